@@ -0,0 +1,223 @@
+// alloc_tracker.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "alloc_tracker.h"
+
+#ifdef ALLOC_TRACKING
+
+#include "../platform/platform.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <ostream>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== ALLOC TRACKER
+
+// Constant-initialized - valid for the allocations of the static constructors
+static std::atomic<std::uint64_t> total_allocs{0};
+static std::atomic<std::uint64_t> total_frees{0};
+static std::atomic<std::uint64_t> total_bytes{0};
+static std::atomic<std::uint64_t> violations{0};
+
+static thread_local std::uint64_t thread_allocs = 0;
+static thread_local const char* forbidden_region = nullptr;
+
+// The log of a violation must not report itself
+static thread_local bool reporting = false;
+
+
+static void count_alloc(std::size_t size)
+{
+    total_allocs.fetch_add(1, std::memory_order_relaxed);
+    total_bytes.fetch_add(size, std::memory_order_relaxed);
+    ++thread_allocs;
+
+    if (!forbidden_region || reporting) return;
+
+    violations.fetch_add(1, std::memory_order_relaxed);
+
+#ifndef NDEBUG
+    reporting = true;
+    SDL_Log("Allocation of %zu bytes in the zero-allocation region %s", size, forbidden_region);
+    reporting = false;
+#endif
+}
+
+
+static void* tracked_alloc(std::size_t size)
+{
+    count_alloc(size);
+
+    // malloc(0) may return nullptr - operator new must not
+    return std::malloc(size ? size : 1);
+}
+
+
+// The aligned blocks keep the malloc pointer right before the aligned one
+static void* tracked_aligned_alloc(std::size_t size, std::size_t alignment)
+{
+    count_alloc(size);
+
+    void* raw = std::malloc(size + alignment + sizeof(void*));
+
+    if (!raw) return nullptr;
+
+    const std::uintptr_t start = reinterpret_cast<std::uintptr_t>(raw) + sizeof(void*);
+    void* aligned = reinterpret_cast<void*>((start + alignment - 1) & ~static_cast<std::uintptr_t>(alignment - 1));
+
+    static_cast<void**>(aligned)[-1] = raw;
+
+    return aligned;
+}
+
+
+static void tracked_free(void* p)
+{
+    if (!p) return;
+
+    total_frees.fetch_add(1, std::memory_order_relaxed);
+    std::free(p);
+}
+
+
+static void tracked_aligned_free(void* p)
+{
+    if (!p) return;
+
+    total_frees.fetch_add(1, std::memory_order_relaxed);
+    std::free(static_cast<void**>(p)[-1]);
+}
+
+
+Alloc_tracker& Alloc_tracker::Instance()
+{
+    static Alloc_tracker instance;
+    return instance;
+}
+
+
+std::uint64_t Alloc_tracker::get_thread_allocs() { return thread_allocs; }
+
+
+Alloc_counts Alloc_tracker::get_totals()
+{
+    Alloc_counts counts;
+
+    counts.allocs = total_allocs.load(std::memory_order_relaxed);
+    counts.frees = total_frees.load(std::memory_order_relaxed);
+    counts.bytes = total_bytes.load(std::memory_order_relaxed);
+
+    return counts;
+}
+
+
+std::uint64_t Alloc_tracker::get_violation_count() { return violations.load(std::memory_order_relaxed); }
+
+
+const char* Alloc_tracker::begin_forbidden(const char* region)
+{
+    const char* previous = forbidden_region;
+
+    if (region) forbidden_region = region;
+
+    return previous;
+}
+
+
+void Alloc_tracker::end_forbidden(const char* previous) { forbidden_region = previous; }
+
+
+void Alloc_tracker::end_frame()
+{
+    const Alloc_counts now = get_totals();
+
+    last_frame.allocs = now.allocs - frame_start.allocs;
+    last_frame.frees = now.frees - frame_start.frees;
+    last_frame.bytes = now.bytes - frame_start.bytes;
+
+    frame_start = now;
+
+    ++frames;
+
+    if (last_frame.allocs > 0) ++allocating_frames;
+    if (last_frame.allocs > max_frame_allocs) max_frame_allocs = last_frame.allocs;
+    if (last_frame.bytes > max_frame_bytes) max_frame_bytes = last_frame.bytes;
+}
+
+
+void Alloc_tracker::dump(std::ostream& out) const
+{
+    const Alloc_counts totals = get_totals();
+
+    out << "Heap: " << totals.allocs << " allocations (" << totals.bytes << " bytes), " << totals.frees << " frees\n";
+    out << "  frames: " << frames << ", with allocations: " << allocating_frames
+        << ", max per frame: " << max_frame_allocs << " (" << max_frame_bytes << " bytes)\n";
+    out << "  zero-allocation region violations: " << get_violation_count() << "\n";
+}
+
+// =========================================================================================== ALLOC TRACKER
+
+
+// =========================================================================================== GLOBAL OPERATORS
+
+void* operator new(std::size_t size)
+{
+    if (void* p = tracked_alloc(size)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    if (void* p = tracked_alloc(size)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return tracked_alloc(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return tracked_alloc(size); }
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    if (void* p = tracked_aligned_alloc(size, static_cast<std::size_t>(alignment))) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    if (void* p = tracked_aligned_alloc(size, static_cast<std::size_t>(alignment))) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return tracked_aligned_alloc(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return tracked_aligned_alloc(size, static_cast<std::size_t>(alignment));
+}
+
+
+void operator delete(void* p) noexcept { tracked_free(p); }
+void operator delete[](void* p) noexcept { tracked_free(p); }
+void operator delete(void* p, std::size_t) noexcept { tracked_free(p); }
+void operator delete[](void* p, std::size_t) noexcept { tracked_free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { tracked_free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { tracked_free(p); }
+
+void operator delete(void* p, std::align_val_t) noexcept { tracked_aligned_free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { tracked_aligned_free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { tracked_aligned_free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { tracked_aligned_free(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { tracked_aligned_free(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { tracked_aligned_free(p); }
+
+// =========================================================================================== GLOBAL OPERATORS
+
+#endif
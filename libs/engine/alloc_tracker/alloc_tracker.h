@@ -0,0 +1,149 @@
+// alloc_tracker.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+#include <iosfwd>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== ALLOC TRACKER
+
+// Optional heap instrumentation, enabled by the ALLOC_TRACKING define (CMake option
+// MIYOO_ALLOC_TRACKING). It replaces the global operator new / delete - without the
+// define nothing below is compiled and the regions are empty macros.
+
+#ifdef ALLOC_TRACKING
+
+#define ALLOC_TRACKER_CONCAT_INNER(a, b) a##b
+#define ALLOC_TRACKER_CONCAT(a, b) ALLOC_TRACKER_CONCAT_INNER(a, b)
+
+// The rest of the scope must not allocate - the debug builds log every allocation in it.
+// The name must be a string literal (the pointer is stored).
+#define ALLOC_FORBID_SCOPE(name) Alloc_forbid_scope ALLOC_TRACKER_CONCAT(alloc_forbid_, __LINE__)(name)
+
+// Same, only while the condition holds (the steady state of the frame loop)
+#define ALLOC_FORBID_SCOPE_IF(condition, name) \
+    Alloc_forbid_scope ALLOC_TRACKER_CONCAT(alloc_forbid_, __LINE__)((condition) ? (name) : nullptr)
+
+
+// Allocations, frees and the allocated bytes
+struct Alloc_counts
+{
+    std::uint64_t allocs = 0;
+    std::uint64_t frees = 0;
+    std::uint64_t bytes = 0;
+};
+
+
+/**
+ * @brief Counts every operator new / delete of the process, per frame and per zone.
+ *
+ * The global counters are relaxed atomics, the thread counter (get_thread_allocs()) is
+ * thread-local - the Zone_profiler stores it with every zone event, so the trace shows
+ * the allocations of every zone. end_frame() splits the totals into the frames.
+ *
+ * A zero-allocation region (ALLOC_FORBID_SCOPE) marks the code, which must not touch
+ * the heap in the steady state - the application wraps state_update and state_render
+ * in them, a while after the last state change. An allocation inside one is counted
+ * as a violation and, in the debug builds, logged with the region name and the size -
+ * the place to break on.
+ *
+ * Singleton, like Lang_state (the counters themselves are static - operator new runs
+ * before main()).
+ *
+ * Usage:
+ * @code
+ * {
+ *     ALLOC_FORBID_SCOPE("particles_update");
+ *     particles.update(dt);
+ * }
+ *
+ * Alloc_tracker::Instance().end_frame();
+ * @endcode
+ */
+class Alloc_tracker
+{
+
+public:
+
+    // Returns the singleton instance.
+    static Alloc_tracker& Instance();
+
+
+    // Allocations of the calling thread since its start
+    static std::uint64_t get_thread_allocs();
+
+    // Process totals since the start
+    static Alloc_counts get_totals();
+
+    // Allocations inside the zero-allocation regions
+    static std::uint64_t get_violation_count();
+
+
+    // === ZERO-ALLOCATION REGIONS (Alloc_forbid_scope) ===
+
+    // Regions of the calling thread nest, the innermost name is reported (nullptr - the outer one stays)
+    static const char* begin_forbidden(const char* region);
+    static void end_forbidden(const char* previous);
+
+    // === ZERO-ALLOCATION REGIONS ===
+
+
+    // Main thread, once per cycle - the counts since the previous call are the frame's
+    void end_frame();
+
+    const Alloc_counts& get_last_frame() const { return last_frame; }
+
+    // Prints the frame statistics
+    void dump(std::ostream& out) const;
+
+
+private:
+
+    Alloc_tracker() = default;
+
+    // Singleton - not copyable
+    Alloc_tracker(const Alloc_tracker&) = delete;
+    Alloc_tracker& operator=(const Alloc_tracker&) = delete;
+
+
+    Alloc_counts frame_start;
+    Alloc_counts last_frame;
+
+    std::uint64_t frames = 0;
+    std::uint64_t allocating_frames = 0;
+    std::uint64_t max_frame_allocs = 0;
+    std::uint64_t max_frame_bytes = 0;
+};
+
+
+// Zero-allocation region of the scope
+class Alloc_forbid_scope
+{
+
+public:
+
+    explicit Alloc_forbid_scope(const char* region) : previous(Alloc_tracker::begin_forbidden(region)) {}
+    ~Alloc_forbid_scope() { Alloc_tracker::end_forbidden(previous); }
+
+    Alloc_forbid_scope(const Alloc_forbid_scope&) = delete;
+    Alloc_forbid_scope& operator=(const Alloc_forbid_scope&) = delete;
+
+
+private:
+
+    const char* previous;
+};
+
+#else
+
+#define ALLOC_FORBID_SCOPE(name) ((void)0)
+#define ALLOC_FORBID_SCOPE_IF(condition, name) ((void)0)
+
+#endif
+
+// =========================================================================================== ALLOC TRACKER
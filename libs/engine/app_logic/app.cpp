@@ -1,9 +1,221 @@
 #include "app.h"
+#include "../startup_trace/startup_trace.h"
+#include "../shape_cache/shape_cache.h"
+#include "../palette/palette.h"
+#include "../layers/layer_stack.h"
+#include "../tile_map/tile_map.h"
+#include "../asset/asset_manager.h"
+#include "../asset/asset_loader.h"
+#include "../asset/asset_prefetch.h"
+#include "../asset/texture_budget.h"
+#include "../asset/asset_stats.h"
+#include "../asset/decoded_cache.h"
+#include "../audio/audio_mixer.h"
+#include "../audio/audio_timeline.h"
+#include "../input_latency/input_latency.h"
+#include "../engine_clock/engine_clock.h"
+#include "../event_bus/event_bus.h"
+#include "../tween/tween.h"
+#include "../sprite_anim/sprite_anim.h"
+#include "../particles/particle_system.h"
+#include "../lang_state/lang_state.h"
+#include "../text/text_cache.h"
+#include "../ui/ui_menu.h"
+#include "../debug_overlay/debug_overlay.h"
+#include "../zone_profiler/zone_profiler.h"
+#include "../alloc_tracker/alloc_tracker.h"
+#include "../render_queue/render_queue.h"
+#include "../render_capture/render_capture.h"
+#include "../culling/view_culler.h"
+#include "../frame_stats/frame_stats.h"
+#include "../frame_stats/present_stats.h"
+#include "../render_stats/render_stats.h"
+#include "../render_target_pool/render_target_pool.h"
+#include "../telemetry/telemetry.h"
+#include "../log/log.h"
+#include "../sampling_profiler/sampling_profiler.h"
+#include "../renderer_probe/renderer_probe.h"
+#include "../blit/hw_blitter.h"
+#include "../frame_arena/frame_arena.h"
+#include "../memory/allocator.h"
+#include "../memory_report/memory_report.h"
+#include "../asset/asset_instance.h"
+#include "../jobs/job_system.h"
+#include "../jobs/completion_queue.h"
+#include "../script/state_script.h"
+#include "../save/save_system.h"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
 
+// Memory accounting of the engine subsystems - a static, so it outlives the singletons using it
+
+struct Subsystem_memory
+{
+    Tracking_allocator states{"states"};
+    Tracking_allocator assets{"assets"};
+    Tracking_allocator audio{"audio"};
+    Tracking_allocator pools{"pools"};
+};
+
+static Subsystem_memory& subsystem_memory()
+{
+    static Subsystem_memory memory;
+    return memory;
+}
+
+
+// The image variants loaded from now on follow the scale of the drawing, lowered by the quality level
+
+static void apply_image_variant_policy(sdl_app_ctx* app)
+{
+    // The logical target is drawn 1:1, the SDL logical size fallback magnifies every copy
+    float scale_x = 1.0f, scale_y = 1.0f;
+    SDL_RenderGetScale(app->renderer, &scale_x, &scale_y);
+
+    Asset_manager::Instance().set_image_variant_policy(std::max(scale_x, scale_y) * app->quality.get_resolution_scale(),
+                                                       app->texture_budget_bytes);
+}
+
+
+// The logical target follows the output size - no target, if the output is the logical size
+
+static void apply_logical_size(sdl_app_ctx* app)
+{
+    if (!app->renderer) return;
+
+    if (!Frame::Instance().is_partial_redraw() &&
+        !Frame::Instance().set_logical_size(app->renderer, app->logical_width, app->logical_height, app->integer_scale))
+        SDL_Log("Logical resolution %dx%d is not available - drawing at the output size", app->logical_width, app->logical_height);
+
+    apply_image_variant_policy(app);
+}
+
+
+// The optional work of the watchdog's level - every step is set, the order is the watchdog's
+
+static void apply_quality(sdl_app_ctx* app)
+{
+    const Quality_watchdog& quality = app->quality;
+
+    Particle_system::set_spawn_share(quality.get_particle_share());
+
+    app->app_sm.set_effects_enabled(quality.allows_effects());
+
+    // Half of the full rate - the configured limit, else the frame rate of the loop
+    const double full_hz = app->quality_render_hz > 0.0 ? app->quality_render_hz : app->target_fps > 0.0 ? app->target_fps : app->sim_hz;
+
+    app->render_hz = quality.halves_render_rate() ? 0.5 * full_hz : app->quality_render_hz;
+    app->render_accumulator = 0.0;
+
+    apply_image_variant_policy(app);
+}
+
+
+// A non-resumable configuration (the menus, the exit) writes an empty snapshot - the next start is cold
+
+static void save_resume_snapshot(sdl_app_ctx* app)
+{
+    if (!app->resume_path || app->app_state != SDL_APP_CONTINUE) return;
+
+    app->app_sm.save_snapshot(app->resume_bytes);
+    Save_system::Instance().save(app->resume_path, app->resume_bytes);
+}
+
+
+// Minimized or asleep: the cycles stop, the render caches rebuilt by the draws are released
+
+static void enter_background(sdl_app_ctx* app)
+{
+    if (app->backgrounded) return;
+
+    app->backgrounded = true;
+
+    // The sleep may end with a kill
+    save_resume_snapshot(app);
+
+    if (app->background_release_caches)
+    {
+        Shape_cache::Instance().clear();
+        Layer_stack::release_all_stacks();
+        Tile_map::release_all_maps();
+        Ui_menu::release_all_menus();
+        Text_cache::Instance().clear();
+        Debug_overlay::Instance().release();
+        app->app_sm.release_render_resources();
+
+        // Everything released above is idle in the pool now
+        Render_target_pool::Instance().clear();
+    }
+
+    const int evicted = app->background_evict_textures ? Texture_budget::Instance().evict_all() : 0;
+
+    SDL_Log("Background: render caches %s, %d textures evicted", app->background_release_caches ? "released" : "kept", evicted);
+}
+
+
+// The first frame draws the visible state only - its caches and textures come back on demand,
+// the rest of the evicted textures follow in the next cycles (restore_queued())
+
+static void leave_background(sdl_app_ctx* app)
+{
+    if (!app->backgrounded) return;
+
+    app->backgrounded = false;
+
+    // Nothing to catch up with - the sleep doesn't turn into the update ticks
+    app->last_cycle_counter = Engine_clock::now();
+    app->pacer.resume();
+
+    app->app_sm.invalidate_overlay_backdrop();
+    Frame::Instance().mark_dirty();
+}
+
+
 bool SDL_app_init(sdl_app_ctx* app, int w, int h, const char* title)
 {
+    // Before any engine thread - every one applies its role at its start
+    if (app->enable_thread_roles)
+    {
+        const Thread_role_config roles[] = {app->thread_role_main, app->thread_role_audio, app->thread_role_worker, app->thread_role_io};
+
+        Thread_roles::Instance().configure(roles);
+        Thread_roles::Instance().apply(Thread_role::MAIN);
+    }
+    else Thread_roles::Instance().disable();
+
+    // First - the log of the whole startup is in the file
+    if (app->telemetry_path) Telemetry::Instance().open(app->telemetry_path, app->telemetry_buffer_bytes, true);
+
+    // The state callbacks log from here on - the console writes leave the game thread
+    Log::Instance().start();
+
+    // Before the first image load - the decodes of the previous launch are mapped
+    if (app->decoded_cache_path) Decoded_cache::Instance().open(app->decoded_cache_path, app->decoded_cache_pending_bytes);
+
+    // Before the first state, asset and mix buffer
+    Subsystem_memory& memory = subsystem_memory();
+
+    app->app_sm.set_allocator(memory.states);
+    Asset_manager::Instance().set_allocator(memory.assets);
+    Instance_pool<Image_instance>::shared().set_allocator(memory.pools);
+    Instance_pool<Audio_instance>::shared().set_allocator(memory.pools);
+    Audio_mixer::Instance().set_allocator(memory.audio);
+
+    // The zones of the main thread are in the traces and the samples from here on
+    PROFILE_THREAD("main");
+
+#ifdef SAMPLING_PROFILER
+    if (app->sample_profile_path)
+        Sampling_profiler::Instance().start(app->sample_profile_path, app->sample_hz, app->sample_capacity);
+#else
+    if (app->sample_profile_path) SDL_Log("Built without MIYOO_SAMPLING_PROFILER - no sampling profile");
+#endif
+
+    // Read by the drivers with a choice of the depth (KMSDRM, Raspberry Pi) at the window creation
+    if (app->swap_depth == 2 || app->swap_depth == 3) SDL_SetHint(SDL_HINT_VIDEO_DOUBLE_BUFFER, app->swap_depth == 2 ? "1" : "0");
+
     if (SDL_Init(SDL_INIT_VIDEO) < 0)
     {
         SDL_Log("SDL_Init failed: %s", SDL_GetError());
@@ -12,16 +224,235 @@ bool SDL_app_init(sdl_app_ctx* app, int w, int h, const char* title)
         return false;
     }
 
+    Startup_trace::Instance().mark("SDL_Init");
+
+
+    app->window = SDL_CreateWindow(title, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, w, h, app->window_flags);
+
+    if (!app->window)
+    {
+        SDL_Log("CreateWindow failed: %s", SDL_GetError());
+        app->app_state = SDL_APP_FAILURE;
+        return false;
+    }
+
+    Startup_trace::Instance().mark("SDL_CreateWindow");
+
+
+    // Turned, scaled and converted at the flip - the logical size is the frame size then
+    app->fb.set_present_pass(app->panel_rotation, app->logical_width, app->logical_height,
+                             app->rgb565_backbuffer ? SDL_PIXELFORMAT_RGB565 : SDL_PIXELFORMAT_UNKNOWN);
+
+    if (app->swap_depth > 0) app->fb.set_page_count(app->swap_depth);
+
+    // Native framebuffer output - the software renderer draws into the back page
+    if (app->use_framebuffer && app->fb.open(app->fb_device, app->rgb565_backbuffer ? 16 : 0))
+    {
+        if (app->partial_redraw) SDL_Log("Partial redraw is not supported by the framebuffer output - full redraw is used");
+
+        app->partial_redraw = false;
+        app->request_vsync = false; // The flip waits for the vertical blank itself
+
+        app->renderer = SDL_CreateSoftwareRenderer(app->fb.get_surface());
+
+        if (app->renderer)
+        {
+            if (app->use_hw_blitter) Hw_blitter::Instance().open(app->renderer, app->fb.get_surface(), app->fb.get_physical_address());
+
+            // The queued hardware draws are finished before the page is shown (and graded)
+            Frame::Instance().set_present_hook([](void* fb)
+            {
+                Hw_blitter::Instance().sync();
+                static_cast<Platform::Video*>(fb)->set_color_grade(Frame::Instance().get_color_grade());
+                static_cast<Platform::Video*>(fb)->flip();
+            }, &app->fb);
+        }
+    }
+    else if (app->partial_redraw)
+    {
+        // Software renderer over the persistent window surface - no vsync on this path
+        SDL_Surface* surface = SDL_GetWindowSurface(app->window);
+
+        app->renderer = surface ? SDL_CreateSoftwareRenderer(surface) : nullptr;
+        app->request_vsync = false;
+
+        if (app->renderer) Frame::Instance().set_partial_redraw(app->window);
+    }
+    else
+    {
+        // Vsync is only a request - the frame pacer checks if the driver really honors it
+        Uint32 renderer_flags = app->request_vsync ? SDL_RENDERER_PRESENTVSYNC : 0;
+
+        // The configured driver, else the fastest driver of the device, not the first working one
+        int driver = app->render_driver ? Renderer_probe::find_driver(app->render_driver) : -1;
+
+        if (app->render_driver && driver < 0) SDL_Log("Render driver %s isn't available", app->render_driver);
+
+        if (driver < 0 && app->renderer_probe_path)
+        {
+            driver = Renderer_probe::select_driver(app->window, app->renderer_probe_path);
+
+            Startup_trace::Instance().mark("Renderer_probe");
+        }
 
-    if (SDL_CreateWindowAndRenderer(w, h, 0, &app->window, &app->renderer))
+        app->renderer = SDL_CreateRenderer(app->window, driver, renderer_flags);
+    }
+
+    if (!app->renderer)
     {
-        SDL_Log("CreateWindowAndRenderer failed: %s", SDL_GetError());
+        SDL_Log("CreateRenderer failed: %s", SDL_GetError());
         app->app_state = SDL_APP_FAILURE;
         return false;
     }
 
+    Startup_trace::Instance().mark("SDL_CreateRenderer");
+
+    // The 16-bit targets - only the software renderer keeps them as surfaces of any format
+    if (app->rgb565_backbuffer)
+    {
+        SDL_RendererInfo info;
+
+        if (SDL_GetRendererInfo(app->renderer, &info) == 0 && (info.flags & SDL_RENDERER_SOFTWARE))
+            Frame::Instance().set_target_format(SDL_PIXELFORMAT_RGB565);
+        else
+            SDL_Log("RGB565 backbuffer needs the software renderer - ARGB8888 targets are used");
+    }
+
+    if (app->logical_width > 0 && app->partial_redraw) SDL_Log("Logical resolution is not supported by the partial redraw - output size is used");
+
+    apply_logical_size(app);
+
+    app->pacer.init(app->renderer, app->window, app->target_fps, app->request_vsync);
+
+    // The blanks of the scanout estimate - the mode timings of the framebuffer, else the display mode
+    const double fb_refresh = app->fb.is_open() ? app->fb.get_refresh_rate() : 0.0;
+
+    Present_stats::Instance().set_refresh_rate(fb_refresh > 0.0 ? fb_refresh : app->pacer.get_refresh_rate());
+
+    if (app->enable_governor)
+    {
+        app->governor.set_idle_fps(app->governor_idle_fps);
+        app->governor.set_low_battery(app->governor_low_battery_percent, app->governor_low_battery_fps);
+        app->governor.set_thermal_limit(app->governor_thermal_limit);
+        app->governor.open(app->target_fps);
+    }
+
+    if (app->enable_quality_watchdog)
+    {
+        app->quality_render_hz = app->render_hz;
+
+        app->quality.set_max_level(app->quality_max_level);
+        app->quality.set_budget(app->frame_budget_ms > 0.0 ? app->frame_budget_ms / 1000.0 : 1.0 / (app->target_fps > 0.0 ? app->target_fps : 60.0));
+
+        Debug_overlay::Instance().set_status_line(app->quality.get_status());
+    }
+
+    // The reduced target scales only the logical resolution drawn into a target
+    if (app->enable_dynamic_resolution &&
+        (app->logical_width <= 0 || Frame::Instance().is_partial_redraw() || !SDL_RenderTargetSupported(app->renderer)))
+    {
+        SDL_Log("Dynamic resolution needs the logical resolution and the render targets - it is off");
+        app->enable_dynamic_resolution = false;
+    }
+
+    if (app->enable_dynamic_resolution)
+    {
+        const double frame_budget = app->frame_budget_ms > 0.0 ? app->frame_budget_ms / 1000.0 : 1.0 / (app->target_fps > 0.0 ? app->target_fps : 60.0);
+
+        app->resolution.set_min_scale(app->dynamic_resolution_min_scale);
+        app->resolution.set_budget(app->fill_budget_ms > 0.0 ? app->fill_budget_ms / 1000.0 : 0.6 * frame_budget);
+    }
+
+    // No workers - the jobs run in place, nothing else changes
+    Job_system::Instance().start(app->job_workers);
+
+    if (app->enable_saves) Save_system::Instance().start();
+
+    // Falls back to the single-threaded cycle, if the worker can't be created
+    if (app->pipelined_update && !app->pipeline.start()) app->pipelined_update = false;
+
+    Texture_budget::Instance().set_budget(app->texture_budget_bytes);
+    Asset_prefetcher::Instance().set_lock_hot(app->lock_hot_assets);
+
+    Frame_arena::Instance().reserve(app->frame_arena_bytes, app->frame_arena_buffered_bytes);
+
+    // No audio device is not fatal - the game runs silent
+    if (app->enable_audio)
+    {
+        Audio_mixer::Instance().set_voice_limit(app->audio_voice_limit);
+        Audio_mixer::Instance().open(app->audio_sample_rate, app->audio_buffer_frames);
+    }
+
+    // The configured language, else the default - no table is not fatal, the strings are empty
+    Lang_list language = Lang_list::LIMIT;
+
+    for (unsigned int i = 0; app->language && i < static_cast<unsigned int>(Lang_list::LIMIT); ++i)
+        if (!std::strcmp(Lang_state::Get_lang_code(static_cast<Lang_list>(i)), app->language)) language = static_cast<Lang_list>(i);
+
+    if (app->language && language == Lang_list::LIMIT) SDL_Log("Language %s isn't available", app->language);
+
+    if (language != Lang_list::LIMIT) Lang_state::Instance().Set_lang(language);
+    else Lang_state::Instance().Load_strings();
+
+    // Nobody reads mouse, touch or text events - don't let them fill the queue
+    Input::Instance().disable_unused_events();
+
+    // No config file is not an error - the built-in layout stays
+    if (app->input_config_path && Input::Instance().load_mapping(app->input_config_path))
+        SDL_Log("Input mapping: %s", app->input_config_path);
+
+    // The pads connected later come as SDL_CONTROLLERDEVICEADDED events
+    if (app->enable_game_controllers && !Input::Instance().open_controllers()) app->enable_game_controllers = false;
+
+    // The connected joysticks come as SDL_JOYDEVICEADDED events
+    if (app->enable_joystick && SDL_InitSubSystem(SDL_INIT_JOYSTICK) != 0)
+    {
+        SDL_Log("Joystick init failed: %s", SDL_GetError());
+        app->enable_joystick = false;
+    }
+
+    // The replay takes over the buttons - the live ones are ignored
+    if (app->input_replay_path && app->input_recording.start_replay(app->input_replay_path))
+    {
+        Input::Instance().set_external_buttons(true);
+
+        if (app->input_recording.get_recorded_sim_hz() != app->sim_hz)
+            SDL_Log("Input replay was recorded at %.3f Hz, replayed at %.3f Hz", app->input_recording.get_recorded_sim_hz(), app->sim_hz);
+    }
+    else if (app->input_record_path) app->input_recording.start_recording(app->input_record_path, app->sim_hz);
+
+    // The SDL key events of the buttons are ignored then, the reader thread has seen them first
+    if (!app->input_recording.is_replaying() && app->use_evdev_input && app->evdev.open(app->evdev_device))
+        Input::Instance().set_external_buttons(true);
+
+#ifdef ZONE_PROFILING
+    Zone_profiler::Instance().set_stutter_export(app->zone_stutter_ms, app->zone_stutter_prefix);
+#endif
+
+    // The replay draws at the size the commands were recorded at
+    if (app->render_capture_path)
+    {
+        int view_w = 0, view_h = 0;
+
+        Frame::Instance().get_logical_size(view_w, view_h);
+
+        if (view_w <= 0 || view_h <= 0) SDL_GetRendererOutputSize(app->renderer, &view_w, &view_h);
+
+        Render_capture::Instance().open(app->render_capture_path, app->render_capture_frames, view_w, view_h);
+    }
+
+    // No target rate (the benchmarks) - the 60 Hz frame
+    const double target_frame_ms = 1000.0 / (app->target_fps > 0.0 ? app->target_fps : 60.0);
+
+    Frame_stats::Instance().set_thresholds(app->frame_budget_ms > 0.0 ? app->frame_budget_ms : target_frame_ms, app->frame_stutter_ms);
+
+    Debug_overlay::Instance().set_font_path(app->debug_overlay_font);
+    Debug_overlay::Instance().set_enabled(app->enable_debug_overlay);
+
     app->app_state = SDL_APP_CONTINUE;
 
+    Startup_trace::Instance().mark("SDL_app_init");
+
     return true;
 }
 
@@ -31,38 +462,814 @@ void SDL_app_event(sdl_app_ctx* app, SDL_Event* event)
     // Main SDL events handler
     if (event->type == SDL_QUIT)
     {
+        save_resume_snapshot(app);
+
         app->app_state = SDL_APP_SUCCESS;
         return;
     }
 
+    // The device sleeps (mobile backends) - no frames until the wake
+    if (event->type == SDL_APP_WILLENTERBACKGROUND)
+    {
+        enter_background(app);
+        return;
+    }
+
+    if (event->type == SDL_APP_DIDENTERFOREGROUND)
+    {
+        leave_background(app);
+        return;
+    }
+
+    // Desktop toggle of the debug overlay, the device uses X + Y
+    if (event->type == SDL_KEYDOWN && !event->key.repeat && event->key.keysym.scancode == SDL_SCANCODE_F3)
+    {
+        Debug_overlay::Instance().toggle();
+        return;
+    }
+
+#ifdef ZONE_PROFILING
+    // The zones of the last frames on demand
+    if (event->type == SDL_KEYDOWN && !event->key.repeat && event->key.keysym.scancode == SDL_SCANCODE_F4)
+    {
+        Zone_profiler::Instance().export_trace(app->zone_trace_path);
+        return;
+    }
+#endif
+
+    // The window content could be lost or rescaled - the damage tracking must redraw it
+    if (event->type == SDL_WINDOWEVENT)
+    {
+        switch (event->window.event)
+        {
+            case SDL_WINDOWEVENT_SIZE_CHANGED:
+                apply_logical_size(app);
+                Frame::Instance().mark_dirty();
+                break;
+
+            case SDL_WINDOWEVENT_MINIMIZED:
+                enter_background(app);
+                break;
+
+            case SDL_WINDOWEVENT_RESTORED:
+                leave_background(app);
+                Frame::Instance().mark_dirty();
+                break;
+
+            case SDL_WINDOWEVENT_EXPOSED:
+            case SDL_WINDOWEVENT_SHOWN:
+                Frame::Instance().mark_dirty();
+                break;
+
+            // Key up events are lost without the focus - release everything
+            case SDL_WINDOWEVENT_FOCUS_LOST:
+                Input::Instance().reset();
+                break;
+
+            default: break;
+        }
+    }
+
+    // Target textures lost their content (D3D device reset, GL context loss) - rebuild them
+    if (event->type == SDL_RENDER_TARGETS_RESET || event->type == SDL_RENDER_DEVICE_RESET)
+    {
+        Shape_cache::Instance().clear();
+        Layer_stack::invalidate_all_stacks();
+        Tile_map::invalidate_all_maps();
+        Ui_menu::invalidate_all_menus();
+        app->app_sm.invalidate_overlay_backdrop();
+        Frame::Instance().mark_dirty();
+
+        // The device reset loses the textures themselves - the runs keep their atlas pages
+        if (event->type == SDL_RENDER_DEVICE_RESET)
+        {
+            Text_cache::Instance().clear();
+            apply_logical_size(app);
+        }
+    }
+
+    // The press is followed from its SDL timestamp to the present, which shows it
+    if (event->type == SDL_KEYDOWN && !event->key.repeat && !Input::Instance().has_external_buttons())
+    {
+        const Button b = Input::Instance().map_scancode(event->key.keysym.scancode);
+
+        if (b != BUTTON_COUNT) Input_latency::Instance().on_event(b, Input_latency::from_ticks(event->key.timestamp));
+    }
+    else if (event->type == SDL_JOYBUTTONDOWN && !Input::Instance().has_external_buttons())
+    {
+        const Button b = Input::Instance().map_joystick_button(event->jbutton.button);
+
+        if (b != BUTTON_COUNT) Input_latency::Instance().on_event(b, Input_latency::from_ticks(event->jbutton.timestamp));
+    }
+
+    // Hot-plugged gamepads are opened, so their button events come in
+    if (event->type == SDL_JOYDEVICEADDED && app->enable_joystick)
+    {
+        if (!SDL_JoystickOpen(event->jdevice.which)) SDL_Log("Joystick %d can't be opened: %s", event->jdevice.which, SDL_GetError());
+        return;
+    }
+
+    // Buttons go into the per-frame input snapshot once, the states read it
+    // instead of decoding the raw key events
+    if (Input::Instance().process_event(*event)) return;
+
     // Other functions delegation to state machine
-    if (app->app_sm.get_current_state()) app->app_sm.state_handle_event(*event);
+    if (app->app_sm.get_active_count() > 0) app->app_sm.state_handle_event(*event);
+}
+
+// State update - fixed steps, so the movement doesn't depend on the frame rate.
+// Runs on the pipeline worker thread in the pipelined cycle.
+
+static void run_update_ticks(sdl_app_ctx* app, int ticks, bool pipelined)
+{
+    Input& input = Input::Instance();
+
+    PROFILE_ZONE("update");
+
+    const Uint64 update_start = Debug_overlay::Instance().is_enabled() ? Engine_clock::now() : 0;
+
+    // The heard music frame of the cycle, its ticks share the way to it
+    Audio_timeline& timeline = Audio_timeline::Instance();
+    timeline.begin_cycle(ticks, Engine_clock::time.tick_dt);
+
+    for (int i = 0; i < ticks; ++i)
+    {
+        // The recorded tick replaces the live buttons, the end of the replay releases them
+        if (app->input_recording.is_replaying())
+        {
+            Input_snapshot recorded;
+
+            app->input_recording.replay_tick(recorded);
+            input.set_snapshot(recorded);
+        }
+        else if (app->input_recording.is_recording()) app->input_recording.record_tick(input.get_snapshot());
+
+        const std::uint32_t pressed = input.get_snapshot().pressed;
+
+        if (app->app_sm.get_active_count() > 0)
+        {
+            ALLOC_FORBID_SCOPE_IF(app->alloc_steady, "state_update");
+
+            // The slow states run at once on the input edges
+            app->app_sm.state_update((pressed | input.get_snapshot().released) != 0);
+        }
+
+        // The tweens started by the tick move with it
+        Tween_system::Instance().update(static_cast<float>(Engine_clock::time.tick_dt));
+
+        // The clips advance by the same tick - the frame changes are written before the render
+        Sprite_animator::Instance().update(static_cast<float>(Engine_clock::time.tick_dt));
+
+        // The music-locked ones by the timeline step instead
+        const float audio_dt = timeline.tick();
+
+        Tween_system::Audio_synced().update(audio_dt);
+        Sprite_animator::Audio_synced().update(audio_dt);
+
+#ifdef STATE_SCRIPTS
+        // The due scripts continue with the tick's input, after the state update
+        Script_runner::Instance().update(static_cast<float>(Engine_clock::time.tick_dt));
+#endif
+
+        Input_latency::Instance().on_update(pressed, pipelined);
+
+        // Every edge is seen by exactly one tick
+        input.end_tick();
+
+        ++app->sim_tick;
+    }
+
+    // Events of the cycle's ticks in one batch per type. The listeners change what the render
+    // reads (the palette, the frame) - the pipelined cycle dispatches them after its sync point.
+    if (!pipelined) Event_bus::Instance().dispatch();
+
+    if (update_start != 0) app->update_time = Engine_clock::now() - update_start;
 }
 
+
+// The scanout starts at the first blank after the flip (the framebuffer), or at the blank,
+// at which a blocking vsync present returned (the SDL path)
+
+static void record_present(sdl_app_ctx* app, Uint64 start, Uint64 end)
+{
+    Present_stats& stats = Present_stats::Instance();
+
+    Uint64 scanout = 0;
+
+    if (app->fb.is_open())
+    {
+        stats.on_vblank(app->fb.get_vblank_time());
+        scanout = stats.next_vblank(app->fb.get_flip_time());
+    }
+    else if (app->pacer.is_vsync_active())
+    {
+        // Blocked for a quarter of the refresh at least - returned at the blank, shown from it
+        if (Engine_clock::to_seconds(end - start) * app->pacer.get_refresh_rate() >= 0.25)
+        {
+            stats.on_vblank(end);
+            scanout = end;
+        }
+        else scanout = stats.next_vblank(end);
+    }
+
+    stats.record(start, end, scanout);
+}
+
+
 bool SDL_app_cycle(sdl_app_ctx* app)
 {
-    // State update
-    if (app->app_sm.get_current_state()) app->app_sm.state_update();
+    // Minimized or asleep - nothing is updated or drawn until the wake
+    if (app->backgrounded) return app->app_state == SDL_APP_CONTINUE;
+
+    // Busy time of the cycle for the governor - without the present wait and the pacing sleep
+    const Uint64 cycle_start = Engine_clock::now();
+
+    // The transient data of the previous frame is gone - the update worker is idle here
+    Frame_arena::Instance().begin_frame();
+
+    Uint64 present_time = 0;
+    Uint64 render_time = 0;
+    Uint64 fill_time = 0;
+
+    Debug_overlay& overlay = Debug_overlay::Instance();
+
+    // X + Y together toggle the overlay, once per press of the combination
+    {
+        const Input_snapshot& in = Input::Instance().get_snapshot();
+        const bool combo = in.is_held(X_BTN) && in.is_held(Y_BTN);
+
+        if (combo && !app->debug_combo_held) overlay.toggle();
+
+        app->debug_combo_held = combo;
+    }
+
+    // Frame boundary - apply the transition requested during the previous frame
+    // (all requests are already collapsed into one by the state machine)
+    app->app_sm.apply_pending_transition();
+
+    // The entered states initialize in slices - interactive once their last step is done. A recorded
+    // or replayed session loads at once: the ticks of a loading state would depend on the machine.
+    if (app->input_recording.is_recording() || app->input_recording.is_replaying()) app->app_sm.finish_loading();
+    else app->app_sm.step_loading(app->state_loading_budget_ms / 1000.0);
+
+    // The text and the pointer events reach the queue only while a state wants them
+    const Uint32 interest = app->app_sm.get_event_interest();
+
+    if (interest != app->event_interest)
+    {
+        Input::Instance().apply_event_interest(interest);
+        app->event_interest = interest;
+    }
+
+    // The last recorded tick was replayed by the previous cycle
+    if (app->replay_quit_at_end && app->input_recording.is_finished())
+    {
+        SDL_Log("Input replay finished: %u ticks", app->input_recording.get_tick_count());
+        app->app_state = SDL_APP_SUCCESS;
+        return false;
+    }
+
+    // The likely next states of the new configuration get their assets loading
+    if (app->asset_prefetch) Asset_prefetcher::Instance().update(app->app_sm);
+
+    // Results of the worker threads - handed back here, once per frame, before anything reads them
+    Completion_queue::Instance().drain();
+
+    // Decoded asynchronous loads - registered and uploaded here, where SDL allows it
+    if (Asset_loader::Instance().pump(app->renderer, app->asset_upload_budget_ms) > 0) Frame::Instance().mark_dirty();
+
+    // The requested language is swapped in here, once it is built - between two frames
+    if (Lang_state::Instance().Update()) Frame::Instance().mark_dirty();
+
+    // Voices played to the end go back to their instances
+    Audio_mixer::Instance().update();
+
+    Input_latency& latency = Input_latency::Instance();
+
+    latency.begin_cycle();
+
+    // The late snapshot of the previous render is stale - the tick one until this cycle latches again
+    Input::Instance().clear_late_latch();
+
+    // Newest button state of the reader thread - the worker is idle, the snapshot is ours
+    if (const std::uint32_t pressed = app->evdev.collect(Input::Instance()))
+    {
+        const std::uint64_t now_ns = Evdev_input::now_ns();
+
+        for (int b = 0; b < BUTTON_COUNT; ++b)
+        {
+            if (!(pressed & (1u << b))) continue;
+
+            const std::uint64_t press_ns = Input::Instance().get_press_time_ns(static_cast<Button>(b));
+
+            latency.on_event(static_cast<Button>(b), Input_latency::from_age_ns(now_ns > press_ns ? now_ns - press_ns : 0));
+        }
+    }
+
+    // Pads are polled once per cycle - no event per axis update
+    if (const std::uint32_t pressed = Input::Instance().poll_controllers())
+    {
+        const Uint64 polled = Engine_clock::now();
+
+        for (int b = 0; b < BUTTON_COUNT; ++b)
+            if (pressed & (1u << b)) latency.on_event(static_cast<Button>(b), polled);
+    }
+
+    // Texture memory over the budget - the least recently used textures go (the previous frame is flushed)
+    Texture_budget::Instance().begin_frame();
+
+    // Render targets idle for too long go, the ones released in the previous frame become reusable
+    Render_target_pool::Instance().begin_frame();
+
+
+    // Elapsed real time since the previous cycle
+    Uint64 now = Engine_clock::now();
+
+    double elapsed = 0.0;
+
+    if (app->last_cycle_counter != 0)
+    {
+        elapsed = Engine_clock::to_seconds(now - app->last_cycle_counter);
+
+        // The previous frame - to the state, which rendered it, unless it was deleted since
+        if (const State* shown = app->app_sm.get_state(app->frame_state))
+            Frame_stats::Instance().record(*shown, app->last_cycle_counter, now);
+    }
+
+    app->last_cycle_counter = now;
+
+    const double step = 1.0 / app->sim_hz;
+
+    // First cycle runs one tick, so the first frame is never drawn before any update
+    if (app->sim_tick == 0 && app->sim_accumulator < step) app->sim_accumulator = step;
+
+    // Clamp the long stalls (debugger, window drag, SD card hitch) to the tick limit
+    app->sim_accumulator += elapsed;
+
+    if (app->sim_accumulator > step * app->max_ticks_per_cycle) app->sim_accumulator = step * app->max_ticks_per_cycle;
+
+
+    // Number of the update ticks in this cycle
+    int ticks = 0;
+
+    while (app->sim_accumulator >= step)
+    {
+        app->sim_accumulator -= step;
+        ++ticks;
+    }
+
+    // The replay workload doesn't depend on the speed of the build
+    if (app->replay_lockstep && app->input_recording.is_replaying())
+    {
+        ticks = 1;
+        app->sim_accumulator = 0.0;
+    }
+
+    // One time for the whole cycle - the ticks and the render read it, nobody writes it until the next cycle
+    Engine_clock::begin_cycle(now, elapsed, ticks, step, static_cast<float>(app->sim_accumulator / step));
+
+    // Pipelined cycle: the worker updates the frame N+1, while this thread renders the frame N
+    // from the published render state. Events are polled only after wait(), so the input
+    // snapshot is never written and read at the same time.
+    bool pipelined = app->pipelined_update && app->app_sm.is_pipelined();
+
+#ifdef ALLOC_TRACKING
+    // Steady state - the caches of the state are warm a while after its last change
+    if (app->app_sm.get_change_counter() != app->alloc_seen_changes)
+    {
+        app->alloc_seen_changes = app->app_sm.get_change_counter();
+        app->alloc_steady_cycles = 0;
+    }
+    else if (app->alloc_steady_cycles < app->alloc_warmup_cycles) ++app->alloc_steady_cycles;
+
+    app->alloc_steady = app->alloc_warmup_cycles > 0 && app->alloc_steady_cycles >= app->alloc_warmup_cycles;
+#endif
+
+    if (pipelined)
+    {
+        app->app_sm.publish_render_state();
+
+        // The publish applies what the worker deferred (a pushed overlay) - the state could leave the pipelined cycle
+        pipelined = app->app_sm.is_pipelined();
+    }
+
+    if (pipelined) app->pipeline.kick([app, ticks]() { run_update_ticks(app, ticks, true); });
+    else run_update_ticks(app, ticks, false);
+
+
+    // Render rate limit (if set). The remainder is kept, so the average rate is exact,
+    // but the lag is never carried over more than one render interval.
+    if (app->render_hz > 0.0)
+    {
+        const double interval = 1.0 / app->render_hz;
+
+        app->render_accumulator += elapsed;
+
+        if (app->render_accumulator < interval)
+        {
+            app->pipeline.wait();
+
+            if (pipelined) Event_bus::Instance().dispatch();
+
+            app->pacer.frame_end(false);
+            return app->app_state == SDL_APP_CONTINUE;
+        }
+
+        app->render_accumulator -= interval;
+
+        if (app->render_accumulator > interval) app->render_accumulator = 0.0;
+    }
+
+
+    // State rendering between the last two ticks.
+    // The engine owns the render pass: Frame clears and presents, the states only draw.
+    bool presented = false;
+
+    if (app->app_sm.get_active_count() > 0)
+    {
+        Frame& frame = Frame::Instance();
+
+        // Transitions and overlay changes always change the screen
+        if (app->app_sm.get_change_counter() != app->seen_sm_changes)
+        {
+            app->seen_sm_changes = app->app_sm.get_change_counter();
+            frame.mark_dirty();
+        }
+
+        // Static states, which didn't mark any damage, skip clear, render and present.
+        // The overlay graph moves every frame - the whole screen is redrawn under it.
+        if (frame.begin(app->renderer, app->app_sm.needs_continuous_redraw() || overlay.is_enabled()))
+        {
+            const float alpha = Engine_clock::time.alpha;
+
+            // The buttons once more, after the update - the render corrects its cheap visuals by them
+            if (app->late_input_latch && !app->input_recording.is_replaying())
+                Input::Instance().latch_late(app->evdev.is_open() ? app->evdev.get_held() : 0);
+
+            Render_capture::Instance().begin_frame(app->renderer);
+
+            const Uint64 render_start = Engine_clock::now();
+
+            // The draws outside of the target are culled before the submission (a state can change the view)
+            {
+                int view_w = 0, view_h = 0;
+
+                frame.get_logical_size(view_w, view_h);
+
+                if (view_w <= 0 || view_h <= 0) SDL_GetRendererOutputSize(app->renderer, &view_w, &view_h);
+
+                View_culler::Instance().set_view({0.0f, 0.0f, static_cast<float>(view_w), static_cast<float>(view_h)});
+            }
+
+            {
+                PROFILE_ZONE("render");
+
+                // One render per damaged region in the partial redraw mode, a single one otherwise
+                do
+                {
+                    ALLOC_FORBID_SCOPE_IF(app->alloc_steady, "state_render");
+                    app->app_sm.state_render(app->renderer, alpha);
+                }
+                while (frame.next_pass());
+
+                render_time = Engine_clock::now() - render_start;
+
+                overlay.render(app->renderer, app->app_sm);
+            }
+
+            const Uint64 present_start = Engine_clock::now();
+
+            {
+                PROFILE_ZONE("present");
+
+                // The draws and the upscale first - the fill time of the dynamic resolution ends there
+                frame.flush();
+                fill_time = Engine_clock::now() - render_start;
+
+                frame.end();
+            }
 
-    // State rendering
-    if (app->app_sm.get_current_state())
+            Render_capture::Instance().end_frame();
+
+            presented = true;
+
+            present_time = Engine_clock::now() - present_start;
+
+            // A GPU driver finishes its queue in the swap - counted, unless the swap waits for the blank
+            if (!app->pacer.is_vsync_active() && !app->fb.is_open()) fill_time = present_start + present_time - render_start;
+
+            record_present(app, present_start, present_start + present_time);
+
+            latency.on_present(frame.get_presented_count());
+        }
+        else latency.on_unchanged_frame();
+    }
+
+    // Sync point - the update is finished before the next events and transitions
+    app->pipeline.wait();
+
+    if (pipelined) Event_bus::Instance().dispatch();
+
+    // Textures evicted for the background, the most recently used first - after the frame is out
+    if (Texture_budget::Instance().get_queued_count() > 0)
+        Texture_budget::Instance().restore_queued(app->background_restore_budget_ms);
+
+    if (overlay.is_enabled())
+    {
+        const std::uint64_t batches = Render_queue::Instance().get_total_batch_count();
+        const int frame_batches = app->seen_batch_count != 0 ? static_cast<int>(batches - app->seen_batch_count) : 0;
+
+        overlay.record(elapsed * 1000.0, Engine_clock::to_seconds(app->update_time) * 1000.0,
+                       Engine_clock::to_seconds(render_time) * 1000.0, frame_batches);
+
+        app->seen_batch_count = batches;
+        app->update_time = 0;
+    }
+    else app->seen_batch_count = 0;
+
+    // The overlay on top was the rendered state
+    const State* shown = app->app_sm.get_top_overlay();
+
+    if (!shown) shown = app->app_sm.get_current_state();
+
+    app->frame_state = shown ? shown->id : State_ID();
+
+    if (shown) Render_stats::Instance().end_frame(*shown);
+
+#ifdef SAMPLING_PROFILER
+    if (shown) Sampling_profiler::Instance().set_state(*shown);
+#endif
+
+    // Metrics line - a copy into the RAM queue, the telemetry thread writes the file
+    Telemetry& telemetry = Telemetry::Instance();
+
+    if (telemetry.is_open())
     {
-        SDL_SetRenderDrawColor(app->renderer, 0, 0, 0, 255);
-        SDL_RenderClear(app->renderer);
+        ++app->telemetry_frames;
+
+        if (app->telemetry_interval_start == 0) app->telemetry_interval_start = now;
+
+        const double seconds = Engine_clock::to_seconds(now - app->telemetry_interval_start);
+
+        if (seconds >= app->telemetry_interval)
+        {
+            const Render_counts& counts = Render_stats::Instance().get_last_frame();
+            const Frame_histogram& frames = Frame_stats::Instance().get_total();
+
+            const Render_target_pool& targets = Render_target_pool::Instance();
+
+            telemetry.writef("metrics: %.1f fps, state %s, draws %llu, over budget %llu, stutters %llu, targets %zu KB (peak %zu KB)",
+                             app->telemetry_frames / seconds, app->app_sm.current_state_label(),
+                             static_cast<unsigned long long>(counts.draw_calls),
+                             static_cast<unsigned long long>(frames.over_budget), static_cast<unsigned long long>(frames.stutters),
+                             targets.get_live_bytes() / 1024, targets.get_peak_bytes() / 1024);
+
+            // The footprint of the interval - the growth over the session
+            Memory_report& memory = Memory_report::Instance();
+            char memory_line[160];
+
+            memory.sample();
+            memory.format_summary(memory_line, sizeof(memory_line), 6);
 
-        app->app_sm.state_render(app->renderer);
+            telemetry.writef("memory: %s", memory_line);
 
-        SDL_RenderPresent(app->renderer);
+            app->telemetry_frames = 0;
+            app->telemetry_interval_start = now;
+        }
     }
 
+#ifdef ZONE_PROFILING
+    Zone_profiler::Instance().end_frame(elapsed * 1000.0);
+#endif
+
+#ifdef ALLOC_TRACKING
+    Alloc_tracker::Instance().end_frame();
+#endif
+
+    const double busy_seconds = Engine_clock::to_seconds(Engine_clock::now() - cycle_start - present_time);
+
+    if (app->governor.is_open())
+    {
+        const bool idle = app->app_sm.can_idle() && !Frame::Instance().has_pending_changes();
+
+        app->governor.update(busy_seconds, idle, app->pacer);
+    }
+
+    // Frames still missing the budget at the governor's clock - the optional work goes
+    if (app->enable_quality_watchdog && app->quality.update(busy_seconds, presented)) apply_quality(app);
+
+    // Frames over the fill budget - the target shrinks before they are dropped
+    if (app->enable_dynamic_resolution && app->resolution.update(Engine_clock::to_seconds(fill_time), presented))
+        Frame::Instance().set_render_scale(app->renderer, app->resolution.get_scale());
+
+    // Sleep until the next frame deadline
+    app->pacer.frame_end(presented);
+
     return app->app_state == SDL_APP_CONTINUE;
 }
 
 
+bool SDL_app_wait_idle(sdl_app_ctx* app)
+{
+    // In the background only the events (the wake, the quit) are waited for
+    if (app->backgrounded && app->app_state == SDL_APP_CONTINUE)
+    {
+        SDL_Event event;
+
+        ++app->idle_waits;
+
+        if (SDL_WaitEventTimeout(&event, app->idle_timeout_ms)) SDL_app_event(app, &event);
+
+        return true;
+    }
+
+    if (app->app_state != SDL_APP_CONTINUE || !app->app_sm.can_idle()) return false;
+
+    // Anything to draw (including the transition and overlay changes) - keep cycling
+    if (Frame::Instance().has_pending_changes() || app->app_sm.get_change_counter() != app->seen_sm_changes) return false;
+
+    // Held buttons could be read by every update tick
+    if (Input::Instance().get_snapshot().held != 0) return false;
+
+    // The overlay graph is a frame every cycle
+    if (Debug_overlay::Instance().is_enabled()) return false;
+
+    // The replayed ticks don't wait for the events
+    if (app->input_recording.is_replaying()) return false;
+
+    // Loads in flight are finished by the cycles
+    if (!Asset_loader::Instance().is_idle()) return false;
+
+    // The language switch is polled by the cycles too
+    if (Lang_state::Instance().Is_switching()) return false;
+
+    SDL_Event event;
+
+    ++app->idle_waits;
+
+    // The sticks send no events - the open pads are polled a few times a second
+    const int timeout = Input::Instance().get_controller_count() ? std::min(app->idle_timeout_ms, 100) : app->idle_timeout_ms;
+
+    bool woken = SDL_WaitEventTimeout(&event, timeout) != 0;
+
+    // Static state has nothing to catch up with - the sleep never turns into the update ticks
+    app->last_cycle_counter = Engine_clock::now();
+    app->pacer.resume();
+
+    if (woken) SDL_app_event(app, &event);
+
+    return true;
+}
+
+
 void SDL_app_shutdown(sdl_app_ctx* app)
 {
+#ifdef SAMPLING_PROFILER
+    // The session only - the shutdown isn't in the profile
+    Sampling_profiler::Instance().stop();
+#endif
+
+    app->pipeline.stop();
+
+    Job_system::Instance().stop();
+
+    // The last footprint of the session - the assets and the states are still loaded
+    if (app->memory_report) Memory_report::Instance().sample();
+
+    // The queued saves are on the card before the process ends
+    Save_system::Instance().stop();
+
+#ifdef STATE_SCRIPTS
+    // The waiting scripts are destroyed while their states are still alive
+    Script_runner::Instance().clear();
+#endif
+
+    const bool evdev_used = app->evdev.is_open();
+
+    app->evdev.close();
+    app->input_recording.stop();
+    Render_capture::Instance().close();
+    Input::Instance().set_external_buttons(false);
+    Input::Instance().close_controllers();
+    Asset_prefetcher::Instance().clear();
+    Asset_loader::Instance().shutdown();
+
+    // The language assets are released through the Asset_manager - before it is cleared
+    Lang_state::Instance().Release_assets();
+
+    // Textures owned by the state machine and the caches must die before the renderer
+    app->app_sm.release_render_resources();
+    Shape_cache::Instance().clear();
+    Layer_stack::release_all_stacks();
+    Tile_map::release_all_maps();
+    Ui_menu::release_all_menus();
+    Debug_overlay::Instance().release();
+    Render_target_pool::Instance().clear();
+    Audio_mixer::Instance().close();
+    Asset_manager::Instance().clear();
+
+    // No image uses the mapped rows anymore - the new decodes are written for the next launch
+    Decoded_cache::Instance().close();
+
+    Palette::Instance().release();
+
+#ifdef STATE_MACHINE_PROFILING
+    app->app_sm.dump_profile(std::cout);
+#endif
+
+    if (app->asset_report)
+    {
+        Asset_stats::Instance().dump(std::cout);
+        Asset_loader::Instance().dump(std::cout);
+        Completion_queue::Instance().dump(std::cout);
+    }
+
+    if (app->decoded_cache_report) Decoded_cache::Instance().dump(std::cout);
+
+#ifdef ALLOC_TRACKING
+    if (app->alloc_report) Alloc_tracker::Instance().dump(std::cout);
+#endif
+
+    if (app->enable_audio && app->audio_report) Audio_mixer::Instance().dump_timing(std::cout);
+
+    if (app->governor_report) app->governor.dump(std::cout);
+
+    if (app->thread_roles_report) Thread_roles::Instance().dump(std::cout);
+
+    if (app->quality_report) app->quality.dump(std::cout);
+
+    if (app->enable_dynamic_resolution && app->dynamic_resolution_report) app->resolution.dump(std::cout);
+
+    if (app->frame_report) Frame_stats::Instance().dump(std::cout);
+
+    if (app->render_report)
+    {
+        Render_stats::Instance().dump(std::cout);
+        Render_target_pool::Instance().dump(std::cout);
+    }
+
+    if (app->present_report)
+    {
+        std::string mode;
+
+        if (app->fb.is_open())
+            mode = "framebuffer, " + std::to_string(app->fb.get_page_count()) + " page(s)";
+        else
+            mode = std::string("renderer, depth ") + (app->swap_depth == 2 ? "2 (hint)" : app->swap_depth == 3 ? "3 (hint)" : "of the driver");
+
+        mode += app->fb.is_open() || app->pacer.is_vsync_active() ? ", vsync" : ", no vsync";
+        mode += ", target " + std::to_string(static_cast<int>(app->target_fps)) + " fps";
+
+        Present_stats::Instance().set_mode(mode);
+        Present_stats::Instance().dump(std::cout);
+    }
+
+    if (app->frame_arena_report) Frame_arena::Instance().dump(std::cout);
+
+    if (app->memory_report)
+    {
+        Tracking_allocator::dump_all(std::cout);
+        Memory_report::Instance().dump(std::cout);
+    }
+
+    // The original cpufreq limit is back before the exit
+    app->governor.close();
+
+    // The latency is compared between these modes
+    if (app->input_latency_report)
+    {
+        std::string mode = std::string(Platform::NAME) + ", ";
+
+        mode += app->fb.is_open() ? "framebuffer" : app->partial_redraw ? "partial redraw" : "renderer";
+
+        if (Hw_blitter::Instance().is_active()) mode += ", hw blitter";
+
+        mode += app->pacer.is_vsync_active() ? ", vsync" : ", no vsync";
+        mode += ", target " + std::to_string(static_cast<int>(app->target_fps)) + " fps";
+
+        if (app->render_hz > 0.0) mode += ", render " + std::to_string(static_cast<int>(app->render_hz)) + " Hz";
+        if (app->pipelined_update) mode += ", pipelined";
+        if (evdev_used) mode += ", evdev input";
+
+        Input_latency::Instance().set_mode(mode);
+        Input_latency::Instance().dump(std::cout);
+    }
+
+    Frame::Instance().release_logical_target();
+
+    // The mirrors of the textures are freed while the renderer is alive
+    Hw_blitter::Instance().close();
+
     if (app->renderer) SDL_DestroyRenderer(app->renderer);
+
+    // The renderer drew into the framebuffer surface - released after it
+    Frame::Instance().set_present_hook(nullptr, nullptr);
+    app->fb.close();
     if (app->window) SDL_DestroyWindow(app->window);
 
+    // Last - the shutdown log is in the file too
+    Log::Instance().stop();
+    Telemetry::Instance().close();
+
     SDL_Quit();
 }
\ No newline at end of file
@@ -1,4 +1,18 @@
+// app.h
+
+#pragma once
+
 #include "../platform/platform.h"
+#include "../frame_pacer/frame_pacer.h"
+#include "../frame/frame.h"
+#include "../input/input.h"
+#include "../input/input_recording.h"
+#include "../pipeline/update_pipeline.h"
+#include "../thread_roles/thread_roles.h"
+#include "../platform/backend.h"
+#include "../governor/perf_governor.h"
+#include "../governor/quality_watchdog.h"
+#include "../governor/resolution_scaler.h"
 #include "../../game_logic/game_states/game_states.h"
 
 
@@ -19,13 +33,579 @@ struct sdl_app_ctx {
     SDL_Window* window = nullptr;
     SDL_Renderer* renderer = nullptr;
 
+    // Extra SDL_CreateWindow flags (SDL_WINDOW_FULLSCREEN_DESKTOP). Set before SDL_app_init().
+    Uint32 window_flags = 0;
+
+    // Language code of the start ("en", "ru"), nullptr - DEFAULT_LANG. Set before SDL_app_init().
+    const char* language = nullptr;
+
     State_machine app_sm;
 
+
+    // === FRAME PACING ===
+
+    // Target frame rate of the main loop, 0 - unlimited. Set before SDL_app_init().
+    double target_fps = 60.0;
+
+    // Request vsync from the renderer (the pacer falls back to sleeping, if it's ignored)
+    bool request_vsync = true;
+
+    // Swap chain depth, 0 - the output default. The framebuffer takes 1 to 3 pages (2 by default),
+    // the SDL path only hints 2 or 3 to the drivers, which have the choice (SDL_HINT_VIDEO_DOUBLE_BUFFER).
+    // 3 keeps the throughput of the late frames for a refresh more of the input latency (Present_stats).
+    // Set before SDL_app_init().
+    int swap_depth = 0;
+
+    // Sleeps until the next frame deadline at the end of every cycle
+    Frame_pacer pacer;
+
+    // State machine change counter seen by the last rendered frame
+    Uint64 seen_sm_changes = ~Uint64{0};
+
+    // Dirty-rectangle mode for the software / fbdev path: the software renderer draws
+    // straight into the window surface, only the damaged regions are recomposed and
+    // copied to the screen. Set before SDL_app_init(), fixed size windows only
+    // (settings.cfg: partial_redraw = on). The framebuffer output keeps the full redraw.
+    bool partial_redraw = false;
+
+    // === FRAME PACING ===
+
+
+    // === RENDERER PROBE ===
+
+    // Render driver choice of the SDL renderer path (Renderer_probe): the first launch
+    // measures every driver and caches the fastest here, the later ones read it.
+    // nullptr - SDL chooses. Set before SDL_app_init().
+    const char* renderer_probe_path = "renderer.cfg";
+
+    // Render driver by its name ("software", "opengles2") - replaces the probe, nullptr - the probe
+    const char* render_driver = nullptr;
+
+    // === RENDERER PROBE ===
+
+
+    // === LOGICAL RESOLUTION ===
+
+    // Fixed resolution the states draw at (Frame::set_logical_size()), scaled to the
+    // window with the nearest filtering - no target on the device, where the output is
+    // this size already. 0 - draw at the output size. Full redraw only, set before SDL_app_init().
+    int logical_width = Platform::LOGICAL_W;
+    int logical_height = Platform::LOGICAL_H;
+
+    // Integer scale factors only (else the largest fitting scale)
+    bool integer_scale = true;
+
+    // === LOGICAL RESOLUTION ===
+
+
+    // === PERFORMANCE GOVERNOR ===
+
+    // Lowers the cpufreq limit and the frame rate to what the frames need (Perf_governor) -
+    // the battery and the SoC temperature cap them. Set before SDL_app_init(), on by
+    // default in the native backend builds.
+    bool enable_governor = Platform::Video::NATIVE;
+
+    // Frame rate of the idle menus
+    double governor_idle_fps = 30.0;
+
+    // Battery percent, at which the CPU and the frame rate are capped, and the capped rate
+    int governor_low_battery_percent = 15;
+    double governor_low_battery_fps = 30.0;
+
+    // SoC temperature limit in degrees C, 0 - no thermal control
+    int governor_thermal_limit = 70;
+
+    // Prints the time at every level at the shutdown
+    bool governor_report = true;
+
+    Perf_governor governor;
+
+    // === PERFORMANCE GOVERNOR ===
+
+
+    // === QUALITY WATCHDOG ===
+
+    // Takes the optional work off, while the frames keep missing the budget (frame_budget_ms, the
+    // frame of target_fps without it), and puts it back with the headroom (Quality_watchdog) - the
+    // particles, the transition effects, the render rate, the image resolution. Set before SDL_app_init().
+    bool enable_quality_watchdog = true;
+
+    // Deepest Quality_level the watchdog goes to
+    int quality_max_level = QUALITY_LOW_RESOLUTION;
+
+    // Prints the time at every level at the shutdown
+    bool quality_report = true;
+
+    // render_hz of the full quality, taken by SDL_app_init() - the halved rate is derived from it
+    double quality_render_hz = 0.0;
+
+    Quality_watchdog quality;
+
+    // === QUALITY WATCHDOG ===
+
+
+    // === DYNAMIC RESOLUTION ===
+
+    // Draws into a reduced logical target, while the fill time of the frames is over its budget,
+    // and upscales it at the present (Resolution_scaler, Frame::set_render_scale()) - a softer image
+    // instead of the dropped frames, the states still draw in the logical units. Needs the logical
+    // resolution and the render targets. Set before SDL_app_init().
+    bool enable_dynamic_resolution = true;
+
+    // Fill budget of a frame (the draws, the upscale, the flush), 0 - 60% of the frame budget
+    // (frame_budget_ms, the frame of target_fps without it), the rest is the update's
+    double fill_budget_ms = 0.0;
+
+    // Smallest scale of the logical size
+    float dynamic_resolution_min_scale = 0.5f;
+
+    // Prints the time at every scale at the shutdown
+    bool dynamic_resolution_report = true;
+
+    Resolution_scaler resolution;
+
+    // === DYNAMIC RESOLUTION ===
+
+
+    // === FRAMEBUFFER ===
+
+    // Draw straight into the mmap-ed Linux framebuffer with the page flipping, instead of
+    // the SDL video driver output (the window is still created for the events).
+    // Full redraw only. Falls back to the SDL renderer if the device can't be opened.
+    // Set before SDL_app_init(), on by default in the native backend builds (Platform).
+    bool use_framebuffer = Platform::Video::NATIVE;
+
+    // Framebuffer device path
+    const char* fb_device = "/dev/fb0";
+
+    // 16-bit software pipeline: the framebuffer is switched to RGB565 and the opaque engine
+    // targets are RGB565 (Frame::set_target_format()) - half the memory traffic, no conversion
+    // on the copies to the screen. Software renderer only, set before SDL_app_init().
+    bool rgb565_backbuffer = false;
+
+    // Clockwise quarter turns of the image on the framebuffer panel (2 - an upside down panel).
+    // A turned panel, the logical size other than the panel or the RGB565 drawing on a 32-bit
+    // panel - the frame is drawn apart and presented in one pass (Fb_backend::set_present_pass()).
+    int panel_rotation = 0;
+
+    // Native video part of the build backend - Fb_backend, or the always closed
+    // Sdl_video stub of the SDL builds (open if use_framebuffer worked)
+    Platform::Video fb;
+
+    // Offload the screen fills and the image copies to the SoC 2D engine (Hw_blitter), on the
+    // framebuffer output only. Falls back to the CPU if the vendor libraries aren't there.
+    // Set before SDL_app_init(), on by default in the native backend builds (Platform).
+    bool use_hw_blitter = Platform::Video::NATIVE;
+
+    // === FRAMEBUFFER ===
+
+
+    // === EVDEV INPUT ===
+
+    // Read the buttons from /dev/input/event* on a dedicated thread, instead of the SDL
+    // key events - the cycle takes the newest state, the presses keep their kernel time.
+    // Falls back to the SDL events if no device can be opened. Set before SDL_app_init(),
+    // on by default in the native backend builds (Platform).
+    bool use_evdev_input = Platform::Input_reader::NATIVE;
+
+    // Event device path, nullptr - every device with the buttons
+    const char* evdev_device = nullptr;
+
+    // Input part of the build backend - Evdev_input, or the Sdl_event_input stub
+    // of the SDL builds, which collects nothing (open if use_evdev_input worked)
+    Platform::Input_reader evdev;
+
+    // Prints the press to present latency (Input_latency) with the measured mode at the shutdown
+    bool input_latency_report = true;
+
+    // === EVDEV INPUT ===
+
+
+    // === INPUT MAPPING ===
+
+    // Button layout config (Input::load_mapping()), loaded by SDL_app_init() over the
+    // built-in layout - nullptr or a missing file keeps the built-in one
+    const char* input_config_path = "input.cfg";
+
+    // Opens the joysticks for the mapped joystick buttons (desktop gamepads).
+    // Set before SDL_app_init().
+    bool enable_joystick = false;
+
+    // Polls the SDL game controllers (external pads) once per cycle into the buttons -
+    // their button and axis events are off. Set before SDL_app_init().
+    bool enable_game_controllers = !Platform::Input_reader::NATIVE;
+
+    // Event categories turned on in SDL - follows the interest of the states
+    Uint32 event_interest = EVENT_DEFAULT;
+
+    // === INPUT MAPPING ===
+
+
+    // === INPUT RECORDING ===
+
+    // Records the per-tick button snapshots into the file, saved at the shutdown.
+    // Set before SDL_app_init().
+    const char* input_record_path = nullptr;
+
+    // Replays the recorded snapshots instead of the live buttons (the SDL key events and
+    // the evdev input are ignored). Set before SDL_app_init(), takes over the recording.
+    const char* input_replay_path = nullptr;
+
+    // One update tick per cycle while replaying - every build renders the same frames,
+    // whatever its speed (the game time is not the real time then)
+    bool replay_lockstep = true;
+
+    // Quits after the last replayed tick
+    bool replay_quit_at_end = true;
+
+    Input_recording input_recording;
+
+    // === INPUT RECORDING ===
+
+
+    // === RENDER CAPTURE ===
+
+    // Writes the recorded render commands of the first frames into the file (Render_capture) -
+    // the workload of ./miyoo_render_replay on every backend. Set before SDL_app_init().
+    const char* render_capture_path = nullptr;
+
+    // Frames to capture, then the file is closed
+    int render_capture_frames = 300;
+
+    // === RENDER CAPTURE ===
+
+
+    // === LATE INPUT LATCH ===
+
+    // Re-samples the buttons right before the render (Input::latch_late()) - the states draw
+    // the cheap, latency-sensitive values (a cursor, the square's predicted position) by
+    // Input::get_late_snapshot(). The simulation stays on the tick input. Off while replaying.
+    bool late_input_latch = false;
+
+    // === LATE INPUT LATCH ===
+
+
+    // === FIXED TIMESTEP ===
+
+    // Simulation rate - state_update is called exactly this many times per second
+    double sim_hz = 60.0;
+
+    // Render rate limit, 0 - render on every cycle. Could be dropped to 30 on heavy
+    // scenes: the simulation speed doesn't change, only fewer frames are drawn.
+    double render_hz = 0.0;
+
+    // Max simulation ticks per cycle - protects from the "spiral of death" after a long stall
+    int max_ticks_per_cycle = 5;
+
+    // Not simulated time left from the previous cycles, in seconds
+    double sim_accumulator = 0.0;
+
+    // Time since the last render, in seconds
+    double render_accumulator = 0.0;
+
+    // Engine_clock::now() of the previous cycle (0 - first cycle)
+    Uint64 last_cycle_counter = 0;
+
+    // Total number of the simulation ticks
+    Uint64 sim_tick = 0;
+
+    // === FIXED TIMESTEP ===
+
+
+    // === PIPELINED UPDATE ===
+
+    // Runs the update of the next frame on a worker thread, while the main thread renders
+    // the current one. Only used while the visible state opted in (State_behavior::is_pipelined,
+    // LEVEL_GAMEPLAY does), the other states keep the single-threaded cycle. Set before
+    // SDL_app_init() (settings.cfg: pipelined_update = on).
+    bool pipelined_update = false;
+
+    // Update worker thread (started by SDL_app_init, if pipelined_update is set)
+    Update_pipeline pipeline;
+
+    // === PIPELINED UPDATE ===
+
+
+    // === STATE LOADING ===
+
+    // Main thread time per cycle for the time-sliced initialization of the entered states
+    // (State::enter_step), in ms - the frame they were entered from stays on the screen meanwhile
+    double state_loading_budget_ms = 4.0;
+
+    // === STATE LOADING ===
+
+
+    // === JOB SYSTEM ===
+
+    // Worker threads of the Job_system (parallel_for of the particles and the other
+    // batches), -1 - one per core besides the main thread. Set before SDL_app_init().
+    int job_workers = -1;
+
+    // === JOB SYSTEM ===
+
+
+    // === THREAD ROLES ===
+
+    // CPU affinity, priority and nice value of the engine threads by their role (Thread_roles):
+    // the game, the mixer callback, the workers and the files off each other's way on the
+    // dual-core Miyoo. Set before SDL_app_init(), on by default on the device builds - the
+    // desktop threads keep the scheduler's CPUs and their own priorities.
+    bool enable_thread_roles = Platform::DEVICE;
+
+    Thread_role_config thread_role_main = Thread_roles::device_defaults(Thread_role::MAIN);
+    Thread_role_config thread_role_audio = Thread_roles::device_defaults(Thread_role::AUDIO);
+    Thread_role_config thread_role_worker = Thread_roles::device_defaults(Thread_role::WORKER);
+    Thread_role_config thread_role_io = Thread_roles::device_defaults(Thread_role::IO);
+
+    // Prints the roles and their threads at the shutdown
+    bool thread_roles_report = true;
+
+    // === THREAD ROLES ===
+
+
+    // === SAVES ===
+
+    // Save_system writer thread - the states save and load through it. Off: every load
+    // finds nothing and every save fails (the benchmarks, the replays of a clean start).
+    bool enable_saves = true;
+
+    // Suspend snapshot of the state machine (see State_machine::save_snapshot()), written on
+    // the quit - the lid and the power key end the process through SIGTERM, which SDL delivers
+    // as SDL_QUIT. The next start restores it instead of going through the menus. nullptr - off.
+    const char* resume_path = nullptr;
+
+    // Buffer of the snapshot - swapped with the Save_system one
+    std::vector<std::uint8_t> resume_bytes;
+
+    // === SAVES ===
+
+
+    // === IDLE MODE ===
+
+    // Longest block of SDL_app_wait_idle() without any event, in ms. SDL timers wake
+    // it earlier (SDL_AddTimer callbacks push an event).
+    int idle_timeout_ms = 1000;
+
+    // Number of the idle waits, for the diagnostics
+    Uint64 idle_waits = 0;
+
+    // === IDLE MODE ===
+
+
+    // === BACKGROUND ===
+
+    // Minimized window or the sleep (SDL_APP_WILLENTERBACKGROUND): no cycles run, the loop only
+    // waits for the events. The resume snapshot is written on the entry - the sleep may end with a kill.
+    bool backgrounded = false;
+
+    // Releases the render caches on the entry (the shapes, layers, menus, tile maps, text runs,
+    // the overlay backdrop) - the draws rebuild them from the CPU data, no file IO
+    bool background_release_caches = true;
+
+    // Evicts the unpinned image textures on the entry too - reloaded from the pack after the wake
+    bool background_evict_textures = false;
+
+    // Main thread time per cycle for the reload of the evicted textures after the wake, in ms.
+    // The first frame reloads only what it draws, the rest follows the most recently used first.
+    double background_restore_budget_ms = 2.0;
+
+    // === BACKGROUND ===
+
+
+    // === ASSET LOADING ===
+
+    // Main thread time per cycle for finishing the asynchronous loads (texture uploads), in ms -
+    // the uploads, which would not fit, wait for the next cycles (config upload_budget_ms)
+    double asset_upload_budget_ms = 2.0;
+
+    // Texture memory limit (LRU eviction of the unpinned image textures), 0 - unlimited
+    size_t texture_budget_bytes = 0;
+
+    // Prints the per-asset load times and sizes at the shutdown
+    bool asset_report = true;
+
+    // Loads the manifests of the children and the siblings of the current state in the background
+    bool asset_prefetch = true;
+
+    // mlock the pack pages of the hot manifest assets of the active states, instead of only
+    // prefaulting them (MADV_WILLNEED) - resident for sure, but counted against RLIMIT_MEMLOCK
+    bool lock_hot_assets = false;
+
+    // === ASSET LOADING ===
+
+
+    // === DECODED CACHE ===
+
+    // Decoded images of the loose files (not cooked into a pack), kept from the previous
+    // launch (Decoded_cache): mapped and used in place when the file bytes didn't change,
+    // instead of the decode, the conversion and the premultiplication. Written at the
+    // shutdown, nullptr - off. Set before SDL_app_init().
+    const char* decoded_cache_path = "decoded.cache";
+
+    // Memory of the new results of a launch kept for the write, the rest is decoded again next time
+    size_t decoded_cache_pending_bytes = 16 * 1024 * 1024;
+
+    // Prints the hits and the misses at the shutdown
+    bool decoded_cache_report = true;
+
+    // === DECODED CACHE ===
+
+
+    // === AUDIO ===
+
+    // Software mixer output - the cooked audio must be at this rate
+    bool enable_audio = true;
+    int audio_sample_rate = 44100;
+    int audio_buffer_frames = 1024;
+
+    // Voice pool size (the worst case of the mixer callback), 1 - Audio_mixer::MAX_VOICES
+    int audio_voice_limit = 16;
+
+    // Prints the callback timing, the underruns and the play latency at the shutdown -
+    // lower audio_buffer_frames, until the underruns show up
+    bool audio_report = true;
+
+    // === AUDIO ===
+
+
+    // === DEBUG OVERLAY ===
+
+    // FPS, the frame time graph, the update / render split and the current state over the
+    // frame, X + Y (F3) toggle it. Off - no timing, no draw.
+    bool enable_debug_overlay = false;
+
+    // Baked font of the overlay text
+    const char* debug_overlay_font = "fonts/ui.fnt";
+
+    // X + Y were held in the previous cycle - the toggle is the edge of the combination
+    bool debug_combo_held = false;
+
+    // Time of the update ticks of the cycle (written by the worker in the pipelined cycle)
+    Uint64 update_time = 0;
+
+    // Render_queue batch total at the previous overlay frame
+    std::uint64_t seen_batch_count = 0;
+
+    // === DEBUG OVERLAY ===
+
+
+    // === ZONE PROFILER ===
+
+    // Only with the MIYOO_ZONE_PROFILING build: the Chrome trace of the last frames,
+    // written after a frame over the threshold (0 - never) and on F4
+    double zone_stutter_ms = 50.0;
+    const char* zone_stutter_prefix = "zone_stutter";
+    const char* zone_trace_path = "zone_trace.json";
+
+    // === ZONE PROFILER ===
+
+
+    // === SAMPLING PROFILER ===
+
+    // Only with the MIYOO_SAMPLING_PROFILER build: the collapsed zone stacks of every state,
+    // sampled sample_hz times a CPU second into sample_capacity slots (nullptr - off).
+    // Set before SDL_app_init(), written at the shutdown.
+    const char* sample_profile_path = nullptr;
+    int sample_hz = 250;
+    Uint32 sample_capacity = 16384;
+
+    // === SAMPLING PROFILER ===
+
+
+    // === ALLOC TRACKING ===
+
+    // Only with the MIYOO_ALLOC_TRACKING build: state_update and state_render are
+    // zero-allocation regions after this many cycles without a state change (0 - never)
+    int alloc_warmup_cycles = 120;
+
+    // Prints the per-frame heap statistics at the shutdown
+    bool alloc_report = true;
+
+    // Cycles since the last state change and the change counter seen
+    int alloc_steady_cycles = 0;
+    Uint64 alloc_seen_changes = 0;
+
+    // The regions are armed in this cycle (read by the update worker)
+    bool alloc_steady = false;
+
+    // === ALLOC TRACKING ===
+
+
+    // === FRAME ARENA ===
+
+    // Initial blocks of the Frame_arena (the transient data of a frame, and of two
+    // frames - buffered), grown to the peak after an overflow. Set before SDL_app_init().
+    size_t frame_arena_bytes = 64 * 1024;
+    size_t frame_arena_buffered_bytes = 16 * 1024;
+
+    // Prints the capacities, the peaks and the overflows at the shutdown
+    bool frame_arena_report = true;
+
+    // === FRAME ARENA ===
+
+
+    // === SUBSYSTEM MEMORY ===
+
+    // The states, the asset index, the instance pools and the audio mix buffer are allocated
+    // through their own Tracking_allocator - the live and the peak bytes of every subsystem,
+    // with the asset data, the textures and the arenas (Memory_report), are printed at the shutdown.
+    // The overlay shows the footprint, the telemetry writes it with every metrics line.
+    bool memory_report = true;
+
+    // === SUBSYSTEM MEMORY ===
+
+
+    // === FRAME STATS ===
+
+    // Frame time histograms of every state, printed at the shutdown: a frame over the
+    // budget (0 - the frame of target_fps, 60 Hz without it) is a missed one, a frame over the stutter
+    // threshold (0 - never) is logged with its heaviest zones
+    double frame_budget_ms = 0.0;
+    double frame_stutter_ms = 50.0;
+    bool frame_report = true;
+
+    // State, which rendered the previous frame - the frame is counted at the next cycle start
+    State_ID frame_state;
+
+    // Prints the draw calls, primitives, texture binds, target switches and pixels of every state at the shutdown
+    bool render_report = true;
+
+    // Prints the present block time and the present to scanout latency with the swap chain mode at the shutdown
+    bool present_report = true;
+
+    // === FRAME STATS ===
+
+
+    // === TELEMETRY ===
+
+    // Log file on the SD card, written in blocks by a background thread (nullptr - off):
+    // the SDL_Log output and a metrics line every telemetry_interval seconds.
+    // Set before SDL_app_init().
+    const char* telemetry_path = nullptr;
+    size_t telemetry_buffer_bytes = 256 * 1024;
+    double telemetry_interval = 1.0;
+
+    // Cycles and the time of the current metrics interval
+    int telemetry_frames = 0;
+    Uint64 telemetry_interval_start = 0;
+
+    // === TELEMETRY ===
+
 };
 
-// Functions which calls callbacks for current state from state machine
+// Functions which calls callbacks for current state from state machine.
+//
+// SDL_app_cycle runs the fixed timestep loop: the real elapsed time is accumulated
+// and consumed by state_update in 1 / sim_hz steps, then state_render is called
+// with the interpolation alpha between the last two ticks.
 bool SDL_app_init(sdl_app_ctx* app, int w, int h, const char* title);
 void SDL_app_event(sdl_app_ctx* app, SDL_Event* event);
 bool SDL_app_iterate(sdl_app_ctx* app);
 void SDL_app_shutdown(sdl_app_ctx* app);
-bool SDL_app_cycle(sdl_app_ctx* app);
\ No newline at end of file
+bool SDL_app_cycle(sdl_app_ctx* app);
+
+// Event-driven idle mode: if the visible state is static (State::is_static) and nothing
+// waits to be drawn, blocks in SDL_WaitEventTimeout until an event or idle_timeout_ms,
+// then handles the waking event. The idle time is not simulated by the next cycle.
+// Returns true if the loop was idle.
+bool SDL_app_wait_idle(sdl_app_ctx* app);
\ No newline at end of file
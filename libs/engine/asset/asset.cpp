@@ -8,6 +8,18 @@
 #include "asset_instance.h"         // Automatically #include "asset.h"
 #include <algorithm>                // For std::remove
 
+#include "../preload/preloader.h"
+#include "asset_pack.h"
+#include "decoded_cache.h"
+#include "asset_manager.h"
+#include "texture_budget.h"
+#include "asset_stats.h"
+#include "streaming_audio.h"
+#include "../audio/audio_mixer.h"
+#include "../audio/adpcm.h"
+#include "../blit/hw_blitter.h"
+#include "../blit/blit_kernels.h"
+
 // =========================================================================================== IMPORT
 
 
@@ -24,8 +36,8 @@ Asset::~Asset()
 {
     while (!instances.empty())
     {
-        // Destroy all instances safely
-        auto* instance = *instances.begin();
+        // Destroy all instances safely (from the back - no moves in the list)
+        auto* instance = instances.back();
         delete_instance(instance);
     }
 
@@ -47,7 +59,10 @@ Asset_type Asset::get_type() const
 
 // Asset path getter
 
-const std::string& Asset::get_path() const 
+size_t Asset::get_memory_bytes() const { return 0; }
+
+
+const Interned_string& Asset::get_path() const 
 {
     // Returns the asset path
     return source_path;
@@ -58,23 +73,50 @@ const std::string& Asset::get_path() const
 
 Asset_instance* Asset::add_instance()
 {
-    // Create an instance by the friendly class constructor
-    auto* instance = new Asset_instance(this);
+    // Create an instance in the pool - it registers itself in the instances list
+    return Asset_instance::create_pooled<Asset_instance>(this);
+}
 
-    // Insert the instance inside the instances list
-    instances.insert(instance);
+void Asset::delete_instance(Asset_instance* instance)
+{
+    if (!instance || instance->main_asset != this) return;
 
+    // Pooled - the destructor unregisters it
+    if (instance->release)
+    {
+        instance->release(instance);
+        return;
+    }
 
-    return instance; // Return and adress for the class-object (variable) to use
+    // Owned by the caller - only detached
+    unregister_instance(instance);
+    instance->main_asset = nullptr;
 }
 
-void Asset::delete_instance(Asset_instance* instance)
+
+size_t Asset::get_instance_count() const { return instances.size(); }
+
+
+const std::vector<Asset_instance*>& Asset::get_instances() const { return instances; }
+
+
+void Asset::register_instance(Asset_instance* instance)
 {
-    if (!instance) return;
+    instance->registry_index = instances.size();
+    instances.push_back(instance);
+}
 
-    instances.erase(instance);
 
-    delete instance;
+void Asset::unregister_instance(Asset_instance* instance)
+{
+    size_t index = instance->registry_index;
+
+    if (index >= instances.size() || instances[index] != instance) return;
+
+    // Swap with the last one - the moved instance gets the new index
+    instances[index] = instances.back();
+    instances[index]->registry_index = index;
+    instances.pop_back();
 }
 
 // Instances workflow by the unordered_set methods
@@ -83,6 +125,28 @@ void Asset::delete_instance(Asset_instance* instance)
 // =========================================================================================== ASSET CLASS
 
 
+// Whole file into the memory - the asset decoders read from it
+static bool read_file(const std::string& path, std::vector<unsigned char>& bytes)
+{
+    // Opened apart - SDL_LoadFile() replaces the open error with its own
+    SDL_RWops* rw = SDL_RWFromFile(path.c_str(), "rb");
+
+    if (!rw) return false;
+
+    size_t size = 0;
+    void* data = SDL_LoadFile_RW(rw, &size, 1);
+
+    if (!data) return false;
+
+    const unsigned char* begin = static_cast<const unsigned char*>(data);
+
+    bytes.assign(begin, begin + size);
+    SDL_free(data);
+
+    return true;
+}
+
+
 // =========================================================================================== IMAGE ASSET CLASS
 
 // Image asset constructor
@@ -93,13 +157,264 @@ Image_asset::Image_asset(const std::string& path) :
     Asset(Asset_type::IMAGE, path), 
 
     initial_width(0), 
-    initial_height(0)
+    initial_height(0),
+    logical_width(0),
+    logical_height(0),
+    variant(1),
+    slice_insets{},
+
+    pixels(nullptr),
+    texture(nullptr),
+    texture_region{{0.0f, 0.0f}, {0.0f, 0.0f}},
+    owns_texture(false),
+
+    texture_renderer(nullptr),
+    texture_bytes(0),
+    last_used_frame(0),
+    texture_pinned(false),
+    evicted(false),
+    deferred(false)
 
 {
-    // TODO:
-    // 1. LOAD IMAGE
-    // 2. GET width / height
-    // 3. SAVE PARAMETERS IN initial_width and initial_height
+    variant = Asset_manager::Instance().select_image_variant(path);
+
+    const Pack_entry* entry = Asset_pack::Instance().find(variant > 1 ? pack_variant_name(path, variant) : path);
+
+    // Cooked - the size is in the pack index, the pixels are read on the first use (load_data())
+    if (entry && entry->type == Asset_type::IMAGE && entry->params[0] > 0 && entry->params[1] > 0)
+    {
+        initial_width = entry->params[0];
+        initial_height = entry->params[1];
+
+        logical_width = entry->params[4] ? entry->params[4] : initial_width;
+        logical_height = entry->params[5] ? entry->params[5] : initial_height;
+
+        slice_insets = {static_cast<float>(pack_slice_inset(entry->params[6], 0)), static_cast<float>(pack_slice_inset(entry->params[6], 1)),
+                        static_cast<float>(pack_slice_inset(entry->params[6], 2)), static_cast<float>(pack_slice_inset(entry->params[6], 3))};
+
+        texture_region = {{0.0f, 0.0f}, {static_cast<float>(initial_width), static_cast<float>(initial_height)}};
+
+        deferred = true;
+        return;
+    }
+
+    load_pixels();
+}
+
+
+// Empty image constructor - no loading
+
+Image_asset::Image_asset(const std::string& name, unsigned int width, unsigned int height) :
+
+    Asset(Asset_type::IMAGE, name),
+
+    initial_width(width),
+    initial_height(height),
+    logical_width(width),
+    logical_height(height),
+    variant(1),
+    slice_insets{},
+
+    pixels(nullptr),
+    texture(nullptr),
+    texture_region{{0.0f, 0.0f}, {static_cast<float>(width), static_cast<float>(height)}},
+    owns_texture(false),
+
+    texture_renderer(nullptr),
+    texture_bytes(0),
+    last_used_frame(0),
+    texture_pinned(false),
+    evicted(false),
+    deferred(false)
+
+{
+}
+
+
+// ARGB8888 rows multiplied by the alpha in place - all the ARGB8888 image pixels are premultiplied
+static void premultiply_surface(SDL_Surface* surface)
+{
+    for (int y = 0; y < surface->h; ++y)
+    {
+        std::uint32_t* row = reinterpret_cast<std::uint32_t*>(static_cast<std::uint8_t*>(surface->pixels) + y * surface->pitch);
+        blit_premultiply_argb(row, row, surface->w);
+    }
+}
+
+
+// Premultiplied ARGB8888 rows back to the straight alpha in place - the locked texture of the renderers without blend_mode_premultiplied()
+static void unpremultiply_surface(SDL_Surface* surface)
+{
+    for (int y = 0; y < surface->h; ++y)
+    {
+        std::uint32_t* row = reinterpret_cast<std::uint32_t*>(static_cast<std::uint8_t*>(surface->pixels) + y * surface->pitch);
+        blit_unpremultiply_argb(row, row, surface->w);
+    }
+}
+
+
+// Straight alpha copy of the premultiplied ARGB8888 rows, nullptr on failure
+static SDL_Surface* straight_copy(const SDL_Surface* surface)
+{
+    SDL_Surface* copy = SDL_CreateRGBSurfaceWithFormat(0, surface->w, surface->h, 32, SDL_PIXELFORMAT_ARGB8888);
+
+    if (!copy) return nullptr;
+
+    for (int y = 0; y < surface->h; ++y)
+    {
+        blit_unpremultiply_argb(reinterpret_cast<std::uint32_t*>(static_cast<std::uint8_t*>(copy->pixels) + y * copy->pitch),
+                                reinterpret_cast<const std::uint32_t*>(static_cast<const std::uint8_t*>(surface->pixels) + y * surface->pitch),
+                                surface->w);
+    }
+
+    return copy;
+}
+
+
+// Key seed of the decoded images in the Decoded_cache - the generator part of the key
+static Uint64 image_cache_seed()
+{
+    static const Uint64 seed = Decoded_cache::hash("image", 5);
+
+    return seed;
+}
+
+
+// Read-only surface over the cached ARGB8888 rows, nullptr if the blob isn't an image
+static SDL_Surface* surface_from_blob(const Decoded_blob& blob)
+{
+    const int w = static_cast<int>(blob.params[0]);
+    const int h = static_cast<int>(blob.params[1]);
+    const int pitch = static_cast<int>(blob.params[2]);
+
+    if (blob.params[3] != SDL_PIXELFORMAT_ARGB8888 || w <= 0 || h <= 0 || pitch < w * 4
+        || static_cast<Uint64>(pitch) * h != blob.size) return nullptr;
+
+    return SDL_CreateRGBSurfaceWithFormatFrom(const_cast<void*>(blob.data), w, h, 32, pitch, SDL_PIXELFORMAT_ARGB8888);
+}
+
+
+// Pixels loading - the constructor and the reload of the evicted asset
+
+bool Image_asset::load_pixels()
+{
+    // A copy for the preloader, the file and the stats - once per load, next to the file read
+    const std::string path(source_path.view());
+
+    Asset_stats& stats = Asset_stats::Instance();
+
+    Uint64 started = SDL_GetPerformanceCounter();
+
+    Asset_pack& pack = Asset_pack::Instance();
+
+    const Pack_entry* entry = find_entry();
+
+    // Cooked pixels - the surface is over the mapped pack, no copy at all (a compressed one is decompressed into it)
+    if (entry && entry->type == Asset_type::IMAGE)
+    {
+        pixels = pack.read_image(*entry);
+
+        const bool straight = pixels && pixels->format->format == SDL_PIXELFORMAT_ARGB8888 && !(entry->params[2] & PACK_IMAGE_PREMULTIPLIED);
+
+        // Straight ARGB8888 rows (cooked with --straight) - the decompressed ones are premultiplied in place,
+        // the mapped ones are read-only - a premultiplied copy
+        if (straight && entry->raw_size) premultiply_surface(pixels);
+        else if (straight)
+        {
+            SDL_Surface* copy = SDL_ConvertSurfaceFormat(pixels, SDL_PIXELFORMAT_ARGB8888, 0);
+            SDL_FreeSurface(pixels);
+
+            pixels = copy;
+
+            if (pixels) premultiply_surface(pixels);
+        }
+
+        if (pixels)
+        {
+            stats.record_io(path, Asset_type::IMAGE, Asset_stats::ms_since(started));
+            stats.record_decode(path, Asset_type::IMAGE, 0.0, static_cast<size_t>(pixels->pitch) * pixels->h);
+
+            initial_width = static_cast<unsigned int>(pixels->w);
+            initial_height = static_cast<unsigned int>(pixels->h);
+
+            logical_width = entry->params[4] ? entry->params[4] : initial_width;
+            logical_height = entry->params[5] ? entry->params[5] : initial_height;
+
+            texture_region = {{0.0f, 0.0f}, {static_cast<float>(initial_width), static_cast<float>(initial_height)}};
+            return true;
+        }
+
+        SDL_Log("Image asset %s pack entry is invalid, loading the file", path.c_str());
+    }
+
+    // Raw file in the pack, the splash preload bytes or the file itself - always a memory decode,
+    // so the I/O and the decode are measured apart
+    std::vector<unsigned char> bytes;
+
+    SDL_RWops* rw = entry && entry->type == Asset_type::UNKNOWN ? pack.open(path) : nullptr;
+
+    if (!rw && (Preloader::Instance().take(path, bytes) || read_file(path, bytes)))
+        rw = SDL_RWFromConstMem(bytes.data(), static_cast<int>(bytes.size()));
+
+    stats.record_io(path, Asset_type::IMAGE, Asset_stats::ms_since(started));
+
+    Uint64 decode_started = SDL_GetPerformanceCounter();
+
+    // Decoded by an earlier launch from the same bytes - a surface over the mapped rows
+    Decoded_cache& cache = Decoded_cache::Instance();
+
+    const bool cached = rw && !bytes.empty() && cache.is_open();
+    const Uint64 key = cached ? Decoded_cache::hash(path.data(), path.size(), image_cache_seed()) : 0;
+    const Uint64 content = cached ? Decoded_cache::hash(bytes.data(), bytes.size()) : 0;
+
+    Decoded_blob blob;
+
+    if (cached && cache.find(key, content, blob)) pixels = surface_from_blob(blob);
+
+    if (pixels) SDL_RWclose(rw);
+    else
+    {
+        SDL_Surface* loaded = rw ? SDL_LoadBMP_RW(rw, 1) : nullptr;
+
+        if (!loaded)
+        {
+            SDL_Log("Image asset %s loading failed: %s", path.c_str(), SDL_GetError());
+            return false;
+        }
+
+        // One pixel format for all images - the atlas pages are plain copies
+        pixels = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_ARGB8888, 0);
+        SDL_FreeSurface(loaded);
+
+        if (!pixels)
+        {
+            SDL_Log("Image asset %s conversion failed: %s", path.c_str(), SDL_GetError());
+            return false;
+        }
+
+        premultiply_surface(pixels);
+
+        if (cached)
+        {
+            const Uint32 params[DECODED_PARAM_COUNT] = {static_cast<Uint32>(pixels->w), static_cast<Uint32>(pixels->h),
+                                                        static_cast<Uint32>(pixels->pitch), pixels->format->format};
+
+            cache.store(key, content, pixels->pixels, static_cast<Uint32>(pixels->pitch * pixels->h), params);
+        }
+    }
+
+    stats.record_decode(path, Asset_type::IMAGE, Asset_stats::ms_since(decode_started),
+                        static_cast<size_t>(pixels->pitch) * pixels->h);
+
+    initial_width = static_cast<unsigned int>(pixels->w);
+    initial_height = static_cast<unsigned int>(pixels->h);
+
+    logical_width = initial_width;
+    logical_height = initial_height;
+
+    texture_region = {{0.0f, 0.0f}, {static_cast<float>(initial_width), static_cast<float>(initial_height)}};
+
+    return true;
 }
 
 
@@ -107,9 +422,14 @@ Image_asset::Image_asset(const std::string& path) :
 
 Image_asset::~Image_asset()
 {
-    // TODO: 
-    // 1) Instances free logic
-    // 2) Asset free logic
+    if (evicted) Texture_budget::Instance().cancel_restore(this);
+
+    release_texture();
+
+    if (pixels) SDL_FreeSurface(pixels);
+    pixels = nullptr;
+
+    // Instances are destroyed by the ~Asset()
 }
 
 
@@ -117,7 +437,7 @@ Image_asset::~Image_asset()
 
 unsigned int Image_asset::get_width() const
 {
-    return initial_width;
+    return logical_width;
 }
 
 
@@ -125,9 +445,304 @@ unsigned int Image_asset::get_width() const
 
 unsigned int Image_asset::get_height() const
 {
-    return initial_height;
+    return logical_height;
+}
+
+
+unsigned int Image_asset::get_texel_width() const { return initial_width; }
+
+
+unsigned int Image_asset::get_texel_height() const { return initial_height; }
+
+
+Vec2 Image_asset::get_texel_scale() const
+{
+    if (logical_width == 0 || logical_height == 0) return {1.0f, 1.0f};
+
+    return {static_cast<float>(initial_width) / static_cast<float>(logical_width),
+            static_cast<float>(initial_height) / static_cast<float>(logical_height)};
 }
 
+
+int Image_asset::get_variant() const { return variant; }
+
+
+const Slice_insets& Image_asset::get_slice_insets() const { return slice_insets; }
+
+
+void Image_asset::set_slice_insets(const Slice_insets& insets) { slice_insets = insets; }
+
+
+bool Image_asset::is_loaded() const { return pixels != nullptr || evicted || deferred; }
+
+
+bool Image_asset::load_data()
+{
+    if (deferred)
+    {
+        deferred = false;
+        load_pixels();
+    }
+
+    return pixels != nullptr;
+}
+
+
+bool Image_asset::loads_into_texture() const
+{
+    const Pack_entry* entry = deferred ? find_entry() : nullptr;
+
+    return entry && entry->type == Asset_type::IMAGE && entry->raw_size > 0;
+}
+
+
+const Pack_entry* Image_asset::find_entry() const
+{
+    if (variant > 1) return Asset_pack::Instance().find(pack_variant_name(source_path, variant));
+
+    return Asset_pack::Instance().find(source_path);
+}
+
+
+// Own texture - for the images, which are not packed into an atlas
+
+bool Image_asset::create_texture(SDL_Renderer* renderer)
+{
+    if (texture) return true;
+
+    if (!renderer) return false;
+
+    Uint64 started = SDL_GetPerformanceCounter();
+
+    // Compressed and not read yet - straight into the texture, the image stays deferred (no pixels)
+    if (loads_into_texture()) texture = upload_from_pack(renderer);
+
+    if (!texture)
+    {
+        if (!load_data()) return false;
+
+        started = SDL_GetPerformanceCounter();
+
+        texture = upload_surface(renderer, pixels);
+    }
+
+    if (!texture)
+    {
+        SDL_Log("Image asset %s texture creation failed: %s", source_path.c_str(), SDL_GetError());
+        return false;
+    }
+
+    owns_texture = true;
+    texture_region = {{0.0f, 0.0f}, {static_cast<float>(initial_width), static_cast<float>(initial_height)}};
+
+    texture_renderer = renderer;
+    texture_bytes = Texture_budget::bytes_of(texture);
+    last_used_frame = Texture_budget::Instance().get_frame();
+
+    Texture_budget::Instance().track(this);
+
+    // The pixels stay for the atlas rebuilds and the reloads
+    Asset_stats::Instance().record_upload(std::string(source_path.view()), Asset_type::IMAGE, Asset_stats::ms_since(started),
+                                          texture_bytes + get_memory_bytes());
+
+    return true;
+}
+
+
+SDL_Texture* Image_asset::upload_from_pack(SDL_Renderer* renderer) const
+{
+    const Pack_entry* entry = find_entry();
+
+    if (!entry || entry->type != Asset_type::IMAGE || !entry->raw_size) return nullptr;
+
+    const int w = static_cast<int>(entry->params[0]);
+    const int h = static_cast<int>(entry->params[1]);
+    const Uint32 format = entry->params[2] & ~PACK_IMAGE_PREMULTIPLIED;
+
+    const bool argb = format == SDL_PIXELFORMAT_ARGB8888;
+
+    // Streaming - the one access SDL can lock; written once here and never again
+    SDL_Texture* uploaded = SDL_CreateTexture(renderer, format, SDL_TEXTUREACCESS_STREAMING, w, h);
+
+    if (!uploaded) return nullptr;
+
+    // The blending of upload_surface(): the renderers without the custom blend modes get the straight rows
+    const bool blend_premultiplied = argb && SDL_SetTextureBlendMode(uploaded, blend_mode_premultiplied()) == 0;
+
+    if (!blend_premultiplied) SDL_SetTextureBlendMode(uploaded, SDL_ISPIXELFORMAT_ALPHA(format) ? SDL_BLENDMODE_BLEND : SDL_BLENDMODE_NONE);
+
+    void* locked = nullptr;
+    int pitch = 0;
+
+    bool ok = SDL_LockTexture(uploaded, nullptr, &locked, &pitch) == 0;
+
+    if (ok)
+    {
+        ok = Asset_pack::Instance().read_image_rows(*entry, locked, pitch);
+
+        // Surface header over the locked rows - the in-place alpha passes and the blitter mirror read them
+        SDL_Surface* rows = ok ? SDL_CreateRGBSurfaceWithFormatFrom(locked, w, h, SDL_BITSPERPIXEL(format), pitch, format) : nullptr;
+
+        if (rows)
+        {
+            if (argb && !(entry->params[2] & PACK_IMAGE_PREMULTIPLIED)) premultiply_surface(rows);
+
+            Hw_blitter::Instance().mirror(uploaded, rows, argb);
+
+            if (argb && !blend_premultiplied) unpremultiply_surface(rows);
+
+            SDL_FreeSurface(rows);
+        }
+        else ok = false;
+
+        SDL_UnlockTexture(uploaded);
+    }
+
+    if (!ok)
+    {
+        SDL_DestroyTexture(uploaded);
+        return nullptr;
+    }
+
+    return uploaded;
+}
+
+
+SDL_Texture* Image_asset::get_texture()
+{
+    if (!texture && evicted) restore();
+
+    last_used_frame = Texture_budget::Instance().get_frame();
+
+    return texture;
+}
+
+
+Image_instance* Image_asset::create_instance() { return Asset_instance::create_pooled<Image_instance>(this); }
+
+
+SDL_Texture* Image_asset::upload_surface(SDL_Renderer* renderer, SDL_Surface* surface)
+{
+    const Uint32 format = surface->format->format;
+
+    // ARGB8888 is premultiplied, RGB565 has no alpha - a plain copy is the cheapest one
+    const bool premultiplied = format == SDL_PIXELFORMAT_ARGB8888;
+    const SDL_BlendMode straight_blend = SDL_ISPIXELFORMAT_ALPHA(format) ? SDL_BLENDMODE_BLEND : SDL_BLENDMODE_NONE;
+
+    SDL_Surface* straight = nullptr;
+
+    SDL_Texture* uploaded = SDL_CreateTexture(renderer, format, SDL_TEXTUREACCESS_STATIC, surface->w, surface->h);
+
+    // No custom blend modes (the SDL software renderer) - the texture gets the straight rows
+    if (uploaded && premultiplied && SDL_SetTextureBlendMode(uploaded, blend_mode_premultiplied()) != 0)
+    {
+        straight = straight_copy(surface);
+        SDL_SetTextureBlendMode(uploaded, straight_blend);
+    }
+    else if (uploaded && !premultiplied) SDL_SetTextureBlendMode(uploaded, straight_blend);
+
+    const SDL_Surface* rows = straight ? straight : surface;
+
+    if (uploaded && SDL_UpdateTexture(uploaded, nullptr, rows->pixels, rows->pitch) != 0)
+    {
+        SDL_DestroyTexture(uploaded);
+        uploaded = nullptr;
+    }
+
+    // Not a texture format at all - the SDL choice of the format, straight
+    if (!uploaded)
+    {
+        if (premultiplied && !straight) straight = straight_copy(surface);
+
+        uploaded = SDL_CreateTextureFromSurface(renderer, straight ? straight : surface);
+
+        if (uploaded) SDL_SetTextureBlendMode(uploaded, straight_blend);
+    }
+
+    if (straight) SDL_FreeSurface(straight);
+
+    if (!uploaded) return nullptr;
+
+    // Static pixels - the copies of it can go to the hardware blitter, which blends them premultiplied
+    Hw_blitter::Instance().mirror(uploaded, surface, premultiplied);
+
+    return uploaded;
+}
+
+
+const Rect2& Image_asset::get_texture_region() const { return texture_region; }
+
+
+void Image_asset::release_texture()
+{
+    if (texture && owns_texture)
+    {
+        Texture_budget::Instance().untrack(this);
+        Hw_blitter::Instance().forget(texture);
+        SDL_DestroyTexture(texture);
+    }
+
+    texture = nullptr;
+    owns_texture = false;
+    texture_bytes = 0;
+}
+
+
+// === TEXTURE BUDGET ===
+
+void Image_asset::set_texture_pinned(bool pinned) { texture_pinned = pinned; }
+
+
+bool Image_asset::is_texture_pinned() const { return texture_pinned; }
+
+
+size_t Image_asset::get_texture_bytes() const { return texture_bytes; }
+
+
+size_t Image_asset::get_memory_bytes() const { return pixels ? static_cast<size_t>(pixels->pitch) * pixels->h : 0; }
+
+
+Uint64 Image_asset::get_last_used_frame() const { return last_used_frame; }
+
+
+bool Image_asset::is_evicted() const { return evicted; }
+
+
+bool Image_asset::evict()
+{
+    // Atlas pages are shared, the renderer is needed for the reload
+    if (!texture || !owns_texture || texture_pinned || !texture_renderer) return false;
+
+    release_texture();
+
+    if (pixels) SDL_FreeSurface(pixels);
+    pixels = nullptr;
+
+    evicted = true;
+
+    return true;
+}
+
+
+bool Image_asset::restore()
+{
+    // The compressed pixels are decompressed into the texture again by create_texture()
+    if (!pixels && !loads_into_texture() && !load_pixels())
+    {
+        // The source is gone - don't retry every frame
+        evicted = false;
+        return false;
+    }
+
+    evicted = false;
+
+    Texture_budget::Instance().count_reload();
+
+    return create_texture(texture_renderer);
+}
+
+// === TEXTURE BUDGET ===
+
 // =========================================================================================== IMAGE ASSET CLASS
 
 
@@ -143,14 +758,186 @@ Audio_asset::Audio_asset(const std::string& path) :
     initial_sample_rate(0),
     initial_bitrate(0),
 
-    initial_audio_length{0, 0, 0, 0}
+    initial_audio_length{0, 0, 0, 0},
+
+    channels(0),
+    format(AUDIO_S16SYS),
+
+    storage(Audio_storage::PCM),
+    adpcm_frames(0),
+
+    streaming(false),
+    deferred(false),
+    deferred_frames(0)
+
+{
+    const Pack_entry* entry = Asset_pack::Instance().find(path);
+
+    // Cooked - the format and the length are in the pack index, the samples are read on the first use (load_data())
+    if (entry && entry->type == Asset_type::AUDIO && entry->params[0] > 0 && entry->params[1] > 0)
+    {
+        const bool packed_adpcm = entry->params[2] == PACK_AUDIO_IMA_ADPCM;
+
+        initial_sample_rate = entry->params[0];
+        channels = entry->params[1];
+        format = packed_adpcm ? AUDIO_S16SYS : static_cast<SDL_AudioFormat>(entry->params[2]);
+
+        storage = packed_adpcm ? Audio_storage::IMA_ADPCM : Audio_storage::PCM;
+        adpcm_frames = packed_adpcm ? entry->params[3] : 0;
+        deferred_frames = entry->params[3];
+
+        initial_bitrate = initial_sample_rate * channels * SDL_AUDIO_BITSIZE(format);
+        initial_audio_length = samples_to_time(deferred_frames, initial_sample_rate);
+
+        deferred = true;
+        return;
+    }
+
+    load_samples();
+}
+
+
+bool Audio_asset::load_data()
+{
+    if (deferred)
+    {
+        deferred = false;
+        load_samples();
+    }
+
+    return !pcm.empty() || !adpcm.empty();
+}
+
+
+// Samples loading - the file, or the cooked pack entry on the first use
+
+bool Audio_asset::load_samples()
+{
+    // A copy for the file and the stats - once per load, next to the file read
+    const std::string path(source_path.view());
+
+    Uint32 frames = 0;
+
+    storage = Audio_storage::PCM;
+    adpcm_frames = 0;
+
+    Asset_stats& stats = Asset_stats::Instance();
+
+    Uint64 started = SDL_GetPerformanceCounter();
+
+    Asset_pack& pack = Asset_pack::Instance();
+
+    // Cooked PCM is already at the output rate - a plain copy (or the LZ4 blocks) from the mapped pack
+    const Pack_entry* entry = pack.find(path);
+
+    // Cooked ADPCM - the blocks are kept as is, the mixer decodes them
+    if (entry && entry->type == Asset_type::AUDIO && entry->params[2] == PACK_AUDIO_IMA_ADPCM)
+    {
+        adpcm.resize(pack_data_size(*entry));
+
+        if (pack.read(*entry, adpcm.data()) && adpcm.size() >= adpcm_encoded_size(entry->params[3], entry->params[1]))
+        {
+            initial_sample_rate = entry->params[0];
+            channels = entry->params[1];
+            format = AUDIO_S16SYS;
+            frames = entry->params[3];
+
+            storage = Audio_storage::IMA_ADPCM;
+            adpcm_frames = frames;
+
+            stats.record_io(path, Asset_type::AUDIO, Asset_stats::ms_since(started));
+            stats.record_decode(path, Asset_type::AUDIO, 0.0, adpcm.size());
+        }
+        else adpcm.clear();
+    }
+    else if (entry && entry->type == Asset_type::AUDIO)
+    {
+        pcm.resize(pack_data_size(*entry));
+
+        if (pack.read(*entry, pcm.data()))
+        {
+            initial_sample_rate = entry->params[0];
+            channels = entry->params[1];
+            format = static_cast<SDL_AudioFormat>(entry->params[2]);
+            frames = entry->params[3];
+        }
+        else pcm.clear();
+
+        if (!pcm.empty())
+        {
+            stats.record_io(path, Asset_type::AUDIO, Asset_stats::ms_since(started));
+            stats.record_decode(path, Asset_type::AUDIO, 0.0, pcm.size());
+        }
+    }
+
+    // Not cooked (a raw pack entry or the file) - WAV as is, in its own rate and format
+    if (pcm.empty() && adpcm.empty())
+    {
+        SDL_AudioSpec spec;
+        Uint8* buffer = nullptr;
+        Uint32 length = 0;
+
+        std::vector<unsigned char> bytes;
+
+        SDL_RWops* rw = entry && entry->type == Asset_type::UNKNOWN ? pack.open(path) : nullptr;
+
+        if (!rw && read_file(path, bytes)) rw = SDL_RWFromConstMem(bytes.data(), static_cast<int>(bytes.size()));
+
+        stats.record_io(path, Asset_type::AUDIO, Asset_stats::ms_since(started));
+
+        Uint64 decode_started = SDL_GetPerformanceCounter();
+
+        if (!rw || !SDL_LoadWAV_RW(rw, 1, &spec, &buffer, &length))
+        {
+            SDL_Log("Audio asset %s loading failed: %s", path.c_str(), SDL_GetError());
+            return false;
+        }
+
+        pcm.assign(buffer, buffer + length);
+        SDL_FreeWAV(buffer);
+
+        stats.record_decode(path, Asset_type::AUDIO, Asset_stats::ms_since(decode_started), pcm.size());
+
+        initial_sample_rate = static_cast<unsigned int>(spec.freq);
+        channels = spec.channels;
+        format = spec.format;
+
+        Uint32 frame_bytes = SDL_AUDIO_BITSIZE(format) / 8 * channels;
+        frames = frame_bytes ? length / frame_bytes : 0;
+    }
+
+    initial_bitrate = initial_sample_rate * channels * SDL_AUDIO_BITSIZE(format);
+    initial_audio_length = samples_to_time(frames, initial_sample_rate);
+
+    // Once at the load - the device format is known, while the mixer is open
+    if ((!pcm.empty() || !adpcm.empty()) && Audio_mixer::Instance().is_open()) convert_to_output();
+
+    return !pcm.empty() || !adpcm.empty();
+}
+
+
+// Empty audio asset - nothing is loaded
+
+Audio_asset::Audio_asset(const std::string& path, bool streaming) :
+
+    Asset(Asset_type::AUDIO, path),
+
+    initial_sample_rate(0),
+    initial_bitrate(0),
+
+    initial_audio_length{0, 0, 0, 0},
+
+    channels(0),
+    format(AUDIO_S16SYS),
+
+    storage(Audio_storage::PCM),
+    adpcm_frames(0),
+
+    streaming(streaming),
+    deferred(false),
+    deferred_frames(0)
 
 {
-    // TODO:
-    // 1. LOAD AUDIO
-    // 2. GET the sample rate / bitrate
-    // 3. Count the length (h, m, s, ms)
-    // 4. Setup the parameters
 }
 
 
@@ -158,10 +945,9 @@ Audio_asset::Audio_asset(const std::string& path) :
 
 Audio_asset::~Audio_asset()
 {
-    // TODO: 
-    // 0) Stop playing command
-    // 1) Instances free logic
-    // 2) Asset free logic
+    // The voices read the PCM in place - stopped before it is freed,
+    // the instances are destroyed by the ~Asset()
+    Audio_mixer::Instance().stop_asset(this);
 }
 
 
@@ -183,10 +969,294 @@ unsigned int Audio_asset::get_bitrate() const
 
 // Initial length getter
 
-const std::vector<unsigned int>& Audio_asset::get_length() const
+const timecode& Audio_asset::get_length() const
 {
     return initial_audio_length;
 }
 
 
+unsigned int Audio_asset::get_channels() const { return channels; }
+
+
+SDL_AudioFormat Audio_asset::get_format() const { return format; }
+
+
+const std::vector<Uint8>& Audio_asset::get_pcm() const { return pcm; }
+
+
+bool Audio_asset::is_streaming() const { return streaming; }
+
+
+uint64_t Audio_asset::get_frame_count() const
+{
+    if (streaming) return static_cast<const Streaming_audio*>(this)->get_frame_count();
+
+    if (deferred) return deferred_frames;
+
+    if (storage == Audio_storage::IMA_ADPCM) return adpcm_frames;
+
+    return channels ? pcm.size() / (sizeof(Sint16) * channels) : 0;
+}
+
+
+Audio_view Audio_asset::get_view(uint64_t start, uint64_t end, uint64_t loop_start, uint64_t loop_end) const
+{
+    Audio_view view;
+
+    if (!streaming)
+    {
+        if (storage == Audio_storage::IMA_ADPCM) view.adpcm = adpcm.data();
+        else view.samples = reinterpret_cast<const Sint16*>(pcm.data());
+    }
+
+    view.channels = channels;
+
+    view.end = std::min(end, get_frame_count());
+    view.start = std::min(start, view.end);
+    view.loop_start = std::max(view.start, std::min(loop_start, view.end));
+    view.loop_end = std::max(view.loop_start, std::min(loop_end, view.end));
+
+    return view;
+}
+
+
+// === REGIONS ===
+
+int Audio_asset::add_region(const std::string& name, uint64_t start, uint64_t end, uint64_t loop_start, uint64_t loop_end)
+{
+    if (end <= start) return -1;
+
+    int index = find_region(name);
+
+    if (index < 0)
+    {
+        index = static_cast<int>(regions.size());
+        regions.push_back({name, 0, 0, 0, 0});
+    }
+
+    Audio_region& region = regions[index];
+
+    region.start = start;
+    region.end = end;
+    region.loop_start = std::max(start, std::min(loop_start, end));
+    region.loop_end = std::max(region.loop_start, std::min(loop_end, end));
+
+    return index;
+}
+
+
+int Audio_asset::find_region(const std::string& name) const
+{
+    for (size_t i = 0; i < regions.size(); ++i)
+        if (regions[i].name == name) return static_cast<int>(i);
+
+    return -1;
+}
+
+
+const Audio_region* Audio_asset::get_region(int index) const
+{
+    return index >= 0 && index < static_cast<int>(regions.size()) ? &regions[index] : nullptr;
+}
+
+
+int Audio_asset::get_region_count() const { return static_cast<int>(regions.size()); }
+
+// === REGIONS ===
+
+
+// === STORAGE ===
+
+bool Audio_asset::set_storage(Audio_storage new_storage)
+{
+    if (streaming) return false;
+
+    load_data();
+
+    if (new_storage == storage) return true;
+
+    if (format != AUDIO_S16SYS || channels < 1 || channels > 2 || (pcm.empty() && adpcm.empty()))
+    {
+        SDL_Log("Audio asset %s has no S16 mono/stereo samples to re-encode", source_path.c_str());
+        return false;
+    }
+
+    // The voices read the samples in place
+    Audio_mixer::Instance().stop_asset(this);
+
+    const Uint64 started = SDL_GetPerformanceCounter();
+
+    if (!reencode(new_storage)) return false;
+
+    Asset_stats::Instance().record_decode(std::string(source_path.view()), Asset_type::AUDIO, Asset_stats::ms_since(started), get_storage_bytes());
+
+    return true;
+}
+
+
+bool Audio_asset::reencode(Audio_storage new_storage)
+{
+    if (new_storage == storage) return true;
+
+    if (new_storage == Audio_storage::IMA_ADPCM)
+    {
+        const uint64_t frames = pcm.size() / (channels * sizeof(Sint16));
+
+        std::vector<Uint8> encoded = adpcm_encode(reinterpret_cast<const Sint16*>(pcm.data()), frames, channels);
+
+        if (encoded.empty() && frames) return false;
+
+        adpcm.swap(encoded);
+        adpcm_frames = frames;
+
+        std::vector<Uint8>().swap(pcm);
+    }
+    else
+    {
+        pcm.resize(static_cast<size_t>(adpcm_frames) * channels * sizeof(Sint16));
+
+        Adpcm_channel state[2];
+
+        adpcm_seek(adpcm.data(), channels, 0, state);
+        adpcm_decode(adpcm.data(), channels, 0, static_cast<int>(adpcm_frames), state, reinterpret_cast<Sint16*>(pcm.data()));
+
+        std::vector<Uint8>().swap(adpcm);
+        adpcm_frames = 0;
+    }
+
+    storage = new_storage;
+
+    return true;
+}
+
+
+Audio_storage Audio_asset::get_storage() const { return storage; }
+
+
+const std::vector<Uint8>& Audio_asset::get_adpcm() const { return adpcm; }
+
+
+uint64_t Audio_asset::get_adpcm_frames() const { return adpcm_frames; }
+
+
+size_t Audio_asset::get_storage_bytes() const { return storage == Audio_storage::IMA_ADPCM ? adpcm.size() : pcm.size(); }
+
+
+size_t Audio_asset::get_memory_bytes() const { return get_storage_bytes(); }
+
+// === STORAGE ===
+
+
+bool Audio_asset::matches_output() const
+{
+    const Audio_mixer& mixer = Audio_mixer::Instance();
+
+    return format == AUDIO_S16SYS && channels >= 1 && channels <= 2 && mixer.is_open() &&
+           initial_sample_rate == static_cast<unsigned int>(mixer.get_sample_rate());
+}
+
+
+bool Audio_asset::convert_to_output()
+{
+    const Audio_mixer& mixer = Audio_mixer::Instance();
+
+    if (streaming || (pcm.empty() && adpcm.empty()) || !mixer.is_open()) return false;
+
+    if (matches_output()) return true;
+
+    const Uint64 started = SDL_GetPerformanceCounter();
+
+    // The ADPCM is converted through the PCM and encoded again
+    const Audio_storage kept_storage = storage;
+
+    if (!reencode(Audio_storage::PCM)) return false;
+
+    const int rate = mixer.get_sample_rate();
+    const unsigned int out_channels = channels > 2 ? 2 : channels;
+
+    SDL_AudioCVT cvt;
+
+    if (SDL_BuildAudioCVT(&cvt, format, static_cast<Uint8>(channels), static_cast<int>(initial_sample_rate),
+                          AUDIO_S16SYS, static_cast<Uint8>(out_channels), rate) < 0)
+    {
+        SDL_Log("Audio asset %s conversion failed: %s", source_path.c_str(), SDL_GetError());
+        return false;
+    }
+
+    // The conversion runs in place - the buffer is its largest intermediate size
+    std::vector<Uint8> converted(pcm.size() * static_cast<size_t>(cvt.len_mult));
+    std::copy(pcm.begin(), pcm.end(), converted.begin());
+
+    cvt.buf = converted.data();
+    cvt.len = static_cast<int>(pcm.size());
+
+    if (SDL_ConvertAudio(&cvt) != 0)
+    {
+        SDL_Log("Audio asset %s conversion failed: %s", source_path.c_str(), SDL_GetError());
+        return false;
+    }
+
+    converted.resize(static_cast<size_t>(cvt.len_cvt));
+    converted.shrink_to_fit();
+
+    pcm.swap(converted);
+
+    // The instance trim ends at the whole audio by default (see Audio_instance())
+    const uint64_t old_full = time_to_samples(initial_audio_length, initial_sample_rate);
+    const unsigned int source_rate = initial_sample_rate;
+
+    initial_sample_rate = static_cast<unsigned int>(rate);
+    channels = out_channels;
+    format = AUDIO_S16SYS;
+    initial_bitrate = initial_sample_rate * channels * SDL_AUDIO_BITSIZE(format);
+
+    const uint64_t frames = pcm.size() / (channels * sizeof(Sint16));
+
+    initial_audio_length = samples_to_time(frames, initial_sample_rate);
+
+    // The trims and the positions of the existing instances are moved to the new rate
+    for (Asset_instance* instance : get_instances())
+    {
+        Audio_instance* audio = static_cast<Audio_instance*>(instance);
+
+        const unsigned int old_rate = audio->current_sample_rate;
+
+        if (old_rate == 0) continue;
+
+        audio->start_sample = std::min<uint64_t>(audio->start_sample * initial_sample_rate / old_rate, frames);
+        audio->end_sample = audio->end_sample >= old_full ? time_to_samples(initial_audio_length, initial_sample_rate) :
+                            std::min<uint64_t>(audio->end_sample * initial_sample_rate / old_rate, frames);
+        audio->current_playtime_sample = audio->current_playtime_sample * initial_sample_rate / old_rate;
+        audio->length_samples = audio->end_sample - audio->start_sample;
+
+        // The unset loop end (UINT64_MAX) stays at the trim end
+        audio->loop_start_sample = std::min<uint64_t>(audio->loop_start_sample * initial_sample_rate / old_rate, frames);
+
+        if (audio->loop_end_sample != UINT64_MAX)
+            audio->loop_end_sample = std::min<uint64_t>(audio->loop_end_sample * initial_sample_rate / old_rate, frames);
+
+        audio->current_sample_rate = initial_sample_rate;
+        audio->current_bitrate = initial_bitrate;
+    }
+
+    // The regions are at the asset rate too
+    for (Audio_region& region : regions)
+    {
+        region.start = std::min<uint64_t>(region.start * initial_sample_rate / source_rate, frames);
+        region.end = std::min<uint64_t>(region.end * initial_sample_rate / source_rate, frames);
+        region.loop_start = std::min<uint64_t>(region.loop_start * initial_sample_rate / source_rate, region.end);
+        region.loop_end = std::min<uint64_t>(region.loop_end * initial_sample_rate / source_rate, region.end);
+    }
+
+    reencode(kept_storage);
+
+    Asset_stats::Instance().record_decode(std::string(source_path.view()), Asset_type::AUDIO, Asset_stats::ms_since(started), get_storage_bytes());
+
+    return true;
+}
+
+
+Audio_instance* Audio_asset::create_instance() { return Asset_instance::create_pooled<Audio_instance>(this); }
+
+
 // =========================================================================================== AUDIO ASSET CLASS
\ No newline at end of file
@@ -7,9 +7,10 @@
 
 #include <string>
 #include <vector>
-#include <unordered_set>
 
 #include "../platform/platform.h"
+#include "../math/math_2d.h"
+#include "../hash_key/interned_string.h"
 
 // =========================================================================================== IMPORT
 
@@ -39,6 +40,15 @@ enum class Asset_type {
 // =========================================================================================== ASSET_TYPES
 
 
+// In-memory storage of the Audio_asset samples
+enum class Audio_storage {
+
+    PCM,        // 16-bit PCM, read by the mixer in place
+    IMA_ADPCM   // 4-bit IMA-ADPCM blocks (adpcm.h), decoded by the mixer voice on the fly
+
+};
+
+
 // =========================================================================================== ASSET BASE CLASS
 
 
@@ -47,6 +57,9 @@ enum class Asset_type {
 // (realized inside the asset_instance.h and asset_instance.cpp)
 
 class Asset_instance;
+class Image_instance;
+class Audio_instance;
+struct Pack_entry;
 
 
 /**
@@ -104,8 +117,11 @@ class Asset
         // Asset type getter
         Asset_type get_type() const;
 
-        // Asset path getter
-        const std::string& get_path() const;
+        // Asset path getter - interned, the key of the Asset_manager is precomputed in it
+        const Interned_string& get_path() const;
+
+        // RAM held by the asset (the pixels, the samples, the tables) - the textures are the Texture_budget's
+        virtual size_t get_memory_bytes() const;
 
 
     protected:
@@ -113,39 +129,50 @@ class Asset
         // Kind of this asset
         Asset_type type;    
 
-        // Path to the file on disk
-        std::string source_path;
+        // Path to the file on disk - interned, the assets and the tickets of one path share it
+        Interned_string source_path;
 
         
         /**
          * @brief Create and register an asset instance.
          *
-         * This method creates a new Asset_instance and registers it
-         * inside the asset's internal instance list.
+         * This method creates a new Asset_instance in the pool
+         * and registers it inside the asset's internal instance list.
          *
          * Asset fully owns the lifetime of created instances.
          */
         Asset_instance* add_instance();
 
+        // Registered instances (the subclasses update them after a format change)
+        const std::vector<Asset_instance*>& get_instances() const;
+
+
+    public:
+
         /**
-         * @brief Unregister an asset instance.
+         * @brief Destroy an instance created by this asset.
          *
-         * Removes the given Asset_instance pointer from the internal list
-         * of active instances associated with this asset.
+         * The pooled instances go back to their pool, the instances constructed
+         * directly (by new or on the stack) are only detached - they are destroyed
+         * by their owner. The asset destructor calls it for all remaining instances.
          *
-         * This method is called automatically by the Asset_instance
-         * destructor and should never be called manually.
-         *
-         * @param instance Pointer to the asset instance to unregister.
+         * @param instance Pointer to the asset instance to destroy.
          */
         void delete_instance(Asset_instance* instance);
 
+        // Number of the registered instances
+        size_t get_instance_count() const;
+
 
     private:
         
-        // List of active asset instance addresses.
+        // List of active asset instance addresses - dense, every instance knows its index.
         // The container is empty on asset creation and fully owned by Asset.
-        std::unordered_set<Asset_instance*> instances;
+        std::vector<Asset_instance*> instances;
+
+        // O(1) registration by the index (called by the Asset_instance constructor and destructor)
+        void register_instance(Asset_instance* instance);
+        void unregister_instance(Asset_instance* instance);
 };
 
 
@@ -155,6 +182,19 @@ class Asset
 // =========================================================================================== ASSETS SUBCLASSES
 
 
+
+
+// Nine-slice borders of an image in its logical pixels - the corners keep their size, the edges
+// stretch along, the middle both ways (Sprite_batch::add_nine_slice())
+struct Slice_insets
+{
+    float left = 0.0f;
+    float top = 0.0f;
+    float right = 0.0f;
+    float bottom = 0.0f;
+};
+
+
 /**
  * @brief Concrete asset representing a 2D image (texture).
  *
@@ -164,34 +204,189 @@ class Asset
 class Image_asset : public Asset {
 
     friend class Image_instance;
+    friend class Texture_atlas;
+    friend class Texture_budget;
+    friend class Streaming_image;
 
     public:
 
         /**
          * @brief Constructor - load an image asset.
          *
-         * @param renderer SDL renderer used to create the texture.
+         * A cooked image is only looked up in the Asset_pack index - the size is there, the
+         * pixels are mapped on the first use (load_data(): the texture, the atlas build).
+         * Of its resolution variants, the one of Asset_manager::select_image_variant() is used.
+         * Otherwise the pixels are decoded from the file (or the Preloader bytes of it) here.
+         * The texture is created later - by the Texture_atlas or create_texture().
+         *
          * @param path Path to the image file.
          */
         Image_asset(const std::string& path);
 
         // Destructor.
         ~Image_asset() override;
+
+        // Loaded pixels (0 after the upload drop or the eviction)
+        size_t get_memory_bytes() const override;
              
 
-        // Get initial width of the image.
+        // Get initial width of the image - the logical one: the same for every resolution variant.
         unsigned int get_width() const;
 
-        // Get initial height of the image.
+        // Get initial height of the image - the logical one.
         unsigned int get_height() const;
 
+        // Size of the loaded pixels - the logical size by the texel scale
+        unsigned int get_texel_width() const;
+        unsigned int get_texel_height() const;
+
+        // Texels per logical pixel on each axis: 1 for the files, less for the smaller variants, more for the --density art
+        Vec2 get_texel_scale() const;
+
+        // Divisor of the loaded resolution variant (Asset_manager::select_image_variant()), 1 - the full size
+        int get_variant() const;
+
+        // Nine-slice borders - cooked with the image (Asset_cooker --slice), or set for a file image
+        const Slice_insets& get_slice_insets() const;
+        void set_slice_insets(const Slice_insets& insets);
+
+
+        // The pixels are loaded (or evicted by the Texture_budget, or cooked and not used yet - loaded on demand)
+        bool is_loaded() const;
+
+        // Reads the pixels of the cooked image, if they aren't yet (Asset_loader does it on the worker) - false if there are none
+        bool load_data();
+
+        // The cooked pixels are LZ4-compressed and not read yet - create_texture() decompresses them
+        // straight into the texture, the Asset_loader doesn't read them ahead
+        bool loads_into_texture() const;
+
+        /**
+         * @brief Creates an own texture of this image, when it isn't packed into an atlas.
+         *
+         * Compressed cooked pixels, which aren't read yet, are decompressed into the locked
+         * streaming texture - no surface at all: the peak memory of the load is the texture and
+         * the pixels are written once. The image keeps no pixels then, a reload after the
+         * eviction decompresses them the same way; the atlas still reads them (load_data()).
+         *
+         * @param renderer SDL renderer used to create the texture.
+         * @return true if the image has a texture.
+         */
+        bool create_texture(SDL_Renderer* renderer);
+
+        /**
+         * @brief Texture with the image (an atlas page or the own texture), nullptr before the upload.
+         *
+         * Marks the texture used in the current frame. The texture, evicted by the
+         * Texture_budget, is reloaded here - with the renderer of create_texture().
+         */
+        SDL_Texture* get_texture();
+
+
+        // === TEXTURE BUDGET ===
+
+        // Pinned textures are never evicted (the UI, the player)
+        void set_texture_pinned(bool pinned);
+        bool is_texture_pinned() const;
+
+        // Memory of the own texture, 0 for the atlas pages and without the texture
+        size_t get_texture_bytes() const;
+
+        // Texture_budget frame, in which the texture was last requested
+        Uint64 get_last_used_frame() const;
+
+        // The texture and pixels were evicted - the next get_texture() reloads them
+        bool is_evicted() const;
+
+        // === TEXTURE BUDGET ===
+
+        // Image rectangle inside the texture
+        const Rect2& get_texture_region() const;
+
+
+        // New pooled instance of this image (destroyed by delete_instance() or with the asset)
+        Image_instance* create_instance();
+
+
+        /**
+         * @brief Static texture in the pixel format of the surface.
+         *
+         * The cooked RGB565 / RGBA5551 / RGBA4444 pixels become a 16-bit texture as they are -
+         * on the 16-bit framebuffer the copies need no conversion per frame. SDL converts once,
+         * here, only if the driver can't create the format. The opaque formats get no blending.
+         *
+         * ARGB8888 is the premultiplied alpha (the cooker and load_pixels() premultiply it) -
+         * the texture is blended by blend_mode_premultiplied(): one product per channel and
+         * no dark fringes of the filtered scaling (Image_instance::set_scaler()). The renderers
+         * without the custom blend modes (the SDL software one) get the straight copy of the rows
+         * with SDL_BLENDMODE_BLEND, the hardware blitter mirror stays premultiplied.
+         *
+         * @return The texture, nullptr if it can't be created.
+         */
+        static SDL_Texture* upload_surface(SDL_Renderer* renderer, SDL_Surface* surface);
+
+
+    protected:
+
+        // Empty image of the size - the pixels are provided by the subclass (Streaming_image)
+        Image_asset(const std::string& name, unsigned int width, unsigned int height);
+
 
     private:
 
-        // Original image w-dimension
+        // Original image w-dimension (texels)
         unsigned int initial_width;
-        // Original image h-dimension
+        // Original image h-dimension (texels)
         unsigned int initial_height;
+
+        // Size the game sees (the cooked logical size of the pack, else the texel size)
+        unsigned int logical_width;
+        unsigned int logical_height;
+
+        // Cooked resolution variant, chosen once by the constructor - the reload after the eviction reads the same
+        int variant;
+
+        Slice_insets slice_insets;
+
+        // Loaded pixels (the cooked format of the pack, ARGB8888 for the decoded files) - the source for the texture upload,
+        // ARGB8888 ones are premultiplied
+        SDL_Surface* pixels;
+
+        // Texture with the image and the image rectangle inside it
+        SDL_Texture* texture;
+        Rect2 texture_region;
+
+        // The texture is not an atlas page
+        bool owns_texture;
+
+        // Drops the texture link (destroys it, if it is the own one)
+        void release_texture();
+
+
+        // Budget accounting of the own texture
+        SDL_Renderer* texture_renderer;
+        size_t texture_bytes;
+        Uint64 last_used_frame;
+        bool texture_pinned;
+        bool evicted;
+
+        // Cooked, the pixels are not read yet - load_data() on the first use
+        bool deferred;
+
+        // Loads the pixels from the pack, the preload bytes or the file
+        bool load_pixels();
+
+        // Texture with the compressed cooked pixels decompressed into its lock, nullptr if they aren't or it fails
+        SDL_Texture* upload_from_pack(SDL_Renderer* renderer) const;
+
+        // Pack entry of the cooked pixels (the variant), nullptr if not packed
+        const Pack_entry* find_entry() const;
+
+        // Frees the own texture and the pixels (Texture_budget), false if it is not evictable
+        bool evict();
+
+        // Reloads the evicted pixels and the texture
+        bool restore();
 };
 
 
@@ -210,6 +405,45 @@ struct timecode
 };
 
 
+// Named frame range of an Audio_asset (Audio_asset::add_region()), at the asset sample rate
+struct Audio_region
+{
+
+    std::string name;
+
+    uint64_t start;
+    uint64_t end;
+
+    // Looped part of the range - a play in the loop runs from start to loop_end, then from loop_start
+    uint64_t loop_start;
+    uint64_t loop_end;
+
+};
+
+
+/**
+ * @brief Non-owning view of the held samples of an Audio_asset over a frame range.
+ *
+ * Points into the single buffer of the asset - the PCM or the ADPCM blocks, both null
+ * for the Streaming_audio. The trims, the loop points and the regions of every instance
+ * are views of the same buffer, the audio data is never copied per instance or per play.
+ */
+struct Audio_view
+{
+
+    const Sint16* samples = nullptr;
+    const Uint8* adpcm = nullptr;
+    uint32_t channels = 0;
+
+    // Frames from the start of the audio, start <= loop_start <= loop_end <= end
+    uint64_t start = 0;
+    uint64_t end = 0;
+    uint64_t loop_start = 0;
+    uint64_t loop_end = 0;
+
+};
+
+
 /**
  * @brief Concrete asset representing a audio.
  *
@@ -219,6 +453,7 @@ struct timecode
 class Audio_asset : public Asset {
 
     friend class Audio_instance;
+    friend class Streaming_audio;
 
     public:
 
@@ -227,6 +462,9 @@ class Audio_asset : public Asset {
          * It could be audio or music with different input and output
          * bitrate and sample rate.
          *
+         * A cooked audio is only looked up in the Asset_pack index - the rate, the channels
+         * and the length are there, the samples are read on the first use (load_data()).
+         *
          * @param path Path to the audio file.
          */
         Audio_asset(const std::string& path);
@@ -235,6 +473,9 @@ class Audio_asset : public Asset {
         // Stop playing, deallocate and nullptr 
         ~Audio_asset() override;
 
+        // Held samples (get_storage_bytes())
+        size_t get_memory_bytes() const override;
+
 
         // Sample rate getter - returns the current sample rate
         unsigned int get_sample_rate() const;
@@ -245,16 +486,148 @@ class Audio_asset : public Asset {
 
 
         // Audio length getter - returns the audio length (by link without copy),
-        // as a vector with size of [4] and format: <h, m, s, ms>
-        const std::vector<unsigned int>& get_length() const;
+        // with format: <h, m, s, ms>
+        const timecode& get_length() const;
+
+
+        // Channels count (1 - mono, 2 - stereo)
+        unsigned int get_channels() const;
+
+        // Sample format of the PCM data
+        SDL_AudioFormat get_format() const;
+
+        // Interleaved PCM data, empty if the loading failed (or streamed, or not read yet - load_data())
+        const std::vector<Uint8>& get_pcm() const;
+
+        // Reads the samples of the cooked audio, if they aren't yet (the first play, Asset_loader on the worker) - false if there are none
+        bool load_data();
+
+        // The PCM is decoded while playing (Streaming_audio), not held in memory
+        bool is_streaming() const;
+
+        // Frames of the held or streamed audio
+        uint64_t get_frame_count() const;
+
+        /**
+         * @brief View of the held samples over the frame range - the pointers into the asset storage.
+         *
+         * The range and the loop points are clamped to the data (the loop points - to the range,
+         * by default the loop is the whole range). The view is valid until the storage changes
+         * (set_storage(), convert_to_output()), so it is taken per play, not kept.
+         */
+        Audio_view get_view(uint64_t start = 0, uint64_t end = UINT64_MAX,
+                            uint64_t loop_start = 0, uint64_t loop_end = UINT64_MAX) const;
+
+
+        // === REGIONS ===
+
+        /**
+         * @brief Names a frame range of the audio - one asset holds a whole set of effects.
+         *
+         * The instances (Audio_instance::set_region()) and the one-shots (Audio_mixer::play_region_oneshot())
+         * of the region read the asset buffer in place. The frames are at get_sample_rate(),
+         * convert_to_output() moves them to the new rate with the instance trims.
+         *
+         * @return Index of the region (a region of the same name is replaced), -1 if the range is empty.
+         */
+        int add_region(const std::string& name, uint64_t start, uint64_t end,
+                       uint64_t loop_start = 0, uint64_t loop_end = UINT64_MAX);
+
+        // Index of the named region, -1 if there is none
+        int find_region(const std::string& name) const;
+
+        // Region by the index, nullptr if it is out of range
+        const Audio_region* get_region(int index) const;
+
+        int get_region_count() const;
+
+        // === REGIONS ===
+
+
+        // === STORAGE ===
+
+        /**
+         * @brief Re-encodes the held samples - a quarter of the memory in the IMA-ADPCM.
+         *
+         * Only the storage changes: the Audio_instance API, the trims and the positions
+         * stay the same, the mixer decodes the ADPCM per voice. The sound is stopped first.
+         * The cooked pack audio could be ADPCM already (asset_cooker --adpcm).
+         *
+         * @return false if there are no S16 mono/stereo samples (or it is streamed).
+         */
+        bool set_storage(Audio_storage new_storage);
+
+        Audio_storage get_storage() const;
+
+        // IMA-ADPCM blocks, empty for the PCM storage
+        const std::vector<Uint8>& get_adpcm() const;
+
+        // Frames of the ADPCM blocks (the last block could be partial)
+        uint64_t get_adpcm_frames() const;
+
+        // Bytes of the held samples, whichever the storage
+        size_t get_storage_bytes() const;
+
+        // === STORAGE ===
+
+
+        /**
+         * @brief Converts the PCM once to the mixer output - S16 at the device rate.
+         *
+         * The mono and the stereo are kept (the mixer adds the mono to both channels),
+         * more channels are mixed down to the stereo. The converted PCM replaces the
+         * source one, the callback only adds and scales it. Called by the constructor,
+         * if the mixer is open, and by the mixer on the play of an older asset.
+         *
+         * @return false if the conversion failed (the asset stays unplayable).
+         */
+        bool convert_to_output();
+
+        // PCM is S16 mono or stereo at the mixer rate
+        bool matches_output() const;
+
+
+        // New pooled instance of this audio (destroyed by delete_instance() or with the asset)
+        Audio_instance* create_instance();
 
 
     private:
 
+        // Swaps the PCM and the ADPCM blocks (S16 mono/stereo, nothing plays them)
+        bool reencode(Audio_storage new_storage);
+
+        // Reads the samples from the pack or the file, converted to the output, if the mixer is open
+        bool load_samples();
+
+
         unsigned int initial_sample_rate;
         unsigned int initial_bitrate;
 
         timecode initial_audio_length; // <h, m, s, ms>
+
+        unsigned int channels;
+        SDL_AudioFormat format;
+
+        std::vector<Uint8> pcm;
+
+        // IMA_ADPCM storage - the blocks replace the PCM
+        Audio_storage storage;
+        std::vector<Uint8> adpcm;
+        uint64_t adpcm_frames;
+
+        std::vector<Audio_region> regions;
+
+        bool streaming;
+
+        // Cooked, the samples are not read yet - load_data() on the first use; the frames of the pack index
+        bool deferred;
+        uint64_t deferred_frames;
+
+
+    protected:
+
+        // Empty audio of the path - the PCM is provided by the subclass (Streaming_audio)
+        Audio_asset(const std::string& path, bool streaming);
 };
 
 // =========================================================================================== ASSETS SUBCLASSES
@@ -0,0 +1,521 @@
+// asset_instance.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "asset_instance.h"
+#include "../audio/audio_mixer.h"
+#include "../palette/theme_group.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== INSTANCE CLASS
+
+// Constructor - links the instance to its asset and registers it
+
+Asset_instance::Asset_instance(Asset* asset) : main_asset(asset)
+{
+    if (main_asset) main_asset->register_instance(this);
+}
+
+
+// Destructor - unregisters the instance (no-op, if the asset already did it)
+
+Asset_instance::~Asset_instance()
+{
+    if (main_asset) main_asset->unregister_instance(this);
+}
+
+
+// Main asset link getter
+
+Asset* Asset_instance::get_main_asset_link() const
+{
+    return main_asset;
+}
+
+// =========================================================================================== INSTANCE CLASS
+
+
+// === LAYOUT METHODS ===
+
+void Image_instance::refresh_layout() const
+{
+    if (!layout_dirty) return;
+
+    float crop_w = crop_map.bottom_right.x - crop_map.top_left.x;
+    float crop_h = crop_map.bottom_right.y - crop_map.top_left.y;
+
+    current_width = crop_w > 0.0f ? static_cast<unsigned int>(crop_w * x_scaler + 0.5f) : 0;
+    current_height = crop_h > 0.0f ? static_cast<unsigned int>(crop_h * y_scaler + 0.5f) : 0;
+
+    get_new_anchor_points();
+
+    // Whole source pixels, as the texture is sampled. The crop is logical - a resolution variant
+    // (or the --density art) has other texels under it, the drawn size stays
+    const Image_asset* asset = get_main_asset_link();
+    const Vec2 texel = asset ? asset->get_texel_scale() : Vec2{1.0f, 1.0f};
+
+    if (texel.x == 1.0f && texel.y == 1.0f)
+    {
+        source_rect.x = static_cast<int>(crop_map.top_left.x);
+        source_rect.y = static_cast<int>(crop_map.top_left.y);
+        source_rect.w = static_cast<int>(crop_w);
+        source_rect.h = static_cast<int>(crop_h);
+    }
+    else
+    {
+        // The edges are scaled, not the size - the neighbouring crops of a sheet stay adjacent
+        source_rect.x = static_cast<int>(crop_map.top_left.x * texel.x + 0.5f);
+        source_rect.y = static_cast<int>(crop_map.top_left.y * texel.y + 0.5f);
+        source_rect.w = static_cast<int>(crop_map.bottom_right.x * texel.x + 0.5f) - source_rect.x;
+        source_rect.h = static_cast<int>(crop_map.bottom_right.y * texel.y + 0.5f) - source_rect.y;
+    }
+
+    const float left = static_cast<float>(source_rect.x);
+    const float top = static_cast<float>(source_rect.y);
+    const float right = static_cast<float>(source_rect.x + source_rect.w);
+    const float bottom = static_cast<float>(source_rect.y + source_rect.h);
+
+    // The flips swap the edges
+    source_edges.top_left = {horizontal_flip ? right : left, vertical_flip ? bottom : top};
+    source_edges.bottom_right = {horizontal_flip ? left : right, vertical_flip ? top : bottom};
+
+    layout_dirty = false;
+}
+
+
+unsigned int Image_instance::get_current_width() const
+{
+    refresh_layout();
+
+    return current_width;
+}
+
+
+unsigned int Image_instance::get_current_height() const
+{
+    refresh_layout();
+
+    return current_height;
+}
+
+
+Vec2 Image_instance::get_anchor(Image_anchor anchor) const
+{
+    refresh_layout();
+
+    switch (anchor)
+    {
+        case Image_anchor::TOP_LEFT:      return anchors.top_left;
+        case Image_anchor::TOP_CENTER:    return anchors.top_center;
+        case Image_anchor::TOP_RIGHT:     return anchors.top_right;
+        case Image_anchor::CENTER_LEFT:   return anchors.center_left;
+        case Image_anchor::CENTER_RIGHT:  return anchors.center_right;
+        case Image_anchor::BOTTOM_LEFT:   return anchors.bottom_left;
+        case Image_anchor::BOTTOM_CENTER: return anchors.bottom_center;
+        case Image_anchor::BOTTOM_RIGHT:  return anchors.bottom_right;
+        default:                          return anchors.center_center;
+    }
+}
+
+
+SDL_FRect Image_instance::get_destination_rect(SDL_FPoint point, Image_anchor anchor) const
+{
+    const Vec2 corner = to_vec2(point) - get_anchor(anchor);
+
+    return {corner.x, corner.y, static_cast<float>(current_width), static_cast<float>(current_height)};
+}
+
+
+int Image_instance::refresh_dirty_layouts()
+{
+    int refreshed = 0;
+
+    Instance_pool<Image_instance>::shared().for_each([&refreshed](Image_instance* instance)
+    {
+        if (instance->layout_dirty)
+        {
+            instance->refresh_layout();
+            ++refreshed;
+        }
+    });
+
+    return refreshed;
+}
+
+// === LAYOUT METHODS ===
+
+// =========================================================================================== IMAGE INSTANCE
+
+// Image instance constructor - the whole image, original size, no flips and rotation
+
+Image_instance::Image_instance(Image_asset* asset) :
+
+    Asset_instance(asset),
+
+    crop_map{{0.0f, 0.0f}, {0.0f, 0.0f}},
+
+    x_scaler(1.0f),
+    y_scaler(1.0f),
+
+    current_width(0),
+    current_height(0),
+
+    layout_dirty(true),
+
+    source_rect{0, 0, 0, 0},
+    source_edges{},
+
+    anchors{},
+
+    horizontal_flip(false),
+    vertical_flip(false),
+
+    rotation_angle(0.0f),
+    rotation_sin(0.0f),
+    rotation_cos(1.0f)
+
+{
+    if (asset)
+        crop_map = {{0.0f, 0.0f}, {static_cast<float>(asset->get_width()), static_cast<float>(asset->get_height())}};
+
+    set_scaler(1.0f, 1.0f);
+}
+
+
+Image_instance::~Image_instance()
+{
+    if (theme_group) theme_group->remove(this);
+}
+
+
+// === CROP METHODS ===
+
+void Image_instance::set_crop_map(const Rect2& new_crop_map)
+{
+    crop_map = new_crop_map;
+
+    // The current size and the anchors follow the crop
+    layout_dirty = true;
+}
+
+
+void Image_instance::set_crop_map(const Vec2& top_left, const Vec2& bottom_right)
+{
+    set_crop_map(Rect2{top_left, bottom_right});
+}
+
+
+SDL_Rect Image_instance::get_source_rect() const
+{
+    refresh_layout();
+
+    const Image_asset* asset = get_main_asset_link();
+
+    SDL_Rect rect = source_rect;
+
+    // Asset region origin inside the texture (atlas page) - whole pixels
+    if (asset)
+    {
+        rect.x += static_cast<int>(asset->get_texture_region().top_left.x);
+        rect.y += static_cast<int>(asset->get_texture_region().top_left.y);
+    }
+
+    return rect;
+}
+
+
+SDL_Texture* Image_instance::get_texture() const
+{
+    Image_asset* asset = get_main_asset_link();
+
+    return asset ? asset->get_texture() : nullptr;
+}
+
+// === CROP METHODS ===
+
+
+// === SCALER METHODS ===
+
+void Image_instance::set_scaler(float new_x_scaler, float new_y_scaler)
+{
+    x_scaler = new_x_scaler;
+    y_scaler = new_y_scaler;
+
+    layout_dirty = true;
+}
+
+
+void Image_instance::get_new_anchor_points() const
+{
+    const Vec2 size = {static_cast<float>(current_width), static_cast<float>(current_height)};
+
+    anchors.top_left      = anchor_offset(size, Image_anchor::TOP_LEFT);
+    anchors.top_center    = anchor_offset(size, Image_anchor::TOP_CENTER);
+    anchors.top_right     = anchor_offset(size, Image_anchor::TOP_RIGHT);
+    anchors.center_left   = anchor_offset(size, Image_anchor::CENTER_LEFT);
+    anchors.center_center = anchor_offset(size, Image_anchor::CENTER_CENTER);
+    anchors.center_right  = anchor_offset(size, Image_anchor::CENTER_RIGHT);
+    anchors.bottom_left   = anchor_offset(size, Image_anchor::BOTTOM_LEFT);
+    anchors.bottom_center = anchor_offset(size, Image_anchor::BOTTOM_CENTER);
+    anchors.bottom_right  = anchor_offset(size, Image_anchor::BOTTOM_RIGHT);
+}
+
+// === SCALER METHODS ===
+
+
+// === FLIP METHODS ===
+
+void Image_instance::set_horizontal_flip(bool h_f_enable)
+{
+    horizontal_flip = h_f_enable;
+    layout_dirty = true;
+}
+
+
+void Image_instance::set_vertical_flip(bool v_f_enable)
+{
+    vertical_flip = v_f_enable;
+    layout_dirty = true;
+}
+
+
+void Image_instance::set_flip(bool h_f_enable, bool v_f_enable)
+{
+    horizontal_flip = h_f_enable;
+    vertical_flip = v_f_enable;
+    layout_dirty = true;
+}
+
+// === FLIP METHODS ===
+
+
+// === ROTATION METHODS ===
+
+void Image_instance::set_angle(float angle_deg)
+{
+    rotation_angle = angle_deg;
+
+    // Once per change, not per draw - the right angles without the trigonometry
+    sin_cos_deg(rotation_angle, rotation_sin, rotation_cos);
+}
+
+
+void Image_instance::add_angle(float delta_angle_deg) { set_angle(rotation_angle + delta_angle_deg); }
+
+
+float Image_instance::get_angle() const { return rotation_angle; }
+
+// === ROTATION METHODS ===
+
+
+Instance_handle<Image_instance> Image_instance::get_handle() const
+{
+    return Instance_pool<Image_instance>::shared().handle_of(this);
+}
+
+// =========================================================================================== IMAGE INSTANCE
+
+
+// =========================================================================================== AUDIO INSTANCE
+
+uint64_t time_to_samples(timecode current_timecode, unsigned int sample_rate)
+{
+    uint64_t ms = (static_cast<uint64_t>(current_timecode.h) * 3600 +
+                   static_cast<uint64_t>(current_timecode.m) * 60 +
+                   current_timecode.s) * 1000 + current_timecode.ms;
+
+    // Rounded up - the sample is at or after the time, the way back gives the time again
+    return (ms * sample_rate + 999) / 1000;
+}
+
+
+timecode samples_to_time(uint64_t sample, unsigned int sample_rate)
+{
+    if (sample_rate == 0) return {0, 0, 0, 0};
+
+    uint64_t ms = sample * 1000 / sample_rate;
+
+    timecode t;
+
+    t.ms = static_cast<uint16_t>(ms % 1000);
+    t.s = static_cast<uint8_t>(ms / 1000 % 60);
+    t.m = static_cast<uint8_t>(ms / 60000 % 60);
+    t.h = static_cast<uint8_t>(ms / 3600000);
+
+    return t;
+}
+
+
+// Audio instance constructor - the whole audio, from the start
+
+Audio_instance::Audio_instance(Audio_asset* asset) :
+
+    Asset_instance(asset),
+
+    current_sample_rate(asset ? asset->get_sample_rate() : 0),
+    current_bitrate(asset ? asset->get_bitrate() : 0),
+
+    start_sample(0),
+    end_sample(asset ? time_to_samples(asset->get_length(), asset->get_sample_rate()) : 0),
+    length_samples(end_sample),
+
+    loop_start_sample(0),
+    loop_end_sample(UINT64_MAX),
+
+    current_playtime_sample(0),
+
+    volume(100),
+    priority(0)
+
+{
+}
+
+
+// The voice must not outlive the instance
+
+Audio_instance::~Audio_instance() { Audio_mixer::Instance().stop(this); }
+
+
+// === TRIM METHODS ===
+
+void Audio_instance::set_start_sample(uint64_t sample)
+{
+    start_sample = sample < end_sample ? sample : end_sample;
+    length_samples = end_sample - start_sample;
+
+    if (current_playtime_sample < start_sample) current_playtime_sample = start_sample;
+}
+
+
+uint64_t Audio_instance::get_start_sample() const { return start_sample; }
+
+
+void Audio_instance::set_end_sample(uint64_t sample)
+{
+    const Audio_asset* asset = static_cast<const Audio_asset*>(get_main_asset_link());
+
+    const uint64_t full = asset ? time_to_samples(asset->get_length(), asset->get_sample_rate()) : 0;
+
+    end_sample = sample < full ? sample : full;
+
+    if (start_sample > end_sample) start_sample = end_sample;
+
+    length_samples = end_sample - start_sample;
+
+    if (current_playtime_sample > end_sample) current_playtime_sample = start_sample;
+}
+
+
+uint64_t Audio_instance::get_end_sample() const { return end_sample; }
+
+
+void Audio_instance::set_loop_points(uint64_t loop_start, uint64_t loop_end)
+{
+    loop_start_sample = loop_start;
+    loop_end_sample = loop_end < loop_start ? loop_start : loop_end;
+}
+
+
+uint64_t Audio_instance::get_loop_start() const { return get_view().loop_start; }
+
+
+uint64_t Audio_instance::get_loop_end() const { return get_view().loop_end; }
+
+
+bool Audio_instance::set_region(int region_index)
+{
+    const Audio_asset* asset = static_cast<const Audio_asset*>(get_main_asset_link());
+
+    const Audio_region* region = asset ? asset->get_region(region_index) : nullptr;
+
+    if (!region) return false;
+
+    // The end first - the start is clamped to it
+    set_end_sample(region->end);
+    set_start_sample(region->start);
+    set_loop_points(region->loop_start, region->loop_end);
+
+    current_playtime_sample = start_sample;
+
+    return true;
+}
+
+
+bool Audio_instance::set_region(const std::string& region_name)
+{
+    const Audio_asset* asset = static_cast<const Audio_asset*>(get_main_asset_link());
+
+    return asset && set_region(asset->find_region(region_name));
+}
+
+
+Audio_view Audio_instance::get_view() const
+{
+    const Audio_asset* asset = static_cast<const Audio_asset*>(get_main_asset_link());
+
+    if (!asset) return {};
+
+    return asset->get_view(start_sample, end_sample, loop_start_sample, loop_end_sample);
+}
+
+// === TRIM METHODS ===
+
+
+// === PLAYER METHODS (Audio_mixer) ===
+
+bool Audio_instance::play_audio(bool loop) { return Audio_mixer::Instance().play(this, loop); }
+
+
+void Audio_instance::pause_audio() { Audio_mixer::Instance().pause(this); }
+
+
+void Audio_instance::stop_audio() { Audio_mixer::Instance().stop(this); }
+
+
+void Audio_instance::rewind_audio(const timecode& new_play_time)
+{
+    Audio_mixer::Instance().seek(this, time_to_samples(new_play_time, current_sample_rate));
+}
+
+
+void Audio_instance::set_volume(unsigned int new_volume) { Audio_mixer::Instance().set_volume(this, new_volume); }
+
+
+unsigned int Audio_instance::get_volume() const { return volume; }
+
+
+void Audio_instance::set_priority(int new_priority) { priority = new_priority; }
+
+
+int Audio_instance::get_priority() const { return priority; }
+
+
+bool Audio_instance::is_playing() const { return Audio_mixer::Instance().is_playing(this); }
+
+
+uint64_t Audio_instance::get_playtime_sample() const { return Audio_mixer::Instance().get_position(this); }
+
+
+bool Audio_instance::play_audio_at(uint64_t sample_clock, bool loop) { return Audio_mixer::Instance().play_at(this, sample_clock, loop); }
+
+
+void Audio_instance::stop_audio_at(uint64_t sample_clock) { Audio_mixer::Instance().stop_at(this, sample_clock); }
+
+
+void Audio_instance::set_volume_at(unsigned int new_volume, uint64_t sample_clock)
+{
+    Audio_mixer::Instance().set_volume_at(this, new_volume, sample_clock);
+}
+
+// === PLAYER METHODS (Audio_mixer) ===
+
+
+Instance_handle<Audio_instance> Audio_instance::get_handle() const
+{
+    return Instance_pool<Audio_instance>::shared().handle_of(this);
+}
+
+// =========================================================================================== AUDIO INSTANCE
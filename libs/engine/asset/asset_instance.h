@@ -5,6 +5,9 @@
 // =========================================================================================== IMPORT
 
 #include "asset.h"
+#include "instance_pool.h"
+
+class Theme_group;
 
 // =========================================================================================== IMPORT
 
@@ -24,6 +27,8 @@ class Asset_instance
 
     friend class Asset; // Asset could call the ~Asset_instance()
 
+    template<typename T, size_t SLAB_SIZE> friend class Instance_pool;
+
     protected:
 
            /**
@@ -47,14 +52,39 @@ class Asset_instance
 
         virtual ~Asset_instance(); // Only called by the Asset::delete_instance(instance);
 
+        // Registered instances can't be copied - the asset knows every one by its index
+        Asset_instance(const Asset_instance&) = delete;
+        Asset_instance& operator=(const Asset_instance&) = delete;
+
         // Main asset link getter
         Asset* get_main_asset_link() const;
 
+
+        // Pooled creation - the instance is returned to the pool of its type by delete_instance()
+        template<typename T, typename A>
+        static T* create_pooled(A* asset)
+        {
+            T* instance = Instance_pool<T>::shared().create(asset);
+
+            instance->release = [](Asset_instance* i) { Instance_pool<T>::shared().destroy(static_cast<T*>(i)); };
+
+            return instance;
+        }
+
         
     private:
 
         // Main asset pointer for instance-to-asset association and parameter access 
-        const Asset* main_asset;
+        Asset* main_asset;
+
+        // Position in the asset's instances list
+        size_t registry_index = 0;
+
+        // Returns the pooled instance to its pool, nullptr - not pooled
+        void (*release)(Asset_instance*) = nullptr;
+
+        // Slot in the handle table of the pool (pooled instances only)
+        std::uint32_t handle_index = Instance_handle<Asset_instance>::NULL_INDEX;
 };
 
 
@@ -68,32 +98,38 @@ class Asset_instance
 // =========================================================================================== IMAGE INSTANCE
 
 
-// Decart coordinate for 2D space.
-struct dec_c_2D
-{
+// Anchor point of the Image_instance, which is put at the drawing point (and is the rotation pivot)
+enum class Image_anchor {
 
-    float x;    // Coordinate by x-axes (width).
-    float y;    //Coordinate by y-axes (height).
+    TOP_LEFT,
+    TOP_CENTER,
+    TOP_RIGHT,
+    CENTER_LEFT,
+    CENTER_CENTER,
+    CENTER_RIGHT,
+    BOTTOM_LEFT,
+    BOTTOM_CENTER,
+    BOTTOM_RIGHT
 
 };
 
 
-// Rectangle size for 2D space.
-struct size_2D
+// Anchor point of a sprite of the size in its local (unrotated) space - the instances and the Sprite_batch
+constexpr Vec2 anchor_offset(Vec2 size, Image_anchor anchor)
 {
-
-    unsigned int w;
-    unsigned int h;
-
-};
-
-// Crop map for 2D space
-struct crop_map_2D {
-
-    dec_c_2D top_left;
-    dec_c_2D bottom_right;
-
-};
+    switch (anchor)
+    {
+        case Image_anchor::TOP_LEFT:      return {0.0f,            0.0f};
+        case Image_anchor::TOP_CENTER:    return {size.x / 2.0f,   0.0f};
+        case Image_anchor::TOP_RIGHT:     return {size.x,          0.0f};
+        case Image_anchor::CENTER_LEFT:   return {0.0f,            size.y / 2.0f};
+        case Image_anchor::CENTER_RIGHT:  return {size.x,          size.y / 2.0f};
+        case Image_anchor::BOTTOM_LEFT:   return {0.0f,            size.y};
+        case Image_anchor::BOTTOM_CENTER: return {size.x / 2.0f,   size.y};
+        case Image_anchor::BOTTOM_RIGHT:  return {size.x,          size.y};
+        default:                          return {size.x / 2.0f,   size.y / 2.0f};
+    }
+}
 
 
 // Image instance subclass for copies of image assets
@@ -104,6 +140,9 @@ class Image_instance : public Asset_instance
 {
 
     friend class Image_asset;
+    friend class Sprite_batch;  // Reads the transform in the batch loop without the getters
+    friend class Transform_store;
+    friend class Theme_group;   // Keeps the membership of the instance
 
     public:
 
@@ -111,8 +150,8 @@ class Image_instance : public Asset_instance
         // pass the Image_asset pointer to the main_asset link, then registers itself 
         // in the asset's internal list of active instances.
         //
-        // After that it initializes the scale factors to 1.0 (original size) and calculates
-        // the current_width, current_height and anchor points
+        // After that it initializes the scale factors to 1.0 (original size) and marks
+        // the current_width, current_height and anchor points for the lazy calculation
         Image_instance(Image_asset* asset);
 
         // Image_instance destructor which calls the Asset_instance destructor - delete
@@ -125,31 +164,43 @@ class Image_instance : public Asset_instance
 
         /**
          * @brief Setup the image cropmap by cropmap link.
-         * Automatically updates the current width and height,
-         * then recalculates the anchor points.
+         * Marks the current width, height and anchor points dirty -
+         * they are recalculated on the next read.
          * 
-         * @param new_crop_map Crop map by the crop_map_2D link
+         * @param new_crop_map Crop map by the Rect2 link
          * 
          * Use like:
          * 
          * image_instance.set_crop_map(crop);
          */
-        void set_crop_map(const crop_map_2D& new_crop_map);
+        void set_crop_map(const Rect2& new_crop_map);
 
         /**
          * @brief Setup the image cropmap by 2 points.
-         * Automatically updates the current width and height,
-         * then recalculates the anchor points.
+         * Marks the current width, height and anchor points dirty -
+         * they are recalculated on the next read.
          * 
-         * @param top_left Top left crop point by the dec_c_2D link
-         * @param bottom_right Bottom rigth crop point by the dec_c_2D link
+         * @param top_left Top left crop point by the Vec2 link
+         * @param bottom_right Bottom rigth crop point by the Vec2 link
          * 
          * Use like:
          * 
          * set_crop_map({{x_1, y_1}, {x_2, y_2}});
          * 
          */
-        void set_crop_map(const dec_c_2D& top_left, const dec_c_2D& bottom_right);
+        void set_crop_map(const Vec2& top_left, const Vec2& bottom_right);
+
+        /**
+         * @brief Source rectangle of the current crop inside the asset texture.
+         *
+         * The crop map is in the image pixels, the asset shifts it into its
+         * texture region - the atlas page sub-rectangle. The crop part is cached
+         * by refresh_layout(), only the region origin is added here.
+         */
+        SDL_Rect get_source_rect() const;
+
+        // Texture to draw the source rectangle from (nullptr before the asset upload)
+        SDL_Texture* get_texture() const;
 
         // === CROP METHODS ===
 
@@ -159,7 +210,7 @@ class Image_instance : public Asset_instance
         /**
          * @brief Change image scale.
          *
-         * Recomputes current width and height based on the original size.
+         * The current width and height (based on the crop size) are recomputed on the next read.
          *
          * @param x_scaler Scale factor x-axes (1.0 = original size).
          * @param y_scaler Scale factor y-axes (1.0 = original size).
@@ -203,6 +254,9 @@ class Image_instance : public Asset_instance
         /**
          * @brief Set image rotation angle.
          *
+         * The sine and the cosine are cached here, the draws don't compute them. The right
+         * angles (0, 90, 180, 270) are exact and take no trigonometry at all (sin_cos_deg()).
+         *
          * @param angle_deg Rotation angle in degrees.
          */
         void set_angle(float angle_deg);
@@ -220,6 +274,50 @@ class Image_instance : public Asset_instance
         // === ROTATION METHODS ===
 
 
+        // === LAYOUT METHODS ===
+
+        // The scaled size and the anchors are recomputed lazily - the scale and crop
+        // setters only mark them dirty, the first read after a change refreshes them.
+
+        // Scaled width and height getters
+        unsigned int get_current_width() const;
+        unsigned int get_current_height() const;
+
+        // Anchor point in the local (unrotated) space
+        Vec2 get_anchor(Image_anchor anchor) const;
+
+        /**
+         * @brief Unrotated destination rectangle of the instance.
+         *
+         * @param point  Drawing point in the render target pixels.
+         * @param anchor Anchor of the instance at the point.
+         */
+        SDL_FRect get_destination_rect(SDL_FPoint point, Image_anchor anchor = Image_anchor::TOP_LEFT) const;
+
+        // Refreshes the size and anchors now, if they are dirty
+        void refresh_layout() const;
+
+        /**
+         * @brief Refreshes every dirty pooled image instance in one pass.
+         *
+         * Call once per frame after the animation updates, so the reads in the
+         * render loop find the layout ready.
+         *
+         * @return Number of the refreshed instances.
+         */
+        static int refresh_dirty_layouts();
+
+        // === LAYOUT METHODS ===
+
+
+        // Theme group of the instance (Theme_group::add()), nullptr - untinted
+        Theme_group* get_theme_group() const { return theme_group; }
+
+
+        // Generational handle of the instance (null, if it isn't pooled)
+        Instance_handle<Image_instance> get_handle() const;
+
+
     protected:
 
         Image_asset* get_main_asset_link() const
@@ -231,7 +329,7 @@ class Image_instance : public Asset_instance
     private:
 
         // Current crop map by 2 points
-        crop_map_2D crop_map;
+        Rect2 crop_map;
 
         // Current image scale factor x-axes
         float x_scaler;
@@ -239,11 +337,22 @@ class Image_instance : public Asset_instance
         // Current image scale factor y-axes
         float y_scaler;
 
-        // Scaled w-dimension
-        unsigned int current_width;
+        // Scaled w-dimension (lazy - refresh_layout())
+        mutable unsigned int current_width;
+
+        // Scaled h-dimension (lazy - refresh_layout())
+        mutable unsigned int current_height;
+
+        // Scale, crop or flip changed after the last layout refresh
+        mutable bool layout_dirty;
 
-        // Scaled h-dimension
-        unsigned int current_height;
+        // Crop in the image pixels, whole (lazy - refresh_layout()). The asset region origin
+        // is added on the read - the atlas may move the region, the crop stays
+        mutable SDL_Rect source_rect;
+
+        // Source edges for the quad corners - the crop with the flips applied: top_left is the
+        // edge under the top left corner (lazy - refresh_layout())
+        mutable Rect2 source_edges;
 
 
         /**
@@ -266,21 +375,23 @@ class Image_instance : public Asset_instance
          */
         struct Anchor_points {
 
-            dec_c_2D top_left;
-            dec_c_2D top_center;
-            dec_c_2D top_right;
-            dec_c_2D center_left;
-            dec_c_2D center_center;
-            dec_c_2D center_right;
-            dec_c_2D bottom_left;
-            dec_c_2D bottom_center;
-            dec_c_2D bottom_right;
+            Vec2 top_left;
+            Vec2 top_center;
+            Vec2 top_right;
+            Vec2 center_left;
+            Vec2 center_center;
+            Vec2 center_right;
+            Vec2 bottom_left;
+            Vec2 bottom_center;
+            Vec2 bottom_right;
+
+        };
 
-        } anchors;
+        mutable Anchor_points anchors;
 
         // Recalculate the anchor points, based on the current width and height
-        // Calls at the constructor and inside the set_scaler() method;
-        void get_new_anchor_points();
+        // Calls by refresh_layout() after the size update
+        void get_new_anchor_points() const;
 
 
         // Image flip flags
@@ -296,6 +407,15 @@ class Image_instance : public Asset_instance
 
         // Rotation angle in degrees (clockwise)
         float rotation_angle;
+
+        // Sine and cosine of the angle, cached by set_angle()
+        float rotation_sin;
+        float rotation_cos;
+
+
+        // Theme group tinting the instance and the position in its members
+        Theme_group* theme_group = nullptr;
+        size_t theme_index = 0;
 };
 
 
@@ -307,6 +427,9 @@ class Image_instance : public Asset_instance
 
 /**
  * @brief Convert timecode to samples
+ *
+ * Integer only - the first sample at or after the time, exact for any rate.
+ * samples_to_time() of the result gives the same timecode back (rates from 1 kHz).
  * 
  * @param current_timecode Current timecode number
  * @param sample_rate Current sample rate 
@@ -316,6 +439,8 @@ uint64_t time_to_samples(timecode current_timecode, unsigned int sample_rate);
 
 /**
  * @brief Convert samples to timecode
+ *
+ * Integer only - the millisecond the sample is in (rounded down).
  * 
  * @param sample Current sample number
  * @param sample_rate Current sample rate 
@@ -329,6 +454,7 @@ class Audio_instance : public Asset_instance
 {
 
     friend class Audio_asset;
+    friend class Audio_mixer;   // Reads the trim and writes the play position back
 
     public:
 
@@ -365,6 +491,113 @@ class Audio_instance : public Asset_instance
 
         uint64_t get_start_sample() const;
 
+        // End sample value setter (clamped to the audio length)
+        void set_end_sample(uint64_t sample);
+
+        uint64_t get_end_sample() const;
+
+        /**
+         * @brief Loop points inside the trim - a play in the loop runs from the play position
+         * to loop_end, then from loop_start over and over (the part before is an intro).
+         *
+         * The points are clamped to the trim, the loop is the whole trim by default.
+         * A play without the loop ignores them and ends at the trim end.
+         */
+        void set_loop_points(uint64_t loop_start, uint64_t loop_end);
+
+        uint64_t get_loop_start() const;
+
+        uint64_t get_loop_end() const;
+
+        /**
+         * @brief Trims the instance to the named range of the asset (Audio_asset::add_region()).
+         *
+         * Sets the trim and the loop points of the region and moves the play position to its start.
+         *
+         * @return false if the asset has no such region.
+         */
+        bool set_region(int region_index);
+
+        bool set_region(const std::string& region_name);
+
+        // View of the trim and the loop points over the asset buffer - nothing is copied
+        Audio_view get_view() const;
+
+        // === TRIM METHODS ===
+
+
+        // === PLAYER METHODS (Audio_mixer) ===
+
+        /**
+         * @brief Plays the audio from the current playtime.
+         *
+         * @param loop Repeat the trimmed part until stopped.
+         * @return false if it can't be played (no audio device, no free voice, not the mixer format).
+         */
+        bool play_audio(bool loop = false);
+
+        // Pause - stop playing and not reset the playtime
+        void pause_audio();
+
+        // Stop - stop playing and reset the playtime to the trim start
+        void stop_audio();
+
+        /**
+         * @brief Audio current playtime setter.
+         *
+         * @param new_play_time New playtime from the start of the audio.
+         */
+        void rewind_audio(const timecode& new_play_time);
+
+        /**
+         * @brief Audio volume percentage value setter.
+         *
+         * @param new_volume New volume value from 0% to 100%.
+         */
+        void set_volume(unsigned int new_volume);
+
+        unsigned int get_volume() const;
+
+        /**
+         * @brief Voice priority of the next plays (0 by default, higher - more important).
+         *
+         * When all voices of the mixer are busy, the play takes the voice of the lowest
+         * priority (the quietest of them) - one of the same priority or below, never higher.
+         */
+        void set_priority(int new_priority);
+
+        int get_priority() const;
+
+        bool is_playing() const;
+
+        // Current playback position in samples (frames)
+        uint64_t get_playtime_sample() const;
+
+
+        // === SCHEDULED (Audio_mixer sample clock) ===
+
+        /**
+         * @brief Plays the audio from the exact frame of the mixer sample clock.
+         *
+         * @code
+         * Audio_mixer& mixer = Audio_mixer::Instance();
+         * step->play_audio_at(mixer.counter_to_sample_clock(frame_start) + mixer.get_schedule_lead());
+         * @endcode
+         */
+        bool play_audio_at(uint64_t sample_clock, bool loop = false);
+
+        // Stop at the exact frame of the sample clock
+        void stop_audio_at(uint64_t sample_clock);
+
+        // Volume change, which starts at the exact frame of the sample clock
+        void set_volume_at(unsigned int new_volume, uint64_t sample_clock);
+
+        // === PLAYER METHODS (Audio_mixer) ===
+
+
+        // Generational handle of the instance (null, if it isn't pooled)
+        Instance_handle<Audio_instance> get_handle() const;
+
         
 
 
@@ -386,11 +619,35 @@ class Audio_instance : public Asset_instance
         // Cached length
         uint64_t length_samples;
 
+        // Loop points, clamped to the trim by get_view() (UINT64_MAX - the trim end)
+        uint64_t loop_start_sample;
+        uint64_t loop_end_sample;
+
 
         // Last known playback cursor
         uint64_t current_playtime_sample;
+
+        // Playing volume, from 0% to 100%
+        unsigned int volume;
+
+        // Voice stealing priority
+        int priority;
 };
 
 // =========================================================================================== AUDIO INSTANCE
 
+
+// =========================================================================================== INSTANCE HANDLES
+
+using Image_handle = Instance_handle<Image_instance>;
+using Audio_handle = Instance_handle<Audio_instance>;
+
+
+// O(1) handle resolve - nullptr, if the instance (or its asset) was destroyed
+inline Image_instance* resolve(Image_handle handle) { return Instance_pool<Image_instance>::shared().resolve(handle); }
+
+inline Audio_instance* resolve(Audio_handle handle) { return Instance_pool<Audio_instance>::shared().resolve(handle); }
+
+// =========================================================================================== INSTANCE HANDLES
+
 // =========================================================================================== INSTANCE SUBCLASSES
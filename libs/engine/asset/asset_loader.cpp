@@ -0,0 +1,588 @@
+// asset_loader.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "asset_loader.h"
+#include "asset_manager.h"
+#include "asset_pack.h"
+#include "font_asset.h"
+#include "../jobs/completion_queue.h"
+#include "../jobs/job_system.h"
+#include "../zone_profiler/zone_profiler.h"
+#include "../thread_roles/thread_roles.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== LOAD TICKET
+
+Load_ticket::Load_ticket(const std::string& path, Asset_type type, bool upload) :
+    path(path), type(type), upload(upload) {}
+
+
+Load_ticket::~Load_ticket()
+{
+    if (asset) Asset_manager::Instance().release(asset);
+}
+
+
+Load_status Load_ticket::get_status() const { return status.load(); }
+
+
+bool Load_ticket::is_ready() const { return status.load() == Load_status::READY; }
+
+
+bool Load_ticket::is_finished() const
+{
+    Load_status s = status.load();
+
+    return s == Load_status::READY || s == Load_status::FAILED;
+}
+
+
+Asset* Load_ticket::get_asset() const { return is_ready() ? asset : nullptr; }
+
+
+Image_asset* Load_ticket::get_image() const
+{
+    return is_ready() && type == Asset_type::IMAGE ? static_cast<Image_asset*>(asset) : nullptr;
+}
+
+
+Audio_asset* Load_ticket::get_audio() const
+{
+    return is_ready() && type == Asset_type::AUDIO ? static_cast<Audio_asset*>(asset) : nullptr;
+}
+
+
+Font_asset* Load_ticket::get_font() const
+{
+    return is_ready() && type == Asset_type::FONT ? static_cast<Font_asset*>(asset) : nullptr;
+}
+
+
+const std::string& Load_ticket::get_path() const { return path; }
+
+// =========================================================================================== LOAD TICKET
+
+
+// =========================================================================================== ASSET LOADER
+
+Asset_loader& Asset_loader::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Asset_loader instance;
+
+    return instance;
+}
+
+
+Asset_loader::~Asset_loader() { shutdown(); }
+
+
+Load_handle Asset_loader::load_image(const std::string& path, bool upload)
+{
+    return enqueue(path, Asset_type::IMAGE, upload, Load_priority::NORMAL);
+}
+
+
+Load_handle Asset_loader::load_audio(const std::string& path)
+{
+    return enqueue(path, Asset_type::AUDIO, false, Load_priority::NORMAL);
+}
+
+
+Load_handle Asset_loader::load_font(const std::string& path, bool upload)
+{
+    return enqueue(path, Asset_type::FONT, upload, Load_priority::NORMAL);
+}
+
+
+Load_handle Asset_loader::load(const std::string& path, Asset_type type, bool upload, Load_priority priority)
+{
+    return enqueue(path, type, type != Asset_type::AUDIO && upload, priority);
+}
+
+
+void Asset_loader::decode(Load_ticket& ticket)
+{
+    switch (ticket.type)
+    {
+        case Asset_type::IMAGE: ticket.decoded.reset(new Image_asset(ticket.path)); break;
+        case Asset_type::AUDIO: ticket.decoded.reset(new Audio_asset(ticket.path)); break;
+        case Asset_type::FONT: ticket.decoded.reset(new Font_asset(ticket.path)); break;
+
+        default:
+            SDL_Log("Asset %s: the type can't be loaded asynchronously", ticket.path.c_str());
+            break;
+    }
+
+    // The cooked assets only read the pack index in the constructors - the data is read here, off the main thread
+    Asset* asset = ticket.decoded.get();
+
+    Image_asset* image = !asset ? nullptr
+                       : ticket.type == Asset_type::IMAGE ? static_cast<Image_asset*>(asset)
+                       : ticket.type == Asset_type::FONT ? static_cast<Font_asset*>(asset)->get_image() : nullptr;
+
+    // A compressed image with its own texture is decompressed straight into the texture by the upload
+    const bool into_texture = ticket.upload && ticket.type == Asset_type::IMAGE && image && image->loads_into_texture();
+
+    if (image && !into_texture) image->load_data();
+    if (asset && ticket.type == Asset_type::AUDIO) static_cast<Audio_asset*>(asset)->load_data();
+}
+
+
+Load_handle Asset_loader::enqueue(const std::string& path, Asset_type type, bool upload, Load_priority priority)
+{
+    const bool counted = priority == Load_priority::NORMAL;
+
+    // A new batch starts after the idle
+    if (counted && is_idle()) batch_total = batch_finished = 0;
+
+    // Prefetched and still waiting - the same ticket, now in the batch
+    if (counted)
+    {
+        if (Load_handle waiting = promote(path, type, upload))
+        {
+            ++batch_total;
+            return waiting;
+        }
+    }
+
+    Load_handle ticket = std::make_shared<Load_ticket>(path, type, upload);
+    ticket->priority = priority;
+
+    if (counted) ++batch_total;
+
+    // Already resident - no loading at all
+    Asset_manager& manager = Asset_manager::Instance();
+
+    Asset* resident = manager.acquire_resident(path, type);
+
+    if (resident)
+    {
+        ticket->asset = resident;
+        ticket->status = Load_status::READY;
+
+        if (counted) ++batch_finished;
+        return ticket;
+    }
+
+    // The blob in the pack - the queue order and the read runs (an image reads its variant)
+    Asset_pack& pack = Asset_pack::Instance();
+
+    if (pack.is_mounted())
+    {
+        const int variant = type == Asset_type::IMAGE ? manager.select_image_variant(path) : 1;
+
+        if (const Pack_entry* entry = pack.find(pack_variant_name(path, variant)))
+        {
+            ticket->pack_offset = entry->offset;
+            ticket->pack_size = entry->size;
+        }
+    }
+
+    start_workers();
+
+    if (threads.empty())
+    {
+        // No workers - a synchronous load, finished by the next pump()
+        decode(*ticket);
+
+        ticket->status = Load_status::DECODED;
+
+        decoded.push_back(ticket);
+
+        return ticket;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        insert_ordered(counted ? queue : low_queue, ticket);
+    }
+
+    // The workers are woken by the next pump() - the requests of the cycle are ordered and run together
+    ++unposted;
+
+    return ticket;
+}
+
+
+Load_handle Asset_loader::promote(const std::string& path, Asset_type type, bool upload)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    // Not decoded yet - it goes to the normal queue, at its pack place
+    for (auto it = low_queue.begin(); it != low_queue.end(); ++it)
+    {
+        if ((*it)->type != type || (*it)->path != path) continue;
+
+        Load_handle ticket = std::move(*it);
+        low_queue.erase(it);
+
+        ticket->priority = Load_priority::NORMAL;
+        ticket->upload = ticket->upload || upload;
+
+        // The semaphore was posted for it already
+        insert_ordered(queue, ticket);
+
+        return ticket;
+    }
+
+    // Decoded and handed back - the next pump() finishes it in its turn
+    for (Load_handle& ticket : decoded)
+    {
+        if (ticket->priority != Load_priority::LOW || ticket->type != type || ticket->path != path) continue;
+
+        ticket->priority = Load_priority::NORMAL;
+        ticket->upload = ticket->upload || upload;
+
+        return ticket;
+    }
+
+    return nullptr;
+}
+
+
+void Asset_loader::insert_ordered(std::deque<Load_handle>& target, Load_handle ticket)
+{
+    // The packed blobs by the offset, the loose files after them - the equal ones in the request order
+    auto order = [](const Load_ticket& t) { return t.pack_size > 0 ? static_cast<Uint64>(t.pack_offset) : ~Uint64{0}; };
+
+    const Uint64 key = order(*ticket);
+
+    auto it = std::upper_bound(target.begin(), target.end(), key,
+                               [&order](Uint64 k, const Load_handle& queued) { return k < order(*queued); });
+
+    target.insert(it, std::move(ticket));
+}
+
+
+void Asset_loader::take_run(std::deque<Load_handle>& source, std::vector<Load_handle>& run)
+{
+    run.push_back(std::move(source.front()));
+    source.pop_front();
+
+    const Load_ticket& first = *run.front();
+
+    if (first.pack_size == 0) return;
+
+    Uint64 end = static_cast<Uint64>(first.pack_offset) + first.pack_size;
+
+    // The neighbours in the pack - the queue is in the pack order, they are at its front
+    while (!source.empty())
+    {
+        const Load_ticket& next = *source.front();
+        const Uint64 next_end = static_cast<Uint64>(next.pack_offset) + next.pack_size;
+
+        if (next.pack_size == 0 || next.pack_offset > end + RUN_GAP_BYTES || next_end - first.pack_offset > RUN_MAX_BYTES) break;
+
+        end = std::max(end, next_end);
+
+        run.push_back(std::move(source.front()));
+        source.pop_front();
+    }
+}
+
+
+void Asset_loader::start_workers()
+{
+    if (!threads.empty()) return;
+
+    if (!jobs) jobs = SDL_CreateSemaphore(0);
+
+    if (!jobs)
+    {
+        SDL_Log("Asset loader semaphore creation failed: %s", SDL_GetError());
+        return;
+    }
+
+    stopping = false;
+
+    for (int i = 0; i < WORKER_COUNT; ++i)
+    {
+        SDL_Thread* thread = SDL_CreateThread(worker_main, "asset_loader", this);
+
+        if (!thread)
+        {
+            SDL_Log("Asset loader worker creation failed: %s", SDL_GetError());
+            break;
+        }
+
+        threads.push_back(thread);
+    }
+}
+
+
+int Asset_loader::worker_main(void* self)
+{
+    auto* loader = static_cast<Asset_loader*>(self);
+
+    PROFILE_THREAD("asset_loader");
+
+    Thread_roles::Instance().apply(Thread_role::IO);
+
+    // The compressed pack entries are decompressed on the job workers too (in place without a free deque)
+    Job_system::Instance().attach_thread();
+
+    std::vector<Load_handle> run;
+
+    for (;;)
+    {
+        SDL_SemWait(loader->jobs);
+
+        if (loader->stopping.load()) return 0;
+
+        {
+            std::lock_guard<std::mutex> guard(loader->lock);
+
+            // The prefetches only when nothing else waits
+            std::deque<Load_handle>& source = loader->queue.empty() ? loader->low_queue : loader->queue;
+
+            if (source.empty()) continue;
+
+            // The other tickets of the run leave their semaphore posts - the workers find the queue empty then
+            take_run(source, run);
+        }
+
+        // One read of the whole run, the decodes fault into the read pages
+        if (run.front()->pack_size > 0)
+        {
+            const Load_ticket& last = *run.back();
+
+            const size_t begin = run.front()->pack_offset;
+            const size_t end = static_cast<size_t>(last.pack_offset) + last.pack_size;
+
+            Asset_pack::Instance().read_ahead(begin, end);
+
+            loader->runs.fetch_add(1, std::memory_order_relaxed);
+            loader->run_loads.fetch_add(run.size(), std::memory_order_relaxed);
+            loader->run_bytes.fetch_add(end - begin, std::memory_order_relaxed);
+        }
+
+        for (Load_handle& ticket : run) loader->finish_decode(std::move(ticket));
+
+        run.clear();
+    }
+}
+
+
+void Asset_loader::finish_decode(Load_handle ticket)
+{
+    // Stopped in the middle of a run - the rest of it is dropped
+    if (stopping.load())
+    {
+        ticket->status = Load_status::FAILED;
+        return;
+    }
+
+    // Dropped prefetch - the queue held the last reference, nobody waits for it
+    if (ticket->priority == Load_priority::LOW && ticket.use_count() == 1)
+    {
+        ticket->status = Load_status::FAILED;
+        return;
+    }
+
+    // The constructors only read and decode - no renderer, safe off the main thread
+    {
+        PROFILE_ZONE("asset_decode");
+        decode(*ticket);
+    }
+
+    ticket->status = Load_status::DECODED;
+
+    // The ticket keeps itself alive in the queue - the completion is a plain pointer
+    Load_ticket* raw = ticket.get();
+    raw->in_completion = std::move(ticket);
+
+    const std::uint64_t value = reinterpret_cast<std::uintptr_t>(raw);
+
+    // Full queue - the worker waits for the next drain, the results aren't dropped
+    while (!Completion_queue::Instance().post(&Asset_loader::on_decoded, this, value))
+    {
+        // Not destroyed here: the asset destructor belongs to the main thread (an audio asset
+        // stops its mixer voices) - shutdown() destroys it after the workers are joined
+        if (stopping.load())
+        {
+            std::lock_guard<std::mutex> guard(lock);
+
+            stopped.push_back(std::move(raw->in_completion));
+            return;
+        }
+
+        SDL_Delay(1);
+    }
+}
+
+
+void Asset_loader::on_decoded(void* self, std::uint64_t ticket)
+{
+    Load_ticket* raw = reinterpret_cast<Load_ticket*>(static_cast<std::uintptr_t>(ticket));
+
+    static_cast<Asset_loader*>(self)->decoded.push_back(std::move(raw->in_completion));
+}
+
+
+// Pixels, which the ticket uploads on the main thread - 0 for the loads without a texture
+static size_t upload_bytes(const Asset* asset)
+{
+    const Image_asset* image = nullptr;
+
+    if (asset->get_type() == Asset_type::IMAGE) image = static_cast<const Image_asset*>(asset);
+    else if (asset->get_type() == Asset_type::FONT) image = static_cast<const Font_asset*>(asset)->get_image();
+
+    return image ? static_cast<size_t>(image->get_texel_width()) * image->get_texel_height() * 4 : 0;
+}
+
+
+int Asset_loader::pump(SDL_Renderer* renderer, double budget_ms)
+{
+    PROFILE_ZONE("asset_pump");
+
+    // The requests of the cycle are all queued - the workers take them in the pack order
+    for (; unposted > 0; --unposted) SDL_SemPost(jobs);
+
+    const Uint64 start = SDL_GetPerformanceCounter();
+    const double frequency = static_cast<double>(SDL_GetPerformanceFrequency());
+
+    Asset_manager& manager = Asset_manager::Instance();
+
+    int finished = 0;
+
+    while (!decoded.empty())
+    {
+        const double spent_ms = static_cast<double>(SDL_GetPerformanceCounter() - start) * 1000.0 / frequency;
+
+        // At least one per call - a long upload can't stall the loading forever
+        if (finished > 0 && spent_ms >= budget_ms) break;
+
+        // The loads of the current state first, the prefetches after them - each in the decode order
+        auto next = std::find_if(decoded.begin(), decoded.end(),
+                                 [](const Load_handle& t) { return t->priority == Load_priority::NORMAL; });
+
+        if (next == decoded.end()) next = decoded.begin();
+
+        Asset* decoded_asset = (*next)->decoded.get();
+
+        // Dropped prefetch - nobody waits for it, no registration and no upload
+        if ((*next)->priority == Load_priority::LOW && next->use_count() == 1) decoded_asset = nullptr;
+
+        const size_t bytes = decoded_asset && (*next)->upload ? upload_bytes(decoded_asset) : 0;
+
+        // The upload wouldn't fit the rest of the budget (by the rate of the previous ones) - the next frame
+        if (finished > 0 && bytes > 0 && spent_ms + upload_ms_per_byte * static_cast<double>(bytes) > budget_ms) break;
+
+        Load_handle ticket = std::move(*next);
+        decoded.erase(next);
+
+        bool loaded = false;
+
+        switch (decoded_asset ? ticket->type : Asset_type::UNKNOWN)
+        {
+            case Asset_type::IMAGE: loaded = static_cast<Image_asset*>(decoded_asset)->is_loaded(); break;
+            case Asset_type::AUDIO: loaded = static_cast<Audio_asset*>(decoded_asset)->get_storage_bytes() > 0; break;
+            case Asset_type::FONT: loaded = static_cast<Font_asset*>(decoded_asset)->is_loaded(); break;
+            default: break;
+        }
+
+        if (loaded)
+        {
+            // The same path could be requested twice - the first one wins
+            ticket->asset = manager.adopt(std::move(ticket->decoded));
+
+            if (ticket->asset && ticket->upload)
+            {
+                const Uint64 upload_start = SDL_GetPerformanceCounter();
+
+                if (ticket->type == Asset_type::IMAGE) static_cast<Image_asset*>(ticket->asset)->create_texture(renderer);
+                else if (ticket->type == Asset_type::FONT) static_cast<Font_asset*>(ticket->asset)->create_texture(renderer);
+
+                // Running rate of the uploads - the estimate of the next one
+                if (bytes > 0)
+                {
+                    const double ms = static_cast<double>(SDL_GetPerformanceCounter() - upload_start) * 1000.0 / frequency;
+                    const double rate = ms / static_cast<double>(bytes);
+
+                    upload_ms_per_byte = upload_ms_per_byte > 0.0 ? upload_ms_per_byte * 0.75 + rate * 0.25 : rate;
+                }
+            }
+        }
+
+        ticket->decoded.reset();
+        ticket->status = ticket->asset ? Load_status::READY : Load_status::FAILED;
+
+        if (ticket->priority == Load_priority::NORMAL) ++batch_finished;
+
+        ++finished;
+    }
+
+    return finished;
+}
+
+
+bool Asset_loader::is_idle() const { return batch_finished >= batch_total; }
+
+
+float Asset_loader::get_progress() const
+{
+    if (batch_total == 0 || is_idle()) return 1.0f;
+
+    return static_cast<float>(batch_finished) / static_cast<float>(batch_total);
+}
+
+
+void Asset_loader::shutdown()
+{
+    stopping = true;
+
+    for (size_t i = 0; i < threads.size(); ++i) SDL_SemPost(jobs);
+    for (SDL_Thread* thread : threads) SDL_WaitThread(thread, nullptr);
+
+    threads.clear();
+
+    if (jobs) SDL_DestroySemaphore(jobs);
+    jobs = nullptr;
+
+    // The completions of the stopped workers - the tickets come back to be failed
+    Completion_queue::Instance().drain();
+
+    std::lock_guard<std::mutex> guard(lock);
+
+    for (Load_handle& ticket : queue) ticket->status = Load_status::FAILED;
+    for (Load_handle& ticket : low_queue) ticket->status = Load_status::FAILED;
+    for (Load_handle& ticket : decoded) { ticket->decoded.reset(); ticket->status = Load_status::FAILED; }
+    for (Load_handle& ticket : stopped) { ticket->decoded.reset(); ticket->status = Load_status::FAILED; }
+
+    queue.clear();
+    low_queue.clear();
+    decoded.clear();
+    stopped.clear();
+
+    batch_total = batch_finished = 0;
+    unposted = 0;
+}
+
+
+
+void Asset_loader::dump(std::ostream& out) const
+{
+    const std::uint64_t run_count = get_run_count();
+
+    if (run_count == 0) return;
+
+    out << "=== Asset loader ===\n";
+
+    out << std::fixed << std::setprecision(1);
+
+    out << "Pack read runs: " << run_count << ", " << static_cast<double>(get_run_load_count()) / run_count
+        << " loads and " << run_bytes.load(std::memory_order_relaxed) / 1024.0 / run_count << " KB per run\n";
+
+    out << std::defaultfloat;
+}
+
+// =========================================================================================== ASSET LOADER
@@ -0,0 +1,303 @@
+// asset_loader.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+
+#include "asset.h"
+
+class Font_asset;
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== ASSET LOADER
+
+
+// Stages of an asynchronous load
+enum class Load_status {
+
+    QUEUED,     // Waiting for a worker
+    DECODED,    // Pixels or PCM are in memory, waiting for the main thread
+    READY,      // Registered in the Asset_manager (and uploaded)
+    FAILED      // The file couldn't be loaded
+
+};
+
+
+// Order of the loads on the workers
+enum class Load_priority {
+
+    NORMAL,     // Needed now - counted by is_idle() and get_progress()
+    LOW         // Prefetch - decoded only when no normal load waits, not counted
+
+};
+
+
+/**
+ * @brief Future of a single asynchronous load.
+ *
+ * The ready ticket holds one Asset_manager reference of its asset - the asset stays
+ * loaded while the handle lives.
+ */
+class Load_ticket
+{
+
+    friend class Asset_loader;
+
+public:
+
+    Load_ticket(const std::string& path, Asset_type type, bool upload);
+
+    // Releases the asset reference of the ticket
+    ~Load_ticket();
+
+    Load_ticket(const Load_ticket&) = delete;
+    Load_ticket& operator=(const Load_ticket&) = delete;
+
+
+    Load_status get_status() const;
+
+    bool is_ready() const;
+
+    // The load is over - ready or failed
+    bool is_finished() const;
+
+    // Loaded asset, nullptr until ready
+    Asset* get_asset() const;
+
+    // Typed asset getters, nullptr until ready or for the other type
+    Image_asset* get_image() const;
+    Audio_asset* get_audio() const;
+    Font_asset* get_font() const;
+
+    const std::string& get_path() const;
+
+
+private:
+
+    std::string path;
+    Asset_type type;
+
+    // Create the texture on the main thread (images and fonts)
+    bool upload;
+
+    // A normal request of the same path promotes the waiting low one (guarded by the loader lock)
+    Load_priority priority = Load_priority::NORMAL;
+
+    // Blob of the asset in the mounted pack - the queue order, size 0 - a loose file
+    Uint32 pack_offset = 0;
+    Uint32 pack_size = 0;
+
+    std::atomic<Load_status> status{Load_status::QUEUED};
+
+    // Worker result, moved into the Asset_manager on the main thread
+    std::unique_ptr<Asset> decoded;
+
+    // Resident asset with the ticket's reference
+    Asset* asset = nullptr;
+
+    // The ticket itself, while its completion is in the Completion_queue (the value is the raw pointer)
+    std::shared_ptr<Load_ticket> in_completion;
+};
+
+
+using Load_handle = std::shared_ptr<Load_ticket>;
+
+
+/**
+ * @brief Loads the assets without freezing the frame loop.
+ *
+ * The file reading and decoding (the asset constructors) run on the worker threads,
+ * the decoded tickets come back through the Completion_queue (drained by SDL_app_cycle).
+ * The main thread finishes the loads in pump(): registers the assets in the Asset_manager
+ * and creates the textures, where SDL requires it, within a time budget per frame.
+ * The engine calls pump() every cycle, the states only request and poll:
+ *
+ * @code
+ * // on_enter
+ * level_tiles = Asset_loader::Instance().load_image("assets/tiles.bmp");
+ *
+ * // update - the loading screen keeps animating
+ * if (Asset_loader::Instance().is_idle()) request_go_to(LEVEL_ID);
+ *
+ * // render
+ * draw_progress_bar(Asset_loader::Instance().get_progress());
+ * @endcode
+ *
+ * Resident assets are returned ready at once.
+ *
+ * The queues are kept in the pack order: the packed loads by the offset of their blob, the
+ * loose files after them in the request order. The workers are woken by the next pump(), so
+ * the requests of a cycle (a state entry, a manifest) are all queued by then. A worker takes the front load together with
+ * the queued ones right after it in the pack (gaps up to RUN_GAP_BYTES, RUN_MAX_BYTES in all),
+ * advises the whole run to be read ahead (Asset_pack::read_ahead()) and decodes it in order -
+ * a manifest of many assets is a few sequential reads of the SD card, not a seek per asset.
+ *
+ * Singleton, like the Asset_manager.
+ */
+class Asset_loader
+{
+
+public:
+
+    // Returns the singleton instance.
+    static Asset_loader& Instance();
+
+
+    /**
+     * @brief Queues an image load.
+     *
+     * @param path   Source path.
+     * @param upload Create the own texture on the main thread (false - the image goes to an atlas).
+     */
+    Load_handle load_image(const std::string& path, bool upload = true);
+
+    // Queues an audio load
+    Load_handle load_audio(const std::string& path);
+
+    // Queues a font load (the metrics and the atlas image), upload - the own atlas texture
+    Load_handle load_font(const std::string& path, bool upload = true);
+
+    /**
+     * @brief Queues a load of the type (IMAGE, AUDIO or FONT).
+     *
+     * A LOW load waits until the normal queue is empty. A later normal request of the
+     * same path takes over the waiting low ticket - the same handle, no second decode.
+     * A low load, whose handle is dropped before a worker takes it, is skipped.
+     */
+    Load_handle load(const std::string& path, Asset_type type, bool upload = true,
+                     Load_priority priority = Load_priority::NORMAL);
+
+
+    /**
+     * @brief Finishes the decoded loads on the main thread - the texture upload scheduler.
+     *
+     * Wakes the workers for the loads requested since the last call first.
+     *
+     * The loads of the current state (NORMAL) go before the prefetches (LOW), each in the
+     * decode order. At least one load is finished per call, the rest - while the budget lasts:
+     * an upload, which wouldn't fit the rest of it by the rate of the previous uploads, waits
+     * for the next frame, so a batch of loads, decoded at once, is spread over the frames.
+     *
+     * @param renderer  Renderer of the textures.
+     * @param budget_ms Time budget of the call in milliseconds.
+     * @return Number of the finished loads.
+     */
+    int pump(SDL_Renderer* renderer, double budget_ms);
+
+
+    // No normal load is queued, decoding or waiting for the main thread (the prefetches don't count)
+    bool is_idle() const;
+
+    // Finished part of the loads requested since the loader was idle the last time (1.0 - idle)
+    float get_progress() const;
+
+
+    // Stops the workers and drops the unfinished loads (shutdown)
+    void shutdown();
+
+
+    // === STATS ===
+
+    // Read runs the workers advised, and the packed loads in them
+    std::uint64_t get_run_count() const { return runs.load(std::memory_order_relaxed); }
+    std::uint64_t get_run_load_count() const { return run_loads.load(std::memory_order_relaxed); }
+
+    // Prints the read runs - the loads per run and the bytes per run
+    void dump(std::ostream& out) const;
+
+    // === STATS ===
+
+
+private:
+
+    // Private constructor for singleton
+    Asset_loader() = default;
+
+    // Stops the workers
+    ~Asset_loader();
+
+    // Copying the singleton is not allowed
+    Asset_loader(const Asset_loader&) = delete;
+    Asset_loader& operator=(const Asset_loader&) = delete;
+
+
+    static constexpr int WORKER_COUNT = 2;
+
+    // Largest gap between two blobs of a read run, and the longest run
+    static constexpr Uint32 RUN_GAP_BYTES = 64 * 1024;
+    static constexpr Uint32 RUN_MAX_BYTES = 4 * 1024 * 1024;
+
+    // Queues the ticket (or completes it at once, if the asset is resident)
+    Load_handle enqueue(const std::string& path, Asset_type type, bool upload, Load_priority priority);
+
+    // Puts the ticket into the queue at its pack order (locked)
+    static void insert_ordered(std::deque<Load_handle>& target, Load_handle ticket);
+
+    // Moves the front ticket and its pack neighbours out of the queue (locked)
+    static void take_run(std::deque<Load_handle>& source, std::vector<Load_handle>& run);
+
+    // Waiting low ticket of the path made normal, nullptr if there is none (locked)
+    Load_handle promote(const std::string& path, Asset_type type, bool upload);
+
+    // Starts the workers on the first request
+    void start_workers();
+
+    // Worker thread entry point - decodes the queued tickets
+    static int worker_main(void* self);
+
+    // Decodes a ticket of the run and hands it back to the main thread (worker)
+    void finish_decode(Load_handle ticket);
+
+    // Reads and decodes the asset of the ticket (any thread)
+    static void decode(Load_ticket& ticket);
+
+    // Completion_queue handler - the decoded ticket goes to the pump (main thread)
+    static void on_decoded(void* self, std::uint64_t ticket);
+
+
+    // Worker queues (the normal and the low one) - guarded by the lock
+    std::mutex lock;
+    std::deque<Load_handle> queue;
+    std::deque<Load_handle> low_queue;
+
+    // Decoded tickets, which a stopping worker couldn't hand back - destroyed by shutdown()
+    // on the main thread, guarded by the lock
+    std::vector<Load_handle> stopped;
+
+    // Decoded tickets, handed back through the Completion_queue (main thread only)
+    std::deque<Load_handle> decoded;
+
+    // Number of the queued jobs for the workers
+    SDL_sem* jobs = nullptr;
+
+    // Jobs queued since the last pump(), not posted yet (main thread only)
+    int unposted = 0;
+
+    std::vector<SDL_Thread*> threads;
+    std::atomic<bool> stopping{false};
+
+    // Progress of the current batch (main thread only)
+    int batch_total = 0;
+    int batch_finished = 0;
+
+    // Running average of the upload time per pixel byte, 0 - nothing uploaded yet (main thread only)
+    double upload_ms_per_byte = 0.0;
+
+    // Read runs of the workers
+    std::atomic<std::uint64_t> runs{0};
+    std::atomic<std::uint64_t> run_loads{0};
+    std::atomic<std::uint64_t> run_bytes{0};
+};
+
+// =========================================================================================== ASSET LOADER
@@ -0,0 +1,242 @@
+// asset_manager.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "asset_manager.h"
+#include "asset_pack.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== ASSET MANAGER
+
+Asset_manager& Asset_manager::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Asset_manager instance;
+
+    return instance;
+}
+
+
+Asset* Asset_manager::acquire(const Asset_path& path, Asset_type type)
+{
+    // Debug only - a second path of the key is logged
+    Hash_key_names::record(path.key, path.path);
+
+    auto it = assets.find(path.key);
+
+    if (it == assets.end())
+    {
+        Entry entry;
+
+        const std::string source(path.path);
+
+        if (type == Asset_type::IMAGE) entry.asset.reset(new Image_asset(source));
+        else if (type == Asset_type::AUDIO) entry.asset.reset(new Audio_asset(source));
+        else if (type == Asset_type::FONT) entry.asset.reset(new Font_asset(source));
+        else if (type == Asset_type::VIDEO) entry.asset.reset(new Video_asset(source));
+        else return nullptr;
+
+        it = assets.emplace(path.key, std::move(entry)).first;
+    }
+    else if (it->second.asset->get_type() != type)
+    {
+        SDL_Log("Asset %.*s is already loaded as a different type", static_cast<int>(path.path.size()), path.path.data());
+        return nullptr;
+    }
+
+    ++it->second.refs;
+
+    return it->second.asset.get();
+}
+
+
+Image_asset* Asset_manager::acquire_image(const Asset_path& path)
+{
+    return static_cast<Image_asset*>(acquire(path, Asset_type::IMAGE));
+}
+
+
+Audio_asset* Asset_manager::acquire_audio(const Asset_path& path)
+{
+    return static_cast<Audio_asset*>(acquire(path, Asset_type::AUDIO));
+}
+
+
+Font_asset* Asset_manager::acquire_font(const Asset_path& path)
+{
+    return static_cast<Font_asset*>(acquire(path, Asset_type::FONT));
+}
+
+
+Video_asset* Asset_manager::acquire_video(const Asset_path& path)
+{
+    return static_cast<Video_asset*>(acquire(path, Asset_type::VIDEO));
+}
+
+
+Asset* Asset_manager::acquire_resident(const Asset_path& path, Asset_type type)
+{
+    auto it = assets.find(path.key);
+
+    if (it == assets.end() || it->second.asset->get_type() != type) return nullptr;
+
+    ++it->second.refs;
+
+    return it->second.asset.get();
+}
+
+
+Asset* Asset_manager::adopt(std::unique_ptr<Asset> asset)
+{
+    if (!asset) return nullptr;
+
+    const Interned_string path = asset->get_path();
+    const Hash_key key = path.get_key();
+
+    Hash_key_names::record(key, path);
+
+    auto it = assets.find(key);
+
+    if (it == assets.end())
+    {
+        Entry entry;
+        entry.asset = std::move(asset);
+
+        it = assets.emplace(key, std::move(entry)).first;
+    }
+    else if (it->second.asset->get_type() != asset->get_type())
+    {
+        SDL_Log("Asset %s is already loaded as a different type", path.c_str());
+        return nullptr;
+    }
+
+    ++it->second.refs;
+
+    return it->second.asset.get();
+}
+
+
+void Asset_manager::release(const Asset* asset)
+{
+    if (!asset) return;
+
+    // The key interned with the path - nothing is hashed
+    auto it = assets.find(asset->get_path().get_key());
+
+    if (it == assets.end() || it->second.asset.get() != asset || it->second.refs == 0) return;
+
+    if (--it->second.refs == 0 && !it->second.pinned) assets.erase(it);
+}
+
+
+bool Asset_manager::set_pinned(const Asset_path& path, bool pinned)
+{
+    auto it = assets.find(path.key);
+
+    if (it == assets.end()) return false;
+
+    it->second.pinned = pinned;
+
+    // Pinned images keep their textures under the texture budget too
+    if (it->second.asset->get_type() == Asset_type::IMAGE)
+        static_cast<Image_asset*>(it->second.asset.get())->set_texture_pinned(pinned);
+
+    // Unpinned and unused - nothing keeps it anymore
+    if (!pinned && it->second.refs == 0) assets.erase(it);
+
+    return true;
+}
+
+
+int Asset_manager::get_ref_count(const Asset_path& path) const
+{
+    auto it = assets.find(path.key);
+
+    return it != assets.end() ? it->second.refs : 0;
+}
+
+
+size_t Asset_manager::get_resident_count() const { return assets.size(); }
+
+
+size_t Asset_manager::get_memory_bytes(Asset_type type) const
+{
+    size_t bytes = 0;
+
+    for (const auto& [key, entry] : assets)
+        if (entry.asset->get_type() == type) bytes += entry.asset->get_memory_bytes();
+
+    return bytes;
+}
+
+
+void Asset_manager::clear()
+{
+    // The buckets go too - the allocator can be gone by the static destruction
+    assets = Asset_map(assets.get_allocator());
+}
+
+
+bool Asset_manager::set_allocator(Allocator& allocator)
+{
+    if (!assets.empty()) return false;
+
+    assets = Asset_map(Asset_map::allocator_type(allocator));
+
+    return true;
+}
+
+
+void Asset_manager::set_image_variant_policy(float draw_scale, size_t texture_budget)
+{
+    variant_draw_scale = draw_scale > 0.0f ? draw_scale : 1.0f;
+    variant_budget = texture_budget;
+}
+
+
+int Asset_manager::get_min_image_variant() const
+{
+    const Asset_pack& pack = Asset_pack::Instance();
+
+    if (variant_budget == 0 || !pack.is_mounted()) return 1;
+
+    // The variant of the divisor d holds 1 / d^2 of the full bytes
+    int divisor = 1;
+
+    while (divisor < pack.get_max_variant() && pack.get_full_image_bytes() / (divisor * divisor) > variant_budget) divisor *= 2;
+
+    return divisor;
+}
+
+
+int Asset_manager::select_image_variant(const std::string& path) const
+{
+    const Asset_pack& pack = Asset_pack::Instance();
+
+    if (!pack.is_mounted() || pack.get_max_variant() == 1) return 1;
+
+    const Pack_entry* full = pack.find(path);
+
+    if (!full || full->type != Asset_type::IMAGE) return 1;
+
+    const Uint32 logical_w = full->params[4] ? full->params[4] : full->params[0];
+    const int min_divisor = get_min_image_variant();
+
+    // The smallest first - the first one sharp enough (or forced by the budget) wins
+    for (int divisor = pack.get_max_variant(); divisor > 1; divisor /= 2)
+    {
+        const Pack_entry* variant = pack.find(pack_variant_name(path, divisor));
+
+        if (!variant || variant->type != Asset_type::IMAGE) continue;
+
+        // Half a texel of slack - the odd sizes round the halved width down
+        if (divisor <= min_divisor || variant->params[0] + 0.5f >= variant_draw_scale * logical_w) return divisor;
+    }
+
+    return 1;
+}
+
+// =========================================================================================== ASSET MANAGER
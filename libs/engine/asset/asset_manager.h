@@ -0,0 +1,209 @@
+// asset_manager.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <unordered_map>
+
+#include "asset.h"
+#include "font_asset.h"
+#include "video_asset.h"
+#include "../hash_key/hash_key.h"
+#include "../memory/allocator.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== ASSET MANAGER
+
+
+/**
+ * @brief Source path of an asset with its hash key - the lookups only use the key.
+ *
+ * A constexpr path is hashed by the compiler, a std::string one - once by the call.
+ * The path itself is read only to load the missing asset.
+ */
+struct Asset_path
+{
+    Hash_key key;
+    std::string_view path;
+
+    constexpr Asset_path(const char* path) : Asset_path(std::string_view(path)) {}
+    constexpr Asset_path(std::string_view path) : key(path), path(path) {}
+    Asset_path(const std::string& path) : Asset_path(std::string_view(path)) {}
+};
+
+
+/**
+ * @brief Central owner of the assets, interned by the hash key of the source path.
+ *
+ * Every part of the game acquires the asset by its path and gets the same object -
+ * the file is loaded once, however many users it has. The references are counted:
+ * the asset is destroyed, when its last user releases it, unless it is pinned
+ * (the assets, which every level uses - fonts, UI sounds).
+ *
+ * Assets, which are packed into a Texture_atlas, must stay acquired while the atlas
+ * is in use - the atlas doesn't own them.
+ *
+ * Singleton, like the Preloader - so the states don't need any context to reach it.
+ *
+ * The assets are found by the Hash_key of the path, the path string isn't compared -
+ * a constexpr Asset_path makes the whole lookup one integer hash. The debug build
+ * records every path in Hash_key_names and logs the colliding ones.
+ *
+ * Usage:
+ * @code
+ * static constexpr Asset_path HERO = "assets/hero.bmp";
+ *
+ * Image_asset* hero = Asset_manager::Instance().acquire_image(HERO);
+ * ...
+ * Asset_manager::Instance().release(hero);
+ * @endcode
+ */
+class Asset_manager
+{
+
+public:
+
+    // Returns the singleton instance.
+    static Asset_manager& Instance();
+
+
+    /**
+     * @brief Returns the image of the path, loads it on the first acquire.
+     *
+     * @param path Source path of the image.
+     * @return Asset with one more reference, nullptr if the path is a different asset type.
+     */
+    Image_asset* acquire_image(const Asset_path& path);
+
+    // Same as acquire_image() for the audio
+    Audio_asset* acquire_audio(const Asset_path& path);
+
+    // Same as acquire_image() for the baked fonts (.fnt)
+    Font_asset* acquire_font(const Asset_path& path);
+
+    // Same as acquire_image() for the videos (.y4m) - the decoder thread starts with it
+    Video_asset* acquire_video(const Asset_path& path);
+
+    /**
+     * @brief Acquires the asset only if it is already loaded (no loading).
+     *
+     * @return Asset with one more reference, nullptr if it is not resident or of another type.
+     */
+    Asset* acquire_resident(const Asset_path& path, Asset_type type);
+
+    /**
+     * @brief Registers an asset loaded elsewhere (the Asset_loader workers).
+     *
+     * If the path is already resident, the new asset is dropped and the resident one is used.
+     *
+     * @return Resident asset of the path with one more reference.
+     */
+    Asset* adopt(std::unique_ptr<Asset> asset);
+
+    /**
+     * @brief Drops one reference. The unpinned asset without the references is destroyed.
+     *
+     * @param asset Asset returned by an acquire call (nullptr is ignored).
+     */
+    void release(const Asset* asset);
+
+    /**
+     * @brief Keeps the asset resident without the references (or lets it go).
+     *
+     * The pinned image textures are never evicted by the Texture_budget.
+     *
+     * @return false if the path is not loaded.
+     */
+    bool set_pinned(const Asset_path& path, bool pinned);
+
+
+    // Number of the references of the path, 0 if it is not loaded
+    int get_ref_count(const Asset_path& path) const;
+
+    // Number of the loaded assets
+    size_t get_resident_count() const;
+
+    // RAM of the loaded assets of the type (Asset::get_memory_bytes()), a walk over the index
+    size_t get_memory_bytes(Asset_type type) const;
+
+
+    // Destroys all assets, referenced or not (shutdown, before the renderer) - the index memory is freed too
+    void clear();
+
+
+    /**
+     * @brief Moves the asset index to another memory source.
+     *
+     * Only while nothing is loaded. The Instance_pool of every instance type takes its own.
+     *
+     * @return false if some asset is resident.
+     */
+    bool set_allocator(Allocator& allocator);
+
+
+    // === IMAGE VARIANTS ===
+
+    /**
+     * @brief Conditions of the resolution variant choice of the cooked images (Asset_cooker --variants).
+     *
+     * Only the images loaded after the call use them - the resident ones keep their variant.
+     * Set on the main thread, before the loading starts (the Asset_loader workers read them).
+     *
+     * @param draw_scale     Output pixels per logical pixel of the states (the renderer scale, 1 - the logical target).
+     * @param texture_budget Texture_budget bytes, 0 - unlimited: the full images of the pack over it
+     *                       force the smaller variants, whatever the draw scale.
+     */
+    void set_image_variant_policy(float draw_scale, size_t texture_budget);
+
+    /**
+     * @brief Variant of the cooked image to load: the smallest one with at least a texel per
+     *        drawn pixel, or a smaller one, if the budget needs it.
+     *
+     * @return Divisor of the variant (pack_variant_name()), 1 - the full size (also not cooked, no variants).
+     */
+    int select_image_variant(const std::string& path) const;
+
+    // Smallest divisor the budget allows for the mounted pack (1 - the full size fits)
+    int get_min_image_variant() const;
+
+    // === IMAGE VARIANTS ===
+
+
+private:
+
+    // Private constructor for singleton
+    Asset_manager() = default;
+
+    // Copying the singleton is not allowed
+    Asset_manager(const Asset_manager&) = delete;
+    Asset_manager& operator=(const Asset_manager&) = delete;
+
+
+    struct Entry
+    {
+        std::unique_ptr<Asset> asset;
+        int refs = 0;
+        bool pinned = false;
+    };
+
+    // Finds or loads the asset of the type
+    Asset* acquire(const Asset_path& path, Asset_type type);
+
+
+    using Asset_map = std::unordered_map<Hash_key, Entry, std::hash<Hash_key>, std::equal_to<Hash_key>,
+                                         Std_allocator<std::pair<const Hash_key, Entry>>>;
+
+    Asset_map assets;
+
+
+    float variant_draw_scale = 1.0f;
+    size_t variant_budget = 0;
+};
+
+// =========================================================================================== ASSET MANAGER
@@ -0,0 +1,631 @@
+// asset_pack.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "asset_pack.h"
+#include "lz4_block.h"
+#include "../jobs/job_system.h"
+
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <cstring>
+#include <cstdlib>
+
+#ifdef PLATFORM_LINUX
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== PACK FORMAT
+
+Uint32 pack_name_hash(std::string_view name)
+{
+    Uint32 hash = 2166136261u;
+
+    for (unsigned char c : name)
+    {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+
+std::string pack_variant_name(std::string_view name, int divisor)
+{
+    std::string variant(name);
+
+    if (divisor > 1) variant += "@" + std::to_string(divisor);
+
+    return variant;
+}
+
+
+std::string pack_tile_name(std::string_view name, int column, int row)
+{
+    return std::string(name) + "#" + std::to_string(column) + "," + std::to_string(row);
+}
+
+
+std::string pack_tile_grid_name(std::string_view name)
+{
+    return std::string(name) + "#tiles";
+}
+
+
+// Little-endian field of the mapped index
+static Uint32 load_le32(const unsigned char* p)
+{
+    return static_cast<Uint32>(p[0]) | static_cast<Uint32>(p[1]) << 8 |
+           static_cast<Uint32>(p[2]) << 16 | static_cast<Uint32>(p[3]) << 24;
+}
+
+
+static void store_le32(unsigned char* p, Uint32 v)
+{
+    p[0] = static_cast<unsigned char>(v);
+    p[1] = static_cast<unsigned char>(v >> 8);
+    p[2] = static_cast<unsigned char>(v >> 16);
+    p[3] = static_cast<unsigned char>(v >> 24);
+}
+
+
+bool pack_compress(const std::vector<unsigned char>& data, std::vector<unsigned char>& blob)
+{
+    const size_t count = (data.size() + PACK_LZ4_BLOCK - 1) / PACK_LZ4_BLOCK;
+
+    // The block count and the size table first, the blocks follow
+    blob.assign(4 + count * 4, 0);
+    store_le32(blob.data(), static_cast<Uint32>(count));
+
+    std::vector<unsigned char> block(lz4_compress_bound(PACK_LZ4_BLOCK));
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const unsigned char* raw = data.data() + i * PACK_LZ4_BLOCK;
+        const size_t raw_size = std::min<size_t>(PACK_LZ4_BLOCK, data.size() - i * PACK_LZ4_BLOCK);
+
+        const size_t packed = lz4_compress(raw, raw_size, block.data());
+
+        // Not smaller - the block is stored, the reader copies it
+        if (packed >= raw_size)
+        {
+            store_le32(blob.data() + 4 + i * 4, static_cast<Uint32>(raw_size) | PACK_LZ4_STORED);
+            blob.insert(blob.end(), raw, raw + raw_size);
+        }
+        else
+        {
+            store_le32(blob.data() + 4 + i * 4, static_cast<Uint32>(packed));
+            blob.insert(blob.end(), block.data(), block.data() + packed);
+        }
+    }
+
+    return blob.size() + data.size() / 16 <= data.size();
+}
+
+
+// Index order - by the hash, then by the name for the collisions
+static bool entry_less(const Pack_entry& a, const Pack_entry& b)
+{
+    return a.hash != b.hash ? a.hash < b.hash : a.name < b.name;
+}
+
+// =========================================================================================== PACK FORMAT
+
+
+// =========================================================================================== ASSET PACK
+
+Asset_pack& Asset_pack::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Asset_pack instance;
+
+    return instance;
+}
+
+
+Asset_pack::~Asset_pack() { unmount(); }
+
+
+bool Asset_pack::mount(const std::string& path)
+{
+    unmount();
+
+#ifdef PLATFORM_LINUX
+    int fd = ::open(path.c_str(), O_RDONLY);
+
+    struct stat st;
+
+    if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        void* map = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (map != MAP_FAILED)
+        {
+            data = static_cast<const unsigned char*>(map);
+            data_size = static_cast<size_t>(st.st_size);
+            mapped = true;
+        }
+    }
+
+    // The mapping stays valid without the descriptor
+    if (fd >= 0) ::close(fd);
+#endif
+
+    // No mmap - the whole pack in memory, still a single open and read
+    if (!data)
+    {
+        size_t size = 0;
+        void* file = SDL_LoadFile(path.c_str(), &size);
+
+        data = static_cast<const unsigned char*>(file);
+        data_size = size;
+    }
+
+    if (!data)
+    {
+        SDL_Log("Asset pack %s opening failed: %s", path.c_str(), SDL_GetError());
+        return false;
+    }
+
+    const unsigned char* p = data;
+
+    if (data_size < 12 || load_le32(p) != PACK_MAGIC || load_le32(p + 4) != PACK_VERSION)
+    {
+        SDL_Log("Asset pack %s has an unsupported format", path.c_str());
+        unmount();
+        return false;
+    }
+
+    const Uint32 count = load_le32(p + 8);
+
+    if (12 + static_cast<size_t>(count) * PACK_ENTRY_SIZE > data_size)
+    {
+        SDL_Log("Asset pack %s index is truncated", path.c_str());
+        unmount();
+        return false;
+    }
+
+    entries.resize(count);
+
+    p += 12;
+
+    for (Uint32 i = 0; i < count; ++i, p += PACK_ENTRY_SIZE)
+    {
+        Pack_entry& e = entries[i];
+
+        const char* name = reinterpret_cast<const char*>(p);
+
+        e.name.assign(name, strnlen(name, PACK_NAME_SIZE));
+        e.hash = load_le32(p + PACK_NAME_SIZE);
+        e.type = static_cast<Asset_type>(load_le32(p + PACK_NAME_SIZE + 4));
+        e.offset = load_le32(p + PACK_NAME_SIZE + 8);
+        e.size = load_le32(p + PACK_NAME_SIZE + 12);
+        e.raw_size = load_le32(p + PACK_NAME_SIZE + 16);
+
+        for (int k = 0; k < PACK_PARAM_COUNT; ++k) e.params[k] = load_le32(p + PACK_NAME_SIZE + 20 + k * 4);
+
+        if (e.type != Asset_type::IMAGE) continue;
+
+        // A tile of a tiled image - a few of them are resident at a time, not the whole image
+        if (e.name.find('#') != std::string::npos) continue;
+
+        // "<path>@<divisor>" - a variant, else a full size image
+        const size_t at = e.name.rfind('@');
+        const int divisor = at != std::string::npos ? std::atoi(e.name.c_str() + at + 1) : 1;
+
+        if (divisor > 1) max_variant = std::max(max_variant, divisor);
+        else full_image_bytes += pack_data_size(e);
+    }
+
+    // The cooker writes the index sorted - keep the search valid for any writer
+    if (!std::is_sorted(entries.begin(), entries.end(), entry_less))
+        std::sort(entries.begin(), entries.end(), entry_less);
+
+    return true;
+}
+
+
+void Asset_pack::unmount()
+{
+#ifdef PLATFORM_LINUX
+    if (data && mapped) munmap(const_cast<unsigned char*>(data), data_size);
+#endif
+
+    if (data && !mapped) SDL_free(const_cast<unsigned char*>(data));
+
+    data = nullptr;
+    data_size = 0;
+    mapped = false;
+
+    entries.clear();
+
+    full_image_bytes = 0;
+    max_variant = 1;
+
+    // munmap drops the locks with the pages
+    pins.clear();
+    pinned_bytes = 0;
+    locked_bytes = 0;
+}
+
+
+bool Asset_pack::is_mounted() const { return data != nullptr; }
+
+
+const Pack_entry* Asset_pack::find(std::string_view name) const
+{
+    if (entries.empty()) return nullptr;
+
+    const Uint32 hash = pack_name_hash(name);
+
+    // The order of entry_less against the hash and the view - no key entry, no copy of the name
+    auto it = std::lower_bound(entries.begin(), entries.end(), hash, [name](const Pack_entry& e, Uint32 h)
+                               { return e.hash != h ? e.hash < h : e.name.compare(name) < 0; });
+
+    return it != entries.end() && it->hash == hash && it->name == name ? &*it : nullptr;
+}
+
+
+const void* Asset_pack::get_data(const Pack_entry& entry) const
+{
+    if (!data || static_cast<size_t>(entry.offset) + entry.size > data_size) return nullptr;
+
+    return data + entry.offset;
+}
+
+
+// Close of the stream over the decompressed copy - the copy goes with it
+static int close_owned_stream(SDL_RWops* rw)
+{
+    SDL_free(rw->hidden.mem.base);
+    SDL_FreeRW(rw);
+
+    return 0;
+}
+
+
+SDL_RWops* Asset_pack::open(std::string_view name) const
+{
+    const Pack_entry* entry = find(name);
+    const void* blob = entry ? get_data(*entry) : nullptr;
+
+    if (!blob) return nullptr;
+
+    if (!entry->raw_size) return SDL_RWFromConstMem(blob, static_cast<int>(entry->size));
+
+    void* copy = SDL_malloc(entry->raw_size);
+    SDL_RWops* rw = copy && decompress(*entry, static_cast<const unsigned char*>(blob), static_cast<unsigned char*>(copy))
+                  ? SDL_RWFromConstMem(copy, static_cast<int>(entry->raw_size)) : nullptr;
+
+    if (!rw)
+    {
+        SDL_Log("Asset pack entry %s decompression failed", entry->name.c_str());
+        SDL_free(copy);
+        return nullptr;
+    }
+
+    rw->close = close_owned_stream;
+
+    return rw;
+}
+
+
+bool Asset_pack::read(const Pack_entry& entry, void* dst) const
+{
+    const void* blob = get_data(entry);
+
+    if (!blob || !dst) return false;
+
+    if (entry.raw_size) return decompress(entry, static_cast<const unsigned char*>(blob), static_cast<unsigned char*>(dst));
+
+    std::memcpy(dst, blob, entry.size);
+
+    return true;
+}
+
+
+bool Asset_pack::decompress(const Pack_entry& entry, const unsigned char* blob, unsigned char* dst)
+{
+    const Uint32 count = entry.size >= 4 ? load_le32(blob) : 0;
+    const size_t table_end = 4 + static_cast<size_t>(count) * 4;
+
+    if (count != (entry.raw_size + PACK_LZ4_BLOCK - 1) / PACK_LZ4_BLOCK || table_end > entry.size) return false;
+
+    // Start of every block - the sizes summed up and checked against the blob once
+    std::vector<size_t> starts(count + 1);
+
+    starts[0] = table_end;
+
+    for (Uint32 i = 0; i < count; ++i)
+    {
+        starts[i + 1] = starts[i] + (load_le32(blob + 4 + i * 4) & ~PACK_LZ4_STORED);
+
+        if (starts[i + 1] > entry.size) return false;
+    }
+
+    std::atomic<bool> damaged{false};
+
+    // Independent blocks - every one straight into its part of the destination
+    Job_system::Instance().parallel_for(static_cast<int>(count), 1, [&](int begin, int end)
+    {
+        for (int i = begin; i < end; ++i)
+        {
+            const size_t offset = static_cast<size_t>(i) * PACK_LZ4_BLOCK;
+            const size_t raw_size = std::min<size_t>(PACK_LZ4_BLOCK, entry.raw_size - offset);
+
+            const unsigned char* src = blob + starts[i];
+            const size_t stored = starts[i + 1] - starts[i];
+
+            const bool ok = load_le32(blob + 4 + i * 4) & PACK_LZ4_STORED
+                ? stored == raw_size && (std::memcpy(dst + offset, src, raw_size), true)
+                : lz4_decompress(src, stored, dst + offset, raw_size);
+
+            if (!ok) damaged.store(true, std::memory_order_relaxed);
+        }
+    });
+
+    return !damaged.load();
+}
+
+
+SDL_Surface* Asset_pack::read_image(const Pack_entry& entry) const
+{
+    if (entry.type != Asset_type::IMAGE) return nullptr;
+
+    const int w = static_cast<int>(entry.params[0]);
+    const int h = static_cast<int>(entry.params[1]);
+    const Uint32 format = entry.params[2] & ~PACK_IMAGE_PREMULTIPLIED;
+    const int pitch = static_cast<int>(entry.params[3]);
+
+    const void* pixels = get_data(entry);
+
+    if (!pixels || pack_data_size(entry) != static_cast<Uint32>(pitch * h)) return nullptr;
+
+    // Compressed - the blocks go straight into the own pixels of the surface
+    if (entry.raw_size)
+    {
+        SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, w, h, SDL_BITSPERPIXEL(format), format);
+
+        if (surface && !read_image_rows(entry, surface->pixels, surface->pitch))
+        {
+            SDL_Log("Asset pack image %s decompression failed", entry.name.c_str());
+            SDL_FreeSurface(surface);
+            return nullptr;
+        }
+
+        return surface;
+    }
+
+    // Surface over the mapped rows - SDL only reads them (texture upload, atlas blit)
+    return SDL_CreateRGBSurfaceWithFormatFrom(const_cast<void*>(pixels), w, h, SDL_BITSPERPIXEL(format), pitch, format);
+}
+
+
+bool Asset_pack::pin(const Pack_entry& entry, bool lock)
+{
+    if (!get_data(entry) || entry.size == 0) return false;
+
+    for (const Pin& p : pins)
+        if (p.entry == &entry) return false;
+
+    Pin pin = {&entry, entry.offset, static_cast<size_t>(entry.offset) + entry.size, false};
+
+#ifdef PLATFORM_LINUX
+    if (mapped)
+    {
+        // Whole pages - the blobs are only PACK_ALIGNMENT aligned, the mapping starts at a page
+        const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+        pin.begin = pin.begin / page * page;
+        pin.end = (pin.end + page - 1) / page * page;
+
+        void* start = const_cast<unsigned char*>(data) + pin.begin;
+        const size_t length = pin.end - pin.begin;
+
+        if (lock && !lock_refused)
+        {
+            pin.locked = mlock(start, length) == 0;
+
+            if (!pin.locked)
+            {
+                SDL_Log("Asset pack mlock of %s failed (%s), the hot assets are only prefaulted", entry.name.c_str(), std::strerror(errno));
+                lock_refused = true;
+            }
+        }
+
+        // The kernel reads the pages in the background, the locked ones are resident already
+        if (!pin.locked) madvise(start, length, MADV_WILLNEED);
+    }
+#else
+    (void)lock;
+#endif
+
+    pins.push_back(pin);
+
+    pinned_bytes += entry.size;
+    if (pin.locked) locked_bytes += entry.size;
+
+    return true;
+}
+
+
+void Asset_pack::unpin(const Pack_entry& entry)
+{
+    auto it = std::find_if(pins.begin(), pins.end(), [&entry](const Pin& p) { return p.entry == &entry; });
+
+    if (it == pins.end()) return;
+
+    const Pin pin = *it;
+
+    *it = pins.back();
+    pins.pop_back();
+
+    pinned_bytes -= entry.size;
+    if (pin.locked) locked_bytes -= entry.size;
+
+#ifdef PLATFORM_LINUX
+    if (!pin.locked) return;
+
+    unsigned char* base = const_cast<unsigned char*>(data);
+
+    munlock(base + pin.begin, pin.end - pin.begin);
+
+    // The locks don't nest - the edge pages shared with a locked neighbour are locked again
+    for (const Pin& other : pins)
+    {
+        if (!other.locked || other.end <= pin.begin || pin.end <= other.begin) continue;
+
+        const size_t begin = std::max(other.begin, pin.begin);
+        const size_t end = std::min(other.end, pin.end);
+
+        mlock(base + begin, end - begin);
+    }
+#endif
+}
+
+
+void Asset_pack::read_ahead(size_t begin, size_t end) const
+{
+#ifdef PLATFORM_LINUX
+    end = std::min(end, data_size);
+
+    if (!mapped || begin >= end) return;
+
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+    begin = begin / page * page;
+
+    madvise(const_cast<unsigned char*>(data) + begin, end - begin, MADV_WILLNEED);
+#else
+    (void)begin;
+    (void)end;
+#endif
+}
+
+
+bool Asset_pack::read_image_rows(const Pack_entry& entry, void* dst, int dst_pitch) const
+{
+    const int h = static_cast<int>(entry.params[1]);
+    const int pitch = static_cast<int>(entry.params[3]);
+    const size_t row = static_cast<size_t>(entry.params[0]) * SDL_BYTESPERPIXEL(entry.params[2] & ~PACK_IMAGE_PREMULTIPLIED);
+
+    const unsigned char* blob = static_cast<const unsigned char*>(get_data(entry));
+
+    if (entry.type != Asset_type::IMAGE || !blob || !dst || dst_pitch < static_cast<int>(row) ||
+        pack_data_size(entry) != static_cast<Uint32>(pitch * h)) return false;
+
+    unsigned char* out = static_cast<unsigned char*>(dst);
+
+    // The same rows - one copy or one decompression into the destination
+    if (dst_pitch == pitch) return read(entry, out);
+
+    std::vector<unsigned char> rows;
+
+    // Another row alignment (SDL, the texture lock) - decompressed aside and copied over by the rows
+    if (entry.raw_size)
+    {
+        rows.resize(entry.raw_size);
+
+        if (!decompress(entry, blob, rows.data())) return false;
+
+        blob = rows.data();
+    }
+
+    for (int y = 0; y < h; ++y)
+        std::memcpy(out + static_cast<size_t>(y) * dst_pitch, blob + static_cast<size_t>(y) * pitch, row);
+
+    return true;
+}
+
+
+bool Asset_pack::write_file(const std::string& path, std::vector<Pack_entry>& entries,
+                            std::vector<std::vector<unsigned char>>& blobs)
+{
+    if (entries.size() != blobs.size()) return false;
+
+    for (Pack_entry& e : entries) e.hash = pack_name_hash(e.name);
+
+    // Index order, the blobs follow their entries
+    std::vector<size_t> order(entries.size());
+    std::iota(order.begin(), order.end(), 0);
+
+    std::sort(order.begin(), order.end(), [&entries](size_t a, size_t b) { return entry_less(entries[a], entries[b]); });
+
+    std::vector<Pack_entry> sorted_entries;
+    std::vector<std::vector<unsigned char>> sorted_blobs;
+
+    for (size_t i : order)
+    {
+        sorted_entries.push_back(entries[i]);
+        sorted_blobs.push_back(std::move(blobs[i]));
+    }
+
+    entries.swap(sorted_entries);
+    blobs.swap(sorted_blobs);
+
+    SDL_RWops* out = SDL_RWFromFile(path.c_str(), "wb");
+
+    if (!out)
+    {
+        SDL_Log("Asset pack %s creation failed: %s", path.c_str(), SDL_GetError());
+        return false;
+    }
+
+    // Blobs follow the index, aligned for the mapped pixel rows
+    auto align = [](Uint32 v) { return (v + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT; };
+
+    Uint32 offset = align(12 + static_cast<Uint32>(entries.size()) * PACK_ENTRY_SIZE);
+
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        entries[i].offset = offset;
+        entries[i].size = static_cast<Uint32>(blobs[i].size());
+
+        offset = align(offset + entries[i].size);
+    }
+
+    bool ok = SDL_WriteLE32(out, PACK_MAGIC) && SDL_WriteLE32(out, PACK_VERSION) &&
+              SDL_WriteLE32(out, static_cast<Uint32>(entries.size()));
+
+    for (const Pack_entry& e : entries)
+    {
+        char name[PACK_NAME_SIZE] = {};
+        std::strncpy(name, e.name.c_str(), PACK_NAME_SIZE - 1);
+
+        ok = ok && SDL_RWwrite(out, name, PACK_NAME_SIZE, 1) == 1;
+        ok = ok && SDL_WriteLE32(out, e.hash) && SDL_WriteLE32(out, static_cast<Uint32>(e.type)) &&
+             SDL_WriteLE32(out, e.offset) && SDL_WriteLE32(out, e.size) && SDL_WriteLE32(out, e.raw_size);
+
+        for (Uint32 p : e.params) ok = ok && SDL_WriteLE32(out, p);
+    }
+
+    static const unsigned char zeros[PACK_ALIGNMENT] = {};
+
+    for (size_t i = 0; i < blobs.size() && ok; ++i)
+    {
+        // Padding up to the blob offset
+        Sint64 pos = SDL_RWtell(out);
+
+        if (pos < entries[i].offset) ok = SDL_RWwrite(out, zeros, static_cast<size_t>(entries[i].offset - pos), 1) == 1;
+
+        if (ok && !blobs[i].empty()) ok = SDL_RWwrite(out, blobs[i].data(), blobs[i].size(), 1) == 1;
+    }
+
+    SDL_RWclose(out);
+
+    if (!ok) SDL_Log("Asset pack %s writing failed: %s", path.c_str(), SDL_GetError());
+
+    return ok;
+}
+
+// =========================================================================================== ASSET PACK
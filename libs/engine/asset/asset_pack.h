@@ -0,0 +1,321 @@
+// asset_pack.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "asset.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== PACK FORMAT
+
+// File layout (little-endian):
+//
+// [magic "MSQP"] [version] [entry count]
+// [entry] * count - fixed size (PACK_ENTRY_SIZE), sorted by the name hash
+// [data blobs] - every blob starts at a PACK_ALIGNMENT boundary
+//
+// Image blob - rows of pitch bytes in the device pixel format at the final size.
+//              A smaller resolution variant is an own entry, named "<path>@<divisor>" (the texels
+//              of 1 / divisor of the full size), the logical size is the one of the full image.
+// Audio blob - interleaved PCM at the output sample rate, or its IMA-ADPCM blocks (adpcm.h).
+// Raw blob   - file as is (type UNKNOWN), read through SDL_RWops.
+//
+// Tiled image - a large image cut into the square tiles of a fixed size, streamed by Tiled_image:
+//              every tile is an own image entry "<path>#<column>,<row>" (the edge tiles are smaller),
+//              the grid is described by the entry "<path>#tiles" (type UNKNOWN, no data, the params).
+//
+// An image or audio blob can be LZ4-compressed (the entry raw_size is not 0) in independent
+// blocks of PACK_LZ4_BLOCK bytes of the data, decompressed in parallel:
+//
+// [block count] [stored size of every block] [blocks]
+//
+// A stored size with PACK_LZ4_STORED is the block as is (it didn't compress). The raw blobs
+// stay uncompressed - they are used in place (fonts, strings) or streamed.
+
+constexpr Uint32 PACK_MAGIC = 0x5051534D;      // "MSQP"
+constexpr Uint32 PACK_VERSION = 5;
+constexpr int PACK_NAME_SIZE = 64;
+constexpr int PACK_PARAM_COUNT = 7;
+constexpr int PACK_ENTRY_SIZE = PACK_NAME_SIZE + 4 * (5 + PACK_PARAM_COUNT);
+constexpr Uint32 PACK_ALIGNMENT = 16;
+
+// Data bytes of one compressed block, and the flag of the block stored as is
+constexpr Uint32 PACK_LZ4_BLOCK = 64 * 1024;
+constexpr Uint32 PACK_LZ4_STORED = 0x80000000u;
+
+// AUDIO format param of the IMA-ADPCM blob (the WAV format tag, not an SDL_AudioFormat)
+constexpr Uint32 PACK_AUDIO_IMA_ADPCM = 0x0011;
+
+// IMAGE format param flag of the premultiplied alpha rows (the cooker premultiplies the ARGB8888 ones)
+constexpr Uint32 PACK_IMAGE_PREMULTIPLIED = 0x80000000u;
+
+// Largest divisor of the image resolution variants (full, half, quarter)
+constexpr int PACK_MAX_VARIANT = 4;
+
+
+// Index entry of a single packed asset
+struct Pack_entry
+{
+    std::string name;           // Source path, which the assets are looked up by
+    Uint32 hash = 0;            // pack_name_hash(name)
+    Asset_type type = Asset_type::UNKNOWN;
+
+    Uint32 offset = 0;          // Blob position in the file
+    Uint32 size = 0;            // Blob size in bytes
+    Uint32 raw_size = 0;        // Data size of the LZ4-compressed blob, 0 - stored as is
+
+    // IMAGE: width, height, SDL_PixelFormatEnum (| PACK_IMAGE_PREMULTIPLIED), pitch,
+    //        logical width, logical height - the size the game draws it at (0 - width, height),
+    //        nine-slice insets - pack_slice_insets() of the logical left, top, right, bottom (0 - none)
+    // AUDIO: sample rate, channels, SDL_AudioFormat (or PACK_AUDIO_IMA_ADPCM), sample frames
+    Uint32 params[PACK_PARAM_COUNT] = {0, 0, 0, 0, 0, 0, 0};
+};
+
+
+// FNV-1a hash of the entry name - the index search key
+Uint32 pack_name_hash(std::string_view name);
+
+// Bytes of the entry data - the decompressed size of a compressed blob
+inline Uint32 pack_data_size(const Pack_entry& entry) { return entry.raw_size ? entry.raw_size : entry.size; }
+
+/**
+ * @brief LZ4 blob of the data in the pack block layout (used by the cooker).
+ *
+ * @param data Entry data.
+ * @param blob Compressed blob.
+ * @return false if it would save less than a sixteenth - store the data as is then.
+ */
+bool pack_compress(const std::vector<unsigned char>& data, std::vector<unsigned char>& blob);
+
+// Entry name of the resolution variant: "<name>@<divisor>", the name itself for 1
+std::string pack_variant_name(std::string_view name, int divisor);
+
+// Entry names of the tiled image: the tile "<name>#<column>,<row>" and the grid "<name>#tiles".
+// The grid params: width, height, tile side (all in texels), columns, rows, logical width, logical height
+std::string pack_tile_name(std::string_view name, int column, int row);
+std::string pack_tile_grid_name(std::string_view name);
+
+// IMAGE nine-slice param of the insets (0 - 255 logical pixels each) and back
+constexpr Uint32 pack_slice_insets(Uint32 left, Uint32 top, Uint32 right, Uint32 bottom)
+{
+    return (left & 0xFF) | (top & 0xFF) << 8 | (right & 0xFF) << 16 | (bottom & 0xFF) << 24;
+}
+
+constexpr Uint32 pack_slice_inset(Uint32 param, int edge) { return param >> (edge * 8) & 0xFF; }
+
+// =========================================================================================== PACK FORMAT
+
+
+// =========================================================================================== ASSET PACK
+
+
+/**
+ * @brief Memory-mapped pack of the cooked assets and the raw files (see asset_cooker).
+ *
+ * One file instead of thousands - a single open on the SD card. The pack is mapped
+ * with mmap (read into memory on the other platforms) and the blobs are used straight
+ * from the mapped pages: the cooked images are surfaces over the pack memory, the raw
+ * files are SDL_RWFromConstMem streams, no intermediate buffers.
+ *
+ * A compressed image or audio entry is read from fewer pages of the SD card: its blocks
+ * are decompressed in parallel on the Job_system straight into the destination - the
+ * surface pixels, the samples buffer, the memory of the stream.
+ *
+ * Image_asset and Audio_asset look their source_path up here first. The assets
+ * created from the pack refer to its memory - unmount only without them
+ * (the engine clears the Asset_manager first).
+ *
+ * Singleton, like the Preloader - the asset constructors have no context.
+ * The lookups and reads are thread-safe (the Asset_loader workers),
+ * mount and unmount are main-thread only.
+ */
+class Asset_pack
+{
+
+public:
+
+    // Returns the singleton instance.
+    static Asset_pack& Instance();
+
+
+    /**
+     * @brief Maps the pack and reads its index. Replaces the mounted pack.
+     *
+     * @param path Pack file path.
+     * @return true if the pack is valid.
+     */
+    bool mount(const std::string& path);
+
+    // Unmaps the pack
+    void unmount();
+
+    bool is_mounted() const;
+
+
+    // Index entry by the asset name (hash search, no copy of the name), nullptr if it isn't packed
+    const Pack_entry* find(std::string_view name) const;
+
+    // Bytes of the full size images (not the variants, nor the streamed tiles) - what the images need without the variants
+    size_t get_full_image_bytes() const { return full_image_bytes; }
+
+    // Largest divisor of the image variants in the pack, 1 without any
+    int get_max_variant() const { return max_variant; }
+
+    // Blob of the entry in the mapped memory (compressed as stored), nullptr if it is out of the pack
+    const void* get_data(const Pack_entry& entry) const;
+
+    /**
+     * @brief Read-only stream over the blob (SDL_RWFromConstMem, no copy).
+     *
+     * A compressed entry is decompressed into the memory of the stream, freed by its close.
+     *
+     * @return Stream to close by the caller, nullptr if the name is not packed.
+     */
+    SDL_RWops* open(std::string_view name) const;
+
+    /**
+     * @brief Copies (or decompresses) the entry data.
+     *
+     * @param entry Entry of the mounted pack.
+     * @param dst   Destination of pack_data_size(entry) bytes.
+     * @return false if the entry is out of the pack or its blocks are damaged.
+     */
+    bool read(const Pack_entry& entry, void* dst) const;
+
+    /**
+     * @brief Surface over the pixels of an image entry - no copy.
+     *
+     * The pixels are read-only and valid while the pack is mounted. A compressed entry is
+     * decompressed into the own pixels of the surface.
+     *
+     * @return Surface owned by the caller, nullptr on failure.
+     */
+    SDL_Surface* read_image(const Pack_entry& entry) const;
+
+    /**
+     * @brief Copies (or decompresses) the pixel rows of an image entry into the memory of another pitch.
+     *
+     * The destination is the locked texture or the own surface - a compressed entry of the same
+     * pitch is decompressed straight into it, another pitch goes through a copy of the rows.
+     *
+     * @param entry     Image entry of the mounted pack.
+     * @param dst       Rows of the entry height.
+     * @param dst_pitch Bytes per destination row, at least the width of a row.
+     */
+    bool read_image_rows(const Pack_entry& entry, void* dst, int dst_pitch) const;
+
+
+    // === HOT PAGES ===
+
+    /**
+     * @brief Faults the pages of the blob in now, before the gameplay touches them.
+     *
+     * A mapped blob is read from the SD card on the first access to each of its pages - a
+     * deferred image drawn for the first time, a sound played for the first time, a music
+     * stream - a fault of milliseconds in the middle of a frame. The pages are requested
+     * ahead with madvise(MADV_WILLNEED) (the kernel reads them in the background), with
+     * the lock on they are mlock-ed too: read at once and never evicted under the memory
+     * pressure - the lock falls back to the advice over the RLIMIT_MEMLOCK.
+     *
+     * A pack read into memory has nothing to fault, the call only counts the entry.
+     *
+     * @param entry Entry of the mounted pack.
+     * @param lock  mlock the pages, else only advise them.
+     * @return true if the entry is pinned (unpin() it), false if it was already or is out of the pack.
+     */
+    bool pin(const Pack_entry& entry, bool lock);
+
+    // Releases the pin - munlock of the pages no other locked entry shares (the advised ones have nothing to undo)
+    void unpin(const Pack_entry& entry);
+
+    /**
+     * @brief Requests a byte range of the pack read ahead, as one sequential read.
+     *
+     * madvise(MADV_WILLNEED) over the pages of the range - the Asset_loader advises a run of
+     * the neighbouring queued entries before it decodes them, the faults of the decodes find
+     * the pages read. Nothing to do for a pack read into memory. Thread-safe.
+     *
+     * @param begin First byte (an entry offset).
+     * @param end   Byte past the range, clamped to the pack.
+     */
+    void read_ahead(size_t begin, size_t end) const;
+
+    // Bytes of the pinned entries, and of the mlock-ed ones (resident until unpinned)
+    size_t get_pinned_bytes() const { return pinned_bytes; }
+    size_t get_locked_bytes() const { return locked_bytes; }
+
+    // === HOT PAGES ===
+
+
+    /**
+     * @brief Writes a pack file (used by the cooker).
+     *
+     * The hashes, offsets and sizes of the entries are filled from the names and blobs (raw_size
+     * of a pack_compress() blob is set by the caller),
+     * and the entries are sorted into the index order.
+     *
+     * @param path    Output file path.
+     * @param entries Index entries, one per blob.
+     * @param blobs   Data of the entries.
+     */
+    static bool write_file(const std::string& path, std::vector<Pack_entry>& entries,
+                           std::vector<std::vector<unsigned char>>& blobs);
+
+
+private:
+
+    // Private constructor for singleton
+    Asset_pack() = default;
+
+    // Unmaps the pack
+    ~Asset_pack();
+
+    // Decompresses the blocks of the blob into raw_size bytes, in parallel (any thread)
+    static bool decompress(const Pack_entry& entry, const unsigned char* blob, unsigned char* dst);
+
+    // Copying the singleton is not allowed
+    Asset_pack(const Asset_pack&) = delete;
+    Asset_pack& operator=(const Asset_pack&) = delete;
+
+
+    // Mapped pack file (or its copy in memory)
+    const unsigned char* data = nullptr;
+    size_t data_size = 0;
+
+    // The data is mapped, not allocated
+    bool mapped = false;
+
+    // Parsed index, sorted by the hash
+    std::vector<Pack_entry> entries;
+
+    // Image totals of the index - the variant selection
+    size_t full_image_bytes = 0;
+    int max_variant = 1;
+
+    // Pinned entry and its page range in the mapping
+    struct Pin
+    {
+        const Pack_entry* entry;
+        size_t begin;
+        size_t end;
+        bool locked;
+    };
+
+    // A few per state - searched linearly
+    std::vector<Pin> pins;
+
+    size_t pinned_bytes = 0;
+    size_t locked_bytes = 0;
+
+    // mlock was refused once (logged) - the later pins are advised only
+    bool lock_refused = false;
+};
+
+// =========================================================================================== ASSET PACK
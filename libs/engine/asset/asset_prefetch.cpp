@@ -0,0 +1,280 @@
+// asset_prefetch.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "asset_prefetch.h"
+#include "asset_manager.h"
+#include "asset_pack.h"
+#include "../audio/audio_mixer.h"
+#include "../state_machine/state_machine.h"
+#include "../zone_profiler/zone_profiler.h"
+
+#include <cstring>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== ASSET PREFETCH
+
+Asset_prefetcher& Asset_prefetcher::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Asset_prefetcher instance;
+    return instance;
+}
+
+
+void Asset_prefetcher::update(const State_machine& sm)
+{
+    if (sm.get_change_counter() == seen_changes)
+    {
+        if (warm_waiting) warm_ready();
+        return;
+    }
+
+    seen_changes = sm.get_change_counter();
+
+    PROFILE_ZONE("asset_prefetch");
+
+    const State* current = sm.get_current_state();
+    const State* overlay = sm.get_top_overlay();
+    const State* shown = overlay ? overlay : current;
+
+    // Before the plan changes - the prefetched assets of the entered state are still held
+    if (shown != seen_state) count_hits(shown);
+
+    seen_state = shown;
+
+    next.clear();
+
+    // The active ones first - the low ones are cut by MAX_ASSETS
+    if (current) hold(current, Load_priority::NORMAL);
+    if (overlay) hold(overlay, Load_priority::NORMAL);
+
+    for (int i = 0; i < sm.get_region_count(); ++i) hold(sm.get_region_state(i), Load_priority::NORMAL);
+
+    if (current) plan(sm, current);
+    if (overlay) plan(sm, overlay);
+
+    for (int i = 0; i < sm.get_region_count(); ++i) plan(sm, sm.get_region_state(i));
+
+    // The rest of the old plan is released here (a waiting prefetch is dropped by the loader)
+    held.swap(next);
+
+    for (Held& entry : next)
+    {
+        update_pin(entry, false);
+        update_warm(entry, 0);
+    }
+
+    next.clear();
+
+    warm_ready();
+}
+
+
+void Asset_prefetcher::clear()
+{
+    for (Held& entry : held)
+    {
+        update_pin(entry, false);
+        update_warm(entry, 0);
+    }
+
+    held.clear();
+    next.clear();
+
+    seen_changes = ~std::uint64_t{0};
+    seen_state = nullptr;
+}
+
+
+void Asset_prefetcher::plan(const State_machine& sm, const State* focus)
+{
+    // The whole active path is entered - its ancestors need their assets too
+    for (const State* s = focus->parent; s; s = s->parent) hold(s, Load_priority::NORMAL);
+
+    for (const State* child : focus->children) hold(child, Load_priority::LOW);
+
+    if (focus->parent)
+    {
+        for (const State* sibling : focus->parent->children)
+            if (sibling != focus) hold(sibling, Load_priority::LOW);
+    }
+    else
+    {
+        // The siblings of a root are the other roots
+        for (const auto& s : sm.get_states())
+            if (!s->parent && s.get() != focus) hold(s.get(), Load_priority::LOW);
+    }
+}
+
+
+void Asset_prefetcher::hold(const State* state, Load_priority priority)
+{
+    if (!state->manifest) return;
+
+    const Asset_manifest& manifest = *state->manifest;
+
+    for (int i = 0; i < manifest.count; ++i)
+    {
+        const Manifest_asset& asset = manifest.assets[i];
+
+        const bool hot = asset.hot && priority == Load_priority::NORMAL;
+        const int voices = priority == Load_priority::NORMAL ? asset.voices : 0;
+
+        // Shared by several states - planned once, hot if any active one has it hot
+        if (Held* planned = find(next, asset))
+        {
+            if (hot) update_pin(*planned, true);
+            if (voices > planned->voices) update_warm(*planned, voices);
+            continue;
+        }
+
+        if (priority == Load_priority::LOW && static_cast<int>(next.size()) >= MAX_ASSETS) return;
+
+        // Already held - the same handle (loaded or on its way) and its pin
+        if (Held* old = find(held, asset))
+        {
+            next.push_back(std::move(*old));
+            next.back().asset = &asset;
+
+            old->asset = nullptr;
+            old->pinned = nullptr;
+            old->voices = 0;
+            old->warm = false;
+        }
+        else next.push_back({&asset, Asset_loader::Instance().load(asset.path, asset.type, asset.upload, priority)});
+
+        update_pin(next.back(), hot);
+        update_warm(next.back(), voices);
+    }
+}
+
+
+void Asset_prefetcher::update_pin(Held& entry, bool hot)
+{
+    Asset_pack& pack = Asset_pack::Instance();
+
+    if (!hot)
+    {
+        if (entry.pinned) pack.unpin(*entry.pinned);
+
+        entry.pinned = nullptr;
+        return;
+    }
+
+    if (entry.pinned || !pack.is_mounted()) return;
+
+    const std::string path = entry.asset->path;
+
+    // The image loads the variant of the policy - the pages of that one are read
+    const int variant = entry.asset->type == Asset_type::IMAGE ? Asset_manager::Instance().select_image_variant(path) : 1;
+
+    const Pack_entry* packed = pack.find(pack_variant_name(path, variant));
+
+    if (packed && pack.pin(*packed, lock_hot)) entry.pinned = packed;
+}
+
+
+void Asset_prefetcher::update_warm(Held& entry, int voices)
+{
+    if (voices == entry.voices) return;
+
+    Audio_mixer& mixer = Audio_mixer::Instance();
+
+    // Another count - reserved again by warm_ready() (a shared effect keeps the larger one)
+    if (entry.warm && entry.handle->is_ready()) mixer.release_voices(entry.handle->get_audio());
+
+    entry.voices = voices;
+    entry.warm = false;
+
+    if (voices > 0) warm_waiting = true;
+}
+
+
+void Asset_prefetcher::warm_ready()
+{
+    Audio_mixer& mixer = Audio_mixer::Instance();
+
+    warm_waiting = false;
+
+    for (Held& entry : held)
+    {
+        if (!entry.asset || entry.voices == 0 || entry.warm) continue;
+
+        // Failed or no audio device - nothing to warm, the plays log it
+        if ((entry.handle->is_finished() && !entry.handle->is_ready()) || !mixer.is_open())
+        {
+            entry.warm = true;
+            continue;
+        }
+
+        if (!entry.handle->is_ready())
+        {
+            warm_waiting = true;
+            continue;
+        }
+
+        PROFILE_ZONE("sfx_prewarm");
+
+        mixer.reserve_voices(entry.handle->get_audio(), entry.voices);
+
+        entry.warm = true;
+    }
+}
+
+
+int Asset_prefetcher::get_warm_count() const
+{
+    int count = 0;
+
+    for (const Held& entry : held)
+        if (entry.asset && entry.voices > 0 && entry.warm) ++count;
+
+    return count;
+}
+
+
+int Asset_prefetcher::get_pinned_count() const
+{
+    int count = 0;
+
+    for (const Held& entry : held)
+        if (entry.pinned) ++count;
+
+    return count;
+}
+
+
+void Asset_prefetcher::count_hits(const State* state)
+{
+    if (!state || !state->manifest) return;
+
+    const Asset_manifest& manifest = *state->manifest;
+
+    for (int i = 0; i < manifest.count; ++i)
+    {
+        const Held* entry = find(held, manifest.assets[i]);
+
+        if (entry && entry->handle->is_ready()) ++hits;
+        else ++misses;
+    }
+}
+
+
+Asset_prefetcher::Held* Asset_prefetcher::find(std::vector<Held>& list, const Manifest_asset& asset)
+{
+    for (Held& entry : list)
+    {
+        if (!entry.asset) continue;
+
+        if (entry.asset == &asset || (entry.asset->type == asset.type && std::strcmp(entry.asset->path, asset.path) == 0))
+            return &entry;
+    }
+
+    return nullptr;
+}
+
+// =========================================================================================== ASSET PREFETCH
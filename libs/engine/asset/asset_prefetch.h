@@ -0,0 +1,197 @@
+// asset_prefetch.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "asset_loader.h"
+
+class State;
+class State_machine;
+struct Pack_entry;
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== ASSET PREFETCH
+
+
+// One asset of a state manifest
+struct Manifest_asset
+{
+    const char* path;
+    Asset_type type;
+
+    // Own texture for the image or the font (false - the image goes to an atlas)
+    bool upload = true;
+
+    // Read from the pack during the gameplay (a deferred image, a sound, a music stream) -
+    // its pack pages are faulted in while the state is active (Asset_pack::pin())
+    bool hot = false;
+
+    // Sound effect to pre-warm: once it is loaded for an active state, its samples are made
+    // playable and this many mixer voices are kept for it (Audio_mixer::reserve_voices())
+    std::uint8_t voices = 0;
+};
+
+
+/**
+ * @brief Assets a state needs, a view of a static table - State::manifest points to it.
+ */
+struct Asset_manifest
+{
+    const Manifest_asset* assets = nullptr;
+    int count = 0;
+
+    constexpr Asset_manifest() = default;
+
+    template <std::size_t N>
+    constexpr Asset_manifest(const Manifest_asset (&list)[N]) : assets(list), count(static_cast<int>(N)) {}
+};
+
+
+/**
+ * @brief Keeps the assets of the active and of the likely next states loaded.
+ *
+ * The likely next states are the children and the siblings of the current state (and of
+ * the top overlay) in the State_ID hierarchy - the menus go to their submenus and to
+ * their neighbours, the level goes to its pause menu. On every change of the state machine
+ * their manifests are queued as LOW loads: the workers decode them between the normal
+ * loads, the loading screens don't wait for them. The manifests of the active path are
+ * normal loads.
+ *
+ * The prefetcher holds a handle of every planned asset, so they stay resident. The ones,
+ * which are no longer planned after a change, are released - a prefetch still waiting in
+ * the queue is dropped. A state entered after a prefetch finds its assets resident, and its
+ * own Asset_loader requests are ready at once (or take over the waiting prefetch).
+ *
+ * The hot assets of the active path have their pack pages pinned (Asset_pack::pin()) - advised
+ * with MADV_WILLNEED, or mlock-ed with set_lock_hot() - for as long as their state is active:
+ * the first draw or play of them in the gameplay doesn't wait for the SD card. A state left
+ * (or only prefetched) unpins them. The image pin is the variant the image loads.
+ *
+ * The sound effects with the manifest voices are pre-warmed the same way: as soon as the load
+ * of an active state's effect is ready, the mixer converts it and keeps its voices, so the
+ * first play_oneshot() in the gameplay is one command in the ring. Left - the voices go back.
+ *
+ * Usage:
+ * @code
+ * static constexpr Manifest_asset level_assets[] = {
+ *     {"assets/tiles.bmp", Asset_type::IMAGE},
+ *     {"assets/jump.wav", Asset_type::AUDIO, true, true},    // hot - played mid-level
+ *     {"assets/hit.wav", Asset_type::AUDIO, true, true, 2},  // pre-warmed, two voices kept
+ * };
+ * static constexpr Asset_manifest level_manifest = level_assets;
+ *
+ * state->manifest = &level_manifest;
+ *
+ * // The engine, every cycle after the transitions
+ * Asset_prefetcher::Instance().update(app_sm);
+ * @endcode
+ */
+class Asset_prefetcher
+{
+
+public:
+
+    // Assets held at the same time - the low ones past it aren't prefetched
+    static constexpr int MAX_ASSETS = 64;
+
+
+    // Returns the singleton instance.
+    static Asset_prefetcher& Instance();
+
+
+    // Plans the loads again, if the state machine changed since the last call (main thread)
+    void update(const State_machine& sm);
+
+    // Releases every held asset and the pins (shutdown, before the Asset_loader and the Asset_manager)
+    void clear();
+
+    // mlock the pages of the hot assets, else only prefault them (the default)
+    void set_lock_hot(bool lock) { lock_hot = lock; }
+
+
+    // === STATS ===
+
+    // Held assets - the active ones and the prefetches
+    int get_held_count() const { return static_cast<int>(held.size()); }
+
+    // Manifest assets of the entered states, which were ready at the entry / which weren't
+    std::uint64_t get_hit_count() const { return hits; }
+    std::uint64_t get_miss_count() const { return misses; }
+
+    // Hot assets with their pack pages pinned now
+    int get_pinned_count() const;
+
+    // Sound effects of the active states with their mixer voices kept now
+    int get_warm_count() const;
+
+    // === STATS ===
+
+
+private:
+
+    Asset_prefetcher() = default;
+
+    // Singleton - not copyable
+    Asset_prefetcher(const Asset_prefetcher&) = delete;
+    Asset_prefetcher& operator=(const Asset_prefetcher&) = delete;
+
+
+    struct Held
+    {
+        const Manifest_asset* asset;
+        Load_handle handle;
+
+        // Pack entry pinned for the hot asset of the active path
+        const Pack_entry* pinned = nullptr;
+
+        // Voices wanted for the effect of the active path, and whether the mixer keeps them
+        int voices = 0;
+        bool warm = false;
+    };
+
+    // Manifests of the state and of its ancestors (normal), of its children and siblings (low)
+    void plan(const State_machine& sm, const State* focus);
+
+    // Moves the held handle of the manifest assets into the plan, requests the missing ones
+    void hold(const State* state, Load_priority priority);
+
+    // Pins the pack pages of the entry (active and hot), else releases its pin
+    void update_pin(Held& entry, bool hot);
+
+    // Wants the voices for the effect (active), 0 - gives back the ones it keeps
+    void update_warm(Held& entry, int voices);
+
+    // Reserves the voices of the loaded effects, which want them - every cycle until none waits
+    void warm_ready();
+
+    // Counts the manifest assets of the entered state, which are ready already
+    void count_hits(const State* state);
+
+    // The held or the planned entry of the path, nullptr if there is none
+    static Held* find(std::vector<Held>& list, const Manifest_asset& asset);
+
+
+    // Handles of the current plan, and the next one built by update()
+    std::vector<Held> held;
+    std::vector<Held> next;
+
+    std::uint64_t seen_changes = ~std::uint64_t{0};
+    const State* seen_state = nullptr;
+
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+
+    bool lock_hot = false;
+
+    // An effect wants its voices, its load isn't ready yet
+    bool warm_waiting = false;
+};
+
+// =========================================================================================== ASSET PREFETCH
@@ -0,0 +1,177 @@
+// asset_stats.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "asset_stats.h"
+
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== ASSET STATS
+
+Asset_stats& Asset_stats::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Asset_stats instance;
+
+    return instance;
+}
+
+
+Asset_load_record& Asset_stats::record(const std::string& path, Asset_type type)
+{
+    Asset_load_record& r = records[path];
+
+    if (r.path.empty())
+    {
+        r.path = path;
+        r.type = type;
+    }
+
+    return r;
+}
+
+
+// === RECORDING ===
+
+void Asset_stats::record_io(const std::string& path, Asset_type type, double ms)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    Asset_load_record& r = record(path, type);
+
+    r.io_ms += ms;
+    ++r.loads;
+}
+
+
+void Asset_stats::record_decode(const std::string& path, Asset_type type, double ms, size_t decoded_bytes)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    Asset_load_record& r = record(path, type);
+
+    r.decode_ms += ms;
+    r.decoded_bytes = decoded_bytes;
+    r.resident_bytes = decoded_bytes;
+}
+
+
+void Asset_stats::record_upload(const std::string& path, Asset_type type, double ms, size_t resident_bytes)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    Asset_load_record& r = record(path, type);
+
+    r.upload_ms += ms;
+    r.resident_bytes = resident_bytes;
+}
+
+// === RECORDING ===
+
+
+std::vector<Asset_load_record> Asset_stats::get_records() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    std::vector<Asset_load_record> out;
+    out.reserve(records.size());
+
+    for (const auto& it : records) out.push_back(it.second);
+
+    return out;
+}
+
+
+Asset_load_record Asset_stats::get_record(const std::string& path) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    auto it = records.find(path);
+
+    return it != records.end() ? it->second : Asset_load_record{};
+}
+
+
+static const char* type_name(Asset_type type)
+{
+    switch (type)
+    {
+        case Asset_type::IMAGE: return "IMAGE";
+        case Asset_type::AUDIO: return "AUDIO";
+        case Asset_type::FONT:  return "FONT";
+        case Asset_type::VIDEO: return "VIDEO";
+        default:                return "UNKNOWN";
+    }
+}
+
+
+void Asset_stats::dump(std::ostream& out) const
+{
+    std::vector<Asset_load_record> all = get_records();
+
+    if (all.empty()) return;
+
+    // Most expensive first inside every type
+    std::sort(all.begin(), all.end(), [](const Asset_load_record& a, const Asset_load_record& b)
+    {
+        return a.get_total_ms() > b.get_total_ms();
+    });
+
+    const Asset_type types[] = {Asset_type::IMAGE, Asset_type::AUDIO, Asset_type::FONT, Asset_type::VIDEO, Asset_type::UNKNOWN};
+
+    out << "Asset loads (ms: io, decode, upload, total; KB: decoded, resident):\n";
+    out << std::fixed << std::setprecision(2);
+
+    for (Asset_type type : types)
+    {
+        double total_ms = 0.0;
+        size_t total_resident = 0;
+        int count = 0;
+
+        for (const Asset_load_record& r : all)
+        {
+            if (r.type != type) continue;
+
+            if (count == 0) out << "  " << type_name(type) << ":\n";
+
+            out << "    " << std::setw(8) << r.io_ms << std::setw(9) << r.decode_ms << std::setw(9) << r.upload_ms
+                << std::setw(9) << r.get_total_ms() << std::setw(9) << r.decoded_bytes / 1024
+                << std::setw(9) << r.resident_bytes / 1024 << "  " << r.path;
+
+            if (r.loads > 1) out << " (x" << r.loads << ")";
+
+            out << "\n";
+
+            total_ms += r.get_total_ms();
+            total_resident += r.resident_bytes;
+            ++count;
+        }
+
+        if (count > 0)
+            out << "    " << count << " assets, " << total_ms << " ms, " << total_resident / 1024 << " KB resident\n";
+    }
+
+    out.unsetf(std::ios::floatfield);
+}
+
+
+void Asset_stats::clear()
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    records.clear();
+}
+
+
+double Asset_stats::ms_since(Uint64 counter)
+{
+    return static_cast<double>(SDL_GetPerformanceCounter() - counter) * 1000.0 / static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+// =========================================================================================== ASSET STATS
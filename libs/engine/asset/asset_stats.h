@@ -0,0 +1,113 @@
+// asset_stats.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "asset.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== ASSET STATS
+
+
+// Load cost of one asset (the times are summed over its loads)
+struct Asset_load_record
+{
+    std::string path;
+    Asset_type type = Asset_type::UNKNOWN;
+
+    // Reading the bytes (file, pack), decoding them (BMP, WAV, format conversion), texture upload
+    double io_ms = 0.0;
+    double decode_ms = 0.0;
+    double upload_ms = 0.0;
+
+    // Decoded data size and the memory taken after the upload (RAM copy + texture)
+    size_t decoded_bytes = 0;
+    size_t resident_bytes = 0;
+
+    int loads = 0;
+
+    double get_total_ms() const { return io_ms + decode_ms + upload_ms; }
+};
+
+
+/**
+ * @brief Per-asset load time and memory instrumentation.
+ *
+ * The asset constructors record the I/O and decode times, the texture creation
+ * records the upload time - on the worker threads of the Asset_loader too, so
+ * the records are thread-safe. The report groups the assets by type, the most
+ * expensive first: the top of every group is what to recompress or preload.
+ *
+ * Singleton, like the Startup_trace.
+ *
+ * Usage:
+ * @code
+ * Asset_stats::Instance().dump(std::cout);     // at any time, and at the shutdown
+ * @endcode
+ */
+class Asset_stats
+{
+
+public:
+
+    // Returns the singleton instance.
+    static Asset_stats& Instance();
+
+
+    // === RECORDING ===
+
+    // Counts a new load of the path (the I/O time of it)
+    void record_io(const std::string& path, Asset_type type, double ms);
+
+    void record_decode(const std::string& path, Asset_type type, double ms, size_t decoded_bytes);
+
+    void record_upload(const std::string& path, Asset_type type, double ms, size_t resident_bytes);
+
+    // === RECORDING ===
+
+
+    // Copy of all records
+    std::vector<Asset_load_record> get_records() const;
+
+    // Record of the path (empty, if it was never loaded)
+    Asset_load_record get_record(const std::string& path) const;
+
+    // Prints the records by the asset type, the most expensive first
+    void dump(std::ostream& out) const;
+
+    void clear();
+
+
+    // Milliseconds since the SDL_GetPerformanceCounter() value
+    static double ms_since(Uint64 counter);
+
+
+private:
+
+    // Private constructor for singleton
+    Asset_stats() = default;
+
+    // Copying the singleton is not allowed
+    Asset_stats(const Asset_stats&) = delete;
+    Asset_stats& operator=(const Asset_stats&) = delete;
+
+
+    // Finds or creates the record (under the lock)
+    Asset_load_record& record(const std::string& path, Asset_type type);
+
+
+    mutable std::mutex lock;
+
+    std::unordered_map<std::string, Asset_load_record> records;
+};
+
+// =========================================================================================== ASSET STATS
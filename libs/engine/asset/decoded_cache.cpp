@@ -0,0 +1,391 @@
+// decoded_cache.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "decoded_cache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+
+#ifdef PLATFORM_LINUX
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== DECODED CACHE
+
+// Header: magic, version, entry count, reserved
+static constexpr size_t HEADER_SIZE = 16;
+
+
+Decoded_cache& Decoded_cache::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Decoded_cache instance;
+
+    return instance;
+}
+
+
+Decoded_cache::~Decoded_cache() { unmap(); }
+
+
+Uint64 Decoded_cache::hash(const void* data, size_t size, Uint64 seed)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+
+    Uint64 h = seed ^ size;
+
+    // FNV-1a over the 64-bit words - a byte at a time would cost as much as the decode it saves
+    for (; size >= 8; size -= 8, p += 8)
+    {
+        Uint64 word;
+        std::memcpy(&word, p, 8);
+
+        h = (h ^ word) * 0x100000001B3ull;
+        h ^= h >> 32;
+    }
+
+    for (; size > 0; --size, ++p) h = (h ^ *p) * 0x100000001B3ull;
+
+    return h;
+}
+
+
+bool Decoded_cache::open(const std::string& cache_path, size_t pending_limit_bytes)
+{
+    close();
+
+    path = cache_path;
+    pending_limit = pending_limit_bytes;
+    opened = true;
+
+#ifdef PLATFORM_LINUX
+    int fd = ::open(path.c_str(), O_RDONLY);
+
+    struct stat st;
+
+    if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        void* map = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (map != MAP_FAILED)
+        {
+            data = static_cast<const unsigned char*>(map);
+            data_size = static_cast<size_t>(st.st_size);
+            mapped = true;
+        }
+    }
+
+    // The mapping stays valid without the descriptor
+    if (fd >= 0) ::close(fd);
+#endif
+
+    // No mmap - the whole file in memory, still a single open and read
+    if (!data)
+    {
+        size_t size = 0;
+        void* file = SDL_LoadFile(path.c_str(), &size);
+
+        data = static_cast<const unsigned char*>(file);
+        data_size = size;
+    }
+
+    // The first launch - nothing cached yet
+    if (!data) return true;
+
+    Uint32 header[4] = {0, 0, 0, 0};
+
+    if (data_size >= HEADER_SIZE) std::memcpy(header, data, HEADER_SIZE);
+
+    if (header[0] != DECODED_CACHE_MAGIC || header[1] != DECODED_CACHE_VERSION)
+    {
+        SDL_Log("Decoded cache %s is of another version - rebuilt", path.c_str());
+        unmap();
+        return true;
+    }
+
+    const size_t count = header[2];
+
+    // In 64 bits - size_t is 32 on the device, a damaged count would wrap past the check
+    if (HEADER_SIZE + static_cast<std::uint64_t>(count) * sizeof(Entry) > data_size)
+    {
+        SDL_Log("Decoded cache %s index is truncated - rebuilt", path.c_str());
+        unmap();
+        return true;
+    }
+
+    entries.resize(count);
+
+    if (count) std::memcpy(entries.data(), data + HEADER_SIZE, count * sizeof(Entry));
+
+    // A torn write could point past the end - the whole file is dropped then
+    for (const Entry& e : entries)
+    {
+        if (static_cast<std::uint64_t>(e.offset) + e.size > data_size)
+        {
+            SDL_Log("Decoded cache %s is damaged - rebuilt", path.c_str());
+            unmap();
+            return true;
+        }
+    }
+
+    // The writer sorts the index - keep the search valid for any writer
+    auto key_less = [](const Entry& a, const Entry& b) { return a.key < b.key; };
+
+    if (!std::is_sorted(entries.begin(), entries.end(), key_less)) std::sort(entries.begin(), entries.end(), key_less);
+
+    return true;
+}
+
+
+void Decoded_cache::close()
+{
+    if (!opened) return;
+
+    if (!pending.empty() && write_file())
+        SDL_Log("Decoded cache %s written: %d new result(s)", path.c_str(), static_cast<int>(pending.size()));
+
+    unmap();
+
+    pending.clear();
+    pending.shrink_to_fit();
+    pending_bytes = 0;
+
+    opened = false;
+}
+
+
+void Decoded_cache::unmap()
+{
+#ifdef PLATFORM_LINUX
+    if (data && mapped) munmap(const_cast<unsigned char*>(data), data_size);
+#endif
+
+    if (data && !mapped) SDL_free(const_cast<unsigned char*>(data));
+
+    data = nullptr;
+    data_size = 0;
+    mapped = false;
+
+    entries.clear();
+}
+
+
+bool Decoded_cache::find(Uint64 key, Uint64 content_hash, Decoded_blob& out)
+{
+    if (!opened) return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // A result of this launch first - it replaces the one of the file
+    for (const Pending& p : pending)
+    {
+        if (p.entry.key != key || p.entry.content != content_hash) continue;
+
+        out.data = p.data.data();
+        out.size = p.entry.size;
+        std::copy(p.entry.params, p.entry.params + DECODED_PARAM_COUNT, out.params);
+        return true;
+    }
+
+    auto it = std::lower_bound(entries.begin(), entries.end(), key, [](const Entry& e, Uint64 k) { return e.key < k; });
+
+    if (it == entries.end() || it->key != key)
+    {
+        ++misses;
+        return false;
+    }
+
+    // The source changed since the result was made
+    if (it->content != content_hash)
+    {
+        ++stale;
+        return false;
+    }
+
+    out.data = data + it->offset;
+    out.size = it->size;
+    std::copy(it->params, it->params + DECODED_PARAM_COUNT, out.params);
+
+    ++hits;
+    hit_bytes += it->size;
+
+    return true;
+}
+
+
+void Decoded_cache::store(Uint64 key, Uint64 content_hash, const void* bytes, Uint32 size, const Uint32* params)
+{
+    if (!opened || !bytes) return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Two loads of one source raced - the first result stays
+    for (const Pending& p : pending)
+        if (p.entry.key == key && p.entry.content == content_hash) return;
+
+    if (pending_bytes + size > pending_limit)
+    {
+        ++dropped;
+        return;
+    }
+
+    Pending p;
+
+    p.entry.key = key;
+    p.entry.content = content_hash;
+    p.entry.size = size;
+
+    if (params) std::copy(params, params + DECODED_PARAM_COUNT, p.entry.params);
+
+    p.data.assign(static_cast<const unsigned char*>(bytes), static_cast<const unsigned char*>(bytes) + size);
+
+    pending_bytes += size;
+    pending.push_back(std::move(p));
+
+    ++stored;
+    stored_bytes += size;
+}
+
+
+bool Decoded_cache::write_file()
+{
+    // The file entries, which weren't made again, and the new results - in the key order
+    std::vector<Entry> index;
+    std::vector<const unsigned char*> blobs;
+
+    std::vector<Uint64> replaced;
+
+    for (const Pending& p : pending) replaced.push_back(p.entry.key);
+
+    std::sort(replaced.begin(), replaced.end());
+
+    for (const Entry& e : entries)
+    {
+        if (std::binary_search(replaced.begin(), replaced.end(), e.key)) continue;
+
+        index.push_back(e);
+        blobs.push_back(data + e.offset);
+    }
+
+    // A source changed during the launch has two results - the last one is written
+    for (size_t i = pending.size(); i-- > 0;)
+    {
+        const Pending& p = pending[i];
+
+        bool newer = false;
+
+        for (size_t k = i + 1; k < pending.size() && !newer; ++k) newer = pending[k].entry.key == p.entry.key;
+
+        if (newer) continue;
+
+        index.push_back(p.entry);
+        blobs.push_back(p.data.data());
+    }
+
+    std::vector<size_t> order(index.size());
+
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+
+    std::sort(order.begin(), order.end(), [&index](size_t a, size_t b) { return index[a].key < index[b].key; });
+
+    // Blobs follow the index, aligned for the mapped pixel rows
+    auto align = [](size_t v) { return (v + DECODED_ALIGNMENT - 1) / DECODED_ALIGNMENT * DECODED_ALIGNMENT; };
+
+    std::vector<Entry> sorted;
+    sorted.reserve(index.size());
+
+    size_t offset = align(HEADER_SIZE + index.size() * sizeof(Entry));
+
+    for (size_t i : order)
+    {
+        sorted.push_back(index[i]);
+        sorted.back().offset = static_cast<Uint32>(offset);
+
+        offset = align(offset + index[i].size);
+    }
+
+    // Written aside and renamed over - a crash in the middle leaves the old file, the mapping of it stays valid
+    const std::string temp_path = path + ".tmp";
+
+    SDL_RWops* out = SDL_RWFromFile(temp_path.c_str(), "wb");
+
+    if (!out)
+    {
+        SDL_Log("Decoded cache %s creation failed: %s", temp_path.c_str(), SDL_GetError());
+        return false;
+    }
+
+    const Uint32 header[4] = {DECODED_CACHE_MAGIC, DECODED_CACHE_VERSION, static_cast<Uint32>(sorted.size()), 0};
+
+    bool ok = SDL_RWwrite(out, header, HEADER_SIZE, 1) == 1;
+
+    if (!sorted.empty()) ok = ok && SDL_RWwrite(out, sorted.data(), sizeof(Entry), sorted.size()) == sorted.size();
+
+    static const unsigned char zeros[DECODED_ALIGNMENT] = {};
+
+    size_t position = HEADER_SIZE + sorted.size() * sizeof(Entry);
+
+    for (size_t k = 0; k < sorted.size() && ok; ++k)
+    {
+        const Entry& e = sorted[k];
+
+        if (e.offset > position) ok = SDL_RWwrite(out, zeros, e.offset - position, 1) == 1;
+
+        ok = ok && (e.size == 0 || SDL_RWwrite(out, blobs[order[k]], e.size, 1) == 1);
+
+        position = static_cast<size_t>(e.offset) + e.size;
+    }
+
+    ok = SDL_RWclose(out) == 0 && ok;
+
+    if (ok && std::rename(temp_path.c_str(), path.c_str()) != 0)
+    {
+        // Not over an existing file on every platform
+        std::remove(path.c_str());
+        ok = std::rename(temp_path.c_str(), path.c_str()) == 0;
+    }
+
+    if (!ok)
+    {
+        SDL_Log("Decoded cache %s writing failed", path.c_str());
+        std::remove(temp_path.c_str());
+        return false;
+    }
+
+    written_bytes = position;
+
+    return true;
+}
+
+
+void Decoded_cache::dump(std::ostream& out) const
+{
+    // Never opened
+    if (path.empty()) return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    out << "=== Decoded cache ===\n";
+
+    out << path << ": " << hits << " hit(s) (" << hit_bytes / 1024 << " KB mapped), " << misses << " miss(es), "
+        << stale << " stale, " << stored << " new (" << stored_bytes / 1024 << " KB)";
+
+    if (dropped) out << ", " << dropped << " over the pending limit";
+
+    if (written_bytes) out << ", " << written_bytes / 1024 << " KB written";
+
+    out << "\n";
+}
+
+// =========================================================================================== DECODED CACHE
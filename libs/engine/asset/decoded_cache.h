@@ -0,0 +1,197 @@
+// decoded_cache.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <iosfwd>
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== CACHE FORMAT
+
+// File layout (native byte order - the cache never leaves the device it was written on):
+//
+// [magic "MSQD"] [version] [entry count] [reserved]
+// [entry] * count - key, content hash, offset, size, params - sorted by the key
+// [data blobs] - every blob starts at a DECODED_ALIGNMENT boundary
+//
+// Bump DECODED_CACHE_VERSION with any change of what the generators produce (the pixel format,
+// the premultiplication) - a file of another version is ignored and rewritten at the close.
+
+constexpr Uint32 DECODED_CACHE_MAGIC = 0x4451534D;     // "MSQD"
+constexpr Uint32 DECODED_CACHE_VERSION = 1;
+constexpr Uint32 DECODED_ALIGNMENT = 16;
+constexpr int DECODED_PARAM_COUNT = 4;
+
+
+// Cached result of a generator, the data is read-only
+struct Decoded_blob
+{
+    const void* data = nullptr;
+    Uint32 size = 0;
+
+    // Meaning is up to the generator (an image: width, height, pitch, SDL_PixelFormatEnum)
+    Uint32 params[DECODED_PARAM_COUNT] = {0, 0, 0, 0};
+};
+
+// =========================================================================================== CACHE FORMAT
+
+
+// =========================================================================================== DECODED CACHE
+
+
+/**
+ * @brief On-disk cache of the data generated at the startup - mapped by the next launches.
+ *
+ * Not everything comes cooked: the loose image files are decoded, converted to ARGB8888 and
+ * premultiplied at every launch, the same work with the same result every time. The first
+ * launch stores the results here, the cache file is written at the close; the next launches
+ * map it (mmap, read into memory on the other platforms) and use the blobs in place -
+ * a surface over the mapped rows instead of the decode.
+ *
+ * An entry is found by its key (what it is - the hash of the generator and the source name)
+ * and validated by the content hash (what it was made from - the hash of the source bytes):
+ * a changed source misses and is stored again, the stale entry is replaced at the close.
+ * The version in the header guards the format of the results.
+ *
+ * The results of this launch are kept in memory until the close (up to the pending limit,
+ * the rest is only counted) - they are the blobs of their own later lookups (a Texture_budget
+ * reload) as well. The blobs are valid until the close: close only after the assets using
+ * them are destroyed (the engine clears the Asset_manager first).
+ *
+ * Singleton, like Asset_pack - the asset constructors have no context.
+ * find() and store() are thread-safe (the Asset_loader workers), open and close are main-thread only.
+ *
+ * Usage:
+ * @code
+ * const Uint64 key = Decoded_cache::hash(path.data(), path.size(), Decoded_cache::hash("image", 5));
+ * const Uint64 content = Decoded_cache::hash(bytes.data(), bytes.size());
+ *
+ * Decoded_blob blob;
+ *
+ * if (!Decoded_cache::Instance().find(key, content, blob))
+ *     Decoded_cache::Instance().store(key, content, pixels, size, params);
+ * @endcode
+ */
+class Decoded_cache
+{
+
+public:
+
+    // Returns the singleton instance.
+    static Decoded_cache& Instance();
+
+
+    /**
+     * @brief Maps the cache file - a missing or invalid one is an empty cache, written at the close.
+     *
+     * @param path          Cache file path.
+     * @param pending_bytes Limit of the results of this launch kept for the write.
+     * @return true if the cache is open (its file could be empty).
+     */
+    bool open(const std::string& path, size_t pending_bytes);
+
+    // Writes the file with the results of this launch, if any, and unmaps it
+    void close();
+
+    bool is_open() const { return opened; }
+
+
+    /**
+     * @brief Cached result of the key, if it was made from the same content.
+     *
+     * @param key          Hash of what the result is.
+     * @param content_hash Hash of what it was made from.
+     * @param out          Blob, valid until the close.
+     * @return false if there's none or it is stale - generate and store() it.
+     */
+    bool find(Uint64 key, Uint64 content_hash, Decoded_blob& out);
+
+    /**
+     * @brief Keeps a copy of the result for the write at the close.
+     *
+     * @param params DECODED_PARAM_COUNT values, nullptr - zeros.
+     */
+    void store(Uint64 key, Uint64 content_hash, const void* data, Uint32 size, const Uint32* params);
+
+
+    // 64-bit FNV-1a style hash of the bytes (by the words), chained by the seed
+    static Uint64 hash(const void* data, size_t size, Uint64 seed = 14695981039346656037ull);
+
+
+    // Prints the hits, the misses and the written bytes (after the close too)
+    void dump(std::ostream& out) const;
+
+
+private:
+
+    // Private constructor for singleton
+    Decoded_cache() = default;
+
+    // Unmaps the file, the results of the launch are lost
+    ~Decoded_cache();
+
+    // Copying the singleton is not allowed
+    Decoded_cache(const Decoded_cache&) = delete;
+    Decoded_cache& operator=(const Decoded_cache&) = delete;
+
+
+    struct Entry
+    {
+        Uint64 key = 0;
+        Uint64 content = 0;
+        Uint32 offset = 0;
+        Uint32 size = 0;
+        Uint32 params[DECODED_PARAM_COUNT] = {0, 0, 0, 0};
+    };
+
+    // Result of this launch - its bytes don't move, the lookups use them in place
+    struct Pending
+    {
+        Entry entry;
+        std::vector<unsigned char> data;
+    };
+
+    // Writes the mapped entries, which weren't replaced, and the pending ones
+    bool write_file();
+
+    // Unmaps the file and drops the index
+    void unmap();
+
+
+    std::string path;
+    bool opened = false;
+
+    // Mapped cache file (or its copy in memory)
+    const unsigned char* data = nullptr;
+    size_t data_size = 0;
+    bool mapped = false;
+
+    // Index of the file, sorted by the key
+    std::vector<Entry> entries;
+
+    std::vector<Pending> pending;
+    size_t pending_bytes = 0;
+    size_t pending_limit = 0;
+
+    // Guards the pending results and the stats
+    mutable std::mutex mutex;
+
+    int hits = 0;
+    int misses = 0;
+    int stale = 0;
+    int stored = 0;
+    int dropped = 0;
+    size_t hit_bytes = 0;
+    size_t stored_bytes = 0;
+    size_t written_bytes = 0;
+};
+
+// =========================================================================================== DECODED CACHE
@@ -0,0 +1,306 @@
+// font_asset.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "font_asset.h"
+#include "asset_pack.h"
+#include "../platform/backend.h"
+#include "../render_queue/render_queue.h"
+#include "../text/utf8.h"
+
+#include <algorithm>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== FONT ASSET
+
+// Codepoints decoded a step - the text is decoded in blocks, 4 bytes a step for the common runs
+static constexpr size_t DECODE_BLOCK = 64;
+
+
+Font_asset::Font_asset(const std::string& path) : Asset(Asset_type::FONT, path)
+{
+    load();
+}
+
+
+Font_asset::~Font_asset() = default;
+
+
+bool Font_asset::load()
+{
+    const Asset_pack& pack = Asset_pack::Instance();
+
+    // The pack first - the tables are over the mapped pages
+    if (const Pack_entry* entry = pack.is_mounted() ? pack.find(source_path) : nullptr)
+    {
+        if (!view.open(pack.get_data(*entry), entry->size))
+        {
+            SDL_Log("Packed font %s is not a valid font", source_path.c_str());
+            return false;
+        }
+    }
+    else
+    {
+        if (!Platform::Files::read_file(source_path.c_str(), buffer)) return false;
+
+        if (!view.open(buffer.data(), buffer.size()))
+        {
+            SDL_Log("Font %s is not a valid font (version %u expected)", source_path.c_str(), FONT_VERSION);
+            buffer.clear();
+            return false;
+        }
+    }
+
+    // Direct table of the common ranges - the lookup of the drawn text is an index
+    const Font_glyph* glyphs = view.get_glyphs();
+    const std::uint32_t count = std::min<std::uint32_t>(view.get_glyph_count(), NO_GLYPH);
+
+    direct.assign(DIRECT_RANGE, NO_GLYPH);
+
+    for (std::uint32_t i = 0; i < count; ++i)
+        if (glyphs[i].codepoint < DIRECT_RANGE) direct[glyphs[i].codepoint] = static_cast<std::uint16_t>(i);
+
+    fallback = direct['?'] != NO_GLYPH ? &glyphs[direct['?']] : nullptr;
+
+    image.reset(new Image_asset(view.get_image_name()));
+
+    if (!image->is_loaded())
+    {
+        SDL_Log("Font %s atlas %s is not loaded", source_path.c_str(), view.get_image_name());
+        return false;
+    }
+
+    return true;
+}
+
+
+bool Font_asset::is_loaded() const { return view.is_open() && image && image->is_loaded(); }
+
+
+size_t Font_asset::get_memory_bytes() const
+{
+    return buffer.capacity() + direct.capacity() * sizeof(std::uint16_t) + (image ? image->get_memory_bytes() : 0);
+}
+
+
+bool Font_asset::create_texture(SDL_Renderer* renderer) { return image && image->create_texture(renderer); }
+
+
+int Font_asset::get_line_height() const { return view.is_open() ? view.get_header().line_height : 0; }
+
+
+int Font_asset::get_baseline() const { return view.is_open() ? view.get_header().baseline : 0; }
+
+
+const Font_glyph* Font_asset::get_glyph(std::uint32_t codepoint) const
+{
+    if (!view.is_open()) return nullptr;
+
+    if (codepoint < DIRECT_RANGE)
+    {
+        const std::uint16_t index = direct[codepoint];
+        return index != NO_GLYPH ? &view.get_glyphs()[index] : fallback;
+    }
+
+    const Font_glyph* first = view.get_glyphs();
+    const Font_glyph* last = first + view.get_glyph_count();
+
+    const Font_glyph* it = std::lower_bound(first, last, codepoint,
+                                            [](const Font_glyph& g, std::uint32_t cp) { return g.codepoint < cp; });
+
+    return it != last && it->codepoint == codepoint ? it : fallback;
+}
+
+
+int Font_asset::get_kerning(std::uint32_t first, std::uint32_t second) const
+{
+    if (!view.is_open() || view.get_kerning_count() == 0) return 0;
+
+    const Font_kerning* begin = view.get_kerning();
+    const Font_kerning* end = begin + view.get_kerning_count();
+
+    const Font_kerning* it = std::lower_bound(begin, end, Font_kerning{first, second, 0},
+                                              [](const Font_kerning& a, const Font_kerning& b)
+                                              { return a.first != b.first ? a.first < b.first : a.second < b.second; });
+
+    return it != end && it->first == first && it->second == second ? it->amount : 0;
+}
+
+
+float Font_asset::measure(std::string_view text) const
+{
+    const char* p = text.data();
+    const char* end = p + text.size();
+
+    float width = 0.0f, line = 0.0f;
+    std::uint32_t previous = 0;
+
+    std::uint32_t block[DECODE_BLOCK];
+
+    while (p < end)
+    {
+        const size_t count = utf8::decode(p, end, block, DECODE_BLOCK);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const std::uint32_t cp = block[i];
+
+            if (cp == '\n')
+            {
+                width = std::max(width, line);
+                line = 0.0f;
+                previous = 0;
+                continue;
+            }
+
+            if (const Font_glyph* g = get_glyph(cp)) line += static_cast<float>(g->advance + get_kerning(previous, cp));
+
+            previous = cp;
+        }
+    }
+
+    return std::max(width, line);
+}
+
+
+void Font_asset::layout(std::string_view text, float scale, float wrap_width, Text_run& out) const
+{
+    out.vertices.clear();
+    out.texture = image ? image->get_texture() : nullptr;
+    out.width = 0.0f;
+    out.height = 0.0f;
+
+    if (!out.texture || text.empty()) return;
+
+    int tw = 0, th = 0;
+    SDL_QueryTexture(out.texture, nullptr, nullptr, &tw, &th);
+
+    // The image region inside its texture (atlas page)
+    const Rect2& region = image->get_texture_region();
+
+    const float su = 1.0f / static_cast<float>(tw);
+    const float sv = 1.0f / static_cast<float>(th);
+
+    const float line_height = static_cast<float>(get_line_height()) * scale;
+    const SDL_Color white = {255, 255, 255, 255};
+
+    const char* p = text.data();
+    const char* end = p + text.size();
+
+    float pen_x = 0.0f, pen_y = 0.0f;
+    std::uint32_t previous = 0;
+
+    // Last space of the line: the first vertex after it and the pen behind it
+    size_t break_vertex = 0;
+    float break_x = 0.0f;
+    bool can_break = false;
+
+    // A quad a byte at most - no growth inside the loop
+    out.vertices.reserve(text.size() * 4);
+
+    std::uint32_t block[DECODE_BLOCK];
+
+    while (p < end)
+    {
+        const size_t count = utf8::decode(p, end, block, DECODE_BLOCK);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const std::uint32_t cp = block[i];
+
+            if (cp == '\n')
+            {
+                pen_x = 0.0f;
+                pen_y += line_height;
+                previous = 0;
+                can_break = false;
+                continue;
+            }
+
+            const Font_glyph* g = get_glyph(cp);
+
+            if (!g) continue;
+
+            pen_x += static_cast<float>(get_kerning(previous, cp)) * scale;
+            previous = cp;
+
+            const float advance = static_cast<float>(g->advance) * scale;
+
+            // The word doesn't fit - it moves to the next line, behind the last space
+            if (wrap_width > 0.0f && can_break && cp != ' ' && pen_x + advance > wrap_width)
+            {
+                for (size_t v = break_vertex; v < out.vertices.size(); ++v)
+                {
+                    out.vertices[v].position.x -= break_x;
+                    out.vertices[v].position.y += line_height;
+                }
+
+                pen_x -= break_x;
+                pen_y += line_height;
+                can_break = false;
+            }
+
+            if (g->w > 0)
+            {
+                const float x0 = pen_x + g->offset_x * scale;
+                const float y0 = pen_y + g->offset_y * scale;
+                const float x1 = x0 + g->w * scale;
+                const float y1 = y0 + g->h * scale;
+
+                const float u0 = (region.top_left.x + g->x) * su;
+                const float v0 = (region.top_left.y + g->y) * sv;
+                const float u1 = u0 + g->w * su;
+                const float v1 = v0 + g->h * sv;
+
+                out.vertices.push_back({{x0, y0}, white, {u0, v0}});
+                out.vertices.push_back({{x1, y0}, white, {u1, v0}});
+                out.vertices.push_back({{x1, y1}, white, {u1, v1}});
+                out.vertices.push_back({{x0, y1}, white, {u0, v1}});
+            }
+
+            pen_x += advance;
+
+            if (cp == ' ')
+            {
+                break_vertex = out.vertices.size();
+                break_x = pen_x;
+                can_break = true;
+            }
+        }
+    }
+
+    for (const SDL_Vertex& v : out.vertices) out.width = std::max(out.width, v.position.x);
+
+    out.height = pen_y + line_height;
+}
+
+
+int Font_asset::draw(const Text_run& run, float x, float y, SDL_Color color, int layer) const
+{
+    const int quads = run.get_quad_count();
+
+    if (quads == 0 || !run.texture) return 0;
+
+    SDL_Vertex* v = Render_queue::Instance().append_quads(run.texture, quads, layer, SDL_BLENDMODE_BLEND);
+
+    if (!v) return 0;
+
+    // Only moved and colored - the layout is done
+    for (const SDL_Vertex& source : run.vertices)
+        *v++ = {{source.position.x + x, source.position.y + y}, color, source.tex_coord};
+
+    return quads;
+}
+
+
+int Font_asset::draw(std::string_view text, float x, float y, SDL_Color color, int layer) const
+{
+    layout(text, 1.0f, 0.0f, scratch);
+
+    return draw(scratch, x, y, color, layer);
+}
+
+// =========================================================================================== FONT ASSET
@@ -0,0 +1,156 @@
+// font_asset.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "asset.h"
+#include "../text/font_format.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== FONT ASSET
+
+
+// Laid out text: the quads from the top left at 0, 0 - moved and colored by the draw
+struct Text_run
+{
+    std::vector<SDL_Vertex> vertices;
+
+    // Texture the UVs were computed for (the atlas page at the layout)
+    SDL_Texture* texture = nullptr;
+
+    float width = 0.0f;
+    float height = 0.0f;
+
+    int get_quad_count() const { return static_cast<int>(vertices.size() / 4); }
+};
+
+
+/**
+ * @brief Bitmap font baked by miyoo_font_baker: the glyph metrics and the atlas image.
+ *
+ * The .fnt tables are used in place (mapped from the asset pack or one read of the file),
+ * the atlas is an ordinary Image_asset owned by the font - create its texture or add it
+ * to a Texture_atlas like any image. The glyph lookup is an array index for the codepoints
+ * below DIRECT_RANGE (Latin and Cyrillic), a binary search above it. A character without
+ * a glyph is drawn as '?'.
+ *
+ * layout() turns a string into a Text_run (the UTF-8 decoding, the metrics, the kerning
+ * and the line breaking), draw() records a run as one run of textured quads - one batch,
+ * whatever the length. The text, which doesn't change, is laid out once (Text_cache).
+ * Nothing is rasterized on the device.
+ *
+ * Usage:
+ * @code
+ * Font_asset* font = Asset_manager::Instance().acquire_font("fonts/ui.fnt");
+ * font->create_texture(renderer);
+ *
+ * font->draw(Lang_state::Instance().Get_string(STR_MENU_TITLE), 40.0f, 32.0f, white);
+ * @endcode
+ */
+class Font_asset : public Asset
+{
+
+public:
+
+    // Codepoints with the direct glyph lookup (Latin, Latin-1, Cyrillic)
+    static constexpr std::uint32_t DIRECT_RANGE = 0x500;
+
+
+    /**
+     * @brief Constructor - loads the metrics and the atlas image of the font.
+     *
+     * @param path Path to the .fnt file.
+     */
+    Font_asset(const std::string& path);
+
+    ~Font_asset() override;
+
+    // The .fnt tables and the pixels of the atlas image
+    size_t get_memory_bytes() const override;
+
+
+    // The metrics and the image are loaded
+    bool is_loaded() const;
+
+    // Atlas image of the glyphs, nullptr if the font isn't loaded
+    Image_asset* get_image() const { return image.get(); }
+
+    // Own texture of the atlas image, when it isn't packed into a Texture_atlas
+    bool create_texture(SDL_Renderer* renderer);
+
+
+    // === METRICS ===
+
+    int get_line_height() const;
+    int get_baseline() const;
+
+    // Glyph of the codepoint, the '?' one if missing, nullptr without both
+    const Font_glyph* get_glyph(std::uint32_t codepoint) const;
+
+    // Advance correction of the pair, 0 without the kerning
+    int get_kerning(std::uint32_t first, std::uint32_t second) const;
+
+    // Width of the widest line of the UTF-8 text in px
+    float measure(std::string_view text) const;
+
+    // === METRICS ===
+
+
+    /**
+     * @brief Lays out the UTF-8 text into the glyph quads.
+     *
+     * '\n' starts a new line, a line longer than the wrap width breaks after its last space.
+     *
+     * @param text       UTF-8 text.
+     * @param scale      Size of the glyphs, 1 - the baked size.
+     * @param wrap_width Line width limit in px, 0 - no wrap.
+     * @param out        Run from the top left at 0, 0.
+     */
+    void layout(std::string_view text, float scale, float wrap_width, Text_run& out) const;
+
+    /**
+     * @brief Records the laid out run into the Render_queue as one run of quads.
+     *
+     * @param run   Run of this font.
+     * @param x, y  Top left of the first line.
+     * @param color Color of the glyphs (the atlas is white).
+     * @param layer Draw order layer.
+     * @return Quads recorded.
+     */
+    int draw(const Text_run& run, float x, float y, SDL_Color color = {255, 255, 255, 255}, int layer = 0) const;
+
+    // Lays out and draws at once - for the text, which changes every frame
+    int draw(std::string_view text, float x, float y, SDL_Color color = {255, 255, 255, 255}, int layer = 0) const;
+
+
+private:
+
+    // The .fnt data, when it isn't mapped from the pack
+    std::vector<Uint8> buffer;
+
+    Font_view view;
+
+    std::unique_ptr<Image_asset> image;
+
+    // Codepoint -> glyph index below DIRECT_RANGE, NO_GLYPH - none
+    static constexpr std::uint16_t NO_GLYPH = 0xFFFF;
+    std::vector<std::uint16_t> direct;
+
+    const Font_glyph* fallback = nullptr;
+
+    // Layout of the immediate draw() - the capacity is kept
+    mutable Text_run scratch;
+
+    // Loads the tables from the pack or the file
+    bool load();
+};
+
+// =========================================================================================== FONT ASSET
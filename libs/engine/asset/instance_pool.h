@@ -0,0 +1,250 @@
+// instance_pool.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <vector>
+#include <memory>
+#include <new>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+
+#include "../memory/allocator.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== INSTANCE HANDLE
+
+
+/**
+ * @brief Generational reference to a pooled instance.
+ *
+ * The index selects the pool handle slot, the generation must match the slot's one.
+ * When the instance is destroyed (by the game or with its asset) the slot generation
+ * is bumped, so every outstanding handle resolves to nullptr instead of a dangling pointer.
+ * The handles don't depend on the instance addresses - the pool is free to relocate them.
+ *
+ * @tparam T Instance type - the handles of different types don't mix.
+ */
+template<typename T>
+struct Instance_handle
+{
+    static constexpr std::uint32_t NULL_INDEX = 0xFFFFFFFFu;
+
+    std::uint32_t index = NULL_INDEX;
+    std::uint32_t generation = 0;
+
+    bool is_null() const { return index == NULL_INDEX; }
+
+    bool operator==(const Instance_handle& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const Instance_handle& other) const { return !(*this == other); }
+};
+
+// =========================================================================================== INSTANCE HANDLE
+
+
+// =========================================================================================== INSTANCE POOL
+
+
+/**
+ * @brief Slab pool of the asset instances of one type.
+ *
+ * The instances live densely in the fixed-size slabs, the freed slots are reused
+ * through a free list - creating and destroying the short-lived instances (particles,
+ * sound effects) every frame doesn't touch the heap after the slabs are allocated.
+ * The slabs are never moved, so the instance pointers stay valid.
+ *
+ * Every pooled instance also owns a slot of the handle table - the long-lived
+ * references (game objects, sound channels) should keep an Instance_handle and
+ * resolve it per use, so an instance destroyed with its asset is detected.
+ *
+ * The pooled instances are created by the asset (Image_asset::create_instance()),
+ * one shared pool per instance type.
+ *
+ * @tparam T          Instance type.
+ * @tparam SLAB_SIZE  Instances per slab.
+ */
+template<typename T, size_t SLAB_SIZE = 64>
+class Instance_pool
+{
+
+public:
+
+    // Shared pool of the type
+    static Instance_pool& shared()
+    {
+        // Local static - lazy and thread-safe initialization, single instance
+        static Instance_pool pool;
+
+        return pool;
+    }
+
+
+    Instance_pool() = default;
+
+    // All instances must be destroyed before - only the memory is freed here
+    ~Instance_pool()
+    {
+        for (Slab* slab : slabs) allocator->deallocate(slab, sizeof(Slab), alignof(Slab));
+    }
+
+    Instance_pool(const Instance_pool&) = delete;
+    Instance_pool& operator=(const Instance_pool&) = delete;
+
+
+    // Constructs an instance in a free slot (a new slab, if there are none) and gives it a handle
+    template<typename... Args>
+    T* create(Args&&... args)
+    {
+        if (free_slots.empty()) add_slab();
+
+        void* slot = free_slots.back();
+        free_slots.pop_back();
+
+        ++live_count;
+
+        T* instance = new (slot) T(std::forward<Args>(args)...);
+
+        // Handle slot - reused ones keep their generation
+        std::uint32_t index;
+
+        if (!free_handles.empty())
+        {
+            index = free_handles.back();
+            free_handles.pop_back();
+        }
+        else
+        {
+            index = static_cast<std::uint32_t>(handles.size());
+            handles.push_back({nullptr, 0});
+        }
+
+        handles[index].instance = instance;
+
+        instance->handle_index = index;
+
+        return instance;
+    }
+
+    // Slabs and tables in the memory of the allocator - only before the first instance (false after)
+    bool set_allocator(Allocator& memory)
+    {
+        if (!slabs.empty() || !handles.empty()) return false;
+
+        allocator = &memory;
+
+        free_slots = std::vector<T*, Std_allocator<T*>>(Std_allocator<T*>(memory));
+        handles = std::vector<Handle_slot, Std_allocator<Handle_slot>>(Std_allocator<Handle_slot>(memory));
+        free_handles = std::vector<std::uint32_t, Std_allocator<std::uint32_t>>(Std_allocator<std::uint32_t>(memory));
+        slabs = std::vector<Slab*, Std_allocator<Slab*>>(Std_allocator<Slab*>(memory));
+
+        return true;
+    }
+
+
+    // Destroys the instance, invalidates its handles and returns its slot to the free list
+    void destroy(T* instance)
+    {
+        if (!instance) return;
+
+        std::uint32_t index = instance->handle_index;
+
+        if (index < handles.size() && handles[index].instance == instance)
+        {
+            handles[index].instance = nullptr;
+            ++handles[index].generation;
+
+            free_handles.push_back(index);
+        }
+
+        instance->~T();
+
+        free_slots.push_back(instance);
+        --live_count;
+    }
+
+
+    // Handle of a pooled instance (null for the instances constructed outside the pool)
+    Instance_handle<T> handle_of(const T* instance) const
+    {
+        Instance_handle<T> handle;
+
+        if (!instance) return handle;
+
+        std::uint32_t index = instance->handle_index;
+
+        if (index < handles.size() && handles[index].instance == instance)
+        {
+            handle.index = index;
+            handle.generation = handles[index].generation;
+        }
+
+        return handle;
+    }
+
+    // O(1) handle resolve, nullptr if the instance was destroyed
+    T* resolve(Instance_handle<T> handle) const
+    {
+        if (handle.index >= handles.size()) return nullptr;
+
+        const Handle_slot& slot = handles[handle.index];
+
+        return slot.generation == handle.generation ? slot.instance : nullptr;
+    }
+
+
+    // Calls fn(T*) for every live instance, in the handle table order
+    template<typename F>
+    void for_each(F fn)
+    {
+        for (Handle_slot& slot : handles)
+            if (slot.instance) fn(slot.instance);
+    }
+
+
+    size_t get_live_count() const { return live_count; }
+
+    size_t get_slab_count() const { return slabs.size(); }
+
+
+private:
+
+    struct Slab
+    {
+        alignas(T) unsigned char storage[sizeof(T) * SLAB_SIZE];
+    };
+
+    void add_slab()
+    {
+        slabs.push_back(static_cast<Slab*>(allocator->allocate(sizeof(Slab), alignof(Slab))));
+
+        T* base = reinterpret_cast<T*>(slabs.back()->storage);
+
+        // Reversed - the slots are taken in the memory order
+        for (size_t i = SLAB_SIZE; i-- > 0;) free_slots.push_back(base + i);
+    }
+
+
+    // Handle table - the instance of the slot and its current generation
+    struct Handle_slot
+    {
+        T* instance;
+        std::uint32_t generation;
+    };
+
+
+    Allocator* allocator = &heap_allocator();
+
+    std::vector<Slab*, Std_allocator<Slab*>> slabs;
+    std::vector<T*, Std_allocator<T*>> free_slots;
+
+    std::vector<Handle_slot, Std_allocator<Handle_slot>> handles;
+    std::vector<std::uint32_t, Std_allocator<std::uint32_t>> free_handles;
+
+    size_t live_count = 0;
+};
+
+// =========================================================================================== INSTANCE POOL
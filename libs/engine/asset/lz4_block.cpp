@@ -0,0 +1,207 @@
+// lz4_block.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "lz4_block.h"
+
+#include <cstring>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== LZ4 BLOCK
+
+// Format limits: the shortest match, the literals closing every block, the last match start
+static constexpr std::size_t MIN_MATCH = 4;
+static constexpr std::size_t LAST_LITERALS = 5;
+static constexpr std::size_t MATCH_FIND_LIMIT = 12;
+
+static constexpr std::size_t MAX_OFFSET = 65535;
+
+static constexpr int HASH_BITS = 12;
+
+
+static std::uint32_t load32(const std::uint8_t* p)
+{
+    std::uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+
+static std::uint32_t hash4(std::uint32_t sequence)
+{
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+
+// Length of the 4-bit field over 15 - the 255 bytes, then the rest
+static std::uint8_t* write_length(std::uint8_t* op, std::size_t length)
+{
+    for (; length >= 255; length -= 255) *op++ = 255;
+
+    *op++ = static_cast<std::uint8_t>(length);
+
+    return op;
+}
+
+
+static std::uint8_t* write_sequence(std::uint8_t* op, const std::uint8_t* literals, std::size_t literal_count,
+                                    std::size_t offset, std::size_t match_length)
+{
+    std::uint8_t* token = op++;
+
+    *token = static_cast<std::uint8_t>((literal_count < 15 ? literal_count : 15) << 4);
+
+    if (literal_count >= 15) op = write_length(op, literal_count - 15);
+
+    std::memcpy(op, literals, literal_count);
+    op += literal_count;
+
+    // The last sequence - literals only
+    if (match_length == 0) return op;
+
+    *op++ = static_cast<std::uint8_t>(offset);
+    *op++ = static_cast<std::uint8_t>(offset >> 8);
+
+    const std::size_t extra = match_length - MIN_MATCH;
+
+    *token |= static_cast<std::uint8_t>(extra < 15 ? extra : 15);
+
+    if (extra >= 15) op = write_length(op, extra - 15);
+
+    return op;
+}
+
+
+std::size_t lz4_compress(const std::uint8_t* src, std::size_t size, std::uint8_t* dst)
+{
+    std::uint8_t* op = dst;
+
+    std::size_t anchor = 0;
+
+    if (size > MATCH_FIND_LIMIT)
+    {
+        // Last position seen of every hash, +1 (0 - none)
+        std::uint32_t table[1 << HASH_BITS] = {};
+
+        const std::size_t match_limit = size - LAST_LITERALS;
+        const std::size_t find_limit = size - MATCH_FIND_LIMIT;
+
+        std::size_t ip = 0;
+
+        while (ip < find_limit)
+        {
+            const std::uint32_t sequence = load32(src + ip);
+            const std::uint32_t h = hash4(sequence);
+
+            const std::size_t candidate = table[h];
+            table[h] = static_cast<std::uint32_t>(ip + 1);
+
+            if (candidate == 0 || ip - (candidate - 1) > MAX_OFFSET || load32(src + candidate - 1) != sequence)
+            {
+                ++ip;
+                continue;
+            }
+
+            std::size_t ref = candidate - 1;
+            std::size_t length = MIN_MATCH;
+
+            while (ip + length < match_limit && src[ref + length] == src[ip + length]) ++length;
+
+            // Back over the literals, which match too
+            while (ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1])
+            {
+                --ip;
+                --ref;
+                ++length;
+            }
+
+            op = write_sequence(op, src + anchor, ip - anchor, ip - ref, length);
+
+            ip += length;
+            anchor = ip;
+
+            // The position before the next search - the runs of the repeated data are found sooner
+            if (ip - 2 < find_limit) table[hash4(load32(src + ip - 2))] = static_cast<std::uint32_t>(ip - 2 + 1);
+        }
+    }
+
+    op = write_sequence(op, src + anchor, size - anchor, 0, 0);
+
+    return static_cast<std::size_t>(op - dst);
+}
+
+
+// Length over the 4-bit field, false past the input
+static bool read_length(const std::uint8_t*& ip, const std::uint8_t* end, std::size_t& length)
+{
+    std::uint8_t b;
+
+    do
+    {
+        if (ip >= end) return false;
+
+        b = *ip++;
+        length += b;
+    }
+    while (b == 255);
+
+    return true;
+}
+
+
+bool lz4_decompress(const std::uint8_t* src, std::size_t size, std::uint8_t* dst, std::size_t raw_size)
+{
+    const std::uint8_t* ip = src;
+    const std::uint8_t* const in_end = src + size;
+
+    std::uint8_t* op = dst;
+    std::uint8_t* const out_end = dst + raw_size;
+
+    for (;;)
+    {
+        if (ip >= in_end) return false;
+
+        const unsigned token = *ip++;
+
+        std::size_t literal_count = token >> 4;
+
+        if (literal_count == 15 && !read_length(ip, in_end, literal_count)) return false;
+
+        if (literal_count > static_cast<std::size_t>(in_end - ip) || literal_count > static_cast<std::size_t>(out_end - op)) return false;
+
+        std::memcpy(op, ip, literal_count);
+        op += literal_count;
+        ip += literal_count;
+
+        // The last sequence ends the input
+        if (ip == in_end) return op == out_end;
+
+        if (in_end - ip < 2) return false;
+
+        const std::size_t offset = static_cast<std::size_t>(ip[0]) | static_cast<std::size_t>(ip[1]) << 8;
+        ip += 2;
+
+        if (offset == 0 || offset > static_cast<std::size_t>(op - dst)) return false;
+
+        std::size_t length = token & 15;
+
+        if (length == 15 && !read_length(ip, in_end, length)) return false;
+
+        length += MIN_MATCH;
+
+        if (length > static_cast<std::size_t>(out_end - op)) return false;
+
+        const std::uint8_t* match = op - offset;
+
+        // An overlapping match repeats its bytes - copied one by one
+        if (offset >= length) std::memcpy(op, match, length);
+        else for (std::size_t i = 0; i < length; ++i) op[i] = match[i];
+
+        op += length;
+    }
+}
+
+// =========================================================================================== LZ4 BLOCK
@@ -0,0 +1,53 @@
+// lz4_block.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstddef>
+#include <cstdint>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== LZ4 BLOCK
+
+/**
+ * LZ4 block codec of the compressed pack entries - the standard block format (a row of
+ * sequences: the token, the literals, the 16-bit match offset), no frame around it.
+ *
+ * The decoder is the fast part: byte copies and a few branches per sequence, several
+ * hundred MB/s on a Cortex-A7 - well above what an SD card reads, so a compressed blob
+ * is loaded faster than the same bytes stored. The input is checked, a damaged block
+ * fails instead of writing past the output.
+ *
+ * The encoder is the greedy one of the reference (a 4-byte hash table of the last
+ * positions), used by the host-side cooker - its speed doesn't matter on the device.
+ */
+
+
+// Largest output of lz4_compress() for the input size
+inline std::size_t lz4_compress_bound(std::size_t size) { return size + size / 255 + 16; }
+
+/**
+ * @brief Compresses one block.
+ *
+ * @param src      Input.
+ * @param size     Input bytes (up to 2 GB).
+ * @param dst      Output of lz4_compress_bound(size) bytes.
+ * @return Compressed bytes.
+ */
+std::size_t lz4_compress(const std::uint8_t* src, std::size_t size, std::uint8_t* dst);
+
+/**
+ * @brief Decompresses one block of a known size.
+ *
+ * @param src      Compressed block.
+ * @param size     Its bytes.
+ * @param dst      Output.
+ * @param raw_size Decompressed bytes - the block must fill the output exactly.
+ * @return false if the block is damaged (the output is partly written then).
+ */
+bool lz4_decompress(const std::uint8_t* src, std::size_t size, std::uint8_t* dst, std::size_t raw_size);
+
+// =========================================================================================== LZ4 BLOCK
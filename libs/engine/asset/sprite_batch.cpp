@@ -0,0 +1,286 @@
+// sprite_batch.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "sprite_batch.h"
+#include "transform_store.h"
+#include "../render_queue/render_queue.h"
+#include "../palette/theme_group.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== SPRITE BATCH
+
+// The vertex colors aren't modulated by the texture color mod - the group tint goes into them
+
+static SDL_Color themed(const Image_instance* sprite, SDL_Color mod)
+{
+    const Theme_group* group = sprite->get_theme_group();
+
+    if (!group) return mod;
+
+    const SDL_Color tint = group->get_tint();
+
+    return {static_cast<Uint8>((mod.r * tint.r + 127) / 255), static_cast<Uint8>((mod.g * tint.g + 127) / 255),
+            static_cast<Uint8>((mod.b * tint.b + 127) / 255), mod.a};
+}
+
+
+void Sprite_batch::set_view(const SDL_FRect& new_view) { view = new_view; }
+
+
+void Sprite_batch::add(const Image_instance* sprite, SDL_FPoint point, Image_anchor anchor, SDL_Color mod)
+{
+    if (!sprite) return;
+
+    SDL_Texture* texture = sprite->get_texture();
+
+    // Not uploaded yet, or an empty crop
+    if (!texture || sprite->get_current_width() == 0 || sprite->get_current_height() == 0) return;
+
+    entries.push_back({sprite, texture, point, static_cast<float>(sprite->current_width),
+                       static_cast<float>(sprite->current_height), sprite->rotation_sin, sprite->rotation_cos, anchor,
+                       themed(sprite, mod), sprite->source_edges});
+}
+
+
+void Sprite_batch::add_nine_slice(const Image_instance* sprite, const SDL_FRect& rect, SDL_Color mod)
+{
+    if (!sprite || rect.w <= 0.0f || rect.h <= 0.0f) return;
+
+    SDL_Texture* texture = sprite->get_texture();
+
+    if (!texture) return;
+
+    sprite->refresh_layout();
+
+    const Image_asset* asset = sprite->get_main_asset_link();
+    const Slice_insets& in = asset->get_slice_insets();
+    const Vec2 texel = asset->get_texel_scale();
+    const SDL_Rect& src = sprite->source_rect;
+
+    // Borders wider than the panel shrink together, the middle is empty then
+    const float kx = in.left + in.right > rect.w ? rect.w / (in.left + in.right) : 1.0f;
+    const float ky = in.top + in.bottom > rect.h ? rect.h / (in.top + in.bottom) : 1.0f;
+
+    // Column and row edges: the source in the texels (a resolution variant has its own), the target in pixels
+    const float sx[4] = {static_cast<float>(src.x), src.x + in.left * texel.x, src.x + src.w - in.right * texel.x,
+                         static_cast<float>(src.x + src.w)};
+    const float sy[4] = {static_cast<float>(src.y), src.y + in.top * texel.y, src.y + src.h - in.bottom * texel.y,
+                         static_cast<float>(src.y + src.h)};
+
+    const float dx[4] = {rect.x, rect.x + in.left * kx, rect.x + rect.w - in.right * kx, rect.x + rect.w};
+    const float dy[4] = {rect.y, rect.y + in.top * ky, rect.y + rect.h - in.bottom * ky, rect.y + rect.h};
+
+    entries.reserve(entries.size() + 9);
+
+    mod = themed(sprite, mod);
+
+    for (int row = 0; row < 3; ++row)
+        for (int col = 0; col < 3; ++col)
+        {
+            const float w = dx[col + 1] - dx[col];
+            const float h = dy[row + 1] - dy[row];
+
+            // No border on the side, or the squeezed middle
+            if (w <= 0.0f || h <= 0.0f) continue;
+
+            entries.push_back({sprite, texture, {dx[col], dy[row]}, w, h, 0.0f, 1.0f, Image_anchor::TOP_LEFT, mod,
+                               {{sx[col], sy[row]}, {sx[col + 1], sy[row + 1]}}});
+        }
+}
+
+
+void Sprite_batch::add(const Transform_store& store, Image_anchor anchor, SDL_Color mod)
+{
+    const int count = store.get_count();
+
+    const float* x = store.get_x();
+    const float* y = store.get_y();
+    const float* w = store.get_width();
+    const float* h = store.get_height();
+    const float* a = store.get_angle();
+
+    entries.reserve(entries.size() + count);
+
+    for (int i = 0; i < count; ++i)
+    {
+        const Image_instance* sprite = resolve(store.get_sprite(i));
+
+        if (!sprite || w[i] <= 0.0f || h[i] <= 0.0f) continue;
+
+        SDL_Texture* texture = sprite->get_texture();
+
+        if (!texture) continue;
+
+        // The source edges are read by the build - clean after refresh_dirty_layouts(), a no-op then
+        sprite->refresh_layout();
+
+        // The store angles are written directly - the unrotated and the right ones skip the trigonometry
+        float sin_a = 0.0f, cos_a = 1.0f;
+
+        sin_cos_deg(a[i], sin_a, cos_a);
+
+        entries.push_back({sprite, texture, {x[i], y[i]}, w[i], h[i], sin_a, cos_a, anchor, themed(sprite, mod),
+                           sprite->source_edges});
+    }
+}
+
+
+void Sprite_batch::build_bounds()
+{
+    bounds.clear();
+
+    for (const Entry& e : entries)
+    {
+        const Vec2 anchor = anchor_offset({e.width, e.height}, e.anchor);
+
+        if (e.sin_a == 0.0f && e.cos_a == 1.0f)
+        {
+            const float x0 = e.point.x - anchor.x;
+            const float y0 = e.point.y - anchor.y;
+
+            bounds.add(x0, y0, x0 + e.width, y0 + e.height);
+        }
+        else if (e.sin_a == 0.0f || e.cos_a == 0.0f)
+        {
+            // A right angle keeps the box axis-aligned - its opposite corners, turned about the pivot
+            const Affine2 turn = Affine2::rotation(e.cos_a, e.sin_a);
+
+            const Vec2 p0 = turn.apply_vector(-anchor);
+            const Vec2 p1 = turn.apply_vector(Vec2{e.width, e.height} - anchor);
+
+            bounds.add(e.point.x + std::min(p0.x, p1.x), e.point.y + std::min(p0.y, p1.y),
+                       e.point.x + std::max(p0.x, p1.x), e.point.y + std::max(p0.y, p1.y));
+        }
+        else
+        {
+            // Any rotation stays inside the circle of the farthest corner around the pivot
+            const float dx = std::max(anchor.x, e.width - anchor.x);
+            const float dy = std::max(anchor.y, e.height - anchor.y);
+            const float r = std::sqrt(dx * dx + dy * dy);
+
+            bounds.add(e.point.x - r, e.point.y - r, e.point.x + r, e.point.y + r);
+        }
+    }
+}
+
+
+void Sprite_batch::quad_geometry(const Entry& e, Vec2* corners, Affine2& transform)
+{
+    const float w = e.width;
+    const float h = e.height;
+
+    // Corners relative to the anchor in the local space
+    const Vec2 anchor = anchor_offset({w, h}, e.anchor);
+
+    corners[0] = -anchor;
+    corners[1] = Vec2{w, 0.0f} - anchor;
+    corners[2] = Vec2{w, h} - anchor;
+    corners[3] = Vec2{0.0f, h} - anchor;
+
+    // Rotated about the anchor, clockwise in the screen space (y down), like SDL_RenderCopyEx
+    const Vec2 point = to_vec2(e.point);
+
+    transform = Affine2::rotation(e.cos_a, e.sin_a).translated(point);
+}
+
+
+void Sprite_batch::build_quad(const Entry& e, int tex_w, int tex_h, const Vec2* corners, SDL_Vertex* out) const
+{
+    // Crop edges with the flips, cached by the instance - only the region origin is added
+    const Vec2 origin = e.sprite->get_main_asset_link()->get_texture_region().top_left;
+
+    const float u0 = (origin.x + e.source.top_left.x) / tex_w;
+    const float v0 = (origin.y + e.source.top_left.y) / tex_h;
+    const float u1 = (origin.x + e.source.bottom_right.x) / tex_w;
+    const float v1 = (origin.y + e.source.bottom_right.y) / tex_h;
+
+    const float u[4] = {u0, u1, u1, u0};
+    const float v[4] = {v0, v0, v1, v1};
+
+    for (int i = 0; i < 4; ++i) out[i] = {to_point(corners[i]), e.mod, {u[i], v[i]}};
+}
+
+
+int Sprite_batch::submit(int layer)
+{
+    if (entries.empty()) return 0;
+
+    // The whole batch against the view at once - the culled sprites are never sorted or built
+    build_bounds();
+
+    View_culler& culler = View_culler::Instance();
+
+    const int count = culler.cull(bounds, view.w > 0.0f && view.h > 0.0f ? view : culler.get_view(), visible);
+
+    order.clear();
+
+    for (int i = 0; i < static_cast<int>(entries.size()); ++i)
+        if (visible[i]) order.push_back(i);
+
+    // Group by the texture, stable - the draw order inside one texture is kept
+
+    std::stable_sort(order.begin(), order.end(), [this](int a, int b)
+    {
+        return std::less<SDL_Texture*>()(entries[a].texture, entries[b].texture);
+    });
+
+    Render_queue& queue = Render_queue::Instance();
+
+    int recorded = 0;
+
+    for (int run_start = 0; run_start < count;)
+    {
+        SDL_Texture* texture = entries[order[run_start]].texture;
+
+        int run_end = run_start;
+        while (run_end < count && entries[order[run_end]].texture == texture) ++run_end;
+
+        int tex_w = 0, tex_h = 0;
+
+        if (SDL_QueryTexture(texture, nullptr, nullptr, &tex_w, &tex_h) == 0 && tex_w > 0 && tex_h > 0)
+        {
+            const int run = run_end - run_start;
+
+            quads.resize(static_cast<size_t>(run) * 4);
+            corners.resize(static_cast<size_t>(run) * 4);
+            transforms.resize(static_cast<size_t>(run));
+
+            for (int i = 0; i < run; ++i) quad_geometry(entries[order[run_start + i]], corners.data() + i * 4, transforms[i]);
+
+            // Every corner of the run to the render target in one batch
+            transform_quads(transforms.data(), corners.data(), corners.data(), run);
+
+            for (int i = 0; i < run; ++i)
+                build_quad(entries[order[run_start + i]], tex_w, tex_h, corners.data() + i * 4, quads.data() + i * 4);
+
+            // One command for the whole run - one geometry call for the texture
+            SDL_Vertex* out = queue.append_quads(texture, run, layer);
+
+            if (out) std::memcpy(out, quads.data(), sizeof(SDL_Vertex) * run * 4);
+
+            recorded += run;
+        }
+
+        run_start = run_end;
+    }
+
+    entries.clear();
+
+    return recorded;
+}
+
+
+void Sprite_batch::clear() { entries.clear(); }
+
+
+int Sprite_batch::get_sprite_count() const { return static_cast<int>(entries.size()); }
+
+// =========================================================================================== SPRITE BATCH
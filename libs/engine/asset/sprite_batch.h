@@ -0,0 +1,164 @@
+// sprite_batch.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <vector>
+
+#include "asset_instance.h"
+#include "../culling/view_culler.h"
+
+// =========================================================================================== IMPORT
+
+
+class Transform_store;
+
+
+// =========================================================================================== SPRITE BATCH
+
+
+/**
+ * @brief Collects the Image_instance draws of a frame and records them as textured quads.
+ *
+ * SDL_RenderCopyEx per sprite is a driver call per sprite. The batch keeps the draws,
+ * and submit() culls the invisible ones, computes the scaled, flipped and rotated quads
+ * in one loop and records every run of the same texture as one Render_queue command -
+ * one SDL_RenderGeometry call per texture (per atlas page) and layer. The corners of a
+ * run go through their Affine2 transforms in one SIMD batch (transform_quads()).
+ *
+ * The culling is one batched View_culler test over the bounds of all of the sprites
+ * (from their anchor points, a circle around the pivot for the rotated ones, the exact
+ * box for a right angle), before any sorting or quad building - the sprites off the
+ * view cost a few compares.
+ *
+ * No trigonometry per draw: an instance caches the sine and the cosine of its angle, and
+ * the right angles - the common sprite turns - are exact 0 and +-1 (the flips are the
+ * texture coordinates, they never rotate anything).
+ *
+ * The instances are only referenced - they must live until submit().
+ *
+ * Usage (inside a state render):
+ * @code
+ * batch.set_view({0.0f, 0.0f, 640.0f, 480.0f});
+ *
+ * for (Enemy& e : enemies) batch.add(e.sprite, e.position);
+ *
+ * batch.submit(1);    // layer 1 of the Render_queue
+ * @endcode
+ */
+class Sprite_batch
+{
+
+public:
+
+    /**
+     * @brief Culling bounds - the sprites entirely outside are skipped.
+     *
+     * @param view Visible area in the render target pixels, zero size - the View_culler view.
+     */
+    void set_view(const SDL_FRect& view);
+
+    /**
+     * @brief Queues an instance draw.
+     *
+     * @param sprite Instance with the crop, scale, flips and angle.
+     * @param point  Drawing point in the render target pixels.
+     * @param anchor Anchor of the sprite at the point, also the rotation pivot.
+     * @param mod    Color and alpha modulation (times the Theme_group tint of the instance).
+     */
+    void add(const Image_instance* sprite, SDL_FPoint point, Image_anchor anchor = Image_anchor::CENTER_CENTER,
+             SDL_Color mod = {255, 255, 255, 255});
+
+    /**
+     * @brief Queues every sprite of the transform store.
+     *
+     * The positions, sizes and angles are read from the store arrays,
+     * the texture, crop and flips - from the instances.
+     * The sprites of the destroyed instances are skipped.
+     */
+    void add(const Transform_store& store, Image_anchor anchor = Image_anchor::CENTER_CENTER,
+             SDL_Color mod = {255, 255, 255, 255});
+
+    /**
+     * @brief Queues a nine-slice panel of the instance image - nine quads in the batch.
+     *
+     * The crop of the instance is the whole panel, the insets are the ones of its image
+     * (Image_asset::get_slice_insets(), no insets - one stretched quad). The corners are drawn
+     * at their logical size, the edges stretch along, the middle both ways; a panel smaller
+     * than its borders shrinks them together. The quads share the texture of the other sprites
+     * of the image (the atlas page) - a panel adds no command of its own, every panel of the
+     * frame is a part of the one geometry call of the texture. The flips, the scale and the
+     * angle of the instance are not used.
+     *
+     * @param sprite Instance of the panel image.
+     * @param rect   Panel in the render target pixels.
+     * @param mod    Color and alpha modulation.
+     */
+    void add_nine_slice(const Image_instance* sprite, const SDL_FRect& rect, SDL_Color mod = {255, 255, 255, 255});
+
+    /**
+     * @brief Records the visible sprites into the Render_queue and clears the batch.
+     *
+     * The order of the sprites with the same texture is kept, the textures are grouped.
+     *
+     * @param layer Render_queue layer of the sprites.
+     * @return Number of the recorded (visible) sprites.
+     */
+    int submit(int layer = 0);
+
+    // Drops the queued draws
+    void clear();
+
+
+    // Number of the queued draws
+    int get_sprite_count() const;
+
+
+private:
+
+    struct Entry
+    {
+        const Image_instance* sprite;
+        SDL_Texture* texture;
+        SDL_FPoint point;
+        float width;
+        float height;
+
+        // Rotation - cached by the instance, exact for the right angles (sin_cos_deg())
+        float sin_a;
+        float cos_a;
+
+        Image_anchor anchor;
+        SDL_Color mod;
+
+        // Crop edges in the image texels with the flips - the instance ones, or a slice of them
+        Rect2 source;
+    };
+
+    // Local corners of the sprite around its anchor and the transform to the render target
+    static void quad_geometry(const Entry& e, Vec2* corners, Affine2& transform);
+
+    // Writes the 4 vertices of the sprite at the transformed corners
+    void build_quad(const Entry& e, int tex_w, int tex_h, const Vec2* corners, SDL_Vertex* out) const;
+
+    // Bounds of every entry for the batched culling
+    void build_bounds();
+
+
+    std::vector<Entry> entries;
+
+    // Texture grouping order and the quads of one run - kept for the capacity
+    std::vector<int> order;
+    std::vector<SDL_Vertex> quads;
+    std::vector<Vec2> corners;
+    std::vector<Affine2> transforms;
+
+    // Culling input and result - kept for the capacity too
+    Cull_bounds bounds;
+    std::vector<std::uint8_t> visible;
+
+    SDL_FRect view = {0.0f, 0.0f, 0.0f, 0.0f};
+};
+
+// =========================================================================================== SPRITE BATCH
@@ -0,0 +1,472 @@
+// streaming_audio.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "streaming_audio.h"
+#include "asset_instance.h"
+#include "asset_pack.h"
+#include "../audio/audio_mixer.h"
+#include "../thread_roles/thread_roles.h"
+
+#include <algorithm>
+#include <cstring>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== STREAMING AUDIO
+
+// Decoder poll period, while the ring is full or the stream is idle (the ring holds ~370 ms)
+static constexpr Uint32 DECODER_IDLE_MS = 5;
+
+
+Streaming_audio::Streaming_audio(const std::string& path, int output_rate) :
+
+    Audio_asset(path, true),
+
+    source(nullptr),
+
+    data_offset(0),
+    data_size(0),
+
+    source_rate(0),
+    source_format(AUDIO_S16LSB),
+    source_frame_bytes(0),
+
+    frame_count(0),
+
+    converter(nullptr),
+    decoder(nullptr),
+
+    running(false),
+
+    generation(0),
+    start_position(0),
+    loop_start(0),
+    loop_end(0),
+    looping(false),
+
+    remaining_bytes(0),
+    source_ended(true),
+    flushed(false),
+
+    current{},
+    current_offset(0),
+    has_current(false),
+
+    underruns(0)
+
+{
+    if (output_rate <= 0)
+    {
+        const Audio_mixer& mixer = Audio_mixer::Instance();
+
+        output_rate = mixer.is_open() ? mixer.get_sample_rate() : 44100;
+    }
+
+    if (!open_source()) return;
+
+    // Output - S16 of the source channels at the output rate, what the mixer plays in place
+    converter = SDL_NewAudioStream(source_format, static_cast<Uint8>(channels), static_cast<int>(source_rate),
+                                   AUDIO_S16SYS, static_cast<Uint8>(channels), output_rate);
+
+    if (!converter)
+    {
+        SDL_Log("Streaming audio %s: no converter: %s", source_path.c_str(), SDL_GetError());
+        return;
+    }
+
+    initial_sample_rate = static_cast<unsigned int>(output_rate);
+    format = AUDIO_S16SYS;
+    initial_bitrate = initial_sample_rate * channels * SDL_AUDIO_BITSIZE(format);
+
+    frame_count = data_size / source_frame_bytes * initial_sample_rate / source_rate;
+    initial_audio_length = samples_to_time(frame_count, initial_sample_rate);
+
+    raw.resize(static_cast<size_t>(CHUNK_FRAMES) * source_frame_bytes);
+
+    running.store(true);
+
+    decoder = SDL_CreateThread(decoder_main, "audio_stream", this);
+
+    if (!decoder)
+    {
+        SDL_Log("Streaming audio %s: decoder thread creation failed: %s", source_path.c_str(), SDL_GetError());
+        running.store(false);
+    }
+}
+
+
+Streaming_audio::~Streaming_audio()
+{
+    // The callback doesn't read the ring anymore, when the voice is stopped
+    Audio_mixer::Instance().stop_asset(this);
+
+    running.store(false);
+
+    if (decoder) SDL_WaitThread(decoder, nullptr);
+    if (converter) SDL_FreeAudioStream(converter);
+    if (source) SDL_RWclose(source);
+}
+
+
+bool Streaming_audio::is_open() const { return decoder != nullptr; }
+
+
+size_t Streaming_audio::get_memory_bytes() const { return sizeof(chunks) + raw.capacity(); }
+
+
+unsigned int Streaming_audio::get_source_rate() const { return source_rate; }
+
+
+SDL_AudioFormat Streaming_audio::get_source_format() const { return source_format; }
+
+
+uint64_t Streaming_audio::get_frame_count() const { return frame_count; }
+
+
+int Streaming_audio::get_underrun_count() const { return underruns.load(std::memory_order_relaxed); }
+
+
+// === SOURCE ===
+
+bool Streaming_audio::open_source()
+{
+    Asset_pack& pack = Asset_pack::Instance();
+
+    const Pack_entry* entry = pack.find(source_path);
+
+    source = entry ? pack.open(source_path) : SDL_RWFromFile(source_path.c_str(), "rb");
+
+    if (!source)
+    {
+        SDL_Log("Streaming audio %s opening failed: %s", source_path.c_str(), SDL_GetError());
+        return false;
+    }
+
+    // Cooked pack audio - headerless PCM, described by the entry
+    if (entry && entry->type == Asset_type::AUDIO)
+    {
+        source_rate = entry->params[0];
+        channels = entry->params[1];
+        source_format = static_cast<SDL_AudioFormat>(entry->params[2]);
+        data_offset = 0;
+        data_size = pack_data_size(*entry);
+    }
+    else
+    {
+        Uint8 riff[12];
+
+        if (SDL_RWread(source, riff, 1, sizeof(riff)) != sizeof(riff) ||
+            std::memcmp(riff, "RIFF", 4) != 0 || std::memcmp(riff + 8, "WAVE", 4) != 0)
+        {
+            SDL_Log("Streaming audio %s is not a WAV file", source_path.c_str());
+            return false;
+        }
+
+        Uint16 tag = 0;
+        Uint16 bits = 0;
+        bool has_format = false;
+
+        // Chunks up to the data - the fmt chunk is before it
+        for (;;)
+        {
+            Uint8 header[8];
+
+            if (SDL_RWread(source, header, 1, sizeof(header)) != sizeof(header))
+            {
+                SDL_Log("Streaming audio %s has no data chunk", source_path.c_str());
+                return false;
+            }
+
+            const Uint32 size = SDL_SwapLE32(*reinterpret_cast<const Uint32*>(header + 4));
+            const Sint64 next = SDL_RWtell(source) + size + (size & 1);
+
+            if (std::memcmp(header, "fmt ", 4) == 0 && size >= 16)
+            {
+                Uint8 fmt[40] = {};
+
+                SDL_RWread(source, fmt, 1, std::min<size_t>(size, sizeof(fmt)));
+
+                tag = static_cast<Uint16>(fmt[0] | fmt[1] << 8);
+                channels = static_cast<unsigned int>(fmt[2] | fmt[3] << 8);
+                source_rate = SDL_SwapLE32(*reinterpret_cast<const Uint32*>(fmt + 4));
+                bits = static_cast<Uint16>(fmt[14] | fmt[15] << 8);
+
+                // WAVE_FORMAT_EXTENSIBLE - the tag is the start of the subformat GUID
+                if (tag == 0xFFFE && size >= 40) tag = static_cast<Uint16>(fmt[24] | fmt[25] << 8);
+
+                has_format = true;
+            }
+            else if (std::memcmp(header, "data", 4) == 0 && has_format)
+            {
+                data_offset = SDL_RWtell(source);
+                data_size = size;
+                break;
+            }
+
+            SDL_RWseek(source, next, RW_SEEK_SET);
+        }
+
+        if (tag == 1 && bits == 8) source_format = AUDIO_U8;
+        else if (tag == 1 && bits == 16) source_format = AUDIO_S16LSB;
+        else if (tag == 1 && bits == 32) source_format = AUDIO_S32LSB;
+        else if (tag == 3 && bits == 32) source_format = AUDIO_F32LSB;
+        else
+        {
+            SDL_Log("Streaming audio %s: WAV format %u, %u bit is not streamable (PCM only)", source_path.c_str(), tag, bits);
+            return false;
+        }
+    }
+
+    if (channels < 1 || channels > 2 || source_rate == 0)
+    {
+        SDL_Log("Streaming audio %s: %u channels at %u Hz are not playable", source_path.c_str(), channels, source_rate);
+        return false;
+    }
+
+    source_frame_bytes = SDL_AUDIO_BITSIZE(source_format) / 8 * channels;
+
+    // Only the whole frames (a truncated file)
+    const Sint64 end = SDL_RWsize(source);
+
+    if (end > data_offset) data_size = std::min<uint64_t>(data_size, static_cast<uint64_t>(end - data_offset));
+
+    data_size -= data_size % source_frame_bytes;
+
+    return true;
+}
+
+
+void Streaming_audio::seek_source(uint64_t frame)
+{
+    const uint64_t source_frames = data_size / source_frame_bytes;
+
+    // Output frame to the source one - a plain byte offset, no decoding up to it
+    const uint64_t source_frame = std::min(frame * source_rate / initial_sample_rate, source_frames);
+
+    SDL_RWseek(source, data_offset + static_cast<Sint64>(source_frame * source_frame_bytes), RW_SEEK_SET);
+    SDL_AudioStreamClear(converter);
+
+    remaining_bytes = (source_frames - source_frame) * source_frame_bytes;
+    source_ended = false;
+    flushed = false;
+}
+
+// === SOURCE ===
+
+
+// === DECODER THREAD ===
+
+int SDLCALL Streaming_audio::decoder_main(void* userdata)
+{
+    Thread_roles::Instance().apply(Thread_role::WORKER);
+
+    static_cast<Streaming_audio*>(userdata)->decode();
+
+    return 0;
+}
+
+
+void Streaming_audio::decode()
+{
+    const int frame_bytes = static_cast<int>(channels * sizeof(Sint16));
+
+    uint32_t active = 0;
+
+    uint64_t produced = 0;
+    uint64_t range_start = 0;
+    uint64_t range_end = 0;
+    bool loop = false;
+
+    // Idle until the first restart
+    bool done = true;
+
+    // Chunk, which didn't fit the full ring
+    Chunk chunk{};
+    bool pending = false;
+
+    while (running.load(std::memory_order_acquire))
+    {
+        const uint32_t wanted = generation.load(std::memory_order_acquire);
+
+        if (wanted != active)
+        {
+            active = wanted;
+
+            produced = start_position.load(std::memory_order_relaxed);
+            range_start = loop_start.load(std::memory_order_relaxed);
+            range_end = loop_end.load(std::memory_order_relaxed);
+            loop = looping.load(std::memory_order_relaxed);
+
+            seek_source(produced);
+
+            pending = false;
+            done = false;
+        }
+
+        if (pending)
+        {
+            if (!chunks.push(chunk))
+            {
+                SDL_Delay(DECODER_IDLE_MS);
+                continue;
+            }
+
+            pending = false;
+
+            if (chunk.last) done = true;
+
+            continue;
+        }
+
+        if (done)
+        {
+            SDL_Delay(DECODER_IDLE_MS);
+            continue;
+        }
+
+        const int available = SDL_AudioStreamAvailable(converter) / frame_bytes;
+
+        // End of the range or of the data - over again, or the last (empty) chunk
+        if (produced >= range_end || (flushed && available == 0))
+        {
+            if (loop && range_end > range_start)
+            {
+                seek_source(range_start);
+                produced = range_start;
+            }
+            else
+            {
+                chunk.generation = active;
+                chunk.frames = 0;
+                chunk.last = true;
+                pending = true;
+            }
+
+            continue;
+        }
+
+        // A whole chunk, the tail of the data or the rest of the range
+        if (available >= CHUNK_FRAMES || (flushed && available > 0) ||
+            (available > 0 && produced + static_cast<uint64_t>(available) >= range_end))
+        {
+            const int n = static_cast<int>(std::min<uint64_t>(std::min(available, CHUNK_FRAMES), range_end - produced));
+
+            const int got = SDL_AudioStreamGet(converter, chunk.data, n * frame_bytes);
+
+            if (got < 0)
+            {
+                SDL_Log("Streaming audio %s conversion failed: %s", source_path.c_str(), SDL_GetError());
+
+                chunk.frames = 0;
+                flushed = true;
+                source_ended = true;
+                continue;
+            }
+
+            chunk.generation = active;
+            chunk.frames = static_cast<uint32_t>(got / frame_bytes);
+            chunk.last = false;
+
+            produced += chunk.frames;
+            pending = chunk.frames > 0;
+
+            continue;
+        }
+
+        // The converter keeps its resampler tail - it is flushed out after the last read
+        if (source_ended)
+        {
+            SDL_AudioStreamFlush(converter);
+            flushed = true;
+            continue;
+        }
+
+        const size_t want = static_cast<size_t>(std::min<uint64_t>(raw.size(), remaining_bytes));
+        const size_t got = want ? SDL_RWread(source, raw.data(), 1, want) : 0;
+
+        if (got == 0)
+        {
+            source_ended = true;
+            continue;
+        }
+
+        remaining_bytes -= got;
+
+        SDL_AudioStreamPut(converter, raw.data(), static_cast<int>(got));
+    }
+}
+
+// === DECODER THREAD ===
+
+
+// === MIXER SIDE ===
+
+uint32_t Streaming_audio::restart(uint64_t position, uint64_t range_start, uint64_t range_end, bool loop)
+{
+    start_position.store(position, std::memory_order_relaxed);
+    loop_start.store(range_start, std::memory_order_relaxed);
+    loop_end.store(std::min(range_end, frame_count), std::memory_order_relaxed);
+    looping.store(loop, std::memory_order_relaxed);
+
+    // The main thread is the only writer - the new generation publishes the parameters
+    const uint32_t next = generation.load(std::memory_order_relaxed) + 1;
+
+    generation.store(next, std::memory_order_release);
+
+    return next;
+}
+
+
+const Sint16* Streaming_audio::acquire(uint32_t wanted, int& frames)
+{
+    frames = 0;
+
+    for (;;)
+    {
+        if (has_current)
+        {
+            const int32_t age = static_cast<int32_t>(current.generation - wanted);
+
+            // A newer restart - the voice gets its generation with the next command
+            if (age > 0) return nullptr;
+
+            if (age == 0 && current_offset < static_cast<int>(current.frames))
+            {
+                frames = static_cast<int>(current.frames) - current_offset;
+                return current.data + current_offset * channels;
+            }
+
+            if (age == 0 && current.last) return nullptr;
+        }
+
+        // Played or stale - the next one
+        if (!chunks.pop(current))
+        {
+            has_current = false;
+            return nullptr;
+        }
+
+        has_current = true;
+        current_offset = 0;
+    }
+}
+
+
+void Streaming_audio::consume(int frames) { current_offset += frames; }
+
+
+bool Streaming_audio::is_drained(uint32_t wanted) const
+{
+    return has_current && current.generation == wanted && current.last &&
+           current_offset >= static_cast<int>(current.frames);
+}
+
+
+void Streaming_audio::count_underrun() { underruns.fetch_add(1, std::memory_order_relaxed); }
+
+// === MIXER SIDE ===
+
+// =========================================================================================== STREAMING AUDIO
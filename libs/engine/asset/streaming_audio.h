@@ -0,0 +1,181 @@
+// streaming_audio.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "asset.h"
+#include "../audio/spsc_ring.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== STREAMING AUDIO
+
+
+/**
+ * @brief Long audio (the music), decoded in chunks while it plays.
+ *
+ * A minute of 44.1 kHz stereo is about 10 MB of PCM - too much to hold for every track.
+ * Only the WAV header is read on the construction, the PCM stays in the file (or the
+ * pack): a background thread reads it in chunks, converts them to S16 at the output
+ * rate and queues them into a wait-free ring of about 370 ms, which the Audio_mixer
+ * callback plays in place. The memory is the ring, whatever the track length.
+ *
+ * The seek is a byte offset into the PCM data - the output frame (time_to_samples())
+ * is scaled to the source rate, nothing is decoded from the start. The chunks of the
+ * previous position are dropped by the callback by their generation.
+ *
+ * It is an Audio_asset - the Audio_instance plays, pauses, trims and seeks it like any
+ * other audio, but only one instance of a stream plays at a time.
+ *
+ * Sources: the PCM WAV (8, 16, 32 bit integer or 32 bit float, mono or stereo), raw
+ * in the pack or a file, and the cooked pack audio. The pack must stay mounted while
+ * the stream exists.
+ *
+ * Usage:
+ * @code
+ * Audio_asset* music = static_cast<Audio_asset*>(
+ *     Asset_manager::Instance().adopt(std::make_unique<Streaming_audio>("assets/music/theme.wav")));
+ *
+ * Audio_instance* theme = music->create_instance();
+ * theme->play_audio(true);
+ * theme->rewind_audio({0, 1, 30, 0});
+ * @endcode
+ */
+class Streaming_audio : public Audio_asset
+{
+
+    friend class Audio_mixer;
+
+public:
+
+    // Frames of one decoded chunk and the number of chunks queued ahead
+    static constexpr int CHUNK_FRAMES = 1024;
+    static constexpr uint32_t CHUNK_COUNT = 16;
+
+
+    /**
+     * @brief Opens the stream and starts its decoder thread.
+     *
+     * @param path        Path of the WAV file (or its pack entry).
+     * @param output_rate Rate of the decoded PCM, 0 - the mixer rate (44100 if it is closed).
+     */
+    Streaming_audio(const std::string& path, int output_rate = 0);
+
+    // Stops the voice and the decoder thread, closes the source
+    ~Streaming_audio() override;
+
+    // The chunk ring and the read buffer - the stream holds no whole samples
+    size_t get_memory_bytes() const override;
+
+
+    // Header is valid and the decoder runs
+    bool is_open() const;
+
+    // Source rate and format (the output is S16 at get_sample_rate())
+    unsigned int get_source_rate() const;
+    SDL_AudioFormat get_source_format() const;
+
+    // Output frames of the whole stream
+    uint64_t get_frame_count() const;
+
+    // Callbacks, which found the ring empty (the decoder was late)
+    int get_underrun_count() const;
+
+
+private:
+
+    struct Chunk
+    {
+        uint32_t generation;
+        uint32_t frames;
+
+        // The last chunk of the data (not looping)
+        bool last;
+
+        Sint16 data[CHUNK_FRAMES * 2];
+    };
+
+
+    // Header of the source - false if it is not a playable WAV
+    bool open_source();
+
+    static int SDLCALL decoder_main(void* userdata);
+    void decode();
+
+    // Decoder side - moves the source to the output frame
+    void seek_source(uint64_t frame);
+
+
+    // === MIXER SIDE ===
+
+    /**
+     * @brief Restarts the decoding from the position (main thread).
+     *
+     * The loop range is played over and over, without the gap of a restart.
+     *
+     * @return Generation of the new chunks - the callback plays only them.
+     */
+    uint32_t restart(uint64_t position, uint64_t range_start, uint64_t range_end, bool loop);
+
+    // Callback - the queued frames of the generation in place, nullptr if there are none yet
+    const Sint16* acquire(uint32_t wanted, int& frames);
+
+    // Callback - frames played from the acquired chunk
+    void consume(int frames);
+
+    // Callback - the last chunk of the generation is played
+    bool is_drained(uint32_t wanted) const;
+
+    void count_underrun();
+
+    // === MIXER SIDE ===
+
+
+    SDL_RWops* source;
+
+    // PCM data in the source
+    Sint64 data_offset;
+    uint64_t data_size;
+
+    unsigned int source_rate;
+    SDL_AudioFormat source_format;
+    unsigned int source_frame_bytes;
+
+    uint64_t frame_count;
+
+    SDL_AudioStream* converter;
+    SDL_Thread* decoder;
+
+    std::atomic<bool> running;
+
+    // Restart request - the parameters, published by the generation
+    std::atomic<uint32_t> generation;
+    std::atomic<uint64_t> start_position;
+    std::atomic<uint64_t> loop_start;
+    std::atomic<uint64_t> loop_end;
+    std::atomic<bool> looping;
+
+    // Decoder state
+    uint64_t remaining_bytes;
+    bool source_ended;
+    bool flushed;
+    std::vector<Uint8> raw;
+
+    // Decoder -> callback
+    Spsc_ring<Chunk, CHUNK_COUNT> chunks;
+
+    // Callback state - the chunk being played
+    Chunk current;
+    int current_offset;
+    bool has_current;
+
+    std::atomic<int> underruns;
+};
+
+// =========================================================================================== STREAMING AUDIO
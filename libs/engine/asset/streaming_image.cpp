@@ -0,0 +1,132 @@
+// streaming_image.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "streaming_image.h"
+#include "texture_budget.h"
+
+#include <cstring>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== STREAMING IMAGE
+
+Streaming_image::Streaming_image(const std::string& name, unsigned int width, unsigned int height, Uint32 format) :
+
+    Image_asset(name, width, height),
+
+    format(format),
+    locked(false)
+
+{
+    // Nothing to reload the pixels from
+    set_texture_pinned(true);
+}
+
+
+Streaming_image::~Streaming_image()
+{
+    if (locked && texture) SDL_UnlockTexture(texture);
+}
+
+
+bool Streaming_image::create(SDL_Renderer* renderer)
+{
+    if (texture) return true;
+
+    if (!renderer || initial_width == 0 || initial_height == 0) return false;
+
+    texture = SDL_CreateTexture(renderer, format, SDL_TEXTUREACCESS_STREAMING,
+                                static_cast<int>(initial_width), static_cast<int>(initial_height));
+
+    if (!texture)
+    {
+        SDL_Log("Streaming image %s texture creation failed: %s", source_path.c_str(), SDL_GetError());
+        return false;
+    }
+
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+    owns_texture = true;
+
+    texture_renderer = renderer;
+    texture_bytes = Texture_budget::bytes_of(texture);
+    last_used_frame = Texture_budget::Instance().get_frame();
+
+    Texture_budget::Instance().track(this);
+
+    // The initial content is undefined
+    int pitch = 0;
+
+    if (void* px = lock(nullptr, &pitch))
+    {
+        std::memset(px, 0, static_cast<size_t>(pitch) * initial_height);
+        unlock();
+    }
+
+    return true;
+}
+
+
+void* Streaming_image::lock(const SDL_Rect* rect, int* pitch)
+{
+    if (!texture || locked) return nullptr;
+
+    void* px = nullptr;
+    int locked_pitch = 0;
+
+    if (SDL_LockTexture(texture, rect, &px, &locked_pitch) != 0)
+    {
+        SDL_Log("Streaming image %s lock failed: %s", source_path.c_str(), SDL_GetError());
+        return nullptr;
+    }
+
+    locked = true;
+
+    if (pitch) *pitch = locked_pitch;
+
+    return px;
+}
+
+
+void Streaming_image::unlock()
+{
+    if (!locked) return;
+
+    SDL_UnlockTexture(texture);
+    locked = false;
+}
+
+
+bool Streaming_image::update(const SDL_Rect* rect, const void* source, int src_pitch)
+{
+    if (!source) return false;
+
+    const int w = rect ? rect->w : static_cast<int>(initial_width);
+    const int h = rect ? rect->h : static_cast<int>(initial_height);
+
+    int pitch = 0;
+
+    unsigned char* dst = static_cast<unsigned char*>(lock(rect, &pitch));
+
+    if (!dst) return false;
+
+    const unsigned char* src = static_cast<const unsigned char*>(source);
+    const size_t row = static_cast<size_t>(w) * SDL_BYTESPERPIXEL(format);
+
+    for (int y = 0; y < h; ++y) std::memcpy(dst + static_cast<size_t>(y) * pitch, src + static_cast<size_t>(y) * src_pitch, row);
+
+    unlock();
+
+    return true;
+}
+
+
+Uint32 Streaming_image::get_format() const { return format; }
+
+
+bool Streaming_image::is_locked() const { return locked; }
+
+// =========================================================================================== STREAMING IMAGE
@@ -0,0 +1,102 @@
+// streaming_image.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include "asset.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== STREAMING IMAGE
+
+
+/**
+ * @brief Procedural image, rewritten often (animated backgrounds, effect buffers).
+ *
+ * The texture is created with SDL_TEXTUREACCESS_STREAMING and updated through
+ * SDL_LockTexture - the pixels are written straight into the driver memory, nothing
+ * is recreated, and only the locked rectangle is uploaded. There are no pixels
+ * in the RAM to reload from, so the texture is pinned under the Texture_budget.
+ *
+ * It is an Image_asset - the instances, the sprite batch and the layers draw it like
+ * any other image. The image is never packed into a Texture_atlas.
+ *
+ * Usage:
+ * @code
+ * Streaming_image fire("fx/fire", 160, 120);
+ * fire.create(renderer);
+ *
+ * // Every frame - only the changed rows
+ * SDL_Rect rows = {0, 100, 160, 20};
+ * int pitch = 0;
+ *
+ * if (Uint32* px = static_cast<Uint32*>(fire.lock(&rows, &pitch)))
+ * {
+ *     ... write rows.h lines of rows.w ARGB8888 pixels, pitch bytes apart ...
+ *     fire.unlock();
+ * }
+ * @endcode
+ */
+class Streaming_image : public Image_asset
+{
+
+public:
+
+    /**
+     * @brief Empty streaming image.
+     *
+     * @param name   Name of the image (the asset path, it is not loaded).
+     * @param width  Image width.
+     * @param height Image height.
+     * @param format Texture pixel format.
+     */
+    Streaming_image(const std::string& name, unsigned int width, unsigned int height,
+                    Uint32 format = SDL_PIXELFORMAT_ARGB8888);
+
+    ~Streaming_image() override;
+
+
+    // Creates the streaming texture, cleared to transparent
+    bool create(SDL_Renderer* renderer);
+
+
+    /**
+     * @brief Locks a rectangle of the texture for writing.
+     *
+     * The locked memory is write-only - its previous content is undefined,
+     * every pixel of the rectangle must be written.
+     *
+     * @param rect  Rectangle to update, nullptr - the whole image.
+     * @param pitch Bytes between the locked rows.
+     * @return First pixel of the rectangle, nullptr on failure (or already locked).
+     */
+    void* lock(const SDL_Rect* rect, int* pitch);
+
+    // Uploads the locked rectangle
+    void unlock();
+
+    /**
+     * @brief Copies the pixels into a rectangle (lock, row copy, unlock).
+     *
+     * @param rect      Rectangle to update, nullptr - the whole image.
+     * @param source    Source pixels in the texture format.
+     * @param src_pitch Bytes between the source rows.
+     */
+    bool update(const SDL_Rect* rect, const void* source, int src_pitch);
+
+
+    Uint32 get_format() const;
+
+    bool is_locked() const;
+
+
+private:
+
+    Uint32 format;
+
+    bool locked;
+};
+
+// =========================================================================================== STREAMING IMAGE
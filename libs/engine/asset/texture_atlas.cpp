@@ -0,0 +1,206 @@
+// texture_atlas.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "texture_atlas.h"
+#include "texture_budget.h"
+#include "../blit/hw_blitter.h"
+#include "../blit/blit_kernels.h"
+
+#include <algorithm>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== TEXTURE ATLAS
+
+Texture_atlas::~Texture_atlas() { release(); }
+
+
+void Texture_atlas::add(Image_asset* asset)
+{
+    if (!asset) return;
+
+    if (std::find(assets.begin(), assets.end(), asset) == assets.end()) assets.push_back(asset);
+}
+
+
+bool Texture_atlas::build(SDL_Renderer* renderer, int page_size)
+{
+    if (!renderer) return false;
+
+    release();
+
+    // A page can't be larger than the driver allows
+    SDL_RendererInfo info;
+
+    if (SDL_GetRendererInfo(renderer, &info) == 0)
+    {
+        if (info.max_texture_width > 0) page_size = std::min(page_size, info.max_texture_width);
+        if (info.max_texture_height > 0) page_size = std::min(page_size, info.max_texture_height);
+    }
+
+    // Tallest first - the shelves are filled evenly
+    std::vector<Image_asset*> order;
+
+    // Evicted own textures come back as the atlas pixels
+    for (Image_asset* asset : assets)
+    {
+        if (asset->evicted && asset->load_pixels()) asset->evicted = false;
+
+        asset->load_data();
+
+        if (asset->pixels) order.push_back(asset);
+    }
+
+    std::stable_sort(order.begin(), order.end(),
+                     [](const Image_asset* a, const Image_asset* b) { return a->get_texel_height() > b->get_texel_height(); });
+
+    // Images cooked into one 16-bit format keep it - the pages are half the size, the copies unconverted
+    Uint32 page_format = SDL_PIXELFORMAT_ARGB8888;
+
+    if (!order.empty()) page_format = order.front()->pixels->format->format;
+
+    for (const Image_asset* asset : order)
+        if (asset->pixels->format->format != page_format) page_format = SDL_PIXELFORMAT_ARGB8888;
+
+    bool all_uploaded = true;
+
+    SDL_Surface* page = nullptr;
+    std::vector<Image_asset*> page_assets;
+
+    int shelf_x = 0, shelf_y = 0, shelf_h = 0;
+
+    // Uploads the current page and links its assets
+    auto flush_page = [&]() -> void
+    {
+        if (!page) return;
+
+        SDL_Texture* texture = Image_asset::upload_surface(renderer, page);
+
+        if (texture)
+        {
+            pages.push_back(texture);
+
+            Texture_budget::Instance().add_fixed_bytes(Texture_budget::bytes_of(texture));
+        }
+        else
+        {
+            SDL_Log("Atlas page creation failed: %s", SDL_GetError());
+            all_uploaded = false;
+        }
+
+        for (Image_asset* asset : page_assets) asset->texture = texture;
+
+        SDL_FreeSurface(page);
+        page = nullptr;
+        page_assets.clear();
+    };
+
+    for (Image_asset* asset : order)
+    {
+        int w = static_cast<int>(asset->get_texel_width());
+        int h = static_cast<int>(asset->get_texel_height());
+
+        // Doesn't fit any page - own texture
+        if (w > page_size || h > page_size)
+        {
+            all_uploaded = asset->create_texture(renderer) && all_uploaded;
+            continue;
+        }
+
+        // Next shelf, then the next page
+        if (page && shelf_x + w > page_size)
+        {
+            shelf_x = 0;
+            shelf_y += shelf_h + PADDING;
+            shelf_h = 0;
+        }
+
+        if (page && shelf_y + h > page_size) flush_page();
+
+        if (!page)
+        {
+            page = SDL_CreateRGBSurfaceWithFormat(0, page_size, page_size, SDL_BITSPERPIXEL(page_format), page_format);
+
+            if (!page)
+            {
+                SDL_Log("Atlas page surface creation failed: %s", SDL_GetError());
+                return false;
+            }
+
+            SDL_FillRect(page, nullptr, 0);
+
+            shelf_x = 0;
+            shelf_y = 0;
+            shelf_h = 0;
+        }
+
+        // Plain copy of the pixels, with the alpha
+        SDL_Rect dst = {shelf_x, shelf_y, w, h};
+
+        SDL_SetSurfaceBlendMode(asset->pixels, SDL_BLENDMODE_NONE);
+        SDL_BlitSurface(asset->pixels, nullptr, page, &dst);
+
+        // The 16-bit alpha formats are straight - premultiplied like the ARGB8888 images on the page
+        if (page_format == SDL_PIXELFORMAT_ARGB8888 && asset->pixels->format->format != SDL_PIXELFORMAT_ARGB8888 &&
+            SDL_ISPIXELFORMAT_ALPHA(asset->pixels->format->format))
+        {
+            for (int y = dst.y; y < dst.y + h; ++y)
+            {
+                std::uint32_t* row = reinterpret_cast<std::uint32_t*>(static_cast<std::uint8_t*>(page->pixels) + y * page->pitch) + dst.x;
+                blit_premultiply_argb(row, row, w);
+            }
+        }
+
+        asset->release_texture();
+        asset->texture_region = {{static_cast<float>(shelf_x), static_cast<float>(shelf_y)},
+                                 {static_cast<float>(shelf_x + w), static_cast<float>(shelf_y + h)}};
+
+        page_assets.push_back(asset);
+
+        shelf_x += w + PADDING;
+        shelf_h = std::max(shelf_h, h);
+    }
+
+    flush_page();
+
+    return all_uploaded;
+}
+
+
+void Texture_atlas::release()
+{
+    // The packed assets lose the pages, the own textures stay
+    for (Image_asset* asset : assets)
+    {
+        if (asset->owns_texture) continue;
+
+        asset->texture = nullptr;
+        asset->texture_region = {{0.0f, 0.0f},
+                                 {static_cast<float>(asset->get_texel_width()), static_cast<float>(asset->get_texel_height())}};
+    }
+
+    for (SDL_Texture* page : pages)
+    {
+        Texture_budget::Instance().remove_fixed_bytes(Texture_budget::bytes_of(page));
+        Hw_blitter::Instance().forget(page);
+        SDL_DestroyTexture(page);
+    }
+
+    pages.clear();
+}
+
+
+int Texture_atlas::get_page_count() const { return static_cast<int>(pages.size()); }
+
+
+SDL_Texture* Texture_atlas::get_page(int index) const
+{
+    if (index < 0 || index >= static_cast<int>(pages.size())) return nullptr;
+
+    return pages[index];
+}
+
+// =========================================================================================== TEXTURE ATLAS
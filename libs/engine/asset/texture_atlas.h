@@ -0,0 +1,97 @@
+// texture_atlas.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <vector>
+
+#include "asset.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== TEXTURE ATLAS
+
+
+/**
+ * @brief Packs many Image_asset pixels into a few large textures at the load time.
+ *
+ * With one texture per file every sprite is a texture switch, so the batches break
+ * on every draw. The atlas puts the images onto pages (shelf packing, tallest first)
+ * and every packed asset gets the page as its texture and its sub-rectangle as the
+ * texture region. Image_instance crop maps stay in the image pixels - get_source_rect()
+ * shifts them into the page, so the instance code doesn't change.
+ *
+ * The pages take the pixel format of the images, when they are all cooked into the same
+ * one (RGB565 - half of the memory), and ARGB8888 otherwise.
+ *
+ * The atlas owns the pages, the assets only refer to them. Destroy (or release)
+ * the atlas before the renderer and after the assets are not drawn anymore.
+ *
+ * Usage:
+ * @code
+ * Texture_atlas atlas;
+ *
+ * atlas.add(&hero);
+ * atlas.add(&coin);
+ *
+ * atlas.build(renderer);      // hero.get_texture() == coin.get_texture()
+ * @endcode
+ */
+class Texture_atlas
+{
+
+public:
+
+    Texture_atlas() = default;
+
+    // Destroys the pages and detaches the assets
+    ~Texture_atlas();
+
+    // The pages are owned - not copyable
+    Texture_atlas(const Texture_atlas&) = delete;
+    Texture_atlas& operator=(const Texture_atlas&) = delete;
+
+
+    /**
+     * @brief Queues an image for the packing. Not loaded images are skipped by build().
+     *
+     * @param asset Image asset, which outlives the atlas pages.
+     */
+    void add(Image_asset* asset);
+
+    /**
+     * @brief Packs all added images and uploads the pages.
+     *
+     * Images larger than a page keep their own texture.
+     * Can be called again (after a device reset) - the pages are rebuilt from the asset pixels.
+     *
+     * @param renderer  Renderer of the pages.
+     * @param page_size Page side in pixels (clamped to the renderer texture limit).
+     * @return true if every loaded image has a texture.
+     */
+    bool build(SDL_Renderer* renderer, int page_size = 1024);
+
+    // Destroys the pages and drops the texture links of the packed assets
+    void release();
+
+
+    // Number of the uploaded pages
+    int get_page_count() const;
+
+    // Page texture by index, nullptr if out of range
+    SDL_Texture* get_page(int index) const;
+
+
+private:
+
+    // Transparent gap between the images - no filtering bleed of the neighbors
+    static constexpr int PADDING = 1;
+
+    std::vector<Image_asset*> assets;
+
+    std::vector<SDL_Texture*> pages;
+};
+
+// =========================================================================================== TEXTURE ATLAS
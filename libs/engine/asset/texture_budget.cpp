@@ -0,0 +1,224 @@
+// texture_budget.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "texture_budget.h"
+#include "asset.h"
+
+#include <algorithm>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== TEXTURE BUDGET
+
+Texture_budget& Texture_budget::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Texture_budget instance;
+
+    return instance;
+}
+
+
+void Texture_budget::set_budget(size_t bytes) { budget = bytes; }
+
+
+size_t Texture_budget::get_budget() const { return budget; }
+
+
+void Texture_budget::begin_frame()
+{
+    enforce();
+
+    ++frame;
+}
+
+
+Uint64 Texture_budget::get_frame() const { return frame; }
+
+
+int Texture_budget::enforce()
+{
+    if (budget == 0 || tracked_bytes + fixed_bytes <= budget)
+    {
+        over_budget_reported = false;
+        return 0;
+    }
+
+    // Oldest first, the textures of the current frame and the pinned ones stay
+    std::vector<Image_asset*> candidates;
+
+    for (Image_asset* asset : tracked)
+        if (!asset->is_texture_pinned() && asset->get_last_used_frame() < frame) candidates.push_back(asset);
+
+    std::sort(candidates.begin(), candidates.end(), [](const Image_asset* a, const Image_asset* b)
+    {
+        return a->get_last_used_frame() < b->get_last_used_frame();
+    });
+
+    int evicted = 0;
+
+    for (Image_asset* asset : candidates)
+    {
+        if (tracked_bytes + fixed_bytes <= budget) break;
+
+        // Untracks itself with the texture release
+        if (asset->evict()) ++evicted;
+    }
+
+    // Reported once - until the usage is back under the budget
+    if (tracked_bytes + fixed_bytes > budget && !over_budget_reported)
+    {
+        over_budget_reported = true;
+
+        SDL_Log("Texture budget: %u KB used of %u KB - nothing more to evict",
+                static_cast<unsigned>((tracked_bytes + fixed_bytes) / 1024), static_cast<unsigned>(budget / 1024));
+    }
+
+    evictions += evicted;
+
+    return evicted;
+}
+
+
+// === BACKGROUND ===
+
+int Texture_budget::evict_all()
+{
+    std::vector<Image_asset*> candidates;
+
+    for (Image_asset* asset : tracked)
+        if (!asset->is_texture_pinned()) candidates.push_back(asset);
+
+    // Newest first - the restore order
+    std::sort(candidates.begin(), candidates.end(), [](const Image_asset* a, const Image_asset* b)
+    {
+        return a->get_last_used_frame() > b->get_last_used_frame();
+    });
+
+    // A queue left from the previous sleep keeps its order after the new ones
+    std::vector<Image_asset*> queue;
+
+    for (Image_asset* asset : candidates)
+        if (asset->evict()) queue.push_back(asset);
+
+    const int evicted = static_cast<int>(queue.size());
+
+    for (size_t i = restore_next; i < restore_queue.size(); ++i)
+        if (restore_queue[i] && restore_queue[i]->is_evicted()) queue.push_back(restore_queue[i]);
+
+    restore_queue.swap(queue);
+    restore_next = 0;
+
+    evictions += evicted;
+
+    return evicted;
+}
+
+
+int Texture_budget::restore_queued(double budget_ms)
+{
+    const Uint64 start = SDL_GetPerformanceCounter();
+    const Uint64 limit = static_cast<Uint64>(budget_ms * SDL_GetPerformanceFrequency() / 1000.0);
+
+    int restored = 0;
+
+    while (restore_next < restore_queue.size())
+    {
+        Image_asset* asset = restore_queue[restore_next++];
+
+        // Already reloaded by a draw, or destroyed
+        if (!asset || !asset->is_evicted()) continue;
+
+        asset->restore();
+        ++restored;
+
+        if (SDL_GetPerformanceCounter() - start >= limit) break;
+    }
+
+    if (restore_next >= restore_queue.size())
+    {
+        restore_queue.clear();
+        restore_next = 0;
+    }
+
+    return restored;
+}
+
+// === BACKGROUND ===
+
+
+// === ACCOUNTING ===
+
+size_t Texture_budget::get_used_bytes() const { return tracked_bytes + fixed_bytes; }
+
+
+int Texture_budget::get_eviction_count() const { return evictions; }
+
+
+int Texture_budget::get_reload_count() const { return reloads; }
+
+
+size_t Texture_budget::get_tracked_count() const { return tracked.size(); }
+
+
+size_t Texture_budget::bytes_of(SDL_Texture* texture)
+{
+    Uint32 format = 0;
+    int w = 0, h = 0;
+
+    if (!texture || SDL_QueryTexture(texture, &format, nullptr, &w, &h) != 0) return 0;
+
+    // YUV and the other FOURCC formats - 1.5 bytes per pixel is the common case
+    size_t bpp = SDL_ISPIXELFORMAT_FOURCC(format) ? 0 : SDL_BYTESPERPIXEL(format);
+
+    return bpp ? static_cast<size_t>(w) * h * bpp : static_cast<size_t>(w) * h * 3 / 2;
+}
+
+// === ACCOUNTING ===
+
+
+// === REGISTRATION (Image_asset, Texture_atlas) ===
+
+void Texture_budget::cancel_restore(Image_asset* asset)
+{
+    for (size_t i = restore_next; i < restore_queue.size(); ++i)
+        if (restore_queue[i] == asset) restore_queue[i] = nullptr;
+}
+
+
+void Texture_budget::track(Image_asset* asset)
+{
+    if (!asset || std::find(tracked.begin(), tracked.end(), asset) != tracked.end()) return;
+
+    tracked.push_back(asset);
+    tracked_bytes += asset->get_texture_bytes();
+}
+
+
+void Texture_budget::untrack(Image_asset* asset)
+{
+    auto it = std::find(tracked.begin(), tracked.end(), asset);
+
+    if (it == tracked.end()) return;
+
+    tracked_bytes -= std::min(tracked_bytes, asset->get_texture_bytes());
+
+    *it = tracked.back();
+    tracked.pop_back();
+}
+
+
+void Texture_budget::add_fixed_bytes(size_t bytes) { fixed_bytes += bytes; }
+
+
+void Texture_budget::remove_fixed_bytes(size_t bytes) { fixed_bytes -= std::min(fixed_bytes, bytes); }
+
+
+void Texture_budget::count_reload() { ++reloads; }
+
+// === REGISTRATION (Image_asset, Texture_atlas) ===
+
+// =========================================================================================== TEXTURE BUDGET
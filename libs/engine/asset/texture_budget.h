@@ -0,0 +1,167 @@
+// texture_budget.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <vector>
+#include <cstddef>
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+class Image_asset;
+
+
+// =========================================================================================== TEXTURE BUDGET
+
+
+/**
+ * @brief Texture memory accounting with the least recently used eviction.
+ *
+ * The device RAM is shared with the GPU and the textures are its largest users.
+ * Every own Image_asset texture is tracked with its size (by the texture format)
+ * and the last frame it was drawn in; the Texture_atlas pages are counted as the
+ * fixed part. When the total exceeds the budget, the least recently used textures,
+ * which are not pinned and not used in the current frame, are destroyed with their
+ * decoded pixels - the asset reloads both transparently from the pack (or the file),
+ * when its texture is requested again.
+ *
+ * The eviction runs only at the frame start (begin_frame()), never while the
+ * Render_queue holds the texture pointers of the recorded frame.
+ *
+ * Singleton - bound to the main thread, like the renderer.
+ *
+ * Usage:
+ * @code
+ * Texture_budget::Instance().set_budget(24 * 1024 * 1024);
+ *
+ * // Main loop, before the state render
+ * Texture_budget::Instance().begin_frame();
+ * @endcode
+ */
+class Texture_budget
+{
+
+public:
+
+    // Returns the singleton instance.
+    static Texture_budget& Instance();
+
+
+    /**
+     * @brief Texture memory limit.
+     *
+     * @param bytes Budget in bytes, 0 - unlimited (only the accounting).
+     */
+    void set_budget(size_t bytes);
+
+    size_t get_budget() const;
+
+
+    // Next frame - evicts over the budget, then advances the frame counter
+    void begin_frame();
+
+    // Current frame number (the textures requested in it are never evicted)
+    Uint64 get_frame() const;
+
+    // Evicts until the budget is met, returns the number of the evicted textures
+    int enforce();
+
+
+    // === BACKGROUND ===
+
+    /**
+     * @brief Evicts every unpinned texture - the application went to the background.
+     *
+     * The evicted ones are queued for restore_queued(), the most recently used first:
+     * the textures of the last frames are the ones the first frame after the wake needs.
+     *
+     * @return Number of the evicted textures.
+     */
+    int evict_all();
+
+    /**
+     * @brief Reloads the queued textures in their order, until the time is spent.
+     *
+     * A texture, which a draw already reloaded (get_texture()), is just dropped from the queue.
+     *
+     * @param budget_ms Main thread time for the reloads, at least one is done.
+     * @return Number of the reloaded textures.
+     */
+    int restore_queued(double budget_ms);
+
+    // Textures waiting for restore_queued()
+    size_t get_queued_count() const { return restore_queue.size() - restore_next; }
+
+    // === BACKGROUND ===
+
+
+    // === ACCOUNTING ===
+
+    // Bytes of all tracked textures and atlas pages
+    size_t get_used_bytes() const;
+
+    // Evictions and reloads since the start
+    int get_eviction_count() const;
+    int get_reload_count() const;
+
+    // Number of the tracked own textures
+    size_t get_tracked_count() const;
+
+    // Memory of the texture by its format and size
+    static size_t bytes_of(SDL_Texture* texture);
+
+    // === ACCOUNTING ===
+
+
+    // === REGISTRATION (Image_asset, Texture_atlas) ===
+
+    void track(Image_asset* asset);
+    void untrack(Image_asset* asset);
+
+    // Atlas pages - accounted, but never evicted
+    void add_fixed_bytes(size_t bytes);
+    void remove_fixed_bytes(size_t bytes);
+
+    void count_reload();
+
+    // The asset is destroyed - out of the restore queue
+    void cancel_restore(Image_asset* asset);
+
+    // === REGISTRATION (Image_asset, Texture_atlas) ===
+
+
+private:
+
+    // Private constructor for singleton
+    Texture_budget() = default;
+
+    // Copying the singleton is not allowed
+    Texture_budget(const Texture_budget&) = delete;
+    Texture_budget& operator=(const Texture_budget&) = delete;
+
+
+    std::vector<Image_asset*> tracked;
+
+    // Evicted by evict_all(), the most recently used first - restore_next is the next one
+    std::vector<Image_asset*> restore_queue;
+    size_t restore_next = 0;
+
+    // Tracked textures and the atlas pages
+    size_t tracked_bytes = 0;
+    size_t fixed_bytes = 0;
+
+    size_t budget = 0;
+
+    Uint64 frame = 1;
+
+    int evictions = 0;
+    int reloads = 0;
+
+    bool over_budget_reported = false;
+};
+
+// =========================================================================================== TEXTURE BUDGET
@@ -0,0 +1,324 @@
+// tiled_image.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "tiled_image.h"
+#include "asset_pack.h"
+#include "texture_budget.h"
+#include "../render_queue/render_queue.h"
+
+#include <algorithm>
+#include <cmath>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== TILED IMAGE
+
+// Slower camera is standing (image pixels per second) - the ring around the view is prefetched evenly
+static constexpr float STILL_SPEED = 1.0f;
+
+
+Tiled_image::~Tiled_image() { close(); }
+
+
+bool Tiled_image::open(const std::string& image_path)
+{
+    close();
+
+    const Pack_entry* grid = Asset_pack::Instance().find(pack_tile_grid_name(image_path));
+
+    if (!grid || grid->params[0] == 0 || grid->params[2] == 0 || grid->params[3] == 0 || grid->params[4] == 0)
+    {
+        SDL_Log("Tiled image %s is not in the pack", image_path.c_str());
+        return false;
+    }
+
+    path = image_path;
+
+    columns = static_cast<int>(grid->params[3]);
+    rows = static_cast<int>(grid->params[4]);
+
+    width = static_cast<float>(grid->params[5] ? grid->params[5] : grid->params[0]);
+    height = static_cast<float>(grid->params[6] ? grid->params[6] : grid->params[1]);
+
+    // The tile side by the texels per logical pixel of the whole image
+    tile_side = static_cast<float>(grid->params[2]) * width / static_cast<float>(grid->params[0]);
+
+    tiles.assign(static_cast<size_t>(columns) * rows, nullptr);
+    candidates.reserve(tiles.size());
+
+    return true;
+}
+
+
+void Tiled_image::close()
+{
+    tiles.clear();
+
+    path.clear();
+    columns = 0;
+    rows = 0;
+
+    has_center = false;
+    velocity_x = 0.0f;
+    velocity_y = 0.0f;
+
+    missing = 0;
+    requests = 0;
+    releases = 0;
+}
+
+
+Tiled_image::Tile_range Tiled_image::tiles_of(float x, float y, float w, float h) const
+{
+    Tile_range range;
+
+    if (w <= 0.0f || h <= 0.0f) return range;
+
+    range.first_x = std::max(0, static_cast<int>(std::floor(x / tile_side)));
+    range.first_y = std::max(0, static_cast<int>(std::floor(y / tile_side)));
+    range.last_x = std::min(columns - 1, static_cast<int>(std::ceil((x + w) / tile_side)) - 1);
+    range.last_y = std::min(rows - 1, static_cast<int>(std::ceil((y + h) / tile_side)) - 1);
+
+    return range;
+}
+
+
+float Tiled_image::distance_of(int column, int row) const
+{
+    const float dx = (column + 0.5f) * tile_side - predicted_x;
+    const float dy = (row + 0.5f) * tile_side - predicted_y;
+
+    return dx * dx + dy * dy;
+}
+
+
+void Tiled_image::release(int index)
+{
+    if (!tiles[index]) return;
+
+    // The last reference - the asset and its texture go, a waiting prefetch is skipped by the loader
+    tiles[index].reset();
+    ++releases;
+}
+
+
+void Tiled_image::update(float camera_x, float camera_y, float view_w, float view_h, float dt)
+{
+    if (!is_open()) return;
+
+    const float x = camera_x + view_w * 0.5f;
+    const float y = camera_y + view_h * 0.5f;
+
+    // Smoothed over two updates - a single uneven step doesn't swing the prefetch
+    if (has_center && dt > 0.0f)
+    {
+        velocity_x = (velocity_x + (x - center_x) / dt) * 0.5f;
+        velocity_y = (velocity_y + (y - center_y) / dt) * 0.5f;
+    }
+    else
+    {
+        velocity_x = 0.0f;
+        velocity_y = 0.0f;
+    }
+
+    center_x = x;
+    center_y = y;
+    has_center = true;
+
+    predicted_x = x + velocity_x * LOOKAHEAD_SECONDS;
+    predicted_y = y + velocity_y * LOOKAHEAD_SECONDS;
+
+    const Tile_range visible = tiles_of(camera_x, camera_y, view_w, view_h);
+
+    // Wanted - the view, one tile around it when standing, the look-ahead tiles on the side it moves to
+    // and none behind it
+    auto extend = [this](float velocity, int& before, int& after)
+    {
+        if (std::fabs(velocity) < STILL_SPEED)
+        {
+            before = after = 1;
+            return;
+        }
+
+        const int ahead = std::clamp(static_cast<int>(std::ceil(std::fabs(velocity) * LOOKAHEAD_SECONDS / tile_side)), 1, MAX_LOOKAHEAD_TILES);
+
+        before = velocity < 0.0f ? ahead : 0;
+        after = velocity > 0.0f ? ahead : 0;
+    };
+
+    int left, right, up, down;
+    extend(velocity_x, left, right);
+    extend(velocity_y, up, down);
+
+    Tile_range wanted;
+    wanted.first_x = std::max(0, visible.first_x - left);
+    wanted.first_y = std::max(0, visible.first_y - up);
+    wanted.last_x = std::min(columns - 1, visible.last_x + right);
+    wanted.last_y = std::min(rows - 1, visible.last_y + down);
+
+    // Kept - a tile behind the camera stays one more tile, a jitter doesn't reload it
+    Tile_range kept;
+    kept.first_x = wanted.first_x - 1;
+    kept.first_y = wanted.first_y - 1;
+    kept.last_x = wanted.last_x + 1;
+    kept.last_y = wanted.last_y + 1;
+
+    int pending = 0;
+
+    for (int row = 0; row < rows; ++row)
+        for (int column = 0; column < columns; ++column)
+        {
+            const int index = row * columns + column;
+
+            if (!tiles[index]) continue;
+
+            // A load, which isn't wanted anymore, is cancelled - the others get its place in the flight
+            const bool finished = tiles[index]->is_finished();
+
+            if (!kept.contains(column, row) || (!finished && !wanted.contains(column, row))) release(index);
+            else if (!finished) ++pending;
+        }
+
+    Texture_budget& budget = Texture_budget::Instance();
+
+    const bool over_budget = budget.get_budget() > 0 && budget.get_used_bytes() > budget.get_budget();
+
+    // Over the budget - the resident tiles out of the view go, the farthest from the predicted camera first
+    if (over_budget)
+    {
+        candidates.clear();
+
+        for (int row = 0; row < rows; ++row)
+            for (int column = 0; column < columns; ++column)
+            {
+                const int index = row * columns + column;
+
+                if (tiles[index] && tiles[index]->is_ready() && !visible.contains(column, row)) candidates.push_back(index);
+            }
+
+        std::sort(candidates.begin(), candidates.end(), [this](int a, int b)
+        {
+            return distance_of(a % columns, a / columns) > distance_of(b % columns, b / columns);
+        });
+
+        for (int index : candidates)
+        {
+            if (budget.get_used_bytes() <= budget.get_budget()) break;
+
+            release(index);
+        }
+    }
+
+    if (pending >= MAX_PENDING) return;
+
+    // Requests - the visible tiles first, then the nearest to the predicted camera. Over the budget
+    // only the visible ones: the prefetches would push the tiles just released out again
+    const Tile_range& requested = over_budget ? visible : wanted;
+
+    candidates.clear();
+
+    for (int row = requested.first_y; row <= requested.last_y; ++row)
+        for (int column = requested.first_x; column <= requested.last_x; ++column)
+            if (!tiles[row * columns + column]) candidates.push_back(row * columns + column);
+
+    std::sort(candidates.begin(), candidates.end(), [this, &visible](int a, int b)
+    {
+        const bool visible_a = visible.contains(a % columns, a / columns);
+        const bool visible_b = visible.contains(b % columns, b / columns);
+
+        if (visible_a != visible_b) return visible_a;
+
+        return distance_of(a % columns, a / columns) < distance_of(b % columns, b / columns);
+    });
+
+    Asset_loader& loader = Asset_loader::Instance();
+
+    for (int index : candidates)
+    {
+        if (pending >= MAX_PENDING) break;
+
+        const int column = index % columns;
+        const int row = index / columns;
+
+        const Load_priority priority = visible.contains(column, row) ? Load_priority::NORMAL : Load_priority::LOW;
+
+        tiles[index] = loader.load(pack_tile_name(path, column, row), Asset_type::IMAGE, true, priority);
+        ++requests;
+
+        // A resident tile is ready at once
+        if (!tiles[index]->is_finished()) ++pending;
+    }
+}
+
+
+void Tiled_image::render(SDL_Renderer* r, float camera_x, float camera_y, int layer)
+{
+    missing = 0;
+
+    if (!r || !is_open()) return;
+
+    // The view in the logical pixels, the output without the logical size
+    int view_w = 0, view_h = 0;
+    SDL_RenderGetLogicalSize(r, &view_w, &view_h);
+
+    if (view_w == 0 || view_h == 0) SDL_GetRendererOutputSize(r, &view_w, &view_h);
+
+    const Tile_range visible = tiles_of(camera_x, camera_y, static_cast<float>(view_w), static_cast<float>(view_h));
+
+    Render_queue& queue = Render_queue::Instance();
+
+    for (int row = visible.first_y; row <= visible.last_y; ++row)
+        for (int column = visible.first_x; column <= visible.last_x; ++column)
+        {
+            const Load_handle& tile = tiles[row * columns + column];
+
+            Image_asset* image = tile ? tile->get_image() : nullptr;
+            SDL_Texture* texture = image ? image->get_texture() : nullptr;
+
+            if (!texture)
+            {
+                ++missing;
+                continue;
+            }
+
+            const Rect2& region = image->get_texture_region();
+
+            const SDL_Rect src = {
+                static_cast<int>(region.top_left.x), static_cast<int>(region.top_left.y),
+                static_cast<int>(region.bottom_right.x - region.top_left.x), static_cast<int>(region.bottom_right.y - region.top_left.y)
+            };
+
+            // The grid, not the tile sizes - the edge tiles are cut at the image edge, no seams
+            const float left = column * tile_side;
+            const float top = row * tile_side;
+
+            queue.copy(texture, &src, {left - camera_x, top - camera_y, std::min(tile_side, width - left), std::min(tile_side, height - top)}, layer);
+        }
+}
+
+
+int Tiled_image::get_resident_count() const
+{
+    int count = 0;
+
+    for (const Load_handle& tile : tiles)
+        if (tile && tile->is_ready()) ++count;
+
+    return count;
+}
+
+
+int Tiled_image::get_pending_count() const
+{
+    int count = 0;
+
+    for (const Load_handle& tile : tiles)
+        if (tile && !tile->is_finished()) ++count;
+
+    return count;
+}
+
+// =========================================================================================== TILED IMAGE
@@ -0,0 +1,193 @@
+// tiled_image.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <string>
+#include <vector>
+
+#include "asset_loader.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== TILED IMAGE
+
+
+/**
+ * @brief Large image streamed in the tiles around the camera (the scrolling backgrounds).
+ *
+ * A background of several screens doesn't fit the texture memory as one Image_asset. The
+ * cooker cuts it into the square tiles (asset_cooker --tile N), every tile is an own image
+ * entry of the pack, and only the tiles near the camera are resident:
+ *
+ * - The visible tiles are loaded through the Asset_loader as the normal loads, the ring
+ *   around them and the tiles ahead of the camera as the prefetches (LOW). The camera
+ *   velocity is measured by update() - the faster it scrolls, the more tiles ahead are
+ *   requested, the tiles behind it aren't.
+ * - At most MAX_PENDING loads are in flight, the nearest ones to the predicted camera
+ *   first - the loader decodes them in the pack order, the order of the requests is the
+ *   priority.
+ * - The tiles out of the kept range are released at once. Over the Texture_budget, the
+ *   resident tiles out of the view are released too, the farthest from the predicted
+ *   camera first (the ones behind it).
+ *
+ * A visible tile, which isn't loaded yet, is not drawn - the background under it shows.
+ * The tiles are plain images of the Asset_manager: the Texture_budget can still evict an
+ * unused one, the next draw reloads it.
+ *
+ * The image coordinates are the logical pixels of the whole image (cooked --density too).
+ * Main thread only, close() it before the Asset_manager is cleared (the state exit).
+ *
+ * Usage:
+ * @code
+ * Tiled_image sky;
+ * sky.open("assets/sky.bmp");                              // on_enter
+ *
+ * sky.update(camera_x, camera_y, 320.0f, 240.0f, dt);      // update - the requests and the evictions
+ * sky.render(r, camera_x, camera_y, 0);                     // render
+ *
+ * sky.close();                                             // on_exit
+ * @endcode
+ */
+class Tiled_image
+{
+
+public:
+
+    // Loads in flight at once - the rest waits for them, the nearest first
+    static constexpr int MAX_PENDING = 6;
+
+    // Seconds of the camera motion, which the prefetch looks ahead
+    static constexpr float LOOKAHEAD_SECONDS = 0.5f;
+
+    // Most tiles prefetched ahead of the view on an axis
+    static constexpr int MAX_LOOKAHEAD_TILES = 3;
+
+
+    Tiled_image() = default;
+
+    // Releases the tiles
+    ~Tiled_image();
+
+    // The tile handles are not shared
+    Tiled_image(const Tiled_image&) = delete;
+    Tiled_image& operator=(const Tiled_image&) = delete;
+
+
+    /**
+     * @brief Reads the tile grid of the image from the mounted pack (nothing is loaded yet).
+     *
+     * @param path Source path of the image cooked with --tile.
+     * @return false if the pack has no tiles of the path.
+     */
+    bool open(const std::string& path);
+
+    // Releases every tile and forgets the grid
+    void close();
+
+    bool is_open() const { return columns > 0; }
+
+
+    /**
+     * @brief Requests the tiles around the camera and releases the distant ones.
+     *
+     * @param camera_x Image pixel at the left edge of the view.
+     * @param camera_y Image pixel at the top edge of the view.
+     * @param view_w   View width in the image pixels.
+     * @param view_h   View height in the image pixels.
+     * @param dt       Seconds since the previous update (the camera velocity), 0 - a jump.
+     */
+    void update(float camera_x, float camera_y, float view_w, float view_h, float dt);
+
+    /**
+     * @brief Queues the loaded tiles of the view.
+     *
+     * @param r        Renderer of the frame (the view size, like Tile_map::render()).
+     * @param camera_x Image pixel at the left edge of the output.
+     * @param camera_y Image pixel at the top edge of the output.
+     * @param layer    Render_queue layer of the tile copies.
+     */
+    void render(SDL_Renderer* r, float camera_x, float camera_y, int layer = 0);
+
+
+    // === STATS ===
+
+    // Whole image in the logical pixels
+    float get_width() const { return width; }
+    float get_height() const { return height; }
+
+    int get_columns() const { return columns; }
+    int get_rows() const { return rows; }
+
+    // Tiles loaded, and requested but not loaded yet
+    int get_resident_count() const;
+    int get_pending_count() const;
+
+    // Visible tiles, which the last render had no pixels of
+    int get_missing_count() const { return missing; }
+
+    // Tile loads requested and the tiles released since the open
+    int get_request_count() const { return requests; }
+    int get_release_count() const { return releases; }
+
+    // === STATS ===
+
+
+private:
+
+    // Range of the tiles, inclusive - empty if first > last
+    struct Tile_range
+    {
+        int first_x = 0;
+        int first_y = 0;
+        int last_x = -1;
+        int last_y = -1;
+
+        bool contains(int x, int y) const { return x >= first_x && x <= last_x && y >= first_y && y <= last_y; }
+    };
+
+    // Tiles under the rectangle of the image pixels, clamped to the grid
+    Tile_range tiles_of(float x, float y, float w, float h) const;
+
+    // Squared distance of the tile center from the predicted camera center
+    float distance_of(int column, int row) const;
+
+    // Drops the handle of the tile
+    void release(int index);
+
+
+    std::string path;
+
+    // Grid and the logical size of a tile side
+    int columns = 0;
+    int rows = 0;
+
+    float width = 0.0f;
+    float height = 0.0f;
+    float tile_side = 0.0f;
+
+    // Handle of every tile, empty - not requested
+    std::vector<Load_handle> tiles;
+
+    // Camera center of the last update and its velocity in the image pixels per second
+    float center_x = 0.0f;
+    float center_y = 0.0f;
+    float velocity_x = 0.0f;
+    float velocity_y = 0.0f;
+    bool has_center = false;
+
+    // Camera center LOOKAHEAD_SECONDS ahead
+    float predicted_x = 0.0f;
+    float predicted_y = 0.0f;
+
+    // Scratch of the update - the tiles to request, sorted by the distance
+    std::vector<int> candidates;
+
+    int missing = 0;
+    int requests = 0;
+    int releases = 0;
+};
+
+// =========================================================================================== TILED IMAGE
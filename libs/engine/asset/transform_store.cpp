@@ -0,0 +1,197 @@
+// transform_store.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "transform_store.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== TRANSFORM STORE
+
+int Transform_store::add(const Image_instance* sprite, SDL_FPoint position)
+{
+    Image_handle handle = sprite ? sprite->get_handle() : Image_handle{};
+
+    if (handle.is_null())
+    {
+        SDL_Log("Transform store: only the pooled image instances could be added");
+        return -1;
+    }
+
+    const float crop_w = sprite->crop_map.bottom_right.x - sprite->crop_map.top_left.x;
+    const float crop_h = sprite->crop_map.bottom_right.y - sprite->crop_map.top_left.y;
+
+    sprites.push_back(handle);
+
+    x.push_back(position.x);
+    y.push_back(position.y);
+
+    scale_x.push_back(sprite->x_scaler);
+    scale_y.push_back(sprite->y_scaler);
+
+    angle.push_back(sprite->rotation_angle);
+
+    base_width.push_back(crop_w > 0.0f ? crop_w : 0.0f);
+    base_height.push_back(crop_h > 0.0f ? crop_h : 0.0f);
+    width.push_back(static_cast<float>(sprite->get_current_width()));
+    height.push_back(static_cast<float>(sprite->get_current_height()));
+
+    return get_count() - 1;
+}
+
+
+void Transform_store::remove(int index)
+{
+    if (index < 0 || index >= get_count()) return;
+
+    const size_t i = static_cast<size_t>(index);
+    const size_t last = sprites.size() - 1;
+
+    sprites[i] = sprites[last];
+    x[i] = x[last];
+    y[i] = y[last];
+    scale_x[i] = scale_x[last];
+    scale_y[i] = scale_y[last];
+    angle[i] = angle[last];
+    base_width[i] = base_width[last];
+    base_height[i] = base_height[last];
+    width[i] = width[last];
+    height[i] = height[last];
+
+    sprites.pop_back();
+    x.pop_back();
+    y.pop_back();
+    scale_x.pop_back();
+    scale_y.pop_back();
+    angle.pop_back();
+    base_width.pop_back();
+    base_height.pop_back();
+    width.pop_back();
+    height.pop_back();
+}
+
+
+void Transform_store::clear()
+{
+    sprites.clear();
+    x.clear();
+    y.clear();
+    scale_x.clear();
+    scale_y.clear();
+    angle.clear();
+    base_width.clear();
+    base_height.clear();
+    width.clear();
+    height.clear();
+}
+
+
+int Transform_store::remove_stale()
+{
+    int removed = 0;
+
+    for (int i = get_count() - 1; i >= 0; --i)
+    {
+        if (!resolve(sprites[i]))
+        {
+            remove(i);
+            ++removed;
+        }
+    }
+
+    return removed;
+}
+
+
+// === BULK UPDATES ===
+
+void Transform_store::translate_all(float dx, float dy)
+{
+    const size_t n = sprites.size();
+
+    float* px = x.data();
+    float* py = y.data();
+
+    for (size_t i = 0; i < n; ++i) px[i] += dx;
+    for (size_t i = 0; i < n; ++i) py[i] += dy;
+}
+
+
+void Transform_store::rotate_all(float delta_angle_deg)
+{
+    const size_t n = sprites.size();
+
+    float* a = angle.data();
+
+    for (size_t i = 0; i < n; ++i) a[i] += delta_angle_deg;
+}
+
+
+void Transform_store::scale_all(float factor)
+{
+    const size_t n = sprites.size();
+
+    float* sx = scale_x.data();
+    float* sy = scale_y.data();
+
+    for (size_t i = 0; i < n; ++i) sx[i] *= factor;
+    for (size_t i = 0; i < n; ++i) sy[i] *= factor;
+
+    update_sizes();
+}
+
+
+void Transform_store::update_sizes()
+{
+    const size_t n = sprites.size();
+
+    const float* bw = base_width.data();
+    const float* bh = base_height.data();
+    const float* sx = scale_x.data();
+    const float* sy = scale_y.data();
+
+    float* w = width.data();
+    float* h = height.data();
+
+    for (size_t i = 0; i < n; ++i) w[i] = bw[i] * sx[i];
+    for (size_t i = 0; i < n; ++i) h[i] = bh[i] * sy[i];
+}
+
+// === BULK UPDATES ===
+
+
+// === SINGLE SPRITE ===
+
+void Transform_store::set_position(int index, SDL_FPoint position)
+{
+    if (index < 0 || index >= get_count()) return;
+
+    x[index] = position.x;
+    y[index] = position.y;
+}
+
+
+void Transform_store::set_scale(int index, float x_scaler, float y_scaler)
+{
+    if (index < 0 || index >= get_count()) return;
+
+    scale_x[index] = x_scaler;
+    scale_y[index] = y_scaler;
+
+    width[index] = base_width[index] * x_scaler;
+    height[index] = base_height[index] * y_scaler;
+}
+
+
+void Transform_store::set_angle(int index, float angle_deg)
+{
+    if (index < 0 || index >= get_count()) return;
+
+    angle[index] = angle_deg;
+}
+
+// === SINGLE SPRITE ===
+
+// =========================================================================================== TRANSFORM STORE
@@ -0,0 +1,132 @@
+// transform_store.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <vector>
+
+#include "asset_instance.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== TRANSFORM STORE
+
+
+/**
+ * @brief Structure-of-arrays transforms of many image sprites.
+ *
+ * Image_instance keeps the crop, scale, anchors, flips and angle together - updating
+ * the position of hundreds of sprites drags all of it through the cache. The store
+ * keeps every transform field in its own array: the bulk updates are plain loops
+ * over contiguous floats (vectorized by the compiler), the sprite batch reads them
+ * directly (Sprite_batch::add(const Transform_store&)).
+ *
+ * The instances give the texture, crop and flips only - they are referenced by handles,
+ * so a sprite of a destroyed instance (or asset) is skipped instead of dangling.
+ *
+ * Usage:
+ * @code
+ * int bullet = store.add(bullet_asset->create_instance(), {x, y});
+ *
+ * float* bx = store.get_x();
+ * for (int i = 0; i < store.get_count(); ++i) bx[i] += vx[i] * dt;
+ *
+ * store.update_sizes();   // after the scale changes
+ * batch.add(store);
+ * @endcode
+ */
+class Transform_store
+{
+
+public:
+
+    /**
+     * @brief Adds a sprite of the pooled instance.
+     *
+     * The scale and angle start from the instance ones, the base size is its crop size.
+     *
+     * @return Index of the sprite (changed only by remove() of another sprite).
+     */
+    int add(const Image_instance* sprite, SDL_FPoint position);
+
+    /**
+     * @brief Removes the sprite - the last sprite takes its index.
+     *
+     * The instance itself is not destroyed.
+     */
+    void remove(int index);
+
+    void clear();
+
+    // Drops the sprites, which instances were destroyed
+    int remove_stale();
+
+
+    // === BULK UPDATES ===
+
+    void translate_all(float dx, float dy);
+
+    void rotate_all(float delta_angle_deg);
+
+    void scale_all(float factor);
+
+    // Recomputes the scaled sizes from the base sizes and scales (after any scale write)
+    void update_sizes();
+
+    // === BULK UPDATES ===
+
+
+    // === SINGLE SPRITE ===
+
+    void set_position(int index, SDL_FPoint position);
+
+    void set_scale(int index, float x_scaler, float y_scaler);
+
+    void set_angle(int index, float angle_deg);
+
+    // === SINGLE SPRITE ===
+
+
+    // === ARRAYS ===
+
+    int get_count() const { return static_cast<int>(sprites.size()); }
+
+    float* get_x() { return x.data(); }
+    float* get_y() { return y.data(); }
+    float* get_scale_x() { return scale_x.data(); }
+    float* get_scale_y() { return scale_y.data(); }
+    float* get_angle() { return angle.data(); }
+
+    const float* get_x() const { return x.data(); }
+    const float* get_y() const { return y.data(); }
+    const float* get_angle() const { return angle.data(); }
+    const float* get_width() const { return width.data(); }
+    const float* get_height() const { return height.data(); }
+
+    Image_handle get_sprite(int index) const { return sprites[index]; }
+
+    // === ARRAYS ===
+
+
+private:
+
+    std::vector<Image_handle> sprites;
+
+    std::vector<float> x;
+    std::vector<float> y;
+
+    std::vector<float> scale_x;
+    std::vector<float> scale_y;
+
+    std::vector<float> angle;
+
+    // Crop size and the scaled size
+    std::vector<float> base_width;
+    std::vector<float> base_height;
+    std::vector<float> width;
+    std::vector<float> height;
+};
+
+// =========================================================================================== TRANSFORM STORE
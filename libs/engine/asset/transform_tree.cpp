@@ -0,0 +1,494 @@
+// transform_tree.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "transform_tree.h"
+#include "transform_store.h"
+#include "../math/math_2d.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== TRANSFORM TREE
+
+namespace
+{
+    template <typename T>
+    void keep_entries(std::vector<T>& v, const std::vector<std::uint8_t>& keep)
+    {
+        size_t n = 0;
+
+        for (size_t i = 0; i < v.size(); ++i)
+            if (keep[i]) v[n++] = v[i];
+
+        v.resize(n);
+    }
+
+
+    template <typename T>
+    void reorder(std::vector<T>& v, const std::vector<int>& order)
+    {
+        std::vector<T> out(order.size());
+
+        for (size_t i = 0; i < order.size(); ++i) out[i] = v[static_cast<size_t>(order[i])];
+
+        v.swap(out);
+    }
+}
+
+
+int Transform_tree::add(int parent_node, SDL_FPoint position, float angle_deg, float scale)
+{
+    if (parent_node != NONE && !exists(parent_node))
+    {
+        SDL_Log("Transform tree: parent node %d doesn't exist", parent_node);
+        return NONE;
+    }
+
+    int node;
+
+    if (!free_ids.empty())
+    {
+        node = free_ids.back();
+        free_ids.pop_back();
+    }
+    else
+    {
+        node = static_cast<int>(index_of.size());
+        index_of.push_back(-1);
+    }
+
+    const int p = parent_node == NONE ? -1 : index_of[parent_node];
+    const int last = get_count() - 1;
+
+    // Still depth-first, if the parent is the last entry or one of its ancestors
+    if (p >= 0)
+    {
+        int a = last;
+
+        while (a >= 0 && a != p) a = parent[a];
+
+        if (a != p) order_dirty = true;
+    }
+
+    index_of[node] = get_count();
+
+    ids.push_back(node);
+    parent.push_back(p);
+
+    local_x.push_back(position.x);
+    local_y.push_back(position.y);
+    local_angle.push_back(angle_deg);
+    local_scale_x.push_back(scale);
+    local_scale_y.push_back(scale);
+
+    world_x.push_back(position.x);
+    world_y.push_back(position.y);
+    world_angle.push_back(angle_deg);
+    world_scale_x.push_back(scale);
+    world_scale_y.push_back(scale);
+    world_cos.push_back(1.0f);
+    world_sin.push_back(0.0f);
+
+    dirty.push_back(1);
+    changed.push_back(0);
+
+    sprite.push_back(-1);
+
+    return node;
+}
+
+
+void Transform_tree::remove(int node)
+{
+    if (!exists(node)) return;
+
+    // The descendants are found in one pass - a parent is before its children
+    if (order_dirty) rebuild_order();
+
+    const int count = get_count();
+    const int first = index_of[node];
+
+    std::vector<std::uint8_t> keep(static_cast<size_t>(count), 1);
+
+    keep[first] = 0;
+
+    for (int i = first + 1; i < count; ++i)
+        if (parent[i] >= 0 && !keep[parent[i]]) keep[i] = 0;
+
+    compact(keep);
+}
+
+
+bool Transform_tree::set_parent(int node, int parent_node)
+{
+    if (!exists(node) || (parent_node != NONE && !exists(parent_node))) return false;
+
+    const int i = index_of[node];
+    const int p = parent_node == NONE ? -1 : index_of[parent_node];
+
+    // A cycle - the new parent is the node or its descendant
+    for (int a = p; a >= 0; a = parent[a])
+    {
+        if (a == i)
+        {
+            SDL_Log("Transform tree: node %d can't be a child of its descendant %d", node, parent_node);
+            return false;
+        }
+    }
+
+    parent[i] = p;
+    dirty[i] = 1;
+
+    order_dirty = true;
+
+    return true;
+}
+
+
+void Transform_tree::clear()
+{
+    index_of.clear();
+    free_ids.clear();
+
+    order_dirty = false;
+
+    ids.clear();
+    parent.clear();
+    local_x.clear();
+    local_y.clear();
+    local_angle.clear();
+    local_scale_x.clear();
+    local_scale_y.clear();
+    world_x.clear();
+    world_y.clear();
+    world_angle.clear();
+    world_scale_x.clear();
+    world_scale_y.clear();
+    world_cos.clear();
+    world_sin.clear();
+    dirty.clear();
+    changed.clear();
+    sprite.clear();
+}
+
+
+bool Transform_tree::exists(int node) const
+{
+    return node >= 0 && node < static_cast<int>(index_of.size()) && index_of[node] >= 0;
+}
+
+
+void Transform_tree::mark_dirty(int node) { dirty[index_of[node]] = 1; }
+
+
+void Transform_tree::set_position(int node, SDL_FPoint position)
+{
+    if (!exists(node)) return;
+
+    const int i = index_of[node];
+
+    local_x[i] = position.x;
+    local_y[i] = position.y;
+
+    mark_dirty(node);
+}
+
+
+void Transform_tree::translate(int node, float dx, float dy)
+{
+    if (!exists(node)) return;
+
+    const int i = index_of[node];
+
+    local_x[i] += dx;
+    local_y[i] += dy;
+
+    mark_dirty(node);
+}
+
+
+void Transform_tree::set_angle(int node, float angle_deg)
+{
+    if (!exists(node)) return;
+
+    local_angle[index_of[node]] = angle_deg;
+
+    mark_dirty(node);
+}
+
+
+void Transform_tree::set_scale(int node, float x_scaler, float y_scaler)
+{
+    if (!exists(node)) return;
+
+    const int i = index_of[node];
+
+    local_scale_x[i] = x_scaler;
+    local_scale_y[i] = y_scaler;
+
+    mark_dirty(node);
+}
+
+
+SDL_FPoint Transform_tree::get_position(int node) const
+{
+    if (!exists(node)) return {0.0f, 0.0f};
+
+    return {local_x[index_of[node]], local_y[index_of[node]]};
+}
+
+
+float Transform_tree::get_angle(int node) const { return exists(node) ? local_angle[index_of[node]] : 0.0f; }
+
+
+int Transform_tree::update()
+{
+    if (order_dirty) rebuild_order();
+
+    const int count = get_count();
+
+    int recomputed = 0;
+
+    for (int i = 0; i < count; ++i)
+    {
+        const int p = parent[i];
+
+        // Nothing above or in the node moved
+        if (!dirty[i] && (p < 0 || !changed[p]))
+        {
+            changed[i] = 0;
+            continue;
+        }
+
+        dirty[i] = 0;
+        changed[i] = 1;
+        ++recomputed;
+
+        if (p < 0)
+        {
+            world_x[i] = local_x[i];
+            world_y[i] = local_y[i];
+            world_angle[i] = local_angle[i];
+            world_scale_x[i] = local_scale_x[i];
+            world_scale_y[i] = local_scale_y[i];
+        }
+        else
+        {
+            // The local offset in the parent space - scaled, then rotated
+            const float ox = local_x[i] * world_scale_x[p];
+            const float oy = local_y[i] * world_scale_y[p];
+
+            world_x[i] = world_x[p] + ox * world_cos[p] - oy * world_sin[p];
+            world_y[i] = world_y[p] + ox * world_sin[p] + oy * world_cos[p];
+            world_angle[i] = world_angle[p] + local_angle[i];
+            world_scale_x[i] = world_scale_x[p] * local_scale_x[i];
+            world_scale_y[i] = world_scale_y[p] * local_scale_y[i];
+        }
+
+        // The unrotated and the right angles without the trigonometry, exact
+        sin_cos_deg(world_angle[i], world_sin[i], world_cos[i]);
+    }
+
+    return recomputed;
+}
+
+
+SDL_FPoint Transform_tree::get_world_position(int node) const
+{
+    if (!exists(node)) return {0.0f, 0.0f};
+
+    return {world_x[index_of[node]], world_y[index_of[node]]};
+}
+
+
+float Transform_tree::get_world_angle(int node) const { return exists(node) ? world_angle[index_of[node]] : 0.0f; }
+
+
+float Transform_tree::get_world_scale_x(int node) const { return exists(node) ? world_scale_x[index_of[node]] : 1.0f; }
+
+
+float Transform_tree::get_world_scale_y(int node) const { return exists(node) ? world_scale_y[index_of[node]] : 1.0f; }
+
+
+bool Transform_tree::is_changed(int node) const { return exists(node) && changed[index_of[node]]; }
+
+
+void Transform_tree::bind_sprite(int node, int sprite_index)
+{
+    if (!exists(node)) return;
+
+    sprite[index_of[node]] = sprite_index;
+
+    // The sprite gets the transform on the next sync()
+    mark_dirty(node);
+}
+
+
+void Transform_tree::sync(Transform_store& store) const
+{
+    float* x = store.get_x();
+    float* y = store.get_y();
+    float* angle = store.get_angle();
+    float* scale_x = store.get_scale_x();
+    float* scale_y = store.get_scale_y();
+
+    const int sprites = store.get_count();
+    const int count = get_count();
+
+    bool rescaled = false;
+
+    for (int i = 0; i < count; ++i)
+    {
+        const int s = sprite[i];
+
+        if (!changed[i] || s < 0 || s >= sprites) continue;
+
+        x[s] = world_x[i];
+        y[s] = world_y[i];
+        angle[s] = world_angle[i];
+
+        if (scale_x[s] != world_scale_x[i] || scale_y[s] != world_scale_y[i])
+        {
+            scale_x[s] = world_scale_x[i];
+            scale_y[s] = world_scale_y[i];
+            rescaled = true;
+        }
+    }
+
+    if (rescaled) store.update_sizes();
+}
+
+
+void Transform_tree::rebuild_order()
+{
+    const int count = get_count();
+
+    // Children lists in the current order
+    std::vector<int> first_child(static_cast<size_t>(count), -1);
+    std::vector<int> next_sibling(static_cast<size_t>(count), -1);
+
+    int first_root = -1;
+
+    for (int i = count - 1; i >= 0; --i)
+    {
+        int& head = parent[i] >= 0 ? first_child[parent[i]] : first_root;
+
+        next_sibling[i] = head;
+        head = i;
+    }
+
+    // Pre-order walk without a stack - down to the first child, else to the next sibling up the chain
+    std::vector<int> order;
+    order.reserve(static_cast<size_t>(count));
+
+    for (int root = first_root; root >= 0; root = next_sibling[root])
+    {
+        int i = root;
+
+        for (;;)
+        {
+            order.push_back(i);
+
+            if (first_child[i] >= 0)
+            {
+                i = first_child[i];
+                continue;
+            }
+
+            while (i != root && next_sibling[i] < 0) i = parent[i];
+
+            if (i == root) break;
+
+            i = next_sibling[i];
+        }
+    }
+
+    permute(order);
+
+    order_dirty = false;
+}
+
+
+void Transform_tree::compact(const std::vector<std::uint8_t>& keep)
+{
+    const int count = get_count();
+
+    std::vector<int> new_index(static_cast<size_t>(count), -1);
+
+    int n = 0;
+
+    for (int i = 0; i < count; ++i)
+    {
+        if (keep[i]) new_index[i] = n++;
+        else
+        {
+            index_of[ids[i]] = -1;
+            free_ids.push_back(ids[i]);
+        }
+    }
+
+    keep_entries(ids, keep);
+    keep_entries(parent, keep);
+    keep_entries(local_x, keep);
+    keep_entries(local_y, keep);
+    keep_entries(local_angle, keep);
+    keep_entries(local_scale_x, keep);
+    keep_entries(local_scale_y, keep);
+    keep_entries(world_x, keep);
+    keep_entries(world_y, keep);
+    keep_entries(world_angle, keep);
+    keep_entries(world_scale_x, keep);
+    keep_entries(world_scale_y, keep);
+    keep_entries(world_cos, keep);
+    keep_entries(world_sin, keep);
+    keep_entries(dirty, keep);
+    keep_entries(changed, keep);
+    keep_entries(sprite, keep);
+
+    // The kept children have kept parents - the whole subtrees are removed
+    for (int i = 0; i < n; ++i)
+    {
+        if (parent[i] >= 0) parent[i] = new_index[parent[i]];
+
+        index_of[ids[i]] = i;
+    }
+}
+
+
+void Transform_tree::permute(const std::vector<int>& order)
+{
+    const int count = get_count();
+
+    std::vector<int> new_index(static_cast<size_t>(count));
+
+    for (int i = 0; i < count; ++i) new_index[order[i]] = i;
+
+    reorder(ids, order);
+    reorder(parent, order);
+    reorder(local_x, order);
+    reorder(local_y, order);
+    reorder(local_angle, order);
+    reorder(local_scale_x, order);
+    reorder(local_scale_y, order);
+    reorder(world_x, order);
+    reorder(world_y, order);
+    reorder(world_angle, order);
+    reorder(world_scale_x, order);
+    reorder(world_scale_y, order);
+    reorder(world_cos, order);
+    reorder(world_sin, order);
+    reorder(dirty, order);
+    reorder(changed, order);
+    reorder(sprite, order);
+
+    for (int i = 0; i < count; ++i)
+    {
+        if (parent[i] >= 0) parent[i] = new_index[parent[i]];
+
+        index_of[ids[i]] = i;
+    }
+}
+
+// =========================================================================================== TRANSFORM TREE
@@ -0,0 +1,192 @@
+// transform_tree.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <vector>
+#include <cstdint>
+
+#include "../platform/platform.h"
+
+class Transform_store;
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== TRANSFORM TREE
+
+
+/**
+ * @brief Parent-child hierarchy of 2D transforms - the sprites attached to a character,
+ *        the character attached to a platform.
+ *
+ * A node has a local transform (position, angle in degrees, scale) relative to its parent.
+ * update() computes the world transforms: world = parent world * local - the local position
+ * is scaled and rotated by the parent, the angles add up, the scales multiply.
+ *
+ * The nodes are stored structure-of-arrays in the depth-first order, so a parent always
+ * precedes its children and update() is one linear pass: a node is recomputed only if its
+ * local transform was written since the last update or its parent was recomputed in this one.
+ * A still scene costs a pass over the flags, a moving character - its own subtree only.
+ *
+ * The nodes are referenced by ids, which stay valid until the node is removed. The world
+ * values are the ones of the last update().
+ *
+ * Usage:
+ * @code
+ * int hero = tree.add(Transform_tree::NONE, {100, 50});
+ * int sword = tree.add(hero, {12, -4});
+ *
+ * tree.bind_sprite(sword, store.add(sword_instance, {}));
+ *
+ * // tick
+ * tree.translate(hero, vx * dt, 0.0f);
+ * tree.update();
+ * tree.sync(store);                    // the recomputed bound sprites only
+ * @endcode
+ */
+class Transform_tree
+{
+
+public:
+
+    // No node - the parent of the roots
+    static constexpr int NONE = -1;
+
+
+    /**
+     * @brief Adds a node under the parent (NONE - a root).
+     *
+     * @return Id of the node, NONE if the parent doesn't exist.
+     */
+    int add(int parent, SDL_FPoint position, float angle_deg = 0.0f, float scale = 1.0f);
+
+    // Removes the node with all of its descendants
+    void remove(int node);
+
+    // Moves the node under another parent (NONE - a root), the local transform is kept.
+    // A parent inside the own subtree is refused.
+    bool set_parent(int node, int parent);
+
+    void clear();
+
+    bool exists(int node) const;
+
+
+    // === LOCAL TRANSFORM ===
+
+    void set_position(int node, SDL_FPoint position);
+
+    void translate(int node, float dx, float dy);
+
+    void set_angle(int node, float angle_deg);
+
+    void set_scale(int node, float x_scaler, float y_scaler);
+
+    SDL_FPoint get_position(int node) const;
+    float get_angle(int node) const;
+
+    // === LOCAL TRANSFORM ===
+
+
+    /**
+     * @brief Recomputes the world transforms of the changed nodes and their descendants.
+     *
+     * Restores the depth-first order first, if set_parent() or add() under a non-root broke it.
+     *
+     * @return Number of the recomputed nodes.
+     */
+    int update();
+
+
+    // === WORLD TRANSFORM ===
+
+    SDL_FPoint get_world_position(int node) const;
+    float get_world_angle(int node) const;
+    float get_world_scale_x(int node) const;
+    float get_world_scale_y(int node) const;
+
+    // The world transform of the node was recomputed by the last update()
+    bool is_changed(int node) const;
+
+    // === WORLD TRANSFORM ===
+
+
+    // === SPRITES ===
+
+    // Links the node to a Transform_store sprite index (-1 - none)
+    void bind_sprite(int node, int sprite);
+
+    // Writes the world transforms of the bound nodes, recomputed by the last update(), into the store
+    void sync(Transform_store& store) const;
+
+    // === SPRITES ===
+
+
+    // === ARRAYS ===
+
+    // Depth-first arrays - the index of a node is get_index(node), valid until the next add / remove / update
+    int get_count() const { return static_cast<int>(ids.size()); }
+
+    int get_index(int node) const { return exists(node) ? index_of[node] : -1; }
+
+    const int* get_parents() const { return parent.data(); }
+    const float* get_world_x() const { return world_x.data(); }
+    const float* get_world_y() const { return world_y.data(); }
+    const float* get_world_angle() const { return world_angle.data(); }
+    const std::uint8_t* get_changed() const { return changed.data(); }
+
+    // === ARRAYS ===
+
+
+private:
+
+    // Restores the depth-first order (a parent before its children, the subtrees contiguous)
+    void rebuild_order();
+
+    // Keeps the entries with keep[i] != 0 in their order, remaps the parents and the ids
+    void compact(const std::vector<std::uint8_t>& keep);
+
+    // Reorders every array: the entry i becomes the entry order[i] was
+    void permute(const std::vector<int>& order);
+
+    void mark_dirty(int node);
+
+
+    // Id -> depth-first index, -1 for the free ids
+    std::vector<int> index_of;
+    std::vector<int> free_ids;
+
+    // The order is broken (set_parent(), add() under a non-root)
+    bool order_dirty = false;
+
+    // Depth-first arrays: the id and the parent index of an entry (-1 - a root)
+    std::vector<int> ids;
+    std::vector<int> parent;
+
+    std::vector<float> local_x;
+    std::vector<float> local_y;
+    std::vector<float> local_angle;
+    std::vector<float> local_scale_x;
+    std::vector<float> local_scale_y;
+
+    std::vector<float> world_x;
+    std::vector<float> world_y;
+    std::vector<float> world_angle;
+    std::vector<float> world_scale_x;
+    std::vector<float> world_scale_y;
+
+    // Rotation of the world angle - the children don't compute it again
+    std::vector<float> world_cos;
+    std::vector<float> world_sin;
+
+    // The local transform was written since the last update() / the world one was recomputed by it
+    std::vector<std::uint8_t> dirty;
+    std::vector<std::uint8_t> changed;
+
+    // Transform_store sprite of the entry, -1 - none
+    std::vector<int> sprite;
+};
+
+// =========================================================================================== TRANSFORM TREE
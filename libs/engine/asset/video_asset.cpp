@@ -0,0 +1,497 @@
+// video_asset.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "video_asset.h"
+#include "asset_instance.h"
+#include "asset_pack.h"
+#include "../audio/audio_mixer.h"
+#include "../blit/blit_kernels.h"
+#include "../engine_clock/engine_clock.h"
+#include "../frame/frame.h"
+#include "../render_queue/render_queue.h"
+#include "../thread_roles/thread_roles.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== VIDEO ASSET
+
+// Decoder poll period, while the queue is full or the stream is at its end
+static constexpr Uint32 DECODER_IDLE_MS = 4;
+
+// Longest stream header line - the parameters are a few short tokens
+static constexpr int MAX_HEADER = 256;
+
+// Header of a frame without the parameters
+static constexpr char FRAME_HEADER[] = "FRAME\n";
+static constexpr Sint64 FRAME_HEADER_BYTES = sizeof(FRAME_HEADER) - 1;
+
+
+Video_asset::Video_asset(const std::string& path) : Asset(Asset_type::VIDEO, path)
+{
+    if (!open_source()) return;
+
+    for (std::uint8_t i = 0; i < FRAME_QUEUE; ++i)
+    {
+        slots[i].pixels.resize(frame_bytes);
+        free_slots.push(i);
+    }
+
+    running.store(true);
+
+    decoder = SDL_CreateThread(decoder_main, "video_decoder", this);
+
+    if (!decoder)
+    {
+        SDL_Log("Video %s: decoder thread creation failed: %s", source_path.c_str(), SDL_GetError());
+        running.store(false);
+    }
+}
+
+
+Video_asset::~Video_asset()
+{
+    running.store(false);
+
+    if (decoder) SDL_WaitThread(decoder, nullptr);
+    if (texture) SDL_DestroyTexture(texture);
+    if (source) SDL_RWclose(source);
+}
+
+
+bool Video_asset::is_open() const { return decoder != nullptr; }
+
+
+size_t Video_asset::get_memory_bytes() const
+{
+    size_t bytes = 0;
+
+    for (const Frame_slot& slot : slots) bytes += slot.pixels.capacity();
+
+    return bytes;
+}
+
+
+double Video_asset::get_frame_rate() const { return static_cast<double>(rate_num) / static_cast<double>(rate_den); }
+
+
+std::uint32_t Video_asset::get_dropped_count() const { return dropped.load(std::memory_order_relaxed); }
+
+
+// === SOURCE ===
+
+bool Video_asset::open_source()
+{
+    Asset_pack& pack = Asset_pack::Instance();
+
+    source = pack.find(source_path) ? pack.open(source_path) : SDL_RWFromFile(source_path.c_str(), "rb");
+
+    if (!source)
+    {
+        SDL_Log("Video %s opening failed: %s", source_path.c_str(), SDL_GetError());
+        return false;
+    }
+
+    char header[MAX_HEADER + 1] = {};
+    int length = 0;
+
+    while (length < MAX_HEADER && SDL_RWread(source, header + length, 1, 1) == 1 && header[length] != '\n') ++length;
+
+    if (length == MAX_HEADER || header[length] != '\n' || std::strncmp(header, "YUV4MPEG2 ", 10) != 0)
+    {
+        SDL_Log("Video %s is not a YUV4MPEG2 stream", source_path.c_str());
+        return false;
+    }
+
+    header[length] = '\0';
+
+    // Space separated parameters, the first letter is the name
+    for (char* token = std::strtok(header + 10, " "); token; token = std::strtok(nullptr, " "))
+    {
+        switch (token[0])
+        {
+            case 'W': width = std::atoi(token + 1); break;
+            case 'H': height = std::atoi(token + 1); break;
+
+            case 'F':
+            {
+                char* den = nullptr;
+
+                rate_num = static_cast<std::uint32_t>(std::strtoul(token + 1, &den, 10));
+                rate_den = den && *den == ':' ? static_cast<std::uint32_t>(std::strtoul(den + 1, nullptr, 10)) : 1;
+                break;
+            }
+
+            // 4:2:0 only (420jpeg, 420mpeg2, 420paldv differ only by the chroma siting)
+            case 'C':
+                if (std::strncmp(token + 1, "420", 3) != 0)
+                {
+                    SDL_Log("Video %s: chroma %s is not supported, 4:2:0 is expected", source_path.c_str(), token + 1);
+                    return false;
+                }
+                break;
+
+            default: break;
+        }
+    }
+
+    if (width <= 0 || height <= 0 || rate_num == 0 || rate_den == 0)
+    {
+        SDL_Log("Video %s has no size or frame rate", source_path.c_str());
+        return false;
+    }
+
+    const size_t chroma = static_cast<size_t>((width + 1) / 2) * static_cast<size_t>((height + 1) / 2);
+
+    frame_bytes = static_cast<size_t>(width) * static_cast<size_t>(height) + 2 * chroma;
+    data_offset = SDL_RWtell(source);
+    frame_stride = FRAME_HEADER_BYTES + static_cast<Sint64>(frame_bytes);
+
+    // The frames are located by their number - their headers must not have parameters
+    char first[FRAME_HEADER_BYTES];
+
+    if (SDL_RWread(source, first, 1, sizeof(first)) != sizeof(first) || std::memcmp(first, FRAME_HEADER, sizeof(first)) != 0)
+    {
+        SDL_Log("Video %s: the frame headers have parameters (or there are no frames)", source_path.c_str());
+        return false;
+    }
+
+    const Sint64 size = SDL_RWsize(source);
+
+    frame_count = size > data_offset ? static_cast<std::uint32_t>((size - data_offset) / frame_stride) : 0;
+
+    if (frame_count == 0)
+    {
+        SDL_Log("Video %s has no complete frame", source_path.c_str());
+        return false;
+    }
+
+    SDL_RWseek(source, data_offset, RW_SEEK_SET);
+
+    return true;
+}
+
+
+// === DECODER ===
+
+int SDLCALL Video_asset::decoder_main(void* userdata)
+{
+    Thread_roles::Instance().apply(Thread_role::WORKER);
+
+    static_cast<Video_asset*>(userdata)->decode();
+    return 0;
+}
+
+
+void Video_asset::decode()
+{
+    while (running.load(std::memory_order_relaxed))
+    {
+        // Rewind - from the first frame again
+        const std::uint32_t wanted_generation = generation.load(std::memory_order_acquire);
+
+        if (wanted_generation != decoder_generation)
+        {
+            decoder_generation = wanted_generation;
+            next_frame = 0;
+        }
+
+        // Late frames are not read at all - the decoder jumps to the first one, which is due
+        const std::uint32_t wanted = std::min(wanted_frame.load(std::memory_order_relaxed), frame_count - 1);
+
+        if (next_frame < wanted)
+        {
+            dropped.fetch_add(wanted - next_frame, std::memory_order_relaxed);
+            next_frame = wanted;
+        }
+
+        if (next_frame >= frame_count)
+        {
+            SDL_Delay(DECODER_IDLE_MS);
+            continue;
+        }
+
+        if (decoder_slot < 0)
+        {
+            std::uint8_t slot = 0;
+
+            if (!free_slots.pop(slot))
+            {
+                SDL_Delay(DECODER_IDLE_MS);
+                continue;
+            }
+
+            decoder_slot = slot;
+        }
+
+        Frame_slot& slot = slots[decoder_slot];
+
+        if (!read_frame(slot))
+        {
+            SDL_Log("Video %s: frame %u can't be read", source_path.c_str(), next_frame);
+
+            // The rest is lost - the last good frame stays shown
+            next_frame = frame_count;
+            continue;
+        }
+
+        decoded_slots.push(static_cast<std::uint8_t>(decoder_slot));
+        decoder_slot = -1;
+
+        ++next_frame;
+    }
+}
+
+
+bool Video_asset::read_frame(Frame_slot& slot)
+{
+    if (SDL_RWseek(source, data_offset + static_cast<Sint64>(next_frame) * frame_stride + FRAME_HEADER_BYTES, RW_SEEK_SET) < 0)
+        return false;
+
+    if (SDL_RWread(source, slot.pixels.data(), 1, frame_bytes) != frame_bytes) return false;
+
+    slot.frame = next_frame;
+    slot.generation = decoder_generation;
+
+    return true;
+}
+
+// === DECODER ===
+
+
+// === PLAYBACK ===
+
+void Video_asset::set_audio(Audio_instance* instance)
+{
+    // No mixer - the position wouldn't move, the real time is the clock
+    audio = Audio_mixer::Instance().is_open() ? instance : nullptr;
+
+    audio_position = 0;
+    audio_position_clock = 0;
+}
+
+
+void Video_asset::play()
+{
+    if (playing || !is_open()) return;
+
+    if (audio && !audio->play_audio())
+    {
+        SDL_Log("Video %s: the audio can't be played, the real time is the clock", source_path.c_str());
+        audio = nullptr;
+    }
+
+    started_at = Engine_clock::now();
+    playing = true;
+}
+
+
+void Video_asset::pause()
+{
+    if (!playing) return;
+
+    paused_time = get_time();
+    playing = false;
+
+    if (audio) audio->pause_audio();
+}
+
+
+void Video_asset::rewind()
+{
+    playing = false;
+    paused_time = 0.0;
+
+    if (audio) audio->stop_audio();
+
+    audio_position = 0;
+    audio_position_clock = 0;
+
+    shown_frame = -1;
+    wanted_frame.store(0, std::memory_order_relaxed);
+    generation.fetch_add(1, std::memory_order_release);
+}
+
+
+bool Video_asset::is_finished() const
+{
+    if (!is_open()) return true;
+
+    return get_time() * static_cast<double>(rate_num) / static_cast<double>(rate_den) >= static_cast<double>(frame_count);
+}
+
+
+double Video_asset::get_time() const
+{
+    if (audio) return audio_time();
+
+    if (!playing) return paused_time;
+
+    return paused_time + Engine_clock::to_seconds(Engine_clock::now() - started_at);
+}
+
+
+double Video_asset::audio_time() const
+{
+    const Audio_mixer& mixer = Audio_mixer::Instance();
+
+    const std::uint64_t position = audio->get_playtime_sample();
+    const std::uint64_t clock = mixer.get_sample_clock();
+
+    // The position moves a callback buffer at a time - between the reports it is
+    // extrapolated by the sample clock, never more than one buffer ahead
+    if (position != audio_position)
+    {
+        audio_position = position;
+        audio_position_clock = clock;
+    }
+
+    std::uint64_t ahead = 0;
+
+    if (playing && clock > audio_position_clock)
+        ahead = std::min<std::uint64_t>(clock - audio_position_clock, static_cast<std::uint64_t>(mixer.get_buffer_frames()));
+
+    return static_cast<double>(audio_position + ahead) / static_cast<double>(mixer.get_sample_rate());
+}
+
+
+void Video_asset::recycle(std::uint8_t slot) { free_slots.push(slot); }
+
+
+bool Video_asset::samples_yuv(SDL_Renderer* renderer)
+{
+    SDL_RendererInfo info;
+
+    if (SDL_GetRendererInfo(renderer, &info) != 0) return false;
+
+    for (Uint32 i = 0; i < info.num_texture_formats; ++i)
+        if (info.texture_formats[i] == SDL_PIXELFORMAT_IYUV) return true;
+
+    return false;
+}
+
+
+bool Video_asset::update(SDL_Renderer* renderer)
+{
+    if (!is_open() || !renderer) return false;
+
+    if (!texture)
+    {
+        // The YUV texture only where the renderer samples it - elsewhere SDL would convert it in plain C
+        texture_format = samples_yuv(renderer) ? SDL_PIXELFORMAT_IYUV
+                       : Frame::Instance().get_target_format() == SDL_PIXELFORMAT_RGB565 ? SDL_PIXELFORMAT_RGB565
+                       : SDL_PIXELFORMAT_ARGB8888;
+
+        texture = SDL_CreateTexture(renderer, texture_format, SDL_TEXTUREACCESS_STREAMING, width, height);
+
+        if (!texture)
+        {
+            SDL_Log("Video %s: no %s texture: %s", source_path.c_str(), SDL_GetPixelFormatName(texture_format), SDL_GetError());
+            return false;
+        }
+
+        if (texture_format != SDL_PIXELFORMAT_IYUV)
+            SDL_Log("Video %s: converted to %s by the engine (%s)", source_path.c_str(), SDL_GetPixelFormatName(texture_format), blit_kernel_name());
+    }
+
+    // The audio is shorter than the picture - the real time goes on from its end
+    if (playing && audio && audio_position > 0 && !audio->is_playing())
+    {
+        paused_time = audio_time();
+        started_at = Engine_clock::now();
+        audio = nullptr;
+    }
+
+    const double due = get_time() * static_cast<double>(rate_num) / static_cast<double>(rate_den);
+    const std::uint32_t wanted = static_cast<std::uint32_t>(std::min(due, static_cast<double>(frame_count - 1)));
+
+    wanted_frame.store(wanted, std::memory_order_relaxed);
+
+    const std::uint32_t current_generation = generation.load(std::memory_order_relaxed);
+
+    // The last due frame is shown, the older due ones are dropped
+    int show = -1;
+
+    for (;;)
+    {
+        if (pending < 0)
+        {
+            std::uint8_t slot = 0;
+
+            if (!decoded_slots.pop(slot)) break;
+
+            pending = slot;
+        }
+
+        const Frame_slot& frame = slots[pending];
+
+        if (frame.generation != current_generation)
+        {
+            recycle(static_cast<std::uint8_t>(pending));
+            pending = -1;
+            continue;
+        }
+
+        if (frame.frame > wanted) break;
+
+        if (show >= 0)
+        {
+            recycle(static_cast<std::uint8_t>(show));
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        show = pending;
+        pending = -1;
+    }
+
+    if (show < 0) return false;
+
+    const Frame_slot& frame = slots[show];
+
+    const int chroma_pitch = (width + 1) / 2;
+    const Uint8* y = frame.pixels.data();
+    const Uint8* u = y + static_cast<size_t>(width) * static_cast<size_t>(height);
+    const Uint8* v = u + static_cast<size_t>(chroma_pitch) * static_cast<size_t>((height + 1) / 2);
+
+    if (texture_format == SDL_PIXELFORMAT_IYUV)
+    {
+        if (SDL_UpdateYUVTexture(texture, nullptr, y, width, u, chroma_pitch, v, chroma_pitch) != 0)
+            SDL_Log("Video %s: frame upload failed: %s", source_path.c_str(), SDL_GetError());
+    }
+    else
+    {
+        void* pixels = nullptr;
+        int pitch = 0;
+
+        // Converted straight into the texture memory - no frame in between
+        if (SDL_LockTexture(texture, nullptr, &pixels, &pitch) == 0)
+        {
+            blit_yuv420(pixels, pitch, texture_format, width, height, y, width, u, v, chroma_pitch);
+            SDL_UnlockTexture(texture);
+        }
+        else SDL_Log("Video %s: frame lock failed: %s", source_path.c_str(), SDL_GetError());
+    }
+
+    shown_frame = frame.frame;
+    recycle(static_cast<std::uint8_t>(show));
+
+    Frame::Instance().mark_dirty();
+
+    return true;
+}
+
+
+void Video_asset::draw(const SDL_FRect& dst, int layer) const
+{
+    if (texture && shown_frame >= 0) Render_queue::Instance().copy(texture, nullptr, dst, layer);
+}
+
+// === PLAYBACK ===
+
+// =========================================================================================== VIDEO ASSET
@@ -0,0 +1,240 @@
+// video_asset.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "asset.h"
+#include "../audio/spsc_ring.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== VIDEO ASSET
+
+
+/**
+ * @brief Intro and cutscene video: the frames are decoded ahead on a thread, the
+ * renderer converts them from YUV.
+ *
+ * The source is a YUV4MPEG2 stream (.y4m, 4:2:0 - "ffmpeg -i intro.mp4 -pix_fmt yuv420p
+ * intro.y4m"), raw in the pack or a file. Decoding it is only reading the planes: the
+ * decoder thread reads the frames into a queue of FRAME_QUEUE buffers, the main thread
+ * uploads the due one with SDL_UpdateYUVTexture into an IYUV texture - the YUV -> RGB
+ * conversion is the renderer's (a shader on the GPU renderers). A renderer, which can't
+ * sample YUV (the software one), gets an RGB texture of the target format instead: the
+ * frame is converted by blit_yuv420() (NEON on the device) straight into the locked
+ * texture. Nothing is allocated while it plays.
+ *
+ * The playback follows a clock: the play position of the attached audio (the sound of
+ * the video, usually a Streaming_audio of the mixer rate), otherwise the real time.
+ * update() shows the last frame, which is due - the older ones are dropped, and the
+ * decoder skips the frames, which are late already, without reading them. A slow frame
+ * never holds the game loop back: the video only shows fewer frames.
+ *
+ * The pack must stay mounted while the video exists.
+ *
+ * Usage:
+ * @code
+ * Video_asset* intro = Asset_manager::Instance().acquire_video("video/intro.y4m");
+ * Audio_asset* sound = static_cast<Audio_asset*>(
+ *     Asset_manager::Instance().adopt(std::make_unique<Streaming_audio>("video/intro.wav")));
+ *
+ * intro->set_audio(sound->create_instance());
+ * intro->play();
+ *
+ * // Every frame, the state render
+ * intro->update(renderer);
+ * intro->draw({0.0f, 0.0f, 640.0f, 480.0f});
+ *
+ * if (intro->is_finished()) app_sm.transit_state(MAIN_MENU);
+ * @endcode
+ */
+class Video_asset : public Asset
+{
+
+public:
+
+    // Decoded frames queued ahead (one is the shown one at most)
+    static constexpr std::uint32_t FRAME_QUEUE = 4;
+
+
+    /**
+     * @brief Opens the stream and starts its decoder thread (paused at the first frame).
+     *
+     * @param path Path of the .y4m file (or its pack entry).
+     */
+    Video_asset(const std::string& path);
+
+    // Stops the decoder thread, destroys the texture and closes the source
+    ~Video_asset() override;
+
+    // Pixels of the frame queue
+    size_t get_memory_bytes() const override;
+
+
+    // Header is valid and the decoder runs
+    bool is_open() const;
+
+    int get_width() const { return width; }
+    int get_height() const { return height; }
+
+    // Frames per second of the stream
+    double get_frame_rate() const;
+
+    // Frames of the whole stream
+    std::uint32_t get_frame_count() const { return frame_count; }
+
+
+    // === PLAYBACK ===
+
+    /**
+     * @brief Attaches the audio, whose play position is the clock of the video.
+     *
+     * The instance is played, paused and stopped with the video. Its audio must be at
+     * the mixer rate - the position is converted to the time by it.
+     *
+     * @param audio Sound of the video, nullptr - the real time clock.
+     */
+    void set_audio(Audio_instance* audio);
+
+    // Starts or resumes the playback (and the audio)
+    void play();
+
+    // Keeps the position and the shown frame
+    void pause();
+
+    // Back to the first frame, paused
+    void rewind();
+
+    bool is_playing() const { return playing; }
+
+    // The clock has passed the last frame
+    bool is_finished() const;
+
+    // Time of the clock from the first frame, in seconds
+    double get_time() const;
+
+    /**
+     * @brief Shows the due frame (the render of the main thread, every frame).
+     *
+     * Creates the texture on the first call. Marks the frame dirty, when the picture changes.
+     *
+     * @param renderer Renderer of the texture.
+     * @return true if a new frame was uploaded.
+     */
+    bool update(SDL_Renderer* renderer);
+
+    // Texture of the shown frame (IYUV, or RGB converted by the engine), nullptr before the first update
+    SDL_Texture* get_texture() const { return texture; }
+
+    /**
+     * @brief Records the shown frame into the Render_queue as one quad.
+     *
+     * @param dst   Screen rectangle.
+     * @param layer Draw order layer.
+     */
+    void draw(const SDL_FRect& dst, int layer = 0) const;
+
+    // === PLAYBACK ===
+
+
+    // Frame number of the shown frame, -1 before the first one
+    std::int64_t get_shown_frame() const { return shown_frame; }
+
+    // Frames skipped by the decoder or dropped by update(), because they were late
+    std::uint32_t get_dropped_count() const;
+
+
+private:
+
+    struct Frame_slot
+    {
+        std::vector<Uint8> pixels;
+
+        std::uint32_t frame = 0;
+        std::uint32_t generation = 0;
+    };
+
+
+    // Header of the source - false if it is not a 4:2:0 YUV4MPEG2 stream of the plain frames
+    bool open_source();
+
+    static int SDLCALL decoder_main(void* userdata);
+    void decode();
+
+    // Decoder side - reads the next frame into the slot, false at the end of the stream
+    bool read_frame(Frame_slot& slot);
+
+    // Main side - gives the slot back to the decoder
+    void recycle(std::uint8_t slot);
+
+    // The renderer has the IYUV textures natively (not through the SDL software conversion)
+    static bool samples_yuv(SDL_Renderer* renderer);
+
+    // Position of the attached audio in seconds
+    double audio_time() const;
+
+
+    SDL_RWops* source = nullptr;
+
+    int width = 0;
+    int height = 0;
+    std::uint32_t rate_num = 0;
+    std::uint32_t rate_den = 1;
+
+    // Planes of one frame, the first frame header and the stride of the frames -
+    // the frame N is at data_offset + N * frame_stride, the seek is one call
+    size_t frame_bytes = 0;
+    Sint64 data_offset = 0;
+    Sint64 frame_stride = 0;
+
+    std::uint32_t frame_count = 0;
+
+    SDL_Thread* decoder = nullptr;
+    std::atomic<bool> running{false};
+
+    // Rewind request - the decoder starts over, the queued frames of the older generation are dropped
+    std::atomic<std::uint32_t> generation{0};
+
+    // First frame, which is not late - the decoder skips to it
+    std::atomic<std::uint32_t> wanted_frame{0};
+
+    std::atomic<std::uint32_t> dropped{0};
+
+    // Decoder state
+    std::uint32_t decoder_generation = 0;
+    std::uint32_t next_frame = 0;
+
+    // Slot taken from the free ring, not filled yet (-1 - none)
+    int decoder_slot = -1;
+
+    Frame_slot slots[FRAME_QUEUE];
+
+    // Main -> decoder (empty slots) and decoder -> main (decoded slots)
+    Spsc_ring<std::uint8_t, FRAME_QUEUE> free_slots;
+    Spsc_ring<std::uint8_t, FRAME_QUEUE> decoded_slots;
+
+    // Main side - a decoded slot, which isn't due yet (-1 - none)
+    int pending = -1;
+
+    SDL_Texture* texture = nullptr;
+    Uint32 texture_format = SDL_PIXELFORMAT_UNKNOWN;
+    std::int64_t shown_frame = -1;
+
+    // Clock
+    Audio_instance* audio = nullptr;
+    bool playing = false;
+    double paused_time = 0.0;
+    Uint64 started_at = 0;
+
+    // Audio position smoothing - the mixer reports it once per callback buffer
+    mutable std::uint64_t audio_position = 0;
+    mutable std::uint64_t audio_position_clock = 0;
+};
+
+// =========================================================================================== VIDEO ASSET
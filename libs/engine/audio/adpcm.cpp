@@ -0,0 +1,217 @@
+// adpcm.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "adpcm.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== IMA ADPCM
+
+static const std::int32_t index_table[16] = { -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8 };
+
+static const std::int32_t step_table[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+
+// The decoder step - the encoder runs it too, so both states stay identical
+static inline std::int16_t decode_nibble(Adpcm_channel& c, std::uint32_t nibble)
+{
+    const std::int32_t step = step_table[c.index];
+
+    std::int32_t diff = step >> 3;
+
+    if (nibble & 1) diff += step >> 2;
+    if (nibble & 2) diff += step >> 1;
+    if (nibble & 4) diff += step;
+
+    c.predictor += (nibble & 8) ? -diff : diff;
+
+    if (c.predictor > 32767) c.predictor = 32767;
+    else if (c.predictor < -32768) c.predictor = -32768;
+
+    c.index += index_table[nibble];
+
+    if (c.index < 0) c.index = 0;
+    else if (c.index > 88) c.index = 88;
+
+    return static_cast<std::int16_t>(c.predictor);
+}
+
+
+static inline std::uint32_t encode_sample(Adpcm_channel& c, std::int32_t sample)
+{
+    std::int32_t diff = sample - c.predictor;
+    std::int32_t step = step_table[c.index];
+
+    std::uint32_t nibble = 0;
+
+    if (diff < 0)
+    {
+        nibble = 8;
+        diff = -diff;
+    }
+
+    if (diff >= step) { nibble |= 4; diff -= step; }
+    step >>= 1;
+    if (diff >= step) { nibble |= 2; diff -= step; }
+    step >>= 1;
+    if (diff >= step) nibble |= 1;
+
+    decode_nibble(c, nibble);
+
+    return nibble;
+}
+
+
+static inline void read_header(const std::uint8_t* block, std::uint32_t channels, Adpcm_channel* state)
+{
+    for (std::uint32_t ch = 0; ch < channels; ++ch)
+    {
+        const std::uint8_t* h = block + ch * ADPCM_HEADER_BYTES;
+
+        state[ch].predictor = static_cast<std::int16_t>(h[0] | (h[1] << 8));
+        state[ch].index = h[2] > 88 ? 88 : h[2];
+    }
+}
+
+
+// Nibble of the frame (and the channel) inside its block
+static inline std::uint32_t read_nibble(const std::uint8_t* block, std::uint32_t channels, int frame, std::uint32_t ch)
+{
+    const std::uint8_t* nibbles = block + channels * ADPCM_HEADER_BYTES;
+
+    const std::uint8_t byte = channels == 2 ? nibbles[frame] : nibbles[frame >> 1];
+    const bool high = channels == 2 ? ch == 1 : (frame & 1) != 0;
+
+    return high ? byte >> 4 : byte & 0x0F;
+}
+
+
+std::size_t adpcm_encoded_size(std::uint64_t frames, std::uint32_t channels)
+{
+    const std::uint64_t blocks = (frames + ADPCM_BLOCK_FRAMES - 1) / ADPCM_BLOCK_FRAMES;
+
+    return static_cast<std::size_t>(blocks) * adpcm_block_bytes(channels);
+}
+
+
+std::vector<std::uint8_t> adpcm_encode(const std::int16_t* pcm, std::uint64_t frames, std::uint32_t channels)
+{
+    std::vector<std::uint8_t> out;
+
+    if (!pcm || channels < 1 || channels > 2) return out;
+
+    out.assign(adpcm_encoded_size(frames, channels), 0);
+
+    // The first predictor is the first sample and the first step fits the first
+    // difference - the step doesn't have to adapt from the smallest one (the attack)
+    Adpcm_channel state[2];
+
+    for (std::uint32_t ch = 0; ch < channels && frames; ++ch)
+    {
+        state[ch].predictor = pcm[ch];
+
+        const std::int32_t delta = frames > 1 ? pcm[channels + ch] - pcm[ch] : 0;
+        const std::int32_t magnitude = delta < 0 ? -delta : delta;
+
+        while (state[ch].index < 88 && step_table[state[ch].index] < magnitude) ++state[ch].index;
+    }
+
+    const std::size_t block_bytes = adpcm_block_bytes(channels);
+
+    for (std::uint64_t f = 0; f < frames; ++f)
+    {
+        const int in_block = static_cast<int>(f % ADPCM_BLOCK_FRAMES);
+
+        std::uint8_t* block = out.data() + (f / ADPCM_BLOCK_FRAMES) * block_bytes;
+
+        if (in_block == 0)
+        {
+            for (std::uint32_t ch = 0; ch < channels; ++ch)
+            {
+                std::uint8_t* h = block + ch * ADPCM_HEADER_BYTES;
+
+                h[0] = static_cast<std::uint8_t>(state[ch].predictor & 0xFF);
+                h[1] = static_cast<std::uint8_t>((state[ch].predictor >> 8) & 0xFF);
+                h[2] = static_cast<std::uint8_t>(state[ch].index);
+                h[3] = 0;
+            }
+        }
+
+        std::uint8_t* nibbles = block + channels * ADPCM_HEADER_BYTES;
+
+        for (std::uint32_t ch = 0; ch < channels; ++ch)
+        {
+            const std::uint32_t nibble = encode_sample(state[ch], pcm[f * channels + ch]);
+
+            std::uint8_t& byte = channels == 2 ? nibbles[in_block] : nibbles[in_block >> 1];
+            const bool high = channels == 2 ? ch == 1 : (in_block & 1) != 0;
+
+            byte = static_cast<std::uint8_t>(byte | (high ? nibble << 4 : nibble));
+        }
+    }
+
+    return out;
+}
+
+
+void adpcm_seek(const std::uint8_t* data, std::uint32_t channels, std::uint64_t frame, Adpcm_channel* state)
+{
+    const std::uint8_t* block = data + (frame / ADPCM_BLOCK_FRAMES) * adpcm_block_bytes(channels);
+
+    read_header(block, channels, state);
+
+    const int skip = static_cast<int>(frame % ADPCM_BLOCK_FRAMES);
+
+    for (int f = 0; f < skip; ++f)
+        for (std::uint32_t ch = 0; ch < channels; ++ch) decode_nibble(state[ch], read_nibble(block, channels, f, ch));
+}
+
+
+void adpcm_decode(const std::uint8_t* data, std::uint32_t channels, std::uint64_t frame, int frames,
+                  Adpcm_channel* state, std::int16_t* out)
+{
+    const std::size_t block_bytes = adpcm_block_bytes(channels);
+
+    int done = 0;
+
+    while (done < frames)
+    {
+        const int in_block = static_cast<int>(frame % ADPCM_BLOCK_FRAMES);
+        const std::uint8_t* block = data + (frame / ADPCM_BLOCK_FRAMES) * block_bytes;
+
+        // Each block restarts from its header (the same state) - any block decodes on its own
+        if (in_block == 0) read_header(block, channels, state);
+
+        const int n = frames - done < ADPCM_BLOCK_FRAMES - in_block ? frames - done : ADPCM_BLOCK_FRAMES - in_block;
+
+        const std::uint8_t* nibbles = block + channels * ADPCM_HEADER_BYTES;
+
+        if (channels == 2)
+        {
+            for (int f = in_block; f < in_block + n; ++f)
+            {
+                *out++ = decode_nibble(state[0], nibbles[f] & 0x0F);
+                *out++ = decode_nibble(state[1], nibbles[f] >> 4);
+            }
+        }
+        else
+        {
+            for (int f = in_block; f < in_block + n; ++f)
+                *out++ = decode_nibble(state[0], (f & 1) ? nibbles[f >> 1] >> 4 : nibbles[f >> 1] & 0x0F);
+        }
+
+        frame += static_cast<std::uint64_t>(n);
+        done += n;
+    }
+}
+
+// =========================================================================================== IMA ADPCM
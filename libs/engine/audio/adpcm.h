@@ -0,0 +1,83 @@
+// adpcm.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== IMA ADPCM
+
+/**
+ * IMA-ADPCM codec of the in-memory sound effects - 4 bits per sample, a quarter
+ * of the 16-bit PCM.
+ *
+ * The data is a row of independent blocks of ADPCM_BLOCK_FRAMES frames. Every block
+ * starts with the decoder state of each channel (4 bytes: the predictor, int16 LE,
+ * the step index and a padding byte), the nibbles of its frames follow:
+ *
+ *     mono   - two frames per byte, the earlier one in the low nibble
+ *     stereo - one frame per byte, the left channel in the low nibble
+ *
+ * The block header is the exact state of the encoder, so any frame is reachable by
+ * decoding less than one block from the header before it - the mixer seeks and loops
+ * the compressed audio without a decode from the start. The last block could be
+ * shorter, its unused nibbles are zero.
+ *
+ * The decoder runs in the audio callback: no allocation, a few integer operations
+ * per sample, the state is a few bytes per channel (Adpcm_channel).
+ */
+
+
+// Frames of one block - even, so a mono block is whole bytes
+static constexpr int ADPCM_BLOCK_FRAMES = 256;
+
+// Header bytes of one channel at the block start
+static constexpr int ADPCM_HEADER_BYTES = 4;
+
+
+// Decoder state of one channel
+struct Adpcm_channel
+{
+    std::int32_t predictor = 0;
+    std::int32_t index = 0;
+};
+
+
+// Bytes of one full block
+inline std::size_t adpcm_block_bytes(std::uint32_t channels)
+{
+    return channels * ADPCM_HEADER_BYTES + static_cast<std::size_t>(ADPCM_BLOCK_FRAMES) * channels / 2;
+}
+
+// Bytes of the encoded frames (whole blocks)
+std::size_t adpcm_encoded_size(std::uint64_t frames, std::uint32_t channels);
+
+
+/**
+ * @brief Encodes the interleaved 16-bit PCM (mono or stereo).
+ *
+ * @return The blocks, empty if the channels are not 1 or 2.
+ */
+std::vector<std::uint8_t> adpcm_encode(const std::int16_t* pcm, std::uint64_t frames, std::uint32_t channels);
+
+
+// Decoder state at the frame - the block header, then the frames before it in the block
+void adpcm_seek(const std::uint8_t* data, std::uint32_t channels, std::uint64_t frame, Adpcm_channel* state);
+
+/**
+ * @brief Decodes the frames from the frame, the state is the one at the frame (adpcm_seek()).
+ *
+ * The state moves to the frame after them - the next call continues without a seek.
+ *
+ * @param out Interleaved 16-bit PCM of frames * channels samples.
+ */
+void adpcm_decode(const std::uint8_t* data, std::uint32_t channels, std::uint64_t frame, int frames,
+                  Adpcm_channel* state, std::int16_t* out);
+
+// =========================================================================================== IMA ADPCM
@@ -0,0 +1,1352 @@
+// audio_mixer.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "audio_mixer.h"
+#include "mix_kernels.h"
+#include "../asset/asset_instance.h"
+#include "../asset/streaming_audio.h"
+#include "../engine_clock/engine_clock.h"
+#include "../thread_roles/thread_roles.h"
+#include "../zone_profiler/zone_profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== AUDIO MIXER
+
+Audio_mixer& Audio_mixer::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Audio_mixer instance;
+
+    return instance;
+}
+
+
+Audio_mixer::~Audio_mixer() { close(); }
+
+
+bool Audio_mixer::open(int rate, int requested_frames)
+{
+    if (device) return true;
+
+    if (SDL_InitSubSystem(SDL_INIT_AUDIO) != 0)
+    {
+        SDL_Log("Audio init failed, no sound: %s", SDL_GetError());
+        return false;
+    }
+
+    SDL_AudioSpec want;
+    SDL_zero(want);
+
+    want.freq = rate;
+    want.format = AUDIO_S16SYS;
+    want.channels = 2;
+    want.samples = static_cast<Uint16>(requested_frames);
+    want.callback = audio_callback;
+    want.userdata = this;
+
+    SDL_AudioSpec have;
+
+    // The thread of the new device takes the role again
+    role_applied = false;
+
+    // The device rate is taken as is (SDL doesn't resample every callback then) - the assets
+    // are converted to it once at the load. The format and the channels stay S16 stereo,
+    // what the mixer writes.
+    device = Platform::Audio::open(want, have);
+
+    if (!device)
+    {
+        SDL_Log("Audio device open failed, no sound: %s", SDL_GetError());
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        return false;
+    }
+
+    sample_rate = have.freq;
+    buffer_frames = have.samples;
+
+    if (have.freq != rate) SDL_Log("Audio device runs at %d Hz, the audio is converted to it on the load", have.freq);
+
+    // The callback buffer could be larger than requested - the accumulator is sized once
+    accumulator.assign(static_cast<size_t>(std::max<int>(have.samples, requested_frames)) * 2, 0);
+
+    for (Voice& v : voices) v = Voice{};
+    for (Voice_owner& o : owners) o = Voice_owner{};
+
+    master_volume = UNITY_VOLUME;
+
+    scheduled_count = 0;
+    clock = 0;
+
+    clock_sequence.store(0);
+    published_clock.store(0);
+    published_counter.store(Engine_clock::now());
+
+    for (std::atomic<uint64_t>& word : voice_cursors) word.store(0);
+
+    counter_frequency = Engine_clock::frequency();
+    previous_start = 0;
+
+    reset_timing();
+
+    commands.reset();
+    events.reset();
+
+    Platform::Audio::pause(device, false);
+
+    return true;
+}
+
+
+void Audio_mixer::close()
+{
+    if (!device) return;
+
+    Platform::Audio::close(device);
+    device = 0;
+
+    drain_events();
+
+    // The play positions are kept - the instances resume from them after a reopen
+    for (int i = 0; i < MAX_VOICES; ++i)
+    {
+        if (owners[i].instance) detach(i, published_position(i));
+
+        owners[i] = Voice_owner{};
+
+        // The next device may have another rate - the assets are warmed for it again
+        reserved[i] = nullptr;
+    }
+
+    // Released here - the allocator can be gone by the static destruction
+    accumulator = std::vector<int32_t, Std_allocator<int32_t>>(accumulator.get_allocator());
+
+    SDL_QuitSubSystem(SDL_INIT_AUDIO);
+}
+
+
+bool Audio_mixer::set_allocator(Allocator& allocator)
+{
+    if (device) return false;
+
+    accumulator = std::vector<int32_t, Std_allocator<int32_t>>(Std_allocator<int32_t>(allocator));
+
+    return true;
+}
+
+
+bool Audio_mixer::is_open() const { return device != 0; }
+
+
+int Audio_mixer::get_sample_rate() const { return sample_rate; }
+
+
+int Audio_mixer::get_buffer_frames() const { return buffer_frames; }
+
+
+void Audio_mixer::update() { drain_events(); }
+
+
+// === PLAYBACK (main thread, used by the Audio_instance) ===
+
+bool Audio_mixer::play(Audio_instance* instance, bool loop) { return play_at(instance, 0, loop); }
+
+
+bool Audio_mixer::play_at(Audio_instance* instance, uint64_t sample_clock, bool loop)
+{
+    if (!device || !instance) return false;
+
+    if (find_voice(instance) >= 0) return true;
+
+    const Audio_asset* asset = static_cast<const Audio_asset*>(instance->get_main_asset_link());
+
+    if (!check_playable(asset)) return false;
+
+    Streaming_audio* stream = asset->is_streaming() ? static_cast<Streaming_audio*>(const_cast<Audio_asset*>(asset)) : nullptr;
+
+    // One decoder, one play position - a stream plays in one voice
+    if (stream)
+    {
+        for (const Voice_owner& o : owners)
+        {
+            if (o.asset == asset && o.instance)
+            {
+                SDL_Log("Audio stream %s is already playing", asset->get_path().c_str());
+                return false;
+            }
+        }
+    }
+
+    const int voice = take_voice(instance->priority, asset);
+
+    if (voice < 0) return false;
+
+    // The trim and the loop points, clamped to the data (the length is rounded to milliseconds)
+    const Audio_view view = instance->get_view();
+
+    uint64_t cursor = instance->current_playtime_sample;
+
+    if (cursor < view.start || cursor >= view.end) cursor = view.start;
+
+    Command command = play_command(view, cursor, loop, sample_clock);
+
+    command.stream = stream;
+
+    // The decoder starts filling the ring, while the command is on its way
+    if (stream)
+    {
+        command.stream_generation = loop ? stream->restart(cursor, view.loop_start, view.loop_end, true) :
+                                           stream->restart(cursor, view.start, view.end, false);
+    }
+
+    if (!start_voice(voice, asset, command, instance->volume)) return false;
+
+    Voice_owner& o = owners[voice];
+
+    o.instance = instance;
+    o.position = cursor;
+    o.looping = loop;
+    o.priority = instance->priority;
+
+    return true;
+}
+
+
+bool Audio_mixer::play_oneshot(const Audio_asset* asset, unsigned int volume, int priority, uint64_t sample_clock)
+{
+    if (!device || !check_playable(asset)) return false;
+
+    return play_view_oneshot(asset, asset->get_view(), volume, priority, sample_clock);
+}
+
+
+bool Audio_mixer::play_region_oneshot(const Audio_asset* asset, int region_index, unsigned int volume, int priority,
+                                      uint64_t sample_clock)
+{
+    if (!device || !check_playable(asset)) return false;
+
+    // The region frames are at the asset rate - taken after the conversion of check_playable()
+    const Audio_region* region = asset->get_region(region_index);
+
+    if (!region) return false;
+
+    return play_view_oneshot(asset, asset->get_view(region->start, region->end), volume, priority, sample_clock);
+}
+
+
+bool Audio_mixer::play_view_oneshot(const Audio_asset* asset, const Audio_view& view, unsigned int volume, int priority,
+                                    uint64_t sample_clock)
+{
+    if (asset->is_streaming())
+    {
+        SDL_Log("Audio stream %s plays by its instance, not as a one-shot", asset->get_path().c_str());
+        return false;
+    }
+
+    const int voice = take_voice(priority, asset);
+
+    if (voice < 0) return false;
+
+    const Command command = play_command(view, view.start, false, sample_clock);
+
+    if (!start_voice(voice, asset, command, std::min(volume, 100u))) return false;
+
+    owners[voice].oneshot = true;
+    owners[voice].priority = priority;
+
+    return true;
+}
+
+
+Audio_mixer::Command Audio_mixer::play_command(const Audio_view& view, uint64_t cursor, bool loop, uint64_t sample_clock)
+{
+    Command command{};
+
+    command.type = Command_type::PLAY;
+    command.samples = view.samples;
+    command.adpcm = view.adpcm;
+    command.channels = view.channels;
+    command.start = view.start;
+    command.end = view.end;
+    command.loop_start = view.loop_start;
+    command.loop_end = view.loop_end;
+    command.loop = loop;
+    command.value = cursor;
+    command.at = sample_clock;
+    command.requested = sample_clock ? 0 : Engine_clock::now();
+
+    return command;
+}
+
+
+void Audio_mixer::pause(Audio_instance* instance)
+{
+    const int voice = find_voice(instance);
+
+    if (voice >= 0) release_voice(voice, Command_type::PAUSE);
+}
+
+
+void Audio_mixer::stop(Audio_instance* instance) { stop_at(instance, 0); }
+
+
+void Audio_mixer::stop_at(Audio_instance* instance, uint64_t sample_clock)
+{
+    if (!instance) return;
+
+    const int voice = find_voice(instance);
+
+    if (voice >= 0) release_voice(voice, Command_type::STOP, sample_clock);
+
+    instance->current_playtime_sample = instance->start_sample;
+}
+
+
+void Audio_mixer::seek(Audio_instance* instance, uint64_t sample)
+{
+    if (!instance) return;
+
+    instance->current_playtime_sample = std::max(instance->start_sample, std::min(sample, instance->end_sample));
+
+    const int voice = find_voice(instance);
+
+    if (voice < 0) return;
+
+    Command command{};
+
+    command.type = Command_type::SEEK;
+    command.voice = voice;
+    command.value = instance->current_playtime_sample;
+    command.serial = owners[voice].serial;
+    command.epoch = next_epoch++;
+
+    // The stream decodes from the byte offset of the position, the queued chunks are dropped
+    if (owners[voice].asset->is_streaming())
+    {
+        Streaming_audio* stream = static_cast<Streaming_audio*>(const_cast<Audio_asset*>(owners[voice].asset));
+
+        const Audio_view view = instance->get_view();
+
+        command.stream_generation = owners[voice].looping ? stream->restart(command.value, view.loop_start, view.loop_end, true) :
+                                                            stream->restart(command.value, view.start, view.end, false);
+    }
+
+    if (!push(command)) return;
+
+    owners[voice].position = instance->current_playtime_sample;
+    owners[voice].epoch = command.epoch;
+}
+
+
+void Audio_mixer::set_volume(Audio_instance* instance, unsigned int volume) { set_volume_at(instance, volume, 0); }
+
+
+void Audio_mixer::set_volume_at(Audio_instance* instance, unsigned int volume, uint64_t sample_clock)
+{
+    if (!instance) return;
+
+    instance->volume = std::min(volume, 100u);
+
+    const int voice = find_voice(instance);
+
+    if (voice < 0) return;
+
+    Command command{};
+
+    command.type = Command_type::VOLUME;
+    command.voice = voice;
+    command.value = static_cast<uint64_t>(instance->volume) * UNITY_VOLUME / 100;
+    command.serial = owners[voice].serial;
+    command.at = sample_clock;
+
+    if (push(command)) owners[voice].volume = instance->volume;
+}
+
+
+bool Audio_mixer::is_playing(const Audio_instance* instance) const { return find_voice(instance) >= 0; }
+
+
+uint64_t Audio_mixer::get_position(const Audio_instance* instance) const
+{
+    const int voice = find_voice(instance);
+
+    if (voice >= 0) return published_position(voice);
+
+    return instance ? instance->current_playtime_sample : 0;
+}
+
+
+void Audio_mixer::stop_asset(const Audio_asset* asset)
+{
+    if (!asset) return;
+
+    // The asset is going - its voices are free for the others
+    release_voices(asset);
+
+    if (!device) return;
+
+    for (int i = 0; i < MAX_VOICES; ++i)
+    {
+        if (owners[i].asset != asset) continue;
+
+        if (owners[i].instance || owners[i].oneshot) release_voice(i, Command_type::PAUSE);
+
+        // Released by a stop in the future - stopped at once, the scheduled stop is ignored
+        else if (owners[i].releasing)
+        {
+            Command command{};
+
+            command.type = Command_type::STOP;
+            command.voice = i;
+            command.serial = owners[i].serial;
+
+            push(command);
+        }
+    }
+
+    // Every callback applies the commands before the mix - the confirmation comes
+    // within one buffer, unless the device is stalled
+    const Uint64 deadline = SDL_GetTicks64() + 500;
+
+    for (;;)
+    {
+        drain_events();
+
+        bool waiting = false;
+
+        for (const Voice_owner& o : owners)
+            if (o.asset == asset && o.releasing) waiting = true;
+
+        if (!waiting) return;
+
+        if (SDL_GetTicks64() > deadline) break;
+
+        SDL_Delay(1);
+    }
+
+    // Stalled device - the callback, which could still read the PCM, is waited out
+    SDL_Log("Audio device doesn't confirm the stop - waiting for the callback");
+
+    Platform::Audio::lock(device);
+    Platform::Audio::unlock(device);
+
+    for (Voice_owner& o : owners)
+        if (o.asset == asset && o.releasing) o = Voice_owner{};
+}
+
+// === PLAYBACK (main thread, used by the Audio_instance) ===
+
+
+// === SAMPLE CLOCK ===
+
+void Audio_mixer::read_clock(uint64_t& frames, Uint64& counter) const
+{
+    // Seqlock - retried, while the callback publishes (the writer never waits)
+    for (;;)
+    {
+        const uint32_t before = clock_sequence.load(std::memory_order_acquire);
+
+        frames = published_clock.load(std::memory_order_relaxed);
+        counter = published_counter.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (!(before & 1) && clock_sequence.load(std::memory_order_relaxed) == before) return;
+    }
+}
+
+
+uint64_t Audio_mixer::get_sample_clock() const { return counter_to_sample_clock(Engine_clock::now()); }
+
+
+uint64_t Audio_mixer::counter_to_sample_clock(Uint64 counter) const
+{
+    if (!device) return 0;
+
+    uint64_t frames = 0;
+    Uint64 mixed_at = 0;
+
+    read_clock(frames, mixed_at);
+
+    const Uint64 frequency = Engine_clock::frequency();
+    const uint64_t rate = static_cast<uint64_t>(sample_rate);
+
+    // Whole seconds and the rest separately - exact, without the 64-bit overflow
+    const Uint64 delta = counter > mixed_at ? counter - mixed_at : mixed_at - counter;
+    const uint64_t offset = delta / frequency * rate + delta % frequency * rate / frequency;
+
+    if (counter < mixed_at) return offset < frames ? frames - offset : 0;
+
+    // Never ahead of the next buffer - a stalled device doesn't run the clock away
+    return frames + std::min<uint64_t>(offset, static_cast<uint64_t>(buffer_frames));
+}
+
+
+uint64_t Audio_mixer::get_schedule_horizon() const
+{
+    if (!device) return 0;
+
+    uint64_t frames = 0;
+    Uint64 mixed_at = 0;
+
+    read_clock(frames, mixed_at);
+
+    // The buffer after the next one - the next could start, before a command is pushed
+    return frames + 2 * static_cast<uint64_t>(buffer_frames);
+}
+
+
+int Audio_mixer::get_schedule_lead() const { return 2 * buffer_frames; }
+
+
+uint64_t Audio_mixer::published_position(int voice) const
+{
+    const Voice_owner& o = owners[voice];
+
+    const uint64_t word = voice_cursors[voice].load(std::memory_order_relaxed);
+
+    // The play or the seek isn't mixed yet (on its way, or scheduled) - its own position
+    if (((word >> CURSOR_BITS) & EPOCH_MASK) != (o.epoch & EPOCH_MASK)) return o.position;
+
+    // Stopped by the callback (the end, or the pause) - the cursor itself
+    if (!(word & PLAYING_BIT)) return word & CURSOR_MASK;
+
+    // Playing - the cursor runs with the sample clock: the sign extended offset moves it on by
+    // the time since the buffer (a word and a clock of the neighbour buffers agree, if it played through).
+    // Closed - the clock the callback ended at, the last word is of its last buffer
+    const int64_t offset = static_cast<int64_t>(word << (64 - CURSOR_BITS)) >> (64 - CURSOR_BITS);
+
+    uint64_t position = (device ? get_sample_clock() : clock) + static_cast<uint64_t>(offset);
+
+    if (!o.instance) return position;
+
+    const Audio_view view = o.instance->get_view();
+
+    if (o.looping && view.loop_end > view.loop_start)
+    {
+        if (position >= view.loop_end) position = view.loop_start + (position - view.loop_end) % (view.loop_end - view.loop_start);
+    }
+    else position = std::min(position, view.end);
+
+    return position;
+}
+
+// === SAMPLE CLOCK ===
+
+
+void Audio_mixer::set_master_volume(unsigned int volume)
+{
+    Command command{};
+
+    command.type = Command_type::MASTER_VOLUME;
+    command.voice = 0;
+    command.value = static_cast<uint64_t>(std::min(volume, 100u)) * UNITY_VOLUME / 100;
+
+    if (device) push(command);
+    else master_volume = static_cast<int>(command.value);
+}
+
+
+int Audio_mixer::get_active_voice_count() const
+{
+    int count = 0;
+
+    for (int i = 0; i < MAX_VOICES; ++i)
+        if (owners[i].instance || owners[i].oneshot) ++count;
+
+    return count;
+}
+
+
+void Audio_mixer::set_voice_limit(int limit) { voice_limit = std::max(1, std::min(limit, MAX_VOICES)); }
+
+
+int Audio_mixer::get_voice_limit() const { return voice_limit; }
+
+
+int Audio_mixer::get_stolen_voice_count() const { return stolen_voices; }
+
+
+// === VOICE RESERVATION ===
+
+int Audio_mixer::reserve_voices(const Audio_asset* asset, int count)
+{
+    if (!device || !asset || asset->is_streaming()) return 0;
+
+    // The read and the conversion of the first play, done now
+    if (!check_playable(asset)) return 0;
+
+    int kept = 0;
+
+    for (int i = 0; i < voice_limit; ++i)
+        if (reserved[i] == asset) ++kept;
+
+    // Only the free voices - the playing ones aren't taken from their sounds
+    for (int i = 0; i < voice_limit && kept < count; ++i)
+    {
+        const Voice_owner& o = owners[i];
+
+        if (reserved[i] || o.instance || o.oneshot || o.releasing) continue;
+
+        reserved[i] = asset;
+        ++kept;
+    }
+
+    if (kept < count) SDL_Log("Audio %s: %d of %d voices reserved", asset->get_path().c_str(), kept, count);
+
+    return kept;
+}
+
+
+void Audio_mixer::release_voices(const Audio_asset* asset)
+{
+    for (int i = 0; i < MAX_VOICES; ++i)
+        if (reserved[i] == asset) reserved[i] = nullptr;
+}
+
+
+int Audio_mixer::get_reserved_voice_count() const
+{
+    int count = 0;
+
+    for (int i = 0; i < MAX_VOICES; ++i)
+        if (reserved[i]) ++count;
+
+    return count;
+}
+
+// === VOICE RESERVATION ===
+
+
+// === INSTRUMENTATION ===
+
+Audio_timing Audio_mixer::get_timing() const
+{
+    Audio_timing t;
+
+    t.sample_rate = sample_rate;
+    t.buffer_frames = buffer_frames;
+    t.buffer_ms = sample_rate ? buffer_frames * 1000.0 / sample_rate : 0.0;
+
+    t.callbacks = timing_callbacks.load(std::memory_order_relaxed);
+
+    for (int b = 0; b < Audio_timing::BUCKETS; ++b) t.buckets[b] = timing_buckets[b].load(std::memory_order_relaxed);
+
+    if (t.callbacks) t.mean_callback_us = static_cast<double>(timing_total_us.load(std::memory_order_relaxed)) / t.callbacks;
+
+    t.max_callback_us = static_cast<double>(timing_max_us.load(std::memory_order_relaxed));
+
+    t.underruns = timing_underruns.load(std::memory_order_relaxed);
+    t.stream_underruns = timing_stream_underruns.load(std::memory_order_relaxed);
+
+    t.latency_samples = latency_count.load(std::memory_order_relaxed);
+
+    if (t.latency_samples)
+    {
+        t.min_latency_ms = latency_min_us.load(std::memory_order_relaxed) / 1000.0;
+        t.mean_latency_ms = static_cast<double>(latency_total_us.load(std::memory_order_relaxed)) / t.latency_samples / 1000.0;
+        t.max_latency_ms = latency_max_us.load(std::memory_order_relaxed) / 1000.0;
+    }
+
+    return t;
+}
+
+
+void Audio_mixer::reset_timing()
+{
+    timing_callbacks.store(0, std::memory_order_relaxed);
+
+    for (std::atomic<uint64_t>& b : timing_buckets) b.store(0, std::memory_order_relaxed);
+
+    timing_total_us.store(0, std::memory_order_relaxed);
+    timing_max_us.store(0, std::memory_order_relaxed);
+    timing_underruns.store(0, std::memory_order_relaxed);
+    timing_stream_underruns.store(0, std::memory_order_relaxed);
+
+    latency_count.store(0, std::memory_order_relaxed);
+    latency_total_us.store(0, std::memory_order_relaxed);
+    latency_min_us.store(UINT64_MAX, std::memory_order_relaxed);
+    latency_max_us.store(0, std::memory_order_relaxed);
+}
+
+
+// Plain text, like the state machine profile - times in microseconds, the latency in ms
+
+void Audio_mixer::dump_timing(std::ostream& out) const
+{
+    const Audio_timing t = get_timing();
+
+    out << "=== Audio timing ===\n";
+
+    if (!t.callbacks)
+    {
+        out << "No callbacks (no audio device)\n";
+        return;
+    }
+
+    out << "Device: " << t.sample_rate << " Hz, " << t.buffer_frames << " frames (" << t.buffer_ms << " ms) per buffer\n"
+        << "Callbacks: " << t.callbacks << ", mean " << t.mean_callback_us << " us, max " << t.max_callback_us << " us\n"
+        << "Underruns: " << t.underruns << " device, " << t.stream_underruns << " stream\n";
+
+    if (t.latency_samples)
+        out << "Play latency: " << t.latency_samples << " plays, min " << t.min_latency_ms << " ms, mean "
+            << t.mean_latency_ms << " ms, max " << t.max_latency_ms << " ms\n";
+
+    out << "Callback duration histogram (us):\n";
+
+    for (int b = 0; b < Audio_timing::BUCKETS; ++b)
+    {
+        if (t.buckets[b] == 0) continue;
+
+        out << "  [" << (b == 0 ? 0u : 1u << b) << ", ";
+
+        if (b == Audio_timing::BUCKETS - 1) out << "inf";
+        else out << (1u << (b + 1));
+
+        out << "): " << t.buckets[b] << "\n";
+    }
+}
+
+// === INSTRUMENTATION ===
+
+
+// === MAIN THREAD SIDE ===
+
+bool Audio_mixer::push(const Command& command)
+{
+    if (commands.push(command)) return true;
+
+    SDL_Log("Audio command queue is full - the command is dropped");
+    return false;
+}
+
+
+void Audio_mixer::drain_events()
+{
+    Event e;
+
+    while (events.pop(e))
+    {
+        Voice_owner& o = owners[e.voice];
+
+        // Reports of an older play of the voice
+        if (o.serial != e.serial) continue;
+
+        switch (e.type)
+        {
+            // Played to the end - the next play starts from the trim start
+            case Event_type::FINISHED:
+                if (o.instance) detach(e.voice, o.instance->start_sample);
+                o = Voice_owner{};
+                break;
+
+            // Confirmed pause or stop - the voice could be reused
+            case Event_type::STOPPED:
+                if (!o.instance && !o.oneshot) o = Voice_owner{};
+                break;
+        }
+    }
+}
+
+
+bool Audio_mixer::check_playable(const Audio_asset* asset) const
+{
+    if (!asset) return false;
+
+    // Cooked and not read yet - the first play reads the samples
+    if (!asset->is_streaming()) const_cast<Audio_asset*>(asset)->load_data();
+
+    // Loaded before the mixer was open (or by another rate) - converted once, here
+    if (!asset->is_streaming() && !asset->matches_output() && !const_cast<Audio_asset*>(asset)->convert_to_output())
+        return false;
+
+    const bool s16 = asset->get_format() == AUDIO_S16SYS;
+    const unsigned int channels = asset->get_channels();
+
+    const Streaming_audio* stream = asset->is_streaming() ? static_cast<const Streaming_audio*>(asset) : nullptr;
+
+    if (!s16 || channels < 1 || channels > 2 || asset->get_sample_rate() != static_cast<unsigned int>(sample_rate) ||
+        (stream ? !stream->is_open() : asset->get_storage_bytes() == 0))
+    {
+        SDL_Log("Audio %s is not S16 mono/stereo at %d Hz - cook it for the mixer", asset->get_path().c_str(), sample_rate);
+        return false;
+    }
+
+    return true;
+}
+
+
+
+int Audio_mixer::take_voice(int priority, const Audio_asset* asset)
+{
+    int victim = -1;
+    int free_voice = -1;
+
+    for (int i = 0; i < voice_limit; ++i)
+    {
+        const Voice_owner& o = owners[i];
+
+        // Kept for another sound
+        if (o.releasing || (reserved[i] && reserved[i] != asset)) continue;
+
+        if (!o.instance && !o.oneshot)
+        {
+            // A voice of its own - no further search
+            if (reserved[i]) return i;
+
+            if (free_voice < 0) free_voice = i;
+            continue;
+        }
+
+        if (o.priority > priority) continue;
+
+        // The lowest priority, the quietest, the oldest play
+        if (victim < 0) victim = i;
+        else
+        {
+            const Voice_owner& v = owners[victim];
+
+            if (o.priority != v.priority ? o.priority < v.priority :
+                o.volume != v.volume ? o.volume < v.volume :
+                o.serial - v.serial > 0x80000000u)
+                victim = i;
+        }
+    }
+
+    if (free_voice >= 0) return free_voice;
+
+    if (victim < 0)
+    {
+        SDL_Log("Audio %s is skipped - all %d voices play a higher priority", asset->get_path().c_str(), voice_limit);
+        return -1;
+    }
+
+    // Stopped by the next callback, before the new play of the voice (the ring keeps the order)
+    Voice_owner& o = owners[victim];
+
+    Command command{};
+
+    command.type = Command_type::STOP;
+    command.voice = victim;
+    command.serial = o.serial;
+
+    if (!push(command)) return -1;
+
+    if (o.instance) detach(victim, o.instance->start_sample);
+
+    o = Voice_owner{};
+
+    ++stolen_voices;
+
+    return victim;
+}
+
+
+bool Audio_mixer::start_voice(int voice, const Audio_asset* asset, const Command& play, unsigned int volume)
+{
+    Command command = play;
+
+    command.voice = voice;
+    command.serial = next_serial++;
+    command.epoch = next_epoch++;
+
+    if (!push(command)) return false;
+
+    // The volume follows the play command
+    Command gain{};
+
+    gain.type = Command_type::VOLUME;
+    gain.voice = voice;
+    gain.value = static_cast<uint64_t>(volume) * UNITY_VOLUME / 100;
+    gain.serial = command.serial;
+    gain.at = command.at;
+
+    push(gain);
+
+    Voice_owner& o = owners[voice];
+
+    o = Voice_owner{};
+    o.asset = asset;
+    o.serial = command.serial;
+    o.epoch = command.epoch;
+    o.volume = volume;
+
+    return true;
+}
+
+
+int Audio_mixer::find_voice(const Audio_instance* instance) const
+{
+    if (!instance) return -1;
+
+    for (int i = 0; i < MAX_VOICES; ++i)
+        if (owners[i].instance == instance) return i;
+
+    return -1;
+}
+
+
+void Audio_mixer::detach(int voice, uint64_t position)
+{
+    if (owners[voice].instance) owners[voice].instance->current_playtime_sample = position;
+
+    owners[voice].instance = nullptr;
+    owners[voice].oneshot = false;
+}
+
+
+void Audio_mixer::release_voice(int voice, Command_type type, uint64_t sample_clock)
+{
+    Command command{};
+
+    command.type = type;
+    command.voice = voice;
+    command.serial = owners[voice].serial;
+    command.at = sample_clock;
+
+    // A dropped command leaves the voice playing - it stays owned by the instance
+    if (!push(command)) return;
+
+    detach(voice, published_position(voice));
+
+    owners[voice].releasing = true;
+}
+
+// === MAIN THREAD SIDE ===
+
+
+// === CALLBACK SIDE ===
+
+void SDLCALL Audio_mixer::audio_callback(void* userdata, Uint8* stream, int len)
+{
+    Audio_mixer* mixer = static_cast<Audio_mixer*>(userdata);
+
+    PROFILE_THREAD("audio");
+    PROFILE_ZONE("audio_callback");
+
+    // The thread is the device's - the role is applied from inside, once
+    if (!mixer->role_applied)
+    {
+        Thread_roles::Instance().apply(Thread_role::AUDIO);
+        mixer->role_applied = true;
+    }
+
+    const int frames = len / static_cast<int>(2 * sizeof(Sint16));
+
+    const Uint64 start = Engine_clock::now();
+
+    mixer->callback_start = start;
+
+    // The buffer start on the sample clock - the game time maps to it
+    mixer->clock_sequence.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    mixer->published_clock.store(mixer->clock, std::memory_order_relaxed);
+    mixer->published_counter.store(start, std::memory_order_relaxed);
+
+    mixer->clock_sequence.fetch_add(1, std::memory_order_release);
+
+    mixer->apply_commands();
+    mixer->mix(reinterpret_cast<Sint16*>(stream), frames);
+
+    mixer->clock += static_cast<uint64_t>(std::max(frames, 0));
+
+    mixer->record_callback(start, frames);
+}
+
+
+void Audio_mixer::publish_cursors(uint64_t mixed_to)
+{
+    // A relaxed store per voice - the reader takes one word, the word is the whole state
+    for (int i = 0; i < MAX_VOICES; ++i)
+    {
+        const Voice& v = voices[i];
+
+        const uint64_t cursor = v.active ? v.cursor - mixed_to : v.cursor;
+        const uint64_t word = (cursor & CURSOR_MASK) | static_cast<uint64_t>(v.epoch & EPOCH_MASK) << CURSOR_BITS |
+                              (v.active ? PLAYING_BIT : 0);
+
+        voice_cursors[i].store(word, std::memory_order_relaxed);
+    }
+}
+
+
+void Audio_mixer::record_callback(Uint64 start, int frames)
+{
+    const Uint64 end = Engine_clock::now();
+
+    const uint64_t us = (end - start) * 1000000 / counter_frequency;
+    const uint64_t period_us = static_cast<uint64_t>(std::max(frames, 0)) * 1000000 / static_cast<uint64_t>(std::max(sample_rate, 1));
+
+    int b = 0;
+    while (b < Audio_timing::BUCKETS - 1 && (us >> (b + 1)) != 0) ++b;
+
+    // Single writer - the plain load and store don't lose the updates
+    timing_buckets[b].store(timing_buckets[b].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    timing_callbacks.store(timing_callbacks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    timing_total_us.store(timing_total_us.load(std::memory_order_relaxed) + us, std::memory_order_relaxed);
+
+    if (us > timing_max_us.load(std::memory_order_relaxed)) timing_max_us.store(us, std::memory_order_relaxed);
+
+    // The device drained its queue: the mix took longer than its buffer plays, or the
+    // callback came two buffers after the previous one (a whole buffer wasn't written in time)
+    const uint64_t interval_us = previous_start ? (start - previous_start) * 1000000 / counter_frequency : 0;
+
+    if (us > period_us || interval_us > 2 * period_us)
+        timing_underruns.store(timing_underruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    previous_start = start;
+}
+
+
+void Audio_mixer::record_latency(Uint64 requested, int offset)
+{
+    // The wait for the callback, the offset in the buffer and the buffer queued in the device
+    const uint64_t wait_us = callback_start > requested ? (callback_start - requested) * 1000000 / counter_frequency : 0;
+    const uint64_t frames = static_cast<uint64_t>(offset) + static_cast<uint64_t>(buffer_frames);
+
+    const uint64_t us = wait_us + frames * 1000000 / static_cast<uint64_t>(std::max(sample_rate, 1));
+
+    latency_count.store(latency_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    latency_total_us.store(latency_total_us.load(std::memory_order_relaxed) + us, std::memory_order_relaxed);
+
+    if (us < latency_min_us.load(std::memory_order_relaxed)) latency_min_us.store(us, std::memory_order_relaxed);
+    if (us > latency_max_us.load(std::memory_order_relaxed)) latency_max_us.store(us, std::memory_order_relaxed);
+}
+
+
+void Audio_mixer::report(int voice, Event_type type)
+{
+    Voice& v = voices[voice];
+
+    if (events.push({type, voice, v.serial, v.cursor})) return;
+
+    v.report_pending = true;
+    v.pending_type = type;
+}
+
+
+void Audio_mixer::apply_commands()
+{
+    // Reports, which didn't fit the ring last time
+    for (int i = 0; i < MAX_VOICES; ++i)
+    {
+        Voice& v = voices[i];
+
+        if (v.report_pending && events.push({v.pending_type, i, v.serial, v.cursor})) v.report_pending = false;
+    }
+
+    Command c;
+
+    while (commands.pop(c))
+    {
+        // The changes of a play, which hasn't started yet, wait for its start
+        if (c.type == Command_type::SEEK || c.type == Command_type::VOLUME)
+        {
+            const uint64_t start = scheduled_play_at(c.voice, c.serial);
+
+            if (start > c.at) c.at = start;
+        }
+
+        // In the future - kept until its frame (the full list applies it at once)
+        if (c.at > clock && scheduled_count < MAX_SCHEDULED)
+        {
+            scheduled[scheduled_count++] = c;
+            continue;
+        }
+
+        apply(c);
+    }
+}
+
+
+void Audio_mixer::apply(const Command& c)
+{
+    if (c.type == Command_type::MASTER_VOLUME)
+    {
+        master_volume = static_cast<int>(c.value);
+        return;
+    }
+
+    Voice& v = voices[c.voice];
+
+    switch (c.type)
+    {
+        case Command_type::PLAY:
+            v.report_pending = false;
+            v.samples = c.samples;
+            v.adpcm = c.adpcm;
+            v.adpcm_cursor = UINT64_MAX;
+            v.stream = c.stream;
+            v.stream_generation = c.stream_generation;
+            v.channels = c.channels;
+            v.start = c.start;
+            v.end = c.end;
+            v.loop_start = c.loop_start;
+            v.loop_end = c.loop_end;
+            v.cursor = c.value;
+            v.epoch = c.epoch;
+            v.loop = c.loop;
+            v.volume = UNITY_VOLUME;
+            v.snap_gain = true;
+            v.serial = c.serial;
+            v.requested = c.requested;
+            v.active = true;
+            break;
+
+        // The commands of an older play of the voice are ignored
+        case Command_type::PAUSE:
+        case Command_type::STOP:
+        {
+            // The scheduled changes of the play are dropped with it (its start too)
+            const bool cancelled = cancel_scheduled(c.voice, c.serial);
+
+            if (v.serial == c.serial && v.active)
+            {
+                v.active = false;
+                report(c.voice, Event_type::STOPPED);
+            }
+            else if (cancelled && !v.active)
+            {
+                // Stopped before its scheduled start - the voice was free all the time
+                v.serial = c.serial;
+                report(c.voice, Event_type::STOPPED);
+            }
+            break;
+        }
+
+        case Command_type::SEEK:
+            if (v.serial == c.serial)
+            {
+                v.cursor = std::max(v.start, std::min(c.value, v.end));
+                v.epoch = c.epoch;
+                v.stream_generation = c.stream_generation;
+            }
+            break;
+
+        case Command_type::VOLUME:
+            if (v.serial == c.serial) v.volume = static_cast<int>(c.value);
+            break;
+
+        default: break;
+    }
+}
+
+
+void Audio_mixer::apply_due(uint64_t now)
+{
+    // In the push order - a play and its volume of the same frame are applied in turn
+    for (;;)
+    {
+        int due = -1;
+
+        for (int k = 0; k < scheduled_count && due < 0; ++k)
+            if (scheduled[k].at <= now) due = k;
+
+        if (due < 0) return;
+
+        const Command c = scheduled[due];
+
+        for (int k = due + 1; k < scheduled_count; ++k) scheduled[k - 1] = scheduled[k];
+
+        --scheduled_count;
+
+        apply(c);
+    }
+}
+
+
+bool Audio_mixer::cancel_scheduled(int voice, uint32_t serial)
+{
+    int kept = 0;
+
+    for (int k = 0; k < scheduled_count; ++k)
+    {
+        const Command& c = scheduled[k];
+
+        if (c.type != Command_type::MASTER_VOLUME && c.voice == voice && c.serial == serial) continue;
+
+        scheduled[kept++] = c;
+    }
+
+    const bool cancelled = kept != scheduled_count;
+
+    scheduled_count = kept;
+
+    return cancelled;
+}
+
+
+uint64_t Audio_mixer::scheduled_play_at(int voice, uint32_t serial) const
+{
+    for (int k = 0; k < scheduled_count; ++k)
+    {
+        const Command& c = scheduled[k];
+
+        if (c.type == Command_type::PLAY && c.voice == voice && c.serial == serial) return c.at;
+    }
+
+    return 0;
+}
+
+
+void Audio_mixer::mix(Sint16* out, int frames)
+{
+    // More than requested on open - never happens with the fixed spec, stays silent
+    if (frames <= 0) return;
+
+    if (frames * 2 > static_cast<int>(accumulator.size()))
+    {
+        std::memset(out, 0, static_cast<size_t>(frames) * 2 * sizeof(Sint16));
+        return;
+    }
+
+    int32_t* acc = accumulator.data();
+
+    std::memset(acc, 0, static_cast<size_t>(frames) * 2 * sizeof(int32_t));
+
+    // The scheduled changes split the buffer - each one starts exactly at its frame
+    int done = 0;
+
+    while (done < frames)
+    {
+        const uint64_t now = clock + static_cast<uint64_t>(done);
+
+        apply_due(now);
+
+        int segment = frames - done;
+
+        for (int k = 0; k < scheduled_count; ++k)
+            if (scheduled[k].at < now + static_cast<uint64_t>(segment)) segment = static_cast<int>(scheduled[k].at - now);
+
+        // The first segment of an immediate play - its latency
+        for (Voice& v : voices)
+        {
+            if (v.active && v.requested)
+            {
+                record_latency(v.requested, done);
+                v.requested = 0;
+            }
+        }
+
+        mix_voices(acc + done * 2, segment);
+
+        done += segment;
+    }
+
+    publish_cursors(clock + static_cast<uint64_t>(frames));
+
+    // Back to 16 bits with the clamp
+    mix_resolve(out, acc, frames * 2);
+}
+
+
+void Audio_mixer::mix_voices(int32_t* acc, int frames)
+{
+    for (int i = 0; i < MAX_VOICES; ++i)
+    {
+        Voice& v = voices[i];
+
+        if (!v.active) continue;
+
+        // Q8 * Q8 - the sum of MAX_VOICES full-scale voices fits 32 bits
+        const int32_t target = ((v.volume * master_volume) >> 8) << 8;
+
+        // A new play starts at its volume, the changes of a playing voice ramp over the segment
+        if (v.snap_gain)
+        {
+            v.gain = target;
+            v.snap_gain = false;
+        }
+
+        const int32_t step = (target - v.gain) / frames;
+
+        int done = 0;
+
+        // In the loop the voice runs to the loop end, the part after it is never mixed
+        const bool looping = v.loop && v.loop_end > v.loop_start;
+        const uint64_t end = looping ? v.loop_end : v.end;
+
+        while (done < frames)
+        {
+            if (v.cursor >= end)
+            {
+                if (looping) v.cursor = v.loop_start;
+                else
+                {
+                    v.active = false;
+                    report(i, Event_type::FINISHED);
+                    break;
+                }
+            }
+
+            uint64_t span = end - v.cursor;
+
+            const Sint16* src = nullptr;
+
+            if (v.stream)
+            {
+                int queued = 0;
+
+                src = v.stream->acquire(v.stream_generation, queued);
+
+                if (!src)
+                {
+                    // The end of the data (a little short of the trim end, by the resampler rounding)
+                    if (v.stream->is_drained(v.stream_generation))
+                    {
+                        v.active = false;
+                        report(i, Event_type::FINISHED);
+                    }
+                    else
+                    {
+                        v.stream->count_underrun();
+                        timing_stream_underruns.store(timing_stream_underruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                    }
+
+                    break;
+                }
+
+                span = std::min<uint64_t>(span, static_cast<uint64_t>(queued));
+            }
+            else if (v.adpcm) span = std::min<uint64_t>(span, ADPCM_BLOCK_FRAMES);
+            else src = v.samples + v.cursor * v.channels;
+
+            const int n = static_cast<int>(std::min<uint64_t>(static_cast<uint64_t>(frames - done), span));
+            int32_t* dst = acc + done * 2;
+
+            // A block at most into the scratch, the decoder state runs on from the last chunk
+            if (v.adpcm)
+            {
+                if (v.adpcm_cursor != v.cursor) adpcm_seek(v.adpcm, v.channels, v.cursor, v.adpcm_state);
+
+                adpcm_decode(v.adpcm, v.channels, v.cursor, n, v.adpcm_state, adpcm_scratch);
+
+                v.adpcm_cursor = v.cursor + static_cast<uint64_t>(n);
+                src = adpcm_scratch;
+            }
+
+            if (v.channels == 2) mix_add_stereo(dst, src, n, v.gain + done * step, step);
+            else mix_add_mono(dst, src, n, v.gain + done * step, step);
+
+            if (v.stream) v.stream->consume(n);
+
+            v.cursor += static_cast<uint64_t>(n);
+            done += n;
+        }
+
+        // The ramp ends at the target (the division remainder is below a Q8 step)
+        v.gain = target;
+    }
+}
+
+// === CALLBACK SIDE ===
+
+// =========================================================================================== AUDIO MIXER
@@ -0,0 +1,622 @@
+// audio_mixer.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+#include "../platform/platform.h"
+#include "../memory/allocator.h"
+#include "adpcm.h"
+#include "spsc_ring.h"
+
+// =========================================================================================== IMPORT
+
+
+class Audio_asset;
+class Audio_instance;
+struct Audio_view;
+class Streaming_audio;
+
+
+// =========================================================================================== AUDIO TIMING
+
+/**
+ * @brief Snapshot of the audio callback instrumentation (Audio_mixer::get_timing()).
+ *
+ * The callback duration histogram has power of two microsecond buckets: bucket 0 -
+ * [0, 2) us, bucket i - [2^i, 2^(i+1)) us, the last bucket takes the rest. The smallest
+ * buffer without the underruns over a play session is the latency to ship.
+ */
+struct Audio_timing
+{
+    static constexpr int BUCKETS = 16;
+
+    // Negotiated device spec - one buffer is the output latency the device adds
+    int sample_rate = 0;
+    int buffer_frames = 0;
+    double buffer_ms = 0.0;
+
+    std::uint64_t callbacks = 0;
+    std::uint64_t buckets[BUCKETS] = {};
+
+    double mean_callback_us = 0.0;
+    double max_callback_us = 0.0;
+
+    // Callbacks, which mixed longer than their buffer plays, or came a whole buffer late
+    std::uint64_t underruns = 0;
+
+    // Streaming_audio callbacks with an empty ring (the decoder was late)
+    std::uint64_t stream_underruns = 0;
+
+    // Play request to its first sample out of the device - the wait for the callback,
+    // the offset in its buffer and the one buffer queued in the device (immediate plays only)
+    std::uint64_t latency_samples = 0;
+    double min_latency_ms = 0.0;
+    double mean_latency_ms = 0.0;
+    double max_latency_ms = 0.0;
+};
+
+// =========================================================================================== AUDIO TIMING
+
+
+// =========================================================================================== AUDIO MIXER
+
+
+/**
+ * @brief Software mixer of the Audio_instance voices, run by the SDL audio callback.
+ *
+ * The callback sums up to MAX_VOICES voices in 32-bit fixed point - the samples are
+ * scaled by the per-voice and the master volume (Q8) and clamped to 16 bits once, by
+ * the SIMD kernels of the build (mix_kernels.h). A volume change ramps over one buffer.
+ *
+ * The sample clock counts the frames mixed since open(). The play, the stop and the
+ * volume could be scheduled at a sample clock value - the callback splits its buffer
+ * at the scheduled frame, so the change is exact to the sample, not to the buffer.
+ * The game time (the Engine_clock counter) is mapped to the clock by the last
+ * callback start - a fixed lead of two buffers keeps the mapped frames ahead of the mix
+ * (the next callback could start before the command is pushed):
+ * @code
+ * // State update - the hit is heard in sync with its frame, whenever the buffer is mixed
+ * Audio_mixer& mixer = Audio_mixer::Instance();
+ * hit->play_audio_at(mixer.counter_to_sample_clock(frame_start) + mixer.get_schedule_lead());
+ * @endcode
+ * Every voice plays its instance trim - from start_sample to end_sample, in the loop -
+ * to the loop end, then from the loop start (Audio_instance::set_loop_points()).
+ *
+ * The callback never allocates and never takes a lock: the main thread sends the
+ * play, pause, stop, seek and volume commands through a wait-free Spsc_ring, the
+ * callback reports the finished and the stopped voices through another one, drained
+ * by update(). Neither thread ever waits for the other - a frame time spike on the
+ * main thread delays only the commands, never the sound.
+ *
+ * The play positions aren't events: once per buffer the callback stores one word per
+ * voice - its cursor relative to the sample clock, the play (or seek) it belongs to
+ * and whether it plays. get_position() is a single load of it, no lock, no ring, and
+ * the sample clock (extrapolated by the time since the buffer start) advances it, so
+ * a progress bar moves every frame, not in the buffer steps.
+ *
+ * A voice is reused only after the callback confirmed its stop, so the commands
+ * of the old and the new play never mix.
+ *
+ * The voices are a fixed pool - nothing is allocated per play, and the callback
+ * never mixes more than get_voice_limit() new voices. A play into the full pool
+ * steals the voice of the lowest priority (Audio_instance::set_priority()), the
+ * quietest and the oldest of them, if its priority is not higher than the new one.
+ * The stolen voice is stopped within the same callback, the new play follows it.
+ * The short effects (the steps, the bounces) play by play_oneshot() without any
+ * Audio_instance - the voice is freed, when the sound ends.
+ *
+ * The voices read the asset PCM in place, through an Audio_view of the trim - the
+ * instances, the regions and the one-shots of an asset all play its single buffer,
+ * no audio is copied per instance or per play. S16 mono or stereo at the rate the device
+ * negotiated on open(). The assets are converted to it once, on their load (or the
+ * first play, if they were loaded before the open), the callback never converts.
+ * The asset cooker output at the device rate is used as is. The IMA-ADPCM assets
+ * (Audio_storage) are decoded by their voice on the fly, a block at most at a time,
+ * into a scratch buffer of the callback - the voice keeps only the decoder state.
+ * The Streaming_audio
+ * voices read the decoded chunks of its ring in place the same way - an empty ring
+ * (the decoder is late) is silence, counted as the stream underrun.
+ *
+ * The callback times itself: the duration histogram, the underruns and the latency
+ * from a play request to its first output sample are read by get_timing() (the
+ * callback only adds to the relaxed atomics) and printed by dump_timing().
+ *
+ * Singleton - the SDL audio device is one per application.
+ *
+ * Usage:
+ * @code
+ * Audio_mixer::Instance().open(44100, 1024);
+ *
+ * Audio_instance* shot = shot_asset->create_instance();
+ * shot->set_volume(80);
+ * shot->play_audio();
+ *
+ * // Fire and forget - the footstep is dropped first, when all voices are busy
+ * Audio_mixer::Instance().play_oneshot(step_asset, 60, -1);
+ *
+ * // Main loop
+ * Audio_mixer::Instance().update();
+ * @endcode
+ */
+class Audio_mixer
+{
+
+public:
+
+    static constexpr int MAX_VOICES = 16;
+
+    // Per-voice and master volume of 1.0 in Q8
+    static constexpr int UNITY_VOLUME = 256;
+
+    // Priority of the instances and the one-shots by default
+    static constexpr int DEFAULT_PRIORITY = 0;
+
+    // Changes scheduled in the future at once (more are applied immediately)
+    static constexpr int MAX_SCHEDULED = 64;
+
+
+    // Returns the singleton instance.
+    static Audio_mixer& Instance();
+
+
+    /**
+     * @brief Opens the audio device (S16 stereo) and starts the callback.
+     *
+     * @param sample_rate   Requested output rate - the device could choose another (get_sample_rate()).
+     * @param buffer_frames Frames per callback - the output latency (the device could round it, get_buffer_frames()).
+     * @return false if there is no audio device - the playback calls are ignored then.
+     */
+    bool open(int sample_rate = 44100, int buffer_frames = 1024);
+
+    // Stops the callback and closes the device (all voices are dropped), frees the mix buffer
+    void close();
+
+    // Memory of the mix buffer - only while closed (false if open)
+    bool set_allocator(Allocator& allocator);
+
+    bool is_open() const;
+
+    // Negotiated device rate - the rate of the played PCM
+    int get_sample_rate() const;
+
+    // Negotiated frames per callback
+    int get_buffer_frames() const;
+
+
+    // Main thread, once per frame - returns the finished voices to their instances
+    void update();
+
+
+    // === PLAYBACK (main thread, used by the Audio_instance) ===
+
+    /**
+     * @brief Starts (or resumes) the instance from its current play position.
+     *
+     * In the full pool it steals a voice of the same or lower priority (the instance priority).
+     *
+     * @return false if the mixer is closed, the audio is not convertible or all voices play a higher priority.
+     */
+    bool play(Audio_instance* instance, bool loop = false);
+
+    // Stops the voice, keeping the play position (the published one - the callback could mix a little further)
+    void pause(Audio_instance* instance);
+
+    // Stops the voice and resets the play position to the trim start
+    void stop(Audio_instance* instance);
+
+    /**
+     * @brief Same as play(), the voice starts at the exact frame of the sample clock.
+     *
+     * The voice is taken at once (is_playing() is true), it is silent until the frame.
+     * A frame already mixed (below get_schedule_horizon()) starts with the next buffer.
+     */
+    bool play_at(Audio_instance* instance, uint64_t sample_clock, bool loop = false);
+
+    // Same as stop(), at the exact frame of the sample clock (the voice is released at once)
+    void stop_at(Audio_instance* instance, uint64_t sample_clock);
+
+    // Same as set_volume(), the ramp starts at the exact frame of the sample clock
+    void set_volume_at(Audio_instance* instance, unsigned int volume, uint64_t sample_clock);
+
+    /**
+     * @brief Plays the whole asset once in a pool voice, without an Audio_instance.
+     *
+     * The voice is freed by the end of the sound (or by stop_asset()), it could be
+     * stolen like any other. Not for the Streaming_audio - it plays by its instance.
+     *
+     * @param volume       Volume in percent (0 - 100).
+     * @param priority     Voice stealing priority.
+     * @param sample_clock Start at the frame of the sample clock, 0 - at once.
+     * @return false if the asset is not playable or all voices play a higher priority.
+     */
+    bool play_oneshot(const Audio_asset* asset, unsigned int volume = 100, int priority = DEFAULT_PRIORITY,
+                      uint64_t sample_clock = 0);
+
+    /**
+     * @brief Same as play_oneshot(), only the named range of the asset (Audio_asset::add_region()).
+     *
+     * A bank of effects in one asset - every region plays from the one asset buffer.
+     *
+     * @return false if there is no such region, or the same as play_oneshot().
+     */
+    bool play_region_oneshot(const Audio_asset* asset, int region_index, unsigned int volume = 100,
+                             int priority = DEFAULT_PRIORITY, uint64_t sample_clock = 0);
+
+    // Moves the play position (frames from the start of the audio)
+    void seek(Audio_instance* instance, uint64_t sample);
+
+    // Volume in percent (0 - 100)
+    void set_volume(Audio_instance* instance, unsigned int volume);
+
+    bool is_playing(const Audio_instance* instance) const;
+
+    /**
+     * @brief Current play position of the instance (frames from the start of the audio).
+     *
+     * Playing - the cursor the callback published with the last buffer, moved on by the
+     * sample clock since then and wrapped by the loop. Wait-free - the callback isn't
+     * waited for, nor locked out.
+     */
+    uint64_t get_position(const Audio_instance* instance) const;
+
+    /**
+     * @brief Stops every voice of the asset and waits for the callback to confirm it.
+     *
+     * The asset PCM is not read anymore, when this returns - called before it is freed.
+     * The wait is at most one callback buffer, the audio thread is never blocked.
+     */
+    void stop_asset(const Audio_asset* asset);
+
+    // === PLAYBACK (main thread, used by the Audio_instance) ===
+
+
+    // === SAMPLE CLOCK ===
+
+    // Frame of the sample clock being mixed now (between the callbacks - extrapolated by the time)
+    uint64_t get_sample_clock() const;
+
+    /**
+     * @brief Sample clock at the Engine_clock::now() value.
+     *
+     * Maps the game time (the frame start counter) linearly to the clock - use it
+     * with get_schedule_lead(), so the frame is not mixed yet.
+     */
+    uint64_t counter_to_sample_clock(Uint64 counter) const;
+
+    // First frame, which is certainly not mixed yet - the scheduled changes from it are exact
+    uint64_t get_schedule_horizon() const;
+
+    // Frames from now to the schedule horizon - two callback buffers
+    int get_schedule_lead() const;
+
+    // === SAMPLE CLOCK ===
+
+
+    // Master volume in percent (0 - 100)
+    void set_master_volume(unsigned int volume);
+
+    // Number of the voices in use
+    int get_active_voice_count() const;
+
+
+    /**
+     * @brief Size of the voice pool (1 - MAX_VOICES, MAX_VOICES by default).
+     *
+     * Lower limit - lower worst case of the callback. The voices above the new limit
+     * play to their end, they are not reused.
+     */
+    void set_voice_limit(int limit);
+
+    int get_voice_limit() const;
+
+    // Voices stolen since open()
+    int get_stolen_voice_count() const;
+
+
+    // === VOICE RESERVATION ===
+
+    /**
+     * @brief Pre-warms the sound effect - its first play costs no more than the next ones.
+     *
+     * The samples are read and converted to the device rate here (the work of the first
+     * play), and up to count free voices are kept for the asset: its plays take them first,
+     * without the stealing search, and the other assets never take them. A play is then
+     * only the PLAY command pushed into the ring. The Asset_prefetcher calls it for the
+     * manifest voices of the active states (Manifest_asset::voices).
+     *
+     * @return Voices reserved for the asset now (0 - closed, not playable or no free voice).
+     */
+    int reserve_voices(const Audio_asset* asset, int count);
+
+    // Gives the voices of the asset back to the pool - a playing one plays to its end
+    void release_voices(const Audio_asset* asset);
+
+    // Voices reserved for any asset (close() drops them all)
+    int get_reserved_voice_count() const;
+
+    // === VOICE RESERVATION ===
+
+
+    // === INSTRUMENTATION ===
+
+    // Callback timing since open() (or the last reset_timing())
+    Audio_timing get_timing() const;
+
+    void reset_timing();
+
+    // Prints the device spec, the underruns, the latency and the callback histogram (called on the app shutdown)
+    void dump_timing(std::ostream& out) const;
+
+    // === INSTRUMENTATION ===
+
+
+private:
+
+    // Private constructor for singleton
+    Audio_mixer() = default;
+
+    ~Audio_mixer();
+
+    // Copying the singleton is not allowed
+    Audio_mixer(const Audio_mixer&) = delete;
+    Audio_mixer& operator=(const Audio_mixer&) = delete;
+
+
+    // Main thread to the callback
+    enum class Command_type : uint8_t { PLAY, PAUSE, STOP, SEEK, VOLUME, MASTER_VOLUME };
+
+    struct Command
+    {
+        Command_type type;
+        int voice;
+
+        // PLAY
+        const Sint16* samples;
+        const Uint8* adpcm;
+        Streaming_audio* stream;
+        uint32_t channels;
+        uint64_t start;
+        uint64_t end;
+        uint64_t loop_start;
+        uint64_t loop_end;
+        bool loop;
+
+        // PLAY, SEEK - position, VOLUME - Q8 volume
+        uint64_t value;
+
+        // PLAY, SEEK of a stream - generation of its chunks
+        uint32_t stream_generation;
+
+        // PLAY, SEEK - epoch of the published cursor (older positions are ignored)
+        uint32_t epoch;
+
+        // Sample clock of the change, 0 - at once
+        uint64_t at;
+
+        // PLAY at once - performance counter of the request, for the latency
+        Uint64 requested;
+
+        uint32_t serial;
+    };
+
+    // Callback to the main thread
+    enum class Event_type : uint8_t { FINISHED, STOPPED };
+
+    struct Event
+    {
+        Event_type type;
+        int voice;
+        uint32_t serial;
+        uint64_t position;
+    };
+
+    // Voice state - read and written only by the callback
+    struct Voice
+    {
+        const Sint16* samples = nullptr;
+        uint32_t channels = 0;
+
+        // ADPCM voice - the blocks, the decoder state and the frame it is at (a jump seeks it again)
+        const Uint8* adpcm = nullptr;
+        Adpcm_channel adpcm_state[2];
+        uint64_t adpcm_cursor = UINT64_MAX;
+
+        // Streamed voice - the samples come from its ring
+        Streaming_audio* stream = nullptr;
+        uint32_t stream_generation = 0;
+
+        uint64_t start = 0;
+        uint64_t end = 0;
+        uint64_t loop_start = 0;
+        uint64_t loop_end = 0;
+        uint64_t cursor = 0;
+
+        // Play or seek, which set the cursor - published with it
+        uint32_t epoch = 0;
+
+        int volume = UNITY_VOLUME;
+
+        // Applied gain (Q16) - ramps to the volume over one callback buffer, no clicks
+        int32_t gain = 0;
+        bool snap_gain = true;
+
+        bool active = false;
+        bool loop = false;
+
+        uint32_t serial = 0;
+
+        // Performance counter of the play request - the latency is taken by its first mixed segment
+        Uint64 requested = 0;
+
+        // FINISHED or STOPPED, which didn't fit the full event ring - retried by the next callback
+        bool report_pending = false;
+        Event_type pending_type = Event_type::STOPPED;
+    };
+
+    // Voice ownership - main thread only
+    struct Voice_owner
+    {
+        Audio_instance* instance = nullptr;
+        const Audio_asset* asset = nullptr;
+        uint32_t serial = 0;
+
+        // Position of the play or the last seek - until the callback publishes its epoch
+        uint64_t position = 0;
+        uint32_t epoch = 0;
+
+        // Paused or stopped, the callback hasn't confirmed it yet - the voice is not reusable
+        bool releasing = false;
+
+        // Played in the loop (a stream seek restarts its decoder with the loop)
+        bool looping = false;
+
+        // Played by play_oneshot() - no instance, the voice is busy till the end of the sound
+        bool oneshot = false;
+
+        // Voice stealing order - the lowest priority, then the quietest
+        int priority = DEFAULT_PRIORITY;
+        unsigned int volume = 100;
+    };
+
+
+    static void SDLCALL audio_callback(void* userdata, Uint8* stream, int len);
+
+    void mix(Sint16* out, int frames);
+
+    // All active voices into the accumulator (a part of the buffer between the scheduled changes)
+    void mix_voices(int32_t* acc, int frames);
+
+    // Callback side of the rings
+    void apply_commands();
+    void report(int voice, Event_type type);
+
+    // Callback side of the scheduling
+    void apply(const Command& command);
+    void apply_due(uint64_t now);
+    bool cancel_scheduled(int voice, uint32_t serial);
+
+    // Scheduled start of the play, 0 if it is not scheduled
+    uint64_t scheduled_play_at(int voice, uint32_t serial) const;
+
+    // Consistent pair of the published clock and its counter
+    void read_clock(uint64_t& frames, Uint64& counter) const;
+
+    // Callback side of the play positions - stores the voice words (the cursors at the buffer end)
+    void publish_cursors(uint64_t mixed_to);
+
+    // Play position of the owned voice - the published word, interpolated by the sample clock
+    uint64_t published_position(int voice) const;
+
+    // Callback side of the instrumentation
+    void record_callback(Uint64 start, int frames);
+    void record_latency(Uint64 requested, int offset);
+
+    // Main side of the rings
+    bool push(const Command& command);
+    void drain_events();
+
+    // Voice of the instance, -1 if it doesn't play
+    int find_voice(const Audio_instance* instance) const;
+
+    // Audio is S16 mono or stereo at the device rate (converted here, if it isn't yet)
+    bool check_playable(const Audio_asset* asset) const;
+
+    // PLAY of the view - the pointers into the asset buffer, nothing is copied
+    static Command play_command(const Audio_view& view, uint64_t cursor, bool loop, uint64_t sample_clock);
+
+    // One-shot of the view of the asset
+    bool play_view_oneshot(const Audio_asset* asset, const Audio_view& view, unsigned int volume, int priority,
+                           uint64_t sample_clock);
+
+    // Free voice of the pool (one reserved for the asset first), or the stolen one of the same or
+    // lower priority, -1 if there is none - the voices reserved for the other assets are skipped
+    int take_voice(int priority, const Audio_asset* asset);
+
+    // Sends the PLAY and its volume into the voice
+    bool start_voice(int voice, const Audio_asset* asset, const Command& play, unsigned int volume);
+
+    // Unlinks the instance from the voice and returns the position to it
+    void detach(int voice, uint64_t position);
+
+    // Sends the PAUSE / STOP of the instance voice, the voice waits for the confirmation
+    void release_voice(int voice, Command_type type, uint64_t sample_clock = 0);
+
+
+    SDL_AudioDeviceID device = 0;
+    int sample_rate = 0;
+    int buffer_frames = 0;
+
+    // Callback state
+    Voice voices[MAX_VOICES];
+    int master_volume = UNITY_VOLUME;
+
+    // Mix accumulator - allocated by open(), never resized in the callback
+    std::vector<int32_t, Std_allocator<int32_t>> accumulator;
+
+    // Decoded ADPCM of the voice being mixed
+    Sint16 adpcm_scratch[ADPCM_BLOCK_FRAMES * 2];
+
+    // Changes in the future, in the push order
+    Command scheduled[MAX_SCHEDULED];
+    int scheduled_count = 0;
+
+    // Frames mixed since open()
+    uint64_t clock = 0;
+
+    // Callback -> main thread: the clock at the last buffer start and its counter (seqlock)
+    std::atomic<uint32_t> clock_sequence{0};
+    std::atomic<uint64_t> published_clock{0};
+    std::atomic<Uint64> published_counter{0};
+
+    // Callback -> main thread: the voice words, stored once per buffer - bits 0-39 the cursor
+    // minus the sample clock (playing) or the cursor (stopped), 40-62 the epoch, 63 playing
+    static constexpr int CURSOR_BITS = 40;
+    static constexpr uint64_t CURSOR_MASK = (uint64_t(1) << CURSOR_BITS) - 1;
+    static constexpr uint32_t EPOCH_MASK = (1u << 23) - 1;
+    static constexpr uint64_t PLAYING_BIT = uint64_t(1) << 63;
+
+    std::atomic<uint64_t> voice_cursors[MAX_VOICES] = {};
+
+    // Callback instrumentation - written by the callback only, read by get_timing()
+    Uint64 counter_frequency = 1;
+    Uint64 callback_start = 0;
+    Uint64 previous_start = 0;
+
+    // The device thread took the audio role (Thread_roles) - the first callback of an open
+    bool role_applied = false;
+
+    std::atomic<uint64_t> timing_callbacks{0};
+    std::atomic<uint64_t> timing_buckets[Audio_timing::BUCKETS] = {};
+    std::atomic<uint64_t> timing_total_us{0};
+    std::atomic<uint64_t> timing_max_us{0};
+    std::atomic<uint64_t> timing_underruns{0};
+    std::atomic<uint64_t> timing_stream_underruns{0};
+
+    std::atomic<uint64_t> latency_count{0};
+    std::atomic<uint64_t> latency_total_us{0};
+    std::atomic<uint64_t> latency_min_us{UINT64_MAX};
+    std::atomic<uint64_t> latency_max_us{0};
+
+    // Main thread state
+    Voice_owner owners[MAX_VOICES];
+    uint32_t next_serial = 1;
+    uint32_t next_epoch = 1;
+
+    int voice_limit = MAX_VOICES;
+    int stolen_voices = 0;
+
+    // Asset the voice is kept for (reserve_voices()), nullptr - any
+    const Audio_asset* reserved[MAX_VOICES] = {};
+
+    // Main thread -> callback, callback -> main thread
+    Spsc_ring<Command, 128> commands;
+    Spsc_ring<Event, 256> events;
+};
+
+// =========================================================================================== AUDIO MIXER
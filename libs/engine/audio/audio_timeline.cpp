@@ -0,0 +1,112 @@
+// audio_timeline.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "audio_timeline.h"
+#include "audio_mixer.h"
+#include "../engine_clock/engine_clock.h"
+
+#include <cmath>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== AUDIO TIMELINE
+
+Audio_timeline& Audio_timeline::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Audio_timeline instance;
+    return instance;
+}
+
+
+void Audio_timeline::begin_cycle(int ticks, double tick_dt)
+{
+    const Audio_mixer& mixer = Audio_mixer::Instance();
+
+    ticks_left = ticks > 0 ? ticks : 0;
+
+    if (!mixer.is_open())
+    {
+        // No device - the tick pace, the frames stay comparable with the scheduled ones
+        synced = false;
+        rate = NOMINAL_RATE;
+        target = frames + static_cast<std::uint64_t>(ticks_left * tick_dt * rate + 0.5);
+        return;
+    }
+
+    rate = mixer.get_sample_rate();
+
+    // Mixed at the cycle start, one buffer still in the device - the frame heard now
+    const std::uint64_t mixed = mixer.counter_to_sample_clock(Engine_clock::time.frame_counter);
+    const std::uint64_t buffered = static_cast<std::uint64_t>(mixer.get_buffer_frames());
+    const std::uint64_t heard = mixed > buffered ? mixed - buffered : 0;
+
+    // A new device (or the first read) - the clock is taken as it is
+    if (!synced || heard + static_cast<std::uint64_t>(RESYNC_SECONDS * rate) < frames) frames = heard;
+
+    synced = true;
+
+    // A little behind - the timeline waits for the clock, never goes back
+    target = heard > frames ? heard : frames;
+}
+
+
+float Audio_timeline::tick()
+{
+    if (ticks_left <= 0)
+    {
+        dt = 0.0f;
+        return dt;
+    }
+
+    // An even share of the rest - the last tick of the cycle (the share of 1) lands on the target
+    const std::uint64_t step = (target - frames) / static_cast<std::uint64_t>(ticks_left);
+
+    frames += step;
+    dt = static_cast<float>(static_cast<double>(step) / rate);
+
+    --ticks_left;
+
+    return dt;
+}
+
+
+void Audio_timeline::set_tempo(double bpm, std::uint64_t first_frame)
+{
+    frames_per_beat = bpm > 0.0 ? 60.0 * rate / bpm : 0.0;
+    beat_zero = first_frame;
+}
+
+
+double Audio_timeline::get_beat() const
+{
+    if (frames_per_beat <= 0.0) return 0.0;
+
+    return (static_cast<double>(frames) - static_cast<double>(beat_zero)) / frames_per_beat;
+}
+
+
+std::uint64_t Audio_timeline::get_beat_frame(double beat) const
+{
+    if (frames_per_beat <= 0.0) return frames;
+
+    const double frame = static_cast<double>(beat_zero) + beat * frames_per_beat;
+
+    return frame > 0.0 ? static_cast<std::uint64_t>(frame + 0.5) : 0;
+}
+
+
+std::uint64_t Audio_timeline::get_next_beat_frame(int count) const
+{
+    if (frames_per_beat <= 0.0) return frames;
+
+    // The boundary after the current frame - a tick exactly on a beat waits for the next one
+    const double next = std::floor(get_beat()) + (count > 0 ? count : 1);
+
+    return get_beat_frame(next);
+}
+
+// =========================================================================================== AUDIO TIMELINE
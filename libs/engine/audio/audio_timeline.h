@@ -0,0 +1,143 @@
+// audio_timeline.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== AUDIO TIMELINE
+
+
+/**
+ * @brief Time source of the visuals locked to the music - the audible frames of the sample clock.
+ *
+ * The tick timers count the simulation steps: the device clock runs a little faster or
+ * slower than the frame pacing, and after a minute of music the beat effects are off by
+ * frames. The timeline follows the Audio_mixer sample clock instead, as it is heard - the
+ * clock at the cycle start (counter_to_sample_clock()) minus one device buffer, still
+ * queued in the device.
+ *
+ * The clock is read once per cycle (begin_cycle()), and the cycle's update ticks share the
+ * way to it (tick()) - the last tick of the cycle ends exactly at the heard frame, so the
+ * timeline never drifts and every tick still moves. A clock behind the timeline holds it
+ * (the timeline never goes back), a clock a second behind is a new device - the timeline
+ * jumps to it. Without an audio device the timeline runs at the tick rate.
+ *
+ * The followers:
+ * - Tween_system::Audio_synced() and Sprite_animator::Audio_synced() advance by the tick() step
+ * - the scripts co_await audio_seconds() and beats() - resumed by the first tick at or after the frame
+ *
+ * The beat grid (set_tempo()) is the frame of a beat and the frames per beat - the song
+ * position in beats, the frame of any beat.
+ *
+ * Singleton, advanced by the engine on the update thread, like the tweens.
+ *
+ * Usage:
+ * @code
+ * // Song start - the beat 0 at the play frame
+ * const uint64_t start = mixer.counter_to_sample_clock(frame_start) + mixer.get_schedule_lead();
+ * song->play_audio_at(start);
+ * Audio_timeline::Instance().set_tempo(128.0, start);
+ *
+ * // Script - the color swap on every beat
+ * for (;;)
+ * {
+ *     co_await beats(1);
+ *     s->swap_colors();
+ * }
+ * @endcode
+ */
+class Audio_timeline
+{
+
+public:
+
+    // Frames per second of the timeline without an audio device
+    static constexpr int NOMINAL_RATE = 48000;
+
+    // Clock this far behind the timeline is a new device - the timeline jumps back to it
+    static constexpr double RESYNC_SECONDS = 1.0;
+
+
+    // Returns the singleton instance.
+    static Audio_timeline& Instance();
+
+
+    /**
+     * @brief Reads the heard frame of the cycle (the engine, before the update ticks).
+     *
+     * @param ticks   Update ticks of the cycle - they share the way to the frame.
+     * @param tick_dt Seconds of a tick - the timeline pace without an audio device.
+     */
+    void begin_cycle(int ticks, double tick_dt);
+
+    // Moves the timeline by the tick's share of the cycle, returns the seconds moved (the engine, once per tick)
+    float tick();
+
+
+    // Heard frame at the current tick
+    std::uint64_t get_frames() const { return frames; }
+
+    // Frames per second - the device rate, NOMINAL_RATE without the device
+    int get_rate() const { return rate; }
+
+    // Timeline seconds (frames / rate) and the step of the last tick
+    double get_seconds() const { return static_cast<double>(frames) / rate; }
+    float get_dt() const { return dt; }
+
+    // The timeline follows the device (not the tick rate)
+    bool is_synced() const { return synced; }
+
+
+    // === BEAT GRID ===
+
+    /**
+     * @brief Beat grid of the music.
+     *
+     * @param bpm         Beats per minute, <= 0 - no grid.
+     * @param first_frame Frame of the beat 0 (the play frame of the song, the sample clock).
+     */
+    void set_tempo(double bpm, std::uint64_t first_frame);
+
+    // Song position in beats (negative before the beat 0), 0 without the grid
+    double get_beat() const;
+
+    // Frame of the beat (a fraction too), the current frame without the grid
+    std::uint64_t get_beat_frame(double beat) const;
+
+    // Frame of the count-th beat boundary after the current frame (1 - the next beat)
+    std::uint64_t get_next_beat_frame(int count = 1) const;
+
+    // === BEAT GRID ===
+
+
+private:
+
+    // Private constructor for singleton
+    Audio_timeline() = default;
+
+    // Copying the singleton is not allowed
+    Audio_timeline(const Audio_timeline&) = delete;
+    Audio_timeline& operator=(const Audio_timeline&) = delete;
+
+
+    std::uint64_t frames = 0;
+    int rate = NOMINAL_RATE;
+    float dt = 0.0f;
+    bool synced = false;
+
+    // Frame the cycle's ticks lead to and the ticks left to it
+    std::uint64_t target = 0;
+    int ticks_left = 0;
+
+    double frames_per_beat = 0.0;
+    std::uint64_t beat_zero = 0;
+};
+
+// =========================================================================================== AUDIO TIMELINE
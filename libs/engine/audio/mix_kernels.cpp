@@ -0,0 +1,372 @@
+// mix_kernels.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "mix_kernels.h"
+
+#if defined(MIX_NEON)
+    #include <arm_neon.h>
+#elif defined(MIX_SSE2)
+    #include <emmintrin.h>
+#endif
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== SCALAR KERNELS
+
+void mix_add_stereo_scalar(std::int32_t* acc, const std::int16_t* src, int frames, std::int32_t gain_start, std::int32_t gain_step)
+{
+    for (int i = 0; i < frames; ++i)
+    {
+        const std::int32_t g = (gain_start + i * gain_step) >> 8;
+
+        acc[i * 2] += src[i * 2] * g;
+        acc[i * 2 + 1] += src[i * 2 + 1] * g;
+    }
+}
+
+
+void mix_add_mono_scalar(std::int32_t* acc, const std::int16_t* src, int frames, std::int32_t gain_start, std::int32_t gain_step)
+{
+    for (int i = 0; i < frames; ++i)
+    {
+        const std::int32_t s = src[i] * ((gain_start + i * gain_step) >> 8);
+
+        acc[i * 2] += s;
+        acc[i * 2 + 1] += s;
+    }
+}
+
+
+void mix_resolve_scalar(std::int16_t* out, const std::int32_t* acc, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        const std::int32_t s = acc[i] >> 8;
+
+        out[i] = static_cast<std::int16_t>(s > 32767 ? 32767 : (s < -32768 ? -32768 : s));
+    }
+}
+
+
+void mix_interleave_scalar(std::int16_t* dst, const std::int16_t* left, const std::int16_t* right, int frames)
+{
+    for (int i = 0; i < frames; ++i)
+    {
+        dst[i * 2] = left[i];
+        dst[i * 2 + 1] = right[i];
+    }
+}
+
+
+void mix_deinterleave_scalar(std::int16_t* left, std::int16_t* right, const std::int16_t* src, int frames)
+{
+    for (int i = 0; i < frames; ++i)
+    {
+        left[i] = src[i * 2];
+        right[i] = src[i * 2 + 1];
+    }
+}
+
+// =========================================================================================== SCALAR KERNELS
+
+
+// =========================================================================================== NEON KERNELS
+
+#ifdef MIX_NEON
+
+// Q8 gains of the 4 frames from i, each repeated for both channels: g0 g0 g1 g1 | g2 g2 g3 g3
+static inline int16x4x2_t frame_gains_neon(std::int32_t gain_start, std::int32_t gain_step, int i, int32x4_t lane_steps)
+{
+    const int32x4_t g = vaddq_s32(vdupq_n_s32(gain_start + i * gain_step), lane_steps);
+    const int16x4_t g16 = vmovn_s32(vshrq_n_s32(g, 8));
+
+    return vzip_s16(g16, g16);
+}
+
+
+static inline int32x4_t lane_steps_neon(std::int32_t gain_step)
+{
+    static const std::int32_t lanes[4] = {0, 1, 2, 3};
+
+    return vmulq_n_s32(vld1q_s32(lanes), gain_step);
+}
+
+
+// 4 frames per iteration - the 16 x 16 products are widened and accumulated by vmlal
+
+static void add_stereo_neon(std::int32_t* acc, const std::int16_t* src, int frames, std::int32_t gain_start, std::int32_t gain_step)
+{
+    const int32x4_t lane_steps = lane_steps_neon(gain_step);
+
+    int i = 0;
+
+    for (; i + 4 <= frames; i += 4)
+    {
+        const int16x4x2_t g = frame_gains_neon(gain_start, gain_step, i, lane_steps);
+        const int16x8_t s = vld1q_s16(src + i * 2);
+
+        int32x4_t a0 = vld1q_s32(acc + i * 2);
+        int32x4_t a1 = vld1q_s32(acc + i * 2 + 4);
+
+        a0 = vmlal_s16(a0, vget_low_s16(s), g.val[0]);
+        a1 = vmlal_s16(a1, vget_high_s16(s), g.val[1]);
+
+        vst1q_s32(acc + i * 2, a0);
+        vst1q_s32(acc + i * 2 + 4, a1);
+    }
+
+    mix_add_stereo_scalar(acc + i * 2, src + i * 2, frames - i, gain_start + i * gain_step, gain_step);
+}
+
+
+static void add_mono_neon(std::int32_t* acc, const std::int16_t* src, int frames, std::int32_t gain_start, std::int32_t gain_step)
+{
+    const int32x4_t lane_steps = lane_steps_neon(gain_step);
+
+    int i = 0;
+
+    for (; i + 4 <= frames; i += 4)
+    {
+        const int16x4x2_t g = frame_gains_neon(gain_start, gain_step, i, lane_steps);
+
+        // s0 s0 s1 s1 | s2 s2 s3 s3 - the mono sample for both channels
+        const int16x4_t m = vld1_s16(src + i);
+        const int16x4x2_t s = vzip_s16(m, m);
+
+        int32x4_t a0 = vld1q_s32(acc + i * 2);
+        int32x4_t a1 = vld1q_s32(acc + i * 2 + 4);
+
+        a0 = vmlal_s16(a0, s.val[0], g.val[0]);
+        a1 = vmlal_s16(a1, s.val[1], g.val[1]);
+
+        vst1q_s32(acc + i * 2, a0);
+        vst1q_s32(acc + i * 2 + 4, a1);
+    }
+
+    mix_add_mono_scalar(acc + i * 2, src + i, frames - i, gain_start + i * gain_step, gain_step);
+}
+
+
+static void resolve_neon(std::int16_t* out, const std::int32_t* acc, int count)
+{
+    int i = 0;
+
+    // Saturating shift-right-narrow - the >> 8 and the clamp in one instruction
+    for (; i + 8 <= count; i += 8)
+        vst1q_s16(out + i, vcombine_s16(vqshrn_n_s32(vld1q_s32(acc + i), 8), vqshrn_n_s32(vld1q_s32(acc + i + 4), 8)));
+
+    mix_resolve_scalar(out + i, acc + i, count - i);
+}
+
+
+static void interleave_neon(std::int16_t* dst, const std::int16_t* left, const std::int16_t* right, int frames)
+{
+    int i = 0;
+
+    for (; i + 8 <= frames; i += 8)
+    {
+        int16x8x2_t v;
+
+        v.val[0] = vld1q_s16(left + i);
+        v.val[1] = vld1q_s16(right + i);
+
+        vst2q_s16(dst + i * 2, v);
+    }
+
+    mix_interleave_scalar(dst + i * 2, left + i, right + i, frames - i);
+}
+
+
+static void deinterleave_neon(std::int16_t* left, std::int16_t* right, const std::int16_t* src, int frames)
+{
+    int i = 0;
+
+    for (; i + 8 <= frames; i += 8)
+    {
+        const int16x8x2_t v = vld2q_s16(src + i * 2);
+
+        vst1q_s16(left + i, v.val[0]);
+        vst1q_s16(right + i, v.val[1]);
+    }
+
+    mix_deinterleave_scalar(left + i, right + i, src + i * 2, frames - i);
+}
+
+#endif
+
+// =========================================================================================== NEON KERNELS
+
+
+// =========================================================================================== SSE2 KERNELS
+
+#ifdef MIX_SSE2
+
+// Q8 gains of the 4 frames from i, each repeated for both channels: g0 g0 g1 g1 g2 g2 g3 g3
+static inline __m128i frame_gains_sse2(std::int32_t gain_start, std::int32_t gain_step, int i, __m128i lane_steps)
+{
+    const __m128i g = _mm_srai_epi32(_mm_add_epi32(_mm_set1_epi32(gain_start + i * gain_step), lane_steps), 8);
+    const __m128i g16 = _mm_packs_epi32(g, g);
+
+    return _mm_unpacklo_epi16(g16, g16);
+}
+
+
+// 8 samples of s * g into the 8 accumulators - SSE2 has no 32-bit multiply,
+// the 32-bit products are put together from the low and the high halves
+static inline void accumulate_sse2(std::int32_t* acc, __m128i s, __m128i g)
+{
+    const __m128i lo = _mm_mullo_epi16(s, g);
+    const __m128i hi = _mm_mulhi_epi16(s, g);
+
+    __m128i* a = reinterpret_cast<__m128i*>(acc);
+
+    _mm_storeu_si128(a, _mm_add_epi32(_mm_loadu_si128(a), _mm_unpacklo_epi16(lo, hi)));
+    _mm_storeu_si128(a + 1, _mm_add_epi32(_mm_loadu_si128(a + 1), _mm_unpackhi_epi16(lo, hi)));
+}
+
+
+static void add_stereo_sse2(std::int32_t* acc, const std::int16_t* src, int frames, std::int32_t gain_start, std::int32_t gain_step)
+{
+    const __m128i lane_steps = _mm_setr_epi32(0, gain_step, 2 * gain_step, 3 * gain_step);
+
+    int i = 0;
+
+    for (; i + 4 <= frames; i += 4)
+    {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+
+        accumulate_sse2(acc + i * 2, s, frame_gains_sse2(gain_start, gain_step, i, lane_steps));
+    }
+
+    mix_add_stereo_scalar(acc + i * 2, src + i * 2, frames - i, gain_start + i * gain_step, gain_step);
+}
+
+
+static void add_mono_sse2(std::int32_t* acc, const std::int16_t* src, int frames, std::int32_t gain_start, std::int32_t gain_step)
+{
+    const __m128i lane_steps = _mm_setr_epi32(0, gain_step, 2 * gain_step, 3 * gain_step);
+
+    int i = 0;
+
+    for (; i + 4 <= frames; i += 4)
+    {
+        // s0 s0 s1 s1 s2 s2 s3 s3 - the mono sample for both channels
+        const __m128i m = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i));
+
+        accumulate_sse2(acc + i * 2, _mm_unpacklo_epi16(m, m), frame_gains_sse2(gain_start, gain_step, i, lane_steps));
+    }
+
+    mix_add_mono_scalar(acc + i * 2, src + i, frames - i, gain_start + i * gain_step, gain_step);
+}
+
+
+static void resolve_sse2(std::int16_t* out, const std::int32_t* acc, int count)
+{
+    int i = 0;
+
+    // The signed pack saturates - the >> 8 and the clamp
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m128i a0 = _mm_srai_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + i)), 8);
+        const __m128i a1 = _mm_srai_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + i + 4)), 8);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(a0, a1));
+    }
+
+    mix_resolve_scalar(out + i, acc + i, count - i);
+}
+
+
+static void interleave_sse2(std::int16_t* dst, const std::int16_t* left, const std::int16_t* right, int frames)
+{
+    int i = 0;
+
+    for (; i + 8 <= frames; i += 8)
+    {
+        const __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(left + i));
+        const __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(right + i));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 2), _mm_unpacklo_epi16(l, r));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 2 + 8), _mm_unpackhi_epi16(l, r));
+    }
+
+    mix_interleave_scalar(dst + i * 2, left + i, right + i, frames - i);
+}
+
+
+static void deinterleave_sse2(std::int16_t* left, std::int16_t* right, const std::int16_t* src, int frames)
+{
+    int i = 0;
+
+    for (; i + 8 <= frames; i += 8)
+    {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2 + 8));
+
+        // The even samples sign-extended from the low halves, the odd ones from the high halves -
+        // in the 16-bit range, so the saturating pack is exact
+        const __m128i l = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16), _mm_srai_epi32(_mm_slli_epi32(b, 16), 16));
+        const __m128i r = _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(left + i), l);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(right + i), r);
+    }
+
+    mix_deinterleave_scalar(left + i, right + i, src + i * 2, frames - i);
+}
+
+#endif
+
+// =========================================================================================== SSE2 KERNELS
+
+
+// =========================================================================================== SELECTED KERNELS
+
+#if defined(MIX_NEON)
+
+void mix_add_stereo(std::int32_t* acc, const std::int16_t* src, int frames, std::int32_t gain_start, std::int32_t gain_step) { add_stereo_neon(acc, src, frames, gain_start, gain_step); }
+
+void mix_add_mono(std::int32_t* acc, const std::int16_t* src, int frames, std::int32_t gain_start, std::int32_t gain_step) { add_mono_neon(acc, src, frames, gain_start, gain_step); }
+
+void mix_resolve(std::int16_t* out, const std::int32_t* acc, int count) { resolve_neon(out, acc, count); }
+
+void mix_interleave(std::int16_t* dst, const std::int16_t* left, const std::int16_t* right, int frames) { interleave_neon(dst, left, right, frames); }
+
+void mix_deinterleave(std::int16_t* left, std::int16_t* right, const std::int16_t* src, int frames) { deinterleave_neon(left, right, src, frames); }
+
+const char* mix_kernel_name() { return "neon"; }
+
+#elif defined(MIX_SSE2)
+
+void mix_add_stereo(std::int32_t* acc, const std::int16_t* src, int frames, std::int32_t gain_start, std::int32_t gain_step) { add_stereo_sse2(acc, src, frames, gain_start, gain_step); }
+
+void mix_add_mono(std::int32_t* acc, const std::int16_t* src, int frames, std::int32_t gain_start, std::int32_t gain_step) { add_mono_sse2(acc, src, frames, gain_start, gain_step); }
+
+void mix_resolve(std::int16_t* out, const std::int32_t* acc, int count) { resolve_sse2(out, acc, count); }
+
+void mix_interleave(std::int16_t* dst, const std::int16_t* left, const std::int16_t* right, int frames) { interleave_sse2(dst, left, right, frames); }
+
+void mix_deinterleave(std::int16_t* left, std::int16_t* right, const std::int16_t* src, int frames) { deinterleave_sse2(left, right, src, frames); }
+
+const char* mix_kernel_name() { return "sse2"; }
+
+#else
+
+void mix_add_stereo(std::int32_t* acc, const std::int16_t* src, int frames, std::int32_t gain_start, std::int32_t gain_step) { mix_add_stereo_scalar(acc, src, frames, gain_start, gain_step); }
+
+void mix_add_mono(std::int32_t* acc, const std::int16_t* src, int frames, std::int32_t gain_start, std::int32_t gain_step) { mix_add_mono_scalar(acc, src, frames, gain_start, gain_step); }
+
+void mix_resolve(std::int16_t* out, const std::int32_t* acc, int count) { mix_resolve_scalar(out, acc, count); }
+
+void mix_interleave(std::int16_t* dst, const std::int16_t* left, const std::int16_t* right, int frames) { mix_interleave_scalar(dst, left, right, frames); }
+
+void mix_deinterleave(std::int16_t* left, std::int16_t* right, const std::int16_t* src, int frames) { mix_deinterleave_scalar(left, right, src, frames); }
+
+const char* mix_kernel_name() { return "scalar"; }
+
+#endif
+
+// =========================================================================================== SELECTED KERNELS
@@ -0,0 +1,73 @@
+// mix_kernels.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== KERNEL SELECTION
+
+// NEON kernels on the ARM Linux builds (Miyoo Mini+ Cortex-A7), SSE2 on the x86 ones
+// (the Windows dev build and the Linux desktop), the other CPUs use the scalar ones.
+#if defined(PLATFORM_LINUX) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+    #define MIX_NEON
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define MIX_SSE2
+#endif
+
+// =========================================================================================== KERNEL SELECTION
+
+
+// =========================================================================================== MIX KERNELS
+
+/**
+ * Audio_mixer sample kernels over the 16-bit PCM and the 32-bit mix accumulator.
+ *
+ * The plain names are the best kernels of the build (NEON, SSE2 or scalar), the _scalar
+ * versions are always available - for the fallback and the comparison in miyoo_mix_bench.
+ * All versions give bit-identical results.
+ *
+ * The voices are summed in 32 bits (they never clip each other), the sum is saturated
+ * to 16 bits once. The gain is Q16 (65536 - unity) and ramps linearly per frame, so
+ * a volume change never clicks:
+ *
+ *     gain(i) = (gain_start + i * gain_step) >> 8      // Q8, 0 - 256 per frame
+ *     acc += sample * gain(i)
+ *
+ * Counts are in frames (samples for the resolve). The buffers could be unaligned.
+ */
+
+
+// Stereo voice into the stereo accumulator: acc[2i + c] += src[2i + c] * gain(i)
+void mix_add_stereo(std::int32_t* acc, const std::int16_t* src, int frames, std::int32_t gain_start, std::int32_t gain_step);
+void mix_add_stereo_scalar(std::int32_t* acc, const std::int16_t* src, int frames, std::int32_t gain_start, std::int32_t gain_step);
+
+// Mono voice into both channels of the stereo accumulator: acc[2i + c] += src[i] * gain(i)
+void mix_add_mono(std::int32_t* acc, const std::int16_t* src, int frames, std::int32_t gain_start, std::int32_t gain_step);
+void mix_add_mono_scalar(std::int32_t* acc, const std::int16_t* src, int frames, std::int32_t gain_start, std::int32_t gain_step);
+
+
+// Accumulator back to 16 bits with the saturation: out = clamp(acc >> 8)
+void mix_resolve(std::int16_t* out, const std::int32_t* acc, int count);
+void mix_resolve_scalar(std::int16_t* out, const std::int32_t* acc, int count);
+
+
+// Planar channels to the interleaved stereo
+void mix_interleave(std::int16_t* dst, const std::int16_t* left, const std::int16_t* right, int frames);
+void mix_interleave_scalar(std::int16_t* dst, const std::int16_t* left, const std::int16_t* right, int frames);
+
+// Interleaved stereo to the planar channels
+void mix_deinterleave(std::int16_t* left, std::int16_t* right, const std::int16_t* src, int frames);
+void mix_deinterleave_scalar(std::int16_t* left, std::int16_t* right, const std::int16_t* src, int frames);
+
+
+// Name of the selected kernel set: "neon", "sse2" or "scalar"
+const char* mix_kernel_name();
+
+// =========================================================================================== MIX KERNELS
@@ -0,0 +1,90 @@
+// spsc_ring.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== SPSC RING
+
+
+/**
+ * @brief Wait-free single-producer, single-consumer ring of fixed capacity.
+ *
+ * One thread pushes, another pops - neither waits for the other, both calls finish
+ * in a bounded number of steps: the full ring refuses the push, the empty one the pop.
+ * The storage is inline, nothing is allocated after the construction - safe for the
+ * audio callback side.
+ *
+ * The indices are free-running 32-bit counters, the slot is the index modulo CAPACITY.
+ *
+ * @tparam T        Trivially copyable element.
+ * @tparam CAPACITY Power of two.
+ */
+template<typename T, uint32_t CAPACITY>
+class Spsc_ring
+{
+    static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "Spsc_ring capacity must be a power of two");
+
+public:
+
+    // Producer side - false if the ring is full
+    bool push(const T& item)
+    {
+        const uint32_t w = write_index.load(std::memory_order_relaxed);
+
+        if (w - read_index.load(std::memory_order_acquire) >= CAPACITY) return false;
+
+        slots[w & (CAPACITY - 1)] = item;
+
+        write_index.store(w + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // Consumer side - false if the ring is empty
+    bool pop(T& item)
+    {
+        const uint32_t r = read_index.load(std::memory_order_relaxed);
+
+        if (r == write_index.load(std::memory_order_acquire)) return false;
+
+        item = slots[r & (CAPACITY - 1)];
+
+        read_index.store(r + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // Approximate number of the queued items (exact from either side for its own view)
+    uint32_t size() const
+    {
+        return write_index.load(std::memory_order_acquire) - read_index.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+
+    // Drops everything - only while neither side runs
+    void reset()
+    {
+        read_index.store(0);
+        write_index.store(0);
+    }
+
+
+private:
+
+    T slots[CAPACITY];
+
+    // Separate cache lines - the producer and the consumer don't share the line they write
+    alignas(64) std::atomic<uint32_t> write_index{0};
+    alignas(64) std::atomic<uint32_t> read_index{0};
+};
+
+// =========================================================================================== SPSC RING
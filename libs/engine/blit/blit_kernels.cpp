@@ -0,0 +1,920 @@
+// blit_kernels.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "blit_kernels.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#ifdef BLIT_NEON
+    #include <arm_neon.h>
+#endif
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== SCALAR KERNELS
+
+// x / 255 with rounding, exact for x <= 255 * 255 (the same formula as the NEON one)
+static inline std::uint32_t div255(std::uint32_t x)
+{
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+
+void blit_fill_argb_scalar(std::uint32_t* dst, int count, std::uint32_t color)
+{
+    for (int i = 0; i < count; ++i) dst[i] = color;
+}
+
+
+void blit_blend_argb_scalar(std::uint32_t* dst, const std::uint32_t* src, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        const std::uint32_t s = src[i];
+        const std::uint32_t d = dst[i];
+
+        const std::uint32_t a = s >> 24;
+        const std::uint32_t ia = 255 - a;
+
+        const std::uint32_t r = div255(((s >> 16) & 0xFF) * a + ((d >> 16) & 0xFF) * ia);
+        const std::uint32_t g = div255(((s >> 8) & 0xFF) * a + ((d >> 8) & 0xFF) * ia);
+        const std::uint32_t b = div255((s & 0xFF) * a + (d & 0xFF) * ia);
+        const std::uint32_t out_a = a + div255((d >> 24) * ia);
+
+        dst[i] = (out_a << 24) | (r << 16) | (g << 8) | b;
+    }
+}
+
+
+void blit_blend_premultiplied_argb_scalar(std::uint32_t* dst, const std::uint32_t* src, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        const std::uint32_t s = src[i];
+        const std::uint32_t d = dst[i];
+
+        const std::uint32_t ia = 255 - (s >> 24);
+
+        std::uint32_t r = ((s >> 16) & 0xFF) + div255(((d >> 16) & 0xFF) * ia);
+        std::uint32_t g = ((s >> 8) & 0xFF) + div255(((d >> 8) & 0xFF) * ia);
+        std::uint32_t b = (s & 0xFF) + div255((d & 0xFF) * ia);
+        std::uint32_t a = (s >> 24) + div255((d >> 24) * ia);
+
+        if ((r | g | b | a) > 255)
+        {
+            r = r > 255 ? 255 : r;
+            g = g > 255 ? 255 : g;
+            b = b > 255 ? 255 : b;
+            a = a > 255 ? 255 : a;
+        }
+
+        dst[i] = (a << 24) | (r << 16) | (g << 8) | b;
+    }
+}
+
+
+void blit_premultiply_argb_scalar(std::uint32_t* dst, const std::uint32_t* src, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        const std::uint32_t s = src[i];
+        const std::uint32_t a = s >> 24;
+
+        const std::uint32_t r = div255(((s >> 16) & 0xFF) * a);
+        const std::uint32_t g = div255(((s >> 8) & 0xFF) * a);
+        const std::uint32_t b = div255((s & 0xFF) * a);
+
+        dst[i] = (a << 24) | (r << 16) | (g << 8) | b;
+    }
+}
+
+
+void blit_unpremultiply_argb(std::uint32_t* dst, const std::uint32_t* src, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        const std::uint32_t s = src[i];
+        const std::uint32_t a = s >> 24;
+
+        if (a == 0 || a == 255)
+        {
+            dst[i] = a ? s : 0;
+            continue;
+        }
+
+        auto channel = [a](std::uint32_t c) { return std::min((c * 255 + a / 2) / a, 255u); };
+
+        dst[i] = (a << 24) | (channel((s >> 16) & 0xFF) << 16) | (channel((s >> 8) & 0xFF) << 8) | channel(s & 0xFF);
+    }
+}
+
+
+SDL_BlendMode blend_mode_premultiplied()
+{
+    return SDL_ComposeCustomBlendMode(SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD,
+                                      SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+}
+
+
+void blit_color_mod_argb_scalar(std::uint32_t* dst, const std::uint32_t* src, int count, SDL_Color mod)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        const std::uint32_t s = src[i];
+
+        const std::uint32_t a = div255((s >> 24) * mod.a);
+        const std::uint32_t r = div255(((s >> 16) & 0xFF) * mod.r);
+        const std::uint32_t g = div255(((s >> 8) & 0xFF) * mod.g);
+        const std::uint32_t b = div255((s & 0xFF) * mod.b);
+
+        dst[i] = (a << 24) | (r << 16) | (g << 8) | b;
+    }
+}
+
+
+void blit_rgb565_to_argb_scalar(std::uint32_t* dst, const std::uint16_t* src, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        const std::uint32_t p = src[i];
+
+        std::uint32_t r = (p >> 8) & 0xF8;
+        std::uint32_t g = (p >> 3) & 0xFC;
+        std::uint32_t b = (p << 3) & 0xF8;
+
+        // Replicate the high bits into the empty low ones, so 31 becomes 255
+        r |= r >> 5;
+        g |= g >> 6;
+        b |= b >> 5;
+
+        dst[i] = 0xFF000000u | (r << 16) | (g << 8) | b;
+    }
+}
+
+
+void blit_argb_to_rgb565_scalar(std::uint16_t* dst, const std::uint32_t* src, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        const std::uint32_t p = src[i];
+
+        dst[i] = static_cast<std::uint16_t>(((p >> 8) & 0xF800) | ((p >> 5) & 0x07E0) | ((p >> 3) & 0x001F));
+    }
+}
+
+
+// === PRESENT ===
+
+// One pixel of the formats - the same results as the row kernels above
+template <typename D> static inline D convert_pixel(std::uint32_t p);
+template <typename D> static inline D convert_pixel(std::uint16_t p);
+
+template <> inline std::uint32_t convert_pixel<std::uint32_t>(std::uint32_t p) { return p; }
+template <> inline std::uint16_t convert_pixel<std::uint16_t>(std::uint16_t p) { return p; }
+
+template <> inline std::uint16_t convert_pixel<std::uint16_t>(std::uint32_t p)
+{
+    return static_cast<std::uint16_t>(((p >> 8) & 0xF800) | ((p >> 5) & 0x07E0) | ((p >> 3) & 0x001F));
+}
+
+template <> inline std::uint32_t convert_pixel<std::uint32_t>(std::uint16_t p)
+{
+    std::uint32_t out;
+    blit_rgb565_to_argb_scalar(&out, &p, 1);
+    return out;
+}
+
+
+static bool is_present_format(Uint32 format) { return format == SDL_PIXELFORMAT_ARGB8888 || format == SDL_PIXELFORMAT_RGB565; }
+
+
+// Source byte offset of every panel column and row: the turned source coordinate of a panel
+// column depends only on the column, of a row - only on the row, their offsets add up
+static void present_offsets(int quarter_turns, int src_pitch, int bpp, int src_w, int src_h, int dst_w, int dst_h,
+                            std::ptrdiff_t* column, std::ptrdiff_t* row)
+{
+    const int turned_w = (quarter_turns & 1) ? src_h : src_w;
+    const int turned_h = (quarter_turns & 1) ? src_w : src_h;
+
+    for (int x = 0; x < dst_w; ++x)
+    {
+        // Nearest pixel center
+        const std::ptrdiff_t t = (static_cast<std::ptrdiff_t>(2 * x + 1) * turned_w) / (2 * dst_w);
+
+        switch (quarter_turns)
+        {
+            case 0:  column[x] = t * bpp; break;
+            case 1:  column[x] = (src_h - 1 - t) * src_pitch; break;
+            case 2:  column[x] = (src_w - 1 - t) * bpp; break;
+            default: column[x] = t * src_pitch; break;
+        }
+    }
+
+    for (int y = 0; y < dst_h; ++y)
+    {
+        const std::ptrdiff_t t = (static_cast<std::ptrdiff_t>(2 * y + 1) * turned_h) / (2 * dst_h);
+
+        switch (quarter_turns)
+        {
+            case 0:  row[y] = t * src_pitch; break;
+            case 1:  row[y] = t * bpp; break;
+            case 2:  row[y] = (src_h - 1 - t) * src_pitch; break;
+            default: row[y] = (src_w - 1 - t) * bpp; break;
+        }
+    }
+}
+
+
+template <typename D, typename S>
+static void present_tiles(std::uint8_t* dst, int dst_pitch, int dst_w, int dst_h, const std::uint8_t* src,
+                          const std::ptrdiff_t* column, const std::ptrdiff_t* row)
+{
+    // 32 source rows of a quarter turn stay in the L1 cache, while their 32 pixels are used
+    constexpr int TILE = 32;
+
+    for (int ty = 0; ty < dst_h; ty += TILE)
+    {
+        const int y_end = std::min(ty + TILE, dst_h);
+
+        for (int tx = 0; tx < dst_w; tx += TILE)
+        {
+            const int x_end = std::min(tx + TILE, dst_w);
+
+            for (int y = ty; y < y_end; ++y)
+            {
+                D* out = reinterpret_cast<D*>(dst + static_cast<std::ptrdiff_t>(y) * dst_pitch);
+                const std::uint8_t* in = src + row[y];
+
+                for (int x = tx; x < x_end; ++x) out[x] = convert_pixel<D>(*reinterpret_cast<const S*>(in + column[x]));
+            }
+        }
+    }
+}
+
+
+void blit_present_scalar(void* dst, int dst_pitch, Uint32 dst_format, int dst_w, int dst_h,
+                         const void* src, int src_pitch, Uint32 src_format, int src_w, int src_h, int quarter_turns)
+{
+    if (!is_present_format(dst_format) || !is_present_format(src_format)) return;
+    if (dst_w <= 0 || dst_h <= 0 || src_w <= 0 || src_h <= 0) return;
+
+    quarter_turns &= 3;
+
+    // Kept between the frames - no allocation per present
+    static thread_local std::vector<std::ptrdiff_t> column;
+    static thread_local std::vector<std::ptrdiff_t> row;
+
+    column.resize(static_cast<size_t>(dst_w));
+    row.resize(static_cast<size_t>(dst_h));
+
+    present_offsets(quarter_turns, src_pitch, SDL_BYTESPERPIXEL(src_format), src_w, src_h, dst_w, dst_h, column.data(), row.data());
+
+    auto* out = static_cast<std::uint8_t*>(dst);
+    const auto* in = static_cast<const std::uint8_t*>(src);
+
+    const bool dst_32 = dst_format == SDL_PIXELFORMAT_ARGB8888;
+    const bool src_32 = src_format == SDL_PIXELFORMAT_ARGB8888;
+
+    if (dst_32 && src_32) present_tiles<std::uint32_t, std::uint32_t>(out, dst_pitch, dst_w, dst_h, in, column.data(), row.data());
+    else if (dst_32) present_tiles<std::uint32_t, std::uint16_t>(out, dst_pitch, dst_w, dst_h, in, column.data(), row.data());
+    else if (src_32) present_tiles<std::uint16_t, std::uint32_t>(out, dst_pitch, dst_w, dst_h, in, column.data(), row.data());
+    else present_tiles<std::uint16_t, std::uint16_t>(out, dst_pitch, dst_w, dst_h, in, column.data(), row.data());
+}
+
+// === PRESENT ===
+
+
+// === YUV ===
+
+// Factors of yuv_rgb_internal.h (YUV2RGB), 1/64 steps: R = Y' + V * v_r, G = Y' + U * u_g + V * v_g, B = Y' + U * u_b
+struct Yuv_factors
+{
+    int y_shift;
+    int y;
+    int v_r;
+    int u_g;
+    int v_g;
+    int u_b;
+};
+
+static constexpr Yuv_factors YUV_BT601 = {16, 75, 102, -25, -52, 129};
+static constexpr Yuv_factors YUV_BT709 = {16, 75, 115, -14, -34, 135};
+
+// SDL_YUV_CONVERSION_AUTOMATIC: the SD sizes are BT.601, the HD ones BT.709
+static const Yuv_factors& yuv_factors(int h) { return h <= 576 ? YUV_BT601 : YUV_BT709; }
+
+
+// Y' + chroma, 6 fraction bits - the floor of the arithmetic shift, clamped like vqshrun
+static inline std::uint32_t yuv_channel(int value) { return static_cast<std::uint32_t>(std::clamp(value >> 6, 0, 255)); }
+
+
+static void yuv420_row(std::uint8_t* dst, Uint32 dst_format, const Uint8* y, const Uint8* u, const Uint8* v,
+                       int from, int count, const Yuv_factors& f)
+{
+    for (int x = from; x < count; ++x)
+    {
+        const int cu = u[x / 2] - 128;
+        const int cv = v[x / 2] - 128;
+        const int luma = (y[x] - f.y_shift) * f.y;
+
+        const std::uint32_t r = yuv_channel(luma + cv * f.v_r);
+        const std::uint32_t g = yuv_channel(luma + cu * f.u_g + cv * f.v_g);
+        const std::uint32_t b = yuv_channel(luma + cu * f.u_b);
+
+        if (dst_format == SDL_PIXELFORMAT_RGB565)
+            reinterpret_cast<std::uint16_t*>(dst)[x] = static_cast<std::uint16_t>((r >> 3) << 11 | (g >> 2) << 5 | b >> 3);
+        else
+            reinterpret_cast<std::uint32_t*>(dst)[x] = 0xFF000000u | r << 16 | g << 8 | b;
+    }
+}
+
+
+void blit_yuv420_scalar(void* dst, int dst_pitch, Uint32 dst_format, int w, int h,
+                        const Uint8* y, int y_pitch, const Uint8* u, const Uint8* v, int uv_pitch)
+{
+    const Yuv_factors& f = yuv_factors(h);
+
+    for (int row = 0; row < h; ++row)
+    {
+        const std::ptrdiff_t chroma = static_cast<std::ptrdiff_t>(row / 2) * uv_pitch;
+
+        yuv420_row(static_cast<std::uint8_t*>(dst) + static_cast<std::ptrdiff_t>(row) * dst_pitch, dst_format,
+                   y + static_cast<std::ptrdiff_t>(row) * y_pitch, u + chroma, v + chroma, 0, w, f);
+    }
+}
+
+// === YUV ===
+
+
+// === COLOR GRADE ===
+
+// Mix row of the matrix - rounded like vqrshrn (arithmetic shift), clamped like vqmovun
+static inline int grade_mix(const std::int16_t* row, int r, int g, int b)
+{
+    return std::clamp((row[0] * r + row[1] * g + row[2] * b + 128) >> 8, 0, 255);
+}
+
+
+// Curves only - after the NEON mix, and the scalar pass without the mix
+static void grade_curves_argb(std::uint32_t* p, int count, const Color_grade& grade)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        const std::uint32_t c = p[i];
+
+        p[i] = (c & 0xFF000000u) | static_cast<std::uint32_t>(grade.curve[0][(c >> 16) & 0xFF]) << 16
+             | static_cast<std::uint32_t>(grade.curve[1][(c >> 8) & 0xFF]) << 8 | grade.curve[2][c & 0xFF];
+    }
+}
+
+
+static void grade_row_argb(std::uint32_t* p, int count, const Color_grade& grade)
+{
+    if (!grade.mixes)
+    {
+        grade_curves_argb(p, count, grade);
+        return;
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        const std::uint32_t c = p[i];
+        const int r = (c >> 16) & 0xFF, g = (c >> 8) & 0xFF, b = c & 0xFF;
+
+        p[i] = (c & 0xFF000000u) | static_cast<std::uint32_t>(grade.curve[0][grade_mix(grade.matrix[0], r, g, b)]) << 16
+             | static_cast<std::uint32_t>(grade.curve[1][grade_mix(grade.matrix[1], r, g, b)]) << 8
+             | grade.curve[2][grade_mix(grade.matrix[2], r, g, b)];
+    }
+}
+
+
+// Expanded to 8 bits like blit_rgb565_to_argb(), truncated back like blit_argb_to_rgb565()
+static void grade_row_rgb565(std::uint16_t* p, int count, const Color_grade& grade)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        const std::uint32_t c = convert_pixel<std::uint32_t>(p[i]);
+
+        int r = (c >> 16) & 0xFF, g = (c >> 8) & 0xFF, b = c & 0xFF;
+
+        if (grade.mixes)
+        {
+            const int mr = grade_mix(grade.matrix[0], r, g, b);
+            const int mg = grade_mix(grade.matrix[1], r, g, b);
+
+            b = grade_mix(grade.matrix[2], r, g, b);
+            r = mr;
+            g = mg;
+        }
+
+        p[i] = static_cast<std::uint16_t>((grade.curve[0][r] >> 3) << 11 | (grade.curve[1][g] >> 2) << 5 | grade.curve[2][b] >> 3);
+    }
+}
+
+
+void blit_color_grade_scalar(void* pixels, int pitch, Uint32 format, int w, int h, const Color_grade& grade)
+{
+    if (grade.is_identity()) return;
+
+    for (int y = 0; y < h; ++y)
+    {
+        std::uint8_t* row = static_cast<std::uint8_t*>(pixels) + static_cast<std::ptrdiff_t>(y) * pitch;
+
+        if (format == SDL_PIXELFORMAT_ARGB8888) grade_row_argb(reinterpret_cast<std::uint32_t*>(row), w, grade);
+        else if (format == SDL_PIXELFORMAT_RGB565) grade_row_rgb565(reinterpret_cast<std::uint16_t*>(row), w, grade);
+    }
+}
+
+// === COLOR GRADE ===
+
+// =========================================================================================== SCALAR KERNELS
+
+
+// =========================================================================================== NEON KERNELS
+
+#ifdef BLIT_NEON
+
+// Same rounding as div255(): (x + ((x + 128) >> 8) + 128) >> 8, narrowed to 8 bits
+static inline uint8x8_t div255_neon(uint16x8_t x) { return vraddhn_u16(x, vrshrq_n_u16(x, 8)); }
+
+
+// 8 pixels per iteration, deinterleaved into the B, G, R, A planes by vld4 (little endian ARGB8888)
+
+static void fill_argb_neon(std::uint32_t* dst, int count, std::uint32_t color)
+{
+    const uint32x4_t c = vdupq_n_u32(color);
+
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        vst1q_u32(dst + i, c);
+        vst1q_u32(dst + i + 4, c);
+    }
+
+    blit_fill_argb_scalar(dst + i, count - i, color);
+}
+
+
+static void blend_argb_neon(std::uint32_t* dst, const std::uint32_t* src, int count)
+{
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        uint8x8x4_t s = vld4_u8(reinterpret_cast<const std::uint8_t*>(src + i));
+        uint8x8x4_t d = vld4_u8(reinterpret_cast<const std::uint8_t*>(dst + i));
+
+        const uint8x8_t a = s.val[3];
+        const uint8x8_t ia = vmvn_u8(a);
+
+        for (int c = 0; c < 3; ++c)
+        {
+            uint16x8_t t = vmull_u8(s.val[c], a);
+            t = vmlal_u8(t, d.val[c], ia);
+
+            d.val[c] = div255_neon(t);
+        }
+
+        d.val[3] = vadd_u8(a, div255_neon(vmull_u8(d.val[3], ia)));
+
+        vst4_u8(reinterpret_cast<std::uint8_t*>(dst + i), d);
+    }
+
+    blit_blend_argb_scalar(dst + i, src + i, count - i);
+}
+
+
+static void blend_premultiplied_argb_neon(std::uint32_t* dst, const std::uint32_t* src, int count)
+{
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        const uint8x8x4_t s = vld4_u8(reinterpret_cast<const std::uint8_t*>(src + i));
+        uint8x8x4_t d = vld4_u8(reinterpret_cast<const std::uint8_t*>(dst + i));
+
+        const uint8x8_t ia = vmvn_u8(s.val[3]);
+
+        for (int c = 0; c < 4; ++c) d.val[c] = vqadd_u8(s.val[c], div255_neon(vmull_u8(d.val[c], ia)));
+
+        vst4_u8(reinterpret_cast<std::uint8_t*>(dst + i), d);
+    }
+
+    blit_blend_premultiplied_argb_scalar(dst + i, src + i, count - i);
+}
+
+
+static void premultiply_argb_neon(std::uint32_t* dst, const std::uint32_t* src, int count)
+{
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        uint8x8x4_t s = vld4_u8(reinterpret_cast<const std::uint8_t*>(src + i));
+
+        for (int c = 0; c < 3; ++c) s.val[c] = div255_neon(vmull_u8(s.val[c], s.val[3]));
+
+        vst4_u8(reinterpret_cast<std::uint8_t*>(dst + i), s);
+    }
+
+    blit_premultiply_argb_scalar(dst + i, src + i, count - i);
+}
+
+
+static void color_mod_argb_neon(std::uint32_t* dst, const std::uint32_t* src, int count, SDL_Color mod)
+{
+    const uint8x8_t m[4] = {vdup_n_u8(mod.b), vdup_n_u8(mod.g), vdup_n_u8(mod.r), vdup_n_u8(mod.a)};
+
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        uint8x8x4_t s = vld4_u8(reinterpret_cast<const std::uint8_t*>(src + i));
+
+        for (int c = 0; c < 4; ++c) s.val[c] = div255_neon(vmull_u8(s.val[c], m[c]));
+
+        vst4_u8(reinterpret_cast<std::uint8_t*>(dst + i), s);
+    }
+
+    blit_color_mod_argb_scalar(dst + i, src + i, count - i, mod);
+}
+
+
+static void rgb565_to_argb_neon(std::uint32_t* dst, const std::uint16_t* src, int count)
+{
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        const uint16x8_t p = vld1q_u16(src + i);
+
+        uint8x8x4_t out;
+
+        uint8x8_t r = vand_u8(vshrn_n_u16(p, 8), vdup_n_u8(0xF8));
+        uint8x8_t g = vand_u8(vshrn_n_u16(p, 3), vdup_n_u8(0xFC));
+        uint8x8_t b = vmovn_u16(vshlq_n_u16(p, 3));
+
+        out.val[0] = vorr_u8(b, vshr_n_u8(b, 5));
+        out.val[1] = vorr_u8(g, vshr_n_u8(g, 6));
+        out.val[2] = vorr_u8(r, vshr_n_u8(r, 5));
+        out.val[3] = vdup_n_u8(0xFF);
+
+        vst4_u8(reinterpret_cast<std::uint8_t*>(dst + i), out);
+    }
+
+    blit_rgb565_to_argb_scalar(dst + i, src + i, count - i);
+}
+
+
+static void argb_to_rgb565_neon(std::uint16_t* dst, const std::uint32_t* src, int count)
+{
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        const uint8x8x4_t s = vld4_u8(reinterpret_cast<const std::uint8_t*>(src + i));
+
+        // Shift-right-and-insert keeps the already placed high bits: RRRRR GGGGGG BBBBB
+        uint16x8_t p = vshll_n_u8(s.val[2], 8);
+        p = vsriq_n_u16(p, vshll_n_u8(s.val[1], 8), 5);
+        p = vsriq_n_u16(p, vshll_n_u8(s.val[0], 8), 11);
+
+        vst1q_u16(dst + i, p);
+    }
+
+    blit_argb_to_rgb565_scalar(dst + i, src + i, count - i);
+}
+
+
+// Pixels of a row backwards: dst[i] = src_end[-1 - i]. vrev64 swaps the pixels in the
+// 64-bit halves, the halves are swapped by the combine
+
+static void reverse_argb_neon(std::uint32_t* dst, const std::uint32_t* src_end, int count)
+{
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        const uint32x4_t r = vrev64q_u32(vld1q_u32(src_end - i - 4));
+
+        vst1q_u32(dst + i, vcombine_u32(vget_high_u32(r), vget_low_u32(r)));
+    }
+
+    for (; i < count; ++i) dst[i] = src_end[-1 - i];
+}
+
+
+static void reverse_rgb565_neon(std::uint16_t* dst, const std::uint16_t* src_end, int count)
+{
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        const uint16x8_t r = vrev64q_u16(vld1q_u16(src_end - i - 8));
+
+        vst1q_u16(dst + i, vcombine_u16(vget_high_u16(r), vget_low_u16(r)));
+    }
+
+    for (; i < count; ++i) dst[i] = src_end[-1 - i];
+}
+
+
+// 16 pixels of one row per iteration - the 8 chroma samples are computed once and doubled by vzip.
+// The sums are 16-bit: only B can pass 32767, vqadd saturates it and vqshrun clamps it to 255 anyway.
+// Returns the pixels done.
+static int yuv420_row_neon(std::uint8_t* dst, Uint32 dst_format, const Uint8* y, const Uint8* u, const Uint8* v,
+                           int count, const Yuv_factors& f)
+{
+    const int16x8_t y_shift = vdupq_n_s16(static_cast<std::int16_t>(f.y_shift));
+    const int16x8_t bias = vdupq_n_s16(128);
+
+    int x = 0;
+
+    for (; x + 16 <= count; x += 16)
+    {
+        const int16x8_t cu = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(u + x / 2))), bias);
+        const int16x8_t cv = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(v + x / 2))), bias);
+
+        const int16x8_t cr = vmulq_n_s16(cv, static_cast<std::int16_t>(f.v_r));
+        const int16x8_t cg = vmlaq_n_s16(vmulq_n_s16(cu, static_cast<std::int16_t>(f.u_g)), cv, static_cast<std::int16_t>(f.v_g));
+        const int16x8_t cb = vmulq_n_s16(cu, static_cast<std::int16_t>(f.u_b));
+
+        // Every chroma sample for two pixels
+        const int16x8x2_t r2 = vzipq_s16(cr, cr);
+        const int16x8x2_t g2 = vzipq_s16(cg, cg);
+        const int16x8x2_t b2 = vzipq_s16(cb, cb);
+
+        const uint8x16_t luma8 = vld1q_u8(y + x);
+
+        for (int half = 0; half < 2; ++half)
+        {
+            const uint8x8_t l = half ? vget_high_u8(luma8) : vget_low_u8(luma8);
+
+            const int16x8_t luma = vmulq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(l)), y_shift), static_cast<std::int16_t>(f.y));
+
+            const uint8x8_t r = vqshrun_n_s16(vqaddq_s16(luma, r2.val[half]), 6);
+            const uint8x8_t g = vqshrun_n_s16(vqaddq_s16(luma, g2.val[half]), 6);
+            const uint8x8_t b = vqshrun_n_s16(vqaddq_s16(luma, b2.val[half]), 6);
+
+            if (dst_format == SDL_PIXELFORMAT_RGB565)
+            {
+                uint16x8_t p = vshll_n_u8(r, 8);
+                p = vsriq_n_u16(p, vshll_n_u8(g, 8), 5);
+                p = vsriq_n_u16(p, vshll_n_u8(b, 8), 11);
+
+                vst1q_u16(reinterpret_cast<std::uint16_t*>(dst) + x + half * 8, p);
+            }
+            else
+            {
+                const uint8x8x4_t out = {{b, g, r, vdup_n_u8(0xFF)}};
+
+                vst4_u8(dst + static_cast<std::ptrdiff_t>(x + half * 8) * 4, out);
+            }
+        }
+    }
+
+    return x;
+}
+
+
+// Channel mix of the color grade, the curves are left to the caller. Returns the pixels done (8 per iteration).
+// The products are 32-bit (the weights go to +-8.0), narrowed with the rounding of grade_mix().
+static int grade_mix_argb_neon(std::uint32_t* p, int count, const Color_grade& grade)
+{
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        uint8x8x4_t s = vld4_u8(reinterpret_cast<const std::uint8_t*>(p + i));
+
+        // The R, G, B inputs of the matrix - the planes 2, 1, 0
+        const int16x8_t in[3] = {vreinterpretq_s16_u16(vmovl_u8(s.val[2])),
+                                 vreinterpretq_s16_u16(vmovl_u8(s.val[1])),
+                                 vreinterpretq_s16_u16(vmovl_u8(s.val[0]))};
+
+        for (int o = 0; o < 3; ++o)
+        {
+            const std::int16_t* m = grade.matrix[o];
+
+            int32x4_t lo = vmull_n_s16(vget_low_s16(in[0]), m[0]);
+            lo = vmlal_n_s16(lo, vget_low_s16(in[1]), m[1]);
+            lo = vmlal_n_s16(lo, vget_low_s16(in[2]), m[2]);
+
+            int32x4_t hi = vmull_n_s16(vget_high_s16(in[0]), m[0]);
+            hi = vmlal_n_s16(hi, vget_high_s16(in[1]), m[1]);
+            hi = vmlal_n_s16(hi, vget_high_s16(in[2]), m[2]);
+
+            s.val[2 - o] = vqmovun_s16(vcombine_s16(vqrshrn_n_s32(lo, 8), vqrshrn_n_s32(hi, 8)));
+        }
+
+        vst4_u8(reinterpret_cast<std::uint8_t*>(p + i), s);
+    }
+
+    return i;
+}
+
+#endif
+
+// =========================================================================================== NEON KERNELS
+
+
+// =========================================================================================== SELECTED KERNELS
+
+#ifdef BLIT_NEON
+
+void blit_fill_argb(std::uint32_t* dst, int count, std::uint32_t color) { fill_argb_neon(dst, count, color); }
+
+void blit_blend_argb(std::uint32_t* dst, const std::uint32_t* src, int count) { blend_argb_neon(dst, src, count); }
+
+void blit_blend_premultiplied_argb(std::uint32_t* dst, const std::uint32_t* src, int count) { blend_premultiplied_argb_neon(dst, src, count); }
+
+void blit_premultiply_argb(std::uint32_t* dst, const std::uint32_t* src, int count) { premultiply_argb_neon(dst, src, count); }
+
+void blit_color_mod_argb(std::uint32_t* dst, const std::uint32_t* src, int count, SDL_Color mod) { color_mod_argb_neon(dst, src, count, mod); }
+
+void blit_rgb565_to_argb(std::uint32_t* dst, const std::uint16_t* src, int count) { rgb565_to_argb_neon(dst, src, count); }
+
+void blit_argb_to_rgb565(std::uint16_t* dst, const std::uint32_t* src, int count) { argb_to_rgb565_neon(dst, src, count); }
+
+const char* blit_kernel_name() { return "neon"; }
+
+#else
+
+void blit_fill_argb(std::uint32_t* dst, int count, std::uint32_t color) { blit_fill_argb_scalar(dst, count, color); }
+
+void blit_blend_argb(std::uint32_t* dst, const std::uint32_t* src, int count) { blit_blend_argb_scalar(dst, src, count); }
+
+void blit_blend_premultiplied_argb(std::uint32_t* dst, const std::uint32_t* src, int count) { blit_blend_premultiplied_argb_scalar(dst, src, count); }
+
+void blit_premultiply_argb(std::uint32_t* dst, const std::uint32_t* src, int count) { blit_premultiply_argb_scalar(dst, src, count); }
+
+void blit_color_mod_argb(std::uint32_t* dst, const std::uint32_t* src, int count, SDL_Color mod) { blit_color_mod_argb_scalar(dst, src, count, mod); }
+
+void blit_rgb565_to_argb(std::uint32_t* dst, const std::uint16_t* src, int count) { blit_rgb565_to_argb_scalar(dst, src, count); }
+
+void blit_argb_to_rgb565(std::uint16_t* dst, const std::uint32_t* src, int count) { blit_argb_to_rgb565_scalar(dst, src, count); }
+
+const char* blit_kernel_name() { return "scalar"; }
+
+#endif
+
+
+void blit_fill_rect_argb(std::uint32_t* dst, int pitch, int w, int h, std::uint32_t color)
+{
+    auto* row = reinterpret_cast<std::uint8_t*>(dst);
+
+    for (int y = 0; y < h; ++y, row += pitch) blit_fill_argb(reinterpret_cast<std::uint32_t*>(row), w, color);
+}
+
+
+#ifdef BLIT_NEON
+
+// One panel row of an unscaled 0 or 180 degree turn - backwards in chunks, which stay in the L1 cache
+static void present_row(void* dst, Uint32 dst_format, const void* src, Uint32 src_format, int count, bool backwards)
+{
+    const bool dst_32 = dst_format == SDL_PIXELFORMAT_ARGB8888;
+    const bool src_32 = src_format == SDL_PIXELFORMAT_ARGB8888;
+
+    if (!backwards)
+    {
+        if (dst_32 == src_32) std::memcpy(dst, src, static_cast<size_t>(count) * SDL_BYTESPERPIXEL(src_format));
+        else if (dst_32) rgb565_to_argb_neon(static_cast<std::uint32_t*>(dst), static_cast<const std::uint16_t*>(src), count);
+        else argb_to_rgb565_neon(static_cast<std::uint16_t*>(dst), static_cast<const std::uint32_t*>(src), count);
+
+        return;
+    }
+
+    if (dst_32 && src_32)
+    {
+        reverse_argb_neon(static_cast<std::uint32_t*>(dst), static_cast<const std::uint32_t*>(src) + count, count);
+        return;
+    }
+
+    if (!dst_32 && !src_32)
+    {
+        reverse_rgb565_neon(static_cast<std::uint16_t*>(dst), static_cast<const std::uint16_t*>(src) + count, count);
+        return;
+    }
+
+    constexpr int CHUNK = 64;
+
+    for (int i = 0; i < count; i += CHUNK)
+    {
+        const int n = std::min(CHUNK, count - i);
+
+        if (src_32)
+        {
+            std::uint32_t chunk[CHUNK];
+
+            reverse_argb_neon(chunk, static_cast<const std::uint32_t*>(src) + count - i, n);
+            argb_to_rgb565_neon(static_cast<std::uint16_t*>(dst) + i, chunk, n);
+        }
+        else
+        {
+            std::uint16_t chunk[CHUNK];
+
+            reverse_rgb565_neon(chunk, static_cast<const std::uint16_t*>(src) + count - i, n);
+            rgb565_to_argb_neon(static_cast<std::uint32_t*>(dst) + i, chunk, n);
+        }
+    }
+}
+
+
+void blit_present(void* dst, int dst_pitch, Uint32 dst_format, int dst_w, int dst_h,
+                  const void* src, int src_pitch, Uint32 src_format, int src_w, int src_h, int quarter_turns)
+{
+    quarter_turns &= 3;
+
+    const bool row_order = (quarter_turns & 1) == 0 && src_w == dst_w && src_h == dst_h;
+
+    if (!row_order || !is_present_format(dst_format) || !is_present_format(src_format) || dst_w <= 0 || dst_h <= 0)
+    {
+        blit_present_scalar(dst, dst_pitch, dst_format, dst_w, dst_h, src, src_pitch, src_format, src_w, src_h, quarter_turns);
+        return;
+    }
+
+    const bool backwards = quarter_turns == 2;
+
+    for (int y = 0; y < dst_h; ++y)
+    {
+        const int source_y = backwards ? src_h - 1 - y : y;
+
+        present_row(static_cast<std::uint8_t*>(dst) + static_cast<std::ptrdiff_t>(y) * dst_pitch, dst_format,
+                    static_cast<const std::uint8_t*>(src) + static_cast<std::ptrdiff_t>(source_y) * src_pitch, src_format,
+                    dst_w, backwards);
+    }
+}
+
+
+void blit_yuv420(void* dst, int dst_pitch, Uint32 dst_format, int w, int h,
+                 const Uint8* y, int y_pitch, const Uint8* u, const Uint8* v, int uv_pitch)
+{
+    const Yuv_factors& f = yuv_factors(h);
+
+    for (int row = 0; row < h; ++row)
+    {
+        std::uint8_t* out = static_cast<std::uint8_t*>(dst) + static_cast<std::ptrdiff_t>(row) * dst_pitch;
+
+        const Uint8* luma = y + static_cast<std::ptrdiff_t>(row) * y_pitch;
+        const Uint8* cu = u + static_cast<std::ptrdiff_t>(row / 2) * uv_pitch;
+        const Uint8* cv = v + static_cast<std::ptrdiff_t>(row / 2) * uv_pitch;
+
+        const int done = yuv420_row_neon(out, dst_format, luma, cu, cv, w, f);
+
+        yuv420_row(out, dst_format, luma, cu, cv, done, w, f);
+    }
+}
+
+
+void blit_color_grade(void* pixels, int pitch, Uint32 format, int w, int h, const Color_grade& grade)
+{
+    if (format != SDL_PIXELFORMAT_ARGB8888 || !grade.mixes)
+    {
+        blit_color_grade_scalar(pixels, pitch, format, w, h, grade);
+        return;
+    }
+
+    for (int y = 0; y < h; ++y)
+    {
+        auto* row = reinterpret_cast<std::uint32_t*>(static_cast<std::uint8_t*>(pixels) + static_cast<std::ptrdiff_t>(y) * pitch);
+
+        const int done = grade_mix_argb_neon(row, w, grade);
+
+        if (grade.curved) grade_curves_argb(row, done, grade);
+
+        grade_row_argb(row + done, w - done, grade);
+    }
+}
+
+#else
+
+void blit_present(void* dst, int dst_pitch, Uint32 dst_format, int dst_w, int dst_h,
+                  const void* src, int src_pitch, Uint32 src_format, int src_w, int src_h, int quarter_turns)
+{
+    blit_present_scalar(dst, dst_pitch, dst_format, dst_w, dst_h, src, src_pitch, src_format, src_w, src_h, quarter_turns);
+}
+
+
+void blit_yuv420(void* dst, int dst_pitch, Uint32 dst_format, int w, int h,
+                 const Uint8* y, int y_pitch, const Uint8* u, const Uint8* v, int uv_pitch)
+{
+    blit_yuv420_scalar(dst, dst_pitch, dst_format, w, h, y, y_pitch, u, v, uv_pitch);
+}
+
+
+void blit_color_grade(void* pixels, int pitch, Uint32 format, int w, int h, const Color_grade& grade)
+{
+    blit_color_grade_scalar(pixels, pitch, format, w, h, grade);
+}
+
+#endif
+
+// =========================================================================================== SELECTED KERNELS
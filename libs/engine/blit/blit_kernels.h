@@ -0,0 +1,125 @@
+// blit_kernels.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+
+#include "../platform/platform.h"
+#include "color_grade.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== KERNEL SELECTION
+
+// NEON kernels are compiled for the ARM Linux builds (Miyoo Mini+ Cortex-A7),
+// the Windows dev build and the other CPUs use the scalar ones.
+#if defined(PLATFORM_LINUX) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+    #define BLIT_NEON
+#endif
+
+// =========================================================================================== KERNEL SELECTION
+
+
+// =========================================================================================== BLIT KERNELS
+
+/**
+ * Software path pixel kernels over the 32-bit ARGB8888 (0xAARRGGBB) and 16-bit RGB565 pixels.
+ *
+ * The plain names are the best kernels of the build (NEON or scalar), the _scalar
+ * versions are always available - for the fallback and the comparison in miyoo_blit_bench.
+ * Both versions give bit-identical results: the division by 255 is rounded the same way.
+ *
+ * Counts are in pixels, pitches - in bytes. The buffers could be unaligned.
+ */
+
+
+// Fills count pixels with the color
+void blit_fill_argb(std::uint32_t* dst, int count, std::uint32_t color);
+void blit_fill_argb_scalar(std::uint32_t* dst, int count, std::uint32_t color);
+
+// Fills the w x h rectangle of the surface pixels
+void blit_fill_rect_argb(std::uint32_t* dst, int pitch, int w, int h, std::uint32_t color);
+
+
+// Source-over alpha blend (SDL_BLENDMODE_BLEND) of src onto dst:
+// dst.rgb = src.rgb * a + dst.rgb * (1 - a), dst.a = a + dst.a * (1 - a)
+void blit_blend_argb(std::uint32_t* dst, const std::uint32_t* src, int count);
+void blit_blend_argb_scalar(std::uint32_t* dst, const std::uint32_t* src, int count);
+
+// Source-over of the premultiplied src (blend_mode_premultiplied()) onto dst - one product per channel:
+// dst = src + dst * (1 - a), saturated (a color above its alpha isn't a valid premultiplied one)
+void blit_blend_premultiplied_argb(std::uint32_t* dst, const std::uint32_t* src, int count);
+void blit_blend_premultiplied_argb_scalar(std::uint32_t* dst, const std::uint32_t* src, int count);
+
+// Straight to the premultiplied alpha: dst.rgb = src.rgb * a, the alpha is kept
+void blit_premultiply_argb(std::uint32_t* dst, const std::uint32_t* src, int count);
+void blit_premultiply_argb_scalar(std::uint32_t* dst, const std::uint32_t* src, int count);
+
+// Premultiplied back to the straight alpha: dst.rgb = src.rgb / a (0 at a = 0) - a division
+// per channel, scalar only - for the uploads to the renderers without blend_mode_premultiplied()
+void blit_unpremultiply_argb(std::uint32_t* dst, const std::uint32_t* src, int count);
+
+// SDL_ComposeCustomBlendMode() of the premultiplied source-over: ONE, ONE_MINUS_SRC_ALPHA, ADD
+SDL_BlendMode blend_mode_premultiplied();
+
+
+// Color and alpha modulation: dst = src * mod / 255 per channel
+void blit_color_mod_argb(std::uint32_t* dst, const std::uint32_t* src, int count, SDL_Color mod);
+void blit_color_mod_argb_scalar(std::uint32_t* dst, const std::uint32_t* src, int count, SDL_Color mod);
+
+
+// RGB565 to ARGB8888 (opaque, the low bits are filled by the high ones)
+void blit_rgb565_to_argb(std::uint32_t* dst, const std::uint16_t* src, int count);
+void blit_rgb565_to_argb_scalar(std::uint32_t* dst, const std::uint16_t* src, int count);
+
+// ARGB8888 to RGB565 (truncated, the alpha is dropped)
+void blit_argb_to_rgb565(std::uint16_t* dst, const std::uint32_t* src, int count);
+void blit_argb_to_rgb565_scalar(std::uint16_t* dst, const std::uint32_t* src, int count);
+
+
+/**
+ * Present pass of a drawn frame into the panel memory - turned, scaled and converted at once.
+ *
+ * The frame is turned clockwise by quarter_turns * 90 degrees, scaled to dst_w x dst_h
+ * (nearest, the pixel centers) and converted between the formats (SDL_PIXELFORMAT_ARGB8888,
+ * SDL_PIXELFORMAT_RGB565) - every panel pixel is written once, the frame isn't copied
+ * in between. The unscaled 0 and 180 degree turns go row by row through the NEON kernels,
+ * the others through 32 x 32 tiles, so the column walk of a quarter turn stays in the cache.
+ */
+void blit_present(void* dst, int dst_pitch, Uint32 dst_format, int dst_w, int dst_h,
+                  const void* src, int src_pitch, Uint32 src_format, int src_w, int src_h, int quarter_turns);
+void blit_present_scalar(void* dst, int dst_pitch, Uint32 dst_format, int dst_w, int dst_h,
+                         const void* src, int src_pitch, Uint32 src_format, int src_w, int src_h, int quarter_turns);
+
+
+/**
+ * YUV 4:2:0 (the IYUV planes) to ARGB8888 or RGB565 - the video frames for a renderer, which can't sample YUV.
+ *
+ * The fixed-point conversion of the yuv2rgb kernels vendored by SDL (src/video/yuv2rgb, 6 fraction
+ * bits, the chroma of a 2 x 2 block shared) with the matrix SDL picks for the size: BT.601 up to 576
+ * lines, BT.709 above - the picture is the one of the GPU renderers. The NEON kernel converts
+ * 16 pixels per iteration, the vendored library has the SSE and the plain C versions only.
+ * RGB565 is truncated like blit_argb_to_rgb565().
+ */
+void blit_yuv420(void* dst, int dst_pitch, Uint32 dst_format, int w, int h,
+                 const Uint8* y, int y_pitch, const Uint8* u, const Uint8* v, int uv_pitch);
+void blit_yuv420_scalar(void* dst, int dst_pitch, Uint32 dst_format, int w, int h,
+                        const Uint8* y, int y_pitch, const Uint8* u, const Uint8* v, int uv_pitch);
+
+
+/**
+ * Color grading of the w x h pixels in place (SDL_PIXELFORMAT_ARGB8888 or SDL_PIXELFORMAT_RGB565),
+ * the last pass of the present. The channel mix of ARGB8888 runs in the NEON kernel,
+ * the curves are the table lookups of the row just mixed (still in the cache).
+ */
+void blit_color_grade(void* pixels, int pitch, Uint32 format, int w, int h, const Color_grade& grade);
+void blit_color_grade_scalar(void* pixels, int pitch, Uint32 format, int w, int h, const Color_grade& grade);
+
+
+// Name of the selected kernel set: "neon" or "scalar"
+const char* blit_kernel_name();
+
+// =========================================================================================== BLIT KERNELS
@@ -0,0 +1,80 @@
+// color_grade.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "color_grade.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== COLOR GRADE
+
+// Rec. 601 luma weights of R, G, B
+static constexpr float LUMA[3] = {0.299f, 0.587f, 0.114f};
+
+
+Color_grade::Color_grade()
+{
+    for (int o = 0; o < 3; ++o)
+    {
+        for (int i = 0; i < 3; ++i) matrix[o][i] = o == i ? 256 : 0;
+        for (int v = 0; v < 256; ++v) curve[o][v] = static_cast<std::uint8_t>(v);
+    }
+}
+
+
+void Color_grade::set_saturation(float saturation)
+{
+    for (int o = 0; o < 3; ++o)
+        for (int i = 0; i < 3; ++i)
+        {
+            const float weight = LUMA[i] * (1.0f - saturation) + (o == i ? saturation : 0.0f);
+
+            matrix[o][i] = static_cast<std::int16_t>(std::clamp(std::lround(weight * 256.0f), -2048L, 2048L));
+        }
+
+    update_flags();
+}
+
+
+void Color_grade::set_tint(SDL_Color color, float amount)
+{
+    const float t = std::clamp(amount, 0.0f, 1.0f);
+    const Uint8 target[3] = {color.r, color.g, color.b};
+
+    for (int o = 0; o < 3; ++o)
+        for (int v = 0; v < 256; ++v)
+            curve[o][v] = static_cast<std::uint8_t>(std::lround(v + (target[o] - v) * t));
+
+    update_flags();
+}
+
+
+void Color_grade::set_curves(const std::uint8_t* r, const std::uint8_t* g, const std::uint8_t* b)
+{
+    std::memcpy(curve[0], r, 256);
+    std::memcpy(curve[1], g, 256);
+    std::memcpy(curve[2], b, 256);
+
+    update_flags();
+}
+
+
+void Color_grade::update_flags()
+{
+    mixes = false;
+    curved = false;
+
+    for (int o = 0; o < 3; ++o)
+    {
+        for (int i = 0; i < 3; ++i) mixes |= matrix[o][i] != (o == i ? 256 : 0);
+        for (int v = 0; v < 256; ++v) curved |= curve[o][v] != v;
+    }
+}
+
+// =========================================================================================== COLOR GRADE
@@ -0,0 +1,68 @@
+// color_grade.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== COLOR GRADE
+
+
+/**
+ * @brief Full-screen color grading of the presented frame: a channel mix, then the per-channel curves.
+ *
+ * out = curve[channel](clamp(matrix * (r, g, b))), the alpha is kept. The mix does the
+ * cross-channel grades (the desaturation on pause), the curves - the rest (the theme tints,
+ * the flashes, the gamma). Under 1 KB - a theme keeps its grade built, and the swap of the
+ * grades is a pointer store (Frame::set_color_grade()), the assets aren't touched.
+ *
+ * Applied by blit_color_grade() on the framebuffer output at the present.
+ *
+ * Usage:
+ * @code
+ * static Color_grade paused;
+ * paused.set_saturation(0.2f);
+ *
+ * Frame::Instance().set_color_grade(&paused);    // on pause
+ * Frame::Instance().set_color_grade(nullptr);    // on resume
+ * @endcode
+ */
+struct Color_grade
+{
+    // Output R, G, B rows of the input R, G, B weights, 256 - 1.0
+    std::int16_t matrix[3][3];
+
+    // Output R, G, B curves after the mix
+    std::uint8_t curve[3][256];
+
+    // The matrix isn't the identity / a curve isn't the identity - the kernel skips the identity stages
+    bool mixes = false;
+    bool curved = false;
+
+
+    // Identity grade
+    Color_grade();
+
+    // Saturation of the mix (Rec. 601 luma): 0 - grey, 1 - as is, above 1 - more saturated
+    void set_saturation(float saturation);
+
+    // Curves pulled toward the color: amount 0 - as is, 1 - the flat color (the flash)
+    void set_tint(SDL_Color color, float amount);
+
+    // Curves of the theme, 256 entries each
+    void set_curves(const std::uint8_t* r, const std::uint8_t* g, const std::uint8_t* b);
+
+    bool is_identity() const { return !mixes && !curved; }
+
+private:
+
+    void update_flags();
+};
+
+// =========================================================================================== COLOR GRADE
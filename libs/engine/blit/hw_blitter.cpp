@@ -0,0 +1,830 @@
+// hw_blitter.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "hw_blitter.h"
+#include "blit_kernels.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#ifdef PLATFORM_LINUX
+    #include <dlfcn.h>
+#endif
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== MI GFX API
+
+// The layouts of mi_sys_datatype.h and mi_gfx_datatype.h of the SSD20x SDK - the vendor
+// headers aren't a part of the build, the libraries are loaded by name
+namespace
+{
+    typedef std::int32_t Mi_s32;
+    typedef std::uint64_t Mi_phy;
+
+    constexpr Mi_s32 MI_SUCCESS = 0;
+
+    // MI_GFX_ColorFmt_e
+    constexpr std::int32_t MI_GFX_FMT_RGB565 = 6;
+    constexpr std::int32_t MI_GFX_FMT_ARGB8888 = 11;
+
+    // MI_GFX_DfbBldOp_e
+    constexpr std::int32_t MI_GFX_BLD_ZERO = 0;
+    constexpr std::int32_t MI_GFX_BLD_ONE = 1;
+    constexpr std::int32_t MI_GFX_BLD_SRCALPHA = 4;
+    constexpr std::int32_t MI_GFX_BLD_INVSRCALPHA = 5;
+
+    // MI_Gfx_DfbBlendFlags_e
+    constexpr std::int32_t MI_GFX_BLEND_NOFX = 0;
+    constexpr std::int32_t MI_GFX_BLEND_COLORALPHA = 0x1;
+    constexpr std::int32_t MI_GFX_BLEND_ALPHACHANNEL = 0x2;
+
+
+    struct Mi_gfx_surface
+    {
+        Mi_phy physical;
+        std::int32_t format;
+        std::uint32_t width;
+        std::uint32_t height;
+        std::uint32_t stride;
+    };
+
+
+    struct Mi_gfx_rect
+    {
+        std::int32_t x;
+        std::int32_t y;
+        std::uint32_t w;
+        std::uint32_t h;
+    };
+
+
+    struct Mi_gfx_color_key
+    {
+        std::uint8_t enable;
+        std::int32_t op;
+        std::int32_t format;
+        std::uint32_t start;
+        std::uint32_t end;
+    };
+
+
+    struct Mi_gfx_opt
+    {
+        Mi_gfx_rect clip;
+        Mi_gfx_color_key src_key;
+        Mi_gfx_color_key dst_key;
+        std::uint8_t rop_enable;
+        std::int32_t rop;
+        std::int32_t src_blend;
+        std::int32_t dst_blend;
+        std::int32_t mirror;
+        std::int32_t rotate;
+        std::int32_t src_yuv;
+        std::int32_t dst_yuv;
+        std::int32_t blend_flags;
+        std::uint32_t src_const_color;
+        std::uint32_t dst_const_color;
+
+        // Zeroed - the later SDK versions have more fields at the end
+        std::uint32_t reserved[16];
+    };
+
+
+    struct Mi_api
+    {
+        Mi_s32 (*sys_init)();
+        Mi_s32 (*mma_alloc)(std::uint8_t* heap, std::uint32_t size, Mi_phy* physical);
+        Mi_s32 (*mma_free)(Mi_phy physical);
+        Mi_s32 (*mmap)(Mi_phy physical, std::uint32_t size, void** memory, std::uint8_t cached);
+        Mi_s32 (*munmap)(void* memory, std::uint32_t size);
+        Mi_s32 (*flush_cache)(void* memory, std::uint32_t size);
+
+        Mi_s32 (*gfx_open)();
+        Mi_s32 (*gfx_close)();
+        Mi_s32 (*quick_fill)(Mi_gfx_surface* dst, Mi_gfx_rect* rect, std::uint32_t color, std::uint16_t* fence);
+        Mi_s32 (*bit_blit)(Mi_gfx_surface* src, Mi_gfx_rect* src_rect, Mi_gfx_surface* dst, Mi_gfx_rect* dst_rect,
+                           Mi_gfx_opt* opt, std::uint16_t* fence);
+        Mi_s32 (*wait_all_done)(std::uint8_t all, std::uint16_t fence);
+    };
+
+    Mi_api api = {};
+
+
+    Mi_gfx_rect to_gfx(const SDL_Rect& rect)
+    {
+        return {rect.x, rect.y, static_cast<std::uint32_t>(rect.w), static_cast<std::uint32_t>(rect.h)};
+    }
+
+
+    Uint32 pixel_at(const void* memory, int pitch, int x, int y)
+    {
+        return static_cast<const Uint32*>(static_cast<const void*>(static_cast<const std::uint8_t*>(memory) + y * pitch))[x];
+    }
+
+
+    // Channel within the rounding of the hardware
+    bool channel_near(Uint32 pixel, int shift, int expected) { return std::abs(static_cast<int>((pixel >> shift) & 0xFF) - expected) <= 3; }
+}
+
+// =========================================================================================== MI GFX API
+
+
+// =========================================================================================== HW BLITTER
+
+Hw_blitter& Hw_blitter::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Hw_blitter instance;
+    return instance;
+}
+
+
+Hw_blitter::~Hw_blitter() { close(); }
+
+
+bool Hw_blitter::open(SDL_Renderer* r, SDL_Surface* screen_surface, std::uint64_t screen_physical)
+{
+    if (active) return true;
+
+    if (!r || !screen_surface || screen_surface->format->format != SDL_PIXELFORMAT_ARGB8888)
+    {
+        SDL_Log("HW blitter: only the ARGB8888 framebuffer is supported - CPU drawing");
+        return false;
+    }
+
+    if (screen_physical == 0)
+    {
+        SDL_Log("HW blitter: the framebuffer physical address is unknown - CPU drawing");
+        return false;
+    }
+
+    if (!load_library()) return false;
+
+    if (api.sys_init() != MI_SUCCESS || api.gfx_open() != MI_SUCCESS)
+    {
+        SDL_Log("HW blitter: MI_GFX can't be opened - CPU drawing");
+        unload_library();
+        return false;
+    }
+
+    renderer = r;
+    screen = screen_surface;
+    screen_base = static_cast<const std::uint8_t*>(screen_surface->pixels);
+    screen_base_physical = screen_physical;
+
+    capabilities = check_capabilities();
+
+    hw_draws = 0;
+    cpu_draws = 0;
+
+    if (!(capabilities & (CAP_FILL | CAP_COPY)))
+    {
+        SDL_Log("HW blitter: MI_GFX results don't match the software renderer - CPU drawing");
+        api.gfx_close();
+        unload_library();
+        return false;
+    }
+
+    active = true;
+
+    SDL_Log("HW blitter: MI_GFX%s%s%s%s%s%s", (capabilities & CAP_FILL) ? " fill" : "", (capabilities & CAP_COPY) ? " copy" : "",
+            (capabilities & CAP_SCALE) ? " scale" : "", (capabilities & CAP_BLEND) ? " blend" : "",
+            (capabilities & CAP_RGB565) ? " rgb565" : "", (capabilities & CAP_PREMULTIPLIED) ? " premultiplied" : "");
+
+    return true;
+}
+
+
+void Hw_blitter::close()
+{
+    if (!active) return;
+
+    sync();
+
+    for (auto& [texture, surface] : mirrors) free_surface(surface);
+
+    mirrors.clear();
+    mirror_bytes = 0;
+
+    SDL_Log("HW blitter: %llu draws by the hardware, %llu declined", static_cast<unsigned long long>(hw_draws),
+            static_cast<unsigned long long>(cpu_draws));
+
+    api.gfx_close();
+    unload_library();
+
+    active = false;
+    capabilities = 0;
+    renderer = nullptr;
+    screen = nullptr;
+}
+
+
+#ifdef PLATFORM_LINUX
+
+bool Hw_blitter::load_library()
+{
+    // The GFX library needs the MI_SYS symbols - global
+    sys_library = dlopen("libmi_sys.so", RTLD_NOW | RTLD_GLOBAL);
+    gfx_library = sys_library ? dlopen("libmi_gfx.so", RTLD_NOW) : nullptr;
+
+    if (!gfx_library)
+    {
+        SDL_Log("HW blitter: MI_SYS / MI_GFX libraries not found - CPU drawing");
+        unload_library();
+        return false;
+    }
+
+    bool found = true;
+
+    auto resolve = [&found](void* library, const char* name, auto& function)
+    {
+        // POSIX way of the object to the function pointer conversion
+        void* symbol = dlsym(library, name);
+        std::memcpy(&function, &symbol, sizeof(symbol));
+
+        if (!symbol)
+        {
+            SDL_Log("HW blitter: %s not found", name);
+            found = false;
+        }
+    };
+
+    resolve(sys_library, "MI_SYS_Init", api.sys_init);
+    resolve(sys_library, "MI_SYS_MMA_Alloc", api.mma_alloc);
+    resolve(sys_library, "MI_SYS_MMA_Free", api.mma_free);
+    resolve(sys_library, "MI_SYS_Mmap", api.mmap);
+    resolve(sys_library, "MI_SYS_Munmap", api.munmap);
+    resolve(sys_library, "MI_SYS_FlushInvCache", api.flush_cache);
+    resolve(gfx_library, "MI_GFX_Open", api.gfx_open);
+    resolve(gfx_library, "MI_GFX_Close", api.gfx_close);
+    resolve(gfx_library, "MI_GFX_QuickFill", api.quick_fill);
+    resolve(gfx_library, "MI_GFX_BitBlit", api.bit_blit);
+    resolve(gfx_library, "MI_GFX_WaitAllDone", api.wait_all_done);
+
+    if (!found) unload_library();
+
+    return found;
+}
+
+
+void Hw_blitter::unload_library()
+{
+    if (gfx_library) dlclose(gfx_library);
+    if (sys_library) dlclose(sys_library);
+
+    gfx_library = nullptr;
+    sys_library = nullptr;
+
+    api = {};
+}
+
+#else
+
+bool Hw_blitter::load_library()
+{
+    SDL_Log("HW blitter: MI_GFX is available only on Linux - CPU drawing");
+    return false;
+}
+
+void Hw_blitter::unload_library() {}
+
+#endif
+
+
+bool Hw_blitter::alloc_surface(Gfx_surface& surface, int w, int h, Uint32 format, bool cached)
+{
+    // The engine reads the rows 16 bytes aligned
+    const int pitch = (w * SDL_BYTESPERPIXEL(format) + 15) & ~15;
+    const Uint32 size = static_cast<Uint32>(pitch) * static_cast<Uint32>(h);
+
+    Mi_phy physical = 0;
+
+    if (api.mma_alloc(nullptr, size, &physical) != MI_SUCCESS) return false;
+
+    void* memory = nullptr;
+
+    if (api.mmap(physical, size, &memory, cached ? 1 : 0) != MI_SUCCESS || !memory)
+    {
+        api.mma_free(physical);
+        return false;
+    }
+
+    surface = {physical, memory, size, w, h, pitch, format};
+
+    return true;
+}
+
+
+void Hw_blitter::free_surface(Gfx_surface& surface)
+{
+    if (surface.memory) api.munmap(surface.memory, surface.size);
+    if (surface.physical) api.mma_free(surface.physical);
+
+    surface = Gfx_surface{};
+}
+
+
+Uint32 Hw_blitter::check_capabilities()
+{
+    constexpr int SIZE = 64;
+
+    Gfx_surface a, b, c;
+
+    if (!alloc_surface(a, SIZE, SIZE, SDL_PIXELFORMAT_ARGB8888, false)) return 0;
+
+    if (!alloc_surface(b, SIZE, SIZE, SDL_PIXELFORMAT_ARGB8888, false))
+    {
+        free_surface(a);
+        return 0;
+    }
+
+    const bool has_rgb565 = alloc_surface(c, SIZE, SIZE, SDL_PIXELFORMAT_RGB565, false);
+
+    const SDL_Rect full = {0, 0, SIZE, SIZE};
+    const SDL_Rect quarter = {0, 0, SIZE / 2, SIZE / 2};
+
+    auto fill = [](Gfx_surface& s, Uint32 color)
+    {
+        for (int y = 0; y < SIZE; ++y)
+            for (int x = 0; x < SIZE; ++x)
+                static_cast<Uint32*>(static_cast<void*>(static_cast<std::uint8_t*>(s.memory) + y * s.pitch))[x] = color;
+    };
+
+    auto all = [](const Gfx_surface& s, auto&& test)
+    {
+        for (int y = 0; y < SIZE; ++y)
+            for (int x = 0; x < SIZE; ++x)
+                if (!test(pixel_at(s.memory, s.pitch, x, y), x, y)) return false;
+
+        return true;
+    };
+
+    Uint32 caps = 0;
+
+    // Fill
+    if (submit_fill(a, full, 0xFF204080u))
+    {
+        wait();
+
+        if (all(a, [](Uint32 p, int, int) { return p == 0xFF204080u; })) caps |= CAP_FILL;
+    }
+
+    // Copy of a pattern, exact
+    auto pattern = [](int x, int y) -> Uint32
+    {
+        return 0xFF000000u | static_cast<Uint32>(x * 4) << 16 | static_cast<Uint32>(y * 4) << 8 | static_cast<Uint32>(x ^ y);
+    };
+
+    for (int y = 0; y < SIZE; ++y)
+        for (int x = 0; x < SIZE; ++x)
+            static_cast<Uint32*>(static_cast<void*>(static_cast<std::uint8_t*>(a.memory) + y * a.pitch))[x] = pattern(x, y);
+
+    fill(b, 0);
+
+    if (submit_blit(a, full, b, full, SDL_BLENDMODE_NONE, 255))
+    {
+        wait();
+
+        if (all(b, [&pattern](Uint32 p, int x, int y) { return p == pattern(x, y); })) caps |= CAP_COPY;
+    }
+
+    // Scaled copy of a flat color - every destination pixel is covered
+    fill(a, 0xFF10A0F0u);
+    fill(b, 0);
+
+    if (submit_blit(a, quarter, b, full, SDL_BLENDMODE_NONE, 255))
+    {
+        wait();
+
+        if (all(b, [](Uint32 p, int, int) { return p == 0xFF10A0F0u; })) caps |= CAP_SCALE;
+    }
+
+    // Source-over with the alpha channel, then with the alpha modulation - half white over black.
+    // The screen alpha isn't shown, only the color is compared.
+    auto half_grey = [](Uint32 p, int, int) { return channel_near(p, 16, 128) && channel_near(p, 8, 128) && channel_near(p, 0, 128); };
+
+    fill(a, 0x80FFFFFFu);
+    fill(b, 0xFF000000u);
+
+    if (submit_blit(a, full, b, full, SDL_BLENDMODE_BLEND, 255))
+    {
+        wait();
+
+        const bool channel = all(b, half_grey);
+
+        fill(a, 0xFFFFFFFFu);
+        fill(b, 0xFF000000u);
+
+        if (channel && submit_blit(a, full, b, full, SDL_BLENDMODE_BLEND, 128))
+        {
+            wait();
+
+            if (all(b, half_grey)) caps |= CAP_BLEND;
+        }
+    }
+
+    // Premultiplied source-over - half white premultiplied over black, the same half grey
+    fill(a, 0x80808080u);
+    fill(b, 0xFF000000u);
+
+    a.premultiplied = true;
+
+    if ((caps & CAP_BLEND) && submit_blit(a, full, b, full, SDL_BLENDMODE_BLEND, 255))
+    {
+        wait();
+
+        if (all(b, half_grey)) caps |= CAP_PREMULTIPLIED;
+    }
+
+    a.premultiplied = false;
+
+    // RGB565 source - pure red, the low bits filled by the high ones
+    if (has_rgb565)
+    {
+        for (int y = 0; y < SIZE; ++y)
+            for (int x = 0; x < SIZE; ++x)
+                static_cast<std::uint16_t*>(static_cast<void*>(static_cast<std::uint8_t*>(c.memory) + y * c.pitch))[x] = 0xF800;
+
+        fill(b, 0);
+
+        if (submit_blit(c, full, b, full, SDL_BLENDMODE_NONE, 255))
+        {
+            wait();
+
+            if (all(b, [](Uint32 p, int, int) { return (p & 0x00FFFFFFu) == 0x00FF0000u; })) caps |= CAP_RGB565;
+        }
+
+        free_surface(c);
+    }
+
+    free_surface(a);
+    free_surface(b);
+
+    return caps;
+}
+
+
+// === TEXTURES ===
+
+bool Hw_blitter::mirror(SDL_Texture* texture, const SDL_Surface* pixels, bool premultiplied)
+{
+    if (!active || !texture || !pixels || !(capabilities & CAP_COPY)) return false;
+
+    const Uint32 format = pixels->format->format;
+
+    if (format != SDL_PIXELFORMAT_ARGB8888 && !(format == SDL_PIXELFORMAT_RGB565 && (capabilities & CAP_RGB565))) return false;
+
+    // SDL could have chosen another texture format
+    Uint32 texture_format = 0;
+    int w = 0;
+    int h = 0;
+
+    if (SDL_QueryTexture(texture, &texture_format, nullptr, &w, &h) != 0) return false;
+    if (texture_format != format || w != pixels->w || h != pixels->h) return false;
+
+    forget(texture);
+
+    Gfx_surface copy;
+
+    if (!alloc_surface(copy, w, h, format, true)) return false;
+
+    const size_t row = static_cast<size_t>(w) * SDL_BYTESPERPIXEL(format);
+
+    for (int y = 0; y < h; ++y)
+        std::memcpy(static_cast<std::uint8_t*>(copy.memory) + y * copy.pitch,
+                    static_cast<const std::uint8_t*>(pixels->pixels) + y * pixels->pitch, row);
+
+    // The engine reads the memory, not the cache
+    api.flush_cache(copy.memory, copy.size);
+
+    copy.premultiplied = premultiplied;
+
+    mirrors[texture] = copy;
+    mirror_bytes += copy.size;
+
+    return true;
+}
+
+
+void Hw_blitter::forget(SDL_Texture* texture)
+{
+    auto found = mirrors.find(texture);
+
+    if (found == mirrors.end()) return;
+
+    // A queued copy may still read it
+    sync();
+
+    mirror_bytes -= found->second.size;
+    free_surface(found->second);
+
+    mirrors.erase(found);
+}
+
+// === TEXTURES ===
+
+
+// === DRAWS ===
+
+bool Hw_blitter::screen_target(SDL_Renderer* r, Gfx_surface& target, SDL_Rect& area, SDL_Point& origin)
+{
+    if (r != renderer || SDL_GetRenderTarget(r)) return false;
+
+    float scale_x = 1.0f;
+    float scale_y = 1.0f;
+
+    SDL_RenderGetScale(r, &scale_x, &scale_y);
+
+    if (scale_x != 1.0f || scale_y != 1.0f) return false;
+
+    SDL_Rect viewport;
+    SDL_RenderGetViewport(r, &viewport);
+
+    const SDL_Rect bounds = {0, 0, screen->w, screen->h};
+
+    if (!SDL_IntersectRect(&viewport, &bounds, &area)) return false;
+
+    // The clip rectangle is relative to the viewport
+    if (SDL_RenderIsClipEnabled(r))
+    {
+        SDL_Rect clip;
+        SDL_RenderGetClipRect(r, &clip);
+
+        clip.x += viewport.x;
+        clip.y += viewport.y;
+
+        if (!SDL_IntersectRect(&area, &clip, &area)) return false;
+    }
+
+    const std::uint8_t* pixels = static_cast<const std::uint8_t*>(screen->pixels);
+
+    target = {screen_base_physical + static_cast<std::uint64_t>(pixels - screen_base), screen->pixels,
+              0, screen->w, screen->h, screen->pitch, SDL_PIXELFORMAT_ARGB8888};
+
+    // The rectangles of the draws are relative to the viewport
+    origin = {viewport.x, viewport.y};
+
+    area.x -= viewport.x;
+    area.y -= viewport.y;
+
+    return true;
+}
+
+
+bool Hw_blitter::clear(SDL_Renderer* r)
+{
+    if (!active) return false;
+
+    Gfx_surface target;
+    SDL_Rect area;
+    SDL_Point origin;
+
+    if (!(capabilities & CAP_FILL) || !screen_target(r, target, area, origin)) return decline();
+
+    // A clear ignores the viewport and the clip rectangle
+    const SDL_Rect all = {0, 0, screen->w, screen->h};
+
+    if (all.w * all.h < min_pixels) return decline();
+
+    Uint8 red, green, blue, alpha;
+    SDL_GetRenderDrawColor(r, &red, &green, &blue, &alpha);
+
+    if (!submit_fill(target, all, SDL_MapRGBA(screen->format, red, green, blue, alpha))) return decline();
+
+    return true;
+}
+
+
+bool Hw_blitter::copy(SDL_Renderer* r, SDL_Texture* texture, const SDL_Rect* src, const SDL_Rect* dst)
+{
+    if (!active) return false;
+
+    auto found = mirrors.find(texture);
+
+    if (found == mirrors.end()) return decline();
+
+    const Gfx_surface& source = found->second;
+
+    Uint8 red, green, blue, alpha;
+    SDL_BlendMode blend;
+
+    SDL_GetTextureColorMod(texture, &red, &green, &blue);
+    SDL_GetTextureAlphaMod(texture, &alpha);
+    SDL_GetTextureBlendMode(texture, &blend);
+
+    if ((red & green & blue) != 255) return decline();
+
+    // The premultiplied blend is the source-over of the premultiplied mirror
+    static const SDL_BlendMode premultiplied_blend = blend_mode_premultiplied();
+
+    if (blend == premultiplied_blend) blend = SDL_BLENDMODE_BLEND;
+
+    // The constant alpha would fade only the alpha of the premultiplied pixels, not the color
+    if (source.premultiplied && blend == SDL_BLENDMODE_BLEND && (alpha != 255 || !(capabilities & CAP_PREMULTIPLIED)))
+        return decline();
+
+    // RGB565 has no alpha - an unmodulated blend is a copy
+    if (blend == SDL_BLENDMODE_BLEND && alpha == 255 && source.format == SDL_PIXELFORMAT_RGB565) blend = SDL_BLENDMODE_NONE;
+
+    if (blend == SDL_BLENDMODE_NONE ? alpha != 255 : blend != SDL_BLENDMODE_BLEND || !(capabilities & CAP_BLEND)) return decline();
+
+    Gfx_surface target;
+    SDL_Rect area;
+    SDL_Point origin;
+
+    if (!screen_target(r, target, area, origin)) return decline();
+
+    SDL_Rect s = src ? *src : SDL_Rect{0, 0, source.w, source.h};
+    SDL_Rect d = dst ? *dst : SDL_Rect{0, 0, 0, 0};
+
+    // nullptr - the whole viewport
+    if (!dst)
+    {
+        SDL_Rect viewport;
+        SDL_RenderGetViewport(r, &viewport);
+
+        d.w = viewport.w;
+        d.h = viewport.h;
+    }
+
+    if (s.w <= 0 || s.h <= 0 || d.w <= 0 || d.h <= 0) return true;
+
+    // A source outside of the texture is clipped by SDL with the rescale
+    if (s.x < 0 || s.y < 0 || s.x + s.w > source.w || s.y + s.h > source.h) return decline();
+
+    if (s.w != d.w || s.h != d.h)
+    {
+        // Scaled - only when nothing is clipped
+        SDL_Rect inside;
+
+        if (!(capabilities & CAP_SCALE) || !SDL_IntersectRect(&d, &area, &inside) || !SDL_RectEquals(&inside, &d)) return decline();
+    }
+    else
+    {
+        SDL_Rect clipped;
+
+        if (!SDL_IntersectRect(&d, &area, &clipped)) return true;
+
+        s.x += clipped.x - d.x;
+        s.y += clipped.y - d.y;
+        s.w = clipped.w;
+        s.h = clipped.h;
+
+        d = clipped;
+    }
+
+    if (d.w * d.h < min_pixels) return decline();
+
+    d.x += origin.x;
+    d.y += origin.y;
+
+    if (!submit_blit(source, s, target, d, blend, alpha)) return decline();
+
+    return true;
+}
+
+
+bool Hw_blitter::fill_rects(SDL_Renderer* r, const SDL_Rect* rects, int count)
+{
+    if (!active) return false;
+
+    Gfx_surface target;
+    SDL_Rect area;
+    SDL_Point origin;
+
+    if (!(capabilities & CAP_FILL) || !screen_target(r, target, area, origin)) return decline();
+
+    Uint8 red, green, blue, alpha;
+    SDL_BlendMode blend;
+
+    SDL_GetRenderDrawColor(r, &red, &green, &blue, &alpha);
+    SDL_GetRenderDrawBlendMode(r, &blend);
+
+    // The opaque fills only - a translucent one is a blend
+    if (!(blend == SDL_BLENDMODE_NONE || (blend == SDL_BLENDMODE_BLEND && alpha == 255))) return decline();
+
+    // nullptr - the whole viewport
+    const SDL_Rect whole = {area.x, area.y, area.w, area.h};
+
+    int pixels = 0;
+
+    for (int i = 0; i < count; ++i)
+    {
+        SDL_Rect clipped;
+
+        if (SDL_IntersectRect(rects ? &rects[i] : &whole, &area, &clipped)) pixels += clipped.w * clipped.h;
+    }
+
+    if (pixels == 0) return true;
+
+    if (pixels < min_pixels) return decline();
+
+    const Uint32 color = SDL_MapRGBA(screen->format, red, green, blue, alpha);
+
+    for (int i = 0; i < count; ++i)
+    {
+        SDL_Rect clipped;
+
+        if (!SDL_IntersectRect(rects ? &rects[i] : &whole, &area, &clipped)) continue;
+
+        clipped.x += origin.x;
+        clipped.y += origin.y;
+
+        // The opaque fills can be done again by the CPU
+        if (!submit_fill(target, clipped, color)) return decline();
+    }
+
+    return true;
+}
+
+
+bool Hw_blitter::submit_fill(const Gfx_surface& target, const SDL_Rect& rect, Uint32 color)
+{
+    Mi_gfx_surface dst = {target.physical, MI_GFX_FMT_ARGB8888, static_cast<std::uint32_t>(target.w),
+                          static_cast<std::uint32_t>(target.h), static_cast<std::uint32_t>(target.pitch)};
+    Mi_gfx_rect dst_rect = to_gfx(rect);
+
+    std::uint16_t fence = 0;
+
+    // The CPU writes reach the memory before the engine reads it
+    __sync_synchronize();
+
+    if (api.quick_fill(&dst, &dst_rect, color, &fence) != MI_SUCCESS) return false;
+
+    pending = true;
+    ++hw_draws;
+
+    return true;
+}
+
+
+bool Hw_blitter::submit_blit(const Gfx_surface& source, const SDL_Rect& src, const Gfx_surface& target,
+                             const SDL_Rect& dst, SDL_BlendMode blend, Uint8 alpha)
+{
+    Mi_gfx_surface src_surface = {source.physical,
+                                  source.format == SDL_PIXELFORMAT_RGB565 ? MI_GFX_FMT_RGB565 : MI_GFX_FMT_ARGB8888,
+                                  static_cast<std::uint32_t>(source.w), static_cast<std::uint32_t>(source.h),
+                                  static_cast<std::uint32_t>(source.pitch)};
+
+    Mi_gfx_surface dst_surface = {target.physical, MI_GFX_FMT_ARGB8888, static_cast<std::uint32_t>(target.w),
+                                  static_cast<std::uint32_t>(target.h), static_cast<std::uint32_t>(target.pitch)};
+
+    Mi_gfx_rect src_rect = to_gfx(src);
+    Mi_gfx_rect dst_rect = to_gfx(dst);
+
+    Mi_gfx_opt opt;
+    std::memset(&opt, 0, sizeof(opt));
+
+    opt.clip = dst_rect;
+
+    if (blend == SDL_BLENDMODE_BLEND)
+    {
+        // SDL source-over: src * a + dst * (1 - a), the alpha modulation is the constant alpha;
+        // the premultiplied source is already multiplied - src + dst * (1 - a)
+        opt.src_blend = source.premultiplied ? MI_GFX_BLD_ONE : MI_GFX_BLD_SRCALPHA;
+        opt.dst_blend = MI_GFX_BLD_INVSRCALPHA;
+        opt.blend_flags = MI_GFX_BLEND_ALPHACHANNEL | (alpha != 255 ? MI_GFX_BLEND_COLORALPHA : 0);
+        opt.src_const_color = static_cast<std::uint32_t>(alpha) << 24;
+    }
+    else
+    {
+        opt.src_blend = MI_GFX_BLD_ONE;
+        opt.dst_blend = MI_GFX_BLD_ZERO;
+        opt.blend_flags = MI_GFX_BLEND_NOFX;
+    }
+
+    std::uint16_t fence = 0;
+
+    __sync_synchronize();
+
+    if (api.bit_blit(&src_surface, &src_rect, &dst_surface, &dst_rect, &opt, &fence) != MI_SUCCESS) return false;
+
+    pending = true;
+    ++hw_draws;
+
+    return true;
+}
+
+
+void Hw_blitter::wait()
+{
+    api.wait_all_done(1, 0);
+    pending = false;
+}
+
+
+bool Hw_blitter::decline()
+{
+    ++cpu_draws;
+    sync();
+
+    return false;
+}
+
+// === DRAWS ===
+
+// =========================================================================================== HW BLITTER
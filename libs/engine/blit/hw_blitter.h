@@ -0,0 +1,207 @@
+// hw_blitter.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+#include <unordered_map>
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== HW BLITTER
+
+
+/**
+ * @brief Hardware 2D engine of the Miyoo Mini SoC (SigmaStar MI_GFX) under the Render:: calls.
+ *
+ * On the framebuffer output the fills, the clears and the texture copies (the plain ones,
+ * the scaled ones and the alpha blended ones) into the screen are done by the GFX engine
+ * instead of the software renderer - the CPU only queues them. Everything else (the render
+ * target textures, the geometry, the color modulation, the small draws, where the ioctl costs
+ * more than the CPU loop) goes to the software renderer as before, so the states see no difference.
+ *
+ * The vendor libraries (libmi_sys.so, libmi_gfx.so) are loaded at the runtime - the same
+ * binary runs without them, on the CPU. open() checks every operation on the test surfaces
+ * and uses only the ones, which give the software renderer results.
+ *
+ * The engine reads only the textures, which have a copy in the physical (MMA) memory:
+ * Image_asset::upload_surface() mirrors the static image textures and the atlas pages,
+ * forget() is called before they are destroyed. The hardware runs in parallel with the CPU -
+ * a declined draw, the present and the pixel reads wait for it (sync()).
+ *
+ * Usage (done by SDL_app_init on the framebuffer output, if sdl_app_ctx::use_hw_blitter is set):
+ * @code
+ * Hw_blitter::Instance().open(renderer, fb.get_surface(), fb.get_physical_address());
+ * // ... Render::copy(r, image, &src, &dst) - the hardware, if it can
+ * Hw_blitter::Instance().sync();   // before the flip
+ * @endcode
+ */
+class Hw_blitter
+{
+
+public:
+
+    // Operations, which passed the check of open()
+    enum Capability : Uint32
+    {
+        CAP_FILL          = 1u << 0,
+        CAP_COPY          = 1u << 1,
+        CAP_SCALE         = 1u << 2,
+        CAP_BLEND         = 1u << 3,
+        CAP_RGB565        = 1u << 4,    // RGB565 sources
+        CAP_PREMULTIPLIED = 1u << 5     // Premultiplied ARGB8888 sources
+    };
+
+
+    // Returns the singleton instance.
+    static Hw_blitter& Instance();
+
+
+    /**
+     * @brief Loads the vendor libraries, opens the GFX engine and checks its operations.
+     *
+     * @param renderer Software renderer of the screen - its draws into the screen are offloaded.
+     * @param screen Framebuffer surface, ARGB8888 (the pixels pointer may move between the pages
+     *               of one mapping - Fb_backend::flip()).
+     * @param screen_physical Physical address of the screen pixels now.
+     * @return true if at least the fills or the copies work; false - all on the CPU.
+     */
+    bool open(SDL_Renderer* renderer, SDL_Surface* screen, std::uint64_t screen_physical);
+
+    // Waits for the engine, frees the mirrors and unloads the libraries
+    void close();
+
+    bool is_active() const { return active; }
+
+    Uint32 get_capabilities() const { return capabilities; }
+
+
+    // === TEXTURES ===
+
+    /**
+     * @brief Keeps a copy of the texture pixels in the physical memory - the copies of it can be offloaded.
+     *
+     * For the textures, which don't change after the upload (SDL_TEXTUREACCESS_STATIC).
+     * The premultiplied pixels are blended as such, whichever the texture blend mode is -
+     * the texture itself could have the straight copy of them (Image_asset::upload_surface()).
+     *
+     * @return false if not active, the format isn't supported or the memory can't be allocated.
+     */
+    bool mirror(SDL_Texture* texture, const SDL_Surface* pixels, bool premultiplied = false);
+
+    // Frees the copy - before the texture is destroyed
+    void forget(SDL_Texture* texture);
+
+    // === TEXTURES ===
+
+
+    // === DRAWS ===
+
+    // The Render:: calls try these first: true - done by the hardware; false - the caller
+    // draws with the software renderer (the hardware is idle then)
+
+    bool clear(SDL_Renderer* r);
+    bool copy(SDL_Renderer* r, SDL_Texture* texture, const SDL_Rect* src, const SDL_Rect* dst);
+    bool fill_rects(SDL_Renderer* r, const SDL_Rect* rects, int count);
+
+    // Waits until the queued operations are done - before the CPU touches the screen
+    void sync() { if (pending) wait(); }
+
+    // Smaller draws stay on the CPU - the submission costs about as much as drawing them
+    void set_min_pixels(int pixels) { min_pixels = pixels; }
+
+    // === DRAWS ===
+
+
+    // === STATS ===
+
+    std::uint64_t get_hw_draws() const { return hw_draws; }
+
+    // Draws, which the hardware declined
+    std::uint64_t get_cpu_draws() const { return cpu_draws; }
+
+    size_t get_mirror_bytes() const { return mirror_bytes; }
+
+    // === STATS ===
+
+
+private:
+
+    Hw_blitter() = default;
+    ~Hw_blitter();
+
+    // Singleton - not copyable
+    Hw_blitter(const Hw_blitter&) = delete;
+    Hw_blitter& operator=(const Hw_blitter&) = delete;
+
+
+    // Physically contiguous pixels, mapped into the process
+    struct Gfx_surface
+    {
+        std::uint64_t physical = 0;
+        void* memory = nullptr;
+        Uint32 size = 0;
+
+        int w = 0;
+        int h = 0;
+        int pitch = 0;
+
+        Uint32 format = SDL_PIXELFORMAT_UNKNOWN;
+
+        // Pixels of the premultiplied alpha
+        bool premultiplied = false;
+    };
+
+    bool load_library();
+    void unload_library();
+
+    bool alloc_surface(Gfx_surface& surface, int w, int h, Uint32 format, bool cached);
+    void free_surface(Gfx_surface& surface);
+
+    // Checks the operations on the test surfaces, returns the working ones
+    Uint32 check_capabilities();
+
+    // Screen as the GFX destination, the draw area (viewport and clip) relative to the viewport origin;
+    // false - the draw isn't into the screen or is scaled by the renderer
+    bool screen_target(SDL_Renderer* r, Gfx_surface& target, SDL_Rect& area, SDL_Point& origin);
+
+    bool submit_fill(const Gfx_surface& target, const SDL_Rect& rect, Uint32 color);
+    bool submit_blit(const Gfx_surface& source, const SDL_Rect& src, const Gfx_surface& target,
+                     const SDL_Rect& dst, SDL_BlendMode blend, Uint8 alpha);
+
+    void wait();
+
+    // The draw stays on the CPU
+    bool decline();
+
+
+    bool active = false;
+    bool pending = false;
+
+    Uint32 capabilities = 0;
+
+    int min_pixels = 4096;
+
+    SDL_Renderer* renderer = nullptr;
+    SDL_Surface* screen = nullptr;
+
+    // Mapping of the screen pages - the physical address follows the pixels pointer
+    const std::uint8_t* screen_base = nullptr;
+    std::uint64_t screen_base_physical = 0;
+
+    std::unordered_map<SDL_Texture*, Gfx_surface> mirrors;
+
+    std::uint64_t hw_draws = 0;
+    std::uint64_t cpu_draws = 0;
+    size_t mirror_bytes = 0;
+
+    // dlopen handles
+    void* sys_library = nullptr;
+    void* gfx_library = nullptr;
+};
+
+// =========================================================================================== HW BLITTER
@@ -0,0 +1,200 @@
+// config_file.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "config_file.h"
+#include "../app_logic/app.h"
+#include "../platform/backend.h"
+
+#include <cstdlib>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== CONFIG FILE
+
+namespace
+{
+    std::string_view trim(std::string_view v)
+    {
+        while (!v.empty() && (v.front() == ' ' || v.front() == '\t')) v.remove_prefix(1);
+        while (!v.empty() && (v.back() == ' ' || v.back() == '\t' || v.back() == '\r')) v.remove_suffix(1);
+
+        return v;
+    }
+
+
+    // on / off, true / false, yes / no, 1 / 0 - -1 if it's none of them
+    int parse_switch(std::string_view v)
+    {
+        if (v == "on" || v == "true" || v == "yes" || v == "1") return 1;
+        if (v == "off" || v == "false" || v == "no" || v == "0") return 0;
+
+        return -1;
+    }
+
+
+    // The value is zero-terminated - strtod / strtol read it in place
+    bool parse_number(std::string_view v, double& out)
+    {
+        char* end = nullptr;
+        out = std::strtod(v.data(), &end);
+
+        return !v.empty() && end == v.data() + v.size();
+    }
+}
+
+
+bool Config_file::load(const char* path)
+{
+    std::vector<Uint8> text;
+
+    if (!Platform::Files::read_file(path, text)) return false;
+
+    parse(text, path);
+
+    return true;
+}
+
+
+void Config_file::parse(std::vector<Uint8>& text, const char* name)
+{
+    buffer.swap(text);
+    settings = Config_settings{};
+
+    // The terminator of the last value - no reallocation after the views are taken
+    buffer.push_back('\n');
+
+    char* data = reinterpret_cast<char*>(buffer.data());
+    const size_t size = buffer.size();
+
+    int line_number = 0;
+    size_t start = 0;
+
+    while (start < size)
+    {
+        size_t end = start;
+
+        while (end < size && data[end] != '\n') ++end;
+
+        std::string_view line(data + start, end - start);
+
+        start = end + 1;
+        ++line_number;
+
+        const size_t comment = line.find('#');
+
+        if (comment != std::string_view::npos) line = line.substr(0, comment);
+
+        line = trim(line);
+
+        if (line.empty()) continue;
+
+        const size_t equals = line.find('=');
+
+        if (equals == std::string_view::npos)
+        {
+            SDL_Log("Config %s:%d: expected \"key = value\"", name, line_number);
+            continue;
+        }
+
+        const std::string_view key = trim(line.substr(0, equals));
+        const std::string_view value = trim(line.substr(equals + 1));
+
+        // In place - the comment, the spaces or the line end after the value
+        const_cast<char*>(value.data())[value.size()] = '\0';
+
+        if (!parse_setting(key, value))
+            SDL_Log("Config %s:%d: bad setting %.*s = %s", name, line_number, static_cast<int>(key.size()), key.data(), value.data());
+    }
+}
+
+
+bool Config_file::parse_setting(std::string_view key, std::string_view value)
+{
+    double number = 0.0;
+
+    if (key == "target_fps")
+    {
+        if (!parse_number(value, number) || number < 0.0) return false;
+
+        settings.target_fps = number;
+    }
+    else if (key == "vsync") settings.vsync = parse_switch(value);
+    else if (key == "fullscreen") settings.fullscreen = parse_switch(value);
+    else if (key == "audio") settings.audio = parse_switch(value);
+    else if (key == "rgb565") settings.rgb565 = parse_switch(value);
+    else if (key == "partial_redraw") settings.partial_redraw = parse_switch(value);
+    else if (key == "pipelined_update") settings.pipelined_update = parse_switch(value);
+    else if (key == "rotation")
+    {
+        if (!parse_number(value, number) || (number != 0.0 && number != 90.0 && number != 180.0 && number != 270.0)) return false;
+
+        settings.rotation = static_cast<int>(number);
+    }
+    else if (key == "swap_depth")
+    {
+        if (!parse_number(value, number) || (number != 1.0 && number != 2.0 && number != 3.0)) return false;
+
+        settings.swap_depth = static_cast<int>(number);
+    }
+    else if (key == "upload_budget_ms")
+    {
+        if (!parse_number(value, number) || number < 0.0) return false;
+
+        settings.upload_budget_ms = number;
+    }
+    else if (key == "window_scale")
+    {
+        if (!parse_number(value, number) || number < 1.0 || number > 8.0) return false;
+
+        settings.window_scale = static_cast<int>(number);
+    }
+    else if (key == "renderer") settings.renderer = value;
+    else if (key == "language") settings.language = value;
+    else if (key == "input_mapping") settings.input_mapping = value;
+    else return false;
+
+    // The switches - anything but on / off is bad
+    return (key != "vsync" || settings.vsync >= 0) && (key != "fullscreen" || settings.fullscreen >= 0)
+           && (key != "audio" || settings.audio >= 0) && (key != "rgb565" || settings.rgb565 >= 0)
+           && (key != "partial_redraw" || settings.partial_redraw >= 0)
+           && (key != "pipelined_update" || settings.pipelined_update >= 0) && !value.empty();
+}
+
+
+void Config_file::apply(sdl_app_ctx& app) const
+{
+    if (settings.target_fps >= 0.0) app.target_fps = settings.target_fps;
+    if (settings.vsync >= 0) app.request_vsync = settings.vsync == 1;
+    if (settings.audio >= 0) app.enable_audio = settings.audio == 1;
+    if (settings.rgb565 >= 0) app.rgb565_backbuffer = settings.rgb565 == 1;
+    if (settings.partial_redraw >= 0) app.partial_redraw = settings.partial_redraw == 1;
+    if (settings.pipelined_update >= 0) app.pipelined_update = settings.pipelined_update == 1;
+    if (settings.rotation >= 0) app.panel_rotation = settings.rotation / 90;
+    if (settings.swap_depth >= 0) app.swap_depth = settings.swap_depth;
+    if (settings.upload_budget_ms >= 0.0) app.asset_upload_budget_ms = settings.upload_budget_ms;
+
+    if (settings.fullscreen == 1) app.window_flags |= SDL_WINDOW_FULLSCREEN_DESKTOP;
+    if (settings.fullscreen == 0) app.window_flags &= ~static_cast<Uint32>(SDL_WINDOW_FULLSCREEN_DESKTOP);
+
+    // Zero-terminated in the buffer - the views are the C strings of the app
+    if (!settings.renderer.empty() && settings.renderer != "auto") app.render_driver = settings.renderer.data();
+    if (!settings.language.empty()) app.language = settings.language.data();
+    if (!settings.input_mapping.empty()) app.input_config_path = settings.input_mapping.data();
+}
+
+
+int Config_file::window_width(int default_width) const
+{
+    return settings.window_scale > 0 ? Platform::LOGICAL_W * settings.window_scale : default_width;
+}
+
+
+int Config_file::window_height(int default_height) const
+{
+    return settings.window_scale > 0 ? Platform::LOGICAL_H * settings.window_scale : default_height;
+}
+
+// =========================================================================================== CONFIG FILE
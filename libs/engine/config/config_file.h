@@ -0,0 +1,133 @@
+// config_file.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+struct sdl_app_ctx;
+
+
+// =========================================================================================== CONFIG FILE
+
+
+/**
+ * @brief Startup settings of the player, typed. The unset ones keep the engine defaults.
+ *
+ * The text values are views into the buffer of their Config_file, zero-terminated.
+ */
+struct Config_settings
+{
+    // Frame rate cap, < 0 - not set (0 - uncapped)
+    double target_fps = -1.0;
+
+    // -1 - not set, 0 / 1
+    int vsync = -1;
+    int fullscreen = -1;
+    int audio = -1;
+
+    // 16-bit software pipeline (sdl_app_ctx::rgb565_backbuffer)
+    int rgb565 = -1;
+
+    // Dirty-rectangle mode of the software path (sdl_app_ctx::partial_redraw)
+    int partial_redraw = -1;
+
+    // Update on the worker thread, while the frame renders (sdl_app_ctx::pipelined_update)
+    int pipelined_update = -1;
+
+    // Panel rotation in degrees: 0, 90, 180 or 270, -1 - not set
+    int rotation = -1;
+
+    // Swap chain depth 1 to 3 (sdl_app_ctx::swap_depth), -1 - not set
+    int swap_depth = -1;
+
+    // Main thread time per frame for the texture uploads of the async loads (sdl_app_ctx::asset_upload_budget_ms), < 0 - not set
+    double upload_budget_ms = -1.0;
+
+    // Window size as a multiple of the logical resolution, 0 - not set
+    int window_scale = 0;
+
+    // SDL render driver ("software", "opengles2"), "auto" - the Renderer_probe choice
+    std::string_view renderer;
+
+    // Language code ("en", "ru")
+    std::string_view language;
+
+    // Key and button mapping file (Input::load_mapping())
+    std::string_view input_mapping;
+};
+
+
+/**
+ * @brief The settings file, read at once and parsed in place - before SDL_app_init().
+ *
+ * The lines are "key = value", '#' starts a comment:
+ *
+ *     target_fps = 60
+ *     vsync = on
+ *     renderer = opengles2
+ *     language = ru
+ *
+ * The file is one read into the buffer. The parser walks it with string_views and
+ * terminates the values right there (the '\0' over the line end) - no string per key or
+ * per value, the text settings are views of the buffer and go to the app as they are.
+ * An unknown key or a bad value is logged with its line and skipped.
+ *
+ * Usage:
+ * @code
+ * Config_file config;              // outlives the app - the app keeps its strings
+ * sdl_app_ctx app;
+ *
+ * if (config.load("settings.cfg")) config.apply(app);
+ *
+ * SDL_app_init(&app, config.window_width(Platform::WINDOW_W), config.window_height(Platform::WINDOW_H), "Game");
+ * @endcode
+ */
+class Config_file
+{
+
+public:
+
+    /**
+     * @brief Reads and parses the file.
+     *
+     * @return false if there is no file (the settings stay unset).
+     */
+    bool load(const char* path);
+
+    // Parses the text (taken by a swap) - the settings of a file from elsewhere
+    void parse(std::vector<Uint8>& text, const char* name = "config");
+
+
+    // Renderer, window flags, frame rate, language and the input mapping into the app
+    void apply(sdl_app_ctx& app) const;
+
+    // Window size of the window_scale setting, the default if it is not set
+    int window_width(int default_width) const;
+    int window_height(int default_height) const;
+
+
+    const Config_settings& get_settings() const { return settings; }
+
+
+private:
+
+    // One "key = value" line, false if the key or the value is invalid
+    bool parse_setting(std::string_view key, std::string_view value);
+
+
+    // The file - the text settings point into it
+    std::vector<Uint8> buffer;
+
+    Config_settings settings;
+};
+
+// =========================================================================================== CONFIG FILE
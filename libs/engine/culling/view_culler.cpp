@@ -0,0 +1,82 @@
+// view_culler.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "view_culler.h"
+
+#include <algorithm>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== VIEW CULLER
+
+View_culler& View_culler::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static View_culler instance;
+    return instance;
+}
+
+
+void View_culler::set_view(const SDL_FRect& new_view) { view = new_view; }
+
+
+bool View_culler::is_visible(const SDL_FRect& bounds)
+{
+    if (!has_view()) return true;
+
+    ++tested;
+
+    const bool visible = bounds.x + bounds.w > view.x && bounds.x < view.x + view.w
+                      && bounds.y + bounds.h > view.y && bounds.y < view.y + view.h;
+
+    if (!visible) ++culled;
+
+    return visible;
+}
+
+
+int View_culler::cull(const Cull_bounds& bounds, std::vector<std::uint8_t>& visible) { return cull(bounds, view, visible); }
+
+
+int View_culler::cull(const Cull_bounds& bounds, const SDL_FRect& area, std::vector<std::uint8_t>& visible)
+{
+    const int count = bounds.size();
+
+    visible.resize(static_cast<size_t>(count));
+
+    if (area.w <= 0.0f || area.h <= 0.0f)
+    {
+        std::fill(visible.begin(), visible.end(), std::uint8_t{1});
+        return count;
+    }
+
+    const float left = area.x;
+    const float top = area.y;
+    const float right = area.x + area.w;
+    const float bottom = area.y + area.h;
+
+    const float* min_x = bounds.min_x.data();
+    const float* min_y = bounds.min_y.data();
+    const float* max_x = bounds.max_x.data();
+    const float* max_y = bounds.max_y.data();
+
+    std::uint8_t* out = visible.data();
+
+    // Non-short-circuit ands - no branches, one vector lane per renderable
+    for (int i = 0; i < count; ++i)
+        out[i] = static_cast<std::uint8_t>((max_x[i] > left) & (min_x[i] < right) & (max_y[i] > top) & (min_y[i] < bottom));
+
+    int shown = 0;
+
+    for (int i = 0; i < count; ++i) shown += out[i];
+
+    tested += static_cast<std::uint64_t>(count);
+    culled += static_cast<std::uint64_t>(count - shown);
+
+    return shown;
+}
+
+// =========================================================================================== VIEW CULLER
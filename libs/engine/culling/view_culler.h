@@ -0,0 +1,134 @@
+// view_culler.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <vector>
+#include <cstdint>
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== CULL BOUNDS
+
+
+/**
+ * @brief Axis-aligned bounds of many renderables, structure-of-arrays.
+ *
+ * The batched test reads four contiguous float arrays - no branch per renderable,
+ * the compiler vectorizes it.
+ */
+struct Cull_bounds
+{
+    std::vector<float> min_x;
+    std::vector<float> min_y;
+    std::vector<float> max_x;
+    std::vector<float> max_y;
+
+    void add(float x0, float y0, float x1, float y1)
+    {
+        min_x.push_back(x0);
+        min_y.push_back(y0);
+        max_x.push_back(x1);
+        max_y.push_back(y1);
+    }
+
+    // Keeps the capacity - no allocation after the first frames
+    void clear()
+    {
+        min_x.clear();
+        min_y.clear();
+        max_x.clear();
+        max_y.clear();
+    }
+
+    int size() const { return static_cast<int>(min_x.size()); }
+};
+
+// =========================================================================================== CULL BOUNDS
+
+
+// =========================================================================================== VIEW CULLER
+
+
+/**
+ * @brief View rectangle of the frame - the renderables entirely outside of it aren't submitted.
+ *
+ * The engine sets the view to the logical render target before every state render, so all
+ * of the draws are culled by default. A state, which renders into a larger target of its
+ * own, sets that one (and gets the screen back with the next frame).
+ *
+ * The Sprite_batch tests its whole frame of sprites with cull() before the quads are built
+ * and sorted, the shape primitives test their bounds with is_visible() before tessellating.
+ * The view is in the render target pixels - a state with a camera subtracts it before the draw.
+ *
+ * Usage:
+ * @code
+ * // per renderable
+ * if (View_culler::Instance().is_visible({x, y, w, h})) draw_rect({x, y, w, h}, color);
+ *
+ * // batched
+ * bounds.add(x0, y0, x1, y1);                            // every renderable
+ * View_culler::Instance().cull(bounds, visible);         // visible[i] - 0 / 1
+ * @endcode
+ */
+class View_culler
+{
+
+public:
+
+    // Returns the singleton instance.
+    static View_culler& Instance();
+
+
+    // Visible area in the render target pixels, zero size - no culling
+    void set_view(const SDL_FRect& view);
+
+    const SDL_FRect& get_view() const { return view; }
+
+    bool has_view() const { return view.w > 0.0f && view.h > 0.0f; }
+
+
+    // The bounds overlap the view (touching edges don't)
+    bool is_visible(const SDL_FRect& bounds);
+
+    /**
+     * @brief Tests all of the bounds against the view in one pass.
+     *
+     * @param visible Resized to bounds.size(), 1 for the visible entries.
+     * @return Number of the visible entries.
+     */
+    int cull(const Cull_bounds& bounds, std::vector<std::uint8_t>& visible);
+
+    // Tests against another view (a batch with its own one), zero size - all are visible
+    int cull(const Cull_bounds& bounds, const SDL_FRect& area, std::vector<std::uint8_t>& visible);
+
+
+    // === STATS ===
+
+    // Tested and culled renderables since the start - the difference of two frames is the frame count
+    std::uint64_t get_tested_count() const { return tested; }
+    std::uint64_t get_culled_count() const { return culled; }
+
+    // === STATS ===
+
+
+private:
+
+    View_culler() = default;
+
+    // Singleton - not copyable
+    View_culler(const View_culler&) = delete;
+    View_culler& operator=(const View_culler&) = delete;
+
+
+    SDL_FRect view = {0.0f, 0.0f, 0.0f, 0.0f};
+
+    std::uint64_t tested = 0;
+    std::uint64_t culled = 0;
+};
+
+// =========================================================================================== VIEW CULLER
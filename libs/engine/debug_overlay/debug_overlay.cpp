@@ -0,0 +1,221 @@
+// debug_overlay.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "debug_overlay.h"
+#include "../asset/asset_manager.h"
+#include "../engine_clock/engine_clock.h"
+#include "../frame/frame.h"
+#include "../render_queue/render_queue.h"
+#include "../render_stats/render_stats.h"
+#include "../memory_report/memory_report.h"
+#include "../state_machine/state_machine.h"
+
+#include <algorithm>
+#include <cstdio>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== DEBUG OVERLAY
+
+// Text refresh interval in seconds - readable numbers, no layout per frame
+static constexpr double TEXT_INTERVAL = 0.25;
+
+// Graph geometry in px: the bar height of 33.3 ms, the panel margin
+static constexpr float GRAPH_HEIGHT = 40.0f;
+static constexpr float GRAPH_FULL_MS = 1000.0f / 30.0f;
+static constexpr float MARGIN = 4.0f;
+
+
+Debug_overlay& Debug_overlay::Instance()
+{
+    static Debug_overlay instance;
+    return instance;
+}
+
+
+void Debug_overlay::set_enabled(bool on)
+{
+    if (enabled == on) return;
+
+    enabled = on;
+
+    // The old samples belong to another time
+    std::fill(frame_ms, frame_ms + GRAPH_SAMPLES, 0.0f);
+    sum_frame_ms = sum_update_ms = sum_render_ms = 0.0;
+    sum_batches = sum_count = 0;
+    worst_frame_ms = 0.0f;
+    text_updated = 0;
+    text_run.vertices.clear();
+
+    Frame::Instance().mark_dirty();
+}
+
+
+void Debug_overlay::record(double frame, double update, double render_time, int batches)
+{
+    frame_ms[head] = static_cast<float>(frame);
+    head = (head + 1) % GRAPH_SAMPLES;
+
+    sum_frame_ms += frame;
+    sum_update_ms += update;
+    sum_render_ms += render_time;
+    sum_batches += batches;
+    ++sum_count;
+    worst_frame_ms = std::max(worst_frame_ms, static_cast<float>(frame));
+}
+
+
+bool Debug_overlay::prepare(SDL_Renderer* r)
+{
+    if (font) return true;
+    if (font_failed) return false;
+
+    font = Asset_manager::Instance().acquire_font(font_path);
+
+    // The stroke of '|' is solid ink - its middle texel colors any quad
+    const Font_glyph* bar = font && font->is_loaded() ? font->get_glyph('|') : nullptr;
+
+    if (!bar || bar->w == 0 || !font->get_image() || (!font->get_image()->get_texture() && !font->create_texture(r)))
+    {
+        SDL_Log("Debug overlay: no font %s with the '|' glyph", font_path);
+
+        Asset_manager::Instance().release(font);
+        font = nullptr;
+        font_failed = true;
+        return false;
+    }
+
+    int tw = 0, th = 0;
+    SDL_QueryTexture(font->get_image()->get_texture(), nullptr, nullptr, &tw, &th);
+
+    const Rect2& region = font->get_image()->get_texture_region();
+
+    solid_uv.x = (static_cast<float>(region.top_left.x + bar->x) + bar->w * 0.5f) / static_cast<float>(tw);
+    solid_uv.y = (static_cast<float>(region.top_left.y + bar->y) + bar->h * 0.5f) / static_cast<float>(th);
+
+    return true;
+}
+
+
+void Debug_overlay::refresh_text(const State_machine& machine)
+{
+    const double n = sum_count > 0 ? static_cast<double>(sum_count) : 1.0;
+    const double frame = sum_frame_ms / n;
+
+    // The render work of the last drawn frame (the overlay's own draw included)
+    const Render_counts& counts = Render_stats::Instance().get_last_frame();
+
+    // The footprint with its largest parts
+    Memory_report& memory = Memory_report::Instance();
+    char memory_line[96];
+
+    memory.sample();
+    memory.format_summary(memory_line, sizeof(memory_line), 3);
+
+    // The label and the active path by name, root first - views of the states, nothing allocated
+    char state_line[64];
+    int state_written = std::snprintf(state_line, sizeof(state_line), "%s", machine.current_state_label());
+
+    for (const State* s : machine.get_active_path())
+    {
+        if (state_written < 0 || static_cast<size_t>(state_written) >= sizeof(state_line)) break;
+
+        const std::string_view name = s->name.view();
+
+        state_written += std::snprintf(state_line + state_written, sizeof(state_line) - static_cast<size_t>(state_written), "%s%.*s",
+                                       s->parent ? ">" : " ", static_cast<int>(name.size()), name.data());
+    }
+
+    char text[384];
+
+    std::snprintf(text, sizeof(text), "%.1f FPS  %.2f ms (max %.1f)\nupdate %.2f  render %.2f ms\nbatches %d  %s\n"
+                  "draws %llu  prims %llu  binds %llu  rt %llu  %llu kpx\n%s%s%s",
+                  frame > 0.0 ? 1000.0 / frame : 0.0, frame, worst_frame_ms,
+                  sum_update_ms / n, sum_render_ms / n, static_cast<int>(sum_batches / n), state_line,
+                  static_cast<unsigned long long>(counts.draw_calls), static_cast<unsigned long long>(counts.primitives),
+                  static_cast<unsigned long long>(counts.texture_binds), static_cast<unsigned long long>(counts.target_switches),
+                  static_cast<unsigned long long>(counts.pixels / 1000), memory_line, status_line ? "\n" : "", status_line ? status_line : "");
+
+    font->layout(text, 1.0f, 0.0f, text_run);
+
+    sum_frame_ms = sum_update_ms = sum_render_ms = 0.0;
+    sum_batches = sum_count = 0;
+    worst_frame_ms = 0.0f;
+}
+
+
+void Debug_overlay::render(SDL_Renderer* r, const State_machine& machine)
+{
+    if (!enabled || !r || !prepare(r)) return;
+
+    const std::uint64_t now = Engine_clock::now();
+
+    if (text_updated == 0 || Engine_clock::to_seconds(now - text_updated) >= TEXT_INTERVAL)
+    {
+        refresh_text(machine);
+        text_updated = now;
+    }
+
+    const float text_w = std::max(text_run.width, static_cast<float>(GRAPH_SAMPLES));
+    const float panel_w = text_w + 2.0f * MARGIN;
+    const float panel_h = text_run.height + GRAPH_HEIGHT + 3.0f * MARGIN;
+
+    // Panel + the 16.7 ms line + a bar per sample + the text
+    const int solid_quads = 2 + GRAPH_SAMPLES;
+    const int quads = solid_quads + text_run.get_quad_count();
+
+    SDL_Vertex* v = Render_queue::Instance().append_quads(font->get_image()->get_texture(), quads, 0, SDL_BLENDMODE_BLEND);
+
+    if (!v) return;
+
+    auto solid = [this, &v](float x0, float y0, float x1, float y1, SDL_Color color)
+    {
+        *v++ = {{x0, y0}, color, solid_uv};
+        *v++ = {{x1, y0}, color, solid_uv};
+        *v++ = {{x1, y1}, color, solid_uv};
+        *v++ = {{x0, y1}, color, solid_uv};
+    };
+
+    solid(0.0f, 0.0f, panel_w, panel_h, {0, 0, 0, 176});
+
+    const float graph_top = MARGIN;
+    const float graph_bottom = graph_top + GRAPH_HEIGHT;
+
+    const float budget_y = graph_bottom - GRAPH_HEIGHT * (1000.0f / 60.0f) / GRAPH_FULL_MS;
+    solid(MARGIN, budget_y, MARGIN + GRAPH_SAMPLES, budget_y + 1.0f, {255, 255, 255, 96});
+
+    // Oldest sample on the left
+    for (int i = 0; i < GRAPH_SAMPLES; ++i)
+    {
+        const float ms = frame_ms[(head + i) % GRAPH_SAMPLES];
+        const float h = std::min(ms / GRAPH_FULL_MS, 1.0f) * GRAPH_HEIGHT;
+        const float x = MARGIN + static_cast<float>(i);
+
+        const SDL_Color color = ms <= 17.0f ? SDL_Color{80, 220, 80, 255} : ms <= 34.0f ? SDL_Color{240, 200, 40, 255} : SDL_Color{240, 60, 60, 255};
+
+        solid(x, graph_bottom - h, x + 1.0f, graph_bottom, color);
+    }
+
+    const float text_x = MARGIN;
+    const float text_y = graph_bottom + MARGIN;
+
+    for (const SDL_Vertex& source : text_run.vertices)
+        *v++ = {{source.position.x + text_x, source.position.y + text_y}, {255, 255, 255, 255}, source.tex_coord};
+
+    // Over everything the state has drawn - its own submission
+    Render_queue::Instance().submit(r);
+}
+
+
+void Debug_overlay::release()
+{
+    Asset_manager::Instance().release(font);
+
+    font = nullptr;
+    font_failed = false;
+}
+
+// =========================================================================================== DEBUG OVERLAY
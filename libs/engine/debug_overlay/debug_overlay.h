@@ -0,0 +1,133 @@
+// debug_overlay.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+
+#include "../platform/platform.h"
+#include "../asset/font_asset.h"
+
+class State_machine;
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== DEBUG OVERLAY
+
+
+/**
+ * @brief On-device performance overlay: FPS, the frame time graph, the update / render
+ * split, the driver calls, the render work of the frame (Render_stats), the current state
+ * and the memory footprint (Memory_report).
+ *
+ * The whole overlay is one run of quads on the font atlas - the panel and the graph bars
+ * are the glyph quads stretched over a solid texel of the '|' glyph - so it adds a single
+ * batch. The text is formatted and laid out four times a second, the frames between only
+ * move the graph. Disabled, it costs one flag test in the cycle: nothing is measured,
+ * nothing is drawn.
+ *
+ * The application records every cycle and renders the overlay over the state, X + Y
+ * (F3 on the desktop) toggle it.
+ *
+ * Singleton, like Lang_state.
+ *
+ * Usage:
+ * @code
+ * Debug_overlay::Instance().set_enabled(true);
+ * @endcode
+ */
+class Debug_overlay
+{
+
+public:
+
+    // Frames in the graph
+    static constexpr int GRAPH_SAMPLES = 120;
+
+    // Returns the singleton instance.
+    static Debug_overlay& Instance();
+
+
+    bool is_enabled() const { return enabled; }
+
+    void set_enabled(bool on);
+    void toggle() { set_enabled(!enabled); }
+
+
+    /**
+     * @brief Font of the overlay, acquired from the Asset_manager on the first render.
+     *
+     * @param path Path of the baked font (the UI font of the game).
+     */
+    void set_font_path(const char* path) { font_path = path; }
+
+    // Extra line under the stats (the Quality_watchdog decision), kept by the caller - nullptr, none
+    void set_status_line(const char* line) { status_line = line; }
+
+    /**
+     * @brief Records the timings of one cycle (the app, only while enabled).
+     *
+     * @param frame_ms  Time since the previous cycle.
+     * @param update_ms Time of the update ticks.
+     * @param render_ms Time of the state render (without the present).
+     * @param batches   Render_queue driver calls of the frame.
+     */
+    void record(double frame_ms, double update_ms, double render_ms, int batches);
+
+    /**
+     * @brief Draws the overlay at the top left of the logical screen, over everything.
+     *
+     * @param r       Renderer of the frame.
+     * @param machine State machine of the current state name.
+     */
+    void render(SDL_Renderer* r, const State_machine& machine);
+
+    // Releases the font (the shutdown, before the Asset_manager is cleared)
+    void release();
+
+
+private:
+
+    Debug_overlay() = default;
+
+    // Singleton - not copyable
+    Debug_overlay(const Debug_overlay&) = delete;
+    Debug_overlay& operator=(const Debug_overlay&) = delete;
+
+
+    // Acquires the font and finds its solid texel, false without them
+    bool prepare(SDL_Renderer* r);
+
+    // Formats and lays out the text of the recorded stats
+    void refresh_text(const State_machine& machine);
+
+
+    bool enabled = false;
+
+    const char* font_path = "fonts/ui.fnt";
+    const char* status_line = nullptr;
+    Font_asset* font = nullptr;
+    bool font_failed = false;
+
+    // UV of a fully covered atlas texel - the solid quads
+    SDL_FPoint solid_uv = {0.0f, 0.0f};
+
+
+    // Frame times of the graph, a ring
+    float frame_ms[GRAPH_SAMPLES] = {};
+    int head = 0;
+
+    // Sums of the text interval
+    double sum_frame_ms = 0.0, sum_update_ms = 0.0, sum_render_ms = 0.0;
+    int sum_batches = 0;
+    int sum_count = 0;
+    float worst_frame_ms = 0.0f;
+
+    std::uint64_t text_updated = 0;
+
+    Text_run text_run;
+};
+
+// =========================================================================================== DEBUG OVERLAY
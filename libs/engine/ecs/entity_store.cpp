@@ -0,0 +1,116 @@
+// entity_store.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "entity_store.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== ENTITY STORE
+
+Entity_store::Entity_store(Allocator& allocator)
+    : pools(Std_allocator<Component_pool_base*>(allocator)), generations(Std_allocator<std::uint32_t>(allocator)),
+      free_slots(Std_allocator<std::uint32_t>(allocator))
+{
+}
+
+
+void Entity_store::attach(Component_pool_base& pool) { pools.push_back(&pool); }
+
+
+Entity Entity_store::create()
+{
+    std::uint32_t slot;
+
+    if (!free_slots.empty())
+    {
+        slot = free_slots.back();
+        free_slots.pop_back();
+    }
+    else
+    {
+        if (generations.size() >= entity::MAX_ENTITIES) return NULL_ENTITY;
+
+        slot = static_cast<std::uint32_t>(generations.size());
+        generations.push_back(0);
+    }
+
+    ++alive;
+
+    return entity::make(slot, generations[slot]);
+}
+
+
+void Entity_store::destroy(Entity e)
+{
+    if (!is_alive(e)) return;
+
+    for (Component_pool_base* pool : pools) pool->remove(e);
+
+    const std::uint32_t slot = entity::index(e);
+
+    generations[slot] = (generations[slot] + 1) & entity::GENERATION_MASK;
+
+    // The last generation would wrap back into the ids still held somewhere - the slot is retired
+    if (generations[slot] != entity::GENERATION_MASK) free_slots.push_back(slot);
+
+    --alive;
+}
+
+
+bool Entity_store::is_alive(Entity e) const
+{
+    const std::uint32_t slot = entity::index(e);
+
+    return e != NULL_ENTITY && slot < generations.size() && generations[slot] == entity::generation(e);
+}
+
+
+void Entity_store::clear()
+{
+    for (Component_pool_base* pool : pools) pool->clear();
+
+    // Every slot gets a new generation - the ids of the old entities stay stale
+    free_slots.clear();
+
+    for (std::uint32_t slot = static_cast<std::uint32_t>(generations.size()); slot-- > 0;)
+    {
+        generations[slot] = (generations[slot] + 1) & entity::GENERATION_MASK;
+
+        if (generations[slot] != entity::GENERATION_MASK) free_slots.push_back(slot);
+    }
+
+    alive = 0;
+}
+
+
+void Entity_store::save(std::vector<std::uint8_t>& out) const
+{
+    snapshot_io::write_value(out, static_cast<std::int32_t>(alive));
+    snapshot_io::write_vector(out, generations);
+    snapshot_io::write_vector(out, free_slots);
+}
+
+
+bool Entity_store::load(const std::uint8_t*& in, const std::uint8_t* end)
+{
+    std::int32_t saved_alive = 0;
+
+    if (!snapshot_io::read_value(in, end, saved_alive) || !snapshot_io::read_vector(in, end, generations)
+        || !snapshot_io::read_vector(in, end, free_slots)) return false;
+
+    alive = saved_alive;
+
+    return true;
+}
+
+
+void Entity_store::reserve(int count)
+{
+    generations.reserve(static_cast<size_t>(count));
+    free_slots.reserve(static_cast<size_t>(count));
+}
+
+// =========================================================================================== ENTITY STORE
@@ -0,0 +1,504 @@
+// entity_store.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../memory/allocator.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== ENTITY
+
+
+/**
+ * Entity id: the slot index in the low 20 bits, the generation of the slot in the high 12.
+ *
+ * A destroyed entity leaves its slot to the next one with the generation + 1, so an
+ * old id kept by somebody (a target, an event) never finds the new entity.
+ */
+using Entity = std::uint32_t;
+
+constexpr Entity NULL_ENTITY = 0xFFFFFFFFu;
+
+namespace entity
+{
+    constexpr int INDEX_BITS = 20;
+    constexpr std::uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+    constexpr std::uint32_t GENERATION_MASK = 0xFFFu;
+
+    // Largest number of the entities alive at once
+    constexpr std::uint32_t MAX_ENTITIES = INDEX_MASK;
+
+    constexpr std::uint32_t index(Entity e) { return e & INDEX_MASK; }
+    constexpr std::uint32_t generation(Entity e) { return (e >> INDEX_BITS) & GENERATION_MASK; }
+
+    constexpr Entity make(std::uint32_t index, std::uint32_t generation)
+    {
+        return ((generation & GENERATION_MASK) << INDEX_BITS) | (index & INDEX_MASK);
+    }
+}
+
+// =========================================================================================== ENTITY
+
+
+// =========================================================================================== SNAPSHOT IO
+
+// Raw copies of the trivially copyable data into a byte buffer - the in-memory snapshots
+// of the same build (no versioning, no endianness conversion). Reading into a vector
+// reuses its capacity, so a warmed up restore doesn't allocate.
+namespace snapshot_io
+{
+    template <typename T>
+    void write_value(std::vector<std::uint8_t>& out, const T& value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only the trivially copyable values are snapshotted");
+
+        const size_t at = out.size();
+        out.resize(at + sizeof(T));
+        std::memcpy(out.data() + at, &value, sizeof(T));
+    }
+
+    template <typename T>
+    bool read_value(const std::uint8_t*& in, const std::uint8_t* end, T& value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only the trivially copyable values are snapshotted");
+
+        if (static_cast<size_t>(end - in) < sizeof(T)) return false;
+
+        std::memcpy(&value, in, sizeof(T));
+        in += sizeof(T);
+
+        return true;
+    }
+
+    // Element count, then the elements
+    template <typename T, typename A>
+    void write_vector(std::vector<std::uint8_t>& out, const std::vector<T, A>& values)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only the trivially copyable values are snapshotted");
+
+        write_value(out, static_cast<std::uint32_t>(values.size()));
+
+        const size_t at = out.size();
+        out.resize(at + values.size() * sizeof(T));
+        if (!values.empty()) std::memcpy(out.data() + at, values.data(), values.size() * sizeof(T));
+    }
+
+    template <typename T, typename A>
+    bool read_vector(const std::uint8_t*& in, const std::uint8_t* end, std::vector<T, A>& values)
+    {
+        std::uint32_t count = 0;
+
+        if (!read_value(in, end, count) || static_cast<size_t>(end - in) / sizeof(T) < count) return false;
+
+        values.resize(count);
+        if (count) std::memcpy(values.data(), in, count * sizeof(T));
+        in += count * sizeof(T);
+
+        return true;
+    }
+}
+
+// =========================================================================================== SNAPSHOT IO
+
+
+// =========================================================================================== COMPONENT POOL
+
+
+// Type-erased side of a pool - the store removes the components of a destroyed entity through it
+class Component_pool_base
+{
+
+public:
+
+    virtual ~Component_pool_base() = default;
+
+    virtual void remove(Entity e) = 0;
+
+    virtual void clear() = 0;
+};
+
+
+/**
+ * @brief Packed array of one component type with the sparse-set lookup.
+ *
+ * The components are kept contiguous in the insertion order (dense), next to the array
+ * of their entities - a system is a plain loop over data() / get_entities(). The sparse
+ * array maps the entity slot to the dense index: has() and get() are two indexed loads,
+ * remove() moves the last component into the hole (the order is not kept).
+ *
+ * Pointers and references into the pool are valid until the next add() or remove().
+ *
+ * Usage:
+ * @code
+ * Component_pool<Velocity> velocities;      // or velocities(level_memory) - any Allocator
+ * store.attach(velocities);
+ *
+ * velocities.add(e, {1, 0});
+ *
+ * Velocity* v = velocities.data();
+ * const Entity* owners = velocities.get_entities();
+ * for (int i = 0; i < velocities.size(); ++i) move(owners[i], v[i]);
+ * @endcode
+ */
+template <typename T>
+class Component_pool final : public Component_pool_base
+{
+
+public:
+
+    Component_pool() = default;
+
+    // The arrays in the memory of the allocator, used while the pool is
+    explicit Component_pool(Allocator& allocator)
+        : components(Std_allocator<T>(allocator)), entities(Std_allocator<Entity>(allocator)),
+          sparse(Std_allocator<std::uint32_t>(allocator))
+    {
+    }
+
+
+    // Adds the component (replaces the existing one of the entity)
+    T& add(Entity e, const T& value)
+    {
+        const std::uint32_t slot = entity::index(e);
+
+        if (slot >= sparse.size()) sparse.resize(slot + 1, EMPTY);
+
+        if (sparse[slot] != EMPTY && entities[sparse[slot]] == e) return components[sparse[slot]] = value;
+
+        sparse[slot] = static_cast<std::uint32_t>(components.size());
+
+        entities.push_back(e);
+        components.push_back(value);
+
+        return components.back();
+    }
+
+    void remove(Entity e) override
+    {
+        const std::uint32_t dense = find(e);
+
+        if (dense == EMPTY) return;
+
+        const std::uint32_t last = static_cast<std::uint32_t>(components.size()) - 1;
+
+        if (dense != last)
+        {
+            components[dense] = std::move(components[last]);
+            entities[dense] = entities[last];
+            sparse[entity::index(entities[dense])] = dense;
+        }
+
+        components.pop_back();
+        entities.pop_back();
+
+        sparse[entity::index(e)] = EMPTY;
+    }
+
+    void clear() override
+    {
+        components.clear();
+        entities.clear();
+        sparse.clear();
+    }
+
+    // Room for count components - and for the slots below count, so add() doesn't grow the sparse array either
+    void reserve(int count)
+    {
+        components.reserve(static_cast<size_t>(count));
+        entities.reserve(static_cast<size_t>(count));
+        sparse.reserve(static_cast<size_t>(count));
+    }
+
+
+    bool has(Entity e) const { return find(e) != EMPTY; }
+
+    // nullptr if the entity has no such component
+    T* get(Entity e)
+    {
+        const std::uint32_t dense = find(e);
+        return dense == EMPTY ? nullptr : &components[dense];
+    }
+
+    const T* get(Entity e) const
+    {
+        const std::uint32_t dense = find(e);
+        return dense == EMPTY ? nullptr : &components[dense];
+    }
+
+
+    // === DENSE ARRAYS ===
+
+    int size() const { return static_cast<int>(components.size()); }
+
+    T* data() { return components.data(); }
+    const T* data() const { return components.data(); }
+
+    // Owner of every component, in the same order
+    const Entity* get_entities() const { return entities.data(); }
+
+    // === DENSE ARRAYS ===
+
+
+    // === SNAPSHOT ===
+
+    // Appends the whole pool to the snapshot (trivially copyable components only)
+    void save(std::vector<std::uint8_t>& out) const
+    {
+        snapshot_io::write_vector(out, components);
+        snapshot_io::write_vector(out, entities);
+        snapshot_io::write_vector(out, sparse);
+    }
+
+    // Replaces the pool by the saved one, false on a truncated snapshot
+    bool load(const std::uint8_t*& in, const std::uint8_t* end)
+    {
+        return snapshot_io::read_vector(in, end, components) && snapshot_io::read_vector(in, end, entities)
+            && snapshot_io::read_vector(in, end, sparse) && components.size() == entities.size();
+    }
+
+    // === SNAPSHOT ===
+
+
+private:
+
+    static constexpr std::uint32_t EMPTY = 0xFFFFFFFFu;
+
+    std::uint32_t find(Entity e) const
+    {
+        const std::uint32_t slot = entity::index(e);
+
+        if (slot >= sparse.size()) return EMPTY;
+
+        const std::uint32_t dense = sparse[slot];
+
+        // The slot could be taken by a newer generation
+        return dense != EMPTY && entities[dense] == e ? dense : EMPTY;
+    }
+
+
+    std::vector<T, Std_allocator<T>> components;
+    std::vector<Entity, Std_allocator<Entity>> entities;
+
+    // Entity slot -> dense index
+    std::vector<std::uint32_t, Std_allocator<std::uint32_t>> sparse;
+};
+
+// =========================================================================================== COMPONENT POOL
+
+
+// =========================================================================================== ENTITY STORE
+
+
+/**
+ * @brief Allocator of the entity ids and the owner of the attached component pools.
+ *
+ * The entities are only ids - all of the data is in the Component_pool arrays, owned
+ * by the game world next to the store. destroy() removes the entity from every
+ * attached pool, so no component outlives its entity.
+ *
+ * The freed slots are reused first (LIFO), so the sparse arrays stay as small as the
+ * largest number of the entities alive at once.
+ *
+ * Usage:
+ * @code
+ * struct World
+ * {
+ *     Entity_store store;
+ *     Component_pool<Position> positions;
+ *
+ *     World() { store.attach(positions); }
+ * };
+ *
+ * Entity e = world.store.create();
+ * world.positions.add(e, {10, 20});
+ * world.store.destroy(e);
+ * @endcode
+ */
+class Entity_store
+{
+
+public:
+
+    Entity_store() = default;
+
+    // The ids and the pool list in the memory of the allocator, used while the store is
+    explicit Entity_store(Allocator& allocator);
+
+
+    // The pool is used while the store is (usually both are the members of one world)
+    void attach(Component_pool_base& pool);
+
+
+    // New entity, NULL_ENTITY if MAX_ENTITIES are alive
+    Entity create();
+
+    // Removes the entity and all of its components, nothing for a stale id
+    void destroy(Entity e);
+
+    bool is_alive(Entity e) const;
+
+    // Destroys every entity, the attached pools are cleared (the capacity is kept)
+    void clear();
+
+
+    int get_alive() const { return alive; }
+
+    void reserve(int count);
+
+
+    // Appends the ids (the generations and the free slots) to the snapshot - the pools are saved by themselves
+    void save(std::vector<std::uint8_t>& out) const;
+
+    // Replaces the ids by the saved ones, false on a truncated snapshot
+    bool load(const std::uint8_t*& in, const std::uint8_t* end);
+
+
+private:
+
+    std::vector<Component_pool_base*, Std_allocator<Component_pool_base*>> pools;
+
+    // Current generation of every slot
+    std::vector<std::uint32_t, Std_allocator<std::uint32_t>> generations;
+
+    // Freed slots, reused first
+    std::vector<std::uint32_t, Std_allocator<std::uint32_t>> free_slots;
+
+    int alive = 0;
+};
+
+// =========================================================================================== ENTITY STORE
+
+
+// =========================================================================================== ENTITY POOL
+
+
+/**
+ * @brief Fixed-capacity pool of one transient entity type (bullets, pickups, popups) over the store.
+ *
+ * spawn() creates the entity in the Entity_store and adds its T, despawn() destroys it -
+ * with all of its other components. Both are O(1): the store reuses the freed slot (LIFO),
+ * the packed pools swap the last element into the hole.
+ *
+ * preallocate() reserves the capacity once per level; then nothing here touches the heap:
+ * a spawn over the capacity is refused (counted), the pool never grows in the gameplay.
+ * The store and the other pools of the entity need the room too (Entity_store::reserve(),
+ * Component_pool::reserve() of the whole level count).
+ *
+ * Despawning in a loop over the pool: back to front, the swapped-in element was already visited.
+ *
+ * Usage:
+ * @code
+ * Entity_pool<Bullet> bullets(store);       // attached to the store
+ * bullets.preallocate(level_hint);
+ *
+ * const Entity e = bullets.spawn({vx, vy});
+ * if (e != NULL_ENTITY) transforms.add(e, {...});
+ *
+ * for (int i = bullets.size(); i-- > 0;)
+ *     if (expired(bullets.data()[i])) bullets.despawn(bullets.get_entities()[i]);
+ * @endcode
+ */
+template <typename T>
+class Entity_pool
+{
+
+public:
+
+    explicit Entity_pool(Entity_store& store) : store(store) { store.attach(components); }
+
+    // The components in the memory of the allocator
+    Entity_pool(Entity_store& store, Allocator& allocator) : store(store), components(allocator) { store.attach(components); }
+
+    Entity_pool(const Entity_pool&) = delete;
+    Entity_pool& operator=(const Entity_pool&) = delete;
+
+
+    // Capacity of the level - reserved now, kept (never shrinks)
+    void preallocate(int new_capacity)
+    {
+        capacity = new_capacity > 0 ? new_capacity : 0;
+        components.reserve(capacity);
+    }
+
+    // New entity with the component, NULL_ENTITY if the pool (or the store) is full
+    Entity spawn(const T& value)
+    {
+        if (components.size() >= capacity)
+        {
+            ++refused;
+            return NULL_ENTITY;
+        }
+
+        const Entity e = store.create();
+
+        if (e == NULL_ENTITY)
+        {
+            ++refused;
+            return NULL_ENTITY;
+        }
+
+        components.add(e, value);
+
+        if (components.size() > peak) peak = components.size();
+
+        return e;
+    }
+
+    // Destroys the entity of this pool, false for a stale or a foreign one
+    bool despawn(Entity e)
+    {
+        if (!components.has(e)) return false;
+
+        store.destroy(e);
+        return true;
+    }
+
+
+    // === DENSE ARRAYS ===
+
+    int size() const { return components.size(); }
+    int get_capacity() const { return capacity; }
+
+    T* data() { return components.data(); }
+    const T* data() const { return components.data(); }
+
+    const Entity* get_entities() const { return components.get_entities(); }
+
+    T* get(Entity e) { return components.get(e); }
+    const T* get(Entity e) const { return components.get(e); }
+
+    // === DENSE ARRAYS ===
+
+
+    // Most alive at once and the refused spawns - the tuning of the level hints
+    int get_peak() const { return peak; }
+    int get_refused_count() const { return refused; }
+
+
+    // The component pool in the snapshots (the store is saved by itself)
+    void save(std::vector<std::uint8_t>& out) const { components.save(out); }
+    bool load(const std::uint8_t*& in, const std::uint8_t* end) { return components.load(in, end); }
+
+
+private:
+
+    Entity_store& store;
+
+    Component_pool<T> components;
+
+    int capacity = 0;
+    int peak = 0;
+    int refused = 0;
+};
+
+// =========================================================================================== ENTITY POOL
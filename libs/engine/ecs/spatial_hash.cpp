@@ -0,0 +1,252 @@
+// spatial_hash.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "spatial_hash.h"
+
+#include <algorithm>
+#include <cstdint>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== SPATIAL HASH
+
+Spatial_hash::Spatial_hash(int shift, int bucket_bits)
+    : cell_shift(shift)
+    , bucket_mask((1u << bucket_bits) - 1)
+    , buckets(static_cast<size_t>(1) << bucket_bits)
+{
+}
+
+
+std::uint32_t Spatial_hash::bucket_of(std::int32_t cx, std::int32_t cy) const
+{
+    // Two large primes - the neighbor cells go to the different buckets
+    return (static_cast<std::uint32_t>(cx) * 73856093u ^ static_cast<std::uint32_t>(cy) * 19349663u) & bucket_mask;
+}
+
+
+void Spatial_hash::insert_cells(Entity e, const Proxy& proxy)
+{
+    for (std::int32_t cy = proxy.cy0; cy <= proxy.cy1; ++cy)
+        for (std::int32_t cx = proxy.cx0; cx <= proxy.cx1; ++cx)
+        {
+            std::vector<Entity>& bucket = buckets[bucket_of(cx, cy)];
+
+            // Two cells of the entity could share a bucket - it's kept there once
+            if (std::find(bucket.begin(), bucket.end(), e) == bucket.end()) bucket.push_back(e);
+        }
+}
+
+
+void Spatial_hash::remove_cells(Entity e, const Proxy& proxy)
+{
+    for (std::int32_t cy = proxy.cy0; cy <= proxy.cy1; ++cy)
+        for (std::int32_t cx = proxy.cx0; cx <= proxy.cx1; ++cx)
+        {
+            std::vector<Entity>& bucket = buckets[bucket_of(cx, cy)];
+
+            const auto it = std::find(bucket.begin(), bucket.end(), e);
+
+            if (it == bucket.end()) continue;
+
+            *it = bucket.back();
+            bucket.pop_back();
+        }
+}
+
+
+void Spatial_hash::update(Entity e, const Aabb& box)
+{
+    Proxy next;
+
+    next.box = box;
+    next.cx0 = box.x0 >> cell_shift;
+    next.cy0 = box.y0 >> cell_shift;
+
+    // The boxes are half-open - the last covered unit is x1 - 1
+    next.cx1 = std::max(box.x0, box.x1 - 1) >> cell_shift;
+    next.cy1 = std::max(box.y0, box.y1 - 1) >> cell_shift;
+
+    next.stamp = 0;
+
+    if (Proxy* proxy = proxies.get(e))
+    {
+        // Same cells - only the box changes
+        if (proxy->cx0 == next.cx0 && proxy->cy0 == next.cy0 && proxy->cx1 == next.cx1 && proxy->cy1 == next.cy1)
+        {
+            proxy->box = box;
+            return;
+        }
+
+        remove_cells(e, *proxy);
+    }
+
+    insert_cells(e, proxies.add(e, next));
+}
+
+
+void Spatial_hash::remove(Entity e)
+{
+    const Proxy* proxy = proxies.get(e);
+
+    if (!proxy) return;
+
+    remove_cells(e, *proxy);
+    proxies.remove(e);
+}
+
+
+void Spatial_hash::clear()
+{
+    for (std::vector<Entity>& bucket : buckets) bucket.clear();
+
+    proxies.clear();
+}
+
+
+int Spatial_hash::query_area(const Aabb& area, std::vector<Entity>& out) const
+{
+    const size_t first = out.size();
+
+    // A new stamp per query - the stamps of the previous query don't need a reset
+    if (++query_stamp == 0)
+    {
+        for (int i = 0; i < proxies.size(); ++i) proxies.data()[i].stamp = 0;
+        query_stamp = 1;
+    }
+
+    const std::int32_t cx0 = area.x0 >> cell_shift;
+    const std::int32_t cy0 = area.y0 >> cell_shift;
+    const std::int32_t cx1 = std::max(area.x0, area.x1 - 1) >> cell_shift;
+    const std::int32_t cy1 = std::max(area.y0, area.y1 - 1) >> cell_shift;
+
+    for (std::int32_t cy = cy0; cy <= cy1; ++cy)
+        for (std::int32_t cx = cx0; cx <= cx1; ++cx)
+            for (Entity e : buckets[bucket_of(cx, cy)])
+            {
+                const Proxy* proxy = proxies.get(e);
+
+                if (proxy->stamp == query_stamp) continue;
+
+                proxy->stamp = query_stamp;
+
+                if (proxy->box.overlaps(area)) out.push_back(e);
+            }
+
+    return static_cast<int>(out.size() - first);
+}
+
+
+int Spatial_hash::query_pairs(std::vector<std::pair<Entity, Entity>>& out) const
+{
+    const size_t first = out.size();
+
+    const Proxy* all = proxies.data();
+    const Entity* owners = proxies.get_entities();
+
+    for (int i = 0; i < proxies.size(); ++i)
+    {
+        const Entity a = owners[i];
+        const Proxy& pa = all[i];
+
+        for (std::int32_t cy = pa.cy0; cy <= pa.cy1; ++cy)
+            for (std::int32_t cx = pa.cx0; cx <= pa.cx1; ++cx)
+                for (Entity b : buckets[bucket_of(cx, cy)])
+                {
+                    if (b <= a) continue;
+
+                    const Proxy* pb = proxies.get(b);
+
+                    if (!pa.box.overlaps(pb->box)) continue;
+
+                    // The pair is reported only by the cell of its overlap's top left corner -
+                    // once, however many cells (or buckets) the two share
+                    const std::int32_t rx = std::max(pa.box.x0, pb->box.x0) >> cell_shift;
+                    const std::int32_t ry = std::max(pa.box.y0, pb->box.y0) >> cell_shift;
+
+                    if (rx == cx && ry == cy) out.emplace_back(a, b);
+                }
+    }
+
+    return static_cast<int>(out.size() - first);
+}
+
+
+
+int Spatial_hash::query_swept(const Aabb& box, std::int32_t dx, std::int32_t dy, std::vector<Entity>& out) const
+{
+    const size_t first = out.size();
+
+    // The candidates overlap the bounds of the whole move - the sweep keeps the ones on its path
+    const Aabb area = {std::min(box.x0, box.x0 + dx), std::min(box.y0, box.y0 + dy),
+                       std::max(box.x1, box.x1 + dx), std::max(box.y1, box.y1 + dy)};
+
+    query_area(area, out);
+
+    size_t kept = first;
+    Sweep_hit hit;
+
+    for (size_t i = first; i < out.size(); ++i)
+        if (sweep(box, dx, dy, proxies.get(out[i])->box, hit)) out[kept++] = out[i];
+
+    out.resize(kept);
+
+    return static_cast<int>(kept - first);
+}
+
+// =========================================================================================== SPATIAL HASH
+
+
+// =========================================================================================== SWEEP
+
+// Open interval of the move shares, in which one axis of the boxes overlaps (Q16.16)
+static bool axis_overlap(std::int32_t min, std::int32_t max, std::int32_t other_min, std::int32_t other_max, std::int32_t d,
+                         std::int64_t& entry, std::int64_t& exit)
+{
+    if (d == 0)
+    {
+        // Standing on the axis - overlapping all of the move or never
+        entry = INT64_MIN;
+        exit = INT64_MAX;
+        return min < other_max && other_min < max;
+    }
+
+    const std::int64_t near = d > 0 ? other_min - max : other_max - min;
+    const std::int64_t far = d > 0 ? other_max - min : other_min - max;
+
+    entry = near * SWEEP_ONE / d;
+    exit = far * SWEEP_ONE / d;
+    return true;
+}
+
+
+bool sweep(const Aabb& box, std::int32_t dx, std::int32_t dy, const Aabb& other, Sweep_hit& hit)
+{
+    std::int64_t entry_x, exit_x, entry_y, exit_y;
+
+    if (!axis_overlap(box.x0, box.x1, other.x0, other.x1, dx, entry_x, exit_x)) return false;
+    if (!axis_overlap(box.y0, box.y1, other.y0, other.y1, dy, entry_y, exit_y)) return false;
+
+    // Both axes overlap at once - after the later entry, before the earlier exit
+    const std::int64_t entry = std::max(entry_x, entry_y);
+    const std::int64_t exit = std::min(exit_x, exit_y);
+
+    if (entry >= exit || entry >= SWEEP_ONE || exit <= 0) return false;
+
+    hit = {};
+
+    // Overlapping already - no side was entered
+    if (entry < 0) return true;
+
+    hit.time = static_cast<std::int32_t>(entry);
+
+    if (entry_x >= entry_y) hit.normal_x = dx > 0 ? -1 : 1;
+    else hit.normal_y = dy > 0 ? -1 : 1;
+
+    return true;
+}
+
+// =========================================================================================== SWEEP
@@ -0,0 +1,154 @@
+// spatial_hash.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "entity_store.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== SPATIAL HASH
+
+
+// Axis-aligned box [x0, x1) x [y0, y1) in the units of the world (Q16.16 pixels in the gameplay)
+struct Aabb
+{
+    std::int32_t x0 = 0;
+    std::int32_t y0 = 0;
+    std::int32_t x1 = 0;
+    std::int32_t y1 = 0;
+
+    // Touching boxes don't overlap
+    bool overlaps(const Aabb& other) const
+    {
+        return x0 < other.x1 && other.x0 < x1 && y0 < other.y1 && other.y0 < y1;
+    }
+};
+
+
+// First overlap of a moving box with a static one (sweep())
+struct Sweep_hit
+{
+    // Share of the move before the overlap, Q16.16 (SWEEP_ONE - the whole move), 0 - overlapping at the start
+    std::int32_t time = 0;
+
+    // Side of the static box entered: -1 / 1 on the axis of the entry, 0 on the other (both 0 at the start)
+    std::int8_t normal_x = 0;
+    std::int8_t normal_y = 0;
+};
+
+// The whole move of sweep()
+constexpr std::int32_t SWEEP_ONE = 1 << 16;
+
+
+/**
+ * @brief Swept AABB test - the box moving by dx, dy overlaps the static other one during the move.
+ *
+ * The overlap test of the end positions misses a box the move jumped over (a fast body or a
+ * long step); the sweep finds it and when it was entered. Integer only, the same on every build.
+ *
+ * @return false if the boxes don't overlap at any point of the move (touching doesn't count).
+ */
+bool sweep(const Aabb& box, std::int32_t dx, std::int32_t dy, const Aabb& other, Sweep_hit& hit);
+
+
+/**
+ * @brief Uniform-grid broadphase: the entities by the cells their boxes cover.
+ *
+ * The grid is unbounded - a cell (x >> cell_shift, y >> cell_shift) is hashed into a
+ * fixed table of buckets, so the memory doesn't depend on the level size. A query
+ * looks only at the buckets of the cells it covers: the cost grows with the number of
+ * the nearby objects, not with the number of all of them.
+ *
+ * Incremental: update() of an entity, whose box stays inside the same cells, only
+ * stores the new box - the buckets are rewritten only when it crosses a cell border.
+ * The static boxes are inserted once.
+ *
+ * Attached to the Entity_store like a component pool, so a destroyed entity leaves the grid.
+ *
+ * Usage:
+ * @code
+ * Spatial_hash grid(22);          // 64 px cells for the Q16.16 coordinates
+ * store.attach(grid);
+ *
+ * grid.update(e, box);            // every tick for the moving entities
+ * grid.query_pairs(contacts);     // all of the overlapping pairs
+ * grid.query_area(area, found);   // the entities overlapping the area
+ * grid.query_swept(box, dx, dy, found);  // the entities a move passes through
+ * @endcode
+ */
+class Spatial_hash final : public Component_pool_base
+{
+
+public:
+
+    /**
+     * @param cell_shift  Cell size as a power of two in the world units (22 - 64 px in Q16.16).
+     * @param bucket_bits Buckets in the table, 1 << bucket_bits.
+     */
+    explicit Spatial_hash(int cell_shift = 22, int bucket_bits = 10);
+
+
+    // Inserts the entity or moves it to the new box
+    void update(Entity e, const Aabb& box);
+
+    void remove(Entity e) override;
+
+    void clear() override;
+
+    bool contains(Entity e) const { return proxies.has(e); }
+
+    int get_count() const { return proxies.size(); }
+
+
+    // === QUERIES ===
+
+    // Appends every entity overlapping the area (each once), returns their number
+    int query_area(const Aabb& area, std::vector<Entity>& out) const;
+
+    // Appends every overlapping pair (each once, the lower id first), returns their number
+    int query_pairs(std::vector<std::pair<Entity, Entity>>& out) const;
+
+    // Appends every entity the box moving by dx, dy overlaps during the move (sweep()), returns their number
+    int query_swept(const Aabb& box, std::int32_t dx, std::int32_t dy, std::vector<Entity>& out) const;
+
+    // === QUERIES ===
+
+
+private:
+
+    struct Proxy
+    {
+        Aabb box;
+
+        // Covered cells, inclusive
+        std::int32_t cx0, cy0, cx1, cy1;
+
+        // Query stamp - the entity is reported once even if it covers many of the area cells
+        mutable std::uint32_t stamp;
+    };
+
+    std::uint32_t bucket_of(std::int32_t cx, std::int32_t cy) const;
+
+    void insert_cells(Entity e, const Proxy& proxy);
+    void remove_cells(Entity e, const Proxy& proxy);
+
+
+    int cell_shift;
+    std::uint32_t bucket_mask;
+
+    Component_pool<Proxy> proxies;
+
+    // Entities of every bucket (a bucket holds all of the cells with its hash)
+    std::vector<std::vector<Entity>> buckets;
+
+    mutable std::uint32_t query_stamp = 0;
+};
+
+// =========================================================================================== SPATIAL HASH
@@ -0,0 +1,68 @@
+// engine_clock.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "engine_clock.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== ENGINE CLOCK
+
+Engine_time Engine_clock::state;
+
+const Engine_time& Engine_clock::time = Engine_clock::state;
+
+bool Engine_clock::pause_requested = false;
+double Engine_clock::scale_requested = 1.0;
+double Engine_clock::smoothing = 0.1;
+
+
+void Engine_clock::begin_cycle(Uint64 counter, double raw_dt, int ticks, double tick_dt, float alpha)
+{
+    const bool first = state.frame_counter == 0;
+
+    if (!first) ++state.frame;
+
+    state.frame_counter = counter;
+
+    state.raw_dt = raw_dt;
+    state.real_time += raw_dt;
+
+    // The first measured cycle starts the average - no ramp from zero
+    if (state.smooth_dt == 0.0) state.smooth_dt = raw_dt;
+    else state.smooth_dt += (raw_dt - state.smooth_dt) * smoothing;
+
+    state.tick += static_cast<Uint64>(state.ticks);
+    state.ticks = ticks;
+    state.tick_dt = tick_dt;
+    state.tick_time = static_cast<double>(state.tick + static_cast<Uint64>(ticks)) * tick_dt;
+    state.alpha = alpha;
+
+    state.paused = pause_requested;
+    state.time_scale = scale_requested;
+
+    state.game_dt = state.paused ? 0.0 : ticks * tick_dt * state.time_scale;
+    state.game_time += state.game_dt;
+}
+
+
+void Engine_clock::set_paused(bool paused) { pause_requested = paused; }
+
+
+void Engine_clock::set_time_scale(double scale) { scale_requested = scale > 0.0 ? scale : 0.0; }
+
+
+void Engine_clock::set_smoothing(double weight) { smoothing = weight < 0.0 ? 0.0 : weight > 1.0 ? 1.0 : weight; }
+
+
+void Engine_clock::reset()
+{
+    state = Engine_time{};
+
+    pause_requested = false;
+    scale_requested = 1.0;
+}
+
+// =========================================================================================== ENGINE CLOCK
@@ -0,0 +1,165 @@
+// engine_clock.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include "../platform/backend.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== ENGINE TIME
+
+
+/**
+ * @brief Time of the current application cycle (Engine_clock::time).
+ *
+ * Written once per cycle by SDL_app_cycle, before the update ticks are started -
+ * constant for the whole cycle, so the state_update ticks on the pipeline worker
+ * and the state_render on the main thread read it without a lock.
+ */
+struct Engine_time
+{
+    // === FRAME ===
+
+    // Index of the cycle, 0 - the first one
+    Uint64 frame = 0;
+
+    // Engine_clock::now() at the start of the cycle
+    Uint64 frame_counter = 0;
+
+    // Real seconds since the previous cycle (the idle sleeps are not counted)
+    double raw_dt = 0.0;
+
+    // raw_dt averaged over the last cycles - for the displays and the adaptive quality, not the movement
+    double smooth_dt = 0.0;
+
+    // Real seconds of the cycles since the first one
+    double real_time = 0.0;
+
+    // === FRAME ===
+
+
+    // === FIXED TICK ===
+
+    // Length of one state_update tick (1 / sim_hz)
+    double tick_dt = 1.0 / 60.0;
+
+    // Update ticks of this cycle
+    int ticks = 0;
+
+    // Ticks run before this cycle - the first tick of the cycle has this index
+    Uint64 tick = 0;
+
+    // Simulation time at the end of the cycle's ticks (the tick count * tick_dt)
+    double tick_time = 0.0;
+
+    // Render interpolation between the last two ticks
+    float alpha = 0.0f;
+
+    // === FIXED TICK ===
+
+
+    // === GAME TIME ===
+
+    // Simulation time, which stops while paused and runs at time_scale - the game timers
+    double game_time = 0.0;
+
+    // Game seconds of this cycle (0 while paused)
+    double game_dt = 0.0;
+
+    double time_scale = 1.0;
+
+    bool paused = false;
+
+    // === GAME TIME ===
+};
+
+// =========================================================================================== ENGINE TIME
+
+
+// =========================================================================================== ENGINE CLOCK
+
+
+/**
+ * @brief The engine-wide monotonic clock (the clock of the Platform backend) and the cycle time.
+ *
+ * Every timing in the engine - the frame pacer, the state profiler, the audio scheduler,
+ * the startup trace and the input latency - takes its counters from now(), so any two
+ * of them can be compared. The cycle time is a plain struct - read as Engine_clock::time.x,
+ * no call and no lock.
+ *
+ * Static only, like the Platform parts.
+ *
+ * Usage:
+ * @code
+ * position += speed * Engine_clock::time.tick_dt;       // state_update
+ * if (Engine_clock::time.game_time > spawn_at) spawn();  // paused by the pause menu
+ * Engine_clock::set_paused(true);
+ * const Uint64 start = Engine_clock::now();
+ * double ms = Engine_clock::to_ms(Engine_clock::now() - start);
+ * @endcode
+ */
+class Engine_clock
+{
+
+public:
+
+    // Time of the current cycle (read only - set by begin_cycle())
+    static const Engine_time& time;
+
+
+    // === CLOCK ===
+
+    // Monotonic counter
+    static Uint64 now() { return Platform::Clock::now(); }
+
+    // Counter ticks per second
+    static Uint64 frequency() { return Platform::Clock::frequency(); }
+
+    static double to_seconds(Uint64 ticks) { return static_cast<double>(ticks) / static_cast<double>(frequency()); }
+    static double to_ms(Uint64 ticks) { return static_cast<double>(ticks) * 1000.0 / static_cast<double>(frequency()); }
+    static Uint64 to_us(Uint64 ticks) { return ticks * 1000000 / frequency(); }
+
+    // === CLOCK ===
+
+
+    // === CYCLE (SDL_app_cycle) ===
+
+    /**
+     * @brief Sets the time of the new cycle.
+     *
+     * @param counter Clock counter of the cycle start.
+     * @param raw_dt  Real seconds since the previous cycle.
+     * @param ticks   Update ticks of the cycle.
+     * @param tick_dt Length of one tick.
+     * @param alpha   Render interpolation after the ticks.
+     */
+    static void begin_cycle(Uint64 counter, double raw_dt, int ticks, double tick_dt, float alpha);
+
+    // The game time stops on the next cycle (the ticks still run - the menus animate)
+    static void set_paused(bool paused);
+
+    // Game seconds per tick second from the next cycle (slow motion, fast forward)
+    static void set_time_scale(double scale);
+
+    // Smoothing of smooth_dt: the weight of the newest cycle, 0 - 1
+    static void set_smoothing(double weight);
+
+    // Back to the frame 0
+    static void reset();
+
+    // === CYCLE (SDL_app_cycle) ===
+
+
+private:
+
+    static Engine_time state;
+
+    static bool pause_requested;
+    static double scale_requested;
+    static double smoothing;
+};
+
+// =========================================================================================== ENGINE CLOCK
@@ -0,0 +1,414 @@
+// evdev_input.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "evdev_input.h"
+#include "../input/input.h"
+#include "../thread_roles/thread_roles.h"
+
+#ifdef PLATFORM_LINUX
+    #include <cerrno>
+    #include <cstdio>
+    #include <ctime>
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <unistd.h>
+    #include <sys/ioctl.h>
+    #include <linux/input.h>
+#endif
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== EVDEV INPUT
+
+Evdev_input::~Evdev_input() { close(); }
+
+
+bool Evdev_input::is_open() const { return reader != nullptr; }
+
+
+std::uint32_t Evdev_input::collect(Input& input)
+{
+    if (!reader) return 0;
+
+    refresh_mapping();
+
+    // The edges are taken first - a key event in between is in the held mask, or in the next collect
+    const std::uint32_t new_pressed = pressed.exchange(0, std::memory_order_acq_rel);
+    const std::uint32_t new_released = released.exchange(0, std::memory_order_acq_rel);
+    const std::uint32_t new_held = held.load(std::memory_order_acquire);
+
+    for (int b = 0; b < BUTTON_COUNT; ++b)
+    {
+        if (new_pressed & (1u << b))
+            input.set_press_time_ns(static_cast<Button>(b), press_time_ns[b].load(std::memory_order_relaxed));
+    }
+
+    input.apply_buttons(new_held, new_pressed, new_released);
+
+    return new_pressed;
+}
+
+
+std::uint32_t Evdev_input::get_held() const { return held.load(std::memory_order_acquire); }
+
+
+std::uint64_t Evdev_input::get_press_time_ns(Button b) const
+{
+    return b < BUTTON_COUNT ? press_time_ns[b].load(std::memory_order_relaxed) : 0;
+}
+
+
+std::uint64_t Evdev_input::get_event_count() const { return event_count.load(std::memory_order_relaxed); }
+
+
+int SDLCALL Evdev_input::reader_main(void* userdata)
+{
+    static_cast<Evdev_input*>(userdata)->read_events();
+
+    return 0;
+}
+
+
+void Evdev_input::apply_key(std::uint16_t code, std::int32_t value, std::uint64_t time_ns)
+{
+    const Button b = map_key(code);
+
+    // Value 2 is the autorepeat - no new information for the held mask
+    if (b == BUTTON_COUNT || value == 2) return;
+
+    const std::uint32_t bit = 1u << b;
+
+    event_count.store(event_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    // The reader is the only writer of the held mask
+    const std::uint32_t was_held = held.load(std::memory_order_relaxed);
+
+    if (value)
+    {
+        if (was_held & bit) return;
+
+        press_time_ns[b].store(time_ns, std::memory_order_relaxed);
+
+        held.store(was_held | bit, std::memory_order_release);
+        pressed.fetch_or(bit, std::memory_order_release);
+    }
+    else
+    {
+        if (!(was_held & bit)) return;
+
+        held.store(was_held & ~bit, std::memory_order_release);
+        released.fetch_or(bit, std::memory_order_release);
+    }
+}
+
+
+Button Evdev_input::map_key_code(std::uint16_t code)
+{
+    const SDL_Scancode scancode = to_scancode(code);
+
+    return scancode == SDL_SCANCODE_UNKNOWN ? BUTTON_COUNT : Input::Instance().map_scancode(scancode);
+}
+
+
+void Evdev_input::refresh_mapping()
+{
+    const Input& input = Input::Instance();
+
+    if (input.get_mapping_revision() == mapping_revision) return;
+
+    std::lock_guard<std::mutex> guard(mapping_lock);
+
+    for (int code = 0; code < SDL_NUM_SCANCODES; ++code) key_buttons[code] = input.map_scancode(static_cast<SDL_Scancode>(code));
+
+    mapping_revision = input.get_mapping_revision();
+}
+
+
+Button Evdev_input::map_key(std::uint16_t code)
+{
+    const SDL_Scancode scancode = to_scancode(code);
+
+    if (scancode == SDL_SCANCODE_UNKNOWN) return BUTTON_COUNT;
+
+    std::lock_guard<std::mutex> guard(mapping_lock);
+
+    return key_buttons[scancode];
+}
+
+
+#ifdef PLATFORM_LINUX
+
+// The keys of the built-in layout only - a key, which has no case here, can't be remapped for evdev
+
+SDL_Scancode Evdev_input::to_scancode(std::uint16_t code)
+{
+    switch (code)
+    {
+        case KEY_UP:        return SDL_SCANCODE_UP;
+        case KEY_DOWN:      return SDL_SCANCODE_DOWN;
+        case KEY_LEFT:      return SDL_SCANCODE_LEFT;
+        case KEY_RIGHT:     return SDL_SCANCODE_RIGHT;
+
+        case KEY_SPACE:     return SDL_SCANCODE_SPACE;      // Miyoo A
+        case KEY_LEFTCTRL:  return SDL_SCANCODE_LCTRL;      // Miyoo B
+        case KEY_LEFTSHIFT: return SDL_SCANCODE_LSHIFT;     // Miyoo X
+        case KEY_LEFTALT:   return SDL_SCANCODE_LALT;       // Miyoo Y
+
+        case KEY_ENTER:     return SDL_SCANCODE_RETURN;     // Miyoo START
+        case KEY_RIGHTCTRL: return SDL_SCANCODE_RCTRL;      // Miyoo SELECT
+        case KEY_ESC:       return SDL_SCANCODE_ESCAPE;     // Miyoo MENU
+        case KEY_TAB:       return SDL_SCANCODE_TAB;        // Miyoo L2
+        case KEY_BACKSPACE: return SDL_SCANCODE_BACKSPACE;  // Miyoo R2
+        case KEY_E:         return SDL_SCANCODE_E;          // Miyoo L1
+        case KEY_T:         return SDL_SCANCODE_T;          // Miyoo R1
+
+        // Desktop extras
+        case KEY_Z:         return SDL_SCANCODE_Z;
+        case KEY_X:         return SDL_SCANCODE_X;
+
+        default:            return SDL_SCANCODE_UNKNOWN;
+    }
+}
+
+
+std::uint64_t Evdev_input::now_ns()
+{
+    timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return static_cast<std::uint64_t>(t.tv_sec) * 1000000000ull + static_cast<std::uint64_t>(t.tv_nsec);
+}
+
+
+bool Evdev_input::open(const char* device)
+{
+    if (reader) return true;
+
+    // The devices with the mapped keys only - the touch screens and the sensors are skipped
+    auto open_device = [this](const char* path) -> bool
+    {
+        const int fd = ::open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+
+        if (fd < 0) return false;
+
+        unsigned long key_bits[(KEY_MAX + 1) / (8 * sizeof(unsigned long)) + 1] = {};
+
+        bool has_keys = ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(key_bits)), key_bits) >= 0;
+
+        if (has_keys)
+        {
+            has_keys = false;
+
+            for (std::uint16_t code = 0; code <= KEY_MAX && !has_keys; ++code)
+            {
+                const unsigned long word = key_bits[code / (8 * sizeof(unsigned long))];
+
+                if ((word >> (code % (8 * sizeof(unsigned long)))) & 1ul) has_keys = map_key_code(code) != BUTTON_COUNT;
+            }
+        }
+
+        if (!has_keys)
+        {
+            ::close(fd);
+            return false;
+        }
+
+        // Event timestamps on the clock of now_ns() (the default realtime clock jumps)
+        int clock_id = CLOCK_MONOTONIC;
+
+        if (ioctl(fd, EVIOCSCLOCKID, &clock_id) != 0) SDL_Log("Input device %s keeps the realtime timestamps", path);
+
+        fds[device_count++] = fd;
+
+        return true;
+    };
+
+    if (device) open_device(device);
+    else
+    {
+        char path[32];
+
+        for (int i = 0; i < 32 && device_count < MAX_DEVICES; ++i)
+        {
+            std::snprintf(path, sizeof(path), "/dev/input/event%d", i);
+            open_device(path);
+        }
+    }
+
+    if (device_count == 0)
+    {
+        SDL_Log("No input device with the buttons can be opened");
+        return false;
+    }
+
+    if (pipe(wake_pipe) != 0)
+    {
+        SDL_Log("Input wake pipe can't be created");
+        close();
+        return false;
+    }
+
+    held.store(0, std::memory_order_relaxed);
+    pressed.store(0, std::memory_order_relaxed);
+    released.store(0, std::memory_order_relaxed);
+
+    // The reader starts with the current layout
+    mapping_revision = Input::Instance().get_mapping_revision() - 1;
+    refresh_mapping();
+
+    running.store(true, std::memory_order_release);
+
+    reader = SDL_CreateThread(reader_main, "evdev_input", this);
+
+    if (!reader)
+    {
+        SDL_Log("Input thread can't be created: %s", SDL_GetError());
+        close();
+        return false;
+    }
+
+    SDL_Log("Evdev input: %d device(s)", device_count);
+
+    return true;
+}
+
+
+void Evdev_input::close()
+{
+    running.store(false, std::memory_order_release);
+
+    if (reader)
+    {
+        const char wake = 0;
+
+        if (write(wake_pipe[1], &wake, 1) != 1) SDL_Log("Input thread wake failed");
+
+        SDL_WaitThread(reader, nullptr);
+        reader = nullptr;
+    }
+
+    for (int i = 0; i < device_count; ++i) ::close(fds[i]);
+
+    device_count = 0;
+
+    for (int& fd : wake_pipe)
+    {
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+    }
+}
+
+
+void Evdev_input::drop_device(int index)
+{
+    SDL_Log("Input device (fd %d) failed or was unplugged - closed", fds[index]);
+
+    ::close(fds[index]);
+
+    // The order of the devices doesn't matter - the last one takes the place
+    fds[index] = fds[--device_count];
+}
+
+
+void Evdev_input::read_events()
+{
+    // With the game - a press wakes it at once
+    if (!Thread_roles::Instance().apply(Thread_role::MAIN)) SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH);
+
+    pollfd polled[MAX_DEVICES + 1];
+
+    // The devices, then the wake pipe - rebuilt after a device is dropped
+    auto build_poll_set = [&]()
+    {
+        for (int i = 0; i < device_count; ++i) polled[i] = {fds[i], POLLIN, 0};
+
+        polled[device_count] = {wake_pipe[0], POLLIN, 0};
+    };
+
+    build_poll_set();
+
+    input_event events[64];
+
+    while (running.load(std::memory_order_acquire))
+    {
+        // Sleeps until a key event or close() - no polling interval to add to the latency
+        if (poll(polled, static_cast<nfds_t>(device_count + 1), -1) <= 0) continue;
+
+        if (polled[device_count].revents) break;
+
+        bool dropped = false;
+
+        // Backwards - a dropped device takes the place of the last one, which is already read
+        for (int i = device_count - 1; i >= 0; --i)
+        {
+            const short revents = polled[i].revents;
+
+            if (!revents) continue;
+
+            ssize_t bytes = 0;
+
+            if (revents & POLLIN)
+            {
+                while ((bytes = read(fds[i], events, sizeof(events))) > 0)
+                {
+                    const int count = static_cast<int>(bytes / static_cast<ssize_t>(sizeof(input_event)));
+
+                    for (int e = 0; e < count; ++e)
+                    {
+                        if (events[e].type != EV_KEY) continue;
+
+                        const std::uint64_t time_ns = static_cast<std::uint64_t>(events[e].input_event_sec) * 1000000000ull +
+                                                      static_cast<std::uint64_t>(events[e].input_event_usec) * 1000ull;
+
+                        apply_key(events[e].code, events[e].value, time_ns);
+                    }
+                }
+            }
+
+            // An error or a hang-up stays reported by every poll() - the device would spin the thread.
+            // A readable one is dropped, when the read fails with anything but the drained queue.
+            const bool failed = (revents & (POLLERR | POLLHUP | POLLNVAL)) ||
+                                bytes == 0 || (bytes < 0 && errno != EAGAIN && errno != EINTR);
+
+            if (failed)
+            {
+                drop_device(i);
+                dropped = true;
+            }
+        }
+
+        if (!dropped) continue;
+
+        if (device_count == 0) SDL_Log("No input device is left - the evdev input is idle until close()");
+
+        build_poll_set();
+    }
+}
+
+#else
+
+SDL_Scancode Evdev_input::to_scancode(std::uint16_t) { return SDL_SCANCODE_UNKNOWN; }
+
+
+std::uint64_t Evdev_input::now_ns() { return 0; }
+
+
+bool Evdev_input::open(const char*)
+{
+    SDL_Log("Evdev input is available only on Linux");
+    return false;
+}
+
+
+void Evdev_input::close() {}
+
+
+void Evdev_input::read_events() {}
+
+#endif
+
+// =========================================================================================== EVDEV INPUT
@@ -0,0 +1,161 @@
+// evdev_input.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+class Input;
+
+
+// =========================================================================================== EVDEV INPUT
+
+
+/**
+ * @brief Native Linux input (/dev/input/event*) read by its own thread.
+ *
+ * The SDL keyboard events of the device go through the SDL event queue and are seen
+ * only by the next poll of the main loop. This backend blocks in poll() on the event
+ * devices instead, and folds every key event into the button masks the moment the
+ * kernel delivers it - the main loop takes the newest state by collect(), without
+ * any queue in between. A press and a release between two collects are both kept.
+ *
+ * Every edge keeps its kernel timestamp (CLOCK_MONOTONIC, set by EVIOCSCLOCKID) -
+ * the press time of a button is exact to the microsecond, not to the frame.
+ * now_ns() reads the same clock.
+ *
+ * The devices are not grabbed, the system keys (the menu, the power) still work.
+ * Available only on Linux, open() fails elsewhere.
+ *
+ * Usage (done by SDL_app_init, if sdl_app_ctx::use_evdev_input is set):
+ * @code
+ * if (evdev.open()) Input::Instance().set_external_buttons(true);
+ * // ... every cycle, before the update ticks:
+ * evdev.collect(Input::Instance());
+ * @endcode
+ */
+class Evdev_input
+{
+
+public:
+
+    // Native input part of the platform backend (platform/backend.h)
+    static constexpr bool NATIVE = true;
+
+    // Most event devices read at once (the Miyoo Mini has the gpio keys and the power key)
+    static constexpr int MAX_DEVICES = 8;
+
+
+    Evdev_input() = default;
+
+    // Stops the thread and closes the devices
+    ~Evdev_input();
+
+    // Copying the device owner is not allowed
+    Evdev_input(const Evdev_input&) = delete;
+    Evdev_input& operator=(const Evdev_input&) = delete;
+
+
+    /**
+     * @brief Opens the key devices and starts the reader thread.
+     *
+     * @param device Device path, nullptr - every /dev/input/event* with the keys.
+     * @return true on success; false if no device could be opened, or the thread failed.
+     */
+    bool open(const char* device = nullptr);
+
+    // Stops the thread and releases the devices
+    void close();
+
+    bool is_open() const;
+
+
+    /**
+     * @brief Moves the edges since the last collect into the Input snapshot (main thread).
+     *
+     * The press times of the buttons go with them (Input::get_press_time_ns()).
+     *
+     * @return Pressed mask of the collected edges.
+     */
+    std::uint32_t collect(Input& input);
+
+    // Buttons held right now - the newest state, without collect()
+    std::uint32_t get_held() const;
+
+    // Kernel time of the last press of the button, in ns of CLOCK_MONOTONIC (0 - never pressed)
+    std::uint64_t get_press_time_ns(Button b) const;
+
+    // Number of the key events read since open()
+    std::uint64_t get_event_count() const;
+
+
+    // CLOCK_MONOTONIC in ns - the clock of the event timestamps
+    static std::uint64_t now_ns();
+
+    /**
+     * @brief Maps the Linux key code (linux/input-event-codes.h) to the engine button.
+     *
+     * The key goes through the SDL scancode into the table of Input::map_scancode(),
+     * so the remapped layout (Input::load_mapping()) is the same for both backends.
+     * Reads the Input table - main thread only, the reader uses its copy of it.
+     *
+     * @return Mapped button, or BUTTON_COUNT if the key is not mapped.
+     */
+    static Button map_key_code(std::uint16_t code);
+
+    // SDL scancode of the Linux key code, SDL_SCANCODE_UNKNOWN for the keys the Miyoo doesn't send
+    static SDL_Scancode to_scancode(std::uint16_t code);
+
+
+private:
+
+    static int SDLCALL reader_main(void* userdata);
+
+    // Reader thread loop - poll() on the devices and the wake pipe
+    void read_events();
+
+    // Reader thread - one key event with its kernel time
+    void apply_key(std::uint16_t code, std::int32_t value, std::uint64_t time_ns);
+
+    // Copies the key table of the Input, if it changed since the last copy (main thread)
+    void refresh_mapping();
+
+    // Reader thread - map_key_code() by the copy of the key table
+    Button map_key(std::uint16_t code);
+
+    // Reader thread - closes a failed or unplugged device and drops it from the poll set
+    void drop_device(int index);
+
+
+    int fds[MAX_DEVICES] = {};
+    int device_count = 0;
+
+    // Wakes the reader from poll() on close()
+    int wake_pipe[2] = {-1, -1};
+
+    SDL_Thread* reader = nullptr;
+    std::atomic<bool> running{false};
+
+    // Reader thread -> main thread: the held mask and the edges since the last collect
+    std::atomic<std::uint32_t> held{0};
+    std::atomic<std::uint32_t> pressed{0};
+    std::atomic<std::uint32_t> released{0};
+
+    std::atomic<std::uint64_t> press_time_ns[BUTTON_COUNT] = {};
+    std::atomic<std::uint64_t> event_count{0};
+
+    // Copy of Input's scancode table - the main thread can remap the keys while the reader runs
+    std::mutex mapping_lock;
+    Button key_buttons[SDL_NUM_SCANCODES];
+    std::uint32_t mapping_revision = 0;
+};
+
+// =========================================================================================== EVDEV INPUT
@@ -0,0 +1,57 @@
+// event_bus.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "event_bus.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== EVENT TYPES
+
+int event_type::next_id()
+{
+    static int count = 0;
+
+    return count++;
+}
+
+// =========================================================================================== EVENT TYPES
+
+
+// =========================================================================================== EVENT BUS
+
+Event_bus& Event_bus::Instance()
+{
+    static Event_bus instance;
+    return instance;
+}
+
+
+void Event_bus::unsubscribe_all(void* context)
+{
+    for (auto& channel : channels)
+        if (channel) channel->unsubscribe_all(context);
+}
+
+
+void Event_bus::dispatch()
+{
+    int count = 0;
+
+    // By index - a listener could emit the first event of a new type (a new channel)
+    for (size_t i = 0; i < channels.size(); ++i)
+        if (channels[i]) count += channels[i]->dispatch();
+
+    last_dispatch_count = count;
+}
+
+
+void Event_bus::clear()
+{
+    for (auto& channel : channels)
+        if (channel) channel->clear();
+}
+
+// =========================================================================================== EVENT BUS
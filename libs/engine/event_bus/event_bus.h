@@ -0,0 +1,251 @@
+// event_bus.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== EVENT TYPES
+
+namespace event_type
+{
+    // Next free type index (one per event type, in the order of the first use)
+    int next_id();
+
+    /**
+     * Index of the event type - assigned once, a constant load after that.
+     * The bus keeps its channels in an array by this index, no map lookup per event.
+     */
+    template <typename T>
+    int id()
+    {
+        static const int value = next_id();
+        return value;
+    }
+}
+
+// =========================================================================================== EVENT TYPES
+
+
+// =========================================================================================== EVENT BUS
+
+
+/**
+ * @brief Queued gameplay events, dispatched in batches once per frame.
+ *
+ * Every event type has its own channel: the queue of the events by value and the array
+ * of the listeners. A listener is a plain function pointer with a context pointer -
+ * no std::function and no capture to allocate. emit() appends to the type's queue,
+ * dispatch() (the engine, after the update ticks of the cycle) hands every listener
+ * the whole queue of its type, then empties it.
+ *
+ * The queues keep their capacity, so after the first frames an event never allocates.
+ * Events are trivially copyable structs. Inside a type the events keep the emit order,
+ * the types are dispatched in the order of their first use. An event emitted by
+ * a listener is delivered by the next dispatch.
+ *
+ * Singleton, like Render_queue - the emitters need no link to the listeners.
+ * Emit on the update thread; dispatch on it, or on the main thread after the sync point
+ * of the pipelined cycle (the update worker is idle then, the listeners may touch the render state).
+ *
+ * Usage:
+ * @code
+ * struct Edge_hit_event { float x, y; };
+ *
+ * Event_bus& bus = Event_bus::Instance();
+ *
+ * bus.subscribe<Edge_hit_event, Sparks, &Sparks::on_edge_hit>(&sparks);
+ * bus.emit(Edge_hit_event{x, y});                  // physics tick
+ * // ... Sparks::on_edge_hit(const Edge_hit_event&) is called by the frame's dispatch
+ * @endcode
+ */
+class Event_bus
+{
+
+public:
+
+    // Returns the singleton instance.
+    static Event_bus& Instance();
+
+
+    // === LISTENERS ===
+
+    /**
+     * @brief Adds a listener of the event type.
+     *
+     * @param fn      Called for every event of the type.
+     * @param context Passed back to fn (the listener object), also the key of unsubscribe_all().
+     */
+    template <typename T>
+    void subscribe(void (*fn)(void* context, const T& event), void* context = nullptr)
+    {
+        get_channel<T>().listeners.push_back({fn, context});
+    }
+
+    // Member function listener - the thunk is generated, the object is the context
+    template <typename T, typename C, void (C::*Method)(const T&)>
+    void subscribe(C* object)
+    {
+        subscribe<T>(&member_thunk<T, C, Method>, object);
+    }
+
+    // Removes the listener added with the same function and context
+    template <typename T>
+    void unsubscribe(void (*fn)(void* context, const T& event), void* context = nullptr)
+    {
+        auto& listeners = get_channel<T>().listeners;
+
+        for (size_t i = 0; i < listeners.size(); ++i)
+            if (listeners[i].fn == fn && listeners[i].context == context)
+            {
+                listeners.erase(listeners.begin() + static_cast<std::ptrdiff_t>(i));
+                return;
+            }
+    }
+
+    template <typename T, typename C, void (C::*Method)(const T&)>
+    void unsubscribe(C* object)
+    {
+        unsubscribe<T>(&member_thunk<T, C, Method>, object);
+    }
+
+    // Removes every listener of every type with the context (the object is destroyed)
+    void unsubscribe_all(void* context);
+
+    // === LISTENERS ===
+
+
+    // === EVENTS ===
+
+    // Queues the event for the next dispatch
+    template <typename T>
+    void emit(const T& event)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "events are copied by value");
+
+        get_channel<T>().pending.push_back(event);
+    }
+
+    // Drops the queued events of the type (the world they describe was replaced)
+    template <typename T>
+    void discard()
+    {
+        get_channel<T>().pending.clear();
+    }
+
+    // Room for the events of the type - no allocation before the first dispatch either
+    template <typename T>
+    void reserve(int count)
+    {
+        get_channel<T>().pending.reserve(static_cast<size_t>(count));
+    }
+
+    // Delivers every queued event to the listeners of its type (once per frame)
+    void dispatch();
+
+    // Drops the queued events of every type
+    void clear();
+
+    // === EVENTS ===
+
+
+    // Events delivered by the last dispatch (for the diagnostics)
+    int get_last_dispatch_count() const { return last_dispatch_count; }
+
+
+private:
+
+    Event_bus() = default;
+
+    // Singleton - not copyable
+    Event_bus(const Event_bus&) = delete;
+    Event_bus& operator=(const Event_bus&) = delete;
+
+
+    struct Channel_base
+    {
+        virtual ~Channel_base() = default;
+
+        // Delivers the queued events, returns their count
+        virtual int dispatch() = 0;
+
+        virtual void clear() = 0;
+
+        virtual void unsubscribe_all(void* context) = 0;
+    };
+
+
+    template <typename T>
+    struct Channel final : Channel_base
+    {
+        struct Listener
+        {
+            void (*fn)(void* context, const T& event);
+            void* context;
+        };
+
+        std::vector<Listener> listeners;
+
+        // Emitted since the last dispatch, and the batch being delivered
+        std::vector<T> pending;
+        std::vector<T> delivering;
+
+        int dispatch() override
+        {
+            // The swap keeps both capacities - the events of the listeners go to pending
+            delivering.swap(pending);
+
+            // Listener by listener over the whole batch - one function and its data at a time
+            for (size_t l = 0; l < listeners.size(); ++l)
+                for (const T& event : delivering) listeners[l].fn(listeners[l].context, event);
+
+            const int count = static_cast<int>(delivering.size());
+            delivering.clear();
+
+            return count;
+        }
+
+        void clear() override { pending.clear(); }
+
+        void unsubscribe_all(void* context) override
+        {
+            for (size_t i = listeners.size(); i-- > 0;)
+                if (listeners[i].context == context) listeners.erase(listeners.begin() + static_cast<std::ptrdiff_t>(i));
+        }
+    };
+
+
+    template <typename T, typename C, void (C::*Method)(const T&)>
+    static void member_thunk(void* object, const T& event)
+    {
+        (static_cast<C*>(object)->*Method)(event);
+    }
+
+
+    // Channel of the type, created on the first use of the type
+    template <typename T>
+    Channel<T>& get_channel()
+    {
+        const size_t index = static_cast<size_t>(event_type::id<T>());
+
+        if (index >= channels.size()) channels.resize(index + 1);
+        if (!channels[index]) channels[index].reset(new Channel<T>());
+
+        return static_cast<Channel<T>&>(*channels[index]);
+    }
+
+
+    // By event_type::id()
+    std::vector<std::unique_ptr<Channel_base>> channels;
+
+    int last_dispatch_count = 0;
+};
+
+// =========================================================================================== EVENT BUS
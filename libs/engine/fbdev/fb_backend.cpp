@@ -0,0 +1,342 @@
+// fb_backend.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "fb_backend.h"
+#include "../blit/blit_kernels.h"
+#include "../engine_clock/engine_clock.h"
+
+#ifdef PLATFORM_LINUX
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/ioctl.h>
+    #include <sys/mman.h>
+    #include <linux/fb.h>
+#endif
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== FRAMEBUFFER BACKEND
+
+Fb_backend::~Fb_backend() { close(); }
+
+
+#ifdef PLATFORM_LINUX
+
+// Channel layout of the depth - RGB565 or ARGB8888, the formats of the surface
+static void set_rgb_layout(fb_var_screeninfo& var, std::uint32_t bits_per_pixel)
+{
+    var.bits_per_pixel = bits_per_pixel;
+
+    if (bits_per_pixel == 16)
+    {
+        var.red = {11, 5, 0};
+        var.green = {5, 6, 0};
+        var.blue = {0, 5, 0};
+        var.transp = {0, 0, 0};
+    }
+    else
+    {
+        var.red = {16, 8, 0};
+        var.green = {8, 8, 0};
+        var.blue = {0, 8, 0};
+        var.transp = {24, 8, 0};
+    }
+}
+
+
+bool Fb_backend::open(const char* device, int bits_per_pixel)
+{
+    if (fd >= 0) return true;
+
+    fd = ::open(device, O_RDWR);
+
+    if (fd < 0)
+    {
+        SDL_Log("Framebuffer %s can't be opened", device);
+        return false;
+    }
+
+    fb_var_screeninfo var = {};
+    fb_fix_screeninfo fix = {};
+
+    if (ioctl(fd, FBIOGET_VSCREENINFO, &var) != 0 || ioctl(fd, FBIOGET_FSCREENINFO, &fix) != 0)
+    {
+        SDL_Log("Framebuffer %s info query failed", device);
+        close();
+        return false;
+    }
+
+    saved_yres_virtual = var.yres_virtual;
+    saved_yoffset = var.yoffset;
+    saved_bits_per_pixel = var.bits_per_pixel;
+
+    // Another depth - the driver may refuse it
+    if ((bits_per_pixel == 16 || bits_per_pixel == 32) && var.bits_per_pixel != static_cast<std::uint32_t>(bits_per_pixel))
+    {
+        fb_var_screeninfo depth = var;
+        set_rgb_layout(depth, static_cast<std::uint32_t>(bits_per_pixel));
+
+        if (ioctl(fd, FBIOPUT_VSCREENINFO, &depth) == 0 && ioctl(fd, FBIOGET_VSCREENINFO, &var) == 0
+            && ioctl(fd, FBIOGET_FSCREENINFO, &fix) == 0 && var.bits_per_pixel == static_cast<std::uint32_t>(bits_per_pixel))
+        {
+            SDL_Log("Framebuffer %s: switched from %u to %d bpp", device, saved_bits_per_pixel, bits_per_pixel);
+        }
+        else
+        {
+            SDL_Log("Framebuffer %s: %d bpp refused, %u bpp is used", device, bits_per_pixel, var.bits_per_pixel);
+        }
+    }
+
+    Uint32 format = var.bits_per_pixel == 32 ? SDL_PIXELFORMAT_ARGB8888
+                  : var.bits_per_pixel == 16 ? SDL_PIXELFORMAT_RGB565
+                  : SDL_PIXELFORMAT_UNKNOWN;
+
+    if (format == SDL_PIXELFORMAT_UNKNOWN)
+    {
+        SDL_Log("Framebuffer %s: unsupported %u bpp", device, var.bits_per_pixel);
+        close();
+        return false;
+    }
+
+    // The pages for the flipping - as many as the driver allows, down to the single buffer
+    for (std::uint32_t pages = static_cast<std::uint32_t>(requested_pages); pages > 1 && var.yres_virtual < var.yres * pages; --pages)
+    {
+        fb_var_screeninfo paged = var;
+        paged.yres_virtual = var.yres * pages;
+
+        if (ioctl(fd, FBIOPUT_VSCREENINFO, &paged) == 0 && ioctl(fd, FBIOGET_VSCREENINFO, &var) == 0
+            && var.yres_virtual >= var.yres * pages) break;
+    }
+
+    width = static_cast<int>(var.xres);
+    height = static_cast<int>(var.yres);
+
+    page_size = static_cast<size_t>(fix.line_length) * var.yres;
+    memory_size = fix.smem_len;
+    physical_address = fix.smem_start;
+
+    page_count = 1;
+
+    while (page_count < requested_pages && var.yres_virtual >= var.yres * (page_count + 1)
+           && memory_size >= page_size * static_cast<size_t>(page_count + 1)) ++page_count;
+
+    // pixclock is the picosecond period of one pixel, the totals have the blanking in them
+    const double frame_pixels = static_cast<double>(var.xres + var.left_margin + var.right_margin + var.hsync_len)
+                              * static_cast<double>(var.yres + var.upper_margin + var.lower_margin + var.vsync_len);
+
+    refresh_rate = var.pixclock ? 1e12 / (static_cast<double>(var.pixclock) * frame_pixels) : 0.0;
+
+    if (refresh_rate < 20.0 || refresh_rate > 240.0) refresh_rate = 0.0;
+
+    void* mapped = mmap(nullptr, memory_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if (mapped == MAP_FAILED)
+    {
+        SDL_Log("Framebuffer %s mmap failed", device);
+        memory = nullptr;
+        close();
+        return false;
+    }
+
+    memory = static_cast<std::uint8_t*>(mapped);
+
+    // Start from page 0 on the screen, draw into the other
+    var.yoffset = 0;
+    ioctl(fd, FBIOPAN_DISPLAY, &var);
+
+    back_page = page_count > 1 ? 1 : 0;
+
+    surface = SDL_CreateRGBSurfaceWithFormatFrom(memory + page_size * back_page, width, height,
+                                                 static_cast<int>(var.bits_per_pixel),
+                                                 static_cast<int>(fix.line_length), format);
+
+    if (!surface)
+    {
+        SDL_Log("Framebuffer surface creation failed: %s", SDL_GetError());
+        close();
+        return false;
+    }
+
+    // The frame of the present pass - only if it isn't the page as it is
+    const int turns = present_turns & 3;
+    const int frame_w = present_w > 0 ? present_w : (turns & 1) ? height : width;
+    const int frame_h = present_h > 0 ? present_h : (turns & 1) ? width : height;
+    const Uint32 frame_format = present_format != SDL_PIXELFORMAT_UNKNOWN ? present_format : format;
+
+    if (turns != 0 || frame_w != width || frame_h != height || frame_format != format)
+    {
+        frame = SDL_CreateRGBSurfaceWithFormat(0, frame_w, frame_h, SDL_BITSPERPIXEL(frame_format), frame_format);
+
+        if (!frame)
+        {
+            SDL_Log("Framebuffer present frame creation failed: %s", SDL_GetError());
+            close();
+            return false;
+        }
+
+        SDL_Log("Framebuffer %s: present pass from %dx%d, %d degrees", device, frame_w, frame_h, turns * 90);
+    }
+
+    SDL_Log("Framebuffer %s: %dx%d, %u bpp, %d page(s), %.1f Hz", device, width, height, var.bits_per_pixel, page_count, refresh_rate);
+
+    return true;
+}
+
+
+void Fb_backend::close()
+{
+    if (frame) SDL_FreeSurface(frame);
+    frame = nullptr;
+
+    if (surface) SDL_FreeSurface(surface);
+    surface = nullptr;
+
+    if (memory) munmap(memory, memory_size);
+    memory = nullptr;
+
+    if (fd >= 0)
+    {
+        // Give the console its original mode back
+        fb_var_screeninfo var = {};
+
+        if (ioctl(fd, FBIOGET_VSCREENINFO, &var) == 0 && saved_yres_virtual != 0)
+        {
+            var.yres_virtual = saved_yres_virtual;
+            var.yoffset = saved_yoffset;
+
+            if (var.bits_per_pixel != saved_bits_per_pixel) set_rgb_layout(var, saved_bits_per_pixel);
+
+            ioctl(fd, FBIOPUT_VSCREENINFO, &var);
+        }
+
+        ::close(fd);
+    }
+
+    fd = -1;
+    physical_address = 0;
+    page_count = 1;
+    back_page = 0;
+    refresh_rate = 0.0;
+    vblank_time = 0;
+    flip_time = 0;
+}
+
+
+// Returns at the start of the vertical blank - its time is the phase of the scanout
+void Fb_backend::wait_vblank()
+{
+    std::uint32_t screen = 0;
+
+    if (ioctl(fd, FBIO_WAITFORVSYNC, &screen) == 0) vblank_time = Engine_clock::now();
+}
+
+
+void Fb_backend::flip()
+{
+    if (fd < 0) return;
+
+    // The whole page is written - before the wait, the pan shows it at the blank
+    if (frame)
+    {
+        blit_present(surface->pixels, surface->pitch, surface->format->format, width, height,
+                     frame->pixels, frame->pitch, frame->format->format, frame->w, frame->h, present_turns);
+    }
+
+    if (color_grade) blit_color_grade(surface->pixels, surface->pitch, surface->format->format, width, height, *color_grade);
+
+    // Two pages and less - the pan right after the blank, the drawn page is off the screen then
+    if (wait_vsync && page_count < 3) wait_vblank();
+
+    const Uint64 previous_flip = flip_time;
+
+    flip_time = Engine_clock::now();
+
+    if (page_count < 2) return;
+
+    fb_var_screeninfo var = {};
+
+    if (ioctl(fd, FBIOGET_VSCREENINFO, &var) != 0) return;
+
+    var.yoffset = static_cast<std::uint32_t>(height * back_page);
+
+    if (ioctl(fd, FBIOPAN_DISPLAY, &var) != 0) return;
+
+    // Three pages - the pan is queued, the driver shows it from the next blank. The next page
+    // is the oldest one: it left the screen at the blank after the previous pan, so the wait
+    // is needed only if the previous flip was less than a refresh ago.
+    if (wait_vsync && page_count == 3)
+    {
+        const double period = 1.0 / (refresh_rate > 0.0 ? refresh_rate : 60.0);
+
+        if (previous_flip != 0 && Engine_clock::to_seconds(flip_time - previous_flip) < period) wait_vblank();
+    }
+
+    // The shown page becomes the front one - the renderer moves to the next.
+    // The software renderer reads the pixels pointer on every draw call.
+    back_page = (back_page + 1) % page_count;
+    surface->pixels = memory + page_size * back_page;
+}
+
+#else
+
+bool Fb_backend::open(const char* device, int)
+{
+    SDL_Log("Framebuffer %s: the framebuffer backend is available only on Linux", device);
+    return false;
+}
+
+void Fb_backend::close() {}
+
+void Fb_backend::flip() {}
+
+#endif
+
+
+bool Fb_backend::is_open() const { return fd >= 0; }
+
+
+void Fb_backend::set_present_pass(int quarter_turns, int w, int h, Uint32 format)
+{
+    present_turns = quarter_turns & 3;
+    present_w = w;
+    present_h = h;
+    present_format = format;
+}
+
+
+SDL_Surface* Fb_backend::get_surface() const { return frame ? frame : surface; }
+
+
+std::uint64_t Fb_backend::get_physical_address() const
+{
+    // The frame of the present pass is the process memory
+    if (frame || !physical_address) return 0;
+
+    return physical_address + page_size * static_cast<size_t>(back_page);
+}
+
+
+void Fb_backend::set_wait_vsync(bool wait) { wait_vsync = wait; }
+
+
+bool Fb_backend::is_double_buffered() const { return page_count > 1; }
+
+
+int Fb_backend::get_page_count() const { return page_count; }
+
+
+double Fb_backend::get_refresh_rate() const { return refresh_rate; }
+
+
+void Fb_backend::set_page_count(int pages) { requested_pages = pages < 1 ? 1 : pages > 3 ? 3 : pages; }
+
+
+int Fb_backend::get_width() const { return width; }
+
+
+int Fb_backend::get_height() const { return height; }
+
+// =========================================================================================== FRAMEBUFFER BACKEND
@@ -0,0 +1,194 @@
+// fb_backend.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+
+#include "../platform/platform.h"
+
+struct Color_grade;
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== FRAMEBUFFER BACKEND
+
+
+/**
+ * @brief Native Linux framebuffer (/dev/fb0) output with the page flipping.
+ *
+ * The framebuffer memory is mmap-ed and wrapped into an SDL_Surface, the engine
+ * draws into it with the SDL software renderer - the same SDL_Renderer interface
+ * for the states, but without the copy of the SDL video driver. With two pages in
+ * the virtual resolution the renderer draws into the back page, and flip() shows it
+ * by FBIOPAN_DISPLAY and moves the surface to the other page, so there is no
+ * tearing. With one page it draws into the visible memory directly.
+ *
+ * The swap chain depth is set by set_page_count(): two pages wait for the blank before
+ * every pan - the lowest latency, but a late frame waits a whole refresh. Three pages
+ * queue the pan at once and draw on into the third one - the cycle blocks only when
+ * two flips come within one refresh, for about a refresh more of the latency.
+ *
+ * Used in the full redraw mode only: the back page content is two frames old.
+ * Available only on Linux, open() fails elsewhere.
+ *
+ * A panel mounted turned relative to the logical screen, a logical resolution other than
+ * the panel one or the 16-bit drawing on a 32-bit panel (set_present_pass()): the renderer
+ * draws into a frame of its own, and flip() turns, scales and converts it into the page
+ * in one pass (blit_present()) - no extra full-screen copy. The color grade of the frame
+ * (set_color_grade()) is the last pass over the page before it is shown.
+ *
+ * Usage (done by SDL_app_init, if sdl_app_ctx::use_framebuffer is set):
+ * @code
+ * if (fb.open("/dev/fb0")) renderer = SDL_CreateSoftwareRenderer(fb.get_surface());
+ * // ... frame: draw, SDL_RenderPresent(renderer), fb.flip();
+ * @endcode
+ */
+class Fb_backend
+{
+
+public:
+
+    // Native video part of the platform backend (platform/backend.h)
+    static constexpr bool NATIVE = true;
+
+
+    Fb_backend() = default;
+
+    // Restores the display and unmaps the memory
+    ~Fb_backend();
+
+    // Copying the device owner is not allowed
+    Fb_backend(const Fb_backend&) = delete;
+    Fb_backend& operator=(const Fb_backend&) = delete;
+
+
+    /**
+     * @brief Opens and maps the framebuffer device.
+     *
+     * Requests the virtual resolution of set_page_count() pages for the page flipping,
+     * falls back to fewer pages (the single buffer at last) if the driver refuses it.
+     *
+     * @param device Device path.
+     * @param bits_per_pixel 16 (RGB565) or 32 (ARGB8888) - requested from the driver, the
+     *                       device mode is kept if it refuses; 0 - the device mode as it is.
+     * @return true on success; false if the device can't be used (16 and 32 bpp are supported).
+     */
+    bool open(const char* device = "/dev/fb0", int bits_per_pixel = 0);
+
+    // Restores the original mode and releases the device
+    void close();
+
+
+    /**
+     * @brief Draws into a frame apart, which flip() presents turned, scaled and converted.
+     *
+     * Call before open(). The frame is used only if it differs from the panel - otherwise
+     * the renderer draws into the page as without the pass.
+     *
+     * @param quarter_turns Clockwise turns of the image on the panel, 0 to 3 (the upside down panel - 2).
+     * @param w, h Size of the frame, 0 - the panel size (turned).
+     * @param format SDL_PIXELFORMAT_ARGB8888 or SDL_PIXELFORMAT_RGB565, SDL_PIXELFORMAT_UNKNOWN - the panel one.
+     */
+    void set_present_pass(int quarter_turns, int w = 0, int h = 0, Uint32 format = SDL_PIXELFORMAT_UNKNOWN);
+
+    // Swap chain depth requested by open(): 1 to 3 pages, 2 by default
+    void set_page_count(int pages);
+
+    // Grade of the next flips, applied to the page before the pan (blit_color_grade()), nullptr - none.
+    // The grade is kept by the caller.
+    void set_color_grade(const Color_grade* grade) { color_grade = grade; }
+
+    // true if the device is opened
+    bool is_open() const;
+
+
+    // Surface to draw into - the page or the frame of the present pass (owned by the backend)
+    SDL_Surface* get_surface() const;
+
+    // Physical address of the surface pixels (the hardware blitter destination), 0 - unknown
+    std::uint64_t get_physical_address() const;
+
+    /**
+     * @brief Shows the drawn page and switches the surface to the other one.
+     *
+     * Call after SDL_RenderPresent(), so the software renderer has flushed its commands.
+     */
+    void flip();
+
+    // Waits for the vertical blank before the pan (if the driver supports FBIO_WAITFORVSYNC)
+    void set_wait_vsync(bool wait);
+
+
+    // true if the page flipping is used
+    bool is_double_buffered() const;
+
+    // Pages of the swap chain, which the driver gave
+    int get_page_count() const;
+
+    // Refresh rate from the mode timings in Hz, 0 - the driver doesn't report them
+    double get_refresh_rate() const;
+
+    // Engine_clock counter of the last vertical blank, which flip() waited for, 0 - none yet
+    Uint64 get_vblank_time() const { return vblank_time; }
+
+    // Engine_clock counter of the last pan of flip() - the page is scanned out from the next blank
+    Uint64 get_flip_time() const { return flip_time; }
+
+    int get_width() const;
+    int get_height() const;
+
+
+private:
+
+#ifdef PLATFORM_LINUX
+    void wait_vblank();
+#endif
+
+    int fd = -1;
+
+    std::uint8_t* memory = nullptr;
+    size_t memory_size = 0;
+
+    // Size of one page in bytes
+    size_t page_size = 0;
+
+    // Physical address of the memory (fb_fix_screeninfo::smem_start)
+    std::uint64_t physical_address = 0;
+
+    int width = 0;
+    int height = 0;
+
+    int page_count = 1;
+    int requested_pages = 2;
+
+    // Page currently drawn into (the others are on the screen or queued for it)
+    int back_page = 0;
+
+    double refresh_rate = 0.0;
+
+    Uint64 vblank_time = 0;
+    Uint64 flip_time = 0;
+
+    bool wait_vsync = true;
+
+    SDL_Surface* surface = nullptr;
+
+    // Present pass: the drawn frame (nullptr - the renderer draws into the page) and its settings
+    SDL_Surface* frame = nullptr;
+    int present_turns = 0;
+    int present_w = 0;
+    int present_h = 0;
+    Uint32 present_format = SDL_PIXELFORMAT_UNKNOWN;
+
+    const Color_grade* color_grade = nullptr;
+
+    // Original virtual resolution, offset and depth, restored by close()
+    std::uint32_t saved_yres_virtual = 0;
+    std::uint32_t saved_yoffset = 0;
+    std::uint32_t saved_bits_per_pixel = 0;
+};
+
+// =========================================================================================== FRAMEBUFFER BACKEND
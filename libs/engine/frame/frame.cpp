@@ -0,0 +1,416 @@
+// frame.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "frame.h"
+#include "../render_stats/render_stats.h"
+
+#include <algorithm>
+#include <cmath>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== FRAME
+
+Frame& Frame::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Frame instance;
+
+    return instance;
+}
+
+
+bool Frame::begin(SDL_Renderer* r, bool always_redraw)
+{
+    ++index;
+
+    bool partial_damage = partial_window && (damage_count > 0 || overflow);
+
+    // Nothing changed on the screen - skip the whole render pass
+    if (!always_redraw && !dirty && !partial_damage)
+    {
+        ++skipped;
+        return false;
+    }
+
+    renderer = r;
+    flushed = false;
+
+    if (partial_window)
+    {
+        int w = 0, h = 0;
+        SDL_GetRendererOutputSize(renderer, &w, &h);
+
+        // Full damage: everything is redrawn as a single region
+        if (always_redraw || dirty)
+        {
+            passes[0] = {0, 0, w, h};
+            pass_count = 1;
+        }
+        else build_passes(w, h);
+
+        damage_count = 0;
+        overflow = false;
+        dirty = false;
+
+        // The whole damage is outside of the screen
+        if (pass_count == 0)
+        {
+            renderer = nullptr;
+            ++skipped;
+            return false;
+        }
+
+        start_pass(0);
+        return true;
+    }
+
+    dirty = false; // Marks made during this render belong to the next frame
+
+    // The states draw at the logical resolution, end() scales it to the output (the target scale is restored too)
+    if (logical_target) Render::set_target(renderer, logical_target);
+
+    SDL_SetRenderDrawColor(renderer, clear_color.r, clear_color.g, clear_color.b, clear_color.a);
+    Render::clear(renderer);
+
+    return true;
+}
+
+
+bool Frame::next_pass()
+{
+    if (!partial_window || !renderer) return false;
+
+    if (pass_index + 1 >= pass_count)
+    {
+        SDL_RenderSetClipRect(renderer, nullptr);
+        return false;
+    }
+
+    start_pass(pass_index + 1);
+    return true;
+}
+
+
+void Frame::flush()
+{
+    if (!renderer || partial_window || flushed) return;
+
+    if (logical_target) present_logical();
+
+    SDL_RenderFlush(renderer);
+
+    flushed = true;
+}
+
+
+void Frame::end()
+{
+    if (!renderer) return;
+
+    if (partial_window)
+    {
+        // Finish the drawing into the surface, then copy only the damaged regions
+        SDL_RenderSetClipRect(renderer, nullptr);
+        SDL_RenderFlush(renderer);
+
+        SDL_UpdateWindowSurfaceRects(partial_window, passes, pass_count);
+    }
+    else
+    {
+        flush();
+
+        SDL_RenderPresent(renderer);
+
+        if (present_hook) present_hook(present_user);
+    }
+
+    ++presented;
+    renderer = nullptr;
+}
+
+
+void Frame::set_present_hook(void (*hook)(void* user), void* user)
+{
+    present_hook = hook;
+    present_user = user;
+}
+
+
+void Frame::set_color_grade(const Color_grade* grade)
+{
+    if (grade == color_grade) return;
+
+    color_grade = grade;
+    mark_dirty();
+}
+
+
+void Frame::set_partial_redraw(SDL_Window* window)
+{
+    partial_window = window;
+    damage_count = 0;
+    overflow = false;
+    dirty = true;
+}
+
+
+bool Frame::is_partial_redraw() const { return partial_window != nullptr; }
+
+
+void Frame::add_damage(const SDL_Rect& rect)
+{
+    if (!partial_window) { dirty = true; return; }
+
+    if (rect.w <= 0 || rect.h <= 0) return;
+
+    if (damage_count < MAX_DAMAGE_RECTS)
+    {
+        damage[damage_count++] = rect;
+        return;
+    }
+
+    // Too many regions - keep only their common bounds
+    if (overflow) SDL_UnionRect(&overflow_bounds, &rect, &overflow_bounds);
+    else overflow_bounds = rect;
+
+    overflow = true;
+}
+
+
+const SDL_Rect* Frame::get_damage_rects() const { return passes; }
+
+
+int Frame::get_damage_rect_count() const { return renderer ? pass_count : 0; }
+
+
+// Greedy merge: two regions are merged if their union costs not much more pixels
+// than both of them separately (overlapping or adjacent, like the old and new
+// bounds of a moving sprite). If more than MAX_PASSES regions are left, or the
+// damage covers most of the screen, a single bounding region is cheaper.
+
+void Frame::build_passes(int out_w, int out_h)
+{
+    SDL_Rect work[MAX_DAMAGE_RECTS + 1];
+    int n = 0;
+
+    const SDL_Rect screen = {0, 0, out_w, out_h};
+
+    // Clip to the screen, drop the invisible ones
+    for (int i = 0; i < damage_count; ++i)
+        if (SDL_IntersectRect(&damage[i], &screen, &work[n])) ++n;
+
+    if (overflow && SDL_IntersectRect(&overflow_bounds, &screen, &work[n])) ++n;
+
+    auto area = [](const SDL_Rect& r) { return static_cast<long>(r.w) * r.h; };
+
+    bool merged = true;
+
+    while (merged && n > 1)
+    {
+        merged = false;
+
+        for (int i = 0; i < n && !merged; ++i)
+        {
+            for (int j = i + 1; j < n; ++j)
+            {
+                SDL_Rect u;
+                SDL_UnionRect(&work[i], &work[j], &u);
+
+                // Up to 25% of the extra pixels is cheaper than an extra pass
+                if (area(u) * 4 <= (area(work[i]) + area(work[j])) * 5)
+                {
+                    work[i] = u;
+                    work[j] = work[--n];
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    long total = 0;
+    for (int i = 0; i < n; ++i) total += area(work[i]);
+
+    // Too fragmented or too big - one bounding region
+    if (n > MAX_PASSES || total * 5 > area(screen) * 3)
+    {
+        for (int i = 1; i < n; ++i) SDL_UnionRect(&work[0], &work[i], &work[0]);
+        n = n > 0 ? 1 : 0;
+    }
+
+    for (int i = 0; i < n; ++i) passes[i] = work[i];
+
+    pass_count = n;
+}
+
+
+void Frame::start_pass(int pass)
+{
+    pass_index = pass;
+
+    SDL_RenderSetClipRect(renderer, &passes[pass]);
+
+    SDL_SetRenderDrawColor(renderer, clear_color.r, clear_color.g, clear_color.b, clear_color.a);
+    Render::fill_rect(renderer, &passes[pass]);
+}
+
+
+// === LOGICAL RESOLUTION ===
+
+bool Frame::set_logical_size(SDL_Renderer* r, int w, int h, bool integer_scale)
+{
+    release_logical_target();
+
+    logical_w = w > 0 && h > 0 ? w : 0;
+    logical_h = w > 0 && h > 0 ? h : 0;
+    logical_integer = integer_scale;
+
+    dirty = true;
+
+    if (!r) return false;
+
+    // Back to the output scale - the fallback below could have set it before
+    SDL_RenderSetLogicalSize(r, 0, 0);
+
+    if (logical_w == 0) return true;
+
+    int out_w = 0, out_h = 0;
+    SDL_GetRendererOutputSize(r, &out_w, &out_h);
+
+    logical_viewport = {0, 0, out_w, out_h};
+
+    // The device at the full scale - the output is the logical size, nothing to scale
+    if (out_w == logical_w && out_h == logical_h && render_scale >= 1.0f) return true;
+
+    if (SDL_RenderTargetSupported(r) && create_logical_target(r)) return true;
+
+    // No targets - the renderer scales every draw call instead
+    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");
+
+    const bool ok = SDL_RenderSetLogicalSize(r, logical_w, logical_h) == 0;
+
+    if (ok) SDL_RenderSetIntegerScale(r, integer_scale ? SDL_TRUE : SDL_FALSE);
+
+    return ok;
+}
+
+
+bool Frame::create_logical_target(SDL_Renderer* r)
+{
+    const int w = std::max(1, static_cast<int>(std::lround(logical_w * render_scale)));
+    const int h = std::max(1, static_cast<int>(std::lround(logical_h * render_scale)));
+
+    logical_target = SDL_CreateTexture(r, target_format, SDL_TEXTUREACCESS_TARGET, w, h);
+
+    if (!logical_target)
+    {
+        SDL_Log("Logical target creation failed: %s", SDL_GetError());
+        return false;
+    }
+
+    // Sharp pixels at the logical size, a softer image than the blocks from a reduced one
+    SDL_SetTextureScaleMode(logical_target, render_scale < 1.0f ? SDL_ScaleModeLinear : SDL_ScaleModeNearest);
+
+    return true;
+}
+
+
+bool Frame::set_render_scale(SDL_Renderer* r, float scale)
+{
+    scale = std::clamp(scale, 0.25f, 1.0f);
+
+    if (scale == render_scale) return true;
+
+    render_scale = scale;
+
+    // Only the logical resolution drawn into a target scales
+    if (!r || logical_w == 0 || partial_window || !SDL_RenderTargetSupported(r)) return false;
+
+    return set_logical_size(r, logical_w, logical_h, logical_integer) && (logical_target || render_scale >= 1.0f);
+}
+
+
+void Frame::restore_target_scale(SDL_Renderer* r)
+{
+    // The logical units over the reduced target - SDL scales every draw down
+    if (logical_target && render_scale < 1.0f) SDL_RenderSetLogicalSize(r, logical_w, logical_h);
+}
+
+
+void Frame::release_logical_target()
+{
+    if (logical_target) SDL_DestroyTexture(logical_target);
+
+    logical_target = nullptr;
+}
+
+
+void Frame::get_logical_size(int& w, int& h) const
+{
+    w = logical_w;
+    h = logical_h;
+}
+
+
+SDL_Rect Frame::get_logical_viewport() const { return logical_viewport; }
+
+
+void Frame::present_logical()
+{
+    Render::set_target(renderer, nullptr);
+
+    int out_w = 0, out_h = 0;
+    SDL_GetRendererOutputSize(renderer, &out_w, &out_h);
+
+    // Largest scale, which fits - an integer one (at least 1:1) for the sharp pixels
+    double scale = std::min(static_cast<double>(out_w) / logical_w, static_cast<double>(out_h) / logical_h);
+
+    if (logical_integer) scale = scale >= 1.0 ? static_cast<int>(scale) : scale;
+
+    const int w = static_cast<int>(logical_w * scale);
+    const int h = static_cast<int>(logical_h * scale);
+
+    logical_viewport = {(out_w - w) / 2, (out_h - h) / 2, w, h};
+
+    // Border - only if the image doesn't cover the output
+    if (w < out_w || h < out_h)
+    {
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+        Render::clear(renderer);
+    }
+
+    Render::copy(renderer, logical_target, nullptr, &logical_viewport);
+}
+
+// === LOGICAL RESOLUTION ===
+
+
+void Frame::mark_dirty() { dirty = true; }
+
+
+bool Frame::is_dirty() const { return dirty; }
+
+
+bool Frame::has_pending_changes() const { return dirty || (partial_window && (damage_count > 0 || overflow)); }
+
+
+void Frame::set_clear_color(Uint8 r, Uint8 g, Uint8 b, Uint8 a)
+{
+    clear_color = {r, g, b, a};
+    dirty = true;
+}
+
+
+Uint64 Frame::get_index() const { return index; }
+
+Uint64 Frame::get_presented_count() const { return presented; }
+
+Uint64 Frame::get_skipped_count() const { return skipped; }
+
+SDL_Renderer* Frame::get_renderer() const { return renderer; }
+
+// =========================================================================================== FRAME
@@ -0,0 +1,317 @@
+// frame.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include "../platform/platform.h"
+
+struct Color_grade;
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== FRAME
+
+
+/**
+ * @brief Engine-owned render pass of a single frame with the damage tracking.
+ *
+ * The application cycle owns the whole render pass: begin() clears the target,
+ * the states draw, end() presents. States never clear or present themselves.
+ *
+ * Damage tracking: states, which opted in (State::tracks_damage), call
+ * mark_dirty() when their visuals change. If nothing was marked since the last
+ * presented frame, begin() returns false and the engine skips clear, render
+ * and present completely - the previous image simply stays on the screen.
+ * States which do not track damage are redrawn every frame as before.
+ *
+ * Partial redraw mode (software / fbdev path, see set_partial_redraw()):
+ * the render target is the persistent window surface, so the pixels outside of
+ * the damaged areas stay valid between the frames. States report the rectangles
+ * they touch with add_damage() (for a moving object - its old and new bounds),
+ * the engine merges them, and only those regions are cleared, recomposed (the state
+ * render runs once per region with the clip rect set) and copied to the screen
+ * by SDL_UpdateWindowSurfaceRects(). mark_dirty() is still a full-screen redraw.
+ *
+ * Logical resolution (full redraw mode, see set_logical_size()): the states draw into
+ * a fixed size target texture - the device resolution on every build - and end()
+ * copies it to the output with the nearest filtering, scaled by an integer factor
+ * (the rest is a black border). If the output is the logical size already (the device),
+ * there is no target and no copy - the states draw into the output directly.
+ *
+ * Dynamic resolution (see set_render_scale()): the logical target is a fraction of the
+ * logical size, the states still draw in the logical units (the SDL logical size of the
+ * target scales them down) and end() upscales it with the linear filtering - a softer
+ * image for less fill. At the full scale it is the logical resolution above.
+ *
+ * Singleton, like Lang_state, so the state callbacks can reach it without any context.
+ *
+ * Usage:
+ * @code
+ * Frame::Instance().mark_dirty(); // "My visuals changed - redraw me"
+ * @endcode
+ */
+class Frame
+{
+
+public:
+
+    // Returns the singleton instance.
+    static Frame& Instance();
+
+
+    /**
+     * @brief Starts the render pass of the frame.
+     *
+     * @param renderer Renderer to draw with.
+     * @param always_redraw true if the visible state doesn't track its damage.
+     * @return true if the frame must be rendered (target is already cleared),
+     *         false if nothing changed and the frame is skipped.
+     */
+    bool begin(SDL_Renderer* renderer, bool always_redraw);
+
+    /**
+     * @brief Moves to the next damaged region of the partial redraw.
+     *
+     * The engine renders the states once per region:
+     *
+     * if (frame.begin(r, always)) { do { render(); } while (frame.next_pass()); frame.end(); }
+     *
+     * @return true if there is one more region to render (clip rect is set and cleared),
+     *         false if the frame is complete (always false in the full redraw mode).
+     */
+    bool next_pass();
+
+    /**
+     * @brief Finishes the drawing of the frame: the logical target is copied to the output
+     *        and the queued draws are flushed - the fill time of the frame ends here.
+     *
+     * Optional, end() does it if it wasn't called. Full redraw mode only.
+     */
+    void flush();
+
+    // Ends the render pass started by begin() and presents it.
+    void end();
+
+
+    /**
+     * @brief Enables the dirty-rectangle mode.
+     *
+     * The renderer must be a software renderer over the window surface
+     * (SDL_CreateSoftwareRenderer(SDL_GetWindowSurface(window))) - it keeps its
+     * pixels between the frames, and we present only the damaged regions.
+     *
+     * @param window Window of the surface, nullptr to disable the partial redraw.
+     */
+    void set_partial_redraw(SDL_Window* window);
+
+    // true if the dirty-rectangle mode is enabled
+    bool is_partial_redraw() const;
+
+    /**
+     * @brief Sets the function called by end() right after SDL_RenderPresent (full redraw mode).
+     *
+     * Lets an output backend, which the renderer doesn't know about, show the frame
+     * (the framebuffer page flip).
+     *
+     * @param hook Present function, nullptr to remove it.
+     * @param user Pointer passed to the hook.
+     */
+    void set_present_hook(void (*hook)(void* user), void* user);
+
+    /**
+     * @brief Reports a screen region changed by the state (partial redraw mode).
+     *
+     * In the full redraw mode it's the same as mark_dirty().
+     *
+     * @param rect Changed region in the screen coordinates.
+     */
+    void add_damage(const SDL_Rect& rect);
+
+    // Regions of the current frame after the merge (valid between begin() and end())
+    const SDL_Rect* get_damage_rects() const;
+    int get_damage_rect_count() const;
+
+
+    // Marks the screen content as changed - the next frame will be redrawn.
+    void mark_dirty();
+
+    // Checks if the next frame will be redrawn.
+    bool is_dirty() const;
+
+    // Checks if anything waits to be drawn: the full redraw or the partial damage
+    bool has_pending_changes() const;
+
+
+    // Clear color of the render pass
+    void set_clear_color(Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+
+
+    /**
+     * @brief Enables the logical resolution of the render pass (full redraw mode).
+     *
+     * Without the render target support the SDL logical size (SDL_RenderSetLogicalSize)
+     * does the scaling instead - the fill cost is the output one then.
+     *
+     * @param renderer      Renderer of the frames.
+     * @param w, h          Logical resolution, 0 - disables the mode.
+     * @param integer_scale Integer factor only (else the largest fitting scale).
+     * @return false if the target can't be created - the output is drawn directly.
+     */
+    bool set_logical_size(SDL_Renderer* renderer, int w, int h, bool integer_scale = true);
+
+    // Releases the logical target (before the renderer is destroyed)
+    void release_logical_target();
+
+    // Size the states draw at: the logical one, or 0 x 0 if the mode is off
+    void get_logical_size(int& w, int& h) const;
+
+    // Output rectangle of the logical image in the last presented frame
+    SDL_Rect get_logical_viewport() const;
+
+
+    /**
+     * @brief Scale of the logical target - the dynamic resolution (Resolution_scaler).
+     *
+     * The target is recreated at the logical size times the scale; below 1 it exists on the
+     * device too, and the upscale to the output filters linearly. No effect without the
+     * logical resolution or without the render target support. Outside of the render pass.
+     *
+     * @param renderer Renderer of the frames.
+     * @param scale    Share of the logical size, 0.25 - 1.
+     * @return false if the scaled target can't be created - the logical resolution is drawn.
+     */
+    bool set_render_scale(SDL_Renderer* renderer, float scale);
+
+    float get_render_scale() const { return render_scale; }
+
+    // Logical target of the frames (nullptr - the output is drawn directly)
+    SDL_Texture* get_logical_target() const { return logical_target; }
+
+    /**
+     * @brief Scales the logical units to the logical target again - SDL resets the scale on
+     *        every target switch (Render::set_target() calls it, when the target is this one).
+     */
+    void restore_target_scale(SDL_Renderer* renderer);
+
+
+    /**
+     * @brief Pixel format of the opaque full-screen targets of the engine.
+     *
+     * The logical target, the overlay backdrop and the transition frame. RGB565 with the
+     * 16-bit screen of the software renderer - the whole pipeline moves half the bytes and
+     * the copies to the screen don't convert (sdl_app_ctx::rgb565_backbuffer). The targets,
+     * which need the alpha (the layers, the cached shapes, the widgets), stay ARGB8888.
+     * Set before set_logical_size(); ARGB8888 by default.
+     */
+    void set_target_format(Uint32 format) { target_format = format; }
+
+    Uint32 get_target_format() const { return target_format; }
+
+
+    /**
+     * @brief Color grade of the presented frames (Color_grade), nullptr - none.
+     *
+     * The swap is a pointer store - the grades of the themes and the effects are built
+     * once and kept by the caller. A new grade redraws the frame; a grade changed in place
+     * (a fading flash) needs mark_dirty(). Applied by the framebuffer output at the flip,
+     * the SDL renderer output shows the frames ungraded.
+     */
+    void set_color_grade(const Color_grade* grade);
+
+    const Color_grade* get_color_grade() const { return color_grade; }
+
+
+    // Index of the current frame (incremented on every begin() call)
+    Uint64 get_index() const;
+
+    // Number of the presented frames
+    Uint64 get_presented_count() const;
+
+    // Number of the frames skipped by the damage tracking
+    Uint64 get_skipped_count() const;
+
+    // Renderer of the running render pass (nullptr outside of begin()/end())
+    SDL_Renderer* get_renderer() const;
+
+
+private:
+
+    // Private constructor - the first frame is always dirty.
+    Frame() = default;
+
+    // Copying the singleton is not allowed
+    Frame(const Frame&) = delete;
+    Frame& operator=(const Frame&) = delete;
+
+
+    // Max number of the reported regions per frame - the rest collapse into the bounds
+    static constexpr int MAX_DAMAGE_RECTS = 32;
+
+    // Max number of the render passes per frame after the merge
+    static constexpr int MAX_PASSES = 8;
+
+
+    SDL_Renderer* renderer = nullptr;
+
+    bool dirty = true;
+
+    // Partial redraw window (nullptr - full redraw mode)
+    SDL_Window* partial_window = nullptr;
+
+    // Reported damage of the next frame
+    SDL_Rect damage[MAX_DAMAGE_RECTS];
+    int damage_count = 0;
+
+    // Bounds of all of the damage, reported above the MAX_DAMAGE_RECTS limit
+    SDL_Rect overflow_bounds = {0, 0, 0, 0};
+    bool overflow = false;
+
+    // Merged regions of the running frame and the current pass index
+    SDL_Rect passes[MAX_PASSES];
+    int pass_count = 0;
+    int pass_index = 0;
+
+
+    // Merges the reported damage into the render passes (bounded by the output size)
+    void build_passes(int out_w, int out_h);
+
+    // Sets the clip rect of the pass and clears the region
+    void start_pass(int index);
+
+    // Copies the logical target to the output (end())
+    void present_logical();
+
+    // Creates the logical target of the scale - nothing at the full scale, if the output is the logical size
+    bool create_logical_target(SDL_Renderer* renderer);
+
+    SDL_Color clear_color = {0, 0, 0, 255};
+
+    // Output backend present function (see set_present_hook())
+    void (*present_hook)(void* user) = nullptr;
+    void* present_user = nullptr;
+
+    // Logical resolution target (nullptr - the output is drawn directly)
+    SDL_Texture* logical_target = nullptr;
+    int logical_w = 0;
+    int logical_h = 0;
+    bool logical_integer = true;
+
+    // Dynamic resolution - the logical target is smaller than the logical size below 1
+    float render_scale = 1.0f;
+
+    // flush() was done in the running frame
+    bool flushed = false;
+
+    Uint32 target_format = SDL_PIXELFORMAT_ARGB8888;
+
+    const Color_grade* color_grade = nullptr;
+    SDL_Rect logical_viewport = {0, 0, 0, 0};
+
+    Uint64 index = 0;
+    Uint64 presented = 0;
+    Uint64 skipped = 0;
+};
+
+// =========================================================================================== FRAME
@@ -0,0 +1,188 @@
+// frame_arena.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "frame_arena.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== LINEAR ARENA
+
+namespace
+{
+    // Blocks in whole pages
+    constexpr size_t BLOCK_ROUNDING = 4096;
+
+    size_t round_up(size_t value, size_t multiple) { return (value + multiple - 1) / multiple * multiple; }
+}
+
+
+Linear_arena::Linear_arena(size_t capacity) { reserve(capacity); }
+
+
+Linear_arena::~Linear_arena()
+{
+    reset();
+    std::free(block);
+}
+
+
+void Linear_arena::reserve(size_t bytes)
+{
+    reset();
+
+    std::free(block);
+
+    capacity = bytes ? round_up(bytes, BLOCK_ROUNDING) : 0;
+    block = capacity ? static_cast<unsigned char*>(std::malloc(capacity)) : nullptr;
+
+    if (!block) capacity = 0;
+}
+
+
+void* Linear_arena::allocate(size_t size, size_t align)
+{
+    if (size == 0) size = 1;
+
+    const std::uintptr_t base = reinterpret_cast<std::uintptr_t>(block);
+
+    size_t current = offset.load(std::memory_order_relaxed);
+
+    while (block)
+    {
+        const size_t start = static_cast<size_t>(((base + current + align - 1) & ~std::uintptr_t(align - 1)) - base);
+        const size_t end = start + size;
+
+        if (end > capacity) break;
+
+        if (offset.compare_exchange_weak(current, end, std::memory_order_relaxed)) return block + start;
+    }
+
+    // Over the capacity - the heap until the reset, which grows the block
+    const size_t padded = size + align - 1;
+
+    void* p = std::malloc(padded);
+
+    if (!p) throw std::bad_alloc();
+
+    std::lock_guard<std::mutex> lock(overflow_mutex);
+
+    overflow.push_back(p);
+    overflow_bytes += padded;
+    ++overflow_total;
+
+    const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(p);
+
+    return reinterpret_cast<void*>((address + align - 1) & ~std::uintptr_t(align - 1));
+}
+
+
+void Linear_arena::release(void* p, size_t size)
+{
+    unsigned char* bytes = static_cast<unsigned char*>(p);
+
+    if (!block || bytes < block || bytes >= block + capacity) return;
+
+    const size_t start = static_cast<size_t>(bytes - block);
+    size_t end = start + (size ? size : 1);
+
+    // Only the newest - an older one would free the allocations after it
+    offset.compare_exchange_strong(end, start, std::memory_order_relaxed);
+}
+
+
+void Linear_arena::reset()
+{
+    const size_t used = offset.exchange(0, std::memory_order_relaxed) + overflow_bytes;
+
+    peak = std::max(peak, used);
+
+    if (overflow.empty()) return;
+
+    for (void* p : overflow) std::free(p);
+
+    overflow.clear();
+    overflow_bytes = 0;
+
+    // The next frame of this size fits the block
+    std::free(block);
+
+    capacity = round_up(peak, BLOCK_ROUNDING);
+    block = static_cast<unsigned char*>(std::malloc(capacity));
+
+    if (!block) capacity = 0;
+}
+
+// =========================================================================================== LINEAR ARENA
+
+
+// =========================================================================================== FRAME ARENA
+
+Frame_arena& Frame_arena::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Frame_arena instance;
+    return instance;
+}
+
+
+void Frame_arena::reserve(size_t frame_bytes, size_t buffered_bytes)
+{
+    frame.reserve(frame_bytes);
+    buffered[0].reserve(buffered_bytes);
+    buffered[1].reserve(buffered_bytes);
+}
+
+
+void Frame_arena::begin_frame()
+{
+    frame.reset();
+
+    // The other one keeps the data of the previous frame for this one
+    current = 1 - current;
+    buffered[current].reset();
+}
+
+
+const char* Frame_arena::format(const char* fmt, ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    const int length = std::vsnprintf(nullptr, 0, fmt, args);
+    va_end(args);
+
+    if (length < 0) return "";
+
+    char* text = static_cast<char*>(frame.allocate(static_cast<size_t>(length) + 1, 1));
+
+    va_start(args, fmt);
+    std::vsnprintf(text, static_cast<size_t>(length) + 1, fmt, args);
+    va_end(args);
+
+    return text;
+}
+
+
+void Frame_arena::dump(std::ostream& out) const
+{
+    const Linear_arena* arenas[] = { &frame, &buffered[0], &buffered[1] };
+    const char* names[] = { "frame", "buffered 0", "buffered 1" };
+
+    out << "Frame arena (KB: capacity, peak; heap overflows):\n";
+
+    for (int i = 0; i < 3; ++i)
+    {
+        out << "  " << names[i] << ": " << arenas[i]->get_capacity() / 1024 << ", " << (arenas[i]->get_peak() + 1023) / 1024
+            << "; " << arenas[i]->get_overflow_count() << "\n";
+    }
+}
+
+// =========================================================================================== FRAME ARENA
@@ -0,0 +1,238 @@
+// frame_arena.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== LINEAR ARENA
+
+
+/**
+ * @brief Bump allocator over one preallocated block, freed all at once by reset().
+ *
+ * An allocation is an aligned move of the offset - no free list, no locking, nothing
+ * to fragment. Freeing single allocations does nothing, except for the newest one
+ * (a growing vector gives its last buffer back). The offset is atomic, so the update
+ * worker and the main thread can both allocate during the frame.
+ *
+ * A frame over the capacity doesn't fail: the rest goes to the heap (counted) and the
+ * next reset() grows the block to the peak of the frame, so the overflow happens
+ * only once per new peak.
+ */
+class Linear_arena
+{
+
+public:
+
+    explicit Linear_arena(size_t capacity = 0);
+    ~Linear_arena();
+
+    Linear_arena(const Linear_arena&) = delete;
+    Linear_arena& operator=(const Linear_arena&) = delete;
+
+
+    // Replaces the block - only between the frames, nothing allocated may be in use
+    void reserve(size_t capacity);
+
+    /**
+     * @brief Allocates the aligned bytes, valid until the next reset().
+     *
+     * @param size  Bytes.
+     * @param align Power of two alignment.
+     * @return Never nullptr (the heap takes the overflow).
+     */
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t));
+
+    // Gives the newest allocation back, the older ones stay until the reset
+    void release(void* p, size_t size);
+
+    // Frees everything at once, grows the block after an overflow - no allocation may be in use
+    void reset();
+
+
+    size_t get_capacity() const { return capacity; }
+    size_t get_used() const { return offset.load(std::memory_order_relaxed); }
+
+    // Largest frame since the start (the overflow included)
+    size_t get_peak() const { return peak; }
+
+    // Allocations, which went to the heap, since the start
+    std::uint64_t get_overflow_count() const { return overflow_total; }
+
+
+private:
+
+    unsigned char* block = nullptr;
+    size_t capacity = 0;
+
+    std::atomic<size_t> offset{0};
+
+    // Heap allocations of this frame over the capacity - freed by reset()
+    std::mutex overflow_mutex;
+    std::vector<void*> overflow;
+    size_t overflow_bytes = 0;
+    std::uint64_t overflow_total = 0;
+
+    size_t peak = 0;
+};
+
+// =========================================================================================== LINEAR ARENA
+
+
+// =========================================================================================== ARENA ALLOCATOR
+
+
+/**
+ * @brief STL allocator over a Linear_arena - the containers of the transient data.
+ *
+ * The container must not outlive the arena reset: a Frame_vector lives inside the
+ * frame, a buffered one until the end of the next frame.
+ *
+ * @tparam T Element type.
+ */
+template <typename T>
+class Arena_allocator
+{
+
+public:
+
+    using value_type = T;
+
+    explicit Arena_allocator(Linear_arena& arena) noexcept : arena(&arena) {}
+
+    template <typename U>
+    Arena_allocator(const Arena_allocator<U>& other) noexcept : arena(other.get_arena()) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T* p, size_t n) noexcept { arena->release(p, n * sizeof(T)); }
+
+    Linear_arena* get_arena() const noexcept { return arena; }
+
+    template <typename U>
+    bool operator==(const Arena_allocator<U>& other) const noexcept { return arena == other.get_arena(); }
+
+    template <typename U>
+    bool operator!=(const Arena_allocator<U>& other) const noexcept { return arena != other.get_arena(); }
+
+private:
+
+    Linear_arena* arena;
+};
+
+
+template <typename T>
+using Frame_vector = std::vector<T, Arena_allocator<T>>;
+
+using Frame_string = std::basic_string<char, std::char_traits<char>, Arena_allocator<char>>;
+
+// =========================================================================================== ARENA ALLOCATOR
+
+
+// =========================================================================================== FRAME ARENA
+
+
+/**
+ * @brief Transient memory of the frame: reset at the start of every SDL_app_cycle().
+ *
+ * Two lifetimes:
+ * - frame - until the next cycle starts (the render commands, the formatted strings,
+ *   the event lists and the scratch vectors of the update and the render)
+ * - buffered - until the cycle after the next one: two arenas in turn, for the data
+ *   made by the update of one frame and read by the next one (the pipelined render)
+ *
+ * Nothing is destroyed - only the trivially destructible objects can be created
+ * directly, the containers free nothing anyway.
+ *
+ * Usage:
+ * @code
+ * Frame_arena& arena = Frame_arena::Instance();
+ *
+ * Frame_vector<SDL_Rect> hits(arena.allocator<SDL_Rect>());
+ * hits.reserve(64);
+ *
+ * const char* label = arena.format("%d / %d", score, best);
+ * @endcode
+ */
+class Frame_arena
+{
+
+public:
+
+    // Returns the singleton instance.
+    static Frame_arena& Instance();
+
+
+    // Block sizes - the peak of the previous run is a good value (the report prints it)
+    void reserve(size_t frame_bytes, size_t buffered_bytes);
+
+    // Frees the frame arena and the buffered one of two frames ago - the worker must be idle
+    void begin_frame();
+
+
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t)) { return frame.allocate(size, align); }
+    void* allocate_buffered(size_t size, size_t align = alignof(std::max_align_t)) { return buffered[current].allocate(size, align); }
+
+    // Constructed in the frame arena, never destroyed
+    template <typename T, typename... Args>
+    T* create(Args&&... args)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "Frame_arena objects are never destroyed");
+
+        return new (frame.allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // printf into the frame arena - the debug and HUD strings
+    const char* format(const char* fmt, ...)
+#if defined(__GNUC__)
+        __attribute__((format(printf, 2, 3)))
+#endif
+        ;
+
+    template <typename T>
+    Arena_allocator<T> allocator() { return Arena_allocator<T>(frame); }
+
+    template <typename T>
+    Arena_allocator<T> buffered_allocator() { return Arena_allocator<T>(buffered[current]); }
+
+
+    Linear_arena& get_frame_arena() { return frame; }
+    Linear_arena& get_buffered_arena() { return buffered[current]; }
+
+    // Blocks of all three arenas (the heap overflow of the frame not included)
+    size_t get_reserved_bytes() const { return frame.get_capacity() + buffered[0].get_capacity() + buffered[1].get_capacity(); }
+
+    // Capacities, peaks and the overflows
+    void dump(std::ostream& out) const;
+
+
+private:
+
+    Frame_arena() = default;
+
+    // Singleton - not copyable
+    Frame_arena(const Frame_arena&) = delete;
+    Frame_arena& operator=(const Frame_arena&) = delete;
+
+
+    Linear_arena frame;
+
+    // The one of this frame, the other one still holds the data of the previous frame
+    Linear_arena buffered[2];
+    int current = 0;
+};
+
+// =========================================================================================== FRAME ARENA
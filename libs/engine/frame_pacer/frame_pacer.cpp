@@ -0,0 +1,161 @@
+// frame_pacer.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "frame_pacer.h"
+#include "../engine_clock/engine_clock.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== FRAME PACER
+
+void Frame_pacer::init(SDL_Renderer* r, SDL_Window* window, double fps, bool vsync_requested)
+{
+    renderer = r;
+    vsync_active = vsync_requested;
+
+    // Refresh rate of the display with the window (0 if the driver doesn't know it)
+    SDL_DisplayMode mode;
+
+    if (window && SDL_GetWindowDisplayMode(window, &mode) == 0 && mode.refresh_rate > 0)
+        refresh_rate = mode.refresh_rate;
+
+    set_target_fps(fps);
+
+    last_frame_end = Engine_clock::now();
+    next_deadline = last_frame_end + period_ticks;
+    last_present_end = 0;
+}
+
+
+void Frame_pacer::set_target_fps(double fps)
+{
+    target_fps = fps > 0.0 ? fps : 0.0;
+
+    period_ticks = target_fps > 0.0
+        ? static_cast<Uint64>(static_cast<double>(Engine_clock::frequency()) / target_fps)
+        : 0;
+
+    // Restart the deadlines chain from now
+    next_deadline = Engine_clock::now() + period_ticks;
+}
+
+
+double Frame_pacer::get_target_fps() const { return target_fps; }
+
+
+void Frame_pacer::frame_end(bool presented)
+{
+    Uint64 now = Engine_clock::now();
+
+    last_work_ticks = now - last_frame_end;
+
+    // Vsync check works with the interval between two presents, before the sleep: it's
+    // the interval defined by the present itself. The sleep is skipped while probing,
+    // so it can't hide the unthrottled presents. The skipped frames (render rate limit)
+    // end right before a present - measured from them, a blocking present looks instant.
+    bool probing = vsync_active && probe_frames < VSYNC_PROBE_FRAMES;
+
+    // The very first present has no interval (the time since the startup) - skipped
+    if (probing && presented && last_present_end != 0) check_vsync(now - last_present_end);
+
+    if (period_ticks > 0)
+    {
+        // With the working vsync at the display rate the present already paces the
+        // loop - an extra sleep could only make us miss the next vblank
+        bool paced_by_vsync = (probing && presented) ||
+                              (presented && vsync_active && target_fps >= refresh_rate * 0.95);
+
+        if (!paced_by_vsync && now < next_deadline) sleep_until(next_deadline);
+
+        next_deadline += period_ticks;
+
+        // More than a frame behind (a hitch) - don't try to catch up with a burst
+        // of the unpaced frames, restart the chain from now
+        Uint64 after = Engine_clock::now();
+
+        if (after > next_deadline) next_deadline = after + period_ticks;
+    }
+
+    Uint64 end = Engine_clock::now();
+
+    last_frame_ticks = end - last_frame_end;
+    last_frame_end = end;
+
+    if (presented) last_present_end = end;
+}
+
+
+bool Frame_pacer::is_vsync_active() const { return vsync_active; }
+
+
+void Frame_pacer::resume()
+{
+    last_frame_end = Engine_clock::now();
+    next_deadline = last_frame_end + period_ticks;
+
+    // The block isn't a present interval either
+    if (last_present_end != 0) last_present_end = last_frame_end;
+}
+
+
+double Frame_pacer::get_last_frame_time() const
+{
+    return static_cast<double>(last_frame_ticks) / static_cast<double>(Engine_clock::frequency());
+}
+
+
+double Frame_pacer::get_last_work_time() const
+{
+    return static_cast<double>(last_work_ticks) / static_cast<double>(Engine_clock::frequency());
+}
+
+
+double Frame_pacer::get_refresh_rate() const { return refresh_rate; }
+
+
+// Coarse sleep leaves ~1 ms, the rest is a yield-spin: SDL_Delay has 1 ms granularity
+// and often oversleeps on the embedded kernels
+
+void Frame_pacer::sleep_until(Uint64 deadline)
+{
+    const Uint64 freq = Engine_clock::frequency();
+
+    for (;;)
+    {
+        Uint64 now = Engine_clock::now();
+
+        if (now >= deadline) return;
+
+        Uint64 remaining_ms = (deadline - now) * 1000 / freq;
+
+        if (remaining_ms > 1) SDL_Delay(static_cast<Uint32>(remaining_ms - 1));
+        else SDL_Delay(0); // Yield the core to the other threads
+    }
+}
+
+
+void Frame_pacer::check_vsync(Uint64 frame_ticks)
+{
+    probe_ticks += frame_ticks;
+    ++probe_frames;
+
+    if (probe_frames < VSYNC_PROBE_FRAMES) return;
+
+    double mean = static_cast<double>(probe_ticks) / probe_frames / static_cast<double>(Engine_clock::frequency());
+
+    // Presents returned noticeably faster than the refresh period - the driver ignores vsync
+    if (mean < 0.75 / refresh_rate)
+    {
+        SDL_Log("Vsync is not honored by the driver (%.2f ms per present), using sleep pacing", mean * 1000.0);
+
+        if (renderer) SDL_RenderSetVSync(renderer, 0);
+
+        vsync_active = false;
+        next_deadline = Engine_clock::now() + period_ticks;
+    }
+}
+
+// =========================================================================================== FRAME PACER
@@ -0,0 +1,140 @@
+// frame_pacer.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== FRAME PACER
+
+
+/**
+ * @brief Keeps the main loop at the target frame rate without burning the CPU.
+ *
+ * The pacer works with absolute deadlines: every frame has its own deadline
+ * (previous deadline + frame period), and frame_end() sleeps until it.
+ * The sleep is split in two parts - the coarse SDL_Delay() until ~1 ms before the
+ * deadline, then a short yield-spin for the precise wake up.
+ *
+ * Vsync is requested at the renderer creation (see SDL_app_init), but many drivers
+ * (software renderer, some fbdev firmwares) silently ignore it. The pacer measures
+ * the real present intervals on the first frames: if they are much shorter than the
+ * display refresh period, vsync is considered broken, it's turned off, and the
+ * sleep-based pacing takes over.
+ *
+ * Example usage:
+ *
+ * Frame_pacer pacer;
+ * 
+ * pacer.init(renderer, window, 60.0, true);
+ * 
+ * while (running) { update(); render(); SDL_RenderPresent(renderer); pacer.frame_end(); }
+ */
+class Frame_pacer
+{
+
+public:
+
+    // Default constructor - unlimited frame rate until init() is called
+    Frame_pacer() = default;
+
+
+    /**
+     * @brief Setup the pacer for the created renderer.
+     *
+     * @param renderer Renderer, created with or without SDL_RENDERER_PRESENTVSYNC.
+     * @param window Window used to query the display refresh rate.
+     * @param target_fps Target frame rate, 0 - unlimited.
+     * @param vsync_requested true if the renderer was created with vsync.
+     */
+    void init(SDL_Renderer* renderer, SDL_Window* window, double target_fps, bool vsync_requested);
+
+
+    /**
+     * @brief Target frame rate setter.
+     *
+     * @param fps New target frame rate, 0 - unlimited.
+     */
+    void set_target_fps(double fps);
+
+    // Target frame rate getter (0 - unlimited)
+    double get_target_fps() const;
+
+
+    /**
+     * @brief Marks the end of the frame (call right after SDL_RenderPresent).
+     *
+     * Measures the frame interval, checks the vsync on the first frames
+     * and sleeps until the deadline of the next frame.
+     *
+     * @param presented false if the frame was skipped (no SDL_RenderPresent call) -
+     *        the vsync check measures only the intervals between the presented frames.
+     */
+    void frame_end(bool presented = true);
+
+
+    // true if the vsync is requested and considered working
+    bool is_vsync_active() const;
+
+    // Restarts the frame timing from now, after the loop was blocked outside of
+    // the frame (idle wait), so the block is neither measured nor paced
+    void resume();
+
+    // Duration of the last full frame (including the sleep), in seconds
+    double get_last_frame_time() const;
+
+    // Duration of the last frame before the sleep (update, render, present), in seconds -
+    // with the working vsync the present wait is in it
+    double get_last_work_time() const;
+
+    // Display refresh rate used for the vsync check, in Hz
+    double get_refresh_rate() const;
+
+
+private:
+
+    // Number of the frames measured for the vsync check
+    static constexpr int VSYNC_PROBE_FRAMES = 30;
+
+    SDL_Renderer* renderer = nullptr;
+
+    // Frame period in performance counter ticks, 0 - unlimited
+    Uint64 period_ticks = 0;
+
+    // Deadline of the next frame_end() return
+    Uint64 next_deadline = 0;
+
+    // Previous frame_end() exit time
+    Uint64 last_frame_end = 0;
+
+    // frame_end() exit time of the last presented frame, 0 - none yet
+    Uint64 last_present_end = 0;
+
+    // Last full frame duration in ticks
+    Uint64 last_frame_ticks = 0;
+
+    // Last frame duration before the sleep in ticks
+    Uint64 last_work_ticks = 0;
+
+    double target_fps = 0.0;
+    double refresh_rate = 60.0;
+
+    bool vsync_active = false;
+
+    // Vsync check state: measured frames and their summary present interval
+    int probe_frames = 0;
+    Uint64 probe_ticks = 0;
+
+
+    // Sleeps with ~0.1 ms precision until the performance counter reaches the deadline
+    static void sleep_until(Uint64 deadline);
+
+    // Compares the measured present interval with the refresh period
+    void check_vsync(Uint64 frame_ticks);
+};
+
+// =========================================================================================== FRAME PACER
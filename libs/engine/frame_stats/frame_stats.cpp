@@ -0,0 +1,179 @@
+// frame_stats.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "frame_stats.h"
+#include "../engine_clock/engine_clock.h"
+#include "../zone_profiler/zone_profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <ostream>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== FRAME HISTOGRAM
+
+// Zones listed in a stutter report
+static constexpr int STUTTER_ZONES = 4;
+
+
+void Frame_histogram::add(double ms)
+{
+    const double us = ms * 1000.0;
+
+    // Bucket b ends at FIRST_US * 2^(b / SUB_BUCKETS)
+    int b = us > FIRST_US ? static_cast<int>(std::ceil(std::log2(us / FIRST_US) * SUB_BUCKETS)) : 0;
+
+    b = std::min(b, BUCKETS - 1);
+
+    ++buckets[b];
+    ++count;
+
+    total_ms += ms;
+    max_ms = std::max(max_ms, ms);
+}
+
+
+double Frame_histogram::percentile_ms(double fraction) const
+{
+    if (count == 0) return 0.0;
+
+    const std::uint64_t wanted = static_cast<std::uint64_t>(fraction * static_cast<double>(count) + 0.5);
+
+    std::uint64_t seen = 0;
+
+    for (int b = 0; b < BUCKETS; ++b)
+    {
+        seen += buckets[b];
+
+        // The upper bound - never above the longest frame
+        if (seen >= wanted && seen > 0)
+            return b == BUCKETS - 1 ? max_ms : std::min(max_ms, FIRST_US * std::exp2(static_cast<double>(b) / SUB_BUCKETS) / 1000.0);
+    }
+
+    return max_ms;
+}
+
+// =========================================================================================== FRAME HISTOGRAM
+
+
+// =========================================================================================== FRAME STATS
+
+Frame_stats& Frame_stats::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Frame_stats instance;
+    return instance;
+}
+
+
+void Frame_stats::set_thresholds(double budget, double stutter)
+{
+    budget_ms = budget;
+    stutter_ms = stutter;
+}
+
+
+void Frame_stats::record(const State& state, Uint64 start, Uint64 end)
+{
+    const double ms = Engine_clock::to_seconds(end - start) * 1000.0;
+
+    // The same state as the last frame - almost always
+    if (last_entry >= states.size() || !(states[last_entry].id == state.id))
+    {
+        last_entry = 0;
+
+        while (last_entry < states.size() && !(states[last_entry].id == state.id)) ++last_entry;
+
+        if (last_entry == states.size()) states.push_back({state.id, std::string(state.name.view()) + " (" + state.label + ")", {}});
+    }
+
+    State_entry& entry = states[last_entry];
+
+    const bool over_budget = ms > budget_ms;
+    const bool stutter = stutter_ms > 0.0 && ms >= stutter_ms;
+
+    for (Frame_histogram* h : {&entry.histogram, &total})
+    {
+        h->add(ms);
+
+        if (over_budget) ++h->over_budget;
+        if (stutter) ++h->stutters;
+    }
+
+    if (stutter) report_stutter(entry, ms, start, end);
+}
+
+
+void Frame_stats::report_stutter(const State_entry& entry, double ms, Uint64 start, Uint64 end) const
+{
+#ifdef ZONE_PROFILING
+    Zone_profiler::Zone_total zones[STUTTER_ZONES];
+
+    const int count = Zone_profiler::Instance().top_zones(start, end, zones, STUTTER_ZONES);
+
+    char text[STUTTER_ZONES * 48] = "";
+    int length = 0;
+
+    for (int i = 0; i < count && length < static_cast<int>(sizeof(text)); ++i)
+        length += SDL_snprintf(text + length, sizeof(text) - length, "%s%s %.1f ms", i ? ", " : "", zones[i].name, zones[i].ms);
+
+    SDL_Log("Stutter: %.1f ms frame in %s, zones: %s", ms, entry.name.c_str(), count ? text : "none");
+#else
+    (void)start;
+    (void)end;
+
+    SDL_Log("Stutter: %.1f ms frame in %s", ms, entry.name.c_str());
+#endif
+}
+
+
+const Frame_histogram* Frame_stats::get_histogram(const State_ID& id) const
+{
+    for (const State_entry& entry : states)
+        if (entry.id == id) return &entry.histogram;
+
+    return nullptr;
+}
+
+
+void Frame_stats::dump(std::ostream& out) const
+{
+    out << "=== Frame times ===\n";
+
+    if (!total.count)
+    {
+        out << "No frames\n";
+        return;
+    }
+
+    out << std::fixed << std::setprecision(2);
+    out << "Budget " << budget_ms << " ms, stutter " << stutter_ms << " ms\n";
+
+    auto print = [&out](const std::string& name, const Frame_histogram& h)
+    {
+        out << "  " << std::left << std::setw(24) << name << std::right
+            << " frames " << std::setw(7) << h.count << ", mean " << std::setw(6) << h.mean_ms()
+            << " ms, p50 " << std::setw(6) << h.percentile_ms(0.5) << ", p95 " << std::setw(6) << h.percentile_ms(0.95)
+            << ", p99 " << std::setw(6) << h.percentile_ms(0.99) << ", max " << std::setw(7) << h.max_ms
+            << " ms, over budget " << h.over_budget << ", stutters " << h.stutters << "\n";
+    };
+
+    for (const State_entry& entry : states) print(entry.name, entry.histogram);
+
+    print("all", total);
+}
+
+
+void Frame_stats::reset()
+{
+    states.clear();
+    last_entry = 0;
+    total = Frame_histogram();
+}
+
+// =========================================================================================== FRAME STATS
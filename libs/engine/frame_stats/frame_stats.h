@@ -0,0 +1,150 @@
+// frame_stats.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "../platform/platform.h"
+#include "../state_machine/state_machine.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== FRAME HISTOGRAM
+
+
+/**
+ * @brief Distribution of the frame times with the logarithmic buckets.
+ *
+ * SUB_BUCKETS buckets per octave from FIRST_US up (about 9 % wide), the last bucket
+ * takes the rest - the percentiles are the upper bounds of their buckets (a hitch of
+ * 40 ms is reported as 40 - 43.6 ms, never as the mean), the max is exact.
+ */
+struct Frame_histogram
+{
+    static constexpr int SUB_BUCKETS = 8;
+    static constexpr int BUCKETS = 12 * SUB_BUCKETS;
+
+    // Upper bound of the first bucket
+    static constexpr double FIRST_US = 250.0;
+
+    std::uint64_t count = 0;
+    std::uint64_t buckets[BUCKETS] = {};
+
+    double total_ms = 0.0;
+    double max_ms = 0.0;
+
+    // Frames over the budget and over the stutter threshold
+    std::uint64_t over_budget = 0;
+    std::uint64_t stutters = 0;
+
+    void add(double ms);
+
+    // Upper bound of the bucket of the fraction (0.5 - the median), in ms
+    double percentile_ms(double fraction) const;
+
+    double mean_ms() const { return count ? total_ms / static_cast<double>(count) : 0.0; }
+};
+
+// =========================================================================================== FRAME HISTOGRAM
+
+
+// =========================================================================================== FRAME STATS
+
+
+/**
+ * @brief Frame times of every visible state: p50, p95, p99, max and the frames over the budget.
+ *
+ * The frame is the time between two cycle starts - what the player sees, the pacing
+ * sleep and the present included (the idle waits are not frames). It is counted to the
+ * state, which rendered it: the top overlay, otherwise the current state.
+ *
+ * A frame over the stutter threshold is logged at once with the state name - and, with
+ * the MIYOO_ZONE_PROFILING build, with the zones of the main thread, which took the most
+ * time in it. The shutdown prints the table of all states.
+ *
+ * Recording is a lookup in a short list and a bucket increment - always on.
+ *
+ * Singleton, like Input_latency, so the app cycle records without any context.
+ *
+ * Usage (done by the app cycle):
+ * @code
+ * Frame_stats::Instance().set_thresholds(1000.0 / 60.0, 50.0);
+ * Frame_stats::Instance().record(*sm.get_current_state(), frame_start, now);
+ * Frame_stats::Instance().dump(std::cout);
+ * @endcode
+ */
+class Frame_stats
+{
+
+public:
+
+    // Returns the singleton instance.
+    static Frame_stats& Instance();
+
+
+    /**
+     * @brief Budget and stutter threshold in ms.
+     *
+     * @param budget_ms  Frame time of the target rate (over it - a missed frame).
+     * @param stutter_ms Frame time, which is logged, 0 - no log.
+     */
+    void set_thresholds(double budget_ms, double stutter_ms);
+
+    /**
+     * @brief Counts the frame to the state (main thread).
+     *
+     * @param state Visible state of the frame.
+     * @param start Engine_clock counter of the frame start.
+     * @param end   Engine_clock counter of the frame end.
+     */
+    void record(const State& state, Uint64 start, Uint64 end);
+
+    // Distribution of the state, nullptr if it wasn't visible yet
+    const Frame_histogram* get_histogram(const State_ID& id) const;
+
+    // Distribution of all frames
+    const Frame_histogram& get_total() const { return total; }
+
+    // Prints the per-state table
+    void dump(std::ostream& out) const;
+
+    void reset();
+
+
+private:
+
+    Frame_stats() = default;
+
+    // Singleton - not copyable
+    Frame_stats(const Frame_stats&) = delete;
+    Frame_stats& operator=(const Frame_stats&) = delete;
+
+
+    struct State_entry
+    {
+        State_ID id;
+        std::string name;
+        Frame_histogram histogram;
+    };
+
+    // Logs the stutter frame with its heaviest zones
+    void report_stutter(const State_entry& entry, double ms, Uint64 start, Uint64 end) const;
+
+
+    // Visible states in the order of the first frame - a few, the lookup is linear
+    std::vector<State_entry> states;
+    size_t last_entry = 0;
+
+    Frame_histogram total;
+
+    double budget_ms = 1000.0 / 60.0;
+    double stutter_ms = 50.0;
+};
+
+// =========================================================================================== FRAME STATS
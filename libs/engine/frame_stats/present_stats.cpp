@@ -0,0 +1,99 @@
+// present_stats.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "present_stats.h"
+#include "../engine_clock/engine_clock.h"
+
+#include <iomanip>
+#include <ostream>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== PRESENT STATS
+
+Present_stats& Present_stats::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Present_stats instance;
+    return instance;
+}
+
+
+void Present_stats::set_refresh_rate(double hz)
+{
+    refresh_period = hz > 0.0 ? static_cast<Uint64>(static_cast<double>(Engine_clock::frequency()) / hz) : 0;
+}
+
+
+void Present_stats::on_vblank(Uint64 counter)
+{
+    if (counter > last_vblank) last_vblank = counter;
+}
+
+
+Uint64 Present_stats::next_vblank(Uint64 counter) const
+{
+    if (last_vblank == 0 || refresh_period == 0) return 0;
+
+    if (counter < last_vblank) return last_vblank;
+
+    // Whole periods since the known blank, the next one strictly after the counter
+    return last_vblank + ((counter - last_vblank) / refresh_period + 1) * refresh_period;
+}
+
+
+void Present_stats::record(Uint64 start, Uint64 end, Uint64 scanout)
+{
+    block.add(Engine_clock::to_ms(end - start));
+
+    if (scanout >= start) scanout_latency.add(Engine_clock::to_ms(scanout - start));
+}
+
+
+void Present_stats::set_mode(const std::string& m) { mode = m; }
+
+
+void Present_stats::dump(std::ostream& out) const
+{
+    out << "=== Present ===\n";
+
+    if (!block.count)
+    {
+        out << "No presents\n";
+        return;
+    }
+
+    out << "Mode: " << (mode.empty() ? "unknown" : mode) << "\n";
+    out << std::fixed << std::setprecision(2);
+
+    auto print = [&out](const char* name, const Frame_histogram& h)
+    {
+        out << "  " << std::left << std::setw(8) << name << std::right << " frames " << std::setw(7) << h.count;
+
+        if (!h.count)
+        {
+            out << ", no vertical blank known\n";
+            return;
+        }
+
+        out << ", mean " << std::setw(6) << h.mean_ms() << " ms, p50 " << std::setw(6) << h.percentile_ms(0.5)
+            << ", p95 " << std::setw(6) << h.percentile_ms(0.95) << ", p99 " << std::setw(6) << h.percentile_ms(0.99)
+            << ", max " << std::setw(7) << h.max_ms << " ms\n";
+    };
+
+    print("block", block);
+    print("scanout", scanout_latency);
+}
+
+
+void Present_stats::reset()
+{
+    block = Frame_histogram();
+    scanout_latency = Frame_histogram();
+    last_vblank = 0;
+}
+
+// =========================================================================================== PRESENT STATS
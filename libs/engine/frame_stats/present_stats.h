@@ -0,0 +1,105 @@
+// present_stats.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+#include "frame_stats.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== PRESENT STATS
+
+
+/**
+ * @brief What the swap chain costs: the present block time and the present to scanout latency.
+ *
+ * Per frame:
+ *
+ * - BLOCK - the time spent in the present (Frame::end(): SDL_RenderPresent and the
+ *   framebuffer flip) - the throughput, which the buffering takes from the cycle;
+ *
+ * - SCANOUT - from the present call to the vertical blank, at which the frame starts
+ *   to be scanned out - the latency, which the buffering adds to every input.
+ *
+ * The scanout is not seen from the software - it is estimated from the vertical blanks:
+ * the FBIO_WAITFORVSYNC returns of the framebuffer flip, or the returns of the SDL presents,
+ * which blocked on the vsync. The next blank follows them by the refresh period. Without
+ * a known blank (no vsync) only the block time is recorded.
+ *
+ * The report has the swap chain mode (set_mode()), so the runs with a different depth,
+ * vsync or game mode compare by it.
+ *
+ * Singleton, like Frame_stats, so the app cycle records without any context.
+ *
+ * Usage (done by the app cycle):
+ * @code
+ * Present_stats::Instance().set_refresh_rate(60.0);
+ * Present_stats::Instance().on_vblank(fb.get_vblank_time());   // after the flip, if any
+ * Present_stats::Instance().record(present_start, present_end, scanout);
+ * Present_stats::Instance().dump(std::cout);
+ * @endcode
+ */
+class Present_stats
+{
+
+public:
+
+    // Returns the singleton instance.
+    static Present_stats& Instance();
+
+
+    // Refresh rate of the output in Hz - the period between the estimated blanks
+    void set_refresh_rate(double hz);
+
+    // A vertical blank happened at the Engine_clock counter, 0 - none is known
+    void on_vblank(Uint64 counter);
+
+    // First vertical blank after the counter, 0 - no blank is known yet
+    Uint64 next_vblank(Uint64 counter) const;
+
+    /**
+     * @brief Counts the present of one frame (main thread).
+     *
+     * @param start   Engine_clock counter of the present call.
+     * @param end     Engine_clock counter of its return.
+     * @param scanout Engine_clock counter of the scanout start, 0 - unknown.
+     */
+    void record(Uint64 start, Uint64 end, Uint64 scanout);
+
+    const Frame_histogram& get_block() const { return block; }
+    const Frame_histogram& get_scanout() const { return scanout_latency; }
+
+    // Description of the swap chain (the output, the depth, the vsync), printed by dump()
+    void set_mode(const std::string& mode);
+
+    // Prints the mode and both distributions
+    void dump(std::ostream& out) const;
+
+    void reset();
+
+
+private:
+
+    Present_stats() = default;
+
+    // Singleton - not copyable
+    Present_stats(const Present_stats&) = delete;
+    Present_stats& operator=(const Present_stats&) = delete;
+
+
+    Frame_histogram block;
+    Frame_histogram scanout_latency;
+
+    Uint64 last_vblank = 0;
+    Uint64 refresh_period = 0;
+
+    std::string mode;
+};
+
+// =========================================================================================== PRESENT STATS
@@ -0,0 +1,383 @@
+// perf_governor.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "perf_governor.h"
+#include "../frame_pacer/frame_pacer.h"
+#include "../engine_clock/engine_clock.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <ostream>
+
+#ifdef PLATFORM_LINUX
+    #include <dirent.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== SYSFS
+
+namespace
+{
+#ifdef PLATFORM_LINUX
+
+    // Reads the whole small sysfs file into the buffer, false if there is no such file
+    bool read_text(const char* path, char* out, size_t size)
+    {
+        const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+
+        if (fd < 0) return false;
+
+        const ssize_t bytes = read(fd, out, size - 1);
+
+        ::close(fd);
+
+        if (bytes <= 0) return false;
+
+        out[bytes] = 0;
+
+        return true;
+    }
+
+
+    bool read_int(const char* path, int& value)
+    {
+        char text[32];
+
+        if (!read_text(path, text, sizeof(text))) return false;
+
+        value = std::atoi(text);
+
+        return true;
+    }
+
+
+    bool write_int(const char* path, int value)
+    {
+        const int fd = ::open(path, O_WRONLY | O_CLOEXEC);
+
+        if (fd < 0) return false;
+
+        char text[16];
+
+        const int length = std::snprintf(text, sizeof(text), "%d", value);
+
+        const bool ok = write(fd, text, static_cast<size_t>(length)) == length;
+
+        ::close(fd);
+
+        return ok;
+    }
+
+#endif
+}
+
+// =========================================================================================== SYSFS
+
+
+// =========================================================================================== PERFORMANCE GOVERNOR
+
+Perf_governor::~Perf_governor() { close(); }
+
+
+bool Perf_governor::is_open() const { return opened; }
+
+
+int Perf_governor::get_cpu_khz() const { return levels.empty() ? 0 : levels[level]; }
+
+
+int Perf_governor::get_battery_percent() const { return battery_percent; }
+
+
+int Perf_governor::get_temperature() const { return temperature; }
+
+
+void Perf_governor::set_idle_fps(double fps) { idle_fps = fps; }
+
+
+void Perf_governor::set_low_battery(int percent, double fps)
+{
+    low_battery_percent = percent;
+    low_battery_fps = fps;
+}
+
+
+void Perf_governor::set_thermal_limit(int celsius) { thermal_limit = celsius; }
+
+
+void Perf_governor::update(double busy_seconds, bool idle, Frame_pacer& pacer)
+{
+    if (!opened) return;
+
+    const double now = Engine_clock::to_seconds(Engine_clock::now());
+
+    // Time at the applied level - the idle sleeps of the loop included
+    if (last_update > 0.0)
+    {
+        if (idle_applied) idle_seconds += now - last_update;
+        else if (!level_seconds.empty()) level_seconds[level] += now - last_update;
+    }
+
+    last_update = now;
+
+    if (window_frames == 0) window_start = now;
+
+    window_max_busy = std::max(window_max_busy, busy_seconds);
+    window_idle = window_idle && idle;
+    ++window_frames;
+
+    if (now - window_start < WINDOW_SECONDS) return;
+
+    if (last_sensor_read < 0.0 || now - last_sensor_read >= SENSOR_SECONDS)
+    {
+        read_sensors();
+        last_sensor_read = now;
+    }
+
+    const bool low_battery = battery_percent >= 0 && !charging && battery_percent <= low_battery_percent;
+
+    int next_level = level;
+    double fps = base_fps;
+
+    if (window_idle)
+    {
+        next_level = 0;
+        fps = idle_fps > 0.0 && (base_fps <= 0.0 || idle_fps < base_fps) ? idle_fps : base_fps;
+    }
+    else if (!levels.empty())
+    {
+        // The unlimited rate has no budget - the 60 Hz one is kept then
+        const double budget = 1.0 / (base_fps > 0.0 ? base_fps : 60.0);
+        const double load = window_max_busy / budget;
+
+        if (load > 1.0) next_level = level + 2;
+        else if (load > RAISE_LOAD) next_level = level + 1;
+        else if (level > 0 && load * levels[level] / levels[level - 1] < LOWER_LOAD) next_level = level - 1;
+    }
+
+    if (low_battery && !window_idle && low_battery_fps > 0.0 && (fps <= 0.0 || low_battery_fps < fps)) fps = low_battery_fps;
+
+    next_level = std::max(0, std::min(next_level, get_level_cap()));
+
+    apply(next_level, fps, pacer);
+
+    idle_applied = window_idle;
+
+    window_frames = 0;
+    window_max_busy = 0.0;
+    window_idle = true;
+}
+
+
+void Perf_governor::apply(int next_level, double fps, Frame_pacer& pacer)
+{
+    if (!levels.empty() && next_level != level)
+    {
+#ifdef PLATFORM_LINUX
+        if (write_int(max_freq_path, levels[next_level])) level = next_level;
+        else
+        {
+            SDL_Log("Governor can't set the cpufreq limit - the frame rate only");
+            levels.clear();
+            level = 0;
+        }
+#endif
+    }
+
+    if (fps != applied_fps)
+    {
+        applied_fps = fps;
+        pacer.set_target_fps(fps);
+    }
+}
+
+
+int Perf_governor::get_level_cap() const
+{
+    if (levels.empty()) return 0;
+
+    int cap = static_cast<int>(levels.size()) - 1;
+
+    if (battery_percent >= 0 && !charging && battery_percent <= low_battery_percent) cap = cap / 2;
+
+    return std::max(0, cap - thermal_steps);
+}
+
+
+void Perf_governor::dump(std::ostream& out) const
+{
+    if (!opened) return;
+
+    out << "=== Performance governor ===\n";
+
+    out << std::fixed << std::setprecision(1);
+
+    if (battery_percent >= 0) out << "Battery: " << battery_percent << "%" << (charging ? ", charging" : "") << "\n";
+    if (temperature >= 0) out << "SoC temperature: " << temperature << " C, " << thermal_steps << " level(s) off\n";
+
+    out << "Idle (" << idle_fps << " fps): " << idle_seconds << " s\n";
+
+    for (size_t i = 0; i < level_seconds.size(); ++i)
+        out << "  " << std::setw(7) << (i < levels.size() ? levels[i] / 1000 : 0) << " MHz: " << level_seconds[i] << " s\n";
+
+    out << std::defaultfloat;
+}
+
+
+#ifdef PLATFORM_LINUX
+
+bool Perf_governor::open(double target_fps, const char* cpufreq_dir)
+{
+    close();
+
+    base_fps = target_fps;
+    applied_fps = target_fps;
+
+    levels.clear();
+    level = 0;
+
+    std::snprintf(max_freq_path, sizeof(max_freq_path), "%s/scaling_max_freq", cpufreq_dir);
+
+    char path[160];
+    char text[512];
+
+    // Every frequency of the policy, or four steps between the hardware limits
+    std::snprintf(path, sizeof(path), "%s/scaling_available_frequencies", cpufreq_dir);
+
+    if (read_text(path, text, sizeof(text)))
+    {
+        for (char* token = std::strtok(text, " \n"); token; token = std::strtok(nullptr, " \n"))
+            if (const int khz = std::atoi(token)) levels.push_back(khz);
+    }
+
+    int min_khz = 0;
+    int max_khz = 0;
+
+    std::snprintf(path, sizeof(path), "%s/cpuinfo_min_freq", cpufreq_dir);
+    const bool has_min = read_int(path, min_khz);
+
+    std::snprintf(path, sizeof(path), "%s/cpuinfo_max_freq", cpufreq_dir);
+    const bool has_max = read_int(path, max_khz);
+
+    if (levels.empty() && has_min && has_max && max_khz > min_khz)
+        for (int step = 0; step < 4; ++step) levels.push_back(min_khz + (max_khz - min_khz) * step / 3);
+
+    std::sort(levels.begin(), levels.end());
+    levels.erase(std::unique(levels.begin(), levels.end()), levels.end());
+
+    // The limit is written back once, so an unwritable cpufreq is known now
+    if (!levels.empty() && (!read_int(max_freq_path, original_khz) || !write_int(max_freq_path, original_khz)))
+    {
+        SDL_Log("Governor can't write %s - the frame rate only", max_freq_path);
+        levels.clear();
+    }
+
+    // Starts at the current limit
+    if (!levels.empty())
+        level = static_cast<int>(std::lower_bound(levels.begin(), levels.end(), original_khz) - levels.begin());
+
+    if (level >= static_cast<int>(levels.size())) level = static_cast<int>(levels.size()) - 1;
+    if (level < 0) level = 0;
+
+    level_seconds.assign(levels.size(), 0.0);
+    idle_seconds = 0.0;
+    idle_applied = false;
+
+    thermal_steps = 0;
+    last_sensor_read = -1.0;
+    last_update = 0.0;
+
+    window_frames = 0;
+    window_max_busy = 0.0;
+    window_idle = true;
+
+    opened = true;
+
+    SDL_Log("Governor: %d cpufreq level(s), %d - %d kHz", static_cast<int>(levels.size()),
+            levels.empty() ? 0 : levels.front(), levels.empty() ? 0 : levels.back());
+
+    return true;
+}
+
+
+void Perf_governor::close()
+{
+    if (!opened) return;
+
+    if (!levels.empty() && original_khz > 0) write_int(max_freq_path, original_khz);
+
+    levels.clear();
+    opened = false;
+}
+
+
+void Perf_governor::read_sensors()
+{
+    battery_percent = -1;
+    charging = false;
+
+    // The first power supply of the Battery type
+    if (DIR* dir = opendir("/sys/class/power_supply"))
+    {
+        char path[320];
+        char text[32];
+
+        while (dirent* entry = readdir(dir))
+        {
+            if (entry->d_name[0] == '.') continue;
+
+            std::snprintf(path, sizeof(path), "/sys/class/power_supply/%s/type", entry->d_name);
+
+            if (!read_text(path, text, sizeof(text)) || std::strncmp(text, "Battery", 7) != 0) continue;
+
+            std::snprintf(path, sizeof(path), "/sys/class/power_supply/%s/capacity", entry->d_name);
+
+            if (!read_int(path, battery_percent)) continue;
+
+            std::snprintf(path, sizeof(path), "/sys/class/power_supply/%s/status", entry->d_name);
+
+            charging = read_text(path, text, sizeof(text)) && (!std::strncmp(text, "Charging", 8) || !std::strncmp(text, "Full", 4));
+
+            break;
+        }
+
+        closedir(dir);
+    }
+
+    // Miyoo Mini without the fuel gauge - the Onion OS battery monitor writes the percent here
+    if (battery_percent < 0) read_int("/tmp/percBat", battery_percent);
+
+    int millidegrees = 0;
+
+    temperature = read_int("/sys/class/thermal/thermal_zone0/temp", millidegrees) ? millidegrees / 1000 : -1;
+
+    if (thermal_limit <= 0 || temperature < 0) thermal_steps = 0;
+    else if (temperature >= thermal_limit) thermal_steps = std::max(0, std::min(thermal_steps + 1, static_cast<int>(levels.size()) - 1));
+    else if (temperature < thermal_limit - 5 && thermal_steps > 0) --thermal_steps;
+}
+
+#else
+
+bool Perf_governor::open(double, const char*)
+{
+    SDL_Log("Performance governor is available only on Linux");
+    return false;
+}
+
+
+void Perf_governor::close() { opened = false; }
+
+
+void Perf_governor::read_sensors() {}
+
+#endif
+
+// =========================================================================================== PERFORMANCE GOVERNOR
@@ -0,0 +1,186 @@
+// perf_governor.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+class Frame_pacer;
+
+
+// =========================================================================================== PERFORMANCE GOVERNOR
+
+
+/**
+ * @brief Keeps the CPU clock and the frame rate as low as the game allows (device builds).
+ *
+ * Every cycle gives the governor its busy time (update and render, without the present
+ * wait and the pacing sleep). Each evaluation window (half a second) compares the
+ * slowest frame of the window with the frame budget of the target rate:
+ *
+ * - close to the budget - the cpufreq limit goes one level up (two if a frame was missed);
+ *
+ * - the load at the next lower frequency still fits with a margin - one level down;
+ *
+ * - the visible state is idle (static menu, nothing to draw) - the lowest level
+ *   and the idle frame rate.
+ *
+ * The battery (/sys/class/power_supply, the Onion OS /tmp/percBat as the fallback) and
+ * the SoC temperature (/sys/class/thermal) are read every few seconds: a low battery
+ * caps the CPU at the middle level and the frame rate at the low battery rate, an
+ * overheated SoC lowers the cap level by level until it cools down.
+ *
+ * The limit is the scaling_max_freq of the cpufreq policy - the kernel governor still
+ * picks the clock below it. The original limit is restored by close(). Without the
+ * writable cpufreq (not root, desktop) only the frame rate is governed.
+ *
+ * Available only on Linux, open() fails elsewhere.
+ *
+ * Usage (done by SDL_app_init / SDL_app_cycle, if sdl_app_ctx::enable_governor is set):
+ * @code
+ * governor.open(60.0);
+ * governor.update(busy_seconds, idle, pacer); // every cycle, after the present
+ * governor.close();                           // restores the cpufreq limit
+ * @endcode
+ */
+class Perf_governor
+{
+
+public:
+
+    Perf_governor() = default;
+
+    // Restores the cpufreq limit
+    ~Perf_governor();
+
+    // Copying the cpufreq owner is not allowed
+    Perf_governor(const Perf_governor&) = delete;
+    Perf_governor& operator=(const Perf_governor&) = delete;
+
+
+    /**
+     * @brief Finds the cpufreq levels and the sensors.
+     *
+     * @param target_fps Frame rate of the game (the budget), restored after the idle.
+     * @param cpufreq_dir cpufreq policy directory.
+     * @return false if there is nothing to govern (not Linux).
+     */
+    bool open(double target_fps, const char* cpufreq_dir = "/sys/devices/system/cpu/cpu0/cpufreq");
+
+    // Restores the original cpufreq limit
+    void close();
+
+    bool is_open() const;
+
+
+    /**
+     * @brief Adds the frame to the window, applies the decision at the end of the window.
+     *
+     * @param busy_seconds Update and render time of the frame (no present wait, no sleep).
+     * @param idle         The visible state is static and nothing waits to be drawn.
+     * @param pacer        Its target frame rate is set on a change.
+     */
+    void update(double busy_seconds, bool idle, Frame_pacer& pacer);
+
+
+    // === SETTINGS ===
+
+    // Frame rate of the idle menus
+    void set_idle_fps(double fps);
+
+    // At or below the percent (not charging): the middle CPU level at most and the fps cap
+    void set_low_battery(int percent, double fps);
+
+    // SoC temperature limit in degrees C, 0 - no thermal control
+    void set_thermal_limit(int celsius);
+
+    // === SETTINGS ===
+
+
+    // === STATE ===
+
+    // Current cpufreq limit in kHz, 0 - not controlled
+    int get_cpu_khz() const;
+
+    // Battery percent, -1 - unknown
+    int get_battery_percent() const;
+
+    // SoC temperature in degrees C, -1 - unknown
+    int get_temperature() const;
+
+    // Prints the time at every level and the sensors
+    void dump(std::ostream& out) const;
+
+    // === STATE ===
+
+
+private:
+
+    // Evaluation window and sensor interval, seconds
+    static constexpr double WINDOW_SECONDS = 0.5;
+    static constexpr double SENSOR_SECONDS = 5.0;
+
+    // Load of the slowest frame to the budget: raise above, lower if the lower level stays below
+    static constexpr double RAISE_LOAD = 0.85;
+    static constexpr double LOWER_LOAD = 0.65;
+
+    // Applies the level and the frame rate decided by the window
+    void apply(int level, double fps, Frame_pacer& pacer);
+
+    // Reads the battery and the temperature
+    void read_sensors();
+
+    // Highest level allowed by the battery and the temperature
+    int get_level_cap() const;
+
+
+    bool opened = false;
+
+    // cpufreq limits in kHz, ascending - empty if the limit can't be written
+    std::vector<int> levels;
+    int level = 0;
+    int original_khz = 0;
+
+    char max_freq_path[128] = {};
+
+    double base_fps = 60.0;
+    double idle_fps = 30.0;
+    double applied_fps = 0.0;
+
+    int low_battery_percent = 15;
+    double low_battery_fps = 30.0;
+    int thermal_limit = 0;
+
+    // Thermal cap - levels taken off the top
+    int thermal_steps = 0;
+
+    int battery_percent = -1;
+    bool charging = false;
+    int temperature = -1;
+
+    // Current window
+    double window_start = 0.0;
+    double window_max_busy = 0.0;
+    int window_frames = 0;
+    bool window_idle = true;
+
+    double last_sensor_read = -1.0;
+    double last_update = 0.0;
+
+    // Seconds at every level (the report)
+    std::vector<double> level_seconds;
+    double idle_seconds = 0.0;
+
+    // The last window decided the idle level
+    bool idle_applied = false;
+};
+
+// =========================================================================================== PERFORMANCE GOVERNOR
@@ -0,0 +1,152 @@
+// quality_watchdog.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "quality_watchdog.h"
+#include "../engine_clock/engine_clock.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iomanip>
+#include <ostream>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== QUALITY WATCHDOG
+
+static const char* const LEVEL_NAMES[QUALITY_LEVEL_COUNT] =
+{
+    "full", "fewer particles", "no effects", "half render rate", "low resolution"
+};
+
+
+const char* Quality_watchdog::get_level_name(int level)
+{
+    return level >= 0 && level < QUALITY_LEVEL_COUNT ? LEVEL_NAMES[level] : "?";
+}
+
+
+void Quality_watchdog::set_budget(double seconds)
+{
+    budget = seconds > 0.0 ? seconds : 0.0;
+}
+
+
+void Quality_watchdog::set_max_level(int new_max)
+{
+    max_level = std::max(0, std::min(new_max, static_cast<int>(QUALITY_LEVEL_COUNT) - 1));
+}
+
+
+bool Quality_watchdog::update(double busy_seconds, bool rendered)
+{
+    if (budget <= 0.0) return false;
+
+    const double now = Engine_clock::to_seconds(Engine_clock::now());
+
+    if (last_update > 0.0) level_seconds[level] += now - last_update;
+
+    last_update = now;
+
+    // A static screen has nothing to judge
+    if (!rendered) return false;
+
+    if (window_frames == 0) window_start = now;
+
+    // At the halved rate a drawn frame has the time of two
+    const double frame_budget = halves_render_rate() ? 2.0 * budget : budget;
+
+    window_max_busy = std::max(window_max_busy, busy_seconds);
+    if (busy_seconds > frame_budget) ++window_missed;
+    ++window_frames;
+
+    if (now - window_start < WINDOW_SECONDS) return false;
+
+    const double missed = static_cast<double>(window_missed) / window_frames;
+    const double slowest = window_max_busy;
+
+    window_frames = 0;
+    window_missed = 0;
+    window_max_busy = 0.0;
+
+    ++since_restore;
+
+    // The level above draws every frame at the full budget - the headroom is judged against it
+    if (missed >= MISSED_SHARE)
+    {
+        ++over_windows;
+        headroom_windows = 0;
+    }
+    else if (slowest < RESTORE_LOAD * budget)
+    {
+        ++headroom_windows;
+        over_windows = 0;
+    }
+    else over_windows = headroom_windows = 0;
+
+    char reason[48];
+
+    if (over_windows >= DEGRADE_WINDOWS && level < max_level)
+    {
+        // Lost right after its restore - the next restore waits twice as long
+        if (steps_up > 0 && since_restore <= restore_windows) restore_windows = std::min(restore_windows * 2, MAX_RESTORE_WINDOWS);
+        else restore_windows = RESTORE_WINDOWS;
+
+        std::snprintf(reason, sizeof(reason), "%d%% over %.1f ms", static_cast<int>(missed * 100.0 + 0.5), frame_budget * 1000.0);
+
+        change_level(level + 1, reason);
+        return true;
+    }
+
+    if (headroom_windows >= restore_windows && level > QUALITY_FULL)
+    {
+        std::snprintf(reason, sizeof(reason), "max %.1f ms", slowest * 1000.0);
+
+        change_level(level - 1, reason);
+        since_restore = 0;
+        return true;
+    }
+
+    return false;
+}
+
+
+void Quality_watchdog::change_level(int next, const char* reason)
+{
+    const bool down = next > level;
+
+    level = next;
+
+    if (down) ++steps_down;
+    else ++steps_up;
+
+    // The next step is judged on the new level only
+    over_windows = 0;
+    headroom_windows = 0;
+
+    std::snprintf(status, sizeof(status), "quality %s (%s %s)", LEVEL_NAMES[level], down ? "down," : "up,", reason);
+
+    SDL_Log("Quality %s to %d (%s): %s", down ? "down" : "up", level, LEVEL_NAMES[level], reason);
+}
+
+
+void Quality_watchdog::dump(std::ostream& out) const
+{
+    if (budget <= 0.0) return;
+
+    out << "=== Quality watchdog ===\n";
+
+    out << std::fixed << std::setprecision(1);
+
+    out << "Budget " << budget * 1000.0 << " ms, " << steps_down << " step(s) down, " << steps_up << " up, final level "
+        << LEVEL_NAMES[level] << "\n";
+
+    for (int i = 0; i <= max_level; ++i)
+        out << "  " << std::setw(16) << LEVEL_NAMES[i] << ": " << level_seconds[i] << " s\n";
+
+    out << std::defaultfloat;
+}
+
+// =========================================================================================== QUALITY WATCHDOG
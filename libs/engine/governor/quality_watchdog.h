@@ -0,0 +1,154 @@
+// quality_watchdog.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+#include <iosfwd>
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== QUALITY WATCHDOG
+
+// Degradation steps, in the order they are taken - a level has every step up to it
+enum Quality_level : std::uint8_t
+{
+    QUALITY_FULL,               // everything on
+    QUALITY_FEWER_PARTICLES,    // the bursts spawn PARTICLE_SHARE of their particles
+    QUALITY_NO_EFFECTS,         // the transition effects are skipped
+    QUALITY_HALF_RENDER_RATE,   // every second frame is drawn, the simulation keeps its rate
+    QUALITY_LOW_RESOLUTION,     // the images load at the half-resolution variants
+
+    QUALITY_LEVEL_COUNT
+};
+
+
+/**
+ * @brief Steps the optional work down when the frames keep missing the budget, and back up.
+ *
+ * The Perf_governor raises the CPU clock first; when the frames still don't fit, the game
+ * would slow down as a whole. The watchdog takes the optional work off instead, one step
+ * at a time in a fixed order - the particles, the effect passes, the render rate, then the
+ * resolution (Quality_level) - the cheapest loss of the picture first.
+ *
+ * Every drawn cycle gives the watchdog its busy time (update and render, without the present
+ * wait and the pacing sleep), and each window (half a second) is judged:
+ *
+ * - over - at least MISSED_SHARE of its frames were over the budget (twice the budget at the
+ *   halved render rate, a frame has two then); DEGRADE_WINDOWS such windows in a row step down;
+ *
+ * - headroom - its slowest frame fits into RESTORE_LOAD of the budget of the level above;
+ *   RESTORE_WINDOWS such windows in a row step up. A level lost again right after its restore
+ *   doubles the wait of the next restore - the quality doesn't flap on the edge.
+ *
+ * The watchdog only decides - the application applies the level (Particle_system spawn share,
+ * State_machine effects, render_hz, the image variant policy) on every change, logs it, and
+ * shows get_status() in the Debug_overlay.
+ *
+ * Usage (done by SDL_app_init / SDL_app_cycle, if sdl_app_ctx::enable_quality_watchdog is set):
+ * @code
+ * watchdog.set_budget(1.0 / 60.0);
+ * if (watchdog.update(busy_seconds, presented)) apply_quality(app);    // every cycle
+ * @endcode
+ */
+class Quality_watchdog
+{
+
+public:
+
+    // Evaluation window, seconds
+    static constexpr double WINDOW_SECONDS = 0.5;
+
+    // Share of the missed frames, which makes a window over, and the over windows per step down
+    static constexpr double MISSED_SHARE = 0.2;
+    static constexpr int DEGRADE_WINDOWS = 2;
+
+    // Load of the slowest frame to the budget of the level above, and the windows per step up
+    static constexpr double RESTORE_LOAD = 0.6;
+    static constexpr int RESTORE_WINDOWS = 6;
+
+    // Longest restore wait after the bounces, windows
+    static constexpr int MAX_RESTORE_WINDOWS = 96;
+
+    // Share of the particles spawned from QUALITY_FEWER_PARTICLES on
+    static constexpr float PARTICLE_SHARE = 0.5f;
+
+
+    // Frame budget in seconds (the target rate), 0 - the watchdog does nothing
+    void set_budget(double seconds);
+
+    // Deepest level the watchdog can go to (QUALITY_FULL - off)
+    void set_max_level(int level);
+
+    /**
+     * @brief Adds the cycle to the window, judges the window at its end.
+     *
+     * @param busy_seconds Update and render time of the cycle (no present wait, no sleep).
+     * @param rendered     A frame was drawn - the cycles without one don't count.
+     * @return true if the level changed - apply it.
+     */
+    bool update(double busy_seconds, bool rendered);
+
+
+    // === LEVEL ===
+
+    int get_level() const { return level; }
+
+    float get_particle_share() const { return level >= QUALITY_FEWER_PARTICLES ? PARTICLE_SHARE : 1.0f; }
+    bool allows_effects() const { return level < QUALITY_NO_EFFECTS; }
+    bool halves_render_rate() const { return level >= QUALITY_HALF_RENDER_RATE; }
+
+    // Scale of the image variant policy: 0.5 - the half-resolution variants
+    float get_resolution_scale() const { return level >= QUALITY_LOW_RESOLUTION ? 0.5f : 1.0f; }
+
+    // Name of the level ("full", "no effects")
+    static const char* get_level_name(int level);
+
+    // Overlay line: the level and the last decision with its reason
+    const char* get_status() const { return status; }
+
+    // Prints the time at every level and the decisions
+    void dump(std::ostream& out) const;
+
+    // === LEVEL ===
+
+
+private:
+
+    // Moves to the level, records the reason
+    void change_level(int next, const char* reason);
+
+
+    double budget = 0.0;
+    int max_level = QUALITY_LEVEL_COUNT - 1;
+    int level = QUALITY_FULL;
+
+    // Current window
+    double window_start = 0.0;
+    double window_max_busy = 0.0;
+    int window_frames = 0;
+    int window_missed = 0;
+
+    // Windows in a row over, and with the headroom
+    int over_windows = 0;
+    int headroom_windows = 0;
+
+    // Windows of headroom the next step up waits for, and the windows since the last step up
+    int restore_windows = RESTORE_WINDOWS;
+    int since_restore = 0;
+
+    double last_update = 0.0;
+
+    // Seconds at every level, the decisions (the report)
+    double level_seconds[QUALITY_LEVEL_COUNT] = {};
+    std::uint64_t steps_down = 0;
+    std::uint64_t steps_up = 0;
+
+    char status[96] = "quality full";
+};
+
+// =========================================================================================== QUALITY WATCHDOG
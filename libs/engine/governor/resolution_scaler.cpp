@@ -0,0 +1,141 @@
+// resolution_scaler.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "resolution_scaler.h"
+#include "../engine_clock/engine_clock.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <ostream>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== RESOLUTION SCALER
+
+void Resolution_scaler::set_budget(double seconds)
+{
+    budget = seconds > 0.0 ? seconds : 0.0;
+}
+
+
+void Resolution_scaler::set_min_scale(float scale)
+{
+    max_step = std::clamp(static_cast<int>((1.0f - scale) / STEP + 0.001f), 0, MAX_STEPS);
+}
+
+
+bool Resolution_scaler::update(double fill_seconds, bool rendered)
+{
+    if (budget <= 0.0) return false;
+
+    const double now = Engine_clock::to_seconds(Engine_clock::now());
+
+    if (last_update > 0.0) step_seconds[step] += now - last_update;
+
+    last_update = now;
+
+    // A static screen has nothing to judge
+    if (!rendered) return false;
+
+    if (window_frames == 0) window_start = now;
+
+    window_fill += fill_seconds;
+    window_max_fill = std::max(window_max_fill, fill_seconds);
+    if (fill_seconds > budget) ++window_missed;
+    ++window_frames;
+
+    if (now - window_start < WINDOW_SECONDS) return false;
+
+    const double missed = static_cast<double>(window_missed) / window_frames;
+    const double mean = window_fill / window_frames;
+    const double slowest = window_max_fill;
+
+    window_frames = 0;
+    window_missed = 0;
+    window_fill = 0.0;
+    window_max_fill = 0.0;
+
+    ++since_restore;
+
+    const double scale = get_scale();
+
+    char reason[48];
+
+    if (missed >= MISSED_SHARE)
+    {
+        headroom_windows = 0;
+
+        if (step >= max_step) return false;
+
+        // The area, which brings the mean fill into the budget - at least one step
+        const double wanted = scale * std::sqrt(budget / mean);
+        const int next = std::clamp(static_cast<int>(std::ceil((1.0 - wanted) / STEP - 0.001)), step + 1, max_step);
+
+        // Lost right after its restore - the next restore waits twice as long
+        if (steps_up > 0 && since_restore <= restore_windows) restore_windows = std::min(restore_windows * 2, MAX_RESTORE_WINDOWS);
+        else restore_windows = RESTORE_WINDOWS;
+
+        std::snprintf(reason, sizeof(reason), "%d%% over %.1f ms", static_cast<int>(missed * 100.0 + 0.5), budget * 1000.0);
+
+        change_step(next, reason);
+        return true;
+    }
+
+    if (step == 0) return false;
+
+    // The slowest frame at the area of the step above
+    const double above = scale + STEP;
+    const double predicted = slowest * (above * above) / (scale * scale);
+
+    if (predicted < RESTORE_LOAD * budget) ++headroom_windows;
+    else headroom_windows = 0;
+
+    if (headroom_windows < restore_windows) return false;
+
+    std::snprintf(reason, sizeof(reason), "max %.1f ms", slowest * 1000.0);
+
+    change_step(step - 1, reason);
+    since_restore = 0;
+    return true;
+}
+
+
+void Resolution_scaler::change_step(int next, const char* reason)
+{
+    const bool down = next > step;
+
+    step = next;
+
+    if (down) ++steps_down;
+    else ++steps_up;
+
+    // The next step is judged at the new scale only
+    headroom_windows = 0;
+
+    SDL_Log("Resolution %s to %.1f%% (%s)", down ? "down" : "up", get_scale() * 100.0f, reason);
+}
+
+
+void Resolution_scaler::dump(std::ostream& out) const
+{
+    if (budget <= 0.0) return;
+
+    out << "=== Dynamic resolution ===\n";
+
+    out << std::fixed << std::setprecision(1);
+
+    out << "Fill budget " << budget * 1000.0 << " ms, " << steps_down << " step(s) down, " << steps_up << " up, final scale "
+        << get_scale() * 100.0f << "%\n";
+
+    for (int i = 0; i <= max_step; ++i)
+        out << "  " << std::setw(6) << (1.0f - static_cast<float>(i) * STEP) * 100.0f << "%: " << step_seconds[i] << " s\n";
+
+    out << std::defaultfloat;
+}
+
+// =========================================================================================== RESOLUTION SCALER
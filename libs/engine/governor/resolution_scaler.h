@@ -0,0 +1,126 @@
+// resolution_scaler.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+#include <iosfwd>
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== RESOLUTION SCALER
+
+
+/**
+ * @brief Steps the resolution of the frame target down when the fill time is over its budget,
+ *        and back up with the headroom (the dynamic resolution).
+ *
+ * The fill time of a frame is the drawing of the states and the overlays, the upscale and
+ * the flush of the queued draws (Frame::flush()) - plus the present without the vsync, where
+ * a GPU driver finishes its queue. It follows the pixels drawn, so a smaller frame target
+ * takes it down without touching the gameplay: the states still draw in the logical units,
+ * the target is upscaled to the output at the present (Frame::set_render_scale()).
+ *
+ * The scale goes in the steps of STEP (1, 7/8, 3/4 .. the minimum), each window (half a
+ * second) is judged:
+ *
+ * - over - at least MISSED_SHARE of its frames were over the budget: the scale steps down at
+ *   once, as many steps as the mean fill of the window needs (the fill goes with the area);
+ *
+ * - headroom - its slowest frame, at the area of the step above, still fits into RESTORE_LOAD
+ *   of the budget; RESTORE_WINDOWS such windows in a row step up by one. A step lost again
+ *   right after its restore doubles the wait of the next restore - the image doesn't pump.
+ *
+ * The scaler only decides - the application applies the scale to the Frame and logs it.
+ *
+ * Usage (done by SDL_app_init / SDL_app_cycle, if sdl_app_ctx::enable_dynamic_resolution is set):
+ * @code
+ * scaler.set_budget(0.6 / 60.0);
+ * if (scaler.update(fill_seconds, presented)) Frame::Instance().set_render_scale(r, scaler.get_scale());
+ * @endcode
+ */
+class Resolution_scaler
+{
+
+public:
+
+    // Evaluation window, seconds
+    static constexpr double WINDOW_SECONDS = 0.5;
+
+    // Share of the frames over the budget, which steps the scale down
+    static constexpr double MISSED_SHARE = 0.2;
+
+    // Predicted load of the step above to the budget, and the windows per step up
+    static constexpr double RESTORE_LOAD = 0.8;
+    static constexpr int RESTORE_WINDOWS = 4;
+
+    // Longest restore wait after the bounces, windows
+    static constexpr int MAX_RESTORE_WINDOWS = 64;
+
+    // Scale of a step, a multiple of it is exact at the usual logical sizes
+    static constexpr float STEP = 0.125f;
+
+
+    // Fill budget of a frame in seconds, 0 - the scaler does nothing
+    void set_budget(double seconds);
+
+    // Smallest scale (a step multiple, at least STEP)
+    void set_min_scale(float scale);
+
+    /**
+     * @brief Adds the frame to the window, judges the window at its end.
+     *
+     * @param fill_seconds Fill time of the frame.
+     * @param rendered     A frame was drawn - the cycles without one don't count.
+     * @return true if the scale changed - apply it.
+     */
+    bool update(double fill_seconds, bool rendered);
+
+
+    // Scale of the frame target, 1 - the logical resolution
+    float get_scale() const { return 1.0f - static_cast<float>(step) * STEP; }
+
+    // Prints the time at every scale and the steps
+    void dump(std::ostream& out) const;
+
+
+private:
+
+    // Deepest step of the minimum scale
+    static constexpr int MAX_STEPS = 7;
+
+    // Moves to the step, logs the reason
+    void change_step(int next, const char* reason);
+
+
+    double budget = 0.0;
+    int max_step = 4;
+    int step = 0;
+
+    // Current window
+    double window_start = 0.0;
+    double window_fill = 0.0;
+    double window_max_fill = 0.0;
+    int window_frames = 0;
+    int window_missed = 0;
+
+    // Windows in a row with the headroom
+    int headroom_windows = 0;
+
+    // Windows of headroom the next step up waits for, and the windows since the last step up
+    int restore_windows = RESTORE_WINDOWS;
+    int since_restore = 0;
+
+    double last_update = 0.0;
+
+    // Seconds at every step, the decisions (the report)
+    double step_seconds[MAX_STEPS + 1] = {};
+    std::uint64_t steps_down = 0;
+    std::uint64_t steps_up = 0;
+};
+
+// =========================================================================================== RESOLUTION SCALER
@@ -0,0 +1,96 @@
+// hash_key.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "hash_key.h"
+
+#ifndef NDEBUG
+
+#include "../platform/platform.h"
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#endif
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== HASH KEY NAMES
+
+#ifndef NDEBUG
+
+namespace
+{
+    struct Name_table
+    {
+        // The loader workers can record too
+        std::mutex lock;
+        std::unordered_map<Hash_key, std::string> names;
+        size_t collisions = 0;
+    };
+
+    Name_table& get_table()
+    {
+        static Name_table table;
+        return table;
+    }
+}
+
+
+bool Hash_key_names::record(Hash_key key, std::string_view name)
+{
+    Name_table& table = get_table();
+    std::lock_guard<std::mutex> guard(table.lock);
+
+    auto it = table.names.find(key);
+
+    if (it == table.names.end())
+    {
+        table.names.emplace(key, std::string(name));
+        return true;
+    }
+
+    if (it->second == name) return true;
+
+    ++table.collisions;
+
+    SDL_Log("Hash key collision 0x%08X: \"%s\" and \"%.*s\"", key.value, it->second.c_str(), static_cast<int>(name.size()), name.data());
+    return false;
+}
+
+
+const char* Hash_key_names::find(Hash_key key)
+{
+    Name_table& table = get_table();
+    std::lock_guard<std::mutex> guard(table.lock);
+
+    auto it = table.names.find(key);
+
+    // The names are never removed - the pointer stays valid
+    return it != table.names.end() ? it->second.c_str() : "";
+}
+
+
+size_t Hash_key_names::get_count()
+{
+    Name_table& table = get_table();
+    std::lock_guard<std::mutex> guard(table.lock);
+
+    return table.names.size();
+}
+
+
+size_t Hash_key_names::get_collision_count()
+{
+    Name_table& table = get_table();
+    std::lock_guard<std::mutex> guard(table.lock);
+
+    return table.collisions;
+}
+
+#endif
+
+// =========================================================================================== HASH KEY NAMES
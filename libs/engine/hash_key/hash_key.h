@@ -0,0 +1,115 @@
+// hash_key.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== HASH KEY
+
+// 32-bit FNV-1a of the bytes - constexpr, so the literal keys are hashed by the compiler
+constexpr std::uint32_t fnv1a(const char* text, size_t length)
+{
+    std::uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < length; ++i)
+    {
+        hash ^= static_cast<std::uint8_t>(text[i]);
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+
+/**
+ * @brief Name (asset path, string key) reduced to its FNV-1a hash.
+ *
+ * The lookups by a key compare and hash one integer, the name is never touched again.
+ * A constexpr key of a literal costs nothing at runtime:
+ *
+ * @code
+ * constexpr Hash_key HERO = "assets/hero.bmp"_key;
+ *
+ * static_assert(HERO == Hash_key("assets/hero.bmp"), "same hash at runtime");
+ * @endcode
+ *
+ * Two names of one hash are caught by Hash_key_names in the debug builds
+ * (and by miyoo_string_cooker for the string keys) - the release trusts the hash.
+ */
+struct Hash_key
+{
+    std::uint32_t value = 0;
+
+    constexpr Hash_key() = default;
+
+    constexpr explicit Hash_key(std::string_view name) : value(fnv1a(name.data(), name.size())) {}
+
+    constexpr bool operator==(Hash_key other) const { return value == other.value; }
+    constexpr bool operator!=(Hash_key other) const { return value != other.value; }
+    constexpr bool operator<(Hash_key other) const { return value < other.value; }
+};
+
+
+// "name"_key - the key of a literal
+constexpr Hash_key operator""_key(const char* name, size_t length) { return Hash_key(std::string_view(name, length)); }
+
+
+// The hash is already uniform - used as it is
+namespace std
+{
+    template <>
+    struct hash<Hash_key>
+    {
+        size_t operator()(Hash_key key) const { return key.value; }
+    };
+}
+
+// =========================================================================================== HASH KEY
+
+
+// =========================================================================================== HASH KEY NAMES
+
+
+/**
+ * @brief Debug reverse table of the keys: the hash back to its name, the collisions.
+ *
+ * The owners of the keys record the names they see (the Asset_manager - every path),
+ * a second name of a recorded hash is logged as a collision. Without NDEBUG only -
+ * the release build has empty inline functions and no table.
+ */
+class Hash_key_names
+{
+
+public:
+
+#ifndef NDEBUG
+
+    // Records the name of the key, false (and a log) if the hash has another name
+    static bool record(Hash_key key, std::string_view name);
+
+    // Recorded name of the key, "" if unknown
+    static const char* find(Hash_key key);
+
+    // Number of the recorded names and of the found collisions
+    static size_t get_count();
+    static size_t get_collision_count();
+
+#else
+
+    static bool record(Hash_key, std::string_view) { return true; }
+    static const char* find(Hash_key) { return ""; }
+    static size_t get_count() { return 0; }
+    static size_t get_collision_count() { return 0; }
+
+#endif
+};
+
+// =========================================================================================== HASH KEY NAMES
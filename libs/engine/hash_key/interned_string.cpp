@@ -0,0 +1,129 @@
+// interned_string.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "interned_string.h"
+
+#include <algorithm>
+#include <cstring>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== INTERNED STRING
+
+// The empty name - outside the blocks, so a default handle needs no interner
+static const Interned_record EMPTY_RECORD = {"", 0, 0, Hash_key(std::string_view())};
+
+
+Interned_string::Interned_string() : record(&EMPTY_RECORD) {}
+
+
+Interned_string::Interned_string(std::string_view name) : Interned_string(String_interner::Instance().intern(name)) {}
+
+
+String_interner& String_interner::Instance()
+{
+    // Never destroyed - the handles kept by the other singletons stay valid through their destructors
+    static String_interner* instance = new String_interner();
+    return *instance;
+}
+
+
+String_interner::String_interner()
+{
+    table.emplace(std::string_view(), &EMPTY_RECORD);
+}
+
+
+const char* String_interner::store(std::string_view name)
+{
+    const size_t bytes = name.size() + 1;
+
+    if (text_used + bytes > TEXT_BLOCK_BYTES)
+    {
+        const size_t block_bytes = std::max(bytes, TEXT_BLOCK_BYTES);
+
+        text_blocks.emplace_back(new char[block_bytes]);
+        text_reserved += block_bytes;
+
+        // A long name fills its own block, the next one starts a new block
+        text_used = 0;
+    }
+
+    char* text = text_blocks.back().get() + text_used;
+
+    std::memcpy(text, name.data(), name.size());
+    text[name.size()] = '\0';
+
+    text_used += bytes;
+
+    return text;
+}
+
+
+Interned_string String_interner::intern(std::string_view name)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    auto it = table.find(name);
+
+    if (it != table.end()) return Interned_string(it->second);
+
+    // The IDs from 1 - the records after the empty one
+    const std::uint32_t id = ++count;
+    const size_t index = id - 1;
+
+    if (index % RECORD_BLOCK_SIZE == 0) record_blocks.emplace_back(new Interned_record[RECORD_BLOCK_SIZE]);
+
+    Interned_record& record = record_blocks.back()[index % RECORD_BLOCK_SIZE];
+
+    record.text = store(name);
+    record.length = static_cast<std::uint32_t>(name.size());
+    record.id = id;
+    record.key = Hash_key(name);
+
+    // The key views the stored copy - the caller's characters can go
+    table.emplace(std::string_view(record.text, record.length), &record);
+
+    return Interned_string(&record);
+}
+
+
+Interned_string String_interner::find(std::string_view name) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    auto it = table.find(name);
+
+    return it != table.end() ? Interned_string(it->second) : Interned_string();
+}
+
+
+Interned_string String_interner::get(std::uint32_t id) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (id == 0 || id > count) return Interned_string();
+
+    return Interned_string(&record_blocks[(id - 1) / RECORD_BLOCK_SIZE][(id - 1) % RECORD_BLOCK_SIZE]);
+}
+
+
+size_t String_interner::get_count() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    return count + 1;
+}
+
+
+size_t String_interner::get_reserved_bytes() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    return text_reserved + record_blocks.size() * RECORD_BLOCK_SIZE * sizeof(Interned_record);
+}
+
+// =========================================================================================== INTERNED STRING
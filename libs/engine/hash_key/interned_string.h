@@ -0,0 +1,150 @@
+// interned_string.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include "hash_key.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== INTERNED STRING
+
+
+// One interned name - its characters (terminated), the length, the hash key and the ID
+struct Interned_record
+{
+    const char* text;
+    std::uint32_t length;
+    std::uint32_t id;
+    Hash_key key;
+};
+
+
+/**
+ * @brief Name (state name, asset path) stored once for the whole run.
+ *
+ * A handle of one pointer to the record of the String_interner: the copies copy the
+ * pointer, two equal names are one record - the comparison is a pointer compare. The
+ * characters never move, view() and c_str() stay valid until the exit.
+ *
+ * The default handle is the empty name (ID 0).
+ *
+ * Usage:
+ * @code
+ * Interned_string name("Main menu");
+ *
+ * name == Interned_string("Main menu");  // true - the same record
+ * SDL_Log("%s", name.c_str());
+ * @endcode
+ */
+class Interned_string
+{
+
+public:
+
+    Interned_string();
+
+    // Interns the name (a lookup, the first time a copy into the interner's storage)
+    explicit Interned_string(std::string_view name);
+
+
+    const char* c_str() const { return record->text; }
+    std::string_view view() const { return std::string_view(record->text, record->length); }
+    operator std::string_view() const { return view(); }
+
+    size_t size() const { return record->length; }
+    bool empty() const { return record->length == 0; }
+
+    // Dense ID of the name (0 - the empty one), the Hash_key of its characters
+    std::uint32_t get_id() const { return record->id; }
+    Hash_key get_key() const { return record->key; }
+
+    bool operator==(Interned_string other) const { return record == other.record; }
+    bool operator!=(Interned_string other) const { return record != other.record; }
+
+
+private:
+
+    explicit Interned_string(const Interned_record* record) : record(record) {}
+
+    const Interned_record* record;
+
+    friend class String_interner;
+};
+
+
+/**
+ * @brief Engine table of the interned names - every distinct name stored once.
+ *
+ * The characters are appended to 4 KB blocks (a longer name gets its own block), the
+ * records to a growing list of the fixed arrays - nothing is moved or freed until the
+ * exit, so the handles and the views need no lifetime. The names are few (the states,
+ * the asset paths) and interned on the creation of their owner, never per frame.
+ *
+ * Singleton, the interning and the lookups are locked (the loader workers can create the
+ * assets); reading a handle needs no lock - a record is immutable once published. The
+ * instance is never destroyed: the other singletons hold the handles in their destructors.
+ */
+class String_interner
+{
+
+public:
+
+    // Returns the singleton instance.
+    static String_interner& Instance();
+
+
+    // Handle of the name, interned on its first use
+    Interned_string intern(std::string_view name);
+
+    // Handle of an already interned name, the empty one if it is unknown (nothing is stored)
+    Interned_string find(std::string_view name) const;
+
+    // Handle of the ID, the empty one if out of range
+    Interned_string get(std::uint32_t id) const;
+
+    // Distinct names, the empty one included
+    size_t get_count() const;
+
+    // Blocks of the characters and of the records, the lookup table aside
+    size_t get_reserved_bytes() const;
+
+
+private:
+
+    String_interner();
+
+    // Singleton - not copyable
+    String_interner(const String_interner&) = delete;
+    String_interner& operator=(const String_interner&) = delete;
+
+
+    static constexpr size_t TEXT_BLOCK_BYTES = 4096;
+    static constexpr size_t RECORD_BLOCK_SIZE = 256;
+
+    // Copies the characters (terminated) into the current text block
+    const char* store(std::string_view name);
+
+    mutable std::mutex lock;
+
+    std::unordered_map<std::string_view, const Interned_record*> table;
+
+    std::vector<std::unique_ptr<char[]>> text_blocks;
+    size_t text_used = TEXT_BLOCK_BYTES;
+    size_t text_reserved = 0;
+
+    std::vector<std::unique_ptr<Interned_record[]>> record_blocks;
+    std::uint32_t count = 0;
+};
+
+// =========================================================================================== INTERNED STRING
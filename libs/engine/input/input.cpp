@@ -0,0 +1,572 @@
+// input.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "input.h"
+#include "../platform/backend.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <vector>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== INPUT
+
+Input::Input() { reset_mapping(); }
+
+
+Input& Input::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Input instance;
+
+    return instance;
+}
+
+
+bool Input::process_event(const SDL_Event& e)
+{
+    Button b = BUTTON_COUNT;
+    bool down = false;
+
+    switch (e.type)
+    {
+        case SDL_KEYDOWN:
+        case SDL_KEYUP:
+            // Key repeats carry no new information for the held mask - drop them here
+            if (e.key.repeat) return true;
+
+            b = map_scancode(e.key.keysym.scancode);
+            down = e.type == SDL_KEYDOWN;
+            break;
+
+        case SDL_JOYBUTTONDOWN:
+        case SDL_JOYBUTTONUP:
+            // The pads are polled - their raw buttons would be the second copy of the press
+            if (is_controller(e.jbutton.which)) return true;
+
+            b = map_joystick_button(e.jbutton.button);
+            down = e.type == SDL_JOYBUTTONDOWN;
+            break;
+
+        // Only for the idle wake up (SDL_app_wait_idle) - the state is polled
+        case SDL_CONTROLLERBUTTONDOWN:
+        case SDL_CONTROLLERBUTTONUP:
+            return true;
+
+        case SDL_CONTROLLERDEVICEADDED:
+            open_controller(e.cdevice.which);
+            return true;
+
+        case SDL_CONTROLLERDEVICEREMOVED:
+            close_controller(e.cdevice.which);
+            return true;
+
+        default: return false;
+    }
+
+    if (b == BUTTON_COUNT) return false;
+
+    // The backend has seen the same key already
+    if (external_buttons) return true;
+
+    set_button(b, down);
+
+    if (e.type == SDL_KEYDOWN || e.type == SDL_KEYUP) key_held = down ? key_held | (1u << b) : key_held & ~(1u << b);
+
+    return true;
+}
+
+
+void Input::end_tick()
+{
+    snapshot.pressed = 0;
+    snapshot.released = 0;
+}
+
+
+void Input::reset()
+{
+    event_held = 0;
+    pad_held = 0;
+    key_held = 0;
+
+    // Everything held goes up with the falling edges (the pads are down again by the next poll)
+    update_held(0);
+}
+
+
+const Input_snapshot& Input::get_snapshot() const { return snapshot; }
+
+
+// === EXTERNAL BACKEND (Evdev_input, Input_recording) ===
+
+void Input::set_external_buttons(bool external) { external_buttons = external; }
+
+
+bool Input::has_external_buttons() const { return external_buttons; }
+
+
+void Input::apply_buttons(std::uint32_t held, std::uint32_t pressed, std::uint32_t released)
+{
+    snapshot.pressed |= pressed;
+    snapshot.released |= released;
+    snapshot.held = held;
+}
+
+
+void Input::set_snapshot(const Input_snapshot& new_snapshot) { snapshot = new_snapshot; }
+
+
+void Input::set_press_time_ns(Button b, std::uint64_t time_ns)
+{
+    if (b < BUTTON_COUNT) press_time_ns[b] = time_ns;
+}
+
+
+std::uint64_t Input::get_press_time_ns(Button b) const { return b < BUTTON_COUNT ? press_time_ns[b] : 0; }
+
+// === EXTERNAL BACKEND (Evdev_input, Input_recording) ===
+
+
+// === LATE LATCH ===
+
+void Input::latch_late(std::uint32_t backend_held)
+{
+    std::uint32_t held = backend_held;
+
+    if (!external_buttons)
+    {
+        // The keyboard state follows the pumped events - the events themselves wait for the next poll
+        SDL_PumpEvents();
+
+        int key_count = 0;
+        const Uint8* keys = SDL_GetKeyboardState(&key_count);
+
+        // The joystick buttons as of their events, the keys and the pads as of now
+        held = event_held & ~key_held;
+
+        for (int code = 0; code < key_count && code < SDL_NUM_SCANCODES; ++code)
+            if (keys[code] && scancode_map[code] != BUTTON_COUNT) held |= 1u << scancode_map[code];
+
+        if (controller_count > 0)
+        {
+            if (SDL_JoystickEventState(SDL_QUERY) == SDL_IGNORE) SDL_GameControllerUpdate();
+
+            held |= read_controllers();
+        }
+    }
+
+    late_snapshot.held = held;
+    late_snapshot.pressed = held & ~snapshot.held;
+    late_snapshot.released = snapshot.held & ~held;
+
+    late_latched = true;
+}
+
+
+void Input::clear_late_latch() { late_latched = false; }
+
+// === LATE LATCH ===
+
+
+void Input::disable_unused_events()
+{
+    static const Uint32 unused[] = {
+
+        SDL_DROPFILE, SDL_DROPTEXT, SDL_DROPBEGIN, SDL_DROPCOMPLETE,
+        SDL_SENSORUPDATE, SDL_CLIPBOARDUPDATE
+
+    };
+
+    for (Uint32 type : unused) SDL_EventState(type, SDL_IGNORE);
+
+    // The text and the pointer stay off until a state wants them
+    apply_event_interest(EVENT_DEFAULT);
+}
+
+
+void Input::apply_event_interest(Uint32 interest)
+{
+    static const Uint32 text[] = {SDL_TEXTEDITING, SDL_TEXTINPUT, SDL_KEYMAPCHANGED};
+
+    static const Uint32 pointer[] = {
+
+        SDL_MOUSEMOTION, SDL_MOUSEBUTTONDOWN, SDL_MOUSEBUTTONUP, SDL_MOUSEWHEEL,
+        SDL_FINGERDOWN, SDL_FINGERUP, SDL_FINGERMOTION,
+        SDL_MULTIGESTURE, SDL_DOLLARGESTURE, SDL_DOLLARRECORD
+
+    };
+
+    const int text_state = (interest & EVENT_TEXT) ? SDL_ENABLE : SDL_IGNORE;
+    const int pointer_state = (interest & EVENT_POINTER) ? SDL_ENABLE : SDL_IGNORE;
+
+    for (Uint32 type : text) SDL_EventState(type, text_state);
+    for (Uint32 type : pointer) SDL_EventState(type, pointer_state);
+
+    // Text input generates SDL_TEXTINPUT for every key - only a text field needs it
+    if (interest & EVENT_TEXT) SDL_StartTextInput();
+    else SDL_StopTextInput();
+}
+
+
+// === BUTTON MAPPING ===
+
+void Input::bind_scancode(SDL_Scancode code, Button b)
+{
+    if (static_cast<unsigned int>(code) >= SDL_NUM_SCANCODES) return;
+
+    scancode_map[code] = b;
+    ++mapping_revision;
+}
+
+
+void Input::bind_joystick_button(int index, Button b)
+{
+    if (static_cast<unsigned int>(index) < MAX_JOYSTICK_BUTTONS) joystick_map[index] = b;
+}
+
+
+void Input::bind_controller_button(SDL_GameControllerButton button, Button b)
+{
+    if (button > SDL_CONTROLLER_BUTTON_INVALID && button < SDL_CONTROLLER_BUTTON_MAX) controller_map[button] = b;
+}
+
+
+void Input::reset_mapping()
+{
+    for (Button& b : scancode_map) b = BUTTON_COUNT;
+    for (Button& b : joystick_map) b = BUTTON_COUNT;
+
+    ++mapping_revision;
+
+    bind_scancode(SDL_SCANCODE_UP, UP_BTN);
+    bind_scancode(SDL_SCANCODE_DOWN, DOWN_BTN);
+    bind_scancode(SDL_SCANCODE_LEFT, LEFT_BTN);
+    bind_scancode(SDL_SCANCODE_RIGHT, RIGHT_BTN);
+
+    bind_scancode(SDL_SCANCODE_SPACE, A_BTN);       // Miyoo A
+    bind_scancode(SDL_SCANCODE_LCTRL, B_BTN);       // Miyoo B
+    bind_scancode(SDL_SCANCODE_LSHIFT, X_BTN);      // Miyoo X
+    bind_scancode(SDL_SCANCODE_LALT, Y_BTN);        // Miyoo Y
+
+    bind_scancode(SDL_SCANCODE_RETURN, START_BTN);  // Miyoo START
+    bind_scancode(SDL_SCANCODE_RCTRL, SELECT_BTN);  // Miyoo SELECT
+
+    // Desktop extras
+    bind_scancode(SDL_SCANCODE_Z, A_BTN);
+    bind_scancode(SDL_SCANCODE_X, B_BTN);
+    bind_scancode(SDL_SCANCODE_BACKSPACE, SELECT_BTN);
+
+    // Any pad by the SDL game controller database - the same positions as the Miyoo buttons
+    for (Button& b : controller_map) b = BUTTON_COUNT;
+
+    bind_controller_button(SDL_CONTROLLER_BUTTON_A, A_BTN);
+    bind_controller_button(SDL_CONTROLLER_BUTTON_B, B_BTN);
+    bind_controller_button(SDL_CONTROLLER_BUTTON_X, X_BTN);
+    bind_controller_button(SDL_CONTROLLER_BUTTON_Y, Y_BTN);
+    bind_controller_button(SDL_CONTROLLER_BUTTON_BACK, SELECT_BTN);
+    bind_controller_button(SDL_CONTROLLER_BUTTON_START, START_BTN);
+    bind_controller_button(SDL_CONTROLLER_BUTTON_DPAD_UP, UP_BTN);
+    bind_controller_button(SDL_CONTROLLER_BUTTON_DPAD_DOWN, DOWN_BTN);
+    bind_controller_button(SDL_CONTROLLER_BUTTON_DPAD_LEFT, LEFT_BTN);
+    bind_controller_button(SDL_CONTROLLER_BUTTON_DPAD_RIGHT, RIGHT_BTN);
+
+    // Desktop gamepads without a controller mapping - the XInput order (A, B, X, Y, BACK, GUIDE, START)
+    bind_joystick_button(0, A_BTN);
+    bind_joystick_button(1, B_BTN);
+    bind_joystick_button(2, X_BTN);
+    bind_joystick_button(3, Y_BTN);
+    bind_joystick_button(4, SELECT_BTN);
+    bind_joystick_button(6, START_BTN);
+}
+
+
+bool Input::load_mapping(const std::string& path)
+{
+    std::vector<Uint8> text;
+
+    if (!Platform::Files::read_file(path.c_str(), text)) return false;
+
+    auto trim = [](std::string v)
+    {
+        const size_t first = v.find_first_not_of(" \t\r");
+        const size_t last = v.find_last_not_of(" \t\r");
+
+        return first == std::string::npos ? std::string() : v.substr(first, last - first + 1);
+    };
+
+    int line_number = 0;
+    size_t start = 0;
+
+    while (start < text.size())
+    {
+        size_t end = start;
+
+        while (end < text.size() && text[end] != '\n') ++end;
+
+        std::string line(reinterpret_cast<const char*>(text.data()) + start, end - start);
+
+        start = end + 1;
+        ++line_number;
+
+        const size_t comment = line.find('#');
+
+        if (comment != std::string::npos) line.resize(comment);
+
+        line = trim(line);
+
+        if (line.empty()) continue;
+
+        const size_t space = line.find_first_of(" \t");
+        const size_t equals = line.find('=');
+
+        if (space == std::string::npos || equals == std::string::npos || equals < space)
+        {
+            SDL_Log("Input mapping %s:%d: expected \"key NAME = BUTTON\" or \"joy INDEX = BUTTON\"", path.c_str(), line_number);
+            continue;
+        }
+
+        const std::string kind = line.substr(0, space);
+        const std::string source = trim(line.substr(space, equals - space));
+        const std::string target = trim(line.substr(equals + 1));
+
+        const Button b = target == "none" ? BUTTON_COUNT : button_from_name(target);
+
+        if (b == BUTTON_COUNT && target != "none")
+        {
+            SDL_Log("Input mapping %s:%d: unknown button %s", path.c_str(), line_number, target.c_str());
+            continue;
+        }
+
+        if (kind == "key")
+        {
+            const SDL_Scancode code = SDL_GetScancodeFromName(source.c_str());
+
+            if (code == SDL_SCANCODE_UNKNOWN) SDL_Log("Input mapping %s:%d: unknown key %s", path.c_str(), line_number, source.c_str());
+            else bind_scancode(code, b);
+        }
+        else if (kind == "joy")
+        {
+            char* parsed_end = nullptr;
+            const long index = std::strtol(source.c_str(), &parsed_end, 10);
+
+            if (parsed_end == source.c_str() || *parsed_end || index < 0 || index >= MAX_JOYSTICK_BUTTONS)
+                SDL_Log("Input mapping %s:%d: joystick button %s is out of 0 - %d", path.c_str(), line_number, source.c_str(), MAX_JOYSTICK_BUTTONS - 1);
+            else bind_joystick_button(static_cast<int>(index), b);
+        }
+        else if (kind == "pad")
+        {
+            const SDL_GameControllerButton button = SDL_GameControllerGetButtonFromString(source.c_str());
+
+            if (button == SDL_CONTROLLER_BUTTON_INVALID) SDL_Log("Input mapping %s:%d: unknown pad button %s", path.c_str(), line_number, source.c_str());
+            else bind_controller_button(button, b);
+        }
+        else SDL_Log("Input mapping %s:%d: unknown binding %s", path.c_str(), line_number, kind.c_str());
+    }
+
+    return true;
+}
+
+
+Button Input::button_from_name(const std::string& name)
+{
+    static const char* const names[BUTTON_COUNT] = {"START", "SELECT", "LEFT", "UP", "RIGHT", "DOWN", "Y", "X", "A", "B"};
+
+    std::string upper = name;
+
+    for (char& c : upper) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+
+    for (int b = 0; b < BUTTON_COUNT; ++b)
+        if (upper == names[b]) return static_cast<Button>(b);
+
+    return BUTTON_COUNT;
+}
+
+// === BUTTON MAPPING ===
+
+
+void Input::set_button(Button b, bool down)
+{
+    const std::uint32_t bit = 1u << b;
+
+    event_held = down ? event_held | bit : event_held & ~bit;
+
+    update_held(event_held | pad_held);
+}
+
+
+void Input::update_held(std::uint32_t held)
+{
+    snapshot.pressed |= held & ~snapshot.held;
+    snapshot.released |= snapshot.held & ~held;
+    snapshot.held = held;
+}
+
+
+// === GAME CONTROLLERS ===
+
+bool Input::open_controllers()
+{
+    if (controllers_open) return true;
+
+    if (SDL_InitSubSystem(SDL_INIT_GAMECONTROLLER) != 0)
+    {
+        SDL_Log("Game controller init failed: %s", SDL_GetError());
+        return false;
+    }
+
+    // The polled state is enough - no event per axis update
+    static const Uint32 polled[] = {
+
+        SDL_CONTROLLERAXISMOTION,
+        SDL_CONTROLLERTOUCHPADDOWN, SDL_CONTROLLERTOUCHPADMOTION, SDL_CONTROLLERTOUCHPADUP,
+        SDL_CONTROLLERSENSORUPDATE,
+        SDL_JOYAXISMOTION, SDL_JOYBALLMOTION, SDL_JOYHATMOTION
+
+    };
+
+    for (Uint32 type : polled) SDL_EventState(type, SDL_IGNORE);
+
+    controllers_open = true;
+
+    // The pads connected before the start come as the SDL_CONTROLLERDEVICEADDED events too,
+    // open_controller() skips the ones already open
+    for (int i = 0; i < SDL_NumJoysticks(); ++i) open_controller(i);
+
+    return true;
+}
+
+
+void Input::close_controllers()
+{
+    if (!controllers_open) return;
+
+    for (int i = 0; i < controller_count; ++i) SDL_GameControllerClose(controllers[i]);
+
+    controller_count = 0;
+    controllers_open = false;
+
+    pad_held = 0;
+    update_held(event_held);
+
+    SDL_QuitSubSystem(SDL_INIT_GAMECONTROLLER);
+}
+
+
+void Input::open_controller(int device_index)
+{
+    if (!controllers_open || !SDL_IsGameController(device_index)) return;
+
+    if (is_controller(SDL_JoystickGetDeviceInstanceID(device_index))) return;
+
+    if (controller_count >= MAX_CONTROLLERS)
+    {
+        SDL_Log("Game controller %s is ignored - %d pads are open", SDL_GameControllerNameForIndex(device_index), MAX_CONTROLLERS);
+        return;
+    }
+
+    SDL_GameController* pad = SDL_GameControllerOpen(device_index);
+
+    if (!pad)
+    {
+        SDL_Log("Game controller %d can't be opened: %s", device_index, SDL_GetError());
+        return;
+    }
+
+    controllers[controller_count++] = pad;
+
+    SDL_Log("Game controller: %s", SDL_GameControllerName(pad));
+}
+
+
+void Input::close_controller(SDL_JoystickID id)
+{
+    for (int i = 0; i < controller_count; ++i)
+    {
+        if (SDL_JoystickInstanceID(SDL_GameControllerGetJoystick(controllers[i])) != id) continue;
+
+        SDL_GameControllerClose(controllers[i]);
+
+        controllers[i] = controllers[--controller_count];
+        controllers[controller_count] = nullptr;
+
+        return;
+    }
+}
+
+
+bool Input::is_controller(SDL_JoystickID id) const
+{
+    for (int i = 0; i < controller_count; ++i)
+        if (SDL_JoystickInstanceID(SDL_GameControllerGetJoystick(controllers[i])) == id) return true;
+
+    return false;
+}
+
+
+std::uint32_t Input::read_controllers() const
+{
+    std::uint32_t held = 0;
+
+    for (int i = 0; i < controller_count; ++i)
+    {
+        SDL_GameController* pad = controllers[i];
+
+        for (int button = 0; button < SDL_CONTROLLER_BUTTON_MAX; ++button)
+        {
+            const Button b = controller_map[button];
+
+            if (b != BUTTON_COUNT && SDL_GameControllerGetButton(pad, static_cast<SDL_GameControllerButton>(button))) held |= 1u << b;
+        }
+
+        // Down past the threshold, up below its half - the previous state decides in between
+        auto stick = [&](SDL_GameControllerAxis axis, Button negative, Button positive)
+        {
+            const int value = SDL_GameControllerGetAxis(pad, axis);
+
+            const int neg_limit = (pad_held >> negative) & 1u ? stick_threshold / 2 : stick_threshold;
+            const int pos_limit = (pad_held >> positive) & 1u ? stick_threshold / 2 : stick_threshold;
+
+            if (value <= -neg_limit) held |= 1u << negative;
+            if (value >= pos_limit) held |= 1u << positive;
+        };
+
+        stick(SDL_CONTROLLER_AXIS_LEFTX, LEFT_BTN, RIGHT_BTN);
+        stick(SDL_CONTROLLER_AXIS_LEFTY, UP_BTN, DOWN_BTN);
+    }
+
+    return held;
+}
+
+
+std::uint32_t Input::poll_controllers()
+{
+    if (!controller_count || external_buttons) return 0;
+
+    // SDL_PumpEvents updates the joysticks only while any joystick event is on
+    if (SDL_JoystickEventState(SDL_QUERY) == SDL_IGNORE) SDL_GameControllerUpdate();
+
+    const std::uint32_t held = read_controllers();
+
+    const std::uint32_t new_pressed = held & ~pad_held & ~event_held;
+
+    pad_held = held;
+
+    update_held(event_held | pad_held);
+
+    return new_pressed;
+}
+
+
+int Input::get_controller_count() const { return controller_count; }
+
+
+void Input::set_stick_threshold(int threshold) { stick_threshold = threshold < 1 ? 1 : threshold > 32767 ? 32767 : threshold; }
+
+// === GAME CONTROLLERS ===
+
+// =========================================================================================== INPUT
@@ -0,0 +1,328 @@
+// input.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+#include <string>
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== INPUT SNAPSHOT
+
+
+/**
+ * @brief Compact state of all the buttons for a single simulation tick.
+ *
+ * Every mask is indexed by the Button enum (bit 1 << BUTTON):
+ *
+ * - held - the button is down right now;
+ *
+ * - pressed - the button went down since the previous tick (rising edge);
+ *
+ * - released - the button went up since the previous tick (falling edge).
+ *
+ * A press and a release inside the same tick are both kept, so short taps are never lost.
+ */
+struct Input_snapshot
+{
+    std::uint32_t held = 0;
+    std::uint32_t pressed = 0;
+    std::uint32_t released = 0;
+
+    bool is_held(Button b) const     { return (held >> b) & 1u; }
+    bool is_pressed(Button b) const  { return (pressed >> b) & 1u; }
+    bool is_released(Button b) const { return (released >> b) & 1u; }
+};
+
+static_assert(BUTTON_COUNT <= 32, "Input_snapshot masks hold up to 32 buttons");
+
+// =========================================================================================== INPUT SNAPSHOT
+
+
+// =========================================================================================== INPUT
+
+
+/**
+ * @brief Engine input layer - converts the SDL events into the Button snapshot.
+ *
+ * The application feeds every event into process_event() once; states never decode
+ * the raw SDL events, they read the snapshot:
+ *
+ * @code
+ * const Input_snapshot& in = Input::Instance().get_snapshot();
+ * if (in.is_pressed(A_BTN)) jump();
+ * @endcode
+ *
+ * The edges are cleared by end_tick() after every simulation tick, so every press
+ * is seen by exactly one state_update, even if the frame runs several ticks or none.
+ *
+ * The keys and the joystick buttons go through the flat mapping tables (load_mapping()),
+ * the cost per event is one indexed load, whatever the layout.
+ *
+ * Game controllers (SDL_GameController - the external pads) are not events: their
+ * axis events are turned off, poll_controllers() reads the state once per cycle into
+ * the same held mask (a button is held by a key or by a pad).
+ *
+ * Event types which nobody uses (mouse, touch, gestures, text input, drag and drop...)
+ * are turned off by disable_unused_events(), so they never fill the SDL queue. The text
+ * and the pointer come back by apply_event_interest(), while a state wants them.
+ *
+ * Singleton, like Lang_state.
+ */
+class Input
+{
+
+public:
+
+    // Returns the singleton instance.
+    static Input& Instance();
+
+
+    /**
+     * @brief Updates the snapshot by a single SDL event.
+     *
+     * @param e Event to process.
+     * @return true if the event was consumed by the input layer (a mapped button
+     *         or a key repeat), false if it should go further.
+     */
+    bool process_event(const SDL_Event& e);
+
+    // Clears the pressed/released edges - called after every simulation tick
+    void end_tick();
+
+    // Releases all of the buttons (focus lost, device sleep)
+    void reset();
+
+    // Snapshot for the current simulation tick
+    const Input_snapshot& get_snapshot() const;
+
+
+    // === EXTERNAL BACKEND (Evdev_input, Input_recording) ===
+
+    /**
+     * @brief The buttons come from a native backend, not from the SDL key events.
+     *
+     * process_event() still consumes the mapped keys, but ignores them - the same
+     * press is never seen twice.
+     */
+    void set_external_buttons(bool external);
+
+    bool has_external_buttons() const;
+
+    // Sets the held mask and adds the edges of the backend (since its last collect)
+    void apply_buttons(std::uint32_t held, std::uint32_t pressed, std::uint32_t released);
+
+    // Replaces the whole snapshot of the tick (Input_recording replay)
+    void set_snapshot(const Input_snapshot& new_snapshot);
+
+    // Press time of the button from the backend, in ns of its clock
+    void set_press_time_ns(Button b, std::uint64_t time_ns);
+
+    // Time of the last press of the button, in ns of CLOCK_MONOTONIC (0 - unknown, the SDL events)
+    std::uint64_t get_press_time_ns(Button b) const;
+
+    // === EXTERNAL BACKEND (Evdev_input, Input_recording) ===
+
+
+    // === LATE LATCH ===
+
+    /**
+     * @brief Re-samples the held buttons right before the render (main thread).
+     *
+     * The tick snapshot is taken at the top of the cycle - by the present it is a frame
+     * old. The late latch reads the devices once more after the update: the SDL keyboard
+     * state after SDL_PumpEvents() (the events stay queued for the next cycle), the pads,
+     * or the held mask of the external backend. The tick snapshot is not touched - the
+     * simulation and the recordings stay on the tick input, only the render can use the
+     * late one for the cheap visual corrections (a cursor, a predicted position).
+     *
+     * @param backend_held Held mask of the external backend (Evdev_input::get_held()), if it is on.
+     */
+    void latch_late(std::uint32_t backend_held = 0);
+
+    // Stops the late latching - the late snapshot is the tick one again (a replay, the option off)
+    void clear_late_latch();
+
+    /**
+     * @brief Input for the render: the late held mask, pressed / released against the tick snapshot.
+     *
+     * A press after the tick sampled the buttons is in pressed (the update sees it next cycle).
+     * Without latch_late() in this cycle it is the tick snapshot.
+     */
+    const Input_snapshot& get_late_snapshot() const { return late_latched ? late_snapshot : snapshot; }
+
+    bool is_late_latched() const { return late_latched; }
+
+    // === LATE LATCH ===
+
+
+    // Turns off the SDL event types, which are not used by the engine
+    void disable_unused_events();
+
+    // Turns the text and the pointer events on or off by the wanted Event_interest mask
+    // (State_machine::get_event_interest()) - the other categories are the engine's own
+    void apply_event_interest(Uint32 interest);
+
+
+    // === BUTTON MAPPING ===
+
+    // Joystick buttons in the mapping table (the higher ones are not mapped)
+    static constexpr int MAX_JOYSTICK_BUTTONS = 32;
+
+    /**
+     * @brief Maps the SDL scancode to the engine button - one indexed load of the flat table.
+     *
+     * Desktop keyboard layout and the Miyoo Mini buttons (the Onion OS keyboard
+     * codes) share the same table, remapped by load_mapping().
+     *
+     * @return Mapped button, or BUTTON_COUNT if the key is not mapped.
+     */
+    Button map_scancode(SDL_Scancode code) const
+    {
+        return static_cast<unsigned int>(code) < SDL_NUM_SCANCODES ? scancode_map[code] : BUTTON_COUNT;
+    }
+
+    // Same for the joystick button index (any joystick)
+    Button map_joystick_button(int index) const
+    {
+        return static_cast<unsigned int>(index) < MAX_JOYSTICK_BUTTONS ? joystick_map[index] : BUTTON_COUNT;
+    }
+
+    // Binds the key to the button, BUTTON_COUNT - unbinds it
+    void bind_scancode(SDL_Scancode code, Button b);
+
+    // Incremented by every key binding change - the evdev reader refreshes its copy of the table
+    std::uint32_t get_mapping_revision() const { return mapping_revision; }
+
+    void bind_joystick_button(int index, Button b);
+
+    // Back to the built-in layout (the Miyoo buttons and the desktop keys)
+    void reset_mapping();
+
+    /**
+     * @brief Loads the mapping from the text config, over the built-in layout.
+     *
+     * One binding per line, '#' starts a comment, a button could have several keys:
+     *
+     *     key Space = A          # SDL_GetScancodeName() names
+     *     key Left Ctrl = B
+     *     key Escape = none      # unbinds the key
+     *     joy 0 = A              # joystick button index
+     *     pad leftshoulder = X   # SDL_GameControllerGetStringForButton() names
+     *
+     * The buttons are START, SELECT, LEFT, UP, RIGHT, DOWN, Y, X, A, B. Main thread only
+     * (the evdev reader thread reads its own copy of the key table).
+     *
+     * @return false if the file can't be read - the built-in layout stays.
+     */
+    bool load_mapping(const std::string& path);
+
+    // Button by its config name (START, A...), BUTTON_COUNT if there is none
+    static Button button_from_name(const std::string& name);
+
+    // Game controller button binding, BUTTON_COUNT - unbinds it
+    void bind_controller_button(SDL_GameControllerButton button, Button b);
+
+    // === BUTTON MAPPING ===
+
+
+    // === GAME CONTROLLERS ===
+
+    // Pads read at once (the later ones are ignored)
+    static constexpr int MAX_CONTROLLERS = 4;
+
+    /**
+     * @brief Starts the game controller subsystem and opens the connected pads.
+     *
+     * The controller axis, touchpad and sensor events and the joystick axis, hat and
+     * ball events are turned off - the analog noise never reaches the queue. The rare
+     * button events stay only to wake the idle wait (consumed, the state is polled),
+     * the device added / removed ones - process_event() opens and closes the pads.
+     *
+     * @return false if the subsystem can't be started.
+     */
+    bool open_controllers();
+
+    void close_controllers();
+
+    /**
+     * @brief Reads every open pad into the snapshot - once per cycle, before the update ticks.
+     *
+     * The stick and the d-pad are the directions (the stick with a dead zone and
+     * a hysteresis, so the noise near the threshold doesn't toggle them).
+     *
+     * @return Buttons pressed by the pads since the previous poll.
+     */
+    std::uint32_t poll_controllers();
+
+    int get_controller_count() const;
+
+    // Stick deflection, at which the direction goes down (0 - 32767); it goes up at the half
+    void set_stick_threshold(int threshold);
+
+    // === GAME CONTROLLERS ===
+
+
+private:
+
+    // Private constructor - all buttons are up, the built-in layout
+    Input();
+
+    // Copying the singleton is not allowed
+    Input(const Input&) = delete;
+    Input& operator=(const Input&) = delete;
+
+    // Sets the button down / up with the edges
+    void set_button(Button b, bool down);
+
+    // Sets the held mask of the snapshot (the keys and the pads) with the edges
+    void update_held(std::uint32_t held);
+
+    // Opens the pad of the device index (SDL_CONTROLLERDEVICEADDED)
+    void open_controller(int device_index);
+
+    // Closes the pad of the instance id (SDL_CONTROLLERDEVICEREMOVED)
+    void close_controller(SDL_JoystickID id);
+
+    // The joystick is an open pad - its raw joystick events are the same buttons again
+    bool is_controller(SDL_JoystickID id) const;
+
+    // Held mask of the open pads right now (the stick hysteresis against the last poll)
+    std::uint32_t read_controllers() const;
+
+
+    Input_snapshot snapshot;
+
+    // Held by the events (keys, joysticks) and by the pads
+    std::uint32_t event_held = 0;
+    std::uint32_t pad_held = 0;
+
+    // Part of event_held from the keys - the late latch reads the keyboard state for it
+    std::uint32_t key_held = 0;
+
+    Input_snapshot late_snapshot;
+    bool late_latched = false;
+
+    SDL_GameController* controllers[MAX_CONTROLLERS] = {};
+    int controller_count = 0;
+    bool controllers_open = false;
+
+    int stick_threshold = 16000;
+
+    bool external_buttons = false;
+
+    std::uint64_t press_time_ns[BUTTON_COUNT] = {};
+
+    // Flat lookup tables, BUTTON_COUNT - not mapped
+    std::uint32_t mapping_revision = 0;
+    Button scancode_map[SDL_NUM_SCANCODES];
+    Button joystick_map[MAX_JOYSTICK_BUTTONS];
+    Button controller_map[SDL_CONTROLLER_BUTTON_MAX];
+};
+
+// =========================================================================================== INPUT
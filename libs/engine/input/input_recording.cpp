@@ -0,0 +1,243 @@
+// input_recording.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "input_recording.h"
+#include "../platform/backend.h"
+
+#include <cmath>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== INPUT RECORDING
+
+namespace
+{
+    constexpr Uint32 RECORDING_MAGIC = 0x5259494D;  // 'MIYR'
+    constexpr Uint32 RECORDING_VERSION = 1;
+    constexpr Uint32 RECORDING_HEADER_SIZE = 20;
+
+    Uint32 load_le32(const Uint8* p)
+    {
+        return static_cast<Uint32>(p[0]) | static_cast<Uint32>(p[1]) << 8 | static_cast<Uint32>(p[2]) << 16 | static_cast<Uint32>(p[3]) << 24;
+    }
+
+    void store_le32(Uint8* p, Uint32 value)
+    {
+        for (int i = 0; i < 4; ++i) p[i] = static_cast<Uint8>(value >> (8 * i));
+    }
+}
+
+
+// === RECORDING ===
+
+bool Input_recording::start_recording(const std::string& new_path, double new_sim_hz)
+{
+    stop();
+
+    path = new_path;
+    sim_hz = new_sim_hz;
+
+    stream.clear();
+    tick = 0;
+    last_record_tick = 0;
+    last_held = 0;
+
+    mode = Mode::RECORDING;
+
+    return true;
+}
+
+
+void Input_recording::record_tick(const Input_snapshot& snapshot)
+{
+    if (mode != Mode::RECORDING) return;
+
+    // Only the changes are stored - a held button without the edges is the previous record
+    if (snapshot.pressed || snapshot.released || snapshot.held != last_held)
+    {
+        write_varint(stream, tick - last_record_tick);
+        write_varint(stream, snapshot.held);
+        write_varint(stream, snapshot.pressed);
+        write_varint(stream, snapshot.released);
+
+        last_record_tick = tick;
+        last_held = snapshot.held;
+    }
+
+    ++tick;
+}
+
+
+bool Input_recording::is_recording() const { return mode == Mode::RECORDING; }
+
+
+void Input_recording::write_varint(std::vector<Uint8>& out, std::uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<Uint8>(value | 0x80));
+        value >>= 7;
+    }
+
+    out.push_back(static_cast<Uint8>(value));
+}
+
+// === RECORDING ===
+
+
+// === REPLAY ===
+
+bool Input_recording::start_replay(const std::string& new_path)
+{
+    stop();
+
+    std::vector<Uint8> file;
+
+    if (!Platform::Files::read_file(new_path.c_str(), file))
+    {
+        SDL_Log("Input recording %s can't be opened", new_path.c_str());
+        return false;
+    }
+
+    auto header = [&file](int field) { return load_le32(file.data() + field * 4); };
+
+    if (file.size() < RECORDING_HEADER_SIZE || header(0) != RECORDING_MAGIC || header(1) != RECORDING_VERSION || header(3) != BUTTON_COUNT)
+    {
+        SDL_Log("Input recording %s is not a recording of this build", new_path.c_str());
+        return false;
+    }
+
+    const Uint32 rate = header(2);
+    const Uint32 ticks = header(4);
+
+    stream.assign(file.begin() + RECORDING_HEADER_SIZE, file.end());
+
+    path = new_path;
+    sim_hz = rate / 1000.0;
+    tick_count = ticks;
+
+    tick = 0;
+    read_offset = 0;
+    last_record_tick = 0;
+    last_held = 0;
+
+    mode = Mode::REPLAYING;
+
+    has_next = read_record();
+
+    return true;
+}
+
+
+bool Input_recording::replay_tick(Input_snapshot& snapshot)
+{
+    if (mode != Mode::REPLAYING) return false;
+
+    // The end - everything held goes up once
+    if (tick >= tick_count)
+    {
+        snapshot.pressed = 0;
+        snapshot.released = last_held;
+        snapshot.held = 0;
+
+        last_held = 0;
+
+        return false;
+    }
+
+    if (has_next && next_tick == tick)
+    {
+        snapshot = next;
+        last_held = next.held;
+
+        has_next = read_record();
+    }
+    else
+    {
+        snapshot.held = last_held;
+        snapshot.pressed = 0;
+        snapshot.released = 0;
+    }
+
+    ++tick;
+
+    return true;
+}
+
+
+bool Input_recording::is_replaying() const { return mode == Mode::REPLAYING; }
+
+
+bool Input_recording::is_finished() const { return mode == Mode::REPLAYING && tick >= tick_count; }
+
+
+double Input_recording::get_recorded_sim_hz() const { return sim_hz; }
+
+
+bool Input_recording::read_varint(std::uint32_t& value)
+{
+    value = 0;
+
+    for (int shift = 0; shift < 35 && read_offset < stream.size(); shift += 7)
+    {
+        const Uint8 byte = stream[read_offset++];
+
+        value |= static_cast<std::uint32_t>(byte & 0x7F) << shift;
+
+        if (!(byte & 0x80)) return true;
+    }
+
+    return false;
+}
+
+
+bool Input_recording::read_record()
+{
+    std::uint32_t delta = 0;
+
+    if (!read_varint(delta) || !read_varint(next.held) || !read_varint(next.pressed) || !read_varint(next.released))
+        return false;
+
+    next_tick = last_record_tick + delta;
+    last_record_tick = next_tick;
+
+    return true;
+}
+
+// === REPLAY ===
+
+
+bool Input_recording::stop()
+{
+    const Mode stopped = mode;
+
+    mode = Mode::IDLE;
+
+    if (stopped != Mode::RECORDING) return true;
+
+    const Uint32 header[] = {RECORDING_MAGIC, RECORDING_VERSION, static_cast<Uint32>(std::lround(sim_hz * 1000.0)), BUTTON_COUNT, tick};
+
+    std::vector<Uint8> file(RECORDING_HEADER_SIZE);
+
+    for (int field = 0; field < 5; ++field) store_le32(file.data() + field * 4, header[field]);
+
+    file.insert(file.end(), stream.begin(), stream.end());
+
+    const bool ok = Platform::Files::write_file(path.c_str(), file.data(), file.size());
+
+    if (!ok) SDL_Log("Input recording %s write failed", path.c_str());
+    else SDL_Log("Input recording %s: %u ticks, %u bytes", path.c_str(), tick, static_cast<unsigned int>(stream.size()) + RECORDING_HEADER_SIZE);
+
+    return ok;
+}
+
+
+std::uint32_t Input_recording::get_tick() const { return tick; }
+
+
+std::uint32_t Input_recording::get_tick_count() const { return tick_count; }
+
+// =========================================================================================== INPUT RECORDING
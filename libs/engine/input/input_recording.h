@@ -0,0 +1,144 @@
+// input_recording.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "input.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== INPUT RECORDING
+
+
+/**
+ * @brief Per-tick Input_snapshot stream - recorded from the live play, replayed instead of it.
+ *
+ * The recording keeps the snapshot of every simulation tick, just before its state_update.
+ * The simulation runs by the fixed timestep, so the same stream gives the same ticks
+ * in every build - a benchmark workload, which doesn't depend on the player.
+ *
+ * The file is compact: only the ticks, which differ from "the same held mask, no edges",
+ * are stored - a varint tick delta and the three masks as varints, after a header:
+ *
+ *     u32 magic 'MIYR', u32 version, u32 sim_hz * 1000, u32 BUTTON_COUNT, u32 tick count
+ *
+ * All the integers are little endian. The stream is written into memory while playing
+ * and saved by stop() - the tick never touches the file.
+ *
+ * Usage (done by the app cycle, if sdl_app_ctx::input_record_path / input_replay_path is set):
+ * @code
+ * recording.start_recording("run.miyr", 60.0);
+ * recording.record_tick(Input::Instance().get_snapshot()); // every tick
+ * recording.stop();                                        // saves the file
+ *
+ * recording.start_replay("run.miyr");
+ * Input_snapshot s;
+ * if (recording.replay_tick(s)) Input::Instance().set_snapshot(s); // every tick
+ * @endcode
+ */
+class Input_recording
+{
+
+public:
+
+    Input_recording() = default;
+
+
+    // === RECORDING ===
+
+    /**
+     * @brief Starts a new recording, saved by stop() into the path.
+     *
+     * @param sim_hz Simulation rate, stored in the header - the replay warns on a different one.
+     */
+    bool start_recording(const std::string& path, double sim_hz);
+
+    // Adds the snapshot of the next tick
+    void record_tick(const Input_snapshot& snapshot);
+
+    bool is_recording() const;
+
+    // === RECORDING ===
+
+
+    // === REPLAY ===
+
+    /**
+     * @brief Loads the recorded stream for the replay.
+     *
+     * @return false if the file can't be read or is not a recording of this build's buttons.
+     */
+    bool start_replay(const std::string& path);
+
+    /**
+     * @brief Snapshot of the next tick.
+     *
+     * @return false after the last recorded tick - the snapshot is released then (nothing held).
+     */
+    bool replay_tick(Input_snapshot& snapshot);
+
+    bool is_replaying() const;
+
+    // All the recorded ticks are replayed
+    bool is_finished() const;
+
+    // Simulation rate of the recording (the header)
+    double get_recorded_sim_hz() const;
+
+    // === REPLAY ===
+
+
+    /**
+     * @brief Ends the recording (saves the file) or the replay.
+     *
+     * @return false if the recording can't be saved.
+     */
+    bool stop();
+
+    // Ticks recorded or replayed so far
+    std::uint32_t get_tick() const;
+
+    // Ticks in the loaded replay
+    std::uint32_t get_tick_count() const;
+
+
+private:
+
+    enum class Mode { IDLE, RECORDING, REPLAYING };
+
+    static void write_varint(std::vector<Uint8>& out, std::uint32_t value);
+    bool read_varint(std::uint32_t& value);
+
+    // Replay - reads the next stored tick, false at the end of the stream
+    bool read_record();
+
+
+    Mode mode = Mode::IDLE;
+
+    std::string path;
+    double sim_hz = 0.0;
+
+    // Encoded records (no header)
+    std::vector<Uint8> stream;
+    size_t read_offset = 0;
+
+    std::uint32_t tick = 0;
+    std::uint32_t tick_count = 0;
+
+    // Recording - the tick of the last stored record and its held mask
+    std::uint32_t last_record_tick = 0;
+    std::uint32_t last_held = 0;
+
+    // Replay - the next stored record
+    bool has_next = false;
+    std::uint32_t next_tick = 0;
+    Input_snapshot next;
+};
+
+// =========================================================================================== INPUT RECORDING
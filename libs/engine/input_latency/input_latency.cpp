@@ -0,0 +1,337 @@
+// input_latency.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "input_latency.h"
+#include "../engine_clock/engine_clock.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== LATENCY STATS
+
+double Latency_distribution::percentile_ms(double fraction) const
+{
+    if (count == 0) return 0.0;
+
+    const std::uint64_t wanted = static_cast<std::uint64_t>(fraction * static_cast<double>(count) + 0.5);
+
+    std::uint64_t seen = 0;
+
+    for (int b = 0; b < BUCKETS; ++b)
+    {
+        seen += buckets[b];
+
+        if (seen >= wanted && seen > 0) return b == BUCKETS - 1 ? max_ms : static_cast<double>(b + 1);
+    }
+
+    return max_ms;
+}
+
+// =========================================================================================== LATENCY STATS
+
+
+// =========================================================================================== INPUT LATENCY
+
+Input_latency& Input_latency::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Input_latency instance;
+
+    return instance;
+}
+
+
+// === RECORDING (app cycle) ===
+
+void Input_latency::begin_cycle()
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    ++cycle;
+}
+
+
+void Input_latency::on_event(Button b, Uint64 origin)
+{
+    const Uint64 now = Engine_clock::now();
+
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (pending_count >= MAX_PENDING)
+    {
+        ++dropped;
+        return;
+    }
+
+    // The origin of the coarse clocks could round past the event
+    pending[pending_count++] = {b, std::min(origin, now), now, 0, false, 0};
+}
+
+
+void Input_latency::on_update(std::uint32_t pressed, bool pipelined)
+{
+    if (!pressed) return;
+
+    const Uint64 now = Engine_clock::now();
+
+    std::lock_guard<std::mutex> guard(lock);
+
+    for (int i = 0; i < pending_count; ++i)
+    {
+        Press& p = pending[i];
+
+        if (p.updated || !((pressed >> p.button) & 1u)) continue;
+
+        p.update = now;
+        p.updated = true;
+
+        // The render of this cycle draws the state published before the pipelined update
+        p.visible_cycle = pipelined ? cycle + 1 : cycle;
+
+        record(QUEUE, p.origin, p.event);
+        record(UPDATE, p.event, p.update);
+    }
+}
+
+
+void Input_latency::on_present(Uint64 frame)
+{
+    const Uint64 now = Engine_clock::now();
+    const double to_ms = 1000.0 / static_cast<double>(Engine_clock::frequency());
+
+    std::lock_guard<std::mutex> guard(lock);
+
+    Latency_frame shown;
+
+    shown.frame = frame;
+
+    int kept = 0;
+
+    for (int i = 0; i < pending_count; ++i)
+    {
+        const Press& p = pending[i];
+
+        if (!p.updated || p.visible_cycle > cycle)
+        {
+            pending[kept++] = p;
+            continue;
+        }
+
+        record(PRESENT, p.update, now);
+        record(TOTAL, p.origin, now);
+
+        const double total = static_cast<double>(now - p.origin) * to_ms;
+
+        shown.min_ms = shown.presses ? std::min(shown.min_ms, total) : total;
+        shown.max_ms = std::max(shown.max_ms, total);
+        ++shown.presses;
+    }
+
+    pending_count = kept;
+
+    if (!shown.presses) return;
+
+    recent[recent_next] = shown;
+    recent_next = (recent_next + 1) % RECENT_FRAMES;
+    recent_count = std::min(recent_count + 1, RECENT_FRAMES);
+}
+
+
+void Input_latency::on_unchanged_frame()
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    int kept = 0;
+
+    for (int i = 0; i < pending_count; ++i)
+    {
+        if (pending[i].updated && pending[i].visible_cycle <= cycle) ++unseen;
+        else pending[kept++] = pending[i];
+    }
+
+    pending_count = kept;
+}
+
+
+void Input_latency::record(Stage stage, Uint64 from, Uint64 to)
+{
+    const double ms = static_cast<double>(to - from) * 1000.0 / static_cast<double>(Engine_clock::frequency());
+
+    Latency_distribution& d = stages[stage];
+
+    const int bucket = std::min(static_cast<int>(ms), Latency_distribution::BUCKETS - 1);
+
+    ++d.buckets[bucket];
+    ++d.count;
+
+    total_ms[stage] += ms;
+
+    d.mean_ms = total_ms[stage] / static_cast<double>(d.count);
+    d.max_ms = std::max(d.max_ms, ms);
+}
+
+// === RECORDING (app cycle) ===
+
+
+// === CLOCKS ===
+
+Uint64 Input_latency::from_ticks(Uint32 ticks)
+{
+    const Uint64 now = Engine_clock::now();
+    const Uint32 age_ms = SDL_GetTicks() - ticks;
+
+    const Uint64 age = static_cast<Uint64>(age_ms) * Engine_clock::frequency() / 1000;
+
+    return age < now ? now - age : 0;
+}
+
+
+Uint64 Input_latency::from_age_ns(std::uint64_t age_ns)
+{
+    const Uint64 now = Engine_clock::now();
+
+    const Uint64 age = static_cast<Uint64>(static_cast<double>(age_ns) * static_cast<double>(Engine_clock::frequency()) / 1e9);
+
+    return age < now ? now - age : 0;
+}
+
+// === CLOCKS ===
+
+
+// === REPORT ===
+
+void Input_latency::set_mode(const std::string& new_mode)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    mode = new_mode;
+}
+
+
+Latency_distribution Input_latency::get_stats(Stage stage) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    return stage < STAGE_COUNT ? stages[stage] : Latency_distribution{};
+}
+
+
+int Input_latency::get_recent_frames(Latency_frame* out) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    const int first = (recent_next - recent_count + RECENT_FRAMES) % RECENT_FRAMES;
+
+    for (int i = 0; i < recent_count; ++i) out[i] = recent[(first + i) % RECENT_FRAMES];
+
+    return recent_count;
+}
+
+
+std::uint64_t Input_latency::get_dropped_count() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    return dropped;
+}
+
+
+std::uint64_t Input_latency::get_unseen_count() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    return unseen;
+}
+
+
+void Input_latency::reset()
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    pending_count = 0;
+
+    for (int s = 0; s < STAGE_COUNT; ++s)
+    {
+        stages[s] = Latency_distribution{};
+        total_ms[s] = 0.0;
+    }
+
+    recent_next = 0;
+    recent_count = 0;
+    dropped = 0;
+    unseen = 0;
+}
+
+
+void Input_latency::dump(std::ostream& out) const
+{
+    static const char* const names[STAGE_COUNT] = {"input -> event", "event -> update", "update -> present", "total"};
+
+    Latency_distribution stats[STAGE_COUNT];
+
+    for (int s = 0; s < STAGE_COUNT; ++s) stats[s] = get_stats(static_cast<Stage>(s));
+
+    Latency_frame frames[RECENT_FRAMES];
+
+    const int frame_count = get_recent_frames(frames);
+
+    out << "=== Input latency ===\n";
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        if (!mode.empty()) out << "Mode: " << mode << "\n";
+    }
+
+    if (!stats[TOTAL].count)
+    {
+        out << "No presses shown\n";
+        return;
+    }
+
+    out << "Presses: " << stats[TOTAL].count << " shown, " << get_unseen_count() << " without a visible change, "
+        << get_dropped_count() << " dropped\n";
+
+    out << std::fixed << std::setprecision(2);
+
+    for (int s = 0; s < STAGE_COUNT; ++s)
+    {
+        const Latency_distribution& d = stats[s];
+
+        out << "  " << std::left << std::setw(18) << names[s] << std::right
+            << " mean " << std::setw(7) << d.mean_ms << " ms, p50 " << std::setw(6) << d.percentile_ms(0.5)
+            << ", p95 " << std::setw(6) << d.percentile_ms(0.95) << ", p99 " << std::setw(6) << d.percentile_ms(0.99)
+            << ", max " << std::setw(7) << d.max_ms << " ms\n";
+    }
+
+    out << "Total latency histogram (ms):\n";
+
+    for (int b = 0; b < Latency_distribution::BUCKETS; ++b)
+    {
+        if (stats[TOTAL].buckets[b] == 0) continue;
+
+        out << "  [" << b << ", ";
+
+        if (b == Latency_distribution::BUCKETS - 1) out << "inf";
+        else out << b + 1;
+
+        out << "): " << stats[TOTAL].buckets[b] << "\n";
+    }
+
+    out << "Recent frames with presses (frame: presses, min - max ms):\n";
+
+    for (int i = 0; i < frame_count; ++i)
+        out << "  " << frames[i].frame << ": " << frames[i].presses << ", " << frames[i].min_ms << " - " << frames[i].max_ms << "\n";
+
+    out << std::defaultfloat;
+}
+
+// === REPORT ===
+
+// =========================================================================================== INPUT LATENCY
@@ -0,0 +1,228 @@
+// input_latency.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== LATENCY STATS
+
+
+/**
+ * @brief Distribution of one stage of the input latency (Input_latency::get_stats()).
+ *
+ * The histogram has 1 ms buckets, the last bucket takes the rest - the percentiles
+ * are the upper bounds of their buckets, the mean and the max are exact.
+ */
+struct Latency_distribution
+{
+    static constexpr int BUCKETS = 100;
+
+    std::uint64_t count = 0;
+    std::uint64_t buckets[BUCKETS] = {};
+
+    double mean_ms = 0.0;
+    double max_ms = 0.0;
+
+    // Upper bound of the bucket of the fraction (0.5 - the median), in ms
+    double percentile_ms(double fraction) const;
+};
+
+
+// Presses shown by one presented frame
+struct Latency_frame
+{
+    Uint64 frame = 0;       // Frame::get_presented_count() of the frame
+    int presses = 0;
+
+    double min_ms = 0.0;    // Press to present
+    double max_ms = 0.0;
+};
+
+// =========================================================================================== LATENCY STATS
+
+
+// =========================================================================================== INPUT LATENCY
+
+
+/**
+ * @brief Follows every button press from the input to the present, which shows its effect.
+ *
+ * A press is tagged by its origin time - the kernel time of the Evdev_input, or
+ * the SDL event timestamp - and by the performance counter of every later stage:
+ *
+ * - QUEUE - the origin to SDL_app_event (or the evdev collect of the cycle);
+ *
+ * - UPDATE - to the end of the first state_update, which saw the press edge;
+ *
+ * - PRESENT - to the return of the first SDL_RenderPresent (the framebuffer flip),
+ *   which drew the state of that update. The pipelined cycle draws the update of
+ *   a cycle in the next one - the press waits for that present;
+ *
+ * - TOTAL - the origin to the present.
+ *
+ * A press, which changed nothing (its frame is skipped as unchanged), is not measured.
+ * The scanout of the panel after the present is not seen from the software, it is the
+ * same for every mode - the vsync, the buffering and the pacing modes compare by the TOTAL.
+ * The report has the aggregate distribution of every stage and the last presented
+ * frames, which showed any press (get_recent_frames()).
+ *
+ * Thread-safe - the pipelined update ticks run on the worker thread.
+ *
+ * Singleton, like Startup_trace, so the app cycle records without any context.
+ *
+ * Usage (done by the app cycle):
+ * @code
+ * Input_latency& latency = Input_latency::Instance();
+ * latency.on_event(A_BTN, origin_counter);    // SDL_app_event
+ * latency.on_update(pressed_mask, pipelined); // after the state_update tick
+ * latency.on_present(presented_frame);        // after Frame::end()
+ * latency.dump(std::cout);                    // shutdown
+ * @endcode
+ */
+class Input_latency
+{
+
+public:
+
+    enum Stage { QUEUE, UPDATE, PRESENT, TOTAL, STAGE_COUNT };
+
+    // Presses in flight at once (the later are counted as dropped)
+    static constexpr int MAX_PENDING = 32;
+
+    // Presented frames with the presses kept for the report
+    static constexpr int RECENT_FRAMES = 32;
+
+
+    // Returns the singleton instance.
+    static Input_latency& Instance();
+
+
+    // === RECORDING (app cycle) ===
+
+    // Start of the application cycle (main thread)
+    void begin_cycle();
+
+    /**
+     * @brief The press reached the application.
+     *
+     * @param b      Pressed button.
+     * @param origin Performance counter of the input (from_ticks(), from_age_ns()).
+     */
+    void on_event(Button b, Uint64 origin);
+
+    /**
+     * @brief The state_update tick, which saw the pressed edges, is finished.
+     *
+     * @param pressed   Pressed mask of the tick (Input_snapshot::pressed).
+     * @param pipelined The tick runs in the pipelined cycle - drawn by the next cycle.
+     */
+    void on_update(std::uint32_t pressed, bool pipelined);
+
+    // The frame is presented (main thread, after Frame::end())
+    void on_present(Uint64 frame);
+
+    // The frame is skipped as unchanged - the updated presses had no visible effect, they are dropped
+    void on_unchanged_frame();
+
+    // === RECORDING (app cycle) ===
+
+
+    // === CLOCKS ===
+
+    // Performance counter of the SDL event timestamp (SDL_GetTicks() milliseconds)
+    static Uint64 from_ticks(Uint32 ticks);
+
+    // Performance counter of the time, which was age_ns ago (the kernel press time of the Evdev_input)
+    static Uint64 from_age_ns(std::uint64_t age_ns);
+
+    // === CLOCKS ===
+
+
+    // === REPORT ===
+
+    // Description of the measured mode (the vsync, the buffering, the pacing), printed by dump()
+    void set_mode(const std::string& mode);
+
+    // Distribution of the stage since the start (or the last reset())
+    Latency_distribution get_stats(Stage stage) const;
+
+    /**
+     * @brief The last presented frames with the presses, the oldest first.
+     *
+     * @param out Array of RECENT_FRAMES records at least.
+     * @return Number of the records.
+     */
+    int get_recent_frames(Latency_frame* out) const;
+
+    // Presses, which didn't fit the pending list
+    std::uint64_t get_dropped_count() const;
+
+    // Presses, which changed nothing on the screen
+    std::uint64_t get_unseen_count() const;
+
+    void reset();
+
+    // Prints the mode, the stage distributions and the recent frames
+    void dump(std::ostream& out) const;
+
+    // === REPORT ===
+
+
+private:
+
+    // Private constructor for singleton
+    Input_latency() = default;
+
+    // Copying the singleton is not allowed
+    Input_latency(const Input_latency&) = delete;
+    Input_latency& operator=(const Input_latency&) = delete;
+
+
+    struct Press
+    {
+        Button button;
+
+        Uint64 origin;
+        Uint64 event;
+        Uint64 update;
+
+        // Seen by a state_update - drawn by the first present of the visible_cycle or later
+        bool updated;
+        Uint64 visible_cycle;
+    };
+
+    // Adds the stage sample under the lock
+    void record(Stage stage, Uint64 from, Uint64 to);
+
+
+    Press pending[MAX_PENDING] = {};
+    int pending_count = 0;
+
+    Uint64 cycle = 0;
+
+    Latency_distribution stages[STAGE_COUNT];
+    double total_ms[STAGE_COUNT] = {};
+
+    Latency_frame recent[RECENT_FRAMES] = {};
+    int recent_next = 0;
+    int recent_count = 0;
+
+    std::uint64_t dropped = 0;
+    std::uint64_t unseen = 0;
+
+    std::string mode;
+
+    mutable std::mutex lock;
+};
+
+// =========================================================================================== INPUT LATENCY
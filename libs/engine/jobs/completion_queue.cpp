@@ -0,0 +1,77 @@
+// completion_queue.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "completion_queue.h"
+
+#include <ostream>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== COMPLETION QUEUE
+
+Completion_queue& Completion_queue::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Completion_queue instance;
+    return instance;
+}
+
+
+bool Completion_queue::post(Completion_fn run, void* context, std::uint64_t value)
+{
+    if (!run) return false;
+
+    if (!queue.push(Completion{run, context, value}))
+    {
+        refused.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    posted.fetch_add(1, std::memory_order_relaxed);
+
+    return true;
+}
+
+
+int Completion_queue::drain()
+{
+    // Only what is queued now - the completions of the handlers wait for the next drain
+    std::uint32_t remaining = queue.size();
+
+    if (remaining > max_depth) max_depth = remaining;
+
+    int total = 0;
+
+    while (remaining > 0)
+    {
+        Completion batch[BATCH];
+        std::uint32_t count = 0;
+
+        queue.pop_batch([&batch, &count](Completion&& c) { batch[count++] = c; }, remaining < BATCH ? remaining : BATCH);
+
+        // A claimed, still unwritten slot - the rest waits for the next frame
+        if (count == 0) break;
+
+        for (std::uint32_t i = 0; i < count; ++i) batch[i].run(batch[i].context, batch[i].value);
+
+        remaining -= count;
+        total += static_cast<int>(count);
+    }
+
+    run_count += static_cast<std::uint64_t>(total);
+
+    return total;
+}
+
+
+void Completion_queue::dump(std::ostream& out) const
+{
+    out << "=== Completions ===\n";
+    out << "Posted " << get_posted_count() << ", run " << run_count << ", refused (queue full) " << get_refused_count()
+        << ", max per frame " << max_depth << " of " << CAPACITY << "\n";
+}
+
+// =========================================================================================== COMPLETION QUEUE
@@ -0,0 +1,106 @@
+// completion_queue.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+#include <iosfwd>
+
+#include "mpsc_queue.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== COMPLETION QUEUE
+
+
+// Main thread handler of a completion: the context of the system and the value of the result
+using Completion_fn = void (*)(void* context, std::uint64_t value);
+
+
+// Result of a worker thread, handed back to the main thread - trivially copyable, no allocation
+struct Completion
+{
+    Completion_fn run = nullptr;
+    void* context = nullptr;
+    std::uint64_t value = 0;
+};
+
+
+/**
+ * @brief The one handoff of the worker results to the main thread.
+ *
+ * The asset loaders, the decoders and the other background threads post() a completion -
+ * a handler, its context and a value (the result pointer or the id) - from any thread, into
+ * the lock-free Mpsc_queue of CAPACITY. SDL_app_cycle drains it once per frame, at a fixed
+ * point before the asset pump and the states, so every async result lands in the same place
+ * of the frame and the handlers run on the main thread, where SDL and the states are safe.
+ *
+ * The drain takes the batches of up to BATCH completions into a local array and then runs
+ * them: the slots are given back to the producers before a slow handler runs, and the
+ * completions, posted by a handler, wait for the next frame - the drain is bounded.
+ *
+ * The full queue refuses the post (counted) - the producer decides: retry later (a worker
+ * can wait), or drop (a statistic).
+ *
+ * Usage:
+ * @code
+ * // worker thread
+ * Completion_queue::Instance().post(&Loader::on_done, loader, reinterpret_cast<std::uintptr_t>(job));
+ *
+ * // main thread, done by SDL_app_cycle
+ * Completion_queue::Instance().drain();
+ * @endcode
+ */
+class Completion_queue
+{
+
+public:
+
+    static constexpr std::uint32_t CAPACITY = 1024;
+    static constexpr std::uint32_t BATCH = 64;
+
+
+    // Returns the singleton instance.
+    static Completion_queue& Instance();
+
+
+    // Queues the completion (any thread) - false if the queue is full
+    bool post(Completion_fn run, void* context, std::uint64_t value = 0);
+
+    // Runs the queued completions (main thread), returns their number
+    int drain();
+
+
+    std::uint64_t get_posted_count() const { return posted.load(std::memory_order_relaxed); }
+    std::uint64_t get_refused_count() const { return refused.load(std::memory_order_relaxed); }
+    std::uint64_t get_run_count() const { return run_count; }
+
+    // Most completions, which a single drain found
+    std::uint32_t get_max_depth() const { return max_depth; }
+
+    // Prints the counts
+    void dump(std::ostream& out) const;
+
+
+private:
+
+    Completion_queue() = default;
+
+    // Singleton - not copyable
+    Completion_queue(const Completion_queue&) = delete;
+    Completion_queue& operator=(const Completion_queue&) = delete;
+
+
+    Mpsc_queue<Completion, CAPACITY> queue;
+
+    std::atomic<std::uint64_t> posted{0};
+    std::atomic<std::uint64_t> refused{0};
+
+    // Main thread only
+    std::uint64_t run_count = 0;
+    std::uint32_t max_depth = 0;
+};
+
+// =========================================================================================== COMPLETION QUEUE
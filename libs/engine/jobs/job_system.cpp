@@ -0,0 +1,320 @@
+// job_system.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "job_system.h"
+#include "../zone_profiler/zone_profiler.h"
+#include "../thread_roles/thread_roles.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== JOB DEQUE
+
+// Lê, Pop, Cohen, Zappa Nardelli: "Correct and Efficient Work-Stealing for Weak Memory Models"
+
+bool Job_deque::push(const Job& job)
+{
+    const std::int64_t b = bottom.load(std::memory_order_relaxed);
+    const std::int64_t t = top.load(std::memory_order_acquire);
+
+    if (b - t >= CAPACITY) return false;
+
+    jobs[b & (CAPACITY - 1)] = job;
+
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom.store(b + 1, std::memory_order_relaxed);
+
+    return true;
+}
+
+
+bool Job_deque::pop(Job& job)
+{
+    const std::int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    std::int64_t t = top.load(std::memory_order_relaxed);
+
+    if (t > b)
+    {
+        // Empty
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    job = jobs[b & (CAPACITY - 1)];
+
+    if (t == b)
+    {
+        // The last one - the thieves race for it too
+        const bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+
+        bottom.store(b + 1, std::memory_order_relaxed);
+
+        return won;
+    }
+
+    return true;
+}
+
+
+bool Job_deque::steal(Job& job)
+{
+    std::int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const std::int64_t b = bottom.load(std::memory_order_acquire);
+
+    if (t >= b) return false;
+
+    // Copied before the claim - a lost race drops the copy
+    job = jobs[t & (CAPACITY - 1)];
+
+    return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+// =========================================================================================== JOB DEQUE
+
+
+// =========================================================================================== JOB SYSTEM
+
+// SDL 2.24+ - the older firmware SDL spins without the hint
+#ifdef SDL_CPUPauseInstruction
+    #define JOB_PAUSE() SDL_CPUPauseInstruction()
+#else
+    #define JOB_PAUSE() ((void)0)
+#endif
+
+// Deque of the calling thread, -1 - not attached
+static thread_local int thread_slot = -1;
+
+// Pause iterations of an idle worker before it sleeps - a few tens of microseconds,
+// the batches of one frame keep it awake, the idle frames don't burn the battery
+static constexpr int IDLE_SPINS = 4096;
+
+
+Job_system& Job_system::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Job_system instance;
+    return instance;
+}
+
+
+bool Job_system::start(int workers)
+{
+    if (running.load()) return true;
+
+    if (workers < 0) workers = SDL_GetCPUCount() - 1;
+
+    workers = std::min(workers, MAX_WORKERS);
+
+    attach_thread();
+
+    if (workers <= 0)
+    {
+        SDL_Log("Job system: single core - the jobs run in place");
+        return true;
+    }
+
+    wake = SDL_CreateSemaphore(0);
+
+    if (!wake)
+    {
+        SDL_Log("Job system: semaphore creation failed: %s", SDL_GetError());
+        return false;
+    }
+
+    running.store(true);
+
+    for (int i = 0; i < workers; ++i)
+    {
+        threads[worker_count] = SDL_CreateThread(worker_main, "job_worker", this);
+
+        if (!threads[worker_count])
+        {
+            SDL_Log("Job system: worker creation failed: %s", SDL_GetError());
+            break;
+        }
+
+        ++worker_count;
+    }
+
+    if (worker_count == 0)
+    {
+        running.store(false);
+
+        SDL_DestroySemaphore(wake);
+        wake = nullptr;
+
+        return false;
+    }
+
+    SDL_Log("Job system: %d workers", worker_count);
+
+    return true;
+}
+
+
+void Job_system::stop()
+{
+    if (!running.load()) return;
+
+    running.store(false);
+
+    for (int i = 0; i < worker_count; ++i) SDL_SemPost(wake);
+
+    for (int i = 0; i < worker_count; ++i)
+    {
+        SDL_WaitThread(threads[i], nullptr);
+        threads[i] = nullptr;
+    }
+
+    worker_count = 0;
+
+    SDL_DestroySemaphore(wake);
+    wake = nullptr;
+}
+
+
+bool Job_system::attach_thread()
+{
+    if (thread_slot >= 0) return true;
+
+    const int slot = deque_count.fetch_add(1);
+
+    if (slot >= MAX_WORKERS + MAX_CLIENTS)
+    {
+        deque_count.fetch_sub(1);
+        return false;
+    }
+
+    thread_slot = slot;
+
+    return true;
+}
+
+
+bool Job_system::is_attached() const { return thread_slot >= 0; }
+
+
+void Job_system::run(const Job& job)
+{
+    const int slot = thread_slot;
+
+    if (job.counter) job.counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+    if (slot < 0 || worker_count == 0 || !deques[slot].push(job))
+    {
+        execute(job);
+        return;
+    }
+
+    // Pairs with the fence of a worker going to sleep - either it sees the job, or we see it sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (sleeping.load(std::memory_order_relaxed) > 0) SDL_SemPost(wake);
+}
+
+
+void Job_system::wait(Job_counter& counter)
+{
+    const int slot = thread_slot;
+
+    while (!counter.is_done())
+    {
+        Job job;
+
+        if (slot >= 0 && take(slot, job)) execute(job);
+        else JOB_PAUSE();
+    }
+}
+
+
+bool Job_system::take(int slot, Job& job)
+{
+    if (deques[slot].pop(job)) return true;
+
+    const int count = deque_count.load(std::memory_order_acquire);
+
+    for (int i = 1; i < count; ++i)
+    {
+        const int victim = (slot + i) % count;
+
+        if (deques[victim].steal(job))
+        {
+            stolen.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+void Job_system::execute(const Job& job)
+{
+    job.function(job.data, job.begin, job.end);
+
+    if (job.counter) job.counter->pending.fetch_sub(1, std::memory_order_release);
+}
+
+
+bool Job_system::has_work() const
+{
+    const int count = deque_count.load(std::memory_order_acquire);
+
+    for (int i = 0; i < count; ++i)
+        if (!deques[i].is_empty()) return true;
+
+    return false;
+}
+
+
+int Job_system::worker_main(void* self)
+{
+    auto* system = static_cast<Job_system*>(self);
+
+    PROFILE_THREAD("job_worker");
+
+    Thread_roles::Instance().apply(Thread_role::WORKER);
+
+    if (!system->attach_thread()) return 0;
+
+    const int slot = thread_slot;
+    int spins = 0;
+
+    while (system->running.load(std::memory_order_relaxed))
+    {
+        Job job;
+
+        if (system->take(slot, job))
+        {
+            system->execute(job);
+            spins = 0;
+            continue;
+        }
+
+        if (++spins < IDLE_SPINS)
+        {
+            JOB_PAUSE();
+            continue;
+        }
+
+        system->sleeping.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        // A job pushed before the fence is seen here, a later one posts the semaphore
+        if (!system->has_work() && system->running.load()) SDL_SemWait(system->wake);
+
+        system->sleeping.fetch_sub(1, std::memory_order_relaxed);
+        spins = 0;
+    }
+
+    return 0;
+}
+
+// =========================================================================================== JOB SYSTEM
@@ -0,0 +1,234 @@
+// job_system.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== JOB
+
+
+// Jobs left of a group - wait() returns, when it is 0
+struct Job_counter
+{
+    std::atomic<int> pending{0};
+
+    bool is_done() const { return pending.load(std::memory_order_acquire) == 0; }
+};
+
+
+// Range of the work - a plain function and its data, nothing is allocated per job
+struct Job
+{
+    void (*function)(void* data, int begin, int end);
+    void* data;
+
+    int begin;
+    int end;
+
+    // Decremented, when the job is done (nullptr - nobody waits)
+    Job_counter* counter;
+};
+
+
+/**
+ * @brief Chase-Lev work-stealing deque of one thread.
+ *
+ * The owner pushes and pops at the bottom (LIFO - the cache is still warm), the other
+ * threads steal from the top. Only the last job is contended - one CAS, no lock.
+ * Fixed capacity: a push into the full deque fails, the caller runs the job itself.
+ */
+class Job_deque
+{
+
+public:
+
+    static constexpr int CAPACITY = 256;
+
+    // Owner only
+    bool push(const Job& job);
+    bool pop(Job& job);
+
+    // Any thread
+    bool steal(Job& job);
+
+    bool is_empty() const
+    {
+        return bottom.load(std::memory_order_acquire) <= top.load(std::memory_order_acquire);
+    }
+
+private:
+
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "Capacity must be a power of two");
+
+    // The thieves and the owner don't share the cache line of their index
+    alignas(64) std::atomic<std::int64_t> top{0};
+    alignas(64) std::atomic<std::int64_t> bottom{0};
+
+    Job jobs[CAPACITY] = {};
+};
+
+// =========================================================================================== JOB
+
+
+// =========================================================================================== JOB SYSTEM
+
+
+/**
+ * @brief Engine worker threads with the work stealing, sized by the CPU count.
+ *
+ * One worker per core besides the main thread (SDL_GetCPUCount() - 1: one on the
+ * dual-core Cortex-A7 of the Miyoo Mini+). Every worker and every attached thread (the
+ * main one, the update worker) has its own Job_deque: its jobs are pushed and popped
+ * there without any contention, an idle worker steals from the others. A thread waiting
+ * for a counter runs the jobs meanwhile, so the submitting thread is a worker too.
+ *
+ * The jobs are a function pointer and a range - no allocation, no std::function. An
+ * idle worker spins shortly, then sleeps on a semaphore, which a submit posts only if
+ * somebody sleeps. A thread, which is not attached, runs its jobs in place.
+ *
+ * Usage:
+ * @code
+ * // Every element, in 64 element batches at least - the small arrays run in place
+ * Job_system::Instance().parallel_for(count, 64, [&](int begin, int end)
+ * {
+ *     for (int i = begin; i < end; ++i) step(items[i]);
+ * });
+ *
+ * // Unrelated jobs, then the dependent work
+ * Job_system& jobs = Job_system::Instance();
+ * Job_counter loaded;
+ * jobs.run({decode_chunk, &chunks[0], 0, 1, &loaded});
+ * jobs.run({decode_chunk, &chunks[1], 0, 1, &loaded});
+ * jobs.wait(loaded);
+ * @endcode
+ */
+class Job_system
+{
+
+public:
+
+    static constexpr int MAX_WORKERS = 7;
+
+    // Attached threads besides the workers (main thread, update worker, the asset loader workers)
+    static constexpr int MAX_CLIENTS = 4;
+
+    // Returns the singleton instance.
+    static Job_system& Instance();
+
+
+    /**
+     * @brief Starts the workers and attaches the calling thread.
+     *
+     * @param workers Worker threads, -1 - SDL_GetCPUCount() - 1 (0 - everything in place).
+     * @return false if no worker could be created (the jobs run in place then).
+     */
+    bool start(int workers = -1);
+
+    // Joins the workers - nothing may be running, the system isn't started again
+    void stop();
+
+    // The calling thread gets a deque and can submit, false if there is no free one
+    bool attach_thread();
+
+    bool is_attached() const;
+
+    int get_worker_count() const { return worker_count; }
+
+
+    // Queues the job (counter + 1), runs it in place if the thread isn't attached or the deque is full
+    void run(const Job& job);
+
+    // Runs the queued jobs until the counter is 0
+    void wait(Job_counter& counter);
+
+
+    /**
+     * @brief Calls fn(begin, end) over [0, count) split in the batches of all threads.
+     *
+     * The first batch runs on the calling thread, which helps with the rest until
+     * everything is done - fn must be safe to run concurrently on the disjoint ranges.
+     *
+     * @param count     Elements.
+     * @param min_batch Smallest batch worth a job - fewer elements run in place.
+     * @param fn        Callable (int begin, int end).
+     */
+    template <typename F>
+    void parallel_for(int count, int min_batch, F&& fn)
+    {
+        if (count <= 0) return;
+
+        min_batch = std::max(1, min_batch);
+
+        if (worker_count == 0 || count < 2 * min_batch || !is_attached())
+        {
+            fn(0, count);
+            return;
+        }
+
+        // Two batches per thread - the stealing evens out the uneven ones
+        const int batches = std::min(2 * (worker_count + 1), count / min_batch);
+        const int batch = (count + batches - 1) / batches;
+
+        Job_counter counter;
+
+        void* data = const_cast<void*>(static_cast<const void*>(&fn));
+
+        for (int begin = batch; begin < count; begin += batch)
+            run({&call_range<typename std::remove_reference<F>::type>, data, begin, std::min(count, begin + batch), &counter});
+
+        fn(0, batch);
+
+        wait(counter);
+    }
+
+
+    // Jobs taken from the deque of another thread, since start()
+    std::uint64_t get_stolen_count() const { return stolen.load(std::memory_order_relaxed); }
+
+
+private:
+
+    Job_system() = default;
+
+    // Singleton - not copyable
+    Job_system(const Job_system&) = delete;
+    Job_system& operator=(const Job_system&) = delete;
+
+
+    template <typename F>
+    static void call_range(void* data, int begin, int end) { (*static_cast<F*>(data))(begin, end); }
+
+    static int SDLCALL worker_main(void* self);
+
+    // Own deque first, then the others from the next one
+    bool take(int slot, Job& job);
+
+    void execute(const Job& job);
+
+    bool has_work() const;
+
+
+    Job_deque deques[MAX_WORKERS + MAX_CLIENTS];
+    std::atomic<int> deque_count{0};
+
+    SDL_Thread* threads[MAX_WORKERS] = {};
+    int worker_count = 0;
+
+    SDL_sem* wake = nullptr;
+    std::atomic<int> sleeping{0};
+    std::atomic<bool> running{false};
+
+    std::atomic<std::uint64_t> stolen{0};
+};
+
+// =========================================================================================== JOB SYSTEM
@@ -0,0 +1,156 @@
+// mpsc_queue.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== MPSC QUEUE
+
+
+/**
+ * @brief Lock-free multi-producer, single-consumer queue of fixed capacity.
+ *
+ * Any thread pushes, one thread pops. The producers claim the slots with one CAS on the
+ * shared position, the consumer reads without any - every slot has its turn counter
+ * (the bounded queue of D. Vyukov): turn == position - free for the producer of the
+ * position, position + 1 - filled for the consumer. The full queue refuses the push,
+ * nothing waits and nothing is allocated after the construction - the storage is inline.
+ *
+ * pop_batch() drains the filled run in one call. The consumer position is private to it -
+ * the producers never read it, each slot is handed back by its own turn store, so the drain
+ * doesn't bounce a shared line with the producers.
+ *
+ * @tparam T        Movable element, default constructible (the free slots hold one).
+ * @tparam CAPACITY Power of two.
+ */
+template<typename T, std::uint32_t CAPACITY>
+class Mpsc_queue
+{
+    static_assert(CAPACITY > 1 && (CAPACITY & (CAPACITY - 1)) == 0, "Mpsc_queue capacity must be a power of two");
+
+public:
+
+    Mpsc_queue()
+    {
+        for (std::uint32_t i = 0; i < CAPACITY; ++i) slots[i].turn.store(i, std::memory_order_relaxed);
+    }
+
+    Mpsc_queue(const Mpsc_queue&) = delete;
+    Mpsc_queue& operator=(const Mpsc_queue&) = delete;
+
+
+    // Producer side (any thread) - false if the queue is full, the item is untouched then
+    bool push(T&& item)
+    {
+        std::uint32_t position = enqueue_position.load(std::memory_order_relaxed);
+
+        for (;;)
+        {
+            Slot& slot = slots[position & (CAPACITY - 1)];
+
+            const std::uint32_t turn = slot.turn.load(std::memory_order_acquire);
+            const std::int32_t lag = static_cast<std::int32_t>(turn - position);
+
+            if (lag == 0)
+            {
+                // Claimed - the slot is ours until the turn store
+                if (enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    slot.item = std::move(item);
+                    slot.turn.store(position + 1, std::memory_order_release);
+
+                    return true;
+                }
+            }
+            else if (lag < 0) return false;     // The consumer hasn't freed the slot of the previous lap
+            else position = enqueue_position.load(std::memory_order_relaxed);
+        }
+    }
+
+    bool push(const T& item)
+    {
+        T copy = item;
+        return push(std::move(copy));
+    }
+
+
+    // Consumer side - false if the queue is empty (or the next item is still being written)
+    bool pop(T& item)
+    {
+        Slot& slot = slots[dequeue_position & (CAPACITY - 1)];
+
+        if (slot.turn.load(std::memory_order_acquire) != dequeue_position + 1) return false;
+
+        item = std::move(slot.item);
+        slot.turn.store(dequeue_position + CAPACITY, std::memory_order_release);
+
+        ++dequeue_position;
+
+        return true;
+    }
+
+    /**
+     * @brief Consumer side - hands the filled run of up to max_items to the function, in order.
+     *
+     * A slot, claimed but not yet written by its producer, ends the run - the later ones
+     * wait for the next call, the order is kept.
+     *
+     * @param fn        Called as fn(T&&) for every item.
+     * @param max_items Batch limit.
+     * @return Number of the items.
+     */
+    template<typename Fn>
+    std::uint32_t pop_batch(Fn&& fn, std::uint32_t max_items = CAPACITY)
+    {
+        std::uint32_t count = 0;
+
+        while (count < max_items)
+        {
+            Slot& slot = slots[dequeue_position & (CAPACITY - 1)];
+
+            if (slot.turn.load(std::memory_order_acquire) != dequeue_position + 1) break;
+
+            fn(std::move(slot.item));
+
+            slot.item = T();
+            slot.turn.store(dequeue_position + CAPACITY, std::memory_order_release);
+
+            ++dequeue_position;
+            ++count;
+        }
+
+        return count;
+    }
+
+    // Consumer side - approximate number of the queued items (the claimed ones included)
+    std::uint32_t size() const { return enqueue_position.load(std::memory_order_acquire) - dequeue_position; }
+
+    bool empty() const { return size() == 0; }
+
+    static constexpr std::uint32_t capacity() { return CAPACITY; }
+
+
+private:
+
+    struct Slot
+    {
+        std::atomic<std::uint32_t> turn{0};
+        T item{};
+    };
+
+    Slot slots[CAPACITY];
+
+    // Separate cache lines - the producers' position isn't on the consumer's line
+    alignas(64) std::atomic<std::uint32_t> enqueue_position{0};
+    alignas(64) std::uint32_t dequeue_position = 0;
+};
+
+// =========================================================================================== MPSC QUEUE
@@ -4,6 +4,10 @@
 // =========================================================================================== IMPORT
 
 #include "lang_state.h"
+#include "../asset/asset_pack.h"
+#include "../asset/asset_loader.h"
+#include "../platform/backend.h"
+#include "../thread_roles/thread_roles.h"
 
 // =========================================================================================== IMPORT
 
@@ -39,6 +43,12 @@ bool Lang_state::Set_lang(Lang_list language)
     // Validate input: must be within the enum range
     if (language < Lang_list::EN || language >= Lang_list::LIMIT) return false;
 
+    // The direct switch overrides the requested one
+    requested_lang = Lang_list::LIMIT;
+
+    // Nothing to reload or rebuild
+    if (language == Curr_lang && current.strings.is_open()) return true;
+
     // Assign the selected language
     // Could extend this switch to initialize other language-specific resources if needed
     switch (language)
@@ -55,8 +65,338 @@ bool Lang_state::Set_lang(Lang_list language)
         default: return false;
     }
 
+    if (pending.lang == language)
+    {
+        // Prefetched - the sets are swapped, the previous language is dropped
+        finish_prefetch();
+
+        std::swap(current, pending);
+        release(pending);
+    }
+    else
+    {
+        // The resources of the previous language are dropped - only one set is resident
+        Cancel_prefetch();
+        Load_strings();
+    }
+
+    // Everything derived from the old strings is rebuilt once
+    for (const Hook& hook : change_hooks) hook.fn(hook.context);
 
     return true; // Language successfully set
 }
 
+
+bool Lang_state::Request_lang(Lang_list lang)
+{
+    if (lang < Lang_list::EN || lang >= Lang_list::LIMIT)
+    {
+        requested_lang = Lang_list::LIMIT;
+        return false;
+    }
+
+    // Back to the current one - the request is over, the prefetched set stays for the menu
+    if (lang == Curr_lang && current.strings.is_open())
+    {
+        requested_lang = Lang_list::LIMIT;
+        return true;
+    }
+
+    requested_lang = lang;
+
+    Prefetch(lang);
+
+    return true;
+}
+
+
+bool Lang_state::Update()
+{
+    if (requested_lang == Lang_list::LIMIT) return false;
+
+    if (pending.lang != requested_lang) Prefetch(requested_lang);
+
+    // The read is over - the table is opened here, the thread is done or returning
+    if (pending.lang == requested_lang && !pending.strings.is_open() && (!prefetch_thread || prefetch_read.load()))
+        finish_prefetch();
+
+    if (!Is_prefetched(requested_lang)) return false;
+
+    // Every hook is polled - each of them starts its work on the first poll
+    bool ready = true;
+
+    for (const Prepare& hook : prepare_hooks)
+        if (!hook.fn(hook.context, requested_lang)) ready = false;
+
+    if (!ready) return false;
+
+    const Lang_list lang = requested_lang;
+    requested_lang = Lang_list::LIMIT;
+
+    return Set_lang(lang);
+}
+
+
+std::string_view Lang_state::Get_pending_string(Lang_list lang, std::uint32_t id) const
+{
+    return pending.lang == lang ? pending.strings.get(id) : std::string_view();
+}
+
+
+void Lang_state::Add_prepare_hook(Prepare_hook hook, void* context)
+{
+    if (hook) prepare_hooks.push_back({hook, context});
+}
+
+
+void Lang_state::Remove_prepare_hook(Prepare_hook hook, void* context)
+{
+    for (size_t i = 0; i < prepare_hooks.size(); ++i)
+        if (prepare_hooks[i].fn == hook && prepare_hooks[i].context == context)
+        {
+            prepare_hooks.erase(prepare_hooks.begin() + static_cast<std::ptrdiff_t>(i));
+            return;
+        }
+}
+
+
+void Lang_state::Add_change_hook(Change_hook hook, void* context)
+{
+    if (hook) change_hooks.push_back({hook, context});
+}
+
+
+void Lang_state::Remove_change_hook(Change_hook hook, void* context)
+{
+    for (size_t i = 0; i < change_hooks.size(); ++i)
+        if (change_hooks[i].fn == hook && change_hooks[i].context == context)
+        {
+            change_hooks.erase(change_hooks.begin() + static_cast<std::ptrdiff_t>(i));
+            return;
+        }
+}
+
+
+bool Lang_state::Load_strings()
+{
+    release(current);
+    current.lang = Curr_lang;
+
+    request_assets(current);
+
+    std::string path;
+
+    if (open_from_pack(current, path)) return true;
+
+    if (path.empty()) return false;
+
+    if (!Platform::Files::read_file(path.c_str(), current.strings_buffer))
+    {
+        SDL_Log("No strings for the language %s", Get_lang_code(Curr_lang));
+        return false;
+    }
+
+    return open_buffer(current, path);
+}
+
+
+void Lang_state::Set_lang_assets(Lang_list lang, std::vector<Lang_asset> assets)
+{
+    if (lang < Lang_list::EN || lang >= Lang_list::LIMIT) return;
+
+    for (Lang_asset& asset : assets) asset.key = Hash_key(asset.path);
+
+    lang_assets[static_cast<unsigned int>(lang)] = std::move(assets);
+
+    // The set of the language is resident already - its new list is loaded at once
+    if (current.lang == lang)
+    {
+        current.assets.clear();
+        request_assets(current);
+    }
+
+    if (pending.lang == lang)
+    {
+        pending.assets.clear();
+        request_assets(pending);
+    }
+}
+
+
+Asset* Lang_state::Get_asset(Hash_key path) const
+{
+    if (current.lang >= Lang_list::LIMIT) return nullptr;
+
+    // The requests are in the order of the list
+    const std::vector<Lang_asset>& list = lang_assets[static_cast<unsigned int>(current.lang)];
+
+    for (size_t i = 0; i < list.size() && i < current.assets.size(); ++i)
+        if (list[i].key == path) return current.assets[i]->get_asset();
+
+    return nullptr;
+}
+
+
+void Lang_state::Prefetch(Lang_list lang)
+{
+    if (lang < Lang_list::EN || lang >= Lang_list::LIMIT) return;
+
+    // Already resident or on the way
+    if (lang == current.lang || lang == pending.lang)
+    {
+        if (lang == current.lang) Cancel_prefetch();
+        return;
+    }
+
+    Cancel_prefetch();
+
+    pending.lang = lang;
+
+    request_assets(pending);
+
+    // The packed table is mapped - nothing to read
+    if (open_from_pack(pending, prefetch_path) || prefetch_path.empty()) return;
+
+    prefetch_thread = SDL_CreateThread(prefetch_main, "lang_prefetch", this);
+
+    // No thread - the table is read by Set_lang() then
+    if (!prefetch_thread) SDL_Log("Language prefetch thread creation failed: %s", SDL_GetError());
+}
+
+
+void Lang_state::Cancel_prefetch()
+{
+    // The set of the requested switch is kept until the switch
+    if (requested_lang != Lang_list::LIMIT && pending.lang == requested_lang) return;
+
+    if (prefetch_thread) SDL_WaitThread(prefetch_thread, nullptr);
+
+    prefetch_thread = nullptr;
+    prefetch_path.clear();
+    prefetch_read = false;
+    prefetch_done = false;
+
+    release(pending);
+}
+
+
+bool Lang_state::Is_prefetched(Lang_list lang) const
+{
+    if (lang == current.lang) return true;
+
+    if (lang != pending.lang) return false;
+
+    // The table is read (or mapped, or known to be missing) and every asset request is over
+    if (!pending.strings.is_open() && !prefetch_done && !(prefetch_thread && prefetch_read.load())) return false;
+
+    for (const auto& ticket : pending.assets)
+        if (!ticket->is_finished()) return false;
+
+    return true;
+}
+
+
+void Lang_state::Release_assets()
+{
+    requested_lang = Lang_list::LIMIT;
+
+    Cancel_prefetch();
+
+    current.assets.clear();
+}
+
+
+Lang_state::~Lang_state()
+{
+    if (prefetch_thread) SDL_WaitThread(prefetch_thread, nullptr);
+}
+
+
+void Lang_state::release(Lang_resources& set)
+{
+    set.lang = Lang_list::LIMIT;
+    set.strings = String_table_view{};
+    set.strings_buffer.clear();
+    set.strings_buffer.shrink_to_fit();
+    set.assets.clear();
+}
+
+
+void Lang_state::request_assets(Lang_resources& set)
+{
+    if (set.lang >= Lang_list::LIMIT || !set.assets.empty()) return;
+
+    for (const Lang_asset& asset : lang_assets[static_cast<unsigned int>(set.lang)])
+        set.assets.push_back(Asset_loader::Instance().load(asset.path, asset.type));
+}
+
+
+bool Lang_state::open_from_pack(Lang_resources& set, std::string& path)
+{
+    path = std::string("lang/") + Get_lang_code(set.lang) + ".str";
+
+    // The pack first - the view is over the mapped pages, nothing is copied
+    const Asset_pack& pack = Asset_pack::Instance();
+
+    if (const Pack_entry* entry = pack.is_mounted() ? pack.find(path) : nullptr)
+    {
+        if (set.strings.open(pack.get_data(*entry), entry->size)) return true;
+
+        SDL_Log("Packed strings %s are not a valid string table", path.c_str());
+        path.clear();
+        return false;
+    }
+
+    return false;
+}
+
+
+bool Lang_state::open_buffer(Lang_resources& set, const std::string& path)
+{
+    if (set.strings.open(set.strings_buffer.data(), set.strings_buffer.size())) return true;
+
+    SDL_Log("Strings %s are not a valid string table (version %u expected)", path.c_str(), STRINGS_VERSION);
+    set.strings_buffer.clear();
+    return false;
+}
+
+
+void Lang_state::finish_prefetch()
+{
+    if (pending.strings.is_open() || prefetch_done) return;
+
+    if (prefetch_thread)
+    {
+        // Usually over long ago - the menu was open for a while
+        SDL_WaitThread(prefetch_thread, nullptr);
+        prefetch_thread = nullptr;
+    }
+    else if (!prefetch_path.empty())
+    {
+        // The thread couldn't start - read here
+        prefetch_read = Platform::Files::read_file(prefetch_path.c_str(), pending.strings_buffer);
+    }
+
+    if (prefetch_read.load()) open_buffer(pending, prefetch_path);
+    else if (!prefetch_path.empty()) SDL_Log("No strings for the language %s", Get_lang_code(pending.lang));
+
+    prefetch_path.clear();
+
+    // A missing table doesn't hold the switch - the strings are empty then, as with Set_lang()
+    prefetch_done = true;
+}
+
+
+int Lang_state::prefetch_main(void* self)
+{
+    auto* state = static_cast<Lang_state*>(self);
+
+    Thread_roles::Instance().apply(Thread_role::IO);
+
+    // Only the pending buffer is touched - the main thread waits for the thread before it reads it
+    state->prefetch_read = Platform::Files::read_file(state->prefetch_path.c_str(), state->pending.strings_buffer);
+
+    return 0;
+}
+
 // =========================================================================================== LANG_STATE SINGLETON
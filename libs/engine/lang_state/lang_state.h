@@ -4,8 +4,20 @@
 
 // =========================================================================================== IMPORT
 
-#include <map>
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
+
+#include "string_table.h"
+#include "../hash_key/hash_key.h"
+
+class Asset;
+class Load_ticket;
+enum class Asset_type;
+struct SDL_Thread;
 
 // =========================================================================================== IMPORT
 
@@ -37,12 +49,33 @@ enum class Lang_list : unsigned int
  * @brief Singleton class that holds the current language state.
  *
  * Ensures there is only one global instance of language state.
- * Provides methods to get and set the current language.
+ * Provides methods to get and set the current language and the strings of it.
+ *
+ * The language owns its resource set: the string table lang/<code>.str (cooked by
+ * miyoo_string_cooker, mapped from the asset pack or read into one buffer) and the
+ * language-specific assets the game declares (the fonts, the voice-over), loaded by
+ * the Asset_loader. Only the set of the current language is resident, Set_lang()
+ * replaces it, Get_string() is an array index into it.
+ *
+ * A language menu calls Prefetch() for the highlighted language: its set is read
+ * on a background thread next to the current one, and Set_lang() to it only swaps
+ * the sets. Cancel_prefetch() (the menu is closed) drops it again - at most one
+ * inactive set is ever in memory.
+ *
+ * Request_lang() is the switch without a hitch: the old language keeps being drawn,
+ * while the new set is loaded and the prepare hooks build what is derived from it
+ * (Text_cache lays out the new runs on its worker). Update() at the frame boundary
+ * swaps everything at once, when all of it is ready.
  *
  * Usage:
  * @code
- * Lang_state::Instance().Set_lang(Lang_list::RU);
+ * Lang_state::Instance().Set_lang_assets(Lang_list::RU, {{"voice/ru/intro.wav", Asset_type::AUDIO}});
+ *
+ * Lang_state::Instance().Prefetch(Lang_list::RU);     // the highlight moved
+ * Lang_state::Instance().Request_lang(Lang_list::RU); // the choice - swapped by a later frame
+ *
  * auto current = Lang_state::Instance().Get_lang();
+ * std::string_view title = Lang_state::Instance().Get_string(STR_MENU_TITLE);
  * @endcode
  */
 class Lang_state
@@ -75,13 +108,121 @@ public:
     bool Set_lang(Lang_list lang);
 
 
+    /**
+     * @brief Loads the resource set of the current language (the startup, after the pack is mounted).
+     *
+     * @return false if the string table is missing or not valid - the strings are empty then.
+     */
+    bool Load_strings();
+
+
+    // Language-specific asset of a resource set
+    struct Lang_asset
+    {
+        std::string path;
+        Asset_type type;
+
+        // Hash of the path, set by Set_lang_assets()
+        Hash_key key = {};
+    };
+
+    /**
+     * @brief Declares the language-specific assets of the language (replaces the previous list).
+     *
+     * Nothing is loaded for an inactive language - the list is loaded with its set.
+     */
+    void Set_lang_assets(Lang_list lang, std::vector<Lang_asset> assets);
+
+    // Language-specific asset of the current set by its path key ("voice/intro.wav"_key), nullptr until it is loaded
+    Asset* Get_asset(Hash_key path) const;
+
+
+    /**
+     * @brief Starts loading the resource set of the language in the background.
+     *
+     * The string table is read on its own thread, the assets are queued to the Asset_loader.
+     * The previous prefetch is dropped; the current language is not prefetched.
+     */
+    void Prefetch(Lang_list lang);
+
+    // Drops the prefetched set (the language menu is closed), unless the switch to it is requested
+    void Cancel_prefetch();
+
+    // The set of the language is prefetched completely - Set_lang() to it won't wait
+    bool Is_prefetched(Lang_list lang) const;
+
+    // Drops the asset references of every set (the shutdown, before the Asset_manager is cleared)
+    void Release_assets();
+
+    /**
+     * @brief String of the current language by its id (String_id of the game).
+     *
+     * @param id Index of the string in the key list.
+     * @return UTF-8 text, valid until the next language change; empty if unknown.
+     */
+    std::string_view Get_string(std::uint32_t id) const { return current.strings.get(id); }
+
+    /**
+     * @brief Requests the switch at a frame boundary, once the new language is completely built.
+     *
+     * @param lang New language; the current one (or an invalid one) cancels the request.
+     * @return false if the language is invalid.
+     */
+    bool Request_lang(Lang_list lang);
+
+    // Requested language, LIMIT - no switch is in progress
+    Lang_list Get_requested_lang() const { return requested_lang; }
+
+    bool Is_switching() const { return requested_lang != Lang_list::LIMIT; }
+
+    /**
+     * @brief Frame boundary step of the requested switch (the engine calls it every cycle).
+     *
+     * Opens the read table of the new set, polls the prepare hooks and swaps the language,
+     * when the set and every hook are ready.
+     *
+     * @return true if the language was switched - the frame is redrawn.
+     */
+    bool Update();
+
+    /**
+     * @brief String of the language being switched to (the prepare hooks).
+     *
+     * @return Empty until the new table is open, or if the language isn't the pending one.
+     */
+    std::string_view Get_pending_string(Lang_list lang, std::uint32_t id) const;
+
+
+    // Called after every language change, once the new strings are loaded
+    using Change_hook = void (*)(void* context);
+
+    // Polled while the switch to the language is requested, true - its data is built
+    using Prepare_hook = bool (*)(void* context, Lang_list lang);
+
+    /**
+     * @brief Adds a hook of the language change (the caches of the text).
+     *
+     * @param hook    Function to call.
+     * @param context Passed back to the hook, also the key of Remove_change_hook().
+     */
+    void Add_change_hook(Change_hook hook, void* context);
+    void Remove_change_hook(Change_hook hook, void* context);
+
+    // Adds a hook, which builds its data of the requested language (context is the key)
+    void Add_prepare_hook(Prepare_hook hook, void* context);
+    void Remove_prepare_hook(Prepare_hook hook, void* context);
+
+    // Short code of the language - the name of its resource files ("en", "ru")
+    static const char* Get_lang_code(Lang_list lang) { return lang == Lang_list::RU ? "ru" : "en"; }
+
+
 private:
 
     // Private constructor ensures no external instances can be created.
     Lang_state();
 
-    // Default destructor is fine; no dynamic allocation to clean up.
-    ~Lang_state() = default;
+    // Waits for the prefetch thread
+    ~Lang_state();
 
     // Copy constructor is deleted to prevent copying the singleton.
     Lang_state(const Lang_state&) = delete;
@@ -92,6 +233,70 @@ private:
 
     // Currently active language
     Lang_list Curr_lang;
+
+    // Strings and assets of one language
+    struct Lang_resources
+    {
+        Lang_list lang = Lang_list::LIMIT;
+
+        // String table and its memory, when it isn't mapped from the pack
+        String_table_view strings;
+        std::vector<std::uint8_t> strings_buffer;
+
+        // Requests of the language-specific assets, each holds its asset
+        std::vector<std::shared_ptr<Load_ticket>> assets;
+    };
+
+    // Set of the current language
+    Lang_resources current;
+
+    // Set of the highlighted language - the prefetch thread owns its buffer until it is joined
+    Lang_resources pending;
+    SDL_Thread* prefetch_thread = nullptr;
+    std::string prefetch_path;
+    std::atomic<bool> prefetch_read{false};
+
+    // The pending table is opened or its read failed (main thread)
+    bool prefetch_done = false;
+
+    std::vector<Lang_asset> lang_assets[static_cast<unsigned int>(Lang_list::LIMIT)];
+
+    // Drops the set, its memory and its asset references
+    static void release(Lang_resources& set);
+
+    // Queues the language-specific assets of the set
+    void request_assets(Lang_resources& set);
+
+    // Opens the table of the set from the pack or (not on the pack) returns false with the path to read
+    static bool open_from_pack(Lang_resources& set, std::string& path);
+
+    // Opens the read buffer of the set, false if it isn't a valid table
+    static bool open_buffer(Lang_resources& set, const std::string& path);
+
+    // Waits for the prefetch thread and opens its buffer
+    void finish_prefetch();
+
+    // Prefetch thread - reads the table file into the pending buffer
+    static int prefetch_main(void* self);
+
+    struct Hook
+    {
+        Change_hook fn;
+        void* context;
+    };
+
+    std::vector<Hook> change_hooks;
+
+    struct Prepare
+    {
+        Prepare_hook fn;
+        void* context;
+    };
+
+    std::vector<Prepare> prepare_hooks;
+
+    // Language of Request_lang(), LIMIT - none
+    Lang_list requested_lang = Lang_list::LIMIT;
 };
 
 // =========================================================================================== LANG_STATE SINGLETON
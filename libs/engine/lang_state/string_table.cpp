@@ -0,0 +1,264 @@
+// string_table.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "string_table.h"
+#include "../hash_key/hash_key.h"
+
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <unordered_map>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== STRING TABLE VIEW
+
+bool String_table_view::open(const void* data, size_t size)
+{
+    header = nullptr;
+    offsets = nullptr;
+    text = nullptr;
+
+    // The tables are read in place - the data must keep their alignment
+    if (!data || size < sizeof(String_table_header) || reinterpret_cast<std::uintptr_t>(data) % alignof(String_table_header) != 0)
+        return false;
+
+    const auto* bytes = static_cast<const std::uint8_t*>(data);
+    const auto* h = reinterpret_cast<const String_table_header*>(bytes);
+
+    if (h->magic != STRINGS_MAGIC || h->version != STRINGS_VERSION || h->size > size) return false;
+
+    const std::uint64_t offsets_end = static_cast<std::uint64_t>(h->offsets_offset) + (static_cast<std::uint64_t>(h->count) + 1) * sizeof(std::uint32_t);
+    const std::uint64_t text_end = static_cast<std::uint64_t>(h->text_offset) + h->text_size;
+
+    if (offsets_end > h->size || text_end > h->size || h->offsets_offset % alignof(std::uint32_t) != 0) return false;
+
+    const auto* table = reinterpret_cast<const std::uint32_t*>(bytes + h->offsets_offset);
+    const char* chars = reinterpret_cast<const char*>(bytes + h->text_offset);
+
+    // Once per load: every string inside the text and 0-terminated - get() checks nothing
+    if (table[0] != 0 || table[h->count] != h->text_size) return false;
+
+    for (std::uint32_t i = 0; i < h->count; ++i)
+        if (table[i + 1] <= table[i] || chars[table[i + 1] - 1] != 0) return false;
+
+    header = h;
+    offsets = table;
+    text = chars;
+
+    return true;
+}
+
+// =========================================================================================== STRING TABLE VIEW
+
+
+// =========================================================================================== STRING TABLE COOKING
+
+namespace
+{
+    template <typename T>
+    void append(std::vector<std::uint8_t>& out, const T& value)
+    {
+        const size_t at = out.size();
+        out.resize(at + sizeof(T));
+        std::memcpy(out.data() + at, &value, sizeof(T));
+    }
+
+
+    // Keys in the order of the list, '#' comments and the blank lines skipped
+    bool read_keys(const std::string& keys, std::vector<std::string>& out, std::string& error)
+    {
+        std::istringstream lines(keys);
+        std::string line;
+        int line_number = 0;
+
+        while (std::getline(lines, line))
+        {
+            ++line_number;
+
+            const size_t comment = line.find('#');
+            if (comment != std::string::npos) line.erase(comment);
+
+            std::istringstream words(line);
+            std::string key, extra;
+
+            if (!(words >> key)) continue;
+
+            if (words >> extra)
+            {
+                error = "keys line " + std::to_string(line_number) + ": one key per line";
+                return false;
+            }
+
+            out.push_back(key);
+        }
+
+        return true;
+    }
+
+
+    // \n and \\ of the source text
+    std::string unescape(const std::string& text)
+    {
+        std::string result;
+        result.reserve(text.size());
+
+        for (size_t i = 0; i < text.size(); ++i)
+        {
+            if (text[i] == '\\' && i + 1 < text.size())
+            {
+                const char next = text[++i];
+                result += next == 'n' ? '\n' : next;
+            }
+            else result += text[i];
+        }
+
+        return result;
+    }
+}
+
+
+bool string_table_cook(const std::string& keys, const std::string& source, std::uint32_t lang,
+                       std::vector<std::uint8_t>& out, std::string& error)
+{
+    std::vector<std::string> key_list;
+
+    if (!read_keys(keys, key_list, error)) return false;
+
+    std::unordered_map<std::string, size_t> ids;
+
+    for (size_t i = 0; i < key_list.size(); ++i)
+        if (!ids.emplace(key_list[i], i).second)
+        {
+            error = "key " + key_list[i] + " is listed twice";
+            return false;
+        }
+
+    std::vector<std::string> strings(key_list.size());
+    std::vector<bool> defined(key_list.size(), false);
+
+    std::istringstream lines(source);
+    std::string line;
+    int line_number = 0;
+
+    while (std::getline(lines, line))
+    {
+        ++line_number;
+
+        while (!line.empty() && line.back() == '\r') line.pop_back();
+
+        std::istringstream words(line);
+        std::string key;
+
+        // '#' only at the start - the texts could contain it
+        if (!(words >> key) || key[0] == '#') continue;
+
+        const auto it = ids.find(key);
+
+        if (it == ids.end() || defined[it->second])
+        {
+            error = "line " + std::to_string(line_number) + ": " + (it == ids.end() ? "unknown" : "repeated") + " key " + key;
+            return false;
+        }
+
+        std::string text;
+        std::getline(words >> std::ws, text);
+
+        strings[it->second] = unescape(text);
+        defined[it->second] = true;
+    }
+
+    for (size_t i = 0; i < key_list.size(); ++i)
+        if (!defined[i])
+        {
+            error = "key " + key_list[i] + " has no text";
+            return false;
+        }
+
+    // Header, offsets, text - the order of the file
+    String_table_header header = {};
+
+    header.magic = STRINGS_MAGIC;
+    header.version = STRINGS_VERSION;
+    header.lang = lang;
+    header.count = static_cast<std::uint32_t>(key_list.size());
+    header.offsets_offset = sizeof(String_table_header);
+    header.text_offset = header.offsets_offset + (header.count + 1) * sizeof(std::uint32_t);
+
+    std::vector<std::uint32_t> offsets;
+    std::string text;
+
+    for (const std::string& s : strings)
+    {
+        offsets.push_back(static_cast<std::uint32_t>(text.size()));
+        text += s;
+        text += '\0';
+    }
+
+    offsets.push_back(static_cast<std::uint32_t>(text.size()));
+
+    header.text_size = static_cast<std::uint32_t>(text.size());
+    header.size = (header.text_offset + header.text_size + 3) & ~3u;
+
+    out.clear();
+    out.reserve(header.size);
+
+    append(out, header);
+    for (std::uint32_t offset : offsets) append(out, offset);
+
+    out.insert(out.end(), text.begin(), text.end());
+    out.resize(header.size, 0);
+
+    return true;
+}
+
+
+bool string_table_enum(const std::string& keys, const std::string& name, std::string& header, std::string& error)
+{
+    std::vector<std::string> key_list;
+
+    if (!read_keys(keys, key_list, error)) return false;
+
+    header = "// Generated by miyoo_string_cooker from the key list - don't edit, regenerate\n\n#pragma once\n\n#include <cstdint>\n\n";
+
+    header += "enum " + name + " : std::uint32_t\n{\n";
+
+    for (const std::string& key : key_list) header += "    STR_" + key + ",\n";
+
+    header += "\n    STR_COUNT\n};\n";
+
+    // The hashes of the keys - a collision would make two keys one id
+    std::unordered_map<std::uint32_t, const std::string*> hashes;
+
+    std::string cases;
+
+    for (const std::string& key : key_list)
+    {
+        const std::uint32_t hash = Hash_key(key).value;
+
+        auto inserted = hashes.emplace(hash, &key);
+
+        if (!inserted.second)
+        {
+            error = "Keys " + *inserted.first->second + " and " + key + " have one hash";
+            return false;
+        }
+
+        char value[16];
+        std::snprintf(value, sizeof(value), "0x%08Xu", hash);
+
+        cases += std::string("        case ") + value + ": return STR_" + key + ";\n";
+    }
+
+    header += "\n\n// Id of the key by its FNV-1a hash (\"MENU_TITLE\"_key.value) - constexpr, STR_COUNT if unknown\n";
+    header += "constexpr " + name + " string_id_of(std::uint32_t key_hash)\n{\n    switch (key_hash)\n    {\n";
+    header += cases;
+    header += "        default: return STR_COUNT;\n    }\n}\n";
+
+    return true;
+}
+
+// =========================================================================================== STRING TABLE COOKING
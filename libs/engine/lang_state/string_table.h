@@ -0,0 +1,141 @@
+// string_table.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== STRING TABLE FORMAT
+
+// File layout (little-endian, every table 4-byte aligned, every offset from the file start):
+//
+// [String_table_header]
+// [std::uint32_t] * (count + 1) at offsets_offset - start of every string inside the text,
+//                                                   the extra one is the end of the text
+// [UTF-8 text] at text_offset, text_size bytes, every string 0-terminated
+//
+// One table per language, the string id is the index: the lookup is two offset loads,
+// no hash and no compare. The ids are the line numbers of the key list the tables were
+// cooked with (miyoo_string_cooker), the same for every language.
+
+constexpr std::uint32_t STRINGS_MAGIC = 0x5351534D;   // "MSQS"
+constexpr std::uint32_t STRINGS_VERSION = 1;
+
+
+struct String_table_header
+{
+    std::uint32_t magic;
+    std::uint32_t version;
+
+    // Whole file size - a truncated file is caught before any table is read
+    std::uint32_t size;
+
+    // Lang_list of the table
+    std::uint32_t lang;
+
+    std::uint32_t count;
+    std::uint32_t offsets_offset;
+
+    std::uint32_t text_offset;
+    std::uint32_t text_size;
+};
+
+static_assert(sizeof(String_table_header) == 32, "String_table_header layout is the file layout");
+
+// =========================================================================================== STRING TABLE FORMAT
+
+
+// =========================================================================================== STRING TABLE VIEW
+
+
+/**
+ * @brief Read-only view of a cooked string table in memory.
+ *
+ * open() checks the header and that the offsets are inside the text, once;
+ * get() is an array index after that. The memory is not owned - it is the mapped
+ * pack or the buffer of Lang_state.
+ *
+ * Usage:
+ * @code
+ * String_table_view table;
+ * if (table.open(data, size)) std::string_view title = table.get(STR_MENU_TITLE);
+ * @endcode
+ */
+class String_table_view
+{
+
+public:
+
+    // false if the data isn't a valid string table of this version
+    bool open(const void* data, size_t size);
+
+    bool is_open() const { return header != nullptr; }
+
+    // String by its id, empty for an unknown id (or without the table)
+    std::string_view get(std::uint32_t id) const
+    {
+        if (!header || id >= header->count) return {};
+
+        return std::string_view(text + offsets[id], offsets[id + 1] - offsets[id] - 1);
+    }
+
+    std::uint32_t get_count() const { return header ? header->count : 0; }
+
+    std::uint32_t get_lang() const { return header ? header->lang : 0; }
+
+
+private:
+
+    const String_table_header* header = nullptr;
+    const std::uint32_t* offsets = nullptr;
+    const char* text = nullptr;
+};
+
+// =========================================================================================== STRING TABLE VIEW
+
+
+// =========================================================================================== STRING TABLE COOKING
+
+/**
+ * @brief Converts the text source of one language into the cooked table (host side).
+ *
+ * The key list is one key per line - the order is the string id. The language source is
+ * one string per line, the key, then the text after the whitespace ('#' at the line
+ * start is a comment, \n in the text is the line break):
+ *
+ *     MENU_TITLE     Miyoo Square
+ *     MENU_START     Press A to start\nor START
+ *
+ * @param keys   Text of the key list.
+ * @param source Text of the language source.
+ * @param lang   Lang_list of the language (stored in the header).
+ * @param out    Cooked table.
+ * @param error  Message with the line number or the key on failure.
+ * @return false on a syntax error, an unknown, repeated or missing key.
+ */
+bool string_table_cook(const std::string& keys, const std::string& source, std::uint32_t lang,
+                       std::vector<std::uint8_t>& out, std::string& error);
+
+/**
+ * @brief Header with the enum of the string ids for the key list (host side).
+ *
+ * Next to the enum the header has a constexpr string_id_of(hash): the id of the key
+ * by its Hash_key ("MENU_TITLE"_key.value) - resolved by the compiler, STR_COUNT if unknown.
+ *
+ * @param keys   Text of the key list.
+ * @param name   Name of the enum, its values are STR_<key> and STR_COUNT.
+ * @param header Text of the header.
+ * @param error  Message with the line number on failure.
+ * @return false on a syntax error of the key list or two keys of one hash.
+ */
+bool string_table_enum(const std::string& keys, const std::string& name, std::string& header, std::string& error);
+
+// =========================================================================================== STRING TABLE COOKING
@@ -0,0 +1,195 @@
+// layer_stack.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "layer_stack.h"
+#include "../render_queue/render_queue.h"
+#include "../frame/frame.h"
+#include "../render_stats/render_stats.h"
+#include "../render_target_pool/render_target_pool.h"
+
+#include <algorithm>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== LAYER STACK
+
+std::vector<Layer_stack*>& Layer_stack::registry()
+{
+    static std::vector<Layer_stack*> stacks;
+
+    return stacks;
+}
+
+
+Layer_stack::Layer_stack() { registry().push_back(this); }
+
+
+Layer_stack::~Layer_stack()
+{
+    release();
+
+    auto& stacks = registry();
+    stacks.erase(std::remove(stacks.begin(), stacks.end(), this), stacks.end());
+}
+
+
+int Layer_stack::add(const std::string& name, Render_fn render, bool cached)
+{
+    Layer layer;
+
+    layer.name = name;
+    layer.render = std::move(render);
+    layer.cached = cached;
+
+    layers.push_back(std::move(layer));
+
+    return static_cast<int>(layers.size()) - 1;
+}
+
+
+bool Layer_stack::invalidate(const std::string& name)
+{
+    for (size_t i = 0; i < layers.size(); ++i)
+    {
+        if (layers[i].name != name) continue;
+
+        invalidate(static_cast<int>(i));
+        return true;
+    }
+
+    return false;
+}
+
+
+void Layer_stack::invalidate(int index)
+{
+    if (index < 0 || index >= static_cast<int>(layers.size())) return;
+
+    layers[index].dirty = true;
+
+    Frame::Instance().mark_dirty();
+}
+
+
+void Layer_stack::invalidate_all()
+{
+    for (Layer& layer : layers) layer.dirty = true;
+
+    Frame::Instance().mark_dirty();
+}
+
+
+void Layer_stack::render(SDL_Renderer* r)
+{
+    if (!r) return;
+
+    // The size of the pass - a reduced frame target (the dynamic resolution) still draws the logical one
+    int w = 0, h = 0;
+    Frame::Instance().get_logical_size(w, h);
+
+    if (w <= 0 || h <= 0) SDL_GetRendererOutputSize(r, &w, &h);
+
+    const bool targets = SDL_RenderTargetSupported(r) == SDL_TRUE;
+
+    for (Layer& layer : layers)
+    {
+        if (layer.cached && targets && (!layer.dirty || rebuild(r, layer, w, h)))
+        {
+            Render::copy(r, layer.texture, nullptr, nullptr);
+            continue;
+        }
+
+        render_live(r, layer);
+    }
+}
+
+
+bool Layer_stack::rebuild(SDL_Renderer* r, Layer& layer, int w, int h)
+{
+    // (Re)create the texture only if the output size changed
+    if (layer.texture)
+    {
+        int tw = 0, th = 0;
+        SDL_QueryTexture(layer.texture, nullptr, nullptr, &tw, &th);
+
+        if (tw != w || th != h)
+        {
+            Render_target_pool::Instance().release(layer.texture);
+            layer.texture = nullptr;
+        }
+    }
+
+    if (!layer.texture)
+    {
+        layer.texture = Render_target_pool::Instance().acquire(r, w, h, SDL_PIXELFORMAT_ARGB8888);
+
+        if (!layer.texture)
+        {
+            SDL_Log("Layer %s texture creation failed: %s", layer.name.c_str(), SDL_GetError());
+            return false;
+        }
+
+        SDL_SetTextureBlendMode(layer.texture, SDL_BLENDMODE_BLEND);
+    }
+
+    SDL_Texture* prev_target = SDL_GetRenderTarget(r);
+
+    Render::set_target(r, layer.texture);
+    SDL_SetRenderDrawColor(r, 0, 0, 0, 0);
+    Render::clear(r);
+
+    render_live(r, layer);
+
+    Render::set_target(r, prev_target);
+
+    layer.dirty = false;
+    ++rebuild_count;
+
+    return true;
+}
+
+
+void Layer_stack::render_live(SDL_Renderer* r, Layer& layer)
+{
+    if (!layer.render) return;
+
+    // Only this layer's queued commands - the layers stay in order
+    Render_queue& queue = Render_queue::Instance();
+    int mark = queue.get_command_count();
+
+    layer.render(r);
+
+    queue.submit_since(r, mark);
+}
+
+
+void Layer_stack::release()
+{
+    for (Layer& layer : layers)
+    {
+        Render_target_pool::Instance().release(layer.texture);
+
+        layer.texture = nullptr;
+        layer.dirty = true;
+    }
+}
+
+
+Uint64 Layer_stack::get_rebuild_count() const { return rebuild_count; }
+
+
+void Layer_stack::invalidate_all_stacks()
+{
+    for (Layer_stack* stack : registry()) stack->invalidate_all();
+}
+
+
+void Layer_stack::release_all_stacks()
+{
+    for (Layer_stack* stack : registry()) stack->release();
+}
+
+// =========================================================================================== LAYER STACK
@@ -0,0 +1,130 @@
+// layer_stack.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== LAYER STACK
+
+
+/**
+ * @brief Named render layers of a state with the static layer caching.
+ *
+ * The state splits its picture into layers, bottom to top (background, playfield, HUD).
+ * A cached layer is rendered into its own target texture only when it was invalidated,
+ * every other frame it costs one texture copy. A live layer is rendered every frame
+ * as before - the one with the moving square.
+ *
+ * Layer callbacks draw with the renderer or the Render_queue - the queued commands
+ * of every layer are submitted in the layer order.
+ *
+ * Without the render target support all of the layers are drawn live.
+ * The engine invalidates all stacks when the render targets are reset and releases
+ * their textures on the shutdown.
+ *
+ * Example usage:
+ *
+ * Layer_stack layers;
+ *
+ * layers.add("background", draw_background);               // cached
+ * layers.add("playfield",  draw_square, false);             // live
+ * layers.add("hud",        draw_hud);                       // cached
+ *
+ * // state render:    layers.render(r);
+ * // on score change: layers.invalidate("hud");
+ */
+class Layer_stack
+{
+
+public:
+
+    using Render_fn = std::function<void(SDL_Renderer*)>;
+
+
+    Layer_stack();
+
+    // Releases the layer textures
+    ~Layer_stack();
+
+    // Textures and the registration are not copyable
+    Layer_stack(const Layer_stack&) = delete;
+    Layer_stack& operator=(const Layer_stack&) = delete;
+
+
+    /**
+     * @brief Adds a layer on top of the previous ones.
+     *
+     * @param name   Layer name for invalidate().
+     * @param render Draws the layer content (full output size, transparent where empty).
+     * @param cached true - render into a texture on invalidation only, false - every frame.
+     * @return Layer index.
+     */
+    int add(const std::string& name, Render_fn render, bool cached = true);
+
+    // Marks a cached layer for the redraw (and the frame as dirty). Returns false if unknown.
+    bool invalidate(const std::string& name);
+    void invalidate(int index);
+
+    // Marks all cached layers for the redraw
+    void invalidate_all();
+
+    /**
+     * @brief Composites all layers: rebuilds the invalidated ones, copies the cached ones,
+     * draws the live ones.
+     *
+     * @param r Renderer of the frame.
+     */
+    void render(SDL_Renderer* r);
+
+    // Destroys the layer textures (they are rebuilt by the next render)
+    void release();
+
+
+    // Number of the layer rebuilds since the start (for the diagnostics)
+    Uint64 get_rebuild_count() const;
+
+
+    // Invalidates every existing stack (render targets reset)
+    static void invalidate_all_stacks();
+
+    // Releases the textures of every existing stack (before the renderer is destroyed)
+    static void release_all_stacks();
+
+
+private:
+
+    struct Layer
+    {
+        std::string name;
+        Render_fn render;
+        bool cached = true;
+        bool dirty = true;
+        SDL_Texture* texture = nullptr;
+    };
+
+    // Renders the layer into its texture, false if it can't be cached
+    bool rebuild(SDL_Renderer* r, Layer& layer, int w, int h);
+
+    // Draws the layer directly into the current target
+    static void render_live(SDL_Renderer* r, Layer& layer);
+
+
+    std::vector<Layer> layers;
+
+    Uint64 rebuild_count = 0;
+
+
+    // All existing stacks - for the engine-wide reset and release
+    static std::vector<Layer_stack*>& registry();
+};
+
+// =========================================================================================== LAYER STACK
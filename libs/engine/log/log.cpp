@@ -0,0 +1,202 @@
+// log.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "log.h"
+#include "../engine_clock/engine_clock.h"
+#include "../telemetry/telemetry.h"
+#include "../thread_roles/thread_roles.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <string>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== LOG
+
+// Drain period - the console is behind the game by this much at most
+static constexpr Uint32 DRAIN_MS = 10;
+
+static const char* const LEVEL_TAGS[] = {"D", "I", "W", "E"};
+
+
+Log& Log::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Log instance;
+    return instance;
+}
+
+
+Log::Ring& Log::get_ring()
+{
+    static thread_local Ring* ring = nullptr;
+
+    if (!ring)
+    {
+        std::unique_ptr<Ring> created(new Ring());
+
+        ring = created.get();
+
+        std::lock_guard<std::mutex> guard(rings_lock);
+        rings.push_back(std::move(created));
+    }
+
+    return *ring;
+}
+
+
+void Log::write(Log_level level, const char* format, ...)
+{
+    if (level < min_level.load(std::memory_order_relaxed)) return;
+
+    Ring& ring = get_ring();
+    Line& line = ring.scratch;
+
+    std::va_list args;
+    va_start(args, format);
+    const int length = std::vsnprintf(line.text, LINE_BYTES, format, args);
+    va_end(args);
+
+    if (length < 0) return;
+
+    line.ticks = Engine_clock::now();
+    line.level = level;
+    line.length = static_cast<std::uint16_t>(std::min<size_t>(static_cast<size_t>(length), LINE_BYTES - 1));
+
+    // No drain thread - written at once
+    if (!running.load(std::memory_order_acquire))
+    {
+        output(&line, 1);
+        return;
+    }
+
+    if (!ring.lines.push(line)) dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+bool Log::start()
+{
+    if (drainer) return true;
+
+    batch.reserve(RING_LINES * 4);
+
+    running.store(true, std::memory_order_release);
+
+    drainer = SDL_CreateThread(drain_main, "log", this);
+
+    if (!drainer)
+    {
+        running.store(false, std::memory_order_release);
+        SDL_Log("Log thread can't be created: %s", SDL_GetError());
+        return false;
+    }
+
+    return true;
+}
+
+
+void Log::stop()
+{
+    if (!drainer) return;
+
+    running.store(false, std::memory_order_release);
+
+    SDL_WaitThread(drainer, nullptr);
+    drainer = nullptr;
+
+    // Pushed while the thread was ending
+    drain();
+}
+
+
+int SDLCALL Log::drain_main(void* userdata)
+{
+    static_cast<Log*>(userdata)->drain_loop();
+    return 0;
+}
+
+
+void Log::drain_loop()
+{
+    if (!Thread_roles::Instance().apply(Thread_role::IO)) SDL_SetThreadPriority(SDL_THREAD_PRIORITY_LOW);
+
+    while (running.load(std::memory_order_acquire))
+    {
+        if (!drain()) SDL_Delay(DRAIN_MS);
+    }
+
+    drain();
+}
+
+
+bool Log::drain()
+{
+    batch.clear();
+
+    {
+        std::lock_guard<std::mutex> guard(rings_lock);
+
+        Line line;
+
+        for (const std::unique_ptr<Ring>& ring : rings)
+            while (ring->lines.pop(line)) batch.push_back(line);
+    }
+
+    const std::uint64_t drops = dropped.load(std::memory_order_relaxed);
+
+    if (drops != reported_drops)
+    {
+        Line line;
+
+        line.ticks = Engine_clock::now();
+        line.level = Log_level::WARNING;
+        line.length = static_cast<std::uint16_t>(std::snprintf(line.text, LINE_BYTES, "Log: %llu lines dropped (full ring)",
+                                                               static_cast<unsigned long long>(drops - reported_drops)));
+        batch.push_back(line);
+
+        reported_drops = drops;
+    }
+
+    if (batch.empty()) return false;
+
+    // The rings are drained one after another - the time orders the threads
+    std::stable_sort(batch.begin(), batch.end(), [](const Line& a, const Line& b) { return a.ticks < b.ticks; });
+
+    output(batch.data(), batch.size());
+
+    return true;
+}
+
+
+void Log::output(const Line* lines, size_t count)
+{
+    std::string out, err;
+
+    Telemetry& telemetry = Telemetry::Instance();
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const Line& line = lines[i];
+        std::string& target = line.level >= Log_level::WARNING ? err : out;
+
+        target += LEVEL_TAGS[static_cast<int>(line.level)];
+        target += ' ';
+        target.append(line.text, line.length);
+        target += '\n';
+
+        if (telemetry.is_open()) telemetry.write(line.text, line.length);
+    }
+
+    // One write per stream and batch
+    if (!out.empty()) std::fwrite(out.data(), 1, out.size(), stdout);
+    if (!err.empty()) std::fwrite(err.data(), 1, err.size(), stderr);
+
+    std::fflush(stdout);
+}
+
+// =========================================================================================== LOG
@@ -0,0 +1,174 @@
+// log.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../platform/platform.h"
+#include "../audio/spsc_ring.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== LOG
+
+
+enum class Log_level : std::uint8_t {
+
+    DEBUG,      // Traces of the development (the state transitions) - compiled out of the release builds
+    INFO,       // Events worth keeping in a session log
+    WARNING,    // Recovered problems
+    ERROR       // Failed operations
+
+};
+
+
+// Lowest level, which is compiled in (CMake MIYOO_LOG_LEVEL) - by default DEBUG, without it in the NDEBUG builds
+#ifndef MIYOO_LOG_LEVEL
+#ifdef NDEBUG
+#define MIYOO_LOG_LEVEL 1
+#else
+#define MIYOO_LOG_LEVEL 0
+#endif
+#endif
+
+// printf style - the filtered out levels are not compiled at all, their arguments are not evaluated
+#if MIYOO_LOG_LEVEL <= 0
+#define LOG_DEBUG(...) Log::Instance().write(Log_level::DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+#if MIYOO_LOG_LEVEL <= 1
+#define LOG_INFO(...) Log::Instance().write(Log_level::INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if MIYOO_LOG_LEVEL <= 2
+#define LOG_WARNING(...) Log::Instance().write(Log_level::WARNING, __VA_ARGS__)
+#else
+#define LOG_WARNING(...) ((void)0)
+#endif
+
+#define LOG_ERROR(...) Log::Instance().write(Log_level::ERROR, __VA_ARGS__)
+
+
+/**
+ * @brief Engine log: the line is formatted into a buffer of the calling thread, a
+ * background thread writes it.
+ *
+ * A log call on the game thread is a vsnprintf into the thread's record and a push into
+ * its own ring - no stream, no lock, no console write in the transition. The drain thread
+ * collects the rings every DRAIN_MS, orders the lines by their time and writes them in
+ * one call per batch: DEBUG and INFO to stdout, WARNING and ERROR to stderr, and every
+ * line into the Telemetry file, if it is open.
+ *
+ * A full ring drops the line and counts it (the drops are logged by the drain thread).
+ * Before start() and after stop() the lines are written at once - the tools and the
+ * early startup need no thread.
+ *
+ * Usage:
+ * @code
+ * LOG_DEBUG("Entering %s", state->name.c_str());
+ * LOG_ERROR("State not found: %s", label);
+ *
+ * Log::Instance().start();  // SDL_app_init
+ * Log::Instance().stop();   // SDL_app_shutdown - writes the rest
+ * @endcode
+ */
+class Log
+{
+
+public:
+
+    // Longest line, the longer ones are cut
+    static constexpr size_t LINE_BYTES = 200;
+
+    // Lines queued per thread
+    static constexpr std::uint32_t RING_LINES = 64;
+
+
+    // Returns the singleton instance.
+    static Log& Instance();
+
+
+    // Formats and queues the line (any thread)
+    void write(Log_level level, const char* format, ...) SDL_PRINTF_VARARG_FUNC(3);
+
+    // Lowest level written at the run time (the compiled levels only)
+    void set_level(Log_level level) { min_level.store(level, std::memory_order_relaxed); }
+
+    // Starts the drain thread - false if it can't be created (the lines are written at once then)
+    bool start();
+
+    // Writes the queued lines and stops the drain thread
+    void stop();
+
+    // Lines dropped, because the ring of their thread was full
+    std::uint64_t get_dropped_count() const { return dropped.load(std::memory_order_relaxed); }
+
+
+private:
+
+    Log() = default;
+
+    // Singleton - not copyable
+    Log(const Log&) = delete;
+    Log& operator=(const Log&) = delete;
+
+
+    struct Line
+    {
+        Uint64 ticks;
+        Log_level level;
+        std::uint16_t length;
+        char text[LINE_BYTES];
+    };
+
+    // Ring of one thread - pushed only by it, popped by the drain thread
+    struct Ring
+    {
+        Spsc_ring<Line, RING_LINES> lines;
+
+        // Formatting buffer of the thread
+        Line scratch;
+    };
+
+
+    // Ring of the calling thread, created on its first line
+    Ring& get_ring();
+
+    static int SDLCALL drain_main(void* userdata);
+    void drain_loop();
+
+    // Pops every queued line and writes them, false if there was none
+    bool drain();
+
+    // Writes the lines in the time order
+    static void output(const Line* lines, size_t count);
+
+
+    std::atomic<Log_level> min_level{Log_level::DEBUG};
+
+    // Every ring ever created - the lines of the finished threads are still drained
+    std::mutex rings_lock;
+    std::vector<std::unique_ptr<Ring>> rings;
+
+    // Drain side
+    std::vector<Line> batch;
+    std::uint64_t reported_drops = 0;
+
+    std::atomic<std::uint64_t> dropped{0};
+
+    SDL_Thread* drainer = nullptr;
+    std::atomic<bool> running{false};
+};
+
+// =========================================================================================== LOG
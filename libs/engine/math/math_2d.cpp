@@ -0,0 +1,183 @@
+// math_2d.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "math_2d.h"
+
+#include <cmath>
+
+#if defined(MATH_NEON)
+    #include <arm_neon.h>
+#elif defined(MATH_SSE2)
+    #include <emmintrin.h>
+#endif
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== VECTOR
+
+float length(Vec2 v) { return std::sqrt(length_squared(v)); }
+
+// =========================================================================================== VECTOR
+
+
+// =========================================================================================== AFFINE
+
+Affine2 Affine2::rotation_deg(float angle_deg)
+{
+    float sin_a = 0.0f, cos_a = 1.0f;
+
+    sin_cos_deg(angle_deg, sin_a, cos_a);
+
+    return rotation(cos_a, sin_a);
+}
+
+
+bool sin_cos_deg(float angle_deg, float& sin_a, float& cos_a)
+{
+    // Unrotated - the most of the sprites
+    if (angle_deg == 0.0f)
+    {
+        sin_a = 0.0f;
+        cos_a = 1.0f;
+        return true;
+    }
+
+    // Whole quarters - the sine and the cosine by the table. Below 2^24 degrees the product of
+    // the quarters back is exact, so an angle a little off the quarter never passes
+    const float quarters = angle_deg / 90.0f;
+
+    if (std::fabs(angle_deg) < 16777216.0f && quarters == std::floor(quarters) && quarters * 90.0f == angle_deg)
+    {
+        static constexpr float SIN[4] = {0.0f, 1.0f, 0.0f, -1.0f};
+        static constexpr float COS[4] = {1.0f, 0.0f, -1.0f, 0.0f};
+
+        const int q = static_cast<int>(static_cast<long>(quarters) & 3);
+
+        sin_a = SIN[q];
+        cos_a = COS[q];
+        return true;
+    }
+
+    const float rad = angle_deg * 3.14159265f / 180.0f;
+
+    sin_a = std::sin(rad);
+    cos_a = std::cos(rad);
+
+    return false;
+}
+
+// =========================================================================================== AFFINE
+
+
+// =========================================================================================== BATCH KERNELS
+
+void transform_points_scalar(const Affine2& m, const Vec2* in, Vec2* out, int count)
+{
+    for (int i = 0; i < count; ++i) out[i] = m.apply(in[i]);
+}
+
+
+void transform_quads_scalar(const Affine2* m, const Vec2* in, Vec2* out, int quads)
+{
+    for (int q = 0; q < quads; ++q)
+        for (int k = q * 4; k < q * 4 + 4; ++k) out[k] = m[q].apply(in[k]);
+}
+
+
+#if defined(MATH_NEON)
+
+// Four points, deinterleaved by the load: x' = (a * x + c * y) + tx - the order of apply(), no fused multiply-add
+static inline float32x4x2_t transform4(const float32x4x2_t& p, float32x4_t a, float32x4_t b, float32x4_t c, float32x4_t d,
+                                       float32x4_t tx, float32x4_t ty)
+{
+    float32x4x2_t r;
+
+    r.val[0] = vaddq_f32(vaddq_f32(vmulq_f32(a, p.val[0]), vmulq_f32(c, p.val[1])), tx);
+    r.val[1] = vaddq_f32(vaddq_f32(vmulq_f32(b, p.val[0]), vmulq_f32(d, p.val[1])), ty);
+
+    return r;
+}
+
+
+void transform_points(const Affine2& m, const Vec2* in, Vec2* out, int count)
+{
+    const float32x4_t a = vdupq_n_f32(m.a), b = vdupq_n_f32(m.b), c = vdupq_n_f32(m.c), d = vdupq_n_f32(m.d);
+    const float32x4_t tx = vdupq_n_f32(m.tx), ty = vdupq_n_f32(m.ty);
+
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4)
+        vst2q_f32(&out[i].x, transform4(vld2q_f32(&in[i].x), a, b, c, d, tx, ty));
+
+    transform_points_scalar(m, in + i, out + i, count - i);
+}
+
+
+void transform_quads(const Affine2* m, const Vec2* in, Vec2* out, int quads)
+{
+    for (int q = 0; q < quads; ++q)
+    {
+        const Affine2& t = m[q];
+
+        vst2q_f32(&out[q * 4].x, transform4(vld2q_f32(&in[q * 4].x), vdupq_n_f32(t.a), vdupq_n_f32(t.b), vdupq_n_f32(t.c),
+                                            vdupq_n_f32(t.d), vdupq_n_f32(t.tx), vdupq_n_f32(t.ty)));
+    }
+}
+
+#elif defined(MATH_SSE2)
+
+// Two interleaved points [x0 y0 x1 y1] by the columns [a b a b], [c d c d] and [tx ty tx ty]
+static inline __m128 transform2(__m128 p, __m128 col0, __m128 col1, __m128 t)
+{
+    const __m128 xs = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 0, 0));
+    const __m128 ys = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 1, 1));
+
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(col0, xs), _mm_mul_ps(col1, ys)), t);
+}
+
+
+void transform_points(const Affine2& m, const Vec2* in, Vec2* out, int count)
+{
+    const __m128 col0 = _mm_setr_ps(m.a, m.b, m.a, m.b);
+    const __m128 col1 = _mm_setr_ps(m.c, m.d, m.c, m.d);
+    const __m128 t = _mm_setr_ps(m.tx, m.ty, m.tx, m.ty);
+
+    int i = 0;
+
+    for (; i + 2 <= count; i += 2)
+        _mm_storeu_ps(&out[i].x, transform2(_mm_loadu_ps(&in[i].x), col0, col1, t));
+
+    transform_points_scalar(m, in + i, out + i, count - i);
+}
+
+
+void transform_quads(const Affine2* m, const Vec2* in, Vec2* out, int quads)
+{
+    for (int q = 0; q < quads; ++q)
+    {
+        const Affine2& a = m[q];
+
+        const __m128 col0 = _mm_setr_ps(a.a, a.b, a.a, a.b);
+        const __m128 col1 = _mm_setr_ps(a.c, a.d, a.c, a.d);
+        const __m128 t = _mm_setr_ps(a.tx, a.ty, a.tx, a.ty);
+
+        const int k = q * 4;
+
+        _mm_storeu_ps(&out[k].x, transform2(_mm_loadu_ps(&in[k].x), col0, col1, t));
+        _mm_storeu_ps(&out[k + 2].x, transform2(_mm_loadu_ps(&in[k + 2].x), col0, col1, t));
+    }
+}
+
+#else
+
+void transform_points(const Affine2& m, const Vec2* in, Vec2* out, int count) { transform_points_scalar(m, in, out, count); }
+
+
+void transform_quads(const Affine2* m, const Vec2* in, Vec2* out, int quads) { transform_quads_scalar(m, in, out, quads); }
+
+#endif
+
+// =========================================================================================== BATCH KERNELS
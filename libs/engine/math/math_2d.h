@@ -0,0 +1,305 @@
+// math_2d.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== KERNEL SELECTION
+
+// Same selection as the particle kernels: NEON on the ARM Linux builds, SSE2 on the x86 ones
+#if defined(PLATFORM_LINUX) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+    #define MATH_NEON
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define MATH_SSE2
+#endif
+
+// =========================================================================================== KERNEL SELECTION
+
+
+// =========================================================================================== VECTOR
+
+
+/**
+ * @brief 2D point or vector of the render space (pixels, y down).
+ *
+ * Two floats, aligned to 8 - one 64-bit load, two of them per SIMD register in the
+ * batch kernels, and the same layout as SDL_FPoint (to_point(), to_vec2()).
+ * Every operation is constexpr - the constant offsets and the anchors fold at compile time.
+ */
+struct alignas(8) Vec2
+{
+    float x;
+    float y;
+
+    constexpr Vec2 operator+(Vec2 o) const { return {x + o.x, y + o.y}; }
+    constexpr Vec2 operator-(Vec2 o) const { return {x - o.x, y - o.y}; }
+    constexpr Vec2 operator-() const { return {-x, -y}; }
+    constexpr Vec2 operator*(float s) const { return {x * s, y * s}; }
+    constexpr Vec2 operator/(float s) const { return {x / s, y / s}; }
+
+    constexpr Vec2& operator+=(Vec2 o) { x += o.x; y += o.y; return *this; }
+    constexpr Vec2& operator-=(Vec2 o) { x -= o.x; y -= o.y; return *this; }
+    constexpr Vec2& operator*=(float s) { x *= s; y *= s; return *this; }
+
+    constexpr bool operator==(Vec2 o) const { return x == o.x && y == o.y; }
+    constexpr bool operator!=(Vec2 o) const { return !(*this == o); }
+};
+
+constexpr Vec2 operator*(float s, Vec2 v) { return v * s; }
+
+// Per-component product (the scale of a size)
+constexpr Vec2 mul(Vec2 a, Vec2 b) { return {a.x * b.x, a.y * b.y}; }
+
+constexpr float dot(Vec2 a, Vec2 b) { return a.x * b.x + a.y * b.y; }
+
+// Z of the 3D cross product - positive if b is clockwise of a on the screen (y down)
+constexpr float cross(Vec2 a, Vec2 b) { return a.x * b.y - a.y * b.x; }
+
+constexpr float length_squared(Vec2 v) { return dot(v, v); }
+
+constexpr Vec2 lerp(Vec2 a, Vec2 b, float alpha) { return a + (b - a) * alpha; }
+
+float length(Vec2 v);
+
+constexpr SDL_FPoint to_point(Vec2 v) { return {v.x, v.y}; }
+constexpr Vec2 to_vec2(SDL_FPoint p) { return {p.x, p.y}; }
+
+// =========================================================================================== VECTOR
+
+
+// =========================================================================================== RECT
+
+
+/**
+ * @brief Axis-aligned rectangle by its two corners (the texture crops and regions, the bounds).
+ *
+ * [top_left, bottom_right) in the render space - the corners, not the size, so the
+ * overlap and the clip are compares only. Aligned to 16 - one SIMD register.
+ */
+struct alignas(16) Rect2
+{
+    Vec2 top_left;
+    Vec2 bottom_right;
+
+    static constexpr Rect2 from_size(Vec2 position, Vec2 size) { return {position, position + size}; }
+    static constexpr Rect2 from_frect(const SDL_FRect& r) { return {{r.x, r.y}, {r.x + r.w, r.y + r.h}}; }
+
+    constexpr float width() const { return bottom_right.x - top_left.x; }
+    constexpr float height() const { return bottom_right.y - top_left.y; }
+    constexpr Vec2 size() const { return bottom_right - top_left; }
+    constexpr Vec2 center() const { return (top_left + bottom_right) * 0.5f; }
+
+    constexpr bool empty() const { return !(bottom_right.x > top_left.x && bottom_right.y > top_left.y); }
+
+    constexpr bool contains(Vec2 p) const
+    {
+        return p.x >= top_left.x && p.y >= top_left.y && p.x < bottom_right.x && p.y < bottom_right.y;
+    }
+
+    // Touching rectangles don't overlap
+    constexpr bool overlaps(const Rect2& o) const
+    {
+        return top_left.x < o.bottom_right.x && o.top_left.x < bottom_right.x &&
+               top_left.y < o.bottom_right.y && o.top_left.y < bottom_right.y;
+    }
+
+    constexpr Rect2 translated(Vec2 offset) const { return {top_left + offset, bottom_right + offset}; }
+
+    constexpr Rect2 intersection(const Rect2& o) const
+    {
+        return {{top_left.x > o.top_left.x ? top_left.x : o.top_left.x, top_left.y > o.top_left.y ? top_left.y : o.top_left.y},
+                {bottom_right.x < o.bottom_right.x ? bottom_right.x : o.bottom_right.x,
+                 bottom_right.y < o.bottom_right.y ? bottom_right.y : o.bottom_right.y}};
+    }
+
+    constexpr SDL_FRect to_frect() const { return {top_left.x, top_left.y, width(), height()}; }
+};
+
+// =========================================================================================== RECT
+
+
+// =========================================================================================== AFFINE
+
+
+/**
+ * @brief 2x3 affine transform - the rotation, scale and shear of the columns, then the translation.
+ *
+ *     x' = a * x + c * y + tx
+ *     y' = b * x + d * y + ty
+ *
+ * a * b is "b first, then a" (the world of a child: parent * local). Everything but
+ * rotation_deg() (the sine and the cosine) is constexpr.
+ */
+struct alignas(8) Affine2
+{
+    float a, b;
+    float c, d;
+    float tx, ty;
+
+    static constexpr Affine2 identity() { return {1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f}; }
+
+    static constexpr Affine2 translation(Vec2 t) { return {1.0f, 0.0f, 0.0f, 1.0f, t.x, t.y}; }
+
+    static constexpr Affine2 scale(float sx, float sy) { return {sx, 0.0f, 0.0f, sy, 0.0f, 0.0f}; }
+
+    // By the cosine and the sine of the angle - clockwise on the screen (y down), like SDL_RenderCopyEx
+    static constexpr Affine2 rotation(float cos_a, float sin_a) { return {cos_a, sin_a, -sin_a, cos_a, 0.0f, 0.0f}; }
+
+    // By the angle in degrees - the right angles exactly (sin_cos_deg())
+    static Affine2 rotation_deg(float angle_deg);
+
+    constexpr Vec2 apply(Vec2 p) const { return {a * p.x + c * p.y + tx, b * p.x + d * p.y + ty}; }
+
+    // The vector - without the translation
+    constexpr Vec2 apply_vector(Vec2 v) const { return {a * v.x + c * v.y, b * v.x + d * v.y}; }
+
+    constexpr Affine2 operator*(const Affine2& o) const
+    {
+        return {a * o.a + c * o.b, b * o.a + d * o.b,
+                a * o.c + c * o.d, b * o.c + d * o.d,
+                a * o.tx + c * o.ty + tx, b * o.tx + d * o.ty + ty};
+    }
+
+    // Moved by the offset after the transform
+    constexpr Affine2 translated(Vec2 t) const { return {a, b, c, d, tx + t.x, ty + t.y}; }
+
+    constexpr float determinant() const { return a * d - b * c; }
+
+    // Inverse (the screen point to the local one) - identity for a singular transform
+    constexpr Affine2 inverse() const
+    {
+        const float det = determinant();
+
+        if (det == 0.0f) return identity();
+
+        const float r = 1.0f / det;
+
+        return {d * r, -b * r, -c * r, a * r, (c * ty - d * tx) * r, (b * tx - a * ty) * r};
+    }
+};
+
+
+/**
+ * @brief Sine and cosine of the angle in degrees (clockwise on the screen, y down).
+ *
+ * The right angles (0, 90, 180, 270 and their full turns either way) skip the
+ * trigonometry and are exact - 0 and +-1, so a quarter-turned sprite keeps its corners
+ * on the pixel grid (std::cos of the float pi / 2 isn't 0).
+ *
+ * @return true for a right angle.
+ */
+bool sin_cos_deg(float angle_deg, float& sin_a, float& cos_a);
+
+// =========================================================================================== AFFINE
+
+
+// =========================================================================================== BATCH KERNELS
+
+/**
+ * Points through one transform, out[i] = m.apply(in[i]) - the tiles, the particles, the
+ * children of a node. 2 points per SSE2 register, 4 per NEON iteration, the rest scalar;
+ * the same operations in the same order, the kernels give the same bits as apply().
+ * out could be in (in place), the pointers could be unaligned.
+ * The plain name is the best kernel of the build, the _scalar one is always available.
+ */
+void transform_points(const Affine2& m, const Vec2* in, Vec2* out, int count);
+void transform_points_scalar(const Affine2& m, const Vec2* in, Vec2* out, int count);
+
+/**
+ * Quads, every one through its own transform: the 4 points in[4 * q ...] by m[q] -
+ * the sprite corners of a batch (Sprite_batch). Same rules as transform_points().
+ */
+void transform_quads(const Affine2* m, const Vec2* in, Vec2* out, int quads);
+void transform_quads_scalar(const Affine2* m, const Vec2* in, Vec2* out, int quads);
+
+// =========================================================================================== BATCH KERNELS
+
+
+// =========================================================================================== FIXED POINT
+
+
+/**
+ * Q16.16 fixed-point number: 16 integer bits (pixels), 16 fraction bits.
+ *
+ * The simulation uses only the integer adds, shifts and the 64-bit products, so a
+ * tick gives the same bits on the x86 desktops and on the ARM Cortex-A7 - the input
+ * recordings replay to the same positions everywhere. The floats appear only at the
+ * render, through to_float().
+ */
+using Fixed = std::int32_t;
+
+namespace fx
+{
+    constexpr int SHIFT = 16;
+    constexpr Fixed ONE = 1 << SHIFT;
+    constexpr Fixed HALF = ONE / 2;
+
+    constexpr Fixed from_int(int value) { return static_cast<Fixed>(static_cast<std::uint32_t>(value) << SHIFT); }
+
+    // Rounded toward the negative infinity (the arithmetic shift)
+    constexpr int to_int(Fixed value) { return value >> SHIFT; }
+
+    // Only for the constants - the value is converted by the compiler, not by the FPU of the target
+    constexpr Fixed from_double(double value) { return static_cast<Fixed>(value * ONE + (value < 0.0 ? -0.5 : 0.5)); }
+
+    // Render only - never fed back into the simulation
+    constexpr float to_float(Fixed value) { return static_cast<float>(value) * (1.0f / ONE); }
+
+    constexpr Fixed mul(Fixed a, Fixed b) { return static_cast<Fixed>((static_cast<std::int64_t>(a) * b) >> SHIFT); }
+
+    constexpr Fixed div(Fixed a, Fixed b) { return static_cast<Fixed>((static_cast<std::int64_t>(a) * ONE) / b); }
+
+    constexpr Fixed abs(Fixed value) { return value < 0 ? -value : value; }
+
+    constexpr Fixed clamp(Fixed value, Fixed low, Fixed high) { return value < low ? low : value > high ? high : value; }
+
+    // Linear interpolation of the render, alpha 0 - 1
+    constexpr float lerp(Fixed a, Fixed b, float alpha) { return to_float(a) + (to_float(b) - to_float(a)) * alpha; }
+
+    /**
+     * @brief Converts a per-second rate to the per-tick one.
+     *
+     * @param per_second Rate in the units per second (px/s for a speed).
+     * @param tick_hz    Fixed tick rate (sdl_app_ctx::sim_hz).
+     * @param order      1 - a speed (one tick_dt), 2 - an acceleration (tick_dt squared).
+     */
+    constexpr Fixed per_tick(double per_second, int tick_hz, int order = 1)
+    {
+        return from_double(order == 2 ? per_second / (static_cast<double>(tick_hz) * tick_hz) : per_second / tick_hz);
+    }
+}
+
+
+// Q16.16 point or vector of the simulation - exact and the same on every build, to_vec2() for the render
+struct alignas(8) Vec2_fx
+{
+    Fixed x;
+    Fixed y;
+
+    constexpr Vec2_fx operator+(Vec2_fx o) const { return {x + o.x, y + o.y}; }
+    constexpr Vec2_fx operator-(Vec2_fx o) const { return {x - o.x, y - o.y}; }
+    constexpr Vec2_fx operator-() const { return {-x, -y}; }
+
+    constexpr Vec2_fx& operator+=(Vec2_fx o) { x += o.x; y += o.y; return *this; }
+    constexpr Vec2_fx& operator-=(Vec2_fx o) { x -= o.x; y -= o.y; return *this; }
+
+    constexpr bool operator==(Vec2_fx o) const { return x == o.x && y == o.y; }
+    constexpr bool operator!=(Vec2_fx o) const { return !(*this == o); }
+
+    // By a Q16.16 factor
+    constexpr Vec2_fx scaled(Fixed s) const { return {fx::mul(x, s), fx::mul(y, s)}; }
+
+    constexpr Vec2 to_vec2() const { return {fx::to_float(x), fx::to_float(y)}; }
+
+    // Render interpolation between the previous and the current tick, alpha 0 - 1
+    static constexpr Vec2 lerp(Vec2_fx a, Vec2_fx b, float alpha) { return {fx::lerp(a.x, b.x, alpha), fx::lerp(a.y, b.y, alpha)}; }
+};
+
+// =========================================================================================== FIXED POINT
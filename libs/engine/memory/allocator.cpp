@@ -0,0 +1,225 @@
+// allocator.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "allocator.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <mutex>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== HEAP ALLOCATOR
+
+void* Heap_allocator::allocate(size_t size, size_t align)
+{
+    if (align > __STDCPP_DEFAULT_NEW_ALIGNMENT__) return ::operator new(size, std::align_val_t(align));
+
+    return ::operator new(size);
+}
+
+
+void Heap_allocator::deallocate(void* p, size_t, size_t align)
+{
+    // Unsized - the states given to add_state() come from make_unique
+    if (align > __STDCPP_DEFAULT_NEW_ALIGNMENT__) ::operator delete(p, std::align_val_t(align));
+    else ::operator delete(p);
+}
+
+
+Heap_allocator& heap_allocator()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Heap_allocator instance;
+    return instance;
+}
+
+// =========================================================================================== HEAP ALLOCATOR
+
+
+// =========================================================================================== POOL ALLOCATOR
+
+Pool_allocator::Pool_allocator(size_t block_size, size_t blocks_per_slab, Allocator& parent)
+    : block_size((std::max(block_size, sizeof(Free_block)) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t)),
+      blocks_per_slab(std::max<size_t>(blocks_per_slab, 1)),
+      parent(parent)
+{
+}
+
+
+Pool_allocator::~Pool_allocator()
+{
+    for (void* slab : slabs) parent.deallocate(slab, block_size * blocks_per_slab);
+}
+
+
+void* Pool_allocator::allocate(size_t size, size_t align)
+{
+    if (size > block_size || align > alignof(std::max_align_t)) return parent.allocate(size, align);
+
+    if (!free_list) add_slab();
+
+    Free_block* block = free_list;
+    free_list = block->next;
+
+    return block;
+}
+
+
+void Pool_allocator::deallocate(void* p, size_t size, size_t align)
+{
+    if (!p) return;
+
+    if (size > block_size || align > alignof(std::max_align_t))
+    {
+        parent.deallocate(p, size, align);
+        return;
+    }
+
+    Free_block* block = static_cast<Free_block*>(p);
+
+    block->next = free_list;
+    free_list = block;
+}
+
+
+void Pool_allocator::add_slab()
+{
+    unsigned char* slab = static_cast<unsigned char*>(parent.allocate(block_size * blocks_per_slab));
+
+    slabs.push_back(slab);
+
+    // Reversed - the blocks are taken in the memory order
+    for (size_t i = blocks_per_slab; i-- > 0;)
+    {
+        Free_block* block = reinterpret_cast<Free_block*>(slab + i * block_size);
+
+        block->next = free_list;
+        free_list = block;
+    }
+}
+
+// =========================================================================================== POOL ALLOCATOR
+
+
+// =========================================================================================== SCOPE ARENA
+
+void Scope_arena::reset()
+{
+    // Newest first - an object may still use the older ones in its destructor
+    while (finalizers)
+    {
+        Finalizer* link = finalizers;
+
+        finalizers = link->next;
+        link->destroy(link->object);
+    }
+
+    arena.reset();
+}
+
+
+int Scope_arena::get_object_count() const
+{
+    int count = 0;
+
+    for (const Finalizer* link = finalizers; link; link = link->next) ++count;
+
+    return count;
+}
+
+// =========================================================================================== SCOPE ARENA
+
+
+// =========================================================================================== TRACKING ALLOCATOR
+
+namespace
+{
+    std::mutex registry_mutex;
+    Tracking_allocator* registry = nullptr;
+}
+
+
+Tracking_allocator::Tracking_allocator(const char* name, Allocator& parent) : name(name), parent(parent)
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+
+    // Appended - the report is in the creation order
+    Tracking_allocator** link = &registry;
+
+    while (*link) link = &(*link)->next;
+
+    *link = this;
+}
+
+
+Tracking_allocator::~Tracking_allocator()
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+
+    for (Tracking_allocator** link = &registry; *link; link = &(*link)->next)
+    {
+        if (*link != this) continue;
+
+        *link = next;
+        break;
+    }
+}
+
+
+void* Tracking_allocator::allocate(size_t size, size_t align)
+{
+    void* p = parent.allocate(size, align);
+
+    const size_t live = live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+
+    size_t peak = peak_bytes.load(std::memory_order_relaxed);
+
+    while (live > peak && !peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+
+    allocations.fetch_add(1, std::memory_order_relaxed);
+
+    return p;
+}
+
+
+void Tracking_allocator::deallocate(void* p, size_t size, size_t align)
+{
+    if (!p) return;
+
+    parent.deallocate(p, size, align);
+
+    live_bytes.fetch_sub(size, std::memory_order_relaxed);
+    frees.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+void Tracking_allocator::for_each(void (*visit)(const Tracking_allocator& tracker, void* context), void* context)
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+
+    for (const Tracking_allocator* t = registry; t; t = t->next) visit(*t, context);
+}
+
+
+void Tracking_allocator::dump_all(std::ostream& out)
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+
+    if (!registry) return;
+
+    out << "Subsystem memory (KB: live, peak; allocations, frees):\n";
+    out << std::fixed << std::setprecision(1);
+
+    for (const Tracking_allocator* t = registry; t; t = t->next)
+    {
+        out << "  " << std::setw(10) << std::left << t->name << std::right << std::setw(9) << t->get_live_bytes() / 1024.0
+            << std::setw(9) << t->get_peak_bytes() / 1024.0 << std::setw(10) << t->get_allocations() << std::setw(10)
+            << t->get_frees() << "\n";
+    }
+}
+
+// =========================================================================================== TRACKING ALLOCATOR
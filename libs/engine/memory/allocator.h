@@ -0,0 +1,350 @@
+// allocator.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../frame_arena/frame_arena.h"
+
+template <typename T> class Std_allocator;
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== ALLOCATOR
+
+
+/**
+ * @brief Memory source of an engine subsystem.
+ *
+ * The State_machine, the Asset_manager with the instance pools, the Audio_mixer and
+ * the Entity_store / Component_pool take one (the heap by default) - every subsystem
+ * can get its own pool, region or accounting without touching its code:
+ *
+ * @code
+ * static Tracking_allocator state_memory("states");
+ *
+ * app.app_sm.set_allocator(state_memory);   // before the first state
+ * @endcode
+ *
+ * The size and the alignment of an allocation are passed back on the deallocation,
+ * like the sized operator delete - the allocators keep no headers.
+ */
+class Allocator
+{
+
+public:
+
+    virtual ~Allocator() = default;
+
+    virtual void* allocate(size_t size, size_t align = alignof(std::max_align_t)) = 0;
+    virtual void deallocate(void* p, size_t size, size_t align = alignof(std::max_align_t)) = 0;
+
+protected:
+
+    Allocator() = default;
+
+    // The subsystems keep pointers to it
+    Allocator(const Allocator&) = delete;
+    Allocator& operator=(const Allocator&) = delete;
+};
+
+
+// operator new / delete - the default of every subsystem, counted by the Alloc_tracker
+class Heap_allocator final : public Allocator
+{
+
+public:
+
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t)) override;
+    void deallocate(void* p, size_t size, size_t align = alignof(std::max_align_t)) override;
+};
+
+// Shared heap allocator
+Heap_allocator& heap_allocator();
+
+
+/**
+ * @brief Fixed-size blocks from the slabs of the parent, recycled through a free list.
+ *
+ * The allocation and the free are a pointer pop and push - the many small same-size
+ * objects (the states, the map nodes) don't fragment the heap. The larger or the more
+ * aligned requests go to the parent. The slabs are returned by the destructor only.
+ * Not thread-safe - one subsystem, one thread.
+ */
+class Pool_allocator final : public Allocator
+{
+
+public:
+
+    Pool_allocator(size_t block_size, size_t blocks_per_slab, Allocator& parent = heap_allocator());
+    ~Pool_allocator() override;
+
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t)) override;
+    void deallocate(void* p, size_t size, size_t align = alignof(std::max_align_t)) override;
+
+    size_t get_block_size() const { return block_size; }
+    size_t get_slab_count() const { return slabs.size(); }
+
+    // Bytes of all of the slabs taken from the parent
+    size_t get_reserved_bytes() const { return slabs.size() * blocks_per_slab * block_size; }
+
+private:
+
+    struct Free_block { Free_block* next; };
+
+    void add_slab();
+
+    size_t block_size;
+    size_t blocks_per_slab;
+
+    Allocator& parent;
+
+    Free_block* free_list = nullptr;
+
+    std::vector<void*> slabs;
+};
+
+
+/**
+ * @brief Region over one Linear_arena block - the subsystem memory freed at once.
+ *
+ * A level or a scene puts its data here and reset() drops all of it (nothing may be in
+ * use then). Only the newest allocation is really freed by deallocate().
+ */
+class Linear_allocator final : public Allocator
+{
+
+public:
+
+    explicit Linear_allocator(size_t capacity) : arena(capacity) {}
+
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t)) override { return arena.allocate(size, align); }
+    void deallocate(void* p, size_t size, size_t = alignof(std::max_align_t)) override { arena.release(p, size); }
+
+    void reset() { arena.reset(); }
+
+    const Linear_arena& get_arena() const { return arena; }
+
+private:
+
+    Linear_arena arena;
+};
+
+
+/**
+ * @brief Region with a lifetime scope - the memory of a state, freed when the state exits.
+ *
+ * A Linear_allocator, which also destroys what create() made: the objects with a destructor
+ * are chained (the chain lives in the arena too) and reset() destroys them newest first,
+ * then drops the block at once. The trivially destructible data costs nothing to free,
+ * so tearing down a level of plain entities is O(1). The containers take allocator<T>().
+ * The objects are created and reset on one thread - the one of the scope.
+ *
+ * Usage:
+ * @code
+ * Level* level = arena.create<Level>(width, height);
+ * std::vector<Entity, Std_allocator<Entity>> entities(arena.allocator<Entity>());
+ *
+ * arena.reset();   // ~Level(), the entity buffer and everything else at once
+ * @endcode
+ */
+class Scope_arena final : public Allocator
+{
+
+public:
+
+    explicit Scope_arena(size_t capacity) : arena(capacity) {}
+    ~Scope_arena() override { reset(); }
+
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t)) override { return arena.allocate(size, align); }
+    void deallocate(void* p, size_t size, size_t = alignof(std::max_align_t)) override { arena.release(p, size); }
+
+    // Constructed in the arena, destroyed by reset() (if it has a destructor)
+    template <typename T, typename... Args>
+    T* create(Args&&... args)
+    {
+        if constexpr (std::is_trivially_destructible<T>::value)
+        {
+            return new (arena.allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+        else
+        {
+            // The link first - the newest allocation stays the object, a container can still grow
+            Finalizer* link = static_cast<Finalizer*>(arena.allocate(sizeof(Finalizer), alignof(Finalizer)));
+            T* object = new (arena.allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+
+            *link = {[](void* p) { static_cast<T*>(p)->~T(); }, object, finalizers};
+            finalizers = link;
+
+            return object;
+        }
+    }
+
+    template <typename T>
+    Std_allocator<T> allocator();
+
+    // Destroys the created objects newest first and frees everything - nothing may be in use
+    void reset();
+
+    const Linear_arena& get_arena() const { return arena; }
+
+    // Objects waiting for their destructor
+    int get_object_count() const;
+
+private:
+
+    struct Finalizer
+    {
+        void (*destroy)(void*);
+        void* object;
+        Finalizer* next;
+    };
+
+    Linear_arena arena;
+
+    // Newest first
+    Finalizer* finalizers = nullptr;
+};
+
+
+/**
+ * @brief Memory accounting of a subsystem over the parent allocator.
+ *
+ * Counts the live bytes, their peak and the allocations - thread-safe, the counters are
+ * atomic. Every tracking allocator is listed by dump_all() (the shutdown report).
+ */
+class Tracking_allocator final : public Allocator
+{
+
+public:
+
+    // The name is stored - a string literal
+    explicit Tracking_allocator(const char* name, Allocator& parent = heap_allocator());
+    ~Tracking_allocator() override;
+
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t)) override;
+    void deallocate(void* p, size_t size, size_t align = alignof(std::max_align_t)) override;
+
+    const char* get_name() const { return name; }
+
+    size_t get_live_bytes() const { return live_bytes.load(std::memory_order_relaxed); }
+    size_t get_peak_bytes() const { return peak_bytes.load(std::memory_order_relaxed); }
+    std::uint64_t get_allocations() const { return allocations.load(std::memory_order_relaxed); }
+    std::uint64_t get_frees() const { return frees.load(std::memory_order_relaxed); }
+
+    // Every tracking allocator alive: live and peak KB, allocations and frees
+    static void dump_all(std::ostream& out);
+
+    // Calls the visitor for every tracking allocator alive, in the creation order (under the registry lock)
+    static void for_each(void (*visit)(const Tracking_allocator& tracker, void* context), void* context);
+
+private:
+
+    const char* name;
+    Allocator& parent;
+
+    std::atomic<size_t> live_bytes{0};
+    std::atomic<size_t> peak_bytes{0};
+    std::atomic<std::uint64_t> allocations{0};
+    std::atomic<std::uint64_t> frees{0};
+
+    // Registry of dump_all()
+    Tracking_allocator* next = nullptr;
+};
+
+// =========================================================================================== ALLOCATOR
+
+
+// =========================================================================================== STD ADAPTERS
+
+
+/**
+ * @brief STL allocator over an engine Allocator - the containers of the subsystems.
+ *
+ * Default constructed - the heap. The allocator moves with the container on the move
+ * assignment and the swap, a copy keeps the allocator of its target.
+ *
+ * @tparam T Element type.
+ */
+template <typename T>
+class Std_allocator
+{
+
+public:
+
+    using value_type = T;
+
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    Std_allocator() noexcept : allocator(&heap_allocator()) {}
+    explicit Std_allocator(Allocator& allocator) noexcept : allocator(&allocator) {}
+
+    template <typename U>
+    Std_allocator(const Std_allocator<U>& other) noexcept : allocator(other.get_allocator()) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(allocator->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T* p, size_t n) noexcept { allocator->deallocate(p, n * sizeof(T), alignof(T)); }
+
+    Allocator* get_allocator() const noexcept { return allocator; }
+
+    template <typename U>
+    bool operator==(const Std_allocator<U>& other) const noexcept { return allocator == other.get_allocator(); }
+
+    template <typename U>
+    bool operator!=(const Std_allocator<U>& other) const noexcept { return allocator != other.get_allocator(); }
+
+private:
+
+    Allocator* allocator;
+};
+
+
+// unique_ptr deleter - destroys and returns the memory to the allocator it came from
+template <typename T>
+class Allocator_delete
+{
+
+public:
+
+    Allocator_delete() noexcept : allocator(&heap_allocator()) {}
+    explicit Allocator_delete(Allocator& allocator) noexcept : allocator(&allocator) {}
+
+    void operator()(T* p) const
+    {
+        p->~T();
+        allocator->deallocate(p, sizeof(T), alignof(T));
+    }
+
+private:
+
+    Allocator* allocator;
+};
+
+
+// Constructs the object in the allocator memory
+template <typename T, typename... Args>
+std::unique_ptr<T, Allocator_delete<T>> make_allocated(Allocator& allocator, Args&&... args)
+{
+    T* object = new (allocator.allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+
+    return std::unique_ptr<T, Allocator_delete<T>>(object, Allocator_delete<T>(allocator));
+}
+
+
+// Containers of the scope - declared above Std_allocator
+template <typename T>
+Std_allocator<T> Scope_arena::allocator() { return Std_allocator<T>(*this); }
+
+// =========================================================================================== STD ADAPTERS
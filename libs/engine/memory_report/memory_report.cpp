@@ -0,0 +1,143 @@
+// memory_report.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "memory_report.h"
+#include "../memory/allocator.h"
+#include "../asset/asset_manager.h"
+#include "../asset/asset_pack.h"
+#include "../asset/texture_budget.h"
+#include "../render_target_pool/render_target_pool.h"
+#include "../frame_arena/frame_arena.h"
+#include "../script/state_script.h"
+#include "../hash_key/interned_string.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <ostream>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== MEMORY REPORT
+
+Memory_report& Memory_report::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Memory_report instance;
+    return instance;
+}
+
+
+void Memory_report::set(const char* name, size_t current, size_t source_peak)
+{
+    int i = 0;
+
+    // A few lines - the names are compared, a tracker could come and go between the samples
+    while (i < count && std::strcmp(lines[i].name, name) != 0) ++i;
+
+    if (i == count)
+    {
+        if (count == MAX_LINES) return;
+
+        lines[count++] = {name, 0, 0};
+    }
+
+    lines[i].current = current;
+    lines[i].peak = std::max({lines[i].peak, current, source_peak});
+}
+
+
+void Memory_report::add_tracker(const Tracking_allocator& tracker, void* context)
+{
+    static_cast<Memory_report*>(context)->set(tracker.get_name(), tracker.get_live_bytes(), tracker.get_peak_bytes());
+}
+
+
+void Memory_report::sample()
+{
+    // A tracker gone since the last sample keeps its peak, at 0 bytes
+    for (int i = 0; i < count; ++i) lines[i].current = 0;
+
+    Tracking_allocator::for_each(add_tracker, this);
+
+    const Asset_manager& assets = Asset_manager::Instance();
+
+    set("images", assets.get_memory_bytes(Asset_type::IMAGE));
+    set("sounds", assets.get_memory_bytes(Asset_type::AUDIO));
+    set("fonts", assets.get_memory_bytes(Asset_type::FONT));
+    set("videos", assets.get_memory_bytes(Asset_type::VIDEO));
+
+    const Render_target_pool& targets = Render_target_pool::Instance();
+
+    // The mlock-ed pack pages of the hot assets - resident, not evictable
+    set("locked", Asset_pack::Instance().get_locked_bytes());
+
+    set("textures", Texture_budget::Instance().get_used_bytes());
+    set("targets", targets.get_live_bytes(), targets.get_peak_bytes());
+
+    set("arenas", Frame_arena::Instance().get_reserved_bytes());
+    set("strings", String_interner::Instance().get_reserved_bytes());
+
+#ifdef STATE_SCRIPTS
+    set("scripts", Script_runner::Instance().get_frame_pool().get_reserved_bytes());
+#endif
+
+    total = 0;
+
+    for (int i = 0; i < count; ++i) total += lines[i].current;
+
+    peak_total = std::max(peak_total, total);
+}
+
+
+void Memory_report::format_summary(char* out, size_t size, int max_lines) const
+{
+    if (size == 0) return;
+
+    int written = std::snprintf(out, size, "mem %.1f MB (peak %.1f)", total / 1048576.0, peak_total / 1048576.0);
+
+    // The largest first - a selection over the few lines, nothing is sorted in place
+    bool listed[MAX_LINES] = {};
+
+    for (int n = 0; n < max_lines && written >= 0 && static_cast<size_t>(written) < size; ++n)
+    {
+        int largest = -1;
+
+        for (int i = 0; i < count; ++i)
+            if (!listed[i] && lines[i].current > 0 && (largest < 0 || lines[i].current > lines[largest].current)) largest = i;
+
+        if (largest < 0) break;
+
+        listed[largest] = true;
+
+        written += std::snprintf(out + written, size - static_cast<size_t>(written), "%s %s %.1f", n == 0 ? ":" : ",",
+                                 lines[largest].name, lines[largest].current / 1048576.0);
+    }
+}
+
+
+void Memory_report::dump(std::ostream& out) const
+{
+    if (count == 0) return;
+
+    out << "=== Memory ===\n";
+    out << "Subsystem (KB: current, peak):\n";
+    out << std::fixed << std::setprecision(1);
+
+    for (int i = 0; i < count; ++i)
+    {
+        out << "  " << std::setw(10) << std::left << lines[i].name << std::right << std::setw(10) << lines[i].current / 1024.0
+            << std::setw(10) << lines[i].peak / 1024.0 << "\n";
+    }
+
+    out << "  " << std::setw(10) << std::left << "total" << std::right << std::setw(10) << total / 1024.0 << std::setw(10)
+        << peak_total / 1024.0 << "\n";
+
+    out << std::defaultfloat;
+}
+
+// =========================================================================================== MEMORY REPORT
@@ -0,0 +1,119 @@
+// memory_report.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstddef>
+#include <iosfwd>
+
+class Tracking_allocator;
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== MEMORY REPORT
+
+
+// Memory of one subsystem at the last sample and the largest one seen
+struct Memory_usage
+{
+    const char* name = nullptr;
+
+    size_t current = 0;
+    size_t peak = 0;
+};
+
+
+/**
+ * @brief Where the memory goes - the current and the peak bytes of every subsystem.
+ *
+ * sample() reads every source into a line, the sources don't overlap - the total is
+ * the footprint of the engine (the heap of the libraries and the code aside):
+ *
+ * - the Tracking_allocator subsystems - the states (the state machine), the asset index,
+ *   the instance pools, the audio mix buffers, the entities of the gameplay world and
+ *   any other tracker alive;
+ *
+ * - the loaded assets by type - the pixels of the images, the samples of the sounds,
+ *   the fonts, the video frame queues (Asset::get_memory_bytes()) - and the pack pages locked
+ *   for the hot assets;
+ *
+ * - the textures (Texture_budget - the images and the atlas pages) and the render targets;
+ *
+ * - the frame arenas, the interned names (the states, the asset paths) and the coroutine
+ *   frame pool of the scripts.
+ *
+ * The peak of a line is the peak of its source (the trackers, the target pool), else the
+ * largest sampled value - the growth over a long session shows in it.
+ *
+ * Singleton, sampled on the main thread: by the Debug_overlay text refresh, the telemetry
+ * metrics line and the shutdown report. Nothing is measured between the samples.
+ *
+ * Usage:
+ * @code
+ * Memory_report& memory = Memory_report::Instance();
+ *
+ * memory.sample();
+ * memory.format_summary(line, sizeof(line), 4);  // "mem 9.4 MB (peak 10.1): textures 5.2, images 2.0, ..."
+ * memory.dump(std::cout);
+ * @endcode
+ */
+class Memory_report
+{
+
+public:
+
+    // Lines of the report - the built-in sources and the trackers
+    static constexpr int MAX_LINES = 24;
+
+    // Returns the singleton instance.
+    static Memory_report& Instance();
+
+
+    // Reads every source (main thread) - the lines keep their order between the samples
+    void sample();
+
+    int get_line_count() const { return count; }
+    const Memory_usage& get_line(int index) const { return lines[index]; }
+
+    // Sum of the lines at the last sample, and the largest sampled sum
+    size_t get_total() const { return total; }
+    size_t get_peak_total() const { return peak_total; }
+
+    /**
+     * @brief One line of the last sample: the total and the largest subsystems, in MB.
+     *
+     * @param out       Buffer, always terminated.
+     * @param size      Its size.
+     * @param max_lines Largest subsystems listed after the total.
+     */
+    void format_summary(char* out, size_t size, int max_lines) const;
+
+    // Every line in KB: current, peak - and the total
+    void dump(std::ostream& out) const;
+
+
+private:
+
+    Memory_report() = default;
+
+    // Singleton - not copyable
+    Memory_report(const Memory_report&) = delete;
+    Memory_report& operator=(const Memory_report&) = delete;
+
+
+    // Sets the line of the name (appended on its first sample), the peak is the larger of both
+    void set(const char* name, size_t current, size_t source_peak = 0);
+
+    static void add_tracker(const Tracking_allocator& tracker, void* context);
+
+
+    Memory_usage lines[MAX_LINES];
+    int count = 0;
+
+    size_t total = 0;
+    size_t peak_total = 0;
+};
+
+// =========================================================================================== MEMORY REPORT
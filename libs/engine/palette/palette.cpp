@@ -0,0 +1,119 @@
+// palette.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "palette.h"
+#include "theme_group.h"
+#include "../frame/frame.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== PALETTE
+
+Palette& Palette::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Palette instance;
+
+    return instance;
+}
+
+
+// All slots start white - untinted
+
+Palette::Palette()
+{
+    for (SDL_Color& color : colors) color = {255, 255, 255, 255};
+}
+
+
+SDL_Color Palette::get(std::uint8_t index) const { return colors[index]; }
+
+
+void Palette::set(std::uint8_t index, SDL_Color color)
+{
+    colors[index] = color;
+
+    commit(index, 1);
+}
+
+
+void Palette::apply_theme(const SDL_Color* theme, int count)
+{
+    if (!theme || count <= 0) return;
+
+    if (count > MAX_COLORS) count = MAX_COLORS;
+
+    for (int i = 0; i < count; ++i) colors[i] = theme[i];
+
+    commit(0, count);
+}
+
+
+Uint64 Palette::get_version() const { return version; }
+
+
+SDL_Palette* Palette::get_sdl_palette()
+{
+    if (!sdl_palette)
+    {
+        sdl_palette = SDL_AllocPalette(MAX_COLORS);
+
+        if (!sdl_palette)
+        {
+            SDL_Log("Palette allocation failed: %s", SDL_GetError());
+            return nullptr;
+        }
+
+        SDL_SetPaletteColors(sdl_palette, colors, 0, MAX_COLORS);
+    }
+
+    return sdl_palette;
+}
+
+
+SDL_Surface* Palette::create_indexed_surface(int w, int h)
+{
+    SDL_Palette* palette = get_sdl_palette();
+
+    if (!palette) return nullptr;
+
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, w, h, 8, SDL_PIXELFORMAT_INDEX8);
+
+    if (!surface)
+    {
+        SDL_Log("Indexed surface creation failed: %s", SDL_GetError());
+        return nullptr;
+    }
+
+    // The surface references the shared palette, so the swaps reach it without a copy
+    SDL_SetSurfacePalette(surface, palette);
+
+    return surface;
+}
+
+
+void Palette::release()
+{
+    if (sdl_palette) SDL_FreePalette(sdl_palette);
+
+    sdl_palette = nullptr;
+}
+
+
+void Palette::commit(int first, int count)
+{
+    if (sdl_palette) SDL_SetPaletteColors(sdl_palette, colors + first, first, count);
+
+    ++version;
+
+    // The textured assets of the changed slots take the new colors
+    Theme_group::apply_palette(first, count);
+
+    // Everything drawn by the palette has changed
+    Frame::Instance().mark_dirty();
+}
+
+// =========================================================================================== PALETTE
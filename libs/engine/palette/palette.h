@@ -0,0 +1,110 @@
+// palette.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== PALETTE
+
+
+/**
+ * @brief Global indexed color table for the theme (color swap) mechanic.
+ *
+ * Everything in the game, which changes its color with the theme, is drawn by
+ * a palette index instead of a fixed color: the procedural shapes take
+ * Palette::Instance().get(SLOT) as their vertex color or tint, the cached shape
+ * textures and the white mask sprites are tinted by the modulation. So a theme
+ * swap only rewrites the table - O(palette size) - and no texture is regenerated
+ * or re-tinted, no matter how many assets are on the screen. The image instances
+ * follow the slots through their Theme_group.
+ *
+ * The same colors live in a shared SDL_Palette for the 8-bit indexed surfaces
+ * (create_indexed_surface()) of the software path.
+ *
+ * Singleton, like Frame, so the render callbacks can reach it without any context.
+ *
+ * Usage:
+ * @code
+ * enum : Uint8 { COLOR_BACKGROUND, COLOR_SQUARE };
+ *
+ * draw_rect(square, Palette::Instance().get(COLOR_SQUARE));  // Every frame
+ * Palette::Instance().apply_theme(night_theme, 2);            // On the edge hit
+ * @endcode
+ */
+class Palette
+{
+
+public:
+
+    // Number of the palette slots (8-bit index)
+    static constexpr int MAX_COLORS = 256;
+
+
+    // Returns the singleton instance.
+    static Palette& Instance();
+
+
+    // Color of the slot
+    SDL_Color get(std::uint8_t index) const;
+
+    // Sets one slot and marks the frame dirty
+    void set(std::uint8_t index, SDL_Color color);
+
+    /**
+     * @brief Replaces the first count slots in one step - the theme swap.
+     *
+     * @param colors Theme colors.
+     * @param count  Number of the colors (clamped to MAX_COLORS).
+     */
+    void apply_theme(const SDL_Color* colors, int count);
+
+
+    // Incremented on every change - lets the caches notice a theme swap
+    Uint64 get_version() const;
+
+
+    // Shared SDL_Palette with the same colors (nullptr before SDL_Init or on failure)
+    SDL_Palette* get_sdl_palette();
+
+    /**
+     * @brief Creates an 8-bit surface bound to the shared palette.
+     *
+     * Blitting it to an RGB surface converts the indices with the current theme.
+     *
+     * @return New surface (owned by the caller), nullptr on failure.
+     */
+    SDL_Surface* create_indexed_surface(int w, int h);
+
+    // Releases the shared SDL_Palette (before SDL_Quit)
+    void release();
+
+
+private:
+
+    // Private constructor for singleton
+    Palette();
+
+    // Copying the singleton is not allowed
+    Palette(const Palette&) = delete;
+    Palette& operator=(const Palette&) = delete;
+
+
+    // Copies the changed slots into the shared SDL_Palette and redraws the screen
+    void commit(int first, int count);
+
+
+    SDL_Color colors[MAX_COLORS];
+
+    SDL_Palette* sdl_palette = nullptr;
+
+    Uint64 version = 0;
+};
+
+// =========================================================================================== PALETTE
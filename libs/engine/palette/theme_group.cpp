@@ -0,0 +1,105 @@
+// theme_group.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "theme_group.h"
+#include "palette.h"
+#include "../asset/asset_instance.h"
+#include "../frame/frame.h"
+
+#include <algorithm>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== THEME GROUP
+
+std::vector<Theme_group*>& Theme_group::registry()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static std::vector<Theme_group*> groups;
+
+    return groups;
+}
+
+
+Theme_group::Theme_group(std::uint8_t palette_slot) : tint(Palette::Instance().get(palette_slot)), slot(palette_slot)
+{
+    registry().push_back(this);
+}
+
+
+Theme_group::~Theme_group()
+{
+    clear();
+
+    std::vector<Theme_group*>& groups = registry();
+
+    groups.erase(std::remove(groups.begin(), groups.end(), this), groups.end());
+}
+
+
+void Theme_group::add(Image_instance* instance)
+{
+    if (!instance || instance->theme_group == this) return;
+
+    if (instance->theme_group) instance->theme_group->remove(instance);
+
+    instance->theme_group = this;
+    instance->theme_index = members.size();
+
+    members.push_back(instance);
+
+    Frame::Instance().mark_dirty();
+}
+
+
+void Theme_group::remove(Image_instance* instance)
+{
+    if (!instance || instance->theme_group != this) return;
+
+    // Swap with the last one - the order of the members doesn't matter
+    Image_instance* last = members.back();
+
+    members[instance->theme_index] = last;
+    last->theme_index = instance->theme_index;
+
+    members.pop_back();
+
+    instance->theme_group = nullptr;
+
+    Frame::Instance().mark_dirty();
+}
+
+
+void Theme_group::clear()
+{
+    for (Image_instance* instance : members) instance->theme_group = nullptr;
+
+    members.clear();
+}
+
+
+int Theme_group::get_count() const { return static_cast<int>(members.size()); }
+
+
+void Theme_group::apply(SDL_Color new_tint)
+{
+    tint = new_tint;
+
+    // The batches read the tint at the next draw - the members' textures aren't touched
+    // (an atlas page is shared with the sprites of the other groups and no group at all)
+    if (!members.empty()) Frame::Instance().mark_dirty();
+}
+
+
+void Theme_group::apply_palette(int first, int count)
+{
+    const Palette& palette = Palette::Instance();
+
+    for (Theme_group* group : registry())
+        if (group->slot >= first && group->slot < first + count) group->apply(palette.get(group->slot));
+}
+
+// =========================================================================================== THEME GROUP
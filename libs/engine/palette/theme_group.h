@@ -0,0 +1,114 @@
+// theme_group.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+#include <vector>
+
+#include "../platform/platform.h"
+
+class Image_instance;
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== THEME GROUP
+
+
+/**
+ * @brief Image instances, which are tinted together by a palette slot - the theme swap of
+ *        the textured assets.
+ *
+ * The Palette tints the procedural shapes, a textured sprite has its pixels. A group keeps
+ * the tint of its members in one place: the Sprite_batch multiplies the group tint into the
+ * vertex colors of every member at the draw. No pixel is touched, no texture is recreated
+ * and no texture state is changed - the members share their textures (the atlas pages) with
+ * the sprites of the other groups and of no group, a texture color mod would tint them all.
+ * A swap is one color per group, not one call per sprite. Draw the themed art white or light.
+ *
+ * A group follows its palette slot: every Palette::set() / apply_theme() of the slot applies
+ * the new color to the group at once, so the theme swap of the game reaches the sprites with
+ * no code of its own.
+ *
+ * An instance is in one group at most, its destruction removes it; a group outlives its
+ * members or is destroyed first (the members are released, untinted from the next draw).
+ *
+ * Usage:
+ * @code
+ * Theme_group stars(COLOR_SQUARE);
+ *
+ * stars.add(star_instance);                               // Joins, tinted at once
+ * Palette::Instance().apply_theme(night_theme, count);    // Every star follows
+ * @endcode
+ */
+class Theme_group
+{
+
+public:
+
+    // Group of the palette slot, tinted by its color from the start
+    explicit Theme_group(std::uint8_t slot);
+
+    // Releases the members - they are drawn untinted
+    ~Theme_group();
+
+    // Registered groups can't be copied - the members and the palette know them by their address
+    Theme_group(const Theme_group&) = delete;
+    Theme_group& operator=(const Theme_group&) = delete;
+
+
+    /**
+     * @brief Adds the instance - it leaves its previous group, its next draw takes the group tint.
+     *
+     * @param instance Instance to tint, nullptr is ignored.
+     */
+    void add(Image_instance* instance);
+
+    // Removes the instance, if it's a member - it's drawn untinted from the next draw
+    void remove(Image_instance* instance);
+
+    // Removes every member
+    void clear();
+
+    int get_count() const;
+
+
+    /**
+     * @brief Tints the whole group - the batches read the tint at the next draw.
+     *
+     * Marks the frame dirty. The next palette change of the slot overrides it.
+     *
+     * @param tint Color modulation (the alpha isn't used).
+     */
+    void apply(SDL_Color tint);
+
+    SDL_Color get_tint() const { return tint; }
+
+    std::uint8_t get_slot() const { return slot; }
+
+
+    /**
+     * @brief Applies the palette colors to the groups of the changed slots (Palette::commit()).
+     *
+     * @param first First changed slot.
+     * @param count Number of the changed slots.
+     */
+    static void apply_palette(int first, int count);
+
+
+private:
+
+    // Live groups - the palette changes reach them
+    static std::vector<Theme_group*>& registry();
+
+
+    std::vector<Image_instance*> members;
+
+    SDL_Color tint = {255, 255, 255, 255};
+
+    std::uint8_t slot;
+};
+
+// =========================================================================================== THEME GROUP
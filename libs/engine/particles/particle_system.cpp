@@ -0,0 +1,325 @@
+// particle_system.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "particle_system.h"
+#include "../render_queue/render_queue.h"
+#include "../engine_clock/engine_clock.h"
+#include "../jobs/job_system.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(PARTICLE_NEON)
+    #include <arm_neon.h>
+#elif defined(PARTICLE_SSE2)
+    #include <emmintrin.h>
+#endif
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== PARTICLE KERNELS
+
+void particles_integrate_scalar(float* x, float* y, float* vx, float* vy, float* life, int count,
+                                float dt, float gravity, float damping)
+{
+    const float dv = gravity * dt;
+
+    for (int i = 0; i < count; ++i)
+    {
+        vx[i] *= damping;
+        vy[i] = (vy[i] + dv) * damping;
+
+        x[i] += vx[i] * dt;
+        y[i] += vy[i] * dt;
+
+        life[i] -= dt;
+    }
+}
+
+
+#if defined(PARTICLE_NEON)
+
+void particles_integrate(float* x, float* y, float* vx, float* vy, float* life, int count,
+                         float dt, float gravity, float damping)
+{
+    const float32x4_t dt4 = vdupq_n_f32(dt);
+    const float32x4_t dv4 = vdupq_n_f32(gravity * dt);
+    const float32x4_t damp4 = vdupq_n_f32(damping);
+
+    for (int i = 0; i < count; i += 4)
+    {
+        const float32x4_t nvx = vmulq_f32(vld1q_f32(vx + i), damp4);
+        const float32x4_t nvy = vmulq_f32(vaddq_f32(vld1q_f32(vy + i), dv4), damp4);
+
+        vst1q_f32(vx + i, nvx);
+        vst1q_f32(vy + i, nvy);
+
+        vst1q_f32(x + i, vmlaq_f32(vld1q_f32(x + i), nvx, dt4));
+        vst1q_f32(y + i, vmlaq_f32(vld1q_f32(y + i), nvy, dt4));
+
+        vst1q_f32(life + i, vsubq_f32(vld1q_f32(life + i), dt4));
+    }
+}
+
+#elif defined(PARTICLE_SSE2)
+
+void particles_integrate(float* x, float* y, float* vx, float* vy, float* life, int count,
+                         float dt, float gravity, float damping)
+{
+    const __m128 dt4 = _mm_set1_ps(dt);
+    const __m128 dv4 = _mm_set1_ps(gravity * dt);
+    const __m128 damp4 = _mm_set1_ps(damping);
+
+    for (int i = 0; i < count; i += 4)
+    {
+        const __m128 nvx = _mm_mul_ps(_mm_loadu_ps(vx + i), damp4);
+        const __m128 nvy = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(vy + i), dv4), damp4);
+
+        _mm_storeu_ps(vx + i, nvx);
+        _mm_storeu_ps(vy + i, nvy);
+
+        _mm_storeu_ps(x + i, _mm_add_ps(_mm_loadu_ps(x + i), _mm_mul_ps(nvx, dt4)));
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(nvy, dt4)));
+
+        _mm_storeu_ps(life + i, _mm_sub_ps(_mm_loadu_ps(life + i), dt4));
+    }
+}
+
+#else
+
+void particles_integrate(float* x, float* y, float* vx, float* vy, float* life, int count,
+                         float dt, float gravity, float damping)
+{
+    particles_integrate_scalar(x, y, vx, vy, life, count, dt, gravity, damping);
+}
+
+#endif
+
+// =========================================================================================== PARTICLE KERNELS
+
+
+// =========================================================================================== PARTICLE SYSTEM
+
+// Directions of a burst - one table for every system, the spawn is a lookup
+static constexpr int DIRECTIONS = 64;
+
+static const SDL_FPoint* get_directions()
+{
+    static SDL_FPoint table[DIRECTIONS];
+    static bool built = false;
+
+    if (!built)
+    {
+        for (int i = 0; i < DIRECTIONS; ++i)
+        {
+            const float angle = 6.2831853f * static_cast<float>(i) / DIRECTIONS;
+            table[i] = {std::cos(angle), std::sin(angle)};
+        }
+
+        built = true;
+    }
+
+    return table;
+}
+
+
+// xorshift32 - cheap and the same sequence on every build
+static std::uint32_t next_random(std::uint32_t& state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+
+    return state;
+}
+
+
+Particle_system::Particle_system(int requested)
+    : capacity((std::max(requested, 4) + 3) & ~3)
+    , x(static_cast<size_t>(capacity), 0.0f)
+    , y(static_cast<size_t>(capacity), 0.0f)
+    , vx(static_cast<size_t>(capacity), 0.0f)
+    , vy(static_cast<size_t>(capacity), 0.0f)
+    , life(static_cast<size_t>(capacity), 0.0f)
+    , inv_life(static_cast<size_t>(capacity), 0.0f)
+{
+}
+
+
+// One share for every system - the watchdog steps the whole game down
+static float spawn_share = 1.0f;
+
+
+void Particle_system::set_spawn_share(float share) { spawn_share = std::max(0.0f, std::min(share, 1.0f)); }
+
+float Particle_system::get_spawn_share() { return spawn_share; }
+
+
+void Particle_system::burst(float origin_x, float origin_y, int count, float speed_min, float speed_max, float seconds)
+{
+    // Rounded - a small burst keeps its particle
+    count = static_cast<int>(static_cast<float>(count) * spawn_share + 0.5f);
+
+    if (count <= 0 || seconds <= 0.0f) return;
+
+    count = std::min(count, capacity);
+
+    const SDL_FPoint* directions = get_directions();
+
+    // Random rotation of the whole burst, evenly spread directions inside it
+    const std::uint32_t rotation = next_random(seed);
+    const float speed_range = speed_max - speed_min;
+
+    for (int n = 0; n < count; ++n)
+    {
+        const int i = head;
+
+        if (life[i] > 0.0f) ++dropped;
+
+        const std::uint32_t r = next_random(seed);
+
+        const SDL_FPoint& d = directions[(rotation + static_cast<std::uint32_t>(n * DIRECTIONS / count)) % DIRECTIONS];
+        const float speed = speed_min + speed_range * static_cast<float>(r & 0xFFFF) * (1.0f / 65535.0f);
+
+        // Lives differ a bit - the burst doesn't vanish in one frame
+        const float particle_life = seconds * (0.75f + 0.25f * static_cast<float>((r >> 16) & 0xFF) * (1.0f / 255.0f));
+
+        x[i] = origin_x;
+        y[i] = origin_y;
+        vx[i] = d.x * speed;
+        vy[i] = d.y * speed;
+        life[i] = particle_life;
+        inv_life[i] = 1.0f / particle_life;
+
+        head = head + 1 == capacity ? 0 : head + 1;
+        used = std::max(used, i + 1);
+    }
+}
+
+
+void Particle_system::update(float dt)
+{
+    if (used == 0) return;
+
+    const Uint64 start = Engine_clock::now();
+
+    last_dt = dt;
+
+    const float damping = std::max(0.0f, 1.0f - drag * dt);
+
+    // The used slots in the groups of the SIMD width - the padding slots are dead ones.
+    // The large systems are split over the cores, the small ones run in place.
+    Job_system::Instance().parallel_for((used + 3) / 4, PARALLEL_BATCH / 4, [&](int begin, int end)
+    {
+        const int i = begin * 4;
+
+        particles_integrate(x.data() + i, y.data() + i, vx.data() + i, vy.data() + i, life.data() + i, (end - begin) * 4,
+                            dt, gravity, damping);
+    });
+
+    update_us = Engine_clock::to_us(Engine_clock::now() - start);
+}
+
+
+int Particle_system::get_alive() const
+{
+    int alive = 0;
+
+    for (int i = 0; i < used; ++i) alive += life[i] > 0.0f;
+
+    return alive;
+}
+
+
+void Particle_system::render(SDL_Color color, float alpha) const
+{
+    const int alive = get_alive();
+
+    if (alive == 0) return;
+
+    SDL_Vertex* v = Render_queue::Instance().append_quads(nullptr, alive, layer, SDL_BLENDMODE_BLEND);
+
+    if (!v) return;
+
+    const float half = size * 0.5f;
+
+    // Negative - the position of the frame is before the last update
+    const float back = (alpha - 1.0f) * last_dt;
+
+    for (int i = 0; i < used; ++i)
+    {
+        if (life[i] <= 0.0f) continue;
+
+        SDL_Color c = color;
+        c.a = static_cast<Uint8>(static_cast<float>(color.a) * std::min(1.0f, life[i] * inv_life[i]));
+
+        const float px = x[i] + vx[i] * back;
+        const float py = y[i] + vy[i] * back;
+
+        const float x0 = px - half;
+        const float y0 = py - half;
+        const float x1 = px + half;
+        const float y1 = py + half;
+
+        *v++ = {{x0, y0}, c, {0.0f, 0.0f}};
+        *v++ = {{x1, y0}, c, {0.0f, 0.0f}};
+        *v++ = {{x1, y1}, c, {0.0f, 0.0f}};
+        *v++ = {{x0, y1}, c, {0.0f, 0.0f}};
+    }
+}
+
+
+bool Particle_system::get_bounds(SDL_Rect& out) const
+{
+    float x0 = 0.0f, y0 = 0.0f, x1 = 0.0f, y1 = 0.0f;
+    bool any = false;
+
+    for (int i = 0; i < used; ++i)
+    {
+        if (life[i] <= 0.0f) continue;
+
+        // The render draws between the positions before and after the last update
+        const float bx = x[i] - vx[i] * last_dt;
+        const float by = y[i] - vy[i] * last_dt;
+
+        const float lx = std::min(x[i], bx), hx = std::max(x[i], bx);
+        const float ly = std::min(y[i], by), hy = std::max(y[i], by);
+
+        if (!any)
+        {
+            x0 = lx; y0 = ly; x1 = hx; y1 = hy;
+            any = true;
+            continue;
+        }
+
+        x0 = std::min(x0, lx);
+        y0 = std::min(y0, ly);
+        x1 = std::max(x1, hx);
+        y1 = std::max(y1, hy);
+    }
+
+    if (!any) return false;
+
+    const float half = size * 0.5f;
+
+    out.x = static_cast<int>(std::floor(x0 - half));
+    out.y = static_cast<int>(std::floor(y0 - half));
+    out.w = static_cast<int>(std::ceil(x1 + half)) - out.x;
+    out.h = static_cast<int>(std::ceil(y1 + half)) - out.y;
+
+    return true;
+}
+
+
+void Particle_system::clear()
+{
+    std::fill(life.begin(), life.end(), 0.0f);
+
+    used = 0;
+    head = 0;
+}
+
+// =========================================================================================== PARTICLE SYSTEM
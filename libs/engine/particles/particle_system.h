@@ -0,0 +1,185 @@
+// particle_system.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+#include <vector>
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== KERNEL SELECTION
+
+// Same selection as the mix kernels: NEON on the ARM Linux builds, SSE2 on the x86 ones
+#if defined(PLATFORM_LINUX) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+    #define PARTICLE_NEON
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define PARTICLE_SSE2
+#endif
+
+// =========================================================================================== KERNEL SELECTION
+
+
+// =========================================================================================== PARTICLE KERNELS
+
+/**
+ * One step of count particles over the structure-of-arrays (4 per iteration on NEON / SSE2):
+ *
+ *     vy += gravity * dt;  vx *= damping;  vy *= damping
+ *     x += vx * dt;  y += vy * dt;  life -= dt
+ *
+ * count must be a multiple of 4 (the arrays are padded), the pointers could be unaligned.
+ * The plain name is the best kernel of the build, the _scalar one is always available.
+ */
+void particles_integrate(float* x, float* y, float* vx, float* vy, float* life, int count,
+                         float dt, float gravity, float damping);
+void particles_integrate_scalar(float* x, float* y, float* vx, float* vy, float* life, int count,
+                                float dt, float gravity, float damping);
+
+// =========================================================================================== PARTICLE KERNELS
+
+
+// =========================================================================================== PARTICLE SYSTEM
+
+
+/**
+ * @brief Fixed-capacity particle bursts: the structure-of-arrays ring and the batched output.
+ *
+ * Every field is its own array, the update is one SIMD loop over all of the slots
+ * (particles_integrate()) - no object, no allocation and no branch per particle.
+ * The capacity is set once: a burst, which doesn't fit, overwrites the oldest particles
+ * (the ring), so the per-tick cost is capped by the capacity, whatever is spawned.
+ *
+ * The live particles go into the Render_queue as one run of quads per render() -
+ * the whole system is one batch of the frame.
+ *
+ * Visual only - the floats never feed the fixed-point simulation.
+ *
+ * Usage:
+ * @code
+ * Particle_system sparks(512);
+ *
+ * sparks.burst(x, y, 64, 60.0f, 240.0f, 0.6f);          // on the edge hit
+ * sparks.update(Engine_clock::time.tick_dt);            // every tick
+ * sparks.render(Palette::Instance().get(COLOR_ACCENT)); // every frame
+ * @endcode
+ */
+class Particle_system
+{
+
+public:
+
+    // Capacity is rounded up to a multiple of 4 (the SIMD width)
+    explicit Particle_system(int capacity = 512);
+
+
+    // === SETTINGS ===
+
+    // Downward acceleration in px/s^2
+    void set_gravity(float px_per_s2) { gravity = px_per_s2; }
+
+    // Share of the speed lost per second, 0 - 1
+    void set_drag(float per_second) { drag = per_second; }
+
+    // Side of the particle quad in px
+    void set_size(float px) { size = px; }
+
+    void set_layer(int render_layer) { layer = render_layer; }
+
+    // Share of every burst spawned by all of the systems, 0 - 1 (the Quality_watchdog lowers it)
+    static void set_spawn_share(float share);
+    static float get_spawn_share();
+
+    // === SETTINGS ===
+
+
+    /**
+     * @brief Spawns the particles from the point in the evenly spread directions.
+     *
+     * @param x, y      Origin.
+     * @param count     Particles, clamped to the capacity.
+     * @param speed_min Slowest speed in px/s.
+     * @param speed_max Fastest speed in px/s.
+     * @param life      Seconds until the particle disappears (fading out).
+     */
+    void burst(float x, float y, int count, float speed_min, float speed_max, float life);
+
+    // Smallest batch of the particles worth a Job_system job - the smaller systems update in place
+    static constexpr int PARALLEL_BATCH = 2048;
+
+    // Advances all of the slots (the update tick), split over the cores from 2 * PARALLEL_BATCH slots
+    void update(float dt);
+
+    /**
+     * @brief Records the live particles into the Render_queue, fading by the remaining life.
+     *
+     * @param color Color of the particles, its alpha is faded.
+     * @param alpha Render interpolation - the particles are drawn back along their speed by
+     *              (1 - alpha) of the last update, no previous position is stored.
+     */
+    void render(SDL_Color color, float alpha = 1.0f) const;
+
+    /**
+     * @brief Screen area of the live particles at any alpha of the last update (the damage tracking).
+     *
+     * @return false if no particle is alive.
+     */
+    bool get_bounds(SDL_Rect& out) const;
+
+    // Kills every particle
+    void clear();
+
+
+    // === STATS ===
+
+    int get_capacity() const { return capacity; }
+
+    // Particles with the life left
+    int get_alive() const;
+
+    // Particles overwritten by the bursts before their end (the capacity was too small)
+    std::uint64_t get_dropped() const { return dropped; }
+
+    // Duration of the last update() in microseconds
+    std::uint64_t get_update_us() const { return update_us; }
+
+    // === STATS ===
+
+
+private:
+
+    int capacity;
+
+    // Slots in use from 0 (only grows, up to the capacity) and the next slot to spawn into
+    int used = 0;
+    int head = 0;
+
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> vx;
+    std::vector<float> vy;
+    std::vector<float> life;
+
+    // 1 / the initial life - the fade of the render
+    std::vector<float> inv_life;
+
+    float gravity = 300.0f;
+    float drag = 1.5f;
+    float size = 3.0f;
+    int layer = 0;
+
+    // Direction spread and the speed variation, deterministic per system
+    std::uint32_t seed = 0x9E3779B9u;
+
+    // dt of the last update - the render interpolation
+    float last_dt = 0.0f;
+
+    std::uint64_t dropped = 0;
+    std::uint64_t update_us = 0;
+};
+
+// =========================================================================================== PARTICLE SYSTEM
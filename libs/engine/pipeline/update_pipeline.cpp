@@ -0,0 +1,123 @@
+// update_pipeline.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "update_pipeline.h"
+#include "../zone_profiler/zone_profiler.h"
+#include "../jobs/job_system.h"
+#include "../thread_roles/thread_roles.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== UPDATE PIPELINE
+
+// Set once by the worker thread on its start
+static thread_local bool worker_thread = false;
+
+
+Update_pipeline::~Update_pipeline() { stop(); }
+
+
+bool Update_pipeline::start()
+{
+    if (thread) return true;
+
+    start_sem = SDL_CreateSemaphore(0);
+    done_sem = SDL_CreateSemaphore(0);
+
+    quit = false;
+
+    thread = (start_sem && done_sem) ? SDL_CreateThread(worker_main, "update_worker", this) : nullptr;
+
+    if (!thread)
+    {
+        SDL_Log("Update pipeline worker creation failed: %s", SDL_GetError());
+        stop();
+        return false;
+    }
+
+    return true;
+}
+
+
+void Update_pipeline::stop()
+{
+    if (thread)
+    {
+        wait(); // Never abandon a job in the middle
+
+        quit = true;
+        SDL_SemPost(start_sem);
+
+        SDL_WaitThread(thread, nullptr);
+        thread = nullptr;
+    }
+
+    if (start_sem) SDL_DestroySemaphore(start_sem);
+    if (done_sem) SDL_DestroySemaphore(done_sem);
+
+    start_sem = nullptr;
+    done_sem = nullptr;
+}
+
+
+bool Update_pipeline::is_running() const { return thread != nullptr; }
+
+
+bool Update_pipeline::is_worker_thread() { return worker_thread; }
+
+
+void Update_pipeline::kick(std::function<void()> job)
+{
+    // No worker - run in place, the caller doesn't see the difference
+    if (!thread)
+    {
+        if (job) job();
+        return;
+    }
+
+    pending_job = std::move(job);
+    in_flight = true;
+
+    SDL_SemPost(start_sem);
+}
+
+
+void Update_pipeline::wait()
+{
+    if (!in_flight) return;
+
+    SDL_SemWait(done_sem);
+    in_flight = false;
+}
+
+
+int Update_pipeline::worker_main(void* self)
+{
+    auto* pipeline = static_cast<Update_pipeline*>(self);
+
+    PROFILE_THREAD("update_worker");
+
+    worker_thread = true;
+
+    // The update of the game - the role of the main thread
+    Thread_roles::Instance().apply(Thread_role::MAIN);
+
+    // The update submits the jobs from here - parallel_for runs in place without a deque
+    Job_system::Instance().attach_thread();
+
+    for (;;)
+    {
+        SDL_SemWait(pipeline->start_sem);
+
+        if (pipeline->quit) return 0;
+
+        if (pipeline->pending_job) pipeline->pending_job();
+
+        SDL_SemPost(pipeline->done_sem);
+    }
+}
+
+// =========================================================================================== UPDATE PIPELINE
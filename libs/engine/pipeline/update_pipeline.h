@@ -0,0 +1,140 @@
+// update_pipeline.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <atomic>
+#include <functional>
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== DOUBLE BUFFER
+
+
+/**
+ * @brief Render state handoff between the update thread and the render thread.
+ *
+ * The update writes the back slot, the render reads the front slot. swap() is called
+ * only at the pipeline sync point, when the update worker is idle, so the slots need
+ * no locks: the semaphores of the Update_pipeline already order the memory accesses.
+ *
+ * Example usage:
+ *
+ * Double_buffer<Square_view> view;
+ * 
+ * // update thread: view.back().x = physics.x;
+ * // main thread:   draw(view.front());
+ * // sync point:    view.swap();
+ */
+template <typename T>
+class Double_buffer
+{
+
+public:
+
+    // Slot written by the update
+    T& back() { return slots[1 - front_index]; }
+
+    // Slot read by the render
+    const T& front() const { return slots[front_index]; }
+
+    // Publishes the back slot to the render. The new back slot starts as a copy
+    // of the published one, so the update could change only what it needs.
+    void swap()
+    {
+        front_index = 1 - front_index;
+        slots[1 - front_index] = slots[front_index];
+    }
+
+
+private:
+
+    T slots[2] = {};
+    int front_index = 0;
+};
+
+// =========================================================================================== DOUBLE BUFFER
+
+
+// =========================================================================================== UPDATE PIPELINE
+
+
+/**
+ * @brief Runs the update job on a dedicated worker thread.
+ *
+ * Used by the pipelined application cycle: kick() starts the update of the frame N+1
+ * on the worker, the main thread submits the render of the frame N meanwhile,
+ * then wait() joins them again. On the dual-core Cortex-A7 it puts the update
+ * and the render on different cores.
+ *
+ * The thread is created once by start() and sleeps on a semaphore between the jobs,
+ * so a frame costs two semaphore operations.
+ */
+class Update_pipeline
+{
+
+public:
+
+    Update_pipeline() = default;
+
+    // Stops the worker, if it is running
+    ~Update_pipeline();
+
+    // Copying the thread owner is not allowed
+    Update_pipeline(const Update_pipeline&) = delete;
+    Update_pipeline& operator=(const Update_pipeline&) = delete;
+
+
+    /**
+     * @brief Creates the worker thread.
+     *
+     * @return true on success (or if already started), false if SDL failed to create it.
+     */
+    bool start();
+
+    // Finishes the running job and joins the worker thread
+    void stop();
+
+    // true if the worker thread is running
+    bool is_running() const;
+
+    // true on the worker thread of any pipeline - a job, which has to leave the main-thread
+    // work (the transitions, the frame) for the sync point, checks it
+    static bool is_worker_thread();
+
+
+    /**
+     * @brief Starts the job on the worker. Must be followed by wait().
+     *
+     * @param job Update job; runs on the worker thread, must not touch the renderer.
+     */
+    void kick(std::function<void()> job);
+
+    // Blocks until the kicked job is finished (returns at once if nothing was kicked)
+    void wait();
+
+
+private:
+
+    // Worker thread entry point
+    static int worker_main(void* self);
+
+
+    SDL_Thread* thread = nullptr;
+
+    SDL_sem* start_sem = nullptr;
+    SDL_sem* done_sem = nullptr;
+
+    std::function<void()> pending_job;
+
+    std::atomic<bool> quit{false};
+
+    // true between kick() and wait()
+    bool in_flight = false;
+};
+
+// =========================================================================================== UPDATE PIPELINE
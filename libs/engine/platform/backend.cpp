@@ -0,0 +1,159 @@
+// backend.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "backend.h"
+
+#include <string>
+
+#ifdef PLATFORM_LINUX
+    #include <cerrno>
+    #include <cstring>
+    #include <fcntl.h>
+    #include <unistd.h>
+#else
+    #include <windows.h>
+#endif
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== BACKEND PARTS
+
+// === FILES ===
+
+bool Sdl_files::read_file(const char* path, std::vector<Uint8>& out)
+{
+    SDL_RWops* in = SDL_RWFromFile(path, "rb");
+
+    if (!in) return false;
+
+    const Sint64 size = SDL_RWsize(in);
+
+    out.resize(size > 0 ? static_cast<size_t>(size) : 0);
+
+    const bool ok = out.empty() || SDL_RWread(in, out.data(), out.size(), 1) == 1;
+
+    SDL_RWclose(in);
+
+    if (!ok)
+    {
+        SDL_Log("File %s can't be read", path);
+        out.clear();
+    }
+
+    return ok;
+}
+
+
+bool Sdl_files::write_file(const char* path, const void* data, size_t size)
+{
+    SDL_RWops* out = SDL_RWFromFile(path, "wb");
+
+    if (!out)
+    {
+        SDL_Log("File %s can't be created: %s", path, SDL_GetError());
+        return false;
+    }
+
+    const bool ok = size == 0 || SDL_RWwrite(out, data, size, 1) == 1;
+
+    if (SDL_RWclose(out) != 0 || !ok)
+    {
+        SDL_Log("File %s write failed", path);
+        return false;
+    }
+
+    return true;
+}
+
+
+#ifdef PLATFORM_LINUX
+
+bool Sdl_files::write_file_atomic(const char* path, const void* data, size_t size)
+{
+    const std::string temp = std::string(path) + ".tmp";
+
+    const int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0)
+    {
+        SDL_Log("File %s can't be created: %s", temp.c_str(), std::strerror(errno));
+        return false;
+    }
+
+    const Uint8* bytes = static_cast<const Uint8*>(data);
+    size_t done = 0;
+
+    while (done < size)
+    {
+        const ssize_t n = ::write(fd, bytes + done, size - done);
+
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+
+        done += static_cast<size_t>(n);
+    }
+
+    // The data must be on the card before the rename makes it the file
+    const bool ok = done == size && ::fsync(fd) == 0;
+
+    if (::close(fd) != 0 || !ok || ::rename(temp.c_str(), path) != 0)
+    {
+        SDL_Log("File %s write failed: %s", path, std::strerror(errno));
+        ::unlink(temp.c_str());
+        return false;
+    }
+
+    // The rename itself is durable only with its directory flushed
+    const char* slash = std::strrchr(path, '/');
+    const std::string dir = slash ? std::string(path, slash == path ? 1 : static_cast<size_t>(slash - path)) : ".";
+
+    const int dir_fd = ::open(dir.c_str(), O_RDONLY);
+
+    if (dir_fd >= 0)
+    {
+        ::fsync(dir_fd);
+        ::close(dir_fd);
+    }
+
+    return true;
+}
+
+#else
+
+bool Sdl_files::write_file_atomic(const char* path, const void* data, size_t size)
+{
+    const std::string temp = std::string(path) + ".tmp";
+
+    HANDLE file = CreateFileA(temp.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        SDL_Log("File %s can't be created", temp.c_str());
+        return false;
+    }
+
+    DWORD written = 0;
+
+    const bool ok = (size == 0 || (WriteFile(file, data, static_cast<DWORD>(size), &written, nullptr) && written == size))
+                    && FlushFileBuffers(file);
+
+    CloseHandle(file);
+
+    if (!ok || !MoveFileExA(temp.c_str(), path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+    {
+        SDL_Log("File %s write failed", path);
+        DeleteFileA(temp.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+#endif
+
+// === FILES ===
+
+// =========================================================================================== BACKEND PARTS
@@ -0,0 +1,312 @@
+// backend.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "platform.h"
+#include "../fbdev/fb_backend.h"
+#include "../evdev/evdev_input.h"
+
+#ifdef PLATFORM_LINUX
+    #include <ctime>
+#endif
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== BACKEND SELECTION
+
+// One backend per build, set by CMake (MIYOO_BACKEND) - the SDL desktop one by default
+
+#if defined(MIYOO_BACKEND_NATIVE) + defined(MIYOO_BACKEND_SDL_MIYOO) + defined(MIYOO_BACKEND_SDL_DESKTOP) > 1
+    #error "Only one of MIYOO_BACKEND_NATIVE, MIYOO_BACKEND_SDL_MIYOO, MIYOO_BACKEND_SDL_DESKTOP can be defined"
+#endif
+
+#if !defined(MIYOO_BACKEND_NATIVE) && !defined(MIYOO_BACKEND_SDL_MIYOO) && !defined(MIYOO_BACKEND_SDL_DESKTOP)
+    #define MIYOO_BACKEND_SDL_DESKTOP
+#endif
+
+#if defined(MIYOO_BACKEND_NATIVE) && !defined(PLATFORM_LINUX)
+    #error "The native fbdev / evdev backend is available only on Linux"
+#endif
+
+// =========================================================================================== BACKEND SELECTION
+
+
+// =========================================================================================== BACKEND PARTS
+
+
+/**
+ * The platform backend is a set of five parts, every part is a plain type with the
+ * interface below. The build picks one set at the compile time (Platform), the engine
+ * calls the parts by their static type - no virtual call, the empty parts of the SDL
+ * builds inline into nothing.
+ *
+ * Video (window / render output), an instance in sdl_app_ctx::fb:
+ *     bool open(const char* device, int bits_per_pixel = 0); void close(); bool is_open() const;
+ *     SDL_Surface* get_surface() const; void flip();
+ *     std::uint64_t get_physical_address() const - of the surface pixels, 0 - unknown
+ *     void set_present_pass(int quarter_turns, int w, int h, Uint32 format) - before open()
+ *     void set_page_count(int pages) - swap chain depth, before open(); int get_page_count() const
+ *     void set_color_grade(const Color_grade* grade) - applied by flip(), nullptr - none
+ *     double get_refresh_rate() const - 0 if unknown
+ *     Uint64 get_vblank_time() const; Uint64 get_flip_time() const - Engine_clock counters, 0 if unknown
+ *     static constexpr bool NATIVE - false: the SDL renderer draws into the window
+ *
+ * Input (button reader), an instance in sdl_app_ctx::evdev:
+ *     bool open(const char* device); void close(); bool is_open() const;
+ *     std::uint32_t collect(Input& input) - applies the newest state, returns the pressed mask
+ *     std::uint32_t get_held() const - buttons held right now (the late input latch)
+ *     static constexpr bool NATIVE - false: the buttons come as the SDL events
+ *
+ * Audio (output device), static:
+ *     SDL_AudioDeviceID open(SDL_AudioSpec& want, SDL_AudioSpec& have);
+ *     void close(id); void pause(id, bool); void lock(id); void unlock(id)
+ *
+ * Clock (monotonic time), static:
+ *     Uint64 now(); Uint64 frequency() - ticks per second
+ *
+ * Files (whole file IO of the configs, the recordings, the saves), static:
+ *     bool read_file(const char* path, std::vector<Uint8>& out);
+ *     bool write_file(const char* path, const void* data, size_t size);
+ *     bool write_file_atomic(const char* path, const void* data, size_t size)
+ */
+
+
+// === VIDEO ===
+
+// No native output - the SDL renderer draws into the window, open() always fails
+struct Sdl_video
+{
+    static constexpr bool NATIVE = false;
+
+    bool open(const char*, int = 0) { return false; }
+    void close() {}
+    bool is_open() const { return false; }
+
+    SDL_Surface* get_surface() const { return nullptr; }
+    std::uint64_t get_physical_address() const { return 0; }
+    void set_present_pass(int, int = 0, int = 0, Uint32 = SDL_PIXELFORMAT_UNKNOWN) {}
+    void set_page_count(int) {}
+    void set_color_grade(const Color_grade*) {}
+    void flip() {}
+
+    int get_page_count() const { return 0; }
+    double get_refresh_rate() const { return 0.0; }
+    Uint64 get_vblank_time() const { return 0; }
+    Uint64 get_flip_time() const { return 0; }
+};
+
+// Fb_backend is the native video part as it is
+
+// === VIDEO ===
+
+
+// === INPUT ===
+
+// No reader - the buttons come as the SDL key and joystick events (Input::process_event())
+struct Sdl_event_input
+{
+    static constexpr bool NATIVE = false;
+
+    bool open(const char*) { return false; }
+    void close() {}
+    bool is_open() const { return false; }
+
+    std::uint32_t collect(Input&) { return 0; }
+    std::uint32_t get_held() const { return 0; }
+};
+
+// Evdev_input is the native input part as it is
+
+// === INPUT ===
+
+
+// === AUDIO ===
+
+// SDL audio device - the only audio output on every target (the Miyoo SDL has its own driver)
+struct Sdl_audio
+{
+    static SDL_AudioDeviceID open(const SDL_AudioSpec& want, SDL_AudioSpec& have)
+    {
+        // The device rate and buffer are taken as is - SDL doesn't convert every callback then
+        return SDL_OpenAudioDevice(nullptr, 0, &want, &have, SDL_AUDIO_ALLOW_SAMPLES_CHANGE | SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+    }
+
+    static void close(SDL_AudioDeviceID id) { SDL_CloseAudioDevice(id); }
+
+    static void pause(SDL_AudioDeviceID id, bool paused) { SDL_PauseAudioDevice(id, paused ? 1 : 0); }
+
+    static void lock(SDL_AudioDeviceID id) { SDL_LockAudioDevice(id); }
+    static void unlock(SDL_AudioDeviceID id) { SDL_UnlockAudioDevice(id); }
+};
+
+// === AUDIO ===
+
+
+// === CLOCK ===
+
+// SDL performance counter (QueryPerformanceCounter, clock_gettime) - read through Engine_clock
+struct Sdl_clock
+{
+    static Uint64 now() { return SDL_GetPerformanceCounter(); }
+    static Uint64 frequency() { return SDL_GetPerformanceFrequency(); }
+};
+
+
+#ifdef PLATFORM_LINUX
+
+// CLOCK_MONOTONIC in ns without the SDL call - the clock of the evdev timestamps
+struct Posix_clock
+{
+    static Uint64 now()
+    {
+        timespec t;
+
+        clock_gettime(CLOCK_MONOTONIC, &t);
+
+        return static_cast<Uint64>(t.tv_sec) * 1000000000ull + static_cast<Uint64>(t.tv_nsec);
+    }
+
+    static Uint64 frequency() { return 1000000000ull; }
+};
+
+#endif
+
+// === CLOCK ===
+
+
+// === FILES ===
+
+// SDL_RWops files - the paths relative to the working directory on every target
+struct Sdl_files
+{
+    // Reads the whole file, false if it can't be opened or read
+    static bool read_file(const char* path, std::vector<Uint8>& out);
+
+    // Writes (replaces) the whole file
+    static bool write_file(const char* path, const void* data, size_t size);
+
+    // Writes "<path>.tmp", flushes it to the card and renames it over the file - a power
+    // loss leaves the old file or the new one, never a torn one. Blocks for the card flush.
+    static bool write_file_atomic(const char* path, const void* data, size_t size);
+};
+
+// === FILES ===
+
+// =========================================================================================== BACKEND PARTS
+
+
+// =========================================================================================== PLATFORM BACKEND
+
+
+namespace backend_check
+{
+    template <typename T, typename = void> struct is_output : std::false_type {};
+
+    template <typename T>
+    struct is_output<T, std::void_t<decltype(std::declval<T&>().open(nullptr)), decltype(std::declval<T&>().close()),
+                                    decltype(std::declval<const T&>().is_open()), decltype(T::NATIVE)>> : std::true_type {};
+
+    template <typename T, typename = void> struct is_video : std::false_type {};
+
+    template <typename T>
+    struct is_video<T, std::void_t<decltype(std::declval<const T&>().get_surface()), decltype(std::declval<T&>().flip())>>
+        : is_output<T> {};
+
+    template <typename T, typename = void> struct is_input : std::false_type {};
+
+    template <typename T>
+    struct is_input<T, std::void_t<decltype(std::declval<T&>().collect(std::declval<Input&>()))>> : is_output<T> {};
+
+    template <typename T, typename = void> struct is_clock : std::false_type {};
+
+    template <typename T>
+    struct is_clock<T, std::void_t<decltype(T::now()), decltype(T::frequency())>> : std::true_type {};
+}
+
+
+/**
+ * @brief Compile-time set of the backend parts (see BACKEND PARTS above).
+ *
+ * Not instantiated - the engine takes the part types (Platform::Video...) and calls
+ * them statically or through their instances in sdl_app_ctx. A part, which doesn't
+ * have the interface, fails the build here, not at the first use.
+ */
+template <typename VideoT, typename InputT, typename AudioT, typename ClockT, typename FilesT>
+struct Platform_backend
+{
+    static_assert(backend_check::is_video<VideoT>::value, "Video part needs open/close/is_open/get_surface/flip/NATIVE");
+    static_assert(backend_check::is_input<InputT>::value, "Input part needs open/close/is_open/collect/NATIVE");
+    static_assert(backend_check::is_clock<ClockT>::value, "Clock part needs static now/frequency");
+
+    using Video = VideoT;
+    using Input_reader = InputT;
+    using Audio = AudioT;
+    using Clock = ClockT;
+    using Files = FilesT;
+};
+
+
+#if defined(MIYOO_BACKEND_NATIVE)
+
+// Miyoo Mini: /dev/fb0 page flipping and the evdev reader thread, the SDL audio
+struct Platform : Platform_backend<Fb_backend, Evdev_input, Sdl_audio, Posix_clock, Sdl_files>
+{
+    static constexpr const char* NAME = "native fbdev / evdev";
+
+    // The Miyoo itself - the device defaults (Thread_roles) apply
+    static constexpr bool DEVICE = true;
+
+    static constexpr int WINDOW_W = 640;
+    static constexpr int WINDOW_H = 480;
+
+    static constexpr int LOGICAL_W = 640;
+    static constexpr int LOGICAL_H = 480;
+};
+
+#elif defined(MIYOO_BACKEND_SDL_MIYOO)
+
+// Miyoo Mini: everything through the Onion OS SDL (its video driver and key events)
+struct Platform : Platform_backend<Sdl_video, Sdl_event_input, Sdl_audio, Sdl_clock, Sdl_files>
+{
+    static constexpr const char* NAME = "SDL Miyoo";
+
+    // The Miyoo itself - the device defaults (Thread_roles) apply
+    static constexpr bool DEVICE = true;
+
+    static constexpr int WINDOW_W = 640;
+    static constexpr int WINDOW_H = 480;
+
+    static constexpr int LOGICAL_W = 640;
+    static constexpr int LOGICAL_H = 480;
+};
+
+#else
+
+// Desktop: SDL window, keyboard and gamepads
+struct Platform : Platform_backend<Sdl_video, Sdl_event_input, Sdl_audio, Sdl_clock, Sdl_files>
+{
+    static constexpr const char* NAME = "SDL desktop";
+
+    // The Miyoo itself - the device defaults (Thread_roles) apply
+    static constexpr bool DEVICE = false;
+
+    // Twice the device panel - the logical resolution is scaled by an integer factor
+    static constexpr int WINDOW_W = 1280;
+    static constexpr int WINDOW_H = 960;
+
+    // The device panel - the same fill cost and layout as on the Miyoo
+    static constexpr int LOGICAL_W = 640;
+    static constexpr int LOGICAL_H = 480;
+};
+
+#endif
+
+// =========================================================================================== PLATFORM BACKEND
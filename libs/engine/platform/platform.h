@@ -46,7 +46,25 @@ enum Button {
     Y_BTN,
     X_BTN,
     A_BTN,
-    B_BTN
+    B_BTN,
+
+    BUTTON_COUNT    // Sentinel for number of buttons
+
+};
+
+// Categories of the SDL events - the event interest of a state (bit mask)
+enum Event_interest : Uint32 {
+
+    EVENT_BUTTONS    = 1u << 0,     // Keys, joystick and controller buttons, hats
+    EVENT_TEXT       = 1u << 1,     // Text input and editing, keymap changes
+    EVENT_WINDOW     = 1u << 2,     // Window, display, render device, quit and app lifecycle
+    EVENT_CONTROLLER = 1u << 3,     // Axes, sensors, device add / remove
+    EVENT_POINTER    = 1u << 4,     // Mouse, touch and gestures
+    EVENT_OTHER      = 1u << 5,     // Everything else (user events, audio devices, drop)
+
+    // What the engine lets through by default - the text and the pointer are off
+    EVENT_DEFAULT    = EVENT_BUTTONS | EVENT_WINDOW | EVENT_CONTROLLER | EVENT_OTHER,
+    EVENT_ALL        = 0xFFFFFFFFu
 
 };
 
@@ -0,0 +1,171 @@
+// preloader.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "preloader.h"
+#include "../startup_trace/startup_trace.h"
+#include "../thread_roles/thread_roles.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== PRELOADER
+
+Preloader& Preloader::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Preloader instance;
+
+    return instance;
+}
+
+
+Preloader::~Preloader() { wait(); }
+
+
+bool Preloader::add(const std::string& path)
+{
+    if (started) return false;
+
+    for (const auto& entry : entries) if (entry->path == path) return false;
+
+    entries.push_back(std::make_unique<Entry>());
+    entries.back()->path = path;
+
+    return true;
+}
+
+
+bool Preloader::start(int thread_count)
+{
+    if (started) return false;
+
+    started = true;
+
+    if (entries.empty()) return true;
+
+    // No more workers than files
+    if (thread_count > static_cast<int>(entries.size())) thread_count = static_cast<int>(entries.size());
+
+    for (int i = 0; i < thread_count; ++i)
+    {
+        SDL_Thread* thread = SDL_CreateThread(worker_main, "preload_worker", this);
+
+        if (!thread)
+        {
+            SDL_Log("Preload worker creation failed: %s", SDL_GetError());
+            break;
+        }
+
+        threads.push_back(thread);
+    }
+
+    // Without any worker the files are read right here
+    if (threads.empty()) worker_main(this);
+
+    return true;
+}
+
+
+void Preloader::wait()
+{
+    for (SDL_Thread* thread : threads) SDL_WaitThread(thread, nullptr);
+
+    threads.clear();
+}
+
+
+bool Preloader::is_done() const { return done_count.load() == static_cast<int>(entries.size()); }
+
+
+float Preloader::get_progress() const
+{
+    if (entries.empty()) return 1.0f;
+
+    return static_cast<float>(done_count.load()) / static_cast<float>(entries.size());
+}
+
+
+bool Preloader::take(const std::string& path, std::vector<unsigned char>& out)
+{
+    for (auto& entry : entries)
+    {
+        if (entry->path != path) continue;
+
+        // Still being read by a worker
+        if (!entry->done.load() || !entry->loaded) return false;
+
+        out = std::move(entry->data);
+        entry->loaded = false;
+
+        return true;
+    }
+
+    return false;
+}
+
+
+void Preloader::clear()
+{
+    wait();
+
+    entries.clear();
+    next_entry = 0;
+    done_count = 0;
+    started = false;
+}
+
+
+void Preloader::load_entry(Entry& entry)
+{
+    SDL_RWops* rw = SDL_RWFromFile(entry.path.c_str(), "rb");
+
+    if (!rw)
+    {
+        SDL_Log("Preload of %s failed: %s", entry.path.c_str(), SDL_GetError());
+        return;
+    }
+
+    Sint64 size = SDL_RWsize(rw);
+
+    if (size > 0)
+    {
+        entry.data.resize(static_cast<size_t>(size));
+        entry.loaded = SDL_RWread(rw, entry.data.data(), 1, entry.data.size()) == entry.data.size();
+    }
+
+    if (!entry.loaded)
+    {
+        SDL_Log("Preload of %s failed: short read", entry.path.c_str());
+        entry.data.clear();
+    }
+
+    SDL_RWclose(rw);
+}
+
+
+int Preloader::worker_main(void* self)
+{
+    auto* preloader = static_cast<Preloader*>(self);
+
+    Thread_roles::Instance().apply(Thread_role::IO);
+
+    const int total = static_cast<int>(preloader->entries.size());
+
+    for (int i = preloader->next_entry++; i < total; i = preloader->next_entry++)
+    {
+        Entry& entry = *preloader->entries[i];
+
+        load_entry(entry);
+
+        entry.done = true;
+
+        // The last finished file ends the preload phase
+        if (++preloader->done_count == total) Startup_trace::Instance().mark("preload finished");
+    }
+
+    return 0;
+}
+
+// =========================================================================================== PRELOADER
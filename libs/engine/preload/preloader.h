@@ -0,0 +1,136 @@
+// preloader.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <memory>
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== PRELOADER
+
+
+/**
+ * @brief Background file preloader for the splash screen.
+ *
+ * The slow part of the asset loading on the SD card is the read itself, so the splash
+ * state queues the files the next states need and reads them into memory on the
+ * worker threads, while it keeps drawing. The states take the bytes later and decode
+ * them on the main thread (SDL_RWFromConstMem), textures are never created off it.
+ *
+ * Files could be queued only before start(). The loaded data stays until taken or clear().
+ *
+ * Singleton, like Frame, so the state callbacks can reach it without any context.
+ *
+ * Usage:
+ * @code
+ * Preloader& p = Preloader::Instance();
+ *
+ * p.add("assets/menu.png");
+ * p.start();
+ *
+ * // ... every frame: if (p.is_done()) go to the next state
+ *
+ * std::vector<unsigned char> bytes;
+ * if (p.take("assets/menu.png", bytes)) { SDL_RWops* rw = SDL_RWFromConstMem(bytes.data(), (int)bytes.size()); ... }
+ * @endcode
+ */
+class Preloader
+{
+
+public:
+
+    // Returns the singleton instance.
+    static Preloader& Instance();
+
+
+    /**
+     * @brief Queues a file for the preload.
+     *
+     * @param path File path.
+     * @return false if the workers are already started or the file is already queued.
+     */
+    bool add(const std::string& path);
+
+    /**
+     * @brief Starts reading the queued files on the worker threads.
+     *
+     * @param thread_count Number of the worker threads (the device has 2 cores).
+     * @return false if already started; if the threads can't be created, the files are read in place.
+     */
+    bool start(int thread_count = 2);
+
+    // Blocks until all of the queued files are read and joins the workers
+    void wait();
+
+
+    // true if every queued file is read (or failed), also true if nothing was queued
+    bool is_done() const;
+
+    // Share of the read files [0, 1]
+    float get_progress() const;
+
+
+    /**
+     * @brief Moves the loaded file data out of the preloader.
+     *
+     * @param path File path passed to add().
+     * @param out  Receives the file bytes.
+     * @return true if the file was preloaded successfully and not taken yet.
+     */
+    bool take(const std::string& path, std::vector<unsigned char>& out);
+
+    // Waits for the workers and drops all queued and loaded files
+    void clear();
+
+
+private:
+
+    // Private constructor for singleton
+    Preloader() = default;
+
+    // Waits for the workers on the exit
+    ~Preloader();
+
+    // Copying the singleton is not allowed
+    Preloader(const Preloader&) = delete;
+    Preloader& operator=(const Preloader&) = delete;
+
+
+    // Single queued file. Written only by the worker, which took it, until done is set.
+    struct Entry
+    {
+        std::string path;
+        std::vector<unsigned char> data;
+        bool loaded = false;
+        std::atomic<bool> done{false};
+    };
+
+    // Reads the file of the entry
+    static void load_entry(Entry& entry);
+
+    // Worker thread entry point - takes the entries until none are left
+    static int worker_main(void* self);
+
+
+    std::vector<std::unique_ptr<Entry>> entries;
+
+    // Index of the next entry for the workers
+    std::atomic<int> next_entry{0};
+
+    // Number of the finished entries
+    std::atomic<int> done_count{0};
+
+    std::vector<SDL_Thread*> threads;
+
+    bool started = false;
+};
+
+// =========================================================================================== PRELOADER
@@ -0,0 +1,318 @@
+// primitives.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "primitives.h"
+#include "../render_queue/render_queue.h"
+#include "../render_stats/render_stats.h"
+#include "../culling/view_culler.h"
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== PRIMITIVES
+
+// Span half-widths of the last circle radius - the circle shape is the same
+// every frame, only the position changes
+
+static std::vector<int> circle_half_widths;
+static int circle_radius = -1;
+
+static std::vector<SDL_Rect> circle_spans;
+
+
+static void build_circle_spans(int radius)
+{
+    circle_half_widths.resize(static_cast<size_t>(radius) * 2 + 1);
+
+    const int r2 = radius * radius;
+
+    int half = radius;
+
+    // From the widest row up - the half width only shrinks, no sqrt needed
+    for (int dy = 0; dy <= radius; ++dy)
+    {
+        while (half > 0 && half * half + dy * dy > r2) --half;
+
+        circle_half_widths[radius + dy] = half;
+        circle_half_widths[radius - dy] = half;
+    }
+
+    circle_radius = radius;
+}
+
+
+void fill_circle(SDL_Renderer* r, int cx, int cy, int radius)
+{
+    if (!r || radius < 0) return;
+
+    if (radius != circle_radius) build_circle_spans(radius);
+
+    const int rows = radius * 2 + 1;
+
+    circle_spans.resize(rows);
+
+    for (int i = 0; i < rows; ++i)
+    {
+        const int half = circle_half_widths[i];
+
+        circle_spans[i] = {cx - half, cy - radius + i, half * 2 + 1, 1};
+    }
+
+    Render::fill_rects(r, circle_spans.data(), rows);
+}
+
+// =========================================================================================== PRIMITIVES
+
+
+// =========================================================================================== SHAPES
+
+static constexpr float PI = 3.14159265358979f;
+
+// Circle outline length per segment, in pixels
+static constexpr float SEGMENT_LENGTH = 4.0f;
+
+static constexpr int MIN_SEGMENTS = 8;
+static constexpr int MAX_SEGMENTS = 128;
+
+
+static SDL_BlendMode blend_for(SDL_Color color) { return color.a < 255 ? SDL_BLENDMODE_BLEND : SDL_BLENDMODE_NONE; }
+
+
+static SDL_Vertex vertex(float x, float y, SDL_Color color) { return {{x, y}, color, {0.0f, 0.0f}}; }
+
+
+// Segments of the full circle of the radius (multiple of 4, so the corners split evenly)
+static int circle_segments(float radius)
+{
+    int segments = static_cast<int>(std::ceil(2.0f * PI * radius / SEGMENT_LENGTH));
+
+    segments = std::clamp(segments, MIN_SEGMENTS, MAX_SEGMENTS);
+
+    return (segments + 3) & ~3;
+}
+
+
+// Unit circle points per segment count - the same shapes are drawn every frame,
+// and circles of different radii alternate within one. The counts are multiples
+// of 4 up to MAX_SEGMENTS, so a slot per count is a small array.
+
+static std::vector<SDL_FPoint> unit_circles[MAX_SEGMENTS / 4 + 1];
+
+static const SDL_FPoint* get_unit_circle(int segments)
+{
+    std::vector<SDL_FPoint>& unit_circle = unit_circles[segments / 4];
+
+    if (unit_circle.empty())
+    {
+        unit_circle.resize(segments + 1);
+
+        for (int i = 0; i <= segments; ++i)
+        {
+            float angle = 2.0f * PI * static_cast<float>(i) / static_cast<float>(segments);
+            unit_circle[i] = {std::cos(angle), std::sin(angle)};
+        }
+    }
+
+    return unit_circle.data();
+}
+
+
+// Writes a quad as two triangles
+static SDL_Vertex* put_quad(SDL_Vertex* v, SDL_FPoint a, SDL_FPoint b, SDL_FPoint c, SDL_FPoint d, SDL_Color color)
+{
+    v[0] = vertex(a.x, a.y, color);
+    v[1] = vertex(b.x, b.y, color);
+    v[2] = vertex(c.x, c.y, color);
+    v[3] = vertex(a.x, a.y, color);
+    v[4] = vertex(c.x, c.y, color);
+    v[5] = vertex(d.x, d.y, color);
+
+    return v + 6;
+}
+
+
+// The bounds overlap the view of the frame - the rest isn't tessellated at all
+static bool in_view(float min_x, float min_y, float max_x, float max_y)
+{
+    return View_culler::Instance().is_visible({min_x, min_y, max_x - min_x, max_y - min_y});
+}
+
+
+void draw_rect(const SDL_FRect& rect, SDL_Color color, int layer)
+{
+    if (!View_culler::Instance().is_visible(rect)) return;
+
+    Render_queue::Instance().fill_rect(rect, color, layer, blend_for(color));
+}
+
+
+void draw_rect_outline(const SDL_FRect& rect, float thickness, SDL_Color color, int layer)
+{
+    if (thickness <= 0.0f) return;
+
+    // Thicker than the half - it's just a solid rectangle
+    if (thickness * 2.0f >= rect.w || thickness * 2.0f >= rect.h)
+    {
+        draw_rect(rect, color, layer);
+        return;
+    }
+
+    if (!View_culler::Instance().is_visible(rect)) return;
+
+    Render_queue& queue = Render_queue::Instance();
+    SDL_BlendMode blend = blend_for(color);
+
+    const float inner_h = rect.h - thickness * 2.0f;
+
+    // Top and bottom bars over the whole width, side bars between them - no overlaps for the blending
+    queue.fill_rect(SDL_FRect{rect.x, rect.y, rect.w, thickness}, color, layer, blend);
+    queue.fill_rect(SDL_FRect{rect.x, rect.y + rect.h - thickness, rect.w, thickness}, color, layer, blend);
+    queue.fill_rect(SDL_FRect{rect.x, rect.y + thickness, thickness, inner_h}, color, layer, blend);
+    queue.fill_rect(SDL_FRect{rect.x + rect.w - thickness, rect.y + thickness, thickness, inner_h}, color, layer, blend);
+}
+
+
+void draw_circle(float cx, float cy, float radius, SDL_Color color, int layer)
+{
+    if (radius <= 0.0f || !in_view(cx - radius, cy - radius, cx + radius, cy + radius)) return;
+
+    const int segments = circle_segments(radius);
+    const SDL_FPoint* unit = get_unit_circle(segments);
+
+    SDL_Vertex* v = Render_queue::Instance().append_triangles(nullptr, segments * 3, layer, blend_for(color));
+
+    for (int i = 0; i < segments; ++i)
+    {
+        *v++ = vertex(cx, cy, color);
+        *v++ = vertex(cx + unit[i].x * radius, cy + unit[i].y * radius, color);
+        *v++ = vertex(cx + unit[i + 1].x * radius, cy + unit[i + 1].y * radius, color);
+    }
+}
+
+
+void draw_circle_outline(float cx, float cy, float radius, float thickness, SDL_Color color, int layer)
+{
+    if (radius <= 0.0f || thickness <= 0.0f) return;
+
+    if (thickness >= radius)
+    {
+        draw_circle(cx, cy, radius, color, layer);
+        return;
+    }
+
+    if (!in_view(cx - radius, cy - radius, cx + radius, cy + radius)) return;
+
+    const float inner = radius - thickness;
+
+    const int segments = circle_segments(radius);
+    const SDL_FPoint* unit = get_unit_circle(segments);
+
+    SDL_Vertex* v = Render_queue::Instance().append_triangles(nullptr, segments * 6, layer, blend_for(color));
+
+    for (int i = 0; i < segments; ++i)
+    {
+        SDL_FPoint o0 = {cx + unit[i].x * radius, cy + unit[i].y * radius};
+        SDL_FPoint o1 = {cx + unit[i + 1].x * radius, cy + unit[i + 1].y * radius};
+        SDL_FPoint i1 = {cx + unit[i + 1].x * inner, cy + unit[i + 1].y * inner};
+        SDL_FPoint i0 = {cx + unit[i].x * inner, cy + unit[i].y * inner};
+
+        v = put_quad(v, o0, o1, i1, i0, color);
+    }
+}
+
+
+void draw_rounded_rect(const SDL_FRect& rect, float radius, SDL_Color color, int layer)
+{
+    radius = std::min(radius, std::min(rect.w, rect.h) * 0.5f);
+
+    if (radius <= 0.0f)
+    {
+        draw_rect(rect, color, layer);
+        return;
+    }
+
+    if (!View_culler::Instance().is_visible(rect)) return;
+
+    // Convex outline: 4 quarter arcs, fanned from the center
+    const int quarter = circle_segments(radius) / 4;
+    const SDL_FPoint* unit = get_unit_circle(quarter * 4);
+
+    const int points = (quarter + 1) * 4;
+
+    Render_queue& queue = Render_queue::Instance();
+    SDL_Vertex* v = queue.append_triangles(nullptr, points * 3, layer, blend_for(color));
+
+    // Corner centers in the order of the angle: bottom-right (0 - 90 deg), bottom-left, top-left, top-right
+    const SDL_FPoint corners[4] = {
+        {rect.x + rect.w - radius, rect.y + rect.h - radius},
+        {rect.x + radius,          rect.y + rect.h - radius},
+        {rect.x + radius,          rect.y + radius},
+        {rect.x + rect.w - radius, rect.y + radius},
+    };
+
+    const SDL_FPoint center = {rect.x + rect.w * 0.5f, rect.y + rect.h * 0.5f};
+
+    auto outline_point = [&](int index) -> SDL_FPoint
+    {
+        index %= points;
+
+        const int corner = index / (quarter + 1);
+        const int step = index % (quarter + 1);
+        const SDL_FPoint& u = unit[corner * quarter + step];
+
+        return {corners[corner].x + u.x * radius, corners[corner].y + u.y * radius};
+    };
+
+    for (int i = 0; i < points; ++i)
+    {
+        SDL_FPoint a = outline_point(i);
+        SDL_FPoint b = outline_point(i + 1);
+
+        *v++ = vertex(center.x, center.y, color);
+        *v++ = vertex(a.x, a.y, color);
+        *v++ = vertex(b.x, b.y, color);
+    }
+}
+
+
+void draw_line(float x0, float y0, float x1, float y1, float thickness, SDL_Color color, int layer)
+{
+    const float dx = x1 - x0;
+    const float dy = y1 - y0;
+    const float length = std::sqrt(dx * dx + dy * dy);
+
+    if (length <= 0.0f || thickness <= 0.0f) return;
+
+    const float half = thickness * 0.5f;
+
+    if (!in_view(std::min(x0, x1) - half, std::min(y0, y1) - half, std::max(x0, x1) + half, std::max(y0, y1) + half)) return;
+
+    // Half thickness along the normal
+    const float nx = -dy / length * thickness * 0.5f;
+    const float ny =  dx / length * thickness * 0.5f;
+
+    SDL_Vertex* v = Render_queue::Instance().append_triangles(nullptr, 6, layer, blend_for(color));
+
+    put_quad(v, {x0 + nx, y0 + ny}, {x1 + nx, y1 + ny}, {x1 - nx, y1 - ny}, {x0 - nx, y0 - ny}, color);
+}
+
+
+void draw_triangle(SDL_FPoint a, SDL_FPoint b, SDL_FPoint c, SDL_Color color, int layer)
+{
+    if (!in_view(std::min({a.x, b.x, c.x}), std::min({a.y, b.y, c.y}), std::max({a.x, b.x, c.x}), std::max({a.y, b.y, c.y})))
+        return;
+
+    SDL_Vertex* v = Render_queue::Instance().append_triangles(nullptr, 3, layer, blend_for(color));
+
+    v[0] = vertex(a.x, a.y, color);
+    v[1] = vertex(b.x, b.y, color);
+    v[2] = vertex(c.x, c.y, color);
+}
+
+// =========================================================================================== SHAPES
@@ -0,0 +1,71 @@
+// primitives.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== PRIMITIVES
+
+
+/**
+ * @brief Filled circle with the current draw color of the renderer.
+ *
+ * The circle is split into horizontal spans, one rectangle per row, and all of them
+ * are drawn by a single SDL_RenderFillRects call - instead of one SDL_RenderDrawPoint
+ * per pixel. The span widths are computed once per radius and reused while it stays the same.
+ *
+ * Covers the same pixels as the (dx*dx + dy*dy <= radius*radius) test.
+ *
+ * @param r      Renderer to draw with.
+ * @param cx     Center x.
+ * @param cy     Center y.
+ * @param radius Radius in pixels (nothing is drawn if negative).
+ */
+void fill_circle(SDL_Renderer* r, int cx, int cy, int radius);
+
+// =========================================================================================== PRIMITIVES
+
+
+// =========================================================================================== SHAPES
+
+// Batched procedural shapes. Every shape is tessellated into triangles right inside
+// the shared vertex buffer of the Render_queue, so the whole procedural UI of a state
+// is usually one SDL_RenderGeometry call per layer. Translucent colors (a < 255) are
+// blended, the opaque ones are not.
+//
+// Usage (inside the state render):
+//
+// draw_rounded_rect({20, 20, 200, 60}, 8.0f, {40, 40, 40, 255});
+// draw_line(20, 100, 220, 100, 2.0f, {255, 255, 255, 255}, 1);
+//
+// Circles and corners get the segment count from their radius (~4 px per segment).
+// A shape entirely outside the View_culler view is skipped before the tessellation.
+
+
+// Solid rectangle
+void draw_rect(const SDL_FRect& rect, SDL_Color color, int layer = 0);
+
+// Rectangle outline, the thickness grows inside the rectangle
+void draw_rect_outline(const SDL_FRect& rect, float thickness, SDL_Color color, int layer = 0);
+
+// Solid circle
+void draw_circle(float cx, float cy, float radius, SDL_Color color, int layer = 0);
+
+// Circle outline (ring), the thickness grows inside the radius
+void draw_circle_outline(float cx, float cy, float radius, float thickness, SDL_Color color, int layer = 0);
+
+// Solid rectangle with the rounded corners (radius is clamped to the half of the smaller side)
+void draw_rounded_rect(const SDL_FRect& rect, float radius, SDL_Color color, int layer = 0);
+
+// Line segment of the given thickness (butt ends)
+void draw_line(float x0, float y0, float x1, float y1, float thickness, SDL_Color color, int layer = 0);
+
+// Solid triangle (any winding)
+void draw_triangle(SDL_FPoint a, SDL_FPoint b, SDL_FPoint c, SDL_Color color, int layer = 0);
+
+// =========================================================================================== SHAPES
@@ -0,0 +1,465 @@
+// render_capture.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "render_capture.h"
+#include "../render_queue/render_queue.h"
+#include "../blit/hw_blitter.h"
+
+#include <cstring>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== RENDER CAPTURE
+
+Render_capture& Render_capture::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Render_capture instance;
+
+    return instance;
+}
+
+
+bool Render_capture::open(const char* path, int frames, int view_w, int view_h)
+{
+    close();
+
+    if (!path || frames <= 0) return false;
+
+    file = SDL_RWFromFile(path, "wb");
+
+    if (!file)
+    {
+        SDL_Log("Render capture %s can't be created: %s", path, SDL_GetError());
+        return false;
+    }
+
+    const std::uint32_t header[4] = {CAPTURE_MAGIC, CAPTURE_VERSION, static_cast<std::uint32_t>(view_w), static_cast<std::uint32_t>(view_h)};
+
+    if (SDL_RWwrite(file, header, sizeof(header), 1) != 1)
+    {
+        SDL_Log("Render capture %s writing failed: %s", path, SDL_GetError());
+        SDL_RWclose(file);
+        file = nullptr;
+        return false;
+    }
+
+    frames_left = frames;
+    written_frames = 0;
+
+    textures.clear();
+    next_texture_id = 1;
+
+    buffer.clear();
+    in_frame = false;
+    in_submission = false;
+
+    SDL_Log("Render capture of %d frames into %s", frames, path);
+
+    return true;
+}
+
+
+void Render_capture::close()
+{
+    if (!file) return;
+
+    // A frame cut by the close is dropped - the replay has whole frames only
+    SDL_RWclose(file);
+    file = nullptr;
+
+    SDL_Log("Render capture closed, %d frames", written_frames);
+
+    buffer.clear();
+    commands.clear();
+    vertices.clear();
+    textures.clear();
+
+    in_frame = false;
+    in_submission = false;
+}
+
+
+void Render_capture::begin_frame(SDL_Renderer* r)
+{
+    if (!file) return;
+
+    frame_target = SDL_GetRenderTarget(r);
+    in_frame = true;
+
+    buffer.clear();
+}
+
+
+void Render_capture::end_frame()
+{
+    if (!file || !in_frame) return;
+
+    end_submission();
+
+    const std::uint32_t tag = CAPTURE_FRAME;
+    put(&tag, sizeof(tag));
+
+    in_frame = false;
+
+    if (SDL_RWwrite(file, buffer.data(), buffer.size(), 1) != 1)
+    {
+        SDL_Log("Render capture writing failed: %s", SDL_GetError());
+        close();
+        return;
+    }
+
+    ++written_frames;
+
+    if (--frames_left == 0) close();
+}
+
+
+bool Render_capture::begin_submission(SDL_Renderer* r)
+{
+    if (!file || !in_frame || SDL_GetRenderTarget(r) != frame_target) return false;
+
+    end_submission();
+
+    in_submission = true;
+
+    return true;
+}
+
+
+void Render_capture::add_command(SDL_Texture* texture, int layer, SDL_BlendMode blend, const SDL_Vertex* command_vertices,
+                                 int vertex_count, bool quad)
+{
+    if (!in_submission) return;
+
+    commands.push_back({layer, static_cast<std::uint32_t>(blend), texture ? texture_id(texture) : 0,
+                        static_cast<std::uint32_t>(vertex_count), quad ? 1u : 0u});
+
+    vertices.insert(vertices.end(), command_vertices, command_vertices + vertex_count);
+}
+
+
+void Render_capture::end_submission()
+{
+    if (!in_submission) return;
+
+    in_submission = false;
+
+    if (commands.empty()) return;
+
+    const std::uint32_t head[3] = {CAPTURE_SUBMISSION, static_cast<std::uint32_t>(commands.size()), static_cast<std::uint32_t>(vertices.size())};
+
+    put(head, sizeof(head));
+    put(commands.data(), commands.size() * sizeof(Capture_command));
+    put(vertices.data(), vertices.size() * sizeof(SDL_Vertex));
+
+    commands.clear();
+    vertices.clear();
+}
+
+
+std::uint32_t Render_capture::texture_id(SDL_Texture* texture)
+{
+    Uint32 format = 0;
+    int access = 0, w = 0, h = 0;
+
+    SDL_QueryTexture(texture, &format, &access, &w, &h);
+
+    // The same address of the same kind - the known texture (a destroyed one can come back at its address)
+    for (const Known_texture& known : textures)
+    {
+        if (known.texture == texture && known.info.width == static_cast<std::uint32_t>(w) && known.info.height == static_cast<std::uint32_t>(h)
+            && known.info.format == format && known.info.access == static_cast<std::uint32_t>(access))
+            return known.info.id;
+    }
+
+    SDL_BlendMode blend = SDL_BLENDMODE_NONE;
+    SDL_GetTextureBlendMode(texture, &blend);
+
+    SDL_ScaleMode scale = SDL_ScaleModeNearest;
+    SDL_GetTextureScaleMode(texture, &scale);
+
+    Capture_texture info = {next_texture_id++, static_cast<std::uint32_t>(w), static_cast<std::uint32_t>(h), format,
+                            static_cast<std::uint32_t>(access), static_cast<std::uint32_t>(blend), static_cast<std::uint32_t>(scale)};
+
+    // The old texture at the address is gone
+    for (Known_texture& known : textures)
+    {
+        if (known.texture != texture) continue;
+
+        known.info = info;
+        texture = nullptr;
+        break;
+    }
+
+    if (texture) textures.push_back({texture, info});
+
+    // Before the submission, which uses it
+    const std::uint32_t tag = CAPTURE_TEXTURE;
+
+    put(&tag, sizeof(tag));
+    put(&info, sizeof(info));
+
+    return info.id;
+}
+
+
+void Render_capture::put(const void* data, size_t bytes)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+
+    buffer.insert(buffer.end(), p, p + bytes);
+}
+
+
+// === REPLAY ===
+
+Render_replay::~Render_replay() { release_textures(); }
+
+
+// Next word of the capture, false past its end
+static bool read_words(const unsigned char*& p, const unsigned char* end, void* out, size_t bytes)
+{
+    if (static_cast<size_t>(end - p) < bytes) return false;
+
+    std::memcpy(out, p, bytes);
+    p += bytes;
+
+    return true;
+}
+
+
+bool Render_replay::load(const char* path)
+{
+    release_textures();
+
+    textures.clear();
+    commands.clear();
+    vertices.clear();
+    submissions.clear();
+    frames.clear();
+
+    size_t size = 0;
+    unsigned char* data = static_cast<unsigned char*>(SDL_LoadFile(path, &size));
+
+    if (!data)
+    {
+        SDL_Log("Render capture %s can't be read: %s", path, SDL_GetError());
+        return false;
+    }
+
+    const unsigned char* p = data;
+    const unsigned char* end = data + size;
+
+    std::uint32_t header[4] = {};
+
+    bool ok = read_words(p, end, header, sizeof(header)) && header[0] == CAPTURE_MAGIC && header[1] == CAPTURE_VERSION;
+
+    view_w = static_cast<int>(header[2]);
+    view_h = static_cast<int>(header[3]);
+
+    // Submissions of the frame being read
+    size_t frame_first = 0;
+
+    while (ok && p < end)
+    {
+        std::uint32_t tag = 0;
+
+        ok = read_words(p, end, &tag, sizeof(tag));
+
+        if (!ok) break;
+
+        if (tag == CAPTURE_TEXTURE)
+        {
+            Capture_texture info;
+
+            ok = read_words(p, end, &info, sizeof(info)) && info.id == textures.size() + 1;
+
+            if (ok) textures.push_back(info);
+        }
+        else if (tag == CAPTURE_SUBMISSION)
+        {
+            std::uint32_t counts[2] = {};
+
+            ok = read_words(p, end, counts, sizeof(counts));
+
+            const size_t first_command = commands.size();
+            const size_t first_vertex = vertices.size();
+
+            if (ok)
+            {
+                commands.resize(first_command + counts[0]);
+                ok = read_words(p, end, commands.data() + first_command, counts[0] * sizeof(Capture_command));
+            }
+
+            if (ok)
+            {
+                vertices.resize(first_vertex + counts[1]);
+                ok = read_words(p, end, vertices.data() + first_vertex, counts[1] * sizeof(SDL_Vertex));
+            }
+
+            // Every command in the vertices and of a known texture
+            size_t vertex_sum = 0;
+
+            for (size_t i = first_command; ok && i < commands.size(); ++i)
+            {
+                vertex_sum += commands[i].vertex_count;
+                ok = commands[i].texture <= textures.size();
+            }
+
+            ok = ok && vertex_sum == counts[1];
+
+            if (ok) submissions.push_back({first_command, counts[0], first_vertex});
+        }
+        else if (tag == CAPTURE_FRAME)
+        {
+            frames.push_back(frame_first);
+            frame_first = submissions.size();
+        }
+        else ok = false;
+    }
+
+    SDL_free(data);
+
+    if (!ok)
+    {
+        SDL_Log("Render capture %s is damaged or of another version", path);
+        return false;
+    }
+
+    return true;
+}
+
+
+bool Render_replay::create_textures(SDL_Renderer* r)
+{
+    release_textures();
+
+    placeholders.assign(textures.size() + 1, nullptr);
+
+    for (const Capture_texture& info : textures)
+    {
+        const int w = static_cast<int>(info.width);
+        const int h = static_cast<int>(info.height);
+
+        SDL_Texture* texture = SDL_CreateTexture(r, info.format, static_cast<int>(info.access), w, h);
+
+        if (!texture) texture = SDL_CreateTexture(r, SDL_PIXELFORMAT_ARGB8888, static_cast<int>(info.access), w, h);
+
+        if (!texture)
+        {
+            SDL_Log("Render replay texture %ux%u creation failed: %s", info.width, info.height, SDL_GetError());
+            return false;
+        }
+
+        SDL_SetTextureBlendMode(texture, static_cast<SDL_BlendMode>(info.blend));
+        SDL_SetTextureScaleMode(texture, static_cast<SDL_ScaleMode>(info.scale));
+
+        // The placeholder texels - a checker of two grays, the target ones are cleared gray
+        if (info.access == SDL_TEXTUREACCESS_TARGET)
+        {
+            SDL_Texture* previous = SDL_GetRenderTarget(r);
+
+            SDL_SetRenderTarget(r, texture);
+            SDL_SetRenderDrawColor(r, 128, 128, 128, 255);
+            SDL_RenderClear(r);
+            SDL_SetRenderTarget(r, previous);
+        }
+        else if (SDL_Surface* checker = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888))
+        {
+            for (int y = 0; y < h; ++y)
+            {
+                Uint32* row = reinterpret_cast<Uint32*>(static_cast<unsigned char*>(checker->pixels) + y * checker->pitch);
+
+                for (int x = 0; x < w; ++x) row[x] = ((x ^ y) & 8) ? 0xFFA0A0A0u : 0xFF606060u;
+            }
+
+            Uint32 format = 0;
+            SDL_QueryTexture(texture, &format, nullptr, nullptr, nullptr);
+
+            if (SDL_Surface* converted = SDL_ConvertSurfaceFormat(checker, format, 0))
+            {
+                SDL_UpdateTexture(texture, nullptr, converted->pixels, converted->pitch);
+
+                // The copies of the static images are offloaded, like the ones of Image_asset
+                if (info.access == SDL_TEXTUREACCESS_STATIC && Hw_blitter::Instance().is_active())
+                    Hw_blitter::Instance().mirror(texture, converted);
+
+                SDL_FreeSurface(converted);
+            }
+
+            SDL_FreeSurface(checker);
+        }
+
+        placeholders[info.id] = texture;
+    }
+
+    return true;
+}
+
+
+void Render_replay::release_textures()
+{
+    for (SDL_Texture* texture : placeholders)
+    {
+        if (!texture) continue;
+
+        Hw_blitter::Instance().forget(texture);
+        SDL_DestroyTexture(texture);
+    }
+
+    placeholders.clear();
+}
+
+
+int Render_replay::get_submission_count(int frame) const
+{
+    if (frame < 0 || frame >= get_frame_count()) return 0;
+
+    const size_t next = static_cast<size_t>(frame) + 1 < frames.size() ? frames[frame + 1] : submissions.size();
+
+    return static_cast<int>(next - frames[frame]);
+}
+
+
+void Render_replay::queue_submission(int frame, int submission) const
+{
+    if (submission < 0 || submission >= get_submission_count(frame)) return;
+
+    const Submission& s = submissions[frames[frame] + submission];
+
+    Render_queue& queue = Render_queue::Instance();
+
+    const SDL_Vertex* source = vertices.data() + s.first_vertex;
+
+    for (size_t i = s.first_command; i < s.first_command + s.command_count; ++i)
+    {
+        const Capture_command& c = commands[i];
+
+        SDL_Texture* texture = c.texture < placeholders.size() ? placeholders[c.texture] : nullptr;
+
+        // A textured command without its placeholder (not created) - skipped, not drawn solid
+        if (c.texture != 0 && !texture)
+        {
+            source += c.vertex_count;
+            continue;
+        }
+
+        const int count = static_cast<int>(c.vertex_count);
+        const SDL_BlendMode blend = static_cast<SDL_BlendMode>(c.blend);
+
+        SDL_Vertex* v = c.quad ? queue.append_quads(texture, count / 4, c.layer, blend)
+                               : queue.append_triangles(texture, count, c.layer, blend);
+
+        if (v) std::memcpy(v, source, sizeof(SDL_Vertex) * count);
+
+        source += c.vertex_count;
+    }
+}
+
+// === REPLAY ===
+
+// =========================================================================================== RENDER CAPTURE
@@ -0,0 +1,276 @@
+// render_capture.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== CAPTURE FORMAT
+
+// File layout (host byte order - captured and replayed on the same architecture):
+//
+// [magic "MSQC"] [version] [view width] [view height]
+// then the records, each starting with its tag:
+//
+// TEXTURE    - id, width, height, SDL_PixelFormatEnum, SDL_TextureAccess, SDL_BlendMode, SDL_ScaleMode
+// SUBMISSION - command count, vertex count, [Capture_command] * count, [SDL_Vertex] * vertex count
+// FRAME      - the end of the frame (presented)
+//
+// A texture is described once, before the first submission using it. Texture id 0 is none (solid).
+
+constexpr std::uint32_t CAPTURE_MAGIC = 0x4351534D;      // "MSQC"
+constexpr std::uint32_t CAPTURE_VERSION = 1;
+
+constexpr std::uint32_t CAPTURE_TEXTURE = 0x58455454;    // "TTEX"
+constexpr std::uint32_t CAPTURE_SUBMISSION = 0x42555353; // "SSUB"
+constexpr std::uint32_t CAPTURE_FRAME = 0x4D524646;      // "FFRM"
+
+
+// One recorded Render_queue command - its vertices follow the commands of the submission in order
+struct Capture_command
+{
+    std::int32_t layer;
+    std::uint32_t blend;        // SDL_BlendMode (a custom one as composed)
+    std::uint32_t texture;      // Texture id of the capture, 0 - solid
+    std::uint32_t vertex_count;
+    std::uint32_t quad;         // Quads of 4 vertices, else a triangle list
+};
+
+// Texture of the capture - the size and the render state, not the texels
+struct Capture_texture
+{
+    std::uint32_t id;
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t format;
+    std::uint32_t access;
+    std::uint32_t blend;
+    std::uint32_t scale;
+};
+
+// =========================================================================================== CAPTURE FORMAT
+
+
+// =========================================================================================== RENDER CAPTURE
+
+
+/**
+ * @brief Writes the recorded render commands of the frames to a file - the replay workload.
+ *
+ * Every Render_queue submission into the frame target (the states, the overlays, the live
+ * layers) is written as it was recorded: the layers, the blend modes, the textures and
+ * the vertices - before the sort and the batching, so the replay runs those too. The
+ * submissions into the own targets (the cached layers, the tile map chunks, the shape
+ * cache) are the content of the textures - not captured, their textures are.
+ *
+ * The textures are described by the size, the format and the render state only - the
+ * replay draws the same geometry from the placeholders of the same size: the fill rate,
+ * the blending and the batches are the ones of the game, the texels are not. The draws
+ * made straight with SDL_Render* (outside of the queue) are not captured.
+ *
+ * The submissions are buffered and written by end_frame(), after the present.
+ *
+ * Singleton - the Render_queue reaches it without any context, main thread only.
+ *
+ * Usage:
+ * @code
+ * Render_capture::Instance().open("frames.cap", 300, 320, 240);
+ *
+ * // The frame loop
+ * if (frame.begin(r, always))
+ * {
+ *     Render_capture::Instance().begin_frame(r);
+ *     ... state render - the submissions are captured ...
+ *     frame.end();
+ *     Render_capture::Instance().end_frame();     // closes itself after 300 frames
+ * }
+ * @endcode
+ */
+class Render_capture
+{
+
+public:
+
+    // Returns the singleton instance.
+    static Render_capture& Instance();
+
+
+    /**
+     * @brief Starts a capture.
+     *
+     * @param path   Capture file, replaced.
+     * @param frames Frames to capture, then the file is closed.
+     * @param view_w Size the states draw at (the logical one, or the output).
+     * @param view_h
+     * @return false if the file can't be created.
+     */
+    bool open(const char* path, int frames, int view_w, int view_h);
+
+    // Writes the buffered frame (if any) and closes the file
+    void close();
+
+    bool is_open() const { return file != nullptr; }
+
+    // Frames written so far
+    int get_frame_count() const { return written_frames; }
+
+
+    // Frame::begin() is done - its render target is the captured one
+    void begin_frame(SDL_Renderer* r);
+
+    // The frame is presented - writes its submissions, closes the file after the last frame
+    void end_frame();
+
+
+    // === RENDER QUEUE ===
+
+    // A submission starts - false if it isn't captured (no capture, another target)
+    bool begin_submission(SDL_Renderer* r);
+
+    // One command of the submission and its vertices
+    void add_command(SDL_Texture* texture, int layer, SDL_BlendMode blend, const SDL_Vertex* vertices, int vertex_count, bool quad);
+
+    // === RENDER QUEUE ===
+
+
+private:
+
+    // Private constructor for singleton
+    Render_capture() = default;
+
+    // Copying the singleton is not allowed
+    Render_capture(const Render_capture&) = delete;
+    Render_capture& operator=(const Render_capture&) = delete;
+
+
+    // Id of the texture, its record buffered on the first use (or when it was recreated at the same address)
+    std::uint32_t texture_id(SDL_Texture* texture);
+
+    // Appends the words to the frame buffer
+    void put(const void* data, size_t bytes);
+
+    // Closes the open submission - its counts and vertices into the frame buffer
+    void end_submission();
+
+
+    SDL_RWops* file = nullptr;
+
+    int frames_left = 0;
+    int written_frames = 0;
+
+    // Render target of the frame, and whether a frame is in progress
+    SDL_Texture* frame_target = nullptr;
+    bool in_frame = false;
+
+    // Records of the frame - written at its end
+    std::vector<unsigned char> buffer;
+
+    // The open submission
+    std::vector<Capture_command> commands;
+    std::vector<SDL_Vertex> vertices;
+    bool in_submission = false;
+
+    // Textures seen by the capture, by the address
+    struct Known_texture
+    {
+        SDL_Texture* texture;
+        Capture_texture info;
+    };
+
+    std::vector<Known_texture> textures;
+    std::uint32_t next_texture_id = 1;
+};
+
+
+/**
+ * @brief Captured frames read back - queued into the Render_queue again, on any backend.
+ *
+ * Usage:
+ * @code
+ * Render_replay replay;
+ * replay.load("frames.cap");
+ * replay.create_textures(renderer);
+ *
+ * for (int f = 0; f < replay.get_frame_count(); ++f)
+ *     for (int s = 0; s < replay.get_submission_count(f); ++s)
+ *     {
+ *         replay.queue_submission(f, s);
+ *         Render_queue::Instance().submit(renderer);
+ *     }
+ * @endcode
+ */
+class Render_replay
+{
+
+public:
+
+    Render_replay() = default;
+
+    // Destroys the placeholder textures
+    ~Render_replay();
+
+    Render_replay(const Render_replay&) = delete;
+    Render_replay& operator=(const Render_replay&) = delete;
+
+
+    // Reads the whole capture, false if it is damaged or of another version
+    bool load(const char* path);
+
+    /**
+     * @brief Creates a placeholder of every captured texture - a checker of the same size,
+     *        format, access, blend mode and scale mode (ARGB8888, if the renderer lacks the format).
+     */
+    bool create_textures(SDL_Renderer* r);
+
+    // Destroys the placeholders (before the renderer)
+    void release_textures();
+
+
+    int get_view_width() const { return view_w; }
+    int get_view_height() const { return view_h; }
+
+    int get_frame_count() const { return static_cast<int>(frames.size()); }
+    int get_submission_count(int frame) const;
+
+    // Commands and vertices of the whole capture
+    size_t get_command_count() const { return commands.size(); }
+    size_t get_vertex_count() const { return vertices.size(); }
+    size_t get_texture_count() const { return textures.size(); }
+
+    // Records the commands of the submission into the Render_queue (submitted by the caller)
+    void queue_submission(int frame, int submission) const;
+
+
+private:
+
+    struct Submission
+    {
+        size_t first_command;
+        size_t command_count;
+        size_t first_vertex;
+    };
+
+    int view_w = 0;
+    int view_h = 0;
+
+    std::vector<Capture_texture> textures;
+    std::vector<SDL_Texture*> placeholders;    // By the texture id, [0] - none
+
+    std::vector<Capture_command> commands;
+    std::vector<SDL_Vertex> vertices;
+    std::vector<Submission> submissions;
+
+    // First submission of every frame, the next frame's first ends it
+    std::vector<size_t> frames;
+};
+
+// =========================================================================================== RENDER CAPTURE
@@ -0,0 +1,386 @@
+// render_queue.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "render_queue.h"
+#include "../render_stats/render_stats.h"
+#include "../blit/blit_kernels.h"
+#include "../frame_arena/frame_arena.h"
+#include "../render_capture/render_capture.h"
+
+#include <algorithm>
+#include <cstring>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== DRAW KEYS
+
+std::uint64_t* sort_draw_keys(std::uint64_t* keys, std::uint64_t* scratch, size_t count)
+{
+    // The bytes above the index - the top 5 of the 8
+    constexpr int FIRST_BYTE = DRAW_KEY_INDEX_BITS / 8;
+    constexpr int PASSES = 8 - FIRST_BYTE;
+
+    constexpr size_t SMALL_SORT = 64;
+
+    // A few keys - the insertion sort is cheaper than clearing the histograms (the keys are unique, stable too)
+    if (count <= SMALL_SORT)
+    {
+        for (size_t i = 1; i < count; ++i)
+        {
+            const std::uint64_t key = keys[i];
+
+            size_t j = i;
+
+            for (; j > 0 && keys[j - 1] > key; --j) keys[j] = keys[j - 1];
+
+            keys[j] = key;
+        }
+
+        return keys;
+    }
+
+    // Every histogram in one read of the keys
+    std::uint32_t counts[PASSES][256];
+    std::memset(counts, 0, sizeof(counts));
+
+    for (size_t i = 0; i < count; ++i)
+        for (int p = 0; p < PASSES; ++p) ++counts[p][keys[i] >> ((FIRST_BYTE + p) * 8) & 0xFF];
+
+    std::uint64_t* from = keys;
+    std::uint64_t* to = scratch;
+
+    for (int p = 0; p < PASSES; ++p)
+    {
+        std::uint32_t* bucket = counts[p];
+        const int shift = (FIRST_BYTE + p) * 8;
+
+        // The same byte in every key - the order stays, no pass
+        if (bucket[from[0] >> shift & 0xFF] == count) continue;
+
+        // Counts to the first positions of the buckets
+        std::uint32_t position = 0;
+
+        for (int b = 0; b < 256; ++b)
+        {
+            const std::uint32_t n = bucket[b];
+            bucket[b] = position;
+            position += n;
+        }
+
+        // In the order of the previous pass - the sort is stable
+        for (size_t i = 0; i < count; ++i) to[bucket[from[i] >> shift & 0xFF]++] = from[i];
+
+        std::swap(from, to);
+    }
+
+    return from;
+}
+
+// =========================================================================================== DRAW KEYS
+
+
+// =========================================================================================== RENDER QUEUE
+
+Render_queue& Render_queue::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Render_queue instance;
+
+    return instance;
+}
+
+
+// === RECORDING ===
+
+void Render_queue::fill_rect(const SDL_FRect& rect, SDL_Color color, int layer, SDL_BlendMode blend)
+{
+    const float x1 = rect.x + rect.w;
+    const float y1 = rect.y + rect.h;
+
+    const SDL_Vertex quad[4] = {
+        {{rect.x, rect.y}, color, {0.0f, 0.0f}},
+        {{x1,     rect.y}, color, {0.0f, 0.0f}},
+        {{x1,     y1},     color, {0.0f, 0.0f}},
+        {{rect.x, y1},     color, {0.0f, 0.0f}},
+    };
+
+    push_quad(nullptr, layer, blend, quad);
+}
+
+
+void Render_queue::fill_rect(const SDL_Rect& rect, SDL_Color color, int layer, SDL_BlendMode blend)
+{
+    const SDL_FRect frect = {static_cast<float>(rect.x), static_cast<float>(rect.y),
+                             static_cast<float>(rect.w), static_cast<float>(rect.h)};
+
+    fill_rect(frect, color, layer, blend);
+}
+
+
+void Render_queue::copy(SDL_Texture* texture, const SDL_Rect* src, const SDL_FRect& dst, int layer, SDL_Color mod)
+{
+    if (!texture) return;
+
+    int tw = 0, th = 0;
+
+    if (SDL_QueryTexture(texture, nullptr, nullptr, &tw, &th) != 0 || tw == 0 || th == 0) return;
+
+    // Texel rectangle to the normalized texture coordinates
+    float u0 = 0.0f, v0 = 0.0f, u1 = 1.0f, v1 = 1.0f;
+
+    if (src)
+    {
+        u0 = static_cast<float>(src->x) / tw;
+        v0 = static_cast<float>(src->y) / th;
+        u1 = static_cast<float>(src->x + src->w) / tw;
+        v1 = static_cast<float>(src->y + src->h) / th;
+    }
+
+    const float x1 = dst.x + dst.w;
+    const float y1 = dst.y + dst.h;
+
+    const SDL_Vertex quad[4] = {
+        {{dst.x, dst.y}, mod, {u0, v0}},
+        {{x1,    dst.y}, mod, {u1, v0}},
+        {{x1,    y1},    mod, {u1, v1}},
+        {{dst.x, y1},    mod, {u0, v1}},
+    };
+
+    SDL_BlendMode blend = SDL_BLENDMODE_NONE;
+    SDL_GetTextureBlendMode(texture, &blend);
+
+    push_quad(texture, layer, blend, quad);
+}
+
+
+void Render_queue::geometry(SDL_Texture* texture, const SDL_Vertex* verts, int count, int layer, SDL_BlendMode blend)
+{
+    if (!verts || count < 3) return;
+
+    count -= count % 3; // Incomplete triangle is dropped, like SDL does
+
+    if (texture) SDL_GetTextureBlendMode(texture, &blend);
+
+    commands.push_back({layer, blend, texture, static_cast<int>(vertices.size()), count, false});
+
+    vertices.insert(vertices.end(), verts, verts + count);
+}
+
+
+SDL_Vertex* Render_queue::append_triangles(SDL_Texture* texture, int count, int layer, SDL_BlendMode blend)
+{
+    if (count < 3 || count % 3 != 0) return nullptr;
+
+    if (texture) SDL_GetTextureBlendMode(texture, &blend);
+
+    const int first = static_cast<int>(vertices.size());
+
+    commands.push_back({layer, blend, texture, first, count, false});
+
+    vertices.resize(vertices.size() + count);
+
+    return vertices.data() + first;
+}
+
+
+SDL_Vertex* Render_queue::append_quads(SDL_Texture* texture, int count, int layer, SDL_BlendMode blend)
+{
+    if (count <= 0) return nullptr;
+
+    if (texture) SDL_GetTextureBlendMode(texture, &blend);
+
+    const int first = static_cast<int>(vertices.size());
+
+    commands.push_back({layer, blend, texture, first, count * 4, true});
+
+    vertices.resize(vertices.size() + count * 4);
+
+    return vertices.data() + first;
+}
+
+
+void Render_queue::push_quad(SDL_Texture* texture, int layer, SDL_BlendMode blend, const SDL_Vertex (&quad)[4])
+{
+    commands.push_back({layer, blend, texture, static_cast<int>(vertices.size()), 4, true});
+
+    vertices.insert(vertices.end(), quad, quad + 4);
+}
+
+// === RECORDING ===
+
+
+// === SUBMISSION ===
+
+void Render_queue::submit(SDL_Renderer* r) { submit_since(r, 0); }
+
+
+void Render_queue::submit_since(SDL_Renderer* r, int first_command)
+{
+    const int total = static_cast<int>(commands.size());
+
+    if (first_command < 0) first_command = 0;
+
+    last_command_count = total > first_command ? total - first_command : 0;
+    last_batch_count = 0;
+
+    if (last_command_count == 0) return;
+
+    // The commands as recorded - the replay sorts and batches them again
+    Render_capture& capture = Render_capture::Instance();
+
+    if (capture.begin_submission(r))
+    {
+        for (int i = first_command; i < total; ++i)
+        {
+            const Command& c = commands[i];
+            capture.add_command(c.texture, c.layer, c.blend, vertices.data() + c.first_vertex, c.vertex_count, c.quad);
+        }
+    }
+
+    // Ranks of the sort: the blend modes in their value order, the textures in the order of their first command
+    key_blends.clear();
+    key_textures.clear();
+
+    for (int i = first_command; i < total; ++i)
+        if (std::find(key_blends.begin(), key_blends.end(), commands[i].blend) == key_blends.end())
+            key_blends.push_back(commands[i].blend);
+
+    std::sort(key_blends.begin(), key_blends.end());
+
+    // Sort the keys, not the commands - the vertices stay where they were recorded
+    const size_t count = static_cast<size_t>(last_command_count);
+    const size_t key_bytes = sizeof(std::uint64_t) * count * 2;
+
+    Linear_arena& arena = Frame_arena::Instance().get_frame_arena();
+
+    std::uint64_t* keys = static_cast<std::uint64_t*>(arena.allocate(key_bytes, alignof(std::uint64_t)));
+
+    SDL_Texture* last_texture = nullptr;
+    unsigned int last_rank = 0;
+    bool has_last = false;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const Command& c = commands[first_command + i];
+
+        // The runs of one texture are the common case - the search only on a change
+        if (!has_last || c.texture != last_texture)
+        {
+            const auto it = std::find(key_textures.begin(), key_textures.end(), c.texture);
+
+            last_rank = static_cast<unsigned int>(it - key_textures.begin());
+            last_texture = c.texture;
+            has_last = true;
+
+            if (it == key_textures.end()) key_textures.push_back(c.texture);
+        }
+
+        const unsigned int blend_rank =
+            static_cast<unsigned int>(std::lower_bound(key_blends.begin(), key_blends.end(), c.blend) - key_blends.begin());
+
+        keys[i] = make_draw_key(c.layer, blend_rank, last_rank, static_cast<unsigned int>(i));
+    }
+
+    const std::uint64_t* sorted = sort_draw_keys(keys, keys + count, count);
+
+    // Every run of the same layer, blend mode and texture is one batch
+    const Command* batch_head = nullptr;
+
+    for (size_t k = 0; k < count; ++k)
+    {
+        const Command& c = commands[first_command + (sorted[k] & ((1u << DRAW_KEY_INDEX_BITS) - 1))];
+
+        if (batch_head && (c.layer != batch_head->layer || c.blend != batch_head->blend || c.texture != batch_head->texture))
+        {
+            flush_batch(r, batch_head->texture, batch_head->blend);
+        }
+
+        if (batch_vertices.empty()) batch_head = &c;
+
+        const int base = static_cast<int>(batch_vertices.size());
+        const SDL_Vertex* first = vertices.data() + c.first_vertex;
+
+        batch_vertices.insert(batch_vertices.end(), first, first + c.vertex_count);
+
+        if (c.quad)
+        {
+            for (int q = base; q < base + c.vertex_count; q += 4)
+            {
+                const int quad_indices[6] = {q, q + 1, q + 2, q, q + 2, q + 3};
+                batch_indices.insert(batch_indices.end(), quad_indices, quad_indices + 6);
+            }
+        }
+        else
+        {
+            for (int i = 0; i < c.vertex_count; ++i) batch_indices.push_back(base + i);
+        }
+    }
+
+    if (batch_head) flush_batch(r, batch_head->texture, batch_head->blend);
+
+    // The keys back to the arena - free again, if nothing was allocated after them
+    arena.release(keys, key_bytes);
+
+    // Drop the submitted tail, the commands before it stay queued
+    vertices.resize(commands[first_command].first_vertex);
+    commands.resize(first_command);
+}
+
+
+void Render_queue::flush_batch(SDL_Renderer* r, SDL_Texture* texture, SDL_BlendMode blend)
+{
+    if (batch_vertices.empty()) return;
+
+    // Solid geometry uses the draw blend mode, the textured one - the texture's own
+    if (!texture) SDL_SetRenderDrawBlendMode(r, blend);
+
+    // Premultiplied textures take the premultiplied vertex colors - the alpha fades the color too
+    static const SDL_BlendMode premultiplied = blend_mode_premultiplied();
+
+    if (texture && blend == premultiplied)
+    {
+        for (SDL_Vertex& v : batch_vertices)
+        {
+            if (v.color.a == 255) continue;
+
+            v.color.r = static_cast<Uint8>((v.color.r * v.color.a + 127) / 255);
+            v.color.g = static_cast<Uint8>((v.color.g * v.color.a + 127) / 255);
+            v.color.b = static_cast<Uint8>((v.color.b * v.color.a + 127) / 255);
+        }
+    }
+
+    if (Render::geometry(r, texture, batch_vertices.data(), static_cast<int>(batch_vertices.size()),
+                           batch_indices.data(), static_cast<int>(batch_indices.size())) != 0)
+    {
+        SDL_Log("Render queue batch failed: %s", SDL_GetError());
+    }
+
+    ++last_batch_count;
+    ++total_batch_count;
+
+    batch_vertices.clear();
+    batch_indices.clear();
+}
+
+// === SUBMISSION ===
+
+
+void Render_queue::clear()
+{
+    commands.clear();
+    vertices.clear();
+}
+
+
+int Render_queue::get_command_count() const { return static_cast<int>(commands.size()); }
+
+
+int Render_queue::get_last_command_count() const { return last_command_count; }
+
+
+int Render_queue::get_last_batch_count() const { return last_batch_count; }
+
+// =========================================================================================== RENDER QUEUE
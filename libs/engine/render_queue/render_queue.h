@@ -0,0 +1,250 @@
+// render_queue.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== DRAW KEYS
+
+// Bits of the command index at the bottom of a draw key - 16M commands per submission
+constexpr int DRAW_KEY_INDEX_BITS = 24;
+
+
+/**
+ * @brief Sort key of a recorded command - the order of the keys is the draw order.
+ *
+ * From the top: the layer (16 bits, biased - the negative layers come first), the rank of the
+ * blend mode (8 bits), the rank of the texture (16 bits) and the command index (24 bits).
+ * The index makes every key unique and carries the command through the sort.
+ */
+constexpr std::uint64_t make_draw_key(int layer, unsigned int blend_rank, unsigned int texture_rank, unsigned int index)
+{
+    const int biased = layer + 0x8000;
+    const std::uint64_t layer_bits = biased < 0 ? 0 : biased > 0xFFFF ? 0xFFFF : static_cast<std::uint64_t>(biased);
+
+    return layer_bits << 48 | static_cast<std::uint64_t>(blend_rank & 0xFF) << 40
+         | static_cast<std::uint64_t>(texture_rank & 0xFFFF) << DRAW_KEY_INDEX_BITS | (index & ((1u << DRAW_KEY_INDEX_BITS) - 1));
+}
+
+
+/**
+ * @brief LSD radix sort of the draw keys - linear time, stable.
+ *
+ * One counting pass per byte above the index (5 at most), all of the histograms are counted
+ * by one read of the keys, and a byte, which is the same in every key (one layer, one blend
+ * mode), costs no pass at all. The index bits are never sorted - they come in order.
+ * Up to 64 keys are insertion sorted instead - a few commands don't pay for the histograms.
+ *
+ * @param keys    Keys to sort.
+ * @param scratch Space of count keys - the passes ping-pong between the two.
+ * @return The sorted keys: keys or scratch.
+ */
+std::uint64_t* sort_draw_keys(std::uint64_t* keys, std::uint64_t* scratch, size_t count);
+
+// =========================================================================================== DRAW KEYS
+
+
+// =========================================================================================== RENDER QUEUE
+
+
+/**
+ * @brief Recorded per-frame render command buffer with the sort-and-batch submission.
+ *
+ * Instead of calling SDL_Render* for every primitive, the states record the draw
+ * commands here. After the state render returns, the state machine submits the queue:
+ * the commands are sorted by layer, blend mode and texture, and every run of the
+ * commands with the same texture and blend mode becomes one SDL_RenderGeometry call.
+ * Solid rectangles of different colors go into the same batch (the color is per vertex).
+ *
+ * Ordering: layers are drawn in ascending order. Inside one layer the commands are
+ * reordered to group the blend modes (in the SDL_BlendMode order - the opaque ones first) and
+ * the textures (in the order of their first command), only the commands with the same texture
+ * and blend mode keep their recording order.
+ *
+ * The order is a radix sort of the 64-bit draw keys (make_draw_key()) in the Frame_arena -
+ * linear in the commands, no comparison per pair and no heap allocation. Overlapping primitives, which must be drawn in a
+ * specific order, go to different layers.
+ *
+ * The queued commands are drawn on top of everything the state drew directly with
+ * SDL_Render* during the same render call.
+ *
+ * The buffers are linear and keep their capacity, so after the first frames
+ * the recording doesn't allocate.
+ *
+ * Singleton, like Frame, so the render callbacks can reach it without any context.
+ *
+ * Usage:
+ * @code
+ * Render_queue& q = Render_queue::Instance();
+ *
+ * q.fill_rect({10, 10, 32, 32}, {255, 0, 0, 255});            // layer 0
+ * q.copy(sprite, nullptr, {50.0f, 50.0f, 16.0f, 16.0f}, 1);   // layer 1, above
+ * @endcode
+ */
+class Render_queue
+{
+
+public:
+
+    // Returns the singleton instance.
+    static Render_queue& Instance();
+
+
+    // === RECORDING ===
+
+    /**
+     * @brief Records a solid rectangle.
+     *
+     * @param rect  Rectangle in the render target pixels.
+     * @param color Fill color.
+     * @param layer Draw order layer, higher is drawn later.
+     * @param blend Blend mode of the fill (SDL_BLENDMODE_BLEND for the translucent colors).
+     */
+    void fill_rect(const SDL_FRect& rect, SDL_Color color, int layer = 0, SDL_BlendMode blend = SDL_BLENDMODE_NONE);
+
+    // Integer rectangle overload
+    void fill_rect(const SDL_Rect& rect, SDL_Color color, int layer = 0, SDL_BlendMode blend = SDL_BLENDMODE_NONE);
+
+    /**
+     * @brief Records a texture copy (SDL_RenderCopyF equivalent, no rotation).
+     *
+     * @param texture Source texture (its own blend mode is used).
+     * @param src     Source rectangle in texels, nullptr - whole texture.
+     * @param dst     Destination rectangle.
+     * @param layer   Draw order layer.
+     * @param mod     Color and alpha modulation.
+     */
+    void copy(SDL_Texture* texture, const SDL_Rect* src, const SDL_FRect& dst, int layer = 0,
+              SDL_Color mod = {255, 255, 255, 255});
+
+    /**
+     * @brief Records a triangle list.
+     *
+     * @param texture  Texture of the triangles, nullptr - solid colored.
+     * @param vertices Vertices, 3 per triangle.
+     * @param count    Number of vertices (multiple of 3).
+     * @param layer    Draw order layer.
+     * @param blend    Blend mode of the solid triangles (textured ones use the texture's).
+     */
+    void geometry(SDL_Texture* texture, const SDL_Vertex* vertices, int count, int layer = 0,
+                  SDL_BlendMode blend = SDL_BLENDMODE_NONE);
+
+    /**
+     * @brief Records a triangle list, which is written in place by the caller.
+     *
+     * The tessellators write the vertices straight into the frame buffer, without a copy.
+     * The pointer is valid only until the next recording call.
+     *
+     * @param count Number of vertices (multiple of 3).
+     * @return Space for count vertices, nullptr if count is invalid.
+     */
+    SDL_Vertex* append_triangles(SDL_Texture* texture, int count, int layer = 0,
+                                 SDL_BlendMode blend = SDL_BLENDMODE_NONE);
+
+    /**
+     * @brief Records a run of quads, which is written in place by the caller.
+     *
+     * Every quad is 4 vertices along its perimeter (top left, top right, bottom right,
+     * bottom left for an unrotated one) - 4 vertices and 6 indices per quad instead of 6 vertices.
+     * The pointer is valid only until the next recording call.
+     *
+     * @param count Number of quads.
+     * @return Space for 4 * count vertices, nullptr if count is invalid.
+     */
+    SDL_Vertex* append_quads(SDL_Texture* texture, int count, int layer = 0,
+                             SDL_BlendMode blend = SDL_BLENDMODE_NONE);
+
+    // === RECORDING ===
+
+
+    /**
+     * @brief Sorts and draws all recorded commands, then clears the queue.
+     *
+     * Called by the state machine after every state render, the states don't call it.
+     *
+     * @param r Renderer to draw with.
+     */
+    void submit(SDL_Renderer* r);
+
+    /**
+     * @brief Sorts and draws only the commands recorded after the mark, and removes them.
+     *
+     * Lets a module draw into its own render target (see Shape_cache) in the middle
+     * of the state render, without flushing the commands the state has already queued.
+     *
+     * @param r             Renderer to draw with.
+     * @param first_command Mark taken by get_command_count() before the recording.
+     */
+    void submit_since(SDL_Renderer* r, int first_command);
+
+    // Drops the recorded commands without drawing them
+    void clear();
+
+
+    // Number of the commands waiting for the submission
+    int get_command_count() const;
+
+    // Number of the commands drawn by the last submit()
+    int get_last_command_count() const;
+
+    // Number of the driver calls made by the last submit()
+    int get_last_batch_count() const;
+
+    // Driver calls of all the submissions since the start - the difference of two frames is the frame count
+    std::uint64_t get_total_batch_count() const { return total_batch_count; }
+
+
+private:
+
+    // Private constructor for singleton
+    Render_queue() = default;
+
+    // Copying the singleton is not allowed
+    Render_queue(const Render_queue&) = delete;
+    Render_queue& operator=(const Render_queue&) = delete;
+
+
+    // Single recorded command - a range of the vertices with one render state
+    struct Command
+    {
+        int layer;
+        SDL_BlendMode blend;
+        SDL_Texture* texture;
+        int first_vertex;
+        int vertex_count;
+        bool quad;              // Quads of 4 vertices (two triangles each), otherwise a plain triangle list
+    };
+
+    // Records a quad (two triangles over 4 vertices)
+    void push_quad(SDL_Texture* texture, int layer, SDL_BlendMode blend, const SDL_Vertex (&quad)[4]);
+
+    // Draws the collected batch with one driver call
+    void flush_batch(SDL_Renderer* r, SDL_Texture* texture, SDL_BlendMode blend);
+
+
+    std::vector<Command> commands;
+    std::vector<SDL_Vertex> vertices;
+
+    // Distinct blend modes and textures of the submission - their index is the rank in the draw keys
+    std::vector<SDL_BlendMode> key_blends;
+    std::vector<SDL_Texture*> key_textures;
+
+    // Submission scratch - kept between the frames for the capacity
+    std::vector<SDL_Vertex> batch_vertices;
+    std::vector<int> batch_indices;
+
+    int last_command_count = 0;
+    int last_batch_count = 0;
+    std::uint64_t total_batch_count = 0;
+};
+
+// =========================================================================================== RENDER QUEUE
@@ -0,0 +1,252 @@
+// render_stats.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "render_stats.h"
+#include "../zone_profiler/zone_profiler.h"
+#include "../blit/hw_blitter.h"
+#include "../frame/frame.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <ostream>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== RENDER CALLS
+
+// Area of a null destination or a clear - the viewport
+static std::uint64_t viewport_pixels(SDL_Renderer* r)
+{
+    SDL_Rect viewport;
+    SDL_RenderGetViewport(r, &viewport);
+
+    return static_cast<std::uint64_t>(viewport.w) * static_cast<std::uint64_t>(viewport.h);
+}
+
+
+static std::uint64_t rect_pixels(SDL_Renderer* r, const SDL_Rect* rect)
+{
+    if (!rect) return viewport_pixels(r);
+
+    return rect->w > 0 && rect->h > 0 ? static_cast<std::uint64_t>(rect->w) * static_cast<std::uint64_t>(rect->h) : 0;
+}
+
+
+static double triangle_area(const SDL_Vertex& a, const SDL_Vertex& b, const SDL_Vertex& c)
+{
+    const double cross = (b.position.x - a.position.x) * (c.position.y - a.position.y)
+                       - (c.position.x - a.position.x) * (b.position.y - a.position.y);
+
+    return std::fabs(cross) * 0.5;
+}
+
+
+namespace Render
+{
+    int clear(SDL_Renderer* r)
+    {
+        Render_stats::Instance().count_draw(nullptr, 1, viewport_pixels(r));
+
+        if (Hw_blitter::Instance().clear(r)) return 0;
+
+        return SDL_RenderClear(r);
+    }
+
+
+    int copy(SDL_Renderer* r, SDL_Texture* texture, const SDL_Rect* src, const SDL_Rect* dst)
+    {
+        Render_stats::Instance().count_draw(texture, 1, rect_pixels(r, dst));
+
+        if (Hw_blitter::Instance().copy(r, texture, src, dst)) return 0;
+
+        return SDL_RenderCopy(r, texture, src, dst);
+    }
+
+
+    int fill_rect(SDL_Renderer* r, const SDL_Rect* rect)
+    {
+        Render_stats::Instance().count_draw(nullptr, 1, rect_pixels(r, rect));
+
+        if (Hw_blitter::Instance().fill_rects(r, rect, 1)) return 0;
+
+        return SDL_RenderFillRect(r, rect);
+    }
+
+
+    int fill_rects(SDL_Renderer* r, const SDL_Rect* rects, int count)
+    {
+        std::uint64_t pixels = 0;
+
+        for (int i = 0; i < count; ++i) pixels += rect_pixels(r, &rects[i]);
+
+        Render_stats::Instance().count_draw(nullptr, static_cast<std::uint32_t>(std::max(count, 0)), pixels);
+
+        if (Hw_blitter::Instance().fill_rects(r, rects, count)) return 0;
+
+        return SDL_RenderFillRects(r, rects, count);
+    }
+
+
+    int geometry(SDL_Renderer* r, SDL_Texture* texture, const SDL_Vertex* vertices, int vertex_count,
+                 const int* indices, int index_count)
+    {
+        // Without the indices the vertices are the triangles
+        const int corners = indices ? index_count : vertex_count;
+
+        double area = 0.0;
+
+        for (int i = 0; i + 2 < corners; i += 3)
+        {
+            if (indices) area += triangle_area(vertices[indices[i]], vertices[indices[i + 1]], vertices[indices[i + 2]]);
+            else area += triangle_area(vertices[i], vertices[i + 1], vertices[i + 2]);
+        }
+
+        Render_stats::Instance().count_draw(texture, static_cast<std::uint32_t>(std::max(corners, 0) / 3),
+                                            static_cast<std::uint64_t>(area));
+
+        // Always the CPU - the hardware draws into the screen are finished first
+        Hw_blitter::Instance().sync();
+
+        return SDL_RenderGeometry(r, texture, vertices, vertex_count, indices, index_count);
+    }
+
+
+    int set_target(SDL_Renderer* r, SDL_Texture* target)
+    {
+        Render_stats::Instance().count_target(target);
+
+        const int result = SDL_SetRenderTarget(r, target);
+
+        // SDL resets the scale of a texture target - the reduced frame target draws in the logical units again
+        if (result == 0 && target && target == Frame::Instance().get_logical_target()) Frame::Instance().restore_target_scale(r);
+
+        return result;
+    }
+}
+
+// =========================================================================================== RENDER CALLS
+
+
+// =========================================================================================== RENDER STATS
+
+Render_stats& Render_stats::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Render_stats instance;
+    return instance;
+}
+
+
+void Render_stats::count_draw(SDL_Texture* texture, std::uint32_t primitives, std::uint64_t pixels)
+{
+    ++frame.draw_calls;
+    frame.primitives += primitives;
+    frame.pixels += pixels;
+
+    if (texture && texture != bound_texture)
+    {
+        ++frame.texture_binds;
+        bound_texture = texture;
+    }
+}
+
+
+void Render_stats::count_target(SDL_Texture* target)
+{
+    if (target == current_target) return;
+
+    ++frame.target_switches;
+    current_target = target;
+}
+
+
+void Render_stats::end_frame(const State& state)
+{
+    // Nothing drawn - the cycle showed the previous frame
+    if (frame.draw_calls == 0)
+    {
+        frame = Render_counts();
+        return;
+    }
+
+    if (last_entry >= states.size() || !(states[last_entry].id == state.id))
+    {
+        last_entry = 0;
+
+        while (last_entry < states.size() && !(states[last_entry].id == state.id)) ++last_entry;
+
+        if (last_entry == states.size()) states.push_back({state.id, std::string(state.name.view()) + " (" + state.label + ")", 0, {}, {}});
+    }
+
+    State_entry& entry = states[last_entry];
+
+    ++entry.frames;
+
+    entry.total.draw_calls += frame.draw_calls;
+    entry.total.primitives += frame.primitives;
+    entry.total.texture_binds += frame.texture_binds;
+    entry.total.target_switches += frame.target_switches;
+    entry.total.pixels += frame.pixels;
+
+    entry.max.draw_calls = std::max(entry.max.draw_calls, frame.draw_calls);
+    entry.max.primitives = std::max(entry.max.primitives, frame.primitives);
+    entry.max.texture_binds = std::max(entry.max.texture_binds, frame.texture_binds);
+    entry.max.target_switches = std::max(entry.max.target_switches, frame.target_switches);
+    entry.max.pixels = std::max(entry.max.pixels, frame.pixels);
+
+#ifdef ZONE_PROFILING
+    Zone_profiler& profiler = Zone_profiler::Instance();
+
+    profiler.counter("draw_calls", static_cast<std::int64_t>(frame.draw_calls));
+    profiler.counter("primitives", static_cast<std::int64_t>(frame.primitives));
+    profiler.counter("texture_binds", static_cast<std::int64_t>(frame.texture_binds));
+    profiler.counter("target_switches", static_cast<std::int64_t>(frame.target_switches));
+    profiler.counter("pixels", static_cast<std::int64_t>(frame.pixels));
+#endif
+
+    last_frame = frame;
+    frame = Render_counts();
+}
+
+
+void Render_stats::dump(std::ostream& out) const
+{
+    out << "=== Render stats ===\n";
+
+    if (states.empty())
+    {
+        out << "No frames rendered\n";
+        return;
+    }
+
+    out << "Per frame: mean / max\n";
+    out << std::fixed << std::setprecision(1);
+
+    for (const State_entry& entry : states)
+    {
+        const double n = static_cast<double>(entry.frames);
+
+        out << "  " << std::left << std::setw(24) << entry.name << std::right << " frames " << std::setw(7) << entry.frames
+            << ", draws " << entry.total.draw_calls / n << " / " << entry.max.draw_calls
+            << ", primitives " << entry.total.primitives / n << " / " << entry.max.primitives
+            << ", binds " << entry.total.texture_binds / n << " / " << entry.max.texture_binds
+            << ", targets " << entry.total.target_switches / n << " / " << entry.max.target_switches
+            << ", kpixels " << static_cast<double>(entry.total.pixels) / n / 1000.0 << " / "
+            << static_cast<double>(entry.max.pixels) / 1000.0 << "\n";
+    }
+}
+
+
+void Render_stats::reset()
+{
+    frame = Render_counts();
+    last_frame = Render_counts();
+    states.clear();
+    last_entry = 0;
+}
+
+// =========================================================================================== RENDER STATS
@@ -0,0 +1,164 @@
+// render_stats.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "../platform/platform.h"
+#include "../state_machine/state_machine.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== RENDER CALLS
+
+/**
+ * @brief The draw calls of the engine - the SDL_Render* calls, which are counted.
+ *
+ * Every engine render path draws through these, so Render_stats sees the whole frame.
+ * They return the result of the SDL call. The pixels filled are the areas of the
+ * destination rectangles and the triangles (a clear and a null destination - the
+ * viewport), before the clipping.
+ *
+ * @code
+ * Render::set_target(r, texture);
+ * Render::clear(r);
+ * Render::copy(r, image, nullptr, &dst);
+ * Render::set_target(r, previous);
+ * @endcode
+ */
+namespace Render
+{
+    int clear(SDL_Renderer* r);
+
+    int copy(SDL_Renderer* r, SDL_Texture* texture, const SDL_Rect* src, const SDL_Rect* dst);
+
+    int fill_rect(SDL_Renderer* r, const SDL_Rect* rect);
+
+    int fill_rects(SDL_Renderer* r, const SDL_Rect* rects, int count);
+
+    int geometry(SDL_Renderer* r, SDL_Texture* texture, const SDL_Vertex* vertices, int vertex_count,
+                 const int* indices, int index_count);
+
+    int set_target(SDL_Renderer* r, SDL_Texture* target);
+}
+
+// =========================================================================================== RENDER CALLS
+
+
+// =========================================================================================== RENDER STATS
+
+
+// Render work of one frame
+struct Render_counts
+{
+    // SDL_Render* draw calls (a clear is one)
+    std::uint64_t draw_calls = 0;
+
+    // Triangles of the geometry, rectangles of the copies and the fills
+    std::uint64_t primitives = 0;
+
+    // Draws with another texture than the previous textured draw
+    std::uint64_t texture_binds = 0;
+
+    // Render target changes
+    std::uint64_t target_switches = 0;
+
+    std::uint64_t pixels = 0;
+};
+
+
+/**
+ * @brief Draw calls, primitives, texture binds, render target switches and pixels filled
+ * of every frame, per visible state.
+ *
+ * The Render:: calls count into the frame, end_frame() closes it: the frame is kept for
+ * the debug overlay, summed to the state, which rendered it, and - with the
+ * MIYOO_ZONE_PROFILING build - written as the counters of the zone trace. The shutdown
+ * prints the mean and the max per frame of every state.
+ *
+ * Counting is a few increments a call - always on. Main thread only (the render thread).
+ *
+ * Usage (done by the app cycle):
+ * @code
+ * Render_stats::Instance().end_frame(*sm.get_current_state());
+ *
+ * const Render_counts& last = Render_stats::Instance().get_last_frame();
+ * @endcode
+ */
+class Render_stats
+{
+
+public:
+
+    // Returns the singleton instance.
+    static Render_stats& Instance();
+
+
+    // Counts a draw call (the Render:: calls)
+    void count_draw(SDL_Texture* texture, std::uint32_t primitives, std::uint64_t pixels);
+
+    // Counts a render target change, when the target differs from the current one
+    void count_target(SDL_Texture* target);
+
+
+    /**
+     * @brief Closes the frame of the state (main thread, every cycle).
+     *
+     * The cycles, which didn't render, are not frames of the state.
+     *
+     * @param state Visible state of the frame.
+     */
+    void end_frame(const State& state);
+
+    // Frame in progress
+    const Render_counts& get_frame() const { return frame; }
+
+    // Last frame, which rendered
+    const Render_counts& get_last_frame() const { return last_frame; }
+
+    // Prints the per-state table
+    void dump(std::ostream& out) const;
+
+    void reset();
+
+
+private:
+
+    Render_stats() = default;
+
+    // Singleton - not copyable
+    Render_stats(const Render_stats&) = delete;
+    Render_stats& operator=(const Render_stats&) = delete;
+
+
+    struct State_entry
+    {
+        State_ID id;
+        std::string name;
+
+        std::uint64_t frames = 0;
+
+        // Sums and the per-frame max
+        Render_counts total;
+        Render_counts max;
+    };
+
+
+    Render_counts frame;
+    Render_counts last_frame;
+
+    SDL_Texture* bound_texture = nullptr;
+    SDL_Texture* current_target = nullptr;
+
+    // Visible states in the order of the first frame - a few, the lookup is linear
+    std::vector<State_entry> states;
+    size_t last_entry = 0;
+};
+
+// =========================================================================================== RENDER STATS
@@ -0,0 +1,146 @@
+// render_target_pool.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "render_target_pool.h"
+
+#include <ostream>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== RENDER TARGET POOL
+
+Render_target_pool& Render_target_pool::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Render_target_pool instance;
+    return instance;
+}
+
+
+SDL_Texture* Render_target_pool::acquire(SDL_Renderer* r, int w, int h, Uint32 format)
+{
+    if (!r || w <= 0 || h <= 0) return nullptr;
+
+    // The most recently released match - its memory is the likeliest to be still warm. Not one
+    // released in this frame: the recorded Render_queue commands may still copy from it
+    Target* best = nullptr;
+
+    for (Target& t : targets)
+        if (!t.in_use && t.released_frame != frame && t.renderer == r && t.format == format && t.w == w && t.h == h)
+            if (!best || t.released_frame > best->released_frame) best = &t;
+
+    if (best)
+    {
+        // The state of a new texture - the previous owner may have changed it
+        SDL_SetTextureBlendMode(best->texture, SDL_BLENDMODE_NONE);
+        SDL_SetTextureColorMod(best->texture, 255, 255, 255);
+        SDL_SetTextureAlphaMod(best->texture, 255);
+
+        best->in_use = true;
+        used_bytes += best->bytes;
+        ++reused;
+
+        return best->texture;
+    }
+
+    SDL_Texture* texture = SDL_CreateTexture(r, format, SDL_TEXTUREACCESS_TARGET, w, h);
+
+    if (!texture) return nullptr;
+
+    Target t;
+
+    t.texture = texture;
+    t.renderer = r;
+    t.format = format;
+    t.w = w;
+    t.h = h;
+    t.bytes = static_cast<size_t>(w) * h * SDL_BYTESPERPIXEL(format);
+    t.in_use = true;
+
+    targets.push_back(t);
+
+    live_bytes += t.bytes;
+    used_bytes += t.bytes;
+
+    if (live_bytes > peak_bytes) peak_bytes = live_bytes;
+
+    ++created;
+
+    return texture;
+}
+
+
+void Render_target_pool::release(SDL_Texture* texture)
+{
+    if (!texture) return;
+
+    for (Target& t : targets)
+    {
+        if (t.texture != texture) continue;
+
+        if (t.in_use)
+        {
+            t.in_use = false;
+            t.released_frame = frame;
+            used_bytes -= t.bytes;
+        }
+
+        return;
+    }
+
+    // Not from the pool - the owner gave it up, nobody else will destroy it
+    SDL_DestroyTexture(texture);
+}
+
+
+void Render_target_pool::begin_frame()
+{
+    ++frame;
+
+    for (size_t i = targets.size(); i-- > 0;)
+        if (!targets[i].in_use && frame - targets[i].released_frame > IDLE_FRAMES) destroy(i);
+}
+
+
+int Render_target_pool::clear()
+{
+    int count = 0;
+
+    for (size_t i = targets.size(); i-- > 0;)
+    {
+        if (targets[i].in_use) continue;
+
+        destroy(i);
+        ++count;
+    }
+
+    return count;
+}
+
+
+void Render_target_pool::destroy(size_t index)
+{
+    SDL_DestroyTexture(targets[index].texture);
+
+    live_bytes -= targets[index].bytes;
+    ++destroyed;
+
+    // The order doesn't matter - the last one takes the place
+    targets[index] = targets.back();
+    targets.pop_back();
+}
+
+
+void Render_target_pool::dump(std::ostream& out) const
+{
+    out << "=== Render targets ===\n";
+    out << "Created " << created << ", reused " << reused << ", destroyed " << destroyed << ", pooled now "
+        << targets.size() << "\n";
+    out << "Memory: live " << live_bytes / 1024 << " KB (in use " << used_bytes / 1024 << " KB), peak "
+        << peak_bytes / 1024 << " KB\n";
+}
+
+// =========================================================================================== RENDER TARGET POOL
@@ -0,0 +1,145 @@
+// render_target_pool.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== RENDER TARGET POOL
+
+
+/**
+ * @brief Shared pool of the offscreen SDL_TEXTUREACCESS_TARGET textures.
+ *
+ * The layers, the overlay backdrop, the transition capture, the menu widgets and the shape
+ * cache all draw into the target textures. Created and destroyed on every size change, every
+ * transition and every cache eviction, they cost a driver allocation each time and fragment
+ * the video memory. The owners acquire() the targets here and release() them back instead:
+ * a released target is kept by its size and format, and the next acquire() of the same
+ * size and format gets it - no driver call, only the texture state is reset. A target is
+ * reused from the next frame on: the commands, recorded in the Render_queue this frame,
+ * may still copy from it.
+ *
+ * The released targets, not acquired again for IDLE_FRAMES frames, are destroyed by
+ * begin_frame() - a one-off size doesn't hold its memory forever. clear() destroys the idle
+ * ones now (the background, the shutdown - after the owners released theirs).
+ *
+ * A reused target keeps the old pixels - the owners clear it, as they do after a creation.
+ *
+ * Accounting: the bytes of all pooled targets (in use and idle) and their peak - the video
+ * memory the offscreen passes really needed. Main thread only, like the renderer.
+ *
+ * Usage:
+ * @code
+ * SDL_Texture* target = Render_target_pool::Instance().acquire(r, w, h, SDL_PIXELFORMAT_ARGB8888);
+ *
+ * // ... render into it, copy it out
+ *
+ * Render_target_pool::Instance().release(target);
+ * @endcode
+ */
+class Render_target_pool
+{
+
+public:
+
+    // Released targets older than this are destroyed (~10 s at 60 fps)
+    static constexpr std::uint64_t IDLE_FRAMES = 600;
+
+
+    // Returns the singleton instance.
+    static Render_target_pool& Instance();
+
+
+    /**
+     * @brief Target texture of the size and format - a pooled one, or a new one.
+     *
+     * The texture state is the one of a new texture: no blending, no color and alpha modulation.
+     *
+     * @return nullptr if the creation failed (SDL_GetError() tells why).
+     */
+    SDL_Texture* acquire(SDL_Renderer* r, int w, int h, Uint32 format);
+
+    // Gives the target back for the reuse (nullptr is ignored, a foreign texture is destroyed)
+    void release(SDL_Texture* texture);
+
+    // Next frame - destroys the targets released more than IDLE_FRAMES ago
+    void begin_frame();
+
+    // Destroys the idle targets now, returns their number (the acquired ones stay with the owners)
+    int clear();
+
+
+    // === ACCOUNTING ===
+
+    // Bytes of the pooled targets: all, the acquired ones, the peak of all
+    size_t get_live_bytes() const { return live_bytes; }
+    size_t get_used_bytes() const { return used_bytes; }
+    size_t get_peak_bytes() const { return peak_bytes; }
+
+    // Targets created, served from the pool and destroyed since the start
+    std::uint64_t get_created_count() const { return created; }
+    std::uint64_t get_reused_count() const { return reused; }
+    std::uint64_t get_destroyed_count() const { return destroyed; }
+
+    // Prints the counts and the memory
+    void dump(std::ostream& out) const;
+
+    // === ACCOUNTING ===
+
+
+private:
+
+    // Private constructor for singleton
+    Render_target_pool() = default;
+
+    // Copying the singleton is not allowed
+    Render_target_pool(const Render_target_pool&) = delete;
+    Render_target_pool& operator=(const Render_target_pool&) = delete;
+
+
+    struct Target
+    {
+        SDL_Texture* texture = nullptr;
+        SDL_Renderer* renderer = nullptr;
+
+        Uint32 format = 0;
+        int w = 0;
+        int h = 0;
+
+        size_t bytes = 0;
+
+        // Frame of the release, meaningful only while idle
+        std::uint64_t released_frame = 0;
+
+        bool in_use = false;
+    };
+
+    // Few targets live at once - a linear search is cheaper than a map
+    std::vector<Target> targets;
+
+    // Destroys the target and drops it from the list
+    void destroy(size_t index);
+
+
+    std::uint64_t frame = 0;
+
+    size_t live_bytes = 0;
+    size_t used_bytes = 0;
+    size_t peak_bytes = 0;
+
+    std::uint64_t created = 0;
+    std::uint64_t reused = 0;
+    std::uint64_t destroyed = 0;
+};
+
+// =========================================================================================== RENDER TARGET POOL
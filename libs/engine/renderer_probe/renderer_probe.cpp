@@ -0,0 +1,225 @@
+// renderer_probe.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "renderer_probe.h"
+#include "../platform/backend.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== RENDERER PROBE
+
+int Renderer_probe::select_driver(SDL_Window* window, const char* cache_path)
+{
+    const char* video = SDL_GetCurrentVideoDriver();
+
+    if (!video) video = "none";
+
+    char cached[64];
+
+    if (cache_path && read_cache(cache_path, video, cached, sizeof(cached)))
+    {
+        const int index = find_driver(cached);
+
+        if (index >= 0)
+        {
+            SDL_Log("Renderer probe: %s (cached in %s)", cached, cache_path);
+            return index;
+        }
+
+        SDL_Log("Renderer probe: cached %s is not available - probing again", cached);
+    }
+
+    int best = -1;
+    double best_ms = 0.0;
+
+    const int count = SDL_GetNumRenderDrivers();
+
+    for (int i = 0; i < count; ++i)
+    {
+        SDL_RendererInfo info;
+
+        if (SDL_GetRenderDriverInfo(i, &info) != 0) continue;
+
+        const double ms = bench_driver(window, i);
+
+        if (ms < 0.0)
+        {
+            SDL_Log("Renderer probe: %s can't be created", info.name);
+            continue;
+        }
+
+        SDL_Log("Renderer probe: %s %.3f ms / frame", info.name, ms);
+
+        if (best < 0 || ms < best_ms)
+        {
+            best = i;
+            best_ms = ms;
+        }
+    }
+
+    if (best < 0)
+    {
+        SDL_Log("Renderer probe: no driver measured - SDL chooses");
+        return -1;
+    }
+
+    SDL_RendererInfo info;
+    SDL_GetRenderDriverInfo(best, &info);
+
+    SDL_Log("Renderer probe: %s selected", info.name);
+
+    if (cache_path) write_cache(cache_path, video, info.name);
+
+    return best;
+}
+
+
+double Renderer_probe::bench_driver(SDL_Window* window, int index)
+{
+    // No vsync - the draw cost, not the refresh rate
+    SDL_Renderer* renderer = SDL_CreateRenderer(window, index, 0);
+
+    if (!renderer) return -1.0;
+
+    int w = 0;
+    int h = 0;
+
+    SDL_GetRendererOutputSize(renderer, &w, &h);
+
+    if (w <= 0 || h <= 0)
+    {
+        SDL_DestroyRenderer(renderer);
+        return -1.0;
+    }
+
+    // Sprite of the copies - a blended 32x32 checker, like the glyphs and the cached shapes
+    SDL_Texture* sprite = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, 32, 32);
+
+    if (sprite)
+    {
+        std::vector<Uint32> pixels(32 * 32);
+
+        for (int y = 0; y < 32; ++y)
+            for (int x = 0; x < 32; ++x) pixels[y * 32 + x] = ((x ^ y) & 8) ? 0xFFFFFFFFu : 0x80FF8000u;
+
+        SDL_UpdateTexture(sprite, nullptr, pixels.data(), 32 * sizeof(Uint32));
+        SDL_SetTextureBlendMode(sprite, SDL_BLENDMODE_BLEND);
+    }
+
+    const Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 start = 0;
+
+    for (int frame = 0; frame < WARMUP_FRAMES + BENCH_FRAMES; ++frame)
+    {
+        if (frame == WARMUP_FRAMES) start = SDL_GetPerformanceCounter();
+
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+        SDL_RenderClear(renderer);
+
+        for (int i = 0; i < BENCH_RECTS; ++i)
+        {
+            const SDL_Rect rect = { (i * 37 + frame * 3) % w, (i * 53) % h, 16, 16 };
+
+            SDL_SetRenderDrawColor(renderer, static_cast<Uint8>(i * 7), static_cast<Uint8>(i * 13), 200, 255);
+            SDL_RenderFillRect(renderer, &rect);
+        }
+
+        if (sprite)
+        {
+            for (int i = 0; i < BENCH_COPIES; ++i)
+            {
+                const SDL_Rect rect = { (i * 41 + frame * 5) % w, (i * 29) % h, 32, 32 };
+
+                SDL_RenderCopy(renderer, sprite, nullptr, &rect);
+            }
+        }
+
+        SDL_RenderPresent(renderer);
+    }
+
+    // The GL drivers queue the frames - a read back waits for them
+    Uint32 pixel = 0;
+    const SDL_Rect first = { 0, 0, 1, 1 };
+
+    SDL_RenderReadPixels(renderer, &first, SDL_PIXELFORMAT_ARGB8888, &pixel, sizeof(pixel));
+
+    const double ms = double(SDL_GetPerformanceCounter() - start) * 1000.0 / double(frequency) / BENCH_FRAMES;
+
+    if (sprite) SDL_DestroyTexture(sprite);
+
+    SDL_DestroyRenderer(renderer);
+
+    return ms;
+}
+
+
+int Renderer_probe::find_driver(const char* name)
+{
+    const int count = SDL_GetNumRenderDrivers();
+
+    for (int i = 0; i < count; ++i)
+    {
+        SDL_RendererInfo info;
+
+        if (SDL_GetRenderDriverInfo(i, &info) == 0 && !std::strcmp(info.name, name)) return i;
+    }
+
+    return -1;
+}
+
+
+bool Renderer_probe::read_cache(const char* path, const char* video, char* name, size_t size)
+{
+    std::vector<Uint8> data;
+
+    if (!Platform::Files::read_file(path, data)) return false;
+
+    const std::string text(data.begin(), data.end());
+
+    bool video_match = false;
+    name[0] = 0;
+
+    size_t start = 0;
+
+    while (start < text.size())
+    {
+        size_t end = text.find('\n', start);
+
+        if (end == std::string::npos) end = text.size();
+
+        const std::string line = text.substr(start, end - start);
+
+        start = end + 1;
+
+        char key[32];
+        char value[64];
+
+        if (std::sscanf(line.c_str(), " %31[^= ] = %63s", key, value) != 2) continue;
+
+        if (!std::strcmp(key, "video")) video_match = !std::strcmp(value, video);
+        else if (!std::strcmp(key, "renderer")) std::snprintf(name, size, "%s", value);
+    }
+
+    return video_match && name[0];
+}
+
+
+void Renderer_probe::write_cache(const char* path, const char* video, const char* name)
+{
+    char text[160];
+
+    const int length = std::snprintf(text, sizeof(text), "video = %s\nrenderer = %s\n", video, name);
+
+    if (length <= 0 || !Platform::Files::write_file(path, text, static_cast<size_t>(length)))
+        SDL_Log("Renderer probe: %s can't be written", path);
+}
+
+// =========================================================================================== RENDERER PROBE
@@ -0,0 +1,86 @@
+// renderer_probe.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== RENDERER PROBE
+
+
+/**
+ * @brief Picks the fastest SDL render driver of the device once and remembers it.
+ *
+ * SDL_CreateRenderer(window, -1, ...) takes the first driver, which works - on some
+ * firmwares that is the slow software path next to a working GLES, on others GLES is
+ * slower than the software blits. select_driver() lists the drivers
+ * (SDL_GetRenderDriverInfo), draws a short synthetic frame workload (the filled
+ * rectangles and the texture copies of the states) with each one and keeps the fastest.
+ *
+ * The choice is cached in a small text file with the video driver it was measured on:
+ *
+ *     video = mali
+ *     renderer = opengles2
+ *
+ * The later launches only read it. A missing driver or another video driver probes
+ * again, deleting the file too.
+ *
+ * Example usage:
+ *
+ * const int driver = Renderer_probe::select_driver(window, "renderer.cfg");
+ *
+ * renderer = SDL_CreateRenderer(window, driver, SDL_RENDERER_PRESENTVSYNC);
+ */
+class Renderer_probe
+{
+
+public:
+
+    // Frames drawn by every driver, after the warm up ones
+    static constexpr int BENCH_FRAMES = 30;
+    static constexpr int WARMUP_FRAMES = 3;
+
+    // Filled rectangles and texture copies of a frame
+    static constexpr int BENCH_RECTS = 200;
+    static constexpr int BENCH_COPIES = 200;
+
+
+    /**
+     * @brief Returns the render driver index for SDL_CreateRenderer().
+     *
+     * @param window Window of the renderer - the drivers draw into it.
+     * @param cache_path Cached choice, read and written; nullptr - always probes.
+     * @return Driver index, -1 (the SDL choice) if no driver could be measured.
+     */
+    static int select_driver(SDL_Window* window, const char* cache_path);
+
+
+    /**
+     * @brief Measures one driver with the synthetic workload.
+     *
+     * @param window Window of the renderer.
+     * @param index Driver index.
+     * @return Mean frame time in ms, negative if the renderer can't be created.
+     */
+    static double bench_driver(SDL_Window* window, int index);
+
+
+    // Index of the named driver, -1 if there is none
+    static int find_driver(const char* name);
+
+
+private:
+
+    Renderer_probe() = delete;
+
+    // Cached driver name of this video driver, false if there is no valid cache
+    static bool read_cache(const char* path, const char* video, char* name, size_t size);
+
+    static void write_cache(const char* path, const char* video, const char* name);
+};
+
+// =========================================================================================== RENDERER PROBE
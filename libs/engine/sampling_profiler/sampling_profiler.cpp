@@ -0,0 +1,281 @@
+// sampling_profiler.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "sampling_profiler.h"
+
+#ifdef SAMPLING_PROFILER
+
+#include "../state_machine/state_machine.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <map>
+
+#ifdef PLATFORM_LINUX
+    #include <signal.h>
+    #include <sys/time.h>
+#endif
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== SAMPLING PROFILER
+
+// Zone stack of a thread - written by its scopes, read by the handler interrupting them.
+// Plain thread-local storage of the executable, which the handler can read.
+struct Zone_stack
+{
+    const char* zones[Sampling_profiler::MAX_DEPTH];
+
+    // Scopes open, the deeper than MAX_DEPTH aren't stored
+    volatile sig_atomic_t depth;
+
+    const char* thread;
+};
+
+static thread_local Zone_stack zone_stack;
+
+// Profiler of the handler - set before the timer is armed, no static guard in the handler
+static Sampling_profiler* active = nullptr;
+
+#ifdef PLATFORM_LINUX
+// Handler of SIGPROF before start() - restored by stop()
+static struct sigaction previous_action;
+#endif
+
+
+Sampling_profiler& Sampling_profiler::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Sampling_profiler instance;
+    return instance;
+}
+
+
+void Sampling_profiler::push(const char* name)
+{
+    const sig_atomic_t depth = zone_stack.depth;
+
+    if (depth < MAX_DEPTH) zone_stack.zones[depth] = name;
+
+    // The name is in place before the handler of this thread can see the depth
+    std::atomic_signal_fence(std::memory_order_release);
+
+    zone_stack.depth = depth + 1;
+}
+
+
+void Sampling_profiler::pop()
+{
+    const sig_atomic_t depth = zone_stack.depth;
+
+    if (depth > 0) zone_stack.depth = depth - 1;
+}
+
+
+void Sampling_profiler::set_thread_name(const char* name) { zone_stack.thread = name; }
+
+
+void Sampling_profiler::on_signal(int)
+{
+    const int saved_errno = errno;
+
+    Sampling_profiler* profiler = active;
+
+    if (!profiler) return;
+
+    profiler->in_handler.fetch_add(1, std::memory_order_acq_rel);
+
+    if (profiler->running.load(std::memory_order_acquire))
+    {
+        const std::uint32_t index = profiler->claimed.fetch_add(1, std::memory_order_relaxed);
+
+        if (index < profiler->samples.size())
+        {
+            Sample& sample = profiler->samples[index];
+
+            std::atomic_signal_fence(std::memory_order_acquire);
+
+            const sig_atomic_t open = zone_stack.depth;
+            const int depth = open < MAX_DEPTH ? static_cast<int>(open) : MAX_DEPTH;
+
+            sample.state = profiler->current_state.load(std::memory_order_relaxed);
+            sample.thread = zone_stack.thread;
+            sample.depth = depth;
+
+            for (int i = 0; i < depth; ++i) sample.zones[i] = zone_stack.zones[i];
+        }
+        else profiler->dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    profiler->in_handler.fetch_sub(1, std::memory_order_release);
+
+    errno = saved_errno;
+}
+
+
+bool Sampling_profiler::start(const char* path, int hz, std::uint32_t capacity)
+{
+#ifdef PLATFORM_LINUX
+    if (running.load() || !path || hz <= 0 || capacity == 0) return false;
+
+    // Allocated here - the handler only fills the slots
+    samples.assign(capacity, Sample{});
+
+    claimed.store(0);
+    dropped.store(0);
+    output_path = path;
+    active = this;
+
+    struct sigaction action = {};
+    action.sa_handler = on_signal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    if (sigaction(SIGPROF, &action, &previous_action) != 0)
+    {
+        SDL_Log("Sampling profiler: SIGPROF handler can't be installed (errno %d)", errno);
+        return false;
+    }
+
+    running.store(true, std::memory_order_release);
+
+    const long period_us = std::max(1L, 1000000L / hz);
+
+    struct itimerval timer = {};
+    timer.it_interval.tv_sec = period_us / 1000000;
+    timer.it_interval.tv_usec = period_us % 1000000;
+    timer.it_value = timer.it_interval;
+
+    if (setitimer(ITIMER_PROF, &timer, nullptr) != 0)
+    {
+        SDL_Log("Sampling profiler: ITIMER_PROF can't be armed (errno %d)", errno);
+
+        running.store(false, std::memory_order_release);
+        sigaction(SIGPROF, &previous_action, nullptr);
+        return false;
+    }
+
+    SDL_Log("Sampling profiler: %d Hz, %u samples at most -> %s", hz, capacity, path);
+
+    return true;
+#else
+    (void)path;
+    (void)hz;
+    (void)capacity;
+
+    SDL_Log("Sampling profiler: no SIGPROF on this platform");
+    return false;
+#endif
+}
+
+
+bool Sampling_profiler::stop()
+{
+#ifdef PLATFORM_LINUX
+    if (!running.load()) return false;
+
+    struct itimerval timer = {};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+
+    running.store(false, std::memory_order_release);
+
+    // A handler can still be filling its slot on another thread
+    while (in_handler.load(std::memory_order_acquire) > 0) SDL_Delay(1);
+
+    sigaction(SIGPROF, &previous_action, nullptr);
+
+    return write(output_path.c_str());
+#else
+    return false;
+#endif
+}
+
+
+std::uint32_t Sampling_profiler::get_sample_count() const
+{
+    return std::min<std::uint32_t>(claimed.load(std::memory_order_relaxed), static_cast<std::uint32_t>(samples.size()));
+}
+
+
+void Sampling_profiler::set_state(const State& state)
+{
+    const std::uint64_t raw = state.id.raw();
+
+    if (raw == current_state.load(std::memory_order_relaxed)) return;
+
+    if (!find_state_name(raw) && state_name_count < MAX_STATES)
+    {
+        State_name& entry = state_names[state_name_count++];
+
+        entry.state = raw;
+        std::snprintf(entry.name, sizeof(entry.name), "%s (%s)", state.name.c_str(), state.label);
+    }
+
+    current_state.store(raw, std::memory_order_relaxed);
+}
+
+
+const char* Sampling_profiler::find_state_name(std::uint64_t state) const
+{
+    for (int i = 0; i < state_name_count; ++i)
+        if (state_names[i].state == state) return state_names[i].name;
+
+    return nullptr;
+}
+
+
+bool Sampling_profiler::write(const char* path) const
+{
+    // One line per distinct stack - ordered, the files of two runs diff
+    std::map<std::string, std::uint32_t> stacks;
+
+    const std::uint32_t count = get_sample_count();
+
+    std::string key;
+
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        const Sample& sample = samples[i];
+        const char* state = find_state_name(sample.state);
+
+        key = state ? state : "no state";
+        key += ';';
+        key += sample.thread ? sample.thread : "thread";
+
+        for (int z = 0; z < sample.depth; ++z)
+        {
+            key += ';';
+
+            // ';' separates the frames of the format
+            for (const char* c = sample.zones[z]; *c; ++c) key += *c == ';' ? ':' : *c;
+        }
+
+        ++stacks[key];
+    }
+
+    std::FILE* file = std::fopen(path, "wb");
+
+    if (!file)
+    {
+        SDL_Log("Sampling profiler: %s can't be written", path);
+        return false;
+    }
+
+    for (const auto& stack : stacks) std::fprintf(file, "%s %u\n", stack.first.c_str(), stack.second);
+
+    const bool ok = std::fclose(file) == 0;
+
+    SDL_Log("Sampling profiler: %u samples (%u dropped, full buffer), %zu stacks -> %s", count, get_dropped_count(),
+            stacks.size(), path);
+
+    return ok;
+}
+
+// =========================================================================================== SAMPLING PROFILER
+
+#endif
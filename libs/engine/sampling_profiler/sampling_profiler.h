@@ -0,0 +1,189 @@
+// sampling_profiler.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../platform/platform.h"
+
+class State;
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== SAMPLING PROFILER
+
+// Optional on-device sampling profiler, enabled by the SAMPLING_PROFILER define (CMake
+// option MIYOO_SAMPLING_PROFILER). Without it the macros are empty and nothing below is
+// compiled. With it the profiler is idle until start() - the cost of the idle build is
+// the zone stack push and pop of PROFILE_ZONE, so it can stay in the test images.
+
+#ifdef SAMPLING_PROFILER
+
+#define SAMPLING_PROFILER_CONCAT_INNER(a, b) a##b
+#define SAMPLING_PROFILER_CONCAT(a, b) SAMPLING_PROFILER_CONCAT_INNER(a, b)
+
+// Zone of the rest of the scope in the samples - a string literal (the pointer is stored)
+#define SAMPLE_ZONE(name) Sample_scope SAMPLING_PROFILER_CONCAT(sample_scope_, __LINE__)(name)
+
+// Thread name in the samples - a string literal too
+#define SAMPLE_THREAD(name) Sampling_profiler::set_thread_name(name)
+
+
+/**
+ * @brief SIGPROF sampler of the zone stacks and the running state, written as the
+ * collapsed stacks of a flame graph.
+ *
+ * The firmware has no perf - the profiler samples itself: setitimer(ITIMER_PROF) raises
+ * SIGPROF every 1 / hz seconds of the CPU time of the process, the handler runs on the
+ * thread, which was on the CPU, and copies its zone stack (the PROFILE_ZONE scopes of
+ * the thread) and the ID of the running state into a preallocated sample. The time
+ * waiting for the vsync or sleeping is not sampled - the samples are where the CPU goes.
+ *
+ * The handler only reads the thread-local stack and writes its sample slot - no lock,
+ * no allocation, no system call. A full buffer drops the further samples (counted).
+ * stop() disarms the timer and aggregates the samples into lines of the collapsed
+ * format (flamegraph.pl, speedscope, Perfetto):
+ *
+ *     Gameplay (1.1);main;update;physics 412
+ *
+ * The states are named by their name and label (set_state() copies them, the states
+ * may be gone by the write).
+ *
+ * Usage:
+ * @code
+ * Sampling_profiler::Instance().start("profile.folded", 250, 16384);
+ *
+ * // Every frame
+ * Sampling_profiler::Instance().set_state(*app_sm.get_current_state());
+ *
+ * Sampling_profiler::Instance().stop();  // flamegraph.pl profile.folded > profile.svg
+ * @endcode
+ */
+class Sampling_profiler
+{
+
+public:
+
+    // Zones of a sample, the deeper ones are cut
+    static constexpr int MAX_DEPTH = 16;
+
+    // Distinct states named in the output
+    static constexpr int MAX_STATES = 64;
+
+    // Returns the singleton instance.
+    static Sampling_profiler& Instance();
+
+
+    /**
+     * @brief Allocates the sample buffer and arms the timer.
+     *
+     * @param path     Output file of the collapsed stacks, written by stop().
+     * @param hz       Samples per second of the CPU time.
+     * @param capacity Samples kept, the later ones are dropped.
+     * @return false if the timer can't be armed (or the platform has no SIGPROF).
+     */
+    bool start(const char* path, int hz, std::uint32_t capacity);
+
+    /**
+     * @brief Disarms the timer and writes the collapsed stacks.
+     *
+     * @return false if it didn't run or the file can't be written.
+     */
+    bool stop();
+
+    bool is_running() const { return running.load(std::memory_order_relaxed); }
+
+    // State of the following samples (main thread, every frame)
+    void set_state(const State& state);
+
+    std::uint32_t get_sample_count() const;
+    std::uint32_t get_dropped_count() const { return dropped.load(std::memory_order_relaxed); }
+
+
+    // Zone stack of the calling thread (the Sample_scope)
+    static void push(const char* name);
+    static void pop();
+
+    // Thread name in the samples, "thread" without it
+    static void set_thread_name(const char* name);
+
+
+private:
+
+    Sampling_profiler() = default;
+
+    // Singleton - not copyable
+    Sampling_profiler(const Sampling_profiler&) = delete;
+    Sampling_profiler& operator=(const Sampling_profiler&) = delete;
+
+
+    struct Sample
+    {
+        std::uint64_t state;
+        const char* thread;
+        int depth;
+        const char* zones[MAX_DEPTH];
+    };
+
+    // Name of a state, copied by set_state()
+    struct State_name
+    {
+        std::uint64_t state;
+        char name[64];
+    };
+
+
+    static void on_signal(int signal);
+
+    // Samples aggregated into the collapsed stack lines
+    bool write(const char* path) const;
+
+    const char* find_state_name(std::uint64_t state) const;
+
+
+    std::vector<Sample> samples;
+
+    // Slots taken by the handler (over the capacity - dropped) and the handlers running
+    std::atomic<std::uint32_t> claimed{0};
+    std::atomic<std::uint32_t> dropped{0};
+    std::atomic<int> in_handler{0};
+
+    std::atomic<bool> running{false};
+
+    // Raw State_ID of the running state
+    std::atomic<std::uint64_t> current_state{0};
+
+    State_name state_names[MAX_STATES];
+    int state_name_count = 0;
+
+    std::string output_path;
+};
+
+
+// Push on the construction, pop on the destruction
+class Sample_scope
+{
+
+public:
+
+    explicit Sample_scope(const char* zone) { Sampling_profiler::push(zone); }
+    ~Sample_scope() { Sampling_profiler::pop(); }
+
+    Sample_scope(const Sample_scope&) = delete;
+    Sample_scope& operator=(const Sample_scope&) = delete;
+};
+
+#else
+
+#define SAMPLE_ZONE(name) ((void)0)
+#define SAMPLE_THREAD(name) ((void)0)
+
+#endif
+
+// =========================================================================================== SAMPLING PROFILER
@@ -0,0 +1,229 @@
+// save_system.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "save_system.h"
+#include "../platform/backend.h"
+#include "../engine_clock/engine_clock.h"
+#include "../zone_profiler/zone_profiler.h"
+#include "../thread_roles/thread_roles.h"
+
+#include <cstring>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== SAVE SYSTEM
+
+Save_system& Save_system::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Save_system instance;
+    return instance;
+}
+
+
+bool Save_system::start()
+{
+    if (writer) return true;
+
+    wake = SDL_CreateSemaphore(0);
+
+    if (!wake)
+    {
+        SDL_Log("Save system: semaphore creation failed: %s", SDL_GetError());
+        return false;
+    }
+
+    running.store(true, std::memory_order_release);
+
+    writer = SDL_CreateThread(writer_main, "save_writer", this);
+
+    if (!writer)
+    {
+        SDL_Log("Save system: writer thread can't be created: %s", SDL_GetError());
+
+        running.store(false);
+        SDL_DestroySemaphore(wake);
+        wake = nullptr;
+
+        return false;
+    }
+
+    return true;
+}
+
+
+void Save_system::stop()
+{
+    if (!writer) return;
+
+    // The writer drains the queued saves before it ends
+    running.store(false, std::memory_order_release);
+    SDL_SemPost(wake);
+
+    SDL_WaitThread(writer, nullptr);
+    writer = nullptr;
+
+    SDL_DestroySemaphore(wake);
+    wake = nullptr;
+}
+
+
+bool Save_system::load(const char* path, std::vector<std::uint8_t>& out)
+{
+    if (!writer || !Platform::Files::read_file(path, out)) return false;
+
+    std::lock_guard<std::mutex> guard(lock);
+
+    // A queued save is newer than the file - it stays the last one
+    if (File* file = find_file(path, true); file && !file->dirty)
+    {
+        file->contents = out;
+        file->stale = false;
+    }
+
+    return true;
+}
+
+
+Save_system::Result Save_system::save(const char* path, std::vector<std::uint8_t>& data)
+{
+    if (!writer)
+    {
+        failed.fetch_add(1, std::memory_order_relaxed);
+        return Result::FAILED;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        File* file = find_file(path, true);
+
+        if (!file)
+        {
+            SDL_Log("Save system: more than %d save files, %s isn't saved", MAX_FILES, path);
+            failed.fetch_add(1, std::memory_order_relaxed);
+            return Result::FAILED;
+        }
+
+        if (!file->stale && file->contents.size() == data.size()
+            && (data.empty() || std::memcmp(file->contents.data(), data.data(), data.size()) == 0))
+        {
+            skipped.fetch_add(1, std::memory_order_relaxed);
+            return Result::UNCHANGED;
+        }
+
+        // A waiting save of the file is replaced - only the newest is written
+        file->contents.swap(data);
+        file->dirty = true;
+        file->stale = false;
+    }
+
+    SDL_SemPost(wake);
+
+    return Result::QUEUED;
+}
+
+
+void Save_system::flush()
+{
+    while (is_busy()) SDL_Delay(1);
+}
+
+
+bool Save_system::is_busy() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (writing > 0) return true;
+
+    for (int i = 0; i < file_count; ++i)
+        if (files[i].dirty) return true;
+
+    return false;
+}
+
+
+Save_system::File* Save_system::find_file(const char* path, bool create)
+{
+    for (int i = 0; i < file_count; ++i)
+        if (files[i].path == path) return &files[i];
+
+    if (!create || file_count == MAX_FILES) return nullptr;
+
+    File& file = files[file_count++];
+    file.path = path;
+
+    return &file;
+}
+
+
+int SDLCALL Save_system::writer_main(void* self)
+{
+    PROFILE_THREAD("save_writer");
+
+    static_cast<Save_system*>(self)->write_loop();
+    return 0;
+}
+
+
+void Save_system::write_loop()
+{
+    // The game threads come first - the save can wait
+    if (!Thread_roles::Instance().apply(Thread_role::IO)) SDL_SetThreadPriority(SDL_THREAD_PRIORITY_LOW);
+
+    std::string path;
+
+    for (;;)
+    {
+        // Read before the drain - the saves queued before stop() are all written
+        const bool stopping = !running.load(std::memory_order_acquire);
+
+        File* file = nullptr;
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+
+            for (int i = 0; i < file_count && !file; ++i)
+                if (files[i].dirty) file = &files[i];
+
+            if (file)
+            {
+                write_buffer = file->contents;
+                path = file->path;
+
+                file->dirty = false;
+                ++writing;
+            }
+        }
+
+        if (!file)
+        {
+            if (stopping) break;
+
+            SDL_SemWait(wake);
+            continue;
+        }
+
+        const Uint64 start = Engine_clock::now();
+
+        const bool ok = Platform::Files::write_file_atomic(path.c_str(), write_buffer.data(), write_buffer.size());
+
+        last_write_us.store(Engine_clock::to_us(Engine_clock::now() - start), std::memory_order_relaxed);
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+
+            // The card has the old contents - the same save again must not be skipped
+            if (!ok && !file->dirty) file->stale = true;
+
+            --writing;
+        }
+
+        (ok ? written : failed).fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// =========================================================================================== SAVE SYSTEM
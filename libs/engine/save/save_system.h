@@ -0,0 +1,162 @@
+// save_system.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== SAVE SYSTEM
+
+
+/**
+ * @brief Save files written by a background thread, atomically.
+ *
+ * The game thread serializes its state into a buffer and hands it over - a compare and a
+ * swap, no file call. The writer thread writes it with Platform::Files::write_file_atomic():
+ * a temp file, the flush to the card, the rename over the save. The SD card flush takes
+ * tens of milliseconds, the frame doesn't wait for it, and a power loss keeps either the
+ * old save or the new one.
+ *
+ * A save equal to the last one of the file (or to the loaded one) is skipped - no write,
+ * no card wear. A save queued while the previous one of the same file is still waiting
+ * replaces it: only the newest contents are written.
+ *
+ * Usage:
+ * @code
+ * // on_enter
+ * if (Save_system::Instance().load("save.dat", bytes)) restore(world, bytes);
+ *
+ * // pause, on_exit
+ * serialize(world, bytes);
+ * Save_system::Instance().save("save.dat", bytes);   // bytes get an old buffer back
+ * @endcode
+ */
+class Save_system
+{
+
+public:
+
+    // Save files in use at the same time
+    static constexpr int MAX_FILES = 8;
+
+    enum class Result
+    {
+        QUEUED,         // The writer thread writes it
+        UNCHANGED,      // Same as the last save of the file - skipped
+        FAILED          // No free file slot or no writer
+    };
+
+
+    // Returns the singleton instance.
+    static Save_system& Instance();
+
+
+    // Starts the writer thread - false if it can't be created (the saves fail then)
+    bool start();
+
+    // Writes the queued saves, then stops the thread
+    void stop();
+
+    bool is_running() const { return writer != nullptr; }
+
+
+    /**
+     * @brief Reads the save, the contents become the last save of the file.
+     *
+     * Blocks on the file read - the state entry, not the frame.
+     *
+     * @return false if there is no such file or the system isn't started.
+     */
+    bool load(const char* path, std::vector<std::uint8_t>& out);
+
+    /**
+     * @brief Queues the contents of the file.
+     *
+     * @param path File - the first MAX_FILES different paths get a slot.
+     * @param data Serialized state, taken by a swap: it holds an older buffer after the call
+     *             (the capacity is reused by the next serialization).
+     */
+    Result save(const char* path, std::vector<std::uint8_t>& data);
+
+    // Blocks until every queued save is written (the scene change before a quit)
+    void flush();
+
+    // A save is queued or being written
+    bool is_busy() const;
+
+
+    // === STATS ===
+
+    std::uint64_t get_written_count() const { return written.load(std::memory_order_relaxed); }
+    std::uint64_t get_skipped_count() const { return skipped.load(std::memory_order_relaxed); }
+    std::uint64_t get_failed_count() const { return failed.load(std::memory_order_relaxed); }
+
+    // Duration of the last write with its flush and rename, in microseconds
+    std::uint64_t get_last_write_us() const { return last_write_us.load(std::memory_order_relaxed); }
+
+    // === STATS ===
+
+
+private:
+
+    Save_system() = default;
+
+    // Singleton - not copyable
+    Save_system(const Save_system&) = delete;
+    Save_system& operator=(const Save_system&) = delete;
+
+
+    struct File
+    {
+        std::string path;
+
+        // Newest contents - queued, being written or already on the card
+        std::vector<std::uint8_t> contents;
+
+        // contents waits for the writer
+        bool dirty = false;
+
+        // The last write failed - the next save is written even if it's the same
+        bool stale = false;
+    };
+
+    // Slot of the path, a new one if there is none - nullptr if all are used (locked)
+    File* find_file(const char* path, bool create);
+
+    static int SDLCALL writer_main(void* self);
+    void write_loop();
+
+
+    // Guards the files - the game thread holds it for a compare and a swap only
+    mutable std::mutex lock;
+
+    File files[MAX_FILES];
+    int file_count = 0;
+
+    // Saves taken by the writer and not written yet
+    int writing = 0;
+
+    // Writer's copy of the contents - the file IO runs without the lock
+    std::vector<std::uint8_t> write_buffer;
+
+    SDL_Thread* writer = nullptr;
+    SDL_sem* wake = nullptr;
+    std::atomic<bool> running{false};
+
+    std::atomic<std::uint64_t> written{0};
+    std::atomic<std::uint64_t> skipped{0};
+    std::atomic<std::uint64_t> failed{0};
+    std::atomic<std::uint64_t> last_write_us{0};
+};
+
+// =========================================================================================== SAVE SYSTEM
@@ -0,0 +1,224 @@
+// state_script.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "state_script.h"
+
+#ifdef STATE_SCRIPTS
+
+#include <algorithm>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== SCRIPT
+
+void* Script::promise_type::operator new(size_t size) { return Script_runner::Instance().allocate_frame(size); }
+
+void Script::promise_type::operator delete(void* p, size_t size) { Script_runner::Instance().free_frame(p, size); }
+
+// =========================================================================================== SCRIPT
+
+
+// =========================================================================================== SCRIPT RUNNER
+
+Script_runner& Script_runner::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Script_runner instance;
+    return instance;
+}
+
+
+Script_id Script_runner::start(Script script, const State_ID& owner)
+{
+    Script::Handle handle = script.release();
+
+    if (!handle) return 0;
+
+    int slot;
+
+    if (!free_slots.empty())
+    {
+        slot = free_slots.back();
+        free_slots.pop_back();
+    }
+    else
+    {
+        if (static_cast<int>(slots.size()) >= MAX_SCRIPTS)
+        {
+            SDL_Log("Script_runner: too many scripts, the script is dropped");
+            handle.destroy();
+            return 0;
+        }
+
+        slot = static_cast<int>(slots.size());
+        slots.emplace_back();
+    }
+
+    slots[slot].handle = handle;
+    slots[slot].owner = owner;
+    handle.promise().slot = slot;
+
+    ++running;
+
+    const Script_id id = make_id(slot);
+
+    resume(slot);
+
+    return is_running(id) ? id : 0;
+}
+
+
+void Script_runner::stop(Script_id id)
+{
+    const int slot = find_slot(id);
+
+    if (slot >= 0) release(slot);
+}
+
+
+void Script_runner::stop_owner(const State_ID& owner)
+{
+    if (owner == State_ID{}) return;
+
+    for (int i = 0; i < static_cast<int>(slots.size()); ++i)
+        if (slots[i].handle && !slots[i].stop_pending && slots[i].owner == owner) release(i);
+}
+
+
+void Script_runner::clear()
+{
+    for (int i = 0; i < static_cast<int>(slots.size()); ++i)
+        if (slots[i].handle && !slots[i].stop_pending) release(i);
+
+    tick_waits.clear();
+    time_waits.clear();
+    audio_waits.clear();
+}
+
+
+bool Script_runner::is_running(Script_id id) const { return find_slot(id) >= 0; }
+
+
+int Script_runner::find_slot(Script_id id) const
+{
+    const int slot = static_cast<int>(id & 0xFFFu) - 1;
+
+    if (slot < 0 || slot >= static_cast<int>(slots.size())) return -1;
+
+    // Stopped inside its own resume - gone for the caller already
+    if (!slots[slot].handle || slots[slot].stop_pending || make_id(slot) != id) return -1;
+
+    return slot;
+}
+
+
+void Script_runner::update(float dt)
+{
+    ++tick;
+    time += dt;
+
+    resumed = 0;
+
+    // Collected first - the resumed scripts queue their next waits meanwhile
+    due.clear();
+
+    while (!tick_waits.empty() && tick_waits.front().tick <= tick)
+    {
+        std::pop_heap(tick_waits.begin(), tick_waits.end(), later_tick);
+        due.push_back(tick_waits.back());
+        tick_waits.pop_back();
+    }
+
+    while (!time_waits.empty() && time_waits.front().time <= time)
+    {
+        std::pop_heap(time_waits.begin(), time_waits.end(), later_time);
+        due.push_back(time_waits.back());
+        time_waits.pop_back();
+    }
+
+    const std::uint64_t heard = Audio_timeline::Instance().get_frames();
+
+    while (!audio_waits.empty() && audio_waits.front().tick <= heard)
+    {
+        std::pop_heap(audio_waits.begin(), audio_waits.end(), later_tick);
+        due.push_back(audio_waits.back());
+        audio_waits.pop_back();
+    }
+
+    for (const Wake& wake : due)
+    {
+        // Stopped since it was queued
+        if (!slots[wake.slot].handle || slots[wake.slot].stop_pending || slots[wake.slot].generation != wake.generation)
+            continue;
+
+        resume(wake.slot);
+        ++resumed;
+    }
+}
+
+
+void Script_runner::wait_ticks(int slot, int ticks)
+{
+    tick_waits.push_back({tick + static_cast<std::uint64_t>(std::max(ticks, 1)), 0.0, slot, slots[slot].generation});
+    std::push_heap(tick_waits.begin(), tick_waits.end(), later_tick);
+}
+
+
+void Script_runner::wait_seconds(int slot, float seconds)
+{
+    time_waits.push_back({0, time + std::max(seconds, 0.0f), slot, slots[slot].generation});
+    std::push_heap(time_waits.begin(), time_waits.end(), later_time);
+}
+
+
+void Script_runner::wait_audio(int slot, std::uint64_t frame)
+{
+    audio_waits.push_back({frame, 0.0, slot, slots[slot].generation});
+    std::push_heap(audio_waits.begin(), audio_waits.end(), later_tick);
+}
+
+
+void Script_runner::resume(int slot)
+{
+    // Copied - a script started meanwhile can grow the slots
+    const Script::Handle handle = slots[slot].handle;
+
+    slots[slot].resuming = true;
+
+    handle.resume();
+
+    slots[slot].resuming = false;
+
+    // Suspended again (or at its end) - safe to destroy now
+    if (slots[slot].stop_pending || handle.done()) release(slot);
+}
+
+
+void Script_runner::release(int slot)
+{
+    Slot& s = slots[slot];
+
+    // Stopped from inside of its own resume (its state exits from it) - destroyed once it suspends
+    if (s.resuming)
+    {
+        s.stop_pending = true;
+        return;
+    }
+
+    s.handle.destroy();
+    s.handle = nullptr;
+    s.owner = State_ID{};
+    s.stop_pending = false;
+    ++s.generation;
+
+    free_slots.push_back(slot);
+
+    --running;
+}
+
+// =========================================================================================== SCRIPT RUNNER
+
+#endif
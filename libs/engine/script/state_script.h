@@ -0,0 +1,341 @@
+// state_script.h
+
+#pragma once
+
+// Coroutine scripts of the states, enabled by the STATE_SCRIPTS define (CMake option
+// MIYOO_STATE_SCRIPTS, which builds the game with C++20). Without it the header is empty.
+
+#ifdef STATE_SCRIPTS
+
+#if !defined(__cpp_impl_coroutine) || !__has_include(<coroutine>)
+    #error "STATE_SCRIPTS needs the C++20 coroutines - configure with MIYOO_STATE_SCRIPTS"
+#endif
+
+// =========================================================================================== IMPORT
+
+#include <algorithm>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <vector>
+
+#include "../state_machine/state_machine.h"
+#include "../memory/allocator.h"
+#include "../audio/audio_timeline.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== SCRIPT
+
+
+/**
+ * @brief Coroutine of a multi-frame sequence - the intro, a fade, a tutorial step.
+ *
+ * A function returning Script is a coroutine: it runs until a co_await of next_frame(),
+ * ticks() or seconds() (or the music time - audio_seconds(), beats()), and the Script_runner continues it there on the tick it waits
+ * for. The sequence reads top to bottom, no timer fields and no step switch inside
+ * state_update.
+ *
+ * The coroutine frame comes from the pool of the runner - no heap per started script.
+ * Created suspended, it does nothing until Script_runner::start(). Not copyable, a
+ * Script which is never started destroys its frame.
+ */
+class Script
+{
+
+public:
+
+    struct promise_type
+    {
+        // Slot of the runner - the awaiters schedule it
+        int slot = -1;
+
+        static void* operator new(size_t size);
+        static void operator delete(void* p, size_t size);
+
+        Script get_return_object() { return Script(std::coroutine_handle<promise_type>::from_promise(*this)); }
+
+        // Runs from start(), the runner destroys the finished frame
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+
+        void return_void() {}
+
+        // The engine doesn't use the exceptions
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    using Handle = std::coroutine_handle<promise_type>;
+
+
+    Script(Script&& other) noexcept : handle(other.handle) { other.handle = nullptr; }
+
+    Script& operator=(Script&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (handle) handle.destroy();
+
+            handle = other.handle;
+            other.handle = nullptr;
+        }
+
+        return *this;
+    }
+
+    ~Script() { if (handle) handle.destroy(); }
+
+    Script(const Script&) = delete;
+    Script& operator=(const Script&) = delete;
+
+    // Gives the frame to the runner
+    Handle release()
+    {
+        Handle h = handle;
+        handle = nullptr;
+        return h;
+    }
+
+private:
+
+    explicit Script(Handle h) : handle(h) {}
+
+    Handle handle;
+};
+
+// =========================================================================================== SCRIPT
+
+
+// =========================================================================================== SCRIPT RUNNER
+
+// Handle of a started script, 0 - none
+using Script_id = std::uint32_t;
+
+
+/**
+ * @brief Resumes the waiting scripts of the states, once per update tick.
+ *
+ * The waiting scripts are three min-heaps, by the wake tick, the wake time and the
+ * Audio_timeline frame -
+ * update() resumes only the due ones, the sleeping scripts cost nothing per tick and
+ * no state polls its timers. The frames live in a Pool_allocator.
+ *
+ * A script started with the ID of a state is stopped (its frame destroyed), when the
+ * state exits - the script can use the state data without checking that it's alive.
+ *
+ * Singleton, updated by the engine after every state_update tick (Engine_clock
+ * tick_dt), on the update thread - start and stop the scripts there too.
+ *
+ * Usage:
+ * @code
+ * static Script intro(Intro_state* s)
+ * {
+ *     s->logo_alpha = 0.0f;
+ *     Tween_system::Instance().start(&s->logo_alpha, 0.0f, 1.0f, 0.5f);
+ *
+ *     co_await seconds(2.0f);
+ *
+ *     s->show_prompt = true;
+ *
+ *     while (!Input::Instance().get_snapshot().is_pressed(A_BTN)) co_await next_frame();
+ *
+ *     s->sm->go_to(MENU_ID);          // exits the intro - the script is destroyed here
+ * }
+ *
+ * void Intro_state::on_enter() { Script_runner::Instance().start(intro(this), INTRO_ID); }
+ * @endcode
+ */
+class Script_runner
+{
+
+public:
+
+    // Frame pool blocks - the larger frames come from the heap
+    static constexpr size_t FRAME_BLOCK = 256;
+    static constexpr size_t FRAMES_PER_SLAB = 32;
+
+    // Scripts alive at the same time - the slot bits of the Script_id
+    static constexpr int MAX_SCRIPTS = 4095;
+
+
+    // Returns the singleton instance.
+    static Script_runner& Instance();
+
+
+    /**
+     * @brief Runs the script until its first co_await.
+     *
+     * @param script Script to run, the runner owns it from now.
+     * @param owner  State, which exit stops the script (empty - runs until its end).
+     * @return Handle, 0 if the script ended right away.
+     */
+    Script_id start(Script script, const State_ID& owner = {});
+
+    // Destroys the script where it waits, stale handles are ignored
+    void stop(Script_id id);
+
+    // Stops the scripts of the state (the State_machine, on its exit)
+    void stop_owner(const State_ID& owner);
+
+    // Stops everything
+    void clear();
+
+    bool is_running(Script_id id) const;
+
+
+    // Advances the script time by dt seconds and resumes the due scripts (the engine, once per tick)
+    void update(float dt);
+
+
+    // === AWAITERS ===
+
+    // The next update() - the awaiters, called from the suspended script
+    void wait_ticks(int slot, int ticks);
+    void wait_seconds(int slot, float seconds);
+    void wait_audio(int slot, std::uint64_t frame);
+
+    // === AWAITERS ===
+
+
+    // === STATS ===
+
+    int get_running() const { return running; }
+
+    // Resumes of the last update()
+    int get_resumed() const { return resumed; }
+
+    const Pool_allocator& get_frame_pool() const { return frame_pool; }
+
+    // === STATS ===
+
+
+    // Coroutine frames - Script::promise_type
+    void* allocate_frame(size_t size) { return frame_pool.allocate(size); }
+    void free_frame(void* p, size_t size) { frame_pool.deallocate(p, size); }
+
+
+private:
+
+    Script_runner() : frame_pool(FRAME_BLOCK, FRAMES_PER_SLAB) {}
+
+    // Singleton - not copyable
+    Script_runner(const Script_runner&) = delete;
+    Script_runner& operator=(const Script_runner&) = delete;
+
+
+    struct Slot
+    {
+        Script::Handle handle;
+        State_ID owner;
+
+        // Bumped on every release - the queued wakes of the old script are stale
+        std::uint32_t generation = 1;
+
+        // Inside its resume() - a stop is deferred until it suspends
+        bool resuming = false;
+        bool stop_pending = false;
+    };
+
+    // Queued resume of a slot
+    struct Wake
+    {
+        std::uint64_t tick;
+        double time;
+        int slot;
+        std::uint32_t generation;
+    };
+
+    // std heap functions build a max-heap - the later wake sinks
+    static bool later_tick(const Wake& a, const Wake& b) { return a.tick > b.tick; }
+    static bool later_time(const Wake& a, const Wake& b) { return a.time > b.time; }
+
+    // Generation above the slot bits
+    Script_id make_id(int slot) const { return (slots[slot].generation << 12) | static_cast<Script_id>(slot + 1); }
+
+    // Slot of a live script, -1 - stale or invalid
+    int find_slot(Script_id id) const;
+
+    // Continues the script, destroys it at its end
+    void resume(int slot);
+
+    void release(int slot);
+
+
+    Pool_allocator frame_pool;
+
+    std::vector<Slot> slots;
+    std::vector<int> free_slots;
+
+    // Min-heaps - the tick waits by their tick, the time waits by their time, the audio waits
+    // by their timeline frame (in the tick field)
+    std::vector<Wake> tick_waits;
+    std::vector<Wake> time_waits;
+    std::vector<Wake> audio_waits;
+
+    // Wakes taken by update() - the resumed scripts queue the new ones meanwhile
+    std::vector<Wake> due;
+
+    std::uint64_t tick = 0;
+    double time = 0.0;
+
+    int running = 0;
+    int resumed = 0;
+};
+
+// =========================================================================================== SCRIPT RUNNER
+
+
+// =========================================================================================== AWAITERS
+
+
+// Suspends the script for the given number of update ticks (at least 1)
+struct Wait_ticks
+{
+    int ticks;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(Script::Handle h) const { Script_runner::Instance().wait_ticks(h.promise().slot, ticks); }
+    void await_resume() const noexcept {}
+};
+
+
+// Suspends the script for the script time in seconds - resumed by the first tick at or after it
+struct Wait_seconds
+{
+    float seconds;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(Script::Handle h) const { Script_runner::Instance().wait_seconds(h.promise().slot, seconds); }
+    void await_resume() const noexcept {}
+};
+
+
+// Suspends the script until the Audio_timeline frame - resumed by the first tick at or after it
+struct Wait_audio
+{
+    std::uint64_t frame;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(Script::Handle h) const { Script_runner::Instance().wait_audio(h.promise().slot, frame); }
+    void await_resume() const noexcept {}
+};
+
+
+inline Wait_ticks next_frame() { return {1}; }
+inline Wait_ticks ticks(int count) { return {count}; }
+inline Wait_seconds seconds(float s) { return {s}; }
+
+// Seconds of the heard music from now - no drift against the song, whatever the tick pace
+inline Wait_audio audio_seconds(float s)
+{
+    const Audio_timeline& timeline = Audio_timeline::Instance();
+    return {timeline.get_frames() + static_cast<std::uint64_t>(std::max(s, 0.0f) * timeline.get_rate() + 0.5f)};
+}
+
+// The count-th beat boundary of the tempo grid (Audio_timeline::set_tempo()), 1 - the next beat
+inline Wait_audio beats(int count) { return {Audio_timeline::Instance().get_next_beat_frame(count)}; }
+
+// =========================================================================================== AWAITERS
+
+#endif
@@ -0,0 +1,253 @@
+// shape_cache.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "shape_cache.h"
+#include "../primitives/primitives.h"
+#include "../render_queue/render_queue.h"
+#include "../render_stats/render_stats.h"
+#include "../render_target_pool/render_target_pool.h"
+
+#include <cstring>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== SHAPE DESCRIPTION
+
+Shape_desc Shape_desc::circle(int radius, SDL_Color color)
+{
+    Shape_desc desc;
+
+    desc.kind = Shape_kind::CIRCLE;
+    desc.w = desc.h = radius * 2;
+    desc.color = color;
+
+    return desc;
+}
+
+
+Shape_desc Shape_desc::circle_outline(int radius, float thickness, SDL_Color color)
+{
+    Shape_desc desc = circle(radius, color);
+
+    desc.kind = Shape_kind::CIRCLE_OUTLINE;
+    desc.thickness = thickness;
+
+    return desc;
+}
+
+
+Shape_desc Shape_desc::rect_outline(int w, int h, float thickness, SDL_Color color)
+{
+    Shape_desc desc;
+
+    desc.kind = Shape_kind::RECT_OUTLINE;
+    desc.w = w;
+    desc.h = h;
+    desc.thickness = thickness;
+    desc.color = color;
+
+    return desc;
+}
+
+
+Shape_desc Shape_desc::rounded_rect(int w, int h, float radius, SDL_Color color)
+{
+    Shape_desc desc;
+
+    desc.kind = Shape_kind::ROUNDED_RECT;
+    desc.w = w;
+    desc.h = h;
+    desc.radius = radius;
+    desc.color = color;
+
+    return desc;
+}
+
+
+bool Shape_desc::operator==(const Shape_desc& other) const
+{
+    return kind == other.kind && w == other.w && h == other.h
+        && radius == other.radius && thickness == other.thickness;
+}
+
+
+std::size_t Shape_desc_hash::operator()(const Shape_desc& desc) const
+{
+    std::uint32_t radius_bits = 0, thickness_bits = 0;
+
+    std::memcpy(&radius_bits, &desc.radius, sizeof(radius_bits));
+    std::memcpy(&thickness_bits, &desc.thickness, sizeof(thickness_bits));
+
+    std::uint64_t h = static_cast<std::uint64_t>(desc.kind);
+
+    // FNV-style mixing of the fields
+    auto mix = [&h](std::uint64_t v) { h = (h ^ v) * 0x100000001B3ull; };
+
+    mix(static_cast<std::uint32_t>(desc.w));
+    mix(static_cast<std::uint32_t>(desc.h));
+    mix(radius_bits);
+    mix(thickness_bits);
+
+    return static_cast<std::size_t>(h);
+}
+
+// =========================================================================================== SHAPE DESCRIPTION
+
+
+// =========================================================================================== SHAPE CACHE
+
+// Tessellates the shape with its bounding box at (x, y) into the Render_queue
+
+static void emit_shape(const Shape_desc& desc, float x, float y, SDL_Color color, int layer)
+{
+    const float w = static_cast<float>(desc.w);
+    const float h = static_cast<float>(desc.h);
+
+    switch (desc.kind)
+    {
+        case Shape_kind::CIRCLE:
+            draw_circle(x + w * 0.5f, y + w * 0.5f, w * 0.5f, color, layer);
+            break;
+
+        case Shape_kind::CIRCLE_OUTLINE:
+            draw_circle_outline(x + w * 0.5f, y + w * 0.5f, w * 0.5f, desc.thickness, color, layer);
+            break;
+
+        case Shape_kind::RECT_OUTLINE:
+            draw_rect_outline({x, y, w, h}, desc.thickness, color, layer);
+            break;
+
+        case Shape_kind::ROUNDED_RECT:
+            draw_rounded_rect({x, y, w, h}, desc.radius, color, layer);
+            break;
+    }
+}
+
+
+Shape_cache& Shape_cache::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Shape_cache instance;
+
+    return instance;
+}
+
+
+void Shape_cache::draw(SDL_Renderer* r, const Shape_desc& desc, float x, float y, int layer)
+{
+    if (desc.w <= 0 || desc.h <= 0) return;
+
+    SDL_Texture* texture = get(r, desc);
+
+    // No render targets - the shape is tessellated every frame
+    if (!texture)
+    {
+        emit_shape(desc, x, y, desc.color, layer);
+        return;
+    }
+
+    const SDL_FRect dst = {x, y, static_cast<float>(desc.w), static_cast<float>(desc.h)};
+
+    Render_queue::Instance().copy(texture, nullptr, dst, layer, desc.color);
+}
+
+
+SDL_Texture* Shape_cache::get(SDL_Renderer* r, const Shape_desc& desc)
+{
+    if (!r || desc.w <= 0 || desc.h <= 0) return nullptr;
+
+    // Textures of another renderer are useless
+    if (r != owner)
+    {
+        clear();
+        owner = r;
+    }
+
+    auto it = entries.find(desc);
+
+    if (it == entries.end())
+    {
+        SDL_Texture* texture = build(r, desc);
+
+        if (!texture) return nullptr;
+
+        if (static_cast<int>(entries.size()) >= MAX_ENTRIES) evict_oldest();
+
+        it = entries.emplace(desc, Entry{texture, 0}).first;
+    }
+
+    it->second.last_use = ++use_counter;
+
+    return it->second.texture;
+}
+
+
+SDL_Texture* Shape_cache::build(SDL_Renderer* r, const Shape_desc& desc)
+{
+    if (!SDL_RenderTargetSupported(r)) return nullptr;
+
+    SDL_Texture* texture = Render_target_pool::Instance().acquire(r, desc.w, desc.h, SDL_PIXELFORMAT_ARGB8888);
+
+    if (!texture)
+    {
+        SDL_Log("Shape cache texture creation failed: %s", SDL_GetError());
+        return nullptr;
+    }
+
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+    SDL_Texture* prev_target = SDL_GetRenderTarget(r);
+
+    Render::set_target(r, texture);
+    SDL_SetRenderDrawColor(r, 0, 0, 0, 0);
+    Render::clear(r);
+
+    // White opaque mask - the color and alpha are applied by the modulation of every copy
+    const SDL_Color white = {255, 255, 255, 255};
+
+    // Only the shape is submitted, the commands the state already queued stay
+    Render_queue& queue = Render_queue::Instance();
+    int mark = queue.get_command_count();
+
+    emit_shape(desc, 0.0f, 0.0f, white, 0);
+    queue.submit_since(r, mark);
+
+    Render::set_target(r, prev_target);
+
+    ++build_count;
+
+    return texture;
+}
+
+
+void Shape_cache::evict_oldest()
+{
+    auto oldest = entries.end();
+
+    for (auto it = entries.begin(); it != entries.end(); ++it)
+        if (oldest == entries.end() || it->second.last_use < oldest->second.last_use) oldest = it;
+
+    if (oldest == entries.end()) return;
+
+    Render_target_pool::Instance().release(oldest->second.texture);
+    entries.erase(oldest);
+}
+
+
+void Shape_cache::clear()
+{
+    for (auto& [desc, entry] : entries) Render_target_pool::Instance().release(entry.texture);
+
+    entries.clear();
+}
+
+
+int Shape_cache::get_entry_count() const { return static_cast<int>(entries.size()); }
+
+
+Uint64 Shape_cache::get_build_count() const { return build_count; }
+
+// =========================================================================================== SHAPE CACHE
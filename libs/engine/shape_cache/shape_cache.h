@@ -0,0 +1,169 @@
+// shape_cache.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+#include <unordered_map>
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== SHAPE DESCRIPTION
+
+
+// Procedural shapes, which could be cached in a texture
+enum class Shape_kind : std::uint8_t
+{
+    CIRCLE,             // Solid circle, w = h = diameter
+    CIRCLE_OUTLINE,     // Ring, w = h = diameter
+    RECT_OUTLINE,       // Rectangle border
+    ROUNDED_RECT        // Solid rectangle with the rounded corners
+};
+
+
+/**
+ * @brief Geometry and color of a cached shape.
+ *
+ * The geometry is the cache key: changing it gives another key, so the changed shape
+ * is simply built again and the old texture is evicted when it is not used anymore.
+ * The color is not a part of the key - the shapes are built white and tinted
+ * by the texture color modulation, so a palette swap never rebuilds them.
+ *
+ * Use the factory functions:
+ *
+ * Shape_desc ball = Shape_desc::circle(50, {255, 0, 0, 255});
+ */
+struct Shape_desc
+{
+    Shape_kind kind = Shape_kind::CIRCLE;
+
+    int w = 0;                  // Bounding box size in pixels
+    int h = 0;
+
+    float radius = 0.0f;        // Corner radius (ROUNDED_RECT)
+    float thickness = 0.0f;     // Border thickness (outlines)
+
+    SDL_Color color = {255, 255, 255, 255};     // Tint, not a part of the key
+
+
+    static Shape_desc circle(int radius, SDL_Color color);
+    static Shape_desc circle_outline(int radius, float thickness, SDL_Color color);
+    static Shape_desc rect_outline(int w, int h, float thickness, SDL_Color color);
+    static Shape_desc rounded_rect(int w, int h, float radius, SDL_Color color);
+
+    // Geometry equality - the color is ignored
+    bool operator==(const Shape_desc& other) const;
+};
+
+
+// Hash of the Shape_desc for the cache map
+struct Shape_desc_hash
+{
+    std::size_t operator()(const Shape_desc& desc) const;
+};
+
+// =========================================================================================== SHAPE DESCRIPTION
+
+
+// =========================================================================================== SHAPE CACHE
+
+
+/**
+ * @brief Cache of the procedural shapes rendered into textures.
+ *
+ * The first draw() of a shape tessellates it once into a target texture,
+ * every next draw() is a single textured copy through the Render_queue, so
+ * the same cached shapes on the screen are batched into one call as well.
+ * The textures are white masks, the color and alpha are the texture modulation
+ * of every copy, so the same shape in different colors shares one texture.
+ *
+ * The cache holds up to MAX_ENTRIES textures, the least recently used one is evicted.
+ * Without the render target support the shapes are drawn live by the primitives.
+ *
+ * The textures belong to the renderer: the engine clears the cache on the shutdown
+ * and when the render targets are reset.
+ *
+ * Singleton, like Render_queue, so the render callbacks can reach it without any context.
+ *
+ * Usage (inside the state render):
+ * @code
+ * Shape_cache::Instance().draw(r, Shape_desc::circle(50, {255, 0, 0, 255}), 350.0f, 250.0f);
+ * @endcode
+ */
+class Shape_cache
+{
+
+public:
+
+    // Returns the singleton instance.
+    static Shape_cache& Instance();
+
+
+    /**
+     * @brief Queues the shape with its top-left corner at (x, y).
+     *
+     * @param r     Renderer of the frame.
+     * @param desc  Shape geometry and color.
+     * @param x     Left edge of the bounding box.
+     * @param y     Top edge of the bounding box.
+     * @param layer Render_queue draw layer.
+     */
+    void draw(SDL_Renderer* r, const Shape_desc& desc, float x, float y, int layer = 0);
+
+    /**
+     * @brief Returns the texture of the shape, building it on the first request.
+     *
+     * @return Texture owned by the cache, nullptr if it can't be built.
+     */
+    SDL_Texture* get(SDL_Renderer* r, const Shape_desc& desc);
+
+    // Destroys all cached textures
+    void clear();
+
+
+    // Number of the cached shapes
+    int get_entry_count() const;
+
+    // Number of the texture builds since the start (grows only when shapes change)
+    Uint64 get_build_count() const;
+
+
+private:
+
+    // Private constructor for singleton
+    Shape_cache() = default;
+
+    // Copying the singleton is not allowed
+    Shape_cache(const Shape_cache&) = delete;
+    Shape_cache& operator=(const Shape_cache&) = delete;
+
+
+    static constexpr int MAX_ENTRIES = 64;
+
+    struct Entry
+    {
+        SDL_Texture* texture = nullptr;
+        Uint64 last_use = 0;
+    };
+
+    // Renders the shape into a new texture
+    SDL_Texture* build(SDL_Renderer* r, const Shape_desc& desc);
+
+    // Destroys the least recently used entry
+    void evict_oldest();
+
+
+    std::unordered_map<Shape_desc, Entry, Shape_desc_hash> entries;
+
+    // Renderer the textures were created with
+    SDL_Renderer* owner = nullptr;
+
+    Uint64 use_counter = 0;
+    Uint64 build_count = 0;
+};
+
+// =========================================================================================== SHAPE CACHE
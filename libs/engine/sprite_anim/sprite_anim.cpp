@@ -0,0 +1,267 @@
+// sprite_anim.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "sprite_anim.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../asset/asset_instance.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== ANIMATION CLIP
+
+void Anim_clip::add_frame(const Rect2& crop, float duration)
+{
+    duration = std::max(duration, 0.001f);
+
+    frames.push_back({crop, duration});
+    length += duration;
+}
+
+
+void Anim_clip::add_grid_frames(Vec2 cell, int columns, int first, int count, float duration)
+{
+    if (columns <= 0) return;
+
+    for (int i = first; i < first + count; ++i)
+    {
+        const Vec2 top_left{static_cast<float>(i % columns) * cell.x, static_cast<float>(i / columns) * cell.y};
+
+        add_frame({top_left, top_left + cell}, duration);
+    }
+}
+
+// =========================================================================================== ANIMATION CLIP
+
+
+// =========================================================================================== SPRITE ANIMATOR
+
+// Handle: generation in the high 16 bits (never 0), slot in the low ones
+static Anim make_handle(std::uint32_t slot, std::uint16_t generation) { return (static_cast<Anim>(generation) << 16) | slot; }
+
+
+Sprite_animator& Sprite_animator::Instance()
+{
+    static Sprite_animator instance;
+    return instance;
+}
+
+
+Sprite_animator& Sprite_animator::Audio_synced()
+{
+    static Sprite_animator instance;
+    return instance;
+}
+
+
+Sprite_animator::Sprite_animator(int requested)
+    : capacity(std::min(std::max(requested, 1), 0xFFFF))
+{
+    const size_t n = static_cast<size_t>(capacity);
+
+    targets.resize(n, nullptr);
+    clips.resize(n, nullptr);
+    time_left.resize(n, 0.0f);
+    speeds.resize(n, 1.0f);
+    frames.resize(n, 0);
+    directions.resize(n, 1);
+    done_fns.resize(n, nullptr);
+    done_contexts.resize(n, nullptr);
+    owners.resize(n, 0);
+
+    indices.resize(n, -1);
+    generations.resize(n, 1);
+
+    free_slots.reserve(n);
+    for (std::uint32_t slot = static_cast<std::uint32_t>(capacity); slot-- > 0;) free_slots.push_back(slot);
+}
+
+
+Anim Sprite_animator::play(Image_instance* target, const Anim_clip* clip, float speed, Done_fn done, void* context)
+{
+    if (!target || !clip || clip->get_frame_count() == 0) return 0;
+
+    // One clip per instance - two players would fight over the crop
+    stop_target(target);
+
+    if (free_slots.empty())
+    {
+        ++dropped;
+        return 0;
+    }
+
+    const std::uint32_t slot = free_slots.back();
+    free_slots.pop_back();
+
+    const int i = count++;
+
+    targets[i] = target;
+    clips[i] = clip;
+    time_left[i] = clip->get_frame(0).duration;
+    speeds[i] = std::max(speed, 0.0f);
+    frames[i] = 0;
+    directions[i] = 1;
+    done_fns[i] = done;
+    done_contexts[i] = context;
+    owners[i] = slot;
+
+    indices[slot] = i;
+
+    target->set_crop_map(clip->get_frame(0).crop);
+    ++frame_writes;
+
+    return make_handle(slot, generations[slot]);
+}
+
+
+bool Sprite_animator::is_active(Anim anim) const
+{
+    const std::uint32_t slot = anim & 0xFFFF;
+
+    return anim != 0 && slot < static_cast<std::uint32_t>(capacity) && indices[slot] >= 0
+        && generations[slot] == static_cast<std::uint16_t>(anim >> 16);
+}
+
+
+void Sprite_animator::stop(Anim anim)
+{
+    if (is_active(anim)) remove_at(indices[anim & 0xFFFF]);
+}
+
+
+void Sprite_animator::stop_target(const Image_instance* target)
+{
+    for (int i = count; i-- > 0;)
+        if (targets[i] == target) remove_at(i);
+}
+
+
+void Sprite_animator::clear()
+{
+    while (count > 0) remove_at(count - 1);
+}
+
+
+void Sprite_animator::set_speed(Anim anim, float speed)
+{
+    if (is_active(anim)) speeds[indices[anim & 0xFFFF]] = std::max(speed, 0.0f);
+}
+
+
+int Sprite_animator::get_frame(Anim anim) const
+{
+    return is_active(anim) ? frames[indices[anim & 0xFFFF]] : -1;
+}
+
+
+void Sprite_animator::remove_at(int index)
+{
+    const std::uint32_t slot = owners[index];
+
+    // A new generation - the handles of this player are stale, 0 is never a generation
+    generations[slot] = static_cast<std::uint16_t>(generations[slot] + 1 == 0x10000 ? 1 : generations[slot] + 1);
+    indices[slot] = -1;
+    free_slots.push_back(slot);
+
+    const int last = --count;
+
+    if (index != last)
+    {
+        targets[index] = targets[last];
+        clips[index] = clips[last];
+        time_left[index] = time_left[last];
+        speeds[index] = speeds[last];
+        frames[index] = frames[last];
+        directions[index] = directions[last];
+        done_fns[index] = done_fns[last];
+        done_contexts[index] = done_contexts[last];
+        owners[index] = owners[last];
+
+        indices[owners[index]] = index;
+    }
+}
+
+
+bool Sprite_animator::step(int i)
+{
+    const Anim_clip& clip = *clips[i];
+    const int n = clip.get_frame_count();
+    const int shown = frames[i];
+
+    // Whole loops of a long tick (a hitch, a resume) skipped at once - the phase stays
+    if (clip.get_loop() == ANIM_LOOP && time_left[i] + clip.get_length() <= 0.0f)
+        time_left[i] = std::fmod(time_left[i], clip.get_length());
+
+    bool playing = true;
+
+    while (time_left[i] <= 0.0f)
+    {
+        int next = frames[i] + directions[i];
+
+        if (next < 0 || next >= n)
+        {
+            if (clip.get_loop() == ANIM_ONCE)
+            {
+                playing = false;
+                break;
+            }
+
+            if (clip.get_loop() == ANIM_LOOP) next = 0;
+            else
+            {
+                directions[i] = static_cast<std::int8_t>(-directions[i]);
+                next = n > 1 ? frames[i] + directions[i] : 0;
+            }
+        }
+
+        frames[i] = next;
+        time_left[i] += clip.get_frame(next).duration;
+    }
+
+    // Only a changed frame touches the instance - its source rect is recomputed once, by the next draw
+    if (frames[i] != shown)
+    {
+        targets[i]->set_crop_map(clip.get_frame(frames[i]).crop);
+        ++frame_writes;
+    }
+
+    return playing;
+}
+
+
+void Sprite_animator::update(float dt)
+{
+    if (count == 0) return;
+
+    bool due = false;
+
+    // One pass over the packed times - most ticks end here, no frame is over
+    for (int i = 0; i < count; ++i)
+    {
+        time_left[i] -= dt * speeds[i];
+
+        due |= time_left[i] <= 0.0f;
+    }
+
+    if (!due) return;
+
+    // From the back - a callback could play a clip (appended) or stop one (swapped in from the back)
+    for (int i = count; i-- > 0;)
+    {
+        if (i >= count || time_left[i] > 0.0f || step(i)) continue;
+
+        const Done_fn done = done_fns[i];
+        void* const context = done_contexts[i];
+
+        remove_at(i);
+
+        if (done) done(context);
+    }
+}
+
+// =========================================================================================== SPRITE ANIMATOR
@@ -0,0 +1,231 @@
+// sprite_anim.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+#include <vector>
+
+#include "../math/math_2d.h"
+
+class Image_instance;
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== ANIMATION CLIP
+
+enum Anim_loop : std::uint8_t
+{
+    ANIM_ONCE,              // stops on the last frame
+    ANIM_LOOP,              // the first frame after the last one
+    ANIM_PING_PONG          // back and forth, the end frames are shown once per turn
+};
+
+
+// Frame of a clip: the crop of the image (logical pixels, as Image_instance::set_crop_map()) and its time
+struct Anim_frame
+{
+    Rect2 crop;
+    float duration;
+};
+
+
+/**
+ * @brief Frame table of a sprite animation - the crops of one image with their durations.
+ *
+ * The crops are in the image's own pixels, not in the texture: the same clip animates the
+ * image in its own texture, packed into an atlas page or loaded as a resolution variant -
+ * the instance adds the atlas origin and the texel scale when it draws.
+ *
+ * Built once (the state enter, the asset load) and shared by all players of it - a clip must
+ * outlive its players.
+ *
+ * Usage:
+ * @code
+ * Anim_clip run(ANIM_LOOP);
+ * run.add_grid_frames({32.0f, 32.0f}, 8, 0, 6, 0.08f);      // cells 0 - 5 of the 8 columns sheet
+ * @endcode
+ */
+class Anim_clip
+{
+
+public:
+
+    explicit Anim_clip(Anim_loop loop = ANIM_LOOP) : loop(loop) {}
+
+    // Appends a frame, a duration below 1 ms is 1 ms (a zero would never step on)
+    void add_frame(const Rect2& crop, float duration);
+
+    // Appends the count cells of a sheet grid from the first one, row by row
+    void add_grid_frames(Vec2 cell, int columns, int first, int count, float duration);
+
+    int get_frame_count() const { return static_cast<int>(frames.size()); }
+    const Anim_frame& get_frame(int index) const { return frames[static_cast<size_t>(index)]; }
+
+    Anim_loop get_loop() const { return loop; }
+    void set_loop(Anim_loop new_loop) { loop = new_loop; }
+
+    // Seconds of one pass over the frames
+    float get_length() const { return length; }
+
+
+private:
+
+    std::vector<Anim_frame> frames;
+
+    Anim_loop loop;
+    float length = 0.0f;
+};
+
+// =========================================================================================== ANIMATION CLIP
+
+
+// =========================================================================================== SPRITE ANIMATOR
+
+// Handle of a playing clip, 0 - none (the animator was full)
+using Anim = std::uint32_t;
+
+
+/**
+ * @brief Players of the animation clips, all advanced by one pass per tick.
+ *
+ * A player steps its instance through the frames of a clip: on every frame change the crop
+ * of the frame is written into the Image_instance (set_crop_map()) - the instance caches the
+ * source rect of it once, the draws of the frame only read it. The ticks without a frame
+ * change don't touch the instance at all.
+ *
+ * The players are packed structure-of-arrays, like the Tween_system - the instance, the clip,
+ * the frame, the time left in it, the direction and the speed - and update() is one loop over
+ * the times, the stepping runs only for the players whose frame is over. A long tick steps
+ * over several frames at once (the time carries over), so the animation keeps its speed at
+ * any tick rate. A finished player (ANIM_ONCE) is swapped out with the last one; the capacity
+ * is allocated by the constructor and never grows.
+ *
+ * The handles have a generation - a handle of a finished player is stale, stop() ignores it.
+ * The instance must outlive its player (or stop_target() it), the clip too.
+ *
+ * Singleton, updated by the engine after every state_update tick (Engine_clock tick_dt),
+ * next to the tweens - the states only play the clips. The Audio_synced() one is updated
+ * with the Audio_timeline step - an instance plays in one of the two at a time.
+ *
+ * Usage:
+ * @code
+ * Sprite_animator& animator = Sprite_animator::Instance();
+ *
+ * Anim walk = animator.play(hero, &run);               // the first frame is shown right away
+ * animator.set_speed(walk, 1.5f);
+ *
+ * animator.stop_target(hero);                          // before the instance is deleted
+ * @endcode
+ */
+class Sprite_animator
+{
+
+public:
+
+    // Called once when an ANIM_ONCE player shows its last frame to the end (not when stopped)
+    using Done_fn = void (*)(void* context);
+
+
+    // Returns the singleton instance.
+    static Sprite_animator& Instance();
+
+    // Second animator, advanced by the Audio_timeline steps - the clips in the music time (the dancers)
+    static Sprite_animator& Audio_synced();
+
+    // Slots for the players alive at the same time
+    explicit Sprite_animator(int capacity = 256);
+
+
+    /**
+     * @brief Starts the clip on the instance, its first frame is set right away.
+     *
+     * The instance keeps playing only this clip - its previous player is stopped.
+     *
+     * @param target Instance to animate.
+     * @param clip   Frames (at least one), outlives the player.
+     * @param speed  Time scale, 1 - the clip durations.
+     * @param done   Optional end callback of the ANIM_ONCE clips and its context.
+     * @return Handle, 0 if every slot is in use or the clip is empty.
+     */
+    Anim play(Image_instance* target, const Anim_clip* clip, float speed = 1.0f,
+              Done_fn done = nullptr, void* context = nullptr);
+
+    // Stops the player on its current frame, stale handles are ignored
+    void stop(Anim anim);
+
+    // Stops the player of the instance (its owner deletes it)
+    void stop_target(const Image_instance* target);
+
+    // Stops everything
+    void clear();
+
+    bool is_active(Anim anim) const;
+
+    // Time scale of the player (0 - paused on the frame)
+    void set_speed(Anim anim, float speed);
+
+    // Index of the frame shown, -1 for a stale handle
+    int get_frame(Anim anim) const;
+
+
+    // Advances every player by dt seconds (the engine, once per tick)
+    void update(float dt);
+
+
+    // === STATS ===
+
+    int get_capacity() const { return capacity; }
+    int get_active() const { return count; }
+
+    // Frame changes written into the instances since the start
+    std::uint64_t get_frame_writes() const { return frame_writes; }
+
+    // Plays refused because the capacity was full
+    std::uint64_t get_dropped() const { return dropped; }
+
+    // === STATS ===
+
+
+private:
+
+    // Removes the player at the packed index (swap with the last one)
+    void remove_at(int index);
+
+    // Moves the player at the index over its finished frames, false if an ANIM_ONCE clip ended
+    bool step(int index);
+
+
+    int capacity;
+    int count = 0;
+
+    // === PACKED, by the index 0 - count ===
+
+    std::vector<Image_instance*> targets;
+    std::vector<const Anim_clip*> clips;
+    std::vector<float> time_left;
+    std::vector<float> speeds;
+    std::vector<int> frames;
+    std::vector<std::int8_t> directions;
+
+    std::vector<Done_fn> done_fns;
+    std::vector<void*> done_contexts;
+
+    // Slot of the player at the index (its handle)
+    std::vector<std::uint32_t> owners;
+
+    // === PACKED ===
+
+    // Slot -> packed index (the handle lookup) and the generation of the slot
+    std::vector<int> indices;
+    std::vector<std::uint16_t> generations;
+
+    std::vector<std::uint32_t> free_slots;
+
+    std::uint64_t frame_writes = 0;
+    std::uint64_t dropped = 0;
+};
+
+// =========================================================================================== SPRITE ANIMATOR
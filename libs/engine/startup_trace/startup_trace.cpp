@@ -0,0 +1,87 @@
+// startup_trace.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "startup_trace.h"
+#include "../engine_clock/engine_clock.h"
+
+#include <iostream>
+#include <iomanip>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== STARTUP TRACE
+
+Startup_trace& Startup_trace::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Startup_trace instance;
+
+    return instance;
+}
+
+
+void Startup_trace::mark(const char* phase)
+{
+    Uint64 now = Engine_clock::now();
+
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (finished || mark_count >= MAX_MARKS) return;
+
+    marks[mark_count++] = {phase, now};
+}
+
+
+void Startup_trace::finish(const char* phase)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (finished) return;
+    }
+
+    mark(phase);
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        finished = true;
+    }
+
+    dump(std::cout);
+}
+
+
+bool Startup_trace::is_finished() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    return finished;
+}
+
+
+void Startup_trace::dump(std::ostream& out) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (mark_count == 0) return;
+
+    const double to_ms = 1000.0 / static_cast<double>(Engine_clock::frequency());
+    const Uint64 origin = marks[0].counter;
+
+    out << "Startup timeline (ms since \"" << marks[0].phase << "\", phase duration):\n";
+
+    for (int i = 0; i < mark_count; ++i)
+    {
+        double since = static_cast<double>(marks[i].counter - origin) * to_ms;
+        double phase = i > 0 ? static_cast<double>(marks[i].counter - marks[i - 1].counter) * to_ms : 0.0;
+
+        out << std::fixed << std::setprecision(2)
+            << "  " << std::setw(9) << since << "  +" << std::setw(8) << phase << "  " << marks[i].phase << "\n";
+    }
+
+    out.unsetf(std::ios::floatfield);
+}
+
+// =========================================================================================== STARTUP TRACE
@@ -0,0 +1,92 @@
+// startup_trace.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <iosfwd>
+#include <mutex>
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== STARTUP TRACE
+
+
+/**
+ * @brief Timeline of the application startup phases.
+ *
+ * Every mark() stores a timestamp with the phase name, finish() adds the last mark
+ * and prints the whole timeline once: the time since the first mark and the
+ * duration of every phase. Shows what part of the cold start (SDL init, window,
+ * renderer, state tree, splash preload) takes the time on the SD card.
+ *
+ * Thread-safe - the preload workers mark their phases too.
+ *
+ * Singleton, like Lang_state, so any module can mark without any context.
+ *
+ * Usage:
+ * @code
+ * Startup_trace::Instance().mark("init_game_states");
+ * Startup_trace::Instance().finish("first interactive frame");
+ * @endcode
+ */
+class Startup_trace
+{
+
+public:
+
+    // Returns the singleton instance.
+    static Startup_trace& Instance();
+
+
+    /**
+     * @brief Records the end of a startup phase.
+     *
+     * @param phase Phase name, must be a string literal (the pointer is stored).
+     */
+    void mark(const char* phase);
+
+    /**
+     * @brief Records the last phase and prints the timeline. Only the first call has any effect.
+     *
+     * @param phase Phase name, must be a string literal.
+     */
+    void finish(const char* phase);
+
+    // true after finish() - the later marks are ignored
+    bool is_finished() const;
+
+    // Prints the recorded timeline
+    void dump(std::ostream& out) const;
+
+
+private:
+
+    // Private constructor for singleton
+    Startup_trace() = default;
+
+    // Copying the singleton is not allowed
+    Startup_trace(const Startup_trace&) = delete;
+    Startup_trace& operator=(const Startup_trace&) = delete;
+
+
+    static constexpr int MAX_MARKS = 32;
+
+    struct Mark
+    {
+        const char* phase;
+        Uint64 counter;
+    };
+
+    Mark marks[MAX_MARKS] = {};
+    int mark_count = 0;
+
+    bool finished = false;
+
+    mutable std::mutex lock;
+};
+
+// =========================================================================================== STARTUP TRACE
@@ -3,87 +3,246 @@
 // =========================================================================================== IMPORT
 
 #include "state_machine.h"
+#include "../render_queue/render_queue.h"
+#include "../engine_clock/engine_clock.h"
+#include "../render_stats/render_stats.h"
+#include "../render_target_pool/render_target_pool.h"
+#include "../frame/frame.h"
+#include "../log/log.h"
+#include "../script/state_script.h"
 
 #include <algorithm> // For "std::find_if" and "std::remove"
+#include <cstring>   // For "std::memcmp"
 
 // =========================================================================================== IMPORT
 
 
-// =========================================================================================== STATE_ID
+// =========================================================================================== STATE ENTER AND EXIT
+
+// Exit hook, then the scripts of the state stop - they can't outlive its data.
+// The arena goes last: the hook and the scripts could still read it.
+
+static void exit_state(State *state)
+{
+    state->run_exit();
+
+    // Left before its initialization ended - no more steps
+    state->loading = false;
+
+#ifdef STATE_SCRIPTS
+    Script_runner::Instance().stop_owner(state->id);
+#endif
+
+    if (state->arena) state->arena->reset();
+}
+
+
+// Enter hook, then the state is loading until its time-sliced initialization ends (State::enter_step)
+
+static void enter_state(State *state)
+{
+    state->run_enter();
+
+    state->loading = state->has_enter_step();
+}
+
+
+// The state or one of its ancestors is still loading - nothing reaches it yet
 
-// We initialize the empty internal vector directly from the initializer list.
+static bool is_path_loading(const State *state)
+{
+    for (int i = 0; i < state->path_depth; ++i) if (state->path[i]->loading) return true;
+
+    return false;
+}
+
+// =========================================================================================== STATE ENTER AND EXIT
+
+
+// =========================================================================================== DISPATCH GUARD
+
+
+// =========================================================================================== PROFILE SCOPE
+
+#ifdef STATE_MACHINE_PROFILING
+
+// RAII timer of a single hook call - adds the elapsed ticks into the counter on destruction
+struct Profile_scope
+{
+    Profile_counter *counter;
+    std::uint64_t start;
+
+    explicit Profile_scope(Profile_counter *c) : counter(c), start(Engine_clock::now()) {}
+
+    ~Profile_scope()
+    {
+        if (counter) counter->add(Engine_clock::now() - start);
+    }
+};
 
-State_ID::State_ID(std::initializer_list<int> lvl) : levels(lvl) {}
+// Scoped measurement of the state hook (state may be nullptr)
+#define SM_PROFILE_SCOPE(state, field) Profile_scope sm_profile_scope((state) ? &(state)->profile.field : nullptr)
 
+#else
 
-// Vector equality already checks both size and each element in order.
+#define SM_PROFILE_SCOPE(state, field)
 
-bool State_ID::operator==(const State_ID &other) const { return levels == other.levels; }
+#endif
 
+// =========================================================================================== PROFILE SCOPE
 
-// Implemented in terms of operator== to avoid duplicating logic.
 
-bool State_ID::operator!=(const State_ID &other) const { return !(*this == other); }
+// Checks if the state s is the root itself or one of its descendants - by the ancestor path
+static bool is_in_subtree(const State *s, const State *root)
+{
+    for (int i = 0; i < s->path_depth; ++i) if (s->path[i] == root) return true;
 
+    return false;
+}
 
-State_ID State_ID::parent() const
+// Renders the state and draws its queued commands right away, so the states
+// stacked on top of it (overlays) stay above, and the backdrop capture is complete
+static void render_and_submit(State *s, SDL_Renderer *r, float alpha)
 {
-    // We make a copy of the current object to avoid modifying the original.
-    // Then we remove the last level, if it exists. This works even if the
-    // current State_ID is empty (will return another empty State_ID).
+    s->run_render(r, alpha);
 
-    State_ID parent_copy = *this;
+    Render_queue::Instance().submit(r);
+}
 
-    // // Remove last level if there is a level
-    if (!parent_copy.levels.empty())
-        parent_copy.levels.pop_back();
+// Same, the propagating ancestors of the state from the level first (root first) before it -
+// a walk of the flat path, for the frames below the top overlay, which are drawn once per push
+static void render_with_ancestors(State *s, int first, SDL_Renderer *r, float alpha)
+{
+    for (int level = first; level < s->path_depth - 1; ++level)
+        if (s->path[level]->propagates) render_and_submit(s->path[level], r, alpha);
 
-    return parent_copy; // Copy as parent
+    render_and_submit(s, r, alpha);
 }
 
+// Length of the common part of the ancestor paths of two states
+static int common_levels(const State *a, const State *b)
+{
+    int n = 0;
+
+    while (n < a->path_depth && n < b->path_depth && a->path[n] == b->path[n]) ++n;
+
+    return n;
+}
 
-bool State_ID::is_parent_of(const State_ID &child) const
+// Moves the leaf of an active path (the main one or a region) to the target:
+// exits up to the LCA, enters down to the target. The same leaf - exit and re-enter.
+// The edge hook of the transition table runs between the exits and the enters.
+static void switch_leaf(State *&leaf, State *target, Transition_hook hook = nullptr)
 {
-    // Quick fail if size mismatch
-    if (levels.size() + 1 != child.levels.size())
-        return false;
+    State *source = leaf;
+
+    if (leaf == target)
+    {
+        exit_state(target);
+
+        if (hook) hook(*target, *target);
+
+        enter_state(target);
+
+        return;
+    }
+
+    // Length of the common prefix of both ancestor paths - the LCA is the last common state.
+    // Both paths start from their own root, so the pointers compare directly.
+    int common = 0;
+
+    if (leaf)
+    {
+        while (common < leaf->path_depth && common < target->path_depth &&
+               leaf->path[common] == target->path[common]) ++common;
+
+        // Call exit callbacks from the current leaf up to the LCA (exclusive)
+        for (int i = leaf->path_depth - 1; i >= common; --i)
+        {
+            State *leaving = leaf->path[i];
+
+            exit_state(leaving);
+        }
+    }
+
+    leaf = target; // Switch to the new state
+
+    if (hook && source) hook(*source, *target);
+
+    // Call enter callbacks from the LCA (exclusive) down to the target
+    for (int i = common; i < target->path_depth; ++i)
+    {
+        State *entering = target->path[i];
+
+        enter_state(entering);
+    }
+}
+
+// RAII marker of the running state callbacks. While any guard is alive,
+// go_to() calls are deferred, so a callback never switches the state under itself.
+struct Dispatch_guard
+{
+    std::atomic<int> &depth;
+
+    explicit Dispatch_guard(std::atomic<int> &d) : depth(d) { ++depth; }
+    ~Dispatch_guard() { --depth; }
+};
+
+// =========================================================================================== DISPATCH GUARD
+
 
-    // Compare each level
-    for (size_t i = 0; i < levels.size(); ++i)
+// =========================================================================================== STATE_ID
 
-        if (levels[i] != child.levels[i])
-            return false; // Mismatch found
+// Errors are reported without aborting - the invalid level is simply dropped.
+// In constant expressions this non-constexpr call makes the ID ill-formed instead.
 
-    return true; // All levels match
+void State_ID::report_invalid_level(int level, int depth)
+{
+    LOG_ERROR("Invalid State_ID level %d at depth %d (max depth %d, max level %d)", level, depth, MAX_DEPTH, MAX_LEVEL);
 }
 
 
-// We copy the current object to avoid modifying it, then push_back
-// the new level. This allows chaining calls like: game.child(2).child
+// String version is a thin wrapper around to_chars() with the stack buffer.
 
-State_ID State_ID::child(int i) const
+std::string State_ID::string() const
 {
-    State_ID curr = *this;    // Copy current
-    curr.levels.push_back(i); // Add new child level
-    return curr;              // Return new object
+    char buf[STRING_BUFFER_SIZE];
+
+    std::size_t len = to_chars(buf, sizeof(buf));
+
+    return std::string(buf, len);
 }
 
 
 // We iterate over all levels and insert dots between them.
 // This creates a human-readable hierarchical representation.
 
-std::string State_ID::string() const
+std::size_t State_ID::to_chars(char *buf, std::size_t size) const
 {
-    // Concatenation buffer
-    std::ostringstream oss;
+    if (size == 0) return 0;
 
-    for (size_t i = 0; i < levels.size(); ++i)
+    char *out = buf;
+    char *end = buf + size - 1; // Keep one byte for '\0'
+
+    for (int i = 0; i < depth(); ++i)
     {
-        if (i > 0) oss << ".";   // Insert dot between levels
-        oss << levels[i]; // Add level number
+        if (i > 0)
+        {
+            if (out == end) { *buf = '\0'; return 0; }
+            *out++ = '.'; // Insert dot between levels
+        }
+
+        // Add level number
+        std::to_chars_result res = std::to_chars(out, end, level(i));
+
+        if (res.ec != std::errc()) { *buf = '\0'; return 0; } // Buffer overflow
+
+        out = res.ptr;
     }
 
-    return oss.str(); // Buffered string return
+    *out = '\0';
+
+    return static_cast<std::size_t>(out - buf);
 }
 
 // =========================================================================================== STATE_ID
@@ -103,9 +262,13 @@ std::string State_ID::string() const
 // This design allows safe creation of states without requiring all callbacks
 // to be assigned immediately.
 
-State::State(const State_ID &state_id, const std::string &state_name)
+State::State(const State_ID &state_id, std::string_view state_name)
     : id(state_id), name(state_name), on_enter(nullptr), on_exit(nullptr), state_update(nullptr),
-      state_handle_event(nullptr), state_render(nullptr), parent(nullptr) {}
+      state_handle_event(nullptr), state_render(nullptr), parent(nullptr)
+{
+    // The label is formatted once for the whole life of the state
+    id.to_chars(label, sizeof(label));
+}
 
 
 // Default destructor is sufficient because:
@@ -115,31 +278,67 @@ State::State(const State_ID &state_id, const std::string &state_name)
 
 State::~State() = default;
 
+// =========================================================================================== STATE TREE
+
+// Never reached at compile time - there the call itself is the error.
+// At runtime (non-constexpr tree) it just reports the problem.
+
+void state_tree_duplicate_id(std::size_t first_index, std::size_t second_index)
+{
+    LOG_ERROR("State tree: definitions %zu and %zu have the same ID", first_index, second_index);
+}
+
+// =========================================================================================== STATE TREE
+
+
 // =========================================================================================== STATE
 
 
 // =========================================================================================== STATE MACHINE
 
+bool State_machine::set_allocator(Allocator& memory)
+{
+    if (!states.empty())
+    {
+        LOG_ERROR("set_allocator() requires an empty state machine");
+        return false;
+    }
+
+    allocator = &memory;
+
+    // The containers move into the new memory, the allocators propagate on the move
+    states = State_list(Std_allocator<State_ptr>(memory));
+    states_index = State_index(0, State_ID_hash(), std::equal_to<State_ID>(), Std_allocator<std::pair<const State_ID, State*>>(memory));
+
+    return true;
+}
+
+
 bool State_machine::add_state(std::unique_ptr<State> s)
+{
+    // make_unique memory - freed by the heap allocator
+    return add_state(State_ptr(s.release(), Allocator_delete<State>(heap_allocator())));
+}
+
+
+bool State_machine::add_state(State_ptr s)
 {
     // Reject if a state with the same ID already exists
     if (id_exists(s->id))
     {
-        std::cerr << "State with ID " << s->id.string() << " already exists!\n";
+        LOG_ERROR("State with ID %s already exists!", s->label);
         return false;
     }
 
     State *raw = s.get(); // Keep raw pointer for hierarchy linking
 
-    // 1. Find the parent (if it exists) and attach this state as a child
-    for (auto &existing : states)
+    // 1. Find the parent (if it exists) by the index and attach this state as a child
+    auto parent_it = states_index.find(raw->id.parent());
+
+    if (parent_it != states_index.end())
     {
-        if (existing->id == s->id.parent())
-        {
-            raw->parent = existing.get();
-            existing->children.push_back(raw);
-            break;
-        }
+        raw->parent = parent_it->second;
+        parent_it->second->children.push_back(raw);
     }
 
     // 2. Find any existing children that this new state should adopt
@@ -152,24 +351,78 @@ bool State_machine::add_state(std::unique_ptr<State> s)
         }
     }
 
-    // Finally, store the state in the machine
+    // 3. Flatten the ancestors chain for the new state and the adopted subtrees
+    rebuild_path(raw);
+
+    // Finally, store the state in the machine and register it in the index
+    raw->index = static_cast<int>(states.size());
+
+    event_interest_dirty = true;
+
+    states_index.emplace(raw->id, raw);
     states.push_back(std::move(s));
+
+    transitions_dirty = true; // New row and column of the transition table
+
     return true;
 }
 
 bool State_machine::id_exists(const State_ID &id) const
 {
-    // Iterate through all states to check if the given ID already exists
-    for (const auto &s : states) if (s->id == id) return true;
+    // Single hash lookup instead of the iteration through all states
+    return states_index.find(id) != states_index.end();
+}
+
+// The path of a state is its parent's path plus the state itself,
+// so the subtree is rebuilt top-down in a single recursive pass.
+
+void State_machine::rebuild_path(State *s)
+{
+    if (s->parent)
+    {
+        State *p = s->parent;
+
+        for (int i = 0; i < p->path_depth; ++i) s->path[i] = p->path[i];
+
+        s->path_depth = p->path_depth;
+    }
+    else s->path_depth = 0;
+
+    // State_ID depth limit guarantees the path always fits
+    s->path[s->path_depth++] = s;
+
+    for (State *child : s->children) rebuild_path(child);
+}
+
+
+// Leaf first, root last - the reverse order of entering
+
+void State_machine::exit_active_path()
+{
+    if (!current_state) return;
+
+    ++change_counter;
+
+    Dispatch_guard guard(dispatch_depth);
+
+    for (int i = current_state->path_depth - 1; i >= 0; --i)
+    {
+        State *active = current_state->path[i];
+
+        exit_state(active);
+    }
+
+    current_state = nullptr;
 
-    return false; // Not found
+    rebuild_active();
 }
 
+
 // Initialization by the smart pointer which will deallocate automatically
 
 void State_machine::initiate_state(const State_ID &state_id, const std::string &state_name)
 {
-    auto new_state = std::make_unique<State>(state_id, state_name); // Create state's smart pointer
+    auto new_state = make_allocated<State>(*allocator, state_id, state_name); // Create state's smart pointer
 
     this->add_state(std::move(new_state)); // Add state to the state machine
 
@@ -177,87 +430,115 @@ void State_machine::initiate_state(const State_ID &state_id, const std::string &
 }
 
 
+// Same initialization, the behavior ownership moves into the state
+
+void State_machine::initiate_state(const State_ID &state_id, const std::string &state_name,
+                                   std::unique_ptr<State_behavior> state_behavior)
+{
+    auto new_state = make_allocated<State>(*allocator, state_id, state_name);
+
+    new_state->behavior = std::move(state_behavior);
+
+    this->add_state(std::move(new_state));
+}
+
+
 // State getter by ID from state machine
 
 State *State_machine::get_state(const State_ID &state_id)
 {
-    // Iterative search of the state by ID
-    for (auto &s : this->states) if (s->id == state_id) return s.get(); // Smart pointer return
+    // Hash search of the state by ID
+    auto it = states_index.find(state_id);
 
-    return nullptr; // No state by state_id case
+    return it != states_index.end() ? it->second : nullptr; // nullptr for no state by state_id case
 }
 
-// Helper-function for recursive removing of the state childrens
-// and nullptring of the deleted state parent children pointer.
+// Marks the subtree for the removal - the dense index of every state under the root
+// becomes -1. Depth-first over the children, no allocation below the stack frames.
 // Called inside the clear_state(const State_ID& id);
-void remove_state_recursive(State *s, std::vector<std::unique_ptr<State>> &states)
+static void mark_subtree(State *s)
 {
-    // Recursive childrens removing by the std::vector<State*> children container
-    for (State *child : s->children) remove_state_recursive(child, states);
+    s->index = -1;
 
-    // Remove the state from the state parent's std::vector<State*> children container
-    if (s->parent)
-    {
-        // Childrens of the deleted state parent
-        auto &siblings = s->parent->children;
+    for (State *child : s->children) mark_subtree(child);
+}
 
-        // Move to the left all the elements which are not equal to s to the begining
-        // and erase the s element from the vector
-        siblings.erase(std::remove(siblings.begin(), siblings.end(), s), siblings.end());
-    }
+void State_machine::clear_state(const State_ID &id)
+{
+    // Find the state pointer by the index
+    State *target = get_state(id);
+
+    if (!target) return; // If there is no state with passed ID - do nothing
+
+
+    // Drop the deferred request, if it points inside the deleted subtree
+    if (pending_state && is_in_subtree(pending_state, target)) pending_state = nullptr;
 
-    // Delete the element from the state machine states vector
+    // Deleted overlays leave the stack (they are exited, top first, with everything above them)
+    for (int i = 0; i < overlay_count; ++i)
+    {
+        if (is_in_subtree(overlays[i], target))
+        {
+            while (overlay_count > i) pop_overlay();
+            break;
+        }
+    }
 
-    // "[&](const std::unique_ptr<State>& sp) { return sp.get() == s; }" is a predicate lambda
-    // used by STL algorithms (like std::find_if or std::remove_if).
-    // Breakdown:
-    // - [&] : capture list by reference, allows the lambda to use external variables (here, 's').
-    // - (const std::unique_ptr<State>& sp) : each element of the container (a unique_ptr<State>) is passed in.
-    // - return sp.get() == s : returns true if the raw pointer inside the unique_ptr matches the target pointer 's'.
-    //   Essentially, it checks whether this is the specific state we want to find or remove.
-    auto it = std::find_if(
+    // If the deleted subtree contains the current state - exit the whole
+    // active configuration and nullptr current state (nothing stays half-active)
+    if (current_state && is_in_subtree(current_state, target))
+    {
+        pop_all_overlays();
+        exit_active_path();
+    }
 
-        states.begin(), states.end(),
+    // Same for the regions, the last one first (the later ones move down)
+    for (int i = region_count - 1; i >= 0; --i)
+    {
+        Region &region = regions[i];
 
-        [&](const std::unique_ptr<State> &sp)
+        if (region.pending && is_in_subtree(region.pending, target)) region.pending = nullptr;
 
-        { return sp.get() == s; }
+        if (is_in_subtree(region.leaf, target)) exit_region(i);
+    }
 
-    );
 
-    if (it != states.end()) states.erase(it); // unique_ptr will call destructor automatically
-}
+    // Only the root is unlinked from the survivors - its subtree goes away entirely
+    if (target->parent)
+    {
+        auto &siblings = target->parent->children;
 
-void State_machine::clear_state(const State_ID &id)
-{
-    // Find the state pointer
-    auto it = std::find_if(
+        siblings.erase(std::remove(siblings.begin(), siblings.end(), target), siblings.end());
+    }
 
-        states.begin(), states.end(),
+    // Mark, then compact in one pass - O(n + k) instead of a search and an erase per state
+    mark_subtree(target);
 
-        [&](const std::unique_ptr<State> &s)
+    std::size_t kept = 0;
 
-        { return s->id == id; }
+    for (std::size_t i = 0; i < states.size(); ++i)
+    {
+        State_ptr &sp = states[i];
 
-    );
+        if (sp->index < 0)
+        {
+            states_index.erase(sp->id); // Unregister from the hash index before the object dies
+            sp.reset();                 // The destructor, the memory back to its allocator
 
-    if (it == states.end()) return; // If there is no state with passed ID - do nothing
+            continue;
+        }
 
+        sp->index = static_cast<int>(kept);
 
-    // Get the deleted state pointer by the unique_ptr.h function
-    State *target = it->get();
+        if (kept != i) states[kept] = std::move(sp);
 
-    // If the deleted state is current - call an on_exit callback
-    // and nullptr current state
-    if (current_state && current_state == target)
-    {
-        if (current_state->on_exit) current_state->on_exit();
-        current_state = nullptr;
+        ++kept;
     }
 
+    states.resize(kept);
 
-    // Recursive state clear
-    remove_state_recursive(target, states);
+    transitions_dirty = true;
+    event_interest_dirty = true;
 }
 
 void State_machine::clear_states()
@@ -286,80 +567,1586 @@ void State_machine::clear_states()
         s->children.clear(); // Remove the links on the childrens
     }
 
+    // Clear the index first: it holds raw pointers to the owned states
+    states_index.clear();
+
     // Clear an unique pointer
     states.clear();
 
-    // Nullptr current state
+    // Nullptr current state, the deferred request and the overlays
     current_state = nullptr;
+    pending_state = nullptr;
+    overlay_count = 0;
+    overlay_backdrop_valid = false;
+
+    region_count = 0;
+    active_count = 0;
+
+    transitions_dirty = true;
+    event_interest_dirty = true;
 }
 
-bool State_machine::go_to(const State_ID &id)
+void State_machine::perform_transition(State *target)
 {
-    // Search for the target state by ID
-    for (auto &s : states)
+    Dispatch_guard guard(dispatch_depth); // go_to() from the callbacks below is deferred
+
+#ifdef STATE_MACHINE_PROFILING
+    struct Transition_timer
     {
-        // Call exit callback on current state if exists
-        if (s->id == id)
+        State *target;
+        Transition_histogram &histogram;
+        std::uint64_t start = Engine_clock::now();
+
+        ~Transition_timer()
         {
-            if (current_state && current_state->on_exit) current_state->on_exit();
+            std::uint64_t ticks = Engine_clock::now() - start;
+
+            target->profile.transition.add(ticks);
+            histogram.add(ticks * 1000000 / Engine_clock::frequency());
+        }
+    } transition_timer{target, transition_histogram};
+#endif
+
+    // The frame we are leaving, while its states and overlays are still there
+    start_effect(target);
+
+    // Overlays belong to the frame of the state we are leaving
+    pop_all_overlays();
+
+    ++change_counter;
+
+    switch_leaf(current_state, target, transition_hook(current_state, target));
+
+    rebuild_active();
+}
+
+
+bool State_machine::go_to(const State_ID &id) { return go_to_target(id, false); }
+
+
+bool State_machine::go_to_target(const State_ID &id, bool own_effect)
+{
+    // Search for the target state by ID - single hash lookup,
+    // so the transition cost doesn't depend on the number of states
+    if (State *target = get_state(id))
+    {
+        // The subtree of a region - the region transition, the main state stays
+        const int r = find_region(target);
 
-            current_state = s.get(); // Switch to the new state
+        if (!check_transition(r >= 0 ? regions[r].leaf : current_state, target)) return false;
 
-            // Call enter callback on new state if exists
-            if (current_state->on_enter) current_state->on_enter();
+        // The newer main transition replaces the request of the frame - with its effect
+        if (r < 0 && !own_effect) has_next_effect = false;
 
-            
+        // Inside a state callback - defer to the frame boundary
+        if (dispatch_depth > 0)
+        {
+            (r >= 0 ? regions[r].pending : pending_state) = target;
             return true;
         }
+
+        // Performed now - a deferred request would override it at the frame boundary
+        (r >= 0 ? regions[r].pending : pending_state) = nullptr;
+
+        if (r >= 0) perform_region_transition(r, target);
+        else perform_transition(target);
+
+        return true;
     }
 
-    // State not found handler
-    std::cerr << "State not found: " << id.string() << "\n";
+    // State not found handler (the ID is formatted into the stack buffer)
+    char buf[State_ID::STRING_BUFFER_SIZE];
+    id.to_chars(buf, sizeof(buf));
+
+    LOG_ERROR("State not found: %s", buf);
 
     return false;
 }
 
 
-// Simply return pointer to the currently active state
+bool State_machine::go_to(const State_ID &id, Transition_effect with_effect, float seconds)
+{
+    // A refused call leaves the effect of the pending request as it was
+    const Transition_effect kept_effect = next_effect;
+    const float kept_seconds = next_effect_seconds;
+    const bool kept = has_next_effect;
 
-State *State_machine::get_current_state() const { return current_state; }
+    next_effect = with_effect;
+    next_effect_seconds = seconds;
+    has_next_effect = true;
+
+    const bool accepted = go_to_target(id, true);
+
+    if (!accepted)
+    {
+        next_effect = kept_effect;
+        next_effect_seconds = kept_seconds;
+        has_next_effect = kept;
+    }
 
+    // Performed or a region one - only a deferred main transition keeps it
+    else if (dispatch_depth == 0 || pending_state != get_state(id)) has_next_effect = false;
 
-// Using function pointer (std::function) in State allows flexible per-state behavior.
+    return accepted;
+}
 
-void State_machine::state_handle_event(SDL_Event &e)
+
+bool State_machine::request_go_to(const State_ID &id, Transition_effect with_effect, float seconds)
 {
-    if (current_state && current_state->state_handle_event) current_state->state_handle_event(e);
+    if (!request_go_to(id)) return false;
+
+    // The regions have no effects
+    if (pending_state == get_state(id))
+    {
+        next_effect = with_effect;
+        next_effect_seconds = seconds;
+        has_next_effect = true;
+    }
+
+    return true;
 }
 
 
-// Delegates all rendering to the current state.
-// Each state knows how to draw itself: menus, game objects, UI elements, text, etc.
-// The renderer is passed down so states can draw directly to the screen.
+bool State_machine::request_go_to(const State_ID &id)
+{
+    State *target = get_state(id);
+
+    if (!target)
+    {
+        char buf[State_ID::STRING_BUFFER_SIZE];
+        id.to_chars(buf, sizeof(buf));
+
+        LOG_ERROR("State not found: %s", buf);
+
+        return false;
+    }
 
-void State_machine::state_render(SDL_Renderer *r)
+    // Overwrite - only the last request of the frame survives (one per region)
+    const int r = find_region(target);
+
+    if (!check_transition(r >= 0 ? regions[r].leaf : current_state, target)) return false;
+
+    (r >= 0 ? regions[r].pending : pending_state) = target;
+
+    // The effect of the overwritten request isn't this one's (the effect overload sets its own)
+    if (r < 0) has_next_effect = false;
+
+    return true;
+}
+
+
+bool State_machine::apply_pending_transition()
+{
+    if (dispatch_depth > 0) return false;
+
+    bool performed = false;
+
+    // Take the request first: the callbacks may request the next one
+    if (State *target = pending_state)
+    {
+        pending_state = nullptr;
+
+        perform_transition(target);
+        performed = true;
+    }
+
+    for (int i = 0; i < region_count; ++i)
+    {
+        if (State *target = regions[i].pending)
+        {
+            regions[i].pending = nullptr;
+
+            perform_region_transition(i, target);
+            performed = true;
+        }
+    }
+
+    return performed;
+}
+
+
+bool State_machine::has_pending_transition() const
 {
-    if (current_state && current_state->state_render) current_state->state_render(r);
+    if (pending_state) return true;
+
+    for (int i = 0; i < region_count; ++i) if (regions[i].pending) return true;
+
+    return false;
 }
 
 
-// Updates the logic of the current state.
-// Only the current state is updated; parent or sibling states are ignored.
-// This keeps the update loop simple and local to the active state.
+// Public wrapper for the shutdown path - the regions first, the last added first
 
-void State_machine::state_update()
+void State_machine::exit_all()
 {
-    if (current_state && current_state->state_update) current_state->state_update();
+    while (region_count > 0) exit_region(region_count - 1);
+
+    exit_active_path();
 }
 
 
-// Returns the human-readable name of the current state.
-// If no state is active, returns "NONE".
-// Useful for debugging, logging, or conditional logic outside the state machine.
+// Simply return pointer to the currently active state
+
+State *State_machine::get_current_state() const { return current_state; }
+
+
+// Using function pointer (std::function) in State allows flexible per-state behavior,
+// the State_behavior hooks give the same flexibility for one virtual call.
+
+void State_machine::state_handle_event(SDL_Event &e)
+{
+    Dispatch_guard guard(dispatch_depth);
+
+    const Uint32 interest = event_interest_of(e.type);
+
+    // One pass over the active list - the top overlay captures the input of the main
+    // state (the state underneath is frozen), the regions get it independently
+    for (int i = 0; i < active_count; ++i)
+    {
+        State *receiver = active[i] == current_state ? visible_main() : active[i];
+
+        // Not subscribed or not initialized yet - no handler call
+        if (!(receiver->event_interest & interest) || is_path_loading(receiver)) continue;
+
+        SM_PROFILE_SCOPE(receiver, handle_event);
+
+        receiver->run_handle_event(e);
+    }
+}
+
+
+// === EVENT INTEREST ===
+
+Uint32 State_machine::get_event_interest()
+{
+    if (!event_interest_dirty) return event_interest;
+
+    // The states without a handler never get an event - their interest doesn't count
+    Uint32 wanted = EVENT_DEFAULT;
+
+    for (const State_ptr &s : states)
+        if (s->behavior || s->state_handle_event) wanted |= s->event_interest;
+
+    event_interest = wanted;
+    event_interest_dirty = false;
+
+    return event_interest;
+}
+
+
+void State_machine::refresh_event_interest() { event_interest_dirty = true; }
+
+
+Uint32 State_machine::event_interest_of(Uint32 type)
+{
+    switch (type)
+    {
+        case SDL_KEYDOWN:
+        case SDL_KEYUP:
+        case SDL_JOYBUTTONDOWN:
+        case SDL_JOYBUTTONUP:
+        case SDL_JOYHATMOTION:
+        case SDL_CONTROLLERBUTTONDOWN:
+        case SDL_CONTROLLERBUTTONUP:
+            return EVENT_BUTTONS;
+
+        case SDL_TEXTEDITING:
+        case SDL_TEXTINPUT:
+        case SDL_KEYMAPCHANGED:
+            return EVENT_TEXT;
+
+        case SDL_QUIT:
+        case SDL_WINDOWEVENT:
+        case SDL_DISPLAYEVENT:
+        case SDL_RENDER_TARGETS_RESET:
+        case SDL_RENDER_DEVICE_RESET:
+        case SDL_APP_TERMINATING:
+        case SDL_APP_LOWMEMORY:
+        case SDL_APP_WILLENTERBACKGROUND:
+        case SDL_APP_DIDENTERBACKGROUND:
+        case SDL_APP_WILLENTERFOREGROUND:
+        case SDL_APP_DIDENTERFOREGROUND:
+            return EVENT_WINDOW;
+
+        case SDL_JOYAXISMOTION:
+        case SDL_JOYBALLMOTION:
+        case SDL_JOYDEVICEADDED:
+        case SDL_JOYDEVICEREMOVED:
+        case SDL_CONTROLLERAXISMOTION:
+        case SDL_CONTROLLERDEVICEADDED:
+        case SDL_CONTROLLERDEVICEREMOVED:
+        case SDL_CONTROLLERDEVICEREMAPPED:
+        case SDL_SENSORUPDATE:
+            return EVENT_CONTROLLER;
+
+        case SDL_MOUSEMOTION:
+        case SDL_MOUSEBUTTONDOWN:
+        case SDL_MOUSEBUTTONUP:
+        case SDL_MOUSEWHEEL:
+        case SDL_FINGERDOWN:
+        case SDL_FINGERUP:
+        case SDL_FINGERMOTION:
+        case SDL_MULTIGESTURE:
+        case SDL_DOLLARGESTURE:
+        case SDL_DOLLARRECORD:
+            return EVENT_POINTER;
+
+        default:
+            return EVENT_OTHER;
+    }
+}
+
+// === EVENT INTEREST ===
+
+
+// Delegates all rendering to the current state.
+// Each state knows how to draw itself: menus, game objects, UI elements, text, etc.
+// The renderer is passed down so states can draw directly to the screen.
+
+void State_machine::state_render(SDL_Renderer *r, float alpha)
+{
+    Dispatch_guard guard(dispatch_depth);
+
+    render_alpha = alpha;
+
+    // Back to front in the region order - each one is drawn over the ones before it
+    for (int i = 0; i < active_count; ++i)
+    {
+        if (active[i] != current_state)
+        {
+            SM_PROFILE_SCOPE(active[i], render);
+
+            if (is_path_loading(active[i])) render_loading(r, active[i]);
+            else
+            {
+                render_propagated(i, r);
+                render_and_submit(active[i], r, alpha);
+            }
+
+            continue;
+        }
+
+        SM_PROFILE_SCOPE(visible_main(), render);
+
+        // The entered state isn't ready - the frame it was entered from stays, the effect waits
+        if (is_path_loading(current_state))
+        {
+            if (effect_frame)
+            {
+                SDL_SetTextureAlphaMod(effect_frame, 255);
+                Render::copy(r, effect_frame, nullptr, nullptr);
+            }
+
+            render_loading(r, current_state);
+            continue;
+        }
+
+        render_main(r);
+
+        // The old frame over the new state - the regions above the main state stay on top
+        if (effect != Transition_effect::NONE) render_effect(r);
+    }
+
+    effect_renderer = r;
+}
+
+
+void State_machine::render_main(SDL_Renderer *r)
+{
+    if (overlay_count > 0)
+    {
+        // Backdrop is rendered once per push, then it is a single texture copy per frame.
+        // Without render target support the underlying states are rendered live.
+        if (overlay_backdrop_valid || capture_backdrop(r))
+            Render::copy(r, overlay_backdrop, nullptr, nullptr);
+        else
+            render_underlying(r);
+    }
+
+    // A loading overlay over the backdrop - its loading hooks only
+    if (visible_main()->loading) render_loading(r, visible_main());
+    else
+    {
+        render_propagated(main_entry, r);
+        render_and_submit(visible_main(), r, render_alpha);
+    }
+}
+
+
+void State_machine::render_propagated(int entry, SDL_Renderer *r)
+{
+    if (entry < 0) return;
+
+    for (int p = propagation_first[entry]; p < propagation_first[entry + 1]; ++p)
+    {
+        SM_PROFILE_SCOPE(propagation[p], render);
+
+        render_and_submit(propagation[p], r, render_alpha);
+    }
+}
+
+
+float State_machine::get_render_alpha() const { return render_alpha; }
+
+
+std::uint64_t State_machine::get_change_counter() const { return change_counter; }
+
+
+bool State_machine::needs_continuous_redraw() const
+{
+    if (effect != Transition_effect::NONE || is_loading()) return true;
+
+    for (int i = 0; i < active_count; ++i)
+    {
+        const State *visible = active[i] == current_state ? visible_main() : active[i];
+
+        if (!visible->tracks_damage && !visible->is_static) return true;
+    }
+
+    return false;
+}
+
+
+bool State_machine::can_idle() const
+{
+    if (active_count == 0 || has_pending_transition() || effect != Transition_effect::NONE || is_loading()) return false;
+
+    for (int i = 0; i < active_count; ++i)
+    {
+        const State *visible = active[i] == current_state ? visible_main() : active[i];
+
+        if (!visible->is_static) return false;
+    }
+
+    return true;
+}
+
+
+bool State_machine::is_pipelined() const
+{
+    // The regions are updated in the same pass on the main thread
+    // The propagating ancestors are updated on the main thread too
+    return overlay_count == 0 && region_count == 0 && current_state && current_state->behavior &&
+           current_state->behavior->is_pipelined() && !is_path_loading(current_state) &&
+           propagation_first[main_entry + 1] == propagation_first[main_entry];
+}
+
+
+void State_machine::publish_render_state()
+{
+    if (is_pipelined()) current_state->behavior->publish_render_state();
+}
+
+
+// Updates the logic of the active leaves - the current state and one per region, each after
+// its propagating ancestors (root first). The other parents and the siblings are ignored, the
+// flat active list and the flat propagation list keep the pass linear.
+
+void State_machine::state_update(bool input_edge)
+{
+    Dispatch_guard guard(dispatch_depth);
+
+    ++update_tick;
+
+    for (int i = 0; i < active_count; ++i)
+    {
+        // Only the top overlay is updated - the underlying frame stays as it was captured
+        State *updated = active[i] == current_state ? visible_main() : active[i];
+
+        // Interactive once its initialization is complete
+        if (is_path_loading(updated)) continue;
+
+        const int divisor = updated->update_divisor;
+
+        if (divisor > 1)
+        {
+            const std::uint64_t elapsed = update_tick - updated->last_update_tick;
+
+            // Phase by the dense index - the slow states of one rate take turns
+            const bool due = (update_tick + static_cast<std::uint64_t>(updated->index)) % static_cast<std::uint64_t>(divisor) == 0;
+
+            // The first update after the start or a long inactivity isn't delayed
+            if (!due && !input_edge && updated->last_update_tick != 0 && elapsed < static_cast<std::uint64_t>(divisor)) continue;
+
+            updated->update_ticks = elapsed < static_cast<std::uint64_t>(divisor) ? static_cast<int>(elapsed) : divisor;
+        }
+        else updated->update_ticks = 1;
+
+        updated->last_update_tick = update_tick;
+
+        // The ancestors on the tick of the leaf, with its time step
+        for (int p = propagation_first[i]; p < propagation_first[i + 1]; ++p)
+        {
+            State *ancestor = propagation[p];
+
+            ancestor->update_ticks = updated->update_ticks;
+            ancestor->last_update_tick = update_tick;
+
+            SM_PROFILE_SCOPE(ancestor, update);
+
+            ancestor->run_update();
+        }
+
+        SM_PROFILE_SCOPE(updated, update);
+
+        updated->run_update();
+    }
+}
+
+
+// === REGIONS ===
+
+bool State_machine::add_region(const State_ID &id, int order)
+{
+    State *target = get_state(id);
+
+    if (!target || region_count >= MAX_REGIONS)
+    {
+        LOG_ERROR("Can't add region (unknown ID or all %d regions are used)", MAX_REGIONS);
+        return false;
+    }
+
+    // The root is the region - two active paths in one subtree aren't orthogonal
+    if (find_region(target) >= 0 || (current_state && current_state->path[0] == target->path[0]))
+    {
+        LOG_ERROR("Can't add region %s - its root is already active", target->label);
+        return false;
+    }
+
+    Region &region = regions[region_count++];
+
+    region.leaf = nullptr;
+    region.pending = nullptr;
+    region.order = order;
+
+    ++change_counter;
+
+    {
+        Dispatch_guard guard(dispatch_depth);
+
+        switch_leaf(region.leaf, target);
+    }
+
+    rebuild_active();
+
+    return true;
+}
+
+
+bool State_machine::remove_region(const State_ID &id)
+{
+    State *state = get_state(id);
+
+    const int r = state ? find_region(state) : -1;
+
+    if (r < 0) return false;
+
+    exit_region(r);
+
+    return true;
+}
+
+
+int State_machine::get_region_count() const { return region_count; }
+
+
+State *State_machine::get_region_state(int region) const
+{
+    return region >= 0 && region < region_count ? regions[region].leaf : nullptr;
+}
+
+
+int State_machine::get_active_count() const { return active_count; }
+
+
+State *State_machine::get_active_state(int index) const
+{
+    return index >= 0 && index < active_count ? active[index] : nullptr;
+}
+
+
+int State_machine::find_region(const State *state) const
+{
+    for (int i = 0; i < region_count; ++i)
+        if (regions[i].leaf->path[0] == state->path[0]) return i;
+
+    return -1;
+}
+
+
+void State_machine::perform_region_transition(int region, State *target)
+{
+    Dispatch_guard guard(dispatch_depth);
+
+    ++change_counter;
+
+    switch_leaf(regions[region].leaf, target, transition_hook(regions[region].leaf, target));
+
+    rebuild_active();
+}
+
+
+void State_machine::exit_region(int region)
+{
+    State *leaf = regions[region].leaf;
+
+    // The slots above move down - the order of the rest is kept
+    for (int i = region; i < region_count - 1; ++i) regions[i] = regions[i + 1];
+
+    --region_count;
+    ++change_counter;
+
+    {
+        Dispatch_guard guard(dispatch_depth);
+
+        for (int i = leaf->path_depth - 1; i >= 0; --i) exit_state(leaf->path[i]);
+    }
+
+    rebuild_active();
+}
+
+
+void State_machine::rebuild_active()
+{
+    active_count = 0;
+
+    // Insertion by the order - the main state is order 0, the regions of the same order
+    // follow the earlier ones (and the main state), at most 1 + MAX_REGIONS entries
+    auto insert = [this](State *state, int order)
+    {
+        int i = active_count++;
+
+        for (; i > 0 && active_order[i - 1] > order; --i)
+        {
+            active[i] = active[i - 1];
+            active_order[i] = active_order[i - 1];
+        }
+
+        active[i] = state;
+        active_order[i] = order;
+    };
+
+    if (current_state) insert(current_state, 0);
+
+    for (int i = 0; i < region_count; ++i) insert(regions[i].leaf, regions[i].order);
+
+    rebuild_propagation();
+}
+
+
+void State_machine::rebuild_propagation()
+{
+    int count = 0;
+
+    main_entry = -1;
+
+    for (int i = 0; i < active_count; ++i)
+    {
+        propagation_first[i] = count;
+
+        State *leaf = active[i];
+        int first = 0;
+
+        if (leaf == current_state)
+        {
+            main_entry = i;
+
+            if (overlay_count > 0)
+            {
+                leaf = overlays[overlay_count - 1];
+                first = levels_below(overlay_count - 1);
+            }
+        }
+
+        // The leaf itself is the last level of its path
+        for (int level = first; level < leaf->path_depth - 1; ++level)
+            if (leaf->path[level]->propagates) propagation[count++] = leaf->path[level];
+    }
+
+    propagation_first[active_count] = count;
+}
+
+
+int State_machine::levels_below(int overlay) const
+{
+    int shared = current_state ? common_levels(overlays[overlay], current_state) : 0;
+
+    for (int i = 0; i < overlay; ++i) shared = std::max(shared, common_levels(overlays[overlay], overlays[i]));
+
+    return shared;
+}
+
+
+State *State_machine::visible_main() const { return overlay_count > 0 ? overlays[overlay_count - 1] : current_state; }
+
+// === REGIONS ===
+
+
+// === TRANSITION TABLE ===
+
+void State_machine::set_transitions(const Transition_edge *edges, std::size_t count)
+{
+    transition_edges.assign(edges, edges + count);
+    transitions_dirty = true;
+}
+
+
+void State_machine::clear_transitions()
+{
+    transition_edges.clear();
+    transition_bits.clear();
+    transition_special.clear();
+    transitions_dirty = false;
+}
+
+
+bool State_machine::has_transitions() const { return !transition_edges.empty(); }
+
+
+bool State_machine::can_go_to(const State_ID &id)
+{
+    State *target = get_state(id);
+
+    if (!target) return false;
+
+    const int r = find_region(target);
+
+    return is_transition_allowed(r >= 0 ? regions[r].leaf : current_state, target);
+}
+
+
+// Rows of the declared edges, then every state gets the rows of its ancestors (an edge
+// from GAME is valid from all of its substates) and the "from any" row - O(n * depth) words
+
+void State_machine::compile_transitions()
+{
+    const std::size_t count = states.size();
+
+    transition_words = (count + 63) / 64;
+
+    std::vector<std::uint64_t> declared(count * transition_words, 0);
+    std::vector<std::uint64_t> declared_special(count * transition_words, 0);
+    std::vector<std::uint64_t> any(transition_words, 0);
+    std::vector<std::uint64_t> any_special(transition_words, 0);
+
+    for (const Transition_edge &edge : transition_edges)
+    {
+        const State *to = get_state(edge.to);
+        const State *from = edge.from == State_ID() ? nullptr : get_state(edge.from);
+
+        if (!to || (!from && edge.from != State_ID()))
+        {
+            char from_buf[State_ID::STRING_BUFFER_SIZE], to_buf[State_ID::STRING_BUFFER_SIZE];
+            edge.from.to_chars(from_buf, sizeof(from_buf));
+            edge.to.to_chars(to_buf, sizeof(to_buf));
+
+            LOG_ERROR("Transition table: unknown state in the edge %s -> %s", from_buf, to_buf);
+            continue;
+        }
+
+        const std::size_t word = static_cast<std::size_t>(to->index) >> 6;
+        const std::uint64_t bit = std::uint64_t{1} << (to->index & 63);
+        const bool special = edge.guard || edge.hook;
+
+        std::uint64_t *row = from ? &declared[from->index * transition_words] : any.data();
+        std::uint64_t *special_row = from ? &declared_special[from->index * transition_words] : any_special.data();
+
+        row[word] |= bit;
+        if (special) special_row[word] |= bit;
+    }
+
+    transition_bits.assign(count * transition_words, 0);
+    transition_special.assign(count * transition_words, 0);
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const State *s = states[i].get();
+
+        std::uint64_t *row = &transition_bits[i * transition_words];
+        std::uint64_t *special_row = &transition_special[i * transition_words];
+
+        for (std::size_t w = 0; w < transition_words; ++w)
+        {
+            row[w] = any[w];
+            special_row[w] = any_special[w];
+        }
+
+        for (int d = 0; d < s->path_depth; ++d)
+        {
+            const std::size_t a = static_cast<std::size_t>(s->path[d]->index) * transition_words;
+
+            for (std::size_t w = 0; w < transition_words; ++w)
+            {
+                row[w] |= declared[a + w];
+                special_row[w] |= declared_special[a + w];
+            }
+        }
+    }
+
+    transitions_dirty = false;
+}
+
+
+// The declared edge, which covers the pair: the nearest ancestor of the source first, "from any" last
+
+const Transition_edge *State_machine::find_edge(const State *from, const State *to) const
+{
+    for (int d = from->path_depth - 1; d >= -1; --d)
+    {
+        const State_ID source = d >= 0 ? from->path[d]->id : State_ID();
+
+        for (const Transition_edge &edge : transition_edges)
+            if (edge.from == source && edge.to == to->id) return &edge;
+    }
+
+    return nullptr;
+}
+
+
+bool State_machine::is_transition_allowed(const State *from, const State *to)
+{
+    // No table, or the first state of the machine (or of the region)
+    if (transition_edges.empty() || !from) return true;
+
+    if (transitions_dirty) compile_transitions();
+
+    const std::size_t row = static_cast<std::size_t>(from->index) * transition_words + (static_cast<std::size_t>(to->index) >> 6);
+    const std::uint64_t bit = std::uint64_t{1} << (to->index & 63);
+
+    if (!(transition_bits[row] & bit)) return false;
+
+    // Only the guarded edges look the edge up
+    if (transition_special[row] & bit)
+    {
+        const Transition_edge *edge = find_edge(from, to);
+
+        if (edge && edge->guard && !edge->guard(*from, *to)) return false;
+    }
+
+    return true;
+}
+
+
+bool State_machine::check_transition(const State *from, const State *to)
+{
+    if (is_transition_allowed(from, to)) return true;
+
+    LOG_ERROR("Transition %s -> %s is not allowed by the transition table", from->label, to->label);
+
+    return false;
+}
+
+
+Transition_hook State_machine::transition_hook(const State *from, const State *to)
+{
+    if (transition_edges.empty() || !from) return nullptr;
+
+    if (transitions_dirty) compile_transitions();
+
+    const std::size_t row = static_cast<std::size_t>(from->index) * transition_words + (static_cast<std::size_t>(to->index) >> 6);
+
+    if (!(transition_special[row] & (std::uint64_t{1} << (to->index & 63)))) return nullptr;
+
+    const Transition_edge *edge = find_edge(from, to);
+
+    return edge ? edge->hook : nullptr;
+}
+
+// === TRANSITION TABLE ===
+
+
+// === SNAPSHOT ===
+
+// "SMSN", version, the current ID (0 - nothing to resume), the overlays, the regions,
+// the state records (ID, length, bytes) - all little-endian
+static constexpr std::uint8_t SNAPSHOT_MAGIC[4] = {'S', 'M', 'S', 'N'};
+static constexpr std::uint16_t SNAPSHOT_VERSION = 1;
+
+static void put_bytes(std::vector<std::uint8_t> &out, std::uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; ++i) out.push_back(static_cast<std::uint8_t>(value >> (i * 8)));
+}
+
+// Bounds-checked little-endian reader - a short read fails once and stays failed
+struct Snapshot_reader
+{
+    const std::uint8_t *data;
+    std::size_t size;
+    std::size_t pos = 0;
+    bool ok = true;
+
+    std::uint64_t get(int bytes)
+    {
+        if (!ok || size - pos < static_cast<std::size_t>(bytes)) { ok = false; return 0; }
+
+        std::uint64_t value = 0;
+
+        for (int i = 0; i < bytes; ++i) value |= std::uint64_t{data[pos++]} << (i * 8);
+
+        return value;
+    }
+};
+
+
+bool State_machine::save_snapshot(std::vector<std::uint8_t> &out)
+{
+    // A half-initialized state has no data to write - its steps finish first
+    finish_loading();
+
+    out.clear();
+
+    for (std::uint8_t b : SNAPSHOT_MAGIC) put_bytes(out, b, 1);
+    put_bytes(out, SNAPSHOT_VERSION, 2);
+
+    if (!current_state || !current_state->resumable)
+    {
+        put_bytes(out, 0, 8);
+        return false;
+    }
+
+    put_bytes(out, current_state->id.raw(), 8);
+
+    int overlays_kept = 0;
+
+    while (overlays_kept < overlay_count && overlays[overlays_kept]->resumable) ++overlays_kept;
+
+    put_bytes(out, static_cast<std::uint64_t>(overlays_kept), 1);
+
+    for (int i = 0; i < overlays_kept; ++i) put_bytes(out, overlays[i]->id.raw(), 8);
+
+    int regions_kept = 0;
+
+    while (regions_kept < region_count && regions[regions_kept].leaf->resumable) ++regions_kept;
+
+    put_bytes(out, static_cast<std::uint64_t>(regions_kept), 1);
+
+    for (int i = 0; i < regions_kept; ++i)
+    {
+        put_bytes(out, regions[i].leaf->id.raw(), 8);
+        put_bytes(out, static_cast<std::uint32_t>(regions[i].order), 4);
+    }
+
+    // Record count is patched after the records - the empty ones aren't written
+    const std::size_t count_pos = out.size();
+    int records = 0;
+
+    put_bytes(out, 0, 2);
+
+    auto record = [&](State *state)
+    {
+        snapshot_scratch.clear();
+        state->run_save_snapshot(snapshot_scratch);
+
+        if (snapshot_scratch.empty()) return;
+
+        put_bytes(out, state->id.raw(), 8);
+        put_bytes(out, snapshot_scratch.size(), 4);
+        out.insert(out.end(), snapshot_scratch.begin(), snapshot_scratch.end());
+
+        ++records;
+    };
+
+    {
+        Dispatch_guard guard(dispatch_depth);
+
+        // Root first - the restore gives the data in the same order
+        for (int i = 0; i < current_state->path_depth; ++i) record(current_state->path[i]);
+
+        for (int i = 0; i < overlays_kept; ++i) record(overlays[i]);
+
+        for (int r = 0; r < regions_kept; ++r)
+            for (int i = 0; i < regions[r].leaf->path_depth; ++i) record(regions[r].leaf->path[i]);
+    }
+
+    out[count_pos] = static_cast<std::uint8_t>(records);
+    out[count_pos + 1] = static_cast<std::uint8_t>(records >> 8);
+
+    return true;
+}
+
+
+bool State_machine::restore_snapshot(const std::uint8_t *data, std::size_t size)
+{
+    if (dispatch_depth > 0)
+    {
+        LOG_ERROR("Snapshot can't be restored from a state callback");
+        return false;
+    }
+
+    if (!data || size < 6 || std::memcmp(data, SNAPSHOT_MAGIC, 4) != 0) return false;
+
+    Snapshot_reader in{data, size, 4};
+
+    if (in.get(2) != SNAPSHOT_VERSION)
+    {
+        LOG_ERROR("Snapshot version mismatch - not restored");
+        return false;
+    }
+
+    // Empty snapshot - the suspended configuration wasn't resumable
+    State *target = get_state(State_ID::from_raw(in.get(8)));
+
+    if (!target || !in.ok) return false;
+
+    State *overlay_states[MAX_OVERLAYS] = {};
+    const int overlays_saved = static_cast<int>(in.get(1));
+
+    if (overlays_saved > MAX_OVERLAYS) return false;
+
+    for (int i = 0; i < overlays_saved; ++i)
+        if (!(overlay_states[i] = get_state(State_ID::from_raw(in.get(8))))) return false;
+
+    Region region_states[MAX_REGIONS] = {};
+    const int regions_saved = static_cast<int>(in.get(1));
+
+    if (regions_saved > MAX_REGIONS) return false;
+
+    for (int i = 0; i < regions_saved; ++i)
+    {
+        if (!(region_states[i].leaf = get_state(State_ID::from_raw(in.get(8))))) return false;
+
+        region_states[i].order = static_cast<std::int32_t>(in.get(4));
+    }
+
+    // The records are checked before anything changes, their bytes are read after the entering
+    const std::size_t records_pos = in.pos;
+    const int records = static_cast<int>(in.get(2));
+
+    for (int i = 0; i < records && in.ok; ++i)
+    {
+        in.get(8);
+        const std::uint64_t length = in.get(4);
+
+        if (length > in.size - in.pos) in.ok = false;
+        else in.pos += static_cast<std::size_t>(length);
+    }
+
+    if (!in.ok)
+    {
+        LOG_ERROR("Snapshot is truncated - not restored");
+        return false;
+    }
+
+    // The configuration is replaced as a whole
+    pending_state = nullptr;
+    pop_all_overlays();
+
+    while (region_count > 0) exit_region(region_count - 1);
+
+    perform_transition(target);
+
+    for (int i = 0; i < overlays_saved; ++i) push_overlay(overlay_states[i]->id);
+    for (int i = 0; i < regions_saved; ++i) add_region(region_states[i].leaf->id, region_states[i].order);
+
+    // The data goes into the initialized states
+    finish_loading();
+
+    in.pos = records_pos + 2;
+
+    Dispatch_guard guard(dispatch_depth);
+
+    for (int i = 0; i < records; ++i)
+    {
+        State *state = get_state(State_ID::from_raw(in.get(8)));
+        const std::size_t length = static_cast<std::size_t>(in.get(4));
+
+        snapshot_scratch.assign(data + in.pos, data + in.pos + length);
+        in.pos += length;
+
+        // A state gone from the tree since the suspend - its data is skipped
+        if (state && !state->run_restore_snapshot(snapshot_scratch))
+            LOG_ERROR("State %s rejected its snapshot data", state->label);
+    }
+
+    return true;
+}
+
+// === SNAPSHOT ===
+
+
+// === OVERLAYS ===
+
+bool State_machine::push_overlay(const State_ID &id)
+{
+    State *overlay = get_state(id);
+
+    if (!overlay || overlay_count >= MAX_OVERLAYS)
+    {
+        LOG_ERROR("Can't push overlay state (unknown ID or full overlay stack)");
+        return false;
+    }
+
+    overlays[overlay_count++] = overlay;
+    overlay_backdrop_valid = false; // The state below the new top changed
+    ++change_counter;
+
+    rebuild_propagation();
+
+    Dispatch_guard guard(dispatch_depth);
+    enter_state(overlay);
+
+    return true;
+}
+
+
+bool State_machine::pop_overlay()
+{
+    if (overlay_count == 0) return false;
+
+    State *overlay = overlays[--overlay_count];
+    overlay_backdrop_valid = false;
+
+    // No overlay left to show the backdrop under - back to the pool
+    if (overlay_count == 0)
+    {
+        Render_target_pool::Instance().release(overlay_backdrop);
+        overlay_backdrop = nullptr;
+    }
+    ++change_counter;
+
+    rebuild_propagation();
+
+    Dispatch_guard guard(dispatch_depth);
+    exit_state(overlay);
+
+    return true;
+}
+
+
+void State_machine::pop_all_overlays() { while (pop_overlay()) {} }
+
+
+State *State_machine::get_top_overlay() const { return overlay_count > 0 ? overlays[overlay_count - 1] : nullptr; }
+
+
+int State_machine::get_overlay_count() const { return overlay_count; }
+
+
+void State_machine::invalidate_overlay_backdrop() { overlay_backdrop_valid = false; }
+
+
+void State_machine::release_render_resources()
+{
+    Render_target_pool::Instance().release(overlay_backdrop);
+    Render_target_pool::Instance().release(effect_frame);
+
+    overlay_backdrop = nullptr;
+    overlay_backdrop_valid = false;
+
+    effect_frame = nullptr;
+    effect = Transition_effect::NONE;
+}
+
+
+// Everything below the top overlay in the bottom-up order
+
+void State_machine::render_underlying(SDL_Renderer *r)
+{
+    if (current_state) render_with_ancestors(current_state, 0, r, render_alpha);
+
+    for (int i = 0; i < overlay_count - 1; ++i) render_with_ancestors(overlays[i], levels_below(i), r, render_alpha);
+}
+
+
+bool State_machine::capture_backdrop(SDL_Renderer *r)
+{
+    if (!SDL_RenderTargetSupported(r)) return false;
+
+    // The size of the pass - a reduced frame target (the dynamic resolution) still draws the logical one
+    int w = 0, h = 0;
+    Frame::Instance().get_logical_size(w, h);
+
+    if (w <= 0 || h <= 0) SDL_GetRendererOutputSize(r, &w, &h);
+
+    // (Re)create the target texture only if the output size changed
+    if (overlay_backdrop)
+    {
+        int tw = 0, th = 0;
+        SDL_QueryTexture(overlay_backdrop, nullptr, nullptr, &tw, &th);
+
+        if (tw != w || th != h) release_render_resources();
+    }
+
+    if (!overlay_backdrop)
+    {
+        overlay_backdrop = Render_target_pool::Instance().acquire(r, w, h, Frame::Instance().get_target_format());
+
+        if (!overlay_backdrop)
+        {
+            SDL_Log("Overlay backdrop creation failed: %s", SDL_GetError());
+            return false;
+        }
+    }
+
+    // Render the underlying frame into the texture once
+    SDL_Texture *prev_target = SDL_GetRenderTarget(r);
+
+    Render::set_target(r, overlay_backdrop);
+    SDL_SetRenderDrawColor(r, 0, 0, 0, 255);
+    Render::clear(r);
+
+    render_underlying(r);
+
+    Render::set_target(r, prev_target);
+
+    overlay_backdrop_valid = true;
+    return true;
+}
+
+// === OVERLAYS ===
+
+
+// === TRANSITION EFFECT ===
+
+bool State_machine::is_effect_running() const { return effect != Transition_effect::NONE; }
+
+
+void State_machine::start_effect(State *target)
+{
+    const Transition_effect wanted = has_next_effect ? next_effect : target->enter_effect;
+    const float seconds = has_next_effect ? next_effect_seconds : target->enter_effect_seconds;
+
+    has_next_effect = false;
+    effect = Transition_effect::NONE;
+
+    const bool animated = wanted != Transition_effect::NONE && seconds > 0.0f && effects_enabled;
+
+    // A state entered with a time-sliced initialization shows the captured frame until it is ready
+    // (switch_leaf() enters the path below the LCA, the target alone on a re-entry)
+    bool held = false;
+
+    if (current_state == target) held = target->has_enter_step();
+    else for (int i = 0; i < target->path_depth && !held; ++i)
+        held = target->path[i]->has_enter_step() && !(current_state && i < current_state->path_depth && current_state->path[i] == target->path[i]);
+
+    // Nothing to capture for, nothing on the screen yet, or the target pass can't hold a captured frame
+    if ((!animated && !held) || !current_state || !effect_renderer) return;
+
+    SDL_Renderer *r = effect_renderer;
+
+    if (Frame::Instance().is_partial_redraw() || !SDL_RenderTargetSupported(r)) return;
+
+    // Outside of the frame pass - the size of the pass, not of the output
+    int w = 0, h = 0;
+    Frame::Instance().get_logical_size(w, h);
+
+    if (w <= 0 || h <= 0) SDL_GetRendererOutputSize(r, &w, &h);
+
+    if (effect_frame)
+    {
+        int tw = 0, th = 0;
+        SDL_QueryTexture(effect_frame, nullptr, nullptr, &tw, &th);
+
+        if (tw != w || th != h)
+        {
+            Render_target_pool::Instance().release(effect_frame);
+            effect_frame = nullptr;
+        }
+    }
+
+    if (!effect_frame)
+    {
+        effect_frame = Render_target_pool::Instance().acquire(r, w, h, Frame::Instance().get_target_format());
+
+        if (!effect_frame)
+        {
+            SDL_Log("Transition effect frame creation failed: %s", SDL_GetError());
+            return;
+        }
+
+        SDL_SetTextureBlendMode(effect_frame, SDL_BLENDMODE_BLEND);
+    }
+
+    // The last look of the leaving states, rendered once
+    SDL_Texture *prev_target = SDL_GetRenderTarget(r);
+
+    Render::set_target(r, effect_frame);
+    SDL_SetRenderDrawColor(r, 0, 0, 0, 255);
+    Render::clear(r);
+
+    render_main(r);
+
+    Render::set_target(r, prev_target);
+
+    // Held only - released by end_loading()
+    effect = animated ? wanted : Transition_effect::NONE;
+    effect_seconds = seconds;
+    effect_start = Engine_clock::time.real_time;
+}
+
+
+void State_machine::render_effect(SDL_Renderer *r)
+{
+    const float t = static_cast<float>((Engine_clock::time.real_time - effect_start) / effect_seconds);
+
+    if (t >= 1.0f || !effect_frame)
+    {
+        // The capture is idle until the next transition - the pool may lend it meanwhile
+        Render_target_pool::Instance().release(effect_frame);
+        effect_frame = nullptr;
+
+        effect = Transition_effect::NONE;
+        return;
+    }
+
+    int w = 0, h = 0;
+    SDL_QueryTexture(effect_frame, nullptr, nullptr, &w, &h);
+
+    // Moved or cut copy of the whole old frame - one quad, the clipping is the renderer's
+    SDL_Rect src = {0, 0, w, h};
+    SDL_Rect dst = {0, 0, w, h};
+
+    const int dx = static_cast<int>(t * static_cast<float>(w));
+    const int dy = static_cast<int>(t * static_cast<float>(h));
+
+    Uint8 alpha = 255;
+
+    switch (effect)
+    {
+        case Transition_effect::FADE:        alpha = static_cast<Uint8>(255.0f * (1.0f - t)); break;
+        case Transition_effect::SLIDE_LEFT:  dst.x = -dx; break;
+        case Transition_effect::SLIDE_RIGHT: dst.x = dx; break;
+        case Transition_effect::SLIDE_UP:    dst.y = -dy; break;
+        case Transition_effect::SLIDE_DOWN:  dst.y = dy; break;
+        case Transition_effect::WIPE_LEFT:   src.x = dst.x = dx; src.w = dst.w = w - dx; break;
+        case Transition_effect::WIPE_RIGHT:  src.w = dst.w = w - dx; break;
+        case Transition_effect::NONE:        break;
+    }
+
+    SDL_SetTextureAlphaMod(effect_frame, alpha);
+
+    Render::copy(r, effect_frame, &src, &dst);
+}
+
+// === TRANSITION EFFECT ===
+
+
+// === TIME-SLICED ENTER ===
+
+// Steps of the loading states on the path, root first - false if one is left incomplete
+static bool step_path(State *state, Uint64 start, double budget_seconds)
+{
+    for (int i = 0; i < state->path_depth; ++i)
+    {
+        State *s = state->path[i];
+
+        if (!s->loading) continue;
+
+        const double left = budget_seconds - Engine_clock::to_seconds(Engine_clock::now() - start);
+
+        // No time left - the rest waits for the next frame
+        if (left <= 0.0 || !s->run_enter_step(left)) return false;
+
+        s->loading = false;
+    }
+
+    return true;
+}
+
+
+bool State_machine::step_loading(double budget_seconds)
+{
+    if (!is_loading()) return true;
+
+    const Uint64 start = Engine_clock::now();
+
+    bool complete = true;
+
+    {
+        Dispatch_guard guard(dispatch_depth); // go_to() from the steps is deferred
+
+        for (int i = 0; i < active_count && complete; ++i) complete = step_path(active[i], start, budget_seconds);
+
+        // An overlay's path is the main one - only the overlay itself is left
+        for (int i = 0; i < overlay_count && complete; ++i) complete = step_path(overlays[i], start, budget_seconds);
+    }
+
+    if (complete) end_loading();
+
+    return complete;
+}
+
+
+void State_machine::finish_loading()
+{
+    // A step always gets a whole second - a step which never completes hangs here, not per frame
+    while (!step_loading(1.0)) {}
+}
+
+
+bool State_machine::is_loading() const
+{
+    for (int i = 0; i < active_count; ++i) if (is_path_loading(active[i])) return true;
+
+    for (int i = 0; i < overlay_count; ++i) if (overlays[i]->loading) return true;
+
+    return false;
+}
+
+
+void State_machine::render_loading(SDL_Renderer *r, State *state)
+{
+    for (int i = 0; i < state->path_depth; ++i)
+        if (state->path[i]->loading) state->path[i]->run_render_loading(r);
+
+    Render_queue::Instance().submit(r);
+}
+
+
+void State_machine::end_loading()
+{
+    ++change_counter;
+
+    // The effect starts from the ready state, not from the entry
+    effect_start = Engine_clock::time.real_time;
+
+    if (effect == Transition_effect::NONE && effect_frame)
+    {
+        Render_target_pool::Instance().release(effect_frame);
+        effect_frame = nullptr;
+    }
+
+    // The damage-tracked states draw their first ready frame
+    Frame::Instance().mark_dirty();
+}
+
+// === TIME-SLICED ENTER ===
+
+
+// === PROFILING ===
+
+#ifdef STATE_MACHINE_PROFILING
+
+const State_profile *State_machine::get_state_profile(const State_ID &state_id) const
+{
+    auto it = states_index.find(state_id);
+
+    return it != states_index.end() ? &it->second->profile : nullptr;
+}
+
+
+const Transition_histogram &State_machine::get_transition_histogram() const { return transition_histogram; }
+
+
+void State_machine::reset_profile()
+{
+    for (auto &s : states) s->profile = State_profile{};
+
+    transition_histogram = Transition_histogram{};
+}
+
+
+// Plain text table: one line per state and hook, times in microseconds
+
+void State_machine::dump_profile(std::ostream &out) const
+{
+    const double us_per_tick = 1000000.0 / static_cast<double>(Engine_clock::frequency());
+
+    auto line = [&](const State &s, const char *hook, const Profile_counter &c)
+    {
+        if (c.calls == 0) return;
+
+        out << s.label << " " << s.name.view() << " " << hook
+            << ": calls " << c.calls
+            << ", total " << c.total_ticks * us_per_tick << " us"
+            << ", mean " << (c.total_ticks * us_per_tick) / c.calls << " us"
+            << ", max " << c.max_ticks * us_per_tick << " us\n";
+    };
+
+    out << "=== State machine profile ===\n";
+
+    for (const auto &s : states)
+    {
+        line(*s, "event", s->profile.handle_event);
+        line(*s, "update", s->profile.update);
+        line(*s, "render", s->profile.render);
+        line(*s, "transition", s->profile.transition);
+    }
+
+    out << "Transition latency histogram (us):\n";
+
+    for (int b = 0; b < Transition_histogram::BUCKETS; ++b)
+    {
+        if (transition_histogram.buckets[b] == 0) continue;
+
+        out << "  [" << (b == 0 ? 0u : 1u << b) << ", ";
+
+        if (b == Transition_histogram::BUCKETS - 1) out << "inf";
+        else out << (1u << (b + 1));
+
+        out << "): " << transition_histogram.buckets[b] << "\n";
+    }
+}
+
+#endif
+
+// === PROFILING ===
+
+
+// === INTROSPECTION ===
+
+const State *State_machine::find_state(const State_ID &state_id) const
+{
+    auto it = states_index.find(state_id);
+
+    return it != states_index.end() ? it->second : nullptr;
+}
+
+
+const State *State_machine::find_state(std::string_view state_name) const
+{
+    // A name never interned has no state - nothing is added to the interner by a query
+    const Interned_string name = String_interner::Instance().find(state_name);
+
+    if (name.empty()) return nullptr;
+
+    for (const State_ptr &s : states)
+        if (s->name == name) return s.get();
+
+    return nullptr;
+}
+
+
+std::string_view State_machine::get_state_name(const State_ID &state_id) const
+{
+    const State *state = find_state(state_id);
+
+    return state ? state->name.view() : std::string_view();
+}
+
+
+const char *State_machine::get_state_label(const State_ID &state_id) const
+{
+    const State *state = find_state(state_id);
+
+    return state ? state->label : "";
+}
+
+
+State_span State_machine::get_active_path() const
+{
+    return current_state ? current_state->get_path() : State_span();
+}
+
+// === INTROSPECTION ===
+
+
+// Returns the human-readable name of the current state.
+// If no state is active, returns "NONE".
+// Useful for debugging, logging, or conditional logic outside the state machine.
+// The view is of the interned name - no allocation per call.
+
+std::string_view State_machine::current_state_name() const
+{
+    return current_state ? current_state->name.view() : "NONE";
+}
+
+
+// Same as above for the precomputed dotted ID label.
 
-std::string State_machine::current_state_name() const
+const char *State_machine::current_state_label() const
 {
-    return current_state ? current_state->name : "NONE";
+    return current_state ? current_state->label : "NONE";
 }
 
 // =========================================================================================== STATE MACHINE
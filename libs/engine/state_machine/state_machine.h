@@ -10,12 +10,21 @@
 #include <iostream>
 #include <functional>
 #include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include <charconv>
+#include <atomic>
 
 #include "../platform/platform.h"
+#include "../memory/allocator.h"
+#include "../hash_key/interned_string.h"
 
 // =========================================================================================== IMPORT
 
 
+struct Asset_manifest;
+
+
 // =========================================================================================== STATE_ID
 
 
@@ -27,27 +36,48 @@
  * position in a state hierarchy. Useful for state machines in games
  * or applications where states can have nested sub-states.
  *
+ * The levels are packed inline into a single 64-bit word: one byte per level,
+ * level 0 in the lowest byte, every byte storing (level + 1). A zero byte marks
+ * the end of the sequence, so the depth is encoded in the word itself and the
+ * whole ID is compared by a single integer compare. There are no heap allocations
+ * at all, and every operation is constexpr, so IDs can be compile-time constants.
+ *
+ * Limits: up to MAX_DEPTH (8) levels, every level in range [0, MAX_LEVEL] (254).
+ * Out of range IDs are rejected at compile time inside constant expressions,
+ * and reported at runtime (the invalid level is dropped).
+ *
  * Example usage:
- * @code State_ID game = {1, 1}; @endcode
- * @code State_ID small_menu = game.child(2);  // Results in {1, 1, 2} @endcode
+ * @code constexpr State_ID game = {1, 1}; @endcode
+ * @code constexpr State_ID small_menu = game.child(2);  // Results in {1, 1, 2} @endcode
  */
 class State_ID
 {
 
 public:
 
-    // Sequence of integers representing hierarchical levels.
-    std::vector<int> levels;
+    // Maximum number of hierarchical levels - one per byte of the packed word
+    static constexpr int MAX_DEPTH = 8;
+
+    // Maximum value of a single level (byte value 0 is reserved for "no level")
+    static constexpr int MAX_LEVEL = 254;
+
+    // Buffer size, which fits any formatted ID with the terminating zero:
+    // 8 levels by 3 digits, 7 dots and '\0'
+    static constexpr std::size_t STRING_BUFFER_SIZE = MAX_DEPTH * 3 + (MAX_DEPTH - 1) + 1;
+
 
     // Default constructor, creates an empty State_ID.
-    State_ID() = default;
+    constexpr State_ID() = default;
 
     /**
      * @brief Construct a State_ID from a list of levels.
      *
      * @param lvl Initializer list of integers representing levels.
      */
-    State_ID(std::initializer_list<int> lvl);
+    constexpr State_ID(std::initializer_list<int> lvl)
+    {
+        for (int level : lvl) push_level(level);
+    }
 
 
     /**
@@ -56,7 +86,7 @@ public:
      * @param other Another State_ID to compare with.
      * @return true if both State_IDs have identical levels, false otherwise.
      */
-    bool operator==(const State_ID& other) const;
+    constexpr bool operator==(const State_ID& other) const { return packed == other.packed; }
 
     /**
      * @brief Inequality operator.
@@ -64,7 +94,33 @@ public:
      * @param other Another State_ID to compare with.
      * @return true if the State_IDs differ, false if they are equal.
      */
-    bool operator!=(const State_ID& other) const;
+    constexpr bool operator!=(const State_ID& other) const { return packed != other.packed; }
+
+
+    // Number of levels in the ID (0 for an empty ID)
+    constexpr int depth() const
+    {
+        int d = 0;
+        while (d < MAX_DEPTH && ((packed >> (d * 8)) & 0xFFu) != 0) ++d;
+        return d;
+    }
+
+    // Level value by index, idx must be in range [0, depth())
+    constexpr int level(int idx) const
+    {
+        return static_cast<int>((packed >> (idx * 8)) & 0xFFu) - 1;
+    }
+
+    // Raw packed representation (useful for serialization and sort keys)
+    constexpr std::uint64_t raw() const { return packed; }
+
+    // State_ID of a raw() value - no validation, an unknown ID is simply not found
+    static constexpr State_ID from_raw(std::uint64_t raw)
+    {
+        State_ID id;
+        id.packed = raw;
+        return id;
+    }
 
 
     /**
@@ -75,7 +131,16 @@ public:
      *
      * @return State_ID of the parent.
      */
-    State_ID parent() const;
+    constexpr State_ID parent() const
+    {
+        State_ID p = *this;
+        int d = depth();
+
+        // Clear the byte of the last level, if there is a level
+        if (d > 0) p.packed &= ~(std::uint64_t{0xFF} << ((d - 1) * 8));
+
+        return p;
+    }
 
 
     /**
@@ -90,12 +155,16 @@ public:
      * 
      * - All preceding levels must match.
      * 
-     * This guarantees a proper hierarchical parent-child relationship.
+     * This guarantees a proper hierarchical parent-child relationship,
+     * and it is the same as "the parent of the child is this ID" - one compare.
      *
      * @param child The candidate child State_ID.
      * @return true if this is the parent of child, false otherwise.
      */
-    bool is_parent_of(const State_ID& child) const;
+    constexpr bool is_parent_of(const State_ID& child) const
+    {
+        return child.packed != 0 && child.parent().packed == packed;
+    }
 
 
     /**
@@ -107,7 +176,12 @@ public:
      * @param i The level index for the new child.
      * @return State_ID representing the child.
      */
-    State_ID child(int i) const;
+    constexpr State_ID child(int i) const
+    {
+        State_ID c = *this;
+        c.push_level(i);
+        return c;
+    }
 
 
         /**
@@ -119,17 +193,396 @@ public:
      * 
      * std::string s = id.string(); // "1.2.3"
      *
+     * Allocates - prefer to_chars() for the logging and per-frame paths.
+     *
      * @return std::string representation of the State_ID.
      */
     std::string string() const;
+
+
+    /**
+     * @brief Formats the State_ID as a dot-separated string into a caller buffer.
+     *
+     * Uses std::to_chars, so there are no allocations, no locales and no iostreams.
+     * The output is always zero-terminated if the buffer is not empty.
+     * A buffer of STRING_BUFFER_SIZE bytes always fits the whole ID.
+     *
+     * Example:
+     *
+     * char buf[State_ID::STRING_BUFFER_SIZE];
+     *
+     * id.to_chars(buf, sizeof(buf)); // "1.2.3"
+     *
+     * @param buf Destination buffer.
+     * @param size Destination buffer size in bytes.
+     * @return Number of characters written (without the '\0'), or 0 if the buffer is too small.
+     */
+    std::size_t to_chars(char* buf, std::size_t size) const;
+
+
+    /**
+     * @brief Returns the hash of the ID for the unordered containers.
+     *
+     * The whole ID is a single word, so the hash is just a cheap bit mix
+     * of it (splitmix64 finalizer), with no iteration over the levels.
+     *
+     * @return Hash value.
+     */
+    constexpr std::size_t hash() const
+    {
+        std::uint64_t h = packed;
+        h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+        h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+        return static_cast<std::size_t>(h ^ (h >> 31));
+    }
+
+
+private:
+
+    // Packed levels, one byte per level, (level + 1) per byte, 0 - end of the sequence
+    std::uint64_t packed = 0;
+
+    // Appends a level. Invalid input is reported by the non-constexpr handler,
+    // which also makes such an ID a compile error inside constant expressions.
+    constexpr void push_level(int level)
+    {
+        int d = depth();
+
+        if (d >= MAX_DEPTH || level < 0 || level > MAX_LEVEL)
+        {
+            report_invalid_level(level, d);
+            return;
+        }
+
+        packed |= static_cast<std::uint64_t>(level + 1) << (d * 8);
+    }
+
+    // Runtime error report for the invalid levels (too deep or out of range)
+    static void report_invalid_level(int level, int depth);
+};
+
+
+// Hasher for the unordered containers keyed by State_ID.
+struct State_ID_hash
+{
+    std::size_t operator()(const State_ID& id) const { return id.hash(); }
 };
 
 // =========================================================================================== STATE_ID
 
 
+// =========================================================================================== PROFILING
+
+// Optional instrumentation of the state machine, enabled by the STATE_MACHINE_PROFILING
+// define (CMake option MIYOO_STATE_PROFILING). Without it all of the code below,
+// the per-state counters and the query API are compiled out completely.
+
+#ifdef STATE_MACHINE_PROFILING
+
+// Call counter with the cumulative and the max time in Engine_clock ticks
+struct Profile_counter
+{
+    std::uint64_t calls = 0;
+    std::uint64_t total_ticks = 0;
+    std::uint64_t max_ticks = 0;
+
+    // Adds one measured call
+    void add(std::uint64_t ticks)
+    {
+        ++calls;
+        total_ticks += ticks;
+        if (ticks > max_ticks) max_ticks = ticks;
+    }
+};
+
+
+// Per-state counters for every dispatched hook
+struct State_profile
+{
+    Profile_counter handle_event;
+    Profile_counter update;
+    Profile_counter render;
+    Profile_counter transition; // go_to() transitions into this state (exit + enter chain)
+};
+
+
+// Transition latency histogram with power of two microsecond buckets:
+// bucket 0 - [0, 2) us, bucket i - [2^i, 2^(i+1)) us, the last bucket takes the rest
+struct Transition_histogram
+{
+    static constexpr int BUCKETS = 16;
+
+    std::uint64_t buckets[BUCKETS] = {};
+
+    void add(std::uint64_t microseconds)
+    {
+        int b = 0;
+        while (b < BUCKETS - 1 && (microseconds >> (b + 1)) != 0) ++b;
+        ++buckets[b];
+    }
+};
+
+#endif
+
+// =========================================================================================== PROFILING
+
+
+// =========================================================================================== STATE TREE
+
+
+/**
+ * @brief Compile-time definition of a single state: ID and human-readable name.
+ */
+struct State_def
+{
+    State_ID id;
+    const char* name;
+};
+
+
+// Compile-time error trigger for the duplicated IDs inside make_state_tree():
+// a call to a non-constexpr function makes the constant expression ill-formed.
+void state_tree_duplicate_id(std::size_t first_index, std::size_t second_index);
+
+
+/**
+ * @brief Flat, constexpr-computed state hierarchy.
+ *
+ * Built from a plain State_def table by make_state_tree(). All of the
+ * parent/child links are resolved at compile time as index arrays:
+ *
+ * - parent[i] - index of the parent definition, or -1 for a root (or an orphan);
+ *
+ * - first_child[i] / next_sibling[i] - intrusive children lists, -1 terminated,
+ *   the siblings in the order of the table (the regions and the iteration depend on it).
+ *
+ * State_machine::build_tree() then creates the states with a single linear pass,
+ * without any ID search or hashing for the linking.
+ */
+template <std::size_t N>
+struct State_tree
+{
+    State_def defs[N];
+
+    int parent[N];
+    int first_child[N];
+    int next_sibling[N];
+
+    // true if there are no duplicated IDs
+    bool valid;
+
+    static constexpr std::size_t size() { return N; }
+};
+
+
+/**
+ * @brief Builds the State_tree from the State_def table at compile time.
+ *
+ * Use like:
+ *
+ * constexpr State_def defs[] = { {{0}, "START"}, {{1}, "MAIN_MENU"} };
+ *
+ * constexpr auto tree = make_state_tree(defs); // Duplicated IDs don't compile
+ *
+ * @param defs Table of the state definitions (any order, the children keep their relative one).
+ * @return The tree with all of the links resolved.
+ */
+template <std::size_t N>
+constexpr State_tree<N> make_state_tree(const State_def (&defs)[N])
+{
+    State_tree<N> tree{};
+    tree.valid = true;
+
+    // Tail of every children list - the children are appended in the declaration order
+    int last_child[N] = {};
+
+    for (std::size_t i = 0; i < N; ++i)
+    {
+        tree.defs[i] = defs[i];
+        tree.parent[i] = -1;
+        tree.first_child[i] = -1;
+        tree.next_sibling[i] = -1;
+        last_child[i] = -1;
+    }
+
+    for (std::size_t i = 0; i < N; ++i)
+    {
+        for (std::size_t j = i + 1; j < N; ++j)
+        {
+            if (defs[i].id == defs[j].id)
+            {
+                tree.valid = false;
+                state_tree_duplicate_id(i, j);
+            }
+        }
+
+        State_ID parent_id = defs[i].id.parent();
+
+        for (std::size_t j = 0; j < N && defs[i].id.depth() > 0; ++j)
+        {
+            if (j != i && defs[j].id == parent_id)
+            {
+                tree.parent[i] = static_cast<int>(j);
+
+                // Append to the parent children list - the siblings keep the order of the table
+                if (last_child[j] >= 0) tree.next_sibling[last_child[j]] = static_cast<int>(i);
+                else tree.first_child[j] = static_cast<int>(i);
+
+                last_child[j] = static_cast<int>(i);
+                break;
+            }
+        }
+    }
+
+    return tree;
+}
+
+// =========================================================================================== STATE TREE
+
+
+// =========================================================================================== TRANSITION EFFECT
+
+
+// Built-in effect of a main transition - the captured outgoing frame over the new state
+enum class Transition_effect : std::uint8_t
+{
+    NONE,
+    FADE,           // The old frame fades out
+    SLIDE_LEFT,     // The old frame moves out of the screen to the left
+    SLIDE_RIGHT,
+    SLIDE_UP,
+    SLIDE_DOWN,
+    WIPE_LEFT,      // The old frame is cut from its left edge, the new state is uncovered
+    WIPE_RIGHT
+};
+
+// =========================================================================================== TRANSITION EFFECT
+
+
+// =========================================================================================== STATE BEHAVIOR
+
+
+/**
+ * @brief Optional interface with the virtual state hooks.
+ *
+ * The low-overhead alternative to the std::function callbacks of the State.
+ * Every hook is one virtual call with no type erasure and no heap-allocated
+ * captures - the state data lives right inside the derived class.
+ * Mark the derived class "final" and the compiler could devirtualize the calls
+ * when the concrete type is known.
+ *
+ * If a State has a behavior, its hooks are used instead of the std::function callbacks.
+ *
+ * Example usage:
+ *
+ * class Level_behavior final : public State_behavior
+ * {
+ *     void update() override { ... }
+ *     void render(SDL_Renderer* r) override { ... }
+ * };
+ *
+ * sm.initiate_state(LEVEL_GAMEPLAY_ID, "LEVEL_GAMEPLAY", std::make_unique<Level_behavior>());
+ */
+class State_behavior
+{
+
+public:
+
+    // Virtual destructor for the deletion by the base pointer
+    virtual ~State_behavior() = default;
+
+    // Called when entering the state
+    virtual void on_enter() {}
+
+    // Called when exiting the state
+    virtual void on_exit() {}
+
+    // Called for every event, while the state is active
+    virtual void handle_event(SDL_Event& e) { (void)e; }
+
+    // Called every update tick, while the state is active
+    virtual void update() {}
+
+    // Called every rendered frame, while the state is active.
+    // alpha is the interpolation factor between the last two simulation ticks [0, 1].
+    virtual void render(SDL_Renderer* r, float alpha) { (void)r; (void)alpha; }
+
+
+    // === PIPELINED UPDATE ===
+
+    // Opt-in for the pipelined cycle (sdl_app_ctx::pipelined_update): update() runs
+    // on the worker thread, while render() draws the previous frame on the main thread.
+    // Such a state keeps the data read by render() in a Double_buffer (or a copy made by
+    // publish_render_state()), update() must not touch the renderer or Frame, render() must
+    // not call go_to(). Update_pipeline::is_worker_thread() tells the two cycles apart.
+    virtual bool is_pipelined() const { return false; }
+
+    // Called on the main thread between frames, when update() is not running -
+    // the place to swap the render state double buffer.
+    virtual void publish_render_state() {}
+
+    // === PIPELINED UPDATE ===
+
+
+    // === TIME-SLICED ENTER ===
+
+    // Opt-in for the time-sliced initialization (see State::enter_step)
+    virtual bool has_enter_step() const { return false; }
+
+    // One slice of the initialization within the budget in seconds - true when it is complete
+    virtual bool enter_step(double budget_seconds) { (void)budget_seconds; return true; }
+
+    // Drawn over the held frame while the initialization runs (a progress bar)
+    virtual void render_loading(SDL_Renderer* r) { (void)r; }
+
+    // === TIME-SLICED ENTER ===
+
+
+    // === SNAPSHOT ===
+
+    // Own data of the resumable state into the suspend snapshot (out is empty)
+    virtual void save_snapshot(std::vector<std::uint8_t>& out) { (void)out; }
+
+    // Called after the resume entered the state - false: the data is rejected, the entered state stays
+    virtual bool restore_snapshot(const std::vector<std::uint8_t>& in) { (void)in; return true; }
+
+    // === SNAPSHOT ===
+};
+
+// =========================================================================================== STATE BEHAVIOR
+
+
 // =========================================================================================== STATE
 
 
+class State;
+
+
+/**
+ * @brief Read-only view of a run of the states - a path from the root, the children.
+ *
+ * Points into the storage of the states, nothing is copied: the tools walk it every
+ * frame without allocating. Valid until the hierarchy changes (a state is added,
+ * linked or cleared) - a view isn't kept across the frames.
+ */
+struct State_span
+{
+    const State* const* first = nullptr;
+    int count = 0;
+
+    const State* const* begin() const { return first; }
+    const State* const* end() const { return first + count; }
+
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    const State* operator[](int i) const { return first[i]; }
+
+    // The last state - the leaf of a path, nullptr if empty
+    const State* back() const { return count > 0 ? first[count - 1] : nullptr; }
+};
+
+
 /**
  * @brief Represents a single state in a hierarchical state machine.
  *
@@ -153,8 +606,13 @@ public:
     // Unique hierarchical identifier for this state.
     State_ID id;
 
-    // Human-readable name of the state.
-    std::string name;
+    // Human-readable name of the state - interned, the states of one name share the characters
+    // and compare by a pointer.
+    Interned_string name;
+
+    // Precomputed dotted ID label ("1.1.2"), formatted once on the state creation,
+    // so logging and debug overlays never format the ID again.
+    char label[State_ID::STRING_BUFFER_SIZE];
 
     // Callback executed when entering this state.
     std::function<void()> on_enter;
@@ -162,6 +620,16 @@ public:
     // Callback executed when exiting this state.
     std::function<void()> on_exit;
 
+    // Time-sliced initialization (optional): after on_enter it is called once per frame with the
+    // budget of the frame in seconds (State_machine::step_loading()) until it returns true. Until
+    // then the state is loading - no events and no updates reach it or its substates, and the frame
+    // it was entered from stays on the screen with state_render_loading over it. The heavy part of
+    // the entry goes here, on_enter only starts it.
+    std::function<bool(double)> enter_step;
+
+    // Drawn over the held frame while the enter_step runs, nullptr - the held frame only
+    std::function<void(SDL_Renderer*)> state_render_loading;
+
     // Callback executed every update tick while in this state for event handling 
     std::function<void(SDL_Event&)> state_handle_event;
 
@@ -171,12 +639,91 @@ public:
     // Callback executed every update tick while in this state for state rendering operation
     std::function<void(SDL_Renderer*)> state_render;
 
+    // Optional virtual hooks, which replace all of the std::function callbacks above.
+    // Owned by the state.
+    std::unique_ptr<State_behavior> behavior;
+
+    // Damage tracking opt-in: if true, the engine redraws this state only after
+    // Frame::Instance().mark_dirty() (static menus, splash screens).
+    // If false, the state is redrawn every frame.
+    bool tracks_damage = false;
+
+    // Idle opt-in: the state is static - nothing animates and the update has no work
+    // without the input. While it's visible and nothing waits to be drawn, the main loop
+    // blocks in SDL_WaitEventTimeout instead of cycling. Implies the damage tracking.
+    bool is_static = false;
+
+    // Propagation opt-in: while the state is an ancestor of an active leaf, it is updated and
+    // rendered too - before the leaf, root first (the shared HUD of a parent under all of its
+    // children). Read on the transitions - set it before the state is entered.
+    bool propagates = false;
+
+    // Effect of the transitions into this state (go_to() with an effect overrides it).
+    // The outgoing frame is captured once, then it is a single textured quad per frame.
+    Transition_effect enter_effect = Transition_effect::NONE;
+    float enter_effect_seconds = 0.25f;
+
+    // Categories of the SDL events the state handles (Event_interest bits) - the others
+    // never reach its handler. The text and the pointer events are turned on in SDL only
+    // while a state of the machine wants them (State_machine::get_event_interest()).
+    Uint32 event_interest = EVENT_DEFAULT;
+
+    // Update rate: the state is updated every update_divisor-th tick (3 - 20 Hz at 60 ticks),
+    // the states of one rate are spread over different ticks. A tick with an input edge
+    // updates it at once, so a slow menu never misses or delays a press.
+    int update_divisor = 1;
+
+    // Ticks covered by the running update (the scheduler sets it) - a slow state scales its
+    // time step by it: tick_dt * update_ticks
+    int update_ticks = 1;
+
+    // Tick of the last update, 0 - not updated since the start
+    std::uint64_t last_update_tick = 0;
+
+    // Assets of the state (static table, see Asset_prefetcher), nullptr - none declared.
+    // Prefetched at a low priority while a parent or a sibling of the state is active.
+    const Asset_manifest* manifest = nullptr;
+
+    // Memory of the state while it is active (level entities, scratch buffers, UI trees),
+    // nullptr - none. Reset in one operation after on_exit, freed with the state by clear_state(),
+    // so nothing allocated by the state outlives it:
+    //     s->arena = std::make_unique<Scope_arena>(256 * 1024);   // once, on the setup
+    //     level = s->arena->create<Level>();                       // on_enter, no on_exit frees
+    std::unique_ptr<Scope_arena> arena;
+
+    // Entered, its enter_step isn't complete yet - set by the entry, cleared by the last step or the exit
+    bool loading = false;
+
+    // Suspend opt-in (see State_machine::save_snapshot()): the state is restored straight
+    // after a cold start, with the data of its hooks (optional, the behavior replaces them)
+    bool resumable = false;
+
+    std::function<void(std::vector<std::uint8_t>&)> save_snapshot;
+    std::function<bool(const std::vector<std::uint8_t>&)> restore_snapshot;
+
     // Pointer to the parent state. nullptr if this is a root state.
     State* parent = nullptr;
 
     // Pointers to child states of this state.
     std::vector<State*> children;
 
+    // Flattened chain of the linked ancestors from the root down to this state (inclusive).
+    // Rebuilt by the State_machine when the hierarchy links change, so transitions
+    // find the lowest common ancestor in O(depth) without walking the parent pointers.
+    State* path[State_ID::MAX_DEPTH] = {};
+
+    // Number of valid entries in path (1 for a root state)
+    int path_depth = 0;
+
+    // Position in the states storage of the machine, kept dense by the removals.
+    // Also the row and the column of the transition table.
+    int index = -1;
+
+#ifdef STATE_MACHINE_PROFILING
+    // Time spent in the hooks of this state
+    State_profile profile;
+#endif
+
 
     /**
      * @brief Constructor to create a state with an ID and name.
@@ -185,7 +732,7 @@ public:
      * @param state_id Hierarchical State_ID for this state.
      * @param state_name Human-readable name of the state.
      */
-    State(const State_ID& state_id, const std::string& state_name);
+    State(const State_ID& state_id, std::string_view state_name);
 
     /**
      * @brief Destructor.
@@ -193,11 +740,91 @@ public:
      * Automatically clears children and callbacks if needed.
      */
     ~State();
+
+
+    // === DISPATCH ===
+
+    // Hook runners used by the State_machine: the behavior if it is set,
+    // the std::function callback otherwise. Inline, so a dispatch is one call.
+
+    void run_enter()                  { if (behavior) behavior->on_enter();       else if (on_enter) on_enter(); }
+    void run_exit()                   { if (behavior) behavior->on_exit();        else if (on_exit) on_exit(); }
+    void run_handle_event(SDL_Event& e) { if (behavior) behavior->handle_event(e); else if (state_handle_event) state_handle_event(e); }
+    void run_update()                 { if (behavior) behavior->update();         else if (state_update) state_update(); }
+    void run_render(SDL_Renderer* r, float alpha) { if (behavior) behavior->render(r, alpha); else if (state_render) state_render(r); }
+
+    bool has_enter_step() const       { return behavior ? behavior->has_enter_step() : static_cast<bool>(enter_step); }
+    bool run_enter_step(double budget_seconds) { if (behavior) return behavior->enter_step(budget_seconds); return enter_step ? enter_step(budget_seconds) : true; }
+    void run_render_loading(SDL_Renderer* r) { if (behavior) behavior->render_loading(r); else if (state_render_loading) state_render_loading(r); }
+
+    void run_save_snapshot(std::vector<std::uint8_t>& out) { if (behavior) behavior->save_snapshot(out); else if (save_snapshot) save_snapshot(out); }
+
+    bool run_restore_snapshot(const std::vector<std::uint8_t>& in)
+    {
+        if (behavior) return behavior->restore_snapshot(in);
+
+        return restore_snapshot ? restore_snapshot(in) : true;
+    }
+
+    // === DISPATCH ===
+
+
+    // === HIERARCHY ===
+
+    // Linked ancestors from the root down to this state (inclusive) and the direct children - views, no copies
+    State_span get_path() const { return {path, path_depth}; }
+    State_span get_children() const { return {children.data(), static_cast<int>(children.size())}; }
+
+    // Levels of the linked hierarchy above the state (0 for a root)
+    int get_depth() const { return path_depth > 0 ? path_depth - 1 : 0; }
+
+    // === HIERARCHY ===
 };
 
 // =========================================================================================== STATE
 
 
+// =========================================================================================== TRANSITION TABLE
+
+
+// Edge guard - the transition is refused if it returns false
+using Transition_guard = bool (*)(const State& from, const State& to);
+
+// Edge hook - runs between the exits of the source and the enters of the target
+using Transition_hook = void (*)(State& from, State& to);
+
+
+/**
+ * @brief Allowed transition of the declared transition table.
+ *
+ * An edge from a state is valid from all of its substates, the default (empty) from ID -
+ * from any state. The guard and the hook are optional plain functions: the edge stays
+ * one bit in the compiled table, only the edges with them are looked up.
+ *
+ * Usage:
+ * @code
+ * static const Transition_edge edges[] =
+ * {
+ *     {START_ID, MAIN_MENU_ID},
+ *     {MAIN_MENU_ID, LEVEL_GAMEPLAY_ID, nullptr, hand_over_menu_assets},
+ *     {GAME_ID, MAIN_MENU_ID},
+ * };
+ *
+ * sm.set_transitions(edges);
+ * @endcode
+ */
+struct Transition_edge
+{
+    State_ID from;
+    State_ID to;
+
+    Transition_guard guard = nullptr;
+    Transition_hook hook = nullptr;
+};
+
+// =========================================================================================== TRANSITION TABLE
+
+
 // =========================================================================================== STATE MACHINE
 
 
@@ -222,14 +849,153 @@ public:
 class State_machine
 {
 
+public:
+
+    // Owning pointer of a state - the memory goes back to the allocator it came from
+    using State_ptr = std::unique_ptr<State, Allocator_delete<State>>;
+
+    using State_list = std::vector<State_ptr, Std_allocator<State_ptr>>;
+    using State_index = std::unordered_map<State_ID, State*, State_ID_hash, std::equal_to<State_ID>,
+                                           Std_allocator<std::pair<const State_ID, State*>>>;
+
 private:
 
+    template <typename Visitor>
+    static void visit_subtree(const State& state, int depth, Visitor& visit)
+    {
+        visit(state, depth);
+
+        for (const State* child : state.children) visit_subtree(*child, depth + 1, visit);
+    }
+
+
+    // Memory of the states and of the containers below
+    Allocator* allocator = &heap_allocator();
+
     // Container of all states managed by this machine.
-    std::vector<std::unique_ptr<State>> states;
+    State_list states;
+
+    // Hash index over the states container for O(1) lookups by State_ID.
+    // Points to the same objects which are owned by the states vector.
+    State_index states_index;
 
     // Pointer to the currently active state.
     State* current_state = nullptr;
 
+    // Target of the deferred transition request, nullptr if there is no request.
+    // All requests made during one frame collapse into this slot - the last one wins.
+    State* pending_state = nullptr;
+
+    // Nesting depth of the state callbacks being executed right now.
+    // While it is non-zero, go_to() is deferred instead of running immediately.
+    // Atomic, because in the pipelined cycle update and render callbacks run concurrently.
+    std::atomic<int> dispatch_depth{0};
+
+
+    // Maximum number of the overlay states on top of the current state
+    static constexpr int MAX_OVERLAYS = 4;
+
+    // Overlay stack - states drawn over the current state (pause menu, dialogs).
+    // The top overlay receives the events and the updates, the states below are frozen.
+    State* overlays[MAX_OVERLAYS] = {};
+
+    // Number of the pushed overlays
+    int overlay_count = 0;
+
+    // Frame underneath the top overlay, rendered once and reused as a backdrop (Render_target_pool)
+    SDL_Texture* overlay_backdrop = nullptr;
+
+    // false if the backdrop must be rendered again on the next state_render()
+    bool overlay_backdrop_valid = false;
+
+    // Renderer of the last state_render() - the outgoing frame is captured with it
+    SDL_Renderer* effect_renderer = nullptr;
+
+    // Outgoing frame of the running transition effect (Render_target_pool, released after the effect)
+    SDL_Texture* effect_frame = nullptr;
+
+    // Running effect, its length and its start (Engine_clock real time)
+    Transition_effect effect = Transition_effect::NONE;
+    float effect_seconds = 0.0f;
+    double effect_start = 0.0;
+
+    // Effect of the next main transition, given by go_to() / request_go_to()
+    Transition_effect next_effect = Transition_effect::NONE;
+    float next_effect_seconds = 0.0f;
+    bool has_next_effect = false;
+
+    // The effects are drawn at all (set_effects_enabled())
+    bool effects_enabled = true;
+
+    // Maximum number of the regions next to the main state
+    static constexpr int MAX_REGIONS = 4;
+
+    // Orthogonal region - an independently active subtree (music, HUD) next to the main state
+    struct Region
+    {
+        State* leaf = nullptr;      // Active leaf, its path is entered
+        State* pending = nullptr;   // Deferred transition inside the region
+        int order = 0;              // Position in the update / render pass, the main state is 0
+    };
+
+    // Regions in the order of adding
+    Region regions[MAX_REGIONS] = {};
+
+    // Number of the added regions
+    int region_count = 0;
+
+    // Flat active list: the current state and the region leaves sorted by the order.
+    // Rebuilt on the configuration changes only - the frame passes never walk the tree.
+    State* active[1 + MAX_REGIONS] = {};
+    int active_order[1 + MAX_REGIONS] = {};
+    int active_count = 0;
+
+    // Propagating ancestors of the active entries, root first - the entry i owns
+    // [propagation_first[i], propagation_first[i + 1]). Rebuilt with the active list and on the
+    // overlay changes, so the frame passes run a flat loop instead of walking up State::parent.
+    State* propagation[(1 + MAX_REGIONS) * State_ID::MAX_DEPTH] = {};
+    int propagation_first[2 + MAX_REGIONS] = {};
+
+    // Entry of the current state in the active list, -1 - none
+    int main_entry = -1;
+
+    // Interpolation factor of the frame being rendered (see state_render())
+    float render_alpha = 1.0f;
+
+    // Incremented on every change of the visible configuration (transitions, overlays)
+    std::uint64_t change_counter = 0;
+
+    // Ticks of state_update() since the start - the clock of the update rates
+    std::uint64_t update_tick = 0;
+
+    // Union of the event interests of the states with a handler, valid if not dirty
+    Uint32 event_interest = EVENT_DEFAULT;
+    bool event_interest_dirty = true;
+
+    // Data of one state while the snapshot is written - the capacity is kept
+    std::vector<std::uint8_t> snapshot_scratch;
+
+    // Declared edges, empty - every transition is allowed
+    std::vector<Transition_edge> transition_edges;
+
+    // Compiled table: row of the source index, bit of the target index. Every row has
+    // the edges of the source ancestors and the "from any" ones already merged in.
+    std::vector<std::uint64_t> transition_bits;
+
+    // Same layout - the allowed edges with a guard or a hook
+    std::vector<std::uint64_t> transition_special;
+
+    // 64-bit words per row
+    std::size_t transition_words = 0;
+
+    // The states or the edges changed - compiled again on the next check
+    bool transitions_dirty = false;
+
+#ifdef STATE_MACHINE_PROFILING
+    // Latency distribution of all transitions
+    Transition_histogram transition_histogram;
+#endif
+
 
     /**
      * @brief Adds a new state to the state machine.
@@ -239,23 +1005,119 @@ private:
      *         with the same ID already exists.
      */
     bool add_state(std::unique_ptr<State> s);
+
+    // Same for a state of the machine allocator
+    bool add_state(State_ptr s);
     
     /**
      * @brief Checks if a State_ID already exists in the machine.
      *
+     * Constant time lookup by the states index.
+     *
      * @param id State_ID to check.
      * @return true if a state with the given ID exists, false otherwise.
      */
     bool id_exists(const State_ID& id) const;
 
 
+    // Rebuilds the flattened ancestor path of the state and of its whole subtree.
+    // Called from add_state when the state gets a parent or adopts children.
+    void rebuild_path(State* s);
+
+    // Calls on_exit for every active state from the current leaf up to the root
+    // (the whole active configuration) and nullptrs the current state.
+    void exit_active_path();
+
+    // Runs the hierarchical exit/enter sequence to the already resolved target state.
+    void perform_transition(State* target);
+
+    // go_to() - own_effect: the caller has set the next effect (else the one of a replaced request is dropped)
+    bool go_to_target(const State_ID& id, bool own_effect);
+
+    // Region whose root is the root of the state, -1 - the state belongs to the main path
+    int find_region(const State* state) const;
+
+    // Moves the leaf of the region to the target by the LCA, like perform_transition()
+    void perform_region_transition(int region, State* target);
+
+    // Exits the whole path of the region (leaf first) and removes it
+    void exit_region(int region);
+
+    // Builds the bit matrix of the declared edges over the dense state indices
+    void compile_transitions();
+
+    // Declared edge of the pair - the nearest ancestor of the source first
+    const Transition_edge* find_edge(const State* from, const State* to) const;
+
+    // One bit test (plus the guard of a guarded edge), no table or no source - allowed
+    bool is_transition_allowed(const State* from, const State* to);
+
+    // Same, logs the refused transition
+    bool check_transition(const State* from, const State* to);
+
+    // Hook of the edge, nullptr for the plain edges
+    Transition_hook transition_hook(const State* from, const State* to);
+
+    // Fills the active list from the current state and the regions
+    void rebuild_active();
+
+    // Collects the propagating ancestors of the active entries - of the top overlay in the main
+    // one, without the ancestors it shares with the frame below it (they are in its backdrop)
+    void rebuild_propagation();
+
+    // Levels of the path of the overlay shared with the frame below it (the current state, the lower overlays)
+    int levels_below(int overlay) const;
+
+    // Renders the propagating ancestors of the active entry, root first
+    void render_propagated(int entry, SDL_Renderer* r);
+
+    // The state in the slot of the main one - the top overlay or the current state
+    State* visible_main() const;
+
+    // Renders everything below the top overlay: the current state and the lower overlays
+    void render_underlying(SDL_Renderer* r);
+
+    // Renders the slot of the main state: the overlay backdrop (or the underlying states) and the top
+    void render_main(SDL_Renderer* r);
+
+    // Captures the visible main slot before a transition into the target, if it has an effect
+    void start_effect(State* target);
+
+    // Draws the outgoing frame of the running effect over the new state, ends it after its time
+    void render_effect(SDL_Renderer* r);
+
+    // Loading hooks of the loading states on the path of the state, root first (the held frame is the caller's)
+    void render_loading(SDL_Renderer* r, State* state);
+
+    // The last step of the loading ended - the held frame starts its effect or goes back to the pool
+    void end_loading();
+
+    // Renders the underlying frame into the backdrop texture (recreated on size change).
+    // Returns false if render targets are not supported by the renderer.
+    bool capture_backdrop(SDL_Renderer* r);
+
+
 public:
 
-    // Default constructor. 
+    // Default constructor - the states are on the heap. 
     State_machine() = default;
     // Default destructor.
     ~State_machine() = default;
 
+    // The states and the index in the memory of the allocator
+    explicit State_machine(Allocator& allocator) { set_allocator(allocator); }
+
+
+    /**
+     * @brief Moves the machine to another memory source.
+     *
+     * Only on an empty machine - the states already created stay where they are.
+     *
+     * @param allocator Memory of the states and the containers, used while the machine is.
+     * @return false if the machine already has states.
+     */
+    bool set_allocator(Allocator& allocator);
+
     
     /**
      * @brief State constructor wrapper to create a state with an ID and name by the 
@@ -267,12 +1129,77 @@ public:
     void initiate_state(const State_ID& state_id, const std::string& state_name);
 
 
+    /**
+     * @brief Same as above, but the state is driven by the virtual hooks of the behavior.
+     *
+     * @param state_id Hierarchical State_ID for this state.
+     * @param state_name Human-readable name of the state.
+     * @param state_behavior Behavior object, owned by the state from now on.
+     */
+    void initiate_state(const State_ID& state_id, const std::string& state_name,
+                        std::unique_ptr<State_behavior> state_behavior);
+
+
+
+    /**
+     * @brief Creates all of the states of the compile-time tree in one linear pass.
+     *
+     * The links are taken from the precomputed index arrays, so building the
+     * machine costs O(n) instead of the O(n^2) linking of add_state() calls.
+     * Works only on an empty machine.
+     *
+     * @param tree Tree built by make_state_tree().
+     * @return true on success, false if the machine already has states.
+     */
+    template <std::size_t N>
+    bool build_tree(const State_tree<N>& tree)
+    {
+        if (!states.empty())
+        {
+            std::cerr << "build_tree() requires an empty state machine\n";
+            return false;
+        }
+
+        states.reserve(N);
+        states_index.reserve(N);
+
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            states.push_back(make_allocated<State>(*allocator, tree.defs[i].id, tree.defs[i].name));
+            states.back()->index = static_cast<int>(i);
+            states_index.emplace(tree.defs[i].id, states.back().get());
+        }
+
+        transitions_dirty = true;
+        event_interest_dirty = true;
+
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            State* s = states[i].get();
+
+            if (tree.parent[i] >= 0) s->parent = states[tree.parent[i]].get();
+
+            for (int c = tree.first_child[i]; c >= 0; c = tree.next_sibling[c])
+                s->children.push_back(states[c].get());
+        }
+
+        // Ancestor paths top-down from every root
+        for (std::size_t i = 0; i < N; ++i)
+            if (tree.parent[i] < 0) rebuild_path(states[i].get());
+
+        return true;
+    }
+
+
 
     /**
      * @brief State smart pointer getter from state machine
      * for performing actions with state by state ID
      * 
+     * Constant time lookup by the states index.
+     * 
      * @param state_id Hierarchical State_ID for this state.
+     * @return Pointer to the state, or nullptr if there is no state with this ID.
      */
     State* get_state(const State_ID& state_id);
 
@@ -280,6 +1207,9 @@ public:
     /**
      * @brief Specific state destructor by the state_machine herself.
      *
+     * Removes the whole subtree of the state. The active states inside it are exited first,
+     * then the subtree is marked and the storage compacted in one pass - O(n + k).
+     *
      * @param state_id Hierarchical State_ID for this state.
      * 
      */
@@ -293,13 +1223,266 @@ public:
     /**
      * @brief Switches the machine to a state with the given ID.
      *
-     * Calls on_exit of the current state and on_enter of the new state.
+     * Hierarchical (HSM) transition: the active configuration is the whole
+     * path from the root down to the current state. Only the states between
+     * the source, the target and their lowest common ancestor (LCA) are touched:
+     *
+     * - on_exit is called from the current state up to the LCA (exclusive), leaf first;
+     *
+     * - on_enter is called from the LCA (exclusive) down to the target, root first.
+     *
+     * So LEVEL_GAMEPLAY (1.1.1) -> SMALL_MENU (1.1.2) exits 1.1.1 and enters 1.1.2,
+     * while GAME (1.1) stays active. Going to an ancestor just exits the descendants.
+     * A transition to the current state itself exits and re-enters it.
+     *
+     * If go_to() is called from inside a state callback (enter/exit, event, update
+     * or render), the transition is not run in the middle of the callback:
+     * it becomes a deferred request, like request_go_to(). A transition run
+     * immediately drops the deferred request of its region - the newer one wins.
      *
      * @param id The State_ID to switch to.
-     * @return true if the transition was successful, false if the ID was not found.
+     * @return true if the transition was successful (or deferred), false if the ID was not found
+     *         or the transition table refuses it.
      */
     bool go_to(const State_ID& id);
 
+    // Same with a transition effect instead of the enter_effect of the target (main transitions)
+    bool go_to(const State_ID& id, Transition_effect with_effect, float seconds = 0.25f);
+
+
+    /**
+     * @brief Requests a transition, which is applied at the next frame boundary.
+     *
+     * Requests are not queued one by one: all requests made before the next
+     * apply_pending_transition() call collapse into one effective transition
+     * to the last requested state, so the intermediate enter/exit work is never done.
+     *
+     * @param id The State_ID to switch to.
+     * @return true if the request was accepted, false if the ID was not found or refused.
+     */
+    bool request_go_to(const State_ID& id);
+
+    // Same with a transition effect, the last request of the frame sets it
+    bool request_go_to(const State_ID& id, Transition_effect with_effect, float seconds = 0.25f);
+
+    // true while a transition effect is drawn
+    bool is_effect_running() const;
+
+    // Off - the transitions cut straight to the new state, no frame captured (the Quality_watchdog)
+    void set_effects_enabled(bool on) { effects_enabled = on; }
+    bool are_effects_enabled() const { return effects_enabled; }
+
+
+    /**
+     * @brief Applies the collapsed transition request, if there is one.
+     *
+     * Called by the application cycle once per frame, before the state update.
+     * Requests made by the callbacks of this transition wait for the next frame.
+     *
+     * @return true if a transition was performed.
+     */
+    bool apply_pending_transition();
+
+
+    // Checks if there is a deferred transition waiting for the frame boundary.
+    bool has_pending_transition() const;
+
+
+    // === OVERLAYS ===
+
+    /**
+     * @brief Pushes an overlay state on top of the current state.
+     *
+     * The overlay is entered (on_enter), the current state stays active but frozen:
+     * only the top overlay gets events and updates. On the next render the frame
+     * underneath is rendered once into a texture, which is then reused as the
+     * backdrop until the overlay is popped - the underlying state isn't rendered again.
+     *
+     * Any transition of the current state (go_to) pops all of the overlays first.
+     *
+     * @param id The State_ID of the overlay state.
+     * @return true on success, false if the ID was not found or the stack is full.
+     */
+    bool push_overlay(const State_ID& id);
+
+    /**
+     * @brief Pops the top overlay state (calls its on_exit).
+     *
+     * @return true if an overlay was popped, false if the stack is empty.
+     */
+    bool pop_overlay();
+
+    // Pops all of the overlays, top first
+    void pop_all_overlays();
+
+    // Top overlay state, or nullptr if there are no overlays
+    State* get_top_overlay() const;
+
+    // Number of the pushed overlays
+    int get_overlay_count() const;
+
+    // Forces the backdrop to be rendered again (e.g. the underlying state changed its visuals)
+    void invalidate_overlay_backdrop();
+
+    // Frees the SDL resources owned by the machine. Must be called before the renderer is destroyed.
+    void release_render_resources();
+
+    // === OVERLAYS ===
+
+
+    // === REGIONS ===
+
+    /**
+     * @brief Enters the state as an orthogonal region - a subtree active next to the main state.
+     *
+     * Background music, HUD or debug views live in their own regions instead of being
+     * repeated in the callbacks of every game state. The root of the state identifies the
+     * region: go_to() and request_go_to() to any state under it move the region's leaf
+     * (LCA exit/enter inside the region), while the main state and the other regions stay.
+     *
+     * update, render and events run over the flat active list in the order: regions with
+     * a negative order, the main state (order 0), the rest - so a HUD region is drawn on top.
+     * Overlays belong to the main state: they freeze and cover it, not the regions.
+     *
+     * @param id State to enter (with its ancestors), its root must not be active already.
+     * @param order Position in the update / render pass.
+     * @return false if the ID is unknown, the root is active or all regions are used.
+     */
+    bool add_region(const State_ID& id, int order = 1);
+
+    // Exits the region of the state (leaf to root) - false if the state is in no region
+    bool remove_region(const State_ID& id);
+
+    int get_region_count() const;
+
+    // Active leaf of the region (in the order of adding), nullptr if out of range
+    State* get_region_state(int region) const;
+
+    // Flat active list in the pass order - the current state and the region leaves
+    int get_active_count() const;
+    State* get_active_state(int index) const;
+
+    // === REGIONS ===
+
+
+    // === TRANSITION TABLE ===
+
+    /**
+     * @brief Declares the allowed transitions - go_to() and request_go_to() refuse the rest.
+     *
+     * The edges are compiled into a bit matrix over the dense state indices (again after
+     * the states change), the validation of a transition is one bit test. The first state
+     * of the machine or of a region is always allowed, the overlays aren't transitions.
+     *
+     * @param edges Copied, see Transition_edge.
+     */
+    void set_transitions(const Transition_edge* edges, std::size_t count);
+
+    template <std::size_t N>
+    void set_transitions(const Transition_edge (&edges)[N]) { set_transitions(edges, N); }
+
+    // Drops the table - every transition is allowed again
+    void clear_transitions();
+
+    bool has_transitions() const;
+
+    // The transition to the state is declared and its guard passes
+    bool can_go_to(const State_ID& id);
+
+    // === TRANSITION TABLE ===
+
+
+    // === TIME-SLICED ENTER ===
+
+    /**
+     * @brief Runs the enter_step of the loading states within the budget - once per frame.
+     *
+     * Called by the application cycle after apply_pending_transition(). Along every active
+     * path root first, then the overlays, so a parent is ready before the step of its
+     * substate. Each step gets the rest of the budget, a step left incomplete ends the pass.
+     * When the last one completes, the transition effect of the held frame starts.
+     *
+     * @param budget_seconds Main thread time of the frame for the steps.
+     * @return true if nothing is loading any more.
+     */
+    bool step_loading(double budget_seconds);
+
+    // Runs the steps until they are complete - the resume and the tools, never per frame
+    void finish_loading();
+
+    // true while an active state (or an ancestor of it, an overlay) is loading
+    bool is_loading() const;
+
+    // === TIME-SLICED ENTER ===
+
+
+    // === SNAPSHOT ===
+
+    /**
+     * @brief Writes the active configuration into a compact binary snapshot - the suspend.
+     *
+     * The current state ID, the overlay stack, the region leaves with their order and the
+     * own data of every active state with a snapshot hook (little-endian, versioned).
+     * Only the states marked resumable are written: a non-resumable current state (the menus,
+     * the exit) writes an empty snapshot, which restores nothing - the next start is cold,
+     * the overlays and the regions stop at the first non-resumable one.
+     *
+     * @param out Replaced by the snapshot (its capacity is reused).
+     * @return true if a resumable configuration was written.
+     */
+    bool save_snapshot(std::vector<std::uint8_t>& out);
+
+    /**
+     * @brief Restores a save_snapshot() configuration - the resume.
+     *
+     * The whole snapshot is validated first, a broken or empty one changes nothing. Then the
+     * pending requests are dropped, the overlays and the regions are left, the current state,
+     * the overlays and the regions are entered like by go_to() / push_overlay() / add_region(),
+     * and the states get their data (restore hooks root first). Not from a state callback.
+     *
+     * @return false if nothing was restored.
+     */
+    bool restore_snapshot(const std::uint8_t* data, std::size_t size);
+
+    // === SNAPSHOT ===
+
+
+#ifdef STATE_MACHINE_PROFILING
+
+    // === PROFILING ===
+
+    /**
+     * @brief Returns the profiling counters of the state.
+     *
+     * Times are in Engine_clock ticks (see Engine_clock::frequency()).
+     *
+     * @param state_id State to query.
+     * @return Pointer to the counters, or nullptr if there is no such state.
+     */
+    const State_profile* get_state_profile(const State_ID& state_id) const;
+
+    // Latency histogram of all transitions
+    const Transition_histogram& get_transition_histogram() const;
+
+    // Zeroes all of the counters
+    void reset_profile();
+
+    // Prints the per-state table and the transition histogram (called on the app shutdown)
+    void dump_profile(std::ostream& out) const;
+
+    // === PROFILING ===
+
+#endif
+
+
+    /**
+     * @brief Exits all active states, from the current leaf up to the root.
+     *
+     * Used on the application shutdown, so every active ancestor gets its on_exit.
+     * The regions are exited first, the last added first.
+     */
+    void exit_all();
+
 
     /**
      * @brief Returns a pointer to the currently active state.
@@ -308,19 +1491,85 @@ public:
      */
     State* get_current_state() const;
 
+    // All of the states in the order of their creation (the roots are the ones without a parent)
+    const State_list& get_states() const { return states; }
+
 
     /**
      * @brief Returns the name of the currently active state.
      *
+     * If no state is active, returns "NONE". The view is of the interned name -
+     * no allocation, valid until the exit.
+     *
+     * @return std::string_view Name of the current state or "NONE" if no state is active.
+     */
+    std::string_view current_state_name() const;
+
+
+    /**
+     * @brief Returns the precomputed dotted ID label of the currently active state.
+     *
+     * No allocation or formatting - the pointer refers to State::label.
      * If no state is active, returns "NONE".
      *
-     * @return std::string Name of the current state or "NONE" if no state is active.
+     * @return Zero-terminated label of the current state.
+     */
+    const char* current_state_label() const;
+
+
+    // === INTROSPECTION ===
+
+    // Read-only queries for the tools (the overlay, the profilers, the snapshot): the states by
+    // reference, the names by view, the paths as State_span - no allocation, callable every frame.
+
+    // State by ID, nullptr if there is none (the const get_state())
+    const State* find_state(const State_ID& state_id) const;
+
+    // First state of the name in the creation order, nullptr if none - the names are interned,
+    // one lookup of the name, then a pointer compare per state
+    const State* find_state(std::string_view state_name) const;
+
+    // Name and dotted label of the state by ID, "" if there is none
+    std::string_view get_state_name(const State_ID& state_id) const;
+    const char* get_state_label(const State_ID& state_id) const;
+
+    // Active path of the main hierarchy from the root to the current leaf, empty if nothing is active
+    State_span get_active_path() const;
+
+    /**
+     * @brief Walks the whole linked hierarchy depth first, every parent before its children.
+     *
+     * The roots in the creation order, the children in their link order. The visitor gets
+     * the state and its depth (0 for a root). Recursion over the children - the depth is
+     * bounded by State_ID::MAX_DEPTH, nothing is allocated.
+     *
+     * Usage:
+     * @code
+     * sm.for_each_state([](const State& s, int depth) { SDL_Log("%*s%s", depth * 2, "", s.name.c_str()); });
+     * @endcode
+     *
+     * @param visit Callable as visit(const State&, int depth). The hierarchy must not change inside.
      */
-    std::string current_state_name() const;
+    template <typename Visitor>
+    void for_each_state(Visitor&& visit) const
+    {
+        for (const State_ptr& s : states)
+            if (!s->parent) visit_subtree(*s, 0, visit);
+    }
+
+    // Visits every active leaf (the current state and the region leaves, by the region order) with its
+    // path from the root - visit(const State& leaf, State_span path); the overlays are get_top_overlay()
+    template <typename Visitor>
+    void for_each_active_path(Visitor&& visit) const
+    {
+        for (int i = 0; i < active_count; ++i) visit(*active[i], active[i]->get_path());
+    }
+
+    // === INTROSPECTION ===
 
 
     /**
-     * @brief Passes an SDL event to the currently active state.
+     * @brief Passes an SDL event to the currently active state (or the top overlay).
      *
      * Any SDL event (keyboard, mouse, controller button, etc.) is forwarded.
      * Each state can decide how to handle it:
@@ -329,6 +1578,8 @@ public:
      * 
      * - GAME might handle character movement, shooting, or other gameplay input.
      *
+     * A state gets only the categories of its event_interest - no handler call for the rest.
+     *
      * @param e Reference to the SDL_Event to handle.
      */
     void state_handle_event(SDL_Event& e);
@@ -337,18 +1588,71 @@ public:
     /**
      * @brief Delegates rendering to the currently active state.
      *
+     * With pushed overlays it draws the cached backdrop and the top overlay instead.
+     * The ancestors with State::propagates are drawn before their leaf, root first.
+     *
      * Each state knows how to draw itself: menus, game objects, UI elements, text, etc.
      * The SDL_Renderer pointer is passed down so states can draw directly to the screen.
      *
+     * With the fixed timestep simulation the render happens between two ticks:
+     * alpha = 0 is the previous tick, alpha = 1 is the latest one. The behaviors
+     * get it as a render() argument, the callbacks could read get_render_alpha().
+     *
      * @param r Pointer to the SDL_Renderer used for drawing.
+     * @param alpha Interpolation factor between the last two simulation ticks [0, 1].
      */
-    void state_render(SDL_Renderer* r);
+    void state_render(SDL_Renderer* r, float alpha = 1.0f);
+
+
+    // Interpolation factor of the frame being rendered right now
+    float get_render_alpha() const;
+
+
+    /**
+     * @brief Returns the counter of the visible configuration changes.
+     *
+     * Incremented by every transition and overlay push/pop, so the engine
+     * can detect that the screen content changed by a single compare.
+     */
+    std::uint64_t get_change_counter() const;
+
+
+    // true if the visible state (top overlay or current) must be redrawn every frame
+    bool needs_continuous_redraw() const;
+
+    // true if the visible state is static and no transition is pending - the loop could sleep
+    bool can_idle() const;
+
+
+    // true if the visible state could be updated on the pipeline worker thread
+    // (its behavior opted in and there are no overlays above it)
+    bool is_pipelined() const;
+
+    // Publishes the render state of the pipelined state. Call only while no update runs.
+    void publish_render_state();
+
+
+    /**
+     * @brief Event categories wanted by the states of the machine - the SDL event filter.
+     *
+     * The union of the event_interest of every state with an event handler, recomputed only
+     * after the states change (or after refresh_event_interest()), else one branch.
+     */
+    Uint32 get_event_interest();
+
+    // Call after changing the event_interest of an already added state
+    void refresh_event_interest();
+
+    // Event_interest category of the SDL event type
+    static Uint32 event_interest_of(Uint32 type);
 
 
-    // Updates the logic of the current state.
-    // Only the current state is updated; parent or sibling states are ignored.
-    // This keeps the update loop simple and local to the active state.
-    void state_update();
+    // Updates the logic of the current state and of the region leaves, in the pass order.
+    // Parent or sibling states are ignored, except the ancestors with State::propagates -
+    // those are updated right before their leaf, root first, on its tick.
+    // The states with an update_divisor are skipped until they are due, input_edge (a button
+    // went down or up this tick) makes them all due.
+    void state_update(bool input_edge = false);
 };
 
 // =========================================================================================== STATE MACHINE
@@ -0,0 +1,99 @@
+// sub_machine.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "sub_machine.h"
+#include "../log/log.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== SUB MACHINE
+
+Sub_machine_table::Sub_machine_table(const Sub_state_def* defs, int count, int initial) : defs(defs), count(count)
+{
+    if (count < 1 || count > MAX_STATES)
+    {
+        LOG_ERROR("Sub-machine table: %d states (1 to %d)", count, MAX_STATES);
+        this->count = count < 1 ? 0 : MAX_STATES;
+    }
+
+    if (initial >= 0 && initial < this->count) this->initial = initial;
+    else LOG_ERROR("Sub-machine table: initial state %d is out of range, 0 is used", initial);
+
+    for (int i = 0; i < this->count; ++i)
+    {
+        if (defs[i].timeout > 0.0f && (defs[i].timeout_next < 0 || defs[i].timeout_next >= this->count))
+            LOG_ERROR("Sub-machine state %s: timeout state %d is out of range", get_state_name(i), defs[i].timeout_next);
+    }
+}
+
+
+const char* Sub_machine_table::get_state_name(int state) const
+{
+    return state >= 0 && state < count && defs[state].name ? defs[state].name : "?";
+}
+
+
+int Sub_machine_table::find_state(std::string_view name) const
+{
+    for (int i = 0; i < count; ++i)
+        if (defs[i].name && name == defs[i].name) return i;
+
+    return STAY;
+}
+
+
+void Sub_machine_table::start(Sub_machine& machine, void* user, std::uint32_t agent) const
+{
+    machine = Sub_machine{};
+
+    if (count == 0) return;
+
+    machine.state = static_cast<std::uint16_t>(initial);
+
+    if (defs[initial].on_enter) defs[initial].on_enter(machine, user, agent);
+}
+
+
+void Sub_machine_table::go_to(Sub_machine& machine, int next, void* user, std::uint32_t agent) const
+{
+    if (next < 0 || next >= count) return;
+
+    // A state out of the table (a machine of another table) has nothing to exit
+    if (machine.state < count && defs[machine.state].on_exit) defs[machine.state].on_exit(machine, user, agent);
+
+    machine.state = static_cast<std::uint16_t>(next);
+    machine.state_time = 0.0f;
+    ++machine.transitions;
+
+    // An enter hook can go on at once - the next update runs the state it chose
+    if (defs[next].on_enter) defs[next].on_enter(machine, user, agent);
+}
+
+
+void Sub_machine_table::update(Sub_machine& machine, float dt, void* user, std::uint32_t agent) const
+{
+    if (machine.state >= count) return;
+
+    machine.state_time += dt;
+    machine.timer = machine.timer > dt ? machine.timer - dt : 0.0f;
+
+    const Sub_state_def& def = defs[machine.state];
+
+    int next = def.update ? def.update(machine, user, agent, dt) : STAY;
+
+    // The update decides first - the timeout is the fallback of a state left alone
+    if (next == STAY && def.timeout > 0.0f && machine.state_time >= def.timeout) next = def.timeout_next;
+
+    if (next != STAY) go_to(machine, next, user, agent);
+}
+
+
+void Sub_machine_table::update_all(Sub_machine* machines, const std::uint32_t* agents, int machine_count, float dt, void* user) const
+{
+    for (int i = 0; i < machine_count; ++i) update(machines[i], dt, user, agents ? agents[i] : static_cast<std::uint32_t>(i));
+}
+
+// =========================================================================================== SUB MACHINE
@@ -0,0 +1,173 @@
+// sub_machine.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== SUB MACHINE
+
+
+struct Sub_machine;
+
+// Hooks of a sub-state: the machine, the user data of the owner (the world, the menu) and the agent
+// (an Entity, a page index) - plain function pointers, the table is a static array
+using Sub_state_hook = void (*)(Sub_machine& machine, void* user, std::uint32_t agent);
+
+// Update of a sub-state - the index of the next state, or Sub_machine_table::STAY
+using Sub_state_update = int (*)(Sub_machine& machine, void* user, std::uint32_t agent, float dt);
+
+
+/**
+ * @brief Definition of one state of a Sub_machine_table.
+ *
+ * Any hook can be nullptr. A timeout > 0 switches to timeout_next after that many seconds
+ * in the state, unless the update went elsewhere first (patrol -> look around -> patrol).
+ */
+struct Sub_state_def
+{
+    const char* name;
+
+    Sub_state_hook on_enter;
+    Sub_state_hook on_exit;
+    Sub_state_update update;
+
+    float timeout;
+    int timeout_next;
+};
+
+
+/**
+ * @brief One running sub-machine - its current state index and its timers, nothing else.
+ *
+ * 12 bytes, trivially copyable: the machines of the agents are stored by their owner
+ * (a Component_pool<Sub_machine> of the Entity_store, a plain array of the menu pages)
+ * and snapshotted with the rest of the components. The definitions, the hooks and the
+ * names are in the shared Sub_machine_table.
+ */
+struct Sub_machine
+{
+    // Index of the current state in the table
+    std::uint16_t state = 0;
+
+    // Transitions taken since the start - a changed count tells an observer "the state changed"
+    std::uint16_t transitions = 0;
+
+    // Seconds in the current state (the timeout clock, reset by every transition)
+    float state_time = 0.0f;
+
+    // Free countdown of the hooks (cooldowns, reaction delays) - decreased to 0 by the updates
+    float timer = 0.0f;
+};
+
+
+/**
+ * @brief Shared definition table of many lightweight state machines.
+ *
+ * The embeddable alternative of a full State_machine inside a state: the enemy AI of
+ * LEVEL_GAMEPLAY, the pages of a menu. A State_machine owns its states, their
+ * std::function hooks and an index - fine for the few app states, too heavy for each
+ * of thousands of agents. Here one static Sub_state_def table (flat, no hierarchy)
+ * drives any number of Sub_machine values: the table is read-only after its
+ * construction, the machines are 12-byte records in the owner's storage.
+ *
+ * update_all() is a linear pass over a dense array of the machines and their agents -
+ * one indirect call per machine, no allocation, the layout of the ECS pools.
+ *
+ * The table can be used from several threads at once (the machines of different
+ * agents) - it has no mutable state.
+ *
+ * Usage:
+ * @code
+ * enum { PATROL, CHASE, LOOK };
+ *
+ * static const Sub_state_def ENEMY_STATES[] = {
+ *     {"PATROL", nullptr,         nullptr, patrol_update, 0.0f, Sub_machine_table::STAY},
+ *     {"CHASE",  chase_enter,     nullptr, chase_update,  0.0f, Sub_machine_table::STAY},
+ *     {"LOOK",   nullptr,         nullptr, look_update,   1.5f, PATROL},
+ * };
+ *
+ * static const Sub_machine_table ENEMY_AI(ENEMY_STATES);
+ *
+ * Sub_machine& ai = machines.add(enemy, {});
+ * ENEMY_AI.start(ai, &world, enemy);
+ * ...
+ * ENEMY_AI.update_all(machines.data(), machines.get_entities(), machines.size(), dt, &world);
+ * @endcode
+ */
+class Sub_machine_table
+{
+
+public:
+
+    // Update result - no transition
+    static constexpr int STAY = -1;
+
+    // Largest number of the states (the index of a Sub_machine is 16-bit)
+    static constexpr int MAX_STATES = 0xFFFF;
+
+
+    /**
+     * @brief Table over the definitions - the array must outlive the table (a static one).
+     *
+     * An invalid initial index is logged and replaced by 0, an invalid timeout_next is logged
+     * (its transition is ignored by go_to()).
+     *
+     * @param defs    State definitions.
+     * @param count   Their number (1 to MAX_STATES).
+     * @param initial State entered by start().
+     */
+    Sub_machine_table(const Sub_state_def* defs, int count, int initial = 0);
+
+    template <std::size_t N>
+    explicit Sub_machine_table(const Sub_state_def (&defs)[N], int initial = 0) : Sub_machine_table(defs, static_cast<int>(N), initial) {}
+
+
+    int get_state_count() const { return count; }
+    int get_initial_state() const { return initial; }
+
+    const Sub_state_def& get_def(int state) const { return defs[state]; }
+
+    // Name of the state, "?" if out of range
+    const char* get_state_name(int state) const;
+
+    // Index of the named state, STAY if there is none (a tool lookup - linear)
+    int find_state(std::string_view name) const;
+
+
+    // Resets the machine into the initial state and runs its on_enter
+    void start(Sub_machine& machine, void* user, std::uint32_t agent) const;
+
+    // Exit of the current state, then the enter of the next one (out of range - ignored)
+    void go_to(Sub_machine& machine, int next, void* user, std::uint32_t agent) const;
+
+    // Advances the timers and runs the update of the current state, then its transition (if any)
+    void update(Sub_machine& machine, float dt, void* user, std::uint32_t agent) const;
+
+    /**
+     * @brief Updates the dense array of the machines - the system of the AI pool.
+     *
+     * @param machines Machines (Component_pool::data()).
+     * @param agents   Agent of each machine (Component_pool::get_entities()), nullptr - the array index.
+     * @param machine_count Number of the machines.
+     * @param dt       Time step in seconds.
+     * @param user     User data given to every hook.
+     */
+    void update_all(Sub_machine* machines, const std::uint32_t* agents, int machine_count, float dt, void* user) const;
+
+
+private:
+
+    const Sub_state_def* defs;
+
+    int count;
+    int initial = 0;
+};
+
+// =========================================================================================== SUB MACHINE
@@ -0,0 +1,284 @@
+// telemetry.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "telemetry.h"
+#include "../engine_clock/engine_clock.h"
+#include "../thread_roles/thread_roles.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== TELEMETRY
+
+// Writer poll period of the empty queue
+static constexpr Uint32 WRITER_IDLE_MS = 20;
+
+// A block, which doesn't fill, is still written after this time - the file stays recent
+static constexpr double FLUSH_INTERVAL = 2.0;
+
+// Queue sizes - a few records at least
+static constexpr size_t MIN_RECORDS = 16;
+
+
+Telemetry& Telemetry::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Telemetry instance;
+    return instance;
+}
+
+
+bool Telemetry::open(const char* path, size_t buffer_bytes, bool capture_log)
+{
+    if (is_open()) close();
+
+    file = SDL_RWFromFile(path, "ab");
+
+    if (!file)
+    {
+        SDL_Log("Telemetry file %s can't be opened: %s", path, SDL_GetError());
+        return false;
+    }
+
+    file_path = path;
+    write_failed = false;
+
+    // Power of two of the records, which fit into the buffer
+    std::uint32_t records = MIN_RECORDS;
+
+    while (static_cast<size_t>(records) * 2 * sizeof(Slot) <= buffer_bytes) records *= 2;
+
+    // The queue stays allocated after close() - a late producer never writes into freed memory
+    if (!slots || mask + 1 != records)
+    {
+        slots.reset(new Slot[records]);
+        mask = records - 1;
+    }
+
+    for (std::uint32_t i = 0; i < records; ++i) slots[i].sequence.store(i, std::memory_order_relaxed);
+
+    enqueue_position.store(0, std::memory_order_relaxed);
+    dequeue_position = 0;
+
+    dropped.store(0, std::memory_order_relaxed);
+    written.store(0, std::memory_order_relaxed);
+    reported_drops = 0;
+
+    block.clear();
+    block.reserve(BLOCK_BYTES);
+
+    opened_at = Engine_clock::now();
+
+    running.store(true, std::memory_order_release);
+
+    writer = SDL_CreateThread(writer_main, "telemetry", this);
+
+    if (!writer)
+    {
+        SDL_Log("Telemetry thread can't be created: %s", SDL_GetError());
+
+        running.store(false);
+        SDL_RWclose(file);
+        file = nullptr;
+        return false;
+    }
+
+    if (capture_log)
+    {
+        SDL_LogGetOutputFunction(&previous_output, &previous_userdata);
+        SDL_LogSetOutputFunction(log_output, this);
+        log_captured = true;
+    }
+
+    writef("telemetry: opened, %u records of queue", records);
+
+    return true;
+}
+
+
+void Telemetry::close()
+{
+    if (!is_open()) return;
+
+    if (log_captured)
+    {
+        SDL_LogSetOutputFunction(previous_output, previous_userdata);
+        log_captured = false;
+    }
+
+    // The writer drains the queue before it ends
+    running.store(false, std::memory_order_release);
+
+    SDL_WaitThread(writer, nullptr);
+    writer = nullptr;
+
+    SDL_RWclose(file);
+    file = nullptr;
+}
+
+
+bool Telemetry::write(const char* text, size_t length)
+{
+    if (!running.load(std::memory_order_acquire)) return false;
+
+    // Bounded multi-producer queue: a producer claims the position, whose slot is free
+    std::uint32_t position = enqueue_position.load(std::memory_order_relaxed);
+    Slot* slot = nullptr;
+
+    for (;;)
+    {
+        slot = &slots[position & mask];
+
+        const std::uint32_t sequence = slot->sequence.load(std::memory_order_acquire);
+        const std::int32_t turn = static_cast<std::int32_t>(sequence - position);
+
+        if (turn == 0)
+        {
+            if (enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+        }
+        else if (turn < 0)
+        {
+            // Full - the writer is behind, the record is dropped, never waited for
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        else position = enqueue_position.load(std::memory_order_relaxed);
+    }
+
+    const int prefix = std::snprintf(slot->text, RECORD_BYTES, "[%10.3f] ", Engine_clock::to_seconds(Engine_clock::now() - opened_at));
+    const size_t copied = std::min(length, RECORD_BYTES - static_cast<size_t>(prefix));
+
+    std::memcpy(slot->text + prefix, text, copied);
+    slot->length = static_cast<std::uint32_t>(prefix + copied);
+
+    slot->sequence.store(position + 1, std::memory_order_release);
+
+    return true;
+}
+
+
+bool Telemetry::writef(const char* format, ...)
+{
+    char text[RECORD_BYTES];
+
+    std::va_list args;
+    va_start(args, format);
+    const int length = std::vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+
+    if (length < 0) return false;
+
+    return write(text, std::min(static_cast<size_t>(length), sizeof(text) - 1));
+}
+
+
+// === WRITER ===
+
+int SDLCALL Telemetry::writer_main(void* userdata)
+{
+    static_cast<Telemetry*>(userdata)->write_loop();
+    return 0;
+}
+
+
+void Telemetry::write_loop()
+{
+    // The game threads come first - the file can wait
+    if (!Thread_roles::Instance().apply(Thread_role::IO)) SDL_SetThreadPriority(SDL_THREAD_PRIORITY_LOW);
+
+    Uint64 last_flush = Engine_clock::now();
+
+    for (;;)
+    {
+        // Read before the drain - the records queued before close() are all written
+        const bool stopping = !running.load(std::memory_order_acquire);
+
+        bool popped = false;
+
+        while (pop_into_block()) popped = true;
+
+        const std::uint64_t drops = dropped.load(std::memory_order_relaxed);
+
+        if (drops != reported_drops)
+        {
+            char text[80];
+            const int length = std::snprintf(text, sizeof(text), "[%10.3f] telemetry: %llu records dropped\n",
+                                             Engine_clock::to_seconds(Engine_clock::now() - opened_at),
+                                             static_cast<unsigned long long>(drops - reported_drops));
+
+            if (block.size() + length > BLOCK_BYTES) flush_block();
+            block.insert(block.end(), text, text + length);
+
+            reported_drops = drops;
+        }
+
+        const Uint64 now = Engine_clock::now();
+
+        if (stopping || (!block.empty() && Engine_clock::to_seconds(now - last_flush) >= FLUSH_INTERVAL))
+        {
+            flush_block();
+            last_flush = now;
+        }
+
+        if (stopping) break;
+
+        if (!popped) SDL_Delay(WRITER_IDLE_MS);
+    }
+}
+
+
+bool Telemetry::pop_into_block()
+{
+    Slot& slot = slots[dequeue_position & mask];
+
+    if (slot.sequence.load(std::memory_order_acquire) != dequeue_position + 1) return false;
+
+    if (block.size() + slot.length + 1 > BLOCK_BYTES) flush_block();
+
+    block.insert(block.end(), slot.text, slot.text + slot.length);
+    block.push_back('\n');
+
+    // Free for the producer of the next round
+    slot.sequence.store(dequeue_position + mask + 1, std::memory_order_release);
+    ++dequeue_position;
+
+    written.fetch_add(1, std::memory_order_relaxed);
+
+    return true;
+}
+
+
+void Telemetry::flush_block()
+{
+    if (block.empty()) return;
+
+    if (!write_failed && SDL_RWwrite(file, block.data(), 1, block.size()) != block.size())
+    {
+        // Logged once - the log itself may be the telemetry
+        write_failed = true;
+        SDL_Log("Telemetry file %s write failed: %s", file_path.c_str(), SDL_GetError());
+    }
+
+    block.clear();
+}
+
+
+void SDLCALL Telemetry::log_output(void* userdata, int category, SDL_LogPriority priority, const char* message)
+{
+    Telemetry* telemetry = static_cast<Telemetry*>(userdata);
+
+    if (telemetry->previous_output) telemetry->previous_output(telemetry->previous_userdata, category, priority, message);
+
+    telemetry->write(message, std::strlen(message));
+}
+
+// === WRITER ===
+
+// =========================================================================================== TELEMETRY
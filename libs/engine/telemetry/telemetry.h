@@ -0,0 +1,153 @@
+// telemetry.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== TELEMETRY
+
+
+/**
+ * @brief Log and metrics file on the SD card, written by a background thread.
+ *
+ * A write from the game thread is a copy into a RAM queue, never a file call: the
+ * records go through a lock-free bounded queue (any thread writes, the writer thread
+ * reads), the low-priority writer thread packs them into BLOCK_BYTES blocks and appends
+ * a whole block at once - a few large sequential writes instead of a small one per line,
+ * which the SD card turns into the multi-millisecond stalls.
+ *
+ * The queue is capped: when it is full, the record is dropped and counted - the writer
+ * never blocks the game. The drops are written into the file by the writer thread.
+ *
+ * With capture_log the SDL_Log output goes into the file too (and to the previous output).
+ *
+ * Every record is a line with the seconds since open().
+ *
+ * Usage:
+ * @code
+ * Telemetry::Instance().open("/mnt/SDCARD/miyoo_square.log", 256 * 1024, true);
+ *
+ * Telemetry::Instance().writef("level %d loaded in %.1f ms", level, ms);
+ *
+ * Telemetry::Instance().close(); // flushes the rest
+ * @endcode
+ */
+class Telemetry
+{
+
+public:
+
+    // Longest record, the longer ones are cut
+    static constexpr size_t RECORD_BYTES = 240;
+
+    // Write unit of the writer thread
+    static constexpr size_t BLOCK_BYTES = 64 * 1024;
+
+
+    // Returns the singleton instance.
+    static Telemetry& Instance();
+
+
+    /**
+     * @brief Starts the writer thread, appending to the file.
+     *
+     * @param path         Output file, appended to.
+     * @param buffer_bytes RAM of the queue (rounded down to a power of two of records).
+     * @param capture_log  Copies the SDL_Log output into the file.
+     * @return false if the file can't be opened or the thread can't be created.
+     */
+    bool open(const char* path, size_t buffer_bytes, bool capture_log);
+
+    // Writes the queued records, stops the thread and closes the file
+    void close();
+
+    bool is_open() const { return writer != nullptr; }
+
+
+    // Queues a line (any thread) - false if it was dropped (queue full or not open)
+    bool write(const char* text, size_t length);
+
+    // Formatted line, printf style
+    bool writef(const char* format, ...) SDL_PRINTF_VARARG_FUNC(2);
+
+
+    // Records dropped, because the queue was full
+    std::uint64_t get_dropped_count() const { return dropped.load(std::memory_order_relaxed); }
+
+    // Records written into the file
+    std::uint64_t get_written_count() const { return written.load(std::memory_order_relaxed); }
+
+
+private:
+
+    Telemetry() = default;
+
+    // Singleton - not copyable
+    Telemetry(const Telemetry&) = delete;
+    Telemetry& operator=(const Telemetry&) = delete;
+
+
+    struct Slot
+    {
+        // Queue turn of the slot: index - free for the writer of index, index + 1 - filled
+        std::atomic<std::uint32_t> sequence{0};
+
+        std::uint32_t length = 0;
+        char text[RECORD_BYTES];
+    };
+
+
+    static int SDLCALL writer_main(void* userdata);
+    void write_loop();
+
+    // Writer side - the next record into the block, false if the queue is empty
+    bool pop_into_block();
+
+    // Writer side - appends the block to the file
+    void flush_block();
+
+    static void SDLCALL log_output(void* userdata, int category, SDL_LogPriority priority, const char* message);
+
+
+    std::unique_ptr<Slot[]> slots;
+    std::uint32_t mask = 0;
+
+    // Free-running positions of the producers and of the writer
+    std::atomic<std::uint32_t> enqueue_position{0};
+    std::uint32_t dequeue_position = 0;
+
+    std::atomic<std::uint64_t> dropped{0};
+    std::atomic<std::uint64_t> written{0};
+
+    // Drops already reported in the file
+    std::uint64_t reported_drops = 0;
+
+    SDL_RWops* file = nullptr;
+    std::string file_path;
+    bool write_failed = false;
+
+    std::vector<char> block;
+
+    SDL_Thread* writer = nullptr;
+    std::atomic<bool> running{false};
+
+    Uint64 opened_at = 0;
+
+    // Output replaced by the log capture
+    SDL_LogOutputFunction previous_output = nullptr;
+    void* previous_userdata = nullptr;
+    bool log_captured = false;
+};
+
+// =========================================================================================== TELEMETRY
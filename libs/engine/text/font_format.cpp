@@ -0,0 +1,48 @@
+// font_format.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "font_format.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== FONT VIEW
+
+bool Font_view::open(const void* data, size_t size)
+{
+    header = nullptr;
+    glyphs = nullptr;
+    kerning = nullptr;
+    image_name = nullptr;
+
+    // The tables are read in place - the data must keep their alignment
+    if (!data || size < sizeof(Font_header) || reinterpret_cast<std::uintptr_t>(data) % alignof(Font_header) != 0)
+        return false;
+
+    const auto* bytes = static_cast<const std::uint8_t*>(data);
+    const auto* h = reinterpret_cast<const Font_header*>(bytes);
+
+    if (h->magic != FONT_MAGIC || h->version != FONT_VERSION || h->size > size) return false;
+
+    // Every table inside the file, the multiplications can't overflow in 64 bits
+    const std::uint64_t glyph_end = static_cast<std::uint64_t>(h->glyph_offset) + static_cast<std::uint64_t>(h->glyph_count) * sizeof(Font_glyph);
+    const std::uint64_t kerning_end = static_cast<std::uint64_t>(h->kerning_offset) + static_cast<std::uint64_t>(h->kerning_count) * sizeof(Font_kerning);
+    const std::uint64_t image_end = static_cast<std::uint64_t>(h->image_offset) + h->image_length + 1;
+
+    if (glyph_end > h->size || kerning_end > h->size || image_end > h->size) return false;
+
+    if (h->glyph_offset % alignof(Font_glyph) != 0 || h->kerning_offset % alignof(Font_kerning) != 0) return false;
+
+    if (bytes[h->image_offset + h->image_length] != 0) return false;
+
+    header = h;
+    glyphs = reinterpret_cast<const Font_glyph*>(bytes + h->glyph_offset);
+    kerning = reinterpret_cast<const Font_kerning*>(bytes + h->kerning_offset);
+    image_name = reinterpret_cast<const char*>(bytes + h->image_offset);
+
+    return true;
+}
+
+// =========================================================================================== FONT VIEW
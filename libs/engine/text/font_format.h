@@ -0,0 +1,128 @@
+// font_format.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstddef>
+#include <cstdint>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== FONT FORMAT
+
+// File layout (little-endian, every table 4-byte aligned, every offset from the file start):
+//
+// [Font_header]
+// [Font_glyph] * glyph_count at glyph_offset, sorted by the codepoint
+// [Font_kerning] * kerning_count at kerning_offset, sorted by the pair
+// [image name] at image_offset, image_length bytes, 0-terminated
+//
+// The glyphs are prebaked by miyoo_font_baker into one atlas image (white, the coverage
+// in the alpha) - the device only copies the rectangles, nothing is rasterized.
+// The image is an ordinary image asset of the name, the Font_asset loads it.
+
+constexpr std::uint32_t FONT_MAGIC = 0x4651534D;      // "MSQF"
+constexpr std::uint32_t FONT_VERSION = 1;
+
+
+struct Font_header
+{
+    std::uint32_t magic;
+    std::uint32_t version;
+
+    // Whole file size - a truncated file is caught before any table is read
+    std::uint32_t size;
+
+    // Distance between the baselines and the baseline below the line top, px
+    std::int32_t line_height;
+    std::int32_t baseline;
+
+    std::uint32_t glyph_count;
+    std::uint32_t glyph_offset;
+
+    std::uint32_t kerning_count;
+    std::uint32_t kerning_offset;
+
+    std::uint32_t image_offset;
+    std::uint32_t image_length;
+
+    std::uint32_t reserved;
+};
+
+
+// One character: its rectangle in the atlas image and the placement
+struct Font_glyph
+{
+    std::uint32_t codepoint;
+
+    // Rectangle in the image, w = 0 for the glyphs without the ink (space)
+    std::uint16_t x;
+    std::uint16_t y;
+    std::uint16_t w;
+    std::uint16_t h;
+
+    // Rectangle offset from the pen position on the line top, and the pen advance
+    std::int16_t offset_x;
+    std::int16_t offset_y;
+    std::int16_t advance;
+
+    std::uint16_t reserved;
+};
+
+
+// Advance correction between two characters (AV, Ту)
+struct Font_kerning
+{
+    std::uint32_t first;
+    std::uint32_t second;
+    std::int32_t amount;
+};
+
+static_assert(sizeof(Font_header) == 48, "Font_header layout is the file layout");
+static_assert(sizeof(Font_glyph) == 20, "Font_glyph layout is the file layout");
+static_assert(sizeof(Font_kerning) == 12, "Font_kerning layout is the file layout");
+
+// =========================================================================================== FONT FORMAT
+
+
+// =========================================================================================== FONT VIEW
+
+
+/**
+ * @brief Read-only view of a baked font in memory - the tables are used where they are.
+ *
+ * open() checks the magic, the version and that every table is inside the data, once.
+ * The memory is not owned - it is the mapped pack or the Font_asset buffer.
+ */
+class Font_view
+{
+
+public:
+
+    // false if the data isn't a valid font of this version
+    bool open(const void* data, size_t size);
+
+    bool is_open() const { return header != nullptr; }
+
+    const Font_header& get_header() const { return *header; }
+
+    const Font_glyph* get_glyphs() const { return glyphs; }
+    std::uint32_t get_glyph_count() const { return header->glyph_count; }
+
+    const Font_kerning* get_kerning() const { return kerning; }
+    std::uint32_t get_kerning_count() const { return header->kerning_count; }
+
+    const char* get_image_name() const { return image_name; }
+
+
+private:
+
+    const Font_header* header = nullptr;
+    const Font_glyph* glyphs = nullptr;
+    const Font_kerning* kerning = nullptr;
+    const char* image_name = nullptr;
+};
+
+// =========================================================================================== FONT VIEW
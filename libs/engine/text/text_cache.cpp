@@ -0,0 +1,185 @@
+// text_cache.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "text_cache.h"
+#include "../lang_state/lang_state.h"
+#include "../thread_roles/thread_roles.h"
+
+#include <algorithm>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== TEXT CACHE
+
+Text_cache& Text_cache::Instance()
+{
+    static Text_cache instance;
+    return instance;
+}
+
+
+Text_cache::Text_cache()
+{
+    Lang_state::Instance().Add_change_hook(&Text_cache::on_lang_change, this);
+    Lang_state::Instance().Add_prepare_hook(&Text_cache::on_lang_prepare, this);
+}
+
+
+Text_cache::~Text_cache()
+{
+    cancel_build();
+
+    Lang_state::Instance().Remove_change_hook(&Text_cache::on_lang_change, this);
+    Lang_state::Instance().Remove_prepare_hook(&Text_cache::on_lang_prepare, this);
+}
+
+
+void Text_cache::on_lang_change(void* context)
+{
+    auto* cache = static_cast<Text_cache*>(context);
+
+    // Built for this language - the swap is the whole change
+    if (cache->build_lang == Lang_state::Instance().Get_lang() && cache->build_done.load())
+    {
+        SDL_WaitThread(cache->build_thread, nullptr);
+        cache->build_thread = nullptr;
+
+        cache->layout_count += cache->build_keys.size();
+
+        cache->runs.swap(cache->back);
+        cache->cancel_build();
+        return;
+    }
+
+    cache->clear();
+}
+
+
+bool Text_cache::on_lang_prepare(void* context, Lang_list lang)
+{
+    auto* cache = static_cast<Text_cache*>(context);
+
+    if (cache->build_lang == lang) return cache->build_done.load();
+
+    // Another language was being built - the request changed
+    cache->cancel_build();
+
+    cache->build_lang = lang;
+
+    // The keys in use now, with their new texts - the worker owns the copies
+    const Lang_state& state = Lang_state::Instance();
+
+    cache->build_keys.reserve(cache->runs.size());
+    cache->build_texts.reserve(cache->runs.size());
+
+    for (const auto& entry : cache->runs)
+    {
+        cache->build_keys.push_back(entry.first);
+        cache->build_texts.emplace_back(state.Get_pending_string(lang, entry.first.id));
+    }
+
+    cache->build_thread = SDL_CreateThread(&Text_cache::build_main, "text_cache", cache);
+
+    // No thread - laid out here, the switch is still done between two frames
+    if (!cache->build_thread) build_main(cache);
+
+    return cache->build_done.load();
+}
+
+
+int Text_cache::build_main(void* context)
+{
+    auto* cache = static_cast<Text_cache*>(context);
+
+    Thread_roles::Instance().apply(Thread_role::WORKER);
+
+    // Only the CPU side of the layout: the metrics, the atlas region and its size
+    for (size_t i = 0; i < cache->build_keys.size(); ++i)
+    {
+        const Key& key = cache->build_keys[i];
+        const Font_asset* font = key.font;
+
+        Text_run& run = cache->back[key];
+
+        if (!font || font->get_line_height() <= 0) continue;
+
+        const float scale = key.size > 0 ? static_cast<float>(key.size) / static_cast<float>(font->get_line_height()) : 1.0f;
+
+        font->layout(cache->build_texts[i], scale, static_cast<float>(key.wrap_width), run);
+    }
+
+    cache->build_done = true;
+
+    return 0;
+}
+
+
+void Text_cache::cancel_build()
+{
+    if (build_thread) SDL_WaitThread(build_thread, nullptr);
+
+    build_thread = nullptr;
+    build_done = false;
+    build_lang = Lang_list::LIMIT;
+
+    back.clear();
+    build_keys.clear();
+    build_texts.clear();
+}
+
+
+const Text_run& Text_cache::get(std::uint32_t id, const Font_asset* font, int size, int wrap_width)
+{
+    const Key key = {id, font, static_cast<std::uint16_t>(std::clamp(size, 0, 0xFFFF)),
+                     static_cast<std::uint16_t>(std::clamp(wrap_width, 0, 0xFFFF))};
+
+    auto it = runs.find(key);
+
+    if (it != runs.end()) return it->second;
+
+    Text_run& run = runs[key];
+
+    if (font && font->get_line_height() > 0)
+    {
+        const float scale = size > 0 ? static_cast<float>(size) / static_cast<float>(font->get_line_height()) : 1.0f;
+
+        font->layout(Lang_state::Instance().Get_string(id), scale, static_cast<float>(key.wrap_width), run);
+        ++layout_count;
+    }
+
+    return run;
+}
+
+
+int Text_cache::draw(std::uint32_t id, const Font_asset* font, int size, float x, float y, SDL_Color color, int layer, int wrap_width)
+{
+    if (!font) return 0;
+
+    return font->draw(get(id, font, size, wrap_width), x, y, color, layer);
+}
+
+
+void Text_cache::clear()
+{
+    cancel_build();
+
+    runs.clear();
+}
+
+
+void Text_cache::forget(const Font_asset* font)
+{
+    // The worker could be laying out with the font
+    cancel_build();
+
+    for (auto it = runs.begin(); it != runs.end();)
+    {
+        if (it->first.font == font) it = runs.erase(it);
+        else ++it;
+    }
+}
+
+// =========================================================================================== TEXT CACHE
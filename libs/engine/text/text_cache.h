@@ -0,0 +1,149 @@
+// text_cache.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../asset/font_asset.h"
+#include "../lang_state/lang_state.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== TEXT CACHE
+
+
+/**
+ * @brief Laid out runs of the localized strings, by the string id, the font, the size and the wrap.
+ *
+ * The menu text doesn't change between the frames, so it is laid out once: the first
+ * draw() of a key lays out Lang_state::Get_string() into a Text_run, the next ones only
+ * copy its quads into the Render_queue (moved and colored) - no UTF-8 decoding,
+ * no metrics and no line breaking in the steady frames.
+ *
+ * The runs depend on the strings and on the atlas pages. Lang_state::Request_lang()
+ * polls the prepare hook of the cache: the keys in use are laid out again from the
+ * strings of the new language on the worker thread, while the old runs keep being
+ * drawn, and the change hook swaps the two run sets at the frame boundary. A direct
+ * Set_lang() and the render device reset drop the cache - rebuilt once by the next draws.
+ *
+ * Singleton, like Lang_state.
+ *
+ * Usage:
+ * @code
+ * Text_cache::Instance().draw(STR_MENU_START, font, 16, 40.0f, 120.0f, white);
+ * @endcode
+ */
+class Text_cache
+{
+
+public:
+
+    // Returns the singleton instance.
+    static Text_cache& Instance();
+
+
+    /**
+     * @brief Run of the string, laid out on the first request of the key.
+     *
+     * @param id         String_id of the string.
+     * @param font       Font of the run (its baked line height is size 0).
+     * @param size       Line height in px, 0 - the baked one.
+     * @param wrap_width Line width limit in px, 0 - no wrap.
+     * @return Cached run (width and height for the placement), valid until the next clear.
+     */
+    const Text_run& get(std::uint32_t id, const Font_asset* font, int size = 0, int wrap_width = 0);
+
+    /**
+     * @brief Records the cached run of the string at the position.
+     *
+     * @return Quads recorded.
+     */
+    int draw(std::uint32_t id, const Font_asset* font, int size, float x, float y,
+             SDL_Color color = {255, 255, 255, 255}, int layer = 0, int wrap_width = 0);
+
+    // Drops every run and the runs being built (render device reset)
+    void clear();
+
+    // Drops the runs of the font (before the font is destroyed)
+    void forget(const Font_asset* font);
+
+
+    // === STATS ===
+
+    int get_run_count() const { return static_cast<int>(runs.size()); }
+
+    // Layouts since the start - stays flat in the steady frames
+    std::uint64_t get_layout_count() const { return layout_count; }
+
+    // === STATS ===
+
+
+private:
+
+    Text_cache();
+    ~Text_cache();
+
+    // Singleton - not copyable
+    Text_cache(const Text_cache&) = delete;
+    Text_cache& operator=(const Text_cache&) = delete;
+
+
+    struct Key
+    {
+        std::uint32_t id;
+        const Font_asset* font;
+        std::uint16_t size;
+        std::uint16_t wrap_width;
+
+        bool operator==(const Key& other) const
+        {
+            return id == other.id && font == other.font && size == other.size && wrap_width == other.wrap_width;
+        }
+    };
+
+    struct Key_hash
+    {
+        size_t operator()(const Key& key) const
+        {
+            const std::uint64_t packed = (static_cast<std::uint64_t>(key.id) << 32) | (static_cast<std::uint64_t>(key.size) << 16) | key.wrap_width;
+
+            return std::hash<std::uint64_t>()(packed) ^ (std::hash<const void*>()(key.font) * 31);
+        }
+    };
+
+    using Run_map = std::unordered_map<Key, Text_run, Key_hash>;
+
+    // Lang_state change hook - swaps in the built runs of the new language or drops the old ones
+    static void on_lang_change(void* cache);
+
+    // Lang_state prepare hook - starts the build of the language, true when it is done
+    static bool on_lang_prepare(void* cache, Lang_list lang);
+
+    // Worker thread - lays out the job texts into the back runs
+    static int build_main(void* cache);
+
+    // Waits for the worker and drops its runs
+    void cancel_build();
+
+
+    Run_map runs;
+
+    // Runs of the requested language: the worker owns the job until build_done
+    Run_map back;
+    std::vector<Key> build_keys;
+    std::vector<std::string> build_texts;
+    Lang_list build_lang = Lang_list::LIMIT;
+    SDL_Thread* build_thread = nullptr;
+    std::atomic<bool> build_done{false};
+
+    std::uint64_t layout_count = 0;
+};
+
+// =========================================================================================== TEXT CACHE
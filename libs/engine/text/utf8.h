@@ -0,0 +1,145 @@
+// utf8.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstddef>
+#include <cstdint>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== UTF-8
+
+namespace utf8
+{
+    // Codepoint of a malformed sequence
+    constexpr std::uint32_t REPLACEMENT = 0xFFFD;
+
+
+    /**
+     * @brief Decodes the codepoint at p and moves p past it.
+     *
+     * A malformed or truncated sequence is one REPLACEMENT and one byte, so the decoding
+     * always moves on. The text doesn't need a terminator.
+     *
+     * @param p   Position in the text, p < end.
+     * @param end End of the text.
+     * @return Codepoint.
+     */
+    inline std::uint32_t next(const char*& p, const char* end)
+    {
+        const auto* s = reinterpret_cast<const unsigned char*>(p);
+        const std::uint32_t c = s[0];
+
+        if (c < 0x80)
+        {
+            ++p;
+            return c;
+        }
+
+        // Length by the lead byte, 0 - not a lead byte
+        const int length = c >= 0xF0 ? (c < 0xF5 ? 4 : 0) : c >= 0xE0 ? 3 : c >= 0xC2 ? 2 : 0;
+
+        if (length == 0 || end - p < length)
+        {
+            ++p;
+            return REPLACEMENT;
+        }
+
+        std::uint32_t cp = c & (0x7F >> length);
+
+        for (int i = 1; i < length; ++i)
+        {
+            if ((s[i] & 0xC0) != 0x80)
+            {
+                ++p;
+                return REPLACEMENT;
+            }
+
+            cp = (cp << 6) | (s[i] & 0x3F);
+        }
+
+        // Overlong forms and the surrogates are malformed too
+        static const std::uint32_t min_cp[5] = {0, 0, 0x80, 0x800, 0x10000};
+
+        if (cp < min_cp[length] || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+        {
+            ++p;
+            return REPLACEMENT;
+        }
+
+        p += length;
+        return cp;
+    }
+
+
+    // Four bytes from s, the first one in the low byte whatever the byte order
+    inline std::uint32_t load4(const unsigned char* s)
+    {
+        return static_cast<std::uint32_t>(s[0]) | (static_cast<std::uint32_t>(s[1]) << 8) |
+               (static_cast<std::uint32_t>(s[2]) << 16) | (static_cast<std::uint32_t>(s[3]) << 24);
+    }
+
+
+    /**
+     * @brief Decodes the text from p into the codepoints, until the end or the out is full.
+     *
+     * The same codepoints as next() one by one, but the common runs take four bytes a step:
+     * four ASCII characters, or two 2-byte sequences (all the Cyrillic, Latin-1) - one load,
+     * one mask test of the whole word, no branch per byte. Anything else goes to next().
+     * A text of n bytes never has more than n codepoints - an out of n always takes it all.
+     *
+     * @param p        Position in the text, moved past the decoded codepoints.
+     * @param end      End of the text.
+     * @param out      Codepoints.
+     * @param capacity Size of the out.
+     * @return Codepoints written.
+     */
+    inline size_t decode(const char*& p, const char* end, std::uint32_t* out, size_t capacity)
+    {
+        const auto* s = reinterpret_cast<const unsigned char*>(p);
+        const auto* e = reinterpret_cast<const unsigned char*>(end);
+
+        size_t count = 0;
+
+        while (s < e && count < capacity)
+        {
+            if (e - s >= 4 && capacity - count >= 4)
+            {
+                const std::uint32_t word = load4(s);
+
+                // Four ASCII bytes
+                if ((word & 0x80808080u) == 0)
+                {
+                    out[count++] = s[0];
+                    out[count++] = s[1];
+                    out[count++] = s[2];
+                    out[count++] = s[3];
+                    s += 4;
+                    continue;
+                }
+
+                // Two 110xxxxx 10xxxxxx pairs, the leads not the overlong C0, C1
+                if ((word & 0xC0E0C0E0u) == 0x80C080C0u && (word & 0x0000001Eu) && (word & 0x001E0000u))
+                {
+                    out[count++] = ((s[0] & 0x1Fu) << 6) | (s[1] & 0x3Fu);
+                    out[count++] = ((s[2] & 0x1Fu) << 6) | (s[3] & 0x3Fu);
+                    s += 4;
+                    continue;
+                }
+            }
+
+            // A mixed word, the tail, 3 and 4 byte sequences, malformed input
+            const char* c = reinterpret_cast<const char*>(s);
+            out[count++] = next(c, end);
+            s = reinterpret_cast<const unsigned char*>(c);
+        }
+
+        p = reinterpret_cast<const char*>(s);
+        return count;
+    }
+}
+
+// =========================================================================================== UTF-8
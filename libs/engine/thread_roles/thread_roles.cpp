@@ -0,0 +1,150 @@
+// thread_roles.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "thread_roles.h"
+
+#include <ostream>
+
+#ifdef PLATFORM_LINUX
+    #include <cerrno>
+    #include <cstring>
+    #include <sched.h>
+    #include <unistd.h>
+    #include <sys/resource.h>
+    #include <sys/syscall.h>
+#endif
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== THREAD ROLES
+
+Thread_roles& Thread_roles::Instance()
+{
+    // Local static - lazy and thread-safe initialization, single instance
+    static Thread_roles instance;
+
+    return instance;
+}
+
+
+Thread_role_config Thread_roles::device_defaults(Thread_role role)
+{
+    switch (role)
+    {
+        case Thread_role::MAIN:   return {0x1, SDL_THREAD_PRIORITY_HIGH, Thread_role_config::NICE_DEFAULT};
+        case Thread_role::AUDIO:  return {0x2, SDL_THREAD_PRIORITY_TIME_CRITICAL, Thread_role_config::NICE_DEFAULT};
+        case Thread_role::WORKER: return {0x0, SDL_THREAD_PRIORITY_NORMAL, Thread_role_config::NICE_DEFAULT};
+        default:                  return {0x2, SDL_THREAD_PRIORITY_LOW, 10};
+    }
+}
+
+
+void Thread_roles::configure(const Thread_role_config* new_configs)
+{
+    if (!new_configs) return;
+
+    for (int i = 0; i < ROLE_COUNT; ++i) configs[i] = new_configs[i];
+
+    enabled.store(true, std::memory_order_release);
+}
+
+
+void Thread_roles::disable() { enabled.store(false, std::memory_order_release); }
+
+
+const Thread_role_config& Thread_roles::get_config(Thread_role role) const { return configs[static_cast<int>(role)]; }
+
+
+bool Thread_roles::apply(Thread_role role)
+{
+    if (!is_enabled()) return false;
+
+    const int index = static_cast<int>(role);
+    const Thread_role_config& config = configs[index];
+
+    applied[index].fetch_add(1, std::memory_order_relaxed);
+
+    // The first failure of the role is logged - the other threads of it would only repeat it
+    auto fail = [&](const char* what, const char* error)
+    {
+        if (failures[index].fetch_add(1, std::memory_order_relaxed) == 0)
+            SDL_Log("Thread role %s: %s failed: %s", get_role_name(role), what, error);
+    };
+
+#ifdef PLATFORM_LINUX
+    if (config.cpu_mask)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+
+        for (int cpu = 0; cpu < 32; ++cpu)
+            if (config.cpu_mask & (1u << cpu)) CPU_SET(cpu, &set);
+
+        // Pid 0 - the calling thread; EINVAL - no CPU of the mask is online (a single-core build)
+        if (sched_setaffinity(0, sizeof(set), &set) != 0) fail("sched_setaffinity", std::strerror(errno));
+    }
+#endif
+
+    if (SDL_SetThreadPriority(config.priority) != 0) fail("SDL_SetThreadPriority", SDL_GetError());
+
+#ifdef PLATFORM_LINUX
+    if (config.nice != Thread_role_config::NICE_DEFAULT)
+    {
+        // The nice value of a Linux thread is its own - set by the thread id
+        const id_t tid = static_cast<id_t>(syscall(SYS_gettid));
+
+        if (setpriority(PRIO_PROCESS, tid, config.nice) != 0) fail("setpriority", std::strerror(errno));
+    }
+#endif
+
+    return true;
+}
+
+
+const char* Thread_roles::get_role_name(Thread_role role)
+{
+    switch (role)
+    {
+        case Thread_role::MAIN:   return "main";
+        case Thread_role::AUDIO:  return "audio";
+        case Thread_role::WORKER: return "worker";
+        case Thread_role::IO:     return "io";
+        default:                  return "?";
+    }
+}
+
+
+void Thread_roles::dump(std::ostream& out) const
+{
+    if (!is_enabled()) return;
+
+    static const char* const priority_names[] = {"low", "normal", "high", "time critical"};
+
+    out << "=== Thread roles ===\n";
+
+    for (int i = 0; i < ROLE_COUNT; ++i)
+    {
+        const Thread_role_config& c = configs[i];
+        const int priority = static_cast<int>(c.priority);
+
+        out << "  " << get_role_name(static_cast<Thread_role>(i)) << ": ";
+
+        if (c.cpu_mask) out << "CPUs 0x" << std::hex << c.cpu_mask << std::dec;
+        else out << "any CPU";
+
+        out << ", " << (priority >= 0 && priority < 4 ? priority_names[priority] : "?") << " priority";
+
+        if (c.nice != Thread_role_config::NICE_DEFAULT) out << ", nice " << c.nice;
+
+        out << " - " << applied[i].load(std::memory_order_relaxed) << " thread(s)";
+
+        if (const int failed = failures[i].load(std::memory_order_relaxed)) out << ", " << failed << " failed call(s)";
+
+        out << "\n";
+    }
+}
+
+// =========================================================================================== THREAD ROLES
@@ -0,0 +1,143 @@
+// thread_roles.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== THREAD ROLES
+
+
+// What an engine thread does - its CPUs and its priority come from the role
+enum class Thread_role : std::uint8_t
+{
+    MAIN,       // the game: the main thread, the update worker, the input reader
+    AUDIO,      // the mixer callback of the audio device
+    WORKER,     // the frame work: the job workers, the decoders, the text builds
+    IO,         // the files: the loaders, the prefetch, the log, the saves, the telemetry
+
+    COUNT
+};
+
+
+// Scheduling of the threads of a role
+struct Thread_role_config
+{
+    // Nice value of the SDL priority (Linux: LOW 19, NORMAL 0, HIGH -10, TIME_CRITICAL -20)
+    static constexpr int NICE_DEFAULT = 100;
+
+    // CPUs the threads run on, a bit per CPU (Linux), 0 - any
+    std::uint32_t cpu_mask = 0;
+
+    SDL_ThreadPriority priority = SDL_THREAD_PRIORITY_NORMAL;
+
+    // Nice value set after the priority (Linux, -20 .. 19, below 0 needs the root), NICE_DEFAULT - the SDL one
+    int nice = NICE_DEFAULT;
+};
+
+
+/**
+ * @brief CPU affinity, priority and nice value of the engine threads by their role.
+ *
+ * On the dual-core Miyoo the mixer callback, the loaders and the game compete for two
+ * cores with the same priority - an audio underrun when a loader takes the core at the
+ * wrong time, a frame spike when a worker does. Every thread of the engine applies its
+ * role once, at its start (the mixer - in its first callback): the affinity
+ * (sched_setaffinity), the SDL priority (SDL_SetThreadPriority) and the nice value
+ * (setpriority), in this order - the nice value overrides the one of the priority.
+ *
+ * The defaults for the Miyoo (device_defaults()): the game alone on the CPU 0 at the
+ * high priority; the audio on the CPU 1 at the time-critical one, next to the files at
+ * the low priority (nice 10 - behind everything, not starved); the workers on both
+ * cores - the parallel batches use them all.
+ *
+ * Off until configure() - the threads keep their own priorities (the log and the saves
+ * low, the input reader high) and the scheduler's CPUs then, apply() returns false.
+ * A failed call (no permission for a negative nice, no CPU of the mask) is logged once
+ * per role and counted, the thread runs on.
+ *
+ * Singleton, like Log, so every thread reaches it without any context.
+ *
+ * Usage:
+ * @code
+ * Thread_roles::Instance().configure(configs);                  // SDL_app_init, before any thread
+ *
+ * static int worker_main(void* self)
+ * {
+ *     Thread_roles::Instance().apply(Thread_role::WORKER);      // first thing of the thread
+ * }
+ * @endcode
+ */
+class Thread_roles
+{
+
+public:
+
+    static constexpr int ROLE_COUNT = static_cast<int>(Thread_role::COUNT);
+
+
+    // Returns the singleton instance.
+    static Thread_roles& Instance();
+
+
+    // Defaults of the dual-core Miyoo of the role
+    static Thread_role_config device_defaults(Thread_role role);
+
+    /**
+     * @brief Enables the roles with the configs - the threads started from now on apply them.
+     *
+     * @param configs Config of every role (ROLE_COUNT, in the Thread_role order).
+     */
+    void configure(const Thread_role_config* configs);
+
+    // Disables the roles - the next threads keep their own priorities
+    void disable();
+
+    bool is_enabled() const { return enabled.load(std::memory_order_acquire); }
+
+    const Thread_role_config& get_config(Thread_role role) const;
+
+
+    /**
+     * @brief Applies the role to the calling thread.
+     *
+     * @return false if the roles are off - the thread sets its own priority then.
+     */
+    bool apply(Thread_role role);
+
+
+    // Name of the role ("main", "io")
+    static const char* get_role_name(Thread_role role);
+
+    // Prints the configs, the threads of every role and the failures
+    void dump(std::ostream& out) const;
+
+
+private:
+
+    // Private constructor for singleton
+    Thread_roles() = default;
+
+    // Copying the singleton is not allowed
+    Thread_roles(const Thread_roles&) = delete;
+    Thread_roles& operator=(const Thread_roles&) = delete;
+
+
+    Thread_role_config configs[ROLE_COUNT];
+
+    std::atomic<bool> enabled{false};
+
+    // Threads, which applied the role, and the failed calls (the first one of a role is logged)
+    std::atomic<int> applied[ROLE_COUNT] = {};
+    std::atomic<int> failures[ROLE_COUNT] = {};
+};
+
+// =========================================================================================== THREAD ROLES
@@ -0,0 +1,294 @@
+// tile_map.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "tile_map.h"
+#include "../asset/asset.h"
+#include "../render_queue/render_queue.h"
+#include "../frame/frame.h"
+#include "../render_stats/render_stats.h"
+
+#include <algorithm>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== TILE MAP
+
+// Rounds down for the camera left of (above) the map too
+static int floor_div(int value, int divisor)
+{
+    return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+
+std::vector<Tile_map*>& Tile_map::registry()
+{
+    static std::vector<Tile_map*> maps;
+
+    return maps;
+}
+
+
+Tile_map::Tile_map() { registry().push_back(this); }
+
+
+Tile_map::~Tile_map()
+{
+    release();
+
+    auto& maps = registry();
+    maps.erase(std::remove(maps.begin(), maps.end(), this), maps.end());
+}
+
+
+bool Tile_map::create(Image_asset* tile_sheet, int size, int map_width, int map_height)
+{
+    if (size <= 0 || map_width <= 0 || map_height <= 0) return false;
+
+    release();
+
+    sheet = tile_sheet;
+    tile_size = size;
+    width = map_width;
+    height = map_height;
+
+    chunks_x = (width + CHUNK_TILES - 1) / CHUNK_TILES;
+    chunks_y = (height + CHUNK_TILES - 1) / CHUNK_TILES;
+
+    tiles.assign(static_cast<size_t>(width) * height, 0);
+    chunks.assign(static_cast<size_t>(chunks_x) * chunks_y, Chunk());
+
+    Frame::Instance().mark_dirty();
+
+    return true;
+}
+
+
+void Tile_map::set_tile(int x, int y, std::uint16_t tile)
+{
+    if (x < 0 || y < 0 || x >= width || y >= height) return;
+
+    std::uint16_t& current = tiles[static_cast<size_t>(y) * width + x];
+
+    if (current == tile) return;
+
+    current = tile;
+
+    chunks[static_cast<size_t>(y / CHUNK_TILES) * chunks_x + x / CHUNK_TILES].dirty = true;
+
+    Frame::Instance().mark_dirty();
+}
+
+
+std::uint16_t Tile_map::get_tile(int x, int y) const
+{
+    if (x < 0 || y < 0 || x >= width || y >= height) return 0;
+
+    return tiles[static_cast<size_t>(y) * width + x];
+}
+
+
+void Tile_map::render(SDL_Renderer* r, int camera_x, int camera_y, int layer)
+{
+    visible_chunks = 0;
+
+    if (!r || chunks.empty()) return;
+
+    // The view in the logical pixels, the output without the logical size
+    int view_w = 0, view_h = 0;
+    SDL_RenderGetLogicalSize(r, &view_w, &view_h);
+
+    if (view_w == 0 || view_h == 0) SDL_GetRendererOutputSize(r, &view_w, &view_h);
+
+    const int chunk_px = CHUNK_TILES * tile_size;
+
+    // Visible chunk range, clamped to the map
+    const int first_x = std::max(0, floor_div(camera_x, chunk_px));
+    const int first_y = std::max(0, floor_div(camera_y, chunk_px));
+    const int last_x = std::min(chunks_x - 1, floor_div(camera_x + view_w - 1, chunk_px));
+    const int last_y = std::min(chunks_y - 1, floor_div(camera_y + view_h - 1, chunk_px));
+
+    // Culled chunks give their textures back first - the chunks scrolling in reuse them
+    for (int cy = 0; cy < chunks_y; ++cy)
+        for (int cx = 0; cx < chunks_x; ++cx)
+        {
+            Chunk& chunk = chunks[static_cast<size_t>(cy) * chunks_x + cx];
+
+            if (chunk.texture && (cx < first_x || cx > last_x || cy < first_y || cy > last_y)) recycle(chunk);
+        }
+
+    const bool targets = SDL_RenderTargetSupported(r) == SDL_TRUE;
+
+    Render_queue& queue = Render_queue::Instance();
+
+    for (int cy = first_y; cy <= last_y; ++cy)
+        for (int cx = first_x; cx <= last_x; ++cx)
+        {
+            Chunk& chunk = chunks[static_cast<size_t>(cy) * chunks_x + cx];
+
+            const float x = static_cast<float>(cx * chunk_px - camera_x);
+            const float y = static_cast<float>(cy * chunk_px - camera_y);
+
+            ++visible_chunks;
+
+            if (targets && (!chunk.dirty || rebuild(r, cx, cy, chunk)))
+            {
+                queue.copy(chunk.texture, nullptr, {x, y, static_cast<float>(chunk_px), static_cast<float>(chunk_px)}, layer);
+                continue;
+            }
+
+            draw_tiles(cx, cy, x, y, layer);
+        }
+}
+
+
+bool Tile_map::rebuild(SDL_Renderer* r, int chunk_x, int chunk_y, Chunk& chunk)
+{
+    const int chunk_px = CHUNK_TILES * tile_size;
+
+    if (!chunk.texture && !free_textures.empty())
+    {
+        chunk.texture = free_textures.back();
+        free_textures.pop_back();
+    }
+
+    if (!chunk.texture)
+    {
+        chunk.texture = SDL_CreateTexture(r, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, chunk_px, chunk_px);
+
+        if (!chunk.texture)
+        {
+            SDL_Log("Tile map chunk texture creation failed: %s", SDL_GetError());
+            return false;
+        }
+
+        SDL_SetTextureBlendMode(chunk.texture, SDL_BLENDMODE_BLEND);
+        ++texture_count;
+    }
+
+    SDL_Texture* prev_target = SDL_GetRenderTarget(r);
+
+    Render::set_target(r, chunk.texture);
+    SDL_SetRenderDrawColor(r, 0, 0, 0, 0);
+    Render::clear(r);
+
+    // Only the chunk tiles - the commands the state has queued stay for the frame
+    Render_queue& queue = Render_queue::Instance();
+    int mark = queue.get_command_count();
+
+    draw_tiles(chunk_x, chunk_y, 0.0f, 0.0f, 0);
+
+    queue.submit_since(r, mark);
+
+    Render::set_target(r, prev_target);
+
+    chunk.dirty = false;
+    ++rebuild_count;
+
+    return true;
+}
+
+
+void Tile_map::draw_tiles(int chunk_x, int chunk_y, float x, float y, int layer) const
+{
+    SDL_Texture* texture = sheet ? sheet->get_texture() : nullptr;
+
+    if (!texture) return;
+
+    Render_queue& queue = Render_queue::Instance();
+
+    const int tx0 = chunk_x * CHUNK_TILES;
+    const int ty0 = chunk_y * CHUNK_TILES;
+    const int tx1 = std::min(width, tx0 + CHUNK_TILES);
+    const int ty1 = std::min(height, ty0 + CHUNK_TILES);
+
+    const float side = static_cast<float>(tile_size);
+
+    for (int ty = ty0; ty < ty1; ++ty)
+        for (int tx = tx0; tx < tx1; ++tx)
+        {
+            SDL_Rect src;
+
+            if (!get_source_rect(tiles[static_cast<size_t>(ty) * width + tx], src)) continue;
+
+            queue.copy(texture, &src, {x + (tx - tx0) * side, y + (ty - ty0) * side, side, side}, layer);
+        }
+}
+
+
+bool Tile_map::get_source_rect(std::uint16_t tile, SDL_Rect& rect) const
+{
+    if (tile == 0) return false;
+
+    // The sheet region inside its texture (atlas page). The grid is logical - a resolution
+    // variant of the sheet has the tiles at the texel scale, the drawn side stays tile_size
+    const Rect2& region = sheet->get_texture_region();
+    const Vec2 texel = sheet->get_texel_scale();
+
+    const int columns = static_cast<int>(sheet->get_width()) / tile_size;
+    const int rows = static_cast<int>(sheet->get_height()) / tile_size;
+
+    const int cell = tile - 1;
+
+    if (columns <= 0 || cell >= columns * rows) return false;
+
+    const int left = (cell % columns) * tile_size;
+    const int top = (cell / columns) * tile_size;
+
+    rect.x = static_cast<int>(region.top_left.x + left * texel.x + 0.5f);
+    rect.y = static_cast<int>(region.top_left.y + top * texel.y + 0.5f);
+    rect.w = static_cast<int>(region.top_left.x + (left + tile_size) * texel.x + 0.5f) - rect.x;
+    rect.h = static_cast<int>(region.top_left.y + (top + tile_size) * texel.y + 0.5f) - rect.y;
+
+    return true;
+}
+
+
+void Tile_map::recycle(Chunk& chunk)
+{
+    free_textures.push_back(chunk.texture);
+
+    chunk.texture = nullptr;
+    chunk.dirty = true;
+}
+
+
+void Tile_map::invalidate_all()
+{
+    for (Chunk& chunk : chunks) chunk.dirty = true;
+
+    Frame::Instance().mark_dirty();
+}
+
+
+void Tile_map::release()
+{
+    for (Chunk& chunk : chunks)
+    {
+        if (chunk.texture) SDL_DestroyTexture(chunk.texture);
+
+        chunk.texture = nullptr;
+        chunk.dirty = true;
+    }
+
+    for (SDL_Texture* texture : free_textures) SDL_DestroyTexture(texture);
+
+    free_textures.clear();
+    texture_count = 0;
+}
+
+
+void Tile_map::invalidate_all_maps()
+{
+    for (Tile_map* map : registry()) map->invalidate_all();
+}
+
+
+void Tile_map::release_all_maps()
+{
+    for (Tile_map* map : registry()) map->release();
+}
+
+// =========================================================================================== TILE MAP
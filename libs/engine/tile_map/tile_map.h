@@ -0,0 +1,171 @@
+// tile_map.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+#include <vector>
+
+#include "../platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== TILE MAP
+
+class Image_asset;
+
+
+/**
+ * @brief Grid of the tiles drawn through the cached chunk textures.
+ *
+ * The map is cut into chunks of CHUNK_TILES x CHUNK_TILES tiles. A visible chunk is
+ * rendered into its own target texture once - from the tile sheet (an atlas page or
+ * the own texture of the image) - and costs one texture copy per frame after that.
+ * set_tile() marks only its chunk for the redraw.
+ *
+ * Chunks outside the camera are culled: their textures go back to the pool and
+ * are reused by the chunks scrolling in, so the texture count follows the view,
+ * not the map size.
+ *
+ * Tile 0 is empty, tile n is the n-th cell of the sheet (row by row from 1).
+ * Without the render target support the visible tiles are drawn one by one.
+ * The engine invalidates all maps when the render targets are reset and releases
+ * their textures on the shutdown.
+ *
+ * Usage:
+ * @code
+ * Tile_map map;
+ *
+ * map.create(&tiles, 16, 200, 30);         // 16 px tiles, 200 x 30 of them
+ * map.set_tile(12, 20, 3);
+ *
+ * map.render(r, camera_x, camera_y);       // state render
+ * @endcode
+ */
+class Tile_map
+{
+
+public:
+
+    // Side of a chunk in tiles
+    static constexpr int CHUNK_TILES = 16;
+
+
+    Tile_map();
+
+    // Releases the chunk textures
+    ~Tile_map();
+
+    // Textures and the registration are not copyable
+    Tile_map(const Tile_map&) = delete;
+    Tile_map& operator=(const Tile_map&) = delete;
+
+
+    /**
+     * @brief Sets the sheet and the size, every tile empty.
+     *
+     * @param sheet     Image with the tiles in a grid, outlives the map.
+     * @param tile_size Tile side in pixels (in the sheet and on the screen).
+     * @param width     Map width in tiles.
+     * @param height    Map height in tiles.
+     * @return false if a size is not positive.
+     */
+    bool create(Image_asset* sheet, int tile_size, int width, int height);
+
+    // Sets a tile and marks its chunk for the redraw, out of the map is ignored
+    void set_tile(int x, int y, std::uint16_t tile);
+
+    // Tile at the position, 0 out of the map
+    std::uint16_t get_tile(int x, int y) const;
+
+
+    /**
+     * @brief Draws the part of the map under the camera, rebuilding the changed visible chunks.
+     *
+     * @param r        Renderer of the frame.
+     * @param camera_x Map pixel at the left edge of the output.
+     * @param camera_y Map pixel at the top edge of the output.
+     * @param layer    Render_queue layer of the chunk copies.
+     */
+    void render(SDL_Renderer* r, int camera_x, int camera_y, int layer = 0);
+
+    // Marks every chunk for the redraw
+    void invalidate_all();
+
+    // Destroys the chunk textures (they are rebuilt by the next render)
+    void release();
+
+
+    // === STATS ===
+
+    int get_width() const { return width; }
+    int get_height() const { return height; }
+    int get_tile_size() const { return tile_size; }
+
+    // Chunks drawn by the last render
+    int get_visible_chunks() const { return visible_chunks; }
+
+    // Chunk textures alive - in use and pooled
+    int get_texture_count() const { return texture_count; }
+
+    // Chunk rebuilds since the start (for the diagnostics)
+    Uint64 get_rebuild_count() const { return rebuild_count; }
+
+    // === STATS ===
+
+
+    // Invalidates every existing map (render targets reset)
+    static void invalidate_all_maps();
+
+    // Releases the textures of every existing map (before the renderer is destroyed)
+    static void release_all_maps();
+
+
+private:
+
+    struct Chunk
+    {
+        SDL_Texture* texture = nullptr;
+        bool dirty = true;
+    };
+
+    // Renders the chunk tiles into its texture, false if it can't be cached
+    bool rebuild(SDL_Renderer* r, int chunk_x, int chunk_y, Chunk& chunk);
+
+    // Queues the tiles of the chunk one by one at the output position
+    void draw_tiles(int chunk_x, int chunk_y, float x, float y, int layer) const;
+
+    // Source rectangle of the tile in the sheet texture, false for the empty tile
+    bool get_source_rect(std::uint16_t tile, SDL_Rect& rect) const;
+
+    // Returns the chunk texture to the pool
+    void recycle(Chunk& chunk);
+
+
+    Image_asset* sheet = nullptr;
+
+    int tile_size = 0;
+    int width = 0;
+    int height = 0;
+
+    int chunks_x = 0;
+    int chunks_y = 0;
+
+    std::vector<std::uint16_t> tiles;
+    std::vector<Chunk> chunks;
+
+    // Textures of the culled chunks, reused before a new one is created
+    std::vector<SDL_Texture*> free_textures;
+
+    int visible_chunks = 0;
+    int texture_count = 0;
+    Uint64 rebuild_count = 0;
+
+
+    // All existing maps - for the engine-wide reset and release
+    static std::vector<Tile_map*>& registry();
+};
+
+// =========================================================================================== TILE MAP
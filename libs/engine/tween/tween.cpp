@@ -0,0 +1,272 @@
+// tween.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "tween.h"
+
+#include <algorithm>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== EASING
+
+// Segments of a curve table - the lerp between the samples is below 0.1% off for these curves
+static constexpr int EASE_SEGMENTS = 64;
+
+
+static float ease_exact(Ease curve, float t)
+{
+    switch (curve)
+    {
+        case EASE_IN_QUAD: return t * t;
+        case EASE_OUT_QUAD: return t * (2.0f - t);
+        case EASE_IN_OUT_QUAD: return t < 0.5f ? 2.0f * t * t : 1.0f - 2.0f * (1.0f - t) * (1.0f - t);
+        case EASE_IN_CUBIC: return t * t * t;
+        case EASE_OUT_CUBIC: { const float u = 1.0f - t; return 1.0f - u * u * u; }
+        case EASE_IN_OUT_CUBIC: return t < 0.5f ? 4.0f * t * t * t : 1.0f - 4.0f * (1.0f - t) * (1.0f - t) * (1.0f - t);
+        case EASE_SMOOTHSTEP: return t * t * (3.0f - 2.0f * t);
+
+        case EASE_OUT_BACK:
+        {
+            const float s = 1.70158f;
+            const float u = t - 1.0f;
+            return 1.0f + u * u * ((s + 1.0f) * u + s);
+        }
+
+        case EASE_OUT_BOUNCE:
+        {
+            const float n = 7.5625f;
+
+            if (t < 1.0f / 2.75f) return n * t * t;
+            if (t < 2.0f / 2.75f) { t -= 1.5f / 2.75f; return n * t * t + 0.75f; }
+            if (t < 2.5f / 2.75f) { t -= 2.25f / 2.75f; return n * t * t + 0.9375f; }
+
+            t -= 2.625f / 2.75f;
+            return n * t * t + 0.984375f;
+        }
+
+        default: return t;
+    }
+}
+
+
+// Samples of every curve, one extra for the lerp of the last segment
+static const float (&get_ease_tables())[EASE_COUNT][EASE_SEGMENTS + 1]
+{
+    static float tables[EASE_COUNT][EASE_SEGMENTS + 1];
+    static bool built = false;
+
+    if (!built)
+    {
+        for (int c = 0; c < EASE_COUNT; ++c)
+            for (int i = 0; i <= EASE_SEGMENTS; ++i)
+                tables[c][i] = ease_exact(static_cast<Ease>(c), static_cast<float>(i) / EASE_SEGMENTS);
+
+        built = true;
+    }
+
+    return tables;
+}
+
+
+// Lookup of the clamped t - shared by ease() and the update loop
+static inline float ease_lookup(const float* table, float t)
+{
+    t = std::min(std::max(t, 0.0f), 1.0f);
+
+    const float position = t * EASE_SEGMENTS;
+    const int i = std::min(static_cast<int>(position), EASE_SEGMENTS - 1);
+    const float frac = position - static_cast<float>(i);
+
+    return table[i] + (table[i + 1] - table[i]) * frac;
+}
+
+
+float ease(Ease curve, float t)
+{
+    if (curve >= EASE_COUNT) curve = EASE_LINEAR;
+
+    return ease_lookup(get_ease_tables()[curve], t);
+}
+
+// =========================================================================================== EASING
+
+
+// =========================================================================================== TWEEN SYSTEM
+
+// Handle: generation in the high 16 bits (never 0), slot in the low ones
+static Tween make_handle(std::uint32_t slot, std::uint16_t generation) { return (static_cast<Tween>(generation) << 16) | slot; }
+
+
+Tween_system& Tween_system::Instance()
+{
+    static Tween_system instance;
+    return instance;
+}
+
+
+Tween_system& Tween_system::Audio_synced()
+{
+    static Tween_system instance;
+    return instance;
+}
+
+
+Tween_system::Tween_system(int requested)
+    : capacity(std::min(std::max(requested, 1), 0xFFFF))
+{
+    const size_t n = static_cast<size_t>(capacity);
+
+    targets.resize(n, nullptr);
+    from.resize(n, 0.0f);
+    delta.resize(n, 0.0f);
+    elapsed.resize(n, 0.0f);
+    inv_duration.resize(n, 0.0f);
+    curves.resize(n, EASE_LINEAR);
+    done_fns.resize(n, nullptr);
+    done_contexts.resize(n, nullptr);
+    owners.resize(n, 0);
+
+    indices.resize(n, -1);
+    generations.resize(n, 1);
+
+    free_slots.reserve(n);
+    for (std::uint32_t slot = static_cast<std::uint32_t>(capacity); slot-- > 0;) free_slots.push_back(slot);
+
+    // Built here, not in the first update tick
+    get_ease_tables();
+}
+
+
+Tween Tween_system::start(float* target, float start_value, float end_value, float duration, Ease curve,
+                          float delay, Done_fn done, void* context)
+{
+    if (!target) return 0;
+
+    if (free_slots.empty())
+    {
+        ++dropped;
+        return 0;
+    }
+
+    const std::uint32_t slot = free_slots.back();
+    free_slots.pop_back();
+
+    const int i = count++;
+
+    targets[i] = target;
+    from[i] = start_value;
+    delta[i] = end_value - start_value;
+    elapsed[i] = -std::max(delay, 0.0f);
+    inv_duration[i] = duration > 0.0f ? 1.0f / duration : 1e30f;
+    curves[i] = curve < EASE_COUNT ? curve : EASE_LINEAR;
+    done_fns[i] = done;
+    done_contexts[i] = context;
+    owners[i] = slot;
+
+    indices[slot] = i;
+
+    *target = start_value;
+
+    return make_handle(slot, generations[slot]);
+}
+
+
+bool Tween_system::is_active(Tween tween) const
+{
+    const std::uint32_t slot = tween & 0xFFFF;
+
+    return tween != 0 && slot < static_cast<std::uint32_t>(capacity) && indices[slot] >= 0
+        && generations[slot] == static_cast<std::uint16_t>(tween >> 16);
+}
+
+
+void Tween_system::stop(Tween tween)
+{
+    if (is_active(tween)) remove_at(indices[tween & 0xFFFF]);
+}
+
+
+void Tween_system::stop_target(const float* target)
+{
+    for (int i = count; i-- > 0;)
+        if (targets[i] == target) remove_at(i);
+}
+
+
+void Tween_system::clear()
+{
+    while (count > 0) remove_at(count - 1);
+}
+
+
+void Tween_system::remove_at(int index)
+{
+    const std::uint32_t slot = owners[index];
+
+    // A new generation - the handles of this tween are stale, 0 is never a generation
+    generations[slot] = static_cast<std::uint16_t>(generations[slot] + 1 == 0x10000 ? 1 : generations[slot] + 1);
+    indices[slot] = -1;
+    free_slots.push_back(slot);
+
+    const int last = --count;
+
+    if (index != last)
+    {
+        targets[index] = targets[last];
+        from[index] = from[last];
+        delta[index] = delta[last];
+        elapsed[index] = elapsed[last];
+        inv_duration[index] = inv_duration[last];
+        curves[index] = curves[last];
+        done_fns[index] = done_fns[last];
+        done_contexts[index] = done_contexts[last];
+        owners[index] = owners[last];
+
+        indices[owners[index]] = index;
+    }
+}
+
+
+void Tween_system::update(float dt)
+{
+    if (count == 0) return;
+
+    const auto& tables = get_ease_tables();
+
+    bool finished = false;
+
+    // One pass over the packed arrays, the same code for every curve
+    for (int i = 0; i < count; ++i)
+    {
+        elapsed[i] += dt;
+
+        const float t = elapsed[i] * inv_duration[i];
+
+        *targets[i] = from[i] + delta[i] * ease_lookup(tables[curves[i]], t);
+
+        finished |= t >= 1.0f;
+    }
+
+    if (!finished) return;
+
+    // From the back - a callback could start a tween (appended) or stop one (swapped in from the back)
+    for (int i = count; i-- > 0;)
+    {
+        if (i >= count || elapsed[i] * inv_duration[i] < 1.0f) continue;
+
+        // The exact end, the table's last sample is the curve at 1
+        *targets[i] = from[i] + delta[i];
+
+        const Done_fn done = done_fns[i];
+        void* const context = done_contexts[i];
+
+        remove_at(i);
+
+        if (done) done(context);
+    }
+}
+
+// =========================================================================================== TWEEN SYSTEM
@@ -0,0 +1,171 @@
+// tween.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+#include <vector>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== EASING
+
+enum Ease : std::uint8_t
+{
+    EASE_LINEAR,
+    EASE_IN_QUAD,
+    EASE_OUT_QUAD,
+    EASE_IN_OUT_QUAD,
+    EASE_IN_CUBIC,
+    EASE_OUT_CUBIC,
+    EASE_IN_OUT_CUBIC,
+    EASE_SMOOTHSTEP,
+    EASE_OUT_BACK,          // overshoots the end a bit - the UI pop
+    EASE_OUT_BOUNCE,
+
+    EASE_COUNT
+};
+
+/**
+ * Curve value at t (0 - 1) from the curve's lookup table: the samples are built once,
+ * every curve is the same load and lerp - no switch and no pow per evaluation.
+ * t out of 0 - 1 is clamped.
+ */
+float ease(Ease curve, float t);
+
+// =========================================================================================== EASING
+
+
+// =========================================================================================== TWEEN SYSTEM
+
+// Handle of a started tween, 0 - none (the system was full)
+using Tween = std::uint32_t;
+
+
+/**
+ * @brief Float animations of the states and the UI, all evaluated by one pass per tick.
+ *
+ * A tween writes from + (to - from) * ease(curve, elapsed / duration) into its target
+ * every tick until the duration ends (the last write is exactly the end value).
+ * The active tweens are packed structure-of-arrays - the target, the curve, the start,
+ * the delta, the elapsed time and 1 / the duration - and update() is one loop over them.
+ * A finished tween is swapped out with the last one, its slot is reused by the next start:
+ * the capacity is allocated by the constructor and never grows.
+ *
+ * The handles have a generation - a handle of a finished tween is stale, stop() ignores it.
+ * The target must outlive the tween (or stop_target() it).
+ * Colors fade as their channels, one tween per float.
+ *
+ * Singleton, updated by the engine after every state_update tick (Engine_clock tick_dt),
+ * so the states only start the tweens. The Audio_synced() one is updated by the same
+ * ticks with the Audio_timeline step - its tweens stay locked to the heard music.
+ *
+ * Usage:
+ * @code
+ * Tween_system& tweens = Tween_system::Instance();
+ *
+ * tweens.start(&menu_x, -200.0f, 40.0f, 0.35f, EASE_OUT_BACK);
+ * Tween fade = tweens.start(&overlay_alpha, 0.0f, 1.0f, 0.2f);
+ *
+ * tweens.stop(fade);          // back before the end - the value stays where it is
+ * @endcode
+ */
+class Tween_system
+{
+
+public:
+
+    // Called once when the tween reaches its end (not when stopped)
+    using Done_fn = void (*)(void* context);
+
+
+    // Returns the singleton instance.
+    static Tween_system& Instance();
+
+    // Second system, advanced by the Audio_timeline steps - the tweens in the music time (the fades on the beat)
+    static Tween_system& Audio_synced();
+
+    // Slots for the tweens alive at the same time
+    explicit Tween_system(int capacity = 256);
+
+
+    /**
+     * @brief Starts animating the target, the first tick moves it already.
+     *
+     * @param target   Value to write.
+     * @param from     Value at the start (written right away).
+     * @param to       Value at the end.
+     * @param duration Seconds, <= 0 jumps to the end by the next update.
+     * @param curve    Easing curve.
+     * @param delay    Seconds at from before the animation.
+     * @param done     Optional end callback and its context.
+     * @return Handle, 0 if every slot is in use.
+     */
+    Tween start(float* target, float from, float to, float duration, Ease curve = EASE_LINEAR,
+                float delay = 0.0f, Done_fn done = nullptr, void* context = nullptr);
+
+    // Stops the tween where it is, stale handles are ignored
+    void stop(Tween tween);
+
+    // Stops every tween writing the target (its owner is destroyed)
+    void stop_target(const float* target);
+
+    // Stops everything
+    void clear();
+
+    bool is_active(Tween tween) const;
+
+
+    // Advances every tween by dt seconds (the engine, once per tick)
+    void update(float dt);
+
+
+    // === STATS ===
+
+    int get_capacity() const { return capacity; }
+    int get_active() const { return count; }
+
+    // Starts refused because the capacity was full
+    std::uint64_t get_dropped() const { return dropped; }
+
+    // === STATS ===
+
+
+private:
+
+    // Removes the tween at the packed index (swap with the last one)
+    void remove_at(int index);
+
+
+    int capacity;
+    int count = 0;
+
+    // === PACKED, by the index 0 - count ===
+
+    std::vector<float*> targets;
+    std::vector<float> from;
+    std::vector<float> delta;
+    std::vector<float> elapsed;
+    std::vector<float> inv_duration;
+    std::vector<Ease> curves;
+
+    std::vector<Done_fn> done_fns;
+    std::vector<void*> done_contexts;
+
+    // Slot of the tween at the index (its handle)
+    std::vector<std::uint32_t> owners;
+
+    // === PACKED ===
+
+    // Slot -> packed index (the handle lookup) and the generation of the slot
+    std::vector<int> indices;
+    std::vector<std::uint16_t> generations;
+
+    std::vector<std::uint32_t> free_slots;
+
+    std::uint64_t dropped = 0;
+};
+
+// =========================================================================================== TWEEN SYSTEM
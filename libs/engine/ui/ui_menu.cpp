@@ -0,0 +1,418 @@
+// ui_menu.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "ui_menu.h"
+#include "../input/input.h"
+#include "../frame/frame.h"
+#include "../lang_state/lang_state.h"
+#include "../render_queue/render_queue.h"
+#include "../text/text_cache.h"
+#include "../render_stats/render_stats.h"
+#include "../render_target_pool/render_target_pool.h"
+
+#include <algorithm>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== UI MENU
+
+std::vector<Ui_menu*>& Ui_menu::registry()
+{
+    static std::vector<Ui_menu*> menus;
+
+    return menus;
+}
+
+
+Ui_menu::Ui_menu()
+{
+    registry().push_back(this);
+
+    Lang_state::Instance().Add_change_hook(&Ui_menu::on_lang_change, this);
+}
+
+
+Ui_menu::~Ui_menu()
+{
+    release();
+
+    Lang_state::Instance().Remove_change_hook(&Ui_menu::on_lang_change, this);
+
+    auto& menus = registry();
+    menus.erase(std::remove(menus.begin(), menus.end(), this), menus.end());
+}
+
+
+void Ui_menu::on_lang_change(void* menu) { static_cast<Ui_menu*>(menu)->invalidate_all(); }
+
+
+void Ui_menu::set_font(const Font_asset* new_font)
+{
+    if (font == new_font) return;
+
+    font = new_font;
+    invalidate_all();
+}
+
+
+void Ui_menu::set_style(const Widget_style& new_style)
+{
+    style = new_style;
+    invalidate_all();
+}
+
+
+int Ui_menu::add(Widget widget)
+{
+    widgets.push_back(std::move(widget));
+
+    const int index = static_cast<int>(widgets.size()) - 1;
+
+    if (focus < 0 && widgets[index].kind != Widget_kind::LABEL) focus = index;
+
+    Frame::Instance().mark_dirty();
+
+    return index;
+}
+
+
+int Ui_menu::add_label(const SDL_Rect& rect, std::uint32_t text_id)
+{
+    Widget widget;
+
+    widget.kind = Widget_kind::LABEL;
+    widget.rect = rect;
+    widget.text_id = text_id;
+
+    return add(std::move(widget));
+}
+
+
+int Ui_menu::add_button(const SDL_Rect& rect, std::uint32_t text_id, Action_fn action, void* context)
+{
+    Widget widget;
+
+    widget.kind = Widget_kind::BUTTON;
+    widget.rect = rect;
+    widget.text_id = text_id;
+    widget.action = action;
+    widget.context = context;
+
+    return add(std::move(widget));
+}
+
+
+int Ui_menu::add_list(const SDL_Rect& rect, std::vector<std::string> items, int selected, Action_fn action, void* context)
+{
+    Widget widget;
+
+    widget.kind = Widget_kind::LIST;
+    widget.rect = rect;
+    widget.items = std::move(items);
+    widget.selected = widget.items.empty() ? 0 : std::clamp(selected, 0, static_cast<int>(widget.items.size()) - 1);
+    widget.action = action;
+    widget.context = context;
+
+    return add(std::move(widget));
+}
+
+
+void Ui_menu::set_text(int widget, std::uint32_t text_id)
+{
+    if (widget < 0 || widget >= get_widget_count() || widgets[widget].text_id == text_id) return;
+
+    widgets[widget].text_id = text_id;
+    invalidate(widget);
+}
+
+
+void Ui_menu::set_selected(int widget, int item)
+{
+    if (widget < 0 || widget >= get_widget_count()) return;
+
+    Widget& w = widgets[widget];
+
+    if (w.items.empty() || item < 0 || item >= static_cast<int>(w.items.size()) || w.selected == item) return;
+
+    w.selected = item;
+    invalidate(widget);
+}
+
+
+int Ui_menu::get_selected(int widget) const
+{
+    return widget >= 0 && widget < get_widget_count() ? widgets[widget].selected : 0;
+}
+
+
+void Ui_menu::set_focus(int widget)
+{
+    if (widget >= get_widget_count() || widget == focus) return;
+
+    if (widget >= 0 && widgets[widget].kind == Widget_kind::LABEL) return;
+
+    const int previous = focus;
+    focus = widget < 0 ? -1 : widget;
+
+    // Only the two widgets change
+    if (previous >= 0)
+    {
+        invalidate(previous);
+        notify(previous, Widget_event::BLUR, widgets[previous].selected);
+    }
+
+    if (focus >= 0)
+    {
+        invalidate(focus);
+        notify(focus, Widget_event::FOCUS, widgets[focus].selected);
+    }
+}
+
+
+int Ui_menu::find_focusable(int from, int step) const
+{
+    const int count = get_widget_count();
+
+    for (int i = 1; i <= count; ++i)
+    {
+        // Wraps around - the last item goes to the first one
+        const int index = ((from + step * i) % count + count) % count;
+
+        if (widgets[index].kind != Widget_kind::LABEL) return index;
+    }
+
+    return -1;
+}
+
+
+void Ui_menu::notify(int widget, Widget_event event, int value)
+{
+    const Widget& w = widgets[widget];
+
+    if (w.action) w.action(w.context, widget, event, value);
+}
+
+
+bool Ui_menu::update(const Input_snapshot& input)
+{
+    if (widgets.empty()) return false;
+
+    bool changed = false;
+
+    if (input.is_pressed(DOWN_BTN) || input.is_pressed(UP_BTN))
+    {
+        const int next = find_focusable(focus < 0 ? -1 : focus, input.is_pressed(DOWN_BTN) ? 1 : -1);
+
+        if (next != focus)
+        {
+            set_focus(next);
+            changed = true;
+        }
+    }
+
+    if (focus < 0) return changed;
+
+    // The actions below can change the menu - the widget is taken by the index every time
+    if (widgets[focus].kind == Widget_kind::LIST && !widgets[focus].items.empty() &&
+        (input.is_pressed(LEFT_BTN) || input.is_pressed(RIGHT_BTN)))
+    {
+        const int count = static_cast<int>(widgets[focus].items.size());
+        const int item = (widgets[focus].selected + (input.is_pressed(RIGHT_BTN) ? 1 : count - 1)) % count;
+
+        if (item != widgets[focus].selected)
+        {
+            const int widget = focus;
+
+            set_selected(widget, item);
+            notify(widget, Widget_event::CHANGE, item);
+            changed = true;
+        }
+    }
+
+    if (focus >= 0 && input.is_pressed(A_BTN))
+    {
+        notify(focus, Widget_event::ACTIVATE, widgets[focus].selected);
+        changed = true;
+    }
+
+    return changed;
+}
+
+
+void Ui_menu::invalidate(int widget)
+{
+    widgets[widget].dirty = true;
+
+    Frame::Instance().mark_dirty();
+}
+
+
+void Ui_menu::invalidate_all()
+{
+    for (Widget& widget : widgets) widget.dirty = true;
+
+    Frame::Instance().mark_dirty();
+}
+
+
+void Ui_menu::render(SDL_Renderer* r)
+{
+    if (!r) return;
+
+    const bool targets = SDL_RenderTargetSupported(r) == SDL_TRUE;
+
+    for (int i = 0; i < get_widget_count(); ++i)
+    {
+        Widget& widget = widgets[i];
+
+        if (targets && (!widget.dirty || rebuild(r, i)))
+        {
+            Render::copy(r, widget.texture, nullptr, &widget.rect);
+            continue;
+        }
+
+        draw(r, widget, i == focus, widget.rect.x, widget.rect.y);
+    }
+}
+
+
+bool Ui_menu::rebuild(SDL_Renderer* r, int index)
+{
+    Widget& widget = widgets[index];
+
+    if (widget.rect.w <= 0 || widget.rect.h <= 0) return false;
+
+    // (Re)create the texture only if the widget size changed
+    if (widget.texture)
+    {
+        int tw = 0, th = 0;
+        SDL_QueryTexture(widget.texture, nullptr, nullptr, &tw, &th);
+
+        if (tw != widget.rect.w || th != widget.rect.h)
+        {
+            Render_target_pool::Instance().release(widget.texture);
+            widget.texture = nullptr;
+        }
+    }
+
+    if (!widget.texture)
+    {
+        widget.texture = Render_target_pool::Instance().acquire(r, widget.rect.w, widget.rect.h, SDL_PIXELFORMAT_ARGB8888);
+
+        if (!widget.texture)
+        {
+            SDL_Log("Menu widget texture creation failed: %s", SDL_GetError());
+            return false;
+        }
+
+        SDL_SetTextureBlendMode(widget.texture, SDL_BLENDMODE_BLEND);
+    }
+
+    SDL_Texture* prev_target = SDL_GetRenderTarget(r);
+
+    Render::set_target(r, widget.texture);
+    SDL_SetRenderDrawColor(r, 0, 0, 0, 0);
+    Render::clear(r);
+
+    draw(r, widget, index == focus, 0, 0);
+
+    Render::set_target(r, prev_target);
+
+    widget.dirty = false;
+    ++rebuild_count;
+
+    return true;
+}
+
+
+void Ui_menu::draw(SDL_Renderer* r, const Widget& widget, bool focused, int x, int y)
+{
+    const SDL_Color background = focused ? style.focus_background : style.background;
+    const SDL_Color color = focused ? style.focus_text : style.text;
+
+    if (background.a > 0)
+    {
+        const SDL_Rect box = {x, y, widget.rect.w, widget.rect.h};
+
+        SDL_SetRenderDrawBlendMode(r, background.a < 255 ? SDL_BLENDMODE_BLEND : SDL_BLENDMODE_NONE);
+        SDL_SetRenderDrawColor(r, background.r, background.g, background.b, background.a);
+        Render::fill_rect(r, &box);
+    }
+
+    if (!font || font->get_line_height() <= 0) return;
+
+    // The text is queued - only this widget's commands, over its background
+    Render_queue& queue = Render_queue::Instance();
+    const int mark = queue.get_command_count();
+
+    const int w = widget.rect.w;
+    const int h = widget.rect.h;
+
+    if (widget.kind == Widget_kind::LIST)
+    {
+        const float scale = style.text_size > 0 ? static_cast<float>(style.text_size) / static_cast<float>(font->get_line_height()) : 1.0f;
+
+        font->layout("<", scale, 0.0f, item_run);
+        draw_text(item_run, x, y, w, h, -1, color);
+
+        font->layout(">", scale, 0.0f, item_run);
+        draw_text(item_run, x, y, w, h, 1, color);
+
+        if (!widget.items.empty())
+        {
+            font->layout(widget.items[widget.selected], scale, 0.0f, item_run);
+            draw_text(item_run, x, y, w, h, 0, color);
+        }
+    }
+    else
+    {
+        const Text_run& run = Text_cache::Instance().get(widget.text_id, font, style.text_size);
+
+        draw_text(run, x, y, w, h, widget.kind == Widget_kind::LABEL ? -1 : 0, color);
+    }
+
+    queue.submit_since(r, mark);
+}
+
+
+void Ui_menu::draw_text(const Text_run& run, int x, int y, int w, int h, int align, SDL_Color color) const
+{
+    float tx = static_cast<float>(x + style.padding);
+
+    if (align == 0) tx = static_cast<float>(x) + (static_cast<float>(w) - run.width) * 0.5f;
+    else if (align > 0) tx = static_cast<float>(x + w - style.padding) - run.width;
+
+    const float ty = static_cast<float>(y) + (static_cast<float>(h) - run.height) * 0.5f;
+
+    // Whole pixels - the baked glyphs stay sharp
+    font->draw(run, static_cast<float>(static_cast<int>(tx)), static_cast<float>(static_cast<int>(ty)), color);
+}
+
+
+void Ui_menu::release()
+{
+    for (Widget& widget : widgets)
+    {
+        Render_target_pool::Instance().release(widget.texture);
+
+        widget.texture = nullptr;
+        widget.dirty = true;
+    }
+}
+
+
+void Ui_menu::invalidate_all_menus()
+{
+    for (Ui_menu* menu : registry()) menu->invalidate_all();
+}
+
+
+void Ui_menu::release_all_menus()
+{
+    for (Ui_menu* menu : registry()) menu->release();
+}
+
+// =========================================================================================== UI MENU
@@ -0,0 +1,230 @@
+// ui_menu.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../platform/platform.h"
+#include "../asset/font_asset.h"
+
+struct Input_snapshot;
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== UI MENU
+
+
+// Kinds of the menu widgets
+enum class Widget_kind : std::uint8_t
+{
+    LABEL,      // Text, never focused
+    BUTTON,     // Text, A activates it
+    LIST        // One item of several, LEFT / RIGHT change it, A activates it
+};
+
+
+// What happened to a widget - the argument of its action
+enum class Widget_event : std::uint8_t
+{
+    FOCUS,      // The focus came to the widget
+    BLUR,       // The focus left the widget
+    CHANGE,     // The list item changed, value - the new item
+    ACTIVATE    // A on the button or the list, value - the list item
+};
+
+
+// Colors and the text size of the widgets
+struct Widget_style
+{
+    SDL_Color text = {255, 255, 255, 255};
+    SDL_Color background = {0, 0, 0, 0};
+    SDL_Color focus_text = {0, 0, 0, 255};
+    SDL_Color focus_background = {255, 255, 255, 255};
+
+    // Line height of the text in px, 0 - the baked one of the font
+    int text_size = 0;
+
+    // Left and right inner margin of the text in px
+    int padding = 8;
+};
+
+
+/**
+ * @brief Retained menu of widgets: labels, buttons and lists with the Button focus navigation.
+ *
+ * The widgets are created once (the state init) and live with the menu. Each of them is
+ * rendered into its own target texture, only on a change of its focus, text or item -
+ * every other frame the whole menu is a few texture copies. A change marks the frame
+ * dirty, so the menu states track their damage and the idle loop sleeps between the
+ * presses.
+ *
+ * The texts of the labels and the buttons are String_id of the Lang_state (drawn with
+ * the Text_cache), a language change redraws the widgets. The list items are the UTF-8
+ * texts themselves (the language names).
+ *
+ * UP / DOWN move the focus between the buttons and the lists, LEFT / RIGHT change the
+ * focused list, A activates. The events come to the action of the widget.
+ *
+ * Without the render target support the widgets are drawn live. The engine invalidates
+ * all menus when the render targets are reset and releases their textures on the shutdown.
+ *
+ * Usage:
+ * @code
+ * Ui_menu menu;
+ *
+ * menu.set_font(font);
+ * menu.add_label({40, 40, 560, 48}, STR_MENU_TITLE);
+ * menu.add_button({40, 120, 560, 40}, STR_MENU_START, on_start, nullptr);
+ *
+ * // update:  menu.update(Input::Instance().get_snapshot());
+ * // render:  menu.render(r);
+ * @endcode
+ */
+class Ui_menu
+{
+
+public:
+
+    using Action_fn = void (*)(void* context, int widget, Widget_event event, int value);
+
+
+    Ui_menu();
+
+    // Releases the widget textures
+    ~Ui_menu();
+
+    // Textures and the registration are not copyable
+    Ui_menu(const Ui_menu&) = delete;
+    Ui_menu& operator=(const Ui_menu&) = delete;
+
+
+    // Font of all the widgets (redraws them), nullptr - the widgets without the text
+    void set_font(const Font_asset* font);
+
+    // Style of all the widgets (redraws them)
+    void set_style(const Widget_style& style);
+
+
+    // === WIDGETS ===
+
+    // Adds a widget, returns its index
+    int add_label(const SDL_Rect& rect, std::uint32_t text_id);
+    int add_button(const SDL_Rect& rect, std::uint32_t text_id, Action_fn action, void* context);
+    int add_list(const SDL_Rect& rect, std::vector<std::string> items, int selected, Action_fn action, void* context);
+
+    // Replaces the text of the label or the button
+    void set_text(int widget, std::uint32_t text_id);
+
+    // Selects the list item, without the CHANGE event
+    void set_selected(int widget, int item);
+    int get_selected(int widget) const;
+
+    // Moves the focus to the widget (FOCUS and BLUR events), -1 - nothing is focused
+    void set_focus(int widget);
+    int get_focus() const { return focus; }
+
+    int get_widget_count() const { return static_cast<int>(widgets.size()); }
+
+    // === WIDGETS ===
+
+
+    /**
+     * @brief Focus navigation and the activation by the input of the tick.
+     *
+     * The actions are called from here, they can change the menu.
+     *
+     * @return true if any widget changed - it is redrawn by the next render.
+     */
+    bool update(const Input_snapshot& input);
+
+    /**
+     * @brief Draws the menu: rebuilds the changed widgets, copies the cached ones.
+     *
+     * @param r Renderer of the frame.
+     */
+    void render(SDL_Renderer* r);
+
+    // Marks all widgets for the redraw (and the frame as dirty)
+    void invalidate_all();
+
+    // Destroys the widget textures (they are rebuilt by the next render)
+    void release();
+
+
+    // Number of the widget rebuilds since the start - stays flat in the idle frames
+    Uint64 get_rebuild_count() const { return rebuild_count; }
+
+
+    // Invalidates every existing menu (render targets reset)
+    static void invalidate_all_menus();
+
+    // Releases the textures of every existing menu (before the renderer is destroyed)
+    static void release_all_menus();
+
+
+private:
+
+    struct Widget
+    {
+        Widget_kind kind = Widget_kind::LABEL;
+        SDL_Rect rect = {0, 0, 0, 0};
+
+        std::uint32_t text_id = 0;
+
+        std::vector<std::string> items;
+        int selected = 0;
+
+        Action_fn action = nullptr;
+        void* context = nullptr;
+
+        bool dirty = true;
+        SDL_Texture* texture = nullptr;
+    };
+
+    // Adds the widget, the first focusable one gets the focus
+    int add(Widget widget);
+
+    // Marks the widget for the redraw (and the frame as dirty)
+    void invalidate(int widget);
+
+    // Calls the action of the widget
+    void notify(int widget, Widget_event event, int value);
+
+    // Next focusable widget in the direction, -1 if there is none
+    int find_focusable(int from, int step) const;
+
+    // Renders the widget into its texture, false if it can't be cached
+    bool rebuild(SDL_Renderer* r, int index);
+
+    // Draws the widget with its top left at x, y into the current target
+    void draw(SDL_Renderer* r, const Widget& widget, bool focused, int x, int y);
+
+    // Records the text centered vertically, at the x by the alignment (-1 left, 0 center, 1 right)
+    void draw_text(const Text_run& run, int x, int y, int w, int h, int align, SDL_Color color) const;
+
+    // Lang_state change hook - the texts are new
+    static void on_lang_change(void* menu);
+
+
+    std::vector<Widget> widgets;
+    int focus = -1;
+
+    const Font_asset* font = nullptr;
+    Widget_style style;
+
+    // Layout of the list items - the capacity is kept
+    Text_run item_run;
+
+    Uint64 rebuild_count = 0;
+
+
+    // All existing menus - for the engine-wide reset and release
+    static std::vector<Ui_menu*>& registry();
+};
+
+// =========================================================================================== UI MENU
@@ -0,0 +1,330 @@
+// zone_profiler.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "zone_profiler.h"
+
+#ifdef ZONE_PROFILING
+
+#include "../engine_clock/engine_clock.h"
+#include "../alloc_tracker/alloc_tracker.h"
+#include "../platform/backend.h"
+
+#include <algorithm>
+#include <cstdio>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== ZONE PROFILER
+
+// Stutter traces of a session at most, and the time between two - one trace covers the ring
+static constexpr int MAX_STUTTER_EXPORTS = 8;
+static constexpr double STUTTER_COOLDOWN = 2.0;
+
+// Distinct zone names summed by top_zones()
+static constexpr int MAX_WINDOW_ZONES = 32;
+
+
+Zone_profiler& Zone_profiler::Instance()
+{
+    static Zone_profiler instance;
+    return instance;
+}
+
+
+void Zone_profiler::Ring::write(const char* zone, char phase, std::int64_t value)
+{
+    const std::uint32_t w = write_index.load(std::memory_order_relaxed);
+
+    Event& e = events[w & (RING_EVENTS - 1)];
+
+    e.name = zone;
+    e.ticks = Engine_clock::now();
+    e.phase = phase;
+    e.value = value;
+
+#ifdef ALLOC_TRACKING
+    e.allocs = Alloc_tracker::get_thread_allocs();
+#endif
+
+    write_index.store(w + 1, std::memory_order_release);
+}
+
+
+Zone_profiler::Ring& Zone_profiler::get_ring()
+{
+    static thread_local Ring* ring = nullptr;
+
+    if (!ring)
+    {
+        std::unique_ptr<Ring> created(new Ring());
+        created->thread = SDL_ThreadID();
+
+        ring = created.get();
+
+        std::lock_guard<std::mutex> guard(rings_lock);
+        rings.push_back(std::move(created));
+    }
+
+    return *ring;
+}
+
+
+void Zone_profiler::begin(const char* name) { get_ring().write(name, 'B'); }
+
+
+void Zone_profiler::end(const char* name) { get_ring().write(name, 'E'); }
+
+
+void Zone_profiler::counter(const char* name, std::int64_t value) { get_ring().write(name, 'C', value); }
+
+
+void Zone_profiler::set_thread_name(const char* name) { get_ring().name.store(name, std::memory_order_relaxed); }
+
+
+// Zone names are literals of the code - only the quotes and the backslashes are escaped
+static void append_json_string(std::string& out, const char* text)
+{
+    out += '"';
+
+    for (const char* c = text ? text : ""; *c; ++c)
+    {
+        if (*c == '"' || *c == '\\') out += '\\';
+        out += *c;
+    }
+
+    out += '"';
+}
+
+
+bool Zone_profiler::export_trace(const char* path)
+{
+    struct Copy
+    {
+        const Ring* ring;
+        std::vector<Event> events;
+    };
+
+    std::vector<Copy> copies;
+
+    {
+        std::lock_guard<std::mutex> guard(rings_lock);
+
+        copies.reserve(rings.size());
+
+        for (const std::unique_ptr<Ring>& ring : rings)
+        {
+            Copy copy{ring.get(), {}};
+
+            const std::uint32_t last = ring->write_index.load(std::memory_order_acquire);
+            const std::uint32_t first = last > RING_EVENTS ? last - RING_EVENTS : 0;
+
+            copy.events.reserve(last - first);
+
+            for (std::uint32_t i = first; i < last; ++i) copy.events.push_back(ring->events[i & (RING_EVENTS - 1)]);
+
+            // The slots the thread has written meanwhile (and the one it writes now) are not valid
+            const std::uint32_t written = ring->write_index.load(std::memory_order_acquire);
+            const std::uint32_t valid = written + 1 > RING_EVENTS ? written + 1 - RING_EVENTS : 0;
+
+            if (valid > first)
+            {
+                copy.events.erase(copy.events.begin(), copy.events.begin() + std::min<std::uint32_t>(valid - first, last - first));
+            }
+
+            copies.push_back(std::move(copy));
+        }
+    }
+
+    // Time from the oldest event - the trace starts at 0
+    Uint64 origin = ~Uint64(0);
+
+    for (const Copy& copy : copies)
+        if (!copy.events.empty()) origin = std::min(origin, copy.events.front().ticks);
+
+    const double us_per_tick = 1000000.0 / static_cast<double>(Engine_clock::frequency());
+
+    std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first_event = true;
+
+    char number[160];
+
+    for (const Copy& copy : copies)
+    {
+        const unsigned long tid = static_cast<unsigned long>(copy.ring->thread);
+
+        if (const char* name = copy.ring->name.load(std::memory_order_relaxed))
+        {
+            std::snprintf(number, sizeof(number), "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%lu,\"args\":{\"name\":",
+                          first_event ? "" : ",\n", tid);
+            json += number;
+            append_json_string(json, name);
+            json += "}}";
+            first_event = false;
+        }
+
+        // The ring starts anywhere - the ends of the overwritten begins are dropped
+        std::vector<const Event*> open;
+
+        for (const Event& e : copy.events)
+        {
+            const Event* begin = nullptr;
+
+            if (e.phase == 'C')
+            {
+                json += first_event ? "{\"name\":" : ",\n{\"name\":";
+                append_json_string(json, e.name);
+
+                std::snprintf(number, sizeof(number), ",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%lu,\"args\":{\"value\":%lld}}",
+                              static_cast<double>(e.ticks - origin) * us_per_tick, tid, static_cast<long long>(e.value));
+                json += number;
+                first_event = false;
+                continue;
+            }
+
+            if (e.phase == 'E')
+            {
+                if (open.empty()) continue;
+
+                begin = open.back();
+                open.pop_back();
+            }
+            else open.push_back(&e);
+
+            json += first_event ? "{\"name\":" : ",\n{\"name\":";
+            append_json_string(json, e.name);
+
+            std::snprintf(number, sizeof(number), ",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%lu",
+                          e.phase, static_cast<double>(e.ticks - origin) * us_per_tick, tid);
+            json += number;
+
+#ifdef ALLOC_TRACKING
+            if (begin)
+            {
+                std::snprintf(number, sizeof(number), ",\"args\":{\"allocs\":%llu}", static_cast<unsigned long long>(e.allocs - begin->allocs));
+                json += number;
+            }
+#else
+            (void)begin;
+#endif
+
+            json += '}';
+            first_event = false;
+        }
+    }
+
+    json += "\n]}\n";
+
+    if (!Platform::Files::write_file(path, json.data(), json.size()))
+    {
+        SDL_Log("Zone trace %s can't be written", path);
+        return false;
+    }
+
+    ++export_count;
+    SDL_Log("Zone trace: %s", path);
+
+    return true;
+}
+
+
+void Zone_profiler::set_stutter_export(double threshold_ms, const char* prefix)
+{
+    stutter_ms = threshold_ms;
+    stutter_prefix = prefix ? prefix : "zone_trace";
+}
+
+
+void Zone_profiler::end_frame(double frame_ms)
+{
+    if (stutter_ms <= 0.0 || frame_ms < stutter_ms || stutter_exports >= MAX_STUTTER_EXPORTS) return;
+
+    const Uint64 now = Engine_clock::now();
+
+    if (last_stutter_export != 0 && Engine_clock::to_seconds(now - last_stutter_export) < STUTTER_COOLDOWN) return;
+
+    last_stutter_export = now;
+    ++stutter_exports;
+
+    const std::string path = stutter_prefix + "_" + std::to_string(stutter_exports) + ".json";
+
+    SDL_Log("Stutter: %.1f ms frame", frame_ms);
+
+    export_trace(path.c_str());
+}
+
+
+int Zone_profiler::top_zones(Uint64 from, Uint64 to, Zone_total* out, int max)
+{
+    // The own ring - no other writer, no copy
+    const Ring& ring = get_ring();
+
+    const std::uint32_t last = ring.write_index.load(std::memory_order_relaxed);
+    const std::uint32_t oldest = last > RING_EVENTS ? last - RING_EVENTS : 0;
+
+    // The events are in the time order - back to the window start
+    std::uint32_t first = last;
+
+    while (first > oldest && ring.events[(first - 1) & (RING_EVENTS - 1)].ticks >= from) --first;
+
+    Zone_total totals[MAX_WINDOW_ZONES];
+    int count = 0;
+
+    const Event* open[MAX_WINDOW_ZONES];
+    int depth = 0;
+
+    const double ms_per_tick = 1000.0 / static_cast<double>(Engine_clock::frequency());
+
+    for (std::uint32_t i = first; i < last; ++i)
+    {
+        const Event& e = ring.events[i & (RING_EVENTS - 1)];
+
+        if (e.ticks > to) break;
+
+        if (e.phase == 'C') continue;
+
+        if (e.phase == 'B')
+        {
+            if (depth < MAX_WINDOW_ZONES) open[depth] = &e;
+            ++depth;
+            continue;
+        }
+
+        // The end of a zone, which began before the window
+        if (depth == 0) continue;
+
+        --depth;
+
+        if (depth >= MAX_WINDOW_ZONES) continue;
+
+        const double ms = static_cast<double>(e.ticks - open[depth]->ticks) * ms_per_tick;
+
+        // The names are literals - the same zone is the same pointer
+        int t = 0;
+
+        while (t < count && totals[t].name != e.name) ++t;
+
+        if (t == count)
+        {
+            if (count == MAX_WINDOW_ZONES) continue;
+
+            totals[count++] = {e.name, 0.0};
+        }
+
+        totals[t].ms += ms;
+    }
+
+    std::sort(totals, totals + count, [](const Zone_total& a, const Zone_total& b) { return a.ms > b.ms; });
+
+    const int written = std::min(count, max);
+
+    std::copy(totals, totals + written, out);
+
+    return written;
+}
+
+// =========================================================================================== ZONE PROFILER
+
+#endif
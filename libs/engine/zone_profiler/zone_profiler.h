@@ -0,0 +1,224 @@
+// zone_profiler.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../platform/platform.h"
+#include "../sampling_profiler/sampling_profiler.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== ZONE PROFILER
+
+// Optional instrumentation of the nested frame timing, enabled by the ZONE_PROFILING
+// define (CMake option MIYOO_ZONE_PROFILING). Without it the macros are empty and
+// nothing below is compiled. The zones and the thread names are the stacks of the
+// sampling profiler (MIYOO_SAMPLING_PROFILER) too - either one can be built alone.
+
+#ifdef ZONE_PROFILING
+
+#define ZONE_PROFILER_CONCAT_INNER(a, b) a##b
+#define ZONE_PROFILER_CONCAT(a, b) ZONE_PROFILER_CONCAT_INNER(a, b)
+
+// Times the rest of the scope - the name must be a string literal (the pointer is stored)
+#define PROFILE_ZONE(name) Zone_scope ZONE_PROFILER_CONCAT(zone_scope_, __LINE__)(name); SAMPLE_ZONE(name)
+
+// Names the calling thread in the trace - a string literal too
+#define PROFILE_THREAD(name) (Zone_profiler::Instance().set_thread_name(name), SAMPLE_THREAD(name))
+
+
+/**
+ * @brief Nested zones of every thread on one timeline, exported as a Chrome trace.
+ *
+ * A zone is a begin and an end event in the ring of its thread: the writer is only
+ * its thread, so the write is two stores and no lock (the ring of a thread is created
+ * on its first zone - the one lock). The rings are flight recorders - the newest
+ * RING_EVENTS events of every thread are kept, the oldest are overwritten.
+ *
+ * export_trace() writes the rings as Chrome trace JSON (chrome://tracing, Perfetto UI):
+ * on demand, or by end_frame() after a frame slower than the stutter threshold - the
+ * trace then shows the frames just before and the stutter itself. The export reads
+ * the rings while they are written: the events overwritten during the copy are dropped.
+ *
+ * With MIYOO_ALLOC_TRACKING every zone carries its heap allocations ("allocs" in the
+ * arguments of its end event).
+ *
+ * counter() records a value over the time (a counter track of the trace) - the render
+ * statistics of every frame.
+ *
+ * The engine zones: events, update, render, present, asset loading (the decode of the
+ * loader workers and the main thread pump) and the audio callback.
+ *
+ * Usage:
+ * @code
+ * void Level::rebuild()
+ * {
+ *     PROFILE_ZONE("level_rebuild");
+ *     ...
+ * }
+ *
+ * Zone_profiler::Instance().export_trace("trace.json");
+ * @endcode
+ */
+class Zone_profiler
+{
+
+public:
+
+    // Events kept per thread (a zone is two)
+    static constexpr std::uint32_t RING_EVENTS = 8192;
+
+    // Returns the singleton instance.
+    static Zone_profiler& Instance();
+
+
+    // Zone start and end of the calling thread (the Zone_scope)
+    void begin(const char* name);
+    void end(const char* name);
+
+    // Thread name in the trace, the thread id without it
+    void set_thread_name(const char* name);
+
+    // Value of a counter track in the trace, from now on - the name is a string literal
+    void counter(const char* name, std::int64_t value);
+
+
+    /**
+     * @brief Writes the recorded zones of every thread as a Chrome trace.
+     *
+     * @param path Output JSON file.
+     * @return false if the file can't be written.
+     */
+    bool export_trace(const char* path);
+
+    /**
+     * @brief Exports the trace after the stutters.
+     *
+     * @param threshold_ms Frame time of a stutter, 0 - off.
+     * @param prefix       Output files - <prefix>_<number>.json.
+     */
+    void set_stutter_export(double threshold_ms, const char* prefix);
+
+    // Measured frame time (main thread, every cycle) - exports the trace after a stutter
+    void end_frame(double frame_ms);
+
+    // Traces written, on demand and by the stutters
+    int get_export_count() const { return export_count; }
+
+
+    // Time of one zone name in a window
+    struct Zone_total
+    {
+        const char* name;
+        double ms;
+    };
+
+    /**
+     * @brief Heaviest zones of the calling thread in a time window (the stutter reports).
+     *
+     * The zones, which began and ended inside the window, summed per name - inclusive,
+     * a nested zone counts in its parent too.
+     *
+     * @param from Engine_clock counter of the window start.
+     * @param to   Engine_clock counter of the window end.
+     * @param out  Zones by the time, the longest first.
+     * @param max  Capacity of out.
+     * @return Zones written.
+     */
+    int top_zones(Uint64 from, Uint64 to, Zone_total* out, int max);
+
+
+private:
+
+    Zone_profiler() = default;
+
+    // Singleton - not copyable
+    Zone_profiler(const Zone_profiler&) = delete;
+    Zone_profiler& operator=(const Zone_profiler&) = delete;
+
+
+    struct Event
+    {
+        const char* name;
+        Uint64 ticks;
+
+        // 'B', 'E' or 'C' (counter)
+        char phase;
+
+        // Value of a counter
+        std::int64_t value;
+
+#ifdef ALLOC_TRACKING
+        // Allocations of the thread so far - the difference of the end and the begin is the zone's
+        std::uint64_t allocs;
+#endif
+    };
+
+    // Ring of one thread - written only by it, copied by the export
+    struct Ring
+    {
+        Event events[RING_EVENTS];
+
+        std::atomic<std::uint32_t> write_index{0};
+
+        SDL_threadID thread = 0;
+        std::atomic<const char*> name{nullptr};
+
+        void write(const char* zone, char phase, std::int64_t value = 0);
+    };
+
+    static_assert((RING_EVENTS & (RING_EVENTS - 1)) == 0, "Zone_profiler ring must be a power of two");
+
+
+    // Ring of the calling thread, created on its first zone
+    Ring& get_ring();
+
+
+    // Every ring ever created - the rings of the finished threads stay in the trace
+    std::mutex rings_lock;
+    std::vector<std::unique_ptr<Ring>> rings;
+
+    double stutter_ms = 0.0;
+    std::string stutter_prefix;
+    Uint64 last_stutter_export = 0;
+    int stutter_exports = 0;
+
+    int export_count = 0;
+};
+
+
+// Begin on the construction, end on the destruction
+class Zone_scope
+{
+
+public:
+
+    explicit Zone_scope(const char* zone) : name(zone) { Zone_profiler::Instance().begin(name); }
+    ~Zone_scope() { Zone_profiler::Instance().end(name); }
+
+    Zone_scope(const Zone_scope&) = delete;
+    Zone_scope& operator=(const Zone_scope&) = delete;
+
+
+private:
+
+    const char* name;
+};
+
+#else
+
+#define PROFILE_ZONE(name) SAMPLE_ZONE(name)
+#define PROFILE_THREAD(name) SAMPLE_THREAD(name)
+
+#endif
+
+// =========================================================================================== ZONE PROFILER
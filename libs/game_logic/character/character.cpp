@@ -0,0 +1,170 @@
+// character.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "character.h"
+
+#include <algorithm>
+#include <cmath>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== CHARACTER
+
+// 1 / sqrt(2) - the diagonal acceleration per axis, so a diagonal isn't faster
+static constexpr Fixed DIAGONAL = fx::from_double(0.70710678118654752);
+
+
+void Character::reset(Fixed new_x, Fixed new_y, Fixed new_width, Fixed new_height)
+{
+    position = previous_position = {new_x, new_y};
+
+    width = new_width;
+    height = new_height;
+
+    velocity = {0, 0};
+
+    edges = previous_edges = EDGE_NONE;
+}
+
+
+void Character::set_params(const Character_params& new_params) { params = new_params; }
+
+
+void Character::set_bounds(Fixed left, Fixed top, Fixed right, Fixed bottom)
+{
+    bound_left = left;
+    bound_top = top;
+    bound_right = right;
+    bound_bottom = bottom;
+}
+
+
+// D-pad of the snapshot as the direction -1, 0, 1 per axis
+static int direction_x(const Input_snapshot& input) { return static_cast<int>(input.is_held(RIGHT_BTN)) - static_cast<int>(input.is_held(LEFT_BTN)); }
+static int direction_y(const Input_snapshot& input) { return static_cast<int>(input.is_held(DOWN_BTN)) - static_cast<int>(input.is_held(UP_BTN)); }
+
+
+std::uint8_t Character::step(const Input_snapshot& input, int ticks)
+{
+    return step(direction_x(input), direction_y(input), ticks);
+}
+
+
+std::uint8_t Character::step(int dir_x, int dir_y, int ticks)
+{
+    previous_position = position;
+    previous_edges = edges;
+
+    // The velocity of every physics tick, one move of their sum - the bounds take it at once
+    Vec2_fx move = {0, 0};
+
+    for (int i = 0; i < std::max(ticks, 1); ++i)
+    {
+        velocity = next_velocity(velocity, dir_x, dir_y);
+        move += velocity;
+    }
+
+    position += move;
+
+    edges = collide(position.x, velocity.x, width, bound_left, bound_right, EDGE_LEFT, EDGE_RIGHT)
+          | collide(position.y, velocity.y, height, bound_top, bound_bottom, EDGE_TOP, EDGE_BOTTOM);
+
+    return edges;
+}
+
+
+int Character::get_step_ticks(double tick_dt)
+{
+    return std::max(1, static_cast<int>(std::lround(tick_dt * CHARACTER_TICK_HZ)));
+}
+
+
+Vec2 Character::get_predicted_position(const Input_snapshot& input, float alpha, int ticks) const
+{
+    Vec2_fx next = position;
+    Vec2_fx speed = velocity;
+
+    for (int i = 0; i < std::max(ticks, 1); ++i)
+    {
+        speed = next_velocity(speed, direction_x(input), direction_y(input));
+        next += speed;
+    }
+
+    // The bounds without the bounce - the real step decides the hit
+    next.x = fx::clamp(next.x, bound_left, bound_right - width);
+    next.y = fx::clamp(next.y, bound_top, bound_bottom - height);
+
+    return Vec2_fx::lerp(position, next, alpha);
+}
+
+
+Vec2_fx Character::next_velocity(Vec2_fx current, int dir_x, int dir_y) const
+{
+    const Fixed acceleration = dir_x != 0 && dir_y != 0 ? fx::mul(params.acceleration, DIAGONAL) : params.acceleration;
+
+    return {accelerate(current.x, dir_x, acceleration), accelerate(current.y, dir_y, acceleration)};
+}
+
+
+Fixed Character::accelerate(Fixed speed, int dir, Fixed acceleration) const
+{
+    if (dir > 0) speed += acceleration;
+    else if (dir < 0) speed -= acceleration;
+
+    // Friction only stops the axis, it never turns it back
+    else if (speed > 0) speed = speed > params.friction ? speed - params.friction : 0;
+    else if (speed < 0) speed = -speed > params.friction ? speed + params.friction : 0;
+
+    return fx::clamp(speed, -params.max_speed, params.max_speed);
+}
+
+
+std::uint8_t Character::collide(Fixed& position, Fixed& speed, Fixed size, Fixed low, Fixed high,
+                                std::uint8_t low_edge, std::uint8_t high_edge) const
+{
+    const Fixed limit = high - size;
+
+    // The part of the move past the edge comes back by the bounce - a long step doesn't lose it
+    if (position <= low)
+    {
+        position = std::min(low + fx::mul(low - position, params.bounce), limit);
+        if (speed < 0) speed = -fx::mul(speed, params.bounce);
+        return low_edge;
+    }
+
+    if (position >= limit)
+    {
+        position = std::max(limit - fx::mul(position - limit, params.bounce), low);
+        if (speed > 0) speed = -fx::mul(speed, params.bounce);
+        return high_edge;
+    }
+
+    return EDGE_NONE;
+}
+
+
+std::uint32_t Character::get_hash() const
+{
+    // FNV-1a over the simulation state - the render-only values are not included
+    const Fixed values[] = { position.x, position.y, velocity.x, velocity.y };
+
+    std::uint32_t hash = 2166136261u;
+
+    for (Fixed value : values)
+    {
+        const std::uint32_t bits = static_cast<std::uint32_t>(value);
+
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            hash ^= (bits >> shift) & 0xFFu;
+            hash *= 16777619u;
+        }
+    }
+
+    return hash;
+}
+
+// =========================================================================================== CHARACTER
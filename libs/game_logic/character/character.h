@@ -0,0 +1,193 @@
+// character.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+
+#include "../../engine/input/input.h"
+#include "../../engine/math/math_2d.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== CHARACTER
+
+
+// Edges of the bounds touched by the last step (bit mask)
+enum Character_edge : std::uint8_t
+{
+    EDGE_NONE   = 0,
+    EDGE_LEFT   = 1 << 0,
+    EDGE_RIGHT  = 1 << 1,
+    EDGE_TOP    = 1 << 2,
+    EDGE_BOTTOM = 1 << 3,
+};
+
+
+// Rate of the physics ticks - a slower simulation tick steps several of them at once
+constexpr int CHARACTER_TICK_HZ = 60;
+
+
+/**
+ * @brief Movement of a character, all of the values are per physics tick (CHARACTER_TICK_HZ).
+ *
+ * The defaults are the square: 300 px/s at most, the full speed in a quarter
+ * of a second, a stop in a third of a second.
+ */
+struct Character_params
+{
+    // Speed gained per tick while a direction is held
+    Fixed acceleration = fx::per_tick(1200.0, CHARACTER_TICK_HZ, 2);
+
+    // Speed lost per tick on an axis without a direction (never past zero)
+    Fixed friction = fx::per_tick(900.0, CHARACTER_TICK_HZ, 2);
+
+    // Speed limit of each axis
+    Fixed max_speed = fx::per_tick(300.0, CHARACTER_TICK_HZ);
+
+    // Speed kept after an edge hit, 0 - stop at the edge, ONE - full bounce
+    Fixed bounce = 0;
+};
+
+
+/**
+ * @brief Physics of the square: the accelerated movement by the D-pad inside the bounds.
+ *
+ * step() is called once per fixed tick from the state_update with the tick's input
+ * snapshot - never with the frame time, so the movement doesn't depend on the render
+ * rate and a replayed recording gives the same positions bit for bit (get_hash()).
+ *
+ * A simulation tick longer than the physics tick (a lowered sim_hz) is one step of
+ * several physics ticks (get_step_ticks()): the velocity still changes per physics tick,
+ * so the path is the same, and the whole move is swept against the bounds at once - the
+ * part past an edge comes back by the bounce instead of being lost. The move of the step
+ * is get_position() - get_previous_position() for the swept obstacle tests (Spatial_hash::query_swept()).
+ *
+ * The previous tick position is kept for the render interpolation (get_render_x/y()
+ * with Engine_clock::time.alpha).
+ *
+ * Usage:
+ * @code
+ * Character square;
+ * square.set_bounds(0, 0, fx::from_int(640), fx::from_int(480));
+ * square.reset(fx::from_int(300), fx::from_int(220), fx::from_int(40), fx::from_int(40));
+ *
+ * if (square.step(Input::Instance().get_snapshot()) != EDGE_NONE) swap_colors(); // state_update
+ *
+ * draw_rect({square.get_render_x(alpha), square.get_render_y(alpha), 40.0f, 40.0f}, color); // state_render
+ * @endcode
+ */
+class Character
+{
+
+public:
+
+    Character() = default;
+
+
+    // Places the character at the top left corner x, y, the speed is zeroed
+    void reset(Fixed x, Fixed y, Fixed width, Fixed height);
+
+    void set_params(const Character_params& params);
+
+    // Area the character stays inside (left <= x, x + width <= right)
+    void set_bounds(Fixed left, Fixed top, Fixed right, Fixed bottom);
+
+
+    /**
+     * @brief Advances the character by one simulation tick.
+     *
+     * The held D-pad accelerates (a diagonal by 1 / sqrt(2) per axis), an axis without
+     * a direction slows down by the friction, each axis is limited by max_speed.
+     *
+     * @param input Snapshot of the tick.
+     * @param ticks Physics ticks of the step (get_step_ticks()), 1 at CHARACTER_TICK_HZ.
+     * @return Edges hit by this step (Character_edge mask), EDGE_NONE inside the bounds.
+     */
+    std::uint8_t step(const Input_snapshot& input, int ticks = 1);
+
+    // Same step by the direction -1, 0, 1 per axis (AI, tests, demo)
+    std::uint8_t step(int dir_x, int dir_y, int ticks = 1);
+
+    // Physics ticks of a simulation tick of the length (at least 1)
+    static int get_step_ticks(double tick_dt);
+
+
+    // === STATE ===
+
+    Fixed get_x() const { return position.x; }
+    Fixed get_y() const { return position.y; }
+    Fixed get_vx() const { return velocity.x; }
+    Fixed get_vy() const { return velocity.y; }
+
+    Vec2_fx get_position() const { return position; }
+    Vec2_fx get_previous_position() const { return previous_position; }
+    Vec2_fx get_velocity() const { return velocity; }
+    Fixed get_width() const { return width; }
+    Fixed get_height() const { return height; }
+
+    // Speed limit of each axis per physics tick
+    Fixed get_max_speed() const { return params.max_speed; }
+
+    // Edges touched by the last step
+    std::uint8_t get_edges() const { return edges; }
+
+    // Edges, which the last step started to touch (the hit, not the resting contact)
+    std::uint8_t get_new_edges() const { return edges & ~previous_edges; }
+
+    // Position between the previous and the current tick
+    float get_render_x(float alpha) const { return fx::lerp(previous_position.x, position.x, alpha); }
+    float get_render_y(float alpha) const { return fx::lerp(previous_position.y, position.y, alpha); }
+
+    Vec2 get_render_position(float alpha) const { return Vec2_fx::lerp(previous_position, position, alpha); }
+
+    /**
+     * @brief Position alpha of the way to where the next step by the input would move it.
+     *
+     * For the late latched input (Input::get_late_snapshot()): drawn one tick ahead of the
+     * interpolation, so a press or a release after the tick sampled the buttons shows in
+     * this frame. Render only - the next step() moves the character for real.
+     */
+    Vec2 get_predicted_position(const Input_snapshot& input, float alpha, int ticks = 1) const;
+
+    // Hash of the position and the speed - equal on every build after the same ticks
+    std::uint32_t get_hash() const;
+
+    // === STATE ===
+
+
+private:
+
+    // Velocity after the tick by the direction (a diagonal by 1 / sqrt(2) per axis)
+    Vec2_fx next_velocity(Vec2_fx current, int dir_x, int dir_y) const;
+
+    // Speed of one axis after the tick by the direction
+    Fixed accelerate(Fixed speed, int dir, Fixed acceleration) const;
+
+    // Keeps the axis inside [low, high - size] - the part of the move past it bounces back, returns the hit edge bit
+    std::uint8_t collide(Fixed& position, Fixed& speed, Fixed size, Fixed low, Fixed high,
+                         std::uint8_t low_edge, std::uint8_t high_edge) const;
+
+
+    Character_params params;
+
+    Vec2_fx position = {0, 0};
+    Vec2_fx velocity = {0, 0};
+
+    Vec2_fx previous_position = {0, 0};
+
+    Fixed width = 0;
+    Fixed height = 0;
+
+    Fixed bound_left = 0;
+    Fixed bound_top = 0;
+    Fixed bound_right = fx::from_int(640);
+    Fixed bound_bottom = fx::from_int(480);
+
+    std::uint8_t edges = EDGE_NONE;
+    std::uint8_t previous_edges = EDGE_NONE;
+};
+
+// =========================================================================================== CHARACTER
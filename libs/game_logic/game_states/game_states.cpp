@@ -4,11 +4,54 @@
 // =========================================================================================== IMPORT
 
 #include "game_states.h"
-#include <iostream> // for std::cout, std::cerr
+#include "../../engine/preload/preloader.h"
+#include "../../engine/startup_trace/startup_trace.h"
+#include "../../engine/shape_cache/shape_cache.h"
+#include "../../engine/palette/palette.h"
+#include "../../engine/frame/frame.h"
+#include "../../engine/asset/asset_loader.h"
+#include "../../engine/asset/asset_prefetch.h"
+#include "../../engine/input/input.h"
+#include "../../engine/lang_state/lang_state.h"
+#include "../../engine/asset/asset_manager.h"
+#include "../../engine/ui/ui_menu.h"
+#include "../../engine/platform/backend.h"
+#include "../../engine/log/log.h"
+#include "../../engine/save/save_system.h"
+#include "../../engine/pipeline/update_pipeline.h"
+#include "../lang/string_ids.h"
+#include "../game_states_logic/1.1.1_LEVEL_GAMEPLAY/update.h"
+#include "../game_states_logic/1.1.1_LEVEL_GAMEPLAY/renderer.h"
+
+#include <string>
+#include <vector>
 
 // =========================================================================================== IMPORT
 
 
+// =========================================================================================== THEME
+
+// Theme colors in the Game_color order
+static const SDL_Color game_themes[GAME_THEME_COUNT][GAME_COLOR_COUNT] = {
+    { {0, 0, 0, 255},       {255, 255, 255, 255}, {255, 0, 0, 255} },    // Day
+    { {255, 255, 255, 255}, {0, 0, 0, 255},       {0, 120, 255, 255} },  // Night
+};
+
+
+void apply_game_theme(int theme)
+{
+    theme = ((theme % GAME_THEME_COUNT) + GAME_THEME_COUNT) % GAME_THEME_COUNT;
+
+    Palette::Instance().apply_theme(game_themes[theme], GAME_COLOR_COUNT);
+
+    // The clear color is a part of the theme too
+    SDL_Color background = Palette::Instance().get(COLOR_BACKGROUND);
+    Frame::Instance().set_clear_color(background.r, background.g, background.b, background.a);
+}
+
+// =========================================================================================== THEME
+
+
 // =========================================================================================== CALLBACKS
 
 // These are the callbacks executed when entering or exiting a state.
@@ -16,118 +59,473 @@
 // You can replace the body with more complex logic or calls to other modules.
 
 
-void start_enter()         { std::cout << "Entering START\n"; }
-void start_exit()          { std::cout << "Exiting START\n"; }
+// === START SPLASH ===
 
-void start_render(SDL_Renderer* renderer)
+// Files MAIN_MENU and GAME need. START reads them from the SD card in the background,
+// the states take them from the Preloader. Filled as the states get their assets.
+static const std::vector<std::string> main_menu_assets = {};
+static const std::vector<std::string> game_assets = {};
+
+// Language-specific assets (the fonts, the voice-over) in the Lang_list order - only
+// the set of the current language is loaded. Filled as the languages get their assets.
+static const std::vector<Lang_state::Lang_asset> lang_assets[static_cast<unsigned int>(Lang_list::LIMIT)] = {{}, {}};
+
+// Font of the menus - loaded by START with the rest, pinned for the whole run
+static constexpr Asset_path UI_FONT = "fonts/ui.fnt";
+
+static Load_handle ui_font_load;
+static Font_asset* ui_font = nullptr;
+
+// Assets of the main menu - prefetched while its sibling START is up (see Asset_prefetcher)
+static constexpr Manifest_asset main_menu_assets_list[] = {
+    {UI_FONT.path.data(), Asset_type::FONT},
+};
+static constexpr Asset_manifest main_menu_manifest = main_menu_assets_list;
+
+// Splash is shown at least this number of update ticks, even if the preload is instant
+static constexpr int SPLASH_MIN_TICKS = 30;
+
+static int splash_ticks = 0;
+
+
+void start_enter()
 {
+    LOG_DEBUG("Entering START");
+
+    splash_ticks = 0;
+
+    Preloader& preloader = Preloader::Instance();
 
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    SDL_RenderClear(renderer);
+    for (const auto& path : main_menu_assets) preloader.add(path);
+    for (const auto& path : game_assets) preloader.add(path);
 
+    if (!ui_font) ui_font_load = Asset_loader::Instance().load_font(std::string(UI_FONT.path));
+
+    // Only the first start really reads - the already started preload is kept
+    if (preloader.start()) Startup_trace::Instance().mark("preload started");
+}
+
+void start_exit()
+{
+    LOG_DEBUG("Exiting START");
+
+    // No font is not fatal - the menus are drawn without the text
+    if (ui_font_load && (ui_font = ui_font_load->get_font())) Asset_manager::Instance().set_pinned(UI_FONT, true);
+
+    ui_font_load.reset();
+}
+
+
+// Leaves the splash, when the preload and the asynchronous loads are finished and the splash was seen
+
+void start_update(State_machine& app_state_machine)
+{
+    ++splash_ticks;
+
+    if (splash_ticks >= SPLASH_MIN_TICKS && start_is_ready()) app_state_machine.request_go_to(MAIN_MENU_ID);
+}
+
+bool start_is_ready() { return Preloader::Instance().is_done() && Asset_loader::Instance().is_idle(); }
+
+// === START SPLASH ===
+
+// The engine clears and presents the frame (see Frame) - the state only draws.
+// START is static, so it tracks damage and is drawn only when the screen changes.
+
+void start_render(SDL_Renderer* renderer)
+{
     // Рисуем красный круг для чека работоспособности
-    SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);
+    // Built into a texture once, then it's a single copy per frame
+    Shape_cache::Instance().draw(renderer, Shape_desc::circle(50, Palette::Instance().get(COLOR_ACCENT)), 350.0f, 250.0f);
+}
+
+
+// === MENUS ===
+
+// Retained widgets of the menus - built once by init_game_states, redrawn only on changes
+static Ui_menu main_menu;
+static Ui_menu small_menu;
+
+static int main_menu_start = -1;
+static int main_menu_language = -1;
+static int small_menu_resume = -1;
+
+
+// Menu colors from the current theme
+static Widget_style menu_style()
+{
+    Widget_style style;
+
+    style.text = Palette::Instance().get(COLOR_SQUARE);
+    style.background = {0, 0, 0, 0};
+    style.focus_text = Palette::Instance().get(COLOR_BACKGROUND);
+    style.focus_background = Palette::Instance().get(COLOR_ACCENT);
+
+    return style;
+}
+
+
+static void on_main_menu_start(void* sm, int, Widget_event event, int)
+{
+    if (event == Widget_event::ACTIVATE) static_cast<State_machine*>(sm)->request_go_to(LEVEL_GAMEPLAY_ID);
+}
+
+
+// The highlighted language is prefetched, A switches to it without a hitch
+static void on_main_menu_language(void*, int, Widget_event event, int item)
+{
+    Lang_state& lang = Lang_state::Instance();
+
+    const Lang_list highlighted = static_cast<Lang_list>(item);
+
+    if (event == Widget_event::FOCUS || event == Widget_event::CHANGE) lang.Prefetch(highlighted);
+    else if (event == Widget_event::ACTIVATE) lang.Request_lang(highlighted);
+}
+
+
+static void on_main_menu_exit(void* sm, int, Widget_event event, int)
+{
+    if (event == Widget_event::ACTIVATE) static_cast<State_machine*>(sm)->request_go_to(EXIT_PROGRAM_ID);
+}
+
+
+static void on_small_menu_resume(void* sm, int, Widget_event event, int)
+{
+    if (event == Widget_event::ACTIVATE) static_cast<State_machine*>(sm)->pop_overlay();
+}
+
+
+static void on_small_menu_quit(void* sm, int, Widget_event event, int)
+{
+    // The transition pops the overlay first
+    if (event == Widget_event::ACTIVATE) static_cast<State_machine*>(sm)->request_go_to(MAIN_MENU_ID);
+}
+
+
+static void build_menus(State_machine& app_state_machine)
+{
+    // In the logical resolution - the same layout on every output
+    const int x = 120, w = Platform::LOGICAL_W - 2 * x;
+
+    main_menu.add_label({x, 60, w, 56}, STR_MENU_TITLE);
+    main_menu_start = main_menu.add_button({x, 180, w, 44}, STR_MENU_START, on_main_menu_start, &app_state_machine);
+    main_menu_language = main_menu.add_list({x, 236, w, 44}, {"English", "Русский"}, 0, on_main_menu_language, nullptr);
+    main_menu.add_button({x, 292, w, 44}, STR_MENU_EXIT, on_main_menu_exit, &app_state_machine);
+
+    small_menu.add_label({x, 120, w, 56}, STR_SMALL_MENU_TITLE);
+    small_menu_resume = small_menu.add_button({x, 220, w, 44}, STR_SMALL_MENU_RESUME, on_small_menu_resume, &app_state_machine);
+    small_menu.add_button({x, 276, w, 44}, STR_SMALL_MENU_QUIT, on_small_menu_quit, &app_state_machine);
+}
+
+// === MENUS ===
+
+
+void main_menu_enter()
+{
+    LOG_DEBUG("Entering MAIN_MENU");
+
+    main_menu.set_font(ui_font);
+    main_menu.set_style(menu_style());
+    main_menu.set_selected(main_menu_language, static_cast<int>(Lang_state::Instance().Get_lang()));
+    main_menu.set_focus(main_menu_start);
+}
+
+void main_menu_exit()
+{
+    LOG_DEBUG("Exiting MAIN_MENU");
+
+    // The inactive language costs nothing outside the menu
+    Lang_state::Instance().Cancel_prefetch();
+}
 
-    int cx = 400, cy = 300, r = 50;
 
-    for (int w = 0; w < r * 2; w++)
+// UP / DOWN choose, LEFT / RIGHT change the language, A activates, START begins the level at once
+
+void main_menu_update(State_machine& app_state_machine)
+{
+    const Input_snapshot& input = Input::Instance().get_snapshot();
+
+    main_menu.update(input);
+
+    if (input.is_pressed(START_BTN)) app_state_machine.request_go_to(LEVEL_GAMEPLAY_ID);
+}
+
+void main_menu_render(SDL_Renderer* renderer) { main_menu.render(renderer); }
+
+void game_enter()          { LOG_DEBUG("Entering GAME"); }
+void game_exit()           { LOG_DEBUG("Exiting GAME"); }
+
+// === LEVEL SAVE ===
+
+// The level continues where it was left - saved on the pause and on the exit
+static constexpr const char* LEVEL_SAVE_PATH = "save.dat";
+
+// Serialized world, swapped with the Save_system buffers - no allocation after the first saves
+static std::vector<std::uint8_t> level_save_bytes;
+
+
+static void save_level()
+{
+    level_gameplay_save(get_gameplay_world(), level_save_bytes);
+
+    Save_system::Instance().save(LEVEL_SAVE_PATH, level_save_bytes);
+}
+
+// === LEVEL SAVE ===
+
+
+// The build of the entry is complete - a level left before that has nothing to save
+static bool level_ready = false;
+
+void level_gameplay_enter()
+{
+    LOG_DEBUG("Entering LEVEL_GAMEPLAY");
+
+    level_ready = false;
+
+    // The frame of the menu stays until the steps below finish the world
+    level_gameplay_build_begin();
+}
+
+bool level_gameplay_enter_step(double budget_seconds)
+{
+    if (!level_gameplay_build_step(budget_seconds)) return false;
+
+    // The retry still goes back to the built level
+    if (Save_system::Instance().load(LEVEL_SAVE_PATH, level_save_bytes))
+        level_gameplay_restore(get_gameplay_world(), level_save_bytes);
+
+    level_ready = true;
+
+    return true;
+}
+
+void level_gameplay_exit()
+{
+    LOG_DEBUG("Exiting LEVEL_GAMEPLAY");
+
+    if (level_ready) save_level();
+
+    level_ready = false;
+}
+
+// The level on the State_behavior hooks - the one state of the pipelined cycle
+// (sdl_app_ctx::pipelined_update): its ticks run on the update worker, while the render
+// draws the world published at the sync point
+
+class Level_gameplay_behavior final : public State_behavior
+{
+
+public:
+
+    explicit Level_gameplay_behavior(State_machine& sm) : app_state_machine(sm) {}
+
+    void on_enter() override { pause_requested = false; level_gameplay_enter(); }
+    void on_exit() override  { level_gameplay_exit(); }
+
+    void update() override
     {
-        for (int h = 0; h < r * 2; h++)
+        // The worker leaves the save and the overlay to the sync point - the ticks after START stay frozen
+        const bool on_worker = Update_pipeline::is_worker_thread();
+
+        if (pause_requested) return;
+
+        // START in the level opens the small menu over its frozen frame
+        if (Input::Instance().get_snapshot().is_pressed(START_BTN))
         {
-            int dx = r - w;
-            int dy = r - h;
+            if (on_worker)
+            {
+                pause_requested = true;
+                return;
+            }
 
-            if ((dx*dx + dy*dy) <= (r*r)) SDL_RenderDrawPoint(renderer, cx + dx, cy + dy);
+            save_level();
+
+            app_state_machine.push_overlay(SMALL_MENU_ID);
+            return;
         }
+
+        level_gameplay_update();
+
+        // The positions of the tick - the damaged regions of the next frame
+        if (on_worker) level_gameplay_defer_damage(get_gameplay_world());
+        else level_gameplay_report_damage(get_gameplay_world());
+    }
+
+    void render(SDL_Renderer* r, float alpha) override { level_gameplay_render(r, alpha); }
+
+
+    bool is_pipelined() const override { return true; }
+
+    void publish_render_state() override
+    {
+        if (pause_requested)
+        {
+            pause_requested = false;
+
+            save_level();
+
+            // The cycle of the push runs on the main thread, the overlay is above the level then
+            app_state_machine.push_overlay(SMALL_MENU_ID);
+        }
+
+        level_gameplay_publish(get_gameplay_world());
     }
 
-    SDL_RenderPresent(renderer);
+
+    // The world in slices, the menu frame held meanwhile; build progress over it
+    bool has_enter_step() const override { return true; }
+    bool enter_step(double budget_seconds) override { return level_gameplay_enter_step(budget_seconds); }
+    void render_loading(SDL_Renderer* r) override { level_gameplay_render_loading(r); }
+
+    // Suspended in the level - the world of that very tick comes back, not the last pause save
+    void save_snapshot(std::vector<std::uint8_t>& out) override { level_gameplay_save(get_gameplay_world(), out); }
+    bool restore_snapshot(const std::vector<std::uint8_t>& in) override { return level_gameplay_restore(get_gameplay_world(), in); }
+
+
+private:
+
+    State_machine& app_state_machine;
+
+    // START pressed in a tick on the worker
+    bool pause_requested = false;
+};
+
+void small_menu_enter()
+{
+    LOG_DEBUG("Entering SMALL_MENU");
+
+    small_menu.set_font(ui_font);
+    small_menu.set_style(menu_style());
+    small_menu.set_focus(small_menu_resume);
 }
 
+void small_menu_exit()     { LOG_DEBUG("Exiting SMALL_MENU"); }
+
 
-void main_menu_enter()     { std::cout << "Entering MAIN_MENU\n"; }
-void main_menu_exit()      { std::cout << "Exiting MAIN_MENU\n"; }
+// B or START resume the level too
 
-void game_enter()          { std::cout << "Entering GAME\n"; }
-void game_exit()           { std::cout << "Exiting GAME\n"; }
+void small_menu_update(State_machine& app_state_machine)
+{
+    const Input_snapshot& input = Input::Instance().get_snapshot();
+
+    if (input.is_pressed(B_BTN) || input.is_pressed(START_BTN))
+    {
+        app_state_machine.pop_overlay();
+        return;
+    }
 
-void level_gameplay_enter(){ std::cout << "Entering LEVEL_GAMEPLAY\n"; }
-void level_gameplay_exit() { std::cout << "Exiting LEVEL_GAMEPLAY\n"; }
+    small_menu.update(input);
+}
 
-void small_menu_enter()    { std::cout << "Entering SMALL_MENU\n"; }
-void small_menu_exit()     { std::cout << "Exiting SMALL_MENU\n"; }
+void small_menu_render(SDL_Renderer* renderer) { small_menu.render(renderer); }
 
-void exit_program_enter()  { std::cout << "Entering EXIT_PROGRAM\n"; }
-void exit_program_exit()   { std::cout << "Exiting EXIT_PROGRAM\n"; }
+void exit_program_enter()
+{
+    LOG_DEBUG("Entering EXIT_PROGRAM");
+
+    // The application loop ends on the quit event, like by the window close
+    SDL_Event quit = {};
+    quit.type = SDL_QUIT;
+    SDL_PushEvent(&quit);
+}
+void exit_program_exit()   { LOG_DEBUG("Exiting EXIT_PROGRAM"); }
 
 // =========================================================================================== CALLBACKS
 
 
 // =========================================================================================== INITIALIZATION
 
+// Allowed transitions - anything else is a bug and is refused. The edge from GAME covers
+// the level and its small menu, the overlays are pushed and popped, not transitioned to.
+static const Transition_edge game_transitions[] =
+{
+    {START_ID,     MAIN_MENU_ID},
+    {MAIN_MENU_ID, LEVEL_GAMEPLAY_ID},
+    {MAIN_MENU_ID, EXIT_PROGRAM_ID},
+    {GAME_ID,      MAIN_MENU_ID},
+};
+
+
 void init_game_states(State_machine& app_state_machine)
 {
-    // Each block below creates a State object, assigns its enter/exit callbacks,
-    // and adds it to the state machine. The hierarchy linking is handled
-    // automatically by State_machine::add_state.
+    // All of the states are created in one linear pass from the compile-time tree.
+    // The hierarchy links are already resolved inside game_state_tree.
+    app_state_machine.build_tree(game_state_tree);
 
-    // === START ===
+    app_state_machine.set_transitions(game_transitions);
+
+    apply_game_theme(0);
+
+    for (unsigned int i = 0; i < static_cast<unsigned int>(Lang_list::LIMIT); ++i)
+        Lang_state::Instance().Set_lang_assets(static_cast<Lang_list>(i), lang_assets[i]);
 
-    // Smart initialization by the state machine
-    app_state_machine.initiate_state(START_ID, "START");
+    build_menus(app_state_machine);
+
+    // Each block below assigns the enter/exit callbacks of a state.
+
+    // === START ===
 
     // Callbacs setting by the state machine
     if (auto* s = app_state_machine.get_state(START_ID))
     {
         s->on_enter = start_enter;          // Actions on the state entering 
         s->on_exit  = start_exit;           // Actions on the state exit
+        s->state_update = [&app_state_machine]() { start_update(app_state_machine); }; // Splash timer and preload check
         s->state_render = start_render;     // Rendering for the state
+        s->tracks_damage = true;            // Static splash - redraw only on changes
     }
 
 
     // === MAIN_MENU ===
-    app_state_machine.initiate_state(MAIN_MENU_ID, "MAIN_MENU");
-
     if (auto* s = app_state_machine.get_state(MAIN_MENU_ID))
     {
         s->on_enter = main_menu_enter;
         s->on_exit  = main_menu_exit;
+        s->state_update = [&app_state_machine]() { main_menu_update(app_state_machine); }; // Menu navigation
+        s->state_render = main_menu_render; // Cached widgets - a few copies per frame
+        s->tracks_damage = true;            // The widgets mark the frame on their changes
+        s->is_static = true;                // Nothing animates - the loop sleeps until the input
+        s->update_divisor = 3;              // 20 Hz, the presses still run it at once
+        s->enter_effect = Transition_effect::FADE; // Over the splash or the left level
+        s->manifest = &main_menu_manifest;  // Loaded ahead, while START is active
     }
 
 
     // === GAME ===
-    app_state_machine.initiate_state(GAME_ID, "GAME");
-
     if (auto* s = app_state_machine.get_state(GAME_ID))
     {
         s->on_enter = game_enter;
         s->on_exit  = game_exit;
+        s->resumable = true;
     }
 
 
     // === LEVEL_GAMEPLAY ===
-    app_state_machine.initiate_state(LEVEL_GAMEPLAY_ID, "LEVEL_GAMEPLAY");
-
     if (auto* s = app_state_machine.get_state(LEVEL_GAMEPLAY_ID))
     {
-        s->on_enter = level_gameplay_enter;
-        s->on_exit  = level_gameplay_exit;
+        s->behavior = std::make_unique<Level_gameplay_behavior>(app_state_machine); // Hooks, pipelined update
+        s->enter_effect = Transition_effect::FADE; // The menu fades out over the first frames
+        s->tracks_damage = true;            // The moving entities report their areas - a resting level isn't redrawn
+        s->resumable = true;                // Resumed into the world of the suspended tick
     }
 
 
     // === SMALL_MENU ===
-    app_state_machine.initiate_state(SMALL_MENU_ID, "SMALL_MENU");
-
     if (auto* s = app_state_machine.get_state(SMALL_MENU_ID))
     {
         s->on_enter = small_menu_enter;
         s->on_exit  = small_menu_exit;
+        s->state_update = [&app_state_machine]() { small_menu_update(app_state_machine); };
+        s->state_render = small_menu_render; // Over the frozen backdrop of the level
+        s->tracks_damage = true;
+        s->is_static = true;
+        s->update_divisor = 3;
+        s->resumable = true;
     }
 
 
     // === EXIT_PROGRAM ===
-    app_state_machine.initiate_state(EXIT_PROGRAM_ID, "EXIT_PROGRAM");
-
     if (auto* s = app_state_machine.get_state(EXIT_PROGRAM_ID))
     {
         s->on_enter = exit_program_enter;
@@ -135,7 +533,7 @@ void init_game_states(State_machine& app_state_machine)
     }
 
     // At this point, all states are registered in the state machine.
-    // State_machine handles connecting parents and children based on IDs,
+    // Parents and children were connected from the tree index arrays,
     // so hierarchical updates and callback chaining will work automatically.
 }
 
@@ -4,7 +4,6 @@
 
 #include <vector>
 #include <string>
-#include <utility> // for std::pair
 
 
 #include "../../engine/state_machine/state_machine.h"
@@ -20,32 +19,79 @@
  * Each ID defines the position of a state in the state machine hierarchy.
  * This makes it easy to determine parent-child relationships and manage
  * nested states.
+ *
+ * State_ID is a packed constexpr value, so these are compile-time constants
+ * with no dynamic initialization in the translation units including this header.
  */
-const State_ID START_ID            = {0};           // Initial boot/start state
-const State_ID MAIN_MENU_ID        = {1};           // Main menu state
-const State_ID GAME_ID             = {1, 1};        // Top-level game state
-const State_ID LEVEL_GAMEPLAY_ID   = {1, 1, 1};     // Gameplay level state
-const State_ID SMALL_MENU_ID       = {1, 1, 2};     // In-game small menu
-const State_ID EXIT_PROGRAM_ID     = {2};           // Program exit state
+constexpr State_ID START_ID            = {0};           // Initial boot/start state
+constexpr State_ID MAIN_MENU_ID        = {1};           // Main menu state
+constexpr State_ID GAME_ID             = {1, 1};        // Top-level game state
+constexpr State_ID LEVEL_GAMEPLAY_ID   = {1, 1, 1};     // Gameplay level state
+constexpr State_ID SMALL_MENU_ID       = {1, 1, 2};     // In-game small menu
+constexpr State_ID EXIT_PROGRAM_ID     = {2};           // Program exit state
+
+static_assert(GAME_ID.is_parent_of(LEVEL_GAMEPLAY_ID), "GAME must be the parent of LEVEL_GAMEPLAY");
+static_assert(GAME_ID.child(2) == SMALL_MENU_ID, "SMALL_MENU must be the second child of GAME");
 
 
 /**
  * @brief Mapping of State_IDs to human-readable names.
  *
  * Useful for debugging, logging, or automatic state registration.
+ * It is the source of the compile-time game_state_tree below.
  */
-const std::vector<std::pair<State_ID, std::string>> state_defs = {
-    {{0},       "START"},
-    {{1},       "MAIN_MENU"},
-    {{1,1},     "GAME"},
-    {{1,1,1},   "LEVEL_GAMEPLAY"},
-    {{1,1,2},   "SMALL_MENU"},
-    {{2},       "EXIT_PROGRAM"}
+constexpr State_def state_defs[] = {
+    {START_ID,          "START"},
+    {MAIN_MENU_ID,      "MAIN_MENU"},
+    {GAME_ID,           "GAME"},
+    {LEVEL_GAMEPLAY_ID, "LEVEL_GAMEPLAY"},
+    {SMALL_MENU_ID,     "SMALL_MENU"},
+    {EXIT_PROGRAM_ID,   "EXIT_PROGRAM"}
 };
 
+
+/**
+ * @brief The whole game state hierarchy, linked at compile time.
+ *
+ * Duplicated IDs inside state_defs are a compile error.
+ */
+constexpr auto game_state_tree = make_state_tree(state_defs);
+
+static_assert(game_state_tree.valid, "state_defs contains duplicated State_IDs");
+
 // =========================================================================================== STATE IDS
 
 
+// =========================================================================================== THEME
+
+/**
+ * @brief Palette slots of the game colors.
+ *
+ * Everything, which changes the color on the edge hit, is drawn by these slots
+ * (Palette::Instance().get(COLOR_SQUARE)), so the color swap is a palette update.
+ */
+enum Game_color : std::uint8_t
+{
+    COLOR_BACKGROUND = 0,
+    COLOR_SQUARE,
+    COLOR_ACCENT,
+
+    GAME_COLOR_COUNT
+};
+
+// Number of the predefined themes
+constexpr int GAME_THEME_COUNT = 2;
+
+/**
+ * @brief Applies a predefined theme: the palette and the frame clear color.
+ *
+ * @param theme Theme index, wrapped by GAME_THEME_COUNT.
+ */
+void apply_game_theme(int theme);
+
+// =========================================================================================== THEME
+
+
 // =========================================================================================== CALLBACKS
 
 /**
@@ -63,15 +109,21 @@ const std::vector<std::pair<State_ID, std::string>> state_defs = {
 
 void start_enter();
 void start_exit();
+void start_update(State_machine& app_state_machine);
 void start_render(SDL_Renderer* renderer);
 
+// The preload of the splash is finished - a suspended session can be resumed now
+bool start_is_ready();
+
 void main_menu_enter();
 void main_menu_exit();
+void main_menu_update(State_machine& app_state_machine);
 
 void game_enter();
 void game_exit();
 
 void level_gameplay_enter();
+bool level_gameplay_enter_step(double budget_seconds);
 void level_gameplay_exit();
 
 void small_menu_enter();
@@ -88,7 +140,7 @@ void exit_program_exit();
 /**
  * @brief Initializes all game states and adds them to the state machine.
  *
- * - Creates State objects for each defined ID and name.
+ * - Creates State objects for each definition of the compile-time game_state_tree.
  * - Assigns the corresponding enter and exit callbacks.
  * - Automatically links parent and child states based on hierarchical IDs.
  *
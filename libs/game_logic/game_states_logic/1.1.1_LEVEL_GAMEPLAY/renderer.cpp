@@ -0,0 +1,257 @@
+// renderer.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "renderer.h"
+#include "update.h"
+#include "../../../engine/primitives/primitives.h"
+#include "../../../engine/palette/palette.h"
+#include "../../../engine/input/input.h"
+#include "../../../engine/platform/backend.h"
+#include "../../../engine/engine_clock/engine_clock.h"
+#include "../../../engine/frame/frame.h"
+
+#include <algorithm>
+#include <cmath>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== DAMAGE
+
+// Screen rectangle over the positions of the last two ticks, widened by the margin on every side
+static SDL_Rect swept_rect(const Transform_component& t, float margin)
+{
+    const float x0 = fx::to_float(std::min(t.previous_x, t.x)) - margin;
+    const float y0 = fx::to_float(std::min(t.previous_y, t.y)) - margin;
+    const float x1 = fx::to_float(std::max(t.previous_x, t.x) + t.width) + margin;
+    const float y1 = fx::to_float(std::max(t.previous_y, t.y) + t.height) + margin;
+
+    const int x = static_cast<int>(std::floor(x0));
+    const int y = static_cast<int>(std::floor(y0));
+
+    return {x, y, static_cast<int>(std::ceil(x1)) - x, static_cast<int>(std::ceil(y1)) - y};
+}
+
+
+// Damaged areas of the world - a redraw of everything, or a rectangle per changed area
+template <typename Redraw, typename Add>
+static void collect_damage(Gameplay_world& world, Redraw&& redraw, Add&& add)
+{
+    if (world.redraw_all)
+    {
+        world.redraw_all = false;
+        redraw();
+        return;
+    }
+
+    // Bodies - only the moving ones, a resting body is the same pixels every frame
+    const Character* bodies = world.bodies.data();
+    const Entity* owners = world.bodies.get_entities();
+
+    const float step_ticks = static_cast<float>(Character::get_step_ticks(Engine_clock::time.tick_dt));
+
+    for (int i = 0; i < world.bodies.size(); ++i)
+    {
+        const Transform_component* t = world.transforms.get(owners[i]);
+        const Vec2_fx velocity = bodies[i].get_velocity();
+
+        if (!t || (t->previous_x == t->x && t->previous_y == t->y && velocity.x == 0 && velocity.y == 0)) continue;
+
+        add(swept_rect(*t, fx::to_float(bodies[i].get_max_speed()) * step_ticks));
+    }
+
+    // Transients - every live one, a spawn and a despawn change the screen too
+    for (int kind = 0; kind < LEVEL_POOL_COUNT; ++kind)
+    {
+        const Entity_pool<Transient_component>& pool = world.get_pool(static_cast<Level_pool>(kind));
+        const Entity* transients = pool.get_entities();
+
+        for (int i = 0; i < pool.size(); ++i)
+            if (const Transform_component* t = world.transforms.get(transients[i])) add(swept_rect(*t, 0.0f));
+    }
+
+    SDL_Rect sparks;
+
+    if (world.sparks.get_bounds(sparks)) add(sparks);
+}
+
+
+void level_gameplay_report_damage(Gameplay_world& world)
+{
+    Frame& frame = Frame::Instance();
+
+    collect_damage(world, [&frame]() { frame.mark_dirty(); }, [&frame](const SDL_Rect& r) { frame.add_damage(r); });
+}
+
+
+void level_gameplay_defer_damage(Gameplay_world& world)
+{
+    // The Frame is the main thread's - the ticks of the worker keep their damage until the sync point
+    collect_damage(world, [&world]() { world.pending_redraw = true; },
+                   [&world](const SDL_Rect& r)
+                   {
+                       if (world.pending_damage.size() < world.pending_damage.capacity()) world.pending_damage.push_back(r);
+                       else world.pending_redraw = true;
+                   });
+}
+
+// =========================================================================================== DAMAGE
+
+
+// =========================================================================================== RENDER VIEW
+
+// What the render of the pipelined cycle draws - the world as of the sync point, the worker
+// runs the next update over the world meanwhile
+struct Gameplay_view
+{
+    struct Item
+    {
+        Transform_component transform;
+        Shape_component shape;
+        bool square = false;
+    };
+
+    std::vector<Item> items;
+
+    // Damage of the published ticks, reported by the render of the cycle
+    std::vector<SDL_Rect> damage;
+
+    // Square for the late latched prediction
+    Character square;
+    bool has_square = false;
+
+    Particle_system sparks;
+};
+
+static Gameplay_view view;
+
+// Frame index at the publish - the next frame renders the view
+static Uint64 view_frame = ~Uint64{0};
+
+
+void level_gameplay_publish(Gameplay_world& world)
+{
+    Frame& frame = Frame::Instance();
+
+    // Damage of the ticks run on the worker since the last sync point
+    if (world.pending_redraw) frame.mark_dirty();
+    else for (const SDL_Rect& r : world.pending_damage) frame.add_damage(r);
+
+    world.pending_damage.clear();
+    world.pending_redraw = false;
+
+    view.items.clear();
+    view.damage.clear();
+
+    collect_damage(world, [&frame]() { frame.mark_dirty(); }, [](const SDL_Rect& r) { view.damage.push_back(r); });
+
+    const Transform_component* transforms = world.transforms.data();
+    const Entity* owners = world.transforms.get_entities();
+
+    for (int i = 0; i < world.transforms.size(); ++i)
+        if (const Shape_component* shape = world.shapes.get(owners[i]))
+            view.items.push_back({transforms[i], *shape, owners[i] == world.square});
+
+    const Character* square = world.bodies.get(world.square);
+
+    view.has_square = square != nullptr;
+
+    if (square) view.square = *square;
+
+    view.sparks = world.sparks;
+
+    // begin() of the render of this cycle moves the index by one
+    view_frame = frame.get_index();
+}
+
+// =========================================================================================== RENDER VIEW
+
+
+// =========================================================================================== RENDER
+
+// Entity between its previous and its current tick, the square one tick ahead by the late buttons
+static void draw_entity(const Transform_component& t, const Shape_component& shape, const Character* predicted, float alpha,
+                        const Palette& palette)
+{
+    if (predicted)
+    {
+        const Vec2 p = predicted->get_predicted_position(Input::Instance().get_late_snapshot(), alpha,
+                                                          Character::get_step_ticks(Engine_clock::time.tick_dt));
+
+        draw_rect({p.x, p.y, fx::to_float(t.width), fx::to_float(t.height)}, palette.get(shape.color), shape.layer);
+        return;
+    }
+
+    draw_rect({t.get_render_x(alpha), t.get_render_y(alpha), fx::to_float(t.width), fx::to_float(t.height)},
+              palette.get(shape.color), shape.layer);
+}
+
+
+void level_gameplay_render(SDL_Renderer*, float alpha)
+{
+    const Gameplay_world& world = get_gameplay_world();
+    const Palette& palette = Palette::Instance();
+    Frame& frame = Frame::Instance();
+
+    // Published at the sync point of this cycle - the world itself is the worker's until the wait
+    const bool published = view_frame + 1 == frame.get_index();
+
+    // Drawn once per damaged region - the drawn areas are reported once per frame
+    static Uint64 reported_frame = ~Uint64{0};
+
+    if (reported_frame != frame.get_index())
+    {
+        reported_frame = frame.get_index();
+
+        if (published) for (const SDL_Rect& r : view.damage) frame.add_damage(r);
+        else level_gameplay_report_damage(get_gameplay_world());
+    }
+
+    // Late latched buttons (sdl_app_ctx::late_input_latch) - the square is drawn one tick ahead by
+    // them, not by the buttons of its last tick; not while rewinding, the tick goes back then
+    const Input& input = Input::Instance();
+    const bool latched = input.is_late_latched() && !input.get_late_snapshot().is_held(B_BTN);
+
+    if (published)
+    {
+        const Character* predicted = latched && view.has_square ? &view.square : nullptr;
+
+        for (const Gameplay_view::Item& item : view.items)
+            draw_entity(item.transform, item.shape, item.square ? predicted : nullptr, alpha, palette);
+
+        view.sparks.render(palette.get(COLOR_ACCENT), alpha);
+        return;
+    }
+
+    const Character* predicted = latched ? world.bodies.get(world.square) : nullptr;
+
+    // Every rendered entity - between its previous and its current tick
+    const Transform_component* transforms = world.transforms.data();
+    const Entity* owners = world.transforms.get_entities();
+
+    for (int i = 0; i < world.transforms.size(); ++i)
+        if (const Shape_component* shape = world.shapes.get(owners[i]))
+            draw_entity(transforms[i], *shape, owners[i] == world.square ? predicted : nullptr, alpha, palette);
+
+    // Sparks - one run of quads above the level, moved back by their speed for the alpha
+    world.sparks.render(palette.get(COLOR_ACCENT), alpha);
+}
+
+
+void level_gameplay_render_loading(SDL_Renderer*)
+{
+    const Palette& palette = Palette::Instance();
+
+    // Thin bar along the bottom edge, above everything of the held frame
+    constexpr float BAR_HEIGHT = 4.0f;
+
+    const float w = static_cast<float>(Platform::LOGICAL_W);
+    const float y = static_cast<float>(Platform::LOGICAL_H) - BAR_HEIGHT;
+
+    draw_rect({0.0f, y, w, BAR_HEIGHT}, palette.get(COLOR_BACKGROUND), 3);
+    draw_rect({0.0f, y, w * level_gameplay_build_progress(), BAR_HEIGHT}, palette.get(COLOR_ACCENT), 3);
+}
+
+// =========================================================================================== RENDER
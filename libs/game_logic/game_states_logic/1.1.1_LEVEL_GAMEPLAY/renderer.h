@@ -0,0 +1,55 @@
+// renderer.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include "../../../engine/platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+struct Gameplay_world;
+
+
+// =========================================================================================== RENDER
+
+/**
+ * @brief Draws the level (the LEVEL_GAMEPLAY state_render).
+ *
+ * One loop over the transforms of the rendered entities, drawn between their last two
+ * ticks, then the sparks as one batch. In the frame after level_gameplay_publish() the
+ * published copy is drawn instead of the world.
+ *
+ * @param renderer Renderer of the frame.
+ * @param alpha    Interpolation factor between the last two simulation ticks [0, 1].
+ */
+void level_gameplay_render(SDL_Renderer* renderer, float alpha);
+
+// Progress bar of the running build over the held frame (the LEVEL_GAMEPLAY state_render_loading)
+void level_gameplay_render_loading(SDL_Renderer* renderer);
+
+/**
+ * @brief Reports the screen areas of the level, which change, to the Frame (main thread only).
+ *
+ * The level tracks its damage (State::tracks_damage): the static boxes are drawn once, only
+ * the moving bodies (their move of the last tick, widened by a step of the max speed for the
+ * late latched prediction), the transients and the sparks are reported. A replaced world
+ * (Gameplay_world::redraw_all) is one full redraw. Called after the update ticks - the new
+ * positions, and by the render once per frame - the drawn ones, which the next frame erases.
+ */
+void level_gameplay_report_damage(Gameplay_world& world);
+
+// Same areas kept in Gameplay_world::pending_damage - the ticks run on the update worker
+void level_gameplay_defer_damage(Gameplay_world& world);
+
+/**
+ * @brief Sync point of the pipelined cycle (main thread, the worker idle).
+ *
+ * Hands the deferred damage to the Frame and copies what the render draws - the transforms
+ * and the shapes, the square for the late latched prediction, the sparks - so the render of
+ * this cycle draws update N while the worker runs update N + 1 over the world.
+ */
+void level_gameplay_publish(Gameplay_world& world);
+
+// =========================================================================================== RENDER
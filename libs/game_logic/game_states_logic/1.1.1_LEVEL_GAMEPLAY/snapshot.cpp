@@ -0,0 +1,132 @@
+// snapshot.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "snapshot.h"
+#include "update.h"
+#include "../../../engine/event_bus/event_bus.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== GAMEPLAY SNAPSHOT
+
+// Catches a snapshot of another layout (the rewind ring survives only one build, but still)
+static constexpr std::uint32_t SNAPSHOT_MAGIC = 0x47534E32u; // "GSN2"
+
+
+void level_gameplay_save(const Gameplay_world& world, std::vector<std::uint8_t>& out)
+{
+    out.clear();
+
+    snapshot_io::write_value(out, SNAPSHOT_MAGIC);
+    snapshot_io::write_value(out, world.square);
+    snapshot_io::write_value(out, static_cast<std::int32_t>(world.theme));
+
+    world.store.save(out);
+    world.bodies.save(out);
+    world.boxes.save(out);
+    world.shapes.save(out);
+    world.transforms.save(out);
+
+    world.bullets.save(out);
+    world.pickups.save(out);
+    world.debris.save(out);
+    world.popups.save(out);
+}
+
+
+bool level_gameplay_restore(Gameplay_world& world, const std::vector<std::uint8_t>& in)
+{
+    const std::uint8_t* p = in.data();
+    const std::uint8_t* end = p + in.size();
+
+    std::uint32_t magic = 0;
+    Entity square = NULL_ENTITY;
+    std::int32_t theme = 0;
+
+    if (!snapshot_io::read_value(p, end, magic) || magic != SNAPSHOT_MAGIC) return false;
+
+    if (!snapshot_io::read_value(p, end, square) || !snapshot_io::read_value(p, end, theme)) return false;
+
+    // The pools are read in place - a damaged snapshot is caught by the size checks,
+    // and the whole snapshot is written by this build, so a failure here is a bug
+    if (!world.store.load(p, end) || !world.bodies.load(p, end) || !world.boxes.load(p, end) || !world.shapes.load(p, end)
+        || !world.transforms.load(p, end) || !world.bullets.load(p, end) || !world.pickups.load(p, end)
+        || !world.debris.load(p, end) || !world.popups.load(p, end))
+    {
+        SDL_Log("Gameplay snapshot is damaged - the level is rebuilt");
+        level_gameplay_build();
+        return false;
+    }
+
+    world.square = square;
+    world.redraw_all = true;
+
+    // The hits of the replaced ticks are not delivered - no sparks and no theme from them
+    Event_bus::Instance().discard<Edge_hit_event>();
+
+    if (world.theme != theme)
+    {
+        world.theme = theme;
+        apply_game_theme(theme);
+    }
+
+    // The grid from the restored boxes - a few entities, cheaper than saving the buckets
+    world.grid.clear();
+
+    const Box_component* boxes = world.boxes.data();
+    const Entity* box_owners = world.boxes.get_entities();
+
+    for (int i = 0; i < world.boxes.size(); ++i)
+        world.grid.update(box_owners[i], {boxes[i].x, boxes[i].y, boxes[i].x + boxes[i].width, boxes[i].y + boxes[i].height});
+
+    const Character* bodies = world.bodies.data();
+    const Entity* body_owners = world.bodies.get_entities();
+
+    for (int i = 0; i < world.bodies.size(); ++i)
+        world.grid.update(body_owners[i], {bodies[i].get_x(), bodies[i].get_y(),
+                                           bodies[i].get_x() + bodies[i].get_width(), bodies[i].get_y() + bodies[i].get_height()});
+
+    world.contacts.clear();
+
+    return true;
+}
+
+// =========================================================================================== GAMEPLAY SNAPSHOT
+
+
+// =========================================================================================== GAMEPLAY REWIND
+
+Gameplay_rewind::Gameplay_rewind(int ticks) : ring(static_cast<size_t>(ticks > 0 ? ticks : 1)) {}
+
+
+void Gameplay_rewind::push(const Gameplay_world& world)
+{
+    level_gameplay_save(world, ring[static_cast<size_t>(head)]);
+
+    head = (head + 1) % static_cast<int>(ring.size());
+
+    if (count < static_cast<int>(ring.size())) ++count;
+}
+
+
+bool Gameplay_rewind::rewind(Gameplay_world& world)
+{
+    if (count == 0) return false;
+
+    head = (head + static_cast<int>(ring.size()) - 1) % static_cast<int>(ring.size());
+    --count;
+
+    return level_gameplay_restore(world, ring[static_cast<size_t>(head)]);
+}
+
+
+void Gameplay_rewind::clear()
+{
+    head = 0;
+    count = 0;
+}
+
+// =========================================================================================== GAMEPLAY REWIND
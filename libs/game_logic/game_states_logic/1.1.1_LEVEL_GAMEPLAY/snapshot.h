@@ -0,0 +1,90 @@
+// snapshot.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+#include <vector>
+
+// =========================================================================================== IMPORT
+
+
+struct Gameplay_world;
+
+
+// =========================================================================================== GAMEPLAY SNAPSHOT
+
+/**
+ * @brief Appends the whole simulation state of the world to the bytes.
+ *
+ * The entity ids, the component pools (bodies with their fixed-point physics, boxes,
+ * shapes, transforms, the transient pools), the square id and the theme index - raw copies of the dense arrays, a few
+ * hundred bytes for the current level. The grid, the contacts and the sparks are not
+ * saved: the grid is rebuilt from the boxes by the restore, the rest is per tick or visual.
+ *
+ * @param world Gameplay world.
+ * @param out   Bytes, cleared first (the capacity is reused).
+ */
+void level_gameplay_save(const Gameplay_world& world, std::vector<std::uint8_t>& out);
+
+/**
+ * @brief Restores the world from a level_gameplay_save() snapshot.
+ *
+ * The theme is applied again if the snapshot has another one.
+ *
+ * @return false if it's not a gameplay snapshot (the world is untouched) or it's damaged
+ *         (the level is rebuilt).
+ */
+bool level_gameplay_restore(Gameplay_world& world, const std::vector<std::uint8_t>& in);
+
+// =========================================================================================== GAMEPLAY SNAPSHOT
+
+
+// =========================================================================================== GAMEPLAY REWIND
+
+
+/**
+ * @brief Ring of the per-tick snapshots of the last seconds - the rewind.
+ *
+ * push() after every tick saves the world into the oldest slot, rewind() restores the
+ * newest one and drops it. The slot buffers keep their capacity, so after the first
+ * lap the rewind doesn't allocate.
+ *
+ * Usage:
+ * @code
+ * if (input.is_held(B_BTN)) rewind.rewind(world);   // instead of the step
+ * else { step(world); rewind.push(world); }
+ * @endcode
+ */
+class Gameplay_rewind
+{
+
+public:
+
+    // 10 seconds of the 60 Hz ticks by default
+    explicit Gameplay_rewind(int ticks = 600);
+
+    // Saves the world as the newest tick
+    void push(const Gameplay_world& world);
+
+    // Restores the newest tick and drops it, false if the ring is empty
+    bool rewind(Gameplay_world& world);
+
+    // Drops every tick (the retry)
+    void clear();
+
+    // Ticks, which could be rewound
+    int get_count() const { return count; }
+
+
+private:
+
+    std::vector<std::vector<std::uint8_t>> ring;
+
+    // Next slot to write and the number of the saved ticks
+    int head = 0;
+    int count = 0;
+};
+
+// =========================================================================================== GAMEPLAY REWIND
@@ -0,0 +1,536 @@
+// update.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "update.h"
+#include "../../../engine/input/input.h"
+#include "../../../engine/platform/backend.h"
+#include "../../../engine/engine_clock/engine_clock.h"
+#include "../../../engine/event_bus/event_bus.h"
+#include "../../level/level_file.h"
+
+#include <algorithm>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== GAMEPLAY WORLD
+
+// Binary level of the gameplay (miyoo_level_cooker), the built-in layout below without it
+static const char* const LEVEL_PATH = "levels/level_1.lvl";
+
+// Built-in layout in the logical pixels (Platform::LOGICAL_W x LOGICAL_H)
+static constexpr int LEVEL_W = Platform::LOGICAL_W;
+static constexpr int LEVEL_H = Platform::LOGICAL_H;
+static constexpr int BORDER = 4;
+static constexpr int SQUARE_SIZE = 40;
+
+// Capacity reserved up front - the level content grows without the reallocations in the ticks
+static constexpr int RESERVED_ENTITIES = 256;
+
+// Transient pools of a level without the hints (Level_pool order): bullets, pickups, debris, popups
+static constexpr std::uint16_t DEFAULT_POOL_CAPACITY[LEVEL_POOL_COUNT] = {64, 16, 128, 8};
+
+// Boxes created between two clock reads of a build step
+static constexpr std::uint32_t BUILD_CHUNK = 32;
+
+// Sparks of one edge hit
+static constexpr int SPARK_COUNT = 96;
+static constexpr float SPARK_SPEED_MIN = 60.0f;
+static constexpr float SPARK_SPEED_MAX = 260.0f;
+static constexpr float SPARK_LIFE = 0.6f;
+
+
+// The palette follows the theme of the hit
+static void apply_hit_theme(void*, const Edge_hit_event& event) { apply_game_theme(event.theme); }
+
+
+// The store and the pools of the world - a static, so it outlives the world (the memory report line)
+static Tracking_allocator& entity_memory()
+{
+    static Tracking_allocator memory{"entities"};
+    return memory;
+}
+
+
+Gameplay_world::Gameplay_world()
+    : store(entity_memory()), bodies(entity_memory()), boxes(entity_memory()), shapes(entity_memory()),
+      transforms(entity_memory()), bullets(store, entity_memory()), pickups(store, entity_memory()),
+      debris(store, entity_memory()), popups(store, entity_memory())
+{
+    store.attach(bodies);
+    store.attach(boxes);
+    store.attach(shapes);
+    store.attach(transforms);
+    store.attach(grid);
+
+    store.reserve(RESERVED_ENTITIES);
+    bodies.reserve(RESERVED_ENTITIES);
+    boxes.reserve(RESERVED_ENTITIES);
+    shapes.reserve(RESERVED_ENTITIES);
+    transforms.reserve(RESERVED_ENTITIES);
+    contacts.reserve(RESERVED_ENTITIES);
+    pending_damage.reserve(RESERVED_ENTITIES);
+
+    sparks.set_layer(2);
+
+    Event_bus& bus = Event_bus::Instance();
+
+    bus.subscribe<Edge_hit_event, Gameplay_world, &Gameplay_world::on_edge_hit>(this);
+    bus.subscribe<Edge_hit_event>(&apply_hit_theme);
+    bus.reserve<Edge_hit_event>(16);
+}
+
+
+Gameplay_world::~Gameplay_world()
+{
+    Event_bus& bus = Event_bus::Instance();
+
+    bus.unsubscribe_all(this);
+    bus.unsubscribe<Edge_hit_event>(&apply_hit_theme);
+}
+
+
+void Gameplay_world::on_edge_hit(const Edge_hit_event& event)
+{
+    sparks.burst(event.x, event.y, SPARK_COUNT, SPARK_SPEED_MIN, SPARK_SPEED_MAX, SPARK_LIFE);
+}
+
+
+void Gameplay_world::clear()
+{
+    store.clear();
+    contacts.clear();
+    sparks.clear();
+    rewind.clear();
+    square = NULL_ENTITY;
+    redraw_all = true;
+    pending_damage.clear();
+    pending_redraw = false;
+}
+
+
+Entity_pool<Transient_component>& Gameplay_world::get_pool(Level_pool kind)
+{
+    switch (kind)
+    {
+        case LEVEL_POOL_BULLET: return bullets;
+        case LEVEL_POOL_PICKUP: return pickups;
+        case LEVEL_POOL_PARTICLE: return debris;
+        default: return popups;
+    }
+}
+
+
+void Gameplay_world::preallocate(int static_entities, const std::uint16_t* capacities)
+{
+    int total = static_entities;
+
+    for (int kind = 0; kind < LEVEL_POOL_COUNT; ++kind)
+    {
+        const int capacity = capacities && capacities[kind] ? capacities[kind] : DEFAULT_POOL_CAPACITY[kind];
+
+        get_pool(static_cast<Level_pool>(kind)).preallocate(capacity);
+        total += capacity;
+    }
+
+    // Every transient has a shape and a transform - the ids and these pools need the room of all
+    store.reserve(total);
+    shapes.reserve(total);
+    transforms.reserve(total);
+
+    // The moving ones of a few ticks - the rest of a longer cycle is a full redraw
+    pending_damage.reserve(static_cast<size_t>(total) * 2);
+}
+
+
+Gameplay_world& get_gameplay_world()
+{
+    static Gameplay_world world;
+    return world;
+}
+
+// =========================================================================================== GAMEPLAY WORLD
+
+
+// =========================================================================================== UPDATE
+
+// Middle of the side of the body, which the edges touch
+static void emit_edge_hit(const Gameplay_world& world, const Character& body, std::uint8_t edges)
+{
+    float x = fx::to_float(body.get_x() + body.get_width() / 2);
+    float y = fx::to_float(body.get_y() + body.get_height() / 2);
+
+    if (edges & EDGE_LEFT) x = fx::to_float(body.get_x());
+    if (edges & EDGE_RIGHT) x = fx::to_float(body.get_x() + body.get_width());
+    if (edges & EDGE_TOP) y = fx::to_float(body.get_y());
+    if (edges & EDGE_BOTTOM) y = fx::to_float(body.get_y() + body.get_height());
+
+    Event_bus::Instance().emit(Edge_hit_event{x, y, edges, world.theme});
+}
+
+
+static Aabb aabb_of(Fixed x, Fixed y, Fixed width, Fixed height) { return {x, y, x + width, y + height}; }
+
+
+// Transforms of the bodies after their step - the previous tick is kept for the render
+static void sync_transforms(Gameplay_world& world)
+{
+    const Character* bodies = world.bodies.data();
+    const Entity* owners = world.bodies.get_entities();
+
+    for (int i = 0; i < world.bodies.size(); ++i)
+    {
+        Transform_component* transform = world.transforms.get(owners[i]);
+
+        if (!transform) continue;
+
+        transform->previous_x = transform->x;
+        transform->previous_y = transform->y;
+        transform->x = bodies[i].get_x();
+        transform->y = bodies[i].get_y();
+    }
+}
+
+
+// Boxes on the path of a body in the tick
+static std::vector<Entity> swept;
+
+
+// Static boxes, which the moves of the bodies passed through - the end overlaps miss them (a fast
+// body, a long tick), query_pairs() has the ones still overlapping
+static void add_swept_contacts(Gameplay_world& world)
+{
+    const Character* bodies = world.bodies.data();
+    const Entity* owners = world.bodies.get_entities();
+
+    for (int i = 0; i < world.bodies.size(); ++i)
+    {
+        const Character& body = bodies[i];
+        const Vec2_fx move = body.get_position() - body.get_previous_position();
+
+        if (move.x == 0 && move.y == 0) continue;
+
+        const Aabb from = aabb_of(body.get_previous_position().x, body.get_previous_position().y, body.get_width(), body.get_height());
+        const Aabb to = aabb_of(body.get_x(), body.get_y(), body.get_width(), body.get_height());
+
+        swept.clear();
+        world.grid.query_swept(from, move.x, move.y, swept);
+
+        for (Entity e : swept)
+        {
+            const Box_component* box = world.boxes.get(e);
+
+            if (!box || to.overlaps(aabb_of(box->x, box->y, box->width, box->height))) continue;
+
+            world.contacts.emplace_back(std::min(owners[i], e), std::max(owners[i], e));
+        }
+    }
+}
+
+
+// Transforms before the rewound tick - the render goes back from them
+static Component_pool<Transform_component> rewind_from;
+
+
+// After a rewind: from where the entities were to the restored tick
+static void interpolate_from(Gameplay_world& world, const Component_pool<Transform_component>& before)
+{
+    Transform_component* transforms = world.transforms.data();
+    const Entity* owners = world.transforms.get_entities();
+
+    for (int i = 0; i < world.transforms.size(); ++i)
+    {
+        const Transform_component* old = before.get(owners[i]);
+
+        if (!old)
+        {
+            transforms[i].snap();
+            continue;
+        }
+
+        transforms[i].previous_x = old->x;
+        transforms[i].previous_y = old->y;
+    }
+}
+
+
+// Transients of the pool by the tick of the physics ticks - moved, the expired ones despawned (back to front, the swap stays behind)
+static void step_transients(Gameplay_world& world, Entity_pool<Transient_component>& pool, int ticks)
+{
+    Transient_component* transients = pool.data();
+    const Entity* owners = pool.get_entities();
+
+    for (int i = pool.size(); i-- > 0;)
+    {
+        Transient_component& t = transients[i];
+
+        if (t.ticks_left != 0)
+        {
+            if (t.ticks_left <= static_cast<std::uint32_t>(ticks))
+            {
+                pool.despawn(owners[i]);
+                continue;
+            }
+
+            t.ticks_left -= ticks;
+        }
+
+        Transform_component* transform = world.transforms.get(owners[i]);
+
+        if (!transform) continue;
+
+        transform->previous_x = transform->x;
+        transform->previous_y = transform->y;
+        transform->x += t.vx * ticks;
+        transform->y += t.vy * ticks;
+    }
+}
+
+
+Entity spawn_transient(Gameplay_world& world, Level_pool kind, const Box_component& box, Fixed vx, Fixed vy,
+                       std::uint32_t ticks, Game_color color, std::uint8_t layer)
+{
+    const Entity e = world.get_pool(kind).spawn({vx, vy, ticks});
+
+    if (e == NULL_ENTITY) return NULL_ENTITY;
+
+    world.shapes.add(e, {color, layer});
+    world.transforms.add(e, {box.x, box.y, box.x, box.y, box.width, box.height});
+
+    return e;
+}
+
+
+// Static box of the level
+static void add_box(Gameplay_world& world, const Box_component& box, Game_color color, std::uint8_t layer)
+{
+    const Entity e = world.store.create();
+
+    world.boxes.add(e, box);
+    world.shapes.add(e, {color, layer});
+    world.transforms.add(e, {box.x, box.y, box.x, box.y, box.width, box.height});
+
+    world.grid.update(e, aabb_of(box.x, box.y, box.width, box.height));
+}
+
+
+// The square at the top left x, y, moving inside the bounds
+static void add_square(Gameplay_world& world, Fixed x, Fixed y, Fixed size, const Aabb& bounds)
+{
+    Character square;
+
+    square.set_bounds(bounds.x0, bounds.y0, bounds.x1, bounds.y1);
+    square.reset(x, y, size, size);
+
+    world.square = world.store.create();
+    world.bodies.add(world.square, square);
+    world.shapes.add(world.square, {COLOR_SQUARE, 1});
+    world.transforms.add(world.square, {x, y, x, y, size, size});
+
+    world.grid.update(world.square, aabb_of(x, y, size, size));
+}
+
+
+// Box of the binary level - the table is read in place
+static void add_level_box(Gameplay_world& world, const Level_box& box)
+{
+    const Game_color color = box.color < GAME_COLOR_COUNT ? static_cast<Game_color>(box.color) : COLOR_ACCENT;
+
+    add_box(world, {box.x, box.y, box.width, box.height}, color, box.layer);
+}
+
+
+// The square of the binary level, after its boxes
+static void add_level_square(Gameplay_world& world, const Level_view& level)
+{
+    const Level_header& header = level.get_header();
+
+    add_square(world, header.spawn_x, header.spawn_y, header.square_size,
+               {header.bounds_left, header.bounds_top, header.bounds_right, header.bounds_bottom});
+}
+
+
+// Borders of the logical screen and the square in the middle
+static void build_default(Gameplay_world& world)
+{
+    const auto border = [&world](int x, int y, int w, int h)
+    {
+        add_box(world, {fx::from_int(x), fx::from_int(y), fx::from_int(w), fx::from_int(h)}, COLOR_ACCENT, 0);
+    };
+
+    border(0, 0, LEVEL_W, BORDER);
+    border(0, LEVEL_H - BORDER, LEVEL_W, BORDER);
+    border(0, BORDER, BORDER, LEVEL_H - 2 * BORDER);
+    border(LEVEL_W - BORDER, BORDER, BORDER, LEVEL_H - 2 * BORDER);
+
+    add_square(world, fx::from_int((LEVEL_W - SQUARE_SIZE) / 2), fx::from_int((LEVEL_H - SQUARE_SIZE) / 2), fx::from_int(SQUARE_SIZE),
+               {fx::from_int(BORDER), fx::from_int(BORDER), fx::from_int(LEVEL_W - BORDER), fx::from_int(LEVEL_H - BORDER)});
+}
+
+
+// Level of the running build - open only while the entities are created
+static Level_file build_level;
+
+// Next box of the running build
+static std::uint32_t build_next_box = 0;
+
+
+void level_gameplay_build_begin()
+{
+    Gameplay_world& world = get_gameplay_world();
+
+    world.clear();
+
+    build_next_box = 0;
+
+    // All of the memory first - the steps only fill it
+    if (build_level.open(LEVEL_PATH))
+    {
+        const Level_view& view = build_level.get_view();
+
+        world.preallocate(static_cast<int>(view.get_box_count()) + 1, view.get_header().pool_capacity);
+    }
+    else world.preallocate(5, nullptr);
+}
+
+
+bool level_gameplay_build_step(double budget_seconds)
+{
+    Gameplay_world& world = get_gameplay_world();
+
+    if (build_level.is_open())
+    {
+        const Level_view& view = build_level.get_view();
+        const Level_box* boxes = view.get_boxes();
+        const std::uint32_t count = view.get_box_count();
+
+        const Uint64 start = Engine_clock::now();
+
+        // The clock is read per chunk - a box is far cheaper than the read
+        while (build_next_box < count)
+        {
+            const std::uint32_t chunk_end = std::min(build_next_box + BUILD_CHUNK, count);
+
+            for (; build_next_box < chunk_end; ++build_next_box) add_level_box(world, boxes[build_next_box]);
+
+            if (build_next_box < count && Engine_clock::to_seconds(Engine_clock::now() - start) >= budget_seconds) return false;
+        }
+
+        add_level_square(world, view);
+
+        build_level.close();
+    }
+    else build_default(world);
+
+    level_gameplay_save(world, world.start_snapshot);
+
+    return true;
+}
+
+
+float level_gameplay_build_progress()
+{
+    if (!build_level.is_open()) return 1.0f;
+
+    const std::uint32_t count = build_level.get_view().get_box_count();
+
+    return count > 0 ? static_cast<float>(build_next_box) / static_cast<float>(count) : 1.0f;
+}
+
+
+void level_gameplay_build()
+{
+    level_gameplay_build_begin();
+
+    while (!level_gameplay_build_step(1.0)) {}
+}
+
+
+void level_gameplay_retry()
+{
+    Gameplay_world& world = get_gameplay_world();
+
+    if (!level_gameplay_restore(world, world.start_snapshot)) return;
+
+    world.rewind.clear();
+    world.sparks.clear();
+
+    // The square jumps back to the start, not flies there
+    Transform_component* transforms = world.transforms.data();
+
+    for (int i = 0; i < world.transforms.size(); ++i) transforms[i].snap();
+}
+
+
+void level_gameplay_update()
+{
+    Gameplay_world& world = get_gameplay_world();
+
+    const Input_snapshot& input = Input::Instance().get_snapshot();
+
+    if (input.is_pressed(SELECT_BTN))
+    {
+        level_gameplay_retry();
+        return;
+    }
+
+    // Rewinding replaces the step - the sparks still fly
+    if (input.is_held(B_BTN))
+    {
+        rewind_from = world.transforms;
+
+        if (world.rewind.rewind(world)) interpolate_from(world, rewind_from);
+        else
+        {
+            // Nothing more to rewind - the square rests
+            Transform_component* transforms = world.transforms.data();
+            for (int i = 0; i < world.transforms.size(); ++i) transforms[i].snap();
+        }
+
+        world.sparks.update(static_cast<float>(Engine_clock::time.tick_dt));
+        return;
+    }
+
+    // Physics ticks of the simulation tick - more than one at a lowered sim_hz
+    const int ticks = Character::get_step_ticks(Engine_clock::time.tick_dt);
+
+    // Body system - only the square takes the input for now
+    Character* bodies = world.bodies.data();
+    const Entity* owners = world.bodies.get_entities();
+
+    for (int i = 0; i < world.bodies.size(); ++i)
+    {
+        if (owners[i] == world.square)
+        {
+            bodies[i].step(input, ticks);
+
+            if (const std::uint8_t edges = bodies[i].get_new_edges())
+            {
+                ++world.theme;
+                emit_edge_hit(world, bodies[i], edges);
+            }
+        }
+        else bodies[i].step(0, 0, ticks);
+    }
+
+    sync_transforms(world);
+
+    for (int kind = 0; kind < LEVEL_POOL_COUNT; ++kind) step_transients(world, world.get_pool(static_cast<Level_pool>(kind)), ticks);
+
+    world.sparks.update(static_cast<float>(Engine_clock::time.tick_dt));
+
+    // Broadphase - a body, which stayed in its cells, only updates its box
+    for (int i = 0; i < world.bodies.size(); ++i)
+        world.grid.update(owners[i], aabb_of(bodies[i].get_x(), bodies[i].get_y(), bodies[i].get_width(), bodies[i].get_height()));
+
+    world.contacts.clear();
+    world.grid.query_pairs(world.contacts);
+
+    add_swept_contacts(world);
+
+    world.rewind.push(world);
+}
+
+// =========================================================================================== UPDATE
@@ -0,0 +1,239 @@
+// update.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "../../../engine/ecs/entity_store.h"
+#include "../../../engine/ecs/spatial_hash.h"
+#include "../../../engine/particles/particle_system.h"
+#include "snapshot.h"
+#include "../../character/character.h"
+#include "../../game_states/game_states.h"
+#include "../../level/level_format.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== COMPONENTS
+
+// Static rectangle of the level - the borders (later the walls and the pickups)
+struct Box_component
+{
+    Fixed x = 0;
+    Fixed y = 0;
+    Fixed width = 0;
+    Fixed height = 0;
+};
+
+
+/**
+ * Rendered rectangle of an entity at the last two ticks.
+ *
+ * The simulation writes it once per tick (sync after the step): the previous one
+ * takes the current, the current takes the new position. The render draws between
+ * the two by the frame's alpha - smooth at any frame rate, with no extra tick.
+ * The static boxes have the previous equal to the current.
+ */
+struct Transform_component
+{
+    Fixed previous_x = 0;
+    Fixed previous_y = 0;
+    Fixed x = 0;
+    Fixed y = 0;
+    Fixed width = 0;
+    Fixed height = 0;
+
+    float get_render_x(float alpha) const { return fx::lerp(previous_x, x, alpha); }
+    float get_render_y(float alpha) const { return fx::lerp(previous_y, y, alpha); }
+
+    // No interpolation from the last position (a teleport, a retry)
+    void snap() { previous_x = x; previous_y = y; }
+};
+
+
+// How an entity is drawn: the palette slot (swapped on the edge hit) and the render layer
+struct Shape_component
+{
+    Game_color color = COLOR_SQUARE;
+    std::uint8_t layer = 0;
+};
+
+// The moving bodies are Character components (character.h)
+
+
+// Short-lived entity (a bullet, a pickup, a debris particle, a popup) - moves by its velocity,
+// despawned when its ticks run out (0 - stays until despawned by the game)
+struct Transient_component
+{
+    Fixed vx = 0;
+    Fixed vy = 0;
+    std::uint32_t ticks_left = 0;
+};
+
+// =========================================================================================== COMPONENTS
+
+
+// =========================================================================================== EVENTS
+
+// New edge hit of the square (Event_bus) - the tick emits it, the sparks and the theme listen
+struct Edge_hit_event
+{
+    // Middle of the hit side in px
+    float x;
+    float y;
+
+    // Character_edge mask of the new hits
+    std::uint8_t edges;
+
+    // Theme of the world after the hit
+    int theme;
+};
+
+// =========================================================================================== EVENTS
+
+
+// =========================================================================================== GAMEPLAY WORLD
+
+
+/**
+ * @brief All of the LEVEL_GAMEPLAY entities and their packed component pools.
+ *
+ * Every entity of the level (the square, the borders, ...) is an id of the store, its
+ * data lives in the pools below - the systems (level_gameplay_update(),
+ * level_gameplay_render()) iterate the pools front to back, no heap object per entity.
+ *
+ * The grid holds the box of every static box and body: the static boxes are inserted
+ * once by the build, the bodies are moved in it after their step. The overlapping
+ * pairs of the tick are in contacts, with the static boxes the move of a body passed
+ * through (the swept test) - a long tick doesn't skip an obstacle.
+ *
+ * The transient entities spawn and despawn all the time - every kind has its Entity_pool,
+ * preallocated by the build from the capacity hints of the level: a spawn or a despawn in
+ * the ticks is O(1) and never allocates. They are drawn like the boxes, not in the grid.
+ *
+ * Built by level_gameplay_build() on the state entry, one world per process.
+ */
+struct Gameplay_world
+{
+    Entity_store store;
+
+    Component_pool<Character> bodies;
+    Component_pool<Box_component> boxes;
+    Component_pool<Shape_component> shapes;
+
+    // Every rendered entity (with a shape) has a transform
+    Component_pool<Transform_component> transforms;
+
+    // Transient entities by the kind (Level_pool)
+    Entity_pool<Transient_component> bullets{store};
+    Entity_pool<Transient_component> pickups{store};
+    Entity_pool<Transient_component> debris{store};
+    Entity_pool<Transient_component> popups{store};
+
+    // Broadphase of the boxes and the bodies (64 px cells)
+    Spatial_hash grid;
+
+    // Overlapping and swept-through pairs found by the last tick
+    std::vector<std::pair<Entity, Entity>> contacts;
+
+    // Bursts of the edge hits - visual only, not entities
+    Particle_system sparks;
+
+    // The level as built - the retry restores it instead of the rebuild
+    std::vector<std::uint8_t> start_snapshot;
+
+    // The last ticks for the rewind
+    Gameplay_rewind rewind;
+
+    // The player's square
+    Entity square = NULL_ENTITY;
+
+    // Current theme, the next one on every edge hit
+    int theme = 0;
+
+    // The entities were replaced (the build, a restore) - the next damage report redraws the whole level
+    bool redraw_all = true;
+
+    // Damage of the ticks run on the update worker (the pipelined cycle), handed to the Frame at
+    // the sync point (level_gameplay_publish()); a redraw, when the reserved room runs out
+    std::vector<SDL_Rect> pending_damage;
+    bool pending_redraw = false;
+
+    Gameplay_world();
+
+    // Stops listening to the events
+    ~Gameplay_world();
+
+    // Destroys every entity
+    void clear();
+
+    // Pool of the transient kind
+    Entity_pool<Transient_component>& get_pool(Level_pool kind);
+
+    /**
+     * @brief Room for the level - the only allocations of the level, done by the build.
+     *
+     * @param static_entities Boxes and bodies of the level.
+     * @param capacities      Transient pool capacities (Level_pool order), 0 - the default one.
+     */
+    void preallocate(int static_entities, const std::uint16_t* capacities);
+
+    // Bursts the sparks from the hit side
+    void on_edge_hit(const Edge_hit_event& event);
+};
+
+// The level world
+Gameplay_world& get_gameplay_world();
+
+// =========================================================================================== GAMEPLAY WORLD
+
+
+// =========================================================================================== UPDATE
+
+// Fills the world from the binary level (levels/level_1.lvl) or the built-in layout
+// (the borders of the logical screen and the square in the middle), then saves it as
+// the retry snapshot - the steps below at once
+void level_gameplay_build();
+
+/**
+ * @brief Time-sliced build (the LEVEL_GAMEPLAY enter_step): begin, then the steps until one returns true.
+ *
+ * The begin clears the world, opens the level and preallocates it; every step creates the
+ * boxes until its budget is spent, the last one adds the square and saves the retry snapshot.
+ * The world isn't complete in between - no tick or save may read it.
+ */
+void level_gameplay_build_begin();
+bool level_gameplay_build_step(double budget_seconds);
+
+// Part of the running build done [0, 1]
+float level_gameplay_build_progress();
+
+// Back to the level start from the retry snapshot, no rebuild
+void level_gameplay_retry();
+
+/**
+ * @brief One fixed tick of the level (the LEVEL_GAMEPLAY state_update).
+ *
+ * Steps every body by the tick's input snapshot, a new edge hit of the square advances the theme
+ * and emits an Edge_hit_event (the palette and the sparks follow it at the frame's dispatch),
+ * then moves the bodies in the grid and collects the overlapping pairs.
+ *
+ * SELECT retries the level, a held B rewinds it tick by tick instead of the step.
+ */
+void level_gameplay_update();
+
+/**
+ * @brief New transient entity of the kind - drawn with the color and the layer, moving by vx, vy per tick.
+ *
+ * @param ticks Lifetime in ticks, 0 - until despawned.
+ * @return NULL_ENTITY if the pool of the kind is full (no allocation either way).
+ */
+Entity spawn_transient(Gameplay_world& world, Level_pool kind, const Box_component& box, Fixed vx, Fixed vy,
+                       std::uint32_t ticks, Game_color color, std::uint8_t layer);
+
+// =========================================================================================== UPDATE
@@ -0,0 +1,41 @@
+// Generated by miyoo_string_cooker from the key list - don't edit, regenerate
+
+#pragma once
+
+#include <cstdint>
+
+enum String_id : std::uint32_t
+{
+    STR_MENU_TITLE,
+    STR_MENU_START,
+    STR_MENU_LANGUAGE,
+    STR_MENU_EXIT,
+    STR_LANG_NAME,
+    STR_GAMEPLAY_RETRY,
+    STR_GAMEPLAY_REWIND,
+    STR_SMALL_MENU_TITLE,
+    STR_SMALL_MENU_RESUME,
+    STR_SMALL_MENU_QUIT,
+
+    STR_COUNT
+};
+
+
+// Id of the key by its FNV-1a hash ("MENU_TITLE"_key.value) - constexpr, STR_COUNT if unknown
+constexpr String_id string_id_of(std::uint32_t key_hash)
+{
+    switch (key_hash)
+    {
+        case 0x7E5D4B57u: return STR_MENU_TITLE;
+        case 0xD8A14295u: return STR_MENU_START;
+        case 0xF4E0C261u: return STR_MENU_LANGUAGE;
+        case 0xE803347Fu: return STR_MENU_EXIT;
+        case 0xE1FD645Du: return STR_LANG_NAME;
+        case 0xB738DF24u: return STR_GAMEPLAY_RETRY;
+        case 0x758B7E25u: return STR_GAMEPLAY_REWIND;
+        case 0xB49CCAC3u: return STR_SMALL_MENU_TITLE;
+        case 0x793037C8u: return STR_SMALL_MENU_RESUME;
+        case 0xC0F58ABCu: return STR_SMALL_MENU_QUIT;
+        default: return STR_COUNT;
+    }
+}
@@ -0,0 +1,54 @@
+// level_file.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "level_file.h"
+#include "../../engine/asset/asset_pack.h"
+#include "../../engine/platform/backend.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== LEVEL FILE
+
+bool Level_file::open(const std::string& path)
+{
+    close();
+
+    // The pack first - the view is over the mapped pages
+    const Asset_pack& pack = Asset_pack::Instance();
+
+    if (const Pack_entry* entry = pack.is_mounted() ? pack.find(path) : nullptr)
+    {
+        if (view.open(pack.get_data(*entry), entry->size))
+        {
+            mapped = true;
+            return true;
+        }
+
+        SDL_Log("Packed level %s is not a valid level", path.c_str());
+        return false;
+    }
+
+    if (!Platform::Files::read_file(path.c_str(), buffer)) return false;
+
+    if (!view.open(buffer.data(), buffer.size()))
+    {
+        SDL_Log("Level %s is not a valid level (version %u expected)", path.c_str(), LEVEL_VERSION);
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+
+void Level_file::close()
+{
+    view = Level_view{};
+    buffer.clear();
+    mapped = false;
+}
+
+// =========================================================================================== LEVEL FILE
@@ -0,0 +1,61 @@
+// level_file.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <string>
+#include <vector>
+
+#include "level_format.h"
+#include "../../engine/platform/platform.h"
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== LEVEL FILE
+
+
+/**
+ * @brief Binary level by its path: the mapped pack entry or the file read once.
+ *
+ * A level packed by the asset cooker (as a raw file) is viewed right inside the
+ * mapped pack - no read and no copy. An unpacked level is read whole into the buffer
+ * with one Platform::Files call. Either way there is no parse (Level_view).
+ *
+ * Usage:
+ * @code
+ * Level_file file;
+ * if (file.open("levels/level_1.lvl")) build(file.get_view());
+ * @endcode
+ */
+class Level_file
+{
+
+public:
+
+    // false if there is no such level or it isn't valid
+    bool open(const std::string& path);
+
+    void close();
+
+    bool is_open() const { return view.is_open(); }
+
+    // Valid while the file is open (and the pack is mounted)
+    const Level_view& get_view() const { return view; }
+
+    // The level is used from the mapped pack
+    bool is_mapped() const { return mapped; }
+
+
+private:
+
+    // Data of an unpacked level
+    std::vector<Uint8> buffer;
+
+    Level_view view;
+
+    bool mapped = false;
+};
+
+// =========================================================================================== LEVEL FILE
@@ -0,0 +1,229 @@
+// level_format.cpp
+
+
+// =========================================================================================== IMPORT
+
+#include "level_format.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== LEVEL VIEW
+
+bool Level_view::open(const void* data, size_t size)
+{
+    header = nullptr;
+    boxes = nullptr;
+    name = nullptr;
+
+    // The tables are read in place - the data must keep their alignment
+    if (!data || size < sizeof(Level_header) || reinterpret_cast<std::uintptr_t>(data) % alignof(Level_header) != 0)
+        return false;
+
+    const auto* bytes = static_cast<const std::uint8_t*>(data);
+    const auto* h = reinterpret_cast<const Level_header*>(bytes);
+
+    if (h->magic != LEVEL_MAGIC || h->version != LEVEL_VERSION || h->size > size) return false;
+
+    // Every table inside the file, the multiplication can't overflow in 64 bits
+    const std::uint64_t box_end = static_cast<std::uint64_t>(h->box_offset) + static_cast<std::uint64_t>(h->box_count) * sizeof(Level_box);
+    const std::uint64_t name_end = static_cast<std::uint64_t>(h->name_offset) + h->name_length + 1;
+
+    if (box_end > h->size || name_end > h->size || h->box_offset % alignof(Level_box) != 0) return false;
+
+    if (bytes[h->name_offset + h->name_length] != 0) return false;
+
+    header = h;
+    boxes = reinterpret_cast<const Level_box*>(bytes + h->box_offset);
+    name = reinterpret_cast<const char*>(bytes + h->name_offset);
+
+    return true;
+}
+
+// =========================================================================================== LEVEL VIEW
+
+
+// =========================================================================================== LEVEL COOKING
+
+namespace
+{
+    std::int32_t to_fixed(double px) { return static_cast<std::int32_t>(std::lround(px * 65536.0)); }
+
+
+    // Palette slot by the name - the Game_color order
+    bool parse_color(const std::string& text, std::uint8_t& color)
+    {
+        static const char* const names[] = {"background", "square", "accent"};
+
+        for (std::uint8_t i = 0; i < 3; ++i)
+            if (text == names[i]) { color = i; return true; }
+
+        return false;
+    }
+
+
+    // Transient pool by the name - the Level_pool order
+    bool parse_pool(const std::string& text, int& pool)
+    {
+        static const char* const names[] = {"bullet", "pickup", "particle", "popup"};
+
+        for (int i = 0; i < LEVEL_POOL_COUNT; ++i)
+            if (text == names[i]) { pool = i; return true; }
+
+        return false;
+    }
+
+
+    template <typename T>
+    void append(std::vector<std::uint8_t>& out, const T& value)
+    {
+        const size_t at = out.size();
+        out.resize(at + sizeof(T));
+        std::memcpy(out.data() + at, &value, sizeof(T));
+    }
+}
+
+
+bool level_cook(const std::string& source, std::vector<std::uint8_t>& out, std::string& error)
+{
+    Level_header header = {};
+
+    header.magic = LEVEL_MAGIC;
+    header.version = LEVEL_VERSION;
+    header.width = to_fixed(640);
+    header.height = to_fixed(480);
+    header.spawn_x = to_fixed(300);
+    header.spawn_y = to_fixed(220);
+    header.square_size = to_fixed(40);
+
+    bool has_bounds = false;
+
+    std::string level_name;
+    std::vector<Level_box> boxes;
+
+    std::istringstream lines(source);
+    std::string line;
+    int line_number = 0;
+
+    while (std::getline(lines, line))
+    {
+        ++line_number;
+
+        const size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+
+        std::istringstream words(line);
+        std::string directive;
+
+        if (!(words >> directive)) continue;
+
+        bool ok = true;
+
+        if (directive == "name")
+        {
+            std::getline(words >> std::ws, level_name);
+            while (!level_name.empty() && (level_name.back() == ' ' || level_name.back() == '\r')) level_name.pop_back();
+        }
+        else if (directive == "size")
+        {
+            double w = 0, h = 0;
+            ok = static_cast<bool>(words >> w >> h) && w > 0 && h > 0;
+            header.width = to_fixed(w);
+            header.height = to_fixed(h);
+        }
+        else if (directive == "spawn")
+        {
+            double x = 0, y = 0;
+            ok = static_cast<bool>(words >> x >> y);
+            header.spawn_x = to_fixed(x);
+            header.spawn_y = to_fixed(y);
+        }
+        else if (directive == "square")
+        {
+            double side = 0;
+            ok = static_cast<bool>(words >> side) && side > 0;
+            header.square_size = to_fixed(side);
+        }
+        else if (directive == "bounds")
+        {
+            double left = 0, top = 0, right = 0, bottom = 0;
+            ok = static_cast<bool>(words >> left >> top >> right >> bottom) && right > left && bottom > top;
+            header.bounds_left = to_fixed(left);
+            header.bounds_top = to_fixed(top);
+            header.bounds_right = to_fixed(right);
+            header.bounds_bottom = to_fixed(bottom);
+            has_bounds = true;
+        }
+        else if (directive == "box")
+        {
+            double x = 0, y = 0, w = 0, h = 0;
+            Level_box box = {};
+
+            ok = static_cast<bool>(words >> x >> y >> w >> h) && w > 0 && h > 0;
+
+            box.x = to_fixed(x);
+            box.y = to_fixed(y);
+            box.width = to_fixed(w);
+            box.height = to_fixed(h);
+            box.color = 2;
+
+            std::string color;
+            int layer = 0;
+
+            if (ok && words >> color) ok = parse_color(color, box.color);
+            if (ok && words >> layer) ok = layer >= 0 && layer < 256;
+
+            box.layer = static_cast<std::uint8_t>(layer);
+            boxes.push_back(box);
+        }
+        else if (directive == "pool")
+        {
+            std::string kind;
+            int pool = 0, capacity = 0;
+
+            ok = static_cast<bool>(words >> kind >> capacity) && parse_pool(kind, pool) && capacity >= 0 && capacity <= 0xFFFF;
+
+            if (ok) header.pool_capacity[pool] = static_cast<std::uint16_t>(capacity);
+        }
+        else ok = false;
+
+        if (!ok)
+        {
+            error = "line " + std::to_string(line_number) + ": can't read '" + directive + "'";
+            return false;
+        }
+    }
+
+    if (!has_bounds)
+    {
+        header.bounds_left = 0;
+        header.bounds_top = 0;
+        header.bounds_right = header.width;
+        header.bounds_bottom = header.height;
+    }
+
+    // Header, boxes, name - the order of the file
+    header.box_count = static_cast<std::uint32_t>(boxes.size());
+    header.box_offset = sizeof(Level_header);
+    header.name_offset = header.box_offset + header.box_count * sizeof(Level_box);
+    header.name_length = static_cast<std::uint32_t>(level_name.size());
+    header.size = (header.name_offset + header.name_length + 1 + 3) & ~3u;
+
+    out.clear();
+    out.reserve(header.size);
+
+    append(out, header);
+    for (const Level_box& box : boxes) append(out, box);
+
+    out.insert(out.end(), level_name.begin(), level_name.end());
+    out.resize(header.size, 0);
+
+    return true;
+}
+
+// =========================================================================================== LEVEL COOKING
@@ -0,0 +1,168 @@
+// level_format.h
+
+#pragma once
+
+// =========================================================================================== IMPORT
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// =========================================================================================== IMPORT
+
+
+// =========================================================================================== LEVEL FORMAT
+
+// File layout (little-endian, every table 4-byte aligned, every offset from the file start):
+//
+// [Level_header]
+// [Level_box] * box_count at box_offset
+// [name bytes] at name_offset, name_length bytes, 0-terminated
+//
+// The structs are read in place - no parse, no pointer fix-up: a level is usable
+// straight from the mapped asset pack (or one read of the file). Every coordinate
+// is Q16.16 fixed point in the logical pixels, like the gameplay simulation (Fixed).
+//
+// Written by miyoo_level_cooker from the editable text source (see level_cook()).
+
+constexpr std::uint32_t LEVEL_MAGIC = 0x4C51534D;     // "MSQL"
+constexpr std::uint32_t LEVEL_VERSION = 2;
+
+
+// Transient entity pools of the gameplay - the index of their capacity hints in the header
+enum Level_pool : std::uint8_t
+{
+    LEVEL_POOL_BULLET,
+    LEVEL_POOL_PICKUP,
+    LEVEL_POOL_PARTICLE,
+    LEVEL_POOL_POPUP,
+
+    LEVEL_POOL_COUNT
+};
+
+
+struct Level_header
+{
+    std::uint32_t magic;
+    std::uint32_t version;
+
+    // Whole file size - a truncated file is caught before any table is read
+    std::uint32_t size;
+
+    // Playfield in Q16.16 px
+    std::int32_t width;
+    std::int32_t height;
+
+    // Square start (top left) and side, Q16.16 px
+    std::int32_t spawn_x;
+    std::int32_t spawn_y;
+    std::int32_t square_size;
+
+    // Area the square moves in (its edge hits), Q16.16 px
+    std::int32_t bounds_left;
+    std::int32_t bounds_top;
+    std::int32_t bounds_right;
+    std::int32_t bounds_bottom;
+
+    std::uint32_t box_count;
+    std::uint32_t box_offset;
+
+    std::uint32_t name_offset;
+    std::uint32_t name_length;
+
+    // Most transient entities of every Level_pool alive at once, 0 - the game default
+    std::uint16_t pool_capacity[LEVEL_POOL_COUNT];
+};
+
+
+// Static rectangle of the level (borders, walls)
+struct Level_box
+{
+    std::int32_t x;
+    std::int32_t y;
+    std::int32_t width;
+    std::int32_t height;
+
+    // Game_color palette slot and the render layer
+    std::uint8_t color;
+    std::uint8_t layer;
+
+    std::uint16_t flags;
+};
+
+static_assert(sizeof(Level_header) == 72, "Level_header layout is the file layout");
+static_assert(sizeof(Level_box) == 20, "Level_box layout is the file layout");
+
+// =========================================================================================== LEVEL FORMAT
+
+
+// =========================================================================================== LEVEL VIEW
+
+
+/**
+ * @brief Read-only view of a binary level in memory - the tables are used where they are.
+ *
+ * open() checks the magic, the version and that every table is inside the data, once;
+ * the accessors are plain pointer arithmetic after that. The memory is not owned -
+ * it is the mapped pack or the Level_file buffer.
+ *
+ * Usage:
+ * @code
+ * Level_view level;
+ * if (level.open(data, size))
+ *     for (std::uint32_t i = 0; i < level.get_box_count(); ++i) add_box(level.get_boxes()[i]);
+ * @endcode
+ */
+class Level_view
+{
+
+public:
+
+    // false if the data isn't a valid level of this version
+    bool open(const void* data, size_t size);
+
+    bool is_open() const { return header != nullptr; }
+
+    const Level_header& get_header() const { return *header; }
+
+    const Level_box* get_boxes() const { return boxes; }
+    std::uint32_t get_box_count() const { return header->box_count; }
+
+    const char* get_name() const { return name; }
+
+
+private:
+
+    const Level_header* header = nullptr;
+    const Level_box* boxes = nullptr;
+    const char* name = nullptr;
+};
+
+// =========================================================================================== LEVEL VIEW
+
+
+// =========================================================================================== LEVEL COOKING
+
+/**
+ * @brief Converts the text level source into the binary level (host side).
+ *
+ * The source is one directive per line, '#' starts a comment, the numbers are pixels
+ * (fractions allowed):
+ *
+ *     name   First steps
+ *     size   640 480                 # playfield
+ *     spawn  300 220                 # square top left
+ *     square 40                      # square side
+ *     bounds 4 4 636 476             # left top right bottom of the square's area (the size by default)
+ *     box    0 0 640 4  accent 0     # x y w h [color [layer]], color: background, square, accent
+ *     pool   bullet 64               # most alive at once: bullet, pickup, particle, popup
+ *
+ * @param source Text of the source.
+ * @param out    Binary level.
+ * @param error  Message with the line number on failure.
+ * @return false on a syntax error.
+ */
+bool level_cook(const std::string& source, std::vector<std::uint8_t>& out, std::string& error);
+
+// =========================================================================================== LEVEL COOKING
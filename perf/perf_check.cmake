@@ -0,0 +1,229 @@
+# perf_check.cmake
+
+# Performance regression check of one benchmark run, the CTest performance tests run it
+# (MIYOO_PERF_TESTS). Runs the benchmark, which writes its JSON report into RESULT,
+# and compares the metrics with the stored baseline of the same benchmark.
+#
+# The reports are flattened into the metric paths: the object members by their names,
+# the array items by their "name" member (and "n", if they have one), otherwise by their
+# index - "states.LEVEL_GAMEPLAY.frame.p99", "results.get_state.1000.median".
+#
+# Only the metrics matched by TOLERANCES are checked, all of them are "lower is better":
+#
+#     COMMAND     "<benchmark>|<argument>|..." - the benchmark and its arguments, without --out
+#     TOLERANCES  "<regex>=<fraction>[:<slack>] ..." - the first match is the tolerance of the
+#                 metric: it fails above baseline * (1 + fraction) + slack (the slack is
+#                 absolute, for the metrics near 0 - the allocations, the short kernels)
+#
+# The baselines belong to the machine, which ran them - none is committed. They are recorded
+# by a run with UPDATE_BASELINE=ON; without it a missing baseline skips the check (the test
+# reports it as skipped: "perf_check: no baseline"), it never passes as if compared.
+#
+# Usage:
+#
+#     cmake -DCOMMAND="./miyoo_core_bench|--repeats|9" -DRESULT=core.json -DBASELINE=baseline/core.json
+#           -DTOLERANCES="\.median$=0.25:5" -P perf_check.cmake
+#
+# (The separators are not ";" - CTest would split the arguments of the test command by it.)
+
+cmake_minimum_required(VERSION 3.20)
+
+foreach (var COMMAND RESULT BASELINE TOLERANCES)
+    if (NOT DEFINED ${var})
+        message(FATAL_ERROR "perf_check: ${var} is not set")
+    endif()
+endforeach()
+
+string(REPLACE "|" ";" COMMAND "${COMMAND}")
+string(REGEX REPLACE "[ ]+" ";" TOLERANCES "${TOLERANCES}")
+
+
+# === RUN ===
+
+if (NOT UPDATE_BASELINE AND NOT EXISTS "${BASELINE}")
+    message(STATUS "perf_check: no baseline ${BASELINE} - skipped, record it with UPDATE_BASELINE=ON")
+    return()
+endif()
+
+get_filename_component(result_dir "${RESULT}" DIRECTORY)
+file(MAKE_DIRECTORY "${result_dir}")
+file(REMOVE "${RESULT}")
+
+execute_process(COMMAND ${COMMAND} --out "${RESULT}" RESULT_VARIABLE run_result)
+
+if (NOT run_result EQUAL 0 OR NOT EXISTS "${RESULT}")
+    message(FATAL_ERROR "perf_check: the benchmark failed (${run_result}): ${COMMAND}")
+endif()
+
+if (UPDATE_BASELINE)
+    get_filename_component(baseline_dir "${BASELINE}" DIRECTORY)
+    file(MAKE_DIRECTORY "${baseline_dir}")
+    configure_file("${RESULT}" "${BASELINE}" COPYONLY)
+
+    message(STATUS "perf_check: baseline recorded - ${BASELINE}")
+    return()
+endif()
+
+# === RUN ===
+
+
+# === FLATTEN ===
+
+# Appends "<path>=<value>" of every number under the path of the JSON value to the list out
+function(flatten_json json path out)
+    string(JSON type TYPE "${json}")
+    string(JSON count LENGTH "${json}")
+
+    set(items ${${out}})
+
+    if (count GREATER 0)
+        math(EXPR last "${count} - 1")
+
+        foreach (i RANGE ${last})
+            if (type STREQUAL "OBJECT")
+                string(JSON key MEMBER "${json}" ${i})
+            else()
+                set(key ${i})
+            endif()
+
+            string(JSON item_type TYPE "${json}" "${key}")
+
+            if (item_type STREQUAL "NUMBER")
+                string(JSON value GET "${json}" "${key}")
+                list(APPEND items "${path}${key}=${value}")
+            elseif (item_type STREQUAL "OBJECT" OR item_type STREQUAL "ARRAY")
+                string(JSON value GET "${json}" "${key}")
+
+                # The array items are identified by their name and size - the order may change
+                if (type STREQUAL "ARRAY" AND item_type STREQUAL "OBJECT")
+                    string(JSON name ERROR_VARIABLE no_name GET "${value}" "name")
+                    string(JSON n ERROR_VARIABLE no_n GET "${value}" "n")
+
+                    if (NOT no_name)
+                        set(key "${name}")
+                        if (NOT no_n)
+                            set(key "${name}.${n}")
+                        endif()
+                    endif()
+                endif()
+
+                flatten_json("${value}" "${path}${key}." items)
+            endif()
+        endforeach()
+    endif()
+
+    set(${out} ${items} PARENT_SCOPE)
+endfunction()
+
+
+# Metric paths in <prefix>_paths, their values in <prefix>_<path>
+function(load_metrics file prefix)
+    file(READ "${file}" json)
+
+    set(items "")
+    flatten_json("${json}" "" items)
+
+    set(paths "")
+
+    foreach (item IN LISTS items)
+        string(FIND "${item}" "=" split REVERSE)
+        string(SUBSTRING "${item}" 0 ${split} key)
+        math(EXPR value_start "${split} + 1")
+        string(SUBSTRING "${item}" ${value_start} -1 value)
+
+        list(APPEND paths "${key}")
+        set(${prefix}_${key} "${value}" PARENT_SCOPE)
+    endforeach()
+
+    set(${prefix}_paths ${paths} PARENT_SCOPE)
+endfunction()
+
+# === FLATTEN ===
+
+
+# === COMPARE ===
+
+load_metrics("${RESULT}" result)
+load_metrics("${BASELINE}" baseline)
+
+set(checked 0)
+set(regressions "")
+
+foreach (path IN LISTS baseline_paths)
+    # The first tolerance, which matches the metric
+    set(tolerance "")
+
+    foreach (entry IN LISTS TOLERANCES)
+        string(FIND "${entry}" "=" split REVERSE)
+        string(SUBSTRING "${entry}" 0 ${split} pattern)
+        math(EXPR rule_start "${split} + 1")
+        string(SUBSTRING "${entry}" ${rule_start} -1 rule)
+
+        if (path MATCHES "${pattern}")
+            set(tolerance "${rule}")
+            break()
+        endif()
+    endforeach()
+
+    if (tolerance STREQUAL "")
+        continue()
+    endif()
+
+    if (NOT DEFINED result_${path})
+        message(WARNING "perf_check: ${path} is not in the result (the baseline is older than the benchmark?)")
+        continue()
+    endif()
+
+    set(slack 0)
+
+    if (tolerance MATCHES "^([^:]+):(.+)$")
+        set(tolerance "${CMAKE_MATCH_1}")
+        set(slack "${CMAKE_MATCH_2}")
+    endif()
+
+    # math() is integer only - the numbers are compared in millionths
+    set(base "${baseline_${path}}")
+    set(value "${result_${path}}")
+
+    foreach (var base value tolerance slack)
+        if (NOT ${var} MATCHES "^-?[0-9]*(\\.[0-9]+)?$")
+            message(FATAL_ERROR "perf_check: ${path}: ${var} '${${var}}' is not a plain decimal")
+        endif()
+
+        string(REGEX MATCH "^-?[0-9]*" whole "${${var}}")
+        string(REGEX MATCH "\\.[0-9]+$" fraction "${${var}}")
+
+        string(SUBSTRING "${fraction}000000" 1 6 micro)
+
+        if (whole STREQUAL "" OR whole STREQUAL "-")
+            set(whole "${whole}0")
+        endif()
+
+        if (whole MATCHES "^-")
+            math(EXPR ${var}_micro "${whole} * 1000000 - ${micro}")
+        else()
+            math(EXPR ${var}_micro "${whole} * 1000000 + ${micro}")
+        endif()
+    endforeach()
+
+    math(EXPR limit_micro "${base_micro} + ${base_micro} / 1000 * ${tolerance_micro} / 1000 + ${slack_micro}")
+
+    math(EXPR checked "${checked} + 1")
+
+    if (value_micro GREATER limit_micro)
+        list(APPEND regressions "${path}: ${value} (baseline ${base}, tolerance ${tolerance}, slack ${slack})")
+    endif()
+endforeach()
+
+if (checked EQUAL 0)
+    message(FATAL_ERROR "perf_check: no metric of ${BASELINE} matches the tolerances")
+endif()
+
+if (regressions)
+    list(JOIN regressions "\n  " text)
+    message(FATAL_ERROR "perf_check: ${COMMAND} regressed:\n  ${text}")
+endif()
+
+message(STATUS "perf_check: ${checked} metrics within the tolerances")
+
+# === COMPARE ===
@@ -0,0 +1,699 @@
+// asset_cooker.cpp
+
+// Host-side asset cooker: converts the source assets into the device-native data
+// of a single pack file, so the device loading is a plain read without a decode.
+//
+// Images (BMP) are scaled to the final size and converted to the device pixel format,
+// audio (WAV) is converted to the output sample rate, channels and 16-bit PCM (or IMA-ADPCM),
+// any other file is packed as is (read through SDL_RWops from the mapped pack).
+// The entries are named by the source path, which the game loads the assets by.
+//
+// Usage:
+//
+// ./miyoo_asset_cooker --out FILE [--rate HZ] [--channels N] [--format F] [--size WxH] [--adpcm] [--lz4] SOURCE ... [--size 0x0] [--pcm] SOURCE ...
+//
+// --size applies to the following images (0x0 - the original size).
+// --variants 2 | 4 adds the half (and the quarter) resolution variants of the following images -
+// the Asset_manager picks one by the output and the memory budget (1 - the full size only, default).
+// Not for the font pages and the sheets with the texel coordinates of their own.
+// --density N - the following images are drawn at the N-th of their size (the art at N times the
+// logical resolution): the game sees the same size with any variant.
+// --tile N - the following images are cut into the tiles of N x N texels (a multiple of 4, 0 - whole),
+// streamed around the camera by Tiled_image: the large scrolling backgrounds, which wouldn't fit the
+// texture memory as one image. No resolution variants of them.
+// --slice L,T,R,B - the nine-slice borders of the following images in logical pixels (0 - 255,
+// 0,0,0,0 - none), read by Sprite_batch::add_nine_slice().
+// --format applies to the following images: argb8888 (default), rgb565 (opaque - backgrounds,
+// tiles), rgba5551 (sprites with the hard edges), rgba4444 (the soft alpha). The 16-bit ones
+// are a half of the memory and match the 16-bit framebuffer. --rgb565 is --format rgb565.
+// --dither / --no-dither - ordered dithering of the 16-bit colors (on by default, off for
+// the pixel art with the exact palette).
+// --premultiply / --straight - premultiplied alpha of the argb8888 images (on by default: the
+// cheaper blend without the dark fringes of the filtered scaling, Image_asset renders it with
+// the premultiplied blend mode; the 16-bit formats are always straight).
+// --adpcm stores the following audio as IMA-ADPCM - a quarter of the memory, for the sound
+// effects (--pcm - back to the 16-bit PCM).
+// --lz4 compresses the following images and audio into LZ4 blocks - fewer bytes to install and
+// to read from the SD card, decompressed in parallel at the load (--no-lz4 - stored as is).
+// An entry, which saves less than a sixteenth, is stored anyway; the raw files never compress.
+
+#include <iostream>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cctype>
+
+
+#include "../libs/engine/asset/asset_pack.h"
+#include "../libs/engine/audio/adpcm.h"
+#include "../libs/engine/blit/blit_kernels.h"
+
+
+// =========================================================================================== COOKER SETTINGS
+
+struct Cook_settings
+{
+    std::string out_path;
+
+    int sample_rate = 44100;
+    int channels = 2;
+
+    Uint32 pixel_format = SDL_PIXELFORMAT_ARGB8888;
+
+    // 4x4 ordered dithering of the channels, which lose bits
+    bool dither = true;
+
+    // ARGB8888 color channels multiplied by the alpha
+    bool premultiply = true;
+
+    // Final image size, 0 - original
+    int width = 0;
+    int height = 0;
+
+    // Smallest resolution variant of the images: 1 - only the full size, 2 - and the half, 4 - and the quarter
+    int variants = 1;
+
+    // Texels of the full size image per logical pixel (2 - the art drawn at the double resolution)
+    int density = 1;
+
+    // Nine-slice insets of the following images (pack_slice_insets(), 0 - none)
+    Uint32 slice = 0;
+
+    // Tile side of the tiled images in texels, 0 - the images are whole
+    int tile = 0;
+
+    // Audio stored as IMA-ADPCM blocks
+    bool adpcm = false;
+
+    // Images and audio compressed into the LZ4 blocks
+    bool lz4 = false;
+};
+
+
+static bool has_extension(const std::string& path, const char* ext)
+{
+    const size_t n = std::strlen(ext);
+
+    if (path.size() < n) return false;
+
+    for (size_t i = 0; i < n; ++i)
+        if (std::tolower(static_cast<unsigned char>(path[path.size() - n + i])) != ext[i]) return false;
+
+    return true;
+}
+
+
+// Image formats by the --format name, 0 - unknown
+static Uint32 parse_pixel_format(const char* name)
+{
+    if (!std::strcmp(name, "argb8888")) return SDL_PIXELFORMAT_ARGB8888;
+    if (!std::strcmp(name, "rgb565")) return SDL_PIXELFORMAT_RGB565;
+    if (!std::strcmp(name, "rgba5551")) return SDL_PIXELFORMAT_RGBA5551;
+    if (!std::strcmp(name, "rgba4444")) return SDL_PIXELFORMAT_RGBA4444;
+
+    return 0;
+}
+
+// =========================================================================================== COOKER SETTINGS
+
+
+// =========================================================================================== COOKING
+
+// 4x4 Bayer matrix - the thresholds of the ordered dithering
+static const int BAYER_4X4[4][4] = {
+    { 0,  8,  2, 10},
+    {12,  4, 14,  6},
+    { 3, 11,  1,  9},
+    {15,  7, 13,  5},
+};
+
+
+// 8-bit channel to the level of the channel with (8 - loss) bits, threshold in [0, 16) or -1 - rounded
+static Uint32 quantize(Uint8 value, int loss, int threshold)
+{
+    const int levels = (1 << (8 - loss)) - 1;
+
+    if (threshold < 0) return static_cast<Uint32>((value * levels + 127) / 255);
+
+    // floor(value * levels / 255 + (threshold + 0.5) / 16) - the mean of a flat area is kept
+    const int level = (value * levels * 32 + (threshold * 2 + 1) * 255) / (255 * 32);
+
+    return static_cast<Uint32>(std::min(level, levels));
+}
+
+
+// ARGB8888 rows into the 16-bit format, dithered or rounded
+static void convert_to_16bit(const SDL_Surface* source, SDL_Surface* cooked, bool dither)
+{
+    const SDL_PixelFormat* f = cooked->format;
+
+    // 1-bit alpha is a hard edge - a stipple is worse than the threshold
+    const bool dither_alpha = dither && f->Amask != 0 && f->Aloss < 7;
+
+    for (int y = 0; y < source->h; ++y)
+    {
+        const Uint32* src = reinterpret_cast<const Uint32*>(static_cast<const Uint8*>(source->pixels) + y * source->pitch);
+        Uint16* dst = reinterpret_cast<Uint16*>(static_cast<Uint8*>(cooked->pixels) + y * cooked->pitch);
+
+        for (int x = 0; x < source->w; ++x)
+        {
+            const Uint32 p = src[x];
+            const int t = dither ? BAYER_4X4[y & 3][x & 3] : -1;
+
+            Uint32 out = quantize(static_cast<Uint8>(p >> 16), f->Rloss, t) << f->Rshift
+                       | quantize(static_cast<Uint8>(p >> 8), f->Gloss, t) << f->Gshift
+                       | quantize(static_cast<Uint8>(p), f->Bloss, t) << f->Bshift;
+
+            if (f->Amask) out |= quantize(static_cast<Uint8>(p >> 24), f->Aloss, dither_alpha ? t : -1) << f->Ashift;
+
+            dst[x] = static_cast<Uint16>(out);
+        }
+    }
+}
+
+
+// Half size ARGB8888 copy - every texel is the 2x2 box of the source (the odd edge repeats),
+// the colors weighted by the alpha: the transparent texels don't darken the edges
+static SDL_Surface* halve_image(const SDL_Surface* source)
+{
+    const int w = (source->w + 1) / 2;
+    const int h = (source->h + 1) / 2;
+
+    SDL_Surface* half = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888);
+
+    if (!half) return nullptr;
+
+    for (int y = 0; y < h; ++y)
+    {
+        const int y0 = y * 2;
+        const int y1 = std::min(y0 + 1, source->h - 1);
+
+        const Uint32* row0 = reinterpret_cast<const Uint32*>(static_cast<const Uint8*>(source->pixels) + y0 * source->pitch);
+        const Uint32* row1 = reinterpret_cast<const Uint32*>(static_cast<const Uint8*>(source->pixels) + y1 * source->pitch);
+        Uint32* dst = reinterpret_cast<Uint32*>(static_cast<Uint8*>(half->pixels) + y * half->pitch);
+
+        for (int x = 0; x < w; ++x)
+        {
+            const int x0 = x * 2;
+            const int x1 = std::min(x0 + 1, source->w - 1);
+
+            const Uint32 box[4] = {row0[x0], row0[x1], row1[x0], row1[x1]};
+
+            Uint32 a = 0, r = 0, g = 0, b = 0;
+
+            for (Uint32 p : box)
+            {
+                const Uint32 pa = p >> 24;
+
+                a += pa;
+                r += ((p >> 16) & 0xFF) * pa;
+                g += ((p >> 8) & 0xFF) * pa;
+                b += (p & 0xFF) * pa;
+            }
+
+            // Fully transparent box - the color doesn't matter, black
+            if (a == 0)
+            {
+                dst[x] = 0;
+                continue;
+            }
+
+            dst[x] = ((a + 2) / 4) << 24 | ((r + a / 2) / a) << 16 | ((g + a / 2) / a) << 8 | ((b + a / 2) / a);
+        }
+    }
+
+    return half;
+}
+
+
+// Entry and blob of the straight ARGB8888 image in the pixel format of the settings with the SDL surface pitch.
+// The premultiplication is done in place - the image isn't usable after
+static bool encode_image(SDL_Surface* image, const Cook_settings& s, Uint32 logical_w, Uint32 logical_h,
+                         Pack_entry& entry, std::vector<unsigned char>& blob)
+{
+    const int w = image->w;
+    const int h = image->h;
+
+    SDL_Surface* cooked = s.pixel_format == SDL_PIXELFORMAT_ARGB8888
+        ? image : SDL_CreateRGBSurfaceWithFormat(0, w, h, SDL_BITSPERPIXEL(s.pixel_format), s.pixel_format);
+
+    if (!cooked) return false;
+
+    // Premultiplied from the full precision rows - the 4-bit alpha would leave too few color levels
+    const bool premultiplied = s.premultiply && cooked == image;
+
+    if (premultiplied)
+    {
+        for (int y = 0; y < h; ++y)
+        {
+            Uint32* row = reinterpret_cast<Uint32*>(static_cast<unsigned char*>(image->pixels) + y * image->pitch);
+            blit_premultiply_argb(row, row, w);
+        }
+    }
+
+    if (cooked != image) convert_to_16bit(image, cooked, s.dither);
+
+    const unsigned char* px = static_cast<const unsigned char*>(cooked->pixels);
+
+    blob.assign(px, px + cooked->pitch * h);
+
+    entry.type = Asset_type::IMAGE;
+    entry.params[0] = static_cast<Uint32>(w);
+    entry.params[1] = static_cast<Uint32>(h);
+    entry.params[2] = s.pixel_format | (premultiplied ? PACK_IMAGE_PREMULTIPLIED : 0);
+    entry.params[3] = static_cast<Uint32>(cooked->pitch);
+    entry.params[4] = logical_w;
+    entry.params[5] = logical_h;
+    entry.params[6] = s.slice;
+
+    if (cooked != image) SDL_FreeSurface(cooked);
+
+    return true;
+}
+
+
+// Tiled image: the tiles of the scaled straight image (<path>#<column>,<row>), then the grid entry (<path>#tiles)
+static bool cook_tiles(const std::string& path, SDL_Surface* image, const Cook_settings& s, Uint32 logical_w, Uint32 logical_h,
+                       std::vector<Pack_entry>& entries, std::vector<std::vector<unsigned char>>& blobs)
+{
+    const int columns = (image->w + s.tile - 1) / s.tile;
+    const int rows = (image->h + s.tile - 1) / s.tile;
+
+    if (pack_tile_name(path, columns - 1, rows - 1).size() >= PACK_NAME_SIZE)
+    {
+        std::cerr << "Source path is too long for the tile names: " << path << "\n";
+        return false;
+    }
+
+    for (int row = 0; row < rows; ++row)
+        for (int column = 0; column < columns; ++column)
+        {
+            SDL_Rect rect = {column * s.tile, row * s.tile, 0, 0};
+            rect.w = std::min(s.tile, image->w - rect.x);
+            rect.h = std::min(s.tile, image->h - rect.y);
+
+            SDL_Surface* tile = SDL_CreateRGBSurfaceWithFormat(0, rect.w, rect.h, 32, SDL_PIXELFORMAT_ARGB8888);
+
+            // The encoding premultiplies the tile copy - the source stays straight for the next tiles
+            bool ok = tile && SDL_BlitSurface(image, &rect, tile, nullptr) == 0;
+
+            Pack_entry entry;
+            entry.name = pack_tile_name(path, column, row);
+
+            std::vector<unsigned char> blob;
+
+            const Uint32 tile_w = static_cast<Uint32>(std::max(1, (rect.w + s.density / 2) / s.density));
+            const Uint32 tile_h = static_cast<Uint32>(std::max(1, (rect.h + s.density / 2) / s.density));
+
+            ok = ok && encode_image(tile, s, tile_w, tile_h, entry, blob);
+
+            if (tile) SDL_FreeSurface(tile);
+
+            if (!ok) return false;
+
+            // The tiles are drawn side by side - no nine-slice
+            entry.params[6] = 0;
+
+            entries.push_back(entry);
+            blobs.push_back(std::move(blob));
+        }
+
+    Pack_entry grid;
+    grid.name = pack_tile_grid_name(path);
+    grid.type = Asset_type::UNKNOWN;
+    grid.params[0] = static_cast<Uint32>(image->w);
+    grid.params[1] = static_cast<Uint32>(image->h);
+    grid.params[2] = static_cast<Uint32>(s.tile);
+    grid.params[3] = static_cast<Uint32>(columns);
+    grid.params[4] = static_cast<Uint32>(rows);
+    grid.params[5] = logical_w;
+    grid.params[6] = logical_h;
+
+    entries.push_back(grid);
+    blobs.emplace_back();
+
+    return true;
+}
+
+
+// Image: the full size entry, then its resolution variants (<path>@2, <path>@4) - the same logical size
+static bool cook_image(const std::string& path, const Cook_settings& s, std::vector<Pack_entry>& entries,
+                       std::vector<std::vector<unsigned char>>& blobs)
+{
+    if (s.tile == 0 && s.variants > 1 && pack_variant_name(path, s.variants).size() >= PACK_NAME_SIZE)
+    {
+        std::cerr << "Source path is too long for the variant names: " << path << "\n";
+        return false;
+    }
+
+    SDL_Surface* source = SDL_LoadBMP(path.c_str());
+
+    if (!source)
+    {
+        std::cerr << "Can't load the image " << path << ": " << SDL_GetError() << "\n";
+        return false;
+    }
+
+    const int w = s.width > 0 ? s.width : source->w;
+    const int h = s.height > 0 ? s.height : source->h;
+
+    // The size the game draws the image at - the full size by the texels per logical pixel
+    const Uint32 logical_w = static_cast<Uint32>(std::max(1, (w + s.density / 2) / s.density));
+    const Uint32 logical_h = static_cast<Uint32>(std::max(1, (h + s.density / 2) / s.density));
+
+    // Scaled at full precision first - the variants are halved and the 16-bit formats are quantized from it
+    std::vector<SDL_Surface*> levels(1, SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888));
+
+    bool ok = levels[0] != nullptr;
+
+    if (ok)
+    {
+        SDL_SetSurfaceBlendMode(source, SDL_BLENDMODE_NONE);
+
+        ok = (w == source->w && h == source->h)
+            ? SDL_BlitSurface(source, nullptr, levels[0], nullptr) == 0
+            : SDL_BlitScaled(source, nullptr, levels[0], nullptr) == 0;
+    }
+
+    if (ok && s.tile > 0)
+    {
+        SDL_SetSurfaceBlendMode(levels[0], SDL_BLENDMODE_NONE);
+
+        ok = cook_tiles(path, levels[0], s, logical_w, logical_h, entries, blobs);
+
+        if (!ok) std::cerr << "Can't cut the image " << path << " into the tiles: " << SDL_GetError() << "\n";
+
+        SDL_FreeSurface(levels[0]);
+        SDL_FreeSurface(source);
+
+        return ok;
+    }
+
+    // Every level from the previous one - all straight, before the encoding premultiplies them
+    for (int divisor = 2; ok && divisor <= s.variants; divisor *= 2)
+    {
+        levels.push_back(halve_image(levels.back()));
+        ok = levels.back() != nullptr;
+    }
+
+    for (size_t i = 0; ok && i < levels.size(); ++i)
+    {
+        Pack_entry entry;
+        entry.name = pack_variant_name(path, 1 << i);
+
+        std::vector<unsigned char> blob;
+
+        ok = encode_image(levels[i], s, logical_w, logical_h, entry, blob);
+
+        if (ok)
+        {
+            entries.push_back(entry);
+            blobs.push_back(std::move(blob));
+        }
+    }
+
+    if (!ok) std::cerr << "Can't convert the image " << path << ": " << SDL_GetError() << "\n";
+
+    for (SDL_Surface* level : levels)
+        if (level) SDL_FreeSurface(level);
+
+    SDL_FreeSurface(source);
+
+    return ok;
+}
+
+
+// Audio: 16-bit PCM at the output rate and channels
+static bool cook_audio(const std::string& path, const Cook_settings& s, Pack_entry& entry, std::vector<unsigned char>& blob)
+{
+    if (s.sample_rate <= 0 || s.channels < 1 || s.channels > 2)
+    {
+        std::cerr << "Invalid audio output settings for " << path << "\n";
+        return false;
+    }
+
+    SDL_AudioSpec spec;
+    Uint8* buffer = nullptr;
+    Uint32 length = 0;
+
+    if (!SDL_LoadWAV(path.c_str(), &spec, &buffer, &length))
+    {
+        std::cerr << "Can't load the audio " << path << ": " << SDL_GetError() << "\n";
+        return false;
+    }
+
+    SDL_AudioCVT cvt;
+
+    int built = SDL_BuildAudioCVT(&cvt, spec.format, spec.channels, spec.freq,
+                                  AUDIO_S16LSB, static_cast<Uint8>(s.channels), s.sample_rate);
+
+    if (built < 0)
+    {
+        std::cerr << "Can't convert the audio " << path << ": " << SDL_GetError() << "\n";
+        SDL_FreeWAV(buffer);
+        return false;
+    }
+
+    blob.resize(static_cast<size_t>(length) * (cvt.len_mult > 0 ? cvt.len_mult : 1));
+    std::memcpy(blob.data(), buffer, length);
+
+    SDL_FreeWAV(buffer);
+
+    cvt.buf = blob.data();
+    cvt.len = static_cast<int>(length);
+
+    if (built > 0 && SDL_ConvertAudio(&cvt) != 0)
+    {
+        std::cerr << "Can't convert the audio " << path << ": " << SDL_GetError() << "\n";
+        return false;
+    }
+
+    blob.resize(built > 0 ? static_cast<size_t>(cvt.len_cvt) : length);
+
+    const Uint32 frames = static_cast<Uint32>(blob.size() / (2 * s.channels));
+
+    entry.type = Asset_type::AUDIO;
+    entry.params[0] = static_cast<Uint32>(s.sample_rate);
+    entry.params[1] = static_cast<Uint32>(s.channels);
+    entry.params[2] = AUDIO_S16LSB;
+    entry.params[3] = frames;
+
+    // The cooker host is little-endian - the S16LSB samples are the native ones
+    if (s.adpcm)
+    {
+        blob = adpcm_encode(reinterpret_cast<const std::int16_t*>(blob.data()), frames, static_cast<std::uint32_t>(s.channels));
+        entry.params[2] = PACK_AUDIO_IMA_ADPCM;
+    }
+
+    return true;
+}
+
+// Any other file: the bytes as is
+static bool pack_raw(const std::string& path, Pack_entry& entry, std::vector<unsigned char>& blob)
+{
+    size_t size = 0;
+    void* data = SDL_LoadFile(path.c_str(), &size);
+
+    if (!data)
+    {
+        std::cerr << "Can't read " << path << ": " << SDL_GetError() << "\n";
+        return false;
+    }
+
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+    blob.assign(bytes, bytes + size);
+    SDL_free(data);
+
+    entry.type = Asset_type::UNKNOWN;
+
+    return true;
+}
+
+
+
+// LZ4 blocks of the image and audio entries from the first one on - the ones, which don't compress, stay stored
+static void compress_entries(std::vector<Pack_entry>& entries, std::vector<std::vector<unsigned char>>& blobs, size_t first)
+{
+    for (size_t i = first; i < entries.size(); ++i)
+    {
+        if (entries[i].type != Asset_type::IMAGE && entries[i].type != Asset_type::AUDIO) continue;
+
+        std::vector<unsigned char> blob;
+
+        if (!pack_compress(blobs[i], blob)) continue;
+
+        entries[i].raw_size = static_cast<Uint32>(blobs[i].size());
+        blobs[i].swap(blob);
+    }
+}
+
+// =========================================================================================== COOKING
+
+
+static void print_usage(const char* exe)
+{
+    std::cerr << "Usage: " << exe << " --out FILE [--rate HZ] [--channels N] [--format argb8888 | rgb565 | rgba5551 | rgba4444]"
+                 " [--dither | --no-dither] [--premultiply | --straight] [--size WxH] [--variants 1 | 2 | 4] [--density N]"
+                 " [--tile N] [--slice L,T,R,B] [--adpcm | --pcm] [--lz4 | --no-lz4] SOURCE ...\n";
+}
+
+
+int main(int argc, char** argv)
+{
+    Cook_settings settings;
+
+    std::vector<Pack_entry> entries;
+    std::vector<std::vector<unsigned char>> blobs;
+
+    if (SDL_Init(0) != 0)
+    {
+        std::cerr << "SDL initialization failed: " << SDL_GetError() << "\n";
+        return -1;
+    }
+
+    bool failed = false;
+
+    for (int i = 1; i < argc && !failed; ++i)
+    {
+        if (!std::strcmp(argv[i], "--out") && i + 1 < argc) settings.out_path = argv[++i];
+        else if (!std::strcmp(argv[i], "--rate") && i + 1 < argc) settings.sample_rate = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--channels") && i + 1 < argc) settings.channels = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--rgb565")) settings.pixel_format = SDL_PIXELFORMAT_RGB565;
+        else if (!std::strcmp(argv[i], "--dither")) settings.dither = true;
+        else if (!std::strcmp(argv[i], "--no-dither")) settings.dither = false;
+        else if (!std::strcmp(argv[i], "--premultiply")) settings.premultiply = true;
+        else if (!std::strcmp(argv[i], "--straight")) settings.premultiply = false;
+        else if (!std::strcmp(argv[i], "--format") && i + 1 < argc)
+        {
+            if (!(settings.pixel_format = parse_pixel_format(argv[++i])))
+            {
+                print_usage(argv[0]);
+                failed = true;
+            }
+        }
+        else if (!std::strcmp(argv[i], "--adpcm")) settings.adpcm = true;
+        else if (!std::strcmp(argv[i], "--pcm")) settings.adpcm = false;
+        else if (!std::strcmp(argv[i], "--lz4")) settings.lz4 = true;
+        else if (!std::strcmp(argv[i], "--no-lz4")) settings.lz4 = false;
+        else if (!std::strcmp(argv[i], "--variants") && i + 1 < argc)
+        {
+            settings.variants = std::atoi(argv[++i]);
+
+            if (settings.variants != 1 && settings.variants != 2 && settings.variants != PACK_MAX_VARIANT)
+            {
+                print_usage(argv[0]);
+                failed = true;
+            }
+        }
+        else if (!std::strcmp(argv[i], "--density") && i + 1 < argc)
+        {
+            settings.density = std::atoi(argv[++i]);
+
+            if (settings.density < 1)
+            {
+                print_usage(argv[0]);
+                failed = true;
+            }
+        }
+        else if (!std::strcmp(argv[i], "--tile") && i + 1 < argc)
+        {
+            settings.tile = std::atoi(argv[++i]);
+
+            if (settings.tile < 0 || settings.tile % 4 != 0)
+            {
+                print_usage(argv[0]);
+                failed = true;
+            }
+        }
+        else if (!std::strcmp(argv[i], "--slice") && i + 1 < argc)
+        {
+            int l = 0, t = 0, r = 0, b = 0;
+
+            if (std::sscanf(argv[++i], "%d,%d,%d,%d", &l, &t, &r, &b) != 4 || std::min({l, t, r, b}) < 0 || std::max({l, t, r, b}) > 255)
+            {
+                print_usage(argv[0]);
+                failed = true;
+            }
+            else settings.slice = pack_slice_insets(l, t, r, b);
+        }
+        else if (!std::strcmp(argv[i], "--size") && i + 1 < argc)
+        {
+            if (std::sscanf(argv[++i], "%dx%d", &settings.width, &settings.height) != 2)
+            {
+                print_usage(argv[0]);
+                failed = true;
+            }
+        }
+        else if (argv[i][0] == '-')
+        {
+            print_usage(argv[0]);
+            failed = true;
+        }
+        else
+        {
+            const std::string path = argv[i];
+
+            if (path.size() >= PACK_NAME_SIZE)
+            {
+                std::cerr << "Source path is too long for the pack index: " << path << "\n";
+                failed = true;
+                break;
+            }
+
+            const size_t first = entries.size();
+
+            // The image entries - the full one and the variants - are added by the cooking
+            if (has_extension(path, ".bmp"))
+            {
+                failed = !cook_image(path, settings, entries, blobs);
+
+                if (!failed && settings.lz4) compress_entries(entries, blobs, first);
+                continue;
+            }
+
+            Pack_entry entry;
+            entry.name = path;
+
+            std::vector<unsigned char> blob;
+
+            if (has_extension(path, ".wav")) failed = !cook_audio(path, settings, entry, blob);
+            else failed = !pack_raw(path, entry, blob);
+
+            if (!failed)
+            {
+                entries.push_back(entry);
+                blobs.push_back(std::move(blob));
+
+                if (settings.lz4) compress_entries(entries, blobs, first);
+            }
+        }
+    }
+
+    if (!failed && settings.out_path.empty())
+    {
+        print_usage(argv[0]);
+        failed = true;
+    }
+
+    if (!failed) failed = !Asset_pack::write_file(settings.out_path, entries, blobs);
+
+    if (!failed)
+    {
+        for (const Pack_entry& e : entries)
+        {
+            std::cout << e.name << " -> " << e.size << " bytes";
+
+            if (e.raw_size) std::cout << " (lz4 of " << e.raw_size << ")";
+
+            std::cout << "\n";
+        }
+    }
+
+    SDL_Quit();
+
+    return failed ? -1 : 0;
+}
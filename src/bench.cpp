@@ -0,0 +1,829 @@
+// bench.cpp
+
+// Headless frame benchmark: runs the real state machine with init_game_states
+// through a scripted state sequence and reports the frame cost per state as JSON.
+//
+// Usage:
+//
+// SDL_VIDEODRIVER=dummy ./miyoo_square_bench [--frames N] [--script NAME:FRAMES,NAME:FRAMES,...] [--replay FILE] [--out FILE]
+//                                            [--check-damage] [--check-pipeline]
+//
+// Without --script every state of game_state_tree except EXIT_PROGRAM runs for N frames (default 600).
+// The frames are reported by the state, which was rendered, so a state that leaves
+// by itself (the START splash) is still measured correctly.
+//
+// --replay runs the full app cycle from START with a recorded input (./miyoo_square --record FILE)
+// until its last tick instead of the script - one tick per cycle, so every build plays the same
+// frames. The update / render split is not measured then, only the whole cycle.
+//
+// --check-damage is the check of the partial redraw instead of the report (a CTest test): the
+// square of LEVEL_GAMEPLAY moves for N frames (120 by default, two per tick - the interpolated
+// positions too) in the dirty-rectangle mode, every frame must present only the damaged regions -
+// the pixels outside of them untouched, the square inside of them - and the screen after it must
+// be the same as a full redraw. Exits with 1 on a mismatch.
+//
+// --check-pipeline is the check of the pipelined update (sdl_app_ctx::pipelined_update, a CTest
+// test): the same N frames of LEVEL_GAMEPLAY run twice from one saved world - the ticks on the
+// main thread with a full render after each, then the update N + 1 on the worker while the render
+// draws the world published at the sync point by its damage. Every pipelined frame must be the
+// screen of the tick before it, and the square must end where it did. Exits with 1 on a mismatch.
+//
+// The report has the startup time too (SDL_app_init, init_game_states and the first frame)
+// and, with the MIYOO_ALLOC_TRACKING build, the heap allocations per frame.
+// The video driver defaults to "dummy", the environment variable overrides it.
+// There is no pacing and no vsync, and every frame is rendered (damage tracking is
+// bypassed), so the numbers are the pure update + render cost.
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+
+#include "../libs/engine/app_logic/app.h"
+#include "../libs/game_logic/game_states/game_states.h"
+#include "../libs/game_logic/game_states_logic/1.1.1_LEVEL_GAMEPLAY/update.h"
+#include "../libs/engine/alloc_tracker/alloc_tracker.h"
+#include "../libs/engine/log/log.h"
+#include "../libs/engine/event_bus/event_bus.h"
+
+
+// =========================================================================================== SCRIPT
+
+// One step of the scripted sequence
+struct Bench_step
+{
+    State_ID id;
+    const char* name;
+    int frames;
+};
+
+
+// Looks up the state definition by its name in the compile-time tree
+static const State_def* find_state_def(const std::string& name)
+{
+    for (const State_def& def : game_state_tree.defs)
+        if (name == def.name) return &def;
+
+    return nullptr;
+}
+
+
+// Parses "NAME:FRAMES,NAME:FRAMES" (FRAMES is optional - the default count is used)
+static bool parse_script(const std::string& script, int default_frames, std::vector<Bench_step>& steps)
+{
+    std::stringstream ss(script);
+    std::string item;
+
+    while (std::getline(ss, item, ','))
+    {
+        std::string name = item;
+        int frames = default_frames;
+
+        size_t colon = item.find(':');
+
+        if (colon != std::string::npos)
+        {
+            name = item.substr(0, colon);
+            frames = std::atoi(item.c_str() + colon + 1);
+        }
+
+        const State_def* def = find_state_def(name);
+
+        if (!def || frames <= 0)
+        {
+            std::cerr << "Invalid bench script step: " << item << "\n";
+            return false;
+        }
+
+        steps.push_back({def->id, def->name, frames});
+    }
+
+    return !steps.empty();
+}
+
+// =========================================================================================== SCRIPT
+
+
+// =========================================================================================== STATISTICS
+
+// Frame time samples of a single state, in microseconds
+struct Bench_samples
+{
+    const char* name;
+
+    std::vector<double> frame;
+    std::vector<double> update;
+    std::vector<double> render;
+
+    // Heap allocations of the frames (MIYOO_ALLOC_TRACKING)
+    std::vector<double> allocs;
+};
+
+
+static double counter_to_us(Uint64 ticks)
+{
+    return static_cast<double>(ticks) * 1e6 / static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+
+// Writes {"min":..,"mean":..,"p99":..,"max":..} of the samples (sorted in place)
+static void write_stats(std::ostream& out, std::vector<double>& samples)
+{
+    if (samples.empty())
+    {
+        out << "{\"min\":0,\"mean\":0,\"p99\":0,\"max\":0}";
+        return;
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    double sum = 0.0;
+    for (double s : samples) sum += s;
+
+    // Nearest-rank percentile
+    size_t p99 = (samples.size() * 99 + 99) / 100 - 1;
+
+    out << "{\"min\":" << samples.front()
+        << ",\"mean\":" << sum / static_cast<double>(samples.size())
+        << ",\"p99\":" << samples[p99]
+        << ",\"max\":" << samples.back() << "}";
+}
+
+// =========================================================================================== STATISTICS
+
+
+// =========================================================================================== BENCH LOOP
+
+// Samples of the rendered state (the names live as long as the states)
+static Bench_samples& find_samples(std::vector<Bench_samples>& results, const State* state)
+{
+    const char* name = state ? state->name.c_str() : "NONE";
+
+    auto it = std::find_if(results.begin(), results.end(), [name](const Bench_samples& s) { return !std::strcmp(s.name, name); });
+
+    if (it == results.end()) it = results.insert(results.end(), Bench_samples{name, {}, {}, {}, {}});
+
+    return *it;
+}
+
+
+static void record_allocs(Bench_samples& samples)
+{
+#ifdef ALLOC_TRACKING
+    // The app cycle closes the frame itself, the scripted frames are closed here
+    samples.allocs.push_back(static_cast<double>(Alloc_tracker::Instance().get_last_frame().allocs));
+#else
+    (void)samples;
+#endif
+}
+
+
+// Same order as SDL_app_cycle, one simulation tick per frame, with the timestamps in between
+static void run_frame(sdl_app_ctx& app, std::vector<Bench_samples>& results)
+{
+    Frame& frame = Frame::Instance();
+
+    SDL_Event event;
+    while (SDL_PollEvent(&event)) SDL_app_event(&app, &event);
+
+    Uint64 t0 = SDL_GetPerformanceCounter();
+
+    app.app_sm.apply_pending_transition();
+    app.app_sm.step_loading(app.state_loading_budget_ms / 1000.0);
+    app.app_sm.state_update();
+    Input::Instance().end_tick();
+
+    Uint64 t1 = SDL_GetPerformanceCounter();
+
+    frame.mark_dirty();
+
+    if (frame.begin(app.renderer, true))
+    {
+        do app.app_sm.state_render(app.renderer, 1.0f);
+        while (frame.next_pass());
+
+        frame.end();
+    }
+
+    Uint64 t2 = SDL_GetPerformanceCounter();
+
+#ifdef ALLOC_TRACKING
+    Alloc_tracker::Instance().end_frame();
+#endif
+
+    const State* state = app.app_sm.get_current_state();
+
+    Bench_samples& samples = find_samples(results, state);
+
+    samples.update.push_back(counter_to_us(t1 - t0));
+    samples.render.push_back(counter_to_us(t2 - t1));
+    samples.frame.push_back(counter_to_us(t2 - t0));
+
+    record_allocs(samples);
+}
+
+
+// Full SDL_app_cycle frames with the recorded input, until the replay ends
+static void run_replay(sdl_app_ctx& app, std::vector<Bench_samples>& results)
+{
+    SDL_Event event;
+
+    while (app.app_state == SDL_APP_CONTINUE)
+    {
+        while (SDL_PollEvent(&event)) SDL_app_event(&app, &event);
+
+        Uint64 t0 = SDL_GetPerformanceCounter();
+
+        const bool running = SDL_app_cycle(&app);
+
+        Uint64 t1 = SDL_GetPerformanceCounter();
+
+        if (!running) break;
+
+        // The overlay on top was the rendered state
+        const State* state = app.app_sm.get_top_overlay();
+
+        if (!state) state = app.app_sm.get_current_state();
+
+        Bench_samples& samples = find_samples(results, state);
+
+        samples.frame.push_back(counter_to_us(t1 - t0));
+
+        record_allocs(samples);
+    }
+}
+
+// =========================================================================================== BENCH LOOP
+
+
+// =========================================================================================== DAMAGE CHECK
+
+// A tick (if any) and a frame of the app order, without the full redraw of run_frame() - false if nothing was presented
+static bool run_tracked_frame(sdl_app_ctx& app, bool tick, std::uint32_t held, float alpha)
+{
+    Frame& frame = Frame::Instance();
+
+    SDL_Event event;
+    while (SDL_PollEvent(&event)) SDL_app_event(&app, &event);
+
+    if (tick)
+    {
+        Input::Instance().set_snapshot({held, 0, 0});
+
+        app.app_sm.apply_pending_transition();
+        app.app_sm.state_update();
+        Input::Instance().end_tick();
+    }
+
+    if (!frame.begin(app.renderer, app.app_sm.needs_continuous_redraw())) return false;
+
+    do app.app_sm.state_render(app.renderer, alpha);
+    while (frame.next_pass());
+
+    return true;
+}
+
+
+static bool rect_contains(const SDL_Rect& r, int x, int y) { return x >= r.x && x < r.x + r.w && y >= r.y && y < r.y + r.h; }
+
+
+// The partial redraw of the moving square - see --check-damage
+static int check_damage(sdl_app_ctx& app, int frames)
+{
+    Frame& frame = Frame::Instance();
+    SDL_Surface* surface = SDL_GetWindowSurface(app.window);
+
+    if (!frame.is_partial_redraw() || !surface)
+    {
+        std::cerr << "damage check: the partial redraw isn't available\n";
+        return 1;
+    }
+
+    app.app_sm.go_to(LEVEL_GAMEPLAY_ID);
+    app.app_sm.finish_loading();
+
+    // The enter effect redraws everything - the check starts after it
+    for (int f = 0; f < 600 && app.app_sm.needs_continuous_redraw(); ++f)
+        if (run_tracked_frame(app, true, 0, 1.0f)) frame.end();
+
+    if (app.app_sm.needs_continuous_redraw())
+    {
+        std::cerr << "damage check: LEVEL_GAMEPLAY doesn't track its damage\n";
+        return 1;
+    }
+
+    const size_t row_bytes = static_cast<size_t>(surface->w) * surface->format->BytesPerPixel;
+    const long screen_area = static_cast<long>(surface->w) * surface->h;
+
+    std::vector<Uint8> before(static_cast<size_t>(surface->pitch) * surface->h);
+    std::vector<Uint8> partial(before.size());
+
+    const Gameplay_world& world = get_gameplay_world();
+
+    int presented = 0;
+    long damaged_area = 0;
+
+    // Square of the last presented frame
+    SDL_Point drawn = {-1, -1};
+
+    for (int f = 0; f < frames; ++f)
+    {
+        SDL_LockSurface(surface);
+        std::memcpy(before.data(), surface->pixels, before.size());
+        SDL_UnlockSurface(surface);
+
+        // At rest (the skipped frames), right, then down - the square starts from the rest
+        // and reaches the borders, the sparks and the theme change are checked too
+        const std::uint32_t held = f < frames / 6 ? 0u : 1u << (f < frames * 7 / 12 ? RIGHT_BTN : DOWN_BTN);
+
+        // Two frames per tick - the second one moves the square without a tick (the interpolation)
+        const float alpha = f % 2 == 0 ? 0.5f : 1.0f;
+
+        const bool shown = run_tracked_frame(app, f % 2 == 0, held, alpha);
+
+        // Where the square is drawn in this frame
+        const Transform_component* square = world.transforms.get(world.square);
+        const SDL_Point at = square ? SDL_Point{static_cast<int>(square->get_render_x(alpha)), static_cast<int>(square->get_render_y(alpha))}
+                                    : drawn;
+
+        if (!shown)
+        {
+            // Skipped - fine only if the square stays where it was drawn
+            if (at.x != drawn.x || at.y != drawn.y)
+            {
+                std::cerr << "damage check: frame " << f << " skipped the moved square\n";
+                return 1;
+            }
+
+            continue;
+        }
+
+        std::vector<SDL_Rect> rects(frame.get_damage_rects(), frame.get_damage_rects() + frame.get_damage_rect_count());
+
+        frame.end();
+
+        ++presented;
+        drawn = at;
+
+        for (const SDL_Rect& r : rects) damaged_area += static_cast<long>(r.w) * r.h;
+
+        // The square is drawn in the damage
+        if (square)
+        {
+            const int x = at.x + fx::to_int(square->width) / 2;
+            const int y = at.y + fx::to_int(square->height) / 2;
+
+            if (std::none_of(rects.begin(), rects.end(), [x, y](const SDL_Rect& r) { return rect_contains(r, x, y); }))
+            {
+                std::cerr << "damage check: frame " << f << " doesn't redraw the square at " << x << ", " << y << "\n";
+                return 1;
+            }
+        }
+
+        SDL_LockSurface(surface);
+        std::memcpy(partial.data(), surface->pixels, partial.size());
+        SDL_UnlockSurface(surface);
+
+        // Nothing outside of the presented regions changed
+        const int bpp = surface->format->BytesPerPixel;
+
+        for (int y = 0; y < surface->h; ++y)
+        {
+            for (int x = 0; x < surface->w; ++x)
+            {
+                const size_t at = static_cast<size_t>(y) * surface->pitch + static_cast<size_t>(x) * bpp;
+
+                if (std::memcmp(&before[at], &partial[at], bpp) == 0) continue;
+
+                if (std::none_of(rects.begin(), rects.end(), [x, y](const SDL_Rect& r) { return rect_contains(r, x, y); }))
+                {
+                    std::cerr << "damage check: frame " << f << " changed the pixel " << x << ", " << y << " outside of the damage\n";
+                    return 1;
+                }
+            }
+        }
+
+        // No trail and no hole - the same image as the full redraw of the frame
+        frame.mark_dirty();
+
+        if (frame.begin(app.renderer, true))
+        {
+            do app.app_sm.state_render(app.renderer, alpha);
+            while (frame.next_pass());
+
+            frame.end();
+        }
+
+        SDL_LockSurface(surface);
+
+        for (int y = 0; y < surface->h; ++y)
+        {
+            const size_t at = static_cast<size_t>(y) * surface->pitch;
+
+            if (std::memcmp(&partial[at], static_cast<const Uint8*>(surface->pixels) + at, row_bytes) != 0)
+            {
+                SDL_UnlockSurface(surface);
+                std::cerr << "damage check: frame " << f << " differs from the full redraw at the row " << y << "\n";
+                return 1;
+            }
+        }
+
+        SDL_UnlockSurface(surface);
+    }
+
+    // The moving square is a small part of the screen
+    if (presented == 0 || damaged_area * 4 > screen_area * presented)
+    {
+        std::cerr << "damage check: " << presented << " frame(s), " << (presented ? damaged_area / presented : 0)
+                  << " px damaged per frame of " << screen_area << "\n";
+        return 1;
+    }
+
+    std::cout << "damage check: " << presented << " frame(s), " << damaged_area / presented << " px of " << screen_area
+              << " redrawn per frame\n";
+
+    return 0;
+}
+
+// =========================================================================================== DAMAGE CHECK
+
+
+// =========================================================================================== PIPELINE CHECK
+
+// FNV-1a of the visible rows of the window surface (the padding of the pitch is left out)
+static Uint64 hash_surface(SDL_Surface* surface)
+{
+    const size_t row_bytes = static_cast<size_t>(surface->w) * surface->format->BytesPerPixel;
+
+    Uint64 h = 14695981039346656037ull;
+
+    SDL_LockSurface(surface);
+
+    for (int y = 0; y < surface->h; ++y)
+    {
+        const Uint8* row = static_cast<const Uint8*>(surface->pixels) + static_cast<size_t>(y) * surface->pitch;
+
+        for (size_t x = 0; x < row_bytes; ++x) h = (h ^ row[x]) * 0x100000001B3ull;
+    }
+
+    SDL_UnlockSurface(surface);
+
+    return h;
+}
+
+
+// The update of the tick N + 1 on the worker against the render of the tick N - see --check-pipeline
+static int check_pipeline(sdl_app_ctx& app, int frames)
+{
+    Frame& frame = Frame::Instance();
+    SDL_Surface* surface = SDL_GetWindowSurface(app.window);
+
+    if (!app.pipeline.is_running() || !frame.is_partial_redraw() || !surface)
+    {
+        std::cerr << "pipeline check: the update worker or the partial redraw isn't available\n";
+        return 1;
+    }
+
+    app.app_sm.go_to(LEVEL_GAMEPLAY_ID);
+    app.app_sm.finish_loading();
+
+    // The enter effect isn't a part of the handoff - the check starts after it
+    for (int f = 0; f < 600 && app.app_sm.needs_continuous_redraw(); ++f)
+        if (run_tracked_frame(app, true, 0, 1.0f)) frame.end();
+
+    if (!app.app_sm.is_pipelined())
+    {
+        std::cerr << "pipeline check: LEVEL_GAMEPLAY doesn't opt in the pipelined update\n";
+        return 1;
+    }
+
+    Gameplay_world& world = get_gameplay_world();
+
+    // Both passes start from the same world, the sparks keep their random seed
+    std::vector<std::uint8_t> start;
+    level_gameplay_save(world, start);
+
+    const Particle_system start_sparks = world.sparks;
+
+    // Same input as --check-damage: at rest, right, then down - the borders, the sparks and the theme change
+    auto held_at = [frames](int f) { return f < frames / 6 ? 0u : 1u << (f < frames * 7 / 12 ? RIGHT_BTN : DOWN_BTN); };
+
+    auto full_render = [&app, &frame]()
+    {
+        frame.mark_dirty();
+
+        if (frame.begin(app.renderer, true))
+        {
+            do app.app_sm.state_render(app.renderer, 1.0f);
+            while (frame.next_pass());
+
+            frame.end();
+        }
+    };
+
+    // Reference - the tick and then its render on the main thread, the screen of every tick
+    std::vector<Uint64> reference;
+    reference.reserve(static_cast<size_t>(frames) + 1);
+
+    full_render();
+    reference.push_back(hash_surface(surface));
+
+    for (int f = 0; f < frames; ++f)
+    {
+        Input::Instance().set_snapshot({held_at(f), 0, 0});
+
+        app.app_sm.state_update();
+        Input::Instance().end_tick();
+        Event_bus::Instance().dispatch();
+
+        full_render();
+        reference.push_back(hash_surface(surface));
+    }
+
+    const Transform_component reference_square = *world.transforms.get(world.square);
+
+    if (!level_gameplay_restore(world, start))
+    {
+        std::cerr << "pipeline check: the start of the level isn't restored\n";
+        return 1;
+    }
+
+    world.sparks = start_sparks;
+
+    // Pipelined - the SDL_app_cycle order: the publish, the tick on the worker, the render
+    // of the published world by its damage, the sync point, the events of the tick
+    for (int f = 0; f < frames; ++f)
+    {
+        if (!app.app_sm.is_pipelined())
+        {
+            std::cerr << "pipeline check: frame " << f << " left the pipelined cycle\n";
+            return 1;
+        }
+
+        Input::Instance().set_snapshot({held_at(f), 0, 0});
+
+        app.app_sm.publish_render_state();
+
+        app.pipeline.kick([&app]()
+        {
+            app.app_sm.state_update();
+            Input::Instance().end_tick();
+        });
+
+        if (frame.begin(app.renderer, app.app_sm.needs_continuous_redraw()))
+        {
+            do app.app_sm.state_render(app.renderer, 1.0f);
+            while (frame.next_pass());
+
+            frame.end();
+        }
+
+        app.pipeline.wait();
+        Event_bus::Instance().dispatch();
+
+        // The render of the cycle is the screen of the tick before it
+        if (hash_surface(surface) != reference[static_cast<size_t>(f)])
+        {
+            std::cerr << "pipeline check: frame " << f << " differs from the render of the tick " << f << " on the main thread\n";
+            return 1;
+        }
+    }
+
+    const Transform_component& square = *world.transforms.get(world.square);
+
+    if (square.x != reference_square.x || square.y != reference_square.y)
+    {
+        std::cerr << "pipeline check: the square of the worker ended at " << fx::to_float(square.x) << ", "
+                  << fx::to_float(square.y) << " instead of " << fx::to_float(reference_square.x) << ", "
+                  << fx::to_float(reference_square.y) << "\n";
+        return 1;
+    }
+
+    std::cout << "pipeline check: " << frames << " frame(s) rendered one tick behind the worker\n";
+
+    return 0;
+}
+
+// =========================================================================================== PIPELINE CHECK
+
+
+int main(int argc, char** argv)
+{
+    int default_frames = 600;
+    std::string script;
+    std::string replay_path;
+    std::string out_path;
+    bool damage_check = false;
+    bool pipeline_check = false;
+    bool frames_set = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!std::strcmp(argv[i], "--frames") && i + 1 < argc)
+        {
+            default_frames = std::atoi(argv[++i]);
+            frames_set = true;
+        }
+        else if (!std::strcmp(argv[i], "--check-damage")) damage_check = true;
+        else if (!std::strcmp(argv[i], "--check-pipeline")) pipeline_check = true;
+        else if (!std::strcmp(argv[i], "--script") && i + 1 < argc) script = argv[++i];
+        else if (!std::strcmp(argv[i], "--replay") && i + 1 < argc) replay_path = argv[++i];
+        else if (!std::strcmp(argv[i], "--out") && i + 1 < argc) out_path = argv[++i];
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--frames N] [--script NAME:FRAMES,...] [--replay FILE] [--out FILE] [--check-damage] [--check-pipeline]\n";
+            return -1;
+        }
+    }
+
+    if (default_frames <= 0) default_frames = 600;
+
+    if ((damage_check || pipeline_check) && !frames_set) default_frames = 120;
+
+
+    // Script steps
+    std::vector<Bench_step> steps;
+
+    if (!script.empty())
+    {
+        if (!parse_script(script, default_frames, steps)) return -1;
+    }
+    else
+    {
+        for (const State_def& def : game_state_tree.defs)
+            if (def.id != EXIT_PROGRAM_ID) steps.push_back({def.id, def.name, default_frames});
+    }
+
+
+    // Headless by default - the hint has the lower priority than the environment variable
+    SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+
+    sdl_app_ctx app;
+
+    app.target_fps = 0.0;
+    app.request_vsync = false;
+
+    // The native backend builds measure the same headless renderer
+    app.use_framebuffer = false;
+    app.use_evdev_input = false;
+
+    // The SDL default driver every run - no probe, no cache file
+    app.renderer_probe_path = nullptr;
+
+    // The level starts the same every run - no save is loaded or written
+    app.enable_saves = false;
+
+    // Fixed clocks - the governor would move the numbers between the runs
+    app.enable_governor = false;
+
+    // Fixed work - the watchdog would drop the particles and the frames of a slow build
+    app.enable_quality_watchdog = false;
+
+    // Fixed fill - a reduced target would draw fewer pixels on a slow build
+    app.enable_dynamic_resolution = false;
+
+    // Only the bench report on the output
+    app.frame_report = false;
+    app.render_report = false;
+    app.frame_arena_report = false;
+    app.memory_report = false;
+
+    // The state callbacks log the transitions - only the warnings and the errors
+    Log::Instance().set_level(Log_level::WARNING);
+
+    if (!replay_path.empty())
+    {
+        app.input_replay_path = replay_path.c_str();
+        app.replay_lockstep = true;
+        app.replay_quit_at_end = true;
+    }
+
+    // The software renderer over the window surface, the window of the level size - no scaling
+    const bool surface_check = damage_check || pipeline_check;
+
+    if (surface_check) app.partial_redraw = true;
+
+    // The update worker is started by the init
+    if (pipeline_check) app.pipelined_update = true;
+
+    const Uint64 startup_start = SDL_GetPerformanceCounter();
+
+    if (!SDL_app_init(&app, surface_check ? Platform::LOGICAL_W : 800, surface_check ? Platform::LOGICAL_H : 600, "Miyoo Square Bench"))
+    {
+        std::cerr << "Failed to initialize SDL application." << std::endl;
+        return -1;
+    }
+
+    if (!replay_path.empty() && !app.input_recording.is_replaying())
+    {
+        std::cerr << "Can't replay the input recording: " << replay_path << "\n";
+        SDL_app_shutdown(&app);
+        return -1;
+    }
+
+    init_game_states(app.app_sm);
+
+    // The steps jump between any states - not the game flow
+    if (replay_path.empty()) app.app_sm.clear_transitions();
+
+    if (surface_check)
+    {
+        const int result = damage_check ? check_damage(app, default_frames) : check_pipeline(app, default_frames);
+
+        app.app_sm.exit_all();
+        SDL_app_shutdown(&app);
+
+        return result;
+    }
+
+
+    std::vector<Bench_samples> results;
+
+    // Startup - up to the end of the first frame of the first state
+    app.app_sm.go_to(replay_path.empty() ? steps[0].id : START_ID);
+
+    if (replay_path.empty()) run_frame(app, results);
+    else
+    {
+        SDL_Event event;
+        while (SDL_PollEvent(&event)) SDL_app_event(&app, &event);
+
+        SDL_app_cycle(&app);
+    }
+
+    const double startup_ms = counter_to_us(SDL_GetPerformanceCounter() - startup_start) / 1000.0;
+
+    results.clear();
+
+    if (!replay_path.empty()) run_replay(app, results);
+
+    for (size_t i = 0; replay_path.empty() && i < steps.size(); ++i)
+    {
+        app.app_sm.request_go_to(steps[i].id);
+
+        // The transition itself is not measured, nor the time-sliced initialization of the state
+        app.app_sm.apply_pending_transition();
+        app.app_sm.finish_loading();
+
+        for (int f = 0; f < steps[i].frames; ++f) run_frame(app, results);
+    }
+
+    app.app_sm.exit_all();
+
+
+    // Report
+    std::ofstream file;
+
+    if (!out_path.empty())
+    {
+        file.open(out_path);
+
+        if (!file)
+        {
+            std::cerr << "Can't open the bench output file: " << out_path << "\n";
+            SDL_app_shutdown(&app);
+            return -1;
+        }
+    }
+
+    std::ostream& out = out_path.empty() ? std::cout : file;
+
+    // Fixed decimals - no exponents, the reports diff line by line (and perf/perf_check.cmake reads them)
+    out << std::fixed << std::setprecision(3);
+
+    out << "{\"video_driver\":\"" << (SDL_GetCurrentVideoDriver() ? SDL_GetCurrentVideoDriver() : "") << "\""
+        << ",\"mode\":\"" << (replay_path.empty() ? "script" : "replay") << "\""
+        << ",\"startup_ms\":" << startup_ms << ",\"unit\":\"us\",\"states\":[";
+
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        out << (i ? "," : "") << "\n  {\"name\":\"" << results[i].name << "\",\"frames\":" << results[i].frame.size();
+
+        out << ",\"frame\":";
+        write_stats(out, results[i].frame);
+
+        out << ",\"update\":";
+        write_stats(out, results[i].update);
+
+        out << ",\"render\":";
+        write_stats(out, results[i].render);
+
+#ifdef ALLOC_TRACKING
+        out << ",\"allocs\":";
+        write_stats(out, results[i].allocs);
+#endif
+
+        out << "}";
+    }
+
+    out << "\n]}\n";
+
+    SDL_app_shutdown(&app);
+
+    return 0;
+}
@@ -0,0 +1,313 @@
+// blit_bench.cpp
+
+// Microbenchmark of the software blit kernels: the selected set of the build (NEON on ARM)
+// against the scalar fallback, on a 640x480 frame. Reports the time per frame of every
+// kernel and checks that both versions give the same pixels, as JSON.
+//
+// Usage:
+//
+// ./miyoo_blit_bench [--iterations N] [--out FILE]
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+
+
+#include "../libs/engine/blit/blit_kernels.h"
+
+
+// Frame of the device screen
+static constexpr int FRAME_W = 640;
+static constexpr int FRAME_H = 480;
+static constexpr int FRAME_PIXELS = FRAME_W * FRAME_H;
+
+
+// =========================================================================================== KERNEL CASES
+
+// Buffers shared by the kernel cases
+struct Bench_buffers
+{
+    std::vector<std::uint32_t> src;
+    std::vector<std::uint32_t> src_premultiplied;
+    std::vector<std::uint32_t> dst;
+    std::vector<std::uint32_t> dst_base;
+    std::vector<std::uint16_t> src_565;
+    std::vector<std::uint16_t> dst_565;
+};
+
+
+// Runs one version of a kernel over the whole frame
+using Kernel_run = void (*)(Bench_buffers& b, bool scalar);
+
+
+static void run_fill(Bench_buffers& b, bool scalar)
+{
+    if (scalar) blit_fill_argb_scalar(b.dst.data(), FRAME_PIXELS, 0xFF336699u);
+    else blit_fill_argb(b.dst.data(), FRAME_PIXELS, 0xFF336699u);
+}
+
+
+static void run_blend(Bench_buffers& b, bool scalar)
+{
+    // Blending is destructive - every run starts from the same destination
+    std::memcpy(b.dst.data(), b.dst_base.data(), FRAME_PIXELS * sizeof(std::uint32_t));
+
+    if (scalar) blit_blend_argb_scalar(b.dst.data(), b.src.data(), FRAME_PIXELS);
+    else blit_blend_argb(b.dst.data(), b.src.data(), FRAME_PIXELS);
+}
+
+
+static void run_blend_premultiplied(Bench_buffers& b, bool scalar)
+{
+    std::memcpy(b.dst.data(), b.dst_base.data(), FRAME_PIXELS * sizeof(std::uint32_t));
+
+    if (scalar) blit_blend_premultiplied_argb_scalar(b.dst.data(), b.src_premultiplied.data(), FRAME_PIXELS);
+    else blit_blend_premultiplied_argb(b.dst.data(), b.src_premultiplied.data(), FRAME_PIXELS);
+}
+
+
+static void run_premultiply(Bench_buffers& b, bool scalar)
+{
+    if (scalar) blit_premultiply_argb_scalar(b.dst.data(), b.src.data(), FRAME_PIXELS);
+    else blit_premultiply_argb(b.dst.data(), b.src.data(), FRAME_PIXELS);
+}
+
+
+static void run_color_mod(Bench_buffers& b, bool scalar)
+{
+    const SDL_Color mod = {200, 100, 50, 180};
+
+    if (scalar) blit_color_mod_argb_scalar(b.dst.data(), b.src.data(), FRAME_PIXELS, mod);
+    else blit_color_mod_argb(b.dst.data(), b.src.data(), FRAME_PIXELS, mod);
+}
+
+
+static void run_565_to_argb(Bench_buffers& b, bool scalar)
+{
+    if (scalar) blit_rgb565_to_argb_scalar(b.dst.data(), b.src_565.data(), FRAME_PIXELS);
+    else blit_rgb565_to_argb(b.dst.data(), b.src_565.data(), FRAME_PIXELS);
+}
+
+
+static void run_argb_to_565(Bench_buffers& b, bool scalar)
+{
+    if (scalar) blit_argb_to_rgb565_scalar(b.dst_565.data(), b.src.data(), FRAME_PIXELS);
+    else blit_argb_to_rgb565(b.dst_565.data(), b.src.data(), FRAME_PIXELS);
+}
+
+
+// Upside down panel (the Miyoo Mini one)
+static void run_present_180(Bench_buffers& b, bool scalar)
+{
+    auto present = scalar ? blit_present_scalar : blit_present;
+
+    present(b.dst.data(), FRAME_W * 4, SDL_PIXELFORMAT_ARGB8888, FRAME_W, FRAME_H,
+            b.src.data(), FRAME_W * 4, SDL_PIXELFORMAT_ARGB8888, FRAME_W, FRAME_H, 2);
+}
+
+
+// Upside down 16-bit panel
+static void run_present_180_565(Bench_buffers& b, bool scalar)
+{
+    auto present = scalar ? blit_present_scalar : blit_present;
+
+    present(b.dst_565.data(), FRAME_W * 2, SDL_PIXELFORMAT_RGB565, FRAME_W, FRAME_H,
+            b.src.data(), FRAME_W * 4, SDL_PIXELFORMAT_ARGB8888, FRAME_W, FRAME_H, 2);
+}
+
+
+// Portrait frame onto the landscape panel, the tiled column walk
+static void run_present_90(Bench_buffers& b, bool scalar)
+{
+    auto present = scalar ? blit_present_scalar : blit_present;
+
+    present(b.dst.data(), FRAME_W * 4, SDL_PIXELFORMAT_ARGB8888, FRAME_W, FRAME_H,
+            b.src.data(), FRAME_H * 4, SDL_PIXELFORMAT_ARGB8888, FRAME_H, FRAME_W, 1);
+}
+
+
+// Half size frame, scaled up
+static void run_present_scaled(Bench_buffers& b, bool scalar)
+{
+    auto present = scalar ? blit_present_scalar : blit_present;
+
+    present(b.dst.data(), FRAME_W * 4, SDL_PIXELFORMAT_ARGB8888, FRAME_W, FRAME_H,
+            b.src_565.data(), FRAME_W, SDL_PIXELFORMAT_RGB565, FRAME_W / 2, FRAME_H / 2, 0);
+}
+
+
+// Pause grade: desaturated and tinted - the mix and the curves
+static void run_color_grade(Bench_buffers& b, bool scalar)
+{
+    static Color_grade grade;
+
+    grade.set_saturation(0.3f);
+    grade.set_tint({40, 60, 120, 255}, 0.25f);
+
+    // Graded in place - every run starts from the same frame
+    std::memcpy(b.dst.data(), b.src.data(), FRAME_PIXELS * sizeof(std::uint32_t));
+
+    if (scalar) blit_color_grade_scalar(b.dst.data(), FRAME_W * 4, SDL_PIXELFORMAT_ARGB8888, FRAME_W, FRAME_H, grade);
+    else blit_color_grade(b.dst.data(), FRAME_W * 4, SDL_PIXELFORMAT_ARGB8888, FRAME_W, FRAME_H, grade);
+}
+
+
+// Video frame: the Y plane and the quarter size U, V planes from the source bytes
+static void run_yuv420(Bench_buffers& b, bool scalar, void* dst, Uint32 format, int bpp)
+{
+    const Uint8* y = reinterpret_cast<const Uint8*>(b.src.data());
+    const Uint8* u = y + FRAME_PIXELS;
+    const Uint8* v = u + FRAME_PIXELS / 4;
+
+    auto convert = scalar ? blit_yuv420_scalar : blit_yuv420;
+
+    convert(dst, FRAME_W * bpp, format, FRAME_W, FRAME_H, y, FRAME_W, u, v, FRAME_W / 2);
+}
+
+static void run_yuv420_argb(Bench_buffers& b, bool scalar) { run_yuv420(b, scalar, b.dst.data(), SDL_PIXELFORMAT_ARGB8888, 4); }
+
+static void run_yuv420_565(Bench_buffers& b, bool scalar) { run_yuv420(b, scalar, b.dst_565.data(), SDL_PIXELFORMAT_RGB565, 2); }
+
+
+struct Kernel_case
+{
+    const char* name;
+    Kernel_run run;
+    bool output_565;    // Result is in dst_565, not in dst
+};
+
+static const Kernel_case kernel_cases[] = {
+    {"fill",            run_fill,        false},
+    {"blend",           run_blend,       false},
+    {"blend_premultiplied", run_blend_premultiplied, false},
+    {"premultiply",     run_premultiply, false},
+    {"color_mod",       run_color_mod,   false},
+    {"rgb565_to_argb",  run_565_to_argb, false},
+    {"argb_to_rgb565",  run_argb_to_565, true},
+    {"present_180",     run_present_180,     false},
+    {"present_180_565", run_present_180_565, true},
+    {"present_90",      run_present_90,      false},
+    {"present_scaled",  run_present_scaled,  false},
+    {"color_grade",     run_color_grade,     false},
+    {"yuv420_argb",     run_yuv420_argb,     false},
+    {"yuv420_565",      run_yuv420_565,      true},
+};
+
+// =========================================================================================== KERNEL CASES
+
+
+// Mean time of one run, in microseconds
+static double time_kernel(const Kernel_case& k, Bench_buffers& b, bool scalar, int iterations)
+{
+    k.run(b, scalar); // Warm up the caches
+
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    for (int i = 0; i < iterations; ++i) k.run(b, scalar);
+
+    Uint64 ticks = SDL_GetPerformanceCounter() - start;
+
+    return static_cast<double>(ticks) * 1e6 / static_cast<double>(SDL_GetPerformanceFrequency()) / iterations;
+}
+
+
+int main(int argc, char** argv)
+{
+    int iterations = 200;
+    std::string out_path;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!std::strcmp(argv[i], "--iterations") && i + 1 < argc) iterations = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--out") && i + 1 < argc) out_path = argv[++i];
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--iterations N] [--out FILE]\n";
+            return -1;
+        }
+    }
+
+    if (iterations <= 0) iterations = 200;
+
+
+    // Pseudo-random pixels with all of the alpha values - fixed seed, repeatable runs
+    Bench_buffers b;
+
+    b.src.resize(FRAME_PIXELS);
+    b.src_premultiplied.resize(FRAME_PIXELS);
+    b.dst.resize(FRAME_PIXELS);
+    b.dst_base.resize(FRAME_PIXELS);
+    b.src_565.resize(FRAME_PIXELS);
+    b.dst_565.resize(FRAME_PIXELS);
+
+    std::uint32_t seed = 0x12345678u;
+
+    auto next = [&seed]() { seed = seed * 1664525u + 1013904223u; return seed; };
+
+    for (int i = 0; i < FRAME_PIXELS; ++i)
+    {
+        b.src[i] = next();
+        b.dst_base[i] = next();
+        b.src_565[i] = static_cast<std::uint16_t>(next() >> 16);
+    }
+
+    // The premultiplied blend takes the valid premultiplied pixels, as the cooked images are
+    blit_premultiply_argb_scalar(b.src_premultiplied.data(), b.src.data(), FRAME_PIXELS);
+
+
+    std::ofstream file;
+
+    if (!out_path.empty())
+    {
+        file.open(out_path);
+
+        if (!file)
+        {
+            std::cerr << "Can't open the bench output file: " << out_path << "\n";
+            return -1;
+        }
+    }
+
+    std::ostream& out = out_path.empty() ? std::cout : file;
+
+    // Fixed decimals - no exponents (perf/perf_check.cmake reads the report)
+    out << std::fixed << std::setprecision(3);
+
+    out << "{\"kernels\":\"" << blit_kernel_name() << "\",\"pixels\":" << FRAME_PIXELS
+        << ",\"unit\":\"us\",\"results\":[";
+
+    bool all_match = true;
+
+    for (size_t k = 0; k < sizeof(kernel_cases) / sizeof(kernel_cases[0]); ++k)
+    {
+        const Kernel_case& kc = kernel_cases[k];
+
+        // Same input, both versions - the outputs must be identical
+        kc.run(b, true);
+        std::vector<std::uint32_t> scalar_out = b.dst;
+        std::vector<std::uint16_t> scalar_out_565 = b.dst_565;
+
+        kc.run(b, false);
+        bool match = kc.output_565 ? scalar_out_565 == b.dst_565 : scalar_out == b.dst;
+
+        all_match = all_match && match;
+
+        double scalar_us = time_kernel(kc, b, true, iterations);
+        double selected_us = time_kernel(kc, b, false, iterations);
+
+        out << (k ? "," : "") << "\n  {\"name\":\"" << kc.name << "\""
+            << ",\"scalar\":" << scalar_us
+            << ",\"selected\":" << selected_us
+            << ",\"speedup\":" << (selected_us > 0.0 ? scalar_us / selected_us : 0.0)
+            << ",\"match\":" << (match ? "true" : "false") << "}";
+    }
+
+    out << "\n]}\n";
+
+    return all_match ? 0 : 1;
+}
@@ -0,0 +1,553 @@
+// core_bench.cpp
+
+// Microbenchmark of the engine core data structures: the state machine (add_state,
+// get_state, go_to, clear_state), the State_ID operations and the asset instance
+// registry (add_instance, delete_instance), at 10 to 10000 states and instances, and the
+// particle integration on one core against the Job_system (particles_serial, particles_jobs),
+// the sprite corners through their transforms, SIMD against scalar (transform_quads*), and the
+// draw order of the Render_queue commands, the radix sort of the keys against a comparison sort
+// (draw_keys_radix, draw_keys_compare), and the update of n agents sharing one Sub_machine_table
+// (sub_machine_update).
+// No window, no assets - the structures are built synthetically.
+//
+// Every case is measured --repeats times, the median time per operation is reported.
+// The JSON has a fixed layout and precision, so the results of two releases diff line by line.
+//
+// Usage:
+//
+// ./miyoo_core_bench [--repeats N] [--out FILE]
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+
+
+#include "../libs/engine/state_machine/state_machine.h"
+#include "../libs/engine/state_machine/sub_machine.h"
+#include "../libs/engine/asset/asset.h"
+#include "../libs/engine/asset/asset_instance.h"
+#include "../libs/engine/particles/particle_system.h"
+#include "../libs/engine/jobs/job_system.h"
+#include "../libs/engine/math/math_2d.h"
+#include "../libs/engine/render_queue/render_queue.h"
+
+
+// Synthetic scales of the states and the instances
+static const int scales[] = {10, 100, 1000, 10000};
+
+// Children of one node of the synthetic state tree
+static constexpr int TREE_FANOUT = 100;
+
+// Smallest particle batch of a job in the bench - the small scales split too
+static constexpr int PARTICLE_BATCH = 256;
+
+// Keeps the results of the measured code alive
+static volatile std::uint64_t sink = 0;
+
+
+// =========================================================================================== FIXTURES
+
+// Three-level tree of exactly n states: the root {1}, the groups {1, g} and their leaves
+// {1, g, l} - the parents always come before their children
+static std::vector<State_ID> make_tree_ids(int n)
+{
+    std::vector<State_ID> ids;
+    ids.reserve(static_cast<size_t>(n));
+
+    const State_ID root{1};
+    ids.push_back(root);
+
+    for (int g = 0; static_cast<int>(ids.size()) < n; ++g)
+    {
+        const State_ID group = root.child(g);
+        ids.push_back(group);
+
+        for (int l = 0; l < TREE_FANOUT && static_cast<int>(ids.size()) < n; ++l) ids.push_back(group.child(l));
+    }
+
+    return ids;
+}
+
+
+// Fixed-seed permutation - repeatable runs
+static std::vector<int> make_order(int n)
+{
+    std::vector<int> order(static_cast<size_t>(n));
+
+    for (int i = 0; i < n; ++i) order[i] = i;
+
+    std::uint32_t seed = 0x2545F491u;
+
+    for (int i = n - 1; i > 0; --i)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        std::swap(order[i], order[(seed >> 8) % static_cast<std::uint32_t>(i + 1)]);
+    }
+
+    return order;
+}
+
+
+static void build_machine(State_machine& sm, const std::vector<State_ID>& ids)
+{
+    for (const State_ID& id : ids) sm.initiate_state(id, "bench");
+}
+
+
+// Asset without any data - only its instance registry is used
+class Bench_asset : public Asset
+{
+
+public:
+
+    Bench_asset() : Asset(Asset_type::UNKNOWN, "bench") {}
+
+    using Asset::add_instance;
+};
+
+// =========================================================================================== FIXTURES
+
+
+// =========================================================================================== CASES
+
+// Runs the operations of one case over n items, returns the time of the measured part in ticks
+using Case_run = Uint64 (*)(int n, const std::vector<State_ID>& ids, const std::vector<int>& order);
+
+
+static Uint64 run_add_state(int, const std::vector<State_ID>& ids, const std::vector<int>&)
+{
+    State_machine sm;
+
+    const Uint64 start = SDL_GetPerformanceCounter();
+    build_machine(sm, ids);
+    const Uint64 ticks = SDL_GetPerformanceCounter() - start;
+
+    sm.clear_states();
+
+    return ticks;
+}
+
+
+static Uint64 run_get_state(int, const std::vector<State_ID>& ids, const std::vector<int>& order)
+{
+    State_machine sm;
+    build_machine(sm, ids);
+
+    const Uint64 start = SDL_GetPerformanceCounter();
+
+    for (int i : order) sink = sink + reinterpret_cast<std::uintptr_t>(sm.get_state(ids[i]));
+
+    return SDL_GetPerformanceCounter() - start;
+}
+
+
+// Random targets - the exit and enter chains up to the common ancestor
+static Uint64 run_go_to(int, const std::vector<State_ID>& ids, const std::vector<int>& order)
+{
+    State_machine sm;
+    build_machine(sm, ids);
+
+    const Uint64 start = SDL_GetPerformanceCounter();
+
+    for (int i : order) sink = sink + static_cast<std::uint64_t>(sm.go_to(ids[i]));
+
+    const Uint64 ticks = SDL_GetPerformanceCounter() - start;
+
+    sm.exit_all();
+
+    return ticks;
+}
+
+
+// Every state, the children before their parents
+static Uint64 run_clear_state(int, const std::vector<State_ID>& ids, const std::vector<int>&)
+{
+    State_machine sm;
+    build_machine(sm, ids);
+
+    const Uint64 start = SDL_GetPerformanceCounter();
+
+    for (size_t i = ids.size(); i-- > 0;) sm.clear_state(ids[i]);
+
+    return SDL_GetPerformanceCounter() - start;
+}
+
+
+static Uint64 run_state_id_hierarchy(int, const std::vector<State_ID>& ids, const std::vector<int>& order)
+{
+    const Uint64 start = SDL_GetPerformanceCounter();
+
+    for (int i : order)
+    {
+        const State_ID& id = ids[i];
+        const State_ID parent = id.parent();
+
+        sink = sink + static_cast<std::uint64_t>(parent.is_parent_of(id)) + static_cast<std::uint64_t>(parent.child(7) == id)
+                    + static_cast<std::uint64_t>(id.depth());
+    }
+
+    return SDL_GetPerformanceCounter() - start;
+}
+
+
+static Uint64 run_state_id_hash(int, const std::vector<State_ID>& ids, const std::vector<int>& order)
+{
+    const Uint64 start = SDL_GetPerformanceCounter();
+
+    for (int i : order) sink = sink + ids[i].hash();
+
+    return SDL_GetPerformanceCounter() - start;
+}
+
+
+static Uint64 run_state_id_to_chars(int, const std::vector<State_ID>& ids, const std::vector<int>& order)
+{
+    char buf[State_ID::STRING_BUFFER_SIZE];
+
+    const Uint64 start = SDL_GetPerformanceCounter();
+
+    for (int i : order) sink = sink + ids[i].to_chars(buf, sizeof(buf));
+
+    return SDL_GetPerformanceCounter() - start;
+}
+
+
+static Uint64 run_add_instance(int n, const std::vector<State_ID>&, const std::vector<int>&)
+{
+    Bench_asset asset;
+
+    const Uint64 start = SDL_GetPerformanceCounter();
+
+    for (int i = 0; i < n; ++i) asset.add_instance();
+
+    return SDL_GetPerformanceCounter() - start;
+}
+
+
+// Random order - the swap-remove of the registry in the middle of the list
+static Uint64 run_delete_instance(int n, const std::vector<State_ID>&, const std::vector<int>& order)
+{
+    Bench_asset asset;
+
+    std::vector<Asset_instance*> instances(static_cast<size_t>(n));
+
+    for (int i = 0; i < n; ++i) instances[i] = asset.add_instance();
+
+    const Uint64 start = SDL_GetPerformanceCounter();
+
+    for (int i : order) asset.delete_instance(instances[i]);
+
+    return SDL_GetPerformanceCounter() - start;
+}
+
+
+// Particle arrays of n slots (padded to the SIMD width), integrated PARTICLE_STEPS times
+struct Bench_particles
+{
+    static constexpr int PARTICLE_STEPS = 8;
+
+    explicit Bench_particles(int n)
+        : count((n + 3) & ~3), x(count, 100.0f), y(count, 100.0f), vx(count, 40.0f), vy(count, -80.0f), life(count, 1e6f)
+    {
+    }
+
+    int count;
+    std::vector<float> x, y, vx, vy, life;
+};
+
+
+static Uint64 run_particles_serial(int n, const std::vector<State_ID>&, const std::vector<int>&)
+{
+    Bench_particles p(n);
+
+    const Uint64 start = SDL_GetPerformanceCounter();
+
+    for (int s = 0; s < Bench_particles::PARTICLE_STEPS; ++s)
+        particles_integrate(p.x.data(), p.y.data(), p.vx.data(), p.vy.data(), p.life.data(), p.count, 0.016f, 300.0f, 0.98f);
+
+    const Uint64 ticks = SDL_GetPerformanceCounter() - start;
+
+    sink = sink + static_cast<std::uint64_t>(p.y[0]);
+
+    return ticks / Bench_particles::PARTICLE_STEPS;
+}
+
+
+// Groups of 4 over the Job_system - the scaling over the cores against particles_serial
+static Uint64 run_particles_jobs(int n, const std::vector<State_ID>&, const std::vector<int>&)
+{
+    Bench_particles p(n);
+
+    const Uint64 start = SDL_GetPerformanceCounter();
+
+    for (int s = 0; s < Bench_particles::PARTICLE_STEPS; ++s)
+    {
+        Job_system::Instance().parallel_for(p.count / 4, PARTICLE_BATCH / 4, [&](int begin, int end)
+        {
+            const int i = begin * 4;
+
+            particles_integrate(p.x.data() + i, p.y.data() + i, p.vx.data() + i, p.vy.data() + i, p.life.data() + i,
+                                (end - begin) * 4, 0.016f, 300.0f, 0.98f);
+        });
+    }
+
+    const Uint64 ticks = SDL_GetPerformanceCounter() - start;
+
+    sink = sink + static_cast<std::uint64_t>(p.y[0]);
+
+    return ticks / Bench_particles::PARTICLE_STEPS;
+}
+
+
+// Corners of n rotated sprites, one Affine2 each - the Sprite_batch submit of a run
+struct Bench_quads
+{
+    explicit Bench_quads(int n) : corners(static_cast<size_t>(n) * 4), out(corners.size()), transforms(n)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            for (int k = 0; k < 4; ++k) corners[i * 4 + k] = {k == 1 || k == 2 ? 8.0f : -8.0f, k >= 2 ? 8.0f : -8.0f};
+
+            transforms[i] = Affine2::rotation_deg(static_cast<float>(i % 360)).translated({static_cast<float>(i % 640), 240.0f});
+        }
+    }
+
+    std::vector<Vec2> corners, out;
+    std::vector<Affine2> transforms;
+};
+
+
+template<void (*KERNEL)(const Affine2*, const Vec2*, Vec2*, int)>
+static Uint64 run_transform_quads(int n, const std::vector<State_ID>&, const std::vector<int>&)
+{
+    Bench_quads q(n);
+
+    const Uint64 start = SDL_GetPerformanceCounter();
+
+    KERNEL(q.transforms.data(), q.corners.data(), q.out.data(), n);
+
+    const Uint64 ticks = SDL_GetPerformanceCounter() - start;
+
+    sink = sink + static_cast<std::uint64_t>(q.out[0].y);
+
+    return ticks;
+}
+
+
+// Keys of n recorded commands: 4 layers, 2 blend modes, 16 textures, in a scrambled recording order
+struct Bench_keys
+{
+    explicit Bench_keys(int n) : keys(static_cast<size_t>(n)), scratch(keys.size())
+    {
+        std::uint32_t seed = 12345;
+
+        for (int i = 0; i < n; ++i)
+        {
+            seed = seed * 1664525u + 1013904223u;
+
+            keys[i] = make_draw_key(static_cast<int>(seed >> 28 & 3), seed >> 27 & 1, seed >> 20 & 15, static_cast<unsigned int>(i));
+        }
+    }
+
+    std::vector<std::uint64_t> keys, scratch;
+};
+
+
+static Uint64 run_draw_keys_radix(int n, const std::vector<State_ID>&, const std::vector<int>&)
+{
+    Bench_keys k(n);
+
+    const Uint64 start = SDL_GetPerformanceCounter();
+
+    const std::uint64_t* sorted = sort_draw_keys(k.keys.data(), k.scratch.data(), k.keys.size());
+
+    const Uint64 ticks = SDL_GetPerformanceCounter() - start;
+
+    sink = sink + sorted[0];
+
+    return ticks;
+}
+
+
+// The order the Render_queue had before the keys - the stable sort of the indices by the fields
+static Uint64 run_draw_keys_compare(int n, const std::vector<State_ID>&, const std::vector<int>&)
+{
+    Bench_keys k(n);
+
+    std::vector<int> order(k.keys.size());
+
+    for (size_t i = 0; i < order.size(); ++i) order[i] = static_cast<int>(i);
+
+    const Uint64 start = SDL_GetPerformanceCounter();
+
+    std::stable_sort(order.begin(), order.end(), [&k](int a, int b)
+    {
+        return (k.keys[a] >> DRAW_KEY_INDEX_BITS) < (k.keys[b] >> DRAW_KEY_INDEX_BITS);
+    });
+
+    const Uint64 ticks = SDL_GetPerformanceCounter() - start;
+
+    sink = sink + static_cast<std::uint64_t>(order[0]);
+
+    return ticks;
+}
+
+
+// Patrol -> look (timeout) -> chase (timer) -> patrol: every agent walks the table, the ticks of
+// one step over all of them
+enum { AGENT_PATROL, AGENT_LOOK, AGENT_CHASE };
+
+static int agent_patrol(Sub_machine& m, void*, std::uint32_t agent, float) { return m.state_time > 0.05f * (agent % 4 + 1) ? AGENT_LOOK : Sub_machine_table::STAY; }
+static void agent_chase_enter(Sub_machine& m, void*, std::uint32_t) { m.timer = 0.1f; }
+static int agent_chase(Sub_machine& m, void*, std::uint32_t, float) { return m.timer <= 0.0f ? AGENT_PATROL : Sub_machine_table::STAY; }
+
+static const Sub_state_def AGENT_STATES[] = {
+    {"PATROL", nullptr,           nullptr, agent_patrol, 0.0f,  Sub_machine_table::STAY},
+    {"LOOK",   nullptr,           nullptr, nullptr,      0.08f, AGENT_CHASE},
+    {"CHASE",  agent_chase_enter, nullptr, agent_chase,  0.0f,  Sub_machine_table::STAY},
+};
+
+static const Sub_machine_table AGENT_AI(AGENT_STATES);
+
+
+static Uint64 run_sub_machine_update(int n, const std::vector<State_ID>&, const std::vector<int>&)
+{
+    static constexpr int STEPS = 32;
+
+    std::vector<Sub_machine> machines(static_cast<size_t>(n));
+
+    for (int i = 0; i < n; ++i) AGENT_AI.start(machines[i], nullptr, static_cast<std::uint32_t>(i));
+
+    const Uint64 start = SDL_GetPerformanceCounter();
+
+    for (int s = 0; s < STEPS; ++s) AGENT_AI.update_all(machines.data(), nullptr, n, 0.016f, nullptr);
+
+    const Uint64 ticks = SDL_GetPerformanceCounter() - start;
+
+    sink = sink + machines[0].transitions;
+
+    return ticks / STEPS;
+}
+
+
+struct Core_case
+{
+    const char* name;
+    Case_run run;
+};
+
+static const Core_case core_cases[] = {
+    {"add_state",          run_add_state},
+    {"get_state",          run_get_state},
+    {"go_to",              run_go_to},
+    {"clear_state",        run_clear_state},
+    {"state_id_hierarchy", run_state_id_hierarchy},
+    {"state_id_hash",      run_state_id_hash},
+    {"state_id_to_chars",  run_state_id_to_chars},
+    {"add_instance",       run_add_instance},
+    {"delete_instance",    run_delete_instance},
+    {"particles_serial",   run_particles_serial},
+    {"particles_jobs",     run_particles_jobs},
+    {"transform_quads",    run_transform_quads<transform_quads>},
+    {"transform_quads_scalar", run_transform_quads<transform_quads_scalar>},
+    {"draw_keys_radix",    run_draw_keys_radix},
+    {"draw_keys_compare",  run_draw_keys_compare},
+    {"sub_machine_update", run_sub_machine_update},
+};
+
+// =========================================================================================== CASES
+
+
+// Median and minimum time of one operation over the repeats, in nanoseconds
+static void time_case(const Core_case& c, int n, int repeats, double& median_ns, double& min_ns)
+{
+    const std::vector<State_ID> ids = make_tree_ids(n);
+    const std::vector<int> order = make_order(n);
+
+    c.run(n, ids, order); // Warm up the caches and the pools
+
+    std::vector<double> samples;
+
+    for (int r = 0; r < repeats; ++r)
+    {
+        const Uint64 ticks = c.run(n, ids, order);
+
+        samples.push_back(static_cast<double>(ticks) * 1e9 / static_cast<double>(SDL_GetPerformanceFrequency()) / n);
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    median_ns = samples[samples.size() / 2];
+    min_ns = samples.front();
+}
+
+
+int main(int argc, char** argv)
+{
+    int repeats = 9;
+    std::string out_path;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!std::strcmp(argv[i], "--repeats") && i + 1 < argc) repeats = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--out") && i + 1 < argc) out_path = argv[++i];
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--repeats N] [--out FILE]\n";
+            return -1;
+        }
+    }
+
+    if (repeats <= 0) repeats = 9;
+
+    // Workers of the particles_jobs case, the main thread submits
+    Job_system::Instance().start();
+
+
+    std::ofstream file;
+
+    if (!out_path.empty())
+    {
+        file.open(out_path);
+
+        if (!file)
+        {
+            std::cerr << "Can't open the bench output file: " << out_path << "\n";
+            return -1;
+        }
+    }
+
+    std::ostream& out = out_path.empty() ? std::cout : file;
+
+    out << std::fixed << std::setprecision(1);
+    out << "{\"bench\":\"core\",\"version\":1,\"repeats\":" << repeats << ",\"unit\":\"ns_per_op\",\"results\":[";
+
+    bool first = true;
+
+    for (const Core_case& c : core_cases)
+    {
+        for (int n : scales)
+        {
+            double median_ns = 0.0, min_ns = 0.0;
+
+            time_case(c, n, repeats, median_ns, min_ns);
+
+            out << (first ? "" : ",") << "\n  {\"name\":\"" << c.name << "\",\"n\":" << n
+                << ",\"median\":" << median_ns << ",\"min\":" << min_ns << "}";
+
+            first = false;
+        }
+    }
+
+    out << "\n]}\n";
+
+    Job_system::Instance().stop();
+
+    return 0;
+}
@@ -0,0 +1,406 @@
+// font_baker.cpp
+
+// Host-side font baker: cuts the glyph cells of a bitmap font sheet to their ink, packs
+// them into one atlas image and writes the glyph metrics (font_format.h) - the device
+// only copies the rectangles, no TrueType rasterization.
+//
+// Usage:
+//
+// ./miyoo_font_baker SOURCE.txt OUT.fnt OUT.bmp
+//
+// The source is one directive per line, '#' starts a comment:
+//
+//     sheet    ui_sheet.bmp    # glyph cells in rows, the background is the color of the top left pixel
+//     cell     8 16            # cell size in px
+//     baseline 12              # baseline below the cell top
+//     line     18              # distance between the lines (the cell height by default)
+//     spacing  1               # px after the ink of every glyph
+//     space    4               # advance of the cells without the ink (the cell width by default)
+//     image    fonts/ui.bmp    # name of the atlas image in the game
+//     chars    ABC...          # UTF-8 characters of the cells in order, the lines are appended
+//     kern     A V -1          # advance correction of the pair
+//
+// Pack OUT.fnt (as a raw file) and OUT.bmp (as an image) with miyoo_asset_cooker.
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+#include "../libs/engine/platform/platform.h"
+#include "../libs/engine/text/font_format.h"
+#include "../libs/engine/text/utf8.h"
+
+
+// =========================================================================================== BAKE SETTINGS
+
+struct Bake_source
+{
+    std::string sheet;
+    std::string image;
+
+    int cell_w = 0;
+    int cell_h = 0;
+
+    int baseline = -1;
+    int line_height = 0;
+    int spacing = 1;
+    int space = -1;
+
+    std::vector<std::uint32_t> chars;
+    std::vector<Font_kerning> kerning;
+};
+
+
+static std::uint32_t first_codepoint(const std::string& text)
+{
+    const char* p = text.data();
+    return text.empty() ? 0 : utf8::next(p, p + text.size());
+}
+
+
+static bool parse_source(const std::string& text, Bake_source& source, std::string& error)
+{
+    std::istringstream lines(text);
+    std::string line;
+    int line_number = 0;
+
+    while (std::getline(lines, line))
+    {
+        ++line_number;
+
+        while (!line.empty() && line.back() == '\r') line.pop_back();
+
+        std::istringstream words(line);
+        std::string directive;
+
+        if (!(words >> directive) || directive[0] == '#') continue;
+
+        bool ok = true;
+
+        if (directive == "chars")
+        {
+            // The rest of the line as it is - '#' and the spaces are characters too
+            std::string chars;
+            std::getline(words, chars);
+
+            if (!chars.empty() && chars[0] == ' ') chars.erase(0, 1);
+
+            const char* p = chars.data();
+            const size_t first = source.chars.size();
+
+            // One codepoint a byte at most
+            source.chars.resize(first + chars.size());
+            source.chars.resize(first + utf8::decode(p, p + chars.size(), source.chars.data() + first, chars.size()));
+        }
+        else
+        {
+            const size_t comment = line.find('#');
+            if (comment != std::string::npos) line.erase(comment);
+
+            words.clear();
+            words.str(line);
+            words >> directive;
+
+            if (directive == "sheet") ok = static_cast<bool>(words >> source.sheet);
+            else if (directive == "image") ok = static_cast<bool>(words >> source.image);
+            else if (directive == "cell") ok = static_cast<bool>(words >> source.cell_w >> source.cell_h) && source.cell_w > 0 && source.cell_h > 0;
+            else if (directive == "baseline") ok = static_cast<bool>(words >> source.baseline);
+            else if (directive == "line") ok = static_cast<bool>(words >> source.line_height) && source.line_height > 0;
+            else if (directive == "spacing") ok = static_cast<bool>(words >> source.spacing);
+            else if (directive == "space") ok = static_cast<bool>(words >> source.space) && source.space >= 0;
+            else if (directive == "kern")
+            {
+                std::string first, second;
+                int amount = 0;
+
+                ok = static_cast<bool>(words >> first >> second >> amount);
+                source.kerning.push_back({first_codepoint(first), first_codepoint(second), amount});
+            }
+            else ok = false;
+        }
+
+        if (!ok)
+        {
+            error = "line " + std::to_string(line_number) + ": can't read '" + directive + "'";
+            return false;
+        }
+    }
+
+    if (source.sheet.empty() || source.image.empty() || source.cell_w == 0 || source.chars.empty())
+    {
+        error = "sheet, image, cell and chars are required";
+        return false;
+    }
+
+    if (source.baseline < 0) source.baseline = source.cell_h;
+    if (source.line_height == 0) source.line_height = source.cell_h;
+    if (source.space < 0) source.space = source.cell_w;
+
+    return true;
+}
+
+// =========================================================================================== BAKE SETTINGS
+
+
+// =========================================================================================== BAKING
+
+// Coverage of the pixel: the alpha of the sheets with it, the distance from the background otherwise
+static Uint8 coverage(Uint32 pixel, Uint32 background, bool has_alpha)
+{
+    if (has_alpha) return static_cast<Uint8>(pixel >> 24);
+
+    const auto luma = [](Uint32 c) { return (((c >> 16) & 0xFF) * 77 + ((c >> 8) & 0xFF) * 150 + (c & 0xFF) * 29) >> 8; };
+
+    const int d = static_cast<int>(luma(pixel)) - static_cast<int>(luma(background));
+
+    return static_cast<Uint8>(std::min(255, d < 0 ? -d : d));
+}
+
+
+struct Baked_glyph
+{
+    Font_glyph glyph;
+
+    // Ink rectangle in the sheet
+    int sheet_x;
+    int sheet_y;
+};
+
+
+template <typename T>
+static void append(std::vector<std::uint8_t>& out, const T& value)
+{
+    const size_t at = out.size();
+    out.resize(at + sizeof(T));
+    std::memcpy(out.data() + at, &value, sizeof(T));
+}
+
+
+int main(int argc, char** argv)
+{
+    if (argc != 4)
+    {
+        std::cerr << "Usage: " << argv[0] << " SOURCE.txt OUT.fnt OUT.bmp\n";
+        return -1;
+    }
+
+    std::ifstream in(argv[1], std::ios::binary);
+
+    if (!in)
+    {
+        std::cerr << "Can't open " << argv[1] << "\n";
+        return -1;
+    }
+
+    std::stringstream text;
+    text << in.rdbuf();
+
+    Bake_source source;
+    std::string error;
+
+    if (!parse_source(text.str(), source, error))
+    {
+        std::cerr << argv[1] << ", " << error << "\n";
+        return -1;
+    }
+
+    SDL_Surface* loaded = SDL_LoadBMP(source.sheet.c_str());
+
+    if (!loaded)
+    {
+        std::cerr << "Can't load " << source.sheet << ": " << SDL_GetError() << "\n";
+        return -1;
+    }
+
+    const bool has_alpha = loaded->format->Amask != 0;
+
+    SDL_Surface* sheet = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_ARGB8888, 0);
+    SDL_FreeSurface(loaded);
+
+    if (!sheet)
+    {
+        std::cerr << "Can't convert " << source.sheet << ": " << SDL_GetError() << "\n";
+        return -1;
+    }
+
+    const auto pixel = [sheet](int x, int y) { return static_cast<const Uint32*>(sheet->pixels)[y * (sheet->pitch / 4) + x]; };
+
+    const Uint32 background = pixel(0, 0);
+    const int columns = sheet->w / source.cell_w;
+
+    if (columns == 0 || static_cast<int>(source.chars.size()) > columns * (sheet->h / source.cell_h))
+    {
+        std::cerr << "The sheet has fewer cells than chars\n";
+        SDL_FreeSurface(sheet);
+        return -1;
+    }
+
+    // Ink bounds of every cell
+    std::vector<Baked_glyph> glyphs;
+
+    for (size_t i = 0; i < source.chars.size(); ++i)
+    {
+        const int cx = static_cast<int>(i) % columns * source.cell_w;
+        const int cy = static_cast<int>(i) / columns * source.cell_h;
+
+        int x0 = source.cell_w, y0 = source.cell_h, x1 = -1, y1 = -1;
+
+        for (int y = 0; y < source.cell_h; ++y)
+            for (int x = 0; x < source.cell_w; ++x)
+                if (coverage(pixel(cx + x, cy + y), background, has_alpha) > 0)
+                {
+                    x0 = std::min(x0, x);
+                    y0 = std::min(y0, y);
+                    x1 = std::max(x1, x);
+                    y1 = std::max(y1, y);
+                }
+
+        Baked_glyph baked = {};
+
+        baked.glyph.codepoint = source.chars[i];
+
+        if (x1 < 0)
+        {
+            baked.glyph.advance = static_cast<std::int16_t>(source.space);
+        }
+        else
+        {
+            baked.glyph.w = static_cast<std::uint16_t>(x1 - x0 + 1);
+            baked.glyph.h = static_cast<std::uint16_t>(y1 - y0 + 1);
+            baked.glyph.offset_x = 0;
+            baked.glyph.offset_y = static_cast<std::int16_t>(y0);
+            baked.glyph.advance = static_cast<std::int16_t>(baked.glyph.w + source.spacing);
+
+            baked.sheet_x = cx + x0;
+            baked.sheet_y = cy + y0;
+        }
+
+        glyphs.push_back(baked);
+    }
+
+    // Shelf packing, tallest first, 1 px transparent gap - no filtering bleed
+    std::vector<Baked_glyph*> order;
+    for (Baked_glyph& g : glyphs) if (g.glyph.w > 0) order.push_back(&g);
+
+    std::sort(order.begin(), order.end(), [](const Baked_glyph* a, const Baked_glyph* b) { return a->glyph.h > b->glyph.h; });
+
+    const int atlas_w = 256;
+    int shelf_x = 1, shelf_y = 1, shelf_h = 0;
+
+    for (Baked_glyph* g : order)
+    {
+        if (shelf_x + g->glyph.w + 1 > atlas_w)
+        {
+            shelf_x = 1;
+            shelf_y += shelf_h + 1;
+            shelf_h = 0;
+        }
+
+        g->glyph.x = static_cast<std::uint16_t>(shelf_x);
+        g->glyph.y = static_cast<std::uint16_t>(shelf_y);
+
+        shelf_x += g->glyph.w + 1;
+        shelf_h = std::max(shelf_h, static_cast<int>(g->glyph.h));
+    }
+
+    // Power of two height - the same texture on every renderer
+    int atlas_h = 1;
+    while (atlas_h < shelf_y + shelf_h + 1) atlas_h *= 2;
+
+    SDL_Surface* atlas = SDL_CreateRGBSurfaceWithFormat(0, atlas_w, atlas_h, 32, SDL_PIXELFORMAT_ARGB8888);
+
+    if (!atlas)
+    {
+        std::cerr << "Can't create the atlas: " << SDL_GetError() << "\n";
+        SDL_FreeSurface(sheet);
+        return -1;
+    }
+
+    SDL_FillRect(atlas, nullptr, 0x00FFFFFFu);
+
+    // White glyphs, the coverage in the alpha - any color by the vertex modulation
+    for (const Baked_glyph* g : order)
+        for (int y = 0; y < g->glyph.h; ++y)
+            for (int x = 0; x < g->glyph.w; ++x)
+            {
+                const Uint8 a = coverage(pixel(g->sheet_x + x, g->sheet_y + y), background, has_alpha);
+
+                static_cast<Uint32*>(atlas->pixels)[(g->glyph.y + y) * (atlas->pitch / 4) + g->glyph.x + x] = (static_cast<Uint32>(a) << 24) | 0xFFFFFFu;
+            }
+
+    SDL_FreeSurface(sheet);
+
+    if (SDL_SaveBMP(atlas, argv[3]) != 0)
+    {
+        std::cerr << "Can't write " << argv[3] << ": " << SDL_GetError() << "\n";
+        SDL_FreeSurface(atlas);
+        return -1;
+    }
+
+    SDL_FreeSurface(atlas);
+
+    // The tables sorted for the binary searches of the device
+    std::sort(glyphs.begin(), glyphs.end(), [](const Baked_glyph& a, const Baked_glyph& b) { return a.glyph.codepoint < b.glyph.codepoint; });
+
+    for (size_t i = 1; i < glyphs.size(); ++i)
+        if (glyphs[i].glyph.codepoint == glyphs[i - 1].glyph.codepoint)
+        {
+            std::cerr << "Character U+" << std::hex << glyphs[i].glyph.codepoint << " is listed twice\n";
+            return -1;
+        }
+
+    std::sort(source.kerning.begin(), source.kerning.end(), [](const Font_kerning& a, const Font_kerning& b)
+              { return a.first != b.first ? a.first < b.first : a.second < b.second; });
+
+    Font_header header = {};
+
+    header.magic = FONT_MAGIC;
+    header.version = FONT_VERSION;
+    header.line_height = source.line_height;
+    header.baseline = source.baseline;
+    header.glyph_count = static_cast<std::uint32_t>(glyphs.size());
+    header.glyph_offset = sizeof(Font_header);
+    header.kerning_count = static_cast<std::uint32_t>(source.kerning.size());
+    header.kerning_offset = header.glyph_offset + header.glyph_count * sizeof(Font_glyph);
+    header.image_offset = header.kerning_offset + header.kerning_count * sizeof(Font_kerning);
+    header.image_length = static_cast<std::uint32_t>(source.image.size());
+    header.size = (header.image_offset + header.image_length + 1 + 3) & ~3u;
+
+    std::vector<std::uint8_t> font;
+    font.reserve(header.size);
+
+    append(font, header);
+    for (const Baked_glyph& g : glyphs) append(font, g.glyph);
+    for (const Font_kerning& k : source.kerning) append(font, k);
+
+    font.insert(font.end(), source.image.begin(), source.image.end());
+    font.resize(header.size, 0);
+
+    // The baked font is checked by the same view the game uses
+    Font_view view;
+
+    if (!view.open(font.data(), font.size()))
+    {
+        std::cerr << "Baked font is not valid\n";
+        return -1;
+    }
+
+    std::ofstream out(argv[2], std::ios::binary);
+
+    if (!out || !out.write(reinterpret_cast<const char*>(font.data()), static_cast<std::streamsize>(font.size())))
+    {
+        std::cerr << "Can't write " << argv[2] << "\n";
+        return -1;
+    }
+
+    std::cout << "Font " << source.image << ": " << glyphs.size() << " glyphs, atlas " << atlas_w << "x" << atlas_h << "\n";
+
+    return 0;
+}
+
+// =========================================================================================== BAKING
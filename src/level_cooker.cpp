@@ -0,0 +1,77 @@
+// level_cooker.cpp
+
+// Host-side level cooker: converts the editable text levels into the binary level
+// format (level_format.h), which the device uses in place - no parse at the level load.
+//
+// Usage:
+//
+// ./miyoo_level_cooker SOURCE.txt OUT.lvl
+//
+// The .lvl files are loaded by their path, pack them with miyoo_asset_cooker (as raw files)
+// to have them mapped instead of read.
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+#include "../libs/game_logic/level/level_format.h"
+
+
+static void print_usage(const char* exe)
+{
+    std::cerr << "Usage: " << exe << " SOURCE.txt OUT.lvl\n";
+}
+
+
+int main(int argc, char** argv)
+{
+    if (argc != 3)
+    {
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    std::ifstream in(argv[1], std::ios::binary);
+
+    if (!in)
+    {
+        std::cerr << "Can't open " << argv[1] << "\n";
+        return -1;
+    }
+
+    std::stringstream source;
+    source << in.rdbuf();
+
+    std::vector<std::uint8_t> level;
+    std::string error;
+
+    if (!level_cook(source.str(), level, error))
+    {
+        std::cerr << argv[1] << ", " << error << "\n";
+        return -1;
+    }
+
+    // The cooked level is checked by the same view the game uses
+    Level_view view;
+
+    if (!view.open(level.data(), level.size()))
+    {
+        std::cerr << "Cooked level is not valid\n";
+        return -1;
+    }
+
+    std::ofstream out(argv[2], std::ios::binary);
+
+    if (!out || !out.write(reinterpret_cast<const char*>(level.data()), static_cast<std::streamsize>(level.size())))
+    {
+        std::cerr << "Can't write " << argv[2] << "\n";
+        return -1;
+    }
+
+    std::cout << "Level '" << view.get_name() << "': " << view.get_box_count() << " boxes, " << level.size() << " bytes\n";
+
+    return 0;
+}
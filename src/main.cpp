@@ -1,15 +1,61 @@
 #include <iostream>
+#include <cstring>
+#include <vector>
 
 
 #include "../libs/engine/app_logic/app.h"
 #include "../libs/game_logic/game_states/game_states.h"
+#include "../libs/engine/startup_trace/startup_trace.h"
+#include "../libs/engine/zone_profiler/zone_profiler.h"
+#include "../libs/engine/config/config_file.h"
+#include "../libs/engine/save/save_system.h"
 
-int main()
+// Usage: ./miyoo_square [--record FILE | --replay FILE] [--capture-render FILE] [--telemetry FILE] [--profile FILE] [--config FILE]
+//
+// --record saves the per-tick buttons of the session, --replay plays them back
+// instead of the live buttons and quits at the end - the same workload for every build.
+// --capture-render writes the render commands of the first 300 frames for ./miyoo_render_replay.
+// --telemetry appends the log and the metrics of the session to the file (written in the background).
+// --profile writes the sampled zone stacks of the session as a flame graph input (MIYOO_SAMPLING_PROFILER builds).
+// --config reads the settings from the file instead of settings.cfg (the renderer, the window, the frame rate, the language).
+
+int main(int argc, char** argv)
 {
+    Startup_trace& trace = Startup_trace::Instance();
+
+    trace.mark("main");
+
+    // Outlives the app - the text settings are its strings
+    Config_file config;
+    const char* config_path = "settings.cfg";
+
     sdl_app_ctx app_test;
 
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!std::strcmp(argv[i], "--record") && i + 1 < argc) app_test.input_record_path = argv[++i];
+        else if (!std::strcmp(argv[i], "--replay") && i + 1 < argc) app_test.input_replay_path = argv[++i];
+        else if (!std::strcmp(argv[i], "--capture-render") && i + 1 < argc) app_test.render_capture_path = argv[++i];
+        else if (!std::strcmp(argv[i], "--telemetry") && i + 1 < argc) app_test.telemetry_path = argv[++i];
+        else if (!std::strcmp(argv[i], "--profile") && i + 1 < argc) app_test.sample_profile_path = argv[++i];
+        else if (!std::strcmp(argv[i], "--config") && i + 1 < argc) config_path = argv[++i];
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--record FILE | --replay FILE] [--capture-render FILE] [--telemetry FILE] [--profile FILE] [--config FILE]\n";
+            return -1;
+        }
+    }
+
+    // No file - the engine defaults
+    if (config.load(config_path)) config.apply(app_test);
+
+    // The session suspended by the lid or the power key continues - not with the replays
+    if (!app_test.input_replay_path) app_test.resume_path = "resume.dat";
+
+    trace.mark("config");
+
     // Initialize SDL application
-    if (!SDL_app_init(&app_test, 800, 600, "Miyoo Square"))
+    if (!SDL_app_init(&app_test, config.window_width(Platform::WINDOW_W), config.window_height(Platform::WINDOW_H), "Miyoo Square"))
     {
         std::cerr << "Failed to initialize SDL application." << std::endl;
         return -1;
@@ -18,6 +64,8 @@ int main()
     // Initialize game states
     init_game_states(app_test.app_sm);
 
+    trace.mark("init_game_states");
+
     // Set the initial state to START_ID
     if (!app_test.app_sm.go_to(START_ID))
     {
@@ -26,23 +74,59 @@ int main()
         return -1;
     }
 
+    trace.mark("go_to(START_ID)");
+
+    // Suspended session - restored as soon as the splash preload is done, instead of the menus
+    std::vector<std::uint8_t> resume;
+
+    if (app_test.resume_path) Save_system::Instance().load(app_test.resume_path, resume);
+
     // Main loop
     SDL_Event event;
 
+    bool splash_presented = false;
+
     while (app_test.app_state == SDL_APP_CONTINUE)
     {
+        // Static screens sleep until the input, instead of polling
+        SDL_app_wait_idle(&app_test);
+
         // Handle events
-        while (SDL_PollEvent(&event))
         {
-            SDL_app_event(&app_test, &event);
+            PROFILE_ZONE("events");
+
+            while (SDL_PollEvent(&event))
+            {
+                SDL_app_event(&app_test, &event);
+            }
+        }
+
+        if (!resume.empty() && start_is_ready())
+        {
+            if (app_test.app_sm.restore_snapshot(resume.data(), resume.size())) trace.finish("resumed");
+
+            resume.clear();
         }
 
         // Update and render
         if (!SDL_app_cycle(&app_test))
         {
-            app_test.app_sm.get_current_state()->on_exit();
+            app_test.app_sm.exit_all(); // Exit every active state, leaf to root
             break;
         }
+
+        // Startup phases end with the splash on the screen and the first menu frame
+        if (!trace.is_finished())
+        {
+            if (!splash_presented && Frame::Instance().get_presented_count() > 0)
+            {
+                splash_presented = true;
+                trace.mark("first splash frame");
+            }
+
+            if (app_test.app_sm.get_current_state() && app_test.app_sm.get_current_state()->id == MAIN_MENU_ID)
+                trace.finish("first interactive frame");
+        }
     }
 
     // Shutdown SDL application
@@ -0,0 +1,233 @@
+// mix_bench.cpp
+
+// Microbenchmark of the audio mixer kernels: the selected set of the build (NEON on ARM,
+// SSE2 on x86) against the scalar fallback, on one callback buffer of all the mixer voices.
+// Reports the time per buffer of every kernel and checks that both versions give the same
+// samples, as JSON.
+//
+// Usage:
+//
+// ./miyoo_mix_bench [--iterations N] [--out FILE]
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+
+
+#include "../libs/engine/audio/mix_kernels.h"
+
+
+// Callback buffer of the default device spec, all voices of the mixer
+static constexpr int BUFFER_FRAMES = 1024;
+static constexpr int VOICES = 16;
+
+// Volume ramp of a buffer: from 25 % up to 100 % (Q16)
+static constexpr std::int32_t RAMP_START = 1 << 14;
+static constexpr std::int32_t RAMP_STEP = ((1 << 16) - RAMP_START) / BUFFER_FRAMES;
+
+
+// =========================================================================================== KERNEL CASES
+
+// Buffers shared by the kernel cases
+struct Bench_buffers
+{
+    std::vector<std::int16_t> stereo;       // VOICES x BUFFER_FRAMES stereo voices
+    std::vector<std::int16_t> mono;         // VOICES x BUFFER_FRAMES mono voices
+    std::vector<std::int32_t> acc;
+    std::vector<std::int16_t> out;
+    std::vector<std::int16_t> left;
+    std::vector<std::int16_t> right;
+};
+
+
+// Runs one version of a kernel over the whole buffer, the output is put into b.out
+using Kernel_run = void (*)(Bench_buffers& b, bool scalar);
+
+
+static void run_add_stereo(Bench_buffers& b, bool scalar)
+{
+    std::memset(b.acc.data(), 0, b.acc.size() * sizeof(std::int32_t));
+
+    for (int v = 0; v < VOICES; ++v)
+    {
+        const std::int16_t* src = b.stereo.data() + v * BUFFER_FRAMES * 2;
+
+        if (scalar) mix_add_stereo_scalar(b.acc.data(), src, BUFFER_FRAMES, RAMP_START, RAMP_STEP);
+        else mix_add_stereo(b.acc.data(), src, BUFFER_FRAMES, RAMP_START, RAMP_STEP);
+    }
+
+    // The accumulator has 32-bit samples - compared through the scalar resolve
+    mix_resolve_scalar(b.out.data(), b.acc.data(), BUFFER_FRAMES * 2);
+}
+
+
+static void run_add_mono(Bench_buffers& b, bool scalar)
+{
+    std::memset(b.acc.data(), 0, b.acc.size() * sizeof(std::int32_t));
+
+    for (int v = 0; v < VOICES; ++v)
+    {
+        const std::int16_t* src = b.mono.data() + v * BUFFER_FRAMES;
+
+        if (scalar) mix_add_mono_scalar(b.acc.data(), src, BUFFER_FRAMES, RAMP_START, RAMP_STEP);
+        else mix_add_mono(b.acc.data(), src, BUFFER_FRAMES, RAMP_START, RAMP_STEP);
+    }
+
+    mix_resolve_scalar(b.out.data(), b.acc.data(), BUFFER_FRAMES * 2);
+}
+
+
+static void run_resolve(Bench_buffers& b, bool scalar)
+{
+    // Sum of the full-scale voices - a part of the samples is saturated
+    for (int i = 0; i < BUFFER_FRAMES * 2; ++i) b.acc[i] = b.stereo[i] * 256 * 4;
+
+    if (scalar) mix_resolve_scalar(b.out.data(), b.acc.data(), BUFFER_FRAMES * 2);
+    else mix_resolve(b.out.data(), b.acc.data(), BUFFER_FRAMES * 2);
+}
+
+
+static void run_interleave(Bench_buffers& b, bool scalar)
+{
+    const std::int16_t* left = b.mono.data();
+    const std::int16_t* right = b.mono.data() + BUFFER_FRAMES;
+
+    if (scalar) mix_interleave_scalar(b.out.data(), left, right, BUFFER_FRAMES);
+    else mix_interleave(b.out.data(), left, right, BUFFER_FRAMES);
+}
+
+
+static void run_deinterleave(Bench_buffers& b, bool scalar)
+{
+    if (scalar) mix_deinterleave_scalar(b.left.data(), b.right.data(), b.stereo.data(), BUFFER_FRAMES);
+    else mix_deinterleave(b.left.data(), b.right.data(), b.stereo.data(), BUFFER_FRAMES);
+
+    std::memcpy(b.out.data(), b.left.data(), BUFFER_FRAMES * sizeof(std::int16_t));
+    std::memcpy(b.out.data() + BUFFER_FRAMES, b.right.data(), BUFFER_FRAMES * sizeof(std::int16_t));
+}
+
+
+struct Kernel_case
+{
+    const char* name;
+    Kernel_run run;
+};
+
+static const Kernel_case kernel_cases[] = {
+    {"add_stereo_ramp",  run_add_stereo},
+    {"add_mono_ramp",    run_add_mono},
+    {"resolve",          run_resolve},
+    {"interleave",       run_interleave},
+    {"deinterleave",     run_deinterleave},
+};
+
+// =========================================================================================== KERNEL CASES
+
+
+// Mean time of one run, in microseconds
+static double time_kernel(const Kernel_case& k, Bench_buffers& b, bool scalar, int iterations)
+{
+    k.run(b, scalar); // Warm up the caches
+
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    for (int i = 0; i < iterations; ++i) k.run(b, scalar);
+
+    Uint64 ticks = SDL_GetPerformanceCounter() - start;
+
+    return static_cast<double>(ticks) * 1e6 / static_cast<double>(SDL_GetPerformanceFrequency()) / iterations;
+}
+
+
+int main(int argc, char** argv)
+{
+    int iterations = 2000;
+    std::string out_path;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!std::strcmp(argv[i], "--iterations") && i + 1 < argc) iterations = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--out") && i + 1 < argc) out_path = argv[++i];
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--iterations N] [--out FILE]\n";
+            return -1;
+        }
+    }
+
+    if (iterations <= 0) iterations = 2000;
+
+
+    // Pseudo-random full-scale samples - fixed seed, repeatable runs
+    Bench_buffers b;
+
+    b.stereo.resize(VOICES * BUFFER_FRAMES * 2);
+    b.mono.resize(VOICES * BUFFER_FRAMES);
+    b.acc.resize(BUFFER_FRAMES * 2);
+    b.out.resize(BUFFER_FRAMES * 2);
+    b.left.resize(BUFFER_FRAMES);
+    b.right.resize(BUFFER_FRAMES);
+
+    std::uint32_t seed = 0x12345678u;
+
+    auto next = [&seed]() { seed = seed * 1664525u + 1013904223u; return seed; };
+
+    for (std::int16_t& s : b.stereo) s = static_cast<std::int16_t>(next() >> 16);
+    for (std::int16_t& s : b.mono) s = static_cast<std::int16_t>(next() >> 16);
+
+
+    std::ofstream file;
+
+    if (!out_path.empty())
+    {
+        file.open(out_path);
+
+        if (!file)
+        {
+            std::cerr << "Can't open the bench output file: " << out_path << "\n";
+            return -1;
+        }
+    }
+
+    std::ostream& out = out_path.empty() ? std::cout : file;
+
+    // Fixed decimals - no exponents (perf/perf_check.cmake reads the report)
+    out << std::fixed << std::setprecision(3);
+
+    out << "{\"kernels\":\"" << mix_kernel_name() << "\",\"frames\":" << BUFFER_FRAMES
+        << ",\"voices\":" << VOICES << ",\"unit\":\"us\",\"results\":[";
+
+    bool all_match = true;
+
+    for (size_t k = 0; k < sizeof(kernel_cases) / sizeof(kernel_cases[0]); ++k)
+    {
+        const Kernel_case& kc = kernel_cases[k];
+
+        // Same input, both versions - the outputs must be identical
+        kc.run(b, true);
+        std::vector<std::int16_t> scalar_out = b.out;
+
+        kc.run(b, false);
+        bool match = scalar_out == b.out;
+
+        all_match = all_match && match;
+
+        double scalar_us = time_kernel(kc, b, true, iterations);
+        double selected_us = time_kernel(kc, b, false, iterations);
+
+        out << (k ? "," : "") << "\n  {\"name\":\"" << kc.name << "\""
+            << ",\"scalar\":" << scalar_us
+            << ",\"selected\":" << selected_us
+            << ",\"speedup\":" << (selected_us > 0.0 ? scalar_us / selected_us : 0.0)
+            << ",\"match\":" << (match ? "true" : "false") << "}";
+    }
+
+    out << "\n]}\n";
+
+    return all_match ? 0 : 1;
+}
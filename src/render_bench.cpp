@@ -0,0 +1,661 @@
+// render_bench.cpp
+
+// Render benchmark of the synthetic scenes: draws the configurable scenes through the engine
+// render paths - no game states, no gameplay code - and reports the cost of every scene as JSON,
+// the baseline for tuning a render backend.
+//
+// Usage:
+//
+// ./miyoo_render_bench [--scenes NAME:COUNT,NAME:COUNT,...] [--frames N] [--warmup N] [--font FILE]
+//                      [--driver NAME] [--framebuffer] [--blitter] [--rgb565] [--out FILE]
+//
+// Scenes (COUNT is optional - the default one is used):
+//
+// circles - COUNT circles tessellated by the primitives (draw_circle) every frame
+// shapes  - COUNT circles of the Shape_cache - one textured copy each
+// sprites - COUNT sprites of one texture through the Sprite_batch, a quarter of them rotated
+// text    - COUNT blocks of a wrapped paragraph, laid out once and drawn by the font (needs --font)
+// layers  - Layer_stack of COUNT layers: the even ones cached (static rectangles), the odd ones live (moving circles)
+//
+// Without --scenes every scene runs with its default count. Every scene draws --frames measured
+// frames (300 by default) after --warmup ones (30, the cached textures and the driver warm up),
+// everything moves every frame. The backend flags are the ones of miyoo_render_replay: --driver
+// picks the SDL render driver by its name ("software", "opengles2"), --framebuffer draws into the
+// Linux framebuffer, --blitter offloads to the SoC 2D engine, --rgb565 is the 16-bit pipeline -
+// one run per backend, the reports diff line by line.
+//
+// Every frame is the engine render pass: Frame::begin() (the clear), the scene recording into the
+// Render_queue, its submission (the sort, the batching, the driver calls) and Frame::end() (the
+// present). There is no pacing and no vsync, the fps is the one of the measured frames back to back.
+// The video driver defaults to "dummy", the environment variable overrides it.
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+
+
+#include "../libs/engine/app_logic/app.h"
+#include "../libs/engine/render_queue/render_queue.h"
+#include "../libs/engine/render_stats/render_stats.h"
+#include "../libs/engine/primitives/primitives.h"
+#include "../libs/engine/shape_cache/shape_cache.h"
+#include "../libs/engine/layers/layer_stack.h"
+#include "../libs/engine/asset/streaming_image.h"
+#include "../libs/engine/asset/asset_instance.h"
+#include "../libs/engine/asset/asset_manager.h"
+#include "../libs/engine/asset/sprite_batch.h"
+#include "../libs/engine/asset/font_asset.h"
+#include "../libs/engine/blit/hw_blitter.h"
+#include "../libs/engine/log/log.h"
+
+
+// =========================================================================================== STATISTICS
+
+static double counter_to_us(Uint64 ticks)
+{
+    return static_cast<double>(ticks) * 1e6 / static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+
+// Writes {"min":..,"mean":..,"p99":..,"max":..} of the samples (sorted in place)
+static void write_stats(std::ostream& out, std::vector<double>& samples)
+{
+    if (samples.empty())
+    {
+        out << "{\"min\":0,\"mean\":0,\"p99\":0,\"max\":0}";
+        return;
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    double sum = 0.0;
+    for (double s : samples) sum += s;
+
+    // Nearest-rank percentile
+    size_t p99 = (samples.size() * 99 + 99) / 100 - 1;
+
+    out << "{\"min\":" << samples.front()
+        << ",\"mean\":" << sum / static_cast<double>(samples.size())
+        << ",\"p99\":" << samples[p99]
+        << ",\"max\":" << samples.back() << "}";
+}
+
+// =========================================================================================== STATISTICS
+
+
+// =========================================================================================== SCENES
+
+enum class Scene_kind
+{
+    CIRCLES,
+    SHAPES,
+    SPRITES,
+    TEXT,
+    LAYERS
+};
+
+
+struct Scene_def
+{
+    Scene_kind kind;
+    const char* name;
+    int default_count;
+};
+
+
+static const Scene_def scene_defs[] =
+{
+    {Scene_kind::CIRCLES, "circles", 256},
+    {Scene_kind::SHAPES,  "shapes",  256},
+    {Scene_kind::SPRITES, "sprites", 512},
+    {Scene_kind::TEXT,    "text",    16},
+    {Scene_kind::LAYERS,  "layers",  4}
+};
+
+
+// One scene of the run
+struct Bench_scene
+{
+    const Scene_def* def;
+    int count;
+};
+
+
+// Parses "NAME:COUNT,NAME:COUNT" (COUNT is optional - the default one is used)
+static bool parse_scenes(const std::string& list, std::vector<Bench_scene>& scenes)
+{
+    std::stringstream ss(list);
+    std::string item;
+
+    while (std::getline(ss, item, ','))
+    {
+        const size_t colon = item.find(':');
+        const std::string name = item.substr(0, colon);
+
+        const Scene_def* def = nullptr;
+
+        for (const Scene_def& d : scene_defs)
+            if (name == d.name) def = &d;
+
+        if (!def)
+        {
+            std::cerr << "Unknown scene: " << name << "\n";
+            return false;
+        }
+
+        const int count = colon != std::string::npos ? std::atoi(item.c_str() + colon + 1) : def->default_count;
+
+        if (count <= 0)
+        {
+            std::cerr << "Bad count of the scene: " << item << "\n";
+            return false;
+        }
+
+        scenes.push_back({def, count});
+    }
+
+    return !scenes.empty();
+}
+
+
+// Deterministic placement - the same scene on every backend and every run
+struct Bench_rng
+{
+    Uint32 state = 0x2545F491u;
+
+    float next(float range)
+    {
+        state = state * 1664525u + 1013904223u;
+        return static_cast<float>(state >> 8) / static_cast<float>(1u << 24) * range;
+    }
+};
+
+
+// Moving item of a scene: wraps around the view
+struct Bench_item
+{
+    float x, y;
+    float vx, vy;
+    float size;
+    SDL_Color color;
+};
+
+
+static std::vector<Bench_item> make_items(int count, float w, float h, float min_size, float max_size)
+{
+    Bench_rng rng;
+    std::vector<Bench_item> items(static_cast<size_t>(count));
+
+    for (Bench_item& it : items)
+    {
+        it.x = rng.next(w);
+        it.y = rng.next(h);
+        it.vx = rng.next(4.0f) - 2.0f;
+        it.vy = rng.next(4.0f) - 2.0f;
+        it.size = min_size + rng.next(max_size - min_size);
+        it.color = {static_cast<Uint8>(64 + rng.next(191.0f)), static_cast<Uint8>(64 + rng.next(191.0f)),
+                    static_cast<Uint8>(64 + rng.next(191.0f)), 255};
+    }
+
+    return items;
+}
+
+
+// Position of the item at the frame, wrapped into the view
+static SDL_FPoint item_at(const Bench_item& it, int frame, float w, float h)
+{
+    float x = std::fmod(it.x + it.vx * static_cast<float>(frame), w);
+    float y = std::fmod(it.y + it.vy * static_cast<float>(frame), h);
+
+    if (x < 0.0f) x += w;
+    if (y < 0.0f) y += h;
+
+    return {x, y};
+}
+
+
+// Soft disc of the sprite scene, straight alpha ARGB8888 (the streaming texture blend)
+static bool fill_sprite(Streaming_image& image)
+{
+    const int side = static_cast<int>(image.get_texel_width());
+
+    std::vector<Uint32> texels(static_cast<size_t>(side) * side);
+
+    const float r = side * 0.5f;
+
+    for (int y = 0; y < side; ++y)
+    {
+        for (int x = 0; x < side; ++x)
+        {
+            const float dx = x + 0.5f - r, dy = y + 0.5f - r;
+            const float edge = std::clamp(r - std::sqrt(dx * dx + dy * dy), 0.0f, 1.0f);
+
+            // Lighter towards the top left - the rotation shows
+            const Uint32 shade = static_cast<Uint32>(160 + 95 * (side - x - y + side) / (2 * side));
+            const Uint32 alpha = static_cast<Uint32>(edge * 255.0f);
+
+            texels[static_cast<size_t>(y) * side + x] = alpha << 24 | shade << 16 | shade << 8 | 255u;
+        }
+    }
+
+    return image.update(nullptr, texels.data(), side * 4);
+}
+
+
+static const char* const paragraph =
+    "The quick brown fox jumps over the lazy dog. Pack my box with five dozen liquor jugs. "
+    "How vexingly quick daft zebras jump! 0123456789 (+-*/=) [Start] [Select]";
+
+// =========================================================================================== SCENES
+
+
+// =========================================================================================== RUN
+
+// Samples of the measured frames of a scene
+struct Scene_result
+{
+    std::vector<double> frame_us, record_us, submit_us, present_us;
+    std::vector<double> draw_calls, batches, texture_binds;
+
+    // Why the scene didn't run, nullptr - it did
+    const char* skipped = nullptr;
+};
+
+
+// Draws the frames of the scene and collects the samples
+static void run_scene(sdl_app_ctx& app, const Bench_scene& scene, int frames, int warmup, const char* font_path,
+                      Scene_result& result)
+{
+    SDL_Renderer* r = app.renderer;
+
+    const float w = static_cast<float>(app.logical_width);
+    const float h = static_cast<float>(app.logical_height);
+
+    // === SCENE SETUP ===
+
+    std::vector<Bench_item> items;
+
+    Streaming_image sprite_image("bench/sprite", 32, 32);
+    std::vector<Image_instance*> sprites;
+    Sprite_batch batch;
+
+    Font_asset* font = nullptr;
+    Text_run text_run;
+
+    Layer_stack layers;
+    std::vector<std::vector<Bench_item>> layer_items;
+    int frame_index = 0;
+
+    switch (scene.def->kind)
+    {
+        case Scene_kind::CIRCLES:
+        case Scene_kind::SHAPES:
+            items = make_items(scene.count, w, h, 4.0f, 16.0f);
+
+            // A few radii - the shape cache holds a handful of textures, not one per circle
+            if (scene.def->kind == Scene_kind::SHAPES)
+                for (Bench_item& it : items) it.size = 4.0f + std::floor(it.size / 4.0f) * 4.0f;
+            break;
+
+        case Scene_kind::SPRITES:
+            if (!sprite_image.create(r) || !fill_sprite(sprite_image))
+            {
+                result.skipped = "no sprite texture";
+                return;
+            }
+
+            items = make_items(scene.count, w, h, 0.5f, 1.5f);
+
+            for (int i = 0; i < scene.count; ++i)
+            {
+                Image_instance* sprite = sprite_image.create_instance();
+
+                sprite->set_scaler(items[i].size, items[i].size);
+                if (i % 4 == 0) sprite->set_angle(static_cast<float>(i * 37 % 360));
+
+                sprites.push_back(sprite);
+            }
+
+            batch.set_view({0.0f, 0.0f, w, h});
+            break;
+
+        case Scene_kind::TEXT:
+            if (!font_path)
+            {
+                result.skipped = "no --font";
+                return;
+            }
+
+            font = Asset_manager::Instance().acquire_font(font_path);
+
+            if (!font || !font->is_loaded() || !font->get_image() || (!font->get_image()->get_texture() && !font->create_texture(r)))
+            {
+                if (font) Asset_manager::Instance().release(font);
+
+                result.skipped = "font not loaded";
+                return;
+            }
+
+            // Laid out once, like the Text_cache runs - the frames only move and color it
+            font->layout(paragraph, 1.0f, w * 0.4f, text_run);
+
+            items = make_items(scene.count, w, h, 0.0f, 1.0f);
+            break;
+
+        case Scene_kind::LAYERS:
+            layer_items.resize(static_cast<size_t>(scene.count));
+
+            for (int i = 0; i < scene.count; ++i)
+            {
+                const bool cached = i % 2 == 0;
+
+                layer_items[i] = make_items(cached ? 48 : 32, w, h, 6.0f, cached ? 40.0f : 12.0f);
+
+                const std::vector<Bench_item>* content = &layer_items[i];
+
+                if (cached)
+                {
+                    layers.add("cached " + std::to_string(i), [content](SDL_Renderer*)
+                    {
+                        for (const Bench_item& it : *content) draw_rect({it.x, it.y, it.size, it.size * 0.5f}, it.color);
+                    });
+                }
+                else
+                {
+                    layers.add("live " + std::to_string(i), [content, &frame_index, w, h](SDL_Renderer*)
+                    {
+                        for (const Bench_item& it : *content)
+                        {
+                            const SDL_FPoint p = item_at(it, frame_index, w, h);
+                            draw_circle(p.x, p.y, it.size, it.color);
+                        }
+                    }, false);
+                }
+            }
+            break;
+    }
+
+    // === SCENE SETUP ===
+
+
+    Frame& frame = Frame::Instance();
+    Render_queue& queue = Render_queue::Instance();
+    Render_stats& stats = Render_stats::Instance();
+
+    for (int f = 0; f < warmup + frames; ++f)
+    {
+        // The window events of the driver - nothing else runs
+        SDL_PumpEvents();
+
+        frame_index = f;
+
+        // The calls of the whole frame: the clear, the scene and the present copies
+        const std::uint64_t batches_before = queue.get_total_batch_count();
+        const Render_counts counts_before = stats.get_frame();
+
+        const Uint64 t0 = SDL_GetPerformanceCounter();
+
+        if (!frame.begin(r, true)) continue;
+
+        const Uint64 t1 = SDL_GetPerformanceCounter();
+
+        switch (scene.def->kind)
+        {
+            case Scene_kind::CIRCLES:
+                for (const Bench_item& it : items)
+                {
+                    const SDL_FPoint p = item_at(it, f, w, h);
+                    draw_circle(p.x, p.y, it.size, it.color);
+                }
+                break;
+
+            case Scene_kind::SHAPES:
+                for (const Bench_item& it : items)
+                {
+                    const SDL_FPoint p = item_at(it, f, w, h);
+                    Shape_cache::Instance().draw(r, Shape_desc::circle(static_cast<int>(it.size), it.color), p.x - it.size, p.y - it.size);
+                }
+                break;
+
+            case Scene_kind::SPRITES:
+                for (size_t i = 0; i < sprites.size(); ++i) batch.add(sprites[i], item_at(items[i], f, w, h), Image_anchor::CENTER_CENTER, items[i].color);
+
+                batch.submit();
+                break;
+
+            case Scene_kind::TEXT:
+                for (const Bench_item& it : items)
+                {
+                    const SDL_FPoint p = item_at(it, f, w, h);
+                    font->draw(text_run, p.x - text_run.width * 0.5f, p.y - text_run.height * 0.5f, it.color);
+                }
+                break;
+
+            case Scene_kind::LAYERS:
+                layers.render(r);
+                break;
+        }
+
+        const Uint64 t2 = SDL_GetPerformanceCounter();
+
+        queue.submit(r);
+
+        const Uint64 t3 = SDL_GetPerformanceCounter();
+
+        frame.end();
+
+        const Uint64 t4 = SDL_GetPerformanceCounter();
+
+        const Render_counts& counts = stats.get_frame();
+
+        // The warm-up builds the cached textures and wakes the driver up
+        if (f < warmup) continue;
+
+        result.frame_us.push_back(counter_to_us(t4 - t0));
+        result.record_us.push_back(counter_to_us(t2 - t1));
+        result.submit_us.push_back(counter_to_us(t3 - t2));
+        result.present_us.push_back(counter_to_us(t4 - t3));
+
+        result.draw_calls.push_back(static_cast<double>(counts.draw_calls - counts_before.draw_calls));
+        result.batches.push_back(static_cast<double>(queue.get_total_batch_count() - batches_before));
+        result.texture_binds.push_back(static_cast<double>(counts.texture_binds - counts_before.texture_binds));
+    }
+
+    if (font) Asset_manager::Instance().release(font);
+}
+
+// =========================================================================================== RUN
+
+
+static void print_usage(const char* exe)
+{
+    std::cerr << "Usage: " << exe << " [--scenes NAME:COUNT,...] [--frames N] [--warmup N] [--font FILE]"
+                                     " [--driver NAME] [--framebuffer] [--blitter] [--rgb565] [--out FILE]\n"
+                                     "Scenes: circles, shapes, sprites, text, layers\n";
+}
+
+
+int main(int argc, char** argv)
+{
+    std::string scene_list;
+    std::string out_path;
+    const char* driver = nullptr;
+    const char* font_path = nullptr;
+
+    bool framebuffer = false;
+    bool blitter = false;
+    bool rgb565 = false;
+
+    int frames = 300;
+    int warmup = 30;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!std::strcmp(argv[i], "--scenes") && i + 1 < argc) scene_list = argv[++i];
+        else if (!std::strcmp(argv[i], "--frames") && i + 1 < argc) frames = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--warmup") && i + 1 < argc) warmup = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--font") && i + 1 < argc) font_path = argv[++i];
+        else if (!std::strcmp(argv[i], "--driver") && i + 1 < argc) driver = argv[++i];
+        else if (!std::strcmp(argv[i], "--framebuffer")) framebuffer = true;
+        else if (!std::strcmp(argv[i], "--blitter")) blitter = true;
+        else if (!std::strcmp(argv[i], "--rgb565")) rgb565 = true;
+        else if (!std::strcmp(argv[i], "--out") && i + 1 < argc) out_path = argv[++i];
+        else
+        {
+            print_usage(argv[0]);
+            return -1;
+        }
+    }
+
+    std::vector<Bench_scene> scenes;
+
+    if (scene_list.empty())
+    {
+        for (const Scene_def& def : scene_defs) scenes.push_back({&def, def.default_count});
+    }
+    else if (!parse_scenes(scene_list, scenes))
+    {
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    if (frames < 1) frames = 1;
+    if (warmup < 0) warmup = 0;
+
+
+    // Headless by default - the hint has the lower priority than the environment variable
+    SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+
+    sdl_app_ctx app;
+
+    app.target_fps = 0.0;
+    app.request_vsync = false;
+
+    // The backend of the command line, nothing else of the build's defaults
+    app.use_framebuffer = framebuffer;
+    app.use_hw_blitter = blitter;
+    app.rgb565_backbuffer = rgb565;
+    app.render_driver = driver;
+    app.use_evdev_input = false;
+
+    // The chosen driver every run - no probe, no cache file
+    app.renderer_probe_path = nullptr;
+    app.decoded_cache_path = nullptr;
+
+    // Fixed clocks and fixed work, only the report on the output
+    app.enable_audio = false;
+    app.enable_saves = false;
+    app.enable_governor = false;
+    app.enable_quality_watchdog = false;
+    app.enable_dynamic_resolution = false;
+    app.frame_report = false;
+    app.render_report = false;
+    app.present_report = false;
+    app.asset_report = false;
+    app.frame_arena_report = false;
+    app.memory_report = false;
+    app.thread_roles_report = false;
+    app.input_latency_report = false;
+
+    Log::Instance().set_level(Log_level::WARNING);
+
+    if (!SDL_app_init(&app, app.logical_width, app.logical_height, "Miyoo Square Render Bench"))
+    {
+        std::cerr << "Failed to initialize SDL application." << std::endl;
+        return -1;
+    }
+
+    std::vector<Scene_result> results(scenes.size());
+
+    for (size_t i = 0; i < scenes.size(); ++i) run_scene(app, scenes[i], frames, warmup, font_path, results[i]);
+
+
+    // Report
+    std::ofstream file;
+
+    if (!out_path.empty())
+    {
+        file.open(out_path);
+
+        if (!file)
+        {
+            std::cerr << "Can't open the bench output file: " << out_path << "\n";
+            SDL_app_shutdown(&app);
+            return -1;
+        }
+    }
+
+    std::ostream& out = out_path.empty() ? std::cout : file;
+
+    SDL_RendererInfo info = {};
+    SDL_GetRendererInfo(app.renderer, &info);
+
+    // Fixed decimals - no exponents, the reports diff line by line
+    out << std::fixed << std::setprecision(3);
+
+    out << "{\"video_driver\":\"" << (SDL_GetCurrentVideoDriver() ? SDL_GetCurrentVideoDriver() : "") << "\""
+        << ",\"render_driver\":\"" << (info.name ? info.name : "") << "\""
+        << ",\"framebuffer\":" << (app.fb.is_open() ? "true" : "false")
+        << ",\"hw_blitter\":" << (Hw_blitter::Instance().is_active() ? "true" : "false")
+        << ",\"rgb565\":" << (rgb565 ? "true" : "false")
+        << ",\"view\":[" << app.logical_width << "," << app.logical_height << "]"
+        << ",\"frames\":" << frames
+        << ",\"warmup\":" << warmup
+        << ",\"unit\":\"us\""
+        << ",\n \"scenes\":[";
+
+    for (size_t i = 0; i < scenes.size(); ++i)
+    {
+        Scene_result& result = results[i];
+
+        out << (i ? ",\n  " : "\n  ") << "{\"name\":\"" << scenes[i].def->name << "\",\"count\":" << scenes[i].count;
+
+        if (result.skipped)
+        {
+            out << ",\"skipped\":\"" << result.skipped << "\"}";
+            continue;
+        }
+
+        double total_us = 0.0;
+        for (double us : result.frame_us) total_us += us;
+
+        out << ",\"fps\":" << (total_us > 0.0 ? static_cast<double>(result.frame_us.size()) * 1e6 / total_us : 0.0);
+
+        out << ",\n   \"frame\":";
+        write_stats(out, result.frame_us);
+
+        // The CPU side: the scene recording, then the sort, the batching and the driver calls
+        out << ",\n   \"record\":";
+        write_stats(out, result.record_us);
+
+        out << ",\n   \"submit\":";
+        write_stats(out, result.submit_us);
+
+        out << ",\n   \"present\":";
+        write_stats(out, result.present_us);
+
+        out << ",\n   \"draw_calls\":";
+        write_stats(out, result.draw_calls);
+
+        out << ",\n   \"batches\":";
+        write_stats(out, result.batches);
+
+        out << ",\n   \"texture_binds\":";
+        write_stats(out, result.texture_binds);
+
+        out << "}";
+    }
+
+    out << "]}\n";
+
+    SDL_app_shutdown(&app);
+
+    return 0;
+}
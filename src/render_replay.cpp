@@ -0,0 +1,269 @@
+// render_replay.cpp
+
+// Render backend benchmark: replays the render commands captured by the game
+// (./miyoo_square --capture-render FILE) on the chosen backend and reports the
+// time per frame as JSON - the same workload on every renderer, no gameplay code.
+//
+// Usage:
+//
+// ./miyoo_render_replay FILE [--driver NAME] [--framebuffer] [--blitter] [--rgb565] [--loops N] [--out FILE]
+//
+// --driver picks the SDL render driver by its name ("software", "opengles2"), the SDL default without it.
+// --framebuffer draws into the Linux framebuffer with the software renderer (Fb_backend), --blitter
+// offloads the fills and the copies to the SoC 2D engine on top of it, --rgb565 is the 16-bit
+// software pipeline. The captured frames are replayed --loops times (3 by default), the first loop
+// is the warm-up and is not measured.
+//
+// Every frame is the engine render pass: Frame::begin() (the clear), the captured submissions
+// through the Render_queue (the sort, the batching, the driver calls) and Frame::end() (the present).
+// There is no pacing and no vsync. The textures are placeholders of the captured sizes and formats.
+// The video driver defaults to "dummy", the environment variable overrides it.
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+
+#include "../libs/engine/app_logic/app.h"
+#include "../libs/engine/render_queue/render_queue.h"
+#include "../libs/engine/render_capture/render_capture.h"
+#include "../libs/engine/blit/hw_blitter.h"
+#include "../libs/engine/log/log.h"
+
+
+// =========================================================================================== STATISTICS
+
+static double counter_to_us(Uint64 ticks)
+{
+    return static_cast<double>(ticks) * 1e6 / static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+
+// Writes {"min":..,"mean":..,"p99":..,"max":..} of the samples (sorted in place)
+static void write_stats(std::ostream& out, std::vector<double>& samples)
+{
+    if (samples.empty())
+    {
+        out << "{\"min\":0,\"mean\":0,\"p99\":0,\"max\":0}";
+        return;
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    double sum = 0.0;
+    for (double s : samples) sum += s;
+
+    // Nearest-rank percentile
+    size_t p99 = (samples.size() * 99 + 99) / 100 - 1;
+
+    out << "{\"min\":" << samples.front()
+        << ",\"mean\":" << sum / static_cast<double>(samples.size())
+        << ",\"p99\":" << samples[p99]
+        << ",\"max\":" << samples.back() << "}";
+}
+
+// =========================================================================================== STATISTICS
+
+
+static void print_usage(const char* exe)
+{
+    std::cerr << "Usage: " << exe << " FILE [--driver NAME] [--framebuffer] [--blitter] [--rgb565] [--loops N] [--out FILE]\n";
+}
+
+
+int main(int argc, char** argv)
+{
+    std::string capture_path;
+    std::string out_path;
+    const char* driver = nullptr;
+
+    bool framebuffer = false;
+    bool blitter = false;
+    bool rgb565 = false;
+
+    int loops = 3;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!std::strcmp(argv[i], "--driver") && i + 1 < argc) driver = argv[++i];
+        else if (!std::strcmp(argv[i], "--framebuffer")) framebuffer = true;
+        else if (!std::strcmp(argv[i], "--blitter")) blitter = true;
+        else if (!std::strcmp(argv[i], "--rgb565")) rgb565 = true;
+        else if (!std::strcmp(argv[i], "--loops") && i + 1 < argc) loops = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--out") && i + 1 < argc) out_path = argv[++i];
+        else if (argv[i][0] != '-' && capture_path.empty()) capture_path = argv[i];
+        else
+        {
+            print_usage(argv[0]);
+            return -1;
+        }
+    }
+
+    if (capture_path.empty())
+    {
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    if (loops < 2) loops = 2;
+
+    Render_replay replay;
+
+    if (!replay.load(capture_path.c_str()) || replay.get_frame_count() == 0)
+    {
+        std::cerr << "Can't read the render capture (or it has no frames): " << capture_path << "\n";
+        return -1;
+    }
+
+
+    // Headless by default - the hint has the lower priority than the environment variable
+    SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+
+    sdl_app_ctx app;
+
+    app.target_fps = 0.0;
+    app.request_vsync = false;
+
+    // The backend of the command line, nothing else of the build's defaults
+    app.use_framebuffer = framebuffer;
+    app.use_hw_blitter = blitter;
+    app.rgb565_backbuffer = rgb565;
+    app.render_driver = driver;
+    app.use_evdev_input = false;
+
+    // The chosen driver every run - no probe, no cache file
+    app.renderer_probe_path = nullptr;
+
+    // The size the commands were recorded at
+    app.logical_width = replay.get_view_width();
+    app.logical_height = replay.get_view_height();
+
+    // Fixed clocks and fixed work, only the report on the output
+    app.enable_saves = false;
+    app.enable_governor = false;
+    app.enable_quality_watchdog = false;
+    app.enable_dynamic_resolution = false;
+    app.frame_report = false;
+    app.render_report = false;
+    app.frame_arena_report = false;
+    app.memory_report = false;
+
+    Log::Instance().set_level(Log_level::WARNING);
+
+    if (!SDL_app_init(&app, replay.get_view_width(), replay.get_view_height(), "Miyoo Square Render Replay"))
+    {
+        std::cerr << "Failed to initialize SDL application." << std::endl;
+        return -1;
+    }
+
+    if (!replay.create_textures(app.renderer))
+    {
+        std::cerr << "Can't create the placeholder textures." << std::endl;
+        SDL_app_shutdown(&app);
+        return -1;
+    }
+
+    Frame& frame = Frame::Instance();
+    Render_queue& queue = Render_queue::Instance();
+
+    std::vector<double> frame_us, render_us, present_us, batches;
+
+    for (int loop = 0; loop < loops; ++loop)
+    {
+        for (int f = 0; f < replay.get_frame_count(); ++f)
+        {
+            // The window events of the driver - nothing else runs
+            SDL_PumpEvents();
+
+            const Uint64 t0 = SDL_GetPerformanceCounter();
+
+            if (!frame.begin(app.renderer, true)) continue;
+
+            const std::uint64_t batches_before = queue.get_total_batch_count();
+
+            for (int s = 0; s < replay.get_submission_count(f); ++s)
+            {
+                replay.queue_submission(f, s);
+                queue.submit(app.renderer);
+            }
+
+            const Uint64 t1 = SDL_GetPerformanceCounter();
+
+            frame.end();
+
+            const Uint64 t2 = SDL_GetPerformanceCounter();
+
+            // The first loop warms the caches and the driver up
+            if (loop == 0) continue;
+
+            frame_us.push_back(counter_to_us(t2 - t0));
+            render_us.push_back(counter_to_us(t1 - t0));
+            present_us.push_back(counter_to_us(t2 - t1));
+            batches.push_back(static_cast<double>(queue.get_total_batch_count() - batches_before));
+        }
+    }
+
+
+    // Report
+    std::ofstream file;
+
+    if (!out_path.empty())
+    {
+        file.open(out_path);
+
+        if (!file)
+        {
+            std::cerr << "Can't open the replay output file: " << out_path << "\n";
+            replay.release_textures();
+            SDL_app_shutdown(&app);
+            return -1;
+        }
+    }
+
+    std::ostream& out = out_path.empty() ? std::cout : file;
+
+    SDL_RendererInfo info = {};
+    SDL_GetRendererInfo(app.renderer, &info);
+
+    // Fixed decimals - no exponents, the reports diff line by line
+    out << std::fixed << std::setprecision(3);
+
+    out << "{\"video_driver\":\"" << (SDL_GetCurrentVideoDriver() ? SDL_GetCurrentVideoDriver() : "") << "\""
+        << ",\"render_driver\":\"" << (info.name ? info.name : "") << "\""
+        << ",\"framebuffer\":" << (app.fb.is_open() ? "true" : "false")
+        << ",\"hw_blitter\":" << (Hw_blitter::Instance().is_active() ? "true" : "false")
+        << ",\"rgb565\":" << (rgb565 ? "true" : "false")
+        << ",\"view\":[" << replay.get_view_width() << "," << replay.get_view_height() << "]"
+        << ",\"captured_frames\":" << replay.get_frame_count()
+        << ",\"commands\":" << replay.get_command_count()
+        << ",\"vertices\":" << replay.get_vertex_count()
+        << ",\"textures\":" << replay.get_texture_count()
+        << ",\"measured_frames\":" << frame_us.size()
+        << ",\"unit\":\"us\"";
+
+    out << ",\n \"frame\":";
+    write_stats(out, frame_us);
+
+    // The clear and the submissions, then the present
+    out << ",\n \"render\":";
+    write_stats(out, render_us);
+
+    out << ",\n \"present\":";
+    write_stats(out, present_us);
+
+    out << ",\n \"batches\":";
+    write_stats(out, batches);
+
+    out << "}\n";
+
+    replay.release_textures();
+
+    SDL_app_shutdown(&app);
+
+    return 0;
+}
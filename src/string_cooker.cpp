@@ -0,0 +1,125 @@
+// string_cooker.cpp
+
+// Host-side string cooker: converts the text sources of a language into the string
+// table format (string_table.h), which the device uses in place - no parse at the load.
+//
+// Usage:
+//
+// ./miyoo_string_cooker KEYS.txt SOURCE.txt LANG OUT.str      LANG: en, ru
+// ./miyoo_string_cooker --enum KEYS.txt OUT.h                 the String_id enum of the keys
+//
+// Lang_state loads lang/<LANG>.str, pack them with miyoo_asset_cooker (as raw files)
+// to have them mapped instead of read.
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+#include "../libs/engine/lang_state/lang_state.h"
+
+
+static void print_usage(const char* exe)
+{
+    std::cerr << "Usage: " << exe << " KEYS.txt SOURCE.txt LANG OUT.str\n"
+              << "       " << exe << " --enum KEYS.txt OUT.h\n";
+}
+
+
+static bool read_text(const char* path, std::string& text)
+{
+    std::ifstream in(path, std::ios::binary);
+
+    if (!in)
+    {
+        std::cerr << "Can't open " << path << "\n";
+        return false;
+    }
+
+    std::stringstream source;
+    source << in.rdbuf();
+    text = source.str();
+
+    return true;
+}
+
+
+static bool write_data(const char* path, const void* data, size_t size)
+{
+    std::ofstream out(path, std::ios::binary);
+
+    if (!out || !out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size)))
+    {
+        std::cerr << "Can't write " << path << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+
+int main(int argc, char** argv)
+{
+    if (argc == 4 && !std::strcmp(argv[1], "--enum"))
+    {
+        std::string keys, header, error;
+
+        if (!read_text(argv[2], keys)) return -1;
+
+        if (!string_table_enum(keys, "String_id", header, error))
+        {
+            std::cerr << argv[2] << ", " << error << "\n";
+            return -1;
+        }
+
+        return write_data(argv[3], header.data(), header.size()) ? 0 : -1;
+    }
+
+    if (argc != 5)
+    {
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    // Lang_list by its code
+    unsigned int lang = 0;
+
+    while (lang < static_cast<unsigned int>(Lang_list::LIMIT) && std::strcmp(Lang_state::Get_lang_code(static_cast<Lang_list>(lang)), argv[3]))
+        ++lang;
+
+    if (lang == static_cast<unsigned int>(Lang_list::LIMIT))
+    {
+        std::cerr << "Unknown language " << argv[3] << "\n";
+        return -1;
+    }
+
+    std::string keys, source, error;
+
+    if (!read_text(argv[1], keys) || !read_text(argv[2], source)) return -1;
+
+    std::vector<std::uint8_t> table;
+
+    if (!string_table_cook(keys, source, lang, table, error))
+    {
+        std::cerr << argv[2] << ", " << error << "\n";
+        return -1;
+    }
+
+    // The cooked table is checked by the same view the game uses
+    String_table_view view;
+
+    if (!view.open(table.data(), table.size()))
+    {
+        std::cerr << "Cooked string table is not valid\n";
+        return -1;
+    }
+
+    if (!write_data(argv[4], table.data(), table.size())) return -1;
+
+    std::cout << "Strings '" << argv[3] << "': " << view.get_count() << " strings, " << table.size() << " bytes\n";
+
+    return 0;
+}